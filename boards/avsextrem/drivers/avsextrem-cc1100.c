@@ -220,7 +220,7 @@ void cc110x_gdo2_disable(void)
 
 void cc110x_gdo2_enable(void)
 {
-    gpioint_set(0, BIT28, GPIOINT_FALLING_EDGE, &cc110x_gdo2_irq);
+    gpioint_set(0, BIT28, GPIOINT_FALLING_EDGE | GPIOINT_HIGH_PRIO, &cc110x_gdo2_irq);
 }
 
 void cc110x_before_send(void)
@@ -237,7 +237,7 @@ void cc110x_after_send(void)
 
 void cc110x_gdo0_enable(void)
 {
-    gpioint_set(2, BIT6, GPIOINT_RISING_EDGE, &cc110x_gdo0_irq);
+    gpioint_set(2, BIT6, GPIOINT_RISING_EDGE | GPIOINT_HIGH_PRIO, &cc110x_gdo0_irq);
 }
 
 void cc110x_gdo0_disable(void)
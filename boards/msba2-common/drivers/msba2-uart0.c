@@ -36,6 +36,7 @@ and the mailinglist (subscription via web site)
 #include "lpc23xx.h"
 #include "VIC.h"
 #include "kernel.h"
+#include "irq.h"
 
 #include "board_uart0.h"
 
@@ -49,86 +50,56 @@ and the mailinglist (subscription via web site)
  * @note    $Id$
  */
 
-typedef struct toprint_t {
-    unsigned int len;
-    char content[];
-} toprint_t;
+/* Output is copied into a ring and handed to the 16 byte transmit FIFO
+ * by the THRE interrupt, so writers only wait when the ring is full.
+ * With interrupts disabled the ring is flushed and output is polled. */
+#define TX_BUFSIZE  (256)               /* power of two */
+#define FIFO_SIZE   (16)                /* transmit and receive FIFO */
 
-#define QUEUESIZE 255
-static volatile toprint_t *queue[QUEUESIZE];
-static volatile unsigned char queue_head = 0;
-static volatile unsigned char queue_tail = 0;
-static volatile unsigned char queue_items = 0;
+static char tx_buf[TX_BUFSIZE];
+static volatile unsigned int tx_head = 0;   /* next byte to write */
+static volatile unsigned int tx_tail = 0;   /* next byte to send */
+static volatile unsigned int running = 0;   /* THRE interrupt pending */
 
-static volatile unsigned int actual_pos = 0;
-static volatile unsigned int running = 0;
-static volatile unsigned int fifo = 0;
-
-static volatile toprint_t *actual = NULL;
-
-static inline void enqueue(void)
-{
-    queue_items++;
-    queue_tail++;
-}
-
-static inline void dequeue(void)
+/* moves up to a FIFO of bytes from the ring, the FIFO must be empty */
+static void tx_fill(void)
 {
-    actual = (queue[queue_head]);
-    queue_items--;
-    queue_head++;
-}
-
-static void  push_queue(void)
-{
-    running = 1;
-    lpm_prevent_sleep |= LPM_PREVENT_SLEEP_UART;
-start:
-
-    if (!actual) {
-        if (queue_items) {
-            dequeue();
-        }
-        else {
-            running = 0;
-            lpm_prevent_sleep &= ~LPM_PREVENT_SLEEP_UART;
+    int n = 0;
 
-            if (!fifo)
-                while (!(U0LSR & BIT6)) {};
-
-            return;
-        }
+    while ((tx_tail != tx_head) && (n++ < FIFO_SIZE)) {
+        U0THR = tx_buf[tx_tail++ & (TX_BUFSIZE - 1)];
     }
 
-    while ((actual_pos < actual->len)  && (fifo++ < 16)) {
-        U0THR = actual->content[actual_pos++];
-    }
+    running = (n > 0);
 
-    if (actual_pos == actual->len) {
-        free((void *)actual);
-        actual = NULL;
-        actual_pos = 0;
-        goto start;
+    if (running) {
+        lpm_prevent_sleep |= LPM_PREVENT_SLEEP_UART;
+    }
+    else {
+        lpm_prevent_sleep &= ~LPM_PREVENT_SLEEP_UART;
     }
 }
 
 int uart_active(void)
 {
-    return (running || fifo);
+    return (running || !(U0LSR & ULSR_TEMT));
 }
 
 void stdio_flush(void)
 {
     U0IER &= ~BIT1;                             // disable THRE interrupt
 
-    while (running) {
-        while (!(U0LSR & (BIT5 | BIT6))) {};    // transmit fifo
-
-        fifo = 0;
+    while (tx_tail != tx_head) {
+        while (!(U0LSR & ULSR_THRE)) {};        // transmit fifo empty
 
-        push_queue();                           // dequeue to fifo
+        tx_fill();
     }
 
+    while (!(U0LSR & ULSR_TEMT)) {};
+
+    running = 0;
+    lpm_prevent_sleep &= ~LPM_PREVENT_SLEEP_UART;
+
     U0IER |= BIT1;                              // enable THRE interrupt
 }
 
@@ -140,20 +111,22 @@ void UART0_IRQHandler(void)
 
     switch (iir & UIIR_ID_MASK) {
         case UIIR_THRE_INT:               // Transmit Holding Register Empty
-            fifo = 0;
-            push_queue();
+            tx_fill();
             break;
 
         case UIIR_CTI_INT:                // Character Timeout Indicator
         case UIIR_RDA_INT:                // Receive Data Available
 #ifdef MODULE_UART0
             if (uart0_handler_pid) {
+                char buf[FIFO_SIZE];
+                int n = 0;
+
                 do {
-                    int c = U0RBR;
-                    uart0_handle_incoming(c);
+                    buf[n++] = U0RBR;
                 }
-                while (U0LSR & ULSR_RDR);
+                while ((U0LSR & ULSR_RDR) && (n < FIFO_SIZE));
 
+                uart0_handle_incoming_block(buf, n);
                 uart0_notify_thread();
             }
 
@@ -169,35 +142,48 @@ void UART0_IRQHandler(void)
     VICVectAddr = 0;                    // Acknowledge Interrupt
 }
 
-static inline int uart0_puts(char *astring, int length)
+int fw_puts(char *astring, int length)
 {
-    /*    while (queue_items == (QUEUESIZE-1)) {} ;
-        U0IER = 0;
-        queue[queue_tail] = malloc(length+sizeof(unsigned int));
-        queue[queue_tail]->len = length;
-        memcpy(&queue[queue_tail]->content,astring,length);
-        enqueue();
-        if (!running)
-            push_queue();
-        U0IER |= BIT0 | BIT1;       // enable RX irq
-    */
-    /* alternative without queue:*/
-    int i;
-
-    for (i = 0; i < length; i++) {
-        while (!(U0LSR & BIT5));
-
-        U0THR = astring[i];
+    unsigned state = disableIRQ();
+    int i = 0;
+
+    if ((state & BIT7) || inISR()) {          // CPSR I bit: IRQs were disabled
+        /* no THRE interrupt will drain the ring */
+        stdio_flush();
+
+        for (i = 0; i < length; i++) {
+            while (!(U0LSR & ULSR_THRE));
+
+            U0THR = astring[i];
+        }
+
+        restoreIRQ(state);
+        return length;
     }
 
-    /*    */
+    restoreIRQ(state);
 
-    return length;
-}
+    while (i < length) {
+        while ((i < length) && (tx_head - tx_tail < TX_BUFSIZE)) {
+            tx_buf[tx_head & (TX_BUFSIZE - 1)] = astring[i++];
+            tx_head++;
+        }
 
-int fw_puts(char *astring, int length)
-{
-    return uart0_puts(astring, length);
+        state = disableIRQ();
+
+        if (!running) {
+            /* at most the last polled byte is left in the FIFO */
+            while (!(U0LSR & ULSR_THRE));
+
+            tx_fill();
+        }
+
+        restoreIRQ(state);
+
+        while (tx_head - tx_tail == TX_BUFSIZE);     // ring full
+    }
+
+    return length;
 }
 
 int
@@ -220,10 +206,10 @@ bl_uart_init(void)
     U0DLL = 0x04;
 
     U0LCR = 0x03;       // DLAB = 0
-    U0FCR = 0x07;       // Enable and reset TX and RX FIFO
+    U0FCR = 0x87;       // Enable and reset TX and RX FIFO, RX irq at 8 bytes
 
     /* irq */
     install_irq(UART0_INT, UART0_IRQHandler, 6);
-    U0IER |= BIT0;       // enable only RX irq
+    U0IER |= BIT0 | BIT1;   // enable RX and THRE irq
     return 1;
 }
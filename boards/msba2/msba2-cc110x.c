@@ -39,6 +39,7 @@ and the mailinglist (subscription via web site)
 
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
 /* core */
 #include "irq.h"
 /* cpu */
@@ -175,6 +176,87 @@ uint8_t cc110x_txrx(uint8_t c)
     return result;
 }
 
+#ifdef CC110X_TXRX_BURST
+#define DMA_BURST_MIN               (8)         // shorter bursts are not worth the setup
+#define DMA_BURST_MAX               (64)        // size of the RX FIFO
+#define DMA_SSP0_TX                 (0)         // GPDMA request line of the SSP0 transmitter
+#define DMA_SSP0_RX                 (1)         // GPDMA request line of the SSP0 receiver
+#define DMA_CTRL_SI                 (BIT26)     // source increment
+#define DMA_CTRL_DI                 (BIT27)     // destination increment
+#define DMA_CTRL_I                  (BIT31)     // terminal count flag
+#define DMA_CFG_E                   (BIT0)      // channel enable
+#define DMA_CFG_M2P                 (1 << 11)
+#define DMA_CFG_P2M                 (2 << 11)
+#define DMA_NOBYTE                  (0xFF)      // CC1100_NOBYTE
+
+// the GPDMA can't reach the local RAM, bursts are bounced through USB RAM
+static uint8_t dma_tx_buf[DMA_BURST_MAX] __attribute__((section(".usbdata")));
+static uint8_t dma_rx_buf[DMA_BURST_MAX] __attribute__((section(".usbdata")));
+
+void cc110x_txrx_burst(const char *tx, char *rx, uint8_t count)
+{
+    uint8_t i;
+
+    // both channels are needed, channel 0 is taken while the MCI transfers
+    if ((count < DMA_BURST_MIN) || (count > DMA_BURST_MAX) ||
+        (GPDMA_ENABLED_CHNS & (BIT0 | BIT1))) {
+        for (i = 0; i < count; i++) {
+            char c = cc110x_txrx(tx ? tx[i] : DMA_NOBYTE);
+
+            if (rx) {
+                rx[i] = c;
+            }
+        }
+
+        return;
+    }
+
+    if (tx) {
+        memcpy(dma_tx_buf, tx, count);
+    }
+    else {
+        memset(dma_tx_buf, DMA_NOBYTE, count);
+    }
+
+    PCONP |= PCGPDMA;
+    GPDMA_CONFIG = 0x01;                        // enable, little-endian
+    GPDMA_INT_TCCLR = BIT0 | BIT1;
+    GPDMA_INT_ERR_CLR = BIT0 | BIT1;
+
+    // receiver first, so no byte is missed
+    GPDMA_CH0_SRC = (unsigned long) &SSP0DR;
+    GPDMA_CH0_DEST = (unsigned long) dma_rx_buf;
+    GPDMA_CH0_LLI = 0;
+    GPDMA_CH0_CTRL = count | DMA_CTRL_DI | DMA_CTRL_I;
+    GPDMA_CH0_CFG = DMA_CFG_E | (DMA_SSP0_RX << 1) | DMA_CFG_P2M;
+
+    GPDMA_CH1_SRC = (unsigned long) dma_tx_buf;
+    GPDMA_CH1_DEST = (unsigned long) &SSP0DR;
+    GPDMA_CH1_LLI = 0;
+    GPDMA_CH1_CTRL = count | DMA_CTRL_SI;
+    GPDMA_CH1_CFG = DMA_CFG_E | (DMA_SSP0_TX << 6) | DMA_CFG_M2P;
+
+    SSP0DMACR = BIT0 | BIT1;                    // RXDMAE, TXDMAE
+
+    // every byte has been clocked in once the receiver is done
+    while (!(GPDMA_RAW_INT_TCSTAT & BIT0)) {
+        if (GPDMA_RAW_INT_ERR_STAT & (BIT0 | BIT1)) {
+            break;
+        }
+    }
+
+    SSP0DMACR = 0;
+    GPDMA_CH0_CFG = 0;
+    GPDMA_CH1_CFG = 0;
+    GPDMA_INT_TCCLR = BIT0 | BIT1;
+    GPDMA_INT_ERR_CLR = BIT0 | BIT1;
+
+    if (rx) {
+        memcpy(rx, dma_rx_buf, count);
+    }
+}
+#endif
+
 void cc110x_spi_cs(void)
 {
     FIO1CLR = BIT21;
@@ -240,7 +322,7 @@ void cc110x_after_send(void)
 
 void cc110x_gdo0_enable(void)
 {
-    gpioint_set(0, BIT27, GPIOINT_RISING_EDGE, &cc110x_gdo0_irq);
+    gpioint_set(0, BIT27, GPIOINT_RISING_EDGE | GPIOINT_HIGH_PRIO, &cc110x_gdo0_irq);
 }
 
 void cc110x_gdo0_disable(void)
@@ -255,7 +337,7 @@ void cc110x_gdo2_disable(void)
 
 void cc110x_gdo2_enable(void)
 {
-    gpioint_set(0, BIT28, GPIOINT_FALLING_EDGE, &cc110x_gdo2_irq);
+    gpioint_set(0, BIT28, GPIOINT_FALLING_EDGE | GPIOINT_HIGH_PRIO, &cc110x_gdo2_irq);
 }
 
 void cc110x_init_interrupts(void)
@@ -190,9 +190,7 @@ void handle_uart_in()
             errx(EXIT_FAILURE, "handle_uart_in: unhandled situation!");
         }
     }
-    for(int pos = 0; pos < nread; pos++) {
-        uart0_handle_incoming(buf[pos]);
-    }
+    uart0_handle_incoming_block(buf, nread);
     uart0_notify_thread();
 
     thread_yield();
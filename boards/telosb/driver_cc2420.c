@@ -101,6 +101,11 @@ int cc2420_get_fifop(void)
     return CC2420_FIFOP;
 }
 
+int cc2420_get_fifo(void)
+{
+    return CC2420_GIO0;
+}
+
 uint8_t cc2420_get_sfd(void)
 {
     return CC2420_SFD;
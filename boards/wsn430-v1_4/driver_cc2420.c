@@ -96,6 +96,16 @@ int cc2420_get_gdo2(void)
     return CC2420_GDO2;
 }
 
+int cc2420_get_fifop(void)
+{
+    return CC2420_GDO2;
+}
+
+int cc2420_get_fifo(void)
+{
+    return CC2420_GDO0;
+}
+
 uint8_t cc2420_get_sfd(void)
 {
     return CC2420_SFD;
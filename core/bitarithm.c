@@ -48,6 +48,11 @@ number_of_highest_bit(unsigned v)
 unsigned
 number_of_lowest_bit(register unsigned v)
 {
+#if defined(__ARM_FEATURE_CLZ) || defined(__ARM_ARCH_7M__) || \
+    defined(__ARM_ARCH_7EM__)
+    /* isolate the lowest bit and count the zeros above it */
+    return 31 - __builtin_clz(v & -v);
+#else
     register unsigned r = 0;
 
     while ((v & 0x01) == 0) {
@@ -56,6 +61,7 @@ number_of_lowest_bit(register unsigned v)
     };
 
     return r;
+#endif
 }
 /*---------------------------------------------------------------------------*/
 unsigned
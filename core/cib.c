@@ -54,15 +54,3 @@ int cib_put(cib_t *cib)
 
     return -1;
 }
-
-/*
-int main() {
-    cib_t cib;
-
-    cib_init(&cib, 0);
-
-    int res = cib_get(&cib);
-
-    printf("%i\n", res);
-}
-*/
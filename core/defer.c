@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup     core_defer
+ * @{
+ *
+ * @file        defer.c
+ * @brief       Deferred work thread
+ *
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "kernel.h"
+#include "thread.h"
+#include "hwtimer.h"
+#include "irq.h"
+#include "defer.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+static char defer_stack[DEFER_STACKSIZE];
+static volatile int defer_pid = -1;
+
+/* FIFO of pending work, guarded by disabling interrupts */
+static defer_t *head;
+static defer_t *tail;
+
+static void defer_thread(void)
+{
+    while (1) {
+        unsigned int state = disableIRQ();
+        defer_t *work = head;
+
+        if (work == NULL) {
+            /* marked sleeping before interrupts are enabled again,
+             * so a schedule from here on wakes us up */
+            thread_sleep();
+            continue;
+        }
+
+        work->pending--;
+
+        if (work->pending == 0) {
+            head = work->next;
+
+            if (head == NULL) {
+                tail = NULL;
+            }
+
+            work->next = NULL;
+        }
+
+        restoreIRQ(state);
+
+        DEBUG("defer: running %p\n", work);
+        work->handler(work);
+    }
+}
+
+int defer_init(void)
+{
+    if (defer_pid < 0) {
+        defer_pid = thread_create(defer_stack, DEFER_STACKSIZE, DEFER_PRIORITY,
+                                  CREATE_STACKTEST, defer_thread, "defer");
+    }
+
+    return defer_pid;
+}
+
+int defer_schedule(defer_t *work)
+{
+    unsigned int state;
+
+    if (defer_pid < 0) {
+        return -1;
+    }
+
+    state = disableIRQ();
+
+    if (work->pending++) {
+        restoreIRQ(state);
+        return 0;
+    }
+
+    work->time = hwtimer_now();
+    work->next = NULL;
+
+    if (tail) {
+        tail->next = work;
+    }
+    else {
+        head = work;
+    }
+
+    tail = work;
+    restoreIRQ(state);
+
+    thread_wakeup(defer_pid);
+    return 1;
+}
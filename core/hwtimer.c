@@ -38,22 +38,117 @@
 
 /*---------------------------------------------------------------------------*/
 
-typedef struct hwtimer_t {
-    void (*callback)(void*);
-    void *data;
-} hwtimer_t;
+/* the hardware channel all timers are multiplexed on */
+#define CHANNEL     (0)
 
-static hwtimer_t timer[HWTIMER_MAXTIMERS];
-static int lifo[HWTIMER_MAXTIMERS + 1];
+/* deadlines this close to now are moved to enable the compare match */
+#define MIN_TICKS   (2)
+
+static hwtimer_entry_t timer[HWTIMER_VIRTUAL_TIMERS];
+static int lifo[HWTIMER_VIRTUAL_TIMERS + 1];
+
+/* pending timers sorted by deadline */
+static hwtimer_entry_t *queue;
+static int dispatching;
 
 /*---------------------------------------------------------------------------*/
 
+static void arm(void)
+{
+    unsigned long now = hwtimer_arch_now();
+    unsigned long deadline = queue->deadline;
+
+    if ((long)(deadline - now) < MIN_TICKS) {
+        deadline = now + MIN_TICKS;
+    }
+
+    hwtimer_arch_set_absolute(deadline, CHANNEL);
+}
+
+/* called with interrupts disabled */
+static void enqueue(hwtimer_entry_t *t)
+{
+    hwtimer_entry_t **p = &queue;
+
+    /* behind timers with the same deadline */
+    while (*p && ((long)((*p)->deadline - t->deadline) <= 0)) {
+        p = &(*p)->next;
+    }
+
+    t->next = *p;
+    t->pprev = p;
+
+    if (*p) {
+        (*p)->pprev = &t->next;
+    }
+
+    *p = t;
+
+    if ((queue == t) && !dispatching) {
+        arm();
+    }
+}
+
+/* called with interrupts disabled, returns 0 if *t* was not pending */
+static int dequeue(hwtimer_entry_t *t)
+{
+    hwtimer_entry_t **p = t->pprev;
+
+    if (p == NULL) {
+        return 0;
+    }
+
+    *p = t->next;
+
+    if (t->next) {
+        t->next->pprev = p;
+    }
+
+    t->pprev = NULL;
+
+    if ((p == &queue) && !dispatching) {
+        if (queue) {
+            arm();
+        }
+        else {
+            hwtimer_arch_unset(CHANNEL);
+        }
+    }
+
+    return 1;
+}
+
 static void multiplexer(int source)
 {
-    lifo_insert(lifo, source);
-    lpm_prevent_sleep--;
+    (void) source;
 
-    timer[source].callback(timer[source].data);
+    dispatching = 1;
+
+    while (queue && ((long)(queue->deadline - hwtimer_arch_now()) <= 0)) {
+        hwtimer_entry_t *t = queue;
+
+        queue = t->next;
+        t->pprev = NULL;
+
+        if (queue) {
+            queue->pprev = &queue;
+        }
+
+        if ((t >= timer) && (t < timer + HWTIMER_VIRTUAL_TIMERS)) {
+            lifo_insert(lifo, t - timer);
+        }
+
+        t->callback(t->data);
+    }
+
+    dispatching = 0;
+
+    if (queue) {
+        arm();
+    }
+    else {
+        hwtimer_arch_unset(CHANNEL);
+    }
 }
 
 static void hwtimer_releasemutex(void* mutex) {
@@ -100,9 +195,9 @@ void hwtimer_init_comp(uint32_t fcpu)
 {
     hwtimer_arch_init(multiplexer, fcpu);
 
-    lifo_init(lifo, HWTIMER_MAXTIMERS);
+    lifo_init(lifo, HWTIMER_VIRTUAL_TIMERS);
 
-    for (int i = 0; i < HWTIMER_MAXTIMERS; i++) {
+    for (int i = 0; i < HWTIMER_VIRTUAL_TIMERS; i++) {
         lifo_insert(lifo, i);
     }
 }
@@ -123,11 +218,27 @@ unsigned long hwtimer_now(void)
 
 /*---------------------------------------------------------------------------*/
 
+int hwtimer_next(unsigned long *deadline)
+{
+    unsigned state = disableIRQ();
+    int pending = (queue != NULL);
+
+    if (pending) {
+        *deadline = queue->deadline;
+    }
+
+    restoreIRQ(state);
+    return pending;
+}
+
+/*---------------------------------------------------------------------------*/
+
 void hwtimer_wait(unsigned long ticks)
 {
     DEBUG("hwtimer_wait ticks=%lu\n", ticks);
 
     mutex_t mutex;
+    hwtimer_entry_t t = { .next = NULL };
 
     if (ticks <= 6 || inISR()) {
         hwtimer_spin(ticks);
@@ -136,12 +247,7 @@ void hwtimer_wait(unsigned long ticks)
     mutex_init(&mutex);
     mutex_lock(&mutex);
     /* -2 is to adjust the real value */
-    int res = hwtimer_set(ticks - 2, hwtimer_releasemutex, &mutex);
-    if (res == -1) {
-        mutex_unlock(&mutex);
-        hwtimer_spin(ticks);
-        return;
-    }
+    hwtimer_entry_set(&t, ticks - 2, hwtimer_releasemutex, &mutex);
 
     /* try to lock mutex again will cause the thread to go into
      * STATUS_MUTEX_BLOCKED until hwtimer fires the releasemutex */
@@ -172,17 +278,9 @@ static int _hwtimer_set(unsigned long offset, void (*callback)(void*), void *ptr
 
     timer[n].callback = callback;
     timer[n].data = ptr;
-
-    if (absolute) {
-        DEBUG("hwtimer_arch_set_absolute n=%d\n", n);
-        hwtimer_arch_set_absolute(offset, n);
-    }
-    else {
-        DEBUG("hwtimer_arch_set n=%d\n", n);
-        hwtimer_arch_set(offset, n);
-    }
-
-    lpm_prevent_sleep++;
+    timer[n].deadline = absolute ? offset : hwtimer_arch_now() + offset;
+    DEBUG("_hwtimer_set n=%d deadline=%lu\n", n, timer[n].deadline);
+    enqueue(&timer[n]);
 
     if (!inISR()) {
         eINT();
@@ -207,14 +305,57 @@ int hwtimer_set_absolute(unsigned long offset, void (*callback)(void*), void *pt
 int hwtimer_remove(int n)
 {
     DEBUG("hwtimer_remove n=%d\n", n);
-    hwtimer_arch_disable_interrupt();
-    hwtimer_arch_unset(n);
 
-    lifo_insert(lifo, n);
+    if (!inISR()) {
+        dINT();
+    }
+
+    /* a timer that fired is back in the lifo already */
+    if (dequeue(&timer[n])) {
+        lifo_insert(lifo, n);
+    }
+
     timer[n].callback = NULL;
 
-    lpm_prevent_sleep--;
+    if (!inISR()) {
+        eINT();
+    }
 
-    hwtimer_arch_enable_interrupt();
     return 1;
 }
+
+/*---------------------------------------------------------------------------*/
+
+static void _hwtimer_entry_set(hwtimer_entry_t *t, unsigned long deadline,
+                               void (*callback)(void*), void *ptr)
+{
+    unsigned state = disableIRQ();
+
+    dequeue(t);
+    t->callback = callback;
+    t->data = ptr;
+    t->deadline = deadline;
+    enqueue(t);
+
+    restoreIRQ(state);
+}
+
+void hwtimer_entry_set(hwtimer_entry_t *t, unsigned long offset,
+                       void (*callback)(void*), void *ptr)
+{
+    _hwtimer_entry_set(t, hwtimer_arch_now() + offset, callback, ptr);
+}
+
+void hwtimer_entry_set_absolute(hwtimer_entry_t *t, unsigned long absolute,
+                                void (*callback)(void*), void *ptr)
+{
+    _hwtimer_entry_set(t, absolute, callback, ptr);
+}
+
+void hwtimer_entry_remove(hwtimer_entry_t *t)
+{
+    unsigned state = disableIRQ();
+
+    dequeue(t);
+    restoreIRQ(state);
+}
@@ -13,6 +13,10 @@
  * @file        atomic.h
  * @brief       Atomic function declarations
  *
+ * Cortex-M3 uses exclusive loads and stores, native the atomic builtins of
+ * the compiler, the other CPUs mask interrupts around the operation.  All
+ * of them may be called from interrupts.
+ *
  * @author      Freie Universität Berlin, Computer Systems & Telematics
  * @author      Kaspar Schleiser <kaspar@schleiser.de>
  */
@@ -26,5 +30,33 @@
 
 extern unsigned int atomic_set_return(unsigned int *val, unsigned int set);
 
+/**
+ * @brief sets "val" to "set" if it equals "old", atomically
+ *
+ * @return 1 if "val" was set, 0 otherwise
+ */
+extern int atomic_cas(unsigned int *val, unsigned int old, unsigned int set);
+
+/**
+ * @brief adds "inc" to "val", atomically; subtracts with "-inc"
+ *
+ * @return the old "val"
+ */
+extern unsigned int atomic_fetch_add(unsigned int *val, unsigned int inc);
+
+/**
+ * @brief sets the bits of "mask" in "val", atomically
+ *
+ * @return the old "val"
+ */
+extern unsigned int atomic_fetch_or(unsigned int *val, unsigned int mask);
+
+/**
+ * @brief clears the bits not in "mask" from "val", atomically
+ *
+ * @return the old "val"
+ */
+extern unsigned int atomic_fetch_and(unsigned int *val, unsigned int mask);
+
 /** @} */
 #endif /* _ATOMIC_H */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    core_defer Deferred work
+ * @brief       Moves interrupt work into a high priority thread
+ * @ingroup     core
+ * @{
+ *
+ * @file        defer.h
+ * @brief       Bottom halves for interrupt handlers
+ *
+ * An interrupt handler only schedules a work item, its handler runs right
+ * after the interrupt returns in the defer thread, with interrupts enabled.
+ * Other peripherals (hwtimer, UART) keep their latency while the work is done.
+ */
+
+#ifndef _DEFER_H
+#define _DEFER_H
+
+/**
+ * @brief Priority of the defer thread, above all other threads.
+ */
+#ifndef DEFER_PRIORITY
+#define DEFER_PRIORITY      (0)
+#endif
+
+/**
+ * @brief Stack size of the defer thread, handlers run on it.
+ */
+#ifndef DEFER_STACKSIZE
+#define DEFER_STACKSIZE     (KERNEL_CONF_STACKSIZE_DEFAULT)
+#endif
+
+/**
+ * @brief Work item, statically allocated by its user.
+ */
+typedef struct defer_t {
+    struct defer_t *next;               // @internal
+    void (*handler)(struct defer_t *);  ///< called once per schedule
+    volatile unsigned int pending;      ///< schedules not handled yet
+    unsigned long time;                 ///< hwtimer_now() of the first pending schedule
+} defer_t;
+
+/**
+ * @brief Static initializer for a work item calling *handler*.
+ */
+#define DEFER_INIT(handler) { NULL, handler, 0, 0 }
+
+/**
+ * @brief Starts the defer thread, only the first call does something.
+ *
+ * @return PID of the defer thread, negative on error.
+ */
+int defer_init(void);
+
+/**
+ * @brief Schedules *work*, callable from interrupt context.
+ * @details Work scheduled again before it ran is handled once per schedule.
+ *
+ * @param work Work item to schedule.
+ *
+ * @return 1 if *work* was queued, 0 if it was already pending,
+ *         -1 if the defer thread is not running.
+ */
+int defer_schedule(defer_t *work);
+
+/** @} */
+#endif /* _DEFER_H */
@@ -20,6 +20,11 @@
  * <b>The hardware timer must not be used within applications</b>, use \ref vtimer
  * instead.
  *
+ * All timers share one hardware channel that is armed for the earliest
+ * deadline.  hwtimer_set() hands out one of HWTIMER_VIRTUAL_TIMERS ids,
+ * hwtimer_entry_set() takes a caller provided ::hwtimer_entry_t and never
+ * runs out.
+ *
  * @{
  *
  * @file        hwtimer.h
@@ -36,6 +41,7 @@
 
 #include <stdint.h>
 #include "hwtimer_cpu.h"
+#include "hwtimer_entry.h"
 
 /**
  * @def    HWTIMER_SPEED
@@ -72,8 +78,16 @@
  */
 #define HWTIMER_OVERFLOW_MICROS()        (1000000L / HWTIMER_SPEED * HWTIMER_MAXTICKS)
 
+/**
+ * @brief    Number of timers available to hwtimer_set()
+ */
+#ifndef HWTIMER_VIRTUAL_TIMERS
+#define HWTIMER_VIRTUAL_TIMERS      (8)
+#endif
+
 typedef uint32_t timer_tick_t;
 
+
 void hwtimer_init(void);
 void hwtimer_init_comp(uint32_t fcpu);
 
@@ -88,7 +102,7 @@ unsigned long hwtimer_now(void);
  * @param[in]    offset        Offset until callback invocation in timer ticks
  * @param[in]    callback    Callback function
  * @param[in]    ptr            Argument to callback function
- * @return        timer id
+ * @return        timer id, -1 if all HWTIMER_VIRTUAL_TIMERS are in use
  */
 int hwtimer_set(unsigned long offset, void (*callback)(void*), void *ptr);
 
@@ -108,6 +122,47 @@ int hwtimer_set_absolute(unsigned long absolute, void (*callback)(void*), void *
  */
 int hwtimer_remove(int t);
 
+/**
+ * @brief Set a timer on caller provided storage
+ *
+ * A pending *t* is rescheduled.  *t* must be zeroed before its first use
+ * and stay valid until it fired or was removed.
+ *
+ * @param[in]    t           The timer
+ * @param[in]    offset      Offset until callback invocation in timer ticks
+ * @param[in]    callback    Callback function
+ * @param[in]    ptr         Argument to callback function
+ */
+void hwtimer_entry_set(hwtimer_entry_t *t, unsigned long offset,
+                       void (*callback)(void*), void *ptr);
+
+/**
+ * @brief Set a timer on caller provided storage to an absolute time
+ *
+ * @param[in]    t           The timer
+ * @param[in]    absolute    Absolute timer counter value for invocation of handler
+ * @param[in]    callback    Callback function
+ * @param[in]    ptr         Argument to callback function
+ */
+void hwtimer_entry_set_absolute(hwtimer_entry_t *t, unsigned long absolute,
+                                void (*callback)(void*), void *ptr);
+
+/**
+ * @brief Remove a timer set with hwtimer_entry_set(), if it is pending
+ *
+ * Takes constant time, the timer knows its place in the queue.
+ *
+ * @param[in]    t            The timer
+ */
+void hwtimer_entry_remove(hwtimer_entry_t *t);
+
+/**
+ * @brief Get the deadline of the next pending timer
+ * @param[out]   deadline     Absolute deadline in timer ticks
+ * @return        1 if a timer is pending, 0 otherwise
+ */
+int hwtimer_next(unsigned long *deadline);
+
 /**
  * @brief    Delay current thread
  * @param[in]    ticks        Number of kernel ticks to delay
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @addtogroup  core_hwtimer
+ * @{
+ *
+ * @file        hwtimer_entry.h
+ * @brief       Timer on caller provided storage
+ *
+ * Kept apart from hwtimer.h, which includes the cpu headers, so that
+ * tcb.h can embed a timer.
+ *
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __HWTIMER_ENTRY_H
+#define __HWTIMER_ENTRY_H
+
+/**
+ * @brief    A timer on caller provided storage, see hwtimer_entry_set()
+ */
+typedef struct hwtimer_entry {
+    struct hwtimer_entry *next;     /**< next pending timer */
+    struct hwtimer_entry **pprev;   /**< link pointing here, NULL if not pending */
+    unsigned long deadline;         /**< absolute expiry in ticks */
+    void (*callback)(void*);        /**< called in interrupt context */
+    void *data;                     /**< argument to callback */
+} hwtimer_entry_t;
+
+/** @} */
+#endif /* __HWTIMER_ENTRY_H */
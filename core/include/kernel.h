@@ -78,6 +78,12 @@
 #define LPM_PREVENT_SLEEP_UART    BIT2
 #define LPM_PREVENT_SLEEP_HWTIMER    BIT1
 
+/**
+ * @brief Users of clocks that stop in LPM_SLEEP and deeper, the idle thread
+ *        only enters LPM_IDLE while it is not 0
+ *
+ * Pending hwtimers do not count, the idle thread wakes up in time for them.
+ */
 extern volatile int lpm_prevent_sleep;
 
 extern config_t sysconfig;
@@ -49,6 +49,37 @@ void lpm_init(void);
  */
 enum lpm_mode lpm_set(enum lpm_mode target);
 
+/**
+ * @brief   lpm_wakeup_latency() of modes the hwtimer can not wake up from
+ */
+#define LPM_LATENCY_NEVER   (~0UL)
+
+/**
+ * @brief   Hwtimer ticks needed to enter and to leave a power mode
+ *
+ * The idle thread only enters a mode if the next hwtimer deadline is
+ * further away.
+ *
+ * @param[in]   mode        Power mode
+ * @return                  Latency in ticks, LPM_LATENCY_NEVER if the MCU
+ *                          can not wake up from *mode* for a hwtimer
+ */
+unsigned long lpm_wakeup_latency(enum lpm_mode mode);
+
+/**
+ * @brief   Switches to a power mode until an interrupt occurs, at the
+ *          latest until the hwtimer reaches *deadline*
+ *
+ * Called with interrupts disabled, returns with interrupts disabled.  A
+ * platform whose hwtimer stops in *target* arranges its own wake-up and
+ * advances the hwtimer by the time it slept.
+ *
+ * @param[in]   target      Target power mode
+ * @param[in]   deadline    Absolute hwtimer time to wake up at
+ * @return                  The previous power mode
+ */
+enum lpm_mode lpm_set_until(enum lpm_mode target, unsigned long deadline);
+
 void lpm_awake(void);
 
 void lpm_begin_awake(void);
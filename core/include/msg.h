@@ -126,6 +126,48 @@ int msg_receive(msg_t *m);
  */
 int msg_try_receive(msg_t *m);
 
+/**
+ * @brief Receive a message, blocking at most *ticks*.
+ *
+ * The timeout is part of the thread, it needs no timer and leaves no
+ * message behind.
+ * @param m pointer to preallocated msg
+ * @param ticks timeout in kernel timer ticks, 0 does not block
+ *
+ * @return 1 if a message was received, -1 on timeout.
+ */
+int msg_receive_timeout(msg_t *m, unsigned long ticks);
+
+/**
+ * @brief Receive a burst of messages.
+ *
+ * This function blocks until at least one message was received and then
+ * collects further messages that are already queued for the calling thread
+ * (or whose senders are blocked on it) without blocking again, so a burst
+ * is drained in a single wakeup.
+ * @param buf pointer to preallocated array of msgs
+ * @param max number of msgs in buf
+ *
+ * @return number of messages written to buf, 0 if max < 1
+ */
+int msg_receive_many(msg_t *buf, int max);
+
+/**
+ * @brief Send a burst of messages without blocking.
+ *
+ * The first message may be delivered directly if the target is waiting,
+ * the rest is put into the target's message queue. The calling thread
+ * yields at most once, after all messages have been delivered.
+ * @param m pointer to array of msgs
+ * @param num number of msgs in m
+ * @param target_pid PID of target thread
+ *
+ * @return number of messages delivered, sending stops at the first message
+ *         that neither the target nor its queue could take
+ * @return -1 on error (invalid PID)
+ */
+int msg_send_many(msg_t *m, int num, unsigned int target_pid);
+
 /**
  * @brief Send a message, block until reply received.
  *
@@ -162,5 +204,130 @@ int msg_reply(msg_t *m, msg_t *reply);
  */
 int msg_init_queue(msg_t *array, int num);
 
+/**
+ * @brief Most priority bands of a message queue
+ */
+#ifndef MSG_QUEUE_BANDS
+#define MSG_QUEUE_BANDS (4)
+#endif
+
+/**
+ * @brief Returns the band of a queued message, 0 is received first
+ */
+typedef unsigned int (*msg_classify_t)(const msg_t *m);
+
+/**
+ * @brief One band of a message queue, a ring of single writer and reader
+ *
+ * A message is stored before it is published by the write index and
+ * taken before its slot is released by the read index, so a thread can
+ * read the ring while an ISR is writing it.
+ */
+typedef struct {
+    msg_t *array;                   /**< memory of the band             */
+    unsigned int mask;              /**< size of the band minus one     */
+    volatile unsigned int read;     /**< messages taken                 */
+    volatile unsigned int write;    /**< messages stored                */
+} msg_band_t;
+
+/**
+ * @brief Message queue with priority bands, see msg_init_queue_bands()
+ */
+typedef struct {
+    msg_band_t band[MSG_QUEUE_BANDS];   /**< the bands, 0 first         */
+    msg_classify_t classify;            /**< picks the band             */
+    uint8_t num;                        /**< number of bands            */
+} msg_bands_t;
+
+/**
+ * @brief Initialize the current thread's message queue with priority bands.
+ *
+ * Queued messages are received from the lowest band holding one, in
+ * order within each band, so a message in band 0 never waits for the
+ * backlog of a higher band.  *array* is split into *bands* equal parts,
+ * a full band makes the sender behave like with a full queue of
+ * msg_init_queue().  Taking a queued message with msg_try_receive() does
+ * not disable interrupts.
+ *
+ * @param queue     management data of the queue, must stay valid
+ * @param array     Pointer to preallocated array of msg objects
+ * @param num       Number of msg objects in array, *num* / *bands* MUST BE
+ *                  POWER OF TWO!
+ * @param bands     number of bands, at most MSG_QUEUE_BANDS
+ * @param classify  returns the band of a message, larger values are
+ *                  clamped to the last band
+ *
+ * @return 0 if successful
+ * @return -1 on error
+ */
+int msg_init_queue_bands(msg_bands_t *queue, msg_t *array, int num,
+                         unsigned int bands, msg_classify_t classify);
+
+/**
+ * @brief Largest inline payload of a message in bytes
+ */
+#ifndef MSG_PAYLOAD_SIZE
+#define MSG_PAYLOAD_SIZE (24)
+#endif
+
+/**
+ * @brief Inline payload of a message, see msg_send_payload()
+ */
+typedef struct {
+    uint8_t len;                        /**< bytes used, 0 for none     */
+    uint8_t data[MSG_PAYLOAD_SIZE];     /**< the payload                */
+} msg_payload_t;
+
+/**
+ * @brief Initialize the current thread's message queue with room for
+ *        inline payloads.
+ *
+ * Works like msg_init_queue(), every queued message keeps its payload in
+ * the slot of *payloads* with the same index.
+ *
+ * @param array     Pointer to preallocated array of msg objects
+ * @param payloads  Pointer to preallocated array of *num* payloads
+ * @param num       Number of msg objects in array. MUST BE POWER OF TWO!
+ *
+ * @return 0 if successful
+ * @return -1 on error
+ */
+int msg_init_queue_payload(msg_t *array, msg_payload_t *payloads, int num);
+
+/**
+ * @brief Send a message with an inline payload without blocking.
+ *
+ * The payload is copied, so it may live on the stack of the sender and
+ * the message needs no buffer shared with the receiver.  It is delivered
+ * directly to a thread waiting in msg_receive_payload() or queued if the
+ * target was set up with msg_init_queue_payload().  A thread waiting in
+ * msg_receive() gets the message without the payload.
+ * Can be called from an interrupt.
+ *
+ * @param m pointer to message structure
+ * @param data payload, may be NULL if *len* is 0
+ * @param len length of *data*, at most MSG_PAYLOAD_SIZE
+ * @param target_pid PID of target thread
+ *
+ * @return 1 if sending was successful
+ * @return 0 if the target is not waiting and has no room for the payload
+ *         in its queue
+ * @return -1 on error (invalid PID or *len* too long)
+ */
+int msg_send_payload(msg_t *m, const void *data, unsigned int len,
+                     unsigned int target_pid);
+
+/**
+ * @brief Receive a message and its inline payload.
+ *
+ * Blocks like msg_receive().  Messages sent without a payload are
+ * received too, with payload->len set to 0.
+ * @param m pointer to preallocated msg
+ * @param payload pointer to preallocated payload
+ *
+ * @return 1 Function always succeeds or blocks forever.
+ */
+int msg_receive_payload(msg_t *m, msg_payload_t *payload);
+
 /** @} */
 #endif /* __MSG_H */
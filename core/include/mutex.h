@@ -22,7 +22,17 @@
 #ifndef _MUTEX_H
 #define _MUTEX_H
 
-#include "queue.h"
+#include "pheap.h"
+
+/**
+ * @brief Enables priority inheritance: a thread holding a mutex runs with
+ *        the priority of the highest priority thread waiting for it.
+ */
+#ifndef MUTEX_PRIORITY_INHERITANCE
+#define MUTEX_PRIORITY_INHERITANCE (1)
+#endif
+
+struct tcb_t;
 
 /**
  * @brief Mutex structure. Should never be modified by the user.
@@ -30,7 +40,8 @@
 typedef struct mutex_t {
     /* fields are managed by mutex functions, don't touch */
     unsigned int val;       // @internal
-    queue_node_t queue;     // @internal
+    pheap_node_t queue;     // @internal
+    struct tcb_t *owner;    // @internal
 } mutex_t;
 
 /**
@@ -61,6 +72,17 @@ int mutex_trylock(struct mutex_t *mutex);
  */
 int mutex_lock(struct mutex_t *mutex);
 
+/**
+ * @brief Tries to get a mutex, blocking at most *ticks*.
+ *
+ * @param mutex Mutex-Object to lock. Has to be initialized first.
+ * @param ticks Timeout in kernel timer ticks, 0 does not block.
+ *
+ * @return 1 getting the mutex was successful
+ * @return 0 the mutex was not unlocked in time
+ */
+int mutex_lock_timeout(struct mutex_t *mutex, unsigned long ticks);
+
 /**
  * @brief Unlocks the mutex.
  *
@@ -75,6 +97,17 @@ void mutex_unlock(struct mutex_t *mutex);
  */
 void mutex_unlock_and_sleep(struct mutex_t *mutex);
 
+/**
+ * @brief Unlocks the mutex and sends the current thread to sleep for at
+ *        most *ticks*
+ *
+ * @param mutex Mutex-Object to unlock.
+ * @param ticks Timeout in kernel timer ticks, not 0.
+ *
+ * @return 1 if the thread was woken up, 0 on timeout
+ */
+int mutex_unlock_and_sleep_timeout(struct mutex_t *mutex, unsigned long ticks);
+
 #define MUTEX_YIELD 1
 #define MUTEX_INISR 2
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @addtogroup  core_util
+ * @{
+ *
+ * @file        pheap.h
+ * @brief       Intrusive priority queue, a pairing heap
+ *
+ * Replaces the sorted list of queue_priority_add() for wait queues: the
+ * head is found in O(1), adding takes O(1) and removing any node takes
+ * O(log n) amortized instead of a walk over all waiters.  Nodes of the
+ * same priority leave in the order they were added.
+ *
+ * Like a queue, the heap is rooted in a node that holds no data, its
+ * *child* is the head.
+ */
+
+#ifndef __PHEAP_H
+#define __PHEAP_H
+
+#include <stdint.h>
+
+/**
+ * @brief Node of a pairing heap, also used as its root.
+ */
+typedef struct pheap_node_t {
+    struct pheap_node_t *child; /**< first child, the head for the root */
+    struct pheap_node_t *next;  /**< next sibling                       */
+    struct pheap_node_t *prev;  /**< previous sibling or parent, NULL if
+                                     not queued                         */
+    unsigned int data;          /**< holding data for this node         */
+    uint32_t priority;          /**< lower values leave first           */
+    uint32_t seq;               /**< order of adding, counter at the root */
+} pheap_node_t;
+
+/**
+ * @brief Initializes an empty heap, a zeroed root is empty too.
+ *
+ * @param[out]  root    Root of the heap
+ */
+void pheap_init(pheap_node_t *root);
+
+/**
+ * @brief Adds *node* with its *priority* set.
+ *
+ * @param[in,out]   root    Root of the heap
+ * @param[in,out]   node    Node to add, must not be queued
+ */
+void pheap_add(pheap_node_t *root, pheap_node_t *node);
+
+/**
+ * @brief Removes *node* from the heap it is queued in, does nothing if it
+ *        is not queued.
+ *
+ * @param[in,out]   node    Node to remove
+ */
+void pheap_remove(pheap_node_t *node);
+
+/**
+ * @brief Removes the node with the lowest priority.
+ *
+ * @param[in,out]   root    Root of the heap
+ *
+ * @return The removed node, NULL if the heap is empty.
+ */
+pheap_node_t *pheap_remove_head(pheap_node_t *root);
+
+/**
+ * @brief Node with the lowest priority, NULL if the heap is empty.
+ */
+static inline pheap_node_t *pheap_head(const pheap_node_t *root)
+{
+    return root->child;
+}
+
+/** @} */
+#endif /* __PHEAP_H */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    core_pubsub Publish/subscribe
+ * @ingroup     core
+ * @brief       One event for many threads, each reading at its own pace
+ *
+ * A topic keeps the last events published in a ring of slots owned by
+ * the publisher.  An event is published once, whatever the number of
+ * subscribers, and holds one reference per subscriber; every subscriber
+ * takes the events with pubsub_get() in order and gives them back with
+ * pubsub_release().  A slot is published again once all references are
+ * back.
+ *
+ * Subscribers are told of new events by a message or by thread flags, but
+ * only once until pubsub_get() found nothing left to take, so a full
+ * message queue loses no events.  A subscriber lagging behind by a whole
+ * ring misses the oldest event, a slot still held by a subscriber makes
+ * pubsub_reserve() fail; both are counted in pubsub_sub_t::drops.
+ *
+ * @{
+ *
+ * @file        pubsub.h
+ * @brief       Publish/subscribe
+ *
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __PUBSUB_H
+#define __PUBSUB_H
+
+#include <stdint.h>
+
+#include "thread_flags.h"
+
+/**
+ * @brief A slot of a topic
+ */
+typedef struct {
+    void *data;                 /**< free for the publisher */
+    uint16_t type;              /**< free for the publisher */
+    uint8_t refs;               /**< internal, references not given back */
+} pubsub_event_t;
+
+/**
+ * @brief A subscriber, owned by the caller
+ */
+typedef struct pubsub_sub {
+    struct pubsub_sub *next;    /**< internal */
+    int pid;                    /**< the thread told of new events */
+    uint16_t msg_type;          /**< type of the message telling it */
+    thread_flags_t flags;       /**< flags telling it instead, if not 0 */
+    uint16_t seq;               /**< internal, next event to take */
+    uint8_t slot;               /**< internal, its slot */
+    uint8_t notified;           /**< internal */
+    uint32_t drops;             /**< events missed */
+} pubsub_sub_t;
+
+/**
+ * @brief A topic
+ */
+typedef struct {
+    pubsub_sub_t *subs;         /**< internal */
+    pubsub_event_t *events;     /**< the slots */
+    uint8_t size;               /**< number of slots */
+    uint8_t subs_numof;         /**< number of subscribers */
+    uint8_t head;               /**< internal, slot of the next event */
+    uint16_t seq;               /**< internal, next event to publish */
+} pubsub_topic_t;
+
+/**
+ * @brief Static initializer of a topic with the *size* slots *events*
+ */
+#define PUBSUB_TOPIC_INIT(events, size)     { NULL, (events), (size), 0, 0, 0 }
+
+/**
+ * @brief Subscribes *sub* to the events published from now on
+ *
+ * @param[in] topic     The topic
+ * @param[in] sub       The subscriber, not subscribed to any topic
+ * @param[in] pid       The thread to tell of new events
+ * @param[in] msg_type  Type of the message telling it, content.ptr is *topic*
+ * @param[in] flags     Thread flags telling it instead, 0 for the message
+ */
+void pubsub_subscribe(pubsub_topic_t *topic, pubsub_sub_t *sub, int pid,
+                      uint16_t msg_type, thread_flags_t flags);
+
+/**
+ * @brief Unsubscribes *sub*, the events it did not take are given back
+ *
+ * Events it took still have to be released.
+ */
+void pubsub_unsubscribe(pubsub_topic_t *topic, pubsub_sub_t *sub);
+
+/**
+ * @brief Gets the slot the next event goes to, to fill it
+ *
+ * Callable from interrupt context.  The publisher must not reserve again
+ * before publishing the slot.
+ *
+ * @return The slot, NULL if a subscriber still holds it
+ */
+pubsub_event_t *pubsub_reserve(pubsub_topic_t *topic);
+
+/**
+ * @brief Publishes the slot from pubsub_reserve() to all subscribers
+ *
+ * Callable from interrupt context, never blocks.
+ */
+void pubsub_publish(pubsub_topic_t *topic, pubsub_event_t *event);
+
+/**
+ * @brief Takes the next event for *sub*, the calling thread holds it then
+ *
+ * @return The event, NULL if *sub* took all events published
+ */
+pubsub_event_t *pubsub_get(pubsub_topic_t *topic, pubsub_sub_t *sub);
+
+/**
+ * @brief Gives back an event taken with pubsub_get()
+ */
+void pubsub_release(pubsub_topic_t *topic, pubsub_event_t *event);
+
+/** @} */
+#endif /* __PUBSUB_H */
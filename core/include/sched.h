@@ -34,6 +34,18 @@
 #define SCHED_PRIO_LEVELS 16
 #endif
 
+/**
+ * @brief   Keep the run queues in arrays indexed by pid
+ *
+ * If set to 1 the run queue of every priority is a circular list of 8 bit
+ * pids in static arrays instead of a clist of the tcbs, which saves the
+ * run queue entry of every tcb and makes picking the next thread a single
+ * array lookup.
+ */
+#ifndef SCHED_RUNQUEUE_ARRAY
+#define SCHED_RUNQUEUE_ARRAY 0
+#endif
+
 /**
  * @brief   Triggers the scheduler to schedule the next task
  */
@@ -48,6 +60,16 @@ void sched_run(void);
  */
 void sched_set_status(tcb_t *process, unsigned int status);
 
+/**
+ * @brief   Change the effective priority of the specified process, moving it
+ *          to the matching run queue if it is runnable
+ *
+ * @param[in]   process     Pointer to the thread control block of the
+ *                          targeted process
+ * @param[in]   priority    The new priority of this thread
+ */
+void sched_change_priority(tcb_t *process, uint16_t priority);
+
 /**
  * @brief   Compare thread priorities and yield() (or set
  *          sched_context_switch_request if in_isr) when other_prio is higher
@@ -58,6 +80,16 @@ void sched_set_status(tcb_t *process, unsigned int status);
  */
 void sched_switch(uint16_t current_prio, uint16_t other_prio);
 
+/**
+ * @brief   Lets the next sched_run() switch straight to *process* without
+ *          picking from the run queues, as long as no runnable thread has a
+ *          higher priority then. Meant for a thread that hands a message to
+ *          *process* and yields right after, with interrupts disabled.
+ *
+ * @param[in]   process     The thread to run next
+ */
+void sched_handoff(tcb_t *process);
+
 /**
  * @brief   Call context switching at task exit
  */
@@ -98,6 +130,11 @@ typedef struct {
                                 scheduled to run */
     unsigned int schedules; /*< How often the thread was scheduled to run */
     unsigned long runtime_ticks;   /*< The total runtime of this thread in ticks */
+    unsigned long wakeup_time;  /*< Time stamp of the last time this thread
+                                    became runnable, 0 if already accounted */
+    unsigned int wakeups;   /*< How often the thread became runnable */
+    unsigned long latency_sum_ticks;   /*< Total wakeup-to-run latency */
+    unsigned long latency_max_ticks;   /*< Maximum wakeup-to-run latency */
 } schedstat;
 
 /**
@@ -105,6 +142,32 @@ typedef struct {
  */
 extern schedstat pidlist[MAXTHREADS];
 
+/**
+ *  Runtime in ticks spent by threads of each priority level
+ */
+extern unsigned long sched_prio_runtime_ticks[SCHED_PRIO_LEVELS];
+
+/**
+ *  Maximum number of threads seen on each run queue
+ */
+extern unsigned int sched_runqueue_depth_max[SCHED_PRIO_LEVELS];
+
+/**
+ *  Time in ticks spent in interrupt handlers that call sched_stat_isr_enter()
+ *  and sched_stat_isr_exit()
+ */
+extern unsigned long sched_isr_ticks;
+
+/**
+ *  To be called by the CPU's interrupt entry code
+ */
+void sched_stat_isr_enter(void);
+
+/**
+ *  To be called by the CPU's interrupt exit code
+ */
+void sched_stat_isr_exit(void);
+
 /**
  *  Register a callback that will be called on every scheduler run
  */
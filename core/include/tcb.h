@@ -26,6 +26,8 @@
 #include "clist.h"
 #include "cib.h"
 #include "msg.h"
+#include "thread_flags.h"
+#include "hwtimer_entry.h"
 
 /**
  * @brief Thread status list
@@ -42,15 +44,17 @@
 #define STATUS_SEND_BLOCKED     4               /**< waiting for message to be delivered*/
 #define STATUS_REPLY_BLOCKED    5               /**< waiting for a message response     */
 #define STATUS_TIMER_WAITING    6               /**< waiting for a timer to fire        */
+#define STATUS_FLAGS_BLOCKED_ANY 7              /**< waiting for any of its flags       */
+#define STATUS_FLAGS_BLOCKED_ALL 8              /**< waiting for all of its flags       */
 /** @} */
 
 /**
  * @brief These have to be on a run queue.
  * @{*/
-#define STATUS_ON_RUNQUEUE      7               /**< to check if on run queue 
+#define STATUS_ON_RUNQUEUE      9               /**< to check if on run queue 
                                                  `st >= STATUS_ON_RUNQUEUE`             */
-#define STATUS_RUNNING          7               /**< currently running                  */
-#define STATUS_PENDING          8               /**< waiting to be scheduled to run     */
+#define STATUS_RUNNING          9               /**< currently running                  */
+#define STATUS_PENDING          10              /**< waiting to be scheduled to run     */
 /** @} */
 /** @} */
 
@@ -63,14 +67,25 @@ typedef struct tcb_t {
 
     uint16_t pid;               /**< thread's process id            */
     uint16_t priority;          /**< thread's priority              */
+    uint16_t base_priority;     /**< priority without inheritance   */
 
+#if !SCHED_RUNQUEUE_ARRAY
     clist_node_t rq_entry;      /**< run queue entry                */
+#endif
 
     void *wait_data;            /**< holding messages               */
     queue_node_t msg_waiters;   /**< threads waiting on message     */
 
     cib_t msg_queue;            /**< message queue                  */
     msg_t *msg_array;           /**< memory holding messages        */
+    msg_bands_t *msg_bands;     /**< priority bands, NULL for FIFO  */
+    msg_payload_t *msg_payloads;/**< payloads of queued messages    */
+    msg_payload_t *wait_payload;/**< holding a received payload     */
+
+    thread_flags_t flags;       /**< pending thread flags           */
+    thread_flags_t flags_wait;  /**< flags waited for               */
+
+    hwtimer_entry_t timeout;    /**< timeout of a timed wait        */
 
     const char *name;           /**< thread's name                  */
     char *stack_start;          /**< thread's stack start address   */
@@ -93,6 +93,26 @@ int thread_getpid(void);
  */
 int thread_getlastpid(void);
 
+/**
+ * @brief   Arms the timeout of the current thread, internal to the timed
+ *          waits like mutex_lock_timeout().
+ *
+ * Call with interrupts disabled after the thread entered its blocked
+ * state: STATUS_MUTEX_BLOCKED with *wait_data* pointing to its pheap_node_t
+ * in the wait queue, STATUS_RECEIVE_BLOCKED or STATUS_SLEEPING with a non-NULL
+ * *wait_data*.  When the timeout fires first, the thread is removed from
+ * that queue, *wait_data* is set to NULL and the thread made pending.
+ *
+ * @param   ticks   timeout in kernel timer ticks
+ */
+void thread_timeout_arm(unsigned long ticks);
+
+/**
+ * @brief   Removes the timeout of the current thread after it was woken up.
+ * @return  1 if the thread was woken up by its timeout, 0 otherwise
+ */
+int thread_timeout_disarm(void);
+
 /**
  * @brief Measures the stack usage of a stack.
  * Only works if the thread was created with the flag CREATE_STACKTEST.
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    core_thread_flags Thread flags
+ * @ingroup     core
+ * @brief       Event bits per thread, a lightweight alternative to messages
+ *
+ * Every thread has THREAD_FLAGS_BITS event flags.  Setting a flag never
+ * blocks, works from interrupts and can not fail because of a full queue:
+ * a flag that is set again before its thread waited for it counts once.
+ * Use messages if an event carries data or must be counted.
+ *
+ * @{
+ *
+ * @file        thread_flags.h
+ * @brief       Thread flags
+ *
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __THREAD_FLAGS_H
+#define __THREAD_FLAGS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Number of flags per thread
+ */
+#define THREAD_FLAGS_BITS   (16)
+
+typedef uint16_t thread_flags_t;
+
+/**
+ * @brief Sets flags of a thread, callable from interrupt context
+ *
+ * Wakes up the thread if it waits for them.
+ *
+ * @param[in]   pid     The thread
+ * @param[in]   mask    Flags to set
+ *
+ * @return      1 on success, -1 if pid is unknown
+ */
+int thread_flags_set(int pid, thread_flags_t mask);
+
+/**
+ * @brief Waits until one of the flags in *mask* is set
+ *
+ * @param[in]   mask    Flags to wait for
+ *
+ * @return      The flags of *mask* that were set, they are cleared
+ */
+thread_flags_t thread_flags_wait_any(thread_flags_t mask);
+
+/**
+ * @brief Waits until all flags in *mask* are set
+ *
+ * @param[in]   mask    Flags to wait for
+ *
+ * @return      *mask*, whose flags are cleared
+ */
+thread_flags_t thread_flags_wait_all(thread_flags_t mask);
+
+/**
+ * @brief Clears flags of the current thread without waiting
+ *
+ * @param[in]   mask    Flags to clear
+ *
+ * @return      The flags of *mask* that were set
+ */
+thread_flags_t thread_flags_clear(thread_flags_t mask);
+
+/** @} */
+#endif /* __THREAD_FLAGS_H */
@@ -31,6 +31,8 @@
 #include "lpm.h"
 #include "thread.h"
 #include "hwtimer.h"
+#include "irq.h"
+#include "energy.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
@@ -47,17 +49,56 @@ volatile int lpm_prevent_sleep = 0;
 
 extern int main(void);
 
+/* the deepest mode we can wake up from in time, called with interrupts disabled */
+static enum lpm_mode idle_mode(unsigned long *deadline)
+{
+    unsigned long now = hwtimer_now();
+    unsigned long ticks = HWTIMER_MAXTICKS / 2;
+
+    if (lpm_prevent_sleep) {
+        return LPM_IDLE;
+    }
+
+    if (hwtimer_next(deadline)) {
+        if ((long)(*deadline - now) <= 0) {
+            return LPM_IDLE;
+        }
+
+        ticks = *deadline - now;
+    }
+    else {
+        *deadline = now + ticks;
+    }
+
+    for (enum lpm_mode mode = LPM_POWERDOWN; mode > LPM_IDLE; mode--) {
+        if (lpm_wakeup_latency(mode) < ticks) {
+            return mode;
+        }
+    }
+
+    return LPM_IDLE;
+}
+
 static void idle_thread(void)
 {
     while (1) {
-        if (lpm_prevent_sleep) {
+        unsigned long deadline;
+        unsigned state = disableIRQ();
+        enum lpm_mode mode = idle_mode(&deadline);
+
+        ENERGY_MCU(mode);
+
+        if (mode == LPM_IDLE) {
+            restoreIRQ(state);
             lpm_set(LPM_IDLE);
         }
         else {
-            lpm_set(LPM_IDLE);
-            /* lpm_set(LPM_SLEEP); */
-            /* lpm_set(LPM_POWERDOWN); */
+            DEBUG("idle: mode %d until %lu\n", mode, deadline);
+            lpm_set_until(mode, deadline);
+            restoreIRQ(state);
         }
+
+        ENERGY_MCU(LPM_ON);
     }
 }
 
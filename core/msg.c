@@ -22,6 +22,7 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 #include <inttypes.h>
 #include "kernel.h"
 #include "sched.h"
@@ -36,16 +37,100 @@
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
 #include "thread.h"
+#include "trace.h"
 
-static int _msg_receive(msg_t *m, int block);
+static int _msg_receive(msg_t *m, int block, unsigned long ticks);
 
 
-static int queue_msg(tcb_t *target, msg_t *m)
+/* keeps the compiler from moving memory accesses across */
+#define BARRIER()   __asm__ volatile ("" : : : "memory")
+
+/* the only writer of a band runs with interrupts disabled or in an ISR */
+static int band_put(msg_band_t *band, msg_t *m)
 {
+    unsigned int write = band->write;
+
+    if (write - band->read > band->mask) {
+        return 0;
+    }
+
+    band->array[write & band->mask] = *m;
+    BARRIER();
+    band->write = write + 1;
+    return 1;
+}
+
+/* the only reader of a band is the thread owning it */
+static int band_get(msg_bands_t *queue, msg_t *m)
+{
+    for (unsigned int i = 0; i < queue->num; i++) {
+        msg_band_t *band = &queue->band[i];
+        unsigned int read = band->read;
+
+        if (read != band->write) {
+            BARRIER();
+            *m = band->array[read & band->mask];
+            BARRIER();
+            band->read = read + 1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* *data* is stored with the message if the queue has room for payloads */
+static int queue_msg_payload(tcb_t *target, msg_t *m, const void *data,
+                             unsigned int len)
+{
+    if (target->msg_bands) {
+        msg_bands_t *queue = target->msg_bands;
+        unsigned int band = queue->classify(m);
+
+        if (band >= queue->num) {
+            band = queue->num - 1;
+        }
+
+        return band_put(&queue->band[band], m);
+    }
+
     int n = cib_put(&(target->msg_queue));
 
     if (n != -1) {
         target->msg_array[n] = *m;
+
+        if (target->msg_payloads) {
+            target->msg_payloads[n].len = len;
+            memcpy(target->msg_payloads[n].data, data, len);
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static inline int queue_msg(tcb_t *target, msg_t *m)
+{
+    return queue_msg_payload(target, m, NULL, 0);
+}
+
+/* takes the next queued message, 0 if there is none */
+static int queue_get(tcb_t *me, msg_t *m)
+{
+    if (me->msg_bands) {
+        return band_get(me->msg_bands, m);
+    }
+
+    int n = cib_get(&(me->msg_queue));
+
+    if (n != -1) {
+        *m = me->msg_array[n];
+
+        if (me->msg_payloads && me->wait_payload) {
+            *me->wait_payload = me->msg_payloads[n];
+        }
+
         return 1;
     }
 
@@ -61,6 +146,7 @@ int msg_send(msg_t *m, unsigned int target_pid, bool block)
     tcb_t *target = (tcb_t*) sched_threads[target_pid];
 
     m->sender_pid = thread_pid;
+    TRACE(TRACE_MSG_SEND, target_pid);
 
     if (m->sender_pid == target_pid) {
         return msg_send_to_self(m);
@@ -87,6 +173,7 @@ int msg_send(msg_t *m, unsigned int target_pid, bool block)
 
         if (!block) {
             DEBUG("msg_send: %s: Receiver not waiting, block=%u\n", active_thread->name, block);
+            TRACE(TRACE_MSG_DROP, target_pid);
             eINT();
             return 0;
         }
@@ -121,6 +208,11 @@ int msg_send(msg_t *m, unsigned int target_pid, bool block)
         msg_t *target_message = (msg_t*) target->wait_data;
         *target_message = *m;
         sched_set_status(target, STATUS_PENDING);
+
+        if (active_thread->status == STATUS_REPLY_BLOCKED) {
+            /* msg_send_receive(), the target runs until it replies */
+            sched_handoff(target);
+        }
     }
 
     eINT();
@@ -129,6 +221,47 @@ int msg_send(msg_t *m, unsigned int target_pid, bool block)
     return 1;
 }
 
+int msg_send_many(msg_t *m, int num, unsigned int target_pid)
+{
+    tcb_t *target = (tcb_t*) sched_threads[target_pid];
+    int sent = 0;
+
+    if (target == NULL) {
+        return -1;
+    }
+
+    unsigned int state = disableIRQ();
+
+    for (; sent < num; sent++) {
+        m[sent].sender_pid = inISR() ? target_pid : (unsigned int) thread_pid;
+
+        if (target->status == STATUS_RECEIVE_BLOCKED) {
+            DEBUG("msg_send_many: Direct msg copy to %i.\n", target_pid);
+            /* copy msg to target */
+            msg_t *target_message = (msg_t*) target->wait_data;
+            *target_message = m[sent];
+            sched_set_status(target, STATUS_PENDING);
+        }
+        else if (!(target->msg_array && queue_msg(target, &m[sent]))) {
+            DEBUG("msg_send_many: Target %i can't take more messages.\n", target_pid);
+            break;
+        }
+    }
+
+    restoreIRQ(state);
+
+    if (sent > 0) {
+        if (inISR()) {
+            sched_context_switch_request = 1;
+        }
+        else if (target_pid != (unsigned int) thread_pid) {
+            sched_switch(active_thread->priority, target->priority);
+        }
+    }
+
+    return sent;
+}
+
 int msg_send_to_self(msg_t *m)
 {
     unsigned int state = disableIRQ();
@@ -143,6 +276,8 @@ int msg_send_int(msg_t *m, unsigned int target_pid)
 {
     tcb_t *target = (tcb_t *) sched_threads[target_pid];
 
+    TRACE(TRACE_MSG_SEND_INT, target_pid);
+
     if (target->status == STATUS_RECEIVE_BLOCKED) {
         DEBUG("msg_send_int: Direct msg copy from %i to %i.\n", thread_getpid(), target_pid);
 
@@ -158,8 +293,72 @@ int msg_send_int(msg_t *m, unsigned int target_pid)
     }
     else {
         DEBUG("msg_send_int: Receiver not waiting.\n");
-        return (queue_msg(target, m));
+
+        if (!queue_msg(target, m)) {
+            TRACE(TRACE_MSG_DROP, target_pid);
+            return 0;
+        }
+
+        return 1;
+    }
+}
+
+int msg_send_payload(msg_t *m, const void *data, unsigned int len,
+                     unsigned int target_pid)
+{
+    if ((target_pid >= MAXTHREADS) || (len > MSG_PAYLOAD_SIZE)) {
+        return -1;
+    }
+
+    tcb_t *target = (tcb_t *) sched_threads[target_pid];
+
+    if (target == NULL) {
+        return -1;
+    }
+
+    m->sender_pid = inISR() ? target_pid : (unsigned int) thread_pid;
+
+    unsigned int state = disableIRQ();
+
+    if (target->status == STATUS_RECEIVE_BLOCKED) {
+        DEBUG("msg_send_payload: Direct msg copy to %i.\n", target_pid);
+        /* copy msg to target */
+        msg_t *target_message = (msg_t*) target->wait_data;
+        *target_message = *m;
+
+        if (target->wait_payload) {
+            target->wait_payload->len = len;
+            memcpy(target->wait_payload->data, data, len);
+        }
+
+        sched_set_status(target, STATUS_PENDING);
+        restoreIRQ(state);
+
+        if (inISR()) {
+            sched_context_switch_request = 1;
+        }
+        else {
+            sched_switch(active_thread->priority, target->priority);
+        }
+
+        return 1;
+    }
+
+    /* a queue without payloads could only take it truncated */
+    int res = 0;
+
+    if (target->msg_array && (target->msg_payloads || (len == 0))) {
+        res = queue_msg_payload(target, m, data, len);
+    }
+
+    restoreIRQ(state);
+
+    if (!res) {
+        DEBUG("msg_send_payload: Target %i can't take the message.\n", target_pid);
+        TRACE(TRACE_MSG_DROP, target_pid);
     }
+
+    return res;
 }
 
 int msg_send_receive(msg_t *m, msg_t *reply, unsigned int target_pid)
@@ -182,6 +381,7 @@ int msg_reply(msg_t *m, msg_t *reply)
 
     if (!target) {
         DEBUG("msg_reply(): %s: Target \"%" PRIu16 "\" not existing...dropping msg!\n", active_thread->name, m->sender_pid);
+        restoreIRQ(state);
         return -1;
     }
 
@@ -196,6 +396,9 @@ int msg_reply(msg_t *m, msg_t *reply)
     msg_t *target_message = (msg_t*) target->wait_data;
     *target_message = *reply;
     sched_set_status(target, STATUS_PENDING);
+    /* switch back to the waiting sender unless a higher priority thread
+     * became runnable meanwhile */
+    sched_handoff(target);
     restoreIRQ(state);
     thread_yield();
 
@@ -218,37 +421,64 @@ int msg_reply_int(msg_t *m, msg_t *reply)
     return 1;
 }
 
+static inline int msg_traced(msg_t *m, int res)
+{
+    if (res > 0) {
+        TRACE(TRACE_MSG_RECEIVE, m->sender_pid);
+    }
+
+    return res;
+}
+
 int msg_try_receive(msg_t *m)
 {
-    return _msg_receive(m, 0);
+    return msg_traced(m, _msg_receive(m, 0, 0));
 }
 
 int msg_receive(msg_t *m)
 {
-    return _msg_receive(m, 1);
+    return msg_traced(m, _msg_receive(m, 1, 0));
 }
 
-static int _msg_receive(msg_t *m, int block)
+int msg_receive_timeout(msg_t *m, unsigned long ticks)
 {
-    dINT();
-    DEBUG("_msg_receive: %s: _msg_receive.\n", active_thread->name);
+    if (ticks == 0) {
+        return msg_traced(m, _msg_receive(m, 0, 0));
+    }
 
+    return msg_traced(m, _msg_receive(m, 1, ticks));
+}
+
+/* blocks at most *ticks* if not 0 */
+static int _msg_receive(msg_t *m, int block, unsigned long ticks)
+{
     tcb_t *me = (tcb_t*) sched_threads[thread_pid];
 
-    int queue_index = -1;
+    /* A queued message in a band can be taken without disabling
+     * interrupts.  A sender starting to wait meanwhile is taken care of
+     * by the next call. */
+    if (me->msg_bands && (me->msg_waiters.next == NULL) &&
+        band_get(me->msg_bands, m)) {
+        return 1;
+    }
+
+    dINT();
+    DEBUG("_msg_receive: %s: _msg_receive.\n", active_thread->name);
+
+    int queued = 0;
 
     if (me->msg_array) {
-        queue_index = cib_get(&(me->msg_queue));
+        queued = queue_get(me, m);
     }
 
-    /* no message, fail */
-    if ((!block) && (queue_index == -1)) {
+    /* no message and no sender waiting, fail */
+    if ((!block) && (!queued) && (me->msg_waiters.next == NULL)) {
+        eINT();
         return -1;
     }
 
-    if (queue_index >= 0) {
+    if (queued) {
         DEBUG("_msg_receive: %s: _msg_receive(): We've got a queued message.\n", active_thread->name);
-        *m = me->msg_array[queue_index];
     }
     else {
         me->wait_data = (void *) m;
@@ -259,32 +489,49 @@ static int _msg_receive(msg_t *m, int block)
     if (node == NULL) {
         DEBUG("_msg_receive: %s: _msg_receive(): No thread in waiting list.\n", active_thread->name);
 
-        if (queue_index < 0) {
+        if (!queued) {
             DEBUG("_msg_receive(): %s: No msg in queue. Going blocked.\n", active_thread->name);
             sched_set_status(me, STATUS_RECEIVE_BLOCKED);
 
+            if (ticks) {
+                thread_timeout_arm(ticks);
+            }
+
             eINT();
             thread_yield();
 
+            if (ticks && thread_timeout_disarm()) {
+                DEBUG("_msg_receive(): %s: timed out.\n", active_thread->name);
+                return -1;
+            }
+
             /* sender copied message */
+            return 1;
         }
 
+        eINT();
         return 1;
     }
     else {
         DEBUG("_msg_receive: %s: _msg_receive(): Waking up waiting thread.\n", active_thread->name);
         tcb_t *sender = (tcb_t*) node->data;
+        msg_t *sender_msg = (msg_t*) sender->wait_data;
 
-        if (queue_index >= 0) {
+        if (queued) {
             /* We've already got a message from the queue. As there is a
              * waiter, take it's message into the just freed queue space.
              */
-            m = &(me->msg_array[cib_put(&(me->msg_queue))]);
+            if (!queue_msg(me, sender_msg)) {
+                /* the band of its message is still full */
+                queue_priority_add(&(me->msg_waiters), node);
+                eINT();
+                return 1;
+            }
+        }
+        else {
+            /* copy msg */
+            *m = *sender_msg;
         }
-
-        /* copy msg */
-        msg_t *sender_msg = (msg_t*) sender->wait_data;
-        *m = *sender_msg;
 
         /* remove sender from queue */
         if (sender->status != STATUS_REPLY_BLOCKED) {
@@ -297,11 +544,45 @@ static int _msg_receive(msg_t *m, int block)
     }
 }
 
+int msg_receive_payload(msg_t *m, msg_payload_t *payload)
+{
+    tcb_t *me = (tcb_t*) sched_threads[thread_pid];
+
+    /* senders only fill it in while the thread is receive blocked */
+    payload->len = 0;
+    me->wait_payload = payload;
+
+    int res = _msg_receive(m, 1, 0);
+
+    me->wait_payload = NULL;
+
+    return msg_traced(m, res);
+}
+
+int msg_receive_many(msg_t *buf, int max)
+{
+    int n = 0;
+
+    if (max < 1) {
+        return 0;
+    }
+
+    _msg_receive(&buf[n++], 1, 0);
+
+    while ((n < max) && (_msg_receive(&buf[n], 0, 0) == 1)) {
+        n++;
+    }
+
+    return n;
+}
+
 int msg_init_queue(msg_t *array, int num)
 {
     /* check if num is a power of two by comparing to its complement */
     if (num && (num & (num - 1)) == 0) {
         tcb_t *me = (tcb_t*) active_thread;
+        me->msg_bands = NULL;
+        me->msg_payloads = NULL;
         me->msg_array = array;
         cib_init(&(me->msg_queue), num);
         return 0;
@@ -309,3 +590,59 @@ int msg_init_queue(msg_t *array, int num)
 
     return -1;
 }
+
+int msg_init_queue_bands(msg_bands_t *queue, msg_t *array, int num,
+                         unsigned int bands, msg_classify_t classify)
+{
+    if ((bands == 0) || (bands > MSG_QUEUE_BANDS) || (classify == NULL) ||
+        (num <= 0) || ((unsigned int) num % bands)) {
+        return -1;
+    }
+
+    unsigned int size = (unsigned int) num / bands;
+
+    /* check if size is a power of two by comparing to its complement */
+    if ((size & (size - 1)) != 0) {
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < bands; i++) {
+        queue->band[i].array = array + i * size;
+        queue->band[i].mask = size - 1;
+        queue->band[i].read = 0;
+        queue->band[i].write = 0;
+    }
+
+    queue->classify = classify;
+    queue->num = bands;
+
+    tcb_t *me = (tcb_t*) active_thread;
+    unsigned int state = disableIRQ();
+    me->msg_bands = queue;
+    me->msg_payloads = NULL;
+    me->msg_array = array;
+    restoreIRQ(state);
+
+    return 0;
+}
+
+int msg_init_queue_payload(msg_t *array, msg_payload_t *payloads, int num)
+{
+    if (payloads == NULL) {
+        return -1;
+    }
+
+    /* check if num is a power of two by comparing to its complement */
+    if (num && (num & (num - 1)) == 0) {
+        tcb_t *me = (tcb_t*) active_thread;
+        unsigned int state = disableIRQ();
+        me->msg_bands = NULL;
+        me->msg_payloads = payloads;
+        me->msg_array = array;
+        cib_init(&(me->msg_queue), num);
+        restoreIRQ(state);
+        return 0;
+    }
+
+    return -1;
+}
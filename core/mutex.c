@@ -32,13 +32,89 @@
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
 
+#if MUTEX_PRIORITY_INHERITANCE
+/* lend the priority of the calling thread to the mutex holder */
+static void mutex_inherit_priority(struct mutex_t *mutex)
+{
+    tcb_t *owner = mutex->owner;
+
+    if ((owner != NULL) && (owner->priority > active_thread->priority)) {
+        DEBUG("%s: raising priority of %s to %u\n", active_thread->name, owner->name, active_thread->priority);
+        sched_change_priority(owner, active_thread->priority);
+    }
+}
+
+/* drop a lent priority of the mutex holder */
+static void mutex_restore_priority(struct mutex_t *mutex)
+{
+    tcb_t *owner = mutex->owner;
+
+    if ((owner != NULL) && (owner->priority != owner->base_priority)) {
+        DEBUG("%s: restoring priority of %s to %u\n", active_thread->name, owner->name, owner->base_priority);
+        sched_change_priority(owner, owner->base_priority);
+    }
+}
+
+/* a waiter gave up, the holder keeps the priority of the ones left */
+static void mutex_reinherit_priority(struct mutex_t *mutex)
+{
+    tcb_t *owner = mutex->owner;
+    uint16_t priority;
+
+    if (owner == NULL) {
+        return;
+    }
+
+    priority = owner->base_priority;
+
+    pheap_node_t *head = pheap_head(&(mutex->queue));
+
+    if (head && (head->priority < priority)) {
+        priority = head->priority;
+    }
+
+    if (owner->priority != priority) {
+        sched_change_priority(owner, priority);
+    }
+}
+#else
+#define mutex_inherit_priority(mutex)
+#define mutex_restore_priority(mutex)
+#define mutex_reinherit_priority(mutex)
+#endif
+
+/* hand the mutex to its first waiter, the mutex stays locked */
+static tcb_t *mutex_handoff(struct mutex_t *mutex)
+{
+    pheap_node_t *next = pheap_remove_head(&(mutex->queue));
+    tcb_t *process = (tcb_t*) next->data;
+
+    mutex_restore_priority(mutex);
+    mutex->owner = process;
+
+    DEBUG("%s: waking up waiter.\n", process->name);
+    sched_set_status(process, STATUS_PENDING);
+
+#if MUTEX_PRIORITY_INHERITANCE
+    /* the new holder inherits from the waiters left behind */
+    if (pheap_head(&(mutex->queue))) {
+        tcb_t *waiter = (tcb_t*) pheap_head(&(mutex->queue))->data;
+
+        if (process->priority > waiter->priority) {
+            sched_change_priority(process, waiter->priority);
+        }
+    }
+#endif
+
+    return process;
+}
+
 int mutex_init(struct mutex_t *mutex)
 {
     mutex->val = 0;
+    mutex->owner = NULL;
 
-    mutex->queue.priority = 0;
-    mutex->queue.data = 0;
-    mutex->queue.next = NULL;
+    pheap_init(&(mutex->queue));
 
     return 1;
 }
@@ -46,7 +122,12 @@ int mutex_init(struct mutex_t *mutex)
 int mutex_trylock(struct mutex_t *mutex)
 {
     DEBUG("%s: trylocking to get mutex. val: %u\n", active_thread->name, mutex->val);
-    return (atomic_set_return(&mutex->val, 1) == 0);
+    if (atomic_set_return(&mutex->val, 1) == 0) {
+        mutex->owner = (tcb_t*) active_thread;
+        return 1;
+    }
+
+    return 0;
 }
 
 int mutex_lock(struct mutex_t *mutex)
@@ -57,11 +138,15 @@ int mutex_lock(struct mutex_t *mutex)
         /* mutex was locked. */
         mutex_wait(mutex);
     }
+    else {
+        mutex->owner = (tcb_t*) active_thread;
+    }
 
     return 1;
 }
 
-void mutex_wait(struct mutex_t *mutex)
+/* blocks at most *ticks* if not 0, returns 0 on timeout */
+static int _mutex_wait(struct mutex_t *mutex, unsigned long ticks)
 {
     int irqstate = disableIRQ();
     DEBUG("%s: Mutex in use. %u\n", active_thread->name, mutex->val);
@@ -69,27 +154,66 @@ void mutex_wait(struct mutex_t *mutex)
     if (mutex->val == 0) {
         /* somebody released the mutex. return. */
         mutex->val = 1;
+        mutex->owner = (tcb_t*) active_thread;
         DEBUG("%s: mutex_wait early out. %u\n", active_thread->name, mutex->val);
         restoreIRQ(irqstate);
-        return;
+        return 1;
     }
 
     sched_set_status((tcb_t*) active_thread, STATUS_MUTEX_BLOCKED);
 
-    queue_node_t n;
+    pheap_node_t n;
     n.priority = (unsigned int) active_thread->priority;
     n.data = (unsigned int) active_thread;
-    n.next = NULL;
 
     DEBUG("%s: Adding node to mutex queue: prio: %" PRIu32 "\n", active_thread->name, n.priority);
 
-    queue_priority_add(&(mutex->queue), &n);
+    pheap_add(&(mutex->queue), &n);
+
+    mutex_inherit_priority(mutex);
+
+    if (ticks) {
+        active_thread->wait_data = (void *) &n;
+        thread_timeout_arm(ticks);
+    }
 
     restoreIRQ(irqstate);
 
     thread_yield();
 
-    /* we were woken up by scheduler. waker removed us from queue. we have the mutex now. */
+    if (ticks && thread_timeout_disarm()) {
+        /* the timeout removed us from the queue */
+        DEBUG("%s: mutex_wait timed out.\n", active_thread->name);
+        irqstate = disableIRQ();
+        mutex_reinherit_priority(mutex);
+        restoreIRQ(irqstate);
+        return 0;
+    }
+
+    /* we were woken up by scheduler. waker removed us from queue and made
+     * us the owner. we have the mutex now. */
+    return 1;
+}
+
+void mutex_wait(struct mutex_t *mutex)
+{
+    _mutex_wait(mutex, 0);
+}
+
+int mutex_lock_timeout(struct mutex_t *mutex, unsigned long ticks)
+{
+    DEBUG("%s: trying to get mutex within %lu ticks. val: %u\n", active_thread->name, ticks, mutex->val);
+
+    if (atomic_set_return(&mutex->val, 1) == 0) {
+        mutex->owner = (tcb_t*) active_thread;
+        return 1;
+    }
+
+    if (ticks == 0) {
+        return 0;
+    }
+
+    return _mutex_wait(mutex, ticks);
 }
 
 void mutex_unlock(struct mutex_t *mutex)
@@ -98,15 +222,14 @@ void mutex_unlock(struct mutex_t *mutex)
     int irqstate = disableIRQ();
 
     if (mutex->val != 0) {
-        if (mutex->queue.next) {
-            queue_node_t *next = queue_remove_head(&(mutex->queue));
-            tcb_t *process = (tcb_t*) next->data;
-            DEBUG("%s: waking up waiter.\n", process->name);
-            sched_set_status(process, STATUS_PENDING);
+        if (pheap_head(&(mutex->queue))) {
+            tcb_t *process = mutex_handoff(mutex);
 
             sched_switch(active_thread->priority, process->priority);
         }
         else {
+            mutex_restore_priority(mutex);
+            mutex->owner = NULL;
             mutex->val = 0;
         }
     }
@@ -114,24 +237,42 @@ void mutex_unlock(struct mutex_t *mutex)
     restoreIRQ(irqstate);
 }
 
-void mutex_unlock_and_sleep(struct mutex_t *mutex)
+/* sleeps at most *ticks* if not 0, returns 0 on timeout */
+static int _mutex_unlock_and_sleep(struct mutex_t *mutex, unsigned long ticks)
 {
     DEBUG("%s: unlocking mutex. val: %u pid: %u, and taking a nap\n", active_thread->name, mutex->val, thread_pid);
     int irqstate = disableIRQ();
 
     if (mutex->val != 0) {
-        if (mutex->queue.next) {
-            queue_node_t *next = queue_remove_head(&(mutex->queue));
-            tcb_t *process = (tcb_t*) next->data;
-            DEBUG("%s: waking up waiter.\n", process->name);
-            sched_set_status(process, STATUS_PENDING);
+        if (pheap_head(&(mutex->queue))) {
+            mutex_handoff(mutex);
         }
         else {
+            mutex_restore_priority(mutex);
+            mutex->owner = NULL;
             mutex->val = 0;
         }
     }
     DEBUG("%s: going to sleep.\n", active_thread->name);
     sched_set_status((tcb_t*) active_thread, STATUS_SLEEPING);
+
+    if (ticks) {
+        active_thread->wait_data = (void *) mutex;
+        thread_timeout_arm(ticks);
+    }
+
     restoreIRQ(irqstate);
     thread_yield();
+
+    return !(ticks && thread_timeout_disarm());
+}
+
+void mutex_unlock_and_sleep(struct mutex_t *mutex)
+{
+    _mutex_unlock_and_sleep(mutex, 0);
+}
+
+int mutex_unlock_and_sleep_timeout(struct mutex_t *mutex, unsigned long ticks)
+{
+    return _mutex_unlock_and_sleep(mutex, ticks);
 }
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup     core_util
+ * @{
+ *
+ * @file        pheap.c
+ * @brief       Pairing heap implementation
+ *
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "pheap.h"
+
+/* 1 if *a* leaves before *b* */
+static inline int pheap_before(const pheap_node_t *a, const pheap_node_t *b)
+{
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/* makes the later of two trees the first child of the other, which is
+ * returned with its *next* and *prev* left to the caller */
+static pheap_node_t *pheap_meld(pheap_node_t *a, pheap_node_t *b)
+{
+    if (pheap_before(b, a)) {
+        pheap_node_t *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    b->prev = a;
+    b->next = a->child;
+
+    if (a->child != NULL) {
+        a->child->prev = b;
+    }
+
+    a->child = b;
+    return a;
+}
+
+/* melds a list of siblings into one tree, in two passes: pairs from left
+ * to right, then the pairs from right to left */
+static pheap_node_t *pheap_merge_pairs(pheap_node_t *first)
+{
+    pheap_node_t *pairs = NULL;
+
+    while (first != NULL) {
+        pheap_node_t *a = first;
+        pheap_node_t *b = a->next;
+
+        if (b != NULL) {
+            first = b->next;
+            a = pheap_meld(a, b);
+        }
+        else {
+            first = NULL;
+        }
+
+        a->next = pairs;
+        pairs = a;
+    }
+
+    pheap_node_t *tree = NULL;
+
+    while (pairs != NULL) {
+        pheap_node_t *a = pairs;
+        pairs = a->next;
+        tree = (tree == NULL) ? a : pheap_meld(tree, a);
+    }
+
+    return tree;
+}
+
+void pheap_init(pheap_node_t *root)
+{
+    root->child = NULL;
+    root->next = NULL;
+    root->prev = NULL;
+    root->data = 0;
+    root->priority = 0;
+    root->seq = 0;
+}
+
+void pheap_add(pheap_node_t *root, pheap_node_t *node)
+{
+    node->seq = root->seq++;
+    node->child = NULL;
+
+    if (root->child != NULL) {
+        node = pheap_meld(root->child, node);
+    }
+
+    node->next = NULL;
+    node->prev = root;
+    root->child = node;
+}
+
+void pheap_remove(pheap_node_t *node)
+{
+    pheap_node_t *prev = node->prev;
+    pheap_node_t *next = node->next;
+
+    if (prev == NULL) {
+        return;
+    }
+
+    /* the children stay in order below the node's parent, so they simply
+     * take its place */
+    pheap_node_t *sub = pheap_merge_pairs(node->child);
+    pheap_node_t *replacement = next;
+
+    if (sub != NULL) {
+        sub->prev = prev;
+        sub->next = next;
+        replacement = sub;
+    }
+
+    if (prev->child == node) {
+        prev->child = replacement;
+    }
+    else {
+        prev->next = replacement;
+    }
+
+    if (next != NULL) {
+        next->prev = (sub != NULL) ? sub : prev;
+    }
+
+    node->child = NULL;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+pheap_node_t *pheap_remove_head(pheap_node_t *root)
+{
+    pheap_node_t *head = root->child;
+
+    if (head != NULL) {
+        pheap_remove(head);
+    }
+
+    return head;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup     core_pubsub
+ * @{
+ *
+ * @file        pubsub.c
+ * @brief       Publish/subscribe implementation
+ *
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "irq.h"
+#include "msg.h"
+#include "thread_flags.h"
+#include "pubsub.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+/* notified: not told of events yet, told, to be told by pubsub_publish() */
+#define NOTIFY_NONE     (0)
+#define NOTIFY_DONE     (1)
+#define NOTIFY_PENDING  (2)
+
+static inline uint8_t next_slot(const pubsub_topic_t *topic, uint8_t slot)
+{
+    return (slot + 1 == topic->size) ? 0 : slot + 1;
+}
+
+void pubsub_subscribe(pubsub_topic_t *topic, pubsub_sub_t *sub, int pid,
+                      uint16_t msg_type, thread_flags_t flags)
+{
+    unsigned int state = disableIRQ();
+
+    sub->pid = pid;
+    sub->msg_type = msg_type;
+    sub->flags = flags;
+    sub->seq = topic->seq;
+    sub->slot = topic->head;
+    sub->notified = NOTIFY_NONE;
+    sub->drops = 0;
+    sub->next = topic->subs;
+    topic->subs = sub;
+    topic->subs_numof++;
+
+    restoreIRQ(state);
+}
+
+void pubsub_unsubscribe(pubsub_topic_t *topic, pubsub_sub_t *sub)
+{
+    unsigned int state = disableIRQ();
+    pubsub_sub_t **p;
+
+    for (p = &topic->subs; *p && (*p != sub); p = &(*p)->next) {
+        ;
+    }
+
+    if (*p == NULL) {
+        restoreIRQ(state);
+        return;
+    }
+
+    *p = sub->next;
+    topic->subs_numof--;
+
+    /* the references of the events it did not take */
+    while (sub->seq != topic->seq) {
+        topic->events[sub->slot].refs--;
+        sub->slot = next_slot(topic, sub->slot);
+        sub->seq++;
+    }
+
+    restoreIRQ(state);
+}
+
+pubsub_event_t *pubsub_reserve(pubsub_topic_t *topic)
+{
+    unsigned int state = disableIRQ();
+    pubsub_event_t *event = &topic->events[topic->head];
+    pubsub_sub_t *sub;
+
+    /* subscribers a whole ring behind miss the oldest event */
+    for (sub = topic->subs; sub; sub = sub->next) {
+        if ((uint16_t)(topic->seq - sub->seq) >= topic->size) {
+            DEBUG("pubsub: %d misses an event\n", sub->pid);
+            event->refs--;
+            sub->slot = next_slot(topic, sub->slot);
+            sub->seq++;
+            sub->drops++;
+        }
+    }
+
+    if (event->refs > 0) {
+        /* still held, this event is lost for everybody */
+        for (sub = topic->subs; sub; sub = sub->next) {
+            sub->drops++;
+        }
+
+        event = NULL;
+    }
+
+    restoreIRQ(state);
+    return event;
+}
+
+void pubsub_publish(pubsub_topic_t *topic, pubsub_event_t *event)
+{
+    unsigned int state = disableIRQ();
+    pubsub_sub_t *sub;
+    msg_t m;
+
+    event->refs = topic->subs_numof;
+    topic->head = next_slot(topic, topic->head);
+    topic->seq++;
+
+    /* only subscribers that took everything before need to be told */
+    for (sub = topic->subs; sub; sub = sub->next) {
+        if (sub->notified == NOTIFY_NONE) {
+            sub->notified = NOTIFY_PENDING;
+        }
+    }
+
+    restoreIRQ(state);
+
+    m.type = 0;
+    m.content.ptr = (char *) topic;
+
+    for (sub = topic->subs; sub; sub = sub->next) {
+        state = disableIRQ();
+
+        /* it may have taken the event in the meantime */
+        if (sub->notified != NOTIFY_PENDING) {
+            restoreIRQ(state);
+            continue;
+        }
+
+        sub->notified = NOTIFY_DONE;
+        restoreIRQ(state);
+
+        if (sub->flags) {
+            thread_flags_set(sub->pid, sub->flags);
+        }
+        else {
+            m.type = sub->msg_type;
+
+            if (msg_send(&m, sub->pid, false) < 1) {
+                /* told again by the next event */
+                sub->notified = NOTIFY_NONE;
+            }
+        }
+    }
+}
+
+pubsub_event_t *pubsub_get(pubsub_topic_t *topic, pubsub_sub_t *sub)
+{
+    unsigned int state = disableIRQ();
+    pubsub_event_t *event = NULL;
+
+    if (sub->seq == topic->seq) {
+        /* the next event tells it again */
+        sub->notified = NOTIFY_NONE;
+    }
+    else {
+        /* its reference goes to the caller */
+        event = &topic->events[sub->slot];
+        sub->slot = next_slot(topic, sub->slot);
+        sub->seq++;
+    }
+
+    restoreIRQ(state);
+    return event;
+}
+
+void pubsub_release(pubsub_topic_t *topic, pubsub_event_t *event)
+{
+    unsigned int state = disableIRQ();
+
+    (void) topic;
+
+    if (event->refs > 0) {
+        event->refs--;
+    }
+
+    restoreIRQ(state);
+}
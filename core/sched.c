@@ -29,6 +29,8 @@
 #include "bitarithm.h"
 #include "thread.h"
 #include "irq.h"
+#include "trace.h"
+#include "energy.h"
 
 #if SCHEDSTATISTICS
 #include "hwtimer.h"
@@ -47,14 +49,145 @@ volatile tcb_t *active_thread;
 volatile int thread_pid = -1;
 volatile int last_pid = -1;
 
-clist_node_t *runqueues[SCHED_PRIO_LEVELS];
 static uint32_t runqueue_bitcache = 0;
 
+/* the thread sched_run() tries first, see sched_handoff() */
+static tcb_t *handoff;
+
+#if SCHED_RUNQUEUE_ARRAY
+/* circular list of the pids per priority, the head runs next */
+static uint8_t runqueue_next[MAXTHREADS];
+static uint8_t runqueue_prev[MAXTHREADS];
+static uint8_t runqueue_head[SCHED_PRIO_LEVELS];
+
+static inline void runqueue_add(tcb_t *process, uint16_t priority)
+{
+    uint8_t pid = process->pid;
+
+    if (runqueue_bitcache & (1 << priority)) {
+        uint8_t head = runqueue_head[priority];
+        uint8_t tail = runqueue_prev[head];
+
+        runqueue_next[tail] = pid;
+        runqueue_prev[pid] = tail;
+        runqueue_next[pid] = head;
+        runqueue_prev[head] = pid;
+    }
+    else {
+        runqueue_head[priority] = pid;
+        runqueue_next[pid] = pid;
+        runqueue_prev[pid] = pid;
+        runqueue_bitcache |= 1 << priority;
+    }
+}
+
+static inline void runqueue_remove(tcb_t *process, uint16_t priority)
+{
+    uint8_t pid = process->pid;
+    uint8_t next = runqueue_next[pid];
+
+    if (next == pid) {
+        runqueue_bitcache &= ~(1 << priority);
+        return;
+    }
+
+    runqueue_next[runqueue_prev[pid]] = next;
+    runqueue_prev[next] = runqueue_prev[pid];
+
+    if (runqueue_head[priority] == pid) {
+        runqueue_head[priority] = next;
+    }
+}
+
+/* returns the head and moves it to the tail */
+static inline tcb_t *runqueue_pick(int priority)
+{
+    uint8_t pid = runqueue_head[priority];
+
+    runqueue_head[priority] = runqueue_next[pid];
+    return (tcb_t *) sched_threads[pid];
+}
+#else
+clist_node_t *runqueues[SCHED_PRIO_LEVELS];
+
+static inline void runqueue_add(tcb_t *process, uint16_t priority)
+{
+    clist_add(&runqueues[priority], &(process->rq_entry));
+    runqueue_bitcache |= 1 << priority;
+}
+
+static inline void runqueue_remove(tcb_t *process, uint16_t priority)
+{
+    clist_remove(&runqueues[priority], &(process->rq_entry));
+
+    if (!runqueues[priority]) {
+        runqueue_bitcache &= ~(1 << priority);
+    }
+}
+
+/* returns the head and moves it to the tail */
+static inline tcb_t *runqueue_pick(int priority)
+{
+    clist_node_t next = *(runqueues[priority]);
+
+    clist_advance(&(runqueues[priority]));
+    return (tcb_t *) next.data;
+}
+#endif
+
 #if SCHEDSTATISTICS
 static void (*sched_cb) (uint32_t timestamp, uint32_t value) = NULL;
 schedstat pidlist[MAXTHREADS];
+unsigned long sched_prio_runtime_ticks[SCHED_PRIO_LEVELS];
+unsigned int sched_runqueue_depth_max[SCHED_PRIO_LEVELS];
+unsigned long sched_isr_ticks;
+static unsigned int runqueue_depth[SCHED_PRIO_LEVELS];
+static unsigned long isr_start;
+static unsigned int isr_nesting;
+
+static void sched_stat_rq_add(uint16_t priority)
+{
+    if (++runqueue_depth[priority] > sched_runqueue_depth_max[priority]) {
+        sched_runqueue_depth_max[priority] = runqueue_depth[priority];
+    }
+}
+
+static void sched_stat_wakeup(tcb_t *process)
+{
+    pidlist[process->pid].wakeup_time = hwtimer_now();
+    pidlist[process->pid].wakeups++;
+}
+
+static void sched_stat_rq_remove(uint16_t priority)
+{
+    runqueue_depth[priority]--;
+}
+#else
+#define sched_stat_rq_add(priority)
+#define sched_stat_rq_remove(priority)
+#define sched_stat_wakeup(process)
 #endif
 
+void sched_handoff(tcb_t *process)
+{
+    handoff = process;
+}
+
+/* the handoff thread if it may run now, it is taken once either way */
+static inline tcb_t *handoff_take(void)
+{
+    tcb_t *process = handoff;
+
+    handoff = NULL;
+
+    if ((process != NULL) && (process->status >= STATUS_ON_RUNQUEUE) &&
+        !(runqueue_bitcache & ((1 << process->priority) - 1))) {
+        return process;
+    }
+
+    return NULL;
+}
+
 void sched_run()
 {
     sched_context_switch_request = 0;
@@ -81,6 +214,7 @@ void sched_run()
 
     if (my_active_thread && (pidlist[my_active_thread->pid].laststart)) {
         pidlist[my_active_thread->pid].runtime_ticks += time - pidlist[my_active_thread->pid].laststart;
+        sched_prio_runtime_ticks[my_active_thread->priority] += time - pidlist[my_active_thread->pid].laststart;
     }
 
 #endif
@@ -98,31 +232,38 @@ void sched_run()
         DEBUG("scheduler: new task created.\n");
     }
 
-    my_active_thread = NULL;
+    my_active_thread = handoff_take();
 
     while (!my_active_thread) {
         int nextrq = number_of_lowest_bit(runqueue_bitcache);
-        clist_node_t next = *(runqueues[nextrq]);
-        DEBUG("scheduler: first in queue: %s\n", ((tcb_t *)next.data)->name);
-        clist_advance(&(runqueues[nextrq]));
-        my_active_thread = (tcb_t *)next.data;
-        thread_pid = (volatile int) my_active_thread->pid;
+        my_active_thread = runqueue_pick(nextrq);
+        DEBUG("scheduler: first in queue: %s\n", my_active_thread->name);
+    }
+
+    thread_pid = (volatile int) my_active_thread->pid;
 #if SCHEDSTATISTICS
-        pidlist[my_active_thread->pid].laststart = time;
-        pidlist[my_active_thread->pid].schedules++;
-        if ((sched_cb) && (my_active_thread->pid != last_pid)) {
-            sched_cb(hwtimer_now(), my_active_thread->pid);
-            last_pid = my_active_thread->pid;
+    pidlist[my_active_thread->pid].laststart = time;
+    pidlist[my_active_thread->pid].schedules++;
+    if (pidlist[my_active_thread->pid].wakeup_time) {
+        unsigned long latency = time - pidlist[my_active_thread->pid].wakeup_time;
+        pidlist[my_active_thread->pid].latency_sum_ticks += latency;
+        if (latency > pidlist[my_active_thread->pid].latency_max_ticks) {
+            pidlist[my_active_thread->pid].latency_max_ticks = latency;
         }
+        pidlist[my_active_thread->pid].wakeup_time = 0;
+    }
+    if ((sched_cb) && (my_active_thread->pid != last_pid)) {
+        sched_cb(hwtimer_now(), my_active_thread->pid);
+        last_pid = my_active_thread->pid;
+    }
 #endif
 #ifdef MODULE_NSS
 
-        if (active_thread && active_thread->pid != last_pid) {
-            last_pid = active_thread->pid;
-        }
+    if (active_thread && active_thread->pid != last_pid) {
+        last_pid = active_thread->pid;
+    }
 
 #endif
-    }
 
     DEBUG("scheduler: next task: %s\n", my_active_thread->name);
 
@@ -134,6 +275,9 @@ void sched_run()
         }
 
         sched_set_status((tcb_t *)my_active_thread,  STATUS_RUNNING);
+        TRACE(TRACE_SCHED_SWITCH, my_active_thread->pid);
+        /* the MCU runs, also if an interrupt woke it up from the idle thread */
+        ENERGY_MCU(LPM_ON);
     }
 
     active_thread = (volatile tcb_t *) my_active_thread;
@@ -146,6 +290,20 @@ void sched_register_cb(void (*callback)(uint32_t, uint32_t))
 {
     sched_cb = callback;
 }
+
+void sched_stat_isr_enter(void)
+{
+    if (isr_nesting++ == 0) {
+        isr_start = hwtimer_now();
+    }
+}
+
+void sched_stat_isr_exit(void)
+{
+    if (isr_nesting && (--isr_nesting == 0)) {
+        sched_isr_ticks += hwtimer_now() - isr_start;
+    }
+}
 #endif
 
 void sched_set_status(tcb_t *process, unsigned int status)
@@ -153,24 +311,39 @@ void sched_set_status(tcb_t *process, unsigned int status)
     if (status >= STATUS_ON_RUNQUEUE) {
         if (!(process->status >= STATUS_ON_RUNQUEUE)) {
             DEBUG("adding process %s to runqueue %u.\n", process->name, process->priority);
-            clist_add(&runqueues[process->priority], &(process->rq_entry));
-            runqueue_bitcache |= 1 << process->priority;
+            runqueue_add(process, process->priority);
+            sched_stat_rq_add(process->priority);
+            sched_stat_wakeup(process);
         }
     }
     else {
         if (process->status >= STATUS_ON_RUNQUEUE) {
             DEBUG("removing process %s from runqueue %u.\n", process->name, process->priority);
-            clist_remove(&runqueues[process->priority], &(process->rq_entry));
-
-            if (!runqueues[process->priority]) {
-                runqueue_bitcache &= ~(1 << process->priority);
-            }
+            runqueue_remove(process, process->priority);
+            sched_stat_rq_remove(process->priority);
         }
     }
 
     process->status = status;
 }
 
+void sched_change_priority(tcb_t *process, uint16_t priority)
+{
+    if (process->priority == priority) {
+        return;
+    }
+
+    if (process->status >= STATUS_ON_RUNQUEUE) {
+        DEBUG("moving process %s from runqueue %u to %u.\n", process->name, process->priority, priority);
+        runqueue_remove(process, process->priority);
+        sched_stat_rq_remove(process->priority);
+        runqueue_add(process, priority);
+        sched_stat_rq_add(priority);
+    }
+
+    process->priority = priority;
+}
+
 void sched_switch(uint16_t current_prio, uint16_t other_prio)
 {
     int in_isr = inISR();
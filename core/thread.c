@@ -31,6 +31,7 @@
 #include "bitarithm.h"
 #include "hwtimer.h"
 #include "sched.h"
+#include "pheap.h"
 
 inline int thread_getpid()
 {
@@ -98,6 +99,47 @@ int thread_wakeup(int pid)
     }
 }
 
+/* ends a timed wait of *arg* that nobody else ended before */
+static void thread_timeout(void *arg)
+{
+    tcb_t *t = (tcb_t *) arg;
+
+    if (t->status == STATUS_MUTEX_BLOCKED) {
+        /* the waker dequeues, a thread that is still blocked is queued */
+        pheap_remove((pheap_node_t *) t->wait_data);
+    }
+    else if ((t->status != STATUS_RECEIVE_BLOCKED) &&
+             (t->status != STATUS_SLEEPING)) {
+        return;
+    }
+
+    DEBUG("thread_timeout: %s timed out\n", t->name);
+
+    t->wait_data = NULL;
+    sched_set_status(t, STATUS_PENDING);
+    sched_context_switch_request = 1;
+}
+
+void thread_timeout_arm(unsigned long ticks)
+{
+    tcb_t *me = (tcb_t *) active_thread;
+
+    hwtimer_entry_set(&me->timeout, ticks, thread_timeout, me);
+}
+
+int thread_timeout_disarm(void)
+{
+    tcb_t *me = (tcb_t *) active_thread;
+    int old_state = disableIRQ();
+    int timed_out;
+
+    hwtimer_entry_remove(&me->timeout);
+    timed_out = (me->wait_data == NULL);
+
+    restoreIRQ(old_state);
+    return timed_out;
+}
+
 int thread_measure_stack_free(char *stack)
 {
     unsigned int *stackp = (unsigned int *)stack;
@@ -183,11 +225,14 @@ int thread_create(char *stack, int stacksize, char priority, int flags, void (*f
     cb->stack_size = total_stacksize;
 
     cb->priority = priority;
+    cb->base_priority = priority;
     cb->status = 0;
 
+#if !SCHED_RUNQUEUE_ARRAY
     cb->rq_entry.data = (unsigned int) cb;
     cb->rq_entry.next = NULL;
     cb->rq_entry.prev = NULL;
+#endif
 
     cb->name = name;
 
@@ -199,6 +244,15 @@ int thread_create(char *stack, int stacksize, char priority, int flags, void (*f
 
     cib_init(&(cb->msg_queue), 0);
     cb->msg_array = NULL;
+    cb->msg_bands = NULL;
+    cb->msg_payloads = NULL;
+    cb->wait_payload = NULL;
+
+    cb->flags = 0;
+    cb->flags_wait = 0;
+
+    cb->timeout.next = NULL;
+    cb->timeout.pprev = NULL;
 
     num_tasks++;
 
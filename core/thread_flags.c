@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup     core_thread_flags
+ * @{
+ *
+ * @file        thread_flags.c
+ * @brief       Thread flags implementation
+ *
+ * @}
+ */
+
+#include "kernel.h"
+#include "irq.h"
+#include "sched.h"
+#include "tcb.h"
+#include "thread.h"
+#include "thread_flags.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+static int satisfied(const tcb_t *t, int all)
+{
+    if (all) {
+        return (t->flags & t->flags_wait) == t->flags_wait;
+    }
+
+    return (t->flags & t->flags_wait) != 0;
+}
+
+int thread_flags_set(int pid, thread_flags_t mask)
+{
+    tcb_t *target;
+    int wake = 0;
+
+    if ((pid < 0) || (pid >= MAXTHREADS)) {
+        return -1;
+    }
+
+    unsigned int state = disableIRQ();
+
+    target = (tcb_t *) sched_threads[pid];
+
+    if (target == NULL) {
+        restoreIRQ(state);
+        return -1;
+    }
+
+    target->flags |= mask;
+
+    if (((target->status == STATUS_FLAGS_BLOCKED_ANY) && satisfied(target, 0)) ||
+        ((target->status == STATUS_FLAGS_BLOCKED_ALL) && satisfied(target, 1))) {
+        DEBUG("thread_flags_set: waking up %i\n", pid);
+        sched_set_status(target, STATUS_PENDING);
+        wake = 1;
+    }
+
+    restoreIRQ(state);
+
+    if (wake) {
+        sched_switch(active_thread->priority, target->priority);
+    }
+
+    return 1;
+}
+
+static thread_flags_t wait(thread_flags_t mask, unsigned int status)
+{
+    tcb_t *me = (tcb_t *) active_thread;
+    thread_flags_t res;
+    unsigned int state = disableIRQ();
+
+    me->flags_wait = mask;
+
+    /* flags set between enabling interrupts and the yield make us pending
+     * again, the yield returns right away then */
+    while (!satisfied(me, status == STATUS_FLAGS_BLOCKED_ALL)) {
+        sched_set_status(me, status);
+        restoreIRQ(state);
+        thread_yield();
+        state = disableIRQ();
+    }
+
+    res = me->flags & mask;
+    me->flags &= ~res;
+
+    restoreIRQ(state);
+    return res;
+}
+
+thread_flags_t thread_flags_wait_any(thread_flags_t mask)
+{
+    return wait(mask, STATUS_FLAGS_BLOCKED_ANY);
+}
+
+thread_flags_t thread_flags_wait_all(thread_flags_t mask)
+{
+    return wait(mask, STATUS_FLAGS_BLOCKED_ALL);
+}
+
+thread_flags_t thread_flags_clear(thread_flags_t mask)
+{
+    tcb_t *me = (tcb_t *) active_thread;
+    unsigned int state = disableIRQ();
+    thread_flags_t res = me->flags & mask;
+
+    me->flags &= ~res;
+
+    restoreIRQ(state);
+    return res;
+}
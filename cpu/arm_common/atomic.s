@@ -8,6 +8,10 @@
 
 /* Public functions declared in this file */
   .global  atomic_set_return
+  .global  atomic_cas
+  .global  atomic_fetch_add
+  .global  atomic_fetch_or
+  .global  atomic_fetch_and
 
 .func
 atomic_set_return:
@@ -15,3 +19,58 @@ atomic_set_return:
     MOV r0, r2
     mov pc, lr
 .endfunc
+
+/* ARMv4 has no exclusive loads, so IRQs are masked around the compare */
+.func
+atomic_cas:
+    MRS r12, CPSR
+    ORR r3, r12, #0x80
+    MSR CPSR_c, r3
+    LDR r3, [r0]
+    CMP r3, r1
+    STREQ r2, [r0]
+    MSR CPSR_c, r12         /* leaves the flags of the compare */
+    MOVEQ r0, #1
+    MOVNE r0, #0
+    mov pc, lr
+.endfunc
+
+/* these mask IRQs like atomic_cas, r0 = val, r1 = operand, returns old */
+.func
+atomic_fetch_add:
+    MRS r12, CPSR
+    ORR r3, r12, #0x80
+    MSR CPSR_c, r3
+    LDR r2, [r0]
+    ADD r3, r2, r1
+    STR r3, [r0]
+    MSR CPSR_c, r12
+    MOV r0, r2
+    mov pc, lr
+.endfunc
+
+.func
+atomic_fetch_or:
+    MRS r12, CPSR
+    ORR r3, r12, #0x80
+    MSR CPSR_c, r3
+    LDR r2, [r0]
+    ORR r3, r2, r1
+    STR r3, [r0]
+    MSR CPSR_c, r12
+    MOV r0, r2
+    mov pc, lr
+.endfunc
+
+.func
+atomic_fetch_and:
+    MRS r12, CPSR
+    ORR r3, r12, #0x80
+    MSR CPSR_c, r3
+    LDR r2, [r0]
+    AND r3, r2, r1
+    STR r3, [r0]
+    MSR CPSR_c, r12
+    MOV r0, r2
+    mov pc, lr
+.endfunc
@@ -82,5 +82,9 @@
 
 bool cpu_install_irq(int IntNumber, void *HandlerAddr, int Priority);
 
+unsigned disableFIQ(void);
+unsigned restoreFIQ(unsigned oldCPSR);
+unsigned enableFIQ(void);
+
 /** @} */
 #endif /*ARMVIC_H_*/
@@ -15,42 +15,195 @@
  * @}
  */
 
+#include <stdio.h>
+#include <stdint.h>
+
 #include "sched.h"
+#include "tcb.h"
 #include "cpu.h"
+#include "cpu-conf.h"
 #include "irq.h"
+#include "crash.h"
 
 extern void sched_task_exit(void);
 void sched_task_return(void);
+void cpu_stack_guard_update(void);
+
+/*
+ * An exclusive store fails if anything, an interrupt included, touched
+ * memory since the exclusive load, the operation is tried again then.
+ */
+unsigned int atomic_set_return(unsigned int *val, unsigned int set)
+{
+    unsigned int old;
+
+    do {
+        old = __LDREXW((volatile uint32_t *) val);
+    } while (__STREXW(set, (volatile uint32_t *) val));
+
+    return old;
+}
+
+int atomic_cas(unsigned int *val, unsigned int old, unsigned int set)
+{
+    do {
+        if (__LDREXW((volatile uint32_t *) val) != old) {
+            __CLREX();
+            return 0;
+        }
+    } while (__STREXW(set, (volatile uint32_t *) val));
+
+    return 1;
+}
+
+unsigned int atomic_fetch_add(unsigned int *val, unsigned int inc)
+{
+    unsigned int old;
+
+    do {
+        old = __LDREXW((volatile uint32_t *) val);
+    } while (__STREXW(old + inc, (volatile uint32_t *) val));
+
+    return old;
+}
+
+unsigned int atomic_fetch_or(unsigned int *val, unsigned int mask)
+{
+    unsigned int old;
+
+    do {
+        old = __LDREXW((volatile uint32_t *) val);
+    } while (__STREXW(old | mask, (volatile uint32_t *) val));
+
+    return old;
+}
+
+unsigned int atomic_fetch_and(unsigned int *val, unsigned int mask)
+{
+    unsigned int old;
+
+    do {
+        old = __LDREXW((volatile uint32_t *) val);
+    } while (__STREXW(old & mask, (volatile uint32_t *) val));
 
-unsigned int atomic_set_return(unsigned int* p, unsigned int uiVal) {
-	//unsigned int cspr = disableIRQ();		//crashes
-	dINT();
-	unsigned int uiOldVal = *p;
-	*p = uiVal;
-	//restoreIRQ(cspr);						//crashes
-	eINT();
-	return uiOldVal;
+    return old;
 }
 
+#if CPU_STACK_GUARD
+#define STACK_GUARD_REGION  (0)
+
+/* start of the guard of the running thread */
+static inline uint32_t stack_guard_start(void)
+{
+    return ((uint32_t) active_thread->stack_start + CPU_STACK_GUARD_SIZE - 1) &
+           ~(uint32_t) (CPU_STACK_GUARD_SIZE - 1);
+}
+
+/* moves the guard region to the stack of the thread that runs next, the
+ * rest of the memory keeps the default map */
+void cpu_stack_guard_update(void)
+{
+    MPU->RBAR = stack_guard_start() | MPU_RBAR_VALID_Msk | STACK_GUARD_REGION;
+    MPU->RASR = (6UL << MPU_RASR_AP_Pos) | MPU_RASR_XN_Msk |
+                MPU_RASR_S_Msk | MPU_RASR_C_Msk |
+                ((__builtin_ctz(CPU_STACK_GUARD_SIZE) - 1) << MPU_RASR_SIZE_Pos) |
+                MPU_RASR_ENABLE_Msk;
+
+    if (!(MPU->CTRL & MPU_CTRL_ENABLE_Msk)) {
+        SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+        MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+    }
+
+    __DSB();
+    __ISB();
+}
+
+void stack_guard_fault(void)
+{
+    static char message[48];
+    uint32_t addr = SCB->MMFAR;
+    uint32_t guard = stack_guard_start();
+
+    if ((SCB->CFSR & (1 << 7)) && (addr >= guard) &&
+        (addr < guard + CPU_STACK_GUARD_SIZE)) {
+        snprintf(message, sizeof(message), "stack overflow in %s",
+                 active_thread->name);
+        core_panic(0x1768, message);
+    }
+
+    core_panic(0x1768, "memory management fault");
+}
+
+/*
+ * The faulting thread has no stack left to run the handler on, so the
+ * MPU is switched off before anything is pushed: the handler overwrites
+ * the guard, which belongs to the thread's own stack.
+ */
+__attribute__((naked))
+void MemManage_Handler(void)
+{
+	asm volatile(
+	"ldr     r0, =0xe000ed94     \n" /* MPU->CTRL */
+	"movs    r1, #0              \n"
+	"str     r1, [r0]            \n"
+	"dsb                         \n"
+	"isb                         \n"
+	"b       stack_guard_fault   \n"
+	);
+}
+#else
+void cpu_stack_guard_update(void)
+{
+}
+#endif
+
 void cpu_switch_context_exit(void){
     sched_run();
+    cpu_stack_guard_update();
     sched_task_return();
 }
 
 
 void thread_yield(void) {
-	asm("svc 0x01\n");
+	/* the switch happens in PendSV_Handler, right away in a thread with
+	 * interrupts enabled, on exception return in an interrupt handler */
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	__DSB();
+	__ISB();
 }
 
 
+/*
+ * PendSV has the lowest priority, so it is tail chained to the interrupt
+ * handlers: however many threads they woke up, there is one switch when
+ * the last of them returns.  {r0-r3,r12,lr,pc,xPSR} were stacked by the
+ * hardware already, r4-r11 are only saved if the thread changes.
+ */
 __attribute__((naked))
-void SVC_Handler(void)
+void PendSV_Handler(void)
 {
-	save_context();
-	asm("bl sched_run");
-	/* call scheduler update active_thread variable with pdc of next thread
-	 * the thread that has higest priority and is in PENDING state */
-	restore_context();
+	asm volatile(
+	"cpsid   i                   \n"
+	"ldr     r1, =active_thread  \n"
+	"ldr     r0, [r1]            \n" /* r0 = thread that was interrupted */
+	"push    {r0, lr}            \n" /* lr is the exception return value */
+	"bl      sched_run           \n" /* keeps r4-r11, they are callee saved */
+	"bl      cpu_stack_guard_update \n"
+	"pop     {r0, lr}            \n"
+	"ldr     r1, =active_thread  \n"
+	"ldr     r1, [r1]            \n" /* r1 = thread to run */
+	"cmp     r0, r1              \n"
+	"beq     1f                  \n"
+	"push    {r4-r11}            \n"
+	"push    {lr}                \n"
+	"str     sp, [r0]            \n" /* save sp in the old thread's tcb */
+	"ldr     sp, [r1]            \n" /* load sp from the new thread's tcb */
+	"pop     {lr}                \n"
+	"pop     {r4-r11}            \n"
+	"1:                          \n"
+	"cpsie   i                   \n"
+	"bx      lr                  \n" /* the hardware restores the rest */
+	);
 }
 
  /* kernel functions */
@@ -17,4 +17,22 @@
 #define UART0_BUFSIZE                   (128)
 /** @} */
 
+/**
+ * @brief Makes the lowest CPU_STACK_GUARD_SIZE bytes of the running
+ *        thread's stack read-only with the MPU, so an overflow raises a
+ *        MemManage fault instead of corrupting the memory below
+ */
+#ifndef CPU_STACK_GUARD
+#define CPU_STACK_GUARD                 (1)
+#endif
+
+/**
+ * @brief Size of the guard, a power of two of at least 32 bytes, taken
+ *        from the thread's stack together with up to as much for its
+ *        alignment
+ */
+#ifndef CPU_STACK_GUARD_SIZE
+#define CPU_STACK_GUARD_SIZE            (32)
+#endif
+
 #endif /* CPU_CONF_H */
@@ -29,6 +29,19 @@ void restore_context(void);
  */
 void thread_yield(void);
 
+extern volatile unsigned int sched_context_switch_request;
+
+/**
+ * @brief Call at the end of an interrupt handler that may have woken up a
+ *        thread, the switch happens when the last handler returned
+ */
+static inline void cpu_end_of_isr(void)
+{
+    if (sched_context_switch_request) {
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+}
+
 /** @} */
 
 #endif /* CPU_H */
@@ -31,6 +31,17 @@ enum lpm_mode lpm_set(enum lpm_mode target) {
 	return last_lpm;
 }
 
+// TODO: sleep modes, timer 0 would stop in them
+unsigned long lpm_wakeup_latency(enum lpm_mode mode) {
+	return (mode <= LPM_IDLE) ? 0 : LPM_LATENCY_NEVER;
+}
+
+enum lpm_mode lpm_set_until(enum lpm_mode target, unsigned long deadline) {
+	(void) deadline;
+
+	return lpm_set(target);
+}
+
 void lpm_awake(void) {
 	lpm = LPM_ON;
 }
@@ -0,0 +1,75 @@
+/**
+ * Sampling timer of the profiler on NXP LPC1768
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * TIMER3 runs at 1 MHz and interrupts every interval.  The interrupted PC
+ * is taken from the exception frame on the stack that was active, MSP in
+ * interrupt context, otherwise PSP.
+ *
+ * @file   profiler_cpu.c
+ * @author Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifdef MODULE_PROFILER
+
+#include <stdint.h>
+#include "cpu.h"
+#include "cpu-conf.h"
+#include "profiler.h"
+
+/* position of the return address in the exception frame */
+#define FRAME_PC        (6)
+
+void TIMER3_IRQHandler(void) __attribute__((naked));
+
+static void __attribute__((used)) profiler_irq(uint32_t *frame)
+{
+    LPC_TIM3->IR = 1;
+    profiler_sample(frame[FRAME_PC]);
+}
+
+void TIMER3_IRQHandler(void)
+{
+    __asm__ volatile(
+        "tst    lr, #4          \n"
+        "ite    eq              \n"
+        "mrseq  r0, msp         \n"
+        "mrsne  r0, psp         \n"
+        "b      profiler_irq    \n"
+    );
+}
+
+int profiler_arch_start(unsigned long interval_us)
+{
+    if (interval_us < 2) {
+        return -1;
+    }
+
+    LPC_SC->PCONP |= (1 << 23);                 /* power up TIMER3 */
+    LPC_SC->PCLKSEL1 &= ~(3 << 14);
+    LPC_SC->PCLKSEL1 |= (1 << 14);              /* PCLK = CCLK */
+
+    LPC_TIM3->TCR = 2;                          /* disable and reset */
+    LPC_TIM3->PR = (F_CPU / 1000000) - 1;       /* 1 MHz */
+    LPC_TIM3->MR0 = interval_us - 1;
+    LPC_TIM3->MCR = 3;                          /* interrupt and reset on MR0 */
+    LPC_TIM3->IR = 0x3f;
+    NVIC_EnableIRQ(TIMER3_IRQn);
+    LPC_TIM3->TCR = 1;
+
+    return 0;
+}
+
+void profiler_arch_stop(void)
+{
+    LPC_TIM3->TCR = 0;
+    NVIC_DisableIRQ(TIMER3_IRQn);
+    LPC_TIM3->IR = 0x3f;
+}
+
+#endif /* MODULE_PROFILER */
@@ -242,6 +242,9 @@ void Reset_Handler(void)
     /*
      * Call the application's entry point.
      */
+    /* context switches wait for all other interrupt handlers */
+    NVIC_SetPriority(PendSV_IRQn, 0xff);
+
     board_init();
     kernel_init();
 }
@@ -91,4 +91,46 @@ bool install_irq(int IntNumber, void (*HandlerAddr)(void), int Priority)
     }
 }
 
+/* read by the FIQ vector in startup.s */
+void (*__fiq_handler)(void) __attribute__((section(".fiq")));
+
+static void (*fiq_top)(void);
+static void (*fiq_deferred)(void);
+
+static void fiq_handler(void) __attribute__((interrupt("FIQ")));
+static void fiq_deferred_handler(void) __attribute__((interrupt("IRQ")));
+
+static void fiq_handler(void)
+{
+    fiq_top();
+    VICSoftInt = 1 << SWI_INT;	/* the rest is a normal interrupt */
+}
+
+static void fiq_deferred_handler(void)
+{
+    VICSoftIntClr = 1 << SWI_INT;
+    fiq_deferred();
+    VICVectAddr = 0;			/* Acknowledge Interrupt */
+}
+
+bool install_fiq(int IntNumber, void (*Top)(void), void (*Deferred)(void))
+{
+    if (IntNumber >= VIC_SIZE || IntNumber == SWI_INT) {
+        return false;
+    }
+
+    disableFIQ();
+    VICIntEnClr = 1 << IntNumber;
+
+    fiq_top = Top;
+    fiq_deferred = Deferred;
+    __fiq_handler = fiq_handler;
+    install_irq(SWI_INT, fiq_deferred_handler, HIGHEST_PRIORITY);
+
+    VICIntSelect |= 1 << IntNumber;	/* FIQ instead of IRQ */
+    VICIntEnable = 1 << IntNumber;
+    enableFIQ();
+    return true;
+}
+
 /** @} */
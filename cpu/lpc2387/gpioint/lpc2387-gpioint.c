@@ -32,13 +32,33 @@ See the file LICENSE in the top level directory for more details.
 #include "gpioint.h"
 #include "cpu.h"
 #include "irq.h"
+#include "bitarithm.h"
+#include "VIC.h"
 
-struct irq_callback_t {
-    fp_irqcb    callback;
-};
+/*
+ * Set GPIOINT_FIQ to take GPIO edges in the FIQ.  Only the edges are
+ * latched there, within a few cycles even while IRQs are disabled, the
+ * callbacks run right after as the interrupt of the highest priority.
+ */
+#ifndef GPIOINT_FIQ
+#define GPIOINT_FIQ     (0)
+#endif
+
+/* callbacks indexed by pin number */
+static fp_irqcb gpioint0[32];
+static fp_irqcb gpioint2[32];
+/* pins registered with GPIOINT_HIGH_PRIO */
+static uint32_t gpioint0_prio;
+static uint32_t gpioint2_prio;
 
-static struct irq_callback_t gpioint0[32];
-static struct irq_callback_t gpioint2[32];
+#if GPIOINT_FIQ
+/* edges taken off the hardware by the FIQ, not dispatched yet */
+static volatile uint32_t latched0;
+static volatile uint32_t latched2;
+
+static void gpioint_fiq(void);
+static void gpioint_deferred(void);
+#endif
 
 
 void gpioint_init(void)
@@ -47,25 +67,28 @@ void gpioint_init(void)
 
     /* GPIO Init */
     INTWAKE |= GPIO0WAKE | GPIO2WAKE;                       /* allow GPIO to wake up from power down */
+#if GPIOINT_FIQ
+    install_fiq(GPIO_INT, gpioint_fiq, gpioint_deferred);   /* install fiq handler */
+#else
     install_irq(GPIO_INT, &GPIO_IRQHandler, IRQP_GPIO);     /* install irq handler */
+#endif
 }
 
 /*---------------------------------------------------------------------------*/
 bool
 gpioint_set(int port, uint32_t bitmask, int flags, fp_irqcb callback)
 {
-    struct irq_callback_t   *cbdata;
-    unsigned long bit;
+    fp_irqcb *cbdata;
+    uint32_t *prio;
     volatile unsigned long *en_f;
     volatile unsigned long *en_r;
     volatile unsigned long *en_clr;
 
     /* lookup registers */
-    bit = number_of_highest_bit(bitmask);                       /* get irq mapping table index */
-
     switch(port) {
         case 0:                                                 /* PORT0 */
             cbdata = gpioint0;
+            prio = &gpioint0_prio;
             en_f = &IO0_INT_EN_F;
             en_r = &IO0_INT_EN_R;
             en_clr = &IO0_INT_CLR;
@@ -73,6 +96,7 @@ gpioint_set(int port, uint32_t bitmask, int flags, fp_irqcb callback)
 
         case 2:                                                 /* PORT2 */
             cbdata = gpioint2;
+            prio = &gpioint2_prio;
             en_f = &IO2_INT_EN_F;
             en_r = &IO2_INT_EN_R;
             en_clr = &IO2_INT_CLR;
@@ -100,12 +124,22 @@ gpioint_set(int port, uint32_t bitmask, int flags, fp_irqcb callback)
         *en_r &= ~bitmask;                                      /* disable rising edge */
     }
 
-    if (((flags & (GPIOINT_FALLING_EDGE | GPIOINT_RISING_EDGE)) != 0)) {
-        cbdata[bit].callback = callback;
+    if (((flags & (GPIOINT_FALLING_EDGE | GPIOINT_RISING_EDGE)) == 0)) {
+        callback = NULL;                                        /* remove from interrupt mapping table */
+    }
+
+    for (uint32_t pins = bitmask; pins != 0;) {
+        unsigned bit = number_of_highest_bit(pins);
 
+        pins &= ~(1UL << bit);
+        cbdata[bit] = callback;
+    }
+
+    if ((callback != NULL) && ((flags & GPIOINT_HIGH_PRIO) != 0)) {
+        *prio |= bitmask;
     }
     else {
-        cbdata[bit].callback = NULL;                            /* remove from interrupt mapping table */
+        *prio &= ~bitmask;
     }
 
     restoreIRQ(cpsr);
@@ -113,25 +147,102 @@ gpioint_set(int port, uint32_t bitmask, int flags, fp_irqcb callback)
     return true;                                                /* success */
 }
 /*---------------------------------------------------------------------------*/
-static void __attribute__((__no_instrument_function__)) test_irq(int port, unsigned long f_mask, unsigned long r_mask, struct irq_callback_t *pcb)
+/* runs the callbacks of the pins in *pins*, without looking at the others */
+static inline void __attribute__((__no_instrument_function__)) dispatch(uint32_t pins, fp_irqcb *cbdata)
 {
-    (void) port;
+    while (pins != 0) {
+        unsigned bit = number_of_highest_bit(pins);
+
+        pins &= ~(1UL << bit);
+
+        if (cbdata[bit] != NULL) {
+            cbdata[bit]();                                          /* pass to handler */
+        }
+    }
+}
+/*---------------------------------------------------------------------------*/
+/* adds the edges that came up to *pending0* and *pending2* */
+static inline void __attribute__((__no_instrument_function__)) collect(uint32_t *pending0, uint32_t *pending2)
+{
+#if GPIOINT_FIQ
+    unsigned cpsr = disableFIQ();
+
+    *pending0 |= latched0;
+    *pending2 |= latched2;
+    latched0 = 0;
+    latched2 = 0;
+    restoreFIQ(cpsr);
+#else
+    if (IO_INT_STAT & BIT0) {                                       /* interrupt(s) on PORT0 pending */
+        uint32_t int_stat = IO0_INT_STAT_F | IO0_INT_STAT_R;
+
+        IO0_INT_CLR = int_stat;                                     /* clear flags of changed pins */
+        *pending0 |= int_stat;
+    }
+
+    if (IO_INT_STAT & BIT2) {                                       /* interrupt(s) on PORT2 pending */
+        uint32_t int_stat = IO2_INT_STAT_F | IO2_INT_STAT_R;
+
+        IO2_INT_CLR = int_stat;                                     /* clear flags of changed pins */
+        *pending2 |= int_stat;
+    }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Callbacks of GPIOINT_HIGH_PRIO pins run first, the others one at a
+ * time, with edges on high priority pins that came up in between handled
+ * before the next.
+ */
+static void __attribute__((__no_instrument_function__)) gpioint_dispatch(void)
+{
+    uint32_t pending0 = 0;
+    uint32_t pending2 = 0;
 
-    /* Test each bit of rising and falling masks, if set trigger interrupt
-     * on corresponding device */
     do {
-        if ((pcb->callback != NULL)) {
-            if ((r_mask & 1) | (f_mask & 1)) {
-                pcb->callback();            /* pass to handler */
-            }
+        collect(&pending0, &pending2);
+
+        dispatch(pending0 & gpioint0_prio, gpioint0);
+        dispatch(pending2 & gpioint2_prio, gpioint2);
+        pending0 &= ~gpioint0_prio;
+        pending2 &= ~gpioint2_prio;
+
+        if (pending0 != 0) {
+            uint32_t pin = 1UL << number_of_highest_bit(pending0);
+
+            pending0 &= ~pin;
+            dispatch(pin, gpioint0);
         }
+        else if (pending2 != 0) {
+            uint32_t pin = 1UL << number_of_highest_bit(pending2);
 
-        f_mask >>= 1UL;
-        r_mask >>= 1UL;
-        pcb++;
+            pending2 &= ~pin;
+            dispatch(pin, gpioint2);
+        }
     }
-    while ((f_mask != 0) || (r_mask != 0));
+    while ((pending0 | pending2) != 0);
+}
+/*---------------------------------------------------------------------------*/
+#if GPIOINT_FIQ
+/* in FIQ mode, touches nothing but the GPIO registers and the latches */
+static void __attribute__((__no_instrument_function__)) gpioint_fiq(void)
+{
+    uint32_t int_stat;
+
+    int_stat = IO0_INT_STAT_F | IO0_INT_STAT_R;
+    IO0_INT_CLR = int_stat;                                         /* clear flags of changed pins */
+    latched0 |= int_stat;
+
+    int_stat = IO2_INT_STAT_F | IO2_INT_STAT_R;
+    IO2_INT_CLR = int_stat;                                         /* clear flags of changed pins */
+    latched2 |= int_stat;
+}
+
+static void __attribute__((__no_instrument_function__)) gpioint_deferred(void)
+{
+    gpioint_dispatch();
 }
+#endif
 /*---------------------------------------------------------------------------*/
 void GPIO_IRQHandler(void) __attribute__((interrupt("IRQ")));
 /**
@@ -143,26 +254,7 @@ void GPIO_IRQHandler(void) __attribute__((interrupt("IRQ")));
  */
 void __attribute__((__no_instrument_function__)) GPIO_IRQHandler(void)
 {
-    if (IO_INT_STAT & BIT0) {                                       /* interrupt(s) on PORT0 pending */
-        unsigned long int_stat_f = IO0_INT_STAT_F;                  /* save content */
-        unsigned long int_stat_r = IO0_INT_STAT_R;                  /* save content */
-
-        IO0_INT_CLR = int_stat_f;                                   /* clear flags of fallen pins */
-        IO0_INT_CLR = int_stat_r;                                   /* clear flags of risen pins */
-
-        test_irq(0, int_stat_f, int_stat_r, gpioint0);
-    }
-
-    if (IO_INT_STAT & BIT2) {                                       /* interrupt(s) on PORT2 pending */
-        unsigned long int_stat_f = IO2_INT_STAT_F;                  /* save content */
-        unsigned long int_stat_r = IO2_INT_STAT_R;                  /* save content */
-
-        IO2_INT_CLR = int_stat_f;                                   /* clear flags of fallen pins */
-        IO2_INT_CLR = int_stat_r;                                   /* clear flags of risen pins */
-
-        test_irq(2, int_stat_f, int_stat_r, gpioint2);
-    }
-
+    gpioint_dispatch();
     VICVectAddr = 0;                                                /* Acknowledge Interrupt */
 }
 /*---------------------------------------------------------------------------*/
@@ -31,6 +31,8 @@
 #include "i2c.h"
 #include "VIC.h"
 #include "irq.h"
+#include "msg.h"
+#include "thread.h"
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -53,6 +55,220 @@ static void i2c_interface1_master_handler(void) __attribute__((interrupt(
 static void i2c_interface2_master_handler(void) __attribute__((interrupt(
             "IRQ")));
 
+/* the registers of an interface, in the order of lpc23xx.h */
+typedef struct {
+    volatile unsigned long conset;
+    volatile unsigned long stat;
+    volatile unsigned long dat;
+    volatile unsigned long adr;
+    volatile unsigned long sclh;
+    volatile unsigned long scll;
+    volatile unsigned long conclr;
+} i2c_regs_t;
+
+/* transfers of i2c_submit(), the head is on the bus */
+typedef struct {
+    i2c_xfer_t *head;
+    i2c_xfer_t *tail;
+    uint8_t index;          /* next byte of tx or rx */
+    uint8_t reading;        /* after the repeated start */
+} i2c_queue_t;
+
+static i2c_regs_t *const i2c_regs[] = {
+    (i2c_regs_t *) I2C0_BASE_ADDR,
+    (i2c_regs_t *) I2C1_BASE_ADDR,
+    (i2c_regs_t *) I2C2_BASE_ADDR,
+};
+
+static i2c_queue_t i2c_queue[3];
+
+/* index into i2c_regs and i2c_queue, -1 for an unknown interface */
+static int i2c_unit(uint8_t i2c_interface)
+{
+    switch (i2c_interface) {
+        case I2C0:
+            return 0;
+
+        case I2C1_0:
+        case I2C1_1:
+            return 1;
+
+        case I2C2:
+            return 2;
+    }
+
+    return -1;
+}
+
+/* ends the transfer on the bus, starts the next one, in the handler */
+static void i2c_queue_finish(int unit, int8_t result)
+{
+    i2c_regs_t *regs = i2c_regs[unit];
+    i2c_queue_t *q = &i2c_queue[unit];
+    i2c_xfer_t *xfer = q->head;
+
+    q->head = xfer->next;
+    q->index = 0;
+    q->reading = 0;
+
+    if (q->head != NULL) {
+        /* a stop and the next start right after */
+        regs->conset = I2CONSET_STO | I2CONSET_STA;
+    }
+    else {
+        q->tail = NULL;
+        regs->conset = I2CONSET_STO;
+    }
+
+    xfer->result = result;
+
+    if (xfer->waiter >= 0) {
+        thread_wakeup(xfer->waiter);
+    }
+
+    if (xfer->pid >= 0) {
+        msg_t m;
+
+        m.type = I2C_XFER_DONE;
+        m.content.ptr = (char *) xfer;
+        msg_send_int(&m, xfer->pid);
+    }
+}
+
+/* one step of the transfer at the head of the queue, in the handler */
+static void i2c_queue_step(int unit)
+{
+    i2c_regs_t *regs = i2c_regs[unit];
+    i2c_queue_t *q = &i2c_queue[unit];
+    i2c_xfer_t *xfer = q->head;
+
+    switch (regs->stat) {
+        case 0x08: /* A Start condition is issued. */
+        case 0x10: /* A repeated started is issued */
+            q->reading = (regs->stat == 0x10) || (xfer->tx_len == 0);
+            regs->dat = ((xfer->slave_addr << 1) & WRITE_ENABLE_BIT_MASK) |
+                        (q->reading ? READ_ENABLE_BIT_MASK : 0);
+            regs->conclr = I2CONCLR_STAC;
+            break;
+
+        case 0x30: /* the slave may refuse the byte after the last */
+            if (q->index < xfer->tx_len) {
+                i2c_queue_finish(unit, I2C_XFER_NACK);
+                break;
+            }
+
+            /* fall through */
+        case 0x18: /* SLA+W or a data byte acknowledged */
+        case 0x28:
+            if (q->index < xfer->tx_len) {
+                regs->dat = xfer->tx[q->index++];
+            }
+            else if (xfer->rx_len != 0) {
+                q->index = 0;
+                regs->conset = I2CONSET_STA; /* Set Repeated-start flag */
+            }
+            else {
+                i2c_queue_finish(unit, I2C_XFER_OK);
+            }
+
+            break;
+
+        case 0x40: /* Master Receive, SLA_R has been sent */
+            if (xfer->rx_len >= 2) {
+                regs->conset = I2CONSET_AA; /* assert ACK after data is received */
+            }
+            else {
+                regs->conclr = I2CONCLR_AAC;
+            }
+
+            break;
+
+        case 0x50: /* Data byte received and acknowledged */
+            xfer->rx[q->index++] = regs->dat;
+
+            if (q->index >= xfer->rx_len - 1) {
+                regs->conclr = I2CONCLR_AAC; /* NACK after the last byte */
+            }
+
+            break;
+
+        case 0x58: /* Last data byte received */
+            xfer->rx[q->index++] = regs->dat;
+            i2c_queue_finish(unit, I2C_XFER_OK);
+            break;
+
+        case 0x20: /* regardless, it's a NACK */
+        case 0x48:
+            i2c_queue_finish(unit, I2C_XFER_NACK);
+            break;
+
+        default:   /* bus error or arbitration lost */
+            i2c_queue_finish(unit, I2C_XFER_ERROR);
+            break;
+    }
+
+    regs->conclr = I2CONCLR_SIC;
+}
+
+bool i2c_submit(uint8_t i2c_interface, i2c_xfer_t *xfers, uint8_t count)
+{
+    int unit = i2c_unit(i2c_interface);
+    i2c_queue_t *q;
+    unsigned cpsr;
+
+    if ((unit < 0) || (count == 0)) {
+        return false;
+    }
+
+    q = &i2c_queue[unit];
+
+    for (uint8_t i = 0; i < count; i++) {
+        xfers[i].next = (i + 1 < count) ? &xfers[i + 1] : NULL;
+        xfers[i].result = I2C_XFER_PENDING;
+        xfers[i].waiter = -1;
+    }
+
+    cpsr = disableIRQ();
+
+    if (q->head == NULL) {
+        q->head = xfers;
+        q->index = 0;
+        q->reading = 0;
+        i2c_regs[unit]->conset = I2CONSET_STA; /* Set Start flag */
+    }
+    else {
+        q->tail->next = xfers;
+    }
+
+    q->tail = &xfers[count - 1];
+    restoreIRQ(cpsr);
+
+    return true;
+}
+
+int i2c_xfer(uint8_t i2c_interface, i2c_xfer_t *xfer)
+{
+    unsigned cpsr;
+
+    xfer->pid = -1;
+
+    if (!i2c_submit(i2c_interface, xfer, 1)) {
+        return I2C_XFER_ERROR;
+    }
+
+    cpsr = disableIRQ();
+
+    if (xfer->result == I2C_XFER_PENDING) {
+        /* checked and set with interrupts off, the wakeup is not lost */
+        xfer->waiter = thread_getpid();
+        thread_sleep();
+    }
+
+    restoreIRQ(cpsr);
+
+    return xfer->result;
+}
+
 bool i2c_initialize(uint8_t i2c_interface, uint32_t i2c_mode,
                     uint8_t slave_addr, uint32_t baud_rate, void *handler)
 {
@@ -354,27 +570,19 @@ void i2c_initial_master_transmitter_mode(uint8_t i2c_interface)
 bool i2c_read(uint8_t i2c_interface, uint8_t slave_addr, uint8_t reg_addr,
               uint8_t *rx_buff, uint8_t rx_buff_length)
 {
-    i2c_clear_buffer((uint8_t *) i2c_master_buffer,
-                     I2C_BUFSIZE * sizeof(uint8_t));
-    i2c_write_length = 1;
-    i2c_read_length = rx_buff_length;
-    bool successful = false;
-    uint8_t readIndex = 3;
-    i2c_master_buffer[0] = (slave_addr << 1) & WRITE_ENABLE_BIT_MASK;
-    i2c_master_buffer[1] = reg_addr;
-    i2c_master_buffer[2] = ((slave_addr << 1) & WRITE_ENABLE_BIT_MASK)
-                           | READ_ENABLE_BIT_MASK;
-    successful = i2c_transaction(i2c_interface);
-
-    if (successful && (rx_buff != NULL) &&
-        (rx_buff_length < (I2C_BUFSIZE - readIndex))) {
-        memcpy(rx_buff, (const uint8_t *)(i2c_master_buffer + readIndex),
-               sizeof(uint8_t) * rx_buff_length);
-        return true;
-    }
-    else {
+    i2c_xfer_t xfer;
+
+    if ((rx_buff == NULL) || (rx_buff_length == 0)) {
         return false;
     }
+
+    xfer.slave_addr = slave_addr;
+    xfer.tx = &reg_addr;
+    xfer.tx_len = 1;
+    xfer.rx = rx_buff;
+    xfer.rx_len = rx_buff_length;
+
+    return i2c_xfer(i2c_interface, &xfer) == I2C_XFER_OK;
 }
 
 void i2c_clear_buffer(void *ptr, uint32_t size)
@@ -385,28 +593,25 @@ void i2c_clear_buffer(void *ptr, uint32_t size)
 bool i2c_write(uint8_t i2c_interface, uint8_t slave_addr, uint8_t reg_addr,
                uint8_t *tx_buff, uint8_t tx_buff_length)
 {
-    //puts("[i2c.c/i2cWrite]: entered\n");
-    i2c_clear_buffer((uint8_t *) i2c_master_buffer,
-                     I2C_BUFSIZE * sizeof(uint8_t));
-    i2c_write_length = tx_buff_length + 1;
-    i2c_master_buffer[0] = (slave_addr << 1) & WRITE_ENABLE_BIT_MASK;
-    i2c_master_buffer[1] = reg_addr;
-    int32_t i;
-    int32_t j = 0;
-
-    if ((tx_buff != NULL) && tx_buff_length < (I2C_BUFSIZE - 2)) {
-        for (i = 2; i < tx_buff_length + 2; i++) {
-            i2c_master_buffer[i] = tx_buff[j];
-            j++;
-            //printf("I2CMasterBuffer[%d] = %d\n", i, I2CMasterBuffer[i]);
-        }
+    uint8_t buf[I2C_BUFSIZE];
+    i2c_xfer_t xfer;
 
-        return i2c_transaction(i2c_interface);
-    }
-    else {
+    if ((tx_buff == NULL) || (tx_buff_length >= I2C_BUFSIZE)) {
         puts("[i2c.c/i2cWrite]: Invalid buffer or invalid write buffer size\n");
         return false;
     }
+
+    /* the register address and the data in one go */
+    buf[0] = reg_addr;
+    memcpy(&buf[1], tx_buff, tx_buff_length);
+
+    xfer.slave_addr = slave_addr;
+    xfer.tx = buf;
+    xfer.tx_len = tx_buff_length + 1;
+    xfer.rx = NULL;
+    xfer.rx_len = 0;
+
+    return i2c_xfer(i2c_interface, &xfer) == I2C_XFER_OK;
 }
 
 //burst mode, the first element in the array
@@ -414,48 +619,23 @@ bool i2c_trans_receive(uint8_t i2c_interface, uint8_t slave_addr,
                        uint8_t *tx_buff, uint8_t tx_buff_length,
                        uint8_t *rx_buff, uint8_t rx_buff_length)
 {
-    puts("[i2c.c/i2cTransReceive]: entered\n");
-    i2c_clear_buffer((uint8_t *) i2c_master_buffer,
-                     I2C_BUFSIZE * sizeof(uint8_t));
-    i2c_write_length = tx_buff_length;
-    i2c_read_length = rx_buff_length;
-    bool successful = false;
-    int32_t read_index = 0;
-    int32_t i = 0;
-
-    if (tx_buff != NULL && (tx_buff_length > 0)) {
-        i2c_master_buffer[0] = (slave_addr << 1) & WRITE_ENABLE_BIT_MASK;
-
-        for (i = 1; i < tx_buff_length + 1; i++) {
-            if (i < I2C_BUFSIZE) {
-                i2c_master_buffer[i] = tx_buff[i - 1];
-            }
-        }
-
-        //enable I2C to read
-        if ((rx_buff_length > 0) && (i < I2C_BUFSIZE)) {
-            i2c_master_buffer[i] = ((slave_addr << 1) & WRITE_ENABLE_BIT_MASK)
-                                   | READ_ENABLE_BIT_MASK;
-            read_index = i + 1;
-        }
-
-        successful = i2c_transaction(i2c_interface);
+    i2c_xfer_t xfer;
 
-        if (successful && (rx_buff != NULL) && (rx_buff_length > 0)) {
-            memcpy(rx_buff, (const uint8_t *)(i2c_master_buffer + read_index),
-                   sizeof(uint8_t) * rx_buff_length);
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-    else {
+    if ((tx_buff == NULL) || (tx_buff_length == 0) ||
+        ((rx_buff == NULL) && (rx_buff_length > 0))) {
         puts(
             "[i2c.c/i2cRead]: the txBuff is not valid or has not a valid \
             length value !\n");
         return false;
     }
+
+    xfer.slave_addr = slave_addr;
+    xfer.tx = tx_buff;
+    xfer.tx_len = tx_buff_length;
+    xfer.rx = rx_buff;
+    xfer.rx_len = rx_buff_length;
+
+    return i2c_xfer(i2c_interface, &xfer) == I2C_XFER_OK;
 }
 
 /**
@@ -468,6 +648,12 @@ void i2c_interface0_master_handler(void) //__irq
     //puts("entering I2C handler function\n");
     uint8_t state_value;
 
+    if (i2c_queue[0].head != NULL) {
+        i2c_queue_step(0);
+        VICVectAddr = 0; /* Acknowledge Interrupt */
+        return;
+    }
+
     /* this handler deals with master read and master write only */
     state_value = I20STAT;
 
@@ -610,6 +796,12 @@ void i2c_interface1_master_handler(void) //__irq
     //puts("entering I2C handler function\n");
     uint8_t state_value;
 
+    if (i2c_queue[1].head != NULL) {
+        i2c_queue_step(1);
+        VICVectAddr = 0; /* Acknowledge Interrupt */
+        return;
+    }
+
     /* this handler deals with master read and master write only */
     state_value = I21STAT;
 
@@ -753,6 +945,12 @@ void i2c_interface2_master_handler(void) //__irq
     //puts("entering I2C handler function\n");
     uint8_t state_value;
 
+    if (i2c_queue[2].head != NULL) {
+        i2c_queue_step(2);
+        VICVectAddr = 0; /* Acknowledge Interrupt */
+        return;
+    }
+
     /* this handler deals with master read and master write only */
     state_value = I22STAT;
 
@@ -29,5 +29,20 @@ extern uintptr_t __stack_start;     ///< end of user stack memory space
 void lpc2387_pclk_scale(uint32_t source, uint32_t target, uint32_t *pclksel, uint32_t *prescale);
 bool install_irq(int IntNumber, void (*HandlerAddr)(void), int Priority);
 
+/**
+ * @brief   Binds one interrupt source to the FIQ, at most one can be
+ *
+ * @param[in] IntNumber     The VIC channel, not SWI_INT which is used for
+ *                          the deferred part
+ * @param[in] Top           Runs in FIQ mode, even while IRQs are disabled,
+ *                          so it must not touch anything but its own data
+ *                          and the device
+ * @param[in] Deferred      Runs as an interrupt of the highest priority
+ *                          right after, may wake up threads
+ *
+ * @return  true on success
+ */
+bool install_fiq(int IntNumber, void (*Top)(void), void (*Deferred)(void));
+
 /** @} */
 #endif /* __CPU_H */
@@ -76,6 +76,33 @@
 #define I2C1_1                  2 // P0.19 SDA1, P0.20 SCL1
 #define I2C2                    3 // P0.10 SDA2, P0.11 SCL2
 
+/**
+ * @brief       Message type a thread gets when one of its transfers is
+ *              done, content.ptr points to the ::i2c_xfer_t.
+ */
+#define I2C_XFER_DONE           (0x4932)
+
+#define I2C_XFER_PENDING        (1)     ///< queued or on the bus
+#define I2C_XFER_OK             (0)     ///< done
+#define I2C_XFER_NACK           (-1)    ///< the slave did not acknowledge
+#define I2C_XFER_ERROR          (-2)    ///< bus error or arbitration lost
+
+/**
+ * @brief       One master transfer: *tx* is written, then, after a repeated
+ *              start, *rx* is read.  Owned by the caller until done.
+ */
+typedef struct i2c_xfer {
+    struct i2c_xfer *next;      ///< internal
+    uint8_t slave_addr;         ///< 7 bit address of the slave
+    const uint8_t *tx;          ///< written first, e.g. a register address
+    uint8_t tx_len;             ///< may be 0
+    uint8_t *rx;                ///< read last
+    uint8_t rx_len;             ///< may be 0
+    volatile int8_t result;     ///< I2C_XFER_PENDING until done
+    int pid;                    ///< gets I2C_XFER_DONE, -1 for no message
+    int waiter;                 ///< internal
+} i2c_xfer_t;
+
 
 /* Functions definitions */
 
@@ -103,6 +130,34 @@ bool i2c_initialize(uint8_t i2c_interface, uint32_t i2c_mode,
                     uint8_t slave_addr, uint32_t baud_rate, void *handler);
 
 
+/**
+ * @brief       Queues transfers and returns at once, the interrupt handler
+ *              runs them one after the other.  Transfers submitted together
+ *              follow each other on the bus without a gap, e.g. to sample
+ *              several sensors with one message for the last of them.
+ *              Needs the default interrupt handler of i2c_initialize().
+ *
+ * @param[in] i2c_interface     the i2c interface, several interfaces can be
+ *                              selected: i2c0, i2c1 and i2c2.
+ * @param[in] xfers             the transfers, with *slave_addr*, *tx*, *rx*
+ *                              and *pid* set.
+ * @param[in] count             the number of transfers.
+ *
+ * @return true if the transfers are queued, false for an unknown interface.
+ */
+bool i2c_submit(uint8_t i2c_interface, i2c_xfer_t *xfers, uint8_t count);
+
+/**
+ * @brief       Runs a transfer, the calling thread sleeps meanwhile.
+ *
+ * @param[in] i2c_interface     the i2c interface, several interfaces can be
+ *                              selected: i2c0, i2c1 and i2c2.
+ * @param[in] xfer              the transfer, *pid* is ignored.
+ *
+ * @return the result of the transfer.
+ */
+int i2c_xfer(uint8_t i2c_interface, i2c_xfer_t *xfer);
+
 /**
  * @brief       Read from an appropriate slave device over the I2C-Interface.
  *              The read values are stored in a buffer, which it is handed to
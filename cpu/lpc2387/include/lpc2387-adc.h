@@ -56,5 +56,46 @@ void adc_init_2(void);
  */
 uint16_t adc_read(uint8_t channel);
 
+/**
+ * @brief   Message type of a full block of adc_stream_start(),
+ *          content.ptr points to its first sample.
+ */
+#define ADC_STREAM_BLOCK    (0x4144)
+
+/**
+ * @brief   Samples a sequence of channels continuously, paced by TIMER3,
+ *          so it cannot run together with the profiler or benchmark_init().
+ *
+ * Each timer tick converts the next channel of the sequence, samples
+ * are stored in that order.  *buf* is used as a double buffer: as soon as
+ * one half is full, *pid* gets an ADC_STREAM_BLOCK message for it, and
+ * has to be done with it before the other half is full.  Blocks the
+ * thread could not take are counted by adc_stream_overruns().
+ * The pins of the channels have to be set up for the ADC.
+ *
+ * @param[in] channels  The channels, 0 to 7, in the order to sample them.
+ * @param[in] num       Number of channels in the sequence.
+ * @param[in] rate      Conversions per second, for all channels together,
+ *                      up to some 100000.
+ * @param[in] buf       Samples, 10 bit each.
+ * @param[in] len       Samples in *buf*, a multiple of 2 * *num*.
+ * @param[in] pid       The thread to get the blocks.
+ *
+ * @return  0 on success, -1 for invalid parameters.
+ */
+int adc_stream_start(const uint8_t *channels, uint8_t num, uint32_t rate,
+                     uint16_t *buf, uint16_t len, int pid);
+
+/**
+ * @brief   Stops adc_stream_start(), the half being filled is dropped.
+ */
+void adc_stream_stop(void);
+
+/**
+ * @brief   Blocks dropped since adc_stream_start() because the thread was
+ *          not ready to receive them.
+ */
+uint32_t adc_stream_overruns(void);
+
 /** @} */
 #endif /* LPC2387ADC_H_ */
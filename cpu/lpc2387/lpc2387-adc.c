@@ -26,6 +26,9 @@ See the file LICENSE in the top level directory for more details.
 #include "lpc2387.h"
 #include "lpc23xx.h"
 #include "lpc2387-adc.h"
+#include "cpu.h"
+#include "VIC.h"
+#include "msg.h"
 
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
@@ -143,3 +146,133 @@ uint16_t adc_read(uint8_t channel)
     DEBUG("%s, %d: %lu\n", __FILE__, __LINE__, t2);
     return (uint16_t) adc_data;				/* return A/D conversion value */
 }
+/*---------------------------------------------------------------------------*/
+#define STREAM_CHANNELS_MAX     (8)
+
+static uint8_t stream_channels[STREAM_CHANNELS_MAX];
+static uint8_t stream_num;
+static uint8_t stream_next;         /* index of the channel converting now */
+static uint8_t stream_running;      /* a conversion is started */
+static uint16_t *stream_buf;
+static uint16_t stream_len;
+static uint16_t stream_pos;
+static int stream_pid;
+static uint32_t stream_overruns;
+
+static void stream_irq(void) __attribute__((interrupt("IRQ")));
+
+/* hands a full half over to the thread */
+static void stream_deliver(uint16_t *block)
+{
+    msg_t m;
+
+    m.type = ADC_STREAM_BLOCK;
+    m.content.ptr = (char *) block;
+
+    if (msg_send_int(&m, stream_pid) != 1) {
+        stream_overruns++;
+    }
+}
+
+/*
+ * Every tick stores the conversion the tick before started, it is long
+ * done (11 ADC clocks), and starts the next one, one interrupt a sample.
+ */
+static void stream_irq(void)
+{
+    T3IR = BIT0;
+
+    if (stream_running) {
+        uint32_t regVal = AD0GDR;
+
+        stream_buf[stream_pos++] = (regVal >> 6) & 0x3FF;
+
+        if (stream_pos == stream_len / 2) {
+            stream_deliver(stream_buf);
+        }
+        else if (stream_pos == stream_len) {
+            stream_deliver(stream_buf + stream_len / 2);
+            stream_pos = 0;
+        }
+
+        if (++stream_next == stream_num) {
+            stream_next = 0;
+        }
+    }
+
+    /* switch channel, start A/D convert */
+    AD0CR = (AD0CR & 0xF8FFFF00) | (1 << 24) |
+            (1 << stream_channels[stream_next]);
+    stream_running = 1;
+
+    VICVectAddr = 0;                /* Acknowledge Interrupt */
+}
+
+int adc_stream_start(const uint8_t *channels, uint8_t num, uint32_t rate,
+                     uint16_t *buf, uint16_t len, int pid)
+{
+    uint32_t pclksel, prescale;
+
+    if ((num == 0) || (num > STREAM_CHANNELS_MAX) || (rate == 0) ||
+        (rate > 1000000) || (len == 0) || (len % (2 * num))) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < num; i++) {
+        if (channels[i] >= 8) {
+            return -1;
+        }
+
+        stream_channels[i] = channels[i];
+    }
+
+    adc_stream_stop();
+
+    stream_num = num;
+    stream_next = 0;
+    stream_running = 0;
+    stream_buf = buf;
+    stream_len = len;
+    stream_pos = 0;
+    stream_pid = pid;
+    stream_overruns = 0;
+
+    /* ADC_CLK = PCLK / 2 = 4.5 MHz at 72 MHz, software started */
+    PCONP |= BIT12;
+    PCLKSEL0 |= 0x03000000;         // pclock = cclock/8
+    AD0INTEN = 0;
+    AD0CR = (0x01 << 8) | (1 << 21);
+
+    /* TIMER3 ticks at 1 MHz and matches *rate* times a second */
+    lpc2387_pclk_scale(F_CPU, 1000000, &pclksel, &prescale);
+    PCONP |= PCTIM3;
+    PCLKSEL1 = (PCLKSEL1 & ~(BIT14 | BIT15)) | (pclksel << 14);
+    T3TCR = 2;                      /* disable and reset timer */
+    T3PR = prescale - 1;
+    T3MR0 = (1000000 / rate) - 1;
+    T3MCR = BIT0 | BIT1;            /* interrupt and reset on MR0 */
+    T3CCR = 0;
+    T3EMR = 0;
+    install_irq(TIMER3_INT, &stream_irq, IRQP_TIMER1);
+    T3TCR = 1;                      /* start */
+
+    return 0;
+}
+
+void adc_stream_stop(void)
+{
+    if (!(PCONP & PCTIM3)) {
+        return;
+    }
+
+    T3TCR = 2;                      /* disable and reset timer */
+    T3MCR = 0;
+    T3IR = 0x3F;
+    AD0CR &= 0xF8FFFFFF;            /* stop ADC now */
+    stream_running = 0;
+}
+
+uint32_t adc_stream_overruns(void)
+{
+    return stream_overruns;
+}
@@ -114,6 +114,106 @@ enum lpm_mode lpm_set(enum lpm_mode target)
     return last_lpm;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Timer 0 stops in sleep and power down, the RTC alarm wakes us up instead.
+ * The alarm has a resolution of one second, lpm_set_until() falls back to
+ * idle if no full second fits before the deadline.
+ */
+#define LPM_SLEEP_LATENCY       (2000)      /* us, oscillator and PLL */
+#define LPM_POWERDOWN_LATENCY   (2500)      /* us, plus flash */
+
+#define RTC_TICKS               (32768)
+#define SECONDS_PER_DAY         (24UL * 60 * 60)
+
+unsigned long lpm_wakeup_latency(enum lpm_mode mode)
+{
+    switch (mode) {
+        case LPM_ON:
+        case LPM_IDLE:
+            return 0;
+#ifdef MODULE_RTC
+        case LPM_SLEEP:
+            return (RTC_CCR & CCR_CLKEN) ? LPM_SLEEP_LATENCY : LPM_LATENCY_NEVER;
+
+        case LPM_POWERDOWN:
+            return (RTC_CCR & CCR_CLKEN) ? LPM_POWERDOWN_LATENCY : LPM_LATENCY_NEVER;
+#endif
+        default:
+            return LPM_LATENCY_NEVER;
+    }
+}
+
+#ifdef MODULE_RTC
+/* second of the day and 32 kHz tick of the RTC */
+static void rtc_now(uint32_t *sec, uint32_t *ticks)
+{
+    do {
+        *ticks = RTC_CTC >> 1;
+        *sec = (RTC_HOUR * 60 + RTC_MIN) * 60 + RTC_SEC;
+    }
+    while (*ticks != (RTC_CTC >> 1));
+}
+
+/* advances timer 0 by the time since *sec*, *ticks* */
+static void compensate(uint32_t sec, uint32_t ticks)
+{
+    uint32_t now_sec, now_ticks, us;
+
+    rtc_now(&now_sec, &now_ticks);
+
+    now_sec = (now_sec + SECONDS_PER_DAY - sec) % SECONDS_PER_DAY;
+    us = now_sec * 1000000UL - (ticks * 15625 >> 9) + (now_ticks * 15625 >> 9);
+    T0TC += us;
+
+    /* a match register the counter jumped over fires now */
+    if ((T0MCR & MR0I) && ((long)(T0MR0 - T0TC) <= 0)) {
+        T0MR0 = T0TC + 2;
+    }
+
+    DEBUG("# LPM slept %lu us\n", us);
+}
+#endif
+
+enum lpm_mode lpm_set_until(enum lpm_mode target, unsigned long deadline)
+{
+#ifdef MODULE_RTC
+    uint32_t sec, ticks, wake;
+    enum lpm_mode last_lpm;
+    long us;
+
+    if ((target >= LPM_SLEEP) && (target <= LPM_POWERDOWN) &&
+        (RTC_CCR & CCR_CLKEN)) {
+        rtc_now(&sec, &ticks);
+
+        /* the alarm fires at the start of a second */
+        us = (long)(deadline - T0TC) - (long) lpm_wakeup_latency(target) -
+             (long)((RTC_TICKS - ticks) * 15625 >> 9);
+
+        if (us >= 0) {
+            wake = (sec + 1 + us / 1000000) % SECONDS_PER_DAY;
+            RTC_ALSEC = wake % 60;
+            RTC_ALMIN = (wake / 60) % 60;
+            RTC_ALHOUR = wake / 3600;
+            RTC_AMR = ~(AMRSEC | AMRMIN | AMRHOUR) & 0xff;
+
+            last_lpm = lpm_set(target);
+
+            /* woken up by the alarm or another interrupt */
+            lpm_awake();
+            RTC_AMR = 0xff;
+            compensate(sec, ticks);
+            return last_lpm;
+        }
+    }
+#else
+    (void) deadline;
+#endif
+
+    /* timer 0 keeps running in idle */
+    (void) target;
+    return lpm_set(LPM_IDLE);
+}
+/*---------------------------------------------------------------------------*/
 enum lpm_mode
 lpm_get(void)
 {
@@ -48,8 +48,8 @@ It is 64 bytes and can be mapped (see documentation 1.4.2). */
                 /* see page 71 of "Insiders Guide to the Philips ARM7-Based Microcontrollers" by Trevor Martin  */
 /*                ldr     PC, [PC,#-0x0120]  	/* Interrupt Request Interrupt (load from VIC) */
                 ldr     PC, IRQ_Addr    	/* Interrupt Request Interrupt (load from VIC) */
-                ldr		r0, =__fiq_handler	/* Fast Interrupt Request Interrupt */
-                ldr		pc, [r0]			/* jump to handler in pointer at __fiq_handler */
+                ldr		r8, =__fiq_handler	/* Fast Interrupt Request Interrupt, r8 is banked */
+                ldr		pc, [r8]			/* jump to handler in pointer at __fiq_handler */
 
 /* Exception vector handlers branching table */
 Reset_Addr:     .word   Reset_Handler		/* defined in this module below  */
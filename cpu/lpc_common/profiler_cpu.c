@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup cpu
+ * @{
+ */
+
+/**
+ * @file
+ * @brief       Sampling timer of the profiler
+ *
+ * The hwtimer uses the match registers of TIMER0 only, TIMER1 is powered
+ * up and prescaled to HWTIMER_SPEED by hwtimer_arch_init() but otherwise
+ * unused.  Its MR0 resets the counter and interrupts every interval.
+ *
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifdef MODULE_PROFILER
+
+#include "cpu.h"
+#include "bitarithm.h"
+#include "hwtimer.h"
+#include "profiler.h"
+
+#if HWTIMER_MAXTIMERS > 4
+#error "the hwtimer uses TIMER1, the profiler needs it"
+#endif
+
+static void profiler_irq(void) __attribute__((interrupt("IRQ")));
+
+static void profiler_irq(void)
+{
+    /* lr_irq is the interrupted instruction plus 4, being off by one
+     * instruction does not matter for the buckets of the histogram */
+    profiler_sample((unsigned long) __builtin_return_address(0));
+
+    T1IR = BIT0;
+    VICVectAddr = 0;    /* acknowledge interrupt */
+}
+
+int profiler_arch_start(unsigned long interval_us)
+{
+    unsigned long ticks = HWTIMER_TICKS(interval_us);
+
+    if (ticks < 2) {
+        return -1;
+    }
+
+    T1MCR = 0;
+    PCONP |= PCTIM1;
+    install_irq(TIMER1_INT, &profiler_irq, 1);
+    T1TC = 0;
+    T1MR0 = ticks - 1;
+    T1IR = BIT0;
+    T1MCR = MR0I | MR0R;
+    VICIntEnable = 1 << TIMER1_INT;
+
+    return 0;
+}
+
+void profiler_arch_stop(void)
+{
+    T1MCR = 0;
+    T1IR = BIT0;
+}
+
+#endif /* MODULE_PROFILER */
+/** @} */
@@ -0,0 +1,78 @@
+/*
+ * asm_aes.c - AES engine on the mc1322x ASM module
+ * Copyright (C) 2013 Thomas Eichinger <thomas.eichinger@fu-berlin.de>
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 2.  See the file LICENSE for more details.
+ *
+ * This file is part of RIOT.
+ */
+
+#include <string.h>
+
+#include "asm.h"
+#include "crypto/aes.h"
+
+static uint8_t asm_on;
+
+/* byte 0 goes into the most significant byte of the first word */
+static void to_container(struct ASM_Container *c, const uint8_t *b)
+{
+    c->value_0 = ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | b[3];
+    c->value_1 = ((uint32_t) b[4] << 24) | ((uint32_t) b[5] << 16) | ((uint32_t) b[6] << 8) | b[7];
+    c->value_2 = ((uint32_t) b[8] << 24) | ((uint32_t) b[9] << 16) | ((uint32_t) b[10] << 8) | b[11];
+    c->value_3 = ((uint32_t) b[12] << 24) | ((uint32_t) b[13] << 16) | ((uint32_t) b[14] << 8) | b[15];
+}
+
+static void from_container(uint8_t *b, const struct ASM_Container *c)
+{
+    const uint32_t v[4] = { c->value_0, c->value_1, c->value_2, c->value_3 };
+    uint8_t i;
+
+    for (i = 0; i < 16; i++) {
+        b[i] = v[i / 4] >> (24 - 8 * (i % 4));
+    }
+}
+
+static int asm_set_key(aes_ctx_t *ctx, const uint8_t *key, uint8_t keysize)
+{
+    if (keysize != AES_KEY_SIZE) {
+        return -2;
+    }
+
+    if (!asm_on) {
+        asm_turn_on();
+        asm_on = 1;
+    }
+
+    /* the key is written for every block, keep it in the rounds space */
+    to_container((asm_keys_t *) ctx->key.rd_key, key);
+    ctx->key.rounds = 10;
+    return 0;
+}
+
+/**
+ * One block is the CTR encryption of zeros with the block as counter.
+ */
+static void asm_encrypt(const aes_ctx_t *ctx, const uint8_t *in, uint8_t *out)
+{
+    asm_data_t data = { 0, 0, 0, 0 };
+    asm_ctr_t ctr;
+
+    to_container(&ctr, in);
+    asm_ctr_encryption_blocking((asm_keys_t *) ctx->key.rd_key, &data, &ctr);
+    from_container(out, &data);
+}
+
+const aes_engine_t asm_aes_engine = {
+    asm_set_key,
+    asm_encrypt
+};
+
+crypto_provider_t asm_crypto_provider = {
+    "mc1322x",
+    CRYPTO_PROVIDER_HW | CRYPTO_PROVIDER_KEY_128,
+    30,
+    &asm_aes_engine,
+    NULL
+};
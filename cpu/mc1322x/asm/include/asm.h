@@ -13,6 +13,8 @@
 
 #include <stdint.h>
 
+#include "crypto/aes.h"
+
 #define ASM_BASE_ADDRESS 0x80008000
 
 struct ASM_struct {
@@ -101,4 +103,8 @@ void asm_ctr_cbc_mac_init(asm_keys_t *keys);
 void asm_ctr_cbc_mac_update(asm_data_t *data, asm_ctr_t *ctr);
 void asm_ctr_cbc_mac_finish(asm_data_t *data);
 
+/* AES engine and crypto provider, see crypto/aes.h */
+extern const aes_engine_t asm_aes_engine;
+extern crypto_provider_t asm_crypto_provider;
+
 #endif /* ASM_H */
@@ -27,6 +27,16 @@ enum lpm_mode lpm_set(enum lpm_mode target) {
     return LPM_ON;
 }
 
+unsigned long lpm_wakeup_latency(enum lpm_mode mode) {
+    return (mode <= LPM_IDLE) ? 0 : LPM_LATENCY_NEVER;
+}
+
+enum lpm_mode lpm_set_until(enum lpm_mode target, unsigned long deadline) {
+    (void) target;
+    (void) deadline;
+    return LPM_ON;
+}
+
 /******************************************************************************
 ** Function name:       install_irq
 **
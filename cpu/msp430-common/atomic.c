@@ -11,7 +11,7 @@
  * @{
  *
  * @file        atomic.c
- * @brief       atomic set and return function
+ * @brief       atomic operations, with interrupts masked
  *
  * @author      Kaspar Schleiser <kaspar@schleiser.de>
  * @author      Oliver Hahm <oliver.hahm@inria.fr>
@@ -24,9 +24,48 @@
 
 unsigned int atomic_set_return(unsigned int *val, unsigned int set)
 {
-    dINT();
+    unsigned int state = __disable_irq();
     unsigned int old_val = *val;
     *val = set;
-    eINT();
+    __restore_irq(state);
+    return old_val;
+}
+
+int atomic_cas(unsigned int *val, unsigned int old, unsigned int set)
+{
+    int res = 0;
+    unsigned int state = __disable_irq();
+    if (*val == old) {
+        *val = set;
+        res = 1;
+    }
+    __restore_irq(state);
+    return res;
+}
+
+unsigned int atomic_fetch_add(unsigned int *val, unsigned int inc)
+{
+    unsigned int state = __disable_irq();
+    unsigned int old_val = *val;
+    *val = old_val + inc;
+    __restore_irq(state);
+    return old_val;
+}
+
+unsigned int atomic_fetch_or(unsigned int *val, unsigned int mask)
+{
+    unsigned int state = __disable_irq();
+    unsigned int old_val = *val;
+    *val = old_val | mask;
+    __restore_irq(state);
+    return old_val;
+}
+
+unsigned int atomic_fetch_and(unsigned int *val, unsigned int mask)
+{
+    unsigned int state = __disable_irq();
+    unsigned int old_val = *val;
+    *val = old_val & mask;
+    __restore_irq(state);
     return old_val;
 }
@@ -24,10 +24,11 @@ void thread_yield()
 {
     __save_context();
 
+    /* reti of __restore_context() enables interrupts again, before that an
+     * interrupt would save its frame to the stack of the old thread */
     dINT();
     /* have active_thread point to the next thread */
     sched_run();
-    eINT();
 
     __restore_context();
 }
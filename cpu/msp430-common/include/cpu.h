@@ -101,10 +101,25 @@ inline void __exit_isr(void)
     __asm__("reti");
 }
 
+/*
+ * Frame of a voluntary thread_yield(), laid out like the one of an ISR so
+ * either path can resume the thread.  r12 to r15 are clobbered by any
+ * call, so their slots are only reserved, the values popped are garbage.
+ */
 inline void __save_context(void)
 {
     __asm__("push r2"); /* save SR */
-    __save_context_isr();
+    __asm__("sub #8, r1");
+    __asm__("push r11");
+    __asm__("push r10");
+    __asm__("push r9");
+    __asm__("push r8");
+    __asm__("push r7");
+    __asm__("push r6");
+    __asm__("push r5");
+    __asm__("push r4");
+
+    __asm__("mov.w r1,%0" : "=r"(active_thread->sp));
 }
 
 inline void __restore_context(void)
@@ -125,6 +140,31 @@ inline void dINT(void)
     dint();
 }
 
+/**
+ * @brief Disables interrupts, returns whether they were enabled before
+ *
+ * Critical sections nest with __restore_irq(), unlike dINT() and eINT().
+ */
+static inline unsigned int __disable_irq(void)
+{
+    unsigned int state;
+
+    /* dint takes effect after the next instruction */
+    __asm__ volatile("mov.w r2, %0\n\t"
+                     "dint\n\t"
+                     "nop" : "=r"(state) : : "memory");
+
+    return state & GIE;
+}
+
+/**
+ * @brief Enables interrupts again if __disable_irq() found them enabled
+ */
+static inline void __restore_irq(unsigned int state)
+{
+    __asm__ volatile("bis.w %0, r2" : : "r"(state & GIE) : "memory");
+}
+
 int inISR(void);
 
 void msp430_cpu_init(void);
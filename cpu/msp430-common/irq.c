@@ -24,15 +24,7 @@
 
 unsigned int disableIRQ()
 {
-    unsigned int state;
-    __asm__("mov.w r2,%0" : "=r"(state));
-    state &= GIE;
-
-    if (state) {
-        dINT();
-    }
-
-    return state;
+    return __disable_irq();
 }
 
 unsigned int enableIRQ()
@@ -50,7 +42,5 @@ unsigned int enableIRQ()
 
 void restoreIRQ(unsigned int state)
 {
-    if (state) {
-        eINT();
-    }
+    __restore_irq(state);
 }
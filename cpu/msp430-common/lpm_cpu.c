@@ -81,6 +81,51 @@ enum lpm_mode lpm_set(enum lpm_mode target)
     return last_mode;
 }
 
+/* Timer A runs on ACLK, which keeps running down to LPM3 */
+unsigned long lpm_wakeup_latency(enum lpm_mode mode)
+{
+    switch (mode) {
+        case LPM_ON:
+        case LPM_IDLE:
+            return 0;
+        case LPM_SLEEP:
+        case LPM_POWERDOWN:
+            // the DCO starts within 6 us, less than one ACLK tick
+            return 1;
+        default:
+            return LPM_LATENCY_NEVER;
+    }
+}
+
+enum lpm_mode lpm_set_until(enum lpm_mode target, unsigned long deadline)
+{
+    enum lpm_mode last_mode = lpm_get();
+
+    // the hwtimer keeps counting and wakes us up in time
+    (void) deadline;
+
+    // enable interrupts in the same instruction that stops the CPU, an
+    // interrupt in between would not wake us up
+    switch (target)
+    {
+    case LPM_SLEEP:
+        __bic_status_register(OSCOFF | SCG1);
+        __bis_status_register(GIE | CPUOFF | SCG0);
+        break;
+    case LPM_POWERDOWN:
+        __bic_status_register(OSCOFF);
+        __bis_status_register(GIE | CPUOFF | SCG0 | SCG1);
+        break;
+    default:
+        __bis_status_register(GIE);
+        lpm_set(target);
+        break;
+    }
+
+    __bic_status_register(GIE);
+    return last_mode;
+}
+
 #define LPM_MASK_SR   (CPUOFF | OSCOFF | SCG0 | SCG1)
 
 /* Return the current LPM mode of the MSP430 MCU. */
@@ -0,0 +1,248 @@
+/**
+ * Multiplexed asynchronous I/O for the native port
+ *
+ * A host thread waits for all registered file descriptors with epoll (or
+ * select where epoll is unavailable) and signals the RIOT process with a
+ * single SIGIO per batch of ready descriptors. The SIGIO handler services
+ * every ready descriptor and then re-arms the host thread, so a burst of
+ * events costs one emulated interrupt instead of one per event.
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup native_cpu
+ * @{
+ * @file
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <sys/select.h>
+#endif
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#include "cpu.h"
+#include "native_internal.h"
+
+static int _async_fds[NATIVE_ASYNC_READ_NUMOF];
+static void (*_async_handlers[NATIVE_ASYNC_READ_NUMOF])(void);
+static volatile sig_atomic_t _async_ready[NATIVE_ASYNC_READ_NUMOF];
+static volatile int _async_numof;
+static int _async_started;
+
+/* the I/O thread blocks on this pipe until a batch has been serviced */
+static int _async_rearm_pipe[2];
+static pthread_t _async_thread;
+#ifdef __linux__
+static int _async_epfd;
+#endif
+
+extern ssize_t (*real_read)(int fd, void *buf, size_t count);
+extern ssize_t (*real_write)(int fd, const void *buf, size_t count);
+
+/* the host's, declared here since <pthread.h> may be RIOT's pthread.h;
+ * <signal.h> declares pthread_sigmask() and the types */
+extern int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                          void *(*start_routine)(void *), void *arg);
+
+static int _async_wait(void)
+{
+    int n = 0;
+
+#ifdef __linux__
+    struct epoll_event ev[NATIVE_ASYNC_READ_NUMOF];
+    int nev = epoll_wait(_async_epfd, ev, NATIVE_ASYNC_READ_NUMOF, -1);
+
+    for (int i = 0; i < nev; i++) {
+        _async_ready[ev[i].data.u32] = 1;
+        n++;
+    }
+#else
+    fd_set rfds;
+    int nfds = 0;
+
+    FD_ZERO(&rfds);
+    for (int i = 0; i < _async_numof; i++) {
+        FD_SET(_async_fds[i], &rfds);
+        if (_async_fds[i] >= nfds) {
+            nfds = _async_fds[i] + 1;
+        }
+    }
+
+    if (select(nfds, &rfds, NULL, NULL, NULL) == -1) {
+        return -1;
+    }
+
+    for (int i = 0; i < _async_numof; i++) {
+        if (FD_ISSET(_async_fds[i], &rfds)) {
+            _async_ready[i] = 1;
+            n++;
+        }
+    }
+#endif
+
+    return (n > 0) ? n : -1;
+}
+
+static void *_async_io_thread(void *arg)
+{
+    (void) arg;
+    char c;
+
+    while (1) {
+        if (_async_wait() == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err(EXIT_FAILURE, "_async_io_thread: wait");
+        }
+
+        /* one interrupt for everything that is ready */
+        kill(getpid(), SIGIO);
+
+        if (real_read(_async_rearm_pipe[0], &c, 1) != 1) {
+            err(EXIT_FAILURE, "_async_io_thread: read");
+        }
+    }
+
+    return NULL;
+}
+
+static void _async_read_isr(void)
+{
+    char c = 0;
+
+    DEBUG("_async_read_isr\n");
+
+    for (int i = 0; i < _async_numof; i++) {
+        if (_async_ready[i]) {
+            _async_ready[i] = 0;
+            _async_handlers[i]();
+        }
+    }
+
+    if (real_write(_async_rearm_pipe[1], &c, 1) != 1) {
+        err(EXIT_FAILURE, "_async_read_isr: write");
+    }
+}
+
+static void _async_thread_start(void)
+{
+    sigset_t all, old;
+
+    /* the I/O thread must never handle RIOT's signals */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    if (pthread_create(&_async_thread, NULL, _async_io_thread, NULL) != 0) {
+        errx(EXIT_FAILURE, "_async_read_start: pthread_create");
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+static void _async_read_start(void)
+{
+    if (pipe(_async_rearm_pipe) == -1) {
+        err(EXIT_FAILURE, "_async_read_start: pipe");
+    }
+
+    register_interrupt(SIGIO, _async_read_isr);
+    _async_thread_start();
+}
+
+#ifdef __linux__
+static void _async_watch(int i)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+
+    if (epoll_ctl(_async_epfd, EPOLL_CTL_ADD, _async_fds[i], &ev) == -1) {
+        err(EXIT_FAILURE, "native_async_read_add_handler: epoll_ctl");
+    }
+}
+#endif
+
+int native_async_read_add_handler(int fd, void (*handler)(void))
+{
+    int i;
+
+    if (_async_numof == NATIVE_ASYNC_READ_NUMOF) {
+        warnx("native_async_read_add_handler: too many descriptors");
+        return -1;
+    }
+
+#ifdef __linux__
+    if (!_async_started &&
+        ((_async_epfd = epoll_create(NATIVE_ASYNC_READ_NUMOF)) == -1)) {
+        err(EXIT_FAILURE, "native_async_read_add_handler: epoll_create");
+    }
+#endif
+
+    i = _async_numof;
+    _async_fds[i] = fd;
+    _async_handlers[i] = handler;
+
+#ifdef __linux__
+    _async_watch(i);
+#endif
+
+    _async_numof++;
+
+    /* start the I/O thread once the first descriptor is known, later
+     * ones are picked up by the select loop on its next round */
+    if (!_async_started) {
+        _async_started = 1;
+        _async_read_start();
+    }
+
+    return 0;
+}
+
+void _native_async_read_after_fork(void)
+{
+    if (!_async_started) {
+        return;
+    }
+
+    _native_renew_pipe(_async_rearm_pipe);
+
+#ifdef __linux__
+    /* the interest list belongs to the epoll instance, which is shared */
+    int epfd;
+
+    if (((epfd = epoll_create(NATIVE_ASYNC_READ_NUMOF)) == -1) ||
+        (dup2(epfd, _async_epfd) == -1)) {
+        err(EXIT_FAILURE, "_native_async_read_after_fork: epoll_create");
+    }
+
+    close(epfd);
+
+    for (int i = 0; i < _async_numof; i++) {
+        _async_watch(i);
+    }
+#endif
+
+    for (int i = 0; i < _async_numof; i++) {
+        _async_ready[i] = 0;
+    }
+
+    _async_thread_start();
+}
+/** @} */
@@ -15,22 +15,37 @@
  */
 
 #include "atomic.h"
-#include "irq.h"
 #include "debug.h"
 
+/*
+ * Interrupts are signals delivered to the same process, the builtins are
+ * atomic against them without masking them.
+ */
+
 unsigned int atomic_set_return(unsigned int *val, unsigned int set)
 {
-    unsigned int old_val;
-    unsigned int old_state;
-
     DEBUG("atomic_set_return\n");
 
-    old_state = disableIRQ();
+    return __atomic_exchange_n(val, set, __ATOMIC_SEQ_CST);
+}
+
+int atomic_cas(unsigned int *val, unsigned int old, unsigned int set)
+{
+    return __atomic_compare_exchange_n(val, &old, set, 0, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_SEQ_CST);
+}
 
-    old_val = *val;
-    *val = set;
+unsigned int atomic_fetch_add(unsigned int *val, unsigned int inc)
+{
+    return __atomic_fetch_add(val, inc, __ATOMIC_SEQ_CST);
+}
 
-    restoreIRQ(old_state);
+unsigned int atomic_fetch_or(unsigned int *val, unsigned int mask)
+{
+    return __atomic_fetch_or(val, mask, __ATOMIC_SEQ_CST);
+}
 
-    return old_val;
+unsigned int atomic_fetch_and(unsigned int *val, unsigned int mask)
+{
+    return __atomic_fetch_and(val, mask, __ATOMIC_SEQ_CST);
 }
@@ -0,0 +1,249 @@
+/**
+ * Host I/O thread for the native port
+ *
+ * With NATIVE_HOST_IO, _native_read() and _native_write() called by a
+ * RIOT thread do not block the emulated CPU anymore.  The request is
+ * queued for a host thread and the calling thread sleeps, the others keep
+ * running.  Once the host thread is done it makes the completion pipe
+ * readable, the SIGIO interrupt of async_read.c wakes up the caller.
+ *
+ * Calls from interrupt context, with interrupts disabled, from the idle
+ * thread or before the kernel runs are done right away as before.
+ * Requests are done in the order they were queued.
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup native_cpu
+ * @{
+ * @file
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#include "cpu.h"
+#include "irq.h"
+#include "sched.h"
+#include "thread.h"
+#include "native_internal.h"
+
+extern volatile tcb_t *active_thread;
+
+typedef struct host_io_req {
+    struct host_io_req *next;
+    int is_write;
+    int fd;
+    void *buf;
+    size_t count;
+    ssize_t result;
+    int error;
+    volatile int done;
+    int pid;
+} host_io_req_t;
+
+/* both lists are shared with the host thread */
+static pthread_mutex_t host_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_io_cond = PTHREAD_COND_INITIALIZER;
+static host_io_req_t *pending_head, *pending_tail;
+static host_io_req_t *completed;
+/* taken by the host thread */
+static host_io_req_t *current;
+
+static int host_io_pipe[2];
+static pthread_t host_io_thread;
+static int host_io_started;
+
+static void *_host_io_thread(void *arg)
+{
+    (void) arg;
+    host_io_req_t *req;
+    char c = 0;
+
+    while (1) {
+        pthread_mutex_lock(&host_io_lock);
+
+        while (pending_head == NULL) {
+            pthread_cond_wait(&host_io_cond, &host_io_lock);
+        }
+
+        req = pending_head;
+
+        if ((pending_head = req->next) == NULL) {
+            pending_tail = NULL;
+        }
+
+        current = req;
+        pthread_mutex_unlock(&host_io_lock);
+
+        if (req->is_write) {
+            req->result = real_write(req->fd, req->buf, req->count);
+        }
+        else {
+            req->result = real_read(req->fd, req->buf, req->count);
+        }
+
+        req->error = errno;
+
+        pthread_mutex_lock(&host_io_lock);
+        current = NULL;
+        req->next = completed;
+        completed = req;
+        pthread_mutex_unlock(&host_io_lock);
+
+        /* a full pipe is readable already */
+        if ((real_write(host_io_pipe[1], &c, 1) == -1) && (errno != EAGAIN)) {
+            err(EXIT_FAILURE, "_host_io_thread: write");
+        }
+    }
+
+    return NULL;
+}
+
+static void _host_io_isr(void)
+{
+    host_io_req_t *req, *next;
+    char buf[16];
+
+    while (real_read(host_io_pipe[0], buf, sizeof(buf)) > 0);
+
+    pthread_mutex_lock(&host_io_lock);
+    req = completed;
+    completed = NULL;
+    pthread_mutex_unlock(&host_io_lock);
+
+    for (; req; req = next) {
+        next = req->next;
+        DEBUG("_host_io_isr: %d done\n", req->pid);
+        req->done = 1;
+        thread_wakeup(req->pid);
+    }
+}
+
+static void _host_io_thread_start(void)
+{
+    sigset_t all, old;
+
+    /* the host thread must never handle RIOT's signals */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    if (pthread_create(&host_io_thread, NULL, _host_io_thread, NULL) != 0) {
+        errx(EXIT_FAILURE, "_native_host_io_init: pthread_create");
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void _native_host_io_init(void)
+{
+    if (pipe(host_io_pipe) == -1) {
+        err(EXIT_FAILURE, "_native_host_io_init: pipe");
+    }
+
+    if ((fcntl(host_io_pipe[0], F_SETFL, O_NONBLOCK) == -1) ||
+        (fcntl(host_io_pipe[1], F_SETFL, O_NONBLOCK) == -1)) {
+        err(EXIT_FAILURE, "_native_host_io_init: fcntl");
+    }
+
+    _host_io_thread_start();
+
+    native_async_read_add_handler(host_io_pipe[0], _host_io_isr);
+    host_io_started = 1;
+}
+
+void _native_host_io_after_fork(void)
+{
+    host_io_req_t *req, *next;
+
+    if (!host_io_started) {
+        return;
+    }
+
+    /* the lock may have been held by the parent's host thread */
+    pthread_mutex_init(&host_io_lock, NULL);
+    pthread_cond_init(&host_io_cond, NULL);
+    _native_renew_pipe(host_io_pipe);
+
+    /* requests not completed before fork() are lost with that thread */
+    if (current != NULL) {
+        current->next = pending_head;
+        pending_head = current;
+        current = NULL;
+    }
+
+    for (req = pending_head; req; req = next) {
+        next = req->next;
+        req->result = -1;
+        req->error = EIO;
+        req->done = 1;
+        thread_wakeup(req->pid);
+    }
+
+    pending_head = pending_tail = NULL;
+
+    _host_io_thread_start();
+}
+
+int _native_host_io(int is_write, int fd, void *buf, size_t count,
+                    ssize_t *result)
+{
+    host_io_req_t req;
+
+    if (!host_io_started || _native_in_isr || _native_in_syscall ||
+        !native_interrupts_enabled || (active_thread == NULL) ||
+        (active_thread->priority == PRIORITY_IDLE)) {
+        return 0;
+    }
+
+    req.next = NULL;
+    req.is_write = is_write;
+    req.fd = fd;
+    req.buf = buf;
+    req.count = count;
+    req.done = 0;
+    req.pid = active_thread->pid;
+
+    dINT();
+
+    pthread_mutex_lock(&host_io_lock);
+
+    if (pending_tail) {
+        pending_tail->next = &req;
+    }
+    else {
+        pending_head = &req;
+    }
+
+    pending_tail = &req;
+    pthread_cond_signal(&host_io_cond);
+    pthread_mutex_unlock(&host_io_lock);
+
+    /* the completion can not be handled before we sleep */
+    while (!req.done) {
+        sched_set_status((tcb_t *) active_thread, STATUS_SLEEPING);
+        eINT();
+        thread_yield();
+        dINT();
+    }
+
+    eINT();
+
+    *result = req.result;
+    errno = req.error;
+    return 1;
+}
+
+/** @} */
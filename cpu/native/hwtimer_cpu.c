@@ -1,9 +1,11 @@
 /**
  * Native CPU hwtimer_arch.h implementation
  *
- * Uses POSIX realtime clock and POSIX itimer to mimic hardware.
- * Since there is only 1 itmer per process and RIOT needs several
- * hardware timers, hwtimers are being multiplexed onto the itimer.
+ * Uses the POSIX monotonic clock to mimic hardware.  The hwtimers are
+ * multiplexed onto one host timer armed for the earliest deadline.  On
+ * Linux that is a timerfd with an absolute deadline, serviced by the
+ * asynchronous I/O thread like any other descriptor, elsewhere the
+ * itimer and SIGALRM.  Every interrupt fires all timers due by then.
  *
  * XXX: does not scale well with number of timers (overhead: O(N)).
  *
@@ -33,6 +35,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <err.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#endif
 
 #include "hwtimer.h"
 #include "hwtimer_arch.h"
@@ -49,13 +56,21 @@
 #define HWTIMERMINOFFSET (1000UL) // 1ms
 
 static unsigned long native_hwtimer_now;
+/* host clock in ns at native_hwtimer_now */
+static uint64_t native_hwtimer_now_ns;
 static unsigned long time_null;
 
-static struct itimerval native_hwtimer[HWTIMER_MAXTIMERS];
+/* absolute, in ticks */
+static unsigned long native_hwtimer_deadline[HWTIMER_MAXTIMERS];
 static int native_hwtimer_isset[HWTIMER_MAXTIMERS];
 
 static int next_timer = -1;
 static void (*int_handler)(int);
+static int native_hwtimer_irq_enabled;
+
+#ifdef __linux__
+static int native_hwtimer_fd = -1;
+#endif
 
 
 /**
@@ -119,94 +134,215 @@ unsigned long ts2ticks(struct timespec *tp)
     return((tp->tv_sec * HWTIMER_SPEED) + (tp->tv_nsec / 1000));
 }
 
+/* deadline a - deadline b, both within half the tick range of now */
+static long deadline_diff(unsigned long a, unsigned long b)
+{
+    return (long)(a - b);
+}
+
 /**
- * set next_timer to the next lowest enabled timer index
+ * arm the host timer for the absolute deadline in ticks
  */
-void schedule_timer(void)
+static void arm_host_timer(unsigned long deadline)
 {
-    /* try to find *an active* timer */
-    next_timer = -1;
-    for (int i = 0; i < HWTIMER_MAXTIMERS; i++) {
-        if (native_hwtimer_isset[i] == 1) {
-            next_timer = i;
-            break;
-        }
-    }
-    if (next_timer == -1) {
-        DEBUG("schedule_timer(): no valid timer found - nothing to schedule\n");
-        // TODO: unset timer
-        return;
-    }
+    long delta = deadline_diff(deadline, native_hwtimer_now);
 
-    /* find the next pending timer (next_timer now points to *a* valid pending timer) */
-    for (int i = 0; i < HWTIMER_MAXTIMERS; i++) {
-        if (
-            (native_hwtimer_isset[i] == 1) &&
-            (tv2ticks(&(native_hwtimer[i].it_value)) < tv2ticks(&(native_hwtimer[next_timer].it_value)))
-        ) {
-            /* timer in slot i is active and the timeout is more recent than next_timer */
-            next_timer = i;
-        }
+#ifdef __linux__
+    struct itimerspec its;
+    uint64_t due = native_hwtimer_now_ns;
+
+    memset(&its, 0, sizeof(its));
+
+    /* a deadline in the past fires at once */
+    if (delta > 0) {
+        due += (uint64_t) delta * (1000000000 / HWTIMER_SPEED);
     }
 
-    /* next pending timer is in slot next_timer */
-    struct timeval now;
-    hwtimer_arch_now(); // update timer
-    ticks2tv(native_hwtimer_now, &now);
+    its.it_value.tv_sec = due / 1000000000;
+    its.it_value.tv_nsec = due % 1000000000;
 
+    _native_syscall_enter();
+    if (timerfd_settime(native_hwtimer_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        err(EXIT_FAILURE, "schedule_timer: timerfd_settime");
+    }
+    _native_syscall_leave();
+#else
     struct itimerval result;
     memset(&result, 0, sizeof(result));
 
-    int retval = timeval_subtract(&result.it_value, &native_hwtimer[next_timer].it_value, &now);
-    if (retval || (tv2ticks(&result.it_value) < HWTIMERMINOFFSET)) {
-        DEBUG("\033[31mschedule_timer(): timer is already due (%i), mitigating.\033[0m\n", next_timer);
-        result.it_value.tv_sec = 0;
-        result.it_value.tv_usec = 1;
+    if (delta < (long) HWTIMERMINOFFSET) {
+        DEBUG("\033[31mschedule_timer(): timer is already due, mitigating.\033[0m\n");
+        delta = 1;
     }
 
+    ticks2tv(delta, &result.it_value);
+
     _native_syscall_enter();
     if (setitimer(ITIMER_REAL, &result, NULL) == -1) {
         err(EXIT_FAILURE, "schedule_timer: setitimer");
     }
-    else {
-        DEBUG("schedule_timer(): set next timer (%i).\n", next_timer);
-    }
     _native_syscall_leave();
+#endif
+}
+
+static void disarm_host_timer(void)
+{
+#ifdef __linux__
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    _native_syscall_enter();
+    timerfd_settime(native_hwtimer_fd, 0, &its, NULL);
+    _native_syscall_leave();
+#else
+    struct itimerval result;
+    memset(&result, 0, sizeof(result));
+
+    _native_syscall_enter();
+    setitimer(ITIMER_REAL, &result, NULL);
+    _native_syscall_leave();
+#endif
+}
+
+/**
+ * set next_timer to the enabled timer with the earliest deadline and arm
+ * the host timer for it
+ */
+void schedule_timer(void)
+{
+    next_timer = -1;
+
+    for (int i = 0; i < HWTIMER_MAXTIMERS; i++) {
+        if (native_hwtimer_isset[i] &&
+            ((next_timer == -1) ||
+             (deadline_diff(native_hwtimer_deadline[i],
+                            native_hwtimer_deadline[next_timer]) < 0))) {
+            next_timer = i;
+        }
+    }
+
+#ifdef NATIVE_VIRTUAL_TIME
+    /* the idle loop advances time to the deadline, see vtime.c */
+    return;
+#endif
+
+    if (next_timer == -1) {
+        DEBUG("schedule_timer(): no valid timer found - nothing to schedule\n");
+        disarm_host_timer();
+        return;
+    }
+
+    hwtimer_arch_now(); /* update native_hwtimer_now */
+    arm_host_timer(native_hwtimer_deadline[next_timer]);
+    DEBUG("schedule_timer(): set next timer (%i).\n", next_timer);
 }
 
+#ifdef NATIVE_VIRTUAL_TIME
+int _native_hwtimer_next(unsigned long *deadline)
+{
+    if ((next_timer == -1) || (native_hwtimer_isset[next_timer] != 1)) {
+        return 0;
+    }
+
+    *deadline = native_hwtimer_deadline[next_timer];
+    return 1;
+}
+#endif
+
 /**
- * native timer signal handler
+ * native timer interrupt handler
  *
- * set new system timer, call timer interrupt handler
+ * call the timer interrupt handler for every timer due by now, earliest
+ * first, then set the new system timer
  */
 void hwtimer_isr_timer()
 {
     DEBUG("hwtimer_isr_timer()\n");
 
-    if (next_timer == -1) {
-        DEBUG("hwtimer_isr_timer(): next_timer is invalid\n");
+    hwtimer_arch_now();
+
+    while (1) {
+        int due = -1;
+
+        for (int i = 0; i < HWTIMER_MAXTIMERS; i++) {
+            if (native_hwtimer_isset[i] &&
+                (deadline_diff(native_hwtimer_deadline[i], native_hwtimer_now) <= 0) &&
+                ((due == -1) ||
+                 (deadline_diff(native_hwtimer_deadline[i],
+                                native_hwtimer_deadline[due]) < 0))) {
+                due = i;
+            }
+        }
+
+        if (due == -1) {
+            break;
+        }
+
+        native_hwtimer_isset[due] = 0;
+        DEBUG("hwtimer_isr_timer(): calling hwtimer.int_handler(%i)\n", due);
+        int_handler(due);
+    }
+
+    schedule_timer();
+}
+
+#ifdef __linux__
+static void hwtimer_fd_isr(void)
+{
+    uint64_t expirations;
+
+    /* non-blocking, nothing to read if the timer was set again since */
+    if (real_read(native_hwtimer_fd, &expirations, sizeof(expirations)) == -1) {
         return;
     }
 
-    if (native_hwtimer_isset[next_timer] == 1) {
-        native_hwtimer_isset[next_timer] = 0;
-        DEBUG("hwtimer_isr_timer(): calling hwtimer.int_handler(%i)\n", next_timer);
-        int_handler(next_timer);
+    if (native_hwtimer_irq_enabled) {
+        hwtimer_isr_timer();
     }
-    else {
-        DEBUG("hwtimer_isr_timer(): this should not have happened\n");
+}
+
+static int hwtimer_fd_open(void)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (fd == -1) {
+        err(EXIT_FAILURE, "hwtimer_arch_init: timerfd_create");
+    }
+
+    return fd;
+}
+
+void _native_hwtimer_after_fork(void)
+{
+    /* the timerfd is shared with the parent, replace it in place */
+    int fd = hwtimer_fd_open();
+
+    if (dup2(fd, native_hwtimer_fd) == -1) {
+        err(EXIT_FAILURE, "_native_hwtimer_after_fork: dup2");
     }
 
+    close(fd);
+    fcntl(native_hwtimer_fd, F_SETFD, FD_CLOEXEC);
+    schedule_timer();
+}
+#else
+void _native_hwtimer_after_fork(void)
+{
     schedule_timer();
 }
+#endif
 
 void hwtimer_arch_enable_interrupt(void)
 {
     DEBUG("hwtimer_arch_enable_interrupt()\n");
 
+#ifdef __linux__
+    native_hwtimer_irq_enabled = 1;
+#else
     if (register_interrupt(SIGALRM, hwtimer_isr_timer) != 0) {
         DEBUG("darn!\n\n");
     }
+#endif
 
     return;
 }
@@ -215,9 +351,13 @@ void hwtimer_arch_disable_interrupt(void)
 {
     DEBUG("hwtimer_arch_disable_interrupt()\n");
 
+#ifdef __linux__
+    native_hwtimer_irq_enabled = 0;
+#else
     if (unregister_interrupt(SIGALRM) != 0) {
         DEBUG("darn!\n\n");
     }
+#endif
 
     return;
 }
@@ -247,12 +387,7 @@ void hwtimer_arch_set_absolute(unsigned long value, short timer)
 {
     DEBUG("hwtimer_arch_set_absolute(%lu, %i)\n", value, timer);
 
-    ticks2tv(value, &(native_hwtimer[timer].it_value));
-
-    DEBUG("hwtimer_arch_set_absolute(): that is at %lu s %lu us\n",
-          (unsigned long)native_hwtimer[timer].it_value.tv_sec,
-          (unsigned long)native_hwtimer[timer].it_value.tv_usec);
-
+    native_hwtimer_deadline[timer] = value;
     native_hwtimer_isset[timer] = 1;
     schedule_timer();
 
@@ -265,6 +400,12 @@ unsigned long hwtimer_arch_now(void)
 
     DEBUG("hwtimer_arch_now()\n");
 
+#ifdef NATIVE_VIRTUAL_TIME
+    (void) t;
+    native_hwtimer_now = _native_vtime_ticks() - time_null;
+    return native_hwtimer_now;
+#endif
+
     _native_syscall_enter();
 #ifdef __MACH__
     clock_serv_t cclock;
@@ -284,11 +425,8 @@ unsigned long hwtimer_arch_now(void)
     _native_syscall_leave();
 
     native_hwtimer_now = ts2ticks(&t) - time_null;
+    native_hwtimer_now_ns = (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
 
-    struct timeval tv;
-    ticks2tv(native_hwtimer_now, &tv);
-    DEBUG("hwtimer_arch_now(): it is now %lu s %lu us\n",
-            (unsigned long)tv.tv_sec, (unsigned long)tv.tv_usec);
     DEBUG("hwtimer_arch_now(): returning %lu\n", native_hwtimer_now);
     return native_hwtimer_now;
 }
@@ -317,10 +455,15 @@ void hwtimer_arch_init(void (*handler)(int), uint32_t fcpu)
 
     for (int i = 0; i < HWTIMER_MAXTIMERS; i++) {
         native_hwtimer_isset[i] = 0;
-        native_hwtimer[i].it_interval.tv_sec = 0;
-        native_hwtimer[i].it_interval.tv_usec = 0;
     }
 
+#ifdef __linux__
+    if (native_hwtimer_fd == -1) {
+        native_hwtimer_fd = hwtimer_fd_open();
+        native_async_read_add_handler(native_hwtimer_fd, hwtimer_fd_isr);
+    }
+#endif
+
     hwtimer_arch_enable_interrupt();
     return;
 }
@@ -56,5 +56,7 @@
 
 /* for nativenet */
 #define NATIVE_ETH_PROTO 0x1234
+/* virtual time requests and grants, see vtime.c */
+#define NATIVE_VTIME_PROTO 0x1235
 
 #endif /* CPUCONF_H_ */
@@ -14,6 +14,14 @@
 
 #include <signal.h>
 
+#ifdef NATIVE_FAST_SWITCH
+/* the signal mask is the same in every context only with deferred
+ * interrupts, the switch does not restore it */
+#ifndef NATIVE_DEFERRED_IRQ
+#define NATIVE_DEFERRED_IRQ
+#endif
+#endif
+
 /**
  * internal functions
  */
@@ -48,10 +56,14 @@ extern volatile int _native_in_isr;
 extern volatile int _native_in_syscall;
 
 extern char __isr_stack[SIGSTKSZ];
+#ifdef NATIVE_FAST_SWITCH
+extern void **_native_cur_ctx, *_native_isr_ctx;
+#else
 extern char __end_stack[SIGSTKSZ];
 extern ucontext_t native_isr_context;
 extern ucontext_t end_context;
 extern ucontext_t *_native_cur_ctx, *_native_isr_ctx;
+#endif
 
 extern const char *_progname;
 extern char **_native_argv;
@@ -64,6 +76,31 @@ extern fd_set _native_rfds;
 ssize_t _native_read(int fd, void *buf, size_t count);
 ssize_t _native_write(int fd, const void *buf, size_t count);
 
+#ifdef NATIVE_FAST_SWITCH
+/**
+ * Context switch without ucontext, see tramp.S
+ *
+ * A context is the stack pointer below the callee-saved registers and the
+ * FPU control words pushed onto its stack.  Neither function touches the
+ * signal mask, so a switch costs no system call.
+ */
+
+/** saves the running context to *save and continues with load */
+void _native_ctx_swap(void **save, void *load);
+
+/** continues with the context load, the running one is lost */
+void _native_ctx_load(void *load) __attribute__((noreturn));
+
+/**
+ * prepares a context on the stack ending at top which calls func and then
+ * exit_func, returns it
+ *
+ * exit_func may be NULL for functions that never return
+ */
+void *_native_ctx_make(char *top, void (*func)(void),
+                       void (*exit_func)(void));
+#endif
+
 /**
  * register interrupt handler handler for interrupt sig
  */
@@ -74,6 +111,109 @@ int register_interrupt(int sig, void (*handler)(void));
  */
 int unregister_interrupt(int sig);
 
+/**
+ * maximum number of file descriptors watched for asynchronous input
+ */
+#ifndef NATIVE_ASYNC_READ_NUMOF
+#define NATIVE_ASYNC_READ_NUMOF 6
+#endif
+
+/**
+ * call handler (in interrupt context) whenever fd becomes readable
+ *
+ * All descriptors that are ready at the same time are serviced in a
+ * single SIGIO interrupt. The handler must not block; fd should be in
+ * non-blocking mode.
+ */
+int native_async_read_add_handler(int fd, void (*handler)(void));
+
+/**
+ * Fork server, see startup.c
+ */
+
+/**
+ * instances started by -n, forked by _native_fork_nodes() once the
+ * radio starts
+ */
+extern int _native_nodes;
+
+/**
+ * forks _native_nodes - 1 copies of the running instance; the copies get
+ * host threads, pipes and the timer of their own, everything in RIOT's
+ * memory is shared copy on write
+ */
+void _native_fork_nodes(void);
+
+/**
+ * replaces a pipe shared with the parent by a new one under the same
+ * descriptors and flags
+ */
+void _native_renew_pipe(int fds[2]);
+
+/** restarts the I/O thread in a forked instance */
+void _native_async_read_after_fork(void);
+
+/** arms the host timer for the next hwtimer */
+void schedule_timer(void);
+
+/** gives a forked instance a host timer of its own */
+void _native_hwtimer_after_fork(void);
+
+#ifdef NATIVE_HOST_IO
+/**
+ * Host I/O thread, see host_io.c
+ */
+
+/** starts the host I/O thread */
+void _native_host_io_init(void);
+
+/**
+ * restarts the host I/O thread in a forked instance, requests still
+ * open fail with EIO
+ */
+void _native_host_io_after_fork(void);
+
+/**
+ * hands a read (is_write == 0) or write to the host I/O thread and sleeps
+ * until it is done
+ *
+ * returns 0 if the caller can not sleep and has to do it itself
+ */
+int _native_host_io(int is_write, int fd, void *buf, size_t count,
+                    ssize_t *result);
+#endif
+
+#ifdef NATIVE_VIRTUAL_TIME
+/**
+ * Virtual time, see vtime.c
+ */
+
+/** the virtual clock in hwtimer ticks */
+unsigned long _native_vtime_ticks(void);
+
+/**
+ * called by the idle loop before it waits for interrupts
+ *
+ * returns 1 if an interrupt is pending and the loop must not wait
+ */
+int _native_vtime_sleep(void);
+
+/** called for every data frame sent or received on the tap */
+void _native_vtime_count_frame(void);
+
+/** handles a frame of the coordinator, in interrupt context */
+void _native_vtime_handle_frame(const void *payload, int len);
+
+/** synchronize with a coordinator over the tap interface */
+extern int _native_vtime_coordinated;
+
+/** deadline of the next hwtimer, returns 0 if none is set */
+int _native_hwtimer_next(unsigned long *deadline);
+
+/** native timer interrupt handler */
+void hwtimer_isr_timer();
+#endif
+
 //#include <sys/param.h>
 
 /* enable signal handler register access on different platforms
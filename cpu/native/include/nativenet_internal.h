@@ -32,12 +32,6 @@
 #define NNEV_SWTRX      0x0b
 #define NNEV_MAXEV      0x0b
 
-struct rx_buffer_s {
-    radio_packet_t packet;
-    char data[NATIVE_MAX_DATA_LENGTH];
-};
-
-extern struct rx_buffer_s _nativenet_rx_buffer[RX_BUF_SIZE];
 extern uint64_t _native_net_addr_long;
 extern radio_address_t _native_net_addr;
 
@@ -0,0 +1,79 @@
+/**
+ * internal nativenet shared memory medium interface
+ *
+ * Instead of a tap interface all instances of a simulation may share a
+ * broadcast ring in POSIX shared memory, started with
+ *
+ *     ./bin/native/default.elf shm:<name>[:<links>]
+ *
+ * A frame is written to the ring once and read by every other instance
+ * from there, a writer only wakes up receivers which wait for input, so a
+ * burst of frames costs one system call per receiver.  Every instance
+ * takes the next free slot of the segment, its MAC address is
+ * 02:00:00:00:00:<slot>.
+ *
+ * The optional link file is read by the instance creating the segment.
+ * Each line "<from> <to> <loss> <delay>" gives the loss in per mille and
+ * the delay in microseconds of frames from slot <from> to slot <to>, '*'
+ * matches all slots.  Links not listed are perfect.
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @{
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+#ifndef _SHM_MEDIUM_H
+#define _SHM_MEDIUM_H
+
+#include "radio/types.h"
+
+/**
+ * prefix of the tap argument selecting the shared memory medium
+ */
+#define SHM_MEDIUM_PREFIX   "shm:"
+
+/**
+ * most instances attached to one segment
+ */
+#ifndef SHM_MEDIUM_NODES
+#define SHM_MEDIUM_NODES    (64)
+#endif
+
+/**
+ * frames in the ring, a reader falling further behind loses frames
+ */
+#ifndef SHM_MEDIUM_RING
+#define SHM_MEDIUM_RING     (128)
+#endif
+
+/**
+ * received frames waiting for their link delay
+ */
+#ifndef SHM_MEDIUM_DELAYED
+#define SHM_MEDIUM_DELAYED  (16)
+#endif
+
+/**
+ * set if the instance uses the shared memory medium
+ */
+extern int _native_shm_medium;
+
+/**
+ * attach to the segment described by "spec", the tap argument without
+ * SHM_MEDIUM_PREFIX
+ */
+int shm_medium_init(char *spec);
+
+/**
+ * put packet into the ring
+ */
+int8_t shm_medium_send(radio_packet_t *packet);
+
+#endif /* _SHM_MEDIUM_H */
@@ -32,6 +32,16 @@
  */
 int tap_init(char *name);
 
+/**
+ * maximum number of frames read from the tap device per interrupt
+ *
+ * frames beyond the free slots of the transceiver buffer are dropped
+ * within a single burst
+ */
+#ifndef NATIVE_TAP_RX_BATCH
+#define NATIVE_TAP_RX_BATCH (TRANSCEIVER_BUFFER_SIZE / 2)
+#endif
+
 extern int _native_tap_fd;
 extern unsigned char _native_tap_mac[ETHER_ADDR_LEN];
 
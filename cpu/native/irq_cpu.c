@@ -39,6 +39,9 @@
 #include "cpu.h"
 
 #include "lpm.h"
+#if SCHEDSTATISTICS
+#include "sched.h"
+#endif
 
 #include "native_internal.h"
 
@@ -54,8 +57,12 @@ volatile int _native_in_syscall;
 static sigset_t _native_sig_set, _native_sig_set_dint;
 
 char __isr_stack[SIGSTKSZ];
+#ifdef NATIVE_FAST_SWITCH
+void **_native_cur_ctx, *_native_isr_ctx;
+#else
 ucontext_t native_isr_context;
 ucontext_t *_native_cur_ctx, *_native_isr_ctx;
+#endif
 
 volatile unsigned int _native_saved_eip;
 volatile int _native_sigpend;
@@ -140,6 +147,42 @@ void native_print_signals()
     }
 }
 
+#ifdef NATIVE_DEFERRED_IRQ
+/*
+ * Signals stay unblocked, native_isr_entry() only records them while
+ * native_interrupts_enabled is 0 and enableIRQ() replays them from
+ * _native_syscall_leave().  A critical section costs no system call.
+ */
+unsigned disableIRQ(void)
+{
+    unsigned int prev_state;
+
+    _native_syscall_enter();
+    prev_state = native_interrupts_enabled;
+    native_interrupts_enabled = 0;
+    /* nothing to replay, interrupts are off now */
+    _native_in_syscall--;
+
+    return prev_state;
+}
+
+unsigned enableIRQ(void)
+{
+    unsigned int prev_state;
+
+    if (_native_in_isr == 1) {
+        DEBUG("enableIRQ + _native_in_isr\n");
+    }
+
+    _native_syscall_enter();
+    prev_state = native_interrupts_enabled;
+    native_interrupts_enabled = 1;
+    /* handles what came in while interrupts were disabled */
+    _native_syscall_leave();
+
+    return prev_state;
+}
+#else
 /**
  * block signals
  */
@@ -197,6 +240,7 @@ unsigned enableIRQ(void)
 
     return prev_state;
 }
+#endif /* NATIVE_DEFERRED_IRQ */
 
 void restoreIRQ(unsigned state)
 {
@@ -259,6 +303,10 @@ void native_irq_handler()
 
     DEBUG("\n\n\t\tnative_irq_handler\n\n");
 
+#if SCHEDSTATISTICS
+    sched_stat_isr_enter();
+#endif
+
     while (_native_sigpend > 0) {
 
         sig = _native_popsig();
@@ -277,13 +325,22 @@ void native_irq_handler()
         }
     }
 
+#if SCHEDSTATISTICS
+    sched_stat_isr_exit();
+#endif
+
     DEBUG("native_irq_handler(): return\n");
     cpu_switch_context_exit();
 }
 
 void isr_set_sigmask(ucontext_t *ctx)
 {
+#ifdef NATIVE_DEFERRED_IRQ
+    /* _native_in_isr defers signals until the trampoline enables them */
+    ctx->uc_sigmask = _native_sig_set;
+#else
     ctx->uc_sigmask = _native_sig_set_dint;
+#endif
 }
 
 /**
@@ -312,7 +369,8 @@ void native_isr_entry(int sig, siginfo_t *info, void *context)
     }
 
     /* XXX: Workaround safety check - whenever this happens it really
-     * indicates a bug in disableIRQ */
+     * indicates a bug in disableIRQ, unless NATIVE_DEFERRED_IRQ defers
+     * the signal until enableIRQ() */
     if (native_interrupts_enabled == 0) {
         //printf("interrupts are off, but I caught a signal.\n");
         return;
@@ -327,11 +385,17 @@ void native_isr_entry(int sig, siginfo_t *info, void *context)
         return;
     }
 
+#ifdef NATIVE_FAST_SWITCH
+    _native_isr_ctx = _native_ctx_make(__isr_stack + SIGSTKSZ,
+                                       native_irq_handler, NULL);
+    _native_cur_ctx = (void **) &active_thread->sp;
+#else
     native_isr_context.uc_stack.ss_sp = __isr_stack;
     native_isr_context.uc_stack.ss_size = SIGSTKSZ;
     native_isr_context.uc_stack.ss_flags = 0;
     makecontext(&native_isr_context, native_irq_handler, 0);
     _native_cur_ctx = (ucontext_t *)active_thread->sp;
+#endif
 
     DEBUG("\n\n\t\treturn to _native_sig_leave_tramp\n\n");
     /* disable interrupts in context */
@@ -482,6 +546,7 @@ void native_interrupt_init(void)
         err(EXIT_FAILURE, "native_interrupt_init: sigaction");
     }
 
+#ifndef NATIVE_FAST_SWITCH
     if (getcontext(&native_isr_context) == -1) {
         err(EXIT_FAILURE, "native_isr_entry(): getcontext()");
     }
@@ -490,6 +555,7 @@ void native_interrupt_init(void)
     native_isr_context.uc_stack.ss_size = SIGSTKSZ;
     native_isr_context.uc_stack.ss_flags = 0;
     _native_isr_ctx = &native_isr_context;
+#endif
 
     static stack_t sigstk;
     sigstk.ss_sp = sigalt_stk;
@@ -500,7 +566,9 @@ void native_interrupt_init(void)
         err(EXIT_FAILURE, "main: sigaltstack");
     }
 
+#ifndef NATIVE_FAST_SWITCH
     makecontext(&native_isr_context, native_irq_handler, 0);
+#endif
 
     _native_in_syscall = 0;
 
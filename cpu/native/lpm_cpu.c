@@ -45,6 +45,15 @@ void lpm_init(void)
 
 void _native_lpm_sleep()
 {
+#ifdef NATIVE_VIRTUAL_TIME
+    if (_native_vtime_sleep()) {
+        /* time jumped to the next deadline, handle the timer */
+        _native_in_syscall++;
+        _native_syscall_leave();
+        return;
+    }
+#endif
+
 #ifdef MODULE_UART0
     int nfds;
 
@@ -139,6 +148,28 @@ enum lpm_mode lpm_set(enum lpm_mode target)
     return last_lpm;
 }
 
+/**
+ * only LPM_IDLE is supported, see lpm_set()
+ */
+unsigned long lpm_wakeup_latency(enum lpm_mode mode)
+{
+    return (mode <= LPM_IDLE) ? 0 : LPM_LATENCY_NEVER;
+}
+
+enum lpm_mode lpm_set_until(enum lpm_mode target, unsigned long deadline)
+{
+    enum lpm_mode last_lpm;
+
+    (void) deadline;
+
+    /* signals are blocked while interrupts are disabled */
+    eINT();
+    last_lpm = lpm_set(target);
+    dINT();
+
+    return last_lpm;
+}
+
 void lpm_awake(void)
 {
     DEBUG("XXX: lpm_awake()\n");
@@ -3,6 +3,8 @@
  *
  * in-process preemptive context switching utilizes POSIX ucontexts.
  * (ucontext provides for architecture independent stack handling)
+ * With NATIVE_FAST_SWITCH the switch of tramp.S is used instead, which
+ * does not save and restore the signal mask with a system call.
  *
  * Copyright (C) 2013 Ludwig Ortmann
  *
@@ -41,6 +43,10 @@
 
 #include <stdlib.h>
 
+#if defined(NATIVE_PERF_THREADS) && defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
 #include "kernel_internal.h"
 #include "kernel.h"
 #include "irq.h"
@@ -56,8 +62,12 @@
 
 extern volatile tcb_t *active_thread;
 
+#ifdef NATIVE_FAST_SWITCH
+extern void _native_ctx_start(void);
+#else
 ucontext_t end_context;
 char __end_stack[SIGSTKSZ];
+#endif
 
 #ifdef MODULE_UART0
 fd_set _native_rfds;
@@ -87,16 +97,51 @@ void thread_print_stack(void)
     return;
 }
 
+#ifdef NATIVE_FAST_SWITCH
+static void native_ctx_returned(void)
+{
+    errx(EXIT_FAILURE, "native_ctx_returned: this should have never been reached!!");
+}
+
+void *_native_ctx_make(char *top, void (*func)(void), void (*exit_func)(void))
+{
+    unsigned int *sp = (unsigned int *)((unsigned int) top & ~15u);
+
+    if (exit_func == NULL) {
+        exit_func = native_ctx_returned;
+    }
+
+    /* popped by _native_ctx_load(), see tramp.S */
+    *--sp = (unsigned int) &_native_ctx_start;
+    *--sp = 0;                          /* ebp */
+    *--sp = (unsigned int) func;        /* ebx */
+    *--sp = (unsigned int) exit_func;   /* esi */
+    *--sp = 0;                          /* edi */
+    *--sp = 0x1f80;                     /* MXCSR at reset */
+    *--sp = 0x037f;                     /* x87 control word at reset */
+
+    return sp;
+}
+#endif
+
 char *thread_stack_init(void (*task_func)(void), void *stack_start, int stacksize)
 {
+#ifndef NATIVE_FAST_SWITCH
     unsigned int *stk;
     ucontext_t *p;
+#endif
 
     VALGRIND_STACK_REGISTER(stack_start, stack_start + stacksize);
     VALGRIND_DEBUG("VALGRIND_STACK_REGISTER(%p, %p)\n", stack_start, (void*)((int)stack_start + stacksize));
 
     DEBUG("thread_stack_init()\n");
 
+#ifdef NATIVE_FAST_SWITCH
+    /* a returning thread exits on its own stack */
+    return _native_ctx_make((char *) stack_start + stacksize, task_func,
+                            sched_task_exit);
+#else
+
     stk = (unsigned int *)stack_start;
 
 #ifdef NATIVESPONTOP
@@ -124,28 +169,57 @@ char *thread_stack_init(void (*task_func)(void), void *stack_start, int stacksiz
     makecontext(p, task_func, 0);
 
     return (char *) p;
+#endif
+}
+
+#if defined(NATIVE_PERF_THREADS) && defined(__linux__)
+/**
+ * Names the host thread after the RIOT thread to run next.  perf records
+ * every change of the name, so `perf report --sort comm` breaks samples
+ * down by RIOT thread.  Costs a system call per thread switch.
+ */
+static void native_perf_thread(void)
+{
+    static volatile tcb_t *named;
+
+    if (active_thread != named) {
+        named = active_thread;
+        prctl(PR_SET_NAME, (unsigned long) active_thread->name, 0, 0, 0);
+    }
 }
+#else
+#define native_perf_thread()
+#endif
 
 void isr_cpu_switch_context_exit(void)
 {
+#ifndef NATIVE_FAST_SWITCH
     ucontext_t *ctx;
+#endif
 
     DEBUG("XXX: cpu_switch_context_exit()\n");
     if ((sched_context_switch_request == 1) || (active_thread == NULL)) {
         sched_run();
     }
 
+    native_perf_thread();
+
     DEBUG("XXX: cpu_switch_context_exit(): calling setcontext(%s)\n\n", active_thread->name);
-    ctx = (ucontext_t *)(active_thread->sp);
 
     /* the next context will have interrupts enabled due to ucontext */
     DEBUG("XXX: cpu_switch_context_exit: native_interrupts_enabled = 1;\n");
     native_interrupts_enabled = 1;
     _native_in_isr = 0;
 
+#ifdef NATIVE_FAST_SWITCH
+    _native_ctx_load(active_thread->sp);
+#else
+    ctx = (ucontext_t *)(active_thread->sp);
+
     if (setcontext(ctx) == -1) {
         err(EXIT_FAILURE, "cpu_switch_context_exit(): setcontext():");
     }
+#endif
     errx(EXIT_FAILURE, "2 this should have never been reached!!");
 }
 
@@ -161,6 +235,10 @@ void cpu_switch_context_exit()
     if (_native_in_isr == 0) {
         dINT();
         _native_in_isr = 1;
+#ifdef NATIVE_FAST_SWITCH
+        _native_ctx_load(_native_ctx_make(__isr_stack + SIGSTKSZ,
+                                          isr_cpu_switch_context_exit, NULL));
+#else
         native_isr_context.uc_stack.ss_sp = __isr_stack;
         native_isr_context.uc_stack.ss_size = SIGSTKSZ;
         native_isr_context.uc_stack.ss_flags = 0;
@@ -168,6 +246,7 @@ void cpu_switch_context_exit()
         if (setcontext(&native_isr_context) == -1) {
             err(EXIT_FAILURE, "cpu_switch_context_exit: swapcontext");
         }
+#endif
         errx(EXIT_FAILURE, "1 this should have never been reached!!");
     }
     else {
@@ -181,22 +260,33 @@ void isr_thread_yield()
     DEBUG("isr_thread_yield()\n");
 
     sched_run();
-    ucontext_t *ctx = (ucontext_t *)(active_thread->sp);
+    native_perf_thread();
     DEBUG("isr_thread_yield(): switching to(%s)\n\n", active_thread->name);
 
     native_interrupts_enabled = 1;
     _native_in_isr = 0;
+#ifdef NATIVE_FAST_SWITCH
+    _native_ctx_load(active_thread->sp);
+#else
+    ucontext_t *ctx = (ucontext_t *)(active_thread->sp);
+
     if (setcontext(ctx) == -1) {
         err(EXIT_FAILURE, "isr_thread_yield(): setcontext()");
     }
+#endif
 }
 
 void thread_yield()
 {
-    ucontext_t *ctx = (ucontext_t *)(active_thread->sp);
     if (_native_in_isr == 0) {
         _native_in_isr = 1;
         dINT();
+#ifdef NATIVE_FAST_SWITCH
+        _native_ctx_swap((void **) &active_thread->sp,
+                         _native_ctx_make(__isr_stack + SIGSTKSZ,
+                                          isr_thread_yield, NULL));
+#else
+        ucontext_t *ctx = (ucontext_t *)(active_thread->sp);
         native_isr_context.uc_stack.ss_sp = __isr_stack;
         native_isr_context.uc_stack.ss_size = SIGSTKSZ;
         native_isr_context.uc_stack.ss_flags = 0;
@@ -204,6 +294,7 @@ void thread_yield()
         if (swapcontext(ctx, &native_isr_context) == -1) {
             err(EXIT_FAILURE, "thread_yield: swapcontext");
         }
+#endif
         eINT();
     }
     else {
@@ -213,6 +304,7 @@ void thread_yield()
 
 void native_cpu_init()
 {
+#ifndef NATIVE_FAST_SWITCH
     if (getcontext(&end_context) == -1) {
         err(EXIT_FAILURE, "end_context(): getcontext()");
     }
@@ -223,6 +315,7 @@ void native_cpu_init()
     makecontext(&end_context, sched_task_exit, 0);
     VALGRIND_STACK_REGISTER(__end_stack, __end_stack + sizeof(__end_stack));
     VALGRIND_DEBUG("VALGRIND_STACK_REGISTER(%p, %p)\n", __end_stack, (void*)((int)__end_stack + sizeof(__end_stack)));
+#endif
 
     DEBUG("RIOT native cpu initialized.\n");
 }
@@ -32,6 +32,8 @@
 #include "tap.h"
 #include "nativenet.h"
 #include "nativenet_internal.h"
+#include "native_internal.h"
+#include "shm_medium.h"
 #include "cpu.h"
 
 struct nativenet_callback_s {
@@ -39,8 +41,6 @@ struct nativenet_callback_s {
 };
 static struct nativenet_callback_s _nativenet_callbacks[255];
 
-struct rx_buffer_s _nativenet_rx_buffer[RX_BUF_SIZE];
-static volatile uint8_t rx_buffer_next;
 
 uint8_t _native_net_chan;
 uint16_t _native_net_pan;
@@ -56,7 +56,13 @@ uint64_t _native_net_addr_long;
 void nativenet_init(int transceiver_pid)
 {
     DEBUG("nativenet_init(transceiver_pid=%d)\n", transceiver_pid);
-    rx_buffer_next = 0;
+
+    /* everything booted so far is shared by the instances of -n */
+    if (_native_nodes > 1) {
+        _native_fork_nodes();
+        shm_medium_init(_native_argv[1] + strlen(SHM_MEDIUM_PREFIX));
+    }
+
     _native_net_pan = 0;
     _native_net_chan = 0;
     _native_net_monitor = 0;
@@ -177,6 +183,8 @@ void do_cb(int event)
 void _nativenet_handle_packet(radio_packet_t *packet)
 {
     radio_address_t dst_addr = packet->dst;
+    radio_packet_t *trans_p;
+    int slot;
 
     /* address filter / monitor mode */
     if (_native_net_monitor == 1) {
@@ -196,27 +204,27 @@ void _nativenet_handle_packet(radio_packet_t *packet)
         }
     }
 
-    /* copy packet to rx buffer */
-    DEBUG("\n\t\trx_buffer_next: %i\n\n", rx_buffer_next);
-    memcpy(&_nativenet_rx_buffer[rx_buffer_next].data, packet->data, packet->length);
-    memcpy(&_nativenet_rx_buffer[rx_buffer_next].packet, packet, sizeof(radio_packet_t));
-    _nativenet_rx_buffer[rx_buffer_next].packet.data = (uint8_t *) &_nativenet_rx_buffer[rx_buffer_next].data;
-
-    /* notify transceiver thread if any */
-    if (_native_net_tpid) {
-        DEBUG("_nativenet_handle_packet: notifying transceiver thread!\n");
-        msg_t m;
-        m.type = (uint16_t) RCV_PKT_NATIVE;
-        m.content.value = rx_buffer_next;
-        msg_send_int(&m, _native_net_tpid);
-    }
-    else {
+    if (!_native_net_tpid) {
         DEBUG("_nativenet_handle_packet: no one to notify =(\n");
+        return;
     }
 
-    /* shift to next buffer element */
-    if (++rx_buffer_next == RX_BUF_SIZE) {
-        rx_buffer_next = 0;
+    /* copy packet right into the transceiver buffer */
+    slot = transceiver_rx_reserve();
+
+    if (slot < 0) {
+        DEBUG("_nativenet_handle_packet: transceiver buffer full, dropped\n");
+        return;
     }
+
+    DEBUG("\n\t\tslot: %i\n\n", slot);
+    trans_p = transceiver_rx_get_packet(slot);
+    memcpy(trans_p, packet, sizeof(radio_packet_t));
+    trans_p->processing = 1;
+    trans_p->data = transceiver_rx_get_payload(slot);
+    memcpy(trans_p->data, packet->data, packet->length);
+
+    DEBUG("_nativenet_handle_packet: notifying transceiver thread!\n");
+    transceiver_rx_commit(RCV_PKT_NATIVE, slot);
 }
 /** @} */
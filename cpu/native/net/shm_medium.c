@@ -0,0 +1,472 @@
+/**
+ * shm_medium.h implementation
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup native_cpu
+ * @{
+ * @file
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#include "cpu.h"
+#include "cpu-conf.h"
+#include "tap.h"
+#include "shm_medium.h"
+#include "nativenet.h"
+#include "nativenet_internal.h"
+#include "native_internal.h"
+
+#include "hwtimer.h"
+#include "vtimer.h"
+
+#define SHM_MAGIC       (0x4d485352)    /* "RSHM" */
+#define SHM_ALL         (-1)
+
+struct shm_link {
+    uint16_t loss;              /* per mille */
+    uint32_t delay;             /* microseconds */
+};
+
+struct shm_frame {
+    volatile uint32_t seq;      /* index + 1 once written, 0 while written */
+    uint16_t src;               /* slot of the sender */
+    uint16_t len;               /* bytes of packet */
+    struct nativenet_packet packet;
+};
+
+struct shm_segment {
+    volatile uint32_t magic;    /* set once the creator is done */
+    volatile uint32_t nodes;    /* slots taken */
+    volatile uint32_t write;    /* index of the next frame */
+    volatile uint32_t armed[SHM_MEDIUM_NODES];  /* the slot waits for input */
+    struct shm_link links[SHM_MEDIUM_NODES][SHM_MEDIUM_NODES];
+    struct shm_frame ring[SHM_MEDIUM_RING];
+};
+
+struct shm_delayed {
+    unsigned long due;
+    uint16_t len;
+    struct nativenet_packet packet;
+};
+
+int _native_shm_medium;
+
+static struct shm_segment *segment;
+static char fifo_base[64];
+static uint16_t self;
+static uint32_t next;
+static int fifo_fd;
+static int peer_fd[SHM_MEDIUM_NODES];
+static unsigned int seed;
+
+/* sorted by due time */
+static struct shm_delayed delayed[SHM_MEDIUM_DELAYED];
+static int delayed_num;
+static hwtimer_entry_t delay_timer;
+
+static void shm_deliver(struct nativenet_packet *packet, uint16_t len)
+{
+    radio_packet_t p;
+    unsigned long t = hwtimer_now();
+
+    p.processing = 0;
+    p.src = ntohs(packet->nn_header.src);
+    p.dst = ntohs(packet->nn_header.dst);
+    p.rssi = 0;
+    p.lqi = 0;
+    p.toa = timex_from_uint64(vtimer_now64_at(t));
+    p.length = ntohs(packet->nn_header.length);
+    p.data = packet->data;
+
+    if (p.length > (len - sizeof(struct nativenet_header))) {
+        warnx("shm_deliver: packet with malicious length field received, discarding");
+        return;
+    }
+
+    DEBUG("shm_deliver: received packet of length %" PRIu16 " for %" PRIu16 " from %" PRIu16 "\n", p.length, p.dst, p.src);
+    _nativenet_handle_packet(&p);
+}
+
+static void shm_delay_cb(void *arg)
+{
+    (void) arg;
+    unsigned long now = hwtimer_now();
+
+    while (delayed_num && ((long)(delayed[0].due - now) <= 0)) {
+        shm_deliver(&delayed[0].packet, delayed[0].len);
+        delayed_num--;
+        memmove(&delayed[0], &delayed[1], delayed_num * sizeof(delayed[0]));
+    }
+
+    if (delayed_num) {
+        hwtimer_entry_set_absolute(&delay_timer, delayed[0].due, shm_delay_cb, NULL);
+    }
+}
+
+static void shm_delay(struct nativenet_packet *packet, uint16_t len,
+                      uint32_t delay)
+{
+    unsigned long due = hwtimer_now() + HWTIMER_TICKS(delay);
+    int i;
+
+    if (delayed_num == SHM_MEDIUM_DELAYED) {
+        DEBUG("shm_delay: queue full, dropping frame\n");
+        return;
+    }
+
+    for (i = delayed_num; (i > 0) && ((long)(delayed[i - 1].due - due) > 0); i--);
+
+    memmove(&delayed[i + 1], &delayed[i], (delayed_num - i) * sizeof(delayed[0]));
+    delayed[i].due = due;
+    delayed[i].len = len;
+    memcpy(&delayed[i].packet, packet, len);
+    delayed_num++;
+
+    if (i == 0) {
+        hwtimer_entry_set_absolute(&delay_timer, due, shm_delay_cb, NULL);
+    }
+}
+
+/**
+ * read and dispatch one frame
+ *
+ * returns 0 if the ring had nothing left to read
+ */
+static int shm_read_frame(void)
+{
+    struct shm_frame *f = &segment->ring[next % SHM_MEDIUM_RING];
+    struct nativenet_packet packet;
+    struct shm_link *link;
+    uint32_t seq = f->seq;
+    uint16_t src, len;
+
+    if ((seq == 0) || ((int32_t)(seq - (next + 1)) < 0)) {
+        /* not written yet */
+        return 0;
+    }
+
+    if (seq != next + 1) {
+        DEBUG("shm_read_frame: lost %" PRIu32 " frames\n", seq - (next + 1));
+        next = seq - 1;
+    }
+
+    src = f->src;
+    len = f->len;
+
+    if ((src >= SHM_MEDIUM_NODES) || (len > sizeof(packet))) {
+        next++;
+        return 1;
+    }
+
+    memcpy(&packet, &f->packet, len);
+    __sync_synchronize();
+
+    if (f->seq != seq) {
+        DEBUG("shm_read_frame: frame overwritten while reading\n");
+        next++;
+        return 1;
+    }
+
+    next++;
+
+    if (src == self) {
+        return 1;
+    }
+
+    link = &segment->links[src][self];
+
+    if (link->loss && (((unsigned) rand_r(&seed) % 1000) < link->loss)) {
+        DEBUG("shm_read_frame: frame from %" PRIu16 " lost\n", src);
+        return 1;
+    }
+
+    if (len <= sizeof(struct nativenet_header)) {
+        DEBUG("shm_read_frame: no payload\n");
+    }
+    else if (link->delay) {
+        shm_delay(&packet, len, link->delay);
+    }
+    else {
+        shm_deliver(&packet, len);
+    }
+
+    return 1;
+}
+
+static void _native_handle_shm_input(void)
+{
+    char buf[64];
+    int i;
+
+    DEBUG("_native_handle_shm_input\n");
+
+    while (real_read(fifo_fd, buf, sizeof(buf)) > 0);
+
+    /* writers wake us up for frames written from now on */
+    segment->armed[self] = 1;
+    __sync_synchronize();
+
+    for (i = 0; i < NATIVE_TAP_RX_BATCH; i++) {
+        if (shm_read_frame() == 0) {
+            break;
+        }
+    }
+
+    if (i == NATIVE_TAP_RX_BATCH) {
+        /* come back for the rest with the next interrupt */
+        if (real_write(fifo_fd, "", 1) == -1) {
+            err(EXIT_FAILURE, "_native_handle_shm_input: write");
+        }
+    }
+
+    DEBUG("_native_handle_shm_input: handled %d frames\n", i);
+}
+
+static void shm_wake(int n)
+{
+    char path[sizeof(fifo_base) + 8];
+
+    if (peer_fd[n] == -1) {
+        snprintf(path, sizeof(path), "%s.%d", fifo_base, n);
+
+        _native_syscall_enter();
+        peer_fd[n] = open(path, O_WRONLY | O_NONBLOCK);
+        _native_syscall_leave();
+
+        if (peer_fd[n] == -1) {
+            DEBUG("shm_wake: slot %d is not listening\n", n);
+            return;
+        }
+    }
+
+    /* a full FIFO wakes the reader as well */
+    if ((_native_write(peer_fd[n], "", 1) == -1) && (errno != EAGAIN)) {
+        warn("shm_wake: write");
+    }
+}
+
+int8_t shm_medium_send(radio_packet_t *packet)
+{
+    struct shm_frame *f;
+    uint32_t i, nodes;
+    int len;
+
+    DEBUG("shm_medium_send: Sending packet of length %" PRIu16 " from %" PRIu16 " to %" PRIu16 "\n", packet->length, packet->src, packet->dst);
+
+    if (packet->length > sizeof(f->packet.data)) {
+        warnx("shm_medium_send: packet too large");
+        return -1;
+    }
+
+    i = __sync_fetch_and_add(&segment->write, 1);
+    f = &segment->ring[i % SHM_MEDIUM_RING];
+    f->seq = 0;
+    __sync_synchronize();
+
+    len = packet->length + sizeof(struct nativenet_header);
+    f->src = self;
+    f->len = len;
+    f->packet.nn_header.length = htons(packet->length);
+    f->packet.nn_header.dst = htons(packet->dst);
+    f->packet.nn_header.src = htons(packet->src);
+    memcpy(f->packet.data, packet->data, packet->length);
+
+    __sync_synchronize();
+    f->seq = i + 1;
+    __sync_synchronize();
+
+    nodes = segment->nodes;
+
+    for (uint32_t n = 0; (n < nodes) && (n < SHM_MEDIUM_NODES); n++) {
+        if ((n != self) && segment->armed[n] &&
+            __sync_lock_test_and_set(&segment->armed[n], 0)) {
+            shm_wake(n);
+        }
+    }
+
+    return (len > INT8_MAX ? INT8_MAX : len);
+}
+
+static int shm_parse_slot(const char *s)
+{
+    int n;
+
+    if (strcmp(s, "*") == 0) {
+        return SHM_ALL;
+    }
+
+    n = atoi(s);
+
+    if ((n < 0) || (n >= SHM_MEDIUM_NODES)) {
+        errx(EXIT_FAILURE, "shm_medium_init: no slot %s", s);
+    }
+
+    return n;
+}
+
+static void shm_read_links(const char *file)
+{
+    char from[8], to[8], line[80];
+    unsigned loss;
+    unsigned long delay;
+    FILE *fp;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+        err(EXIT_FAILURE, "shm_medium_init: %s", file);
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        int f, t;
+
+        if ((line[0] == '#') ||
+            (sscanf(line, "%7s %7s %u %lu", from, to, &loss, &delay) != 4)) {
+            continue;
+        }
+
+        f = shm_parse_slot(from);
+        t = shm_parse_slot(to);
+
+        for (int i = 0; i < SHM_MEDIUM_NODES; i++) {
+            for (int j = 0; j < SHM_MEDIUM_NODES; j++) {
+                if (((f == SHM_ALL) || (f == i)) && ((t == SHM_ALL) || (t == j))) {
+                    segment->links[i][j].loss = (loss > 1000) ? 1000 : loss;
+                    segment->links[i][j].delay = delay;
+                }
+            }
+        }
+    }
+
+    fclose(fp);
+}
+
+int shm_medium_init(char *spec)
+{
+    char path[sizeof(fifo_base) + 8];
+    struct stat st;
+    char *links;
+    int fd, created = 1;
+
+#ifdef NATIVE_VIRTUAL_TIME
+    if (_native_vtime_coordinated) {
+        errx(EXIT_FAILURE, "shm_medium_init: -c needs a tap interface");
+    }
+#endif
+
+    if ((links = strchr(spec, ':')) != NULL) {
+        *links++ = '\0';
+    }
+
+    snprintf(path, sizeof(path), "/riot.%s", spec);
+
+    if ((fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1) {
+        if ((errno != EEXIST) || ((fd = shm_open(path, O_RDWR, 0600)) == -1)) {
+            err(EXIT_FAILURE, "shm_medium_init: shm_open(%s)", path);
+        }
+
+        created = 0;
+    }
+    else if (ftruncate(fd, sizeof(struct shm_segment)) == -1) {
+        err(EXIT_FAILURE, "shm_medium_init: ftruncate");
+    }
+
+    /* the creator may not have truncated the segment yet */
+    while ((fstat(fd, &st) == 0) &&
+           (st.st_size < (off_t) sizeof(struct shm_segment))) {
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+
+    segment = mmap(NULL, sizeof(struct shm_segment), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+
+    if (segment == MAP_FAILED) {
+        err(EXIT_FAILURE, "shm_medium_init: mmap");
+    }
+
+    close(fd);
+
+    if (created) {
+        if (links) {
+            shm_read_links(links);
+        }
+
+        __sync_synchronize();
+        segment->magic = SHM_MAGIC;
+    }
+
+    while (segment->magic != SHM_MAGIC) {
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+
+    if ((self = __sync_fetch_and_add(&segment->nodes, 1)) >= SHM_MEDIUM_NODES) {
+        errx(EXIT_FAILURE, "shm_medium_init: all %d slots of %s are taken",
+             SHM_MEDIUM_NODES, spec);
+    }
+
+    for (int i = 0; i < SHM_MEDIUM_NODES; i++) {
+        peer_fd[i] = -1;
+    }
+
+    snprintf(fifo_base, sizeof(fifo_base), "/tmp/riot.shm.%s", spec);
+    snprintf(path, sizeof(path), "%s.%d", fifo_base, self);
+
+    if ((mkfifo(path, 0600) == -1) && (errno != EEXIST)) {
+        err(EXIT_FAILURE, "shm_medium_init: mkfifo(%s)", path);
+    }
+
+    /* read-write, so the FIFO never sees its last writer go away */
+    if ((fifo_fd = open(path, O_RDWR | O_NONBLOCK)) == -1) {
+        err(EXIT_FAILURE, "shm_medium_init: open(%s)", path);
+    }
+
+    _native_tap_mac[0] = 0x02;
+    _native_tap_mac[1] = _native_tap_mac[2] = _native_tap_mac[3] = 0;
+    _native_tap_mac[4] = self >> 8;
+    _native_tap_mac[5] = self & 0xff;
+
+    unsigned char *eui_64 = (unsigned char*)&_native_net_addr_long;
+    eui_64[0] = _native_tap_mac[0];
+    eui_64[1] = _native_tap_mac[1];
+    eui_64[2] = _native_tap_mac[2];
+    eui_64[3] = 0xff;
+    eui_64[4] = 0xfe;
+    eui_64[5] = _native_tap_mac[3];
+    eui_64[6] = _native_tap_mac[4];
+    eui_64[7] = _native_tap_mac[5];
+
+    seed = getpid() ^ self;
+    next = segment->write;
+    _native_shm_medium = 1;
+
+    native_async_read_add_handler(fifo_fd, _native_handle_shm_input);
+
+    /* frames of the others wake us up from now on */
+    segment->armed[self] = 1;
+
+    DEBUG("RIOT native shared memory medium initialized, slot %d.\n", self);
+    return fifo_fd;
+}
+/** @} */
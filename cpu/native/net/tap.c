@@ -43,12 +43,14 @@
 #include "cpu.h"
 #include "cpu-conf.h"
 #include "tap.h"
+#include "shm_medium.h"
 #include "nativenet.h"
 #include "nativenet_internal.h"
 #include "native_internal.h"
 
 #include "hwtimer.h"
 #include "timex.h"
+#include "vtimer.h"
 
 #define TAP_BUFFER_LENGTH (ETHER_MAX_LEN)
 int _native_marshall_ethernet(uint8_t *framebuf, radio_packet_t *packet);
@@ -56,25 +58,23 @@ int _native_marshall_ethernet(uint8_t *framebuf, radio_packet_t *packet);
 int _native_tap_fd;
 unsigned char _native_tap_mac[ETHER_ADDR_LEN];
 
-#ifdef __MACH__
-pid_t sigio_child_pid;
-#endif
-
-void _native_handle_tap_input(void)
+/**
+ * read and dispatch one frame
+ *
+ * returns 0 if the tap device had nothing left to read
+ */
+static int _native_tap_read_frame(union eth_frame *frame)
 {
     int nread;
-    union eth_frame frame;
     radio_packet_t p;
 
-    DEBUG("_native_handle_tap_input\n");
-
-    /* TODO: check whether this is an input or an output event
-       TODO: refactor this into general io-signal multiplexer */
-
-    nread = real_read(_native_tap_fd, &frame, sizeof(union eth_frame));
+    nread = real_read(_native_tap_fd, frame, sizeof(union eth_frame));
     DEBUG("_native_handle_tap_input - read %d bytes\n", nread);
     if (nread > 0) {
-        if (ntohs(frame.field.header.ether_type) == NATIVE_ETH_PROTO) {
+        if (ntohs(frame->field.header.ether_type) == NATIVE_ETH_PROTO) {
+#ifdef NATIVE_VIRTUAL_TIME
+            _native_vtime_count_frame();
+#endif
             nread = nread - ETHER_HDR_LEN;
             if ((nread - 1) <= 0) {
                 DEBUG("_native_handle_tap_input: no payload\n");
@@ -82,15 +82,14 @@ void _native_handle_tap_input(void)
             else {
                 unsigned long t = hwtimer_now();
                 p.processing = 0;
-                p.src = ntohs(frame.field.payload.nn_header.src);
-                p.dst = ntohs(frame.field.payload.nn_header.dst);
+                p.src = ntohs(frame->field.payload.nn_header.src);
+                p.dst = ntohs(frame->field.payload.nn_header.dst);
                 p.rssi = 0;
                 p.lqi = 0;
-                p.toa.seconds = HWTIMER_TICKS_TO_US(t)/1000000;
-                p.toa.microseconds = HWTIMER_TICKS_TO_US(t)%1000000;
+                p.toa = timex_from_uint64(vtimer_now64_at(t));
                 /* XXX: check overflow */
-                p.length = ntohs(frame.field.payload.nn_header.length);
-                p.data = frame.field.payload.data;
+                p.length = ntohs(frame->field.payload.nn_header.length);
+                p.data = frame->field.payload.data;
                 if (p.length > (nread - sizeof(struct nativenet_header))) {
                     warnx("_native_handle_tap_input: packet with malicious length field received, discarding");
                 }
@@ -100,37 +99,20 @@ void _native_handle_tap_input(void)
                 }
             }
         }
-        else {
-            DEBUG("ignoring non-native frame\n");
-        }
-
-        /* work around lost signals */
-        fd_set rfds;
-        struct timeval t;
-        memset(&t, 0, sizeof(t));
-        FD_ZERO(&rfds);
-        FD_SET(_native_tap_fd, &rfds);
-
-        _native_in_syscall++; // no switching here
-        if (select(_native_tap_fd +1, &rfds, NULL, NULL, &t) == 1) {
-            int sig = SIGIO;
-            extern int _sig_pipefd[2];
-            extern ssize_t (*real_write)(int fd, const void *buf, size_t count);
-            real_write(_sig_pipefd[1], &sig, sizeof(int));
-            _native_sigpend++;
-            DEBUG("_native_handle_tap_input: sigpend++\n");
+#ifdef NATIVE_VIRTUAL_TIME
+        else if (ntohs(frame->field.header.ether_type) == NATIVE_VTIME_PROTO) {
+            _native_vtime_handle_frame(frame->buffer + ETHER_HDR_LEN,
+                                       nread - ETHER_HDR_LEN);
         }
-        else {
-            DEBUG("_native_handle_tap_input: no more pending tap data\n");
-#ifdef __MACH__
-            kill(sigio_child_pid, SIGCONT);
 #endif
+        else {
+            DEBUG("ignoring non-native frame\n");
         }
-        _native_in_syscall--;
+        return 1;
     }
     else if (nread == -1) {
         if ((errno == EAGAIN ) || (errno == EWOULDBLOCK)) {
-            //warn("read");
+            return 0;
         }
         else {
             err(EXIT_FAILURE, "_native_handle_tap_input: read");
@@ -139,40 +121,25 @@ void _native_handle_tap_input(void)
     else {
         errx(EXIT_FAILURE, "internal error _native_handle_tap_input");
     }
+    return 0;
 }
 
-#ifdef __MACH__
-void sigio_child()
+void _native_handle_tap_input(void)
 {
-    pid_t parent = getpid();
-
-    if ((sigio_child_pid = fork()) == -1) {
-        err(EXIT_FAILURE, "sigio_child: fork");
-    }
-
-    if (sigio_child_pid > 0) {
-        /* return in parent process */
-        return;
-    }
+    union eth_frame frame;
+    int i;
 
-    /* watch tap interface and signal parent process if data is
-     * available */
+    DEBUG("_native_handle_tap_input\n");
 
-    fd_set rfds;
-    while (1) {
-        FD_ZERO(&rfds);
-        FD_SET(_native_tap_fd, &rfds);
-        if (select(_native_tap_fd +1, &rfds, NULL, NULL, NULL) == 1) {
-            kill(parent, SIGIO);
-        }
-        else {
-            kill(parent, SIGKILL);
-            err(EXIT_FAILURE, "osx_sigio_child: select");
+    /* drain a burst of frames in one interrupt, the rest (if any) keeps
+     * the descriptor readable and raises the next one */
+    for (i = 0; i < NATIVE_TAP_RX_BATCH; i++) {
+        if (_native_tap_read_frame(&frame) == 0) {
+            break;
         }
-        pause();
     }
+    DEBUG("_native_handle_tap_input: handled %d frames\n", i);
 }
-#endif
 
 int _native_marshall_ethernet(uint8_t *framebuf, radio_packet_t *packet)
 {
@@ -200,6 +167,7 @@ int _native_marshall_ethernet(uint8_t *framebuf, radio_packet_t *packet)
      * As of now only tuntaposx needs this. */
     if (data_len < ETHERMIN) {
         DEBUG("padding data! (%d -> ", data_len);
+        memset(f->field.payload.data + packet->length, 0, ETHERMIN - data_len);
         data_len = ETHERMIN;
         DEBUG("%d)\n", data_len);
     }
@@ -212,7 +180,9 @@ int8_t send_buf(radio_packet_t *packet)
     uint8_t buf[TAP_BUFFER_LENGTH];
     int nsent, to_send;
 
-    memset(buf, 0, sizeof(buf));
+    if (_native_shm_medium) {
+        return shm_medium_send(packet);
+    }
 
     DEBUG("send_buf:  Sending packet of length %" PRIu16 " from %" PRIu16 " to %" PRIu16 "\n", packet->length, packet->src, packet->dst);
     to_send = _native_marshall_ethernet(buf, packet);
@@ -223,6 +193,9 @@ int8_t send_buf(radio_packet_t *packet)
         warn("write");
         return -1;
     }
+#ifdef NATIVE_VIRTUAL_TIME
+    _native_vtime_count_frame();
+#endif
     return (nsent > INT8_MAX ? INT8_MAX : nsent);
 }
 
@@ -296,24 +269,13 @@ int tap_init(char *name)
     eui_64[6] = _native_tap_mac[4];
     eui_64[7] = _native_tap_mac[5];
 
-    /* configure signal handler for fds */
-    register_interrupt(SIGIO, _native_handle_tap_input);
-
-#ifdef __MACH__
-    /* tuntap signalled IO is not working in OSX,
-     * check http://sourceforge.net/p/tuntaposx/bugs/17/ */
-    sigio_child();
-#else
-    /* configure fds to send signals on io */
-    if (fcntl(_native_tap_fd, F_SETOWN, getpid()) == -1) {
-        err(EXIT_FAILURE, "tap_init(): fcntl(F_SETOWN)");
-    }
-
     /* set file access mode to nonblocking */
-    if (fcntl(_native_tap_fd, F_SETFL, O_NONBLOCK|O_ASYNC) == -1) {
+    if (fcntl(_native_tap_fd, F_SETFL, O_NONBLOCK) == -1) {
         err(EXIT_FAILURE, "tap_init(): fcntl(F_SETFL)");
     }
-#endif /* not OSX */
+
+    /* have the native I/O thread raise an interrupt for incoming frames */
+    native_async_read_add_handler(_native_tap_fd, _native_handle_tap_input);
 
     DEBUG("RIOT native tap initialized.\n");
     return _native_tap_fd;
@@ -0,0 +1,106 @@
+/**
+ * Sampling timer of the profiler on native
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * The host's profiling timer sends SIGPROF every interval of CPU time the
+ * process used, time spent waiting for interrupts is not sampled.  The
+ * handler takes the interrupted PC from the signal context and bypasses
+ * the interrupt emulation: it only records the sample and does not switch
+ * threads.  Signals are blocked in the emulated interrupt context, so like
+ * on the MCUs code with interrupts disabled is sampled when they are
+ * enabled again.
+ *
+ * gprof uses SIGPROF as well, do not build with all-gprof and the
+ * profiler module.
+ *
+ * @ingroup native_cpu
+ * @{
+ * @file   profiler_cpu.c
+ * @author Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// __USE_GNU for gregs[REG_EIP] access under Linux
+#define __USE_GNU
+#include <signal.h>
+#undef __USE_GNU
+
+#include "cpu.h"
+#include "profiler.h"
+
+#include "native_internal.h"
+
+static void profiler_isr(int sig, siginfo_t *info, void *context)
+{
+    (void) sig;
+    (void) info;
+
+#ifdef __MACH__
+    profiler_sample(((ucontext_t *)context)->uc_mcontext->__ss.__eip);
+#elif BSD
+    profiler_sample(((struct sigcontext *)context)->sc_eip);
+#else
+    profiler_sample(((ucontext_t *)context)->uc_mcontext.gregs[REG_EIP]);
+#endif
+}
+
+static int profiler_timer(unsigned long interval_us)
+{
+    struct itimerval it;
+
+    it.it_interval.tv_sec = interval_us / 1000000;
+    it.it_interval.tv_usec = interval_us % 1000000;
+    it.it_value = it.it_interval;
+
+    return setitimer(ITIMER_PROF, &it, NULL);
+}
+
+int profiler_arch_start(unsigned long interval_us)
+{
+    struct sigaction sa;
+
+    if (interval_us == 0) {
+        return -1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = profiler_isr;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO | SA_ONSTACK;
+
+    if (sigfillset(&sa.sa_mask) == -1) {
+        err(EXIT_FAILURE, "profiler_arch_start: sigfillset");
+    }
+
+    _native_syscall_enter();
+
+    if (sigaction(SIGPROF, &sa, NULL) == -1) {
+        err(EXIT_FAILURE, "profiler_arch_start: sigaction");
+    }
+
+    int res = profiler_timer(interval_us);
+
+    _native_syscall_leave();
+
+    return (res == -1) ? -1 : 0;
+}
+
+void profiler_arch_stop(void)
+{
+    _native_syscall_enter();
+
+    if (profiler_timer(0) == -1) {
+        err(EXIT_FAILURE, "profiler_arch_stop: setitimer");
+    }
+
+    _native_syscall_leave();
+}
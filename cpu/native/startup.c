@@ -29,6 +29,10 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <signal.h>
+#include <sys/prctl.h>
+#endif
 
 #include "kernel_internal.h"
 #include "cpu.h"
@@ -36,6 +40,7 @@
 #include "board_internal.h"
 #include "native_internal.h"
 #include "tap.h"
+#include "shm_medium.h"
 
 int (*real_printf)(const char *format, ...);
 int _native_null_in_pipe[2];
@@ -148,6 +153,71 @@ void daemonize()
     }
 }
 
+void _native_renew_pipe(int fds[2])
+{
+    int renewed[2];
+
+    if (pipe(renewed) == -1) {
+        err(EXIT_FAILURE, "_native_renew_pipe: pipe");
+    }
+
+    for (int i = 0; i < 2; i++) {
+        int flags = fcntl(fds[i], F_GETFL);
+
+        if ((flags == -1) || (dup2(renewed[i], fds[i]) == -1) ||
+            (fcntl(fds[i], F_SETFL, flags) == -1)) {
+            err(EXIT_FAILURE, "_native_renew_pipe: dup2");
+        }
+
+        close(renewed[i]);
+    }
+}
+
+#ifdef MODULE_NATIVENET
+int _native_nodes = 1;
+
+/**
+ * The fork server: instead of starting every instance from scratch, the
+ * first one boots up to the radio and forks the others from there.  The
+ * copies only differ in the slot of the medium they take afterwards.  The
+ * first instance stays the parent, its exit takes the others along.
+ */
+void _native_fork_nodes(void)
+{
+    int i;
+
+    dINT();
+
+    for (i = 1; i < _native_nodes; i++) {
+        pid_t pid;
+
+        if ((pid = fork()) == -1) {
+            err(EXIT_FAILURE, "_native_fork_nodes: fork");
+        }
+
+        if (pid == 0) {
+            break;
+        }
+    }
+
+    if (i < _native_nodes) {
+#ifdef __linux__
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+        /* fork() copies neither host threads nor the interval timer */
+        _native_renew_pipe(_sig_pipefd);
+#ifdef NATIVE_HOST_IO
+        _native_host_io_after_fork();
+#endif
+        _native_hwtimer_after_fork();
+        _native_async_read_after_fork();
+    }
+
+    _native_nodes = 1;
+    eINT();
+}
+#endif
+
 void usage_exit()
 {
     real_printf("usage: %s", _progname);
@@ -160,6 +230,14 @@ void usage_exit()
     real_printf(" [-t <port>|-u]");
 #endif
 
+#ifdef MODULE_NATIVENET
+    real_printf(" [-n <count>]");
+#endif
+
+#if defined(MODULE_NATIVENET) && defined(NATIVE_VIRTUAL_TIME)
+    real_printf(" [-c]");
+#endif
+
     real_printf(" [-d] [-e|-E] [-o]\n");
 
     real_printf(" help: %s -h\n", _progname);
@@ -175,6 +253,17 @@ void usage_exit()
     real_printf("\
 -u      redirect stdio to UNIX socket\n\
 -t      redirect stdio to TCP socket\n");
+#endif
+
+#ifdef MODULE_NATIVENET
+    real_printf("\
+-n      run <count> instances on the shared memory medium, forked from\n\
+        this one when the radio starts\n");
+#endif
+
+#if defined(MODULE_NATIVENET) && defined(NATIVE_VIRTUAL_TIME)
+    real_printf("\
+-c      synchronize virtual time with vtime_coordinator on the tap bridge\n");
 #endif
 
     real_printf("\n\
@@ -244,6 +333,24 @@ __attribute__((constructor)) static void startup(int argc, char **argv)
         else if (strcmp("-o", arg) == 0) {
             stdouttype = "file";
         }
+#ifdef MODULE_NATIVENET
+        else if (strcmp("-n", arg) == 0) {
+            if ((argp + 1 >= argc) ||
+                ((_native_nodes = atoi(argv[++argp])) < 1)) {
+                usage_exit();
+            }
+
+            if (strncmp(argv[1], SHM_MEDIUM_PREFIX,
+                        strlen(SHM_MEDIUM_PREFIX)) != 0) {
+                errx(EXIT_FAILURE, "-n needs a shared memory medium");
+            }
+        }
+#endif
+#if defined(MODULE_NATIVENET) && defined(NATIVE_VIRTUAL_TIME)
+        else if (strcmp("-c", arg) == 0) {
+            _native_vtime_coordinated = 1;
+        }
+#endif
 #ifdef MODULE_UART0
         else if (strcmp("-t", arg) == 0) {
             stdiotype = "tcp";
@@ -286,8 +393,19 @@ __attribute__((constructor)) static void startup(int argc, char **argv)
     native_hwtimer_pre_init();
     native_cpu_init();
     native_interrupt_init();
+#ifdef NATIVE_HOST_IO
+    _native_host_io_init();
+#endif
 #ifdef MODULE_NATIVENET
-    tap_init(argv[1]);
+    if (strncmp(argv[1], SHM_MEDIUM_PREFIX, strlen(SHM_MEDIUM_PREFIX)) == 0) {
+        /* with -n the instances attach after _native_fork_nodes() */
+        if (_native_nodes == 1) {
+            shm_medium_init(argv[1] + strlen(SHM_MEDIUM_PREFIX));
+        }
+    }
+    else {
+        tap_init(argv[1]);
+    }
 #endif
 
     board_init();
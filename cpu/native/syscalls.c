@@ -79,6 +79,11 @@ void _native_syscall_leave()
     {
         _native_in_isr = 1;
         dINT();
+#ifdef NATIVE_FAST_SWITCH
+        _native_ctx_swap((void **) &active_thread->sp,
+                         _native_ctx_make(__isr_stack + SIGSTKSZ,
+                                          native_irq_handler, NULL));
+#else
         _native_cur_ctx = (ucontext_t *)active_thread->sp;
         native_isr_context.uc_stack.ss_sp = __isr_stack;
         native_isr_context.uc_stack.ss_size = SIGSTKSZ;
@@ -87,6 +92,7 @@ void _native_syscall_leave()
         if (swapcontext(_native_cur_ctx, &native_isr_context) == -1) {
             err(EXIT_FAILURE, "_native_syscall_leave: swapcontext");
         }
+#endif
         eINT();
     }
 }
@@ -145,6 +151,12 @@ ssize_t _native_read(int fd, void *buf, size_t count)
 {
     ssize_t r;
 
+#ifdef NATIVE_HOST_IO
+    if (_native_host_io(0, fd, buf, count, &r)) {
+        return r;
+    }
+#endif
+
     _native_syscall_enter();
     r = real_read(fd, buf, count);
     _native_syscall_leave();
@@ -156,6 +168,12 @@ ssize_t _native_write(int fd, const void *buf, size_t count)
 {
     ssize_t r;
 
+#ifdef NATIVE_HOST_IO
+    if (_native_host_io(1, fd, (void *) buf, count, &r)) {
+        return r;
+    }
+#endif
+
     _native_syscall_enter();
     r = real_write(fd, buf, count);
     _native_syscall_leave();
@@ -0,0 +1,199 @@
+/**
+ * Native CPU virtual time
+ *
+ * With NATIVE_VIRTUAL_TIME the hwtimer does not follow the host clock.
+ * Time stands still while RIOT runs and jumps to the next timer deadline
+ * whenever the idle loop would wait for an interrupt, so a simulation
+ * runs as fast as the host executes it and does not depend on host load.
+ *
+ * Several instances on one tap bridge are kept in step by a coordinator,
+ * see dist/tools/vtime_coordinator, if started with -c.  An idle instance
+ * broadcasts a request holding its next deadline and waits.  Once all
+ * instances wait, the coordinator grants the earliest deadline to all of
+ * them.  Every request carries the number of data frames the instance
+ * sent and received and the number of the last grant, requests not
+ * matching the numbers seen by the coordinator are outdated, so no
+ * instance advances while a frame is in flight.
+ *
+ * Busy waiting for hwtimer_now() to change does not terminate in this
+ * mode.
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup native_cpu
+ * @{
+ * @file
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <err.h>
+#include <arpa/inet.h>
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#include "cpu.h"
+#include "cpu-conf.h"
+#include "native_internal.h"
+
+#ifdef MODULE_NATIVENET
+#include "tap.h"
+#endif
+
+#define VTIME_REQUEST   (1)
+#define VTIME_GRANT     (2)
+
+#define VTIME_NEVER     (UINT64_MAX)
+
+/* payload of a NATIVE_VTIME_PROTO frame, in network byte order */
+struct vtime_msg {
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t seq;               /* number of the last grant */
+    uint32_t frames;            /* data frames sent and received */
+    uint32_t time_hi;           /* deadline or granted time in ticks */
+    uint32_t time_lo;
+} __attribute__((packed));
+
+int _native_vtime_coordinated;
+
+static uint64_t vtime_now;
+static uint32_t vtime_frames;
+static uint32_t vtime_seq;
+
+unsigned long _native_vtime_ticks(void)
+{
+    return (unsigned long) vtime_now;
+}
+
+void _native_vtime_count_frame(void)
+{
+    vtime_frames++;
+}
+
+/* time of the next hwtimer, VTIME_NEVER if none is set */
+static uint64_t next_deadline(void)
+{
+    unsigned long deadline;
+    long delta;
+
+    if (!_native_hwtimer_next(&deadline)) {
+        return VTIME_NEVER;
+    }
+
+    delta = (long)(deadline - (unsigned long) vtime_now);
+    return vtime_now + ((delta > 0) ? delta : 0);
+}
+
+/* has the idle loop handle the timer interrupt */
+static void raise_timer(void)
+{
+    DEBUG("vtime: timer due at %llu\n", (unsigned long long) vtime_now);
+
+    _native_in_syscall++;
+
+    if (raise(SIGALRM) != 0) {
+        err(EXIT_FAILURE, "_native_vtime_sleep: raise");
+    }
+
+    _native_in_syscall--;
+}
+
+#ifdef MODULE_NATIVENET
+static void send_request(uint64_t deadline)
+{
+    static struct vtime_msg last;
+    uint8_t buf[ETHER_HDR_LEN + ETHERMIN];
+    struct ether_header *hdr = (struct ether_header *) buf;
+    struct vtime_msg msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = VTIME_REQUEST;
+    msg.seq = htonl(vtime_seq);
+    msg.frames = htonl(vtime_frames);
+    msg.time_hi = htonl((uint32_t)(deadline >> 32));
+    msg.time_lo = htonl((uint32_t) deadline);
+
+    /* requests of the other instances wake us up as well */
+    if (memcmp(&msg, &last, sizeof(msg)) == 0) {
+        return;
+    }
+
+    memset(buf, 0, sizeof(buf));
+    memset(hdr->ether_dhost, 0xff, ETHER_ADDR_LEN);
+    memcpy(hdr->ether_shost, _native_tap_mac, ETHER_ADDR_LEN);
+    hdr->ether_type = htons(NATIVE_VTIME_PROTO);
+    memcpy(buf + ETHER_HDR_LEN, &msg, sizeof(msg));
+
+    if (_native_write(_native_tap_fd, buf, sizeof(buf)) == -1) {
+        warn("_native_vtime_sleep: write");
+        return;
+    }
+
+    last = msg;
+}
+
+void _native_vtime_handle_frame(const void *payload, int len)
+{
+    struct vtime_msg msg;
+    uint64_t t;
+
+    if (len < (int) sizeof(msg)) {
+        return;
+    }
+
+    memcpy(&msg, payload, sizeof(msg));
+
+    if (msg.type != VTIME_GRANT) {
+        return;
+    }
+
+    vtime_seq = ntohl(msg.seq);
+    t = ((uint64_t) ntohl(msg.time_hi) << 32) | ntohl(msg.time_lo);
+    DEBUG("vtime: grant %lu up to %llu\n", (unsigned long) vtime_seq,
+          (unsigned long long) t);
+
+    if (t > vtime_now) {
+        vtime_now = t;
+    }
+
+    if (next_deadline() == vtime_now) {
+        hwtimer_isr_timer();
+    }
+}
+#endif
+
+int _native_vtime_sleep(void)
+{
+    uint64_t deadline = next_deadline();
+
+    if (deadline == vtime_now) {
+        raise_timer();
+        return 1;
+    }
+
+#ifdef MODULE_NATIVENET
+    if (_native_vtime_coordinated) {
+        send_request(deadline);
+        return 0;
+    }
+#endif
+
+    if (deadline == VTIME_NEVER) {
+        /* only input can wake us up */
+        return 0;
+    }
+
+    vtime_now = deadline;
+    raise_timer();
+    return 1;
+}
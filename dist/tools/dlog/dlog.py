@@ -0,0 +1,188 @@
+#!/usr/bin/env python2
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2014 Freie Universität Berlin
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+"""
+Formats the records written by the dlog module, see sys/include/dlog.h,
+with the format strings of an ELF file.
+
+Usage: dlog.py <elf> [log]
+
+The log is read from stdin if not given, lines not starting with "DLOG"
+are passed through.  The objdump of the toolchain is taken from $OBJDUMP,
+e.g. OBJDUMP=arm-none-eabi-objdump.
+"""
+
+from __future__ import print_function
+
+from os import environ
+from subprocess import PIPE, Popen
+import re
+import sys
+
+PID_ISR = 0xff
+
+CONVERSION = re.compile(r'%[-+ #0]*\d*(?:\.\d+)?(?:hh|h|ll|l|z|t|j)?([diouxXcsp%])')
+
+
+def run(args):
+    proc = Popen(args, stdout=PIPE)
+    lines = [line.decode('ascii', 'replace') for line in proc.stdout]
+
+    if proc.wait() != 0:
+        sys.exit('%s failed' % args[0])
+
+    return lines
+
+
+def loaded_sections(objdump, elf):
+    """Returns the names of the sections that occupy memory on the node."""
+    names, name = [], None
+
+    for line in run([objdump, '-h', elf]):
+        fields = line.split()
+
+        if (len(fields) == 7) and fields[0].isdigit():
+            name = fields[1]
+        elif (name is not None) and ('ALLOC' in line):
+            names.append(name)
+            name = None
+
+    return names
+
+
+def read_sections(elf):
+    """Returns the contents of the ELF file as (start, bytes) tuples."""
+    objdump = environ.get('OBJDUMP', 'objdump')
+    args = [objdump, '-s']
+
+    for name in loaded_sections(objdump, elf):
+        args += ['-j', name]
+
+    sections, start, data = [], None, bytearray()
+
+    for line in run(args + [elf]):
+        if line.startswith('Contents of section'):
+            if start is not None:
+                sections.append((start, bytes(data)))
+            start, data = None, bytearray()
+            continue
+
+        fields = line.split()
+
+        if (len(fields) < 2) or not line.startswith(' '):
+            continue
+
+        try:
+            addr = int(fields[0], 16)
+        except ValueError:
+            continue
+
+        if start is None:
+            start = addr
+
+        # up to four groups of hex digits, then the ASCII column
+        for group in fields[1:5]:
+            if not re.match(r'^[0-9a-f]+$', group) or (len(group) % 2):
+                break
+            data.extend(bytearray.fromhex(group))
+
+    if start is not None:
+        sections.append((start, bytes(data)))
+
+    return sections
+
+
+def read_string(sections, addr):
+    for start, data in sections:
+        if start <= addr < start + len(data):
+            end = data.find(b'\0', addr - start)
+            return data[addr - start:end if end >= 0 else None].decode(
+                'utf-8', 'replace')
+    return None
+
+
+def format_record(sections, fmt, args):
+    args = list(args)
+
+    def convert(match):
+        kind = match.group(1)
+
+        if kind == '%':
+            return '%'
+        if not args:
+            return match.group(0)
+
+        value = args.pop(0)
+        spec = match.group(0)
+        spec = re.sub(r'(hh|h|ll|l|z|t|j)(?=[a-zA-Z]$)', '', spec)
+
+        if kind in 'di':
+            value -= (value & 0x80000000) << 1
+        elif kind == 's':
+            string = read_string(sections, value)
+            return spec % (string if string is not None else
+                           '<0x%08x>' % value)
+        elif kind == 'p':
+            return '0x%08x' % value
+        elif kind == 'c':
+            value &= 0xff
+        elif kind == 'u':
+            spec = spec[:-1] + 'd'
+
+        return spec % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.exit('usage: %s <elf> [log]' % argv[0])
+
+    sections = read_sections(argv[1])
+    log = open(argv[2]) if len(argv) == 3 else sys.stdin
+
+    for line in log:
+        fields = line.split()
+
+        if (len(fields) < 2) or (fields[0] != 'DLOG'):
+            sys.stdout.write(line)
+            continue
+
+        if fields[1] == 'lost':
+            print('[dlog] %d records lost' % int(fields[2], 16))
+            continue
+
+        words = [int(f, 16) for f in fields[1:]]
+        fmt = read_string(sections, words[0])
+
+        if fmt is None:
+            fmt = '<unknown format 0x%08x>\n' % words[0]
+
+        pid = words[2] >> 8
+        thread = 'isr' if pid == PID_ISR else '%3d' % pid
+        text = format_record(sections, fmt, words[3:3 + (words[2] & 0xff)])
+        sys.stdout.write('[%10d %s] %s' % (words[1], thread, text))
+
+        if not text.endswith('\n'):
+            sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main(sys.argv)
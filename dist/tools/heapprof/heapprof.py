@@ -0,0 +1,183 @@
+#!/usr/bin/env python2
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2014 Freie Universität Berlin
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+"""
+Maps the output of heapprof_dump(), see sys/include/heapprof.h, to the
+functions of an ELF file, or replays the trace heapprof_trace() writes on
+native, and prints per function the allocations and the bytes held.
+
+Usage: heapprof.py <elf> [log]
+       heapprof.py -t <elf> <trace>
+
+The log is read from stdin if not given, lines not starting with "HEAP"
+are skipped.  A trace is replayed in full: the peak per function is that
+of its own blocks, the blocks left are those still held at the end of the
+trace.  The nm of the toolchain is taken from $NM, e.g.
+NM=arm-none-eabi-nm.
+"""
+
+from __future__ import print_function
+
+from bisect import bisect_right
+from os import environ
+from subprocess import PIPE, Popen
+import sys
+
+
+def read_symbols(elf):
+    nm = Popen([environ.get('NM', 'nm'), '-n', elf], stdout=PIPE)
+    addrs, names = [], []
+
+    for line in nm.stdout:
+        fields = line.decode('ascii', 'replace').split()
+
+        if (len(fields) == 3) and (fields[1] in 'TtWw'):
+            # thumb functions have bit 0 set
+            addrs.append(int(fields[0], 16) & ~1)
+            names.append(fields[2])
+
+    if nm.wait() != 0:
+        sys.exit('%s failed' % environ.get('NM', 'nm'))
+
+    return addrs, names
+
+
+def function(symbols, site):
+    addrs, names = symbols
+
+    if site == 0:
+        return '(other)'
+
+    # the return address may be just past the end of the calling function
+    i = bisect_right(addrs, site - 1) - 1
+    return names[i] if i >= 0 else '0x%08x' % site
+
+
+def read_dump(log):
+    header, sites = None, []
+
+    for line in log:
+        fields = line.split()
+
+        if (len(fields) < 2) or (fields[0] != 'HEAP'):
+            continue
+
+        if fields[1] == 'begin':
+            header = dict(f.split('=', 1) for f in fields[2:])
+            sites = []
+        elif fields[1] == 'site':
+            sites.append([int(fields[2], 16)] +
+                         [int(f) for f in fields[3:9]])
+
+    if header is None:
+        sys.exit('no heapprof dump found')
+
+    return header, sites
+
+
+def print_functions(functions):
+    print('%8s %6s %6s %8s %8s %10s  %s' % ('allocs', 'fails', 'blocks',
+          'bytes', 'peak', 'total', 'function'))
+
+    for name, f in sorted(functions.items(), key=lambda f: -f[1][4]):
+        print('%8d %6d %6d %8d %8d %10d  %s' % (tuple(f) + (name,)))
+
+
+def main_dump(symbols, log):
+    header, sites = read_dump(log)
+    functions = {}
+
+    print('%s bytes held, %s at the peak, %s allocations, %s failed, '
+          '%s bytes overhead per block' % (header['bytes'], header['peak'],
+          header['allocs'], header['fails'], header['overhead']))
+    print()
+
+    # the peaks of the sites of a function add up to an upper bound
+    for site in sites:
+        f = functions.setdefault(function(symbols, site[0]), [0] * 6)
+
+        for i in range(6):
+            f[i] += site[i + 1]
+
+    print_functions(functions)
+
+
+def main_trace(symbols, log):
+    functions, blocks = {}, {}
+    held = peak = 0
+
+    for line in log:
+        fields = line.split()
+
+        if not fields:
+            continue
+
+        if fields[0] == '+':
+            site, ptr, size = [int(f, 16) for f in fields[1:4]]
+            name = function(symbols, site)
+            f = functions.setdefault(name, [0] * 6)
+            blocks[ptr] = (name, size)
+            f[0] += 1
+            f[2] += 1
+            f[3] += size
+            f[4] = max(f[4], f[3])
+            f[5] += size
+            held += size
+            peak = max(peak, held)
+        elif fields[0] == '-':
+            ptr = int(fields[1], 16)
+
+            if ptr in blocks:
+                name, size = blocks.pop(ptr)
+                f = functions[name]
+                f[2] -= 1
+                f[3] -= size
+                held -= size
+        elif fields[0] == '!':
+            name = function(symbols, int(fields[1], 16))
+            functions.setdefault(name, [0] * 6)[1] += 1
+
+    print('%d bytes held at the end in %d blocks, %d at the peak' %
+          (held, len(blocks), peak))
+    print()
+    print_functions(functions)
+
+
+def main(argv):
+    trace = (len(argv) > 1) and (argv[1] == '-t')
+
+    if trace:
+        argv = argv[1:]
+
+    if (len(argv) not in (2, 3)) or (trace and (len(argv) != 3)):
+        sys.exit('usage: %s <elf> [log]\n       %s -t <elf> <trace>' %
+                 (argv[0], argv[0]))
+
+    symbols = read_symbols(argv[1])
+    log = open(argv[2]) if len(argv) == 3 else sys.stdin
+
+    if trace:
+        main_trace(symbols, log)
+    else:
+        main_dump(symbols, log)
+
+
+if __name__ == '__main__':
+    main(sys.argv)
@@ -135,6 +135,22 @@ void flowcontrol_deliver_from_tty(const border_packet_t *packet, int len)
             }
             while (slwin_stat.last_ack != packet->seq_num);
         }
+
+        if (len >= (int) sizeof(border_ack_packet_t)) {
+            uint8_t sack = ((const border_ack_packet_t *)packet)->sack;
+            uint8_t i;
+
+            /* no need to resend what the LoWPAN interface already has */
+            for (i = 0; sack != 0; i++, sack >>= 1) {
+                uint8_t seq_num = packet->seq_num + 2 + i;
+                struct send_slot *slot = &(slwin_stat.send_win[seq_num % BORDER_SWS]);
+
+                if ((sack & 1) && slot->frame_len != 0 &&
+                    in_window(seq_num, slwin_stat.last_ack + 1, slwin_stat.last_frame)) {
+                    pthread_cancel(slot->resend_thread);
+                }
+            }
+        }
     }
     else {
         struct recv_slot *slot;
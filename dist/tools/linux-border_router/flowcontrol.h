@@ -24,8 +24,12 @@
 #define BORDER_CONF_SYN           0       ///< Configuration packet type for SYN-Packets.
 #define BORDER_CONF_SYNACK        1       ///< Configuration packet type for SYN/ACK-Packets.
 
-#define BORDER_SWS                1       ///< Sending window size for flow control.
-#define BORDER_RWS                1       ///< Receiving window size for flow control.
+#ifndef BORDER_SWS
+#define BORDER_SWS                4       ///< Sending window size for flow control.
+#endif
+#ifndef BORDER_RWS
+#define BORDER_RWS                4       ///< Receiving window size for flow control.
+#endif
 #define BORDER_SL_TIMEOUT         500000  ///< Timeout time (in µsec) for flow control.
 
 /**
@@ -62,6 +66,22 @@ typedef struct flowcontrol_stat_t {
     } recv_win[BORDER_RWS];             ///< The receiving window.
 } flowcontrol_stat_t;
 
+/**
+ * @brief   Acknowledgement of the LoWPAN interface.
+ * @extends border_packet_t
+ */
+typedef struct __attribute__((packed)) border_ack_packet_t {
+    uint8_t empty;
+    uint8_t type;
+    uint8_t seq_num;    ///< Every frame up to this one was received.
+    /**
+     * @brief Selective acknowledgement
+     *
+     * Bit i is set if frame @ref seq_num + 2 + i was received as well.
+     */
+    uint8_t sack;
+} border_ack_packet_t;
+
 /**
  * @brief   Describes a SYN packet for connection establishment of
  *          the serial line.
@@ -14,6 +14,9 @@
 #define END_ESC     0xDC
 #define ESC_ESC     0xDD
 
+#define BINARY_MAGIC    0xA5
+#define BINARY_HDR_LEN  3
+
 uint8_t serial_out_buf[BUFFER_SIZE];
 uint8_t serial_in_buf[BUFFER_SIZE];
 
@@ -49,6 +52,81 @@ uint8_t serial_read_byte()
     return (uint8_t)c;
 }
 
+#ifdef BORDER_BINARY_FRAMING
+static int read_serial_bytes(uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+
+    while (got < len) {
+        int n = read_serial_port(buf + got, len - got);
+
+        if (n <= 0) {
+            return -1;
+        }
+
+        got += n;
+    }
+
+    return got;
+}
+
+int readpacket(uint8_t *packet_buf, size_t size)
+{
+    uint8_t *line_buf_ptr = packet_buf;
+    uint8_t hdr[BINARY_HDR_LEN - 1];
+    size_t len;
+    uint8_t byte;
+
+    byte = serial_read_byte();
+
+    if (byte != BINARY_MAGIC) {
+        /* plain text the node printed outside of any frame */
+        while (byte != '\n' && (line_buf_ptr - packet_buf) < size - 1) {
+            if (line_buf_ptr != packet_buf || byte != 0) {
+                *line_buf_ptr++ = byte;
+            }
+
+            byte = serial_read_byte();
+        }
+
+        *line_buf_ptr++ = '\0';
+        return (line_buf_ptr - packet_buf > 1) ? line_buf_ptr - packet_buf : 0;
+    }
+
+    if (read_serial_bytes(hdr, sizeof(hdr)) < 0) {
+        return -1;
+    }
+
+    len = (hdr[0] << 8) | hdr[1];
+
+    if (len > size) {
+        uint8_t discard;
+
+        while (len-- && read_serial_bytes(&discard, 1) > 0);
+
+        return 0;
+    }
+
+    return read_serial_bytes(packet_buf, len);
+}
+
+int writepacket(uint8_t *packet_buf, size_t size)
+{
+    uint8_t packet_tmp[BINARY_HDR_LEN + BUFFER_SIZE];
+
+    if (size > BUFFER_SIZE) {
+        return -1;
+    }
+
+    packet_tmp[0] = BINARY_MAGIC;
+    packet_tmp[1] = (uint8_t)(size >> 8);
+    packet_tmp[2] = (uint8_t) size;
+    memcpy(&packet_tmp[BINARY_HDR_LEN], packet_buf, size);
+    write_serial_port(packet_tmp, BINARY_HDR_LEN + size);
+
+    return 0;
+}
+#else
 int readpacket(uint8_t *packet_buf, size_t size)
 {
     uint8_t *line_buf_ptr = packet_buf;
@@ -108,36 +186,35 @@ int readpacket(uint8_t *packet_buf, size_t size)
 
 int writepacket(uint8_t *packet_buf, size_t size)
 {
-    uint8_t packet_tmp[2 * BUFFER_SIZE];
+    uint8_t packet_tmp[2 * BUFFER_SIZE + 1];
     uint8_t *byte_ptr = packet_buf;
     uint8_t *tmp_ptr = packet_tmp;
 
-    if (2 * size + 1 > BUFFER_SIZE) {
+    if (size > BUFFER_SIZE) {
         return -1;
     }
 
     while ((byte_ptr - packet_buf) < size) {
+        /* leave packet_buf intact, it may be resent */
         switch(*byte_ptr) {
             case (END): {
-                *byte_ptr = END_ESC;
-                *tmp_ptr = ESC;
-                tmp_ptr++;
+                *tmp_ptr++ = ESC;
+                *tmp_ptr = END_ESC;
                 break;
             }
 
             case (ESC): {
-                *byte_ptr = ESC_ESC;
-                *tmp_ptr = ESC;
-                tmp_ptr++;
+                *tmp_ptr++ = ESC;
+                *tmp_ptr = ESC_ESC;
                 break;
             }
 
             default: {
+                *tmp_ptr = *byte_ptr;
                 break;
             }
         }
 
-        *tmp_ptr = *byte_ptr;
         byte_ptr++;
         tmp_ptr++;
     }
@@ -147,6 +224,7 @@ int writepacket(uint8_t *packet_buf, size_t size)
 
     return 0;
 }
+#endif
 
 void demultiplex(const border_packet_t *packet, int len)
 {
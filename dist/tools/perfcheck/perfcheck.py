@@ -0,0 +1,327 @@
+#!/usr/bin/env python2
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2014 Freie Universität Berlin
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""
+Headless regression check on BOARD=native, see README.md.
+
+Builds and runs the embunit unittests, tests/bench_kernel and, given two
+tap interfaces, examples/netperf, then compares the measured numbers
+against a baseline file.  The exit code is 0 if all tests passed and no
+number got worse than its tolerance allows.
+"""
+
+from __future__ import print_function
+
+from argparse import ArgumentParser
+from os import environ, read
+from os.path import abspath, dirname, join
+from select import select
+from subprocess import PIPE, Popen
+import re
+import sys
+import time
+
+riotbase = environ.get('RIOTBASE') or abspath(join(dirname(abspath(__file__)), '../' * 3))
+
+DEFAULT_BASELINE = join(dirname(abspath(__file__)), 'baseline.native')
+DEFAULT_TOLERANCE = 25.0
+
+# metrics where a larger number is better, all others are costs
+HIGHER_IS_BETTER = set(['netperf.udp_goodput_bps'])
+
+
+class Failure(Exception):
+    pass
+
+
+class Node(object):
+    """A running native instance, read line by line with a deadline."""
+
+    def __init__(self, elf, args=()):
+        self.proc = Popen([elf] + list(args), stdin=PIPE, stdout=PIPE,
+                          stderr=PIPE)
+        self.buf = b''
+        self.lines = []
+
+    def send(self, line):
+        self.proc.stdin.write((line + '\n').encode('ascii'))
+        self.proc.stdin.flush()
+
+    def expect(self, pattern, timeout):
+        """Returns the match of the first line matching *pattern*."""
+        regex = re.compile(pattern)
+        deadline = time.time() + timeout
+
+        while True:
+            while b'\n' in self.buf:
+                line, self.buf = self.buf.split(b'\n', 1)
+                line = line.decode('ascii', 'replace').rstrip('\r')
+                self.lines.append(line)
+                match = regex.search(line)
+
+                if match:
+                    return match
+
+            left = deadline - time.time()
+
+            if left <= 0:
+                raise Failure('timeout waiting for "%s"' % pattern)
+
+            ready = select([self.proc.stdout], [], [], left)[0]
+
+            if ready:
+                data = read(self.proc.stdout.fileno(), 4096)
+
+                if not data:
+                    raise Failure('exited (%s) before "%s"' %
+                                  (self.proc.wait(), pattern))
+
+                self.buf += data
+
+    def stop(self):
+        if self.proc.poll() is None:
+            self.proc.kill()
+
+        self.proc.wait()
+
+
+def build(project):
+    path = join(riotbase, project)
+    env = dict(environ, BOARD='native', QUIET='1')
+
+    if Popen(['make', '-C', path, 'all'], env=env).wait() != 0:
+        raise Failure('build of %s failed' % project)
+
+    return join(path, 'bin', 'native', project.split('/')[-1] + '.elf')
+
+
+def run_unittests(args):
+    node = Node(build('tests/unittests'))
+
+    try:
+        match = node.expect(r'^(OK \((\d+) tests?\)|run (\d+) failures (\d+))',
+                            args.timeout)
+    finally:
+        node.stop()
+
+    if match.group(2) is None:
+        for line in node.lines:
+            print('    ' + line)
+
+        raise Failure('%s of %s unittests failed' % (match.group(4),
+                                                     match.group(3)))
+
+    print('unittests: %s passed' % match.group(2))
+    return {}
+
+
+def run_bench_kernel(args):
+    elf = build('tests/bench_kernel')
+    results = {}
+
+    # the minimum of several runs is the least disturbed by the host
+    for _ in range(args.runs):
+        node = Node(elf)
+
+        try:
+            node.expect(r'^BENCH start', args.timeout)
+
+            while True:
+                match = node.expect(r'^BENCH (done|(\S+) iterations=(\d+) '
+                                    r'total=(\d+))', args.timeout)
+
+                if match.group(1) == 'done':
+                    break
+
+                name = 'bench_kernel.' + match.group(2)
+                value = float(match.group(4)) / int(match.group(3))
+                results[name] = min(value, results.get(name, value))
+        finally:
+            node.stop()
+
+    return results
+
+
+def run_netperf(args):
+    if len(args.tap) != 2:
+        print('netperf: skipped, needs --tap twice')
+        return {}
+
+    elf = build('examples/netperf')
+    server = Node(elf, [args.tap[0]])
+    client = None
+
+    try:
+        server.expect(r'^netperf', args.timeout)
+        server.send('init 2')
+        server.expect(r'initialized', args.timeout)
+        server.send('server udp')
+
+        client = Node(elf, [args.tap[1]])
+        client.expect(r'^netperf', args.timeout)
+        client.send('init 1')
+        client.expect(r'initialized', args.timeout)
+        client.send('client udp 2 64 %d 5' % args.rate)
+
+        sent = client.expect(r'^NETPERF send .*send_avg_us=(\d+)',
+                             args.timeout + 5)
+        recv = server.expect(r'^NETPERF recv .*packets=(\d+) .*lost=(\d+) '
+                             r'.*goodput_bps=(\d+)', args.timeout)
+    finally:
+        server.stop()
+
+        if client:
+            client.stop()
+
+    packets = int(recv.group(1)) + int(recv.group(2))
+
+    return {
+        'netperf.udp_send_avg_us': float(sent.group(1)),
+        'netperf.udp_goodput_bps': float(recv.group(3)),
+        'netperf.udp_loss_pct': 100.0 * int(recv.group(2)) / (packets or 1),
+    }
+
+
+SUITES = [
+    ('unittests', run_unittests),
+    ('bench_kernel', run_bench_kernel),
+    ('netperf', run_netperf),
+]
+
+
+def read_baseline(path):
+    """Lines of "<name> <value> [<tolerance in percent>]", # comments."""
+    baseline = {}
+
+    try:
+        f = open(path)
+    except IOError:
+        return baseline
+
+    for line in f:
+        fields = line.split('#', 1)[0].split()
+
+        if fields:
+            tolerance = float(fields[2]) if len(fields) > 2 else None
+            baseline[fields[0]] = (float(fields[1]), tolerance)
+
+    return baseline
+
+
+def write_baseline(path, baseline, results):
+    with open(path, 'w') as f:
+        f.write('# <name> <value> [<tolerance in percent>], '
+                'written by perfcheck.py --update\n')
+
+        for name in sorted(results):
+            tolerance = baseline.get(name, (None, None))[1]
+            f.write('%s %.2f%s\n' % (name, results[name],
+                    '' if tolerance is None else ' %g' % tolerance))
+
+
+def compare(baseline, results, default_tolerance):
+    regressions = 0
+
+    print('%-40s %12s %12s %8s' % ('metric', 'baseline', 'now', 'change'))
+
+    for name in sorted(results):
+        value = results[name]
+
+        if name not in baseline:
+            print('%-40s %12s %12.2f %8s  new' % (name, '-', value, '-'))
+            continue
+
+        base, tolerance = baseline[name]
+
+        if tolerance is None:
+            tolerance = default_tolerance
+
+        change = 100.0 * (value - base) / base if base else 0.0
+        worse = -change if name in HIGHER_IS_BETTER else change
+        status = ''
+
+        if worse > tolerance:
+            status = 'REGRESSION'
+            regressions += 1
+        elif worse < -tolerance:
+            status = 'improved, consider --update'
+
+        print('%-40s %12.2f %12.2f %+7.1f%%  %s' % (name, base, value, change,
+                                                    status))
+
+    return regressions
+
+
+def main():
+    parser = ArgumentParser(description='regression check on native')
+    parser.add_argument('--baseline', default=DEFAULT_BASELINE)
+    parser.add_argument('--update', action='store_true',
+                        help='store the measured numbers as the baseline')
+    parser.add_argument('--tolerance', type=float, default=DEFAULT_TOLERANCE,
+                        help='percent, if the baseline has none')
+    parser.add_argument('--runs', type=int, default=3,
+                        help='runs of bench_kernel, the best one counts')
+    parser.add_argument('--timeout', type=float, default=60,
+                        help='seconds to wait for the output of a test')
+    parser.add_argument('--tap', action='append', default=[],
+                        help='tap interface for netperf, give two')
+    parser.add_argument('--rate', type=int, default=50,
+                        help='datagrams per second sent by netperf')
+    parser.add_argument('suites', nargs='*',
+                        help='subset of %s' % ', '.join(s[0] for s in SUITES))
+    args = parser.parse_args()
+
+    results = {}
+    failed = []
+
+    for name, run in SUITES:
+        if args.suites and name not in args.suites:
+            continue
+
+        print('=== %s' % name)
+
+        try:
+            results.update(run(args))
+        except Failure as e:
+            print('%s: FAILED, %s' % (name, e))
+            failed.append(name)
+
+    baseline = read_baseline(args.baseline)
+
+    if args.update:
+        baseline_results = dict((k, v[0]) for k, v in baseline.items())
+        baseline_results.update(results)
+        write_baseline(args.baseline, baseline, baseline_results)
+        print('baseline written to %s' % args.baseline)
+    elif results:
+        print('=== comparison with %s' % args.baseline)
+
+        if compare(baseline, results, args.tolerance):
+            failed.append('performance')
+
+    if failed:
+        print('FAILED: %s' % ', '.join(failed))
+        return 1
+
+    print('PASSED')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
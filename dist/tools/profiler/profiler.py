@@ -0,0 +1,127 @@
+#!/usr/bin/env python2
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2014 Freie Universität Berlin
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""
+Maps the output of profiler_dump(), see sys/include/profiler.h, to the
+functions of an ELF file and prints the share of the samples per thread,
+per function and per function of every thread.
+
+Usage: profiler.py <elf> [log]
+
+The log is read from stdin if not given, lines not starting with "PROF"
+are skipped.  The nm of the toolchain is taken from $NM, e.g.
+NM=arm-none-eabi-nm.
+"""
+
+from __future__ import print_function
+
+from bisect import bisect_right
+from os import environ
+from subprocess import PIPE, Popen
+import sys
+
+
+def read_symbols(elf):
+    nm = Popen([environ.get('NM', 'nm'), '-n', elf], stdout=PIPE)
+    addrs, names = [], []
+
+    for line in nm.stdout:
+        fields = line.decode('ascii', 'replace').split()
+
+        if (len(fields) == 3) and (fields[1] in 'TtWw'):
+            # thumb functions have bit 0 set
+            addrs.append(int(fields[0], 16) & ~1)
+            names.append(fields[2])
+
+    if nm.wait() != 0:
+        sys.exit('%s failed' % environ.get('NM', 'nm'))
+
+    return addrs, names
+
+
+def read_dump(log):
+    header, threads, pcs = None, [], []
+
+    for line in log:
+        fields = line.split()
+
+        if (len(fields) < 2) or (fields[0] != 'PROF'):
+            continue
+
+        if fields[1] == 'begin':
+            header = dict(f.split('=', 1) for f in fields[2:])
+            threads, pcs = [], []
+        elif fields[1] == 'thread':
+            threads.append((fields[2], fields[3], int(fields[4])))
+        elif fields[1] == 'pc':
+            # dumps of older versions have no pid
+            pid = fields[4] if len(fields) > 4 else None
+            pcs.append((int(fields[2], 16), int(fields[3]), pid))
+
+    if header is None:
+        sys.exit('no profiler dump found')
+
+    return header, threads, pcs
+
+
+def print_functions(functions, samples):
+    for name, count in sorted(functions.items(), key=lambda f: -f[1]):
+        print('%6.2f%% %8d  %s' % (100.0 * count / samples, count, name))
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.exit('usage: %s <elf> [log]' % argv[0])
+
+    addrs, names = read_symbols(argv[1])
+    log = open(argv[2]) if len(argv) == 3 else sys.stdin
+    header, threads, pcs = read_dump(log)
+    samples = int(header['samples']) or 1
+
+    print('%s samples every %s us, %s missed' % (header['samples'],
+          header['interval_us'], header['missed']))
+    print()
+
+    for pid, name, count in threads:
+        print('%6.2f%% %8d  thread %s %s' % (100.0 * count / samples, count,
+                                              pid, name))
+    print()
+
+    functions, per_thread = {}, {}
+
+    for pc, count, pid in pcs:
+        i = bisect_right(addrs, pc) - 1
+        name = names[i] if i >= 0 else '0x%08x' % pc
+        functions[name] = functions.get(name, 0) + count
+
+        if pid is not None:
+            thread = per_thread.setdefault(pid, {})
+            thread[name] = thread.get(name, 0) + count
+
+    print_functions(functions, samples)
+
+    for pid, name, count in threads:
+        if pid in per_thread:
+            print()
+            print('thread %s %s' % (pid, name))
+            print_functions(per_thread[pid], samples)
+
+
+if __name__ == '__main__':
+    main(sys.argv)
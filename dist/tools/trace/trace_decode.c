@@ -0,0 +1,148 @@
+/*
+ * Decoder for the dumps of the event tracer
+ *
+ * Reads the output of trace_dump(), see sys/include/trace.h, from a file
+ * or stdin and prints one line per event with the time since the first
+ * event and since the previous one in microseconds.  Other lines are
+ * skipped, so a complete terminal log or the output of a native instance
+ * can be passed.  A summary of the number of events of every kind
+ * follows.
+ *
+ * Usage: trace_decode [file]
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+
+#define TRACE_PID_ISR   (0xff)
+#define TRACE_USER      (0x80)
+
+/* the events of sys/include/trace.h */
+static const char *names[TRACE_USER] = {
+    [1] = "sched_switch",
+    [2] = "msg_send",
+    [3] = "msg_send_int",
+    [4] = "msg_receive",
+    [5] = "msg_drop",
+    [6] = "transceiver_rx",
+    [7] = "transceiver_no_slot",
+    [8] = "transceiver_release",
+    [9] = "lowpan_rx",
+    [10] = "lowpan_deliver",
+    [11] = "lowpan_timeout",
+    [12] = "lowpan_tx",
+};
+
+static unsigned long counts[256];
+
+static const char *event_name(unsigned int event, char *buf, size_t len)
+{
+    if ((event < TRACE_USER) && names[event]) {
+        return names[event];
+    }
+
+    if (event >= TRACE_USER) {
+        snprintf(buf, len, "user+%u", event - TRACE_USER);
+    }
+    else {
+        snprintf(buf, len, "unknown_%u", event);
+    }
+
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    char line[256], name[32];
+    unsigned long hz = 1000000, records = 0, lost = 0;
+    uint32_t first = 0, prev = 0;
+    int dumps = 0, started = 0;
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if ((argc == 2) && ((in = fopen(argv[1], "r")) == NULL)) {
+        err(EXIT_FAILURE, "%s", argv[1]);
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        char *p = strstr(line, "TRACE ");
+        unsigned long time;
+        unsigned int event, pid, arg;
+
+        if (p == NULL) {
+            continue;
+        }
+
+        p += strlen("TRACE ");
+
+        if (sscanf(p, "begin hz=%lu records=%lu lost=%lu", &hz, &records,
+                   &lost) == 3) {
+            dumps++;
+            printf("%sdump %d: %lu events, %lu older ones lost\n",
+                   (dumps > 1) ? "\n" : "", dumps, records, lost);
+            printf("%12s %10s %4s  %-20s %s\n", "time_us", "delta_us",
+                   "pid", "event", "arg");
+            memset(counts, 0, sizeof(counts));
+            started = 0;
+            continue;
+        }
+
+        if (strncmp(p, "end", 3) == 0) {
+            printf("\n");
+
+            for (unsigned int i = 0; i < 256; i++) {
+                if (counts[i]) {
+                    printf("%-20s %lu\n", event_name(i, name, sizeof(name)),
+                           counts[i]);
+                }
+            }
+
+            continue;
+        }
+
+        if (sscanf(p, "%lx %x %x %x", &time, &event, &pid, &arg) != 4) {
+            continue;
+        }
+
+        if (!started) {
+            first = prev = (uint32_t) time;
+            started = 1;
+        }
+
+        /* the differences are right across a wrap of the hwtimer */
+        printf("%12.1f %10.1f ", (double)((uint32_t) time - first) * 1e6 / hz,
+               (double)((uint32_t) time - prev) * 1e6 / hz);
+
+        if (pid == TRACE_PID_ISR) {
+            printf("%4s", "isr");
+        }
+        else {
+            printf("%4u", pid);
+        }
+
+        printf("  %-20s %u\n", event_name(event & 0xff, name, sizeof(name)),
+               arg);
+        counts[event & 0xff]++;
+        prev = (uint32_t) time;
+    }
+
+    if (dumps == 0) {
+        fprintf(stderr, "no trace dump found\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/*
+ * Virtual time coordinator for native instances on a tap bridge
+ *
+ * Listens on the bridge for the requests of instances started with -c,
+ * see cpu/native/vtime.c, and grants the earliest requested deadline once
+ * every instance waits and no data frame is in flight.
+ *
+ * Usage: vtime_coordinator <bridge> <number of instances>
+ *
+ * Needs CAP_NET_RAW, e.g. run it as root.
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <err.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <netpacket/packet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#define NATIVE_ETH_PROTO    (0x1234)
+#define NATIVE_VTIME_PROTO  (0x1235)
+
+#define VTIME_REQUEST       (1)
+#define VTIME_GRANT         (2)
+
+#define VTIME_NEVER         (UINT64_MAX)
+
+#define MAX_NODES           (256)
+
+struct vtime_msg {
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t seq;
+    uint32_t frames;
+    uint32_t time_hi;
+    uint32_t time_lo;
+} __attribute__((packed));
+
+struct node {
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint32_t seq;               /* grant of the last request */
+    uint32_t frames;            /* frame count of the last request */
+    uint32_t expected;          /* frames sent and delivered to the node */
+    uint64_t deadline;
+};
+
+static struct node nodes[MAX_NODES];
+static int known;
+
+static int sock;
+static int ifindex;
+static uint8_t own_mac[ETHER_ADDR_LEN];
+
+static uint32_t grant_seq;
+
+static struct node *find(const uint8_t *mac)
+{
+    for (int i = 0; i < known; i++) {
+        if (memcmp(nodes[i].mac, mac, ETHER_ADDR_LEN) == 0) {
+            return &nodes[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* the first request of an instance tells how many frames it had before */
+static struct node *add(const uint8_t *mac, uint32_t frames)
+{
+    struct node *n = find(mac);
+
+    if (n || (known == MAX_NODES)) {
+        return n;
+    }
+
+    n = &nodes[known++];
+    memcpy(n->mac, mac, ETHER_ADDR_LEN);
+    n->expected = frames;
+    return n;
+}
+
+/*
+ * An instance counts the data frames it sends and the ones its tap
+ * delivers, that is broadcasts of the others and frames sent to it.
+ */
+static void count_frame(const struct ether_header *hdr)
+{
+    struct node *src = find(hdr->ether_shost);
+
+    if (src) {
+        src->expected++;
+    }
+
+    if (hdr->ether_dhost[0] & 0x01) {
+        for (int i = 0; i < known; i++) {
+            if (&nodes[i] != src) {
+                nodes[i].expected++;
+            }
+        }
+    }
+    else {
+        struct node *dst = find(hdr->ether_dhost);
+
+        if (dst) {
+            dst->expected++;
+        }
+    }
+}
+
+static void grant(uint64_t t)
+{
+    uint8_t buf[ETHER_HDR_LEN + ETHER_MIN_LEN];
+    struct ether_header *hdr = (struct ether_header *) buf;
+    struct vtime_msg msg;
+    struct sockaddr_ll addr;
+
+    grant_seq++;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = VTIME_GRANT;
+    msg.seq = htonl(grant_seq);
+    msg.time_hi = htonl((uint32_t)(t >> 32));
+    msg.time_lo = htonl((uint32_t) t);
+
+    memset(buf, 0, sizeof(buf));
+    memset(hdr->ether_dhost, 0xff, ETHER_ADDR_LEN);
+    memcpy(hdr->ether_shost, own_mac, ETHER_ADDR_LEN);
+    hdr->ether_type = htons(NATIVE_VTIME_PROTO);
+    memcpy(buf + ETHER_HDR_LEN, &msg, sizeof(msg));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_ifindex = ifindex;
+    addr.sll_halen = ETHER_ADDR_LEN;
+    memset(addr.sll_addr, 0xff, ETHER_ADDR_LEN);
+
+    if (sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *) &addr,
+               sizeof(addr)) == -1) {
+        err(EXIT_FAILURE, "sendto");
+    }
+}
+
+/* grants the earliest deadline if all instances wait for the last grant */
+static void check(int count)
+{
+    uint64_t t = VTIME_NEVER;
+
+    if (known < count) {
+        return;
+    }
+
+    for (int i = 0; i < known; i++) {
+        /* outdated request or a frame in flight */
+        if ((nodes[i].seq != grant_seq) ||
+            (nodes[i].frames != nodes[i].expected)) {
+            return;
+        }
+
+        if (nodes[i].deadline < t) {
+            t = nodes[i].deadline;
+        }
+    }
+
+    if (t == VTIME_NEVER) {
+        /* nothing left to do until one of them gets input */
+        return;
+    }
+
+    grant(t);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_ll addr;
+    struct ifreq ifr;
+    uint8_t buf[ETHER_MAX_LEN];
+    int count;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <bridge> <number of instances>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    count = atoi(argv[2]);
+
+    if ((count < 1) || (count > MAX_NODES)) {
+        errx(EXIT_FAILURE, "between 1 and %d instances", MAX_NODES);
+    }
+
+    if ((sock = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) == -1) {
+        err(EXIT_FAILURE, "socket");
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, argv[1], IFNAMSIZ - 1);
+
+    if (ioctl(sock, SIOCGIFINDEX, &ifr) == -1) {
+        err(EXIT_FAILURE, "%s", argv[1]);
+    }
+
+    ifindex = ifr.ifr_ifindex;
+
+    if (ioctl(sock, SIOCGIFHWADDR, &ifr) == -1) {
+        err(EXIT_FAILURE, "%s", argv[1]);
+    }
+
+    memcpy(own_mac, ifr.ifr_hwaddr.sa_data, ETHER_ADDR_LEN);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        err(EXIT_FAILURE, "bind");
+    }
+
+    while (1) {
+        struct ether_header *hdr = (struct ether_header *) buf;
+        struct vtime_msg msg;
+        struct node *n;
+        ssize_t len;
+
+        if ((len = recv(sock, buf, sizeof(buf), 0)) == -1) {
+            err(EXIT_FAILURE, "recv");
+        }
+
+        if (len < ETHER_HDR_LEN) {
+            continue;
+        }
+
+        if (ntohs(hdr->ether_type) == NATIVE_ETH_PROTO) {
+            count_frame(hdr);
+            continue;
+        }
+
+        if ((ntohs(hdr->ether_type) != NATIVE_VTIME_PROTO) ||
+            (len < ETHER_HDR_LEN + (ssize_t) sizeof(msg))) {
+            continue;
+        }
+
+        memcpy(&msg, buf + ETHER_HDR_LEN, sizeof(msg));
+
+        if ((msg.type != VTIME_REQUEST) ||
+            ((n = add(hdr->ether_shost, ntohl(msg.frames))) == NULL)) {
+            continue;
+        }
+
+        n->seq = ntohl(msg.seq);
+        n->frames = ntohl(msg.frames);
+        n->deadline = ((uint64_t) ntohl(msg.time_hi) << 32) |
+                      ntohl(msg.time_lo);
+
+        check(count);
+    }
+
+    return 0;
+}
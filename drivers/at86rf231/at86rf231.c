@@ -10,6 +10,10 @@
 #include "at86rf231_arch.h"
 #include "at86rf231_spi.h"
 
+#include "hwtimer.h"
+#include "defer.h"
+#include "energy.h"
+
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
@@ -18,16 +22,29 @@ static uint8_t  radio_channel;
 static uint16_t radio_address;
 static uint64_t radio_address_long;
 
+static uint8_t ext_mode = 1;
+static uint8_t ext_csma_retries = AT86RF231_CSMA_RETRIES;
+static uint8_t ext_frame_retries = AT86RF231_FRAME_RETRIES;
+
+static void write_extended_mode(void);
+
+static void rx_work_handler(defer_t *work);
+
+// the frame buffer is read in the defer thread, not in the interrupt
+static defer_t rx_work = DEFER_INIT(rx_work_handler);
+
+int at86rf231_transceiver_pid;
+
 void at86rf231_init(int tpid)
 {
-    transceiver_pid = tpid;
+    at86rf231_transceiver_pid = tpid;
+    defer_init();
 
     at86rf231_gpio_spi_interrupts_init();
 
     at86rf231_reset();
 
-    // TODO : Enable addr decode, auto ack, auto crc
-    // and configure security, power, channel, pan
+    // TODO : configure security, power, channel, pan
 
     radio_pan = 0;
     radio_pan = 0x00FF & (uint16_t)at86rf231_reg_read(AT86RF231_REG__PAN_ID_0);
@@ -47,11 +64,37 @@ void at86rf231_init(int tpid)
     radio_address_long |= ((uint64_t)at86rf231_reg_read(AT86RF231_REG__IEEE_ADDR_1)) << 48;
     radio_address_long |= ((uint64_t)at86rf231_reg_read(AT86RF231_REG__IEEE_ADDR_1)) << 56;
 
+    // RX_AACK recognizes addresses, RX_ON does not: the driver filters in
+    // software in both modes
+    radio_filter_init(&at86rf231_rx_filter, 0);
+    at86rf231_rx_filter.pan = radio_pan;
+    at86rf231_rx_filter.addr = radio_address;
+
+    // the FCS is added in hardware
+    at86rf231_reg_write(AT86RF231_REG__TRX_CTRL_1,
+                        at86rf231_reg_read(AT86RF231_REG__TRX_CTRL_1) |
+                        AT86RF231_TRX_CTRL_1_MASK__TX_AUTO_CRC_ON);
+
+    // seed the CSMA/CA backoff, differently on every node
+    at86rf231_reg_write(AT86RF231_REG__CSMA_SEED_0, (uint8_t) radio_address_long);
+    at86rf231_reg_write(AT86RF231_REG__CSMA_SEED_1,
+                        (at86rf231_reg_read(AT86RF231_REG__CSMA_SEED_1) &
+                         ~AT86RF231_CSMA_SEED_1_MASK__CSMA_SEED_1) |
+                        ((uint8_t) radio_address &
+                         AT86RF231_CSMA_SEED_1_MASK__CSMA_SEED_1));
+
+    // macMinBE 3 and macMaxBE 5, as the transceiver module backs off
+    at86rf231_reg_write(AT86RF231_REG__CSMA_BE, (5 << 4) | 3);
+
+    write_extended_mode();
     at86rf231_switch_to_rx();
 }
 
 void at86rf231_switch_to_rx(void)
 {
+    uint8_t rx_state = ext_mode ? AT86RF231_TRX_STATE__RX_AACK_ON :
+                       AT86RF231_TRX_STATE__RX_ON;
+
     at86rf231_disable_interrupts();
     // Send a FORCE TRX OFF command
     at86rf231_reg_write(AT86RF231_REG__TRX_STATE, AT86RF231_TRX_STATE__FORCE_TRX_OFF);
@@ -65,8 +108,9 @@ void at86rf231_switch_to_rx(void)
     // Enable IRQ interrupt
     at86rf231_enable_interrupts();
 
-    // Start RX
-    at86rf231_reg_write(AT86RF231_REG__TRX_STATE, AT86RF231_TRX_STATE__RX_ON);
+    // Start RX, the TRX_STATE commands equal the states they lead to
+    at86rf231_reg_write(AT86RF231_REG__TRX_STATE, rx_state);
+    ENERGY_RADIO(ENERGY_RADIO_RX);
 
     // wait until it is on RX_ON state
     uint8_t status;
@@ -78,21 +122,38 @@ void at86rf231_switch_to_rx(void)
         vtimer_usleep(10);
 
         if (!--max_wait) {
-            printf("at86rf231 : ERROR : could not enter RX_ON mode");
+            printf("at86rf231 : ERROR : could not enter RX mode");
             break;
         }
     }
-    while ((status & AT86RF231_TRX_STATUS_MASK__TRX_STATUS) != AT86RF231_TRX_STATUS__RX_ON);
+    while ((status & AT86RF231_TRX_STATUS_MASK__TRX_STATUS) != rx_state);
 }
 
 void at86rf231_rx_irq(void)
 {
+    if (at86rf231_tx_pending) {
+        // the end of a transmission, at86rf231_send() polls for it
+        at86rf231_tx_pending = 0;
+        at86rf231_reg_read(AT86RF231_REG__IRQ_STATUS);
+        return;
+    }
+
+    if (defer_schedule(&rx_work) < 0) {
+        at86rf231_rx_handler();
+    }
+}
+
+static void rx_work_handler(defer_t *work)
+{
+    DEBUG("at86rf231: rx %lu ticks after the interrupt\n", hwtimer_now() - work->time);
+    (void) work;
     at86rf231_rx_handler();
 }
 
 radio_address_t at86rf231_set_address(radio_address_t address)
 {
     radio_address = address;
+    at86rf231_rx_filter.addr = radio_address;
 
     at86rf231_reg_write(AT86RF231_REG__SHORT_ADDR_0, (uint8_t)(0x00FF & radio_address));
     at86rf231_reg_write(AT86RF231_REG__SHORT_ADDR_1, (uint8_t)(radio_address >> 8));
@@ -129,6 +190,7 @@ uint64_t at86rf231_get_address_long(void)
 uint16_t at86rf231_set_pan(uint16_t pan)
 {
     radio_pan = pan;
+    at86rf231_rx_filter.pan = radio_pan;
 
     at86rf231_reg_write(AT86RF231_REG__PAN_ID_0, (uint8_t)(0x00FF & radio_pan));
     at86rf231_reg_write(AT86RF231_REG__PAN_ID_1, (uint8_t)(radio_pan >> 8));
@@ -164,6 +226,43 @@ uint8_t at86rf231_get_channel(void)
 
 void at86rf231_set_monitor(uint8_t mode)
 {
-    (void) mode;
-    // TODO
+    uint8_t xah_ctrl_1 = at86rf231_reg_read(AT86RF231_REG__XAH_CTRL_1);
+
+    at86rf231_rx_filter.monitor = mode;
+
+    // RX_AACK hands up every frame with a valid PHR in promiscuous mode
+    if (mode) {
+        xah_ctrl_1 |= AT86RF231_XAH_CTRL_1_MASK__AACK_PROM_MODE;
+    }
+    else {
+        xah_ctrl_1 &= ~AT86RF231_XAH_CTRL_1_MASK__AACK_PROM_MODE;
+    }
+
+    at86rf231_reg_write(AT86RF231_REG__XAH_CTRL_1, xah_ctrl_1);
+}
+
+void at86rf231_set_extended_mode(uint8_t on, uint8_t csma_retries,
+                                 uint8_t frame_retries)
+{
+    ext_mode = on;
+    ext_csma_retries = (csma_retries > 5) ? 5 : csma_retries;
+    ext_frame_retries = (frame_retries > 15) ? 15 : frame_retries;
+
+    write_extended_mode();
+    at86rf231_switch_to_rx();
+}
+
+uint8_t at86rf231_get_extended_mode(void)
+{
+    return ext_mode;
+}
+
+static void write_extended_mode(void)
+{
+    // unslotted CSMA/CA, MAX_CSMA_RETRIES 7 would send without CCA
+    at86rf231_reg_write(AT86RF231_REG__XAH_CTRL_0,
+                        ((ext_frame_retries << 4) &
+                         AT86RF231_XAH_CTRL_0_MASK__MAX_FRAME_RETRIES) |
+                        ((ext_csma_retries << 1) &
+                         AT86RF231_XAH_CTRL_0_MASK__MAX_CSMA_RETRIES));
 }
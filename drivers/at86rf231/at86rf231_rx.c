@@ -3,6 +3,7 @@
 #include "at86rf231_arch.h"
 #include "at86rf231_spi.h"
 
+#include "radio/filter.h"
 #include "transceiver.h"
 #include "msg.h"
 
@@ -15,16 +16,31 @@
 at86rf231_packet_t at86rf231_rx_buffer[AT86RF231_RX_BUF_SIZE];
 uint8_t buffer[AT86RF231_RX_BUF_SIZE][AT86RF231_MAX_PKT_LENGTH];
 volatile uint8_t rx_buffer_next;
+radio_filter_t at86rf231_rx_filter;
 
 void at86rf231_rx_handler(void)
 {
-    uint8_t lqi, fcs_rssi;
-    // read packet length
-    at86rf231_read_fifo(&at86rf231_rx_buffer[rx_buffer_next].length, 1);
+    uint8_t lqi, fcs_rssi, hdr_len;
+    uint8_t *buf = buffer[rx_buffer_next];
+
+    // every frame buffer access starts at the length byte, so read it
+    // together with the header and only fetch the rest if the frame is wanted
+    at86rf231_read_fifo(buf, 1 + RADIO_FILTER_IEEE802154_HDR_LEN);
+    at86rf231_rx_buffer[rx_buffer_next].length = buf[0];
+    hdr_len = (buf[0] < RADIO_FILTER_IEEE802154_HDR_LEN) ?
+              buf[0] : RADIO_FILTER_IEEE802154_HDR_LEN;
+
+    if (!radio_filter_ieee802154(&at86rf231_rx_filter, &buf[1], hdr_len)) {
+        DEBUG("Dropped filtered frame.\n");
+        // Read IRQ to clear it
+        at86rf231_reg_read(AT86RF231_REG__IRQ_STATUS);
+        return;
+    }
 
     // read psdu, read packet with length as first byte and lqi as last byte.
-    uint8_t *buf = buffer[rx_buffer_next];
-    at86rf231_read_fifo(buf, at86rf231_rx_buffer[rx_buffer_next].length);
+    if (buf[0] > 1 + RADIO_FILTER_IEEE802154_HDR_LEN) {
+        at86rf231_read_fifo(buf, at86rf231_rx_buffer[rx_buffer_next].length);
+    }
 
     // read lqi which is appended after the psdu
     lqi = buf[at86rf231_rx_buffer[rx_buffer_next].length - 1];
@@ -53,11 +69,12 @@ void at86rf231_rx_handler(void)
 #endif
 
         /* notify transceiver thread if any */
-        if (transceiver_pid) {
+        if (at86rf231_transceiver_pid) {
             msg_t m;
             m.type = (uint16_t) RCV_PKT_AT86RF231;
             m.content.value = rx_buffer_next;
-            msg_send_int(&m, transceiver_pid);
+            // runs in the defer thread or, without it, in the ISR
+            msg_send(&m, at86rf231_transceiver_pid, false);
         }
     }
     else {
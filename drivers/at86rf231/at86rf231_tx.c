@@ -2,10 +2,17 @@
 #include "at86rf231_arch.h"
 #include "at86rf231_spi.h"
 
-static void at86rf231_xmit(uint8_t *data, uint8_t length);
+#include "transceiver.h"
+#include "energy.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+static int16_t at86rf231_xmit(uint8_t *data, uint8_t length);
+static void at86rf231_set_state(uint8_t state);
 static void at86rf231_gen_pkt(uint8_t *buf, at86rf231_packet_t *packet);
 
-static uint8_t sequenz_nr;
+volatile uint8_t at86rf231_tx_pending;
 
 int16_t at86rf231_send(at86rf231_packet_t *packet)
 {
@@ -35,9 +42,7 @@ int16_t at86rf231_send(at86rf231_packet_t *packet)
     }
 
     packet->frame.src_pan_id = at86rf231_get_pan();
-    packet->frame.seq_nr = sequenz_nr;
-
-    sequenz_nr += 1;
+    /* the sequence number comes with the frame, retries keep it */
 
     // calculate size of the frame (payload + FCS) */
     packet->length = ieee802154_frame_get_hdr_len(&packet->frame) +
@@ -54,16 +59,81 @@ int16_t at86rf231_send(at86rf231_packet_t *packet)
     at86rf231_gen_pkt(pkt, packet);
 
     // transmit packet
-    at86rf231_xmit(pkt, packet->length);
-    return packet->length;
+    int16_t res = at86rf231_xmit(pkt, packet->length);
+
+    return (res < 0) ? res : packet->length;
 }
 
-static void at86rf231_xmit(uint8_t *data, uint8_t length)
+/*
+ * Sends the frame and waits until it is done. In the extended operating
+ * mode the radio backs off, retries and waits for the acknowledgement by
+ * itself, TRAC_STATUS tells how it went.
+ */
+static int16_t at86rf231_xmit(uint8_t *data, uint8_t length)
 {
-    // Go to state PLL_ON
-    at86rf231_reg_write(AT86RF231_REG__TRX_STATE, AT86RF231_TRX_STATE__PLL_ON);
+    uint8_t ext_mode = at86rf231_get_extended_mode();
+    int16_t res = 0;
+
+    // Go to state PLL_ON, a frame being received is finished first
+    at86rf231_set_state(AT86RF231_TRX_STATE__PLL_ON);
+    ENERGY_RADIO(ENERGY_RADIO_IDLE);
+
+    if (ext_mode) {
+        at86rf231_set_state(AT86RF231_TRX_STATE__TX_ARET_ON);
+    }
+
+    // copy the packet to the radio FIFO
+    at86rf231_write_fifo(data, length);
+
+    // Start TX
+    at86rf231_tx_pending = 1;
+    at86rf231_reg_write(AT86RF231_REG__TRX_STATE, AT86RF231_TRX_STATE__TX_START);
+    // in the extended operating mode the backoffs and the ACK count as well
+    ENERGY_RADIO(ENERGY_RADIO_TX);
+
+    for (unsigned i = 0; at86rf231_tx_pending; i++) {
+        if (i >= AT86RF231_TX_TIMEOUT_US / AT86RF231_TX_POLL_US) {
+            printf("at86rf231 : ERROR : transmission did not end");
+            at86rf231_tx_pending = 0;
+            res = -1;
+            break;
+        }
 
-    // wait until it is on PLL_ON state
+        vtimer_usleep(AT86RF231_TX_POLL_US);
+    }
+
+    if (ext_mode && (res == 0)) {
+        switch (at86rf231_reg_read(AT86RF231_REG__TRX_STATE) &
+                AT86RF231_TRX_STATE_MASK__TRAC) {
+            case AT86RF231_TRAC_STATUS__SUCCESS:
+            case AT86RF231_TRAC_STATUS__SUCCESS_DATA_PENDING:
+                break;
+
+            case AT86RF231_TRAC_STATUS__NO_ACK:
+                DEBUG("at86rf231: no ACK\n");
+                res = TRANSCEIVER_TX_NOACK;
+                break;
+
+            case AT86RF231_TRAC_STATUS__CHANNEL_ACCESS_FAILURE:
+                DEBUG("at86rf231: channel busy\n");
+                res = TRANSCEIVER_TX_CHANNEL_BUSY;
+                break;
+
+            default:
+                res = -1;
+                break;
+        }
+    }
+
+    at86rf231_switch_to_rx();
+    return res;
+}
+
+static void at86rf231_set_state(uint8_t state)
+{
+    at86rf231_reg_write(AT86RF231_REG__TRX_STATE, state);
+
+    // wait until it is in the state, the commands equal the states
     uint8_t status;
     uint8_t max_wait = 100;   // TODO : move elsewhere, this is in 10us
 
@@ -73,17 +143,11 @@ static void at86rf231_xmit(uint8_t *data, uint8_t length)
         vtimer_usleep(10);
 
         if (!--max_wait) {
-            printf("at86rf231 : ERROR : could not enter PLL_ON mode");
+            printf("at86rf231 : ERROR : could not enter state %02x", state);
             break;
         }
     }
-    while ((status & AT86RF231_TRX_STATUS_MASK__TRX_STATUS) != AT86RF231_TRX_STATUS__PLL_ON);
-
-    // copy the packet to the radio FIFO
-    at86rf231_write_fifo(data, length);
-
-    // Start TX
-    at86rf231_reg_write(AT86RF231_REG__TRX_STATE, AT86RF231_TRX_STATE__TX_START);
+    while ((status & AT86RF231_TRX_STATUS_MASK__TRX_STATUS) != state);
 }
 
 /**
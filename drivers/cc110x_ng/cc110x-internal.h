@@ -69,6 +69,21 @@
 #define PKT_LENGTH_CONFIG   (0x03)      ///< Bitmask (=00000011) for reading LENGTH_CONFIG in PKTCTRL0 configuration register.
 /** @} */
 
+/**
+ * @name    Bitmasks for wake-on-radio
+ * @{
+ */
+#define MCSM2_RX_TIME_RSSI  (0x10)      ///< End RX early if there is no carrier.
+#define MCSM2_RX_TIME_QUAL  (0x08)      ///< Stay in RX at the timeout if a preamble was found.
+#define MCSM2_RX_TIME_END   (0x07)      ///< No RX timeout, stay in RX until the end of a packet.
+#define MCSM0_FS_AUTOCAL    (0x30)      ///< Bitmask (=00110000) for FS_AUTOCAL in MCSM0.
+#define FS_AUTOCAL_4TH      (0x30)      ///< Calibrate every 4th time from IDLE to RX/TX.
+#define WORCTRL_RC_PD       (0x80)      ///< Power down the RC oscillator, disables WOR.
+#define WORCTRL_EVENT1      (0x70)      ///< EVENT1 = 48 RC periods (~1.4 ms) for the crystal to settle.
+#define WORCTRL_RC_CAL      (0x08)      ///< Calibrate the RC oscillator automatically.
+#define RX_TIME_MAX         (6)         ///< Last RX_TIME for WOR_RES 0, listens EVENT0 / 2^(3+RX_TIME).
+/** @} */
+
 /**
  * @name    Definitions to support burst/single access
  * @{
@@ -27,20 +27,12 @@
 #include "cpu-conf.h"
 #include "cpu.h"
 
-#ifdef DBG_IGNORE
-#include <stdio.h>
-#include <string.h>
-#define IGN_MAX     (10)
-
-radio_address_t ignored_addr[IGN_MAX];
-static uint8_t is_ignored(radio_address_t addr);
-#endif
-
 static uint8_t receive_packet_variable(uint8_t *rxBuffer, uint8_t length);
 static uint8_t receive_packet(uint8_t *rxBuffer, uint8_t length);
 
 rx_buffer_t cc110x_rx_buffer[RX_BUF_SIZE];          ///< RX buffer
 volatile uint8_t rx_buffer_next;        ///< Next packet in RX queue
+radio_filter_t cc110x_rx_filter;        ///< Senders dropped before payload read
 
 void cc110x_rx_handler(void)
 {
@@ -70,26 +62,15 @@ void cc110x_rx_handler(void)
          * So put CC1100 to RX for WOR_TIMEOUT (have to manually put
          * the radio back to sleep/WOR). */
         //cc110x_spi_write_reg(CC1100_MCSM0, 0x08); /* Turn off FS-Autocal */
-        cc110x_write_reg(CC1100_MCSM2, 0x07);   /* Configure RX_TIME (until end of packet) */
-        cc110x_strobe(CC1100_SRX);
+        cc110x_setup_rx_mode();     /* Configure RX_TIME (until end of packet) */
         hwtimer_wait(IDLE_TO_RX_TIME);
-        radio_state = RADIO_RX;
-
-#ifdef DBG_IGNORE
-
-        if (is_ignored(cc110x_rx_buffer[rx_buffer_next].packet.phy_src)) {
-            LED_RED_TOGGLE;
-            return;
-        }
-
-#endif
 
         /* notify transceiver thread if any */
-        if (transceiver_pid) {
+        if (cc110x_transceiver_pid) {
             msg_t m;
             m.type = (uint16_t) RCV_PKT_CC1100;
             m.content.value = rx_buffer_next;
-            msg_send_int(&m, transceiver_pid);
+            msg_send_int(&m, cc110x_transceiver_pid);
         }
 
         /* shift to next buffer element */
@@ -122,7 +103,12 @@ void cc110x_rx_handler(void)
         }
 
         /* No valid packet, so go back to RX/WOR as soon as possible */
-        cc110x_switch_to_rx();
+        if (radio_state == RADIO_WOR) {
+            cc110x_switch_to_wor();
+        }
+        else {
+            cc110x_switch_to_rx();
+        }
     }
 }
 
@@ -142,9 +128,24 @@ static uint8_t receive_packet_variable(uint8_t *rxBuffer, uint8_t length)
             /* Put length byte at first position in RX Buffer */
             rxBuffer[0] = packetLength;
 
+            /* Read destination, source and flags first, frames from
+             * ignored senders are flushed without reading the payload */
+            if (packetLength < CC1100_HEADER_LENGTH) {
+                return 0;
+            }
+
+            cc110x_read_fifo((char *) rxBuffer + 1, CC1100_HEADER_LENGTH);
+
+            if (radio_filter_is_ignored(&cc110x_rx_filter,
+                                        ((cc110x_packet_t *) rxBuffer)->phy_src)) {
+                cc110x_statistic.packets_in_filtered++;
+                return 0;
+            }
+
             /* Read the rest of the packet */
             //cc110x_readburst_reg(CC1100_RXFIFO, (char*)rxBuffer+1, packetLength);
-            cc110x_read_fifo((char *) rxBuffer + 1, packetLength);
+            cc110x_read_fifo((char *) rxBuffer + 1 + CC1100_HEADER_LENGTH,
+                             packetLength - CC1100_HEADER_LENGTH);
 
             /* Read the 2 appended status bytes (status[0] = RSSI, status[1] = LQI) */
             cc110x_readburst_reg(CC1100_RXFIFO, (char *)status, 2);
@@ -193,35 +194,11 @@ static uint8_t receive_packet(uint8_t *rxBuffer, uint8_t length)
 #ifdef DBG_IGNORE
 void cc110x_init_ignore(void)
 {
-    memset(ignored_addr, 0, IGN_MAX * sizeof(radio_address_t));
+    radio_filter_ignore_clear(&cc110x_rx_filter);
 }
 
 uint8_t cc110x_add_ignored(radio_address_t addr)
 {
-    uint8_t i = 0;
-
-    while ((i < IGN_MAX) && ignored_addr[i++]) {
-        printf("i: %hu\n", i);
-    }
-
-    if (i > IGN_MAX) {
-        return 0;
-    }
-
-    ignored_addr[i - 1] = addr;
-    return 1;
-}
-
-static uint8_t is_ignored(radio_address_t addr)
-{
-    uint8_t i;
-
-    for (i = 0; i < IGN_MAX; i++) {
-        if (ignored_addr[i] == addr) {
-            return 1;
-        }
-    }
-
-    return 0;
+    return (radio_filter_ignore_add(&cc110x_rx_filter, addr) >= 0);
 }
 #endif
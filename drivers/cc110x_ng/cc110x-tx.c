@@ -22,11 +22,13 @@
 #include "cc110x-internal.h"
 
 #include "irq.h"
+#include "energy.h"
 
 int8_t cc110x_send(cc110x_packet_t *packet)
 {
     volatile uint32_t abort_count;
     uint8_t size;
+    uint8_t old_state = radio_state;
     /* TODO: burst sending */
     radio_state = RADIO_SEND_BURST;
     rflags.LL_ACK = 0;
@@ -53,6 +55,7 @@ int8_t cc110x_send(cc110x_packet_t *packet)
 
     /* But CC1100 in IDLE mode to flush the FIFO */
     cc110x_strobe(CC1100_SIDLE);
+    ENERGY_RADIO(ENERGY_RADIO_IDLE);
     /* Flush TX FIFO to be sure it is empty */
     cc110x_strobe(CC1100_SFTX);
     /* Write packet into TX FIFO */
@@ -61,6 +64,7 @@ int8_t cc110x_send(cc110x_packet_t *packet)
     abort_count = 0;
     unsigned int cpsr = disableIRQ();
     cc110x_strobe(CC1100_STX);
+    ENERGY_RADIO(ENERGY_RADIO_TX);
 
     /* Wait for GDO2 to be set -> sync word transmitted */
     while (cc110x_get_gdo2() == 0) {
@@ -88,7 +92,12 @@ int8_t cc110x_send(cc110x_packet_t *packet)
     rflags.TX = 0;
 
     /* Go to mode after TX (CONST_RX -> RX, WOR -> WOR) */
-    cc110x_switch_to_rx();
+    if (old_state == RADIO_WOR) {
+        cc110x_switch_to_wor();
+    }
+    else {
+        cc110x_switch_to_rx();
+    }
 
     return size;
 }
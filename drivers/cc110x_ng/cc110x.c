@@ -22,6 +22,7 @@
 #include "hwtimer.h"
 #include "config.h"
 #include "cpu.h"
+#include "energy.h"
 
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
@@ -40,6 +41,10 @@ volatile uint8_t radio_state = RADIO_UNKNOWN;       ///< Radio state
 static radio_address_t radio_address;                     ///< Radio address
 static uint8_t radio_channel;                             ///< Radio channel
 
+static uint16_t wor_event0;                               ///< WOR interval, 0 if disabled
+static uint8_t wor_rx_time;                               ///< WOR RX_TIME
+static uint8_t wor_regs;                                  ///< MCSM0/2 hold the WOR settings
+
 /* internal function prototypes */
 static int rd_set_mode(int mode);
 static void reset(void);
@@ -49,10 +54,12 @@ static void write_register(uint8_t r, uint8_t value);
 /*---------------------------------------------------------------------------*
  *                              Radio Driver API                             *
  *---------------------------------------------------------------------------*/
+int cc110x_transceiver_pid;
+
 void cc110x_init(int tpid)
 {
-    transceiver_pid = tpid;
-    DEBUG("Transceiver PID: %i\n", transceiver_pid);
+    cc110x_transceiver_pid = tpid;
+    DEBUG("Transceiver PID: %i\n", cc110x_transceiver_pid);
 
     rx_buffer_next = 0;
 
@@ -89,12 +96,10 @@ void cc110x_init(int tpid)
 #endif
     DEBUG("CC1100 initialized and set to channel %i\n", radio_channel);
 
+    radio_filter_init(&cc110x_rx_filter, 0);
+
     /* Switch to desired mode (WOR or RX) */
     rd_set_mode(RADIO_MODE_ON);
-
-#ifdef DBG_IGNORE
-    cc110x_init_ignore();
-#endif
 }
 
 void cc110x_disable_interrupts(void)
@@ -169,25 +174,108 @@ void cc110x_set_monitor(uint8_t mode)
 void cc110x_setup_rx_mode(void)
 {
     /* Stay in RX mode until end of packet */
-    cc110x_write_reg(CC1100_MCSM2, 0x07);
+    cc110x_write_reg(CC1100_MCSM2, MCSM2_RX_TIME_END);
+    cc110x_write_reg(CC1100_MCSM0, cc110x_conf[CC1100_MCSM0]);
+    wor_regs = 0;
     cc110x_switch_to_rx();
 }
 
 void cc110x_switch_to_rx(void)
 {
+    if (wor_regs) {
+        /* RX would time out as after a wake up */
+        cc110x_wakeup_from_rx();
+        cc110x_setup_rx_mode();
+        return;
+    }
+
     radio_state = RADIO_RX;
     cc110x_strobe(CC1100_SRX);
+    ENERGY_RADIO(ENERGY_RADIO_RX);
+}
+
+int cc110x_set_wor(uint32_t interval, uint32_t listen)
+{
+    /* EVENT0 counts 750 crystal periods at WOR_RES 0 */
+    uint32_t event0 = ((uint64_t) interval * (CC1100_XOSC_FREQ / 1000)) / 750000;
+    uint8_t rx_time = 0;
+    uint8_t old_state;
+
+    if (interval == 0) {
+        wor_event0 = 0;
+        return 1;
+    }
+
+    if ((event0 == 0) || (event0 > 0xffff)) {
+        return 0;
+    }
+
+    /* the shortest listen window still covering *listen* */
+    while ((rx_time < RX_TIME_MAX) && ((interval >> (4 + rx_time)) >= listen)) {
+        rx_time++;
+    }
+
+    if ((event0 == wor_event0) && (rx_time == wor_rx_time)) {
+        return 1;
+    }
+
+    old_state = radio_state;
+    cc110x_wakeup_from_rx();
+
+    cc110x_write_reg(CC1100_WOREVT1, event0 >> 8);
+    cc110x_write_reg(CC1100_WOREVT0, event0 & 0xff);
+    cc110x_write_reg(CC1100_WORCTRL, WORCTRL_EVENT1 | WORCTRL_RC_CAL);
+    cc110x_strobe(CC1100_SWORRST);
+
+    wor_event0 = event0;
+    wor_rx_time = rx_time;
+    /* MCSM2 gets the new RX_TIME */
+    wor_regs = 0;
+
+    if (old_state == RADIO_WOR) {
+        cc110x_switch_to_wor();
+    }
+    else if (old_state == RADIO_RX) {
+        cc110x_switch_to_rx();
+    }
+
+    return 1;
+}
+
+void cc110x_switch_to_wor(void)
+{
+    if (wor_event0 == 0) {
+        cc110x_switch_to_pwd();
+        return;
+    }
+
+    cc110x_wakeup_from_rx();
+
+    if (!wor_regs) {
+        cc110x_write_reg(CC1100_MCSM2, MCSM2_RX_TIME_RSSI | MCSM2_RX_TIME_QUAL |
+                         wor_rx_time);
+        /* calibrating on every wake up would cost more than listening */
+        cc110x_write_reg(CC1100_MCSM0, (cc110x_conf[CC1100_MCSM0] & ~MCSM0_FS_AUTOCAL) |
+                         FS_AUTOCAL_4TH);
+        wor_regs = 1;
+    }
+
+    /* the WOR timer keeps running, wake ups stay in phase */
+    cc110x_strobe(CC1100_SWOR);
+    radio_state = RADIO_WOR;
+    ENERGY_RADIO(ENERGY_RADIO_WOR);
 }
 
 void cc110x_wakeup_from_rx(void)
 {
-    if (radio_state != RADIO_RX) {
+    if ((radio_state != RADIO_RX) && (radio_state != RADIO_WOR)) {
         return;
     }
 
     DEBUG("CC1100 going to idle\n");
     cc110x_strobe(CC1100_SIDLE);
     radio_state = RADIO_IDLE;
+    ENERGY_RADIO(ENERGY_RADIO_IDLE);
 }
 
 char *cc110x_get_marc_state(void)
@@ -206,7 +294,10 @@ char *cc110x_get_marc_state(void)
 
     /* Have to put radio back to WOR/RX if old radio state
      * was WOR/RX, otherwise no action is necessary */
-    if (old_state == RADIO_WOR || old_state == RADIO_RX) {
+    if (old_state == RADIO_WOR) {
+        cc110x_switch_to_wor();
+    }
+    else if (old_state == RADIO_RX) {
         cc110x_switch_to_rx();
     }
 
@@ -309,6 +400,7 @@ void cc110x_switch_to_pwd(void)
     cc110x_wakeup_from_rx();
     cc110x_strobe(CC1100_SPWD);
     radio_state = RADIO_PWD;
+    ENERGY_RADIO(ENERGY_RADIO_OFF);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -369,6 +461,7 @@ static void power_up_reset(void)
     hwtimer_wait(RESET_WAIT_TIME);
     reset();
     radio_state = RADIO_IDLE;
+    ENERGY_RADIO(ENERGY_RADIO_IDLE);
 }
 
 static void write_register(uint8_t r, uint8_t value)
@@ -382,7 +475,10 @@ static void write_register(uint8_t r, uint8_t value)
 
     /* Have to put radio back to WOR/RX if old radio state
      * was WOR/RX, otherwise no action is necessary */
-    if ((old_state == RADIO_WOR) || (old_state == RADIO_RX)) {
+    if (old_state == RADIO_WOR) {
+        cc110x_switch_to_wor();
+    }
+    else if (old_state == RADIO_RX) {
         cc110x_switch_to_rx();
     }
 }
@@ -36,18 +36,27 @@
 //                      CC1100 SPI access
 /*---------------------------------------------------------------------------*/
 
+#ifndef CC110X_TXRX_BURST
+void cc110x_txrx_burst(const char *tx, char *rx, uint8_t count)
+{
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        char c = cc110x_txrx(tx ? tx[i] : CC1100_NOBYTE);
+
+        if (rx) {
+            rx[i] = c;
+        }
+    }
+}
+#endif
+
 uint8_t cc110x_writeburst_reg(uint8_t addr, char *src, uint8_t count)
 {
-    int i = 0;
     unsigned int cpsr = disableIRQ();
     cc110x_spi_select();
     cc110x_txrx(addr | CC1100_WRITE_BURST);
-
-    while (i < count) {
-        cc110x_txrx(src[i]);
-        i++;
-    }
-
+    cc110x_txrx_burst(src, NULL, count);
     cc110x_spi_unselect();
     restoreIRQ(cpsr);
     return count;
@@ -55,16 +64,10 @@ uint8_t cc110x_writeburst_reg(uint8_t addr, char *src, uint8_t count)
 
 void cc110x_readburst_reg(uint8_t addr, char *buffer, uint8_t count)
 {
-    int i = 0;
     unsigned int cpsr = disableIRQ();
     cc110x_spi_select();
     cc110x_txrx(addr | CC1100_READ_BURST);
-
-    while (i < count) {
-        buffer[i] = cc110x_txrx(CC1100_NOBYTE);
-        i++;
-    }
-
+    cc110x_txrx_burst(NULL, buffer, count);
     cc110x_spi_unselect();
     restoreIRQ(cpsr);
 }
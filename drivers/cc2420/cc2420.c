@@ -11,16 +11,28 @@
 #include "cc2420_settings.h"
 #include "cc2420_arch.h"
 #include "hwtimer.h"
+#include "defer.h"
+#include "energy.h"
 
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
 
 /* Radio driver API */
 
+int cc2420_transceiver_pid;
+
+static void rx_work_handler(defer_t *work);
+
+/* the FIFO is read in the defer thread, not in the FIFOP interrupt */
+static defer_t rx_work = DEFER_INIT(rx_work_handler);
+
 void cc2420_init(int tpid)
 {
     uint16_t reg;
-    transceiver_pid = tpid;
+    cc2420_transceiver_pid = tpid;
+    defer_init();
+    /* ADR_DECODE below checks PAN and destination in hardware */
+    radio_filter_init(&cc2420_rx_filter, RADIO_FILTER_HW_ADDR);
 
     cc2420_spi_init();
     hwtimer_wait(CC2420_WAIT_TIME);
@@ -30,6 +42,8 @@ void cc2420_init(int tpid)
 
     while ((cc2420_strobe(NOBYTE) & 0x40) == 0);       //wait for crystal to be stable
 
+    ENERGY_RADIO(ENERGY_RADIO_IDLE);
+
     hwtimer_wait(CC2420_WAIT_TIME);
 
     reg = cc2420_read_reg(CC2420_REG_MDMCTRL0);
@@ -70,24 +84,34 @@ void cc2420_switch_to_rx(void)
     cc2420_strobe(CC2420_STROBE_FLUSHRX);
     cc2420_strobe(CC2420_STROBE_FLUSHRX);
     cc2420_strobe(CC2420_STROBE_RXON);
+    ENERGY_RADIO(ENERGY_RADIO_RX);
 }
 
 void cc2420_rxoverflow_irq(void)
 {
-    cc2420_strobe(CC2420_STROBE_FLUSHRX);
-    //Datasheets says do this twice...
-    cc2420_strobe(CC2420_STROBE_FLUSHRX);
+    /* the frames complete before the overflow are read before the FIFO
+     * is flushed, see cc2420_rx_handler() */
+    cc2420_rx_irq();
 }
 
 void cc2420_rx_irq(void)
 {
-    cc2420_rx_handler();
+    if (defer_schedule(&rx_work) < 0) {
+        cc2420_rx_handler(hwtimer_now());
+    }
+}
+
+static void rx_work_handler(defer_t *work)
+{
+    DEBUG("cc2420: rx %lu ticks after FIFOP\n", hwtimer_now() - work->time);
+    cc2420_rx_handler(work->time);
 }
 
 void cc2420_set_monitor(uint8_t mode)
 {
     uint16_t reg;
     reg = cc2420_read_reg(CC2420_REG_MDMCTRL0);
+    cc2420_rx_filter.monitor = mode;
 
     if (mode) {
         reg &= ~CC2420_ADR_DECODE;
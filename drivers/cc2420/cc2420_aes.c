@@ -0,0 +1,85 @@
+/**
+  * cc2420_aes.c - AES engine on the stand-alone encryption of the cc2420.
+  * Copyright (C) 2013 Milan Babel <babel@inf.fu-berlin.de>
+  *
+  * This source code is licensed under the GNU Lesser General Public License,
+  * Version 2.  See the file LICENSE for more details.
+  */
+
+#include <string.h>
+
+#include "cc2420.h"
+#include "cc2420_spi.h"
+#include "cc2420_settings.h"
+#include "crypto/aes.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+/* context whose key is in CC2420_RAM_KEY0 */
+static const aes_ctx_t *loaded;
+
+/* the radio stores keys and data with the most significant byte last */
+static void reverse(uint8_t *dst, const uint8_t *src)
+{
+    uint8_t i;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++) {
+        dst[i] = src[AES_BLOCK_SIZE - 1 - i];
+    }
+}
+
+static void load_key(const aes_ctx_t *ctx)
+{
+    uint8_t buf[AES_KEY_SIZE];
+
+    reverse(buf, (const uint8_t *) ctx->key.rd_key);
+    cc2420_write_ram(CC2420_RAM_KEY0, buf, AES_KEY_SIZE);
+    loaded = ctx;
+}
+
+static int hw_set_key(aes_ctx_t *ctx, const uint8_t *key, uint8_t keysize)
+{
+    if (keysize != AES_KEY_SIZE) {
+        return -2;
+    }
+
+    /* kept in the context to reload it after another context was used */
+    memcpy(ctx->key.rd_key, key, AES_KEY_SIZE);
+    ctx->key.rounds = 10;
+    load_key(ctx);
+    return 0;
+}
+
+static void hw_encrypt(const aes_ctx_t *ctx, const uint8_t *in, uint8_t *out)
+{
+    uint8_t buf[AES_BLOCK_SIZE];
+
+    if (loaded != ctx) {
+        load_key(ctx);
+    }
+
+    reverse(buf, in);
+    cc2420_write_ram(CC2420_RAM_SABUF, buf, AES_BLOCK_SIZE);
+    cc2420_strobe(CC2420_STROBE_AES);
+
+    /* 14 us per block */
+    while (cc2420_strobe(CC2420_STROBE_NOP) & CC2420_STATUS_ENC_BUSY);
+
+    cc2420_read_ram(CC2420_RAM_SABUF, buf, AES_BLOCK_SIZE);
+    reverse(out, buf);
+    DEBUG("cc2420: encrypted block\n");
+}
+
+const aes_engine_t cc2420_aes_engine = {
+    hw_set_key,
+    hw_encrypt
+};
+
+crypto_provider_t cc2420_crypto_provider = {
+    "cc2420",
+    CRYPTO_PROVIDER_HW | CRYPTO_PROVIDER_KEY_128,
+    CC2420_AES_RANK,
+    &cc2420_aes_engine,
+    NULL
+};
@@ -14,23 +14,83 @@
 #include "cc2420_spi.h"
 #include "ieee802154_frame.h"
 
+#include "radio/filter.h"
 #include "transceiver.h"
 #include "msg.h"
 #include "debug.h"
 
 cc2420_packet_t cc2420_rx_buffer[CC2420_RX_BUF_SIZE];
 volatile uint8_t rx_buffer_next;
+radio_filter_t cc2420_rx_filter;
+volatile int16_t cc2420_ack_seq = -1;
 
-void cc2420_rx_handler(void)
+/* bytes of the RX FIFO */
+#define CC2420_RXFIFO_SIZE      (128)
+
+static void rx_drop(void)
+{
+    /* datasheet says flush twice */
+    cc2420_strobe(CC2420_STROBE_FLUSHRX);
+    cc2420_strobe(CC2420_STROBE_FLUSHRX);
+}
+
+/*
+ * Reads the next frame of the FIFO, which holds at most max bytes.
+ * Returns the bytes read with the length byte, -1 if the length is not
+ * that of a complete frame: the FIFO is out of step then and must be
+ * flushed.  Frames dropped by the filter or for their CRC are read out.
+ */
+static int rx_frame(uint8_t max, unsigned long toa)
 {
     uint8_t rssi_crc_lqi[2];
+    uint8_t len, hdr_len;
 
     /* read length */
     cc2420_read_fifo(&cc2420_rx_buffer[rx_buffer_next].length, 1);
+    len = cc2420_rx_buffer[rx_buffer_next].length;
+
+    if ((len > CC2420_MAX_PKT_LENGTH) || (len < 3 + IEEE_802154_FCS_LEN) ||
+        (len >= max)) {
+        return -1;
+    }
+
+    /* read the header first (without rssi, crc and lqi) */
+    uint8_t buf[len - 2];
+    cc2420_read_fifo(buf, 2);
+
+    if ((buf[0] & 0x07) == IEEE_802154_ACK_FRAME) {
+        /* FCF, DSN and FCS, handled right here for cc2420_send() */
+        if (len == 3 + IEEE_802154_FCS_LEN) {
+            cc2420_read_fifo(&buf[2], 1);
+            cc2420_read_fifo(rssi_crc_lqi, 2);
+
+            if (rssi_crc_lqi[1] & 0x80) {
+                cc2420_ack_seq = buf[2];
+            }
+        }
+        else {
+            cc2420_read_fifo(NULL, len - 2);
+        }
+
+        return 1 + len;
+    }
+    hdr_len = radio_filter_ieee802154_hdr_len(buf);
+
+    if (hdr_len > len - 2) {
+        hdr_len = len - 2;
+    }
+
+    cc2420_read_fifo(&buf[2], hdr_len - 2);
+
+    if (!radio_filter_ieee802154(&cc2420_rx_filter, buf, hdr_len)) {
+        DEBUG("Dropped filtered frame.\n");
+        /* the rest of the frame, rssi, crc and lqi */
+        cc2420_read_fifo(NULL, len - hdr_len);
+        return 1 + len;
+    }
 
-    /* read packet without rssi, crc and lqi */
-    uint8_t buf[cc2420_rx_buffer[rx_buffer_next].length - 2];
-    cc2420_read_fifo(buf, cc2420_rx_buffer[rx_buffer_next].length - 2);
+    /* read the rest of the packet */
+    cc2420_read_fifo(&buf[hdr_len], len - 2 - hdr_len);
 
     /* read rssi, lqi and crc */
     cc2420_read_fifo(rssi_crc_lqi, 2);
@@ -39,10 +99,11 @@ void cc2420_rx_handler(void)
     cc2420_rx_buffer[rx_buffer_next].rssi = (int8_t)(rssi_crc_lqi[0]);
     cc2420_rx_buffer[rx_buffer_next].lqi = (uint8_t)(rssi_crc_lqi[1] & 0x7F);
     cc2420_rx_buffer[rx_buffer_next].crc = (uint8_t)((rssi_crc_lqi[1] & 0x80) >> 7);
+    cc2420_rx_buffer[rx_buffer_next].toa = toa;
 
     if (cc2420_rx_buffer[rx_buffer_next].crc == 0) {
         DEBUG("Got packet with invalid crc.\n");
-        return;
+        return 1 + len;
     }
 
     ieee802154_frame_read(buf,
@@ -55,11 +116,12 @@ void cc2420_rx_handler(void)
 #endif
 
         /* notify transceiver thread if any */
-        if (transceiver_pid) {
+        if (cc2420_transceiver_pid) {
             msg_t m;
             m.type = (uint16_t) RCV_PKT_CC2420;
             m.content.value = rx_buffer_next;
-            msg_send_int(&m, transceiver_pid);
+            /* runs in the defer thread or, without it, in the ISR */
+            msg_send(&m, cc2420_transceiver_pid, false);
         }
     }
 
@@ -75,4 +137,45 @@ void cc2420_rx_handler(void)
     if (++rx_buffer_next == CC2420_RX_BUF_SIZE) {
         rx_buffer_next = 0;
     }
+
+    return 1 + len;
+}
+
+void cc2420_rx_handler(unsigned long toa)
+{
+    uint8_t left = CC2420_RXFIFO_SIZE;
+    int n;
+
+    if (!cc2420_get_fifop() || cc2420_get_fifo()) {
+        /* FIFOP stays high as long as a complete frame is left, there is
+         * no further interrupt for the frames behind the first one */
+        while (cc2420_get_fifop() && cc2420_get_fifo()) {
+            if (rx_frame(CC2420_RXFIFO_SIZE, toa) < 0) {
+                rx_drop();
+                return;
+            }
+        }
+
+        if (!cc2420_get_fifop()) {
+            return;
+        }
+
+        /* overflowed meanwhile, it is unknown where the FIFO stopped */
+        rx_drop();
+        return;
+    }
+
+    /* After an overflow the FIFO is full: the frames that were complete
+     * before are read, the one that was cut off is flushed. */
+    while (left > 0) {
+        n = rx_frame(left, toa);
+
+        if (n < 0) {
+            break;
+        }
+
+        left -= n;
+    }
+
+    rx_drop();
 }
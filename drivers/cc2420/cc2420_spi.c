@@ -6,12 +6,26 @@
   * Version 2.  See the file LICENSE for more details.
   */
 
+#include <stddef.h>
+
 #include "cc2420_spi.h"
 #include "cc2420_arch.h"
 
 #include "cc2420_settings.h"
 #include "irq.h"
 
+#ifndef CC2420_TXRX_BURST
+void cc2420_txrx_burst(const uint8_t *tx, uint8_t *rx, uint16_t len) {
+    uint16_t i;
+    for (i = 0; i < len; i++) {
+        uint8_t c = cc2420_txrx(tx ? tx[i] : NOBYTE);
+        if (rx) {
+            rx[i] = c;
+        }
+    }
+}
+#endif
+
 /* reg */
 void cc2420_write_reg(uint8_t addr, uint16_t value) {
     unsigned int cpsr = disableIRQ();
@@ -48,57 +62,45 @@ uint8_t cc2420_strobe(uint8_t c) {
 
 /* ram */
 uint16_t cc2420_read_ram(uint16_t addr, uint8_t* buffer, uint16_t len) {
-    uint16_t i;
     unsigned int cpsr = disableIRQ();
     cc2420_spi_select();
     cc2420_txrx(CC2420_RAM_ACCESS | (addr & 0x7F));
     cc2420_txrx(((addr >> 1) & 0xC0) | CC2420_RAM_READ_ACCESS);
-    for (i = 0; i < len; i++) {
-        buffer[i] = cc2420_txrx(NOBYTE);
-    }
+    cc2420_txrx_burst(NULL, buffer, len);
     cc2420_spi_unselect();
     restoreIRQ(cpsr);
-    return i;
+    return len;
 }
 
 uint16_t cc2420_write_ram(uint16_t addr, uint8_t* buffer, uint16_t len) {
-    uint16_t i;
     unsigned int cpsr = disableIRQ();
     cc2420_spi_select();
     cc2420_txrx(CC2420_RAM_ACCESS | (addr & 0x7F));
     cc2420_txrx(((addr >> 1) & 0xC0) | CC2420_RAM_WRITE_ACCESS);
-    for (i = 0; i < len; i++) {
-        cc2420_txrx(buffer[i]);
-    }
+    cc2420_txrx_burst(buffer, NULL, len);
     cc2420_spi_unselect();
     restoreIRQ(cpsr);
-    return i;
+    return len;
 }
 
 /* fifo */
 
 uint16_t cc2420_write_fifo(uint8_t* data, uint16_t data_length) {
-    uint16_t i;
     unsigned int cpsr = disableIRQ();
     cc2420_spi_select();
     cc2420_txrx(CC2420_REG_TXFIFO | CC2420_WRITE_ACCESS);
-    for (i = 0; i < data_length; i++) {
-        cc2420_txrx(data[i]);
-    }
+    cc2420_txrx_burst(data, NULL, data_length);
     cc2420_spi_unselect();
     restoreIRQ(cpsr);
-    return i;
+    return data_length;
 }
 
 uint16_t cc2420_read_fifo(uint8_t* data, uint16_t data_length) {
-    uint16_t i;
     unsigned int cpsr = disableIRQ();
     cc2420_spi_select();
     cc2420_txrx(CC2420_REG_RXFIFO | CC2420_READ_ACCESS);
-    for (i = 0; i < data_length; i++) {
-        data[i] = cc2420_txrx(NOBYTE);
-    }
+    cc2420_txrx_burst(NULL, data, data_length);
     cc2420_spi_unselect();
     restoreIRQ(cpsr);
-    return i;
+    return data_length;
 }
@@ -14,15 +14,13 @@
 #include "cc2420_arch.h"
 #include "ieee802154_frame.h"
 
+#include "hwtimer.h"
 #include "irq.h"
+#include "energy.h"
 
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
 
-static void cc2420_gen_pkt(uint8_t *buf, cc2420_packet_t *packet);
-
-static uint8_t sequenz_nr;
-
 int16_t cc2420_send(cc2420_packet_t *packet)
 {
     volatile uint32_t abort_count = 0;
@@ -53,9 +51,7 @@ int16_t cc2420_send(cc2420_packet_t *packet)
     }
 
     packet->frame.src_pan_id = cc2420_get_pan();
-    packet->frame.seq_nr = sequenz_nr;
-
-    sequenz_nr += 1;
+    /* the sequence number comes with the frame, retries keep it */
 
     /* calculate size of the package (header + payload + fcs) */
     packet->length = ieee802154_frame_get_hdr_len(&packet->frame) +
@@ -65,22 +61,25 @@ int16_t cc2420_send(cc2420_packet_t *packet)
         return -1;
     }
 
-    /* FCS is added in hardware */
-    uint8_t pkt[packet->length - 2];
+    /* FCS is added in hardware, the payload goes to the FIFO as it is */
+    uint8_t hdr[IEEE_802154_MAX_HDR_LEN];
+    uint8_t hdr_len = ieee802154_frame_init(&packet->frame, hdr);
 
-    /* generate pkt */
-    cc2420_gen_pkt(pkt, packet);
+    cc2420_ack_seq = -1;
 
     /* idle & flush tx */
     cc2420_strobe(CC2420_STROBE_RFOFF);
     cc2420_strobe(CC2420_STROBE_FLUSHTX);
+    ENERGY_RADIO(ENERGY_RADIO_IDLE);
 
-    /* write length and packet to fifo */
+    /* write length, header and payload to fifo */
     cc2420_write_fifo(&packet->length, 1);
-    cc2420_write_fifo(pkt, packet->length - 2);
+    cc2420_write_fifo(hdr, hdr_len);
+    cc2420_write_fifo(packet->frame.payload, packet->frame.payload_len);
 
     unsigned int cpsr = disableIRQ();
     cc2420_strobe(CC2420_STROBE_TXON);
+    ENERGY_RADIO(ENERGY_RADIO_TX);
 
     // Wait for SFD to be set -> sync word transmitted
     while (cc2420_get_sfd() == 0) {
@@ -103,22 +102,18 @@ int16_t cc2420_send(cc2420_packet_t *packet)
     while (cc2420_get_sfd() != 0);
 
     cc2420_switch_to_rx();
-    return packet->length;
-}
 
-/**
- * @brief Static function to generate byte array from cc2420 packet.
- *
- */
+    if (packet->frame.fcf.ack_req) {
+        /* the receiver acknowledges in hardware, no ACK has the caller retry */
+        for (unsigned i = 0; cc2420_ack_seq != packet->frame.seq_nr; i++) {
+            if (i >= CC2420_ACK_WAIT_US / CC2420_ACK_POLL_US) {
+                DEBUG("No ACK for SEQ %u\n", packet->frame.seq_nr);
+                return -1;
+            }
 
-static void cc2420_gen_pkt(uint8_t *buf, cc2420_packet_t *packet)
-{
-    uint8_t index, offset;
-    index = ieee802154_frame_init(&packet->frame, buf);
-    offset = index;
-
-    while (index < packet->length - 2) {
-        buf[index] = packet->frame.payload[index - offset];
-        index += 1;
+            hwtimer_wait(HWTIMER_TICKS(CC2420_ACK_POLL_US));
+        }
     }
+
+    return packet->length;
 }
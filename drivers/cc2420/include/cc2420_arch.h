@@ -37,6 +37,18 @@ and Telematics group (http://cst.mi.fu-berlin.de).
  */
 uint8_t cc2420_txrx(uint8_t c);
 
+/**
+ * @brief Transfers a burst of bytes while the cc2420 is selected.
+ * @details Boards with a DMA controller define CC2420_TXRX_BURST and provide
+ *          their own version, the default calls cc2420_txrx() for each byte.
+ *
+ * @param[in] tx bytes to send, NULL sends NOBYTE.
+ * @param[out] rx received bytes, NULL discards them.
+ * @param[in] len number of bytes.
+ *
+ */
+void cc2420_txrx_burst(const uint8_t *tx, uint8_t *rx, uint16_t len);
+
 /**
  * @brief Gets the status of the sfd pin.
  *
@@ -45,6 +57,24 @@ uint8_t cc2420_txrx(uint8_t c);
  */
 uint8_t cc2420_get_sfd(void);
 
+/**
+ * @brief Gets the status of the fifop pin, high while a complete frame is
+ *        in the RX FIFO.
+ *
+ * @return Status of the fifop pin.
+ *
+ */
+int cc2420_get_fifop(void);
+
+/**
+ * @brief Gets the status of the fifo pin, high while the RX FIFO is not
+ *        empty.  Low with fifop high after an RX FIFO overflow.
+ *
+ * @return Status of the fifo pin.
+ *
+ */
+int cc2420_get_fifo(void);
+
 /**
  * @brief Gets the status of the cca pin
  *
@@ -235,6 +235,10 @@
 #define CC2420_RAM_PANID        0x168
 /** @brief IEEE long (64-bit) address of the system. */
 #define CC2420_RAM_IEEEADR      0x160
+/** @brief Key used by the stand-alone encryption (SEC_SAKEYSEL = 0). */
+#define CC2420_RAM_KEY0         0x100
+/** @brief Plaintext and ciphertext of the stand-alone encryption. */
+#define CC2420_RAM_SABUF        0x120
 
 /**
  * @}
@@ -308,5 +312,8 @@
 #define CC2420_SYNC_WORD_TX_TIME 900000
 #define CC2420_RX_BUF_SIZE      3
 #define CC2420_WAIT_TIME        500
+/* macAckWaitDuration is 864 us at 2.4 GHz, polled every CC2420_ACK_POLL_US */
+#define CC2420_ACK_WAIT_US      1000
+#define CC2420_ACK_POLL_US      100
 
 #endif
@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "radio/types.h"
+#include "radio/filter.h"
 
 #include "ieee802154_frame.h"
 
@@ -13,6 +14,23 @@
 #define AT86RF231_MAX_PKT_LENGTH 127
 #define AT86RF231_MAX_DATA_LENGTH 118
 
+/**
+ * Extended operating mode: the radio sends with CSMA/CA (TX_ARET), waits
+ * for the acknowledgement of a frame that asks for one and acknowledges
+ * received frames by itself (RX_AACK). It is on after at86rf231_init().
+ */
+#ifndef AT86RF231_CSMA_RETRIES
+#define AT86RF231_CSMA_RETRIES      (4)     ///< macMaxCSMABackoffs, 0 to 5
+#endif
+#ifndef AT86RF231_FRAME_RETRIES
+#define AT86RF231_FRAME_RETRIES     (0)     ///< 0 to 15, the transceiver
+                                            ///< module retries by itself
+#endif
+
+// longest TX_ARET transaction with all retries and a polling step, in us
+#define AT86RF231_TX_TIMEOUT_US     (100000)
+#define AT86RF231_TX_POLL_US        (100)
+
 /**
  *  Structure to represent a at86rf231 packet.
  */
@@ -28,7 +46,7 @@ typedef struct __attribute__((packed))
 }
 at86rf231_packet_t;
 
-extern int transceiver_pid;
+extern int at86rf231_transceiver_pid;
 
 void at86rf231_init(int tpid);
 //void at86rf231_reset(void);
@@ -52,6 +70,17 @@ void at86rf231_switch_to_rx(void);
 
 void at86rf231_set_monitor(uint8_t mode);
 
+/**
+ * @brief Switches the extended operating mode on or off.
+ *
+ * @param on            1 for TX_ARET and RX_AACK, 0 for the basic mode
+ * @param csma_retries  backoffs before the channel is given up, at most 5
+ * @param frame_retries retransmissions of an unacknowledged frame, at most 15
+ */
+void at86rf231_set_extended_mode(uint8_t on, uint8_t csma_retries,
+                                 uint8_t frame_retries);
+uint8_t at86rf231_get_extended_mode(void);
+
 enum {
     RF86RF231_MAX_TX_LENGTH = 125,
     RF86RF231_MAX_RX_LENGTH = 127,
@@ -60,5 +89,12 @@ enum {
 };
 
 extern at86rf231_packet_t at86rf231_rx_buffer[AT86RF231_RX_BUF_SIZE];
+extern radio_filter_t at86rf231_rx_filter;
+
+/**
+ * 1 while a frame is sent, the TRX_END interrupt then ends the transmission
+ * and no reception.
+ */
+extern volatile uint8_t at86rf231_tx_pending;
 
 #endif
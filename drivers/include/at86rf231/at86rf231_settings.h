@@ -147,6 +147,44 @@ enum at86rf231_trx_state {
     AT86RF231_TRX_STATE__TX_ARET_ON = 0x19,
 };
 
+/* TRAC_STATUS in the TRX_STATE register, the result of a TX_ARET transaction */
+enum at86rf231_trac_status {
+    AT86RF231_TRX_STATE_MASK__TRAC = 0xE0,
+
+    AT86RF231_TRAC_STATUS__SUCCESS = 0x00,
+    AT86RF231_TRAC_STATUS__SUCCESS_DATA_PENDING = 0x20,
+    AT86RF231_TRAC_STATUS__SUCCESS_WAIT_FOR_ACK = 0x40,
+    AT86RF231_TRAC_STATUS__CHANNEL_ACCESS_FAILURE = 0x60,
+    AT86RF231_TRAC_STATUS__NO_ACK = 0xA0,
+    AT86RF231_TRAC_STATUS__INVALID = 0xE0,
+};
+
+enum at86rf231_xah_ctrl_0 {
+    AT86RF231_XAH_CTRL_0_MASK__MAX_FRAME_RETRIES = 0xF0,
+    AT86RF231_XAH_CTRL_0_MASK__MAX_CSMA_RETRIES = 0x0E,
+    AT86RF231_XAH_CTRL_0_MASK__SLOTTED_OPERATION = 0x01,
+};
+
+enum at86rf231_xah_ctrl_1 {
+    AT86RF231_XAH_CTRL_1_MASK__AACK_FLTR_RES_FT = 0x20,
+    AT86RF231_XAH_CTRL_1_MASK__AACK_UPLD_RES_FT = 0x10,
+    AT86RF231_XAH_CTRL_1_MASK__AACK_ACK_TIME = 0x04,
+    AT86RF231_XAH_CTRL_1_MASK__AACK_PROM_MODE = 0x02,
+};
+
+enum at86rf231_csma_seed_1 {
+    AT86RF231_CSMA_SEED_1_MASK__AACK_FVN_MODE = 0xC0,
+    AT86RF231_CSMA_SEED_1_MASK__AACK_SET_PD = 0x20,
+    AT86RF231_CSMA_SEED_1_MASK__AACK_DIS_ACK = 0x10,
+    AT86RF231_CSMA_SEED_1_MASK__AACK_I_AM_COORD = 0x08,
+    AT86RF231_CSMA_SEED_1_MASK__CSMA_SEED_1 = 0x07,
+};
+
+enum at86rf231_csma_be {
+    AT86RF231_CSMA_BE_MASK__MAX_BE = 0xF0,
+    AT86RF231_CSMA_BE_MASK__MIN_BE = 0x0F,
+};
+
 enum at86rf231_phy_cc_cca {
     AT86RF231_PHY_CC_CCA_MASK__CCA_REQUEST = 0x80,
     AT86RF231_PHY_CC_CCA_MASK__CCA_MODE = 0x60,
@@ -30,6 +30,17 @@
 
 uint8_t cc110x_txrx(uint8_t c);
 
+/**
+ * @brief   Transfers *count* bytes back to back while the radio is selected.
+ * @details Boards with a DMA controller define CC110X_TXRX_BURST and provide
+ *          their own version, the default calls cc110x_txrx() for each byte.
+ *
+ * @param[in] tx        Bytes to send, NULL sends CC1100_NOBYTE.
+ * @param[out] rx       Received bytes, NULL discards them.
+ * @param[in] count     Number of bytes.
+ */
+void cc110x_txrx_burst(const char *tx, char *rx, uint8_t count);
+
 void cc110x_gdo0_enable(void);
 void cc110x_gdo0_disable(void);
 void cc110x_gdo2_enable(void);
@@ -100,6 +100,7 @@ typedef struct cc110x_statistic {
     uint32_t    packets_in;
     uint32_t    packets_in_crc_fail;
     uint32_t    packets_in_while_tx;
+    uint32_t    packets_in_filtered;
     uint32_t    packets_in_dups;
     uint32_t    packets_in_up;
     uint32_t    packets_out;
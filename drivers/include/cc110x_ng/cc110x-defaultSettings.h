@@ -70,6 +70,9 @@ and Telematics group (http://cst.mi.fu-berlin.de).
 // Time chip needs to go to RX and CS signal is ready
 #define CS_READY_TIME           RTIMER_TICKS(3 * TIMER_TICK_USEC_RES)
 
+// Crystal frequency in Hz, clocks the WOR timer
+#define CC1100_XOSC_FREQ        (26000000)
+
 // Default RX interval for WOR in milliseconds
 #define T_RX_INTERVAL           (542)
 
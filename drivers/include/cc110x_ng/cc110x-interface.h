@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include "radio/radio.h"
 #include "radio/types.h"
+#include "radio/filter.h"
 #include "cc110x-config.h"
 
 #define CC1100_MAX_DATA_LENGTH (58)
@@ -114,8 +115,9 @@ extern volatile uint8_t rx_buffer_next;     ///< Next packet in RX queue
 
 extern volatile uint8_t radio_state;        ///< Radio state
 extern cc110x_statistic_t cc110x_statistic;
+extern radio_filter_t cc110x_rx_filter;     ///< Senders dropped on reception
 
-extern int transceiver_pid;                 ///< the transceiver thread pid
+extern int cc110x_transceiver_pid;          ///< the transceiver thread pid
 
 void cc110x_init(int transceiver_pid);
 
@@ -130,6 +132,31 @@ void cc110x_switch_to_rx(void);
 void cc110x_wakeup_from_rx(void);
 void cc110x_switch_to_pwd(void);
 
+/**
+ * @brief   Configures wake-on-radio: the radio wakes up every *interval*
+ *          us by itself and listens at least *listen* us, the MCU is only
+ *          woken by a packet.
+ *
+ * Takes effect with the next cc110x_switch_to_wor().  The RC oscillator
+ * timing the wake ups is calibrated against the crystal automatically.
+ *
+ * @param[in] interval  Time between two wake ups in us, up to ~1.89 s, 0
+ *                      disables wake-on-radio.
+ * @param[in] listen    Time listened after a wake up in us, up to 1/8 of
+ *                      *interval*.  Listening ends early without a carrier
+ *                      and goes on while a preamble is received.
+ *
+ * @return  1 on success, 0 if *interval* is out of range.
+ */
+int cc110x_set_wor(uint32_t interval, uint32_t listen);
+
+/**
+ * @brief   Switches to wake-on-radio as configured by cc110x_set_wor(),
+ *          powers down if it is disabled.  After a packet the radio stays
+ *          in RX until it is switched back.
+ */
+void cc110x_switch_to_wor(void);
+
 void cc110x_disable_interrupts(void);
 int16_t cc110x_set_config_channel(uint8_t channr);
 int16_t cc110x_set_channel(uint8_t channr);
@@ -82,6 +82,8 @@ Frame type value:
 #include "cc2420_settings.h"
 
 #include "radio/types.h"
+#include "radio/filter.h"
+#include "crypto/aes.h"
 
 #define CC2420_MAX_PKT_LENGTH 127
 #define CC2420_MAX_DATA_LENGTH (118)
@@ -101,10 +103,11 @@ typedef struct __attribute__ ((packed)) {
     int8_t rssi;                /** < the rssi value */
     uint8_t crc;                /** < 1 if crc was successfull, 0 otherwise */
     uint8_t lqi;                /** < the link quality indicator */
+    uint32_t toa;               /** < hwtimer_now() of the FIFOP interrupt */
     /* @} */
 } cc2420_packet_t;
 
-extern int transceiver_pid;
+extern int cc2420_transceiver_pid;
 
 /**
  * @brief Init the cc2420.
@@ -209,10 +212,12 @@ void cc2420_rx_irq(void);
 
 
 /**
- * @brief RX handler, process data from the RX FIFO.
+ * @brief RX handler, reads every complete frame from the RX FIFO.
  *
+ * @param[in] toa   hwtimer_now() of the interrupt, the frames are stamped
+ *                  with it
  */
-void cc2420_rx_handler(void);
+void cc2420_rx_handler(unsigned long toa);
 
 /**
  * @brief Send function, sends a cc2420_packet_t over the air.
@@ -234,15 +239,41 @@ int16_t cc2420_send(cc2420_packet_t *packet);
  */
 bool channel_clear(void);
 
-/**
- * The PID of the transceiver thread.
- */
-extern int transceiver_pid;
-
 /*
  * RX Packet Buffer, read from the transceiver, filled by the cc2420_rx_handler.
  */
 extern cc2420_packet_t cc2420_rx_buffer[CC2420_RX_BUF_SIZE];
 
+/**
+ * @brief Filter applied to received frames before they are read completely.
+ */
+extern radio_filter_t cc2420_rx_filter;
+
+/**
+ * @brief Sequence number of the last acknowledgement received, -1 if none
+ *        since the last frame was sent.
+ */
+extern volatile int16_t cc2420_ack_seq;
+
+/**
+ * @brief AES-128 engine using the stand-alone encryption of the radio.
+ * @details Only one key is held by the radio, it is loaded again whenever
+ *          another context encrypts.
+ */
+extern const aes_engine_t cc2420_aes_engine;
+
+/**
+ * @brief Rank of the cc2420 crypto provider, the SPI transfers make it
+ *        slower than the T-tables of a 32 bit MCU.
+ */
+#ifndef CC2420_AES_RANK
+#define CC2420_AES_RANK         (8)
+#endif
+
+/**
+ * @brief Provider of cc2420_aes_engine, registered by auto_init.
+ */
+extern crypto_provider_t cc2420_crypto_provider;
+
 
 #endif
@@ -43,6 +43,7 @@ and Telematics group (http://cst.mi.fu-berlin.de).
 #define GPIOINT_RISING_EDGE     0x01            ///< interrupt is generated on rising edge
 #define GPIOINT_FALLING_EDGE    0x02            ///< interrupt is generated on falling edge
 #define GPIOINT_DEBOUNCE        0x04            ///< debounce this interrupt
+#define GPIOINT_HIGH_PRIO       0x08            ///< handle before other pins, if supported
 
 /**
  * @brief   GPIO IRQ callback function type
@@ -55,7 +56,8 @@ typedef void(*fp_irqcb)(void);
  * @brief   GPIO IRQ handler setup
  * @param[in]   port        CPU specific port number (starting at 0)
  * @param[in]   bitmask     One or more bits for which to set the handler
- * @param[in]   flags       A combination of #GPIOINT_RISING_EDGE and #GPIOINT_FALLING_EDGE
+ * @param[in]   flags       A combination of #GPIOINT_RISING_EDGE and #GPIOINT_FALLING_EDGE,
+ *                          optionally #GPIOINT_HIGH_PRIO
  * @param[in]   callback    A pointer to a handler function
  * @retval      true        successful
  * @retval      false       failed
@@ -96,10 +96,11 @@ static void riot_ccn_express_interest(int argc, char **argv)
 
     DEBUG("in='%s'\n", small_buf);
 
-    int content_len = ccnl_riot_client_get(relay_pid, small_buf, (char *) big_buf); // small_buf=name to request
+    int window = (argc > 2) ? atoi(argv[2]) : 1;
+    int content_len = ccnl_riot_client_fetch(relay_pid, small_buf, (char *) big_buf, sizeof(big_buf) - 1, window); // small_buf=name to request
 
-    if (content_len == 0) {
-        puts("riot_get returned 0 bytes...aborting!");
+    if (content_len <= 0) {
+        puts("riot_fetch returned 0 bytes...aborting!");
         return;
     }
 
@@ -130,6 +131,17 @@ static void riot_ccn_register_prefix(int argc, char **argv)
     puts("done");
 }
 
+static void riot_ccn_cache(int argc, char **argv)
+{
+    if (argc > 1) {
+        ccnl_riot_client_cache(relay_pid, "cachepolicy", argv[1], big_buf);
+        printf("%s\n", big_buf);
+    }
+
+    ccnl_riot_client_cache(relay_pid, "cachestat", NULL, big_buf);
+    printf("%s", big_buf);
+}
+
 static void relay_thread(void)
 {
     ccnl_riot_relay_start(shell_max_cache_entries, shell_threshold_prefix, shell_threshold_aggregate);
@@ -286,10 +298,11 @@ static void riot_ccn_stat(int argc, char **argv)
 static const shell_command_t sc[] = {
     { "ccn", "starts ccn relay", riot_ccn_relay_start },
     { "haltccn", "stops ccn relay", riot_ccn_relay_stop },
-    { "interest", "express an interest", riot_ccn_express_interest },
+    { "interest", "express an interest [name [window]]", riot_ccn_express_interest },
     { "populate", "populate the cache of the relay with data", riot_ccn_populate },
     { "prefix", "registers a prefix to a face", riot_ccn_register_prefix },
     { "stat", "prints out forwarding statistics", riot_ccn_stat },
+    { "cache", "sets the caching policy all|prob[=n]|lcd|size, prints hit counters", riot_ccn_cache },
 #if RIOT_CCN_APPSERVER
     { "appserver", "starts an application server to reply to interests", riot_ccn_appserver },
 #endif
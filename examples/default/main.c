@@ -72,7 +72,7 @@ void radio(void)
                 printf("%02X ", p->data[i]);
             }
 
-            p->processing--;
+            transceiver_release(p);
             puts("\n");
         }
         else if (m.type == ENOBUFFER) {
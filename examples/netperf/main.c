@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup examples
+ * @{
+ *
+ * @file
+ * @brief   Throughput and latency of the network stack
+ *
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * @}
+ */
+
+#include <stdio.h>
+
+#include "posix_io.h"
+#include "shell.h"
+#include "shell_commands.h"
+#include "board_uart0.h"
+
+#include "netperf.h"
+
+const shell_command_t shell_commands[] = {
+    {"init", "Initialize the network with an address", netperf_init},
+    {"server", "Receive udp, tcp or ip test traffic", netperf_server},
+    {"client", "Send udp, tcp or ip test traffic", netperf_client},
+    {"report", "Print the receiver statistics", netperf_report},
+    {NULL, NULL, NULL}
+};
+
+int main(void)
+{
+    puts("netperf");
+
+    /* start shell */
+    posix_open(uart0_handler_pid, 0);
+
+    shell_t shell;
+    shell_init(&shell, shell_commands, UART0_BUFSIZE, uart0_readc, uart0_putc);
+
+    shell_run(&shell);
+    return 0;
+}
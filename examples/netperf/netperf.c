@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup examples
+ * @{
+ *
+ * @file
+ * @brief   Test traffic over destiny UDP, destiny TCP and raw IPv6
+ *
+ * Results are printed as one line each, e.g.
+ *
+ *     NETPERF recv proto=udp packets=.. bytes=.. lost=.. duration_us=..
+ *             goodput_bps=.. jitter_us=..
+ *
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "kernel.h"
+#include "thread.h"
+#include "msg.h"
+#include "vtimer.h"
+#include "net_if.h"
+#include "sixlowpan.h"
+#include "ipv6.h"
+#include "destiny/socket.h"
+
+#include "netperf.h"
+
+/* datagrams ending a run, some may get lost */
+#define LAST_REPEAT     (3)
+
+#define SERVER_PRIO     (PRIORITY_MAIN - 2)
+
+typedef struct {
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t expected;      /* highest sequence number + 1 */
+    uint32_t first;         /* arrival of the first packet */
+    uint32_t last;          /* arrival of the latest packet */
+    int32_t transit;        /* arrival - send time of the latest packet */
+    uint32_t jitter;        /* RFC 3550 interarrival jitter, times 16 */
+} stats_t;
+
+static const char *proto_names[] = { "udp", "tcp", "ip" };
+
+static char server_stack[KERNEL_CONF_STACKSIZE_MAIN];
+static int server_proto = -1;
+static stats_t stats;
+static uint8_t buf[NETPERF_MAX_SIZE];
+
+static uint32_t now_us(void)
+{
+    timex_t t;
+
+    vtimer_now(&t);
+    return t.seconds * 1000000 + t.microseconds;
+}
+
+static int parse_proto(const char *name)
+{
+    for (unsigned i = 0; i < sizeof(proto_names) / sizeof(proto_names[0]); i++) {
+        if (strcmp(name, proto_names[i]) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void set_addr(ipv6_addr_t *addr, uint16_t id)
+{
+    ipv6_addr_init(addr, 0xabcd, 0xef12, 0, 0, 0, 0x00ff, 0xfe00, id);
+}
+
+static void stats_reset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+static void stats_bytes(uint32_t len)
+{
+    uint32_t now = now_us();
+
+    if (stats.packets++ == 0) {
+        stats.first = now;
+    }
+
+    stats.last = now;
+    stats.bytes += len;
+}
+
+/* accounts a datagram, returns its last flag */
+static int stats_datagram(const uint8_t *data, uint32_t len)
+{
+    netperf_hdr_t hdr;
+    int32_t transit, d;
+
+    if (len < sizeof(hdr)) {
+        return 0;
+    }
+
+    memcpy(&hdr, data, sizeof(hdr));
+
+    if (hdr.last) {
+        return 1;
+    }
+
+    stats_bytes(len);
+
+    if (hdr.seq + 1 > stats.expected) {
+        stats.expected = hdr.seq + 1;
+    }
+
+    /* the clocks are not synchronized, only the changes count */
+    transit = (int32_t)(stats.last - hdr.sent);
+
+    if (stats.packets > 1) {
+        d = transit - stats.transit;
+        d = (d < 0) ? -d : d;
+        stats.jitter += d - ((stats.jitter + 8) >> 4);
+    }
+
+    stats.transit = transit;
+    return 0;
+}
+
+static void stats_print(void)
+{
+    uint32_t duration = stats.last - stats.first;
+    uint32_t lost = (stats.expected > stats.packets) ?
+                    stats.expected - stats.packets : 0;
+    uint64_t goodput = duration ?
+                       ((uint64_t) stats.bytes * 8 * 1000000) / duration : 0;
+
+    if (server_proto < 0) {
+        puts("no server running");
+        return;
+    }
+
+    printf("NETPERF recv proto=%s packets=%" PRIu32 " bytes=%" PRIu32
+           " lost=%" PRIu32 " duration_us=%" PRIu32 " goodput_bps=%" PRIu32
+           " jitter_us=%" PRIu32 "\n", proto_names[server_proto],
+           stats.packets, stats.bytes,
+           (server_proto == NETPERF_PROTO_TCP) ? 0 : lost, duration,
+           (uint32_t) goodput, stats.jitter >> 4);
+}
+
+static void udp_server(void)
+{
+    sockaddr6_t sa;
+    uint32_t fromlen = sizeof(sa);
+    int32_t len;
+    int sock = destiny_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET;
+    sa.sin6_port = HTONS(NETPERF_PORT);
+
+    if (destiny_socket_bind(sock, &sa, sizeof(sa)) == -1) {
+        puts("ERROR: bind failed");
+        destiny_socket_close(sock);
+        return;
+    }
+
+    while (1) {
+        len = destiny_socket_recvfrom(sock, buf, sizeof(buf), 0, &sa, &fromlen);
+
+        if ((len > 0) && stats_datagram(buf, len) && stats.packets) {
+            stats_print();
+            stats_reset();
+        }
+    }
+}
+
+static void tcp_server(void)
+{
+    sockaddr6_t sa;
+    socklen_t salen = sizeof(sa);
+    int32_t len;
+    int conn;
+    int sock = destiny_socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET;
+    sa.sin6_port = HTONS(NETPERF_PORT);
+
+    if ((destiny_socket_bind(sock, &sa, sizeof(sa)) == -1) ||
+        (destiny_socket_listen(sock, 1) == -1)) {
+        puts("ERROR: bind or listen failed");
+        destiny_socket_close(sock);
+        return;
+    }
+
+    while (1) {
+        if ((conn = destiny_socket_accept(sock, &sa, &salen)) < 0) {
+            continue;
+        }
+
+        while ((len = destiny_socket_recv(conn, buf, sizeof(buf), 0)) > 0) {
+            stats_bytes(len);
+        }
+
+        destiny_socket_close(conn);
+        stats_print();
+        stats_reset();
+    }
+}
+
+/*
+ * The IP thread publishes a copy of every packet to the registered
+ * threads, the server takes all copies published since it was told.
+ */
+static void ip_server(void)
+{
+    msg_t m;
+    ipv6_hdr_t *hdr;
+
+    ipv6_register_packet_handler(thread_getpid());
+
+    while (1) {
+        msg_receive(&m);
+
+        if (m.type != IPV6_PACKET_RECEIVED) {
+            continue;
+        }
+
+        while ((hdr = ipv6_packet_get()) != NULL) {
+            if (hdr->nextheader == NETPERF_IP_PROTO &&
+                stats_datagram((uint8_t *)(hdr + 1), NTOHS(hdr->length)) &&
+                stats.packets) {
+                stats_print();
+                stats_reset();
+            }
+
+            ipv6_packet_release(hdr);
+        }
+    }
+}
+
+void netperf_init(int argc, char **argv)
+{
+    ipv6_addr_t prefix;
+    int id;
+
+    if (argc != 2) {
+        printf("usage: %s <address>\n", argv[0]);
+        return;
+    }
+
+    id = atoi(argv[1]);
+
+    if ((id < 1) || (id > 255)) {
+        puts("ERROR: address not a valid 8 bit integer");
+        return;
+    }
+
+    set_addr(&prefix, 0);
+    net_if_set_src_address_mode(0, NET_IF_TRANS_ADDR_M_SHORT);
+
+    if (!net_if_set_hardware_address(0, id) ||
+        !sixlowpan_lowpan_init_adhoc_interface(0, &prefix)) {
+        puts("ERROR: can not initialize 6LoWPAN");
+        return;
+    }
+
+    printf("initialized as abcd:ef12::ff:fe00:%x\n", id);
+}
+
+void netperf_server(int argc, char **argv)
+{
+    void (*server[])(void) = { udp_server, tcp_server, ip_server };
+    int proto;
+
+    if ((argc != 2) || ((proto = parse_proto(argv[1])) < 0)) {
+        printf("usage: %s <udp|tcp|ip>\n", argv[0]);
+        return;
+    }
+
+    if (server_proto >= 0) {
+        printf("ERROR: %s server already running\n", proto_names[server_proto]);
+        return;
+    }
+
+    stats_reset();
+    server_proto = proto;
+    thread_create(server_stack, sizeof(server_stack), SERVER_PRIO,
+                  CREATE_STACKTEST, server[proto], "netperf server");
+}
+
+void netperf_report(int argc, char **argv)
+{
+    (void) argc;
+    (void) argv;
+
+    stats_print();
+}
+
+static int32_t client_send(int proto, int sock, sockaddr6_t *sa,
+                           const uint8_t *data, uint32_t len)
+{
+    switch (proto) {
+        case NETPERF_PROTO_UDP:
+            return destiny_socket_sendto(sock, data, len, 0, sa, sizeof(*sa));
+
+        case NETPERF_PROTO_TCP:
+            return destiny_socket_send(sock, data, len, 0);
+
+        default:
+            return ipv6_sendto(&sa->sin6_addr, NETPERF_IP_PROTO, data, len);
+    }
+}
+
+void netperf_client(int argc, char **argv)
+{
+    static uint8_t data[NETPERF_MAX_SIZE];
+    netperf_hdr_t hdr;
+    sockaddr6_t sa;
+    uint32_t size, rate, duration, interval, start, next, t;
+    uint32_t sent = 0, failed = 0, bytes = 0, send_max = 0;
+    uint64_t send_total = 0;
+    int proto, sock = -1;
+
+    if ((argc != 6) || ((proto = parse_proto(argv[1])) < 0)) {
+        printf("usage: %s <udp|tcp|ip> <address> <size> <packets/s> <seconds>\n",
+               argv[0]);
+        puts("\ta rate of 0 sends as fast as possible");
+        return;
+    }
+
+    size = atoi(argv[3]);
+    rate = atoi(argv[4]);
+    duration = atoi(argv[5]) * 1000000;
+    interval = rate ? 1000000 / rate : 0;
+
+    if ((size < sizeof(hdr)) || (size > NETPERF_MAX_SIZE)) {
+        printf("ERROR: size must be between %u and %u\n",
+               (unsigned) sizeof(hdr), NETPERF_MAX_SIZE);
+        return;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET;
+    sa.sin6_port = HTONS(NETPERF_PORT);
+    set_addr(&sa.sin6_addr, atoi(argv[2]));
+
+    if (proto == NETPERF_PROTO_UDP) {
+        sock = destiny_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    }
+    else if (proto == NETPERF_PROTO_TCP) {
+        sock = destiny_socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP);
+
+        if ((sock >= 0) &&
+            (destiny_socket_connect(sock, &sa, sizeof(sa)) < 0)) {
+            puts("ERROR: connect failed");
+            destiny_socket_close(sock);
+            return;
+        }
+    }
+
+    if ((proto != NETPERF_PROTO_IP) && (sock < 0)) {
+        puts("ERROR: no socket");
+        return;
+    }
+
+    memset(data, 0, sizeof(data));
+    memset(&hdr, 0, sizeof(hdr));
+    start = next = now_us();
+
+    while ((uint32_t)(now_us() - start) < duration) {
+        int32_t res;
+
+        hdr.seq = sent;
+        hdr.sent = now_us();
+        memcpy(data, &hdr, sizeof(hdr));
+
+        res = client_send(proto, sock, &sa, data, size);
+
+        /* what the stack below the application costs */
+        t = now_us() - hdr.sent;
+        send_total += t;
+        send_max = (t > send_max) ? t : send_max;
+
+        sent++;
+
+        if (res < 0) {
+            failed++;
+        }
+        else {
+            bytes += size;
+        }
+
+        if (interval) {
+            next += interval;
+            t = next - now_us();
+
+            if ((int32_t) t > 0) {
+                vtimer_usleep(t);
+            }
+        }
+    }
+
+    t = now_us() - start;
+
+    if (proto == NETPERF_PROTO_TCP) {
+        destiny_socket_tcp_stats_t ts;
+
+        if (destiny_socket_get_tcp_stats(sock, &ts) == 0) {
+            printf("NETPERF tcp bytes_sent=%" PRIu32 " bytes_acked=%" PRIu32
+                   " retransmits=%u timeouts=%u cwnd=%u srtt_us=%" PRIu32 "\n",
+                   ts.bytes_sent, ts.bytes_acked, ts.retransmits, ts.timeouts,
+                   ts.cwnd, ts.srtt);
+        }
+    }
+    else {
+        hdr.last = 1;
+        memcpy(data, &hdr, sizeof(hdr));
+
+        for (int i = 0; i < LAST_REPEAT; i++) {
+            client_send(proto, sock, &sa, data, sizeof(hdr));
+        }
+    }
+
+    if (sock >= 0) {
+        destiny_socket_close(sock);
+    }
+
+    printf("NETPERF send proto=%s packets=%" PRIu32 " failed=%" PRIu32
+           " bytes=%" PRIu32 " duration_us=%" PRIu32 " send_avg_us=%" PRIu32
+           " send_max_us=%" PRIu32 "\n", proto_names[proto], sent, failed,
+           bytes, t, sent ? (uint32_t)(send_total / sent) : 0, send_max);
+}
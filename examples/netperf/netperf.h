@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+#ifndef NETPERF_H
+#define NETPERF_H
+
+#include <stdint.h>
+
+#define NETPERF_PORT        (0xF0B2)
+
+/* RFC 3692 experimental next header for the ip mode */
+#define NETPERF_IP_PROTO    (253)
+
+#define NETPERF_MAX_SIZE    (512)
+
+#define NETPERF_PROTO_UDP   (0)
+#define NETPERF_PROTO_TCP   (1)
+#define NETPERF_PROTO_IP    (2)
+
+/* leads every datagram, the rest of the payload is padding */
+typedef struct __attribute__((packed)) {
+    uint32_t seq;
+    uint32_t sent;          /* sender time in microseconds */
+    uint8_t last;           /* set in the datagrams ending a run */
+} netperf_hdr_t;
+
+void netperf_init(int argc, char **argv);
+void netperf_server(int argc, char **argv);
+void netperf_client(int argc, char **argv);
+void netperf_report(int argc, char **argv);
+
+#endif /* NETPERF_H */
@@ -80,27 +80,29 @@ void rpl_udp_monitor(void)
                 DEBUG("%02X ", p->data[i]);
             }
 
-            p->processing--;
+            transceiver_release(p);
             DEBUG("\n");
         }
         else if (m.type == IPV6_PACKET_RECEIVED) {
-            ipv6_buf = (ipv6_hdr_t *) m.content.ptr;
-            printf("IPv6 datagram received (next header: %02X)", ipv6_buf->nextheader);
-            printf(" from %s ", ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN,
-                                                 &ipv6_buf->srcaddr));
-
-            if (ipv6_buf->nextheader == IPV6_PROTO_NUM_ICMPV6) {
-                icmpv6_buf = (icmpv6_hdr_t *) &ipv6_buf[(LL_HDR_LEN + IPV6_HDR_LEN) + ipv6_ext_hdr_len];
-                icmp_type = icmpv6_buf->type;
-                icmp_code = icmpv6_buf->code;
+            while ((ipv6_buf = ipv6_packet_get()) != NULL) {
+                printf("IPv6 datagram received (next header: %02X)", ipv6_buf->nextheader);
+                printf(" from %s ", ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN,
+                                                     &ipv6_buf->srcaddr));
+
+                if (ipv6_buf->nextheader == IPV6_PROTO_NUM_ICMPV6) {
+                    icmpv6_buf = (icmpv6_hdr_t *) &ipv6_buf[(LL_HDR_LEN + IPV6_HDR_LEN) + ipv6_ext_hdr_len];
+                    icmp_type = icmpv6_buf->type;
+                    icmp_code = icmpv6_buf->code;
+                }
+
+                if (ipv6_buf->nextheader == IPV6_PROTO_NUM_ICMPV6) {
+                    DEBUG("\t ICMP type: %02X ", icmp_type);
+                    DEBUG("\t ICMP code: %02X ", icmp_code);
+                }
+
+                printf("\n");
+                ipv6_packet_release(ipv6_buf);
             }
-
-            if (ipv6_buf->nextheader == IPV6_PROTO_NUM_ICMPV6) {
-                DEBUG("\t ICMP type: %02X ", icmp_type);
-                DEBUG("\t ICMP code: %02X ", icmp_code);
-            }
-
-            printf("\n");
         }
         else if (m.type == ENOBUFFER) {
             puts("Transceiver buffer full");
@@ -83,7 +83,7 @@ void rpl_udp_init(int argc, char **argv)
             is_root = 1;
         }
         else {
-            ipv6_iface_set_routing_provider(rpl_get_next_hop);
+            ipv6_iface_set_class_routing_provider(rpl_get_next_hop_class);
         }
 
         DEBUGF("Start monitor\n");
@@ -133,7 +133,7 @@ void rpl_udp_loop(int argc, char **argv)
     rtable = rpl_get_routing_table();
     rpl_dodag_t *mydodag = rpl_get_my_dodag();
 
-    if (mydodag == NULL) {
+    if ((mydodag == NULL) || (rtable == NULL)) {
         return;
     }
 
@@ -177,6 +177,12 @@ void rpl_udp_table(int argc, char **argv)
 
     rpl_routing_entry_t *rtable;
     rtable = rpl_get_routing_table();
+
+    if (rtable == NULL) {
+        puts("Not part of a dodag");
+        return;
+    }
+
     printf("---------------------------\n");
     printf("OUTPUT\n");
     printf("---------------------------\n");
@@ -18,6 +18,11 @@
 #include <stdio.h>
 
 #include "auto_init.h"
+#include "hwtimer.h"
+#include "irq.h"
+#include "kernel.h"
+#include "thread.h"
+#include "thread_flags.h"
 
 #ifdef MODULE_SHT11
 #include "sht11.h"
@@ -43,10 +48,22 @@
 #include "diskio.h"
 #endif
 
+#ifdef MODULE_BLOCKCACHE
+#include "blockcache.h"
+#endif
+
 #ifdef MODULE_VTIMER
 #include "vtimer.h"
 #endif
 
+#ifdef MODULE_STACKMON
+#include "stackmon.h"
+#endif
+
+#ifdef MODULE_DLOG
+#include "dlog.h"
+#endif
+
 #ifdef MODULE_RTC
 #include "rtc.h"
 #endif
@@ -64,6 +81,16 @@
 #include "transceiver.h"
 #endif
 
+#ifdef MODULE_CRYPTO_AES
+#include "crypto/aes.h"
+#ifdef MODULE_CC2420
+#include "cc2420.h"
+#endif
+#ifdef MODULE_MC1322X_ASM
+#include "asm.h"
+#endif
+#endif
+
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
@@ -75,48 +102,72 @@
 #define CONF_PAN_ID     (0xabcd)
 #endif
 
+/* flag a runner waits for, set whenever a stage finished */
+#define AUTO_INIT_FLAG  (1 << (THREAD_FLAGS_BITS - 1))
+
+/* the stage may run in the helper thread, main() still waits for it */
+#define PARALLEL        (1)
+
+typedef struct {
+    const char *name;
+    void (*init)(void);
+    uint8_t id;
+    uint8_t flags;
+    uint16_t deps;      /**< stages that have to finish first */
+} auto_init_stage_t;
+
 extern int main(void);
 
-void auto_init(void)
-{
+/* the init functions that return a status nobody looks at */
 #ifdef MODULE_VTIMER
-    DEBUG("Auto init vtimer module.\n");
+static void init_vtimer(void)
+{
     vtimer_init();
+}
 #endif
-#ifdef MODULE_UART0
-    DEBUG("Auto init uart0 module.\n");
-    board_uart0_init();
-#endif
+
 #ifdef MODULE_RTC
-    DEBUG("Auto init rtc module.\n");
+static void init_rtc(void)
+{
     rtc_init();
     rtc_enable();
+}
 #endif
-#ifdef MODULE_SHT11
-    DEBUG("Auto init SHT11 module.\n");
-    sht11_init();
+
+#if defined(MODULE_CC110X) && !defined(MODULE_TRANSCEIVER)
+static void init_cc110x(void)
+{
+    cc1100_init();
+}
 #endif
-#ifdef MODULE_GPIOINT
-    DEBUG("Auto init gpioint module.\n");
-    gpioint_init();
+
+#if defined(MODULE_BLOCKCACHE) || defined(MODULE_MCI)
+static void init_disk(void)
+{
+#ifdef MODULE_BLOCKCACHE
+    blockcache_init();
+#else
+    MCI_initialize();
 #endif
-#ifdef MODULE_CC110X
-    DEBUG("Auto init CC1100 module.\n");
-#ifndef MODULE_TRANSCEIVER
-    cc1100_init();
+}
 #endif
+
+#ifdef MODULE_CRYPTO_AES
+static void init_crypto(void)
+{
+#ifdef MODULE_CC2420
+    crypto_provider_register(&cc2420_crypto_provider);
 #endif
-#ifdef MODULE_LTC4150
-    DEBUG("Auto init ltc4150 module.\n");
-    ltc4150_init();
+#ifdef MODULE_MC1322X_ASM
+    crypto_provider_register(&asm_crypto_provider);
 #endif
-#ifdef MODULE_MCI
-    DEBUG("Auto init mci module.\n");
-    MCI_initialize();
+}
 #endif
+
 #ifdef MODULE_NET_IF
+static void init_net_if(void)
+{
     int iface;
-    DEBUG("Auto init net_if module.\n");
     transceiver_type_t transceivers = 0;
 #ifdef MODULE_AT86RF231
     transceivers |= TRANSCEIVER_AT86RF231;
@@ -169,22 +220,189 @@ void auto_init(void)
             DEBUG("Auto init interface %d\n", iface);
         }
     }
-    else {
-        iface = -1;
-    }
+}
+#endif
 
 #ifdef MODULE_SIXLOWPAN
-    DEBUG("Auto init 6LoWPAN module.\n");
+static void init_sixlowpan(void)
+{
     sixlowpan_lowpan_init();
+}
 #endif
+
+#ifdef MODULE_DESTINY
+static void init_destiny(void)
+{
+    destiny_init_transport_layer();
+}
+#endif
+
+#ifdef MODULE_STACKMON
+static void init_stackmon(void)
+{
+    stackmon_init();
+}
+#endif
+
+#ifdef MODULE_DLOG
+static void init_dlog(void)
+{
+    dlog_init();
+}
 #endif
+
 #ifdef MODULE_PROFILING
-    extern void profiling_init(void);
-    profiling_init();
+extern void profiling_init(void);
+#endif
+
+#define S(x)    AUTO_INIT_STAGE(x)
+
+/* in an order that satisfies the dependencies */
+static const auto_init_stage_t stages[] = {
+#ifdef MODULE_VTIMER
+    { "vtimer", init_vtimer, AUTO_INIT_VTIMER, 0, 0 },
+#endif
+#ifdef MODULE_UART0
+    { "uart0", board_uart0_init, AUTO_INIT_UART0, 0, 0 },
+#endif
+#ifdef MODULE_RTC
+    { "rtc", init_rtc, AUTO_INIT_RTC, 0, 0 },
+#endif
+#ifdef MODULE_SHT11
+    { "sht11", sht11_init, AUTO_INIT_SHT11, PARALLEL, 0 },
+#endif
+#ifdef MODULE_GPIOINT
+    { "gpioint", gpioint_init, AUTO_INIT_GPIOINT, 0, 0 },
+#endif
+#if defined(MODULE_CC110X) && !defined(MODULE_TRANSCEIVER)
+    { "cc1100", init_cc110x, AUTO_INIT_CC110X, 0, S(AUTO_INIT_GPIOINT) },
+#endif
+#ifdef MODULE_LTC4150
+    { "ltc4150", ltc4150_init, AUTO_INIT_LTC4150, PARALLEL, S(AUTO_INIT_GPIOINT) },
+#endif
+#if defined(MODULE_BLOCKCACHE) || defined(MODULE_MCI)
+    { "disk", init_disk, AUTO_INIT_DISK, PARALLEL, S(AUTO_INIT_VTIMER) },
+#endif
+#ifdef MODULE_CRYPTO_AES
+    { "crypto", init_crypto, AUTO_INIT_CRYPTO, 0, 0 },
+#endif
+#ifdef MODULE_NET_IF
+    { "net_if", init_net_if, AUTO_INIT_NET_IF, 0,
+      S(AUTO_INIT_VTIMER) | S(AUTO_INIT_GPIOINT) | S(AUTO_INIT_CRYPTO) },
+#ifdef MODULE_SIXLOWPAN
+    { "sixlowpan", init_sixlowpan, AUTO_INIT_SIXLOWPAN, 0,
+      S(AUTO_INIT_VTIMER) | S(AUTO_INIT_NET_IF) },
+#endif
+#endif
+#ifdef MODULE_PROFILING
+    { "profiling", profiling_init, AUTO_INIT_PROFILING, 0, 0 },
 #endif
 #ifdef MODULE_DESTINY
-    DEBUG("Auto init transport layer [destiny] module.\n");
-    destiny_init_transport_layer();
+    { "destiny", init_destiny, AUTO_INIT_DESTINY, 0,
+      S(AUTO_INIT_VTIMER) | S(AUTO_INIT_NET_IF) | S(AUTO_INIT_SIXLOWPAN) },
+#endif
+#ifdef MODULE_STACKMON
+    { "stackmon", init_stackmon, AUTO_INIT_STACKMON, 0, 0 },
+#endif
+#ifdef MODULE_DLOG
+    { "dlog", init_dlog, AUTO_INIT_DLOG, 0, 0 },
+#endif
+    { NULL, NULL, 0, 0, 0 }
+};
+
+static volatile uint16_t done;
+static int main_pid = -1;
+static int helper_pid = -1;
+static unsigned long boot_start;
+
+/* a stage the helper thread runs */
+static int in_helper(const auto_init_stage_t *s)
+{
+    return (s->flags & PARALLEL) || (S(s->id) & AUTO_INIT_DEFERRED);
+}
+
+void auto_init_wait(uint16_t mask)
+{
+    while ((done & mask) != mask) {
+        thread_flags_wait_any(AUTO_INIT_FLAG);
+    }
+}
+
+static void run(const auto_init_stage_t *s)
+{
+    auto_init_wait(s->deps);
+
+    DEBUG("Auto init %s module.\n", s->name);
+    unsigned long start = hwtimer_now();
+    s->init();
+
+#if AUTO_INIT_PROFILE
+    unsigned long end = hwtimer_now();
+    printf("auto_init: %-10s %8lu us at %8lu us\n", s->name,
+           HWTIMER_TICKS_TO_US(end - start),
+           HWTIMER_TICKS_TO_US(end - boot_start));
+#else
+    (void) start;
+#endif
+
+    int state = disableIRQ();
+    done |= S(s->id);
+    restoreIRQ(state);
+
+    thread_flags_set(main_pid, AUTO_INIT_FLAG);
+
+    if (helper_pid >= 0) {
+        thread_flags_set(helper_pid, AUTO_INIT_FLAG);
+    }
+}
+
+static void helper(void)
+{
+    for (const auto_init_stage_t *s = stages; s->init != NULL; s++) {
+        if (in_helper(s)) {
+            run(s);
+        }
+    }
+
+    helper_pid = -1;
+}
+
+void auto_init(void)
+{
+    uint16_t present = 0;
+    int parallel = 0;
+
+    boot_start = hwtimer_now();
+    main_pid = thread_pid;
+
+    for (const auto_init_stage_t *s = stages; s->init != NULL; s++) {
+        present |= S(s->id);
+        parallel |= in_helper(s);
+    }
+
+    /* modules that are not used count as initialized */
+    done = ~present;
+
+    if (parallel) {
+        /* runs whenever a stage of the main thread blocks */
+        static char helper_stack[KERNEL_CONF_STACKSIZE_DEFAULT];
+
+        helper_pid = thread_create(helper_stack, sizeof(helper_stack),
+                                   PRIORITY_MAIN + 1, CREATE_STACKTEST,
+                                   helper, "auto_init");
+    }
+
+    for (const auto_init_stage_t *s = stages; s->init != NULL; s++) {
+        if ((helper_pid < 0) || !in_helper(s)) {
+            run(s);
+        }
+    }
+
+    auto_init_wait(present & ~AUTO_INIT_DEFERRED);
+
+#if AUTO_INIT_PROFILE
+    printf("auto_init: done after %lu us\n",
+           HWTIMER_TICKS_TO_US(hwtimer_now() - boot_start));
 #endif
 
     main();
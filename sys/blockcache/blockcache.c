@@ -0,0 +1,412 @@
+/**
+ * Write-back sector cache for block devices
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_blockcache
+ * @{
+ * @file    blockcache.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "thread.h"
+#include "mutex.h"
+#include "thread_flags.h"
+#include "vtimer.h"
+#include "diskio.h"
+#include "blockcache.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define FLAG_VALID      (0x01)
+#define FLAG_DIRTY      (0x02)
+
+/* thread flags of the flush thread */
+#define FLAG_FLUSH      (0x0001)
+#define FLAG_TIMER      (0x0002)
+
+typedef struct {
+    unsigned long sector;
+    uint16_t used;              /* LRU stamp */
+    uint8_t flags;
+} entry_t;
+
+/* in words, the MCI driver copies aligned data faster */
+static unsigned long data[BLOCKCACHE_SECTORS][BLOCKCACHE_SECTOR_SIZE / sizeof(unsigned long)];
+static entry_t entries[BLOCKCACHE_SECTORS];
+static unsigned long staging[BLOCKCACHE_COALESCE][BLOCKCACHE_SECTOR_SIZE / sizeof(unsigned long)];
+
+/* lock orders cache before dev, dev serializes all MCI calls */
+static mutex_t cache_lock;
+static mutex_t dev_lock;
+
+static uint16_t stamp;
+static unsigned int dirty;
+static blockcache_stats_t stats;
+
+static char flush_stack[KERNEL_CONF_STACKSIZE_DEFAULT];
+static int flush_pid = -1;
+static vtimer_t flush_timer;
+
+static int lookup(unsigned long sector)
+{
+    for (int i = 0; i < BLOCKCACHE_SECTORS; i++) {
+        if ((entries[i].flags & FLAG_VALID) && (entries[i].sector == sector)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void touch(int i)
+{
+    entries[i].used = ++stamp;
+}
+
+/* least recently used entry, a dirty one only if all are dirty */
+static int victim(void)
+{
+    int best = -1;
+    int best_dirty = -1;
+
+    for (int i = 0; i < BLOCKCACHE_SECTORS; i++) {
+        if (!(entries[i].flags & FLAG_VALID)) {
+            return i;
+        }
+
+        if (entries[i].flags & FLAG_DIRTY) {
+            if ((best_dirty < 0) ||
+                ((uint16_t)(stamp - entries[i].used) >
+                 (uint16_t)(stamp - entries[best_dirty].used))) {
+                best_dirty = i;
+            }
+        }
+        else if ((best < 0) ||
+                 ((uint16_t)(stamp - entries[i].used) >
+                  (uint16_t)(stamp - entries[best].used))) {
+            best = i;
+        }
+    }
+
+    return (best >= 0) ? best : best_dirty;
+}
+
+/*
+ * Writes back the run of dirty sectors starting at the lowest dirty one,
+ * called with cache_lock held.  The run is copied to the staging buffer,
+ * so the cache is only locked while copying.
+ */
+static DRESULT flush_run(int *more)
+{
+    unsigned long first = 0;
+    int run[BLOCKCACHE_COALESCE];
+    int n = 0;
+    DRESULT res;
+
+    *more = 0;
+
+    for (int i = 0; i < BLOCKCACHE_SECTORS; i++) {
+        if ((entries[i].flags & FLAG_DIRTY) &&
+            ((n == 0) || (entries[i].sector < first))) {
+            first = entries[i].sector;
+            run[0] = i;
+            n = 1;
+        }
+    }
+
+    if (n == 0) {
+        return RES_OK;
+    }
+
+    while (n < BLOCKCACHE_COALESCE) {
+        int i = lookup(first + n);
+
+        if ((i < 0) || !(entries[i].flags & FLAG_DIRTY)) {
+            break;
+        }
+
+        run[n++] = i;
+    }
+
+    for (int k = 0; k < n; k++) {
+        memcpy(staging[k], data[run[k]], BLOCKCACHE_SECTOR_SIZE);
+        entries[run[k]].flags &= ~FLAG_DIRTY;
+    }
+
+    dirty -= n;
+
+    /* readers missing the cache wait for the device, so a sector that is
+     * clean now is never read back before it is written */
+    mutex_lock(&dev_lock);
+    mutex_unlock(&cache_lock);
+
+    DEBUG("blockcache: writing %lu + %d\n", first, n);
+    res = MCI_write((const unsigned char *) staging, first, n);
+
+    mutex_unlock(&dev_lock);
+    mutex_lock(&cache_lock);
+
+    stats.writebacks++;
+
+    if (res != RES_OK) {
+        /* keep the data, marking what is still cached dirty again */
+        for (int k = 0; k < n; k++) {
+            int i = lookup(first + k);
+
+            if ((i >= 0) && !(entries[i].flags & FLAG_DIRTY)) {
+                entries[i].flags |= FLAG_DIRTY;
+                dirty++;
+            }
+        }
+
+        return res;
+    }
+
+    stats.written += n;
+    *more = (dirty > 0);
+    return RES_OK;
+}
+
+static DRESULT flush_locked(void)
+{
+    DRESULT res;
+    int more;
+
+    do {
+        res = flush_run(&more);
+    }
+    while ((res == RES_OK) && more);
+
+    return res;
+}
+
+/* slot for *sector*, writing back dirty sectors if none is clean */
+static int allocate(unsigned long sector, DRESULT *res)
+{
+    int i = victim();
+
+    *res = RES_OK;
+
+    if (entries[i].flags & FLAG_DIRTY) {
+        *res = flush_locked();
+
+        if (*res != RES_OK) {
+            return -1;
+        }
+
+        /* the lock was dropped, another thread may have cached it */
+        if ((i = lookup(sector)) >= 0) {
+            return i;
+        }
+
+        i = victim();
+    }
+
+    entries[i].flags = 0;
+    entries[i].sector = sector;
+    return i;
+}
+
+static void flush_thread(void)
+{
+    timex_t interval = timex_set(BLOCKCACHE_FLUSH_INTERVAL, 0);
+
+    while (1) {
+        vtimer_set_flags(&flush_timer, interval, thread_getpid(), FLAG_TIMER);
+        thread_flags_wait_any(FLAG_FLUSH | FLAG_TIMER);
+        vtimer_remove(&flush_timer);
+        thread_flags_clear(FLAG_TIMER);
+
+        mutex_lock(&cache_lock);
+
+        if (dirty) {
+            flush_locked();
+        }
+
+        mutex_unlock(&cache_lock);
+    }
+}
+
+DSTATUS blockcache_init(void)
+{
+    DSTATUS stat;
+
+    if (flush_pid < 0) {
+        mutex_init(&cache_lock);
+        mutex_init(&dev_lock);
+        flush_pid = thread_create(flush_stack, sizeof(flush_stack),
+                                  BLOCKCACHE_FLUSH_PRIORITY, CREATE_STACKTEST,
+                                  flush_thread, "blockcache");
+    }
+
+    mutex_lock(&dev_lock);
+    stat = MCI_initialize();
+    mutex_unlock(&dev_lock);
+
+    return stat;
+}
+
+DRESULT blockcache_flush(void)
+{
+    DRESULT res;
+
+    mutex_lock(&cache_lock);
+    res = flush_locked();
+    mutex_unlock(&cache_lock);
+
+    return res;
+}
+
+void blockcache_invalidate(void)
+{
+    mutex_lock(&cache_lock);
+    memset(entries, 0, sizeof(entries));
+    dirty = 0;
+    mutex_unlock(&cache_lock);
+}
+
+const blockcache_stats_t *blockcache_stats(void)
+{
+    return &stats;
+}
+
+/* diskio.h */
+
+DSTATUS disk_initialize(unsigned char drv)
+{
+    if (drv != DN_MCI) {
+        return STA_NOINIT;
+    }
+
+    return blockcache_init();
+}
+
+DSTATUS disk_status(unsigned char drv)
+{
+    if (drv != DN_MCI) {
+        return STA_NOINIT;
+    }
+
+    return MCI_status();
+}
+
+DRESULT disk_read(unsigned char drv, unsigned char *buff, unsigned long sector,
+                  unsigned char count)
+{
+    DRESULT res = RES_OK;
+
+    if (drv != DN_MCI) {
+        return RES_PARERR;
+    }
+
+    mutex_lock(&cache_lock);
+
+    for (; count; count--, sector++, buff += BLOCKCACHE_SECTOR_SIZE) {
+        int i = lookup(sector);
+
+        if (i < 0) {
+            if ((i = allocate(sector, &res)) < 0) {
+                break;
+            }
+
+            mutex_lock(&dev_lock);
+            res = MCI_read((unsigned char *) data[i], sector, 1);
+            mutex_unlock(&dev_lock);
+
+            if (res != RES_OK) {
+                break;
+            }
+
+            entries[i].flags = FLAG_VALID;
+            stats.misses++;
+        }
+        else {
+            stats.hits++;
+        }
+
+        touch(i);
+        memcpy(buff, data[i], BLOCKCACHE_SECTOR_SIZE);
+    }
+
+    mutex_unlock(&cache_lock);
+    return res;
+}
+
+DRESULT disk_write(unsigned char drv, const unsigned char *buff,
+                   unsigned long sector, unsigned char count)
+{
+    DRESULT res = RES_OK;
+    int wake;
+
+    if (drv != DN_MCI) {
+        return RES_PARERR;
+    }
+
+    mutex_lock(&cache_lock);
+
+    for (; count; count--, sector++, buff += BLOCKCACHE_SECTOR_SIZE) {
+        int i = lookup(sector);
+
+        if (i < 0) {
+            if ((i = allocate(sector, &res)) < 0) {
+                break;
+            }
+
+            entries[i].flags = FLAG_VALID;
+        }
+        else {
+            stats.hits++;
+        }
+
+        if (!(entries[i].flags & FLAG_DIRTY)) {
+            entries[i].flags |= FLAG_DIRTY;
+            dirty++;
+        }
+
+        touch(i);
+        memcpy(data[i], buff, BLOCKCACHE_SECTOR_SIZE);
+    }
+
+    wake = (dirty >= BLOCKCACHE_FLUSH_THRESHOLD);
+    mutex_unlock(&cache_lock);
+
+    if (wake && (flush_pid >= 0)) {
+        thread_flags_set(flush_pid, FLAG_FLUSH);
+    }
+
+    return res;
+}
+
+DRESULT disk_ioctl(unsigned char drv, unsigned char ctrl, void *buff)
+{
+    DRESULT res;
+
+    if (drv != DN_MCI) {
+        return RES_PARERR;
+    }
+
+    if (ctrl == CTRL_SYNC) {
+        res = blockcache_flush();
+
+        if (res != RES_OK) {
+            return res;
+        }
+    }
+
+    mutex_lock(&dev_lock);
+    res = MCI_ioctl(ctrl, buff);
+    mutex_unlock(&dev_lock);
+
+    return res;
+}
@@ -18,7 +18,10 @@
 #include <stdarg.h>
 #include <stdbool.h>
 
+#include <string.h>
+
 #include "bloom.h"
+#include "hashes.h"
 
 #define SETBIT(a,n) (a[n/CHAR_BIT] |= (1<<(n%CHAR_BIT)))
 #define GETBIT(a,n) (a[n/CHAR_BIT] &  (1<<(n%CHAR_BIT)))
@@ -63,10 +66,48 @@ struct bloom_t *bloom_new(size_t size, size_t num_hashes, ...)
      */
     bloom->k = num_hashes;
     bloom->m = size;
+    bloom->seed = 0;
+    bloom->flags = 0;
 
     return bloom;
 }
 
+void bloom_init(struct bloom_t *bloom, size_t size, uint8_t *bitfield,
+                size_t num_hashes, uint32_t seed, uint8_t flags)
+{
+    memset(bitfield, 0, BLOOM_BITFIELD_SIZE(size));
+
+    if ((flags & BLOOM_BLOCKED) && (size < BLOOM_BLOCK_BITS)) {
+        flags &= ~BLOOM_BLOCKED;
+    }
+
+    bloom->m = size;
+    bloom->k = num_hashes;
+    bloom->a = bitfield;
+    bloom->hash = NULL;
+    bloom->seed = seed;
+    bloom->flags = flags | BLOOM_DOUBLE_HASH;
+}
+
+/*
+ * Bit index n (0 <= n < k) of an element, g_n = h1 + n * h2.  h2 is made
+ * odd so that for a power of 2 as size all k indices differ.  A blocked
+ * filter picks the block with h1 and spreads the bits inside it.
+ */
+static size_t bloom_index(const struct bloom_t *bloom, uint32_t h1,
+                          uint32_t h2, size_t n)
+{
+    if (bloom->flags & BLOOM_BLOCKED) {
+        size_t block = h1 % (bloom->m / BLOOM_BLOCK_BITS);
+        uint32_t step = (h1 >> 16) | 1;
+
+        return block * BLOOM_BLOCK_BITS +
+               ((h2 + n * step) & (BLOOM_BLOCK_BITS - 1));
+    }
+
+    return (h1 + n * (h2 | 1)) % bloom->m;
+}
+
 void bloom_del(struct bloom_t *bloom)
 {
     free(bloom->a);
@@ -79,6 +120,17 @@ void bloom_add(struct bloom_t *bloom, const uint8_t *buf, size_t len)
     uint32_t hash;
     size_t n;
 
+    if (bloom->flags & BLOOM_DOUBLE_HASH) {
+        uint64_t h = double_hash64(buf, len, bloom->seed);
+
+        for (n = 0; n < bloom->k; n++) {
+            size_t i = bloom_index(bloom, (uint32_t) h, h >> 32, n);
+            SETBIT(bloom->a, i);
+        }
+
+        return;
+    }
+
     for (n = 0; n < bloom->k; n++) {
         hash = bloom->hash[n](buf, len);
         SETBIT(bloom->a, (hash % bloom->m));
@@ -90,6 +142,20 @@ bool bloom_check(struct bloom_t *bloom, const uint8_t *buf, size_t len)
     uint32_t hash;
     size_t n;
 
+    if (bloom->flags & BLOOM_DOUBLE_HASH) {
+        uint64_t h = double_hash64(buf, len, bloom->seed);
+
+        for (n = 0; n < bloom->k; n++) {
+            size_t i = bloom_index(bloom, (uint32_t) h, h >> 32, n);
+
+            if (!(GETBIT(bloom->a, i))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     for (n = 0; n < bloom->k; n++) {
         hash = bloom->hash[n](buf, len);
 
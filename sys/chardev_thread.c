@@ -17,23 +17,23 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #include "kernel.h"
-#include "irq.h"
 
 #include "thread.h"
 #include "msg.h"
 
-#include "ringbuffer.h"
+#include "spsc_ringbuffer.h"
 #include "posix_io.h"
 
 /* increase stack size in uart0 when setting this to 1 */
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
 
-static int min(int a, int b)
+static int max(int a, int b)
 {
-    if (b > a) {
+    if (b < a) {
         return a;
     }
     else {
@@ -41,14 +41,53 @@ static int min(int a, int b)
     }
 }
 
-void chardev_loop(ringbuffer_t *rb)
+/* copies what is available, up to the size of the request, into the
+ * buffers of the reader */
+static int chardev_read(spsc_ringbuffer_t *rb, int type, void *r)
+{
+    if (type == READ) {
+        struct posix_iop_t *iop = r;
+        return spsc_rb_get(rb, iop->buffer, max(iop->nbytes, 0));
+    }
+
+    struct posix_iopv_t *iopv = r;
+    int nbytes = 0;
+
+    for (int i = 0; i < iopv->iovcnt && spsc_rb_avail(rb); i++) {
+        struct posix_iovec_t *iov = iopv->iov + i;
+        nbytes += spsc_rb_get(rb, iov->buffer, max(iov->nbytes, 0));
+    }
+
+    return nbytes;
+}
+
+/* the device is the standard output, as for uart0_putc() */
+static int chardev_write(char *buffer, int nbytes)
+{
+    for (int i = 0; i < nbytes; i++) {
+        putchar(buffer[i]);
+    }
+
+    return nbytes;
+}
+
+static void chardev_reply_nbytes(msg_t *m, int nbytes)
+{
+    /* struct posix_iopv_t starts like struct posix_iop_t */
+    ((struct posix_iop_t *)(void *) m->content.ptr)->nbytes = nbytes;
+    msg_reply(m, m);
+}
+
+void chardev_loop(spsc_ringbuffer_t *rb)
 {
     msg_t m;
 
     int pid = thread_getpid();
 
     int reader_pid = -1;
-    struct posix_iop_t *r = NULL;
+    int reader_flags = 0;
+    int rtype = READ;
+    void *r = NULL;
 
     puts("UART0 thread started.");
 
@@ -63,6 +102,7 @@ void chardev_loop(ringbuffer_t *rb)
                     DEBUG("OPEN\n");
                     if (reader_pid == -1) {
                         reader_pid = m.sender_pid;
+                        reader_flags = m.content.value;
                         /* no error */
                         m.content.value = 0;
                     }
@@ -74,18 +114,46 @@ void chardev_loop(ringbuffer_t *rb)
                     break;
 
                 case READ:
+                case READV:
                     DEBUG("READ\n");
                     if (m.sender_pid != reader_pid) {
-                        m.content.value = -EINVAL;
                         r = NULL;
-                        msg_reply(&m, &m);
+                        chardev_reply_nbytes(&m, -EINVAL);
+                    }
+                    else if (!spsc_rb_avail(rb) && (reader_flags & O_NONBLOCK)) {
+                        r = NULL;
+                        chardev_reply_nbytes(&m, -EAGAIN);
                     }
                     else {
-                        r = (struct posix_iop_t *)(void*)m.content.ptr;
+                        rtype = m.type;
+                        r = (void *) m.content.ptr;
                     }
 
                     break;
 
+                case WRITE:
+                    DEBUG("WRITE\n");
+                    {
+                        struct posix_iop_t *iop = (struct posix_iop_t *)(void *) m.content.ptr;
+                        chardev_reply_nbytes(&m, chardev_write(iop->buffer, iop->nbytes));
+                    }
+                    break;
+
+                case WRITEV:
+                    DEBUG("WRITEV\n");
+                    {
+                        struct posix_iopv_t *iopv = (struct posix_iopv_t *)(void *) m.content.ptr;
+                        int nbytes = 0;
+
+                        for (int i = 0; i < iopv->iovcnt; i++) {
+                            nbytes += chardev_write(iopv->iov[i].buffer,
+                                                    iopv->iov[i].nbytes);
+                        }
+
+                        chardev_reply_nbytes(&m, nbytes);
+                    }
+                    break;
+
                 case CLOSE:
                     DEBUG("CLOSE\n");
                     if (m.sender_pid == reader_pid) {
@@ -108,13 +176,11 @@ void chardev_loop(ringbuffer_t *rb)
             }
         }
 
-        if (rb->avail && (r != NULL)) {
+        if (spsc_rb_avail(rb) && (r != NULL)) {
             DEBUG("Data is available\n");
-            int state = disableIRQ();
-            int nbytes = min(r->nbytes, rb->avail);
+            int nbytes = chardev_read(rb, rtype, r);
             DEBUG("uart0_thread [%i]: sending %i bytes received from %i to pid %i\n", pid, nbytes, m.sender_pid, reader_pid);
-            rb_get_elements(rb, r->buffer, nbytes);
-            r->nbytes = nbytes;
+            ((struct posix_iop_t *) r)->nbytes = nbytes;
 
             m.sender_pid = reader_pid;
             m.type = OPEN;
@@ -123,7 +189,6 @@ void chardev_loop(ringbuffer_t *rb)
             msg_reply(&m, &m);
 
             r = NULL;
-            restoreIRQ(state);
         }
     }
 }
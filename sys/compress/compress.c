@@ -0,0 +1,187 @@
+/**
+ * Delta and varint coding of sensor values
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_compress
+ * @{
+ * @file    compress.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "compress.h"
+
+size_t compress_varint_put(uint8_t *buf, uint32_t value)
+{
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        buf[n++] = (uint8_t) value | 0x80;
+        value >>= 7;
+    }
+
+    buf[n++] = (uint8_t) value;
+    return n;
+}
+
+int compress_varint_get(const uint8_t *buf, size_t len, uint32_t *value)
+{
+    uint32_t v = 0;
+
+    for (size_t n = 0; n < len; n++) {
+        if (n == COMPRESS_VARINT_MAX) {
+            return -1;
+        }
+
+        v |= (uint32_t)(buf[n] & 0x7f) << (7 * n);
+
+        if (!(buf[n] & 0x80)) {
+            *value = v;
+            return n + 1;
+        }
+    }
+
+    return (len < COMPRESS_VARINT_MAX) ? 0 : -1;
+}
+
+int compress_delta_encode(int32_t *prev, const int32_t *values, size_t count,
+                          uint8_t *buf, size_t size)
+{
+    uint8_t tmp[COMPRESS_VARINT_MAX];
+    int32_t last = *prev;
+    size_t pos = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        /* wraps around for differences beyond 31 bits, so does decoding */
+        size_t n = compress_varint_put(tmp,
+                                       compress_zigzag((int32_t)((uint32_t) values[i] -
+                                                                 (uint32_t) last)));
+
+        if (pos + n > size) {
+            return -1;
+        }
+
+        for (size_t k = 0; k < n; k++) {
+            buf[pos++] = tmp[k];
+        }
+
+        last = values[i];
+    }
+
+    *prev = last;
+    return pos;
+}
+
+void compress_delta_decoder_init(compress_delta_decoder_t *dec, int32_t prev)
+{
+    dec->prev = prev;
+    dec->acc = 0;
+    dec->shift = 0;
+}
+
+int compress_delta_decode(compress_delta_decoder_t *dec, const uint8_t **data,
+                          size_t *len, int32_t *values, size_t max)
+{
+    size_t count = 0;
+
+    while ((count < max) && (*len > 0)) {
+        uint8_t b = *(*data)++;
+
+        (*len)--;
+
+        if (dec->shift == 7 * COMPRESS_VARINT_MAX) {
+            return -1;
+        }
+
+        dec->acc |= (uint32_t)(b & 0x7f) << dec->shift;
+        dec->shift += 7;
+
+        if (b & 0x80) {
+            continue;
+        }
+
+        dec->prev = (int32_t)((uint32_t) dec->prev +
+                              (uint32_t) compress_unzigzag(dec->acc));
+        values[count++] = dec->prev;
+        dec->acc = 0;
+        dec->shift = 0;
+    }
+
+    return count;
+}
+
+#ifdef MODULE_SAMPLER
+int compress_record_encode(const sampler_record_t *record, uint8_t *buf,
+                           size_t size)
+{
+    int32_t prev = 0;
+    size_t pos;
+    int n;
+
+    if (size < 2 + 2 * COMPRESS_VARINT_MAX) {
+        return -1;
+    }
+
+    buf[0] = record->id;
+    buf[1] = record->count;
+    pos = 2;
+    pos += compress_varint_put(&buf[pos], record->time);
+    pos += compress_varint_put(&buf[pos], record->period);
+
+    n = compress_delta_encode(&prev, record->values, record->count,
+                              &buf[pos], size - pos);
+
+    return (n < 0) ? -1 : (int)(pos + n);
+}
+
+int compress_record_decode(const uint8_t *buf, size_t len,
+                           sampler_record_t *record)
+{
+    compress_delta_decoder_t dec;
+    const uint8_t *data;
+    size_t pos = 2;
+    int n;
+
+    if ((len < 2) || (buf[1] > SAMPLER_BATCH)) {
+        return -1;
+    }
+
+    record->id = buf[0];
+    record->count = buf[1];
+
+    n = compress_varint_get(&buf[pos], len - pos, &record->time);
+
+    if (n <= 0) {
+        return -1;
+    }
+
+    pos += n;
+    n = compress_varint_get(&buf[pos], len - pos, &record->period);
+
+    if (n <= 0) {
+        return -1;
+    }
+
+    pos += n;
+    data = &buf[pos];
+    len -= pos;
+
+    compress_delta_decoder_init(&dec, 0);
+    n = compress_delta_decode(&dec, &data, &len, record->values,
+                              record->count);
+
+    if (n != record->count) {
+        return -1;
+    }
+
+    return data - buf;
+}
+#endif
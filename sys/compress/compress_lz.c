@@ -0,0 +1,193 @@
+/**
+ * LZ coding of small blocks
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * Matches are found through a hash of the next 3 bytes, which keeps the
+ * latest position they were seen at only: the encoder misses some matches
+ * but takes a single pass and a fixed table.
+ *
+ * @ingroup sys_compress
+ * @{
+ * @file    compress_lz.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "compress.h"
+
+#define LZ_MIN_MATCH        (3)
+#define LZ_MAX_MATCH        (0x7f + LZ_MIN_MATCH)
+#define LZ_MAX_LITERALS     (0x80)
+#define LZ_MATCH            (0x80)
+
+/* states of the decoder */
+#define LZ_TOKEN            (0)
+#define LZ_LITERALS         (1)
+#define LZ_OFFSET           (2)
+
+static unsigned lz_hash(const uint8_t *p)
+{
+    uint16_t h = ((uint16_t) p[0] << 8 | p[1]) ^ ((uint16_t) p[2] << 4);
+
+    /* multiplicative hashing, the high bits mix all of the input */
+    return (uint16_t)(h * 40503u) >> (16 - COMPRESS_LZ_HASH_BITS);
+}
+
+/* writes the literals from *in* up to *end*, returns the new position in
+ * *out* or -1 if they do not fit */
+static int lz_literals(const uint8_t *in, size_t end, size_t start,
+                       uint8_t *out, size_t o, size_t size)
+{
+    while (start < end) {
+        size_t n = end - start;
+
+        if (n > LZ_MAX_LITERALS) {
+            n = LZ_MAX_LITERALS;
+        }
+
+        if (o + 1 + n > size) {
+            return -1;
+        }
+
+        out[o++] = n - 1;
+        memcpy(&out[o], &in[start], n);
+        o += n;
+        start += n;
+    }
+
+    return o;
+}
+
+int compress_lz_encode(const uint8_t *in, size_t len, uint8_t *out,
+                       size_t size)
+{
+    /* position + 1 the hash was seen last, 0 if never */
+    size_t table[1 << COMPRESS_LZ_HASH_BITS];
+    size_t pos = 0, lit = 0;
+    int o = 0;
+
+    memset(table, 0, sizeof(table));
+
+    while (pos + LZ_MIN_MATCH <= len) {
+        unsigned h = lz_hash(&in[pos]);
+        size_t cand = table[h];
+
+        table[h] = pos + 1;
+
+        if ((cand == 0) || (pos - (cand - 1) > COMPRESS_LZ_WINDOW) ||
+            memcmp(&in[cand - 1], &in[pos], LZ_MIN_MATCH)) {
+            pos++;
+            continue;
+        }
+
+        cand--;
+
+        size_t m = LZ_MIN_MATCH;
+
+        while ((m < LZ_MAX_MATCH) && (pos + m < len) &&
+               (in[cand + m] == in[pos + m])) {
+            m++;
+        }
+
+        o = lz_literals(in, pos, lit, out, o, size);
+
+        if ((o < 0) || ((size_t) o + 2 > size)) {
+            return -1;
+        }
+
+        out[o++] = LZ_MATCH | (m - LZ_MIN_MATCH);
+        out[o++] = pos - cand - 1;
+        pos += m;
+        lit = pos;
+    }
+
+    return lz_literals(in, len, lit, out, o, size);
+}
+
+void compress_lz_decoder_init(compress_lz_decoder_t *dec, uint8_t *out,
+                              size_t size)
+{
+    dec->out = out;
+    dec->size = size;
+    dec->pos = 0;
+    dec->state = LZ_TOKEN;
+    dec->count = 0;
+}
+
+int compress_lz_decode(compress_lz_decoder_t *dec, const uint8_t *data,
+                       size_t len)
+{
+    while (len > 0) {
+        switch (dec->state) {
+            case LZ_TOKEN:
+                if (*data & LZ_MATCH) {
+                    dec->count = (*data & ~LZ_MATCH) + LZ_MIN_MATCH;
+                    dec->state = LZ_OFFSET;
+                }
+                else {
+                    dec->count = *data + 1;
+                    dec->state = LZ_LITERALS;
+                }
+
+                data++;
+                len--;
+                break;
+
+            case LZ_LITERALS: {
+                size_t n = (len < dec->count) ? len : dec->count;
+
+                if (dec->pos + n > dec->size) {
+                    return -1;
+                }
+
+                memcpy(&dec->out[dec->pos], data, n);
+                dec->pos += n;
+                dec->count -= n;
+                data += n;
+                len -= n;
+
+                if (dec->count == 0) {
+                    dec->state = LZ_TOKEN;
+                }
+
+                break;
+            }
+
+            case LZ_OFFSET: {
+                size_t offset = *data + 1;
+
+                if ((offset > dec->pos) ||
+                    (dec->pos + dec->count > dec->size)) {
+                    return -1;
+                }
+
+                /* byte by byte, the match may overlap its own output */
+                for (uint8_t i = 0; i < dec->count; i++) {
+                    dec->out[dec->pos] = dec->out[dec->pos - offset];
+                    dec->pos++;
+                }
+
+                data++;
+                len--;
+                dec->state = LZ_TOKEN;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int compress_lz_finish(const compress_lz_decoder_t *dec)
+{
+    return (dec->state == LZ_TOKEN) ? (int) dec->pos : -1;
+}
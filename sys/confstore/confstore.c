@@ -0,0 +1,362 @@
+/**
+ * Typed key-value configuration store in internal flash
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_confstore
+ * @{
+ * @file    confstore.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "flashlog.h"
+#include "hashes.h"
+#include "mutex.h"
+#include "confstore.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#if CONFSTORE_ENTRIES & (CONFSTORE_ENTRIES - 1)
+#error "CONFSTORE_ENTRIES must be a power of two"
+#endif
+
+typedef struct {
+    uint32_t key;
+    uint8_t type;
+    uint8_t len;
+    uint8_t value[CONFSTORE_VALUE_MAX];
+} entry_t;
+
+static flashlog_t store;
+static mutex_t lock;
+static entry_t table[CONFSTORE_ENTRIES];
+static uint16_t count;
+/* sequence number of the sector holding the latest full copy */
+static uint32_t written_seq;
+
+static uint32_t key_hash(const char *key)
+{
+    return fnv_hash((const uint8_t *) key, strlen(key));
+}
+
+/* slot of *key*, or the free slot to put it, NULL if the table is full */
+static entry_t *lookup(uint32_t key)
+{
+    unsigned i = key & (CONFSTORE_ENTRIES - 1);
+    entry_t *free_slot = NULL;
+
+    for (unsigned n = 0; n < CONFSTORE_ENTRIES; n++) {
+        entry_t *e = &table[(i + n) & (CONFSTORE_ENTRIES - 1)];
+
+        if (e->key == key && e->type != CONFSTORE_NONE) {
+            return e;
+        }
+
+        if (e->type == CONFSTORE_NONE) {
+            if (free_slot == NULL) {
+                free_slot = e;
+            }
+
+            if (e->key == 0) {
+                /* never used, the probe sequence ends here */
+                break;
+            }
+        }
+    }
+
+    return free_slot;
+}
+
+/* applies the entries in *buf*, returns -1 if one did not fit */
+static int apply(const uint8_t *buf, uint16_t len)
+{
+    int res = 0;
+
+    for (uint16_t off = 0; off + CONFSTORE_ENTRY_HEADER <= len;) {
+        uint32_t key;
+        uint8_t type = buf[off + 4];
+        uint8_t vlen = buf[off + 5];
+
+        memcpy(&key, buf + off, sizeof(key));
+        off += CONFSTORE_ENTRY_HEADER;
+
+        if ((off + vlen > len) || (vlen > CONFSTORE_VALUE_MAX)) {
+            DEBUG("confstore: broken entry\n");
+            return -1;
+        }
+
+        entry_t *e = lookup(key);
+
+        if (type == CONFSTORE_NONE) {
+            if ((e != NULL) && (e->type != CONFSTORE_NONE)) {
+                /* keep the key as a tombstone for the probing */
+                e->type = CONFSTORE_NONE;
+                count--;
+            }
+        }
+        else if (e == NULL) {
+            res = -1;
+        }
+        else {
+            if (e->type == CONFSTORE_NONE) {
+                count++;
+            }
+
+            e->key = key;
+            e->type = type;
+            e->len = vlen;
+            memcpy(e->value, buf + off, vlen);
+        }
+
+        off += vlen;
+    }
+
+    return res;
+}
+
+/* number of keys set in *buf* that are not in the table, at most */
+static unsigned new_keys(const uint8_t *buf, uint16_t len)
+{
+    unsigned n = 0;
+
+    for (uint16_t off = 0; off + CONFSTORE_ENTRY_HEADER <= len;
+         off += CONFSTORE_ENTRY_HEADER + buf[off + 5]) {
+        uint32_t key;
+        entry_t *e;
+
+        memcpy(&key, buf + off, sizeof(key));
+        e = lookup(key);
+
+        if ((buf[off + 4] != CONFSTORE_NONE) &&
+            ((e == NULL) || (e->type == CONFSTORE_NONE))) {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+static int add(confstore_txn_t *txn, uint32_t key, uint8_t type,
+               const void *value, uint8_t len)
+{
+    if ((len > CONFSTORE_VALUE_MAX) ||
+        ((size_t)(txn->len + CONFSTORE_ENTRY_HEADER + len) > sizeof(txn->buf))) {
+        return -1;
+    }
+
+    uint8_t *p = txn->buf + txn->len;
+
+    memcpy(p, &key, sizeof(key));
+    p[4] = type;
+    p[5] = len;
+    if (len) {
+        memcpy(p + CONFSTORE_ENTRY_HEADER, value, len);
+    }
+    txn->len += CONFSTORE_ENTRY_HEADER + len;
+
+    return 0;
+}
+
+/* appends *txn*, copies all entries once the log opened a new sector */
+static int append(confstore_txn_t *txn)
+{
+    int res = flashlog_append(&store, store.last + 1, txn->buf, txn->len);
+
+    while ((res == 0) && (store.seq != written_seq)) {
+        written_seq = store.seq;
+        DEBUG("confstore: copying %u entries to sector %lu\n",
+              count, (unsigned long) written_seq);
+
+        confstore_begin(txn);
+
+        for (unsigned i = 0; (res == 0) && (i < CONFSTORE_ENTRIES); i++) {
+            entry_t *e = &table[i];
+
+            if (e->type == CONFSTORE_NONE) {
+                continue;
+            }
+
+            if (add(txn, e->key, e->type, e->value, e->len) < 0) {
+                res = flashlog_append(&store, store.last + 1, txn->buf, txn->len);
+                confstore_begin(txn);
+                add(txn, e->key, e->type, e->value, e->len);
+            }
+        }
+
+        if ((res == 0) && txn->len) {
+            res = flashlog_append(&store, store.last + 1, txn->buf, txn->len);
+        }
+    }
+
+    return res;
+}
+
+int confstore_init(uint8_t *start, uint8_t sectors, uint32_t sector_size)
+{
+    flashlog_cursor_t cursor;
+    confstore_txn_t txn;
+    int len;
+
+    mutex_init(&lock);
+    memset(table, 0, sizeof(table));
+    count = 0;
+
+    if (flashlog_init(&store, start, sectors, sector_size) < 0) {
+        return -1;
+    }
+
+    /* replay the log, later entries win */
+    flashlog_seek(&store, &cursor, 0);
+
+    while ((len = flashlog_read(&store, &cursor, NULL, txn.buf,
+                                sizeof(txn.buf))) >= 0) {
+        if (apply(txn.buf, len) < 0) {
+            DEBUG("confstore: table full while loading\n");
+        }
+    }
+
+    written_seq = store.seq;
+    DEBUG("confstore: %u entries loaded\n", count);
+    return 0;
+}
+
+void confstore_begin(confstore_txn_t *txn)
+{
+    txn->len = 0;
+}
+
+int confstore_set_u32(confstore_txn_t *txn, const char *key, uint32_t value)
+{
+    return add(txn, key_hash(key), CONFSTORE_U32, &value, sizeof(value));
+}
+
+int confstore_set_i32(confstore_txn_t *txn, const char *key, int32_t value)
+{
+    return add(txn, key_hash(key), CONFSTORE_I32, &value, sizeof(value));
+}
+
+int confstore_set_str(confstore_txn_t *txn, const char *key, const char *value)
+{
+    size_t len = strlen(value) + 1;
+
+    if (len > CONFSTORE_VALUE_MAX) {
+        return -1;
+    }
+
+    return add(txn, key_hash(key), CONFSTORE_STR, value, len);
+}
+
+int confstore_set_blob(confstore_txn_t *txn, const char *key,
+                       const void *value, uint8_t len)
+{
+    return add(txn, key_hash(key), CONFSTORE_BLOB, value, len);
+}
+
+int confstore_unset(confstore_txn_t *txn, const char *key)
+{
+    return add(txn, key_hash(key), CONFSTORE_NONE, NULL, 0);
+}
+
+int confstore_commit(confstore_txn_t *txn)
+{
+    int res;
+
+    if (txn->len == 0) {
+        return 0;
+    }
+
+    mutex_lock(&lock);
+
+    /* check that every new key finds a slot before anything is written */
+    if (new_keys(txn->buf, txn->len) > (unsigned)(CONFSTORE_ENTRIES - count)) {
+        mutex_unlock(&lock);
+        return -1;
+    }
+
+    apply(txn->buf, txn->len);
+
+    res = append(txn);
+
+    if (res == 0) {
+        res = flashlog_sync(&store);
+    }
+
+    mutex_unlock(&lock);
+    return (res < 0) ? -2 : 0;
+}
+
+/* the entry of *key* if it has *type* */
+static const entry_t *get(const char *key, uint8_t type)
+{
+    const entry_t *e = lookup(key_hash(key));
+
+    if ((e == NULL) || (e->type != type)) {
+        return NULL;
+    }
+
+    return e;
+}
+
+int confstore_get_u32(const char *key, uint32_t *value)
+{
+    const entry_t *e = get(key, CONFSTORE_U32);
+
+    if (e == NULL) {
+        return -1;
+    }
+
+    memcpy(value, e->value, sizeof(*value));
+    return 0;
+}
+
+int confstore_get_i32(const char *key, int32_t *value)
+{
+    const entry_t *e = get(key, CONFSTORE_I32);
+
+    if (e == NULL) {
+        return -1;
+    }
+
+    memcpy(value, e->value, sizeof(*value));
+    return 0;
+}
+
+int confstore_get_str(const char *key, char *buf, uint8_t size)
+{
+    const entry_t *e = get(key, CONFSTORE_STR);
+
+    if ((e == NULL) || (size == 0)) {
+        return -1;
+    }
+
+    uint8_t len = e->len - 1;
+
+    if (len >= size) {
+        len = size - 1;
+    }
+
+    memcpy(buf, e->value, len);
+    buf[len] = '\0';
+    return e->len - 1;
+}
+
+int confstore_get_blob(const char *key, void *buf, uint8_t size)
+{
+    const entry_t *e = get(key, CONFSTORE_BLOB);
+
+    if (e == NULL) {
+        return -1;
+    }
+
+    memcpy(buf, e->value, (e->len < size) ? e->len : size);
+    return e->len;
+}
@@ -281,26 +281,73 @@ int tripledes_setup_key(cipher_context_t *context, uint8_t *key,
                          keysize, key);
 }
 
-int tripledes_encrypt(cipher_context_t *context, uint8_t *plain, uint8_t *crypt)
+/* schedule of the last key, see cipher_key_cache_t, allocated on first use */
+static cipher_key_cache_t key_cache;
+static struct des3_key_s *cached_key;
+
+/*
+ * Gets the schedule of the key in *context*: the cached one if it belongs to
+ * the last key, else it is expanded into the cache or, if another thread
+ * uses the cache, into a block of its own.  *held* tells whether
+ * des3_schedule_done() releases the cache or frees that block.
+ */
+static struct des3_key_s *des3_schedule(cipher_context_t *context, int *held)
 {
-    int res;
-    struct des3_key_s *key = malloc(sizeof(des3_key_s));
-    uint32_t work[2];
+    int state = cipher_key_cache_acquire(&key_cache, context);
+    struct des3_key_s *key;
+
+    *held = (state >= 0);
+
+    if (state == 1) {
+        return cached_key;
+    }
+
+    if ((state == 0) && (cached_key == NULL)) {
+        cached_key = malloc(sizeof(des3_key_s));
+    }
+
+    key = (state == 0) ? cached_key : malloc(sizeof(des3_key_s));
 
     if (!key) {
         printf("%-40s: [ERROR] Could NOT malloc space for the des3_key_s \
                    struct.\r\n", __FUNCTION__);
-        return -1;
+
+        if (*held) {
+            cipher_key_cache_release(&key_cache);
+            *held = 0;
+        }
+
+        return NULL;
     }
 
     memset(key, 0, sizeof(des3_key_s));
-    res = des3_key_setup(context->context, key);
+    des3_key_setup(context->context, key);
+
+    if (*held) {
+        key_cache.valid = 1;
+    }
+
+    return key;
+}
 
-    if (res < 0) {
-        printf("%-40s: [ERROR] des3_key_setup failed with Code %i\r\n",
-               __FUNCTION__, res);
+static void des3_schedule_done(struct des3_key_s *key, int held)
+{
+    if (held) {
+        cipher_key_cache_release(&key_cache);
+    }
+    else {
         free(key);
-        return -2;
+    }
+}
+
+int tripledes_encrypt(cipher_context_t *context, uint8_t *plain, uint8_t *crypt)
+{
+    int held;
+    struct des3_key_s *key = des3_schedule(context, &held);
+    uint32_t work[2];
+
+    if (!key) {
+        return -1;
     }
 
     work[0] = WPA_GET_BE32(plain);
@@ -311,33 +358,21 @@ int tripledes_encrypt(cipher_context_t *context, uint8_t *plain, uint8_t *crypt)
     WPA_PUT_BE32(crypt, work[0]);
     WPA_PUT_BE32(crypt + 4, work[1]);
 
-    free(key);
+    des3_schedule_done(key, held);
     return 1;
 }
 
 
 int tripledes_decrypt(cipher_context_t *context, uint8_t *crypt, uint8_t *plain)
 {
-    int res;
-    struct des3_key_s *key = malloc(sizeof(des3_key_s));
+    int held;
+    struct des3_key_s *key = des3_schedule(context, &held);
     uint32_t work[2];
 
     if (!key) {
-        printf("%-40s: [ERROR] Could NOT malloc space for the des3_key_s \
-                        struct.\r\n", __FUNCTION__);
         return -1;
     }
 
-    memset(key, 0, sizeof(des3_key_s));
-    res = des3_key_setup(context->context, key);
-
-    if (res < 0) {
-        printf("%-40s: [ERROR] des3_key_setup failed with Code %i\r\n",
-               __FUNCTION__, res);
-        free(key);
-        return -2;
-    }
-
     work[0] = WPA_GET_BE32(crypt);
     work[1] = WPA_GET_BE32(crypt + 4);
     desfunc(work, key->dk[0]);
@@ -346,7 +381,7 @@ int tripledes_decrypt(cipher_context_t *context, uint8_t *crypt, uint8_t *plain)
     WPA_PUT_BE32(plain, work[0]);
     WPA_PUT_BE32(plain + 4, work[1]);
 
-    free(key);
+    des3_schedule_done(key, held);
     return 1;
 }
 
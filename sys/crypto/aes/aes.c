@@ -938,6 +938,48 @@ static int aes_set_decrypt_key(const unsigned char *userKey, const int bits,
 }
 
 #ifndef AES_ASM
+/* schedules of the last key, see cipher_key_cache_t */
+static cipher_key_cache_t enc_cache, dec_cache;
+static AES_KEY enc_schedule, dec_schedule;
+
+/*
+ * Gets the schedule of the key in *context*: *cached* if it belongs to the
+ * last key, else *expand* expands it into *cached* or, if another thread
+ * uses the cache, into *tmp*.  Returns NULL if the key is refused, *held*
+ * tells whether the cache has to be released.
+ */
+static const AES_KEY *aes_schedule(cipher_key_cache_t *cache, AES_KEY *cached,
+                                   AES_KEY *tmp,
+                                   const cipher_context_t *context,
+                                   int (*expand)(const unsigned char *,
+                                                 const int, AES_KEY *),
+                                   int *held)
+{
+    int state = cipher_key_cache_acquire(cache, context);
+    AES_KEY *key = (state < 0) ? tmp : cached;
+
+    *held = (state >= 0);
+
+    if (state == 1) {
+        return cached;
+    }
+
+    if (expand(context->context, AES_KEY_SIZE * 8, key) < 0) {
+        if (*held) {
+            cipher_key_cache_release(cache);
+            *held = 0;
+        }
+
+        return NULL;
+    }
+
+    if (state == 0) {
+        cache->valid = 1;
+    }
+
+    return key;
+}
+
 /*
  * Encrypt a single block
  * in and out can overlap
@@ -945,16 +987,35 @@ static int aes_set_decrypt_key(const unsigned char *userKey, const int bits,
 int aes_encrypt(cipher_context_t *context, uint8_t *plainBlock,
                 uint8_t *cipherBlock)
 {
-    //setup AES_KEY
-    int res;
     AES_KEY aeskey;
-    const AES_KEY *key = &aeskey;
-    res = aes_set_encrypt_key((unsigned char *)context->context,
-                                   AES_KEY_SIZE * 8, &aeskey);
-    if (res < 0) {
-        return res;
+    int held;
+    const AES_KEY *key = aes_schedule(&enc_cache, &enc_schedule, &aeskey,
+                                      context, aes_set_encrypt_key, &held);
+
+    if (key == NULL) {
+        return -1;
     }
 
+    aes_encrypt_schedule(key, plainBlock, cipherBlock);
+
+    if (held) {
+        cipher_key_cache_release(&enc_cache);
+    }
+
+    return 1;
+}
+
+int aes_set_key_schedule(AES_KEY *key, const uint8_t *user_key,
+                         uint8_t keysize)
+{
+    return aes_set_encrypt_key(user_key, keysize * 8, key);
+}
+
+/**
+ * Encrypt a single block with an already expanded key schedule.
+ */
+void aes_encrypt_schedule(const AES_KEY *key, const uint8_t *in, uint8_t *out)
+{
     const u32 *rk;
     u32 s0, s1, s2, s3, t0, t1, t2, t3;
 #ifndef FULL_UNROLL
@@ -967,10 +1028,10 @@ int aes_encrypt(cipher_context_t *context, uint8_t *plainBlock,
      * map byte array block to cipher state
      * and add initial round key:
      */
-    s0 = GETU32(plainBlock) ^ rk[0];
-    s1 = GETU32(plainBlock +  4) ^ rk[1];
-    s2 = GETU32(plainBlock +  8) ^ rk[2];
-    s3 = GETU32(plainBlock + 12) ^ rk[3];
+    s0 = GETU32(in) ^ rk[0];
+    s1 = GETU32(in +  4) ^ rk[1];
+    s2 = GETU32(in +  8) ^ rk[2];
+    s3 = GETU32(in + 12) ^ rk[3];
 #ifdef FULL_UNROLL
     /* round 1: */
     t0 = Te0[s0 >> 24] ^ Te1[(s1 >> 16) & 0xff] ^ Te2[(s2 >>  8) & 0xff] ^
@@ -1172,29 +1233,28 @@ int aes_encrypt(cipher_context_t *context, uint8_t *plainBlock,
         (Te4[(t2 >>  8) & 0xff] & 0x0000ff00) ^
         (Te4[(t3) & 0xff]       & 0x000000ff) ^
         rk[0];
-    PUTU32(cipherBlock     , s0);
+    PUTU32(out     , s0);
     s1 =
         (Te4[(t1 >> 24)       ] & 0xff000000) ^
         (Te4[(t2 >> 16) & 0xff] & 0x00ff0000) ^
         (Te4[(t3 >>  8) & 0xff] & 0x0000ff00) ^
         (Te4[(t0) & 0xff]       & 0x000000ff) ^
         rk[1];
-    PUTU32(cipherBlock +  4, s1);
+    PUTU32(out +  4, s1);
     s2 =
         (Te4[(t2 >> 24)       ] & 0xff000000) ^
         (Te4[(t3 >> 16) & 0xff] & 0x00ff0000) ^
         (Te4[(t0 >>  8) & 0xff] & 0x0000ff00) ^
         (Te4[(t1) & 0xff]       & 0x000000ff) ^
         rk[2];
-    PUTU32(cipherBlock +  8, s2);
+    PUTU32(out +  8, s2);
     s3 =
         (Te4[(t3 >> 24)       ] & 0xff000000) ^
         (Te4[(t0 >> 16) & 0xff] & 0x00ff0000) ^
         (Te4[(t1 >>  8) & 0xff] & 0x0000ff00) ^
         (Te4[(t2) & 0xff]       & 0x000000ff) ^
         rk[3];
-    PUTU32(cipherBlock + 12, s3);
-    return 1;
+    PUTU32(out + 12, s3);
 }
 
 /*
@@ -1204,15 +1264,13 @@ int aes_encrypt(cipher_context_t *context, uint8_t *plainBlock,
 int aes_decrypt(cipher_context_t *context, uint8_t *cipherBlock,
                 uint8_t *plainBlock)
 {
-    //setup AES_KEY
-    int res;
     AES_KEY aeskey;
-    const AES_KEY *key = &aeskey;
-    res = aes_set_decrypt_key((unsigned char *)context->context,
-                              AES_KEY_SIZE * 8, &aeskey);
+    int held;
+    const AES_KEY *key = aes_schedule(&dec_cache, &dec_schedule, &aeskey,
+                                      context, aes_set_decrypt_key, &held);
 
-    if (res < 0) {
-        return res;
+    if (key == NULL) {
+        return -1;
     }
 
     const u32 *rk;
@@ -1454,6 +1512,11 @@ int aes_decrypt(cipher_context_t *context, uint8_t *cipherBlock,
         (Td4[(t0) & 0xff]       & 0x000000ff) ^
         rk[3];
     PUTU32(plainBlock + 12, s3);
+
+    if (held) {
+        cipher_key_cache_release(&dec_cache);
+    }
+
     return 1;
 }
 
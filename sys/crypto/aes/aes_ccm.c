@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * This source code is licensed under the LGPLv2 license,
+ * See the file LICENSE for more details.
+ */
+
+/**
+ * @ingroup     sys_crypto
+ * @{
+ *
+ * @file        aes_ccm.c
+ * @brief       CTR and CCM* modes of operation on an AES context
+ *
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "crypto/aes.h"
+#include "crypto/ccmmode.h"
+
+static void ctr_increment(uint8_t *ctr)
+{
+    int i;
+
+    for (i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+        if (++ctr[i] != 0) {
+            break;
+        }
+    }
+}
+
+void aes_ctr_crypt(const aes_ctx_t *ctx, uint8_t *ctr, const uint8_t *in,
+                   uint8_t *out, uint16_t len)
+{
+    uint8_t stream[AES_BLOCK_SIZE];
+
+    while (len > 0) {
+        uint8_t n = (len < AES_BLOCK_SIZE) ? len : AES_BLOCK_SIZE;
+        uint8_t i;
+
+        aes_ctx_encrypt(ctx, ctr, stream);
+        ctr_increment(ctr);
+
+        for (i = 0; i < n; i++) {
+            out[i] = in[i] ^ stream[i];
+        }
+
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+static int ccm_check(uint8_t nonce_len, uint8_t mic_len)
+{
+    if ((nonce_len < CCM_NONCE_MIN_LEN) || (nonce_len > CCM_NONCE_MAX_LEN)) {
+        return -2;
+    }
+
+    if ((mic_len != 0) &&
+        ((mic_len < 4) || (mic_len > CCM_MIC_MAX_LEN) || (mic_len & 1))) {
+        return -3;
+    }
+
+    return 0;
+}
+
+/* fills flags, nonce and a big endian *value* into the L bytes after it */
+static void ccm_block(uint8_t *block, uint8_t flags, const uint8_t *nonce,
+                      uint8_t nonce_len, uint16_t value)
+{
+    memset(block, 0, AES_BLOCK_SIZE);
+    block[0] = flags;
+    memcpy(block + 1, nonce, nonce_len);
+    block[AES_BLOCK_SIZE - 2] = value >> 8;
+    block[AES_BLOCK_SIZE - 1] = value & 0xff;
+}
+
+/* CBC-MAC over *data*, continuing at *pos* bytes into the current block */
+static uint8_t ccm_mac_update(const aes_ctx_t *ctx, uint8_t *x, uint8_t pos,
+                              const uint8_t *data, uint16_t len)
+{
+    while (len--) {
+        x[pos++] ^= *data++;
+
+        if (pos == AES_BLOCK_SIZE) {
+            aes_ctx_encrypt(ctx, x, x);
+            pos = 0;
+        }
+    }
+
+    return pos;
+}
+
+static void ccm_mac(const aes_ctx_t *ctx, const uint8_t *nonce,
+                    uint8_t nonce_len, const uint8_t *adata, uint16_t adata_len,
+                    const uint8_t *plain, uint16_t len, uint8_t mic_len,
+                    uint8_t *x)
+{
+    uint8_t l = AES_BLOCK_SIZE - 1 - nonce_len;
+    uint8_t flags = (((mic_len - 2) / 2) << 3) | (l - 1);
+    uint8_t pos;
+
+    if (adata_len) {
+        flags |= 0x40;
+    }
+
+    ccm_block(x, flags, nonce, nonce_len, len);
+    aes_ctx_encrypt(ctx, x, x);
+
+    if (adata_len) {
+        /* lengths below 0xff00 are encoded in two bytes */
+        x[0] ^= adata_len >> 8;
+        x[1] ^= adata_len & 0xff;
+        pos = ccm_mac_update(ctx, x, 2, adata, adata_len);
+
+        if (pos) {
+            aes_ctx_encrypt(ctx, x, x);
+        }
+    }
+
+    pos = ccm_mac_update(ctx, x, 0, plain, len);
+
+    if (pos) {
+        aes_ctx_encrypt(ctx, x, x);
+    }
+}
+
+int aes_ccm_encrypt(const aes_ctx_t *ctx, const uint8_t *nonce,
+                    uint8_t nonce_len, const uint8_t *adata, uint16_t adata_len,
+                    const uint8_t *in, uint8_t *out, uint16_t len,
+                    uint8_t *mic, uint8_t mic_len)
+{
+    uint8_t x[AES_BLOCK_SIZE];
+    uint8_t ctr[AES_BLOCK_SIZE];
+    int res = ccm_check(nonce_len, mic_len);
+
+    if (res < 0) {
+        return res;
+    }
+
+    if (mic_len) {
+        ccm_mac(ctx, nonce, nonce_len, adata, adata_len, in, len, mic_len, x);
+    }
+
+    /* A_0 encrypts the MIC, the payload starts at A_1 */
+    ccm_block(ctr, AES_BLOCK_SIZE - 2 - nonce_len, nonce, nonce_len, 0);
+
+    if (mic_len) {
+        aes_ctr_crypt(ctx, ctr, x, mic, mic_len);
+    }
+    else {
+        ctr_increment(ctr);
+    }
+
+    aes_ctr_crypt(ctx, ctr, in, out, len);
+    return 0;
+}
+
+int aes_ccm_decrypt(const aes_ctx_t *ctx, const uint8_t *nonce,
+                    uint8_t nonce_len, const uint8_t *adata, uint16_t adata_len,
+                    const uint8_t *in, uint8_t *out, uint16_t len,
+                    const uint8_t *mic, uint8_t mic_len)
+{
+    uint8_t x[AES_BLOCK_SIZE];
+    uint8_t ctr[AES_BLOCK_SIZE];
+    uint8_t s0[AES_BLOCK_SIZE];
+    uint8_t diff = 0;
+    uint8_t i;
+    int res = ccm_check(nonce_len, mic_len);
+
+    if (res < 0) {
+        return res;
+    }
+
+    ccm_block(ctr, AES_BLOCK_SIZE - 2 - nonce_len, nonce, nonce_len, 0);
+    aes_ctx_encrypt(ctx, ctr, s0);
+    ctr_increment(ctr);
+    aes_ctr_crypt(ctx, ctr, in, out, len);
+
+    if (mic_len == 0) {
+        return 0;
+    }
+
+    ccm_mac(ctx, nonce, nonce_len, adata, adata_len, out, len, mic_len, x);
+
+    /* compare in constant time */
+    for (i = 0; i < mic_len; i++) {
+        diff |= x[i] ^ s0[i] ^ mic[i];
+    }
+
+    if (diff) {
+        memset(out, 0, len);
+        return -1;
+    }
+
+    return 0;
+}
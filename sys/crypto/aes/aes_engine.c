@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * This source code is licensed under the LGPLv2 license,
+ * See the file LICENSE for more details.
+ */
+
+/**
+ * @ingroup     sys_crypto
+ * @{
+ *
+ * @file        aes_engine.c
+ * @brief       AES contexts, the software engine and the provider registry
+ *
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "crypto/aes.h"
+
+#if AES_COMPACT
+#define AES_COMPACT_ROUNDS  (10)
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static uint8_t xtime(uint8_t x)
+{
+    return (x << 1) ^ ((x & 0x80) ? 0x1b : 0x00);
+}
+
+/* the round keys are kept as 176 bytes in rd_key */
+static int sw_set_key(aes_ctx_t *ctx, const uint8_t *key, uint8_t keysize)
+{
+    uint8_t *rk = (uint8_t *) ctx->key.rd_key;
+    uint8_t rcon = 0x01;
+    uint8_t i;
+
+    if (keysize != AES_KEY_SIZE) {
+        return -2;
+    }
+
+    memcpy(rk, key, AES_KEY_SIZE);
+
+    for (i = AES_KEY_SIZE; i < AES_BLOCK_SIZE * (AES_COMPACT_ROUNDS + 1); i += 4) {
+        uint8_t t0 = rk[i - 4], t1 = rk[i - 3], t2 = rk[i - 2], t3 = rk[i - 1];
+
+        if ((i % AES_KEY_SIZE) == 0) {
+            /* RotWord, SubWord and Rcon */
+            uint8_t tmp = t0;
+            t0 = sbox[t1] ^ rcon;
+            t1 = sbox[t2];
+            t2 = sbox[t3];
+            t3 = sbox[tmp];
+            rcon = xtime(rcon);
+        }
+
+        rk[i] = rk[i - AES_KEY_SIZE] ^ t0;
+        rk[i + 1] = rk[i + 1 - AES_KEY_SIZE] ^ t1;
+        rk[i + 2] = rk[i + 2 - AES_KEY_SIZE] ^ t2;
+        rk[i + 3] = rk[i + 3 - AES_KEY_SIZE] ^ t3;
+    }
+
+    ctx->key.rounds = AES_COMPACT_ROUNDS;
+    return 0;
+}
+
+static void sw_encrypt(const aes_ctx_t *ctx, const uint8_t *in, uint8_t *out)
+{
+    const uint8_t *rk = (const uint8_t *) ctx->key.rd_key;
+    uint8_t s[AES_BLOCK_SIZE], t[AES_BLOCK_SIZE];
+    uint8_t round, i;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++) {
+        s[i] = in[i] ^ rk[i];
+    }
+
+    for (round = 1; round <= AES_COMPACT_ROUNDS; round++) {
+        rk += AES_BLOCK_SIZE;
+
+        /* SubBytes and ShiftRows, the state is column major */
+        for (i = 0; i < AES_BLOCK_SIZE; i++) {
+            t[i] = sbox[s[(i + 4 * (i % 4)) % AES_BLOCK_SIZE]];
+        }
+
+        if (round == AES_COMPACT_ROUNDS) {
+            for (i = 0; i < AES_BLOCK_SIZE; i++) {
+                out[i] = t[i] ^ rk[i];
+            }
+
+            return;
+        }
+
+        /* MixColumns and AddRoundKey */
+        for (i = 0; i < AES_BLOCK_SIZE; i += 4) {
+            uint8_t all = t[i] ^ t[i + 1] ^ t[i + 2] ^ t[i + 3];
+
+            s[i] = t[i] ^ all ^ xtime(t[i] ^ t[i + 1]) ^ rk[i];
+            s[i + 1] = t[i + 1] ^ all ^ xtime(t[i + 1] ^ t[i + 2]) ^ rk[i + 1];
+            s[i + 2] = t[i + 2] ^ all ^ xtime(t[i + 2] ^ t[i + 3]) ^ rk[i + 2];
+            s[i + 3] = t[i + 3] ^ all ^ xtime(t[i + 3] ^ t[i]) ^ rk[i + 3];
+        }
+    }
+}
+#else
+static int sw_set_key(aes_ctx_t *ctx, const uint8_t *key, uint8_t keysize)
+{
+    return aes_set_key_schedule(&ctx->key, key, keysize);
+}
+
+static void sw_encrypt(const aes_ctx_t *ctx, const uint8_t *in, uint8_t *out)
+{
+    aes_encrypt_schedule(&ctx->key, in, out);
+}
+#endif
+
+const aes_engine_t aes_engine_software = {
+    sw_set_key,
+    sw_encrypt
+};
+
+static crypto_provider_t software_provider = {
+    "software",
+#if AES_COMPACT
+    CRYPTO_PROVIDER_KEY_128,
+#else
+    CRYPTO_PROVIDER_KEY_128 | CRYPTO_PROVIDER_KEY_192 | CRYPTO_PROVIDER_KEY_256,
+#endif
+    AES_SOFTWARE_RANK,
+    &aes_engine_software,
+    NULL
+};
+
+/* sorted by rank, drivers register during auto_init */
+static crypto_provider_t *providers = &software_provider;
+
+void crypto_provider_register(crypto_provider_t *provider)
+{
+    crypto_provider_t **p = &providers;
+
+    while (*p && ((*p)->rank >= provider->rank)) {
+        if (*p == provider) {
+            return;
+        }
+
+        p = &(*p)->next;
+    }
+
+    provider->next = *p;
+    *p = provider;
+}
+
+const crypto_provider_t *crypto_provider_find(uint8_t flags)
+{
+    const crypto_provider_t *p;
+
+    for (p = providers; p; p = p->next) {
+        if ((p->flags & flags) == flags) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+const crypto_provider_t *crypto_provider_list(void)
+{
+    return providers;
+}
+
+int aes_ctx_init(aes_ctx_t *ctx, const aes_engine_t *engine,
+                 const uint8_t *key, uint8_t keysize)
+{
+    if (engine == NULL) {
+        const crypto_provider_t *p;
+
+        if ((keysize != 16) && (keysize != 24) && (keysize != 32)) {
+            return -2;
+        }
+
+        p = crypto_provider_find(CRYPTO_PROVIDER_KEY(keysize));
+        engine = p ? p->aes : &aes_engine_software;
+    }
+
+    ctx->engine = engine;
+    return ctx->engine->set_key(ctx, key, keysize);
+}
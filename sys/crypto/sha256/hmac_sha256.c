@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup     sys_crypto
+ * @{
+ *
+ * @file        hmac_sha256.c
+ * @brief       HMAC-SHA256 (RFC 2104) and HKDF-SHA256 (RFC 5869)
+ *
+ * @}
+ */
+
+#include <string.h>
+
+#include "crypto/sha256.h"
+
+#define IPAD    (0x36)
+#define OPAD    (0x5c)
+
+/* hashes one key block, the state after it starts every message */
+static void hmac_pad(uint32_t *state, const unsigned char *key, uint8_t pad)
+{
+    sha256_context_t ctx;
+    unsigned char block[SHA256_BLOCK_LENGTH];
+
+    for (int i = 0; i < SHA256_BLOCK_LENGTH; i++) {
+        block[i] = key[i] ^ pad;
+    }
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, block, SHA256_BLOCK_LENGTH);
+    memcpy(state, ctx.state, sizeof(ctx.state));
+
+    memset(block, 0, sizeof(block));
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+/* continues from a keyed state, one block already counted */
+static void hmac_start(sha256_context_t *ctx, const uint32_t *state)
+{
+    memcpy(ctx->state, state, sizeof(ctx->state));
+    ctx->count[0] = 0;
+    ctx->count[1] = SHA256_BLOCK_LENGTH * 8;
+}
+
+void hmac_sha256_init(hmac_sha256_context_t *hctx, const void *key,
+                      size_t keylen)
+{
+    unsigned char k[SHA256_BLOCK_LENGTH];
+
+    memset(k, 0, sizeof(k));
+
+    if (keylen > SHA256_BLOCK_LENGTH) {
+        sha256(key, keylen, k);
+    }
+    else {
+        memcpy(k, key, keylen);
+    }
+
+    hmac_pad(hctx->istate, k, IPAD);
+    hmac_pad(hctx->ostate, k, OPAD);
+    memset(k, 0, sizeof(k));
+
+    hmac_sha256_reset(hctx);
+}
+
+void hmac_sha256_reset(hmac_sha256_context_t *hctx)
+{
+    hmac_start(&hctx->ctx, hctx->istate);
+}
+
+void hmac_sha256_update(hmac_sha256_context_t *hctx, const void *in,
+                        size_t len)
+{
+    sha256_update(&hctx->ctx, in, len);
+}
+
+void hmac_sha256_final(unsigned char digest[32], hmac_sha256_context_t *hctx)
+{
+    unsigned char inner[SHA256_DIGEST_LENGTH];
+
+    sha256_final(inner, &hctx->ctx);
+
+    hmac_start(&hctx->ctx, hctx->ostate);
+    sha256_update(&hctx->ctx, inner, SHA256_DIGEST_LENGTH);
+    sha256_final(digest, &hctx->ctx);
+
+    memset(inner, 0, sizeof(inner));
+}
+
+void hmac_sha256(const void *key, size_t keylen, const void *d, size_t n,
+                 unsigned char *md)
+{
+    hmac_sha256_context_t hctx;
+
+    hmac_sha256_init(&hctx, key, keylen);
+    hmac_sha256_update(&hctx, d, n);
+    hmac_sha256_final(md, &hctx);
+
+    memset(&hctx, 0, sizeof(hctx));
+}
+
+int hkdf_sha256(const void *salt, size_t salt_len, const void *ikm,
+                size_t ikm_len, const void *info, size_t info_len,
+                unsigned char *okm, size_t okm_len)
+{
+    hmac_sha256_context_t hctx;
+    unsigned char prk[SHA256_DIGEST_LENGTH];
+    unsigned char t[SHA256_DIGEST_LENGTH];
+    unsigned char n = 1;
+
+    if (okm_len > 255 * SHA256_DIGEST_LENGTH) {
+        return -1;
+    }
+
+    /* extract, no salt is a block of zeros just as an empty key */
+    hmac_sha256(salt, salt ? salt_len : 0, ikm, ikm_len, prk);
+
+    /* expand, T(n) = HMAC(PRK, T(n - 1) | info | n) */
+    hmac_sha256_init(&hctx, prk, SHA256_DIGEST_LENGTH);
+
+    while (okm_len > 0) {
+        size_t chunk = (okm_len < SHA256_DIGEST_LENGTH) ?
+                       okm_len : SHA256_DIGEST_LENGTH;
+
+        if (n > 1) {
+            hmac_sha256_update(&hctx, t, SHA256_DIGEST_LENGTH);
+        }
+
+        if (info) {
+            hmac_sha256_update(&hctx, info, info_len);
+        }
+
+        hmac_sha256_update(&hctx, &n, 1);
+        hmac_sha256_final(t, &hctx);
+        hmac_sha256_reset(&hctx);
+
+        memcpy(okm, t, chunk);
+        okm += chunk;
+        okm_len -= chunk;
+        n++;
+    }
+
+    memset(prk, 0, sizeof(prk));
+    memset(t, 0, sizeof(t));
+    memset(&hctx, 0, sizeof(hctx));
+    return 0;
+}
@@ -46,36 +46,21 @@
 #include "crypto/sha256.h"
 #include "board.h"
 
-#ifdef __BIG_ENDIAN__
-/* Copy a vector of big-endian uint32_t into a vector of bytes */
-#define be32enc_vect memcpy
-
-/* Copy a vector of bytes into a vector of big-endian uint32_t */
-#define be32dec_vect memcpy
-
-#else /* !__BIG_ENDIAN__ */
-
 /*
  * Encode a length len/4 vector of (uint32_t) into a length len vector of
- * (unsigned char) in big-endian form.  Assumes len is a multiple of 4.
+ * (unsigned char) in big-endian form.  Assumes len is a multiple of 4,
+ * dst needs no alignment.
  */
-static void be32enc_vect(void *dst_, const void *src_, size_t len)
+static void be32enc_vect(unsigned char *dst, const uint32_t *src, size_t len)
 {
-    uint32_t *dst = dst_;
-    const uint32_t *src = src_;
     for (size_t i = 0; i < len / 4; i++) {
-        dst[i] = __builtin_bswap32(src[i]);
+        dst[4 * i] = src[i] >> 24;
+        dst[4 * i + 1] = src[i] >> 16;
+        dst[4 * i + 2] = src[i] >> 8;
+        dst[4 * i + 3] = src[i];
     }
 }
 
-/*
- * Decode a big-endian length len vector of (unsigned char) into a length
- * len/4 vector of (uint32_t).  Assumes len is a multiple of 4.
- */
-#define be32dec_vect be32enc_vect
-
-#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
-
 /* Elementary functions used by SHA256 */
 #define Ch(x, y, z) ((x & (y ^ z)) ^ z)
 #define Maj(x, y, z)    ((x & (y | z)) | (y & z))
@@ -105,6 +90,32 @@ static const uint32_t K[64] = {
     0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
 };
 
+/* Big-endian load from any alignment, so update() needs no copy of the input */
+#define BE32(p)     (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | \
+                     ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+
+#if SHA256_UNROLL
+/* One round, the working variables are renamed instead of shifted */
+#define RND(a, b, c, d, e, f, g, h, i)                          \
+    do {                                                        \
+        uint32_t t0 = h + S1(e) + Ch(e, f, g) + W[i] + K[i];    \
+        uint32_t t1 = S0(a) + Maj(a, b, c);                     \
+        d += t0;                                                \
+        h = t0 + t1;                                            \
+    } while (0)
+
+#define RND8(i)                                                 \
+    do {                                                        \
+        RND(a, b, c, d, e, f, g, h, i + 0);                     \
+        RND(h, a, b, c, d, e, f, g, i + 1);                     \
+        RND(g, h, a, b, c, d, e, f, i + 2);                     \
+        RND(f, g, h, a, b, c, d, e, i + 3);                     \
+        RND(e, f, g, h, a, b, c, d, i + 4);                     \
+        RND(d, e, f, g, h, a, b, c, i + 5);                     \
+        RND(c, d, e, f, g, h, a, b, i + 6);                     \
+        RND(b, c, d, e, f, g, h, a, i + 7);                     \
+    } while (0)
+
 /*
  * SHA256 block compression function.  The 256-bit state is transformed via
  * the 512-bit input block to produce a new state.
@@ -112,36 +123,83 @@ static const uint32_t K[64] = {
 static void sha256_transform(uint32_t *state, const unsigned char block[64])
 {
     uint32_t W[64];
-    uint32_t S[8];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
 
     /* 1. Prepare message schedule W. */
-    be32dec_vect(W, block, 64);
+    for (int i = 0; i < 16; i++) {
+        W[i] = BE32(&block[4 * i]);
+    }
+
     for (int i = 16; i < 64; i++) {
         W[i] = s1(W[i - 2]) + W[i - 7] + s0(W[i - 15]) + W[i - 16];
     }
 
-    /* 2. Initialize working variables. */
-    memcpy(S, state, 32);
-
-    /* 3. Mix. */
-    for (int i = 0; i < 64; ++i) {
-        uint32_t e = S[(68 - i) % 8], f = S[(69 - i) % 8];
-        uint32_t g = S[(70 - i) % 8], h = S[(71 - i) % 8];
-        uint32_t t0 = h + S1(e) + Ch(e, f, g) + W[i] + K[i];
-
-        uint32_t a = S[(64 - i) % 8], b = S[(65 - i) % 8];
-        uint32_t c = S[(66 - i) % 8], d = S[(67 - i) % 8];
-        uint32_t t1 = S0(a) + Maj(a, b, c);
-
-        S[(67 - i) % 8] = d + t0;
-        S[(71 - i) % 8] = t0 + t1;
+    /* 2. Mix. */
+    RND8(0);
+    RND8(8);
+    RND8(16);
+    RND8(24);
+    RND8(32);
+    RND8(40);
+    RND8(48);
+    RND8(56);
+
+    /* 3. Mix local working variables into global state */
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+#else
+/*
+ * SHA256 block compression function.  The 256-bit state is transformed via
+ * the 512-bit input block to produce a new state.  The message schedule is
+ * computed in a 16 word window to keep the stack small.
+ */
+static void sha256_transform(uint32_t *state, const unsigned char block[64])
+{
+    uint32_t W[16];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t t0, t1;
+
+        if (i < 16) {
+            W[i] = BE32(&block[4 * i]);
+        }
+        else {
+            W[i & 15] += s1(W[(i - 2) & 15]) + W[(i - 7) & 15] +
+                         s0(W[(i - 15) & 15]);
+        }
+
+        t0 = h + S1(e) + Ch(e, f, g) + W[i & 15] + K[i];
+        t1 = S0(a) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + t0;
+        d = c;
+        c = b;
+        b = a;
+        a = t0 + t1;
     }
 
-    /* 4. Mix local working variables into global state */
-    for (int i = 0; i < 8; i++) {
-        state[i] += S[i];
-    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
 }
+#endif
 
 static unsigned char PAD[64] = {
     0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -217,7 +275,7 @@ void sha256_update(sha256_context_t *ctx, const void *in, size_t len)
     src += 64 - r;
     len -= 64 - r;
 
-    /* Perform complete blocks */
+    /* Perform complete blocks straight from the input */
     while (len >= 64) {
         sha256_transform(ctx->state, src);
         src += 64;
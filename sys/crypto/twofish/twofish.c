@@ -646,26 +646,80 @@ static int twofish_set_key(twofish_context_t *ctx, uint8_t *key, uint8_t keylen)
 }
 
 
-/* Encrypt one block.  in and out may be the same. */
-int twofish_encrypt(cipher_context_t *context, uint8_t *in, uint8_t *out)
+/* schedule of the last key, see cipher_key_cache_t, allocated on first use */
+static cipher_key_cache_t key_cache;
+static twofish_context_t *cached_ctx;
+
+/*
+ * Gets the schedule of the key in *context*: the cached one if it belongs to
+ * the last key, else it is expanded into the cache or, if another thread
+ * uses the cache, into a block of its own.  *held* tells whether
+ * twofish_schedule_done() releases the cache or frees that block.
+ */
+static twofish_context_t *twofish_schedule(cipher_context_t *context,
+                                           int *held)
 {
+    int state = cipher_key_cache_acquire(&key_cache, context);
+    twofish_context_t *ctx;
     int res;
-    //setup the twofish-specific context
-    twofish_context_t *ctx = malloc(sizeof(twofish_context_t));
+
+    *held = (state >= 0);
+
+    if (state == 1) {
+        return cached_ctx;
+    }
+
+    if ((state == 0) && (cached_ctx == NULL)) {
+        cached_ctx = malloc(sizeof(twofish_context_t));
+    }
+
+    ctx = (state == 0) ? cached_ctx : malloc(sizeof(twofish_context_t));
 
     if (!ctx) {
         printf("%-40s: [ERROR] Could NOT malloc space for the twofish_context_t \
                 struct.\r\n", __FUNCTION__);
-        return -1;
     }
-
-    res = twofish_set_key(ctx, context->context, TWOFISH_KEY_SIZE);
-
-    if (res < 0) {
+    else if ((res = twofish_set_key(ctx, context->context,
+                                    TWOFISH_KEY_SIZE)) < 0) {
         printf("%-40s: [ERROR] twofish_setKey failed with Code %i\r\n",
                __FUNCTION__, res);
+
+        if (!*held) {
+            free(ctx);
+        }
+
+        ctx = NULL;
+    }
+    else if (*held) {
+        key_cache.valid = 1;
+    }
+
+    if (!ctx && *held) {
+        cipher_key_cache_release(&key_cache);
+        *held = 0;
+    }
+
+    return ctx;
+}
+
+static void twofish_schedule_done(twofish_context_t *ctx, int held)
+{
+    if (held) {
+        cipher_key_cache_release(&key_cache);
+    }
+    else {
         free(ctx);
-        return -2;
+    }
+}
+
+/* Encrypt one block.  in and out may be the same. */
+int twofish_encrypt(cipher_context_t *context, uint8_t *in, uint8_t *out)
+{
+    int held;
+    twofish_context_t *ctx = twofish_schedule(context, &held);
+
+    if (!ctx) {
+        return -1;
     }
 
     /* The four 32-bit chunks of the text. */
@@ -696,31 +750,20 @@ int twofish_encrypt(cipher_context_t *context, uint8_t *in, uint8_t *out)
     OUTUNPACK(2, a, 6);
     OUTUNPACK(3, b, 7);
 
-    free(ctx);
+    twofish_schedule_done(ctx, held);
     return 1;
 }
 
 /* Decrypt one block.  in and out may be the same. */
 int twofish_decrypt(cipher_context_t *context, uint8_t *in, uint8_t *out)
 {
-    int res;
-    twofish_context_t *ctx = malloc(sizeof(twofish_context_t));
+    int held;
+    twofish_context_t *ctx = twofish_schedule(context, &held);
 
     if (!ctx) {
-        printf("%-40s: [ERROR] Could NOT malloc space for the twofish_context_t \
-                struct.\r\n", __FUNCTION__);
         return -1;
     }
 
-    res = twofish_set_key(ctx, context->context, TWOFISH_KEY_SIZE);
-
-    if (res < 0) {
-        printf("%-40s: [ERROR] twofish_setKey failed with Code %i\r\n",
-               __FUNCTION__, res);
-        free(ctx);
-        return -2;
-    }
-
     /* The four 32-bit chunks of the text. */
     uint32_t a, b, c, d;
 
@@ -749,7 +792,7 @@ int twofish_decrypt(cipher_context_t *context, uint8_t *in, uint8_t *out)
     OUTUNPACK(2, c, 2);
     OUTUNPACK(3, d, 3);
 
-    free(ctx);
+    twofish_schedule_done(ctx, held);
     return 1;
 }
 
@@ -0,0 +1,157 @@
+/**
+ * Deferred binary logging
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_dlog
+ * @{
+ * @file    dlog.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+
+#include "kernel.h"
+#include "hwtimer.h"
+#include "irq.h"
+#include "sched.h"
+#include "thread.h"
+#include "thread_flags.h"
+#include "dlog.h"
+
+#if DLOG_SIZE & (DLOG_SIZE - 1)
+#error DLOG_SIZE must be a power of two
+#endif
+
+/* words of a record before the arguments: format, time, number | pid */
+#define HEADER          (3)
+
+#define FLAG_PENDING    (1 << 0)
+
+/* indices run freely, the ring holds head - tail words */
+static uint32_t ring[DLOG_SIZE];
+static unsigned int head;
+static unsigned int tail;
+static unsigned int lost;
+
+static int dlog_pid = -1;
+static char dlog_stack[DLOG_STACKSIZE];
+
+void dlog_write(const char *fmt, const uint32_t *args, unsigned int num)
+{
+    if (num > DLOG_ARGS_MAX) {
+        num = DLOG_ARGS_MAX;
+    }
+
+    unsigned int pid = inISR() ? DLOG_PID_ISR : (unsigned int) thread_pid;
+    unsigned long now = hwtimer_now();
+    unsigned int state = disableIRQ();
+
+    if (DLOG_SIZE - (head - tail) < HEADER + num) {
+        lost++;
+        restoreIRQ(state);
+        return;
+    }
+
+    int wake = (head == tail);
+
+    ring[head++ & (DLOG_SIZE - 1)] = (uint32_t)(uintptr_t) fmt;
+    ring[head++ & (DLOG_SIZE - 1)] = now;
+    ring[head++ & (DLOG_SIZE - 1)] = num | (pid << 8);
+
+    for (unsigned int i = 0; i < num; i++) {
+        ring[head++ & (DLOG_SIZE - 1)] = args[i];
+    }
+
+    restoreIRQ(state);
+
+    if (wake && (dlog_pid >= 0)) {
+        thread_flags_set(dlog_pid, FLAG_PENDING);
+    }
+}
+
+static void put_hex(uint32_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[10];
+
+    buf[0] = ' ';
+    buf[9] = '\0';
+
+    for (int i = 8; i > 0; i--) {
+        buf[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+
+    fputs(buf, stdout);
+}
+
+/* takes one record off the ring, returns its number of words or 0 */
+static unsigned int take(uint32_t *rec)
+{
+    unsigned int state = disableIRQ();
+
+    if (head == tail) {
+        restoreIRQ(state);
+        return 0;
+    }
+
+    unsigned int words = HEADER + (ring[(tail + 2) & (DLOG_SIZE - 1)] & 0xff);
+
+    for (unsigned int i = 0; i < words; i++) {
+        rec[i] = ring[tail++ & (DLOG_SIZE - 1)];
+    }
+
+    restoreIRQ(state);
+    return words;
+}
+
+void dlog_flush(void)
+{
+    uint32_t rec[HEADER + DLOG_ARGS_MAX];
+    unsigned int words;
+
+    while ((words = take(rec)) != 0) {
+        fputs("DLOG", stdout);
+
+        for (unsigned int i = 0; i < words; i++) {
+            put_hex(rec[i]);
+        }
+
+        putchar('\n');
+    }
+
+    unsigned int state = disableIRQ();
+    unsigned int count = lost;
+    lost = 0;
+    restoreIRQ(state);
+
+    if (count) {
+        fputs("DLOG lost", stdout);
+        put_hex(count);
+        putchar('\n');
+    }
+}
+
+static void dlog_thread(void)
+{
+    while (1) {
+        thread_flags_wait_any(FLAG_PENDING);
+        dlog_flush();
+    }
+}
+
+int dlog_init(void)
+{
+    if (dlog_pid < 0) {
+        dlog_pid = thread_create(dlog_stack, sizeof(dlog_stack), DLOG_PRIORITY,
+                                 CREATE_STACKTEST, dlog_thread, "dlog");
+    }
+
+    return dlog_pid;
+}
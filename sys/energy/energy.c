@@ -0,0 +1,242 @@
+/**
+ * Energy accounting
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_energy
+ * @{
+ * @file    energy.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hwtimer.h"
+#include "irq.h"
+#include "kernel.h"
+#include "sched.h"
+#include "vtimer.h"
+
+#ifdef MODULE_LTC4150
+#include "ltc4150.h"
+#endif
+
+#include "energy.h"
+
+/* the state a switch of the MCU or radio leaves and when it was entered */
+typedef struct {
+    uint8_t state;
+    uint64_t since;
+} energy_part_t;
+
+static const char *const state_names[ENERGY_STATES] = {
+    "cpu", "idle", "sleep", "powerdown",
+    "radio_off", "radio_idle", "radio_wor", "radio_rx", "radio_tx"
+};
+
+static uint32_t currents[ENERGY_STATES] = {
+    ENERGY_CURRENT_CPU,
+    ENERGY_CURRENT_LPM_IDLE,
+    ENERGY_CURRENT_LPM_SLEEP,
+    ENERGY_CURRENT_LPM_POWERDOWN,
+    ENERGY_CURRENT_RADIO_OFF,
+    ENERGY_CURRENT_RADIO_IDLE,
+    ENERGY_CURRENT_RADIO_WOR,
+    ENERGY_CURRENT_RADIO_RX,
+    ENERGY_CURRENT_RADIO_TX
+};
+
+/* us per state, without the time since the last switch */
+static uint64_t times[ENERGY_STATES];
+static energy_part_t mcu = { ENERGY_CPU, 0 };
+static energy_part_t radio = { ENERGY_RADIO_OFF, 0 };
+
+/* estimates are scaled by this, in 1/1000 */
+static uint32_t scale = 1000;
+
+#ifdef MODULE_LTC4150
+/* ltc4150 interrupts and unscaled estimate in uC at the last calibration */
+static long calib_ints;
+static uint64_t calib_charge;
+static uint8_t calib_started;
+#endif
+
+#if SCHEDSTATISTICS
+/* runtime of the threads at the last energy_clear() */
+static unsigned long thread_base[MAXTHREADS];
+#endif
+
+static void energy_switch(energy_part_t *part, uint8_t state)
+{
+    unsigned int irq = disableIRQ();
+
+    if (part->state != state) {
+        uint64_t now = vtimer_now64();
+
+        times[part->state] += now - part->since;
+        part->state = state;
+        part->since = now;
+    }
+
+    restoreIRQ(irq);
+}
+
+void energy_mcu(enum lpm_mode mode)
+{
+    if ((mode >= LPM_ON) && (mode <= LPM_POWERDOWN)) {
+        energy_switch(&mcu, ENERGY_CPU + mode);
+    }
+}
+
+void energy_radio(energy_state_t state)
+{
+    if ((state >= ENERGY_RADIO_OFF) && (state < ENERGY_STATES)) {
+        energy_switch(&radio, state);
+    }
+}
+
+void energy_set_current(energy_state_t state, uint32_t current)
+{
+    if (state < ENERGY_STATES) {
+        currents[state] = current;
+    }
+}
+
+uint64_t energy_time(energy_state_t state)
+{
+    unsigned int irq = disableIRQ();
+    uint64_t t = times[state];
+    uint64_t now = vtimer_now64();
+
+    if (mcu.state == state) {
+        t += now - mcu.since;
+    }
+    else if (radio.state == state) {
+        t += now - radio.since;
+    }
+
+    restoreIRQ(irq);
+    return t;
+}
+
+/* the charge in uC of *us* in a state, without the calibration */
+static uint64_t raw_charge(energy_state_t state, uint64_t us)
+{
+    return us * currents[state] / 1000000;
+}
+
+uint64_t energy_charge(energy_state_t state)
+{
+    return raw_charge(state, energy_time(state)) * scale / 1000;
+}
+
+const char *energy_state_name(energy_state_t state)
+{
+    return (state < ENERGY_STATES) ? state_names[state] : NULL;
+}
+
+void energy_clear(void)
+{
+    unsigned int irq = disableIRQ();
+    uint64_t now = vtimer_now64();
+
+    for (int i = 0; i < ENERGY_STATES; i++) {
+        times[i] = 0;
+    }
+
+    mcu.since = now;
+    radio.since = now;
+
+#if SCHEDSTATISTICS
+    for (int i = 0; i < MAXTHREADS; i++) {
+        thread_base[i] = pidlist[i].runtime_ticks;
+    }
+#endif
+
+#ifdef MODULE_LTC4150
+    /* the estimate starts from 0 again */
+    calib_started = 0;
+#endif
+
+    restoreIRQ(irq);
+}
+
+/* energy in uJ of a charge in uC */
+static unsigned long to_uj(uint64_t charge)
+{
+    return (unsigned long)(charge * ENERGY_SUPPLY_MV / 1000);
+}
+
+void energy_dump(void)
+{
+    uint64_t total = 0;
+
+    printf("ENERGY begin supply_mV=%u scale=%lu\n", (unsigned int) ENERGY_SUPPLY_MV,
+           (unsigned long) scale);
+
+    for (int i = 0; i < ENERGY_STATES; i++) {
+        uint64_t us = energy_time(i);
+        uint64_t charge = raw_charge(i, us) * scale / 1000;
+
+        total += charge;
+        printf("ENERGY state %-10s %8lu.%06lu s %8lu uA %10lu uC %10lu uJ\n",
+               state_names[i], (unsigned long)(us / 1000000),
+               (unsigned long)(us % 1000000), (unsigned long) currents[i],
+               (unsigned long) charge, to_uj(charge));
+    }
+
+#if SCHEDSTATISTICS
+    /* the active time of the MCU per thread */
+    for (int i = 0; i < MAXTHREADS; i++) {
+        if (sched_threads[i] == NULL) {
+            continue;
+        }
+
+        uint64_t us = HWTIMER_TICKS_TO_US((uint64_t)
+                      (pidlist[i].runtime_ticks - thread_base[i]));
+        uint64_t charge = raw_charge(ENERGY_CPU, us) * scale / 1000;
+
+        printf("ENERGY thread %2d %-16s %8lu.%06lu s %10lu uC %10lu uJ\n", i,
+               sched_threads[i]->name, (unsigned long)(us / 1000000),
+               (unsigned long)(us % 1000000), (unsigned long) charge,
+               to_uj(charge));
+    }
+#endif
+
+    printf("ENERGY end %lu uC %lu uJ\n", (unsigned long) total, to_uj(total));
+}
+
+int energy_calibrate(void)
+{
+#ifdef MODULE_LTC4150
+    long ints = ltc4150_get_intcount();
+    uint64_t charge = 0;
+    int res = -1;
+
+    for (int i = 0; i < ENERGY_STATES; i++) {
+        charge += raw_charge(i, energy_time(i));
+    }
+
+    if (calib_started && (charge > calib_charge)) {
+        /* every interrupt of the ltc4150 is 1 / (_GFH * _R_SENSE) C */
+        double measured = (ints - calib_ints) * 1000000.0 / (_GFH * _R_SENSE);
+
+        scale = (uint32_t)(measured * 1000 / (charge - calib_charge) + 0.5);
+        res = scale;
+    }
+
+    calib_ints = ints;
+    calib_charge = charge;
+    calib_started = 1;
+
+    return res;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,418 @@
+/**
+ * Append-only record log in internal flash
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_flashlog
+ * @{
+ * @file    flashlog.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "flashrom.h"
+#include "flashlog.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define MAGIC           (0x474f4c46)    /* "FLOG" */
+#define END_OF_PAGE     (0xffff)
+
+#define PAGES(log)      ((log)->sector_size / FLASHLOG_PAGE_SIZE)
+#define SECTOR(log, s)  ((log)->start + (uint32_t)(s) * (log)->sector_size)
+#define PAGE(log, s, p) (SECTOR(log, s) + (uint32_t)(p) * FLASHLOG_PAGE_SIZE)
+#define OLDEST(log)     ((log)->seq - (log)->used + 1)
+
+/* header of the record at *off*, 0 if there is none */
+static int record(const uint8_t *page, uint16_t limit, uint16_t off,
+                  uint32_t *time, uint16_t *len)
+{
+    if (off + FLASHLOG_RECORD_HEADER > limit) {
+        return 0;
+    }
+
+    memcpy(time, page + off, sizeof(uint32_t));
+    memcpy(len, page + off + sizeof(uint32_t), sizeof(uint16_t));
+
+    return (*len != END_OF_PAGE) &&
+           (off + FLASHLOG_RECORD_HEADER + *len <= limit);
+}
+
+static uint32_t first_time(const uint8_t *page, uint16_t p)
+{
+    uint32_t time;
+
+    memcpy(&time, page + (p ? 0 : FLASHLOG_SECTOR_HEADER), sizeof(time));
+    return time;
+}
+
+/* physical sector of *seq*, -1 if it is not in the log */
+static int sector_of(const flashlog_t *log, uint32_t seq)
+{
+    uint32_t age = log->seq - seq;
+
+    if (age >= log->used) {
+        return -1;
+    }
+
+    return (log->head + log->sectors - age) % log->sectors;
+}
+
+/* page *p* of sector *s*, in flash or in the buffer */
+static const uint8_t *page_data(const flashlog_t *log, uint8_t s, uint16_t p,
+                                uint16_t *limit)
+{
+    if (s == log->head) {
+        if (p == log->page) {
+            *limit = log->fill;
+            return (const uint8_t *) log->buf;
+        }
+
+        if (p > log->page) {
+            return NULL;
+        }
+    }
+
+    *limit = FLASHLOG_PAGE_SIZE;
+    return PAGE(log, s, p);
+}
+
+static void reset(flashlog_t *log)
+{
+    log->used = 0;
+    log->head = log->sectors - 1;
+    log->page = PAGES(log);
+    log->fill = 0;
+    log->last = 0;
+}
+
+static int program(flashlog_t *log)
+{
+    uint8_t *dst = PAGE(log, log->head, log->page);
+    int ok;
+
+    memset((uint8_t *) log->buf + log->fill, 0xff,
+           FLASHLOG_PAGE_SIZE - log->fill);
+
+    DEBUG("flashlog: programming %u/%u\n", log->head, log->page);
+    ok = flashrom_write(dst, (char *) log->buf, FLASHLOG_PAGE_SIZE);
+
+    /* a page is programmed once, even if that failed */
+    log->page++;
+    log->fill = 0;
+
+    return ok ? 0 : -2;
+}
+
+static int open_sector(flashlog_t *log, uint32_t time)
+{
+    uint8_t next = (log->head + 1) % log->sectors;
+    uint32_t header[2];
+
+    if (log->used == log->sectors) {
+        /* next is the oldest sector */
+        log->used--;
+    }
+
+    DEBUG("flashlog: erasing %u\n", next);
+
+    if (!flashrom_erase(SECTOR(log, next))) {
+        return -2;
+    }
+
+    log->head = next;
+    log->seq++;
+    log->used++;
+    log->page = 0;
+    log->first[next] = time;
+
+    header[0] = MAGIC;
+    header[1] = log->seq;
+    memcpy(log->buf, header, sizeof(header));
+    log->fill = FLASHLOG_SECTOR_HEADER;
+
+    return 0;
+}
+
+int flashlog_init(flashlog_t *log, uint8_t *start, uint8_t sectors,
+                  uint32_t sector_size)
+{
+    uint32_t header[2];
+    uint32_t time;
+    uint16_t len, off, p;
+    int head = -1;
+
+    if ((sectors < 2) || (sectors > FLASHLOG_MAX_SECTORS) ||
+        (sector_size < FLASHLOG_PAGE_SIZE) ||
+        (sector_size % FLASHLOG_PAGE_SIZE)) {
+        return -1;
+    }
+
+    mutex_init(&log->lock);
+    log->start = start;
+    log->sectors = sectors;
+    log->sector_size = sector_size;
+    log->seq = 0;
+    reset(log);
+
+    /* the head has the highest sequence number */
+    for (uint8_t s = 0; s < sectors; s++) {
+        memcpy(header, SECTOR(log, s), sizeof(header));
+
+        if ((header[0] == MAGIC) &&
+            ((head < 0) || ((int32_t)(header[1] - log->seq) > 0))) {
+            head = s;
+            log->seq = header[1];
+        }
+    }
+
+    if (head < 0) {
+        return 0;
+    }
+
+    /* followed backwards by its predecessors */
+    log->head = head;
+
+    for (log->used = 1; log->used < sectors; log->used++) {
+        uint8_t s = (head + sectors - log->used) % sectors;
+
+        memcpy(header, SECTOR(log, s), sizeof(header));
+
+        if ((header[0] != MAGIC) || (header[1] != log->seq - log->used)) {
+            break;
+        }
+    }
+
+    for (uint8_t i = 0; i < log->used; i++) {
+        uint8_t s = (head + sectors - i) % sectors;
+
+        log->first[s] = first_time(SECTOR(log, s), 0);
+    }
+
+    /* the first erased page of the head, the latest time stamp before */
+    for (p = 1; p < PAGES(log); p++) {
+        if (record(PAGE(log, head, p), FLASHLOG_PAGE_SIZE, 0, &time, &len)) {
+            continue;
+        }
+
+        break;
+    }
+
+    log->page = p;
+    off = (p == 1) ? FLASHLOG_SECTOR_HEADER : 0;
+
+    while (record(PAGE(log, head, p - 1), FLASHLOG_PAGE_SIZE, off,
+                  &time, &len)) {
+        log->last = time;
+        off += FLASHLOG_RECORD_HEADER + len;
+    }
+
+    DEBUG("flashlog: %u sectors, head %u/%u\n", log->used, head, p);
+    return 0;
+}
+
+int flashlog_append(flashlog_t *log, uint32_t time, const void *data,
+                    uint16_t len)
+{
+    uint8_t *b = (uint8_t *) log->buf;
+    int res = 0;
+
+    if (len > FLASHLOG_RECORD_MAX) {
+        return -1;
+    }
+
+    mutex_lock(&log->lock);
+
+    if (log->used && (time < log->last)) {
+        mutex_unlock(&log->lock);
+        return -1;
+    }
+
+    if ((log->page < PAGES(log)) &&
+        (log->fill + FLASHLOG_RECORD_HEADER + len > FLASHLOG_PAGE_SIZE)) {
+        res = program(log);
+    }
+
+    if (log->page == PAGES(log)) {
+        int err = open_sector(log, time);
+
+        if (err < 0) {
+            mutex_unlock(&log->lock);
+            return err;
+        }
+    }
+
+    memcpy(b + log->fill, &time, sizeof(time));
+    memcpy(b + log->fill + sizeof(time), &len, sizeof(len));
+    memcpy(b + log->fill + FLASHLOG_RECORD_HEADER, data, len);
+    log->fill += FLASHLOG_RECORD_HEADER + len;
+    log->last = time;
+
+    mutex_unlock(&log->lock);
+    return res;
+}
+
+int flashlog_sync(flashlog_t *log)
+{
+    int res = 0;
+
+    mutex_lock(&log->lock);
+
+    if ((log->page < PAGES(log)) && log->fill) {
+        res = program(log);
+    }
+
+    mutex_unlock(&log->lock);
+    return res;
+}
+
+int flashlog_erase(flashlog_t *log)
+{
+    int res = 0;
+
+    mutex_lock(&log->lock);
+
+    for (uint8_t s = 0; s < log->sectors; s++) {
+        if (!flashrom_erase(SECTOR(log, s))) {
+            res = -2;
+        }
+    }
+
+    reset(log);
+    mutex_unlock(&log->lock);
+    return res;
+}
+
+void flashlog_seek(flashlog_t *log, flashlog_cursor_t *cursor, uint32_t time)
+{
+    flashlog_cursor_t prev;
+    uint8_t lo = 0, hi, s;
+    uint16_t pages, plo = 0, phi;
+    uint32_t t;
+
+    mutex_lock(&log->lock);
+
+    /*
+     * Records before the last sector starting earlier than *time* are
+     * older, the same holds for the pages of that sector.
+     */
+    hi = log->used;
+
+    while (hi - lo > 1) {
+        uint8_t mid = (lo + hi) / 2;
+
+        if (log->first[sector_of(log, OLDEST(log) + mid)] < time) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    cursor->seq = OLDEST(log) + lo;
+    cursor->page = 0;
+    cursor->offset = FLASHLOG_SECTOR_HEADER;
+
+    if (log->used) {
+        s = sector_of(log, cursor->seq);
+        pages = (s == log->head) ? log->page : PAGES(log);
+        phi = pages;
+
+        while (phi - plo > 1) {
+            uint16_t mid = (plo + phi) / 2;
+
+            if (first_time(PAGE(log, s, mid), mid) < time) {
+                plo = mid;
+            }
+            else {
+                phi = mid;
+            }
+        }
+
+        if (plo) {
+            cursor->page = plo;
+            cursor->offset = 0;
+        }
+    }
+
+    mutex_unlock(&log->lock);
+
+    do {
+        prev = *cursor;
+    }
+    while ((flashlog_read(log, cursor, &t, NULL, 0) >= 0) && (t < time));
+
+    *cursor = prev;
+}
+
+int flashlog_read(flashlog_t *log, flashlog_cursor_t *cursor, uint32_t *time,
+                  void *buf, uint16_t size)
+{
+    const uint8_t *page;
+    uint16_t limit, len;
+    uint32_t t;
+    int s;
+
+    mutex_lock(&log->lock);
+
+    while (log->used && ((int32_t)(cursor->seq - log->seq) <= 0)) {
+        if ((int32_t)(cursor->seq - OLDEST(log)) < 0) {
+            DEBUG("flashlog: cursor behind the oldest sector\n");
+            cursor->seq = OLDEST(log);
+            cursor->page = 0;
+        }
+
+        if ((cursor->page == 0) &&
+            (cursor->offset < FLASHLOG_SECTOR_HEADER)) {
+            cursor->offset = FLASHLOG_SECTOR_HEADER;
+        }
+
+        if (cursor->page >= PAGES(log)) {
+            cursor->seq++;
+            cursor->page = 0;
+            cursor->offset = FLASHLOG_SECTOR_HEADER;
+            continue;
+        }
+
+        s = sector_of(log, cursor->seq);
+
+        if ((page = page_data(log, s, cursor->page, &limit)) == NULL) {
+            break;
+        }
+
+        if (record(page, limit, cursor->offset, &t, &len)) {
+            if (buf) {
+                memcpy(buf, page + cursor->offset + FLASHLOG_RECORD_HEADER,
+                       (len < size) ? len : size);
+            }
+
+            cursor->offset += FLASHLOG_RECORD_HEADER + len;
+
+            if (time) {
+                *time = t;
+            }
+
+            mutex_unlock(&log->lock);
+            return len;
+        }
+
+        if ((s == log->head) && (cursor->page == log->page)) {
+            /* end of the buffer, more may be appended */
+            break;
+        }
+
+        cursor->page++;
+        cursor->offset = 0;
+    }
+
+    mutex_unlock(&log->lock);
+    return -1;
+}
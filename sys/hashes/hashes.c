@@ -110,3 +110,173 @@ uint32_t one_at_a_time_hash(const uint8_t *buf, size_t len)
     hash += hash << 15;
     return hash;
 }
+
+uint64_t double_hash64(const uint8_t *buf, size_t len, uint32_t seed)
+{
+    uint32_t h1 = 2166136261u ^ seed; /* FNV-1a offset basis */
+    uint32_t h2 = 786431 + seed;
+
+    for (size_t i = 0; i < len; i++) {
+        h1 ^= buf[i];
+        h1 *= 16777619u;
+
+        h2 += buf[i];
+        h2 += h2 << 10;
+        h2 ^= h2 >> 6;
+    }
+    h2 += h2 << 3;
+    h2 ^= h2 >> 11;
+    h2 += h2 << 15;
+    return ((uint64_t) h2 << 32) | h1;
+}
+
+#define XXH32_P1 (2654435761u)
+#define XXH32_P2 (2246822519u)
+#define XXH32_P3 (3266489917u)
+#define XXH32_P4 (668265263u)
+#define XXH32_P5 (374761393u)
+
+#define XXH64_P1 (11400714785074694791ull)
+#define XXH64_P2 (14029467366897019727ull)
+#define XXH64_P3 (1609587929392839161ull)
+#define XXH64_P4 (9650029242287828579ull)
+#define XXH64_P5 (2870177450012600261ull)
+
+#define ROTL32(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/* little endian loads, independent of alignment and host byte order */
+static inline uint32_t read32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+           ((uint32_t) p[3] << 24);
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+    return read32(p) | ((uint64_t) read32(p + 4) << 32);
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t input)
+{
+    acc += input * XXH32_P2;
+    acc = ROTL32(acc, 13);
+    return acc * XXH32_P1;
+}
+
+uint32_t xxh32_hash(const uint8_t *buf, size_t len, uint32_t seed)
+{
+    const uint8_t *end = buf + len;
+    uint32_t hash;
+
+    if (len >= 16) {
+        const uint8_t *limit = end - 16;
+        uint32_t v1 = seed + XXH32_P1 + XXH32_P2;
+        uint32_t v2 = seed + XXH32_P2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - XXH32_P1;
+
+        do {
+            v1 = xxh32_round(v1, read32(buf));
+            v2 = xxh32_round(v2, read32(buf + 4));
+            v3 = xxh32_round(v3, read32(buf + 8));
+            v4 = xxh32_round(v4, read32(buf + 12));
+            buf += 16;
+        } while (buf <= limit);
+
+        hash = ROTL32(v1, 1) + ROTL32(v2, 7) + ROTL32(v3, 12) + ROTL32(v4, 18);
+    }
+    else {
+        hash = seed + XXH32_P5;
+    }
+
+    hash += (uint32_t) len;
+
+    while (buf + 4 <= end) {
+        hash += read32(buf) * XXH32_P3;
+        hash = ROTL32(hash, 17) * XXH32_P4;
+        buf += 4;
+    }
+
+    while (buf < end) {
+        hash += (*buf++) * XXH32_P5;
+        hash = ROTL32(hash, 11) * XXH32_P1;
+    }
+
+    hash ^= hash >> 15;
+    hash *= XXH32_P2;
+    hash ^= hash >> 13;
+    hash *= XXH32_P3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH64_P2;
+    acc = ROTL64(acc, 31);
+    return acc * XXH64_P1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH64_P1 + XXH64_P4;
+}
+
+uint64_t xxh64_hash(const uint8_t *buf, size_t len, uint64_t seed)
+{
+    const uint8_t *end = buf + len;
+    uint64_t hash;
+
+    if (len >= 32) {
+        const uint8_t *limit = end - 32;
+        uint64_t v1 = seed + XXH64_P1 + XXH64_P2;
+        uint64_t v2 = seed + XXH64_P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH64_P1;
+
+        do {
+            v1 = xxh64_round(v1, read64(buf));
+            v2 = xxh64_round(v2, read64(buf + 8));
+            v3 = xxh64_round(v3, read64(buf + 16));
+            v4 = xxh64_round(v4, read64(buf + 24));
+            buf += 32;
+        } while (buf <= limit);
+
+        hash = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+        hash = xxh64_merge(hash, v1);
+        hash = xxh64_merge(hash, v2);
+        hash = xxh64_merge(hash, v3);
+        hash = xxh64_merge(hash, v4);
+    }
+    else {
+        hash = seed + XXH64_P5;
+    }
+
+    hash += (uint64_t) len;
+
+    while (buf + 8 <= end) {
+        hash ^= xxh64_round(0, read64(buf));
+        hash = ROTL64(hash, 27) * XXH64_P1 + XXH64_P4;
+        buf += 8;
+    }
+
+    if (buf + 4 <= end) {
+        hash ^= (uint64_t) read32(buf) * XXH64_P1;
+        hash = ROTL64(hash, 23) * XXH64_P2 + XXH64_P3;
+        buf += 4;
+    }
+
+    while (buf < end) {
+        hash ^= (*buf++) * XXH64_P5;
+        hash = ROTL64(hash, 11) * XXH64_P1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH64_P2;
+    hash ^= hash >> 29;
+    hash *= XXH64_P3;
+    hash ^= hash >> 32;
+    return hash;
+}
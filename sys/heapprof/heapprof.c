@@ -0,0 +1,396 @@
+/**
+ * Allocation profiler
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_heapprof
+ * @{
+ * @file    heapprof.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef CPU_NATIVE
+#include <fcntl.h>
+#include <unistd.h>
+#include "native_internal.h"
+#endif
+
+#include "irq.h"
+#include "heapprof.h"
+
+/* tells the blocks with a header from those newlib allocated itself */
+#define HEAPPROF_MAGIC      (0xa110)
+
+/* index of the sites not fitting into the table */
+#define HEAPPROF_OTHER      (HEAPPROF_SITES)
+
+typedef union {
+    struct {
+        uint32_t size;
+        uint16_t site;
+        uint16_t magic;
+    } h;
+    uint8_t pad[HEAPPROF_HDR_SIZE];
+} heapprof_hdr_t;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static heapprof_site_t sites[HEAPPROF_SITES + 1];
+static uint32_t heap_bytes;
+static uint32_t heap_peak;
+static uint32_t heap_allocs;
+static uint32_t heap_fails;
+
+#ifdef CPU_NATIVE
+static int trace_fd = -1;
+
+/* appends *value* in hex to *buf* */
+static size_t trace_hex(char *buf, unsigned long value)
+{
+    char tmp[2 * sizeof(value)];
+    size_t n = 0, len = 0;
+
+    do {
+        tmp[n++] = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value);
+
+    while (n) {
+        buf[len++] = tmp[--n];
+    }
+
+    return len;
+}
+
+/* logs an event: '+' with site, block and size, '-' with the block or
+ * '!' with site and size of a failed allocation */
+static void trace(char event, uintptr_t site, void *ptr, size_t size)
+{
+    char line[4 + 6 * sizeof(unsigned long)];
+    size_t len = 0;
+
+    if (trace_fd < 0) {
+        return;
+    }
+
+    line[len++] = event;
+
+    if (event != '-') {
+        line[len++] = ' ';
+        len += trace_hex(&line[len], site);
+    }
+
+    if (event != '!') {
+        line[len++] = ' ';
+        len += trace_hex(&line[len], (uintptr_t) ptr);
+    }
+
+    if (event != '-') {
+        line[len++] = ' ';
+        len += trace_hex(&line[len], size);
+    }
+
+    line[len++] = '\n';
+    _native_write(trace_fd, line, len);
+}
+#else
+static inline void trace(char event, uintptr_t site, void *ptr, size_t size)
+{
+    (void) event;
+    (void) site;
+    (void) ptr;
+    (void) size;
+}
+#endif
+
+static uint16_t site_index(uintptr_t site)
+{
+    unsigned int i = (site >> 1) % HEAPPROF_SITES;
+
+    for (unsigned int n = 0; n < HEAPPROF_SITES; n++) {
+        if (sites[i].site == site) {
+            return i;
+        }
+
+        if (sites[i].site == 0) {
+            sites[i].site = site;
+            return i;
+        }
+
+        if (++i == HEAPPROF_SITES) {
+            i = 0;
+        }
+    }
+
+    return HEAPPROF_OTHER;
+}
+
+/* sets up the header of a new block, returns the block for the caller */
+static void *account_alloc(heapprof_hdr_t *hdr, size_t size, uintptr_t site)
+{
+    unsigned int state = disableIRQ();
+    uint16_t i = site_index(site);
+    heapprof_site_t *s = &sites[i];
+
+    if (hdr == NULL) {
+        s->fails++;
+        heap_fails++;
+        restoreIRQ(state);
+        trace('!', site, NULL, size);
+        return NULL;
+    }
+
+    hdr->h.size = size;
+    hdr->h.site = i;
+    hdr->h.magic = HEAPPROF_MAGIC;
+
+    s->allocs++;
+    s->blocks++;
+    s->bytes += size;
+    s->total += size;
+
+    if (s->bytes > s->peak) {
+        s->peak = s->bytes;
+    }
+
+    heap_allocs++;
+    heap_bytes += size;
+
+    if (heap_bytes > heap_peak) {
+        heap_peak = heap_bytes;
+    }
+
+    restoreIRQ(state);
+    trace('+', site, hdr + 1, size);
+
+    return hdr + 1;
+}
+
+/* *hdr* is that of *ptr* or a copy of it */
+static void account_free(const heapprof_hdr_t *hdr, void *ptr)
+{
+    unsigned int state = disableIRQ();
+    heapprof_site_t *s = &sites[hdr->h.site];
+
+    s->blocks--;
+    s->bytes -= hdr->h.size;
+    heap_bytes -= hdr->h.size;
+
+    restoreIRQ(state);
+    trace('-', 0, ptr, 0);
+}
+
+/* the header of a block of the wrappers, NULL for others */
+static heapprof_hdr_t *block_hdr(void *ptr)
+{
+    heapprof_hdr_t *hdr = (heapprof_hdr_t *) ptr - 1;
+
+    return (hdr->h.magic == HEAPPROF_MAGIC) ? hdr : NULL;
+}
+
+static void *heapprof_malloc(size_t size, uintptr_t site)
+{
+    if (size > SIZE_MAX - sizeof(heapprof_hdr_t)) {
+        return account_alloc(NULL, size, site);
+    }
+
+    return account_alloc(__real_malloc(size + sizeof(heapprof_hdr_t)), size,
+                         site);
+}
+
+static void heapprof_free(void *ptr)
+{
+    heapprof_hdr_t *hdr;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    hdr = block_hdr(ptr);
+
+    if (hdr == NULL) {
+        __real_free(ptr);
+        return;
+    }
+
+    account_free(hdr, ptr);
+    hdr->h.magic = 0;
+    __real_free(hdr);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    return heapprof_malloc(size, (uintptr_t) __builtin_return_address(0));
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+    uintptr_t site = (uintptr_t) __builtin_return_address(0);
+    size_t bytes = num * size;
+
+    if ((size && (bytes / size != num)) ||
+        (bytes > SIZE_MAX - sizeof(heapprof_hdr_t))) {
+        return account_alloc(NULL, SIZE_MAX, site);
+    }
+
+    return account_alloc(__real_calloc(1, bytes + sizeof(heapprof_hdr_t)),
+                         bytes, site);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    uintptr_t site = (uintptr_t) __builtin_return_address(0);
+    heapprof_hdr_t *hdr, *moved, old;
+
+    if (ptr == NULL) {
+        return heapprof_malloc(size, site);
+    }
+
+    hdr = block_hdr(ptr);
+
+    if (hdr == NULL) {
+        return __real_realloc(ptr, size);
+    }
+
+    if (size == 0) {
+        heapprof_free(ptr);
+        return NULL;
+    }
+
+    if (size > SIZE_MAX - sizeof(heapprof_hdr_t)) {
+        return account_alloc(NULL, size, site);
+    }
+
+    old = *hdr;
+    moved = __real_realloc(hdr, size + sizeof(heapprof_hdr_t));
+
+    if (moved == NULL) {
+        /* the old block stays as it is */
+        return account_alloc(NULL, size, site);
+    }
+
+    /* the block is counted for the caller of realloc() from now on */
+    account_free(&old, ptr);
+    return account_alloc(moved, size, site);
+}
+
+void __wrap_free(void *ptr)
+{
+    heapprof_free(ptr);
+}
+
+const heapprof_site_t *heapprof_get_site(unsigned int i)
+{
+    if ((i > HEAPPROF_OTHER) ||
+        ((i < HEAPPROF_OTHER) && (sites[i].site == 0))) {
+        return NULL;
+    }
+
+    return &sites[i];
+}
+
+void heapprof_clear(void)
+{
+    unsigned int state = disableIRQ();
+
+    for (int i = 0; i <= HEAPPROF_OTHER; i++) {
+        sites[i].allocs = 0;
+        sites[i].fails = 0;
+        sites[i].total = 0;
+        sites[i].peak = sites[i].bytes;
+    }
+
+    heap_allocs = 0;
+    heap_fails = 0;
+    heap_peak = heap_bytes;
+
+    restoreIRQ(state);
+}
+
+void heapprof_dump(unsigned int top)
+{
+    uint8_t order[HEAPPROF_SITES + 1];
+    unsigned int n = 0;
+
+    /* the sites seen, by their peak */
+    for (int i = 0; i <= HEAPPROF_OTHER; i++) {
+        if ((sites[i].allocs == 0) && (sites[i].fails == 0) &&
+            (sites[i].peak == 0)) {
+            continue;
+        }
+
+        unsigned int k = n++;
+
+        while ((k > 0) && (sites[order[k - 1]].peak < sites[i].peak)) {
+            order[k] = order[k - 1];
+            k--;
+        }
+
+        order[k] = i;
+    }
+
+    if ((top == 0) || (top > n)) {
+        top = n;
+    }
+
+    printf("HEAP begin bytes=%lu peak=%lu allocs=%lu fails=%lu overhead=%u\n",
+           (unsigned long) heap_bytes, (unsigned long) heap_peak,
+           (unsigned long) heap_allocs, (unsigned long) heap_fails,
+           (unsigned int) sizeof(heapprof_hdr_t));
+
+    for (unsigned int k = 0; k < top; k++) {
+        const heapprof_site_t *s = &sites[order[k]];
+
+        printf("HEAP site %08lx %lu %lu %lu %lu %lu %lu\n",
+               (unsigned long) s->site, (unsigned long) s->allocs,
+               (unsigned long) s->fails, (unsigned long) s->blocks,
+               (unsigned long) s->bytes, (unsigned long) s->peak,
+               (unsigned long) s->total);
+    }
+
+    puts("HEAP end");
+}
+
+int heapprof_trace(int on)
+{
+#ifdef CPU_NATIVE
+
+    if (on && (trace_fd < 0)) {
+        char name[64];
+
+        snprintf(name, sizeof(name), HEAPPROF_NATIVE_FILE, (int) getpid());
+        _native_syscall_enter();
+        trace_fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        _native_syscall_leave();
+
+        return (trace_fd < 0) ? -1 : 0;
+    }
+
+    if (!on && (trace_fd >= 0)) {
+        int fd = trace_fd;
+
+        trace_fd = -1;
+        _native_syscall_enter();
+        close(fd);
+        _native_syscall_leave();
+    }
+
+    return 0;
+#else
+    (void) on;
+    return -1;
+#endif
+}
@@ -14,6 +14,15 @@
  *              initialized only once, so do not call a module's init function
  *              when using auto_init unless you know what you're doing.
  *
+ *              Every module is a stage with the stages it depends on.  Slow
+ *              stages that nothing else needs (sensors, the disk) run in a
+ *              helper thread of lower priority, which only gets the CPU while
+ *              the main thread waits.  main() is called once all stages are
+ *              done, except for those in the AUTO_INIT_DEFERRED mask, which
+ *              finish in the background; use auto_init_wait() before using
+ *              one of them.  With AUTO_INIT_PROFILE set to 1 the duration of
+ *              every stage is printed.
+ *
  * @{
  *
  * @file        auto_init.h
@@ -22,7 +31,63 @@
 #ifndef AUTO_INIT_H
 #define AUTO_INIT_H
 
+#include <stdint.h>
+
+/**
+ * @brief Stages of the initialization
+ */
+enum {
+    AUTO_INIT_VTIMER,
+    AUTO_INIT_UART0,
+    AUTO_INIT_RTC,
+    AUTO_INIT_SHT11,
+    AUTO_INIT_GPIOINT,
+    AUTO_INIT_CC110X,
+    AUTO_INIT_LTC4150,
+    AUTO_INIT_DISK,
+    AUTO_INIT_CRYPTO,
+    AUTO_INIT_NET_IF,
+    AUTO_INIT_SIXLOWPAN,
+    AUTO_INIT_PROFILING,
+    AUTO_INIT_DESTINY,
+    AUTO_INIT_STACKMON,
+    AUTO_INIT_DLOG,
+    AUTO_INIT_STAGES
+};
+
+/**
+ * @brief Bit of a stage in a mask
+ */
+#define AUTO_INIT_STAGE(x)      (1 << (x))
+
+/**
+ * @brief Stages main() does not wait for, e.g.
+ *        AUTO_INIT_STAGE(AUTO_INIT_DISK)
+ */
+#ifndef AUTO_INIT_DEFERRED
+#define AUTO_INIT_DEFERRED      (0)
+#endif
+
+/**
+ * @brief Set to 1 to print the boot time of every stage
+ */
+#ifndef AUTO_INIT_PROFILE
+#define AUTO_INIT_PROFILE       (0)
+#endif
+
+/**
+ * @brief Initializes all used modules and calls main()
+ */
 void auto_init(void);
 
+/**
+ * @brief Blocks until all *stages* are initialized
+ *
+ * Stages of modules that are not used count as initialized.
+ *
+ * @param[in] stages    mask of AUTO_INIT_STAGE() bits
+ */
+void auto_init_wait(uint16_t stages);
+
 /** @} */
 #endif /* AUTO_INIT_H */
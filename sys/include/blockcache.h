@@ -0,0 +1,107 @@
+/**
+ * Write-back sector cache for block devices
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_blockcache Block cache
+ * @ingroup     sys
+ * @brief       LRU sector cache between diskio.h users and the MCI driver
+ *
+ * The module implements the generic disk_*() functions of diskio.h for
+ * DN_MCI.  Writes only go to the cache, a flush thread writes dirty
+ * sectors back when BLOCKCACHE_FLUSH_THRESHOLD of them are dirty or every
+ * BLOCKCACHE_FLUSH_INTERVAL, consecutive sectors with one multi block
+ * command.  disk_ioctl(DN_MCI, CTRL_SYNC, NULL) or blockcache_flush()
+ * write everything back before they return.
+ *
+ * @{
+ * @file        blockcache.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __BLOCKCACHE_H
+#define __BLOCKCACHE_H
+
+#include "diskio.h"
+
+/**
+ * @brief Number of cached sectors
+ */
+#ifndef BLOCKCACHE_SECTORS
+#define BLOCKCACHE_SECTORS          (8)
+#endif
+
+/**
+ * @brief Sector size of the device
+ */
+#define BLOCKCACHE_SECTOR_SIZE      (512)
+
+/**
+ * @brief Most sectors written back with one command
+ */
+#ifndef BLOCKCACHE_COALESCE
+#define BLOCKCACHE_COALESCE         (4)
+#endif
+
+/**
+ * @brief Dirty sectors that wake up the flush thread
+ */
+#ifndef BLOCKCACHE_FLUSH_THRESHOLD
+#define BLOCKCACHE_FLUSH_THRESHOLD  (BLOCKCACHE_SECTORS / 2)
+#endif
+
+/**
+ * @brief Longest time in seconds a sector stays dirty
+ */
+#ifndef BLOCKCACHE_FLUSH_INTERVAL
+#define BLOCKCACHE_FLUSH_INTERVAL   (1)
+#endif
+
+/**
+ * @brief Priority of the flush thread
+ */
+#ifndef BLOCKCACHE_FLUSH_PRIORITY
+#define BLOCKCACHE_FLUSH_PRIORITY   (PRIORITY_MAIN - 1)
+#endif
+
+/**
+ * @brief Statistics of the cache
+ */
+typedef struct {
+    unsigned long hits;         /**< sectors read or written in the cache */
+    unsigned long misses;       /**< sectors read from the device */
+    unsigned long writebacks;   /**< write commands sent to the device */
+    unsigned long written;      /**< sectors written to the device */
+} blockcache_stats_t;
+
+/**
+ * @brief Initializes the cache and the device, starts the flush thread
+ *
+ * @return the status of the device, see MCI_initialize()
+ */
+DSTATUS blockcache_init(void);
+
+/**
+ * @brief Writes all dirty sectors back to the device
+ *
+ * @return RES_OK on success
+ */
+DRESULT blockcache_flush(void);
+
+/**
+ * @brief Drops all sectors without writing them back, e.g. after the card
+ *        was changed
+ */
+void blockcache_invalidate(void);
+
+/**
+ * @brief Returns the statistics of the cache
+ */
+const blockcache_stats_t *blockcache_stats(void);
+
+/** @} */
+#endif /* __BLOCKCACHE_H */
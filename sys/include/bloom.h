@@ -125,6 +125,29 @@
  */
 typedef uint32_t (*hashfp_t)(const uint8_t *, int len);
 
+/**
+ * Derive all k indices from one double_hash64() pass instead of calling
+ * k hash functions.
+ */
+#define BLOOM_DOUBLE_HASH   (0x01)
+
+/**
+ * Set all k bits of an element inside one block of BLOOM_BLOCK_BITS bits,
+ * so a check touches one cache line (or flash page) only. Implies
+ * BLOOM_DOUBLE_HASH.
+ */
+#define BLOOM_BLOCKED       (0x02)
+
+/**
+ * Bits per block of a BLOOM_BLOCKED filter
+ */
+#define BLOOM_BLOCK_BITS    (512)
+
+/**
+ * Bytes needed by the bit array of a filter of 'size' bits
+ */
+#define BLOOM_BITFIELD_SIZE(size)   (((size) + 7) / 8)
+
 /**
  * struct bloom_t bloom filter object
  */
@@ -133,6 +156,8 @@ struct bloom_t {
     size_t k;
     uint8_t *a;
     hashfp_t *hash;
+    uint32_t seed;
+    uint8_t flags;
 };
 
 /**
@@ -149,6 +174,29 @@ struct bloom_t {
  */
 struct bloom_t *bloom_new(size_t size, size_t num_hashes, ...);
 
+/**
+ * bloom_init  Initialize a Bloom filter in static storage.
+ *
+ * The filter hashes every element once with double_hash64(), k only
+ * decides how many bits are derived from that hash.  For BLOOM_BLOCKED
+ * make 'size' a multiple of BLOOM_BLOCK_BITS.
+ *
+ * @param bloom       the filter to initialize
+ * @param size        size of the bit array in the filter
+ * @param bitfield    the bit array, BLOOM_BITFIELD_SIZE(size) bytes
+ * @param num_hashes  the number of bits set per element (k)
+ * @param seed        seed of the hash, filters with other seeds fail
+ *                    independently
+ * @param flags       BLOOM_DOUBLE_HASH or BLOOM_BLOCKED
+ *
+ * Do not pass such a filter to bloom_del().
+ *
+ * @return nothing
+ *
+ */
+void bloom_init(struct bloom_t *bloom, size_t size, uint8_t *bitfield,
+                size_t num_hashes, uint32_t seed, uint8_t flags);
+
 /**
  * bloom_del  Delete a Bloom filter.
  *
@@ -18,6 +18,7 @@ extern int uart0_handler_pid;
 
 void board_uart0_init(void);
 void uart0_handle_incoming(int c);
+void uart0_handle_incoming_block(char *buf, int n);
 void uart0_notify_thread(void);
 
 int uart0_readc(void);
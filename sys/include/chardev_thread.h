@@ -8,8 +8,8 @@
 #ifndef __CHARDEV_THREAD_H
 #define __CHARDEV_THREAD_H
 
-#include "ringbuffer.h"
+#include "spsc_ringbuffer.h"
 
-void chardev_loop(ringbuffer_t *rb);
+void chardev_loop(spsc_ringbuffer_t *rb);
 
 #endif /* __CHARDEV_THREAD_H */
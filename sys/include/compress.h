@@ -0,0 +1,239 @@
+/**
+ * Compression of sensor payloads
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_compress Compress
+ * @ingroup     sys
+ * @brief       Delta, varint and LZ coding small enough for the MCUs
+ *
+ * Slowly changing series are sent as the differences of their values,
+ * zig-zag mapped so that small negative differences stay small, and
+ * written as varints of 7 bits per byte: a temperature read every minute
+ * mostly takes one byte instead of four.  Batches with repeating byte
+ * patterns, e.g. several of these or text, are further shrunk by an LZ
+ * coder with a window of COMPRESS_LZ_WINDOW bytes that needs no more than
+ * its hash table of 2^COMPRESS_LZ_HASH_BITS positions on the stack.
+ *
+ * The decoders keep their state between calls, so a payload that arrives
+ * in pieces, e.g. CoAP blocks, is decoded as the pieces come in:
+ *
+ *     compress_delta_decoder_t dec;
+ *     int32_t values[8];
+ *
+ *     compress_delta_decoder_init(&dec, 0);
+ *     while (<a block arrived>) {
+ *         const uint8_t *data = block;
+ *         size_t len = block_len;
+ *         int n;
+ *
+ *         while ((n = compress_delta_decode(&dec, &data, &len, values, 8)) > 0) {
+ *             <use n values>
+ *         }
+ *     }
+ *
+ * Records of the sampler (see sampler.h) are coded as a whole with
+ * compress_record_encode() and compress_record_decode().
+ *
+ * @{
+ * @file        compress.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __COMPRESS_H
+#define __COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef MODULE_SAMPLER
+#include "sampler.h"
+#endif
+
+/**
+ * @brief Bytes of the longest varint, that of a 32 bit value
+ */
+#define COMPRESS_VARINT_MAX     (5)
+
+/**
+ * @brief Bytes an LZ match may reach back
+ */
+#define COMPRESS_LZ_WINDOW      (256)
+
+/**
+ * @brief log2 of the positions in the hash table of the LZ encoder, it
+ *        takes 2^COMPRESS_LZ_HASH_BITS * sizeof(size_t) bytes of stack
+ */
+#ifndef COMPRESS_LZ_HASH_BITS
+#define COMPRESS_LZ_HASH_BITS   (6)
+#endif
+
+/**
+ * @brief Largest LZ encoding of *len* bytes, if nothing repeats
+ */
+#define COMPRESS_LZ_BOUND(len)  ((len) + ((len) + 127) / 128)
+
+/**
+ * @brief Maps signed to unsigned values, small magnitudes to small values:
+ *        0, -1, 1, -2 become 0, 1, 2, 3
+ */
+static inline uint32_t compress_zigzag(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief Reverses compress_zigzag()
+ */
+static inline int32_t compress_unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**
+ * @brief Writes *value* as a varint, 7 bits per byte, the lowest first
+ *
+ * @param[out] buf      at least COMPRESS_VARINT_MAX bytes
+ * @param[in] value     the value
+ *
+ * @return bytes written
+ */
+size_t compress_varint_put(uint8_t *buf, uint32_t value);
+
+/**
+ * @brief Reads a varint
+ *
+ * @return bytes read, 0 if it is cut off, -1 if it is longer than
+ *         COMPRESS_VARINT_MAX bytes
+ */
+int compress_varint_get(const uint8_t *buf, size_t len, uint32_t *value);
+
+/**
+ * @brief Writes *values* as zig-zag varints of their differences
+ *
+ * @param[in,out] prev  the value before the first one, e.g. 0 or the
+ *                      last one of the previous batch, the last one
+ *                      written on return
+ * @param[in] values    the values
+ * @param[in] count     number of *values*
+ * @param[out] buf      the encoding
+ * @param[in] size      size of *buf*
+ *
+ * @return bytes written, -1 if *buf* is too small; *prev* is not changed
+ *         then
+ */
+int compress_delta_encode(int32_t *prev, const int32_t *values, size_t count,
+                          uint8_t *buf, size_t size);
+
+/**
+ * @brief State of a delta decoder
+ */
+typedef struct {
+    int32_t prev;                   /**< the value decoded last */
+    uint32_t acc;                   /**< internal, varint read so far */
+    uint8_t shift;                  /**< internal */
+} compress_delta_decoder_t;
+
+/**
+ * @brief Prepares a delta decoder
+ *
+ * @param[out] dec  the decoder
+ * @param[in] prev  as passed to compress_delta_encode() for the first value
+ */
+void compress_delta_decoder_init(compress_delta_decoder_t *dec, int32_t prev);
+
+/**
+ * @brief Decodes values until *max* are decoded or the data is used up, a
+ *        varint cut off is completed by the next call
+ *
+ * @param[in,out] dec   the decoder
+ * @param[in,out] data  the data, advanced by the bytes used
+ * @param[in,out] len   bytes of *data*, reduced by the bytes used
+ * @param[out] values   the values
+ * @param[in] max       size of *values*
+ *
+ * @return number of values, -1 if the data is corrupt
+ */
+int compress_delta_decode(compress_delta_decoder_t *dec, const uint8_t **data,
+                          size_t *len, int32_t *values, size_t max);
+
+/**
+ * @brief Compresses a block with LZ coding
+ *
+ * A byte below 0x80 is followed by that many plus one literal bytes,
+ * otherwise by an offset byte: the low 7 bits plus 3 bytes are copied
+ * from the offset plus 1 bytes before.
+ *
+ * @param[in] in        the block
+ * @param[in] len       bytes of *in*
+ * @param[out] out      the encoding, COMPRESS_LZ_BOUND(len) bytes always
+ *                      suffice
+ * @param[in] size      size of *out*
+ *
+ * @return bytes written, -1 if *out* is too small
+ */
+int compress_lz_encode(const uint8_t *in, size_t len, uint8_t *out,
+                       size_t size);
+
+/**
+ * @brief State of an LZ decoder
+ */
+typedef struct {
+    uint8_t *out;                   /**< the decoded block */
+    size_t size;                    /**< size of *out* */
+    size_t pos;                     /**< bytes decoded */
+    uint8_t state;                  /**< internal */
+    uint8_t count;                  /**< internal */
+} compress_lz_decoder_t;
+
+/**
+ * @brief Prepares an LZ decoder
+ *
+ * @param[out] dec  the decoder
+ * @param[out] out  the block is decoded into it, matches are copied from
+ *                  it so it has to hold the whole block
+ * @param[in] size  size of *out*
+ */
+void compress_lz_decoder_init(compress_lz_decoder_t *dec, uint8_t *out,
+                              size_t size);
+
+/**
+ * @brief Decodes the next piece of an LZ encoding
+ *
+ * @return 0 on success, -1 if the data is corrupt or does not fit
+ */
+int compress_lz_decode(compress_lz_decoder_t *dec, const uint8_t *data,
+                       size_t len);
+
+/**
+ * @brief Ends an LZ decoding
+ *
+ * @return bytes decoded, -1 if the encoding ended in the middle
+ */
+int compress_lz_finish(const compress_lz_decoder_t *dec);
+
+#ifdef MODULE_SAMPLER
+/**
+ * @brief Writes a record: its id and count, time and period as varints and
+ *        the values with compress_delta_encode() from 0
+ *
+ * @return bytes written, -1 if *buf* is too small
+ */
+int compress_record_encode(const sampler_record_t *record, uint8_t *buf,
+                           size_t size);
+
+/**
+ * @brief Reads a record of compress_record_encode()
+ *
+ * @return bytes read, -1 if the data is corrupt or cut off
+ */
+int compress_record_decode(const uint8_t *buf, size_t len,
+                           sampler_record_t *record);
+#endif
+
+/** @} */
+#endif /* __COMPRESS_H */
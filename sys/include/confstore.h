@@ -0,0 +1,138 @@
+/**
+ * Typed key-value configuration store in internal flash
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_confstore Configuration store
+ * @ingroup     sys
+ * @brief       Extensible configuration parameters on a flashlog.h
+ *
+ * Parameters are named by strings and hold an unsigned or signed integer,
+ * a string or a blob.  Keys are stored as their 32 bit FNV hash, values
+ * as type-length-value entries.  All parameters live in a RAM table with
+ * open addressing, so the getters never touch the flash.
+ *
+ * Changes are collected in a transaction and appended as one flashlog
+ * record: either all of them are found after a reset or none.  Since the
+ * log is a ring of sectors the flash wears evenly.  Whenever the log
+ * moved on to a new sector, all parameters are written again, so erasing
+ * the oldest sector never loses one.
+ *
+ *     confstore_txn_t txn;
+ *
+ *     confstore_begin(&txn);
+ *     confstore_set_u32(&txn, "radio.channel", 5);
+ *     confstore_set_str(&txn, "name", "node-17");
+ *     confstore_commit(&txn);
+ *
+ * @{
+ * @file        confstore.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __CONFSTORE_H
+#define __CONFSTORE_H
+
+#include <stdint.h>
+
+#include "flashlog.h"
+
+/**
+ * @brief Most parameters, a power of two
+ */
+#ifndef CONFSTORE_ENTRIES
+#define CONFSTORE_ENTRIES       (32)
+#endif
+
+/**
+ * @brief Longest value of a parameter, including the 0 of a string
+ */
+#ifndef CONFSTORE_VALUE_MAX
+#define CONFSTORE_VALUE_MAX     (24)
+#endif
+
+/**
+ * @brief Bytes of the key, type and length of an entry
+ */
+#define CONFSTORE_ENTRY_HEADER  (6)
+
+/**
+ * @brief Types of a parameter
+ */
+#define CONFSTORE_NONE          (0)     /**< removed */
+#define CONFSTORE_U32           (1)
+#define CONFSTORE_I32           (2)
+#define CONFSTORE_STR           (3)
+#define CONFSTORE_BLOB          (4)
+
+/**
+ * @brief Changes to be committed at once
+ */
+typedef struct {
+    uint16_t len;                       /**< bytes used in *buf* */
+    uint8_t buf[FLASHLOG_RECORD_MAX];   /**< the entries */
+} confstore_txn_t;
+
+/**
+ * @brief Mounts the store and loads all parameters
+ *
+ * Takes the same parameters as flashlog_init().  The sectors must be large
+ * enough to hold every parameter at once.
+ *
+ * @return 0 on success, -1 on invalid parameters
+ */
+int confstore_init(uint8_t *start, uint8_t sectors, uint32_t sector_size);
+
+/**
+ * @brief Starts a new transaction
+ */
+void confstore_begin(confstore_txn_t *txn);
+
+/**
+ * @brief Adds a change to *txn*
+ *
+ * @return 0 on success, -1 if the value is too long or *txn* is full
+ */
+int confstore_set_u32(confstore_txn_t *txn, const char *key, uint32_t value);
+int confstore_set_i32(confstore_txn_t *txn, const char *key, int32_t value);
+int confstore_set_str(confstore_txn_t *txn, const char *key, const char *value);
+int confstore_set_blob(confstore_txn_t *txn, const char *key,
+                       const void *value, uint8_t len);
+int confstore_unset(confstore_txn_t *txn, const char *key);
+
+/**
+ * @brief Writes all changes of *txn* to flash and applies them
+ *
+ * @return 0 on success, -1 if the RAM table is full,
+ *         -2 on a flash error
+ */
+int confstore_commit(confstore_txn_t *txn);
+
+/**
+ * @brief Reads a parameter
+ *
+ * @return 0 on success, -1 if there is no such parameter of this type
+ */
+int confstore_get_u32(const char *key, uint32_t *value);
+int confstore_get_i32(const char *key, int32_t *value);
+
+/**
+ * @brief Copies a string parameter to *buf*, truncated to *size*
+ *
+ * @return length of the string, -1 if there is no such parameter
+ */
+int confstore_get_str(const char *key, char *buf, uint8_t size);
+
+/**
+ * @brief Copies up to *size* bytes of a blob parameter to *buf*
+ *
+ * @return length of the blob, -1 if there is no such parameter
+ */
+int confstore_get_blob(const char *key, void *buf, uint8_t size);
+
+/** @} */
+#endif /* __CONFSTORE_H */
@@ -131,11 +131,99 @@ int aes_decrypt(cipher_context_t *context, uint8_t *cipher_block,
  */
 uint8_t aes_get_preferred_block_size(void);
 
+/**
+ * @brief   Byte oriented AES-128 with only the S-box as table instead of the
+ *          T-tables, for the multi-block API on small flash devices
+ */
+#ifndef AES_COMPACT
+#ifdef __MSP430__
+#define AES_COMPACT         (1)
+#else
+#define AES_COMPACT         (0)
+#endif
+#endif
+
+/**
+ * @brief   expands a key into an encryption key schedule
+ *
+ * @param       key       the key schedule to fill
+ * @param       user_key  a pointer to the key
+ * @param       keysize   the length of the key, 16, 24 or 32
+ *
+ * @return  0 on success, negative if the key size is invalid
+ */
+int aes_set_key_schedule(AES_KEY *key, const uint8_t *user_key,
+                         uint8_t keysize);
+
+/**
+ * @brief   encrypts one block with an expanded key schedule
+ *
+ * @param       key       the key schedule of aes_set_key_schedule()
+ * @param       in        the plaintext block
+ * @param       out       the ciphertext block, may be *in*
+ */
+void aes_encrypt_schedule(const AES_KEY *key, const uint8_t *in, uint8_t *out);
+
+struct aes_ctx;
+
+/**
+ * @brief   a block encryption engine behind the multi-block API, software
+ *          or a hardware AES unit
+ */
+typedef struct aes_engine {
+    /** loads *key* of *keysize* bytes, 0 on success */
+    int (*set_key)(struct aes_ctx *ctx, const uint8_t *key, uint8_t keysize);
+    /** encrypts one block, *out* may be *in* */
+    void (*encrypt)(const struct aes_ctx *ctx, const uint8_t *in, uint8_t *out);
+} aes_engine_t;
+
+/**
+ * @brief   key and engine for the multi-block functions, the key is expanded
+ *          once instead of per block
+ */
+typedef struct aes_ctx {
+    const aes_engine_t *engine;     ///< the engine doing the block operations
+    AES_KEY key;                    ///< key schedule of the software engine
+} aes_ctx_t;
+
+/**
+ * @brief   the software engine, T-tables or AES_COMPACT
+ */
+extern const aes_engine_t aes_engine_software;
+
+/**
+ * @brief   rank of the software provider, always registered
+ */
+#if AES_COMPACT
+#define AES_SOFTWARE_RANK   (5)
+#else
+#define AES_SOFTWARE_RANK   (10)
+#endif
+
+/**
+ * @brief   sets up *ctx* for *key* on *engine*
+ *
+ * @param       ctx       the context to initialize
+ * @param       engine    the engine to use, NULL for the registered provider
+ *                        of the highest rank supporting *keysize*
+ * @param       key       a pointer to the key
+ * @param       keysize   the length of the key
+ *
+ * @return  0 on success, negative if the engine refused the key
+ */
+int aes_ctx_init(aes_ctx_t *ctx, const aes_engine_t *engine,
+                 const uint8_t *key, uint8_t keysize);
+
+/**
+ * @brief   encrypts one block with the engine of *ctx*
+ */
+#define aes_ctx_encrypt(ctx, in, out)   ((ctx)->engine->encrypt((ctx), (in), (out)))
+
 /**
   * Interface to access the functions
   *
   */
-extern block_cipher_interface_t aes_inerface;
+extern block_cipher_interface_t aes_interface;
 
 /** @} */
 #endif /* AES_H */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * This source code is licensed under the LGPLv2 license,
+ * See the file LICENSE for more details.
+ */
+
+/**
+ * @ingroup     sys_crypto
+ * @{
+ *
+ * @file        ccmmode.h
+ * @brief       CTR and CCM* modes of operation on an AES context
+ *
+ * CCM* as used by IEEE 802.15.4 link-layer security: a MIC length of 0
+ * selects encryption only, otherwise 4 to 16 bytes of MIC are generated.
+ * All blocks go through aes_ctx_encrypt(), so a hardware engine handles
+ * the whole frame.
+ */
+
+#ifndef CCMMODE_H_
+#define CCMMODE_H_
+
+#include <stdint.h>
+
+#include "crypto/aes.h"
+
+/**
+ * @brief   Shortest and longest CCM* nonce in bytes
+ */
+#define CCM_NONCE_MIN_LEN   (7)
+#define CCM_NONCE_MAX_LEN   (13)
+
+/**
+ * @brief   Longest MIC in bytes
+ */
+#define CCM_MIC_MAX_LEN     (16)
+
+/**
+ * @brief   En- or decrypts *len* bytes in counter mode
+ *
+ * @param       ctx     the AES context with the key
+ * @param       ctr     the 16 byte counter block, incremented big endian
+ *                      per block and left at the next unused value
+ * @param       in      the input data
+ * @param       out     the output data, may be *in*
+ * @param       len     the number of bytes to process
+ */
+void aes_ctr_crypt(const aes_ctx_t *ctx, uint8_t *ctr, const uint8_t *in,
+                   uint8_t *out, uint16_t len);
+
+/**
+ * @brief   Encrypts and authenticates a message in CCM* mode
+ *
+ * @param       ctx         the AES context with the key
+ * @param       nonce       the nonce
+ * @param       nonce_len   the length of the nonce, 7 to 13
+ * @param       adata       the additional authenticated data (e.g. the MAC header)
+ * @param       adata_len   the length of *adata*
+ * @param       in          the plaintext
+ * @param       out         the ciphertext, may be *in*
+ * @param       len         the length of the plaintext
+ * @param       mic         the generated MIC
+ * @param       mic_len     the length of the MIC, 0 or an even number from 4 to 16
+ *
+ * @return  0 on success, negative on invalid parameters
+ */
+int aes_ccm_encrypt(const aes_ctx_t *ctx, const uint8_t *nonce,
+                    uint8_t nonce_len, const uint8_t *adata, uint16_t adata_len,
+                    const uint8_t *in, uint8_t *out, uint16_t len,
+                    uint8_t *mic, uint8_t mic_len);
+
+/**
+ * @brief   Decrypts and verifies a message in CCM* mode
+ *
+ * Parameters as for aes_ccm_encrypt(), *mic* is the received MIC.
+ *
+ * @return  0 on success, -1 if the MIC does not match, another negative
+ *          value on invalid parameters
+ */
+int aes_ccm_decrypt(const aes_ctx_t *ctx, const uint8_t *nonce,
+                    uint8_t nonce_len, const uint8_t *adata, uint16_t adata_len,
+                    const uint8_t *in, uint8_t *out, uint16_t len,
+                    const uint8_t *mic, uint8_t mic_len);
+
+/** @} */
+#endif /* CCMMODE_H_ */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup     sys_crypto
+ * @{
+ *
+ * @file        cipher_select.h
+ * @brief       Picks the block cipher of a build at compile time
+ *
+ * CIPHER_SELECTED is the interface of the fastest cipher among the
+ * crypto_* modules of the build whose key meets CIPHERS_MIN_KEY_BITS.
+ * Speed is given by a rank per cipher, the defaults follow published
+ * measurements for 16 bit (MSP430) and 32 bit (ARM) MCUs.  The
+ * `cipherbench` shell command measures the ciphers on a board and prints
+ * the ranks to put into its Makefile, e.g.
+ *
+ *     CFLAGS += -DCIPHER_RANK_TWOFISH=5
+ *
+ * CIPHER_SELECTED is not defined if no cipher qualifies.
+ *
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __CIPHER_SELECT_H
+#define __CIPHER_SELECT_H
+
+#include "crypto/ciphers.h"
+
+#ifdef MODULE_CRYPTO_AES
+#include "crypto/aes.h"
+#endif
+#ifdef MODULE_CRYPTO_TWOFISH
+#include "crypto/twofish.h"
+#endif
+#ifdef MODULE_CRYPTO_RC5
+#include "crypto/rc5.h"
+#endif
+#ifdef MODULE_CRYPTO_SKIPJACK
+#include "crypto/skipjack.h"
+#endif
+#ifdef MODULE_CRYPTO_3DES
+#include "crypto/3des.h"
+#endif
+
+/**
+ * @brief   the security policy, ciphers with shorter keys are not selected
+ */
+#ifndef CIPHERS_MIN_KEY_BITS
+#define CIPHERS_MIN_KEY_BITS    (128)
+#endif
+
+/**
+ * @name    Effective key length of the ciphers in bits
+ * @{
+ */
+#define CIPHER_KEY_BITS_AES         (128)
+#define CIPHER_KEY_BITS_TWOFISH     (128)
+#define CIPHER_KEY_BITS_THREEDES    (112)   ///< meet-in-the-middle
+#define CIPHER_KEY_BITS_SKIPJACK    (80)
+#define CIPHER_KEY_BITS_RC5         (64)    ///< the key is cut to 8 bytes
+/** @} */
+
+/**
+ * @name    Speed of the ciphers, the highest rank is the fastest
+ * @{
+ */
+#ifdef __MSP430__
+/* 16 bit: RC5's 32 bit rotations are slow, Skipjack works on 16 bit words */
+#ifndef CIPHER_RANK_SKIPJACK
+#define CIPHER_RANK_SKIPJACK        (5)
+#endif
+#ifndef CIPHER_RANK_RC5
+#define CIPHER_RANK_RC5             (3)
+#endif
+#else
+#ifndef CIPHER_RANK_SKIPJACK
+#define CIPHER_RANK_SKIPJACK        (3)
+#endif
+#ifndef CIPHER_RANK_RC5
+#define CIPHER_RANK_RC5             (5)
+#endif
+#endif
+#ifndef CIPHER_RANK_AES
+#define CIPHER_RANK_AES             (4)
+#endif
+#ifndef CIPHER_RANK_TWOFISH
+#define CIPHER_RANK_TWOFISH         (2)
+#endif
+#ifndef CIPHER_RANK_THREEDES
+#define CIPHER_RANK_THREEDES        (1)
+#endif
+/** @} */
+
+/* rank of a cipher in the build meeting the policy, else 0 */
+#define _CIPHER_SCORE(name) \
+    ((CIPHER_KEY_BITS_##name >= CIPHERS_MIN_KEY_BITS) ? CIPHER_RANK_##name : 0)
+
+#ifdef MODULE_CRYPTO_AES
+#define _CIPHER_SCORE_AES       _CIPHER_SCORE(AES)
+#else
+#define _CIPHER_SCORE_AES       (0)
+#endif
+#ifdef MODULE_CRYPTO_TWOFISH
+#define _CIPHER_SCORE_TWOFISH   _CIPHER_SCORE(TWOFISH)
+#else
+#define _CIPHER_SCORE_TWOFISH   (0)
+#endif
+#ifdef MODULE_CRYPTO_RC5
+#define _CIPHER_SCORE_RC5       _CIPHER_SCORE(RC5)
+#else
+#define _CIPHER_SCORE_RC5       (0)
+#endif
+#ifdef MODULE_CRYPTO_SKIPJACK
+#define _CIPHER_SCORE_SKIPJACK  _CIPHER_SCORE(SKIPJACK)
+#else
+#define _CIPHER_SCORE_SKIPJACK  (0)
+#endif
+#ifdef MODULE_CRYPTO_3DES
+#define _CIPHER_SCORE_THREEDES  _CIPHER_SCORE(THREEDES)
+#else
+#define _CIPHER_SCORE_THREEDES  (0)
+#endif
+
+/* *s* qualifies and no other score is higher, ties go to the first */
+#define _CIPHER_BEST(s, a, b, c, d) \
+    ((s) && ((s) >= (a)) && ((s) >= (b)) && ((s) >= (c)) && ((s) >= (d)))
+
+#if _CIPHER_BEST(_CIPHER_SCORE_AES, _CIPHER_SCORE_TWOFISH, _CIPHER_SCORE_RC5, \
+                 _CIPHER_SCORE_SKIPJACK, _CIPHER_SCORE_THREEDES)
+#define CIPHER_SELECTED     aes_interface
+#elif _CIPHER_BEST(_CIPHER_SCORE_TWOFISH, _CIPHER_SCORE_AES, _CIPHER_SCORE_RC5, \
+                   _CIPHER_SCORE_SKIPJACK, _CIPHER_SCORE_THREEDES)
+#define CIPHER_SELECTED     twofish_interface
+#elif _CIPHER_BEST(_CIPHER_SCORE_RC5, _CIPHER_SCORE_AES, _CIPHER_SCORE_TWOFISH, \
+                   _CIPHER_SCORE_SKIPJACK, _CIPHER_SCORE_THREEDES)
+#define CIPHER_SELECTED     rc5_interface
+#elif _CIPHER_BEST(_CIPHER_SCORE_SKIPJACK, _CIPHER_SCORE_AES, \
+                   _CIPHER_SCORE_TWOFISH, _CIPHER_SCORE_RC5, \
+                   _CIPHER_SCORE_THREEDES)
+#define CIPHER_SELECTED     skipjack_interface
+#elif _CIPHER_SCORE_THREEDES
+#define CIPHER_SELECTED     tripledes_interface
+#endif
+
+/** @} */
+#endif /* __CIPHER_SELECT_H */
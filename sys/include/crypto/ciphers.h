@@ -21,6 +21,11 @@
 #ifndef __CIPHERS_H_
 #define __CIPHERS_H_
 
+#include <stdint.h>
+#include <string.h>
+
+#include "mutex.h"
+
 /* Shared header file for all cipher algorithms */
 
 /* Set the algorithms that should be compiled in here. When these defines
@@ -34,6 +39,14 @@
 // #define TWOFISH
 // #define SKIPJACK
 
+/* the context has to hold the largest cipher in the build */
+#if defined(MODULE_CRYPTO_RC5) && !defined(RC5)
+#define RC5
+#endif
+#if defined(MODULE_CRYPTO_3DES) && !defined(THREEDES)
+#define THREEDES
+#endif
+
 /// the length of keys in bytes
 #define PARSEC_MAX_BLOCK_CIPHERS  5
 #define CIPHERS_KEYSIZE           20
@@ -62,6 +75,52 @@ typedef struct {
 #endif
 } cipher_context_t;
 
+/**
+ * @brief   the key schedule of the last key a cipher expanded, the block
+ *          functions reuse it as long as they are called with that key
+ *          instead of expanding the key for every block
+ *
+ * The schedule itself is kept by the cipher next to this struct.  A
+ * thread finding the cache in use by another one expands the key on its
+ * own, as without the cache.
+ */
+typedef struct {
+    mutex_t lock;                           ///< held while the schedule is used
+    uint8_t key[sizeof(cipher_context_t)];  ///< the key of the schedule
+    uint8_t valid;                          ///< the schedule matches *key*
+} cipher_key_cache_t;
+
+/**
+ * @brief   takes *cache* for the key in *context*
+ *
+ * @return  1 if the cached schedule belongs to the key, 0 if the caller has
+ *          to expand it and then set *valid*, -1 if the cache is in use.
+ *          Unless -1, cipher_key_cache_release() has to follow.
+ */
+static inline int cipher_key_cache_acquire(cipher_key_cache_t *cache,
+                                           const cipher_context_t *context)
+{
+    if (!mutex_trylock(&cache->lock)) {
+        return -1;
+    }
+
+    if (cache->valid && !memcmp(cache->key, context->context, sizeof(cache->key))) {
+        return 1;
+    }
+
+    memcpy(cache->key, context->context, sizeof(cache->key));
+    cache->valid = 0;
+    return 0;
+}
+
+/**
+ * @brief   gives back *cache* taken by cipher_key_cache_acquire()
+ */
+static inline void cipher_key_cache_release(cipher_key_cache_t *cache)
+{
+    mutex_unlock(&cache->lock);
+}
+
 
 /**
  * @struct BlockCipherInterface_t
@@ -106,6 +165,52 @@ typedef struct {
     block_cipher_interface_t ciphers[PARSEC_MAX_BLOCK_CIPHERS];
 } block_cipher_archive_t;
 
+struct aes_engine;
+
+/**
+ * @name    Capabilities of a crypto provider
+ * @{
+ */
+#define CRYPTO_PROVIDER_HW          (0x01)  ///< runs on a hardware unit
+#define CRYPTO_PROVIDER_KEY_128     (0x02)  ///< supports 128 bit keys
+#define CRYPTO_PROVIDER_KEY_192     (0x04)  ///< supports 192 bit keys
+#define CRYPTO_PROVIDER_KEY_256     (0x08)  ///< supports 256 bit keys
+/** @} */
+
+/**
+ * @brief   capability flag for a key of *keysize* bytes
+ */
+#define CRYPTO_PROVIDER_KEY(keysize)    (CRYPTO_PROVIDER_KEY_128 << (((keysize) - 16) / 8))
+
+/**
+ * @brief   a block cipher backend registered at runtime, the hardware engines
+ *          of radio chips next to the software implementation
+ */
+typedef struct crypto_provider {
+    const char *name;                   ///< shown by the benchmark command
+    uint8_t flags;                      ///< CRYPTO_PROVIDER_* capabilities
+    uint8_t rank;                       ///< the highest rank is used first
+    const struct aes_engine *aes;       ///< the AES engine of this provider
+    struct crypto_provider *next;       // @internal
+} crypto_provider_t;
+
+/**
+ * @brief   adds *provider* to the registry, it stays registered
+ */
+void crypto_provider_register(crypto_provider_t *provider);
+
+/**
+ * @brief   finds the provider of the highest rank having all of *flags*
+ *
+ * @return  the provider, NULL if none matched
+ */
+const crypto_provider_t *crypto_provider_find(uint8_t flags);
+
+/**
+ * @brief   the registered providers, ordered by rank
+ */
+const crypto_provider_t *crypto_provider_list(void);
+
 typedef struct {
         // cipher_context_t for the cipher-operations
     cipher_context_t cc;
@@ -53,6 +53,23 @@
 
 #define SHA256_DIGEST_LENGTH 32
 
+/**
+ * @brief Block size of SHA-256, also the HMAC key block size
+ */
+#define SHA256_BLOCK_LENGTH  64
+
+/**
+ * @brief Unroll the 64 rounds of the block transform: faster, but several
+ *        KiB more flash, so off by default on MSP430
+ */
+#ifndef SHA256_UNROLL
+#ifdef __MSP430__
+#define SHA256_UNROLL   (0)
+#else
+#define SHA256_UNROLL   (1)
+#endif
+#endif
+
 typedef struct {
     uint32_t state[8];
     uint32_t count[2];
@@ -96,5 +113,82 @@ void sha256_final(unsigned char digest[32], sha256_context_t *ctx);
  */
 unsigned char *sha256(const unsigned char *d, size_t n, unsigned char *md);
 
+/**
+ * @brief HMAC-SHA256 context, keeps the keyed inner and outer states so that
+ * a key is processed once for any number of messages
+ */
+typedef struct {
+    sha256_context_t ctx;   ///< hash of the current message
+    uint32_t istate[8];     ///< state after the inner key block
+    uint32_t ostate[8];     ///< state after the outer key block
+} hmac_sha256_context_t;
+
+/**
+ * @brief HMAC-SHA256 initialization with a key, begins the first message
+ *
+ * @param hctx   hmac_sha256_context_t handle to init
+ * @param key    the key, hashed first if longer than SHA256_BLOCK_LENGTH
+ * @param keylen length of the key
+ */
+void hmac_sha256_init(hmac_sha256_context_t *hctx, const void *key,
+                      size_t keylen);
+
+/**
+ * @brief Begins a new message with the key of hmac_sha256_init()
+ *
+ * @param hctx   hmac_sha256_context_t handle to use
+ */
+void hmac_sha256_reset(hmac_sha256_context_t *hctx);
+
+/**
+ * @brief Add bytes into the HMAC
+ *
+ * @param hctx   hmac_sha256_context_t handle to use
+ * @param in     pointer to the input buffer
+ * @param len    length of the buffer
+ */
+void hmac_sha256_update(hmac_sha256_context_t *hctx, const void *in,
+                        size_t len);
+
+/**
+ * @brief HMAC-SHA256 finalization, the key stays usable with
+ * hmac_sha256_reset().  Clear *hctx* with memset() when done with the key.
+ *
+ * @param digest resulting MAC of SHA256_DIGEST_LENGTH bytes
+ * @param hctx   hmac_sha256_context_t handle to use
+ */
+void hmac_sha256_final(unsigned char digest[32], hmac_sha256_context_t *hctx);
+
+/**
+ * @brief HMAC-SHA256 of one buffer
+ *
+ * @param key    the key
+ * @param keylen length of the key
+ * @param d      pointer to the buffer to authenticate
+ * @param n      length of the buffer
+ * @param md     the resulting MAC of SHA256_DIGEST_LENGTH bytes
+ */
+void hmac_sha256(const void *key, size_t keylen, const void *d, size_t n,
+                 unsigned char *md);
+
+/**
+ * @brief HKDF-SHA256 key derivation (RFC 5869), extract and expand
+ *
+ * @param salt     optional salt, NULL for none
+ * @param salt_len length of the salt
+ * @param ikm      the input keying material
+ * @param ikm_len  length of the input keying material
+ * @param info     optional context information, NULL for none
+ * @param info_len length of the context information
+ * @param okm      the output keying material
+ * @param okm_len  length of the output keying material, at most
+ *                 255 * SHA256_DIGEST_LENGTH
+ *
+ * @return 0 on success, -1 if *okm_len* is too large
+ */
+int hkdf_sha256(const void *salt, size_t salt_len, const void *ikm,
+                size_t ikm_len, const void *info, size_t info_len,
+                unsigned char *okm, size_t okm_len);
+
 /** @} */
 #endif /* _SHA256_H_ */
@@ -0,0 +1,114 @@
+/**
+ * Deferred binary logging
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_dlog Deferred logging
+ * @ingroup     sys
+ * @brief       Log messages formatted on the host instead of the node
+ *
+ * DLOG() stores the address of its format string, the hwtimer time, the
+ * running thread and its arguments as raw words in a RAM ring.  Nothing
+ * is formatted on the node: the format strings are put into the section
+ * .dlog_fmt of the ELF file and a thread of low priority writes the
+ * records as hex lines starting with "DLOG".  dist/tools/dlog/dlog.py
+ * looks the format strings up in the ELF file and prints the text, other
+ * lines of the log are passed through.
+ *
+ * Writing a record disables interrupts for a few words and never blocks,
+ * so it is safe in interrupt context and does not need a printf-sized
+ * stack.  Records that do not fit into the ring are counted and reported
+ * as lost.
+ *
+ *     DLOG("rx %u bytes from %04x, rssi %d\n", len, addr, rssi);
+ *
+ * Arguments are integers of at most 32 bits, cast pointers to uintptr_t.
+ * %s is printed if the pointer points into the ELF file, e.g. to a string
+ * constant.  Without the dlog module DLOG() expands to nothing.
+ *
+ * @{
+ * @file        dlog.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __DLOG_H
+#define __DLOG_H
+
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * @brief Size of the ring in 32 bit words, a power of two
+ */
+#ifndef DLOG_SIZE
+#define DLOG_SIZE           (512)
+#endif
+
+/**
+ * @brief Most arguments of a record
+ */
+#define DLOG_ARGS_MAX       (8)
+
+/**
+ * @brief pid recorded for messages in interrupt context
+ */
+#define DLOG_PID_ISR        (0xff)
+
+/**
+ * @brief Priority of the thread writing the records out
+ */
+#ifndef DLOG_PRIORITY
+#define DLOG_PRIORITY       (PRIORITY_MIN - 1)
+#endif
+
+/**
+ * @brief Stack size of the thread writing the records out
+ */
+#ifndef DLOG_STACKSIZE
+#define DLOG_STACKSIZE      (KERNEL_CONF_STACKSIZE_DEFAULT)
+#endif
+
+#ifdef MODULE_DLOG
+/**
+ * @brief Logs *fmt* with up to DLOG_ARGS_MAX integer arguments
+ */
+#define DLOG(fmt, ...) \
+    do { \
+        static const char _dlog_fmt[] \
+            __attribute__((section(".dlog_fmt"), used)) = fmt; \
+        const uint32_t _dlog_args[] = { 0, ##__VA_ARGS__ }; \
+        dlog_write(_dlog_fmt, &_dlog_args[1], \
+                   sizeof(_dlog_args) / sizeof(uint32_t) - 1); \
+    } while (0)
+#else
+#define DLOG(fmt, ...)      ((void) 0)
+#endif
+
+/**
+ * @brief Adds a record to the ring, use DLOG() instead
+ *
+ * @param[in] fmt   format string in the section .dlog_fmt
+ * @param[in] args  the arguments
+ * @param[in] num   number of *args*, at most DLOG_ARGS_MAX
+ */
+void dlog_write(const char *fmt, const uint32_t *args, unsigned int num);
+
+/**
+ * @brief Starts the thread writing the records out, done by auto_init
+ *
+ * @return its pid, a negative value on error
+ */
+int dlog_init(void);
+
+/**
+ * @brief Writes out all records now, from the calling thread
+ */
+void dlog_flush(void);
+
+/** @} */
+#endif /* __DLOG_H */
@@ -0,0 +1,191 @@
+/**
+ * Energy accounting
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_energy Energy accounting
+ * @ingroup     sys
+ * @brief       Tells where the charge goes: MCU power modes, radio states
+ *              and threads
+ *
+ * The MCU and the radio are each in one state at a time.  The idle thread
+ * and the scheduler report the power modes of the MCU with ENERGY_MCU(),
+ * the cc110x_ng, cc2420 and at86rf231 drivers report the radio states with
+ * ENERGY_RADIO().  The time spent in every state is summed up in us
+ * (vtimer_now64()), the charge is the time times the current of the state
+ * as set with energy_set_current() or the board's ENERGY_CURRENT_*
+ * defines.  With SCHEDSTATISTICS the active time of the MCU is broken down
+ * by thread as well.
+ *
+ * The currents of the data sheets are off for a real board.  With the
+ * ltc4150 module, energy_calibrate() compares the charge the coulomb
+ * counter measured since the last call with the one estimated and scales
+ * all estimates by their ratio from then on.
+ *
+ * Interrupts waking the MCU are counted to the power mode it slept in
+ * until the scheduler or the idle thread runs.
+ *
+ * energy_dump() prints the totals as lines starting with "ENERGY".
+ * Without the energy module ENERGY_MCU() and ENERGY_RADIO() expand to
+ * nothing.
+ *
+ * @{
+ * @file        energy.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __ENERGY_H
+#define __ENERGY_H
+
+#include <stdint.h>
+
+#include "lpm.h"
+
+/**
+ * @brief States accounted for, the MCU ones in the order of enum lpm_mode
+ */
+typedef enum {
+    ENERGY_CPU = 0,             ///< MCU active, LPM_ON
+    ENERGY_LPM_IDLE,            ///< MCU in LPM_IDLE
+    ENERGY_LPM_SLEEP,           ///< MCU in LPM_SLEEP
+    ENERGY_LPM_POWERDOWN,       ///< MCU in LPM_POWERDOWN
+    ENERGY_RADIO_OFF,           ///< radio powered down or not started
+    ENERGY_RADIO_IDLE,          ///< radio on, neither listening nor sending
+    ENERGY_RADIO_WOR,           ///< radio listening in its own duty cycle
+    ENERGY_RADIO_RX,            ///< radio listening or receiving
+    ENERGY_RADIO_TX,            ///< radio sending
+    ENERGY_STATES
+} energy_state_t;
+
+/**
+ * @brief Supply voltage in mV the energies are computed for
+ */
+#ifndef ENERGY_SUPPLY_MV
+#define ENERGY_SUPPLY_MV            (3000)
+#endif
+
+/**
+ * @name Currents of the states in uA, boards may define their own
+ * @{
+ */
+#ifndef ENERGY_CURRENT_CPU
+#define ENERGY_CURRENT_CPU          (0)
+#endif
+#ifndef ENERGY_CURRENT_LPM_IDLE
+#define ENERGY_CURRENT_LPM_IDLE     (0)
+#endif
+#ifndef ENERGY_CURRENT_LPM_SLEEP
+#define ENERGY_CURRENT_LPM_SLEEP    (0)
+#endif
+#ifndef ENERGY_CURRENT_LPM_POWERDOWN
+#define ENERGY_CURRENT_LPM_POWERDOWN (0)
+#endif
+#ifndef ENERGY_CURRENT_RADIO_OFF
+#define ENERGY_CURRENT_RADIO_OFF    (0)
+#endif
+#ifndef ENERGY_CURRENT_RADIO_IDLE
+#define ENERGY_CURRENT_RADIO_IDLE   (0)
+#endif
+#ifndef ENERGY_CURRENT_RADIO_WOR
+#define ENERGY_CURRENT_RADIO_WOR    (0)
+#endif
+#ifndef ENERGY_CURRENT_RADIO_RX
+#define ENERGY_CURRENT_RADIO_RX     (0)
+#endif
+#ifndef ENERGY_CURRENT_RADIO_TX
+#define ENERGY_CURRENT_RADIO_TX     (0)
+#endif
+/** @} */
+
+#ifdef MODULE_ENERGY
+/**
+ * @brief The MCU switches to power mode *mode*
+ */
+#define ENERGY_MCU(mode)            energy_mcu(mode)
+
+/**
+ * @brief The radio switches to *state*, one of the ENERGY_RADIO_* states
+ */
+#define ENERGY_RADIO(state)         energy_radio(state)
+#else
+#define ENERGY_MCU(mode)            ((void) (mode))
+#define ENERGY_RADIO(state)         ((void) (state))
+#endif
+
+/**
+ * @brief Accounts the time since the last switch of the MCU and switches
+ *        to *mode*, use ENERGY_MCU() instead.  Safe to call from interrupt
+ *        context.
+ */
+void energy_mcu(enum lpm_mode mode);
+
+/**
+ * @brief Accounts the time since the last switch of the radio and switches
+ *        to *state*, use ENERGY_RADIO() instead.  Safe to call from
+ *        interrupt context.
+ */
+void energy_radio(energy_state_t state);
+
+/**
+ * @brief Sets the current of a state
+ *
+ * @param[in] state     the state
+ * @param[in] current   its current in uA
+ */
+void energy_set_current(energy_state_t state, uint32_t current);
+
+/**
+ * @brief Gets the time spent in a state since the last energy_clear()
+ *
+ * @param[in] state     the state
+ *
+ * @return the time in us
+ */
+uint64_t energy_time(energy_state_t state);
+
+/**
+ * @brief Gets the charge drawn in a state since the last energy_clear(),
+ *        with the calibration applied
+ *
+ * @param[in] state     the state
+ *
+ * @return the charge in uC
+ */
+uint64_t energy_charge(energy_state_t state);
+
+/**
+ * @brief Gets the name of a state, as energy_dump() prints it
+ *
+ * @return the name, NULL if *state* is out of range
+ */
+const char *energy_state_name(energy_state_t state);
+
+/**
+ * @brief Starts the accounting anew, the currents and the calibration are
+ *        kept
+ */
+void energy_clear(void);
+
+/**
+ * @brief Prints the time, charge and energy per state and per thread
+ */
+void energy_dump(void);
+
+/**
+ * @brief Scales the estimates so they match the charge the ltc4150
+ *        measured since the last call, the first call just starts the
+ *        measurement
+ *
+ * The ltc4150 must have been started with ltc4150_start().
+ *
+ * @return the new scale in 1/1000, -1 if there is no ltc4150, nothing to
+ *         compare yet or no charge estimated since the last call
+ */
+int energy_calibrate(void);
+
+/** @} */
+#endif /* __ENERGY_H */
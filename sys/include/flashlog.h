@@ -0,0 +1,155 @@
+/**
+ * Append-only record log in internal flash
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_flashlog Flash log
+ * @ingroup     sys
+ * @brief       Log-structured store for time stamped records on flashrom.h
+ *
+ * The log occupies a range of equally sized flash sectors and is written
+ * as a ring: records are collected in a RAM page and the page is
+ * programmed once it is full, each page exactly once.  When the last
+ * sector is full the oldest one is erased and reused, so all sectors wear
+ * out at the same rate and the newest data survives.
+ *
+ * Every sector starts with a header holding a sequence number, which lets
+ * flashlog_init() find the head of the log after a reset.  Time stamps of
+ * appended records must not decrease; a RAM index of the first time stamp
+ * in every sector lets flashlog_seek() find a point in time with a binary
+ * search over the sectors and a scan of one sector.
+ *
+ * On the LPC2387 sectors 9 to 21 are 32 KiB each:
+ *
+ *     flashlog_init(&log, (uint8_t *) 0x40000, 8, 0x8000);
+ *
+ * @{
+ * @file        flashlog.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __FLASHLOG_H
+#define __FLASHLOG_H
+
+#include <stdint.h>
+
+#include "mutex.h"
+
+/**
+ * @brief Bytes programmed at once, flashrom_write() writes 256 bytes
+ */
+#define FLASHLOG_PAGE_SIZE      (256)
+
+/**
+ * @brief Most sectors of a log
+ */
+#ifndef FLASHLOG_MAX_SECTORS
+#define FLASHLOG_MAX_SECTORS    (16)
+#endif
+
+/**
+ * @brief Bytes of a sector header and of a record header
+ */
+#define FLASHLOG_SECTOR_HEADER  (8)
+#define FLASHLOG_RECORD_HEADER  (6)
+
+/**
+ * @brief Largest record, records never cross a page
+ */
+#define FLASHLOG_RECORD_MAX     (FLASHLOG_PAGE_SIZE - FLASHLOG_SECTOR_HEADER - \
+                                 FLASHLOG_RECORD_HEADER)
+
+typedef struct {
+    uint8_t *start;             /**< first byte of the first sector */
+    uint32_t sector_size;       /**< bytes per sector */
+    uint8_t sectors;            /**< sectors of the log */
+    uint8_t used;               /**< sectors holding records */
+    uint8_t head;               /**< sector being written */
+    uint16_t page;              /**< page of the head in the buffer */
+    uint16_t fill;              /**< bytes in the buffer */
+    uint32_t seq;               /**< sequence number of the head */
+    uint32_t last;              /**< latest time stamp */
+    uint32_t first[FLASHLOG_MAX_SECTORS];   /**< first time stamp per sector */
+    uint32_t buf[FLASHLOG_PAGE_SIZE / sizeof(uint32_t)];
+    mutex_t lock;
+} flashlog_t;
+
+/**
+ * @brief Position of a reader, stays valid while records are appended
+ */
+typedef struct {
+    uint32_t seq;               /**< sequence number of the sector */
+    uint16_t page;              /**< page in the sector */
+    uint16_t offset;            /**< offset in the page */
+} flashlog_cursor_t;
+
+/**
+ * @brief Mounts the log, erased or previously written sectors
+ *
+ * @param log           the log
+ * @param start         flash address of the first sector
+ * @param sectors       number of sectors, at least 2
+ * @param sector_size   size of every sector, a multiple of the page size
+ *
+ * @return 0 on success, -1 on invalid parameters
+ */
+int flashlog_init(flashlog_t *log, uint8_t *start, uint8_t sectors,
+                  uint32_t sector_size);
+
+/**
+ * @brief Appends a record, erasing the oldest sector if the log is full
+ *
+ * @param log   the log
+ * @param time  time stamp, not less than the one of the previous record
+ * @param data  the record
+ * @param len   length of the record, at most FLASHLOG_RECORD_MAX
+ *
+ * @return 0 on success, -1 on invalid parameters, -2 on a flash error
+ */
+int flashlog_append(flashlog_t *log, uint32_t time, const void *data,
+                    uint16_t len);
+
+/**
+ * @brief Programs the buffered records, e.g. before a power down
+ *
+ * The rest of the page stays unused.
+ *
+ * @return 0 on success, -2 on a flash error
+ */
+int flashlog_sync(flashlog_t *log);
+
+/**
+ * @brief Erases all sectors
+ *
+ * @return 0 on success, -2 on a flash error
+ */
+int flashlog_erase(flashlog_t *log);
+
+/**
+ * @brief Places *cursor* at the first record not older than *time*
+ */
+void flashlog_seek(flashlog_t *log, flashlog_cursor_t *cursor, uint32_t time);
+
+/**
+ * @brief Reads the record at *cursor* and advances it
+ *
+ * Buffered records are read as well.  A cursor on a sector that was
+ * erased meanwhile continues at the oldest record.
+ *
+ * @param log       the log
+ * @param cursor    position, see flashlog_seek()
+ * @param time      receives the time stamp if not NULL
+ * @param buf       receives up to *size* bytes of the record
+ * @param size      size of *buf*
+ *
+ * @return length of the record, -1 at the end of the log
+ */
+int flashlog_read(flashlog_t *log, flashlog_cursor_t *cursor, uint32_t *time,
+                  void *buf, uint16_t size);
+
+/** @} */
+#endif /* __FLASHLOG_H */
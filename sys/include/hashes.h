@@ -156,5 +156,52 @@ uint32_t rotating_hash(const uint8_t *buf, size_t len);
  */
 uint32_t one_at_a_time_hash(const uint8_t *buf, size_t len);
 
+/**
+ * @brief double_hash64
+ *
+ * Two independent 32 bit hashes computed in one pass over the buffer:
+ * FNV-1a in the lower and one-at-a-time in the upper half, both started
+ * from *seed*.  Enough for double hashing, g_i(x) = h1(x) + i * h2(x),
+ * as described by Kirsch and Mitzenmacher in "Less Hashing, Same
+ * Performance: Building a Better Bloom Filter".
+ *
+ * @param buf  input buffer to hash
+ * @param len  length of buffer
+ * @param seed start value, different seeds give unrelated hashes
+ * @return two 32 bit sized hashes
+ */
+uint64_t double_hash64(const uint8_t *buf, size_t len, uint32_t seed);
+
+/**
+ * @brief xxh32_hash
+ *
+ * xxHash, 32 bit version, as found on
+ * https://github.com/Cyan4973/xxHash
+ *
+ * Consumes 16 bytes per iteration in four independent lanes and mixes the
+ * result with a full avalanche, every input bit affects every output bit.
+ * Good for IPv6 addresses, names and address/port tuples.  Results are
+ * the same as the reference implementation on every platform.
+ *
+ * @param buf  input buffer to hash, no alignment needed
+ * @param len  length of buffer
+ * @param seed seed of the hash
+ * @return 32 bit sized hash
+ */
+uint32_t xxh32_hash(const uint8_t *buf, size_t len, uint32_t seed);
+
+/**
+ * @brief xxh64_hash
+ *
+ * xxHash, 64 bit version. Faster than xxh32_hash() on 64 bit hosts, but
+ * slow on 16 and 32 bit MCUs because of the 64 bit multiplications.
+ *
+ * @param buf  input buffer to hash, no alignment needed
+ * @param len  length of buffer
+ * @param seed seed of the hash
+ * @return 64 bit sized hash
+ */
+uint64_t xxh64_hash(const uint8_t *buf, size_t len, uint64_t seed);
+
 /** @} */
 #endif /* __HASHES_H */
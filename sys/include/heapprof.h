@@ -0,0 +1,108 @@
+/**
+ * Allocation profiler
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_heapprof Allocation profiler
+ * @ingroup     sys
+ * @brief       Shows who holds the heap, per call site of malloc()
+ *
+ * With `USEMODULE += heapprof` the linker wraps malloc(), calloc(),
+ * realloc() and free() (ld's --wrap, so not with BUILDOSXNATIVE).  Every
+ * block gets a header of HEAPPROF_HDR_SIZE bytes with its size and the
+ * call site it was allocated from, the return address of the call.
+ * Allocations, failures, the bytes held and their peak are counted per
+ * call site in a table of HEAPPROF_SITES entries, sites beyond it are
+ * counted together as "other".  heapprof_dump() prints the sites with the
+ * highest peaks, the script in dist/tools/heapprof maps them to the
+ * functions of the ELF file.
+ *
+ * Blocks newlib allocates for itself, e.g. in strdup(), are not seen; a
+ * free() of one is told apart by a magic number in the header and passed
+ * on as it is.
+ *
+ * On native, heapprof_trace() logs every allocation and free to the file
+ * HEAPPROF_NATIVE_FILE.  The script replays the log and shows the peak
+ * and the blocks still held at its end per call site.
+ *
+ * @{
+ * @file        heapprof.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __HEAPPROF_H
+#define __HEAPPROF_H
+
+#include <stdint.h>
+
+/**
+ * @brief Call sites counted apart
+ */
+#ifndef HEAPPROF_SITES
+#define HEAPPROF_SITES          (32)
+#endif
+
+/**
+ * @brief Bytes in front of every block, a multiple of the alignment
+ *        malloc() guarantees
+ */
+#ifndef HEAPPROF_HDR_SIZE
+#define HEAPPROF_HDR_SIZE       (8)
+#endif
+
+/**
+ * @brief Name of the trace on native, %i is the pid of the process
+ */
+#ifndef HEAPPROF_NATIVE_FILE
+#define HEAPPROF_NATIVE_FILE    "riot-%i.heap"
+#endif
+
+/**
+ * @brief Allocations of a call site
+ */
+typedef struct {
+    uintptr_t site;         /**< return address of the call, 0 for "other" */
+    uint32_t allocs;        /**< successful allocations */
+    uint32_t fails;         /**< failed allocations */
+    uint32_t blocks;        /**< blocks held */
+    uint32_t bytes;         /**< bytes held, without the headers */
+    uint32_t peak;          /**< most bytes held at a time */
+    uint32_t total;         /**< bytes allocated in all */
+} heapprof_site_t;
+
+/**
+ * @brief Gets the allocations of a call site
+ *
+ * @param[in] i     0 to HEAPPROF_SITES, the last one is "other"
+ *
+ * @return the site, NULL if *i* is out of range or no site was seen there
+ */
+const heapprof_site_t *heapprof_get_site(unsigned int i);
+
+/**
+ * @brief Prints the totals and the call sites with the highest peaks
+ *
+ * @param[in] top   sites to print at most, 0 for all
+ */
+void heapprof_dump(unsigned int top);
+
+/**
+ * @brief Counts allocations and peaks anew, the bytes held are kept
+ */
+void heapprof_clear(void);
+
+/**
+ * @brief Starts or stops the trace of all allocations
+ *
+ * @param[in] on    1 to start, 0 to stop
+ *
+ * @return 0 on success, -1 if the file cannot be opened or not on native
+ */
+int heapprof_trace(int on);
+
+/** @} */
+#endif /* __HEAPPROF_H */
@@ -0,0 +1,120 @@
+/**
+ * Fixed-size block pool allocator
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_mempool Memory pools
+ * @ingroup     sys
+ * @brief       O(1) allocator for protocol objects with compile-time size
+ *              classes
+ *
+ * Requests are served from the smallest size class that has a free block.
+ * Requests larger than the biggest class, or made while all fitting
+ * classes are exhausted, fall back to malloc(). mempool_free() accepts
+ * both kinds of pointers, so callers can treat the pool like the heap.
+ *
+ * @{
+ * @file        mempool.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __MEMPOOL_H
+#define __MEMPOOL_H
+
+#include <stddef.h>
+
+/**
+ * @name Size classes
+ *
+ * Block sizes must be multiples of 8 and ascending. A class with zero
+ * blocks is disabled.
+ * @{
+ */
+#ifndef MEMPOOL_SIZE_0
+#define MEMPOOL_SIZE_0  (16)
+#endif
+#ifndef MEMPOOL_NUM_0
+#define MEMPOOL_NUM_0   (16)
+#endif
+#ifndef MEMPOOL_SIZE_1
+#define MEMPOOL_SIZE_1  (32)
+#endif
+#ifndef MEMPOOL_NUM_1
+#define MEMPOOL_NUM_1   (16)
+#endif
+#ifndef MEMPOOL_SIZE_2
+#define MEMPOOL_SIZE_2  (64)
+#endif
+#ifndef MEMPOOL_NUM_2
+#define MEMPOOL_NUM_2   (8)
+#endif
+#ifndef MEMPOOL_SIZE_3
+#define MEMPOOL_SIZE_3  (128)
+#endif
+#ifndef MEMPOOL_NUM_3
+#define MEMPOOL_NUM_3   (4)
+#endif
+#ifndef MEMPOOL_SIZE_4
+#define MEMPOOL_SIZE_4  (256)
+#endif
+#ifndef MEMPOOL_NUM_4
+#define MEMPOOL_NUM_4   (2)
+#endif
+/** @} */
+
+#define MEMPOOL_CLASSES (5)
+
+/**
+ * @brief Statistics of one size class
+ */
+typedef struct {
+    size_t size;            /**< block size */
+    unsigned int num;       /**< number of blocks */
+    unsigned int used;      /**< blocks currently in use */
+    unsigned int max_used;  /**< high-water mark of used blocks */
+    unsigned int fallbacks; /**< requests that had to go to malloc() */
+} mempool_stats_t;
+
+/**
+ * @brief   Allocates a block of at least *size* bytes
+ * @return  Pointer to the block, NULL if out of memory
+ */
+void *mempool_alloc(size_t size);
+
+/**
+ * @brief   Allocates a zeroed block of at least *num* * *size* bytes
+ * @return  Pointer to the block, NULL if out of memory
+ */
+void *mempool_calloc(size_t num, size_t size);
+
+/**
+ * @brief   Resizes a block, moving it to a different size class if required
+ * @return  Pointer to the resized block, NULL if out of memory (*ptr* stays
+ *          valid in this case)
+ */
+void *mempool_realloc(void *ptr, size_t size);
+
+/**
+ * @brief   Returns a block obtained by one of the allocation functions
+ * @param[in] ptr   the block, may be NULL
+ */
+void mempool_free(void *ptr);
+
+/**
+ * @brief   Gets the statistics of a size class
+ * @param[in] cls   index of the size class, < MEMPOOL_CLASSES
+ * @return  Pointer to the statistics, NULL if *cls* is invalid
+ */
+const mempool_stats_t *mempool_get_stats(unsigned int cls);
+
+/**
+ * @brief   Prints the statistics of all size classes to stdout
+ */
+void mempool_print_stats(void);
+
+/** @} */
+#endif /* __MEMPOOL_H */
@@ -0,0 +1,175 @@
+/**
+ * Packet capture in pcap format
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_pcap pcap
+ * @ingroup     sys
+ * @brief       Streams received frames to a host in pcap format
+ *
+ * pcap_capture() copies a frame with its pcap record header into a RAM
+ * ring, the formatting is done there and then.  A thread of low priority
+ * writes the ring out as a pcap stream, so a busy radio loses capture
+ * records rather than frames, and the loss is counted.  Wireshark reads the
+ * stream directly, e.g. from a serial port:
+ *
+ *     stty -F /dev/ttyUSB0 raw 115200 && wireshark -k -i - < /dev/ttyUSB0
+ *
+ * The stream goes to stdout, i.e. the UART, so nothing else may print
+ * while a capture runs.  On native it goes to the file PCAP_NATIVE_FILE
+ * instead, e.g. for `tail -c +0 -f riot-1234.pcap | wireshark -k -i -`.
+ *
+ * 802.15.4 frames are captured with the link type IEEE802_15_4_TAP, which
+ * carries RSSI, LQI and channel along with the frame, other radios with
+ * USER0 and a header of destination and source address.  A filter and a
+ * snap length limit what is copied.
+ *
+ * @{
+ * @file        pcap.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __PCAP_H
+#define __PCAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * @brief Size of the ring in bytes, a power of two
+ */
+#ifndef PCAP_BUFSIZE
+#define PCAP_BUFSIZE        (2048)
+#endif
+
+/**
+ * @brief Priority of the thread writing the stream
+ */
+#ifndef PCAP_PRIORITY
+#define PCAP_PRIORITY       (PRIORITY_MIN - 1)
+#endif
+
+/**
+ * @brief Stack size of the thread writing the stream
+ */
+#ifndef PCAP_STACKSIZE
+#define PCAP_STACKSIZE      (KERNEL_CONF_STACKSIZE_DEFAULT)
+#endif
+
+/**
+ * @brief File written on native, %i is replaced by the process id
+ */
+#ifndef PCAP_NATIVE_FILE
+#define PCAP_NATIVE_FILE    "riot-%i.pcap"
+#endif
+
+/**
+ * @name Link types
+ * @{
+ */
+#define PCAP_LINKTYPE_USER0             (147)   ///< dst, src, payload
+#define PCAP_LINKTYPE_IEEE802_15_4_TAP  (283)   ///< 802.15.4 with TLVs
+/** @} */
+
+/**
+ * @brief Address or frame type of a frame not known
+ */
+#define PCAP_UNKNOWN        (0xffff)
+
+/**
+ * @name Fields compared by the filter
+ * @{
+ */
+#define PCAP_MATCH_SRC      (0x01)
+#define PCAP_MATCH_DST      (0x02)
+#define PCAP_MATCH_TYPE     (0x04)
+#define PCAP_MATCH_RSSI     (0x08)
+/** @} */
+
+/**
+ * @brief A frame as seen by the radio
+ */
+typedef struct {
+    uint16_t src;           ///< short source address or PCAP_UNKNOWN
+    uint16_t dst;           ///< short destination address or PCAP_UNKNOWN
+    uint16_t type;          ///< 802.15.4 frame type or PCAP_UNKNOWN
+    int8_t rssi;            ///< in dBm
+    uint8_t lqi;            ///< link quality indicator
+    uint8_t channel;        ///< 0 if not known
+} pcap_info_t;
+
+/**
+ * @brief Frames to capture, all fields in *match* must be equal
+ */
+typedef struct {
+    uint8_t match;          ///< PCAP_MATCH_* flags
+    uint8_t types;          ///< frame types, bit 1 << type
+    int8_t rssi;            ///< minimum RSSI
+    uint16_t src;           ///< source address
+    uint16_t dst;           ///< destination address
+} pcap_filter_t;
+
+/**
+ * @brief Counters of a capture
+ */
+typedef struct {
+    unsigned int captured;  ///< frames put into the ring
+    unsigned int filtered;  ///< frames not matching the filter
+    unsigned int dropped;   ///< frames not fitting into the ring
+} pcap_stats_t;
+
+/**
+ * @brief   Starts a capture, writes the pcap file header
+ *
+ * @param[in] linktype  PCAP_LINKTYPE_*
+ * @param[in] snaplen   most bytes of a frame captured, 0 for all
+ *
+ * @return  0 on success, -1 if the thread or the output failed
+ */
+int pcap_start(uint32_t linktype, uint16_t snaplen);
+
+/**
+ * @brief   Stops capturing, the ring is still written out
+ */
+void pcap_stop(void);
+
+/**
+ * @brief   Link type of the running capture
+ * @return  the link type, 0 if no capture runs
+ */
+uint32_t pcap_linktype(void);
+
+/**
+ * @brief   Sets the filter, NULL captures all frames
+ */
+void pcap_set_filter(const pcap_filter_t *filter);
+
+/**
+ * @brief   Copies a frame into the ring if a capture runs and it matches
+ *          the filter, may be called from interrupts
+ *
+ * The frame is given in two parts, e.g. a rebuilt header and the payload
+ * still in the driver's buffer.
+ *
+ * @param[in] info      what is known of the frame
+ * @param[in] hdr       first part of the frame, may be NULL
+ * @param[in] hdr_len   length of *hdr*
+ * @param[in] data      second part of the frame
+ * @param[in] len       length of *data*
+ */
+void pcap_capture(const pcap_info_t *info, const uint8_t *hdr, size_t hdr_len,
+                  const uint8_t *data, size_t len);
+
+/**
+ * @brief   Gets the counters of the running or last capture
+ */
+void pcap_get_stats(pcap_stats_t *stats);
+
+/** @} */
+#endif /* __PCAP_H */
@@ -25,16 +25,61 @@
 #define CLOSE 1
 #define READ 2
 #define WRITE 3
+#define READV 4
+#define WRITEV 5
 
+/**
+ * @brief   Request of READ and WRITE, the driver thread copies from or to
+ *          *buffer* and returns the number of bytes, or a negative errno,
+ *          in *nbytes*
+ */
 struct posix_iop_t {
     int nbytes;
     char *buffer;
 };
 
+/**
+ * @brief   One buffer of a vectored request
+ */
+struct posix_iovec_t {
+    char *buffer;
+    int nbytes;
+};
+
+/**
+ * @brief   Request of READV and WRITEV, the buffers are filled or written
+ *          in order, *nbytes* returns the total as for struct posix_iop_t
+ */
+struct posix_iopv_t {
+    int nbytes;
+    struct posix_iovec_t *iov;
+    int iovcnt;
+};
+
+/**
+ * @brief   Opens the device of driver thread *pid*
+ *
+ * With O_NONBLOCK in *flags* reads return -EAGAIN instead of waiting
+ * for data.
+ */
 int posix_open(int pid, int flags);
 int posix_close(int pid);
 int posix_read(int pid, char *buffer, int bufsize);
 int posix_write(int pid, char *buffer, int bufsize);
 
+/**
+ * @brief   Reads into several buffers with one message to the driver thread
+ *
+ * @return  bytes read, or a negative errno
+ */
+int posix_readv(int pid, struct posix_iovec_t *iov, int iovcnt);
+
+/**
+ * @brief   Writes several buffers with one message to the driver thread
+ *
+ * @return  bytes written, or a negative errno
+ */
+int posix_writev(int pid, struct posix_iovec_t *iov, int iovcnt);
+
 /** @} */
 #endif /* __READ_H */
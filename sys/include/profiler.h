@@ -0,0 +1,101 @@
+/**
+ * Statistical sampling profiler
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_profiler Sampling profiler
+ * @ingroup     sys
+ * @brief       Shows where the CPU time goes, without a debugger
+ *
+ * A timer of the CPU not used by the hwtimer interrupts periodically and
+ * records the address of the interrupted instruction and the running
+ * thread.  The addresses are counted per thread in a histogram of
+ * PROFILER_SLOTS buckets of PROFILER_GRANULARITY bytes each, samples not
+ * fitting into it are counted as missed.  profiler_dump() prints the
+ * histogram, the script in dist/tools/profiler maps it to the functions of
+ * the ELF file, in total and per thread.
+ *
+ * Code running with interrupts disabled is not sampled, its samples are
+ * taken when interrupts are enabled again.  Supported CPUs are the
+ * lpc2387, using TIMER1, the lpc1768, using TIMER3, and native, using the
+ * host's profiling timer and thus sampling CPU time of the process.
+ *
+ * @{
+ * @file        profiler.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+/**
+ * @brief Buckets of the address histogram
+ */
+#ifndef PROFILER_SLOTS
+#define PROFILER_SLOTS          (256)
+#endif
+
+/**
+ * @brief Bytes of code per bucket, a power of two
+ */
+#ifndef PROFILER_GRANULARITY
+#define PROFILER_GRANULARITY    (16)
+#endif
+
+/**
+ * @brief Default time between two samples in microseconds
+ */
+#ifndef PROFILER_INTERVAL
+#define PROFILER_INTERVAL       (1000)
+#endif
+
+/**
+ * @brief Starts sampling, the histogram is kept
+ *
+ * @param interval_us   Microseconds between two samples
+ *
+ * @return 0 on success, -1 if the interval is not supported
+ */
+int profiler_start(unsigned long interval_us);
+
+/**
+ * @brief Stops sampling
+ */
+void profiler_stop(void);
+
+/**
+ * @brief Discards all samples
+ */
+void profiler_clear(void);
+
+/**
+ * @brief Prints the samples per thread and the histogram
+ */
+void profiler_dump(void);
+
+/**
+ * @brief Records a sample, called by the timer interrupt of the CPU
+ *
+ * @param pc    Address of the interrupted instruction
+ */
+void profiler_sample(unsigned long pc);
+
+/**
+ * @brief Starts the timer of the CPU to call profiler_sample() every
+ *        *interval_us*
+ *
+ * @return 0 on success, -1 if the interval is not supported
+ */
+int profiler_arch_start(unsigned long interval_us);
+
+/**
+ * @brief Stops the timer of the CPU
+ */
+void profiler_arch_stop(void);
+
+/** @} */
+#endif /* __PROFILER_H */
@@ -11,4 +11,9 @@
 void thread_print_all(void);
 void _ps_handler(int argc, char **argv);
 
+#if SCHEDSTATISTICS
+void sched_print_stats(void);
+void _schedstat_handler(int argc, char **argv);
+#endif
+
 #endif /* __PS_H */
@@ -0,0 +1,246 @@
+/**
+ * Stackless tasks
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_ptask Stackless tasks
+ * @ingroup     sys
+ * @brief       Protothread-style tasks sharing the stack of one thread
+ *
+ * A task is a function that returns whenever it waits and is called again
+ * from where it left off, so it needs no stack of its own: a ::ptask_t is
+ * a few dozen bytes.  The thread calling ptask_run() runs all started
+ * tasks; they wait for messages to that thread, for timeouts and, with
+ * destiny, for sockets to become ready.
+ *
+ *     static int blink(ptask_t *t)
+ *     {
+ *         PTASK_BEGIN(t);
+ *
+ *         while (1) {
+ *             LED_RED_TOGGLE;
+ *             PTASK_SLEEP(t, 500000);
+ *         }
+ *
+ *         PTASK_END(t);
+ *     }
+ *
+ * As with protothreads, local variables do not survive a wait, a task
+ * keeps its state in a structure around its ::ptask_t or behind
+ * ptask_t::arg.  The wait macros place case labels into the function, so
+ * they must not be used inside a switch statement of its own and only one
+ * of them per line.  A task must not block the thread, e.g. with
+ * msg_receive() or a blocking socket call; destiny_socket_recv() after
+ * PTASK_WAIT_SOCKET() for DESTINY_POLLIN does not block.
+ *
+ * Messages to the thread running the tasks go to the first task waiting
+ * for their type; one nobody waits for is dropped.
+ *
+ * @{
+ * @file        ptask.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __PTASK_H
+#define __PTASK_H
+
+#include <stdint.h>
+
+#include "msg.h"
+#include "vtimer.h"
+
+#ifdef MODULE_DESTINY
+#include "destiny/socket.h"
+#endif
+
+/**
+ * @brief Messages the thread running the tasks queues
+ */
+#ifndef PTASK_MSG_QUEUE_SIZE
+#define PTASK_MSG_QUEUE_SIZE    (8)
+#endif
+
+/**
+ * @brief Message type waking the thread running the tasks
+ */
+#define PTASK_MSG_WAKE          (0x7a50)
+
+/**
+ * @brief Wait for a message of any type
+ */
+#define PTASK_MSG_ANY           (0xffff)
+
+/**
+ * @name Return values of a task function, set by the macros
+ * @{
+ */
+#define PTASK_WAITING           (0)     ///< waits for an event
+#define PTASK_YIELDED           (1)     ///< runs again in the next round
+#define PTASK_EXITED            (2)     ///< is done, ptask_start() again
+/** @} */
+
+/**
+ * @name Events a task waits for and was woken by, see ptask_t::event
+ * @{
+ */
+#define PTASK_EV_MSG            (0x01)  ///< a message, in ptask_t::msg
+#define PTASK_EV_TIMEOUT        (0x02)  ///< the timeout expired
+#define PTASK_EV_SOCKET         (0x04)  ///< the socket is ready
+#define PTASK_EV_WAKE           (0x08)  ///< ptask_wake() was called
+#define PTASK_EV_COND           (0x10)  ///< the condition may hold
+/** @} */
+
+struct ptask;
+
+/**
+ * @brief Function of a task, returns through the macros only
+ */
+typedef int (*ptask_fn_t)(struct ptask *);
+
+/**
+ * @brief A task, owned by the caller
+ */
+typedef struct ptask {
+    struct ptask *next;         /**< internal, next started task */
+    ptask_fn_t fn;              /**< the function of the task */
+    void *arg;                  /**< free for the task */
+    uint16_t lc;                /**< where the task goes on, 0 at its start */
+    uint8_t wait;               /**< internal, PTASK_EV_* it waits for */
+    uint8_t event;              /**< PTASK_EV_* that woke the task */
+    volatile uint8_t woken;     /**< internal, ptask_wake() was called */
+    uint8_t started;            /**< internal */
+    uint16_t msg_type;          /**< internal, type of message waited for */
+    msg_t msg;                  /**< the message received */
+    vtimer_t timer;             /**< internal */
+    uint64_t deadline;          /**< internal, vtimer_now64() of the timeout */
+#ifdef MODULE_DESTINY
+    destiny_socket_pollfd_t poll;   /**< socket waited for, revents when ready */
+#endif
+} ptask_t;
+
+/**
+ * @brief Starts the task, only as the first statement of a task function
+ */
+#define PTASK_BEGIN(t)      switch ((t)->lc) { case 0:
+
+/**
+ * @brief Ends the task, only as the last statement of a task function
+ */
+#define PTASK_END(t)        } (t)->lc = 0; return PTASK_EXITED
+
+/**
+ * @brief Ends the task at once
+ */
+#define PTASK_EXIT(t)       do { (t)->lc = 0; return PTASK_EXITED; } while (0)
+
+/**
+ * @brief Lets the other ready tasks run first
+ */
+#define PTASK_YIELD(t)      do { (t)->lc = __LINE__; return PTASK_YIELDED; \
+                                 case __LINE__:; } while (0)
+
+/**
+ * @brief Waits for the events armed with the ptask_wait_* functions, the
+ *        one that came is in ptask_t::event, with none armed it yields
+ */
+#define PTASK_WAIT(t)       do { (t)->lc = __LINE__; return PTASK_WAITING; \
+                                 case __LINE__:; } while (0)
+
+/**
+ * @brief Waits until *cond* holds, it is tested again whenever another
+ *        task ran or an event came in
+ */
+#define PTASK_WAIT_UNTIL(t, cond) \
+    do { (t)->lc = __LINE__; case __LINE__: \
+        if (!(cond)) { ptask_wait_cond(t); return PTASK_WAITING; } } while (0)
+
+/**
+ * @brief Waits for *us* microseconds
+ */
+#define PTASK_SLEEP(t, us) \
+    do { ptask_wait_timeout((t), (us)); PTASK_WAIT(t); } while (0)
+
+/**
+ * @brief Waits for a message of *type*, it is in ptask_t::msg then
+ */
+#define PTASK_RECEIVE(t, type) \
+    do { ptask_wait_msg((t), (type)); PTASK_WAIT(t); } while (0)
+
+/**
+ * @brief Waits for socket *s* to report one of the DESTINY_POLL* *events*,
+ *        the ones it reports are in ptask_t::poll.revents
+ */
+#define PTASK_WAIT_SOCKET(t, s, events) \
+    do { ptask_wait_socket((t), (s), (events)); PTASK_WAIT(t); } while (0)
+
+/**
+ * @brief Prepares *t*, which must not be started
+ *
+ * @param t     the task
+ * @param fn    its function
+ * @param arg   stored in t->arg
+ */
+void ptask_init(ptask_t *t, ptask_fn_t fn, void *arg);
+
+/**
+ * @brief Adds *t* to the tasks ptask_run() runs, from any thread
+ *
+ * An exited task may be started again, it begins anew.
+ *
+ * @return 0 on success, -1 if *t* runs already
+ */
+int ptask_start(ptask_t *t);
+
+/**
+ * @brief Runs the started tasks in the calling thread, never returns
+ *
+ * Only one thread may run tasks.
+ */
+void ptask_run(void);
+
+/**
+ * @brief Gets the thread running the tasks, to send their messages to
+ *
+ * @return the pid, -1 if ptask_run() was not called yet
+ */
+int ptask_getpid(void);
+
+/**
+ * @brief Wakes *t* from its wait with PTASK_EV_WAKE, from any thread or
+ *        interrupt
+ */
+void ptask_wake(ptask_t *t);
+
+/**
+ * @brief Lets the next PTASK_WAIT() of *t* end on a message of *type*
+ *
+ * @param t     the task
+ * @param type  the message type, PTASK_MSG_ANY for all
+ */
+void ptask_wait_msg(ptask_t *t, uint16_t type);
+
+/**
+ * @brief Lets the next PTASK_WAIT() of *t* end after *us* microseconds
+ */
+void ptask_wait_timeout(ptask_t *t, uint32_t us);
+
+/**
+ * @brief Lets the next PTASK_WAIT() of *t* end once the tasks ran or an
+ *        event came in, for PTASK_WAIT_UNTIL()
+ */
+void ptask_wait_cond(ptask_t *t);
+
+#ifdef MODULE_DESTINY
+/**
+ * @brief Lets the next PTASK_WAIT() of *t* end when socket *s* reports one
+ *        of *events*, the task thread becomes its receiving thread
+ */
+void ptask_wait_socket(ptask_t *t, int s, uint8_t events);
+#endif
+
+/** @} */
+#endif /* __PTASK_H */
@@ -0,0 +1,117 @@
+/**
+ * Early frame filter for radio drivers
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup transceiver
+ * @{
+ * @file    filter.h
+ * @brief   Frame acceptance filter shared by the radio drivers.
+ * @details A driver checks the first bytes of a frame against its filter
+ *          before it reads the rest from the radio. Frames from ignored
+ *          senders, for other PANs or addresses and of unwanted types are
+ *          dropped without transferring the payload over SPI.
+ * @}
+ */
+
+#ifndef RADIO_FILTER_H
+#define RADIO_FILTER_H
+
+#include <stdint.h>
+
+#include "radio/types.h"
+
+/**
+ * @brief   Size of the ignore set as a power of two.
+ */
+#ifndef RADIO_FILTER_IGNORE_BITS
+#define RADIO_FILTER_IGNORE_BITS    (4)
+#endif
+
+/**
+ * @brief   Number of senders that can be ignored at the same time.
+ */
+#define RADIO_FILTER_IGNORE_SIZE    (1 << RADIO_FILTER_IGNORE_BITS)
+
+/**
+ * @brief   PAN or short address that matches every frame.
+ */
+#define RADIO_FILTER_ANY            (0xffff)
+
+/**
+ * @brief   The radio checks PAN and destination address itself.
+ */
+#define RADIO_FILTER_HW_ADDR        (0x01)
+
+/**
+ * @brief   Accept frames of IEEE 802.15.4 frame type *t*.
+ */
+#define RADIO_FILTER_TYPE(t)        (1 << (t))
+
+/**
+ * @brief   Bytes of an IEEE 802.15.4 frame needed by
+ *          radio_filter_ieee802154(): frame control, sequence number and both
+ *          PAN IDs and long addresses.
+ */
+#define RADIO_FILTER_IEEE802154_HDR_LEN (23)
+
+/**
+ * @brief   Filter state of one radio.
+ */
+typedef struct {
+    uint16_t pan;               ///< accepted destination PAN or RADIO_FILTER_ANY
+    radio_address_t addr;       ///< accepted short destination or RADIO_FILTER_ANY
+    uint8_t frame_types;        ///< RADIO_FILTER_TYPE() mask of accepted types
+    uint8_t flags;              ///< RADIO_FILTER_HW_ADDR if done by the radio
+    uint8_t monitor;            ///< accept all PANs and addresses
+    uint8_t ignored_numof;      ///< number of entries in *ignored*
+    radio_address_t ignored[RADIO_FILTER_IGNORE_SIZE];  ///< hashed ignore set, 0 marks a free entry
+} radio_filter_t;
+
+/**
+ * @brief   Initializes *filter* to accept beacon, data and MAC command
+ *          frames for any PAN and address from all senders.
+ */
+void radio_filter_init(radio_filter_t *filter, uint8_t flags);
+
+/**
+ * @brief   Adds *addr* to the senders ignored by *filter*.
+ *
+ * @return  Index of the entry, -1 if the ignore set is full.
+ */
+int16_t radio_filter_ignore_add(radio_filter_t *filter, radio_address_t addr);
+
+/**
+ * @brief   Removes all senders from the ignore set of *filter*.
+ */
+void radio_filter_ignore_clear(radio_filter_t *filter);
+
+/**
+ * @brief   Checks whether frames from *addr* are ignored by *filter*.
+ */
+int radio_filter_is_ignored(const radio_filter_t *filter, radio_address_t addr);
+
+/**
+ * @brief   Length of the IEEE 802.15.4 MAC header up to the source address,
+ *          as given by its frame control field *fcf* (2 bytes).
+ */
+uint8_t radio_filter_ieee802154_hdr_len(const uint8_t *fcf);
+
+/**
+ * @brief   Checks the header of an IEEE 802.15.4 frame against *filter*.
+ *
+ * @param[in] filter    The filter of the receiving radio.
+ * @param[in] hdr       The frame, starting with the frame control field.
+ * @param[in] len       Number of bytes available at *hdr*.
+ *
+ * @return  1 if the frame has to be read and delivered, 0 if it can be
+ *          dropped.
+ */
+int radio_filter_ieee802154(const radio_filter_t *filter, const uint8_t *hdr,
+                            uint8_t len);
+
+#endif /* RADIO_FILTER_H */
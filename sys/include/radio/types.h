@@ -72,7 +72,7 @@ typedef struct __attribute__((packed))
     uint16_t dst;           ///< Radio destination address
     uint8_t rssi;           ///< Radio Signal Strength Indication
     uint8_t lqi;            ///< Link Quality Indicator
-    timex_t toa;            ///< Time of Arrival
+    timex_t toa;            ///< Time of Arrival, as vtimer_now()
     radio_packet_length_t length;         ///< Length of payload
     uint8_t *data;          ///< Payload
 }
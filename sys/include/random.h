@@ -3,6 +3,11 @@
  * @defgroup    sys_random Random
  * @ingroup     sys
  * @brief       Random number generator
+ *
+ * The default backend is the Mersenne Twister MT19937 with 2.5 KB of
+ * state.  `USEMODULE += random_xorshift` selects xoshiro128** instead,
+ * which keeps 16 bytes of state and takes the same short time for every
+ * number.
  */
 
 #include <inttypes.h>
@@ -12,7 +17,7 @@
 #endif
 
 /**
- * @brief initializes mt[N] with a seed
+ * @brief initializes the state of the PRNG with a seed
  *
  * @param s seed for the PRNG
  */
@@ -35,6 +40,17 @@ void genrand_init_by_array(uint32_t init_key[], int key_length);
  */
 uint32_t genrand_uint32(void);
 
+/**
+ * @brief mixes a sample of hardware noise into the state of the PRNG
+ *
+ * The transceiver hands in the signal strength and the arrival time of
+ * every received packet.  Boards with other sources of noise may call it
+ * as well, e.g. with the RSSI of an idle channel.
+ *
+ * @param sample value with some bits of entropy
+ */
+void genrand_add_entropy(uint32_t sample);
+
 
 #if PRNG_FLOAT
 /* These real versions are due to Isaku Wada, 2002/01/09 added */
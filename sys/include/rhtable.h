@@ -0,0 +1,149 @@
+/**
+ * Fixed capacity Robin Hood hash table
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_lib
+ * @{
+ * @file   rhtable.h
+ * @brief  Open addressing hash table on caller provided storage
+ *
+ * Unlike hashtable.h nothing is allocated: the slots are given to
+ * rhtable_init(), insertions never rehash and fail once the table is full.
+ * Robin Hood probing keeps lookups short up to high load factors, removal
+ * shifts the following entries back instead of leaving tombstones.
+ *
+ * Keys are hashed and compared as raw bytes, struct keys must not contain
+ * uninitialized padding.
+ *
+ * Typical use with typed wrappers:
+ *
+ *     RHTABLE_STORAGE(nbr, 32, ipv6_addr_t, nbr_entry_t);
+ *     RHTABLE_FUNCTIONS(nbr, ipv6_addr_t, nbr_entry_t);
+ *     static rhtable_t nbr_table;
+ *
+ *     RHTABLE_INIT(&nbr_table, nbr, NULL);
+ *     nbr_insert(&nbr_table, &addr, &entry);
+ *     nbr_entry_t *e = nbr_search(&nbr_table, &addr);
+ * @}
+ */
+
+#ifndef __RHTABLE_H
+#define __RHTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Hash function over the key bytes
+ */
+typedef uint32_t (*rhtable_hash_t)(const void *key, size_t len);
+
+typedef struct rhtable {
+    uint8_t *slots;             /**< capacity slots of slot_size bytes */
+    uint8_t *psl;               /**< probe sequence length + 1, 0 if free */
+    rhtable_hash_t hash;        /**< hash of the keys, FNV-1a if NULL */
+    uint16_t capacity;          /**< number of slots */
+    uint16_t count;             /**< number of entries */
+    uint16_t slot_size;         /**< bytes per slot, key and value */
+    uint8_t key_size;           /**< bytes of the key at the slot start */
+    uint8_t value_offset;       /**< offset of the value in a slot */
+    uint8_t value_size;         /**< bytes of the value */
+} rhtable_t;
+
+/**
+ * Declares static storage *name*_slots and *name*_psl for *capacity*
+ * entries of *keytype* and *valuetype*
+ */
+#define RHTABLE_STORAGE(name, capacity, keytype, valuetype)             \
+    struct name##_rhslot {                                              \
+        keytype key;                                                    \
+        valuetype value;                                                \
+    };                                                                  \
+    static struct name##_rhslot name##_slots[capacity];                 \
+    static uint8_t name##_psl[capacity]
+
+/**
+ * Initializes *table* on the storage of RHTABLE_STORAGE(*name*, ...)
+ */
+#define RHTABLE_INIT(table, name, hash)                                 \
+    rhtable_init((table), name##_slots, name##_psl,                     \
+                 sizeof(name##_psl), sizeof(struct name##_rhslot),      \
+                 sizeof(((struct name##_rhslot *) 0)->key),             \
+                 offsetof(struct name##_rhslot, value),                 \
+                 sizeof(((struct name##_rhslot *) 0)->value), (hash))
+
+/**
+ * Defines typed *name*_insert(), *name*_search() and *name*_remove()
+ */
+#define RHTABLE_FUNCTIONS(name, keytype, valuetype)                     \
+    static inline valuetype *name##_insert(rhtable_t *t,                \
+                                           const keytype *k,            \
+                                           const valuetype *v)          \
+    {                                                                   \
+        return (valuetype *) rhtable_insert(t, k, v);                   \
+    }                                                                   \
+    static inline valuetype *name##_search(const rhtable_t *t,          \
+                                           const keytype *k)            \
+    {                                                                   \
+        return (valuetype *) rhtable_search(t, k);                      \
+    }                                                                   \
+    static inline int name##_remove(rhtable_t *t, const keytype *k,     \
+                                    valuetype *v)                       \
+    {                                                                   \
+        return rhtable_remove(t, k, v);                                 \
+    }
+
+/**
+ * Initializes an empty table
+ *
+ * @param table         the table
+ * @param slots         storage of capacity * slot_size bytes
+ * @param psl           storage of capacity bytes
+ * @param capacity      number of slots
+ * @param slot_size     size of one slot
+ * @param key_size      size of the key, stored at the start of a slot
+ * @param value_offset  offset of the value in a slot
+ * @param value_size    size of the value
+ * @param hash          hash function, NULL for FNV-1a
+ */
+void rhtable_init(rhtable_t *table, void *slots, uint8_t *psl,
+                  uint16_t capacity, uint16_t slot_size, uint8_t key_size,
+                  uint8_t value_offset, uint8_t value_size,
+                  rhtable_hash_t hash);
+
+/**
+ * Inserts *key* with *value* or replaces the value of *key*
+ *
+ * Pointers returned by earlier calls become invalid, entries move.
+ *
+ * @param value may be NULL to leave the value uninitialized
+ * @return the stored value, NULL if the table is full
+ */
+void *rhtable_insert(rhtable_t *table, const void *key, const void *value);
+
+/**
+ * Finds *key*
+ *
+ * @return the stored value, NULL if *key* is not in the table
+ */
+void *rhtable_search(const rhtable_t *table, const void *key);
+
+/**
+ * Removes *key*
+ *
+ * @param value receives the removed value if not NULL
+ * @return 0 on success, -1 if *key* is not in the table
+ */
+int rhtable_remove(rhtable_t *table, const void *key, void *value);
+
+/**
+ * Removes all entries
+ */
+void rhtable_clear(rhtable_t *table);
+
+#endif /* __RHTABLE_H */
@@ -24,12 +24,32 @@ typedef struct ringbuffer {
     unsigned int        end;
     unsigned int        size;
     unsigned int        avail;
+    unsigned int        mask;       /* size - 1 for power of two sizes, else 0 */
+    unsigned int        overflow;   /* oldest elements dropped to make room */
 } ringbuffer_t;
 
 void ringbuffer_init(ringbuffer_t *rb, char *buffer, unsigned int bufsize);
+/* adding to a full ringbuffer drops the oldest elements, see overflow */
 void rb_add_element(ringbuffer_t *rb, char c);
 void rb_add_elements(ringbuffer_t *rb, char *buf, int n);
 int rb_get_element(ringbuffer_t *rb);
 int rb_get_elements(ringbuffer_t *rb, char *buf, int n);
+/* like rb_get_element(s)() but the elements stay in the ringbuffer */
+int rb_peek_element(ringbuffer_t *rb);
+int rb_peek_elements(ringbuffer_t *rb, char *buf, int n);
+/* points *region to the oldest elements and returns how many of them are
+ * contiguous, rb_skip_elements() removes them once they are consumed */
+unsigned int rb_get_region(ringbuffer_t *rb, char **region);
+void rb_skip_elements(ringbuffer_t *rb, unsigned int n);
+/* points *region to the free space behind the stored elements and returns
+ * its contiguous size, rb_commit_elements() makes what is filled in
+ * available */
+unsigned int rb_put_region(ringbuffer_t *rb, char **region);
+/* writes n bytes offset bytes behind the stored ones without making them
+ * available yet, they must fit into the free space */
+void rb_write_elements(ringbuffer_t *rb, unsigned int offset, const char *buf,
+                       unsigned int n);
+/* makes n bytes written by rb_write_elements() available */
+void rb_commit_elements(ringbuffer_t *rb, unsigned int n);
 
 #endif /* __RINGBUFFER_H */
@@ -0,0 +1,210 @@
+/**
+ * Scheduled sensor sampling with batching and decimation
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_sampler Sampler
+ * @ingroup     sys
+ * @brief       One thread and one timer reading all sensors of a node
+ *
+ * Every sensor is a ::sampler_source_t with a period.  Periods count from
+ * the same start, so sources with periods that divide each other are read
+ * in the same wake up; a source due within SAMPLER_SLACK is read early to
+ * join a wake up as well.  Optionally every *decimate* readings are reduced
+ * to one value, their average, minimum or maximum.  The values are
+ * collected into a record of SAMPLER_BATCH values, and only a full record
+ * is handed to the source's callback, e.g. to send it in one packet.
+ *
+ * Reads run on the sampler thread, so drivers that busy wait like sht11
+ * only delay other sensors, never the caller.  Adapters for sht11, ltc4150
+ * and lm75a are built along with these modules:
+ *
+ *     static sampler_source_t temp;
+ *
+ *     sampler_init();
+ *     sampler_source_init(&temp, 1, sampler_sht11_temperature, NULL,
+ *                         10000000, 6, SAMPLER_AVG, send_record, NULL);
+ *     sampler_add(&temp);
+ *
+ * @{
+ * @file        sampler.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __SAMPLER_H
+#define __SAMPLER_H
+
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * @brief Values in a record
+ */
+#ifndef SAMPLER_BATCH
+#define SAMPLER_BATCH           (8)
+#endif
+
+/**
+ * @brief Time in us a source is read early to share a wake up
+ */
+#ifndef SAMPLER_SLACK
+#define SAMPLER_SLACK           (20000)
+#endif
+
+/**
+ * @brief Stack size of the sampler thread, reads and callbacks run on it
+ */
+#ifndef SAMPLER_STACKSIZE
+#define SAMPLER_STACKSIZE       (KERNEL_CONF_STACKSIZE_MAIN)
+#endif
+
+/**
+ * @brief Thread priority of the sampler
+ */
+#ifndef SAMPLER_PRIORITY
+#define SAMPLER_PRIORITY        (PRIORITY_MAIN - 1)
+#endif
+
+/**
+ * @brief How readings are reduced to a value
+ */
+typedef enum {
+    SAMPLER_AVG,                    /**< average of the readings */
+    SAMPLER_MIN,                    /**< smallest reading */
+    SAMPLER_MAX,                    /**< largest reading */
+    SAMPLER_LAST,                   /**< latest reading only */
+} sampler_reduce_t;
+
+/**
+ * @brief A batch of values of one source
+ */
+typedef struct {
+    uint8_t id;                     /**< id of the source */
+    uint8_t count;                  /**< values in *values* */
+    uint32_t time;                  /**< vtimer_now64() of the first value
+                                         in ms */
+    uint32_t period;                /**< us between two values */
+    int32_t values[SAMPLER_BATCH];  /**< the values, oldest first */
+} sampler_record_t;
+
+struct sampler_source;
+
+/**
+ * @brief Reads a sensor
+ *
+ * @return 0 on success, -1 if there is no reading this time
+ */
+typedef int (*sampler_read_t)(void *arg, int32_t *value);
+
+/**
+ * @brief Gets a full record, it is reused once the callback returns
+ *
+ * Must not call functions of the sampler.
+ */
+typedef void (*sampler_deliver_t)(const sampler_record_t *record, void *arg);
+
+/**
+ * @brief A sensor to be sampled, owned by the caller
+ */
+typedef struct sampler_source {
+    struct sampler_source *next;    /**< internal */
+    sampler_read_t read;            /**< reads the sensor */
+    void *read_arg;                 /**< passed to *read* */
+    sampler_deliver_t deliver;      /**< gets full records */
+    void *deliver_arg;              /**< passed to *deliver* */
+    uint32_t period;                /**< us between two readings */
+    uint64_t due;                   /**< internal, next reading */
+    uint8_t decimate;               /**< readings per value */
+    sampler_reduce_t reduce;        /**< how readings become a value */
+    uint8_t readings;               /**< internal */
+    int64_t acc;                    /**< internal */
+    sampler_record_t record;        /**< internal, being filled */
+} sampler_source_t;
+
+/**
+ * @brief Starts the sampler thread, further calls do nothing
+ *
+ * @return PID of the thread, -1 on error
+ */
+int sampler_init(void);
+
+/**
+ * @brief Prepares a source
+ *
+ * @param source        the source
+ * @param id            copied into its records
+ * @param read          reads the sensor
+ * @param read_arg      passed to *read*
+ * @param period        us between two readings
+ * @param decimate      readings per value, 1 keeps every reading
+ * @param reduce        how *decimate* readings become a value
+ * @param deliver       gets every full record
+ * @param deliver_arg   passed to *deliver*
+ */
+void sampler_source_init(sampler_source_t *source, uint8_t id,
+                         sampler_read_t read, void *read_arg,
+                         uint32_t period, uint8_t decimate,
+                         sampler_reduce_t reduce, sampler_deliver_t deliver,
+                         void *deliver_arg);
+
+/**
+ * @brief Starts sampling *source*, the first reading is at its next period
+ *
+ * @return 0 on success, -1 if the source is sampled already
+ */
+int sampler_add(sampler_source_t *source);
+
+/**
+ * @brief Stops sampling *source*, values not yet delivered are dropped
+ *
+ * Must not be called from a callback of the sampler.
+ *
+ * @return 0 on success, -1 if the source was not sampled
+ */
+int sampler_remove(sampler_source_t *source);
+
+/**
+ * @brief Hands the values of *source* collected so far to its callback
+ *
+ * The record may hold fewer than SAMPLER_BATCH values, or none.  The
+ * callback runs on the calling thread.
+ */
+void sampler_flush(sampler_source_t *source);
+
+#ifdef MODULE_SHT11
+/**
+ * @brief Temperature in 1/100 °C of the sht11, *arg* is unused
+ */
+int sampler_sht11_temperature(void *arg, int32_t *value);
+
+/**
+ * @brief Temperature compensated relative humidity in 1/100 %, *arg* is
+ *        unused
+ */
+int sampler_sht11_humidity(void *arg, int32_t *value);
+#endif
+
+#ifdef MODULE_LTC4150
+/**
+ * @brief Average current since the last reading in uA, *arg* is unused
+ *
+ * Derived from the coulomb counter, so no reading is missed in between.
+ * ltc4150_start() has to be called before.
+ */
+int sampler_ltc4150_current(void *arg, int32_t *value);
+#endif
+
+#ifdef MODULE_LM75A
+/**
+ * @brief Temperature in 1/100 °C of the lm75a, *arg* is unused
+ */
+int sampler_lm75a_temperature(void *arg, int32_t *value);
+#endif
+
+/** @} */
+#endif /* __SAMPLER_H */
@@ -19,6 +19,15 @@
 
 #include "attributes.h"
 
+/**
+ * @brief           Slots of the command index of a shell session, a power of two.
+ * @details         The index takes up to SHELL_INDEX_SIZE - 1 commands,
+ *                  with more commands the shell searches the lists linearly.
+ */
+#ifndef SHELL_INDEX_SIZE
+#define SHELL_INDEX_SIZE    (64)
+#endif
+
 /**
  * @brief           Protype of a shell callback handler.
  * @details         The functions supplied to shell_init() must use this signature.
@@ -56,6 +65,8 @@ typedef struct shell_t {
     uint16_t shell_buffer_size;
     int (*readchar)(void);
     void (*put_char)(int);
+    uint8_t indexed;                    /**< the index holds all commands */
+    uint8_t index[SHELL_INDEX_SIZE];    /**< commands hashed by their name */
 } shell_t;
 
 /**
@@ -84,4 +95,14 @@ void shell_init(shell_t *shell,
  */
 void shell_run(shell_t *shell) NORETURN;
 
+/**
+ * @brief           Executes a script of commands without prompting or echoing.
+ * @details         Lines are separated by `\n` or `\r`,
+ *                  empty lines and lines starting with `#` are skipped.
+ *                  Use it e.g. to provision a node with many commands at once.
+ * @param[in]       shell   The session that was previously initialized with shell_init().
+ * @param[in,out]   script  Null-terminated script, it is modified during execution.
+ */
+void shell_run_script(shell_t *shell, char *script);
+
 #endif /* __SHELL_H */
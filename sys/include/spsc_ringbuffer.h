@@ -0,0 +1,47 @@
+/**
+ * Single producer, single consumer ringbuffer header
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_lib
+ * @{
+ * @file   spsc_ringbuffer.h
+ * @brief  Ringbuffer shared by one producer and one consumer, e.g. an ISR
+ *         and a thread, without disabling interrupts
+ *
+ * The producer only writes head, the consumer only writes tail, and each
+ * publishes its index with atomic_set_return() after copying the data.
+ * Both indices run freely, so the size must be a power of two.  Unlike
+ * ringbuffer_t a full buffer drops the newest elements, the producer may
+ * not touch the oldest ones.
+ * @}
+ */
+
+#ifndef __SPSC_RINGBUFFER_H
+#define __SPSC_RINGBUFFER_H
+
+typedef struct spsc_ringbuffer {
+    char *buf;
+    unsigned int            mask;       /* size - 1 */
+    volatile unsigned int   head;       /* written by the producer */
+    volatile unsigned int   tail;       /* written by the consumer */
+    unsigned int            overflow;   /* elements dropped by the producer */
+} spsc_ringbuffer_t;
+
+/* bufsize must be a power of two */
+void spsc_rb_init(spsc_ringbuffer_t *rb, char *buffer, unsigned int bufsize);
+/* producer: adds up to n elements, returns how many fit */
+unsigned int spsc_rb_put(spsc_ringbuffer_t *rb, const char *buf, unsigned int n);
+/* consumer: removes up to n elements, returns how many were stored */
+unsigned int spsc_rb_get(spsc_ringbuffer_t *rb, char *buf, unsigned int n);
+
+static inline unsigned int spsc_rb_avail(spsc_ringbuffer_t *rb)
+{
+    return rb->head - rb->tail;
+}
+
+#endif /* __SPSC_RINGBUFFER_H */
@@ -0,0 +1,67 @@
+/**
+ * Stack high-water monitor
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_stackmon Stack monitor
+ * @ingroup     sys
+ * @brief       Records the stack usage of all threads to right-size stacks
+ *
+ * Every STACKMON_INTERVAL the workqueue samples the painted stack of every
+ * thread and keeps the largest usage per stack buffer, also after the
+ * thread exited.  "ps stack" prints the records together with a suggested
+ * size, the usage plus STACKMON_MARGIN percent.  Only stacks of threads
+ * created with CREATE_STACKTEST can be measured.
+ *
+ * @{
+ * @file        stackmon.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __STACKMON_H
+#define __STACKMON_H
+
+/**
+ * @brief Microseconds between two samples
+ */
+#ifndef STACKMON_INTERVAL
+#define STACKMON_INTERVAL   (500000)
+#endif
+
+/**
+ * @brief Stack buffers recorded
+ */
+#ifndef STACKMON_RECORDS
+#define STACKMON_RECORDS    (MAXTHREADS + 4)
+#endif
+
+/**
+ * @brief Head room in percent of the usage added to a suggested size
+ */
+#ifndef STACKMON_MARGIN
+#define STACKMON_MARGIN     (25)
+#endif
+
+/**
+ * @brief Starts sampling the stacks periodically
+ *
+ * @return 0 on success, -1 if the workqueue could not be started
+ */
+int stackmon_init(void);
+
+/**
+ * @brief Samples the stacks of all threads now
+ */
+void stackmon_sample(void);
+
+/**
+ * @brief Prints the recorded usage and suggested size of every stack
+ */
+void stackmon_print_report(void);
+
+/** @} */
+#endif /* __STACKMON_H */
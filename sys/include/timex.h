@@ -55,6 +55,43 @@ int timex_isnormalized(timex_t *time);
  */
 uint64_t timex_uint64(const timex_t a);
 
+/**
+ * @brief Divides a uint64_t by a 16 bit divisor with 32 bit divisions only
+ *
+ * Cheaper than the generic 64 bit division on 16 and 32 bit cores, the
+ * compiler turns divisions by a constant into multiplications.
+ * The quotient must fit into 32 bits, i.e. n < d * 2^32.
+ *
+ * @param[in]  n    dividend
+ * @param[in]  d    divisor
+ * @param[out] rem  remainder, may be NULL
+ *
+ * @return n / d
+ */
+static inline uint32_t timex_udiv64(uint64_t n, uint16_t d, uint16_t *rem)
+{
+    /* long division in base 2^16, every step fits into 32 bits */
+    uint32_t r = (uint32_t) (n >> 32);
+    uint32_t step = (r << 16) | ((uint32_t) n >> 16);
+    uint32_t q = step / d;
+
+    r = ((step % d) << 16) | ((uint32_t) n & 0xffff);
+    q = (q << 16) | (r / d);
+
+    if (rem) {
+        *rem = r % d;
+    }
+
+    return q;
+}
+
+/**
+ * @brief Converts a uint64_t of microseconds to a normalized timex_t
+ *
+ * @return timex representation of *timestamp*
+ */
+timex_t timex_from_uint64(const uint64_t timestamp);
+
 /**
  * @brief Prints a timex_t
  */
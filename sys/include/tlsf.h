@@ -0,0 +1,139 @@
+/**
+ * Two-level segregated fit allocator
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_tlsf TLSF
+ * @ingroup     sys
+ * @brief       General purpose allocator with O(1) malloc and free
+ *
+ * Free blocks are kept in lists by size class: the first level splits
+ * sizes by powers of two, the second level splits each of those into 16
+ * ranges.  Two bitmaps tell which lists hold a block, so a fitting block
+ * is found with two bit scans and a freed block is merged with its free
+ * neighbors in constant time.  The time to allocate does not depend on
+ * the number or the layout of the blocks, unlike the search of newlib's
+ * malloc.
+ *
+ * Memory is given to the allocator with tlsf_add_pool().
+ * `USEMODULE += tlsf_malloc` makes it the system allocator: malloc() and
+ * friends, including the reentrant versions newlib uses internally, are
+ * served by TLSF, which takes its pools from sbrk() in steps of
+ * TLSF_MALLOC_GROW bytes.
+ *
+ * Every block remembers the thread that allocated it, so the bytes each
+ * thread holds can be shown with the `tlsf` shell command.
+ *
+ * @{
+ * @file        tlsf.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __TLSF_H
+#define __TLSF_H
+
+#include <stddef.h>
+
+#include "sched.h"
+
+/**
+ * @brief Blocks are smaller than 2^TLSF_FL_MAX bytes, at most 24
+ */
+#ifndef TLSF_FL_MAX
+#define TLSF_FL_MAX         (20)
+#endif
+
+/**
+ * @brief Bytes of a pool taken by the allocator itself, at most
+ */
+#define TLSF_POOL_OVERHEAD  (5 * sizeof(void *))
+
+/**
+ * @brief Bytes requested from sbrk() whenever the system allocator runs
+ *        out of memory, larger requests take what they need
+ */
+#ifndef TLSF_MALLOC_GROW
+#define TLSF_MALLOC_GROW    (4096)
+#endif
+
+/**
+ * @brief Allocations of a thread
+ */
+typedef struct {
+    size_t used;            /**< bytes currently allocated */
+    size_t peak;            /**< high-water mark of *used* */
+    unsigned int allocs;    /**< successful allocations */
+    unsigned int fails;     /**< allocations that found no block */
+} tlsf_stats_t;
+
+/**
+ * @brief State of the free memory
+ */
+typedef struct {
+    size_t pool;            /**< bytes of all pools */
+    size_t free;            /**< bytes in free blocks */
+    size_t largest;         /**< largest free block */
+    unsigned int blocks;    /**< number of free blocks */
+} tlsf_frag_t;
+
+/**
+ * @brief   Adds memory to allocate from
+ *
+ * @param[in] mem       start of the memory
+ * @param[in] bytes     size of the memory
+ *
+ * @return  0 on success, -1 if it is too small
+ */
+int tlsf_add_pool(void *mem, size_t bytes);
+
+/**
+ * @brief   Allocates a block of at least *size* bytes
+ * @return  Pointer to the block, NULL if out of memory or *size* is 0
+ */
+void *tlsf_malloc(size_t size);
+
+/**
+ * @brief   Allocates a zeroed block of at least *num* * *size* bytes
+ * @return  Pointer to the block, NULL if out of memory
+ */
+void *tlsf_calloc(size_t num, size_t size);
+
+/**
+ * @brief   Resizes a block, in place if its free neighbor allows
+ * @return  Pointer to the resized block, NULL if out of memory (*ptr* stays
+ *          valid in this case) or if *size* is 0 (*ptr* is freed)
+ */
+void *tlsf_realloc(void *ptr, size_t size);
+
+/**
+ * @brief   Returns a block obtained by one of the allocation functions
+ * @param[in] ptr   the block, may be NULL
+ */
+void tlsf_free(void *ptr);
+
+/**
+ * @brief   Gets the allocations of a thread
+ * @param[in] pid   the thread, MAXTHREADS for allocations made before the
+ *                  scheduler ran
+ * @return  Pointer to the statistics, NULL if *pid* is invalid
+ */
+const tlsf_stats_t *tlsf_get_stats(unsigned int pid);
+
+/**
+ * @brief   Walks the free blocks, takes time linear in their number
+ * @param[out] frag     the state of the free memory
+ */
+void tlsf_get_frag(tlsf_frag_t *frag);
+
+/**
+ * @brief   Prints the allocations per thread and the fragmentation of the
+ *          free memory to stdout
+ */
+void tlsf_print_stats(void);
+
+/** @} */
+#endif /* __TLSF_H */
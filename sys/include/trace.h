@@ -0,0 +1,114 @@
+/**
+ * Binary event tracer
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_trace Event tracer
+ * @ingroup     sys
+ * @brief       Records timestamped events of the hot paths into a RAM ring
+ *
+ * TRACE() stores a record of fixed size with the hwtimer time, the event,
+ * the running thread and an argument.  Nothing is formatted or printed
+ * and interrupts are disabled for a few instructions only, so tracing
+ * hardly changes the timing of the code under test, unlike DEBUG().  The
+ * newest TRACE_SIZE records are kept.
+ *
+ * trace_dump() prints the ring as text lines starting with "TRACE", the
+ * decoder in dist/tools/trace turns a terminal log or the output of a
+ * native instance into a readable time line.
+ *
+ * Without the trace module TRACE() expands to nothing.
+ *
+ * @{
+ * @file        trace.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Records kept, a power of two
+ */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE          (256)
+#endif
+
+/**
+ * @brief pid recorded for events in interrupt context
+ */
+#define TRACE_PID_ISR       (0xff)
+
+/**
+ * @brief Events of the trace points in RIOT, the argument in brackets
+ *
+ * Numbers from TRACE_USER on are free for applications.  The decoder
+ * knows the names of these, keep dist/tools/trace in sync.
+ */
+enum {
+    TRACE_SCHED_SWITCH = 1,     ///< context switch [pid of the new thread]
+    TRACE_MSG_SEND,             ///< msg_send() [target pid]
+    TRACE_MSG_SEND_INT,         ///< msg_send_int() [target pid]
+    TRACE_MSG_RECEIVE,          ///< message received [sender pid]
+    TRACE_MSG_DROP,             ///< message not delivered [target pid]
+    TRACE_TRANSCEIVER_RX,       ///< packet got a receive slot [slot]
+    TRACE_TRANSCEIVER_NO_SLOT,  ///< packet lost, no free slot [0]
+    TRACE_TRANSCEIVER_RELEASE,  ///< receive slot free again [slot]
+    TRACE_LOWPAN_RX,            ///< frame passed to 6LoWPAN [length]
+    TRACE_LOWPAN_DELIVER,       ///< datagram passed to IPv6 [length]
+    TRACE_LOWPAN_TIMEOUT,       ///< reassembly timed out [tag]
+    TRACE_LOWPAN_TX,            ///< datagram sent [length]
+    TRACE_USER = 0x80           ///< first application event
+};
+
+/**
+ * @brief One record, as kept in the ring
+ */
+typedef struct {
+    uint32_t time;              ///< hwtimer ticks
+    uint8_t event;              ///< event number
+    uint8_t pid;                ///< running thread or TRACE_PID_ISR
+    uint16_t arg;               ///< event argument
+} trace_record_t;
+
+#ifdef MODULE_TRACE
+/**
+ * @brief Records *event* with argument *arg*
+ */
+#define TRACE(event, arg)   trace_record((event), (arg))
+#else
+#define TRACE(event, arg)   ((void) (event), (void) (arg))
+#endif
+
+/**
+ * @brief Adds a record to the ring, use TRACE() instead.  Safe to call
+ *        from interrupt context.
+ */
+void trace_record(uint8_t event, uint16_t arg);
+
+/**
+ * @brief Starts or stops recording, it is on from boot on.  Stopping
+ *        right after an error keeps the events leading to it.
+ */
+void trace_enable(int on);
+
+/**
+ * @brief Discards all records
+ */
+void trace_clear(void);
+
+/**
+ * @brief Prints the records, oldest first, for the decoder
+ *
+ * Recording is stopped while printing.
+ */
+void trace_dump(void);
+
+/** @} */
+#endif /* __TRACE_H */
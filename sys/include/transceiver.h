@@ -127,6 +127,41 @@
 #define TRANSCEIVER_NATIVE      (0x10)      ///< NATIVE transceivers
 #define TRANSCEIVER_AT86RF231   (0x20)      ///< AT86RF231 transceivers
 
+/**
+ * @brief Transceivers whose radio checks every frame with a CRC of its own
+ *        and drops broken ones, no software FCS is needed for them
+ */
+#define TRANSCEIVER_HW_FCS      (TRANSCEIVER_CC1100 | TRANSCEIVER_CC2420 | \
+                                 TRANSCEIVER_MC1322X | TRANSCEIVER_AT86RF231)
+
+/**
+ * @brief Transceivers whose driver waits for the link layer acknowledgement
+ *        of a frame that asks for one and fails the send without it, the
+ *        AT86RF231 as long as its extended operating mode is on
+ */
+#define TRANSCEIVER_HW_ACK      (TRANSCEIVER_CC2420 | TRANSCEIVER_AT86RF231)
+
+/**
+ * @brief The transceiver of a build with only one driver, its functions are
+ *        then called without dispatching on the transceiver type at
+ *        runtime. Undefined with several drivers.
+ */
+#if ((defined(MODULE_CC110X_NG) || defined(MODULE_CC110X)) + \
+     defined(MODULE_CC2420) + defined(MODULE_MC1322X) + \
+     defined(MODULE_NATIVENET) + defined(MODULE_AT86RF231)) == 1
+#if defined(MODULE_CC110X_NG) || defined(MODULE_CC110X)
+#define TRANSCEIVER_SINGLE      (TRANSCEIVER_CC1100)
+#elif defined(MODULE_CC2420)
+#define TRANSCEIVER_SINGLE      (TRANSCEIVER_CC2420)
+#elif defined(MODULE_MC1322X)
+#define TRANSCEIVER_SINGLE      (TRANSCEIVER_MC1322X)
+#elif defined(MODULE_NATIVENET)
+#define TRANSCEIVER_SINGLE      (TRANSCEIVER_NATIVE)
+#else
+#define TRANSCEIVER_SINGLE      (TRANSCEIVER_AT86RF231)
+#endif
+#endif
+
 /**
  * @brief Data type for transceiver specification
  */
@@ -152,7 +187,10 @@ enum transceiver_msg_type_t {
     /* Message types for transceiver <-> upper layer communication */
     PKT_PENDING,    ///< packet pending in transceiver buffer
     SND_PKT,        ///< request for sending a packet
+    SND_PKT_PRIO,   ///< request for sending a packet in a priority class
     SND_ACK,        ///< request for sending an acknowledgement
+    SND_PKT_QUEUED, ///< queue a packet for sending, completion comes as TX_DONE
+    TX_DONE,        ///< a queued packet was sent or given up
     SWITCH_RX,      ///< switch transceiver to RX sate
     POWERDOWN,      ///< power down transceiver
     GET_CHANNEL,    ///< Get current channel
@@ -164,6 +202,10 @@ enum transceiver_msg_type_t {
     SET_MONITOR,    ///< Set transceiver to monitor mode (disable address checking)
     GET_PAN,        ///< Get current pan
     SET_PAN,        ///< Set a new pan
+    SWITCH_WOR,     ///< let the transceiver listen periodically by itself
+    SET_EXT_MODE,   ///< let the transceiver do CSMA/CA, ACKs and retries by itself
+    SET_CHANNELS,   ///< set the channels of multi-channel operation
+    SET_NBR_CHANNEL, ///< set the channel a neighbor listens on
 
     /* debug message types */
     DBG_IGN,        ///< add a physical address to the ignore list
@@ -179,6 +221,143 @@ enum transceiver_msg_type_t {
     UPPER_LAYER_5,  ///< reserved
 };
 
+/**
+ * @name Transmit queue
+ * @{
+ */
+/* number of packets waiting for the radio, synchronous sends included */
+#ifndef TRANSCEIVER_TX_QUEUE_SIZE
+#define TRANSCEIVER_TX_QUEUE_SIZE   (4)
+#endif
+
+/* attempts after the first one before a packet is given up */
+#ifndef TRANSCEIVER_TX_MAX_RETRIES
+#define TRANSCEIVER_TX_MAX_RETRIES  (4)
+#endif
+
+/* backoff exponents and unit of the CSMA/CA backoff (IEEE 802.15.4
+ * macMinBE, macMaxBE and aUnitBackoffPeriod at 250 kbit/s) */
+#define TRANSCEIVER_CSMA_MIN_BE     (3)
+#define TRANSCEIVER_CSMA_MAX_BE     (5)
+#define TRANSCEIVER_CSMA_UNIT_US    (320)
+
+/* priority classes of the transmit queue, a lower one goes first */
+#define TRANSCEIVER_TX_PRIO_CONTROL (0)     ///< routing and neighbor discovery
+#define TRANSCEIVER_TX_PRIO_EXPEDITED (1)   ///< alarms, latency bound traffic
+#define TRANSCEIVER_TX_PRIO_DATA    (2)     ///< everything else
+#define TRANSCEIVER_TX_PRIO_BULK    (3)     ///< traffic that may wait
+#define TRANSCEIVER_TX_PRIO_NUMOF   (4)
+
+/* tag and result of a TX_DONE message's content.value */
+#define TRANSCEIVER_TX_DONE_TAG(value)      ((uint16_t)((value) >> 16))
+#define TRANSCEIVER_TX_DONE_RESULT(value)   ((int16_t)((value) & 0xffff))
+
+/* result and number of transmissions of the reply to SND_PKT, a frame
+ * asking for an acknowledgement is sent again until it gets one */
+#define TRANSCEIVER_TX_RESULT(value)        ((int16_t)((value) & 0xffff))
+#define TRANSCEIVER_TX_ATTEMPTS(value)      ((uint8_t)((value) >> 16))
+
+/* results of a failed send a driver may tell apart, others fail with -1.
+ * A channel found busy after the radio's own CSMA/CA is not retried. */
+#define TRANSCEIVER_TX_NOACK                (-2)    ///< no acknowledgement
+#define TRANSCEIVER_TX_CHANNEL_BUSY         (-3)    ///< channel access failure
+/** @} */
+
+/**
+ * @brief Data of a SND_PKT_QUEUED command. The packet and its payload are
+ *        copied, the caller may reuse them as soon as the reply arrives.
+ *        The reply's content.value is 1 if the packet was queued and 0 if
+ *        the queue was full.
+ *
+ *        Also the data of a SND_PKT_PRIO command, which is replied to like
+ *        SND_PKT when the packet is done; its tag is not used.
+ */
+typedef struct {
+    void *packet;       ///< radio_packet_t or ieee802154_packet_t
+    uint8_t priority;   ///< TRANSCEIVER_TX_PRIO_*
+    uint16_t tag;       ///< returned with the TX_DONE message
+} transceiver_tx_request_t;
+
+/**
+ * @brief Data of a SWITCH_WOR command. The reply's content.value is 1 if
+ *        the transceiver now wakes up by itself every *interval* us to
+ *        listen for *listen* us, and 0 if it cannot; it is left as it was
+ *        then.
+ */
+typedef struct {
+    uint32_t interval;  ///< time between two wake ups in us
+    uint32_t listen;    ///< time listened after a wake up in us
+} transceiver_wor_t;
+
+/**
+ * @brief Data of a SET_EXT_MODE command. The reply's content.value is 1 if
+ *        the transceiver has such a mode and 0 if not. Retries done by the
+ *        radio are not counted by TRANSCEIVER_TX_ATTEMPTS().
+ */
+typedef struct {
+    uint8_t on;             ///< 1 to use the mode, 0 for the basic mode
+    uint8_t csma_retries;   ///< backoffs before the channel is given up
+    uint8_t frame_retries;  ///< retransmissions of an unacknowledged frame
+} transceiver_ext_mode_t;
+
+/**
+ * @name Multi-channel operation
+ *
+ * Every node listens on a home channel out of a set of channels shared by
+ * the network, and a sender switches to the channel of the receiver for a
+ * unicast frame. By default a node with the address *a* listens on
+ * channels[a % num], senders derive it the same way from the lowest 16
+ * bits of the destination; a node whose long address does not end in its
+ * short address needs a SET_NBR_CHANNEL entry at its neighbors.
+ * Broadcasts are sent on every channel of the set.
+ *
+ * The transmit queue sends frames for the current channel ahead of older
+ * ones of the same priority for other channels, up to
+ * TRANSCEIVER_CHANNEL_BATCH in a row, since every switch costs the radio
+ * its PLL settling and calibration. The radio goes back to its home
+ * channel whenever the queue is empty or waiting for a backoff.
+ * @{
+ */
+#ifndef TRANSCEIVER_CHANNELS_MAX
+#define TRANSCEIVER_CHANNELS_MAX        (16)    ///< at most 16
+#endif
+
+#ifndef TRANSCEIVER_CHANNEL_NEIGHBORS
+#define TRANSCEIVER_CHANNEL_NEIGHBORS   (8)     ///< SET_NBR_CHANNEL entries
+#endif
+
+#ifndef TRANSCEIVER_CHANNEL_BATCH
+#define TRANSCEIVER_CHANNEL_BATCH       (4)
+#endif
+
+/**
+ * @brief Data of a SET_CHANNELS command, copied.
+ */
+typedef struct {
+    const uint8_t *channels;    ///< the channel set, same order on all nodes
+    uint8_t num;                ///< 0 for single-channel operation again
+    int16_t home;               ///< own channel, -1 to derive it
+} transceiver_channels_t;
+
+/**
+ * @brief Data of a SET_NBR_CHANNEL command.
+ */
+typedef struct {
+    uint64_t addr;              ///< short address, or long address in host
+                                ///< byte order
+    uint8_t channel;            ///< 0 to derive it again
+} transceiver_nbr_channel_t;
+
+/**
+ * @brief Channel switches of a transceiver
+ */
+typedef struct {
+    uint32_t switches;          ///< channel switches
+    uint32_t switch_us;         ///< time spent on them, settling included
+    uint32_t batched;           ///< frames sent ahead of older ones
+} transceiver_channel_stats_t;
+/** @} */
+
 /**
  * @brief Manage registered threads per transceiver
  */
@@ -192,7 +371,7 @@ typedef struct {
     void *data;
 } transceiver_command_t;
 
-/* The transceiver thread's pid */
+/* The pid of the first transceiver worker thread */
 extern int transceiver_pid;
 
 /**
@@ -203,9 +382,9 @@ extern int transceiver_pid;
 void transceiver_init(transceiver_type_t transceivers);
 
 /**
- * @brief Runs the transceiver thread
+ * @brief Runs a worker thread for every initialized transceiver
  *
- * @return              The transceiver thread's pid
+ * @return              The first worker thread's pid
  */
 int transceiver_start(void);
 
@@ -219,4 +398,101 @@ int transceiver_start(void);
  */
 uint8_t transceiver_register(transceiver_type_t transceivers, int pid);
 
+/**
+ * @brief Returns the worker thread serving a transceiver. Every transceiver
+ *        gets a worker of its own, commands for it have to be sent there.
+ *
+ * @param transceivers  The transceiver type, the first one started is used if
+ *                      several are set
+ *
+ * @return              The worker's pid, -1 if none is running
+ */
+int transceiver_get_pid(transceiver_type_t transceivers);
+
+/**
+ * @brief Runs a command in the calling thread instead of sending it to the
+ *        worker, which keeps off the driver meanwhile. Saves the message
+ *        round trip for getting and setting the channel, addresses, PAN,
+ *        monitor mode and power state.
+ *
+ * @param type          The message type, not SND_PKT or SND_PKT_QUEUED
+ * @param cmd           The command, as it would be sent to the worker
+ *
+ * @return              The reply's content.value for SWITCH_WOR,
+ *                      SET_EXT_MODE, SET_CHANNELS and SET_NBR_CHANNEL, 0
+ *                      for commands with their result in
+ *                      cmd->data, (uint32_t) -1 if no worker runs for the
+ *                      transceiver or *type* is no such command
+ */
+uint32_t transceiver_config(uint16_t type, transceiver_command_t *cmd);
+
+/**
+ * @brief Copies the channel switch statistics of a transceiver
+ */
+void transceiver_get_channel_stats(transceiver_type_t transceivers,
+                                   transceiver_channel_stats_t *stats);
+
+/**
+ * @brief Receive statistics of the transceiver buffer
+ */
+typedef struct {
+    uint32_t received;      ///< packets that got a slot
+    uint32_t no_slot;       ///< packets dropped because every slot was owned
+    uint32_t not_queued;    ///< packets dropped because the transceiver
+                            ///< thread's queue was full
+    uint32_t not_delivered; ///< notifications a registered thread missed
+} transceiver_rx_stats_t;
+
+/**
+ * @brief Releases a packet passed with PKT_PENDING. Every registered thread
+ *        that got the packet owns one token of its slot and has to call
+ *        this exactly once when done with it; the slot is reused only after
+ *        all tokens are back.
+ *
+ * @param packet        The packet from the PKT_PENDING message
+ */
+void transceiver_release(void *packet);
+
+/**
+ * @brief Copies the receive statistics to *stats*
+ */
+void transceiver_get_rx_stats(transceiver_rx_stats_t *stats);
+
+/**
+ * @brief Claims a free slot of the transceiver buffer for a driver to
+ *        receive into directly. Safe to call from interrupt context.
+ *
+ * @return              The slot, -1 if every slot is still owned by upper
+ *                      layers (the drop is counted)
+ */
+int transceiver_rx_reserve(void);
+
+/**
+ * @brief Returns the packet struct of a reserved slot (radio_packet_t or
+ *        ieee802154_packet_t, depending on the transceiver)
+ */
+void *transceiver_rx_get_packet(int slot);
+
+/**
+ * @brief Returns the PAYLOAD_SIZE bytes of payload storage of a reserved slot
+ */
+uint8_t *transceiver_rx_get_payload(int slot);
+
+/**
+ * @brief Hands a filled slot to the transceiver thread, which passes it on
+ *        to the registered threads. Has to be called from interrupt
+ *        context. The slot is given back if the thread's queue is full.
+ *
+ * @param type          The driver's RCV_PKT_* message type
+ * @param slot          The slot from transceiver_rx_reserve()
+ *
+ * @return              1 on success, 0 if the packet was dropped
+ */
+int transceiver_rx_commit(uint16_t type, int slot);
+
+/**
+ * @brief Gives back a reserved slot that was not committed
+ */
+void transceiver_rx_cancel(int slot);
+
 #endif /* TRANSCEIVER_H */
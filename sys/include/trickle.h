@@ -0,0 +1,57 @@
+/**
+ * Trickle constants and prototypes
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_trickle Trickle
+ * @ingroup     sys
+ * @brief       Trickle (RFC 6206)
+ *
+ * Used by RPL for DIOs and by MPL for multicast data messages.
+ *
+ * @{
+ * @file    trickle.h
+ *
+ * A trickle_t does not own a thread. Its timer sends a message of type
+ * MSG_TIMER with the trickle_t as content to the thread given to
+ * trickle_start(), which has to pass it on to trickle_fire(). The callback
+ * then runs in that thread.
+ *
+ * @author  Eric Engel <eric.engel@fu-berlin.de>
+ */
+
+#ifndef _TRICKLE_H
+#define _TRICKLE_H
+
+#include <stdint.h>
+
+#include "vtimer.h"
+
+typedef struct {
+    uint32_t Imin;              ///< minimum interval in ms
+    uint8_t Imax;               ///< maximum number of doublings of Imin
+    uint8_t k;                  ///< redundancy constant, 0 is infinity
+    uint8_t t_over;             ///< t has passed in the current interval
+    uint16_t c;                 ///< consistent transmissions heard
+    uint32_t I;                 ///< current interval in ms, 0 if stopped
+    uint32_t t;                 ///< transmission time in the interval in ms
+    unsigned int pid;           ///< thread receiving the timer messages
+    void (*callback)(void *);   ///< transmits, called with *arg*
+    void *arg;
+    vtimer_t timer;
+} trickle_t;
+
+void trickle_start(trickle_t *trickle, unsigned int pid,
+                   void (*callback)(void *), void *arg,
+                   uint32_t Imin, uint8_t Imax, uint8_t k);
+void trickle_stop(trickle_t *trickle);
+void trickle_reset_timer(trickle_t *trickle);
+void trickle_increment_counter(trickle_t *trickle);
+void trickle_fire(trickle_t *trickle);
+
+/** @} */
+#endif /* _TRICKLE_H */
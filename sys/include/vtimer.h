@@ -24,9 +24,18 @@
 #include "queue.h"
 #include "timex.h"
 #include "msg.h"
+#include "thread_flags.h"
 
 #define MSG_TIMER 12345
 
+/**
+ * @brief   Longest timeout in seconds handed to the timed waits of the kernel
+ *          at once, see vtimer_timeout_ticks()
+ */
+#ifndef VTIMER_TIMEOUT_MAX
+#define VTIMER_TIMEOUT_MAX  (1000)
+#endif
+
 /**
  * A vtimer object.
  *
@@ -40,6 +49,9 @@ typedef struct vtimer_t {
     void(*action)(void *);
     void *arg;
     unsigned int pid;
+    uint32_t slack;         /**< microseconds the timer may fire late */
+    struct vtimer_t *prev;  /**< previous timer in the same timer list */
+    uint8_t list;           /**< timer list the timer is queued in, 0 if none */
 } vtimer_t;
 
 /**
@@ -48,6 +60,27 @@ typedef struct vtimer_t {
  */
 void vtimer_now(timex_t *out);
 
+/**
+ * @brief   Current system time in microseconds
+ *
+ * The hwtimer counter is extended to 64 bits by counting its overflows,
+ * the long term tick of the vtimer reads the clock often enough for that.
+ * Prefer this function over vtimer_now() to compute with time stamps.
+ *
+ * @return  microseconds since system boot
+ */
+uint64_t vtimer_now64(void);
+
+/**
+ * @brief   vtimer_now64() of an earlier hwtimer_now() reading, e.g. one
+ *          taken in an interrupt to stamp an event
+ *
+ * @param[in] ticks     hwtimer_now() less than half the hwtimer range ago
+ *
+ * @return  microseconds since system boot at *ticks*
+ */
+uint64_t vtimer_now64_at(unsigned long ticks);
+
 /**
  * @brief Get the current time in seconds and microseconds since system start
  * @param[in] tp    Uptime will be stored in the timeval structure pointed to by tp
@@ -81,6 +114,15 @@ int vtimer_usleep(uint32_t us);
  */
 int vtimer_sleep(timex_t time);
 
+/**
+ * @brief   same as vtimer_sleep(), but the thread may sleep up to *slack*
+ *          microseconds longer, see vtimer_set_msg_slack()
+ * @param[in]   time    timex_t with time to suspend execution
+ * @param[in]   slack   microseconds the thread may sleep longer
+ * @return      0 on success, < 0 on error
+ */
+int vtimer_sleep_slack(timex_t time, uint32_t slack);
+
 /**
  * @brief   set a vtimer with msg event handler
  * @param[in]   t           pointer to preinitialised vtimer_t
@@ -91,6 +133,24 @@ int vtimer_sleep(timex_t time);
  */
 int vtimer_set_msg(vtimer_t *t, timex_t interval, unsigned int pid, void *ptr);
 
+/**
+ * @brief   set a vtimer with msg event handler that may fire late
+ *
+ * The timer fires at some time in [interval, interval + slack], chosen so
+ * that timers of a similar deadline fire together and the MCU wakes up
+ * once for all of them.  Meant for periodic housekeeping that does not
+ * care about the exact time.
+ *
+ * @param[in]   t           pointer to preinitialised vtimer_t
+ * @param[in]   interval    vtimer timex_t interval
+ * @param[in]   slack       microseconds the timer may fire late
+ * @param[in]   pid         process id
+ * @param[in]   ptr         message value
+ * @return      0 on success, < 0 on error
+ */
+int vtimer_set_msg_slack(vtimer_t *t, timex_t interval, uint32_t slack,
+                         unsigned int pid, void *ptr);
+
 /**
  * @brief   set a vtimer with wakeup event
  * @param[in]   t           pointer to preinitialised vtimer_t
@@ -99,6 +159,29 @@ int vtimer_set_msg(vtimer_t *t, timex_t interval, unsigned int pid, void *ptr);
  */
 int vtimer_set_wakeup(vtimer_t *t, timex_t interval, int pid);
 
+/**
+ * @brief   set a vtimer with wakeup event that may fire late, see
+ *          vtimer_set_msg_slack()
+ * @param[in]   t           pointer to preinitialised vtimer_t
+ * @param[in]   interval    vtimer timex_t interval
+ * @param[in]   slack       microseconds the timer may fire late
+ * @param[in]   pid         process id
+ * @return      0 on success, < 0 on error
+ */
+int vtimer_set_wakeup_slack(vtimer_t *t, timex_t interval, uint32_t slack,
+                            int pid);
+
+/**
+ * @brief   set a vtimer that sets thread flags
+ * @param[in]   t           pointer to preinitialised vtimer_t
+ * @param[in]   interval    vtimer timex_t interval
+ * @param[in]   pid         process id
+ * @param[in]   flags       flags to set, see thread_flags_set()
+ * @return      0 on success, < 0 on error
+ */
+int vtimer_set_flags(vtimer_t *t, timex_t interval, int pid,
+                     thread_flags_t flags);
+
 /**
  * @brief   remove a vtimer
  * @param[in]   t           pointer to preinitialised vtimer_t
@@ -115,6 +198,30 @@ int vtimer_remove(vtimer_t *t);
  */
 int vtimer_msg_receive_timeout(msg_t *m, timex_t timeout);
 
+/**
+ * @brief   kernel timer ticks until an absolute time, for msg_receive_timeout(),
+ *          mutex_lock_timeout() and alike
+ *
+ * Longer waits are cut to VTIMER_TIMEOUT_MAX seconds, so a caller waits
+ * again until the time has come:
+ *
+ *     while ((ticks = vtimer_timeout_ticks(then)) > 0) {
+ *         if (mutex_lock_timeout(&mutex, ticks)) { ... }
+ *     }
+ *
+ * @param[in]    then        absolute time as given by vtimer_now(),
+ *                           it does not need to be normalized
+ * @return       ticks to wait, 0 if *then* has passed
+ */
+unsigned long vtimer_timeout_ticks(timex_t then);
+
+/**
+ * @brief   Same as vtimer_timeout_ticks(), for a time as given by vtimer_now64()
+ * @param[in]    then        absolute time in microseconds
+ * @return       ticks to wait, 0 if *then* has passed
+ */
+unsigned long vtimer_timeout_ticks64(uint64_t then);
+
 #if ENABLE_DEBUG
 
 /**
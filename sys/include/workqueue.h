@@ -0,0 +1,124 @@
+/**
+ * Shared executor for deferred work
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @defgroup    sys_workqueue Work queue
+ * @ingroup     sys
+ * @brief       Prioritized callbacks run by a few shared worker threads
+ *
+ * Instead of a thread and a stack of its own, a module posts a ::work_t
+ * whenever there is something to do, from a thread or from an interrupt.
+ * WORKQUEUE_WORKERS threads run the queued handlers one after the other,
+ * the most important first.  A handler must not block for long, it
+ * delays all work behind it.
+ *
+ * Periodic work posts itself again with workqueue_post_in():
+ *
+ *     static void tick(work_t *w)
+ *     {
+ *         ...
+ *         workqueue_post_in(w, 500000);
+ *     }
+ *
+ * @{
+ * @file        workqueue.h
+ * @author      Freie Universität Berlin, Computer Systems & Telematics
+ */
+
+#ifndef __WORKQUEUE_H
+#define __WORKQUEUE_H
+
+#include <stdint.h>
+
+#include "kernel.h"
+#include "hwtimer_entry.h"
+
+/**
+ * @brief Number of worker threads
+ */
+#ifndef WORKQUEUE_WORKERS
+#define WORKQUEUE_WORKERS       (1)
+#endif
+
+/**
+ * @brief Stack size of every worker, handlers run on it
+ */
+#ifndef WORKQUEUE_STACKSIZE
+#define WORKQUEUE_STACKSIZE     (KERNEL_CONF_STACKSIZE_MAIN)
+#endif
+
+/**
+ * @brief Thread priority of the workers
+ */
+#ifndef WORKQUEUE_PRIORITY
+#define WORKQUEUE_PRIORITY      (PRIORITY_MAIN - 1)
+#endif
+
+struct work;
+
+/**
+ * @brief A callback to run on a worker, owned by the caller
+ */
+typedef struct work {
+    struct work *next;              /**< next queued work */
+    hwtimer_entry_t timer;          /**< delay of workqueue_post_in() */
+    void (*handler)(struct work *); /**< runs on a worker */
+    void *arg;                      /**< free for the handler */
+    uint8_t priority;               /**< lower runs first, like threads */
+    uint8_t queued;                 /**< internal */
+} work_t;
+
+/**
+ * @brief Prepares *work*, which must not be queued
+ *
+ * @param work      the work
+ * @param handler   called on a worker with *work*
+ * @param arg       stored in work->arg
+ * @param priority  lower values run first
+ */
+void workqueue_work_init(work_t *work, void (*handler)(work_t *), void *arg,
+                         uint8_t priority);
+
+/**
+ * @brief Starts the workers, further calls do nothing
+ *
+ * Modules using the queue call it from their own init function.
+ *
+ * @return 0 on success, -1 if no worker could be created
+ */
+int workqueue_init(void);
+
+/**
+ * @brief Queues *work* behind all work of the same or a lower priority
+ *
+ * May be called from interrupts.  The handler runs once, no matter how
+ * often *work* was posted before it ran.
+ *
+ * @return 1 if *work* was queued, 0 if it already was
+ */
+int workqueue_post(work_t *work);
+
+/**
+ * @brief Queues *work* after *us* microseconds
+ *
+ * A pending delay is restarted.  Delays are kept by the hardware timer
+ * and must be shorter than half its range.
+ */
+void workqueue_post_in(work_t *work, unsigned long us);
+
+/**
+ * @brief Takes *work* out of the queue and stops its delay
+ *
+ * A handler that is running already is not stopped.
+ *
+ * @return 1 if *work* was queued or delayed, 0 otherwise
+ */
+int workqueue_cancel(work_t *work);
+
+/** @} */
+#endif /* __WORKQUEUE_H */
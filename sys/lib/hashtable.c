@@ -43,6 +43,12 @@
 #include "malloc.h"
 #endif
 
+#ifdef MODULE_MEMPOOL
+#include "mempool.h"
+#define malloc(s)   mempool_alloc(s)
+#define free(p)     mempool_free(p)
+#endif
+
 #include "hashtable.h"
 #include "hashtable_private.h"
 
@@ -0,0 +1,194 @@
+/**
+ * Fixed capacity Robin Hood hash table
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_lib
+ * @{
+ * @file   rhtable.c
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rhtable.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/* largest psl value, a longer probe sequence makes an insert fail */
+#define PSL_MAX     (UINT8_MAX)
+
+#define SLOT(t, i)  ((t)->slots + (size_t)(i) * (t)->slot_size)
+#define NEXT(t, i)  (((i) + 1 == (t)->capacity) ? 0 : (i) + 1)
+#define PREV(t, i)  (((i) == 0) ? (t)->capacity - 1 : (i) - 1)
+
+static uint32_t fnv1a(const void *key, size_t len)
+{
+    const uint8_t *k = key;
+    uint32_t hash = 2166136261u;
+
+    while (len--) {
+        hash ^= *k++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static uint16_t home(const rhtable_t *table, const void *key)
+{
+    return table->hash(key, table->key_size) % table->capacity;
+}
+
+/* slot of *key*, -1 if not found */
+static int32_t find(const rhtable_t *table, const void *key)
+{
+    uint16_t i;
+    uint16_t d = 1;
+
+    if (table->count == 0) {
+        return -1;
+    }
+
+    i = home(table, key);
+
+    /* an entry closer to its home than we are to ours ends the search */
+    while (table->psl[i] >= d) {
+        if ((table->psl[i] == d) &&
+            (memcmp(SLOT(table, i), key, table->key_size) == 0)) {
+            return i;
+        }
+
+        i = NEXT(table, i);
+        d++;
+    }
+
+    return -1;
+}
+
+void rhtable_init(rhtable_t *table, void *slots, uint8_t *psl,
+                  uint16_t capacity, uint16_t slot_size, uint8_t key_size,
+                  uint8_t value_offset, uint8_t value_size,
+                  rhtable_hash_t hash)
+{
+    table->slots = slots;
+    table->psl = psl;
+    table->hash = hash ? hash : fnv1a;
+    table->capacity = capacity;
+    table->slot_size = slot_size;
+    table->key_size = key_size;
+    table->value_offset = value_offset;
+    table->value_size = value_size;
+    rhtable_clear(table);
+}
+
+void rhtable_clear(rhtable_t *table)
+{
+    memset(table->psl, 0, table->capacity);
+    table->count = 0;
+}
+
+void *rhtable_insert(rhtable_t *table, const void *key, const void *value)
+{
+    int32_t found = find(table, key);
+    uint16_t i, j;
+    uint16_t d = 1;
+
+    if (found >= 0) {
+        i = found;
+        goto store;
+    }
+
+    if (table->count == table->capacity) {
+        return NULL;
+    }
+
+    /*
+     * Robin Hood: the new entry takes the first slot that is free or holds
+     * an entry closer to its home.  Displacing that entry and all behind it
+     * up to the next free slot by one keeps the table ordered the same way.
+     */
+    i = home(table, key);
+
+    while (table->psl[i] >= d) {
+        if (d == PSL_MAX) {
+            return NULL;
+        }
+
+        i = NEXT(table, i);
+        d++;
+    }
+
+    for (j = i; table->psl[j] != 0; j = NEXT(table, j)) {
+        if (table->psl[j] == PSL_MAX) {
+            return NULL;
+        }
+    }
+
+    while (j != i) {
+        uint16_t p = PREV(table, j);
+
+        memcpy(SLOT(table, j), SLOT(table, p), table->slot_size);
+        table->psl[j] = table->psl[p] + 1;
+        j = p;
+    }
+
+    table->psl[i] = d;
+    table->count++;
+    memcpy(SLOT(table, i), key, table->key_size);
+    DEBUG("rhtable: inserted at %u, psl %u\n", i, d);
+
+store:
+
+    if (value) {
+        memcpy(SLOT(table, i) + table->value_offset, value,
+               table->value_size);
+    }
+
+    return SLOT(table, i) + table->value_offset;
+}
+
+void *rhtable_search(const rhtable_t *table, const void *key)
+{
+    int32_t i = find(table, key);
+
+    if (i < 0) {
+        return NULL;
+    }
+
+    return SLOT(table, i) + table->value_offset;
+}
+
+int rhtable_remove(rhtable_t *table, const void *key, void *value)
+{
+    int32_t found = find(table, key);
+    uint16_t i, j;
+
+    if (found < 0) {
+        return -1;
+    }
+
+    i = found;
+
+    if (value) {
+        memcpy(value, SLOT(table, i) + table->value_offset,
+               table->value_size);
+    }
+
+    /* shift back the entries that are not in their home slot */
+    for (j = NEXT(table, i); table->psl[j] > 1; j = NEXT(table, j)) {
+        memcpy(SLOT(table, i), SLOT(table, j), table->slot_size);
+        table->psl[i] = table->psl[j] - 1;
+        i = j;
+    }
+
+    table->psl[i] = 0;
+    table->count--;
+    return 0;
+}
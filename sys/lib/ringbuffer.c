@@ -30,6 +30,16 @@
 
 #include "ringbuffer.h"
 
+/* pos < 2 * size, as all sums of a position and a count are */
+static inline unsigned int rb_wrap(ringbuffer_t *rb, unsigned int pos)
+{
+    if (rb->mask) {
+        return pos & rb->mask;
+    }
+
+    return (pos >= rb->size) ? pos - rb->size : pos;
+}
+
 void ringbuffer_init(ringbuffer_t *rb, char *buffer, unsigned int bufsize)
 {
     rb->buf = buffer;
@@ -37,56 +47,145 @@ void ringbuffer_init(ringbuffer_t *rb, char *buffer, unsigned int bufsize)
     rb->end = 0;
     rb->size = bufsize;
     rb->avail = 0;
+    rb->mask = (bufsize && !(bufsize & (bufsize - 1))) ? bufsize - 1 : 0;
+    rb->overflow = 0;
 }
 
 void rb_add_elements(ringbuffer_t *rb, char *buf, int n)
 {
-    for (int i = 0; i < n; i++) {
-        rb_add_element(rb, buf[i]);
+    unsigned int space;
+
+    if (n <= 0) {
+        return;
     }
+
+    /* like rb_add_element(), the oldest elements make room */
+    if ((unsigned int) n > rb->size) {
+        rb->overflow += n - rb->size;
+        buf += n - rb->size;
+        n = rb->size;
+    }
+
+    space = rb->size - rb->avail;
+
+    if ((unsigned int) n > space) {
+        rb_skip_elements(rb, n - space);
+        rb->overflow += n - space;
+    }
+
+    rb_write_elements(rb, 0, buf, n);
+    rb_commit_elements(rb, n);
 }
 
 void rb_add_element(ringbuffer_t *rb, char c)
 {
     if (rb->avail == rb->size) {
         rb_get_element(rb);
+        rb->overflow++;
     }
 
-    rb->buf[rb->end++] = c;
+    rb->buf[rb->end] = c;
+    rb->end = rb_wrap(rb, rb->end + 1);
+    rb->avail++;
+}
+
+int rb_get_element(ringbuffer_t *rb)
+{
+    int c = rb_peek_element(rb);
 
-    if (rb->end >= rb->size) {
-        rb->end = 0;
+    if (c >= 0) {
+        rb_skip_elements(rb, 1);
     }
 
-    rb->avail++;
+    return c;
 }
 
-int rb_get_element(ringbuffer_t *rb)
+int rb_get_elements(ringbuffer_t *rb, char *buf, int n)
+{
+    int count = rb_peek_elements(rb, buf, n);
+
+    rb_skip_elements(rb, count);
+
+    return count;
+}
+
+int rb_peek_element(ringbuffer_t *rb)
 {
     if (rb->avail == 0) {
         return -1;
     }
 
-    rb->avail--;
+    return (unsigned char) rb->buf[rb->start];
+}
 
-    int c = (char)rb->buf[rb->start++];
+int rb_peek_elements(ringbuffer_t *rb, char *buf, int n)
+{
+    unsigned int count, first;
 
-    if (rb->start >= rb->size) {
-        rb->start = 0;
+    if (n <= 0) {
+        return 0;
     }
 
-    return c;
+    count = ((unsigned int) n < rb->avail) ? (unsigned int) n : rb->avail;
+    first = rb->size - rb->start;
+
+    if (first > count) {
+        first = count;
+    }
+
+    memcpy(buf, rb->buf + rb->start, first);
+    memcpy(buf + first, rb->buf, count - first);
+
+    return count;
 }
 
-int rb_get_elements(ringbuffer_t *rb, char *buf, int n)
+unsigned int rb_get_region(ringbuffer_t *rb, char **region)
 {
-    int count = 0;
+    unsigned int first = rb->size - rb->start;
 
-    while (rb->avail && (count < n)) {
-        buf[count++] = rb_get_element(rb);
+    *region = rb->buf + rb->start;
+
+    return (first < rb->avail) ? first : rb->avail;
+}
+
+void rb_skip_elements(ringbuffer_t *rb, unsigned int n)
+{
+    if (n > rb->avail) {
+        n = rb->avail;
     }
 
-    return count;
+    rb->start = rb_wrap(rb, rb->start + n);
+    rb->avail -= n;
+}
+
+unsigned int rb_put_region(ringbuffer_t *rb, char **region)
+{
+    unsigned int first = rb->size - rb->end;
+    unsigned int space = rb->size - rb->avail;
+
+    *region = rb->buf + rb->end;
+
+    return (first < space) ? first : space;
+}
+
+void rb_write_elements(ringbuffer_t *rb, unsigned int offset, const char *buf,
+                       unsigned int n)
+{
+    unsigned int pos = rb_wrap(rb, rb->end + offset);
+    unsigned int first = rb->size - pos;
+
+    if (first > n) {
+        first = n;
+    }
+
+    memcpy(rb->buf + pos, buf, first);
+    memcpy(rb->buf, buf + first, n - first);
+}
+
+void rb_commit_elements(ringbuffer_t *rb, unsigned int n)
+{
+    rb->end = rb_wrap(rb, rb->end + n);
+    rb->avail += n;
 }
 
 /*
@@ -0,0 +1,77 @@
+/**
+ * Single producer, single consumer ringbuffer implementation
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_lib
+ * @{
+ * @file   spsc_ringbuffer.c
+ * @}
+ */
+
+#include <string.h>
+
+#include "atomic.h"
+#include "spsc_ringbuffer.h"
+
+void spsc_rb_init(spsc_ringbuffer_t *rb, char *buffer, unsigned int bufsize)
+{
+    rb->buf = buffer;
+    rb->mask = bufsize - 1;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->overflow = 0;
+}
+
+unsigned int spsc_rb_put(spsc_ringbuffer_t *rb, const char *buf, unsigned int n)
+{
+    unsigned int head = rb->head;
+    unsigned int space = rb->mask + 1 - (head - rb->tail);
+    unsigned int pos = head & rb->mask;
+    unsigned int first = rb->mask + 1 - pos;
+
+    if (n > space) {
+        rb->overflow += n - space;
+        n = space;
+    }
+
+    if (first > n) {
+        first = n;
+    }
+
+    memcpy(rb->buf + pos, buf, first);
+    memcpy(rb->buf, buf + first, n - first);
+
+    /* the data is in place before the consumer sees the new head */
+    atomic_set_return((unsigned int *) &rb->head, head + n);
+
+    return n;
+}
+
+unsigned int spsc_rb_get(spsc_ringbuffer_t *rb, char *buf, unsigned int n)
+{
+    unsigned int tail = rb->tail;
+    unsigned int avail = rb->head - tail;
+    unsigned int pos = tail & rb->mask;
+    unsigned int first = rb->mask + 1 - pos;
+
+    if (n > avail) {
+        n = avail;
+    }
+
+    if (first > n) {
+        first = n;
+    }
+
+    memcpy(buf, rb->buf + pos, first);
+    memcpy(buf + first, rb->buf, n - first);
+
+    /* the data is copied out before the producer may overwrite it */
+    atomic_set_return((unsigned int *) &rb->tail, tail + n);
+
+    return n;
+}
@@ -0,0 +1,223 @@
+/**
+ * Fixed-size block pool allocator
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_mempool
+ * @{
+ * @file    mempool.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "irq.h"
+#include "mempool.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+/* storage for a class, in 8 byte words so blocks are suitably aligned */
+#define MEMPOOL_WORDS(n)    ((MEMPOOL_SIZE_##n * MEMPOOL_NUM_##n) / 8 + 1)
+
+typedef struct mempool_block {
+    struct mempool_block *next;
+} mempool_block_t;
+
+typedef struct {
+    uint8_t *start;
+    uint8_t *end;
+    mempool_block_t *free;
+    mempool_stats_t stats;
+} mempool_class_t;
+
+static uint64_t mempool_mem_0[MEMPOOL_WORDS(0)];
+static uint64_t mempool_mem_1[MEMPOOL_WORDS(1)];
+static uint64_t mempool_mem_2[MEMPOOL_WORDS(2)];
+static uint64_t mempool_mem_3[MEMPOOL_WORDS(3)];
+static uint64_t mempool_mem_4[MEMPOOL_WORDS(4)];
+
+#define MEMPOOL_CLASS(n) { (uint8_t *) mempool_mem_##n, \
+                           (uint8_t *) mempool_mem_##n + \
+                           MEMPOOL_SIZE_##n * MEMPOOL_NUM_##n, \
+                           NULL, \
+                           { MEMPOOL_SIZE_##n, MEMPOOL_NUM_##n, 0, 0, 0 } }
+
+static mempool_class_t mempool_classes[MEMPOOL_CLASSES] = {
+    MEMPOOL_CLASS(0),
+    MEMPOOL_CLASS(1),
+    MEMPOOL_CLASS(2),
+    MEMPOOL_CLASS(3),
+    MEMPOOL_CLASS(4),
+};
+
+static int mempool_initialized = 0;
+
+static void mempool_init(void)
+{
+    for (int c = 0; c < MEMPOOL_CLASSES; c++) {
+        mempool_class_t *cls = &mempool_classes[c];
+
+        for (unsigned int i = cls->stats.num; i > 0; i--) {
+            mempool_block_t *b = (mempool_block_t *) (cls->start +
+                                 (i - 1) * cls->stats.size);
+            b->next = cls->free;
+            cls->free = b;
+        }
+    }
+
+    mempool_initialized = 1;
+}
+
+static mempool_class_t *mempool_class_of(void *ptr)
+{
+    for (int c = 0; c < MEMPOOL_CLASSES; c++) {
+        if (((uint8_t *) ptr >= mempool_classes[c].start) &&
+            ((uint8_t *) ptr < mempool_classes[c].end)) {
+            return &mempool_classes[c];
+        }
+    }
+
+    return NULL;
+}
+
+void *mempool_alloc(size_t size)
+{
+    mempool_class_t *fit = NULL;
+    void *ptr = NULL;
+    unsigned state = disableIRQ();
+
+    if (!mempool_initialized) {
+        mempool_init();
+    }
+
+    for (int c = 0; c < MEMPOOL_CLASSES; c++) {
+        mempool_class_t *cls = &mempool_classes[c];
+
+        if ((cls->stats.num == 0) || (size > cls->stats.size)) {
+            continue;
+        }
+
+        if (fit == NULL) {
+            fit = cls;
+        }
+
+        if (cls->free != NULL) {
+            ptr = cls->free;
+            cls->free = cls->free->next;
+
+            if (++cls->stats.used > cls->stats.max_used) {
+                cls->stats.max_used = cls->stats.used;
+            }
+
+            break;
+        }
+    }
+
+    if ((ptr == NULL) && (fit != NULL)) {
+        fit->stats.fallbacks++;
+    }
+
+    restoreIRQ(state);
+
+    if (ptr == NULL) {
+        DEBUG("mempool_alloc(): no block for %u bytes, using malloc\n",
+              (unsigned int) size);
+        ptr = malloc(size);
+    }
+
+    return ptr;
+}
+
+void *mempool_calloc(size_t num, size_t size)
+{
+    void *ptr = mempool_alloc(num * size);
+
+    if (ptr != NULL) {
+        memset(ptr, 0, num * size);
+    }
+
+    return ptr;
+}
+
+void *mempool_realloc(void *ptr, size_t size)
+{
+    mempool_class_t *cls;
+    void *newptr;
+
+    if (ptr == NULL) {
+        return mempool_alloc(size);
+    }
+
+    cls = mempool_class_of(ptr);
+
+    if (cls == NULL) {
+        return realloc(ptr, size);
+    }
+
+    if (size <= cls->stats.size) {
+        return ptr;
+    }
+
+    newptr = mempool_alloc(size);
+
+    if (newptr != NULL) {
+        memcpy(newptr, ptr, cls->stats.size);
+        mempool_free(ptr);
+    }
+
+    return newptr;
+}
+
+void mempool_free(void *ptr)
+{
+    mempool_class_t *cls;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    cls = mempool_class_of(ptr);
+
+    if (cls == NULL) {
+        free(ptr);
+        return;
+    }
+
+    unsigned state = disableIRQ();
+    mempool_block_t *b = (mempool_block_t *) ptr;
+
+    b->next = cls->free;
+    cls->free = b;
+    cls->stats.used--;
+
+    restoreIRQ(state);
+}
+
+const mempool_stats_t *mempool_get_stats(unsigned int cls)
+{
+    if (cls >= MEMPOOL_CLASSES) {
+        return NULL;
+    }
+
+    return &mempool_classes[cls].stats;
+}
+
+void mempool_print_stats(void)
+{
+    printf("size | num | used | max used | fallbacks\n");
+
+    for (int c = 0; c < MEMPOOL_CLASSES; c++) {
+        mempool_stats_t *s = &mempool_classes[c].stats;
+        printf("%4u | %3u | %4u | %8u | %9u\n", (unsigned int) s->size,
+               s->num, s->used, s->max_used, s->fallbacks);
+    }
+}
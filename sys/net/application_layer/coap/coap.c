@@ -0,0 +1,779 @@
+/*
+ * CoAP server
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_coap
+ * @{
+ * @file    coap.c
+ * @brief   Requests parsed in place, responses built in the transmit buffer
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "mutex.h"
+#include "thread.h"
+#include "net_help.h"
+#include "destiny/socket.h"
+
+#include "coap.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define COAP_VERSION        (1)
+#define COAP_HDR_LEN        (4)
+#define COAP_TOKEN_MAX      (8)
+#define COAP_PAYLOAD_MARKER (0xff)
+/* options may not follow once the payload is there */
+#define COAP_OPT_NONE       (0xffff)
+/* header, longest token and Observe option in front of a notification */
+#define COAP_NOTIFY_HDR_LEN (COAP_HDR_LEN + COAP_TOKEN_MAX + 4)
+
+typedef struct {
+    const coap_resource_t *resource;    /* NULL if unused */
+    sockaddr6_t remote;
+    uint16_t last_id;                   /* of the last notification */
+    uint8_t token_len;
+    uint8_t token[COAP_TOKEN_MAX];
+} coap_observer_t;
+
+static char coap_stack[COAP_STACKSIZE];
+static int coap_pid = -1;
+static int coap_sock = -1;
+
+static const coap_resource_t *coap_resources;
+static unsigned int coap_resources_numof;
+
+/* only used by the server thread */
+static uint8_t coap_rx_buf[COAP_BUF_SIZE];
+
+/* guards everything below */
+static mutex_t coap_mutex;
+static uint8_t coap_tx_buf[COAP_BUF_SIZE];
+/* options and payload of a notification, shared by all observers */
+static uint8_t coap_notify_buf[COAP_BUF_SIZE - COAP_NOTIFY_HDR_LEN];
+static coap_observer_t coap_observers[COAP_OBSERVERS_NUMOF];
+static uint32_t coap_observe_seq;
+static uint16_t coap_next_id;
+
+/* reads the extended delta or length that follows an option header */
+static int coap_opt_ext(const uint8_t **p, const uint8_t *end, uint32_t *v)
+{
+    if (*v == 13) {
+        if (end - *p < 1) {
+            return -1;
+        }
+
+        *v = 13 + (*p)[0];
+        *p += 1;
+    }
+    else if (*v == 14) {
+        if (end - *p < 2) {
+            return -1;
+        }
+
+        *v = 269 + (((*p)[0] << 8) | (*p)[1]);
+        *p += 2;
+    }
+    else if (*v == 15) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* 1 if *opt* holds the next option, 0 at the end, -1 if it is malformed */
+static int coap_opt_parse(const coap_request_t *req, coap_opt_t *opt)
+{
+    const uint8_t *p = (opt->next != NULL) ? opt->next : req->options;
+    const uint8_t *end = req->options + req->options_len;
+    uint32_t delta, len;
+
+    if ((p >= end) || (*p == COAP_PAYLOAD_MARKER)) {
+        return 0;
+    }
+
+    delta = *p >> 4;
+    len = *p & 0x0f;
+    p++;
+
+    if ((coap_opt_ext(&p, end, &delta) < 0) ||
+        (coap_opt_ext(&p, end, &len) < 0) ||
+        (len > (uint32_t)(end - p)) ||
+        (((opt->next != NULL) ? opt->num : 0) + delta > 0xffff)) {
+        return -1;
+    }
+
+    opt->num = ((opt->next != NULL) ? opt->num : 0) + delta;
+    opt->len = len;
+    opt->val = p;
+    opt->next = p + len;
+    return 1;
+}
+
+int coap_opt_next(const coap_request_t *req, coap_opt_t *opt)
+{
+    return coap_opt_parse(req, opt) > 0;
+}
+
+int coap_opt_find(const coap_request_t *req, uint16_t num, coap_opt_t *opt)
+{
+    memset(opt, 0, sizeof(*opt));
+
+    while (coap_opt_next(req, opt)) {
+        if (opt->num == num) {
+            return 1;
+        }
+
+        if (opt->num > num) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t coap_opt_uint(const coap_opt_t *opt)
+{
+    uint32_t val = 0;
+
+    for (uint16_t i = 0; (i < opt->len) && (i < 4); i++) {
+        val = (val << 8) | opt->val[i];
+    }
+
+    return val;
+}
+
+int coap_req_block(const coap_request_t *req, uint16_t num,
+                   coap_block_t *block)
+{
+    coap_opt_t opt;
+    uint32_t val;
+
+    if (!coap_opt_find(req, num, &opt) || (opt.len > 3)) {
+        return 0;
+    }
+
+    val = coap_opt_uint(&opt);
+
+    if ((val & 0x07) == 7) {
+        /* reserved block size */
+        return 0;
+    }
+
+    block->num = val >> 4;
+    block->more = (val >> 3) & 1;
+    block->szx = val & 0x07;
+    return 1;
+}
+
+static uint8_t coap_opt_nibble(uint16_t v)
+{
+    return (v < 13) ? v : ((v < 269) ? 13 : 14);
+}
+
+static uint8_t *coap_opt_put_ext(uint8_t *p, uint16_t v)
+{
+    if (v >= 269) {
+        *p++ = (v - 269) >> 8;
+        *p++ = (v - 269) & 0xff;
+    }
+    else if (v >= 13) {
+        *p++ = v - 13;
+    }
+
+    return p;
+}
+
+int coap_resp_opt(coap_response_t *resp, uint16_t num, const void *val,
+                  uint16_t len)
+{
+    uint16_t delta = num - resp->last_opt;
+    uint8_t *p = &resp->buf[resp->len];
+    uint16_t need = 1 + len;
+
+    if ((resp->last_opt == COAP_OPT_NONE) || (num < resp->last_opt)) {
+        return -1;
+    }
+
+    need += (delta >= 269) ? 2 : ((delta >= 13) ? 1 : 0);
+    need += (len >= 269) ? 2 : ((len >= 13) ? 1 : 0);
+
+    if (resp->len + need > resp->size) {
+        return -1;
+    }
+
+    *p++ = (coap_opt_nibble(delta) << 4) | coap_opt_nibble(len);
+    p = coap_opt_put_ext(p, delta);
+    p = coap_opt_put_ext(p, len);
+    memcpy(p, val, len);
+
+    resp->len += need;
+    resp->last_opt = num;
+    return 0;
+}
+
+int coap_resp_opt_uint(coap_response_t *resp, uint16_t num, uint32_t val)
+{
+    uint8_t buf[4];
+    uint8_t len = 0;
+
+    /* as few bytes as possible, none for 0 */
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if ((len > 0) || ((val >> shift) & 0xff)) {
+            buf[len++] = (val >> shift) & 0xff;
+        }
+    }
+
+    return coap_resp_opt(resp, num, buf, len);
+}
+
+int coap_resp_opt_block(coap_response_t *resp, uint16_t num,
+                        const coap_block_t *block)
+{
+    return coap_resp_opt_uint(resp, num, (block->num << 4) |
+                              (block->more << 3) | block->szx);
+}
+
+uint8_t *coap_resp_payload(coap_response_t *resp, uint16_t *max)
+{
+    if ((resp->last_opt == COAP_OPT_NONE) || (resp->len + 1 >= resp->size)) {
+        *max = 0;
+        return NULL;
+    }
+
+    *max = resp->size - resp->len - 1;
+    return &resp->buf[resp->len + 1];
+}
+
+int coap_resp_payload_len(coap_response_t *resp, uint16_t len)
+{
+    if (len == 0) {
+        return 0;
+    }
+
+    if ((resp->last_opt == COAP_OPT_NONE) ||
+        (resp->len + 1 + len > resp->size)) {
+        return -1;
+    }
+
+    resp->buf[resp->len] = COAP_PAYLOAD_MARKER;
+    resp->len += 1 + len;
+    resp->last_opt = COAP_OPT_NONE;
+    return 0;
+}
+
+int coap_resp_block2(const coap_request_t *req, coap_response_t *resp,
+                     const void *repr, uint32_t len)
+{
+    coap_block_t block = { 0, 0, COAP_BLOCK_SZX };
+    int asked = coap_req_block(req, COAP_OPT_BLOCK2, &block);
+    uint32_t offset = coap_block_offset(&block);
+    uint16_t max, size;
+    uint8_t *payload;
+
+    if (asked && (offset >= len) && (len > 0)) {
+        coap_resp_code(resp, COAP_CODE_BAD_OPTION);
+        return -1;
+    }
+
+    /* room for the option, 1 byte header and up to 3 bytes value */
+    if (resp->len + 5 >= resp->size) {
+        return -1;
+    }
+
+    if (!asked && (len <= (uint32_t)(resp->size - resp->len - 1))) {
+        payload = coap_resp_payload(resp, &max);
+
+        if (payload == NULL) {
+            return (len == 0) ? 0 : -1;
+        }
+
+        memcpy(payload, repr, len);
+        return coap_resp_payload_len(resp, len);
+    }
+
+    /* a smaller block than asked for if the buffer is short */
+    if (block.szx > COAP_BLOCK_SZX) {
+        block.szx = COAP_BLOCK_SZX;
+    }
+
+    while ((block.szx > 0) &&
+           ((16U << block.szx) > (unsigned)(resp->size - resp->len - 5))) {
+        block.szx--;
+    }
+
+    block.num = offset >> (block.szx + 4);
+    offset = coap_block_offset(&block);
+    size = 16 << block.szx;
+
+    if (size > len - offset) {
+        size = len - offset;
+    }
+
+    block.more = (offset + size < len);
+
+    if (coap_resp_opt_block(resp, COAP_OPT_BLOCK2, &block) < 0) {
+        return -1;
+    }
+
+    payload = coap_resp_payload(resp, &max);
+
+    if ((payload == NULL) || (size > max)) {
+        return -1;
+    }
+
+    memcpy(payload, (const uint8_t *) repr + offset, size);
+    return coap_resp_payload_len(resp, size);
+}
+
+/* writes the header of a message to *buf*, a response follows */
+static void coap_resp_init(coap_response_t *resp, uint8_t *buf, uint16_t size,
+                           uint8_t type, uint8_t code, uint16_t id,
+                           const uint8_t *token, uint8_t token_len)
+{
+    buf[0] = (COAP_VERSION << 6) | (type << 4) | token_len;
+    buf[1] = code;
+    buf[2] = id >> 8;
+    buf[3] = id & 0xff;
+    memcpy(&buf[COAP_HDR_LEN], token, token_len);
+
+    resp->buf = buf;
+    resp->size = size;
+    resp->len = COAP_HDR_LEN + token_len;
+    resp->last_opt = 0;
+    resp->code = code;
+}
+
+static int coap_send(const uint8_t *buf, uint16_t len, const sockaddr6_t *remote)
+{
+    return destiny_socket_sendto(coap_sock, buf, len, 0,
+                                 (sockaddr6_t *) remote, sizeof(sockaddr6_t));
+}
+
+static int coap_opt_known(uint16_t num)
+{
+    switch (num) {
+        case COAP_OPT_IF_MATCH:
+        case COAP_OPT_URI_HOST:
+        case COAP_OPT_ETAG:
+        case COAP_OPT_IF_NONE_MATCH:
+        case COAP_OPT_OBSERVE:
+        case COAP_OPT_URI_PORT:
+        case COAP_OPT_URI_PATH:
+        case COAP_OPT_CONTENT_FORMAT:
+        case COAP_OPT_URI_QUERY:
+        case COAP_OPT_ACCEPT:
+        case COAP_OPT_BLOCK2:
+        case COAP_OPT_BLOCK1:
+        case COAP_OPT_SIZE2:
+        case COAP_OPT_SIZE1:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+/* fills *req* from the message in *buf*, 0 on success, -1 if it is
+ * malformed, 1 if it has an unknown critical option */
+static int coap_parse(coap_request_t *req, const uint8_t *buf, uint16_t len)
+{
+    coap_opt_t opt;
+    const uint8_t *end = buf + len;
+    const uint8_t *pos;
+    int res, unknown = 0;
+
+    if ((len < COAP_HDR_LEN) || ((buf[0] >> 6) != COAP_VERSION) ||
+        ((buf[0] & 0x0f) > COAP_TOKEN_MAX) ||
+        (COAP_HDR_LEN + (buf[0] & 0x0f) > len)) {
+        return -1;
+    }
+
+    memset(req, 0, sizeof(*req));
+    req->buf = buf;
+    req->len = len;
+    req->type = (buf[0] >> 4) & 0x03;
+    req->token_len = buf[0] & 0x0f;
+    req->code = buf[1];
+    req->id = (buf[2] << 8) | buf[3];
+    req->token = &buf[COAP_HDR_LEN];
+    req->options = req->token + req->token_len;
+    req->options_len = end - req->options;
+
+    memset(&opt, 0, sizeof(opt));
+
+    while ((res = coap_opt_parse(req, &opt)) > 0) {
+        /* critical options have odd numbers */
+        if ((opt.num & 1) && !coap_opt_known(opt.num)) {
+            unknown = 1;
+        }
+    }
+
+    if (res < 0) {
+        return -1;
+    }
+
+    pos = (opt.next != NULL) ? opt.next : req->options;
+
+    if (pos < end) {
+        /* a marker without payload is a format error */
+        if ((*pos != COAP_PAYLOAD_MARKER) || (pos + 1 == end)) {
+            return -1;
+        }
+
+        req->payload = pos + 1;
+        req->payload_len = end - pos - 1;
+    }
+
+    req->options_len = pos - req->options;
+    return unknown;
+}
+
+static int coap_path_match(const coap_request_t *req, const char *path)
+{
+    coap_opt_t opt;
+
+    memset(&opt, 0, sizeof(opt));
+
+    while (*path == '/') {
+        path++;
+    }
+
+    while (coap_opt_next(req, &opt) && (opt.num <= COAP_OPT_URI_PATH)) {
+        size_t seg;
+
+        if (opt.num != COAP_OPT_URI_PATH) {
+            continue;
+        }
+
+        seg = strcspn(path, "/");
+
+        if ((seg != opt.len) || (memcmp(path, opt.val, seg) != 0)) {
+            return 0;
+        }
+
+        path += seg;
+
+        while (*path == '/') {
+            path++;
+        }
+    }
+
+    return *path == '\0';
+}
+
+static int coap_remote_equal(const sockaddr6_t *a, const sockaddr6_t *b)
+{
+    return (a->sin6_port == b->sin6_port) &&
+           (memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(ipv6_addr_t)) == 0);
+}
+
+/* with coap_mutex held */
+static coap_observer_t *coap_observer_find(const coap_resource_t *resource,
+                                           const sockaddr6_t *remote)
+{
+    for (int i = 0; i < COAP_OBSERVERS_NUMOF; i++) {
+        coap_observer_t *o = &coap_observers[i];
+
+        if ((o->resource == resource) && coap_remote_equal(&o->remote, remote)) {
+            return o;
+        }
+    }
+
+    return NULL;
+}
+
+static int coap_observer_add(const coap_resource_t *resource,
+                             const coap_request_t *req)
+{
+    coap_observer_t *o = coap_observer_find(resource, req->remote);
+
+    for (int i = 0; (o == NULL) && (i < COAP_OBSERVERS_NUMOF); i++) {
+        if (coap_observers[i].resource == NULL) {
+            o = &coap_observers[i];
+        }
+    }
+
+    if (o == NULL) {
+        DEBUG("coap: no room for another observer\n");
+        return -1;
+    }
+
+    /* a client observing again replaces its token */
+    o->resource = resource;
+    memcpy(&o->remote, req->remote, sizeof(o->remote));
+    o->token_len = req->token_len;
+    memcpy(o->token, req->token, req->token_len);
+    o->last_id = req->id;
+    return 0;
+}
+
+static void coap_observer_remove(const coap_resource_t *resource,
+                                 const sockaddr6_t *remote)
+{
+    coap_observer_t *o = coap_observer_find(resource, remote);
+
+    if (o != NULL) {
+        o->resource = NULL;
+    }
+}
+
+/* a reset in answer to a notification cancels the observation */
+static void coap_observer_reset(const sockaddr6_t *remote, uint16_t id)
+{
+    for (int i = 0; i < COAP_OBSERVERS_NUMOF; i++) {
+        coap_observer_t *o = &coap_observers[i];
+
+        if ((o->resource != NULL) && (o->last_id == id) &&
+            coap_remote_equal(&o->remote, remote)) {
+            o->resource = NULL;
+        }
+    }
+}
+
+/* runs the handler, with coap_mutex held */
+static void coap_call(const coap_resource_t *resource,
+                      const coap_request_t *req, coap_response_t *resp)
+{
+    uint16_t len = resp->len;
+    uint16_t last_opt = resp->last_opt;
+
+    resp->code = (req->code == COAP_GET) ? COAP_CODE_CONTENT :
+                 COAP_CODE_CHANGED;
+
+    if (resource->handler(req, resp, resource->arg) < 0) {
+        /* whatever the handler wrote is dropped, an error code it set is
+         * kept */
+        resp->len = len;
+        resp->last_opt = last_opt;
+
+        if ((resp->code >> 5) == 2) {
+            resp->code = COAP_CODE_INTERNAL_ERROR;
+        }
+    }
+}
+
+static const coap_resource_t *coap_resource_find(const coap_request_t *req)
+{
+    for (unsigned int i = 0; i < coap_resources_numof; i++) {
+        if (coap_path_match(req, coap_resources[i].path)) {
+            return &coap_resources[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* with coap_mutex held */
+static void coap_handle(uint16_t len, const sockaddr6_t *remote)
+{
+    coap_request_t req;
+    coap_response_t resp;
+    const coap_resource_t *resource;
+    coap_opt_t opt;
+    int res = coap_parse(&req, coap_rx_buf, len);
+    int observing = 0;
+
+    if (res < 0) {
+        if ((len >= COAP_HDR_LEN) && (((coap_rx_buf[0] >> 4) & 0x03) ==
+                                      COAP_TYPE_CON)) {
+            /* a malformed confirmable message is rejected */
+            coap_resp_init(&resp, coap_tx_buf, sizeof(coap_tx_buf),
+                           COAP_TYPE_RST, 0,
+                           (coap_rx_buf[2] << 8) | coap_rx_buf[3], NULL, 0);
+            coap_send(coap_tx_buf, resp.len, remote);
+        }
+
+        return;
+    }
+
+    req.remote = remote;
+
+    if ((req.type == COAP_TYPE_ACK) || (req.type == COAP_TYPE_RST)) {
+        if (req.type == COAP_TYPE_RST) {
+            coap_observer_reset(remote, req.id);
+        }
+
+        return;
+    }
+
+    if ((req.code == 0) || (req.code > COAP_DELETE)) {
+        /* a ping, or a response we never asked for */
+        if (req.type == COAP_TYPE_CON) {
+            coap_resp_init(&resp, coap_tx_buf, sizeof(coap_tx_buf),
+                           COAP_TYPE_RST, 0, req.id, NULL, 0);
+            coap_send(coap_tx_buf, resp.len, remote);
+        }
+
+        return;
+    }
+
+    if (req.type == COAP_TYPE_CON) {
+        coap_resp_init(&resp, coap_tx_buf, sizeof(coap_tx_buf), COAP_TYPE_ACK,
+                       0, req.id, req.token, req.token_len);
+    }
+    else {
+        coap_resp_init(&resp, coap_tx_buf, sizeof(coap_tx_buf), COAP_TYPE_NON,
+                       0, coap_next_id++, req.token, req.token_len);
+    }
+
+    resource = coap_resource_find(&req);
+
+    if (res > 0) {
+        resp.code = COAP_CODE_BAD_OPTION;
+    }
+    else if (resource == NULL) {
+        resp.code = COAP_CODE_NOT_FOUND;
+    }
+    else if (!(resource->methods & (1 << (req.code - 1)))) {
+        resp.code = COAP_CODE_NOT_ALLOWED;
+    }
+    else {
+        if (resource->observable && (req.code == COAP_GET) &&
+            coap_opt_find(&req, COAP_OPT_OBSERVE, &opt)) {
+            if (coap_opt_uint(&opt) == 0) {
+                observing = (coap_observer_add(resource, &req) == 0);
+            }
+            else {
+                coap_observer_remove(resource, remote);
+            }
+        }
+
+        if (observing) {
+            coap_resp_opt_uint(&resp, COAP_OPT_OBSERVE, coap_observe_seq);
+        }
+
+        coap_call(resource, &req, &resp);
+
+        if (observing && ((resp.code >> 5) != 2)) {
+            coap_observer_remove(resource, remote);
+        }
+    }
+
+    coap_tx_buf[1] = resp.code;
+    coap_send(coap_tx_buf, resp.len, remote);
+}
+
+int coap_notify(const coap_resource_t *resource)
+{
+    coap_request_t req;
+    coap_response_t body;
+    int sent = 0;
+    int i;
+
+    mutex_lock(&coap_mutex);
+
+    for (i = 0; i < COAP_OBSERVERS_NUMOF; i++) {
+        if (coap_observers[i].resource == resource) {
+            break;
+        }
+    }
+
+    if (i == COAP_OBSERVERS_NUMOF) {
+        /* nobody to render it for */
+        mutex_unlock(&coap_mutex);
+        return 0;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.type = COAP_TYPE_NON;
+    req.code = COAP_GET;
+
+    /* rendered once, behind an Observe option that differs per observer */
+    body.buf = coap_notify_buf;
+    body.size = sizeof(coap_notify_buf);
+    body.len = 0;
+    body.last_opt = COAP_OPT_OBSERVE;
+    coap_call(resource, &req, &body);
+
+    coap_observe_seq = (coap_observe_seq + 1) & 0xffffff;
+
+    for (; i < COAP_OBSERVERS_NUMOF; i++) {
+        coap_observer_t *o = &coap_observers[i];
+        coap_response_t resp;
+
+        if (o->resource != resource) {
+            continue;
+        }
+
+        o->last_id = coap_next_id++;
+        coap_resp_init(&resp, coap_tx_buf, sizeof(coap_tx_buf), COAP_TYPE_NON,
+                       body.code, o->last_id, o->token, o->token_len);
+        coap_resp_opt_uint(&resp, COAP_OPT_OBSERVE, coap_observe_seq);
+        memcpy(&coap_tx_buf[resp.len], coap_notify_buf, body.len);
+
+        if (coap_send(coap_tx_buf, resp.len + body.len, &o->remote) >= 0) {
+            sent++;
+        }
+
+        if ((body.code >> 5) != 2) {
+            /* an error ends the observation */
+            o->resource = NULL;
+        }
+    }
+
+    mutex_unlock(&coap_mutex);
+    return sent;
+}
+
+static void coap_thread(void)
+{
+    sockaddr6_t sa;
+    socklen_t sa_len;
+    int32_t len;
+
+    coap_sock = destiny_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET6;
+    sa.sin6_port = HTONS(COAP_PORT);
+
+    if ((coap_sock < 0) ||
+        (destiny_socket_bind(coap_sock, &sa, sizeof(sa)) < 0)) {
+        DEBUG("coap: cannot bind port %u\n", COAP_PORT);
+        return;
+    }
+
+    while (1) {
+        len = destiny_socket_recvfrom(coap_sock, coap_rx_buf,
+                                      sizeof(coap_rx_buf), 0, &sa, &sa_len);
+
+        if (len <= 0) {
+            continue;
+        }
+
+        /* recvfrom() returns the port in host byte order */
+        sa.sin6_port = HTONS(sa.sin6_port);
+
+        mutex_lock(&coap_mutex);
+        coap_handle(len, &sa);
+        mutex_unlock(&coap_mutex);
+    }
+}
+
+int coap_init(const coap_resource_t *resources, unsigned int numof)
+{
+    if (coap_pid >= 0) {
+        return coap_pid;
+    }
+
+    mutex_init(&coap_mutex);
+    coap_resources = resources;
+    coap_resources_numof = numof;
+    coap_next_id = rand();
+
+    coap_pid = thread_create(coap_stack, COAP_STACKSIZE, COAP_PRIORITY,
+                             CREATE_STACKTEST, coap_thread, "coap");
+
+    return coap_pid;
+}
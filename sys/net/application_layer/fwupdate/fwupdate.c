@@ -0,0 +1,844 @@
+/*
+ * Firmware dissemination
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_fwupdate
+ * @{
+ * @file    fwupdate.c
+ * @brief   Delta chunks over MPL, written to flash page by page, NACK repair
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "mutex.h"
+#include "thread.h"
+#include "vtimer.h"
+#include "flashrom.h"
+#include "net_help.h"
+#include "sixlowpan/ip.h"
+#include "destiny/socket.h"
+#include "destiny/types.h"
+#include "mpl.h"
+
+#include "fwupdate.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define FW_CHUNKS           (FWUPDATE_PAGE_SIZE / FWUPDATE_CHUNK_SIZE)
+
+#if (FW_CHUNKS > 8) || (FW_CHUNKS * FWUPDATE_CHUNK_SIZE != FWUPDATE_PAGE_SIZE)
+#error "FWUPDATE_CHUNK_SIZE must divide FWUPDATE_PAGE_SIZE in at most 8 chunks"
+#endif
+
+#define FW_MSG_CHUNK        (1)
+#define FW_MSG_NACK         (2)
+
+/*
+ * chunk: type, chunk of the page, version, base version, image length,
+ * page, CRC of the image, the delta
+ * NACK: type, 0, version, first page, bitmap of missing pages
+ */
+#define FW_CHUNK_HDR_LEN    (14)
+#define FW_NACK_LEN         (6 + FWUPDATE_NACK_PAGES / 8)
+
+/*
+ * a delta is a sequence of ops, the length of the run is in the op octet:
+ * a copy from the old image is followed by the offset there, a literal
+ * by its bytes
+ */
+#define FW_OP_COPY          (0x80)
+#define FW_OP_LEN_MAX       (0x80)
+#define FW_OP_COPY_LEN      (5)
+/* a shorter copy takes no less space than the literal */
+#define FW_COPY_MIN         (6)
+/* a chunk sent literally */
+#define FW_DELTA_MAX        (FWUPDATE_CHUNK_SIZE + \
+                             (FWUPDATE_CHUNK_SIZE + FW_OP_LEN_MAX - 1) / \
+                             FW_OP_LEN_MAX)
+#define FW_MSG_MAX          (FW_CHUNK_HDR_LEN + FW_DELTA_MAX)
+
+/* fwupdate_send() is noticed within this time */
+#define FW_IDLE_MS          (1000)
+
+typedef struct {
+    int32_t page;               /* -1 if unused */
+    uint8_t chunks;             /* bitmap of the chunks decoded */
+    uint8_t data[FWUPDATE_PAGE_SIZE] __attribute__((aligned(4)));
+} fw_page_t;
+
+/* the transfer this node receives */
+typedef struct {
+    uint8_t active;
+    uint8_t complete;
+    uint8_t retries;            /* NACKs since a chunk was heard */
+    uint16_t version;
+    uint16_t base;
+    uint16_t crc;
+    uint16_t pages;
+    uint16_t pages_done;
+    uint32_t len;
+    uint64_t nack_at;           /* 0 if no NACK is due */
+    ipv6_addr_t source;
+    uint8_t done[FWUPDATE_PAGES_MAX / 8];
+} fw_rx_t;
+
+/* the image this node sends */
+typedef struct {
+    const uint8_t *image;       /* NULL if none */
+    const uint8_t *base;
+    uint32_t len;
+    uint32_t base_len;
+    uint16_t version;
+    uint16_t base_version;
+    uint16_t crc;
+    uint16_t pages;
+    uint16_t page;              /* being sent */
+    uint8_t chunk;              /* next of *page* */
+    uint64_t next_at;           /* 0 if nothing is pending */
+    uint8_t pending[FWUPDATE_PAGES_MAX / 8];
+} fw_tx_t;
+
+static char fw_stack[FWUPDATE_STACKSIZE];
+static int fw_pid = -1;
+static int fw_sock = -1;
+static const fwupdate_config_t *fw_config;
+static ipv6_addr_t fw_group;
+
+/* only used by the service thread */
+static uint8_t fw_rx_buf[FW_MSG_MAX];
+static uint8_t fw_tx_buf[sizeof(udp_hdr_t) + FW_MSG_MAX];
+static fw_page_t fw_pages[FWUPDATE_PAGE_BUFS];
+
+/* guards everything below */
+static mutex_t fw_mutex;
+static fw_rx_t fw_rx;
+static fw_tx_t fw_tx;
+
+static inline int bit_get(const uint8_t *map, unsigned int i)
+{
+    return map[i >> 3] & (1 << (i & 7));
+}
+
+static inline void bit_set(uint8_t *map, unsigned int i)
+{
+    map[i >> 3] |= (1 << (i & 7));
+}
+
+static inline void bit_clear(uint8_t *map, unsigned int i)
+{
+    map[i >> 3] &= ~(1 << (i & 7));
+}
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v >> 16);
+    put16(p + 2, v);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return ((uint32_t) get16(p) << 16) | get16(p + 2);
+}
+
+/* versions are compared in serial number arithmetic */
+static inline int version_newer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+/* CRC-16-CCITT, 0xffff to start with */
+static uint16_t crc16(uint16_t crc, const uint8_t *p, uint32_t len)
+{
+    while (len--) {
+        crc ^= (uint16_t) *p++ << 8;
+
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static uint16_t pages_of(uint32_t len)
+{
+    return (len + FWUPDATE_PAGE_SIZE - 1) / FWUPDATE_PAGE_SIZE;
+}
+
+/* chunks of *page*, fewer than FW_CHUNKS for the last one */
+static uint8_t chunks_of(uint32_t len, uint16_t page)
+{
+    uint32_t left = len - (uint32_t) page * FWUPDATE_PAGE_SIZE;
+
+    if (left >= FWUPDATE_PAGE_SIZE) {
+        return FW_CHUNKS;
+    }
+
+    return (left + FWUPDATE_CHUNK_SIZE - 1) / FWUPDATE_CHUNK_SIZE;
+}
+
+/* bytes of a chunk starting at *off* */
+static uint16_t chunk_len(uint32_t len, uint32_t off)
+{
+    return (len - off < FWUPDATE_CHUNK_SIZE) ? len - off : FWUPDATE_CHUNK_SIZE;
+}
+
+static uint16_t match_len(const uint8_t *a, const uint8_t *b, uint16_t max)
+{
+    uint16_t l = 0;
+
+    while ((l < max) && (a[l] == b[l])) {
+        l++;
+    }
+
+    return l;
+}
+
+static uint16_t delta_literal(uint8_t *out, const uint8_t *src, uint16_t n)
+{
+    uint16_t o = 0;
+
+    while (n) {
+        uint16_t l = (n > FW_OP_LEN_MAX) ? FW_OP_LEN_MAX : n;
+
+        out[o++] = l - 1;
+        memcpy(&out[o], src, l);
+        o += l;
+        src += l;
+        n -= l;
+    }
+
+    return o;
+}
+
+/*
+ * the longest run in the old image at the offset of the new bytes, at
+ * the shift of the last copy, or else in the window around them
+ */
+static uint16_t delta_match(uint32_t at, int32_t shift, uint16_t max,
+                            uint32_t *from)
+{
+    const uint8_t *src = fw_tx.image + at;
+    uint32_t cand[2] = { at, at + shift };
+    uint16_t best = 0;
+
+    for (int k = 0; k < 2; k++) {
+        if (cand[k] < fw_tx.base_len) {
+            uint32_t room = fw_tx.base_len - cand[k];
+            uint16_t l = match_len(fw_tx.base + cand[k], src,
+                                   (room < max) ? room : max);
+
+            if (l > best) {
+                best = l;
+                *from = cand[k];
+            }
+        }
+    }
+
+    if (best >= FW_COPY_MIN) {
+        return best;
+    }
+
+    uint32_t lo = (at > FWUPDATE_DELTA_WINDOW) ? at - FWUPDATE_DELTA_WINDOW : 0;
+    uint32_t hi = at + FWUPDATE_DELTA_WINDOW;
+
+    if (hi > fw_tx.base_len) {
+        hi = fw_tx.base_len;
+    }
+
+    for (uint32_t c = lo; c < hi; c++) {
+        if (fw_tx.base[c] == src[0]) {
+            uint32_t room = fw_tx.base_len - c;
+            uint16_t l = match_len(fw_tx.base + c, src,
+                                   (room < max) ? room : max);
+
+            if (l > best) {
+                best = l;
+                *from = c;
+            }
+        }
+    }
+
+    return best;
+}
+
+/* the delta of the *n* bytes of the new image at *off* */
+static uint16_t delta_encode(uint8_t *out, uint32_t off, uint16_t n)
+{
+    const uint8_t *src = fw_tx.image + off;
+    int32_t shift = 0;
+    uint16_t pos = 0, lit = 0, o = 0;
+
+    if (fw_tx.base == NULL) {
+        return delta_literal(out, src, n);
+    }
+
+    while (pos < n) {
+        uint16_t max = (n - pos > FW_OP_LEN_MAX) ? FW_OP_LEN_MAX : n - pos;
+        uint32_t from = 0;
+        uint16_t l;
+
+        if (o + 1 + lit + FW_OP_COPY_LEN > FW_DELTA_MAX) {
+            /* ops do not pay off here */
+            return delta_literal(out, src, n);
+        }
+
+        l = delta_match(off + pos, shift, max, &from);
+
+        if (l < FW_COPY_MIN) {
+            if (++lit == FW_OP_LEN_MAX) {
+                o += delta_literal(&out[o], src + pos + 1 - lit, lit);
+                lit = 0;
+            }
+
+            pos++;
+            continue;
+        }
+
+        if (lit) {
+            o += delta_literal(&out[o], src + pos - lit, lit);
+            lit = 0;
+        }
+
+        out[o] = FW_OP_COPY | (l - 1);
+        put32(&out[o + 1], from);
+        o += FW_OP_COPY_LEN;
+        shift = from - (off + pos);
+        pos += l;
+    }
+
+    if (lit) {
+        o += delta_literal(&out[o], src + pos - lit, lit);
+    }
+
+    return o;
+}
+
+static int delta_decode(uint8_t *out, uint16_t n, const uint8_t *d,
+                        uint16_t dlen)
+{
+    uint16_t pos = 0, i = 0;
+
+    while (i < dlen) {
+        uint8_t op = d[i++];
+        uint16_t l = (op & ~FW_OP_COPY) + 1;
+
+        if (pos + l > n) {
+            return -1;
+        }
+
+        if (op & FW_OP_COPY) {
+            uint32_t from;
+
+            if ((i + 4 > dlen) || (fw_rx.base == FWUPDATE_NO_BASE)) {
+                return -1;
+            }
+
+            from = get32(&d[i]);
+            i += 4;
+
+            if ((from >= fw_config->image_len) ||
+                (fw_config->image_len - from < l)) {
+                return -1;
+            }
+
+            memcpy(&out[pos], fw_config->image + from, l);
+        }
+        else {
+            if (i + l > dlen) {
+                return -1;
+            }
+
+            memcpy(&out[pos], &d[i], l);
+            i += l;
+        }
+
+        pos += l;
+    }
+
+    return (pos == n) ? 0 : -1;
+}
+
+static void fw_nack_schedule(void)
+{
+    fw_rx.nack_at = vtimer_now64() +
+                    (uint64_t)(FWUPDATE_NACK_DELAY +
+                               rand() % FWUPDATE_NACK_DELAY) * 1000;
+}
+
+/* erases the pages of the image in the slot, skipping blank ones */
+static int fw_rx_start(uint16_t version, uint16_t base, uint32_t len,
+                       uint16_t crc)
+{
+    uint8_t *slot = fw_config->slot;
+
+    DEBUG("fwupdate: receiving version %u, %lu bytes\n", version,
+          (unsigned long) len);
+
+    fw_rx.active = 0;
+    fw_rx.complete = 0;
+    fw_rx.version = version;
+    fw_rx.base = base;
+    fw_rx.len = len;
+    fw_rx.crc = crc;
+    fw_rx.pages = pages_of(len);
+    fw_rx.pages_done = 0;
+    memset(fw_rx.done, 0, sizeof(fw_rx.done));
+
+    for (int k = 0; k < FWUPDATE_PAGE_BUFS; k++) {
+        fw_pages[k].page = -1;
+    }
+
+    /* a sector holds one or more pages, erasing it blanks all of them */
+    for (uint16_t p = 0; p < fw_rx.pages; p++) {
+        uint8_t *page = slot + (uint32_t) p * FWUPDATE_PAGE_SIZE;
+        uint16_t i = 0;
+
+        while ((i < FWUPDATE_PAGE_SIZE) && (page[i] == 0xff)) {
+            i++;
+        }
+
+        if ((i < FWUPDATE_PAGE_SIZE) && !flashrom_erase(page)) {
+            DEBUG("fwupdate: cannot erase %p\n", page);
+            return -1;
+        }
+    }
+
+    fw_rx.active = 1;
+    return 0;
+}
+
+/* the buffer assembling *page*, a new one replaces the lowest page */
+static fw_page_t *fw_page_get(int32_t page)
+{
+    fw_page_t *victim = &fw_pages[0];
+
+    for (int k = 0; k < FWUPDATE_PAGE_BUFS; k++) {
+        if (fw_pages[k].page == page) {
+            return &fw_pages[k];
+        }
+
+        if ((victim->page >= 0) &&
+            ((fw_pages[k].page < 0) || (fw_pages[k].page < victim->page))) {
+            victim = &fw_pages[k];
+        }
+    }
+
+    /* the chunks of the page replaced are NACKed later */
+    victim->page = page;
+    victim->chunks = 0;
+    /* the tail of the last page */
+    memset(victim->data, 0xff, FWUPDATE_PAGE_SIZE);
+    return victim;
+}
+
+/* returns 1 if the image is complete */
+static int fw_page_write(fw_page_t *buf)
+{
+    uint8_t *dst = fw_config->slot + (uint32_t) buf->page * FWUPDATE_PAGE_SIZE;
+    uint16_t page = buf->page;
+
+    buf->page = -1;
+
+    if (!flashrom_write(dst, (char *) buf->data, FWUPDATE_PAGE_SIZE)) {
+        DEBUG("fwupdate: cannot write page %u\n", page);
+        return 0;
+    }
+
+    bit_set(fw_rx.done, page);
+
+    if (++fw_rx.pages_done < fw_rx.pages) {
+        return 0;
+    }
+
+    if (crc16(0xffff, fw_config->slot, fw_rx.len) != fw_rx.crc) {
+        DEBUG("fwupdate: image corrupt, starting over\n");
+        fw_rx_start(fw_rx.version, fw_rx.base, fw_rx.len, fw_rx.crc);
+        return 0;
+    }
+
+    fw_rx.complete = 1;
+    fw_rx.nack_at = 0;
+    return 1;
+}
+
+/* returns 1 if the image is complete */
+static int fw_handle_chunk(uint16_t len, const sockaddr6_t *sa)
+{
+    const uint8_t *msg = fw_rx_buf;
+    uint8_t chunk = msg[1];
+    uint16_t version = get16(&msg[2]);
+    uint16_t base = get16(&msg[4]);
+    uint32_t img_len = get32(&msg[6]);
+    uint16_t page = get16(&msg[10]);
+    uint16_t crc = get16(&msg[12]);
+    uint32_t off;
+    fw_page_t *buf;
+
+    if (!version_newer(version, fw_config->version) ||
+        ((base != FWUPDATE_NO_BASE) && (base != fw_config->version)) ||
+        (img_len == 0) || (img_len > fw_config->slot_size) ||
+        (pages_of(img_len) > FWUPDATE_PAGES_MAX)) {
+        return 0;
+    }
+
+    if (!fw_rx.active || (version != fw_rx.version) ||
+        (img_len != fw_rx.len) || (crc != fw_rx.crc)) {
+        if (fw_rx.active && version_newer(fw_rx.version, version)) {
+            /* an older image still in the network */
+            return 0;
+        }
+
+        if (fw_rx_start(version, base, img_len, crc) < 0) {
+            return 0;
+        }
+    }
+
+    if (fw_rx.complete) {
+        return 0;
+    }
+
+    memcpy(&fw_rx.source, &sa->sin6_addr, sizeof(ipv6_addr_t));
+    fw_rx.retries = 0;
+    fw_nack_schedule();
+
+    if ((page >= fw_rx.pages) || (chunk >= chunks_of(img_len, page)) ||
+        bit_get(fw_rx.done, page)) {
+        return 0;
+    }
+
+    buf = fw_page_get(page);
+
+    if (buf->chunks & (1 << chunk)) {
+        return 0;
+    }
+
+    off = (uint32_t) page * FWUPDATE_PAGE_SIZE + chunk * FWUPDATE_CHUNK_SIZE;
+
+    if (delta_decode(&buf->data[chunk * FWUPDATE_CHUNK_SIZE],
+                     chunk_len(img_len, off), &msg[FW_CHUNK_HDR_LEN],
+                     len - FW_CHUNK_HDR_LEN) < 0) {
+        DEBUG("fwupdate: bad delta for page %u\n", page);
+        return 0;
+    }
+
+    buf->chunks |= (1 << chunk);
+
+    if (buf->chunks != (1 << chunks_of(img_len, page)) - 1) {
+        return 0;
+    }
+
+    return fw_page_write(buf);
+}
+
+static void fw_handle_nack(void)
+{
+    const uint8_t *msg = fw_rx_buf;
+    uint16_t first = get16(&msg[4]);
+
+    if ((fw_tx.image == NULL) || (get16(&msg[2]) != fw_tx.version)) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < FWUPDATE_NACK_PAGES; i++) {
+        if (bit_get(&msg[6], i) && (first + i < fw_tx.pages)) {
+            bit_set(fw_tx.pending, first + i);
+        }
+    }
+
+    if (fw_tx.next_at == 0) {
+        fw_tx.next_at = vtimer_now64();
+    }
+}
+
+static void fw_send_nack(void)
+{
+    sockaddr6_t sa;
+    uint16_t first = 0;
+
+    if (++fw_rx.retries > FWUPDATE_NACK_RETRIES) {
+        DEBUG("fwupdate: source gone, version %u incomplete\n",
+              fw_rx.version);
+        fw_rx.nack_at = 0;
+        return;
+    }
+
+    while (bit_get(fw_rx.done, first)) {
+        first++;
+    }
+
+    memset(fw_tx_buf, 0, FW_NACK_LEN);
+    fw_tx_buf[0] = FW_MSG_NACK;
+    put16(&fw_tx_buf[2], fw_rx.version);
+    put16(&fw_tx_buf[4], first);
+
+    for (uint16_t i = 0; (i < FWUPDATE_NACK_PAGES) &&
+         (first + i < fw_rx.pages); i++) {
+        if (!bit_get(fw_rx.done, first + i)) {
+            bit_set(&fw_tx_buf[6], i);
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET6;
+    sa.sin6_port = HTONS(FWUPDATE_PORT);
+    memcpy(&sa.sin6_addr, &fw_rx.source, sizeof(ipv6_addr_t));
+
+    DEBUG("fwupdate: NACK from page %u\n", first);
+    destiny_socket_sendto(fw_sock, fw_tx_buf, FW_NACK_LEN, 0, &sa,
+                          sizeof(sa));
+    fw_nack_schedule();
+}
+
+/* the next pending page from the one being sent on, -1 if none */
+static int32_t fw_tx_pending(void)
+{
+    for (uint16_t i = 0; i < fw_tx.pages; i++) {
+        uint16_t page = (fw_tx.page + i) % fw_tx.pages;
+
+        if (bit_get(fw_tx.pending, page)) {
+            return page;
+        }
+    }
+
+    return -1;
+}
+
+/* sends the next chunk over MPL, with its UDP header */
+static void fw_send_chunk(void)
+{
+    udp_hdr_t *udp = (udp_hdr_t *) fw_tx_buf;
+    uint8_t *msg = (uint8_t *)(udp + 1);
+    int32_t page = fw_tx_pending();
+    ipv6_hdr_t pseudo;
+    uint32_t off;
+    uint16_t len, sum;
+
+    if (page < 0) {
+        fw_tx.next_at = 0;
+        return;
+    }
+
+    if (page != fw_tx.page) {
+        fw_tx.page = page;
+        fw_tx.chunk = 0;
+    }
+
+    off = (uint32_t) page * FWUPDATE_PAGE_SIZE +
+          fw_tx.chunk * FWUPDATE_CHUNK_SIZE;
+
+    msg[0] = FW_MSG_CHUNK;
+    msg[1] = fw_tx.chunk;
+    put16(&msg[2], fw_tx.version);
+    put16(&msg[4], fw_tx.base ? fw_tx.base_version : FWUPDATE_NO_BASE);
+    put32(&msg[6], fw_tx.len);
+    put16(&msg[10], page);
+    put16(&msg[12], fw_tx.crc);
+    len = FW_CHUNK_HDR_LEN +
+          delta_encode(&msg[FW_CHUNK_HDR_LEN], off, chunk_len(fw_tx.len, off));
+
+    len += sizeof(udp_hdr_t);
+    udp->src_port = HTONS(FWUPDATE_PORT);
+    udp->dst_port = HTONS(FWUPDATE_PORT);
+    udp->length = HTONS(len);
+    udp->checksum = 0;
+
+    /* the source address MPL will pick */
+    memcpy(&pseudo.destaddr, &fw_group, sizeof(ipv6_addr_t));
+    ipv6_net_if_get_best_src_addr(&pseudo.srcaddr, &fw_group);
+    sum = ~ipv6_csum(&pseudo, fw_tx_buf, len, IPPROTO_UDP);
+    /* 0 means no checksum */
+    udp->checksum = sum ? sum : 0xffff;
+
+    fw_tx.next_at = vtimer_now64() + FWUPDATE_PACE * 1000ull;
+
+    if (mpl_send(&fw_group, IPPROTO_UDP, fw_tx_buf, len) < 0) {
+        /* no MPL buffer free yet, the chunk is sent again */
+        return;
+    }
+
+    if (++fw_tx.chunk == chunks_of(fw_tx.len, page)) {
+        bit_clear(fw_tx.pending, page);
+        fw_tx.page = (page + 1) % fw_tx.pages;
+        fw_tx.chunk = 0;
+    }
+}
+
+/* ms until the next chunk or NACK is due */
+static int32_t fw_timeout(void)
+{
+    uint64_t now = vtimer_now64();
+    uint64_t due = now + FW_IDLE_MS * 1000ull;
+
+    if (fw_tx.image && fw_tx.next_at && (fw_tx.next_at < due)) {
+        due = fw_tx.next_at;
+    }
+
+    if (fw_rx.nack_at && (fw_rx.nack_at < due)) {
+        due = fw_rx.nack_at;
+    }
+
+    return (due > now) ? (int32_t)((due - now) / 1000) : 0;
+}
+
+static void fw_thread(void)
+{
+    destiny_socket_pollfd_t pfd;
+    sockaddr6_t sa;
+    socklen_t sa_len;
+    int32_t len;
+
+    fw_sock = destiny_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET6;
+    sa.sin6_port = HTONS(FWUPDATE_PORT);
+
+    if ((fw_sock < 0) ||
+        (destiny_socket_bind(fw_sock, &sa, sizeof(sa)) < 0)) {
+        DEBUG("fwupdate: cannot bind port %u\n", FWUPDATE_PORT);
+        return;
+    }
+
+    pfd.fd = fw_sock;
+    pfd.events = DESTINY_POLLIN;
+
+    while (1) {
+        int complete = 0;
+        uint64_t now;
+
+        mutex_lock(&fw_mutex);
+        len = fw_timeout();
+        mutex_unlock(&fw_mutex);
+
+        if (destiny_socket_poll(&pfd, 1, len) > 0) {
+            sa_len = sizeof(sa);
+            len = destiny_socket_recvfrom(fw_sock, fw_rx_buf,
+                                          sizeof(fw_rx_buf), 0, &sa, &sa_len);
+        }
+        else {
+            len = 0;
+        }
+
+        mutex_lock(&fw_mutex);
+
+        if ((len > FW_CHUNK_HDR_LEN) && (fw_rx_buf[0] == FW_MSG_CHUNK)) {
+            complete = fw_handle_chunk(len, &sa);
+        }
+        else if ((len >= FW_NACK_LEN) && (fw_rx_buf[0] == FW_MSG_NACK)) {
+            fw_handle_nack();
+        }
+
+        now = vtimer_now64();
+
+        if (fw_tx.image && fw_tx.next_at && (fw_tx.next_at <= now)) {
+            fw_send_chunk();
+        }
+
+        if (fw_rx.active && fw_rx.nack_at && (fw_rx.nack_at <= now)) {
+            fw_send_nack();
+        }
+
+        mutex_unlock(&fw_mutex);
+
+        if (complete && fw_config->done) {
+            fw_config->done(fw_rx.version, fw_rx.len);
+        }
+    }
+}
+
+int fwupdate_init(const fwupdate_config_t *config)
+{
+    if (fw_pid >= 0) {
+        return fw_pid;
+    }
+
+    if (mpl_init() < 0) {
+        return -1;
+    }
+
+    mutex_init(&fw_mutex);
+    fw_config = config;
+
+    /* ff03::1:f1, realm-local for MPL to forward it */
+    ipv6_addr_init(&fw_group, 0xff03, 0, 0, 0, 0, 0, 0x0001, 0x00f1);
+    ipv6_mcast_join(&fw_group);
+
+    fw_pid = thread_create(fw_stack, FWUPDATE_STACKSIZE, FWUPDATE_PRIORITY,
+                           CREATE_STACKTEST, fw_thread, "fwupdate");
+
+    return fw_pid;
+}
+
+int fwupdate_send(const uint8_t *image, uint32_t len, uint16_t version,
+                  const uint8_t *base, uint32_t base_len,
+                  uint16_t base_version)
+{
+    uint16_t pages = pages_of(len);
+
+    if ((fw_pid < 0) || (len == 0) || (pages > FWUPDATE_PAGES_MAX)) {
+        return -1;
+    }
+
+    mutex_lock(&fw_mutex);
+
+    fw_tx.image = image;
+    fw_tx.len = len;
+    fw_tx.version = version;
+    fw_tx.base = base;
+    fw_tx.base_len = base ? base_len : 0;
+    fw_tx.base_version = base_version;
+    fw_tx.crc = crc16(0xffff, image, len);
+    fw_tx.pages = pages;
+    fw_tx.page = 0;
+    fw_tx.chunk = 0;
+    memset(fw_tx.pending, 0, sizeof(fw_tx.pending));
+
+    for (uint16_t p = 0; p < pages; p++) {
+        bit_set(fw_tx.pending, p);
+    }
+
+    fw_tx.next_at = vtimer_now64();
+
+    mutex_unlock(&fw_mutex);
+    return 0;
+}
+
+void fwupdate_stop(void)
+{
+    mutex_lock(&fw_mutex);
+    fw_tx.image = NULL;
+    fw_tx.next_at = 0;
+    mutex_unlock(&fw_mutex);
+}
+
+void fwupdate_status(fwupdate_status_t *status)
+{
+    mutex_lock(&fw_mutex);
+    status->version = fw_rx.active ? fw_rx.version : 0;
+    status->pages = fw_rx.active ? fw_rx.pages : 0;
+    status->pages_done = fw_rx.active ? fw_rx.pages_done : 0;
+    status->complete = fw_rx.complete;
+    mutex_unlock(&fw_mutex);
+}
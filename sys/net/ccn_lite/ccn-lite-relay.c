@@ -42,6 +42,7 @@
 #include "thread.h"
 #include "transceiver.h"
 #include "hwtimer.h"
+#include "irq.h"
 
 #include "ccnl-riot-compat.h"
 #include "ccn_lite/test_data/text.txt.ccnb.h"
@@ -52,6 +53,17 @@
 /** message buffer */
 msg_t msg_buffer_relay[RELAY_MSG_BUFFER_SIZE];
 
+/** Messages handled before what they caused is sent */
+#define RELAY_MSG_BURST (8)
+
+/** Radio frame the transceiver interface packs its queued packets into */
+static unsigned char trans_frame[PAYLOAD_SIZE];
+
+#ifdef MODULE_CCN_LITE_UDP
+/** Datagram the UDP interface packs its queued packets into */
+static unsigned char udp_frame[CCNL_UDP_MTU];
+#endif
+
 // ----------------------------------------------------------------------
 
 struct ccnl_relay_s theRelay;
@@ -144,6 +156,32 @@ void ccnl_nonce_timeout(void *relay, void *aux)
 
 // ----------------------------------------------------------------------
 
+/** The interfaces of the relay, in the order of their RIOT_*_IDX */
+static const struct {
+    const char *name;
+    int idx;
+    int (*open)(void);
+    int (*sendfunc)(uint8_t *, uint16_t, uint16_t);
+    int mtu;
+    unsigned char *frame;   ///< NULL sends the queued packets one by one
+    int framelen;
+    int broadcast;          ///< has a static broadcast face
+} relay_ifs[] = {
+    { "msg", RIOT_MSG_IDX, ccnl_open_riotmsgdev, riot_send_msg, 4000,
+      NULL, 0, 0 },
+#ifdef USE_FRAG
+    { "trans", RIOT_TRANS_IDX, ccnl_open_riottransdev, riot_send_transceiver,
+      120, trans_frame, sizeof(trans_frame), 1 },
+#else
+    { "trans", RIOT_TRANS_IDX, ccnl_open_riottransdev, riot_send_transceiver,
+      1500, trans_frame, sizeof(trans_frame), 1 },
+#endif
+#ifdef MODULE_CCN_LITE_UDP
+    { "udp", RIOT_UDP_IDX, ccnl_open_riotudpdev, riot_send_udp,
+      CCNL_UDP_MTU, udp_frame, sizeof(udp_frame), 1 },
+#endif
+};
+
 void ccnl_relay_config(struct ccnl_relay_s *relay, int max_cache_entries, int fib_threshold_prefix, int fib_threshold_aggregate)
 {
     struct ccnl_if_s *i;
@@ -151,63 +189,49 @@ void ccnl_relay_config(struct ccnl_relay_s *relay, int max_cache_entries, int fi
     DEBUGMSG(99, "ccnl_relay_config\n");
 
     relay->max_cache_entries = max_cache_entries;
+    relay->cache_policy = CCNL_CACHE_ALL;
+    relay->cache_prob = CCNL_CACHE_PROBABILITY;
     relay->fib_threshold_prefix = fib_threshold_prefix;
     relay->fib_threshold_aggregate = fib_threshold_aggregate;
+    ccnl_nonce_init(relay);
 
-    if (RIOT_MSG_IDX != relay->ifcount) {
-        DEBUGMSG(1, "sorry, idx did not match: riot msg device\n");
-    }
+    for (unsigned k = 0; k < sizeof(relay_ifs) / sizeof(relay_ifs[0]); k++) {
+        if (relay_ifs[k].idx != relay->ifcount) {
+            DEBUGMSG(1, "sorry, idx did not match: riot %s device\n",
+                     relay_ifs[k].name);
+        }
 
-    i = &relay->ifs[relay->ifcount];
-    i->sock = ccnl_open_riotmsgdev();
-    i->sendfunc = &riot_send_msg;
-    i->mtu = 4000;
-    i->reflect = 0;
-    i->fwdalli = 0;
+        i = &relay->ifs[relay->ifcount];
+        i->sock = relay_ifs[k].open();
+        i->sendfunc = relay_ifs[k].sendfunc;
+        i->mtu = relay_ifs[k].mtu;
+        i->reflect = 0;
+        i->fwdalli = 0;
+        i->frame = relay_ifs[k].frame;
+        i->framelen = i->mtu < relay_ifs[k].framelen ? i->mtu
+                      : relay_ifs[k].framelen;
+
+        if (i->sock < 0) {
+            DEBUGMSG(1, "sorry, could not open riot %s device\n",
+                     relay_ifs[k].name);
+            continue;
+        }
 
-    if (i->sock >= 0) {
         relay->ifcount++;
 
         if (relay->defaultInterfaceScheduler) {
             i->sched = relay->defaultInterfaceScheduler(relay,
                        ccnl_interface_CTS);
         }
-    }
-    else {
-        DEBUGMSG(1, "sorry, could not open riot msg device\n");
-    }
-
-    if (RIOT_TRANS_IDX != relay->ifcount) {
-        DEBUGMSG(1, "sorry, idx did not match: riot trans device\n");
-    }
-
-    i = &relay->ifs[relay->ifcount];
-    i->sock = ccnl_open_riottransdev();
-    i->sendfunc = &riot_send_transceiver;
-#ifdef USE_FRAG
-    i->mtu = 120;
-#else
-    i->mtu = 1500;
-#endif
-    i->reflect = 0;
-    i->fwdalli = 0;
-
-    if (i->sock >= 0) {
-        relay->ifcount++;
 
-        if (relay->defaultInterfaceScheduler) {
-            i->sched = relay->defaultInterfaceScheduler(relay,
-                       ccnl_interface_CTS);
+        if (relay_ifs[k].broadcast) {
+            /* create default boardcast face on the interface */
+            struct ccnl_face_s *f = ccnl_get_face_or_create(relay,
+                                    relay_ifs[k].idx, RIOT_BROADCAST);
+            f->flags |= CCNL_FACE_FLAGS_STATIC;
+            i->broadcast_face = f;
         }
     }
-    else {
-        DEBUGMSG(1, "sorry, could not open riot trans device\n");
-    }
-
-    /* create default boardcast face on transceiver interface */
-    struct ccnl_face_s * f = ccnl_get_face_or_create(relay, RIOT_TRANS_IDX, RIOT_BROADCAST);
-    f->flags |= CCNL_FACE_FLAGS_STATIC;
-    i->broadcast_face = f;
 
     ccnl_set_timer(TIMEOUT_TO_US(CCNL_CHECK_TIMEOUT_SEC, CCNL_CHECK_TIMEOUT_USEC), ccnl_ageing, relay, 0);
     ccnl_set_timer(TIMEOUT_TO_US(CCNL_CHECK_RETRANSMIT_SEC, CCNL_CHECK_RETRANSMIT_USEC), ccnl_retransmit, relay, 0);
@@ -301,15 +325,141 @@ void handle_populate_cache(void)
 
 // ----------------------------------------------------------------------
 
+/* the hwtimer of the relay, armed for the first event of the eventqueue */
+static int relay_timer = -1;
+static struct timeval relay_timer_deadline;
+
+/* shorter delays are rounded up, the hwtimer may miss them */
+#define RELAY_TIMER_MIN_USEC    (1000)
+
 void ccnl_timeout_callback(void *ptr)
 {
     struct ccnl_relay_s *ccnl = ptr;
 
+    relay_timer = -1;
+
     msg_t ccnl_timeout_msg;
     ccnl_timeout_msg.type = CCNL_RIOT_TIMEOUT;
     msg_send(&ccnl_timeout_msg, ccnl->riot_pid, false);
 }
 
+static void ccnl_relay_timer_remove(void)
+{
+    unsigned state = disableIRQ();
+
+    /* the callback marks a fired timer, its slot may be in use again */
+    if (relay_timer >= 0) {
+        hwtimer_remove(relay_timer);
+        relay_timer = -1;
+    }
+
+    restoreIRQ(state);
+}
+
+/* arms the timer for the first event, unless it is armed for it already */
+static void ccnl_relay_timer_update(struct ccnl_relay_s *ccnl, struct timeval *delay)
+{
+    unsigned long us;
+
+    if ((relay_timer >= 0)
+        && (timevaldelta(&eventqueue->timeout, &relay_timer_deadline) == 0)) {
+        return;
+    }
+
+    ccnl_relay_timer_remove();
+
+    us = delay->tv_sec * 1000 * 1000 + delay->tv_usec;
+
+    if (us < RELAY_TIMER_MIN_USEC) {
+        us = RELAY_TIMER_MIN_USEC;
+    }
+
+    relay_timer_deadline = eventqueue->timeout;
+    relay_timer = hwtimer_set(HWTIMER_TICKS(us), ccnl_timeout_callback, ccnl);
+
+    if (relay_timer == -1) {
+        puts("NO MORE TIMERS!");
+    }
+}
+
+static void ccnl_io_handle(struct ccnl_relay_s *ccnl, msg_t *in)
+{
+    radio_packet_t *p;
+    riot_ccnl_msg_t *m;
+
+    switch (in->type) {
+        case PKT_PENDING:
+            /* msg from transceiver */
+            p = (radio_packet_t *) in->content.ptr;
+            DEBUGMSG(1, "\tLength:\t%u\n", p->length);
+            DEBUGMSG(1, "\tSrc:\t%u\n", p->src);
+            DEBUGMSG(1, "\tDst:\t%u\n", p->dst);
+
+            // p->src must be > 0
+            if (!p->src) {
+                p->src = RIOT_BROADCAST;
+            }
+
+            ccnl_core_RX(ccnl, RIOT_TRANS_IDX, (unsigned char *) p->data, (int) p->length, p->src);
+            transceiver_release(p);
+            break;
+
+        case (CCNL_RIOT_MSG):
+            /* msg from device local client */
+            m = (riot_ccnl_msg_t *) in->content.ptr;
+            DEBUGMSG(1, "\tLength:\t%u\n", m->size);
+            DEBUGMSG(1, "\tSrc:\t%u\n", in->sender_pid);
+
+            ccnl_core_RX(ccnl, RIOT_MSG_IDX, (unsigned char *) m->payload, m->size,
+                         in->sender_pid);
+            break;
+
+#ifdef MODULE_CCN_LITE_UDP
+        case (CCNL_RIOT_UDP):
+            /* datagram from the UDP interface */
+            ccnl_udp_RX(ccnl, in->content.ptr);
+            break;
+#endif
+
+        case (CCNL_RIOT_HALT):
+            /* cmd to stop the relay */
+            DEBUGMSG(1, "\tSrc:\t%u\n", in->sender_pid);
+            DEBUGMSG(1, "\tNumb:\t%" PRIu32 "\n", in->content.value);
+
+            ccnl->halt_flag = 1;
+            break;
+
+#if RIOT_CCNL_POPULATE
+        case (CCNL_RIOT_POPULATE):
+            /* cmd to polulate the cache */
+            DEBUGMSG(1, "\tSrc:\t%u\n", in->sender_pid);
+            DEBUGMSG(1, "\tNumb:\t%" PRIu32 "\n", in->content.value);
+
+            handle_populate_cache();
+            break;
+#endif
+        case (CCNL_RIOT_PRINT_STAT):
+            /* cmd to print face statistics */
+            for (struct ccnl_face_s *f = ccnl->faces; f; f = f->next) {
+                ccnl_face_print_stat(f);
+            }
+            break;
+        case (CCNL_RIOT_TIMEOUT):
+            /* ccn timeout from hwtimer, the events run at the top of
+             * the loop */
+            break;
+        case (ENOBUFFER):
+            /* transceiver has not enough buffer to store incoming packets, one packet is dropped  */
+            DEBUGMSG(1, "transceiver: one packet is dropped because buffers are full\n");
+            break;
+        default:
+            DEBUGMSG(1, "%s Packet waiting\n", riot_ccnl_event_to_string(in->type));
+            DEBUGMSG(1, "\tSrc:\t%u\n", in->sender_pid);
+            DEBUGMSG(1, "\tdropping it...\n");
+            break;
+    }
+}
+
 int ccnl_io_loop(struct ccnl_relay_s *ccnl)
 {
     if (ccnl->ifcount == 0) {
@@ -324,98 +474,30 @@ int ccnl_io_loop(struct ccnl_relay_s *ccnl)
         return -1;
     }
 
-    msg_t in;
-    radio_packet_t *p;
-    riot_ccnl_msg_t *m;
+    msg_t in[RELAY_MSG_BURST];
     struct timeval *timeout;
-    unsigned long us = CCNL_CHECK_RETRANSMIT_USEC;
-    int hwtimer_id;
 
     while (!ccnl->halt_flag) {
-        hwtimer_id = hwtimer_set(HWTIMER_TICKS(us), ccnl_timeout_callback, ccnl);
-        if (hwtimer_id == -1) {
-            puts("NO MORE TIMERS!");
-        }
-        else {
-            //DEBUGMSG(1, "hwtimer_id is %d\n", hwtimer_id);
+        /* one timer for all events, kept armed while messages come in */
+        timeout = ccnl_run_events();
+
+        if (timeout) {
+            ccnl_relay_timer_update(ccnl, timeout);
         }
-        msg_receive(&in);
-        //DEBUGMSG(1, "%s Packet waiting, us was %lu\n", riot_ccnl_event_to_string(in.type), us);
-
-        switch (in.type) {
-            case PKT_PENDING:
-                /* msg from transceiver */
-                hwtimer_remove(hwtimer_id);
-                p = (radio_packet_t *) in.content.ptr;
-                DEBUGMSG(1, "\tLength:\t%u\n", p->length);
-                DEBUGMSG(1, "\tSrc:\t%u\n", p->src);
-                DEBUGMSG(1, "\tDst:\t%u\n", p->dst);
-
-                // p->src must be > 0
-                if (!p->src) {
-                    p->src = RIOT_BROADCAST;
-                }
-
-                ccnl_core_RX(ccnl, RIOT_TRANS_IDX, (unsigned char *) p->data, (int) p->length, p->src);
-                p->processing--;
-                break;
-
-            case (CCNL_RIOT_MSG):
-                /* msg from device local client */
-                hwtimer_remove(hwtimer_id);
-                m = (riot_ccnl_msg_t *) in.content.ptr;
-                DEBUGMSG(1, "\tLength:\t%u\n", m->size);
-                DEBUGMSG(1, "\tSrc:\t%u\n", in.sender_pid);
-
-                ccnl_core_RX(ccnl, RIOT_MSG_IDX, (unsigned char *) m->payload, m->size,
-                             in.sender_pid);
-                break;
-
-            case (CCNL_RIOT_HALT):
-                /* cmd to stop the relay */
-                hwtimer_remove(hwtimer_id);
-                DEBUGMSG(1, "\tSrc:\t%u\n", in.sender_pid);
-                DEBUGMSG(1, "\tNumb:\t%" PRIu32 "\n", in.content.value);
-
-                ccnl->halt_flag = 1;
-                break;
 
-#if RIOT_CCNL_POPULATE
-            case (CCNL_RIOT_POPULATE):
-                /* cmd to polulate the cache */
-                hwtimer_remove(hwtimer_id);
-                DEBUGMSG(1, "\tSrc:\t%u\n", in.sender_pid);
-                DEBUGMSG(1, "\tNumb:\t%" PRIu32 "\n", in.content.value);
-
-                handle_populate_cache();
-                break;
-#endif
-            case (CCNL_RIOT_PRINT_STAT):
-                /* cmd to print face statistics */
-                hwtimer_remove(hwtimer_id);
-                for (struct ccnl_face_s *f = ccnl->faces; f; f = f->next) {
-                    ccnl_face_print_stat(f);
-                }
-                break;
-            case (CCNL_RIOT_TIMEOUT):
-                /* ccn timeout from hwtimer, run pending events */
-                timeout = ccnl_run_events();
-                us = timeout->tv_sec * 1000 * 1000 + timeout->tv_usec;
-                break;
-            case (ENOBUFFER):
-                /* transceiver has not enough buffer to store incoming packets, one packet is dropped  */
-                hwtimer_remove(hwtimer_id);
-                DEBUGMSG(1, "transceiver: one packet is dropped because buffers are full\n");
-                break;
-            default:
-                hwtimer_remove(hwtimer_id);
-                DEBUGMSG(1, "%s Packet waiting\n", riot_ccnl_event_to_string(in.type));
-                DEBUGMSG(1, "\tSrc:\t%u\n", in.sender_pid);
-                DEBUGMSG(1, "\tdropping it...\n");
-                break;
+        /* packets queued by the last burst and the events leave in as
+         * few frames as possible */
+        ccnl_interface_flush(ccnl);
+
+        int n = msg_receive_many(in, RELAY_MSG_BURST);
+
+        for (int k = 0; k < n; k++) {
+            ccnl_io_handle(ccnl, &in[k]);
         }
     }
 
+    ccnl_interface_flush(ccnl);
+    ccnl_relay_timer_remove();
     return 0;
 }
 
@@ -436,9 +518,11 @@ void ccnl_riot_relay_start(int max_cache_entries, int fib_threshold_prefix, int
     DEBUGMSG(1, "  threshold_aggregate: %d\n", fib_threshold_aggregate);
 
     ccnl_relay_config(&theRelay, max_cache_entries, fib_threshold_prefix, fib_threshold_aggregate);
+    ccnl_store_init(&theRelay);
 
     ccnl_io_loop(&theRelay);
     DEBUGMSG(1, "ioloop stopped\n");
+    ccnl_store_sync(&theRelay);
 
     while (eventqueue) {
         ccnl_rem_timer(eventqueue);
@@ -36,11 +36,16 @@
 #include "ccnl-includes.h"
 
 #include "ccnl-riot-compat.h"
+#include "random.h"
 
 #define CCNL_DYNAMIC_FIB (0)
 
 static struct ccnl_interest_s *ccnl_interest_remove(struct ccnl_relay_s *ccnl,
         struct ccnl_interest_s *i);
+static int ccnl_content_serve_bucket(struct ccnl_relay_s *ccnl,
+                                     struct ccnl_content_s *c,
+                                     struct ccnl_face_s *from,
+                                     int compcnt, uint32_t h);
 
 void ccnl_ll_TX(struct ccnl_relay_s *ccnl, struct ccnl_if_s *ifc,
                 sockunion *dest, struct ccnl_buf_s *buf);
@@ -147,6 +152,44 @@ done:
     return rc;
 }
 
+// ----------------------------------------------------------------------
+// name hash index for content store and PIT
+
+#define CCNL_HASH_INIT          2166136261u
+#define CCNL_HASH_PRIME         16777619u
+#define CCNL_INDEX_BUCKET(h)    ((h) & (CCNL_INDEX_BUCKETS - 1))
+
+// components an aggregated route has in common with the ones it replaces
+#define CCNL_FIB_AGGR_LEN(relay) \
+    ((relay)->fib_threshold_aggregate > 0 ? (relay)->fib_threshold_aggregate : 0)
+
+// extends the hash h of a name prefix by one more component
+static uint32_t ccnl_hash_comp(uint32_t h, unsigned char *comp, int complen)
+{
+    h = (h ^ (uint32_t) complen) * CCNL_HASH_PRIME;
+
+    for (int i = 0; i < complen; i++) {
+        h = (h ^ comp[i]) * CCNL_HASH_PRIME;
+    }
+
+    return h;
+}
+
+uint32_t ccnl_hash_prefix(struct ccnl_prefix_s *p, int compcnt)
+{
+    uint32_t h = CCNL_HASH_INIT;
+
+    if (p->hash) {
+        return compcnt ? p->hash[compcnt - 1] : h;
+    }
+
+    for (int i = 0; i < compcnt; i++) {
+        h = ccnl_hash_comp(h, p->comp[i], p->complen[i]);
+    }
+
+    return h;
+}
+
 // ----------------------------------------------------------------------
 // ccnb parsing support
 
@@ -208,60 +251,44 @@ static int data2uint(unsigned char *cp, int len)
     return val;
 }
 
-struct ccnl_nonce_s *ccnl_nonce_new(struct ccnl_buf_s *that)
+void ccnl_nonce_init(struct ccnl_relay_s *ccnl)
 {
-    struct ccnl_nonce_s *n = (struct ccnl_nonce_s *) ccnl_malloc(sizeof(struct ccnl_nonce_s));
-
-    n->buf = buf_dup(that);
-    ccnl_get_timeval(&n->created);
-
-    n->next = NULL;
-    n->prev = NULL;
+    for (int k = 0; k < 2; k++) {
+        bloom_init(ccnl->nonce_bloom + k, CCNL_NONCE_BLOOM_BITS,
+                   ccnl->nonce_bits[k], CCNL_NONCE_BLOOM_HASHES, 0,
+                   BLOOM_DOUBLE_HASH);
+    }
 
-    return n;
+    ccnl->nonce_slice = 0;
+    ccnl->nonce_cnt = 0;
 }
 
-struct ccnl_nonce_s *ccnl_nonce_remove(struct ccnl_relay_s *ccnl, struct ccnl_nonce_s *nonce)
+// forgets the nonces of the older slice, which then takes new nonces
+static void ccnl_nonce_rotate(struct ccnl_relay_s *ccnl)
 {
-    DEBUGMSG(99, "ccnl_nonce_remove: %u:%u:%u:%u\n",
-             nonce->buf->data[0], nonce->buf->data[1], nonce->buf->data[2], nonce->buf->data[3]);
-
-    struct ccnl_nonce_s *next = nonce->next;
-    DBL_LINKED_LIST_REMOVE(ccnl->nonces, nonce);
-
-    free(nonce->buf);
-    free(nonce);
-
-    return next;
+    ccnl->nonce_slice ^= 1;
+    memset(ccnl->nonce_bits[ccnl->nonce_slice], 0,
+           sizeof(ccnl->nonce_bits[0]));
+    ccnl->nonce_cnt = 0;
 }
 
-struct ccnl_buf_s *
-ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
-                               int *aok, int *min, int *max, struct ccnl_prefix_s **prefix,
-                               struct ccnl_buf_s **nonce, struct ccnl_buf_s **ppkd,
-                               unsigned char **content, int *contlen)
+// parses an interest or content object, *data points behind its dtag
+int ccnl_parse(unsigned char **data, int *datalen, struct ccnl_parsed_s *pkt)
 {
-    unsigned char *start = *data - 2, *cp;
+    struct ccnl_prefix_s *p = &pkt->prefix;
+    unsigned char *cp;
     int num, typ, len;
-    struct ccnl_prefix_s *p;
-    struct ccnl_buf_s *buf, *n = 0, *pub = 0;
-    DEBUGMSG(99, "ccnl_extract_prefix\n");
-
-    p = (struct ccnl_prefix_s *) ccnl_calloc(1, sizeof(struct ccnl_prefix_s));
-
-    if (!p) {
-        puts("can't get more memory from malloc, dropping ccn msg...");
-        return NULL;
-    }
-
-    p->comp = (unsigned char **) ccnl_malloc(
-                  CCNL_MAX_NAME_COMP * sizeof(unsigned char **));
-    p->complen = (int *) ccnl_malloc(CCNL_MAX_NAME_COMP * sizeof(int));
-
-    if (!p->comp || !p->complen) {
-        puts("can't get more memory from malloc, dropping ccn msg...");
-        goto Bail;
-    }
+    uint32_t h = CCNL_HASH_INIT;
+    DEBUGMSG(99, "ccnl_parse\n");
+
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->pkt = *data - 2;
+    pkt->scope = 3;
+    pkt->aok = 3;
+    pkt->maxsfx = CCNL_MAX_NAME_COMP;
+    p->comp = pkt->comp;
+    p->complen = pkt->complen;
+    p->hash = pkt->hash;
 
     while (dehead(data, datalen, &num, &typ) == 0) {
         if (num == 0 && typ == 0) {
@@ -272,7 +299,7 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
             if (num == CCN_DTAG_NAME) {
                 while (1) {
                     if (dehead(data, datalen, &num, &typ) != 0) {
-                        goto Bail;
+                        return -1;
                     }
 
                     if (num == 0 && typ == 0) {
@@ -283,14 +310,16 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
                         && p->compcnt < CCNL_MAX_NAME_COMP) {
                         if (hunt_for_end(data, datalen, p->comp + p->compcnt,
                                          p->complen + p->compcnt) < 0) {
-                            goto Bail;
+                            return -1;
                         }
 
-                        p->compcnt++;
+                        h = ccnl_hash_comp(h, p->comp[p->compcnt],
+                                           p->complen[p->compcnt]);
+                        p->hash[p->compcnt++] = h;
                     }
                     else {
                         if (consume(typ, num, data, datalen, 0, 0) < 0) {
-                            goto Bail;
+                            return -1;
                         }
                     }
                 }
@@ -303,31 +332,33 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
                 || num == CCN_DTAG_MAXSUFFCOMP
                 || num == CCN_DTAG_PUBPUBKDIGEST) {
                 if (hunt_for_end(data, datalen, &cp, &len) < 0) {
-                    goto Bail;
+                    return -1;
                 }
 
-                if (num == CCN_DTAG_SCOPE && len == 1 && scope) {
-                    *scope = isdigit(*cp) && (*cp < '3') ? *cp - '0' : -1;
+                if (num == CCN_DTAG_SCOPE && len == 1) {
+                    pkt->scope = isdigit(*cp) && (*cp < '3') ? *cp - '0' : -1;
                 }
 
-                if (num == CCN_DTAG_ANSWERORIGKIND && aok) {
-                    *aok = data2uint(cp, len);
+                if (num == CCN_DTAG_ANSWERORIGKIND) {
+                    pkt->aok = data2uint(cp, len);
                 }
 
-                if (num == CCN_DTAG_MINSUFFCOMP && min) {
-                    *min = data2uint(cp, len);
+                if (num == CCN_DTAG_MINSUFFCOMP) {
+                    pkt->minsfx = data2uint(cp, len);
                 }
 
-                if (num == CCN_DTAG_MAXSUFFCOMP && max) {
-                    *max = data2uint(cp, len);
+                if (num == CCN_DTAG_MAXSUFFCOMP) {
+                    pkt->maxsfx = data2uint(cp, len);
                 }
 
-                if (num == CCN_DTAG_NONCE && !n) {
-                    n = ccnl_buf_new(cp, len);
+                if (num == CCN_DTAG_NONCE && !pkt->nonce) {
+                    pkt->nonce = cp;
+                    pkt->noncelen = len;
                 }
 
-                if (num == CCN_DTAG_PUBPUBKDIGEST && !pub) {
-                    pub = ccnl_buf_new(cp, len);
+                if (num == CCN_DTAG_PUBPUBKDIGEST && !pkt->ppkd) {
+                    pkt->ppkd = cp;
+                    pkt->ppkdlen = len;
                 }
 
                 if (num == CCN_DTAG_EXCLUDE) {
@@ -339,8 +370,9 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
             }
 
             if (num == CCN_DTAG_CONTENT || num == CCN_DTAG_CONTENTOBJ) {
-                if (consume(typ, num, data, datalen, content, contlen) < 0) {
-                    goto Bail;
+                if (consume(typ, num, data, datalen, &pkt->content,
+                            &pkt->contlen) < 0) {
+                    return -1;
                 }
 
                 continue;
@@ -348,12 +380,83 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
         }
 
         if (consume(typ, num, data, datalen, 0, 0) < 0) {
-            goto Bail;
+            return -1;
         }
     }
 
+    p->comp[p->compcnt] = NULL;
+    pkt->pktlen = *data - pkt->pkt;
+    return 0;
+}
+
+// copies a parsed packet and its name to the heap, for keeping it,
+// the name and the content point into the returned buffer
+struct ccnl_buf_s *
+ccnl_parsed_copy(struct ccnl_parsed_s *pkt, struct ccnl_prefix_s **prefix,
+                 unsigned char **content)
+{
+    int compcnt = pkt->prefix.compcnt;
+    struct ccnl_prefix_s *p;
+    struct ccnl_buf_s *buf;
+
+    buf = ccnl_buf_new(pkt->pkt, pkt->pktlen);
+    p = (struct ccnl_prefix_s *) ccnl_calloc(1, sizeof(struct ccnl_prefix_s));
+
+    if (!buf || !p) {
+        goto Bail;
+    }
+
+    p->comp = (unsigned char **) ccnl_malloc((compcnt + 1) * sizeof(unsigned char *));
+    p->complen = (int *) ccnl_malloc((compcnt + 1) * sizeof(int));
+
+    if (!p->comp || !p->complen) {
+        goto Bail;
+    }
+
+    // carefully rebase ptrs to new buf because of 64bit pointers:
+    for (int k = 0; k < compcnt; k++) {
+        p->comp[k] = buf->data + (pkt->comp[k] - pkt->pkt);
+        p->complen[k] = pkt->complen[k];
+    }
+
+    p->comp[compcnt] = NULL;
+    p->compcnt = compcnt;
+
+    if (content) {
+        *content = pkt->content ? buf->data + (pkt->content - pkt->pkt) : NULL;
+    }
+
+    *prefix = p;
+    return buf;
+Bail:
+    puts("can't get more memory from malloc, dropping ccn msg...");
+    free_prefix(p);
+    ccnl_free(buf);
+    return NULL;
+}
+
+struct ccnl_buf_s *
+ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
+                               int *aok, int *min, int *max, struct ccnl_prefix_s **prefix,
+                               struct ccnl_buf_s **nonce, struct ccnl_buf_s **ppkd,
+                               unsigned char **content, int *contlen)
+{
+    struct ccnl_parsed_s pkt;
+    struct ccnl_prefix_s *p;
+    struct ccnl_buf_s *buf;
+    DEBUGMSG(99, "ccnl_extract_prefix\n");
+
+    if (ccnl_parse(data, datalen, &pkt) < 0) {
+        return NULL;
+    }
+
+    buf = ccnl_parsed_copy(&pkt, &p, content);
+
+    if (!buf) {
+        return NULL;
+    }
+
     if (prefix) {
-        p->comp[p->compcnt] = NULL;
         *prefix = p;
     }
     else {
@@ -361,39 +464,83 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
     }
 
     if (nonce) {
-        *nonce = n;
-    }
-    else {
-        ccnl_free(n);
+        *nonce = pkt.nonce ? ccnl_buf_new(pkt.nonce, pkt.noncelen) : NULL;
     }
 
     if (ppkd) {
-        *ppkd = pub;
+        *ppkd = pkt.ppkd ? ccnl_buf_new(pkt.ppkd, pkt.ppkdlen) : NULL;
     }
-    else {
-        ccnl_free(pub);
+
+    if (scope) {
+        *scope = pkt.scope;
     }
 
-    buf = ccnl_buf_new(start, *data - start);
+    if (aok) {
+        *aok = pkt.aok;
+    }
 
-    if (!buf) {
-        puts("can't get more memory from malloc, dropping ccn msg...");
+    if (min) {
+        *min = pkt.minsfx;
     }
 
-    // carefully rebase ptrs to new buf because of 64bit pointers:
-    if (content) {
-        *content = buf->data + (*content - start);
+    if (max) {
+        *max = pkt.maxsfx;
     }
 
-    for (num = 0; num < p->compcnt; num++) {
-        p->comp[num] = buf->data + (p->comp[num] - start);
+    if (contlen) {
+        *contlen = pkt.contlen;
     }
 
     return buf;
-Bail:
-    free_prefix(p);
-    free_2ptr_list(n, pub);
-    return NULL;
+}
+
+// ----------------------------------------------------------------------
+// lists ordered by last_used, for ageing without a sweep over all entries
+
+static void ccnl_age_push(struct ccnl_age_list_s *l, struct ccnl_age_s *a)
+{
+    a->older = l->newest;
+    a->newer = NULL;
+
+    if (l->newest) {
+        l->newest->newer = a;
+    }
+    else {
+        l->oldest = a;
+    }
+
+    l->newest = a;
+}
+
+static void ccnl_age_unlink(struct ccnl_age_list_s *l, struct ccnl_age_s *a)
+{
+    if (a->newer) {
+        a->newer->older = a->older;
+    }
+    else {
+        l->newest = a->older;
+    }
+
+    if (a->older) {
+        a->older->newer = a->newer;
+    }
+    else {
+        l->oldest = a->newer;
+    }
+
+    a->newer = a->older = NULL;
+}
+
+// sets last_used to now, which makes the entry the newest of its list
+static void ccnl_age_touch(struct ccnl_age_list_s *l, struct ccnl_age_s *a,
+                           struct timeval *last_used)
+{
+    ccnl_get_timeval(last_used);
+
+    if (l->newest != a) {
+        ccnl_age_unlink(l, a);
+        ccnl_age_push(l, a);
+    }
 }
 
 // ----------------------------------------------------------------------
@@ -414,7 +561,7 @@ ccnl_get_face_or_create(struct ccnl_relay_s *ccnl, int ifndx, uint16_t sender_id
     for (f = ccnl->faces; f; f = f->next) {
         if (ifndx == f->ifndx && (f->faceid == sender_id)) {
             DEBUGMSG(1, "face found! ifidx=%d sender_id=%d faceid=%d\n", ifndx, sender_id, f->faceid);
-            ccnl_get_timeval(&f->last_used);
+            ccnl_age_touch(&ccnl->face_age, &f->age, &f->last_used);
             return f;
         }
     }
@@ -468,6 +615,7 @@ ccnl_get_face_or_create(struct ccnl_relay_s *ccnl, int ifndx, uint16_t sender_id
 #endif
 
     ccnl_get_timeval(&f->last_used);
+    ccnl_age_push(&ccnl->face_age, &f->age);
     DBL_LINKED_LIST_ADD(ccnl->faces, f);
 
     return f;
@@ -532,6 +680,7 @@ ccnl_face_remove(struct ccnl_relay_s *ccnl, struct ccnl_face_s *f)
 
     f2 = f->next;
     DBL_LINKED_LIST_REMOVE(ccnl->faces, f);
+    ccnl_age_unlink(&ccnl->face_age, &f->age);
     ccnl_free(f);
     return f2;
 }
@@ -574,6 +723,8 @@ void ccnl_interface_CTS(void *aux1, void *aux2)
     struct ccnl_relay_s *ccnl = (struct ccnl_relay_s *) aux1;
     struct ccnl_if_s *ifc = (struct ccnl_if_s *) aux2;
     struct ccnl_txrequest_s *r, req;
+    unsigned int len;
+    int cnt = 1;
     DEBUGMSG(25, "ccnl_interface_CTS interface=%p, qlen=%d, sched=%p\n",
              (void *) ifc, ifc->qlen, (void *) ifc->sched);
 
@@ -586,8 +737,51 @@ void ccnl_interface_CTS(void *aux1, void *aux2)
     ifc->qfront = (ifc->qfront + 1) % CCNL_MAX_IF_QLEN;
     ifc->qlen--;
 
-    ccnl_ll_TX(ccnl, ifc, &req.dst, req.buf);
-    ccnl_free(req.buf);
+    if (!ifc->frame || req.buf->datalen > (unsigned int) ifc->framelen) {
+        ccnl_ll_TX(ccnl, ifc, &req.dst, req.buf);
+        ccnl_free(req.buf);
+        return;
+    }
+
+    // the following packets to the same peer go into the same frame as
+    // long as it has room, the receiver parses a datagram packet by packet
+    len = 0;
+
+    while (1) {
+        memcpy(ifc->frame + len, req.buf->data, req.buf->datalen);
+        len += req.buf->datalen;
+        ccnl_free(req.buf);
+
+        if (ifc->qlen <= 0) {
+            break;
+        }
+
+        r = ifc->queue + ifc->qfront;
+
+        if (r->dst.id != req.dst.id
+            || len + r->buf->datalen > (unsigned int) ifc->framelen) {
+            break;
+        }
+
+        memcpy(&req, r, sizeof(req));
+        ifc->qfront = (ifc->qfront + 1) % CCNL_MAX_IF_QLEN;
+        ifc->qlen--;
+        cnt++;
+    }
+
+    DEBUGMSG(25, "  %d packets in one frame of %u bytes\n", cnt, len);
+    ifc->sendfunc(ifc->frame, (uint16_t) len, req.dst.id);
+}
+
+// sends what the batching interfaces have queued, called by the relay
+// before it waits for the next messages
+void ccnl_interface_flush(struct ccnl_relay_s *ccnl)
+{
+    for (int i = 0; i < ccnl->ifcount; i++) {
+        while (ccnl->ifs[i].qlen > 0) {
+            ccnl_interface_CTS(ccnl, ccnl->ifs + i);
+        }
+    }
 }
 
 void ccnl_interface_enqueue(void (tx_done)(void *, int, int),
@@ -598,6 +792,11 @@ void ccnl_interface_enqueue(void (tx_done)(void *, int, int),
     DEBUGMSG(25, "ccnl_interface_enqueue interface=%p buf=%p (qlen=%d)\n",
              (void *) ifc, (void *) buf, ifc->qlen);
 
+    if (ifc->frame && ifc->qlen >= CCNL_MAX_IF_QLEN) {
+        // a batching interface sends when full instead of dropping
+        ccnl_interface_CTS(ccnl, ifc);
+    }
+
     if (ifc->qlen >= CCNL_MAX_IF_QLEN) {
         DEBUGMSG(2, "  DROPPING buf=%p\n", (void *) buf);
         ccnl_free(buf);
@@ -611,7 +810,9 @@ void ccnl_interface_enqueue(void (tx_done)(void *, int, int),
     r->txdone_face = f;
     ifc->qlen++;
 
-    ccnl_interface_CTS(ccnl, ifc);
+    if (!ifc->frame) {
+        ccnl_interface_CTS(ccnl, ifc);
+    }
 }
 
 struct ccnl_buf_s *
@@ -661,15 +862,27 @@ void ccnl_face_CTS(struct ccnl_relay_s *ccnl, struct ccnl_face_s *f)
     else {
         sockunion dst;
         int ifndx = f->ifndx;
-        buf = ccnl_frag_getnext(f->frag, &ifndx, &dst);
 
-        if (!buf) {
-            buf = ccnl_face_dequeue(ccnl, f);
-            ccnl_frag_reset(f->frag, buf, f->ifndx, &f->peer);
+        // all fragments at once, nothing calls back for the next one and
+        // a batching interface packs the last one with what follows
+        while (1) {
             buf = ccnl_frag_getnext(f->frag, &ifndx, &dst);
-        }
 
-        if (buf) {
+            if (!buf) {
+                buf = ccnl_face_dequeue(ccnl, f);
+
+                if (!buf) {
+                    break;
+                }
+
+                ccnl_frag_reset(f->frag, buf, f->ifndx, &f->peer);
+                buf = ccnl_frag_getnext(f->frag, &ifndx, &dst);
+
+                if (!buf) {
+                    break;
+                }
+            }
+
             ccnl_interface_enqueue(ccnl_face_CTS_done, f,
                                    ccnl, ccnl->ifs + ifndx, buf, &dst);
         }
@@ -709,38 +922,32 @@ int ccnl_face_enqueue(struct ccnl_relay_s *ccnl, struct ccnl_face_s *to,
 // ----------------------------------------------------------------------
 // handling of interest messages
 
+/* Recent nonces are kept in two bloom filters, each one covering a time
+ * slice: new nonces go into the current one, both are checked.  Every
+ * nonce timeout, or when the current slice holds CCNL_MAX_NONCES / 2
+ * nonces, the older filter is cleared and becomes the current one.  A
+ * nonce is thus known for one to two slices, at fixed memory and k bit
+ * tests per lookup.  A false positive drops an interest, which the
+ * sender retransmits with a fresh nonce. */
 int ccnl_nonce_find_or_append(struct ccnl_relay_s *ccnl,
-                              struct ccnl_buf_s *nonce)
+                              unsigned char *nonce, int len)
 {
-    struct ccnl_nonce_s *n, *last;
-    int i;
     DEBUGMSG(99, "ccnl_nonce_find_or_append: %u:%u:%u:%u\n",
-             nonce->data[0], nonce->data[1], nonce->data[2], nonce->data[3]);
+             nonce[0], nonce[1], nonce[2], nonce[3]);
 
-    /* test for noce in nonce cache */
-
-    for (n = ccnl->nonces, i = 0; n; n = n->next, i++) {
-        DEBUGMSG(1, "known: %u:%u:%u:%u\n",
-                 n->buf->data[0], n->buf->data[1], n->buf->data[2], n->buf->data[3]);
-        if (buf_equal(n->buf, nonce)) {
-            /* nonce in cache -> known */
-            return -1;
-        }
-        if (n->next) {
-            last = n->next;
-        }
+    if (bloom_check(ccnl->nonce_bloom, nonce, len)
+        || bloom_check(ccnl->nonce_bloom + 1, nonce, len)) {
+        /* nonce in cache -> known */
+        return -1;
     }
 
-    /* nonce not in local cache, add it */
-    n = ccnl_nonce_new(nonce);
-    DBL_LINKED_LIST_ADD(ccnl->nonces, n);
-
-    /* nonce chache full? */
-    if (i >= CCNL_MAX_NONCES) {
-        /* cache is full, drop oldest nonce: its the last element in the list */
-        ccnl_nonce_remove(ccnl, last);
+    if (ccnl->nonce_cnt >= CCNL_MAX_NONCES / 2) {
+        ccnl_nonce_rotate(ccnl);
     }
 
+    bloom_add(ccnl->nonce_bloom + ccnl->nonce_slice, nonce, len);
+    ccnl->nonce_cnt++;
+
     return 0;
 }
 
@@ -768,7 +975,13 @@ ccnl_interest_new(struct ccnl_relay_s *ccnl, struct ccnl_face_s *from,
     i->minsuffix = minsuffix;
     i->maxsuffix = maxsuffix;
     ccnl_get_timeval(&i->last_used);
+    ccnl_age_push(&ccnl->pit_age, &i->age);
     DBL_LINKED_LIST_ADD(ccnl->pit, i);
+
+    i->hash = ccnl_hash_prefix(i->prefix, i->prefix->compcnt);
+    i->hnext = ccnl->pit_index[CCNL_INDEX_BUCKET(i->hash)];
+    ccnl->pit_index[CCNL_INDEX_BUCKET(i->hash)] = i;
+    ccnl->pit_compcnt[i->prefix->compcnt]++;
     return i;
 }
 
@@ -819,35 +1032,63 @@ void ccnl_interest_propagate(struct ccnl_relay_s *ccnl,
     // transmit an Interest Message on all listed dest faces in sequence."
     // CCNL strategy: we forward on all FWD entries with a prefix match
     int forward_cnt = 0;
-    for (fwd = ccnl->fib; fwd; fwd = fwd->next) {
-        int rc = ccnl_prefix_cmp(fwd->prefix, NULL, i->prefix, CMP_LONGEST);
-        DEBUGMSG(40, "  ccnl_interest_propagate, rc=%d/%d\n", rc,
-                 fwd->prefix->compcnt);
+    uint32_t h = CCNL_HASH_INIT;
+
+    // only routes for a prefix of the name can match, one bucket per length
+    for (int k = 0; k <= i->prefix->compcnt; k++) {
+        if (k > 0) {
+            h = ccnl_hash_comp(h, i->prefix->comp[k - 1], i->prefix->complen[k - 1]);
+        }
 
-        if (rc < fwd->prefix->compcnt) {
+        if (ccnl->fib_compcnt[k] == 0) {
             continue;
         }
 
-        DEBUGMSG(40, "  ccnl_interest_propagate, fwd==%p\n", (void *) fwd);
+        for (fwd = ccnl->fib_index[CCNL_INDEX_BUCKET(h)]; fwd; fwd = fwd->hnext) {
+            if (fwd->hash != h || fwd->prefix->compcnt != k) {
+                continue;
+            }
+
+            int rc = ccnl_prefix_cmp(fwd->prefix, NULL, i->prefix, CMP_LONGEST);
+            DEBUGMSG(40, "  ccnl_interest_propagate, rc=%d/%d\n", rc, k);
+
+            if (rc < k) {
+                continue;
+            }
 
-        // suppress forwarding to origin of interest, except wireless
-        if (!i->from || fwd->face != i->from
-            || (i->from->flags & CCNL_FACE_FLAGS_REFLECT)) {
+            DEBUGMSG(40, "  ccnl_interest_propagate, fwd==%p\n", (void *) fwd);
 
-            i->forwarded_over = fwd;
-            fwd->face->stat.send_interest[i->retries]++;
-            ccnl_get_timeval(&i->last_used);
-            ccnl_face_enqueue(ccnl, fwd->face, buf_dup(i->pkt));
-            ccnl_get_timeval(&fwd->last_used);
-            forward_cnt++;
+            // suppress forwarding to origin of interest, except wireless
+            if (!i->from || fwd->face != i->from
+                || (i->from->flags & CCNL_FACE_FLAGS_REFLECT)) {
+
+                i->forwarded_over = fwd;
+                fwd->face->stat.send_interest[i->retries]++;
+                ccnl_age_touch(&ccnl->pit_age, &i->age, &i->last_used);
+                ccnl_face_enqueue(ccnl, fwd->face, buf_dup(i->pkt));
+                ccnl_age_touch(&ccnl->fib_age, &fwd->age, &fwd->last_used);
+                forward_cnt++;
+            }
         }
     }
 
     if (forward_cnt == 0) {
-        DEBUGMSG(40, "  ccnl_interest_propagate: using broadcast face!\n");
-        ccnl->ifs[RIOT_TRANS_IDX].broadcast_face->stat.send_interest[i->retries]++;
-        ccnl_get_timeval(&i->last_used);
-        ccnl_face_enqueue(ccnl, ccnl->ifs[RIOT_TRANS_IDX].broadcast_face, buf_dup(i->pkt));
+        DEBUGMSG(40, "  ccnl_interest_propagate: using broadcast faces!\n");
+        ccnl_age_touch(&ccnl->pit_age, &i->age, &i->last_used);
+
+        for (int k = 0; k < ccnl->ifcount; k++) {
+            struct ccnl_face_s *bf = ccnl->ifs[k].broadcast_face;
+
+            // the radio is a broadcast medium, other interfaces do not
+            // get the interest back
+            if (!bf || (i->from && i->from->ifndx == k
+                        && k != RIOT_TRANS_IDX)) {
+                continue;
+            }
+
+            bf->stat.send_interest[i->retries]++;
+            ccnl_face_enqueue(ccnl, bf, buf_dup(i->pkt));
+        }
     }
 
     return;
@@ -856,9 +1097,17 @@ void ccnl_interest_propagate(struct ccnl_relay_s *ccnl,
 struct ccnl_interest_s *
 ccnl_interest_remove(struct ccnl_relay_s *ccnl, struct ccnl_interest_s *i)
 {
-    struct ccnl_interest_s *i2;
+    struct ccnl_interest_s *i2, **pi;
     DEBUGMSG(40, "ccnl_interest_remove %p\n", (void *) i);
 
+    for (pi = &ccnl->pit_index[CCNL_INDEX_BUCKET(i->hash)]; *pi; pi = &(*pi)->hnext) {
+        if (*pi == i) {
+            *pi = i->hnext;
+            ccnl->pit_compcnt[i->prefix->compcnt]--;
+            break;
+        }
+    }
+
     while (i->pending) {
         struct ccnl_pendint_s *tmp = i->pending->next;
         ccnl_free(i->pending);
@@ -867,6 +1116,7 @@ ccnl_interest_remove(struct ccnl_relay_s *ccnl, struct ccnl_interest_s *i)
 
     i2 = i->next;
     DBL_LINKED_LIST_REMOVE(ccnl->pit, i);
+    ccnl_age_unlink(&ccnl->pit_age, &i->age);
     free_prefix(i->prefix);
     free_3ptr_list(i->ppkd, i->pkt, i);
     return i2;
@@ -938,6 +1188,192 @@ ccnl_content_new(struct ccnl_relay_s *ccnl, struct ccnl_buf_s **pkt,
     return c;
 }
 
+static int ccnl_content_in_lru(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
+{
+    return c->lru_prev || ccnl->lru_head == c;
+}
+
+static void ccnl_content_lru_unlink(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
+{
+    if (c->lru_prev) {
+        c->lru_prev->lru_next = c->lru_next;
+    }
+    else {
+        ccnl->lru_head = c->lru_next;
+    }
+
+    if (c->lru_next) {
+        c->lru_next->lru_prev = c->lru_prev;
+    }
+    else {
+        ccnl->lru_tail = c->lru_prev;
+    }
+
+    c->lru_next = c->lru_prev = NULL;
+}
+
+static void ccnl_content_lru_push(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
+{
+    c->lru_prev = NULL;
+    c->lru_next = ccnl->lru_head;
+
+    if (ccnl->lru_head) {
+        ccnl->lru_head->lru_prev = c;
+    }
+    else {
+        ccnl->lru_tail = c;
+    }
+
+    ccnl->lru_head = c;
+}
+
+// marks c as used, keeping the LRU list ordered by last_used
+static void ccnl_content_touch(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
+{
+    ccnl_get_timeval(&c->last_used);
+
+    if (ccnl_content_in_lru(ccnl, c) && ccnl->lru_head != c) {
+        ccnl_content_lru_unlink(ccnl, c);
+        ccnl_content_lru_push(ccnl, c);
+    }
+}
+
+// inserts c into cs_index once for each prefix of its name
+static int ccnl_content_index(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
+{
+    int compcnt = c->name->compcnt;
+    uint32_t h = CCNL_HASH_INIT;
+
+    if (compcnt == 0) {
+        return 0;
+    }
+
+    c->refs = (struct ccnl_content_ref_s *) ccnl_calloc(compcnt,
+              sizeof(struct ccnl_content_ref_s));
+
+    if (!c->refs) {
+        return -1;
+    }
+
+    for (int k = 0; k < compcnt; k++) {
+        struct ccnl_content_ref_s *ref = c->refs + k;
+        h = ccnl_hash_comp(h, c->name->comp[k], c->name->complen[k]);
+        ref->content = c;
+        ref->hash = h;
+        ref->compcnt = k + 1;
+        ref->next = ccnl->cs_index[CCNL_INDEX_BUCKET(h)];
+        ccnl->cs_index[CCNL_INDEX_BUCKET(h)] = ref;
+    }
+
+    return 0;
+}
+
+static void ccnl_content_unindex(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
+{
+    if (!c->refs) {
+        return;
+    }
+
+    for (int k = 0; k < c->name->compcnt; k++) {
+        struct ccnl_content_ref_s **pref;
+
+        for (pref = &ccnl->cs_index[CCNL_INDEX_BUCKET(c->refs[k].hash)]; *pref;
+             pref = &(*pref)->next) {
+            if (*pref == c->refs + k) {
+                *pref = c->refs[k].next;
+                break;
+            }
+        }
+    }
+
+    ccnl_free(c->refs);
+    c->refs = NULL;
+}
+
+// returns a cached content matching the interest, using the name index
+static struct ccnl_content_s *
+ccnl_content_lookup(struct ccnl_relay_s *ccnl, struct ccnl_prefix_s *p,
+                    struct ccnl_buf_s *ppkd, int minsuffix, int maxsuffix)
+{
+    struct ccnl_content_ref_s *ref;
+    struct ccnl_content_s *c;
+    int n = p->compcnt;
+
+    if (n == 0) {
+        for (c = ccnl->contents; c; c = c->next) {
+            if (ccnl_i_prefixof_c(p, ppkd, minsuffix, maxsuffix, c)) {
+                return c;
+            }
+        }
+
+        return NULL;
+    }
+
+    uint32_t h_short = ccnl_hash_prefix(p, n - 1);
+    uint32_t h = ccnl_hash_comp(h_short, p->comp[n - 1], p->complen[n - 1]);
+
+    // contents whose name starts with the full prefix
+    for (ref = ccnl->cs_index[CCNL_INDEX_BUCKET(h)]; ref; ref = ref->next) {
+        if (ref->compcnt == n && ref->hash == h
+            && ccnl_i_prefixof_c(p, ppkd, minsuffix, maxsuffix, ref->content)) {
+            return ref->content;
+        }
+    }
+
+    // the last component may be the implicit digest of a content
+    if (n == 1) {
+        return NULL;
+    }
+
+    for (ref = ccnl->cs_index[CCNL_INDEX_BUCKET(h_short)]; ref; ref = ref->next) {
+        if (ref->compcnt == n - 1 && ref->hash == h_short
+            && ref->content->name->compcnt == n - 1
+            && ccnl_i_prefixof_c(p, ppkd, minsuffix, maxsuffix, ref->content)) {
+            return ref->content;
+        }
+    }
+
+    return NULL;
+}
+
+static int ccnl_content_is_pkt(struct ccnl_content_s *c, unsigned char *pkt,
+                               int len)
+{
+    return c->pkt->datalen == (unsigned int) len && !memcmp(c->pkt->data, pkt, len);
+}
+
+// returns a cached content holding the same packet as pkt
+struct ccnl_content_s *
+ccnl_content_find_dup(struct ccnl_relay_s *ccnl, struct ccnl_prefix_s *p,
+                      unsigned char *pkt, int len)
+{
+    struct ccnl_content_ref_s *ref;
+    struct ccnl_content_s *c;
+    int n = p->compcnt;
+
+    if (n == 0) {
+        for (c = ccnl->contents; c; c = c->next) {
+            if (ccnl_content_is_pkt(c, pkt, len)) {
+                return c;
+            }
+        }
+
+        return NULL;
+    }
+
+    uint32_t h = ccnl_hash_prefix(p, n);
+
+    for (ref = ccnl->cs_index[CCNL_INDEX_BUCKET(h)]; ref; ref = ref->next) {
+        if (ref->compcnt == n && ref->hash == h
+            && ref->content->name->compcnt == n
+            && ccnl_content_is_pkt(ref->content, pkt, len)) {
+            return ref->content;
+        }
+    }
+
+    return NULL;
+}
+
 struct ccnl_content_s *
 ccnl_content_remove(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
 {
@@ -946,6 +1382,12 @@ ccnl_content_remove(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
 
     c2 = c->next;
     DBL_LINKED_LIST_REMOVE(ccnl->contents, c);
+
+    if (ccnl_content_in_lru(ccnl, c)) {
+        ccnl_content_lru_unlink(ccnl, c);
+    }
+
+    ccnl_content_unindex(ccnl, c);
     free_content(c);
     ccnl->contentcnt--;
     return c2;
@@ -964,15 +1406,8 @@ ccnl_content_add2cache(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
 
     while (ccnl->max_cache_entries <= ccnl->contentcnt) {
         DEBUGMSG(1, "  remove Least Recently Used content...\n");
-        struct ccnl_content_s *c2, *lru = NULL;
-
-        for (c2 = ccnl->contents; c2; c2 = c2->next) {
-            DEBUGMSG(1, "    '%s' -> %ld:%ld\n", ccnl_prefix_to_path(c2->name), c2->last_used.tv_sec, c2->last_used.tv_usec);
-            if (!(c2->flags & CCNL_CONTENT_FLAGS_STATIC)
-                && ((!lru) || timevaldelta(&c2->last_used, &lru->last_used) < 0)) {
-                lru = c2;
-            }
-        }
+        // static content is never linked into the LRU list
+        struct ccnl_content_s *lru = ccnl->lru_tail;
 
         if (lru) {
             DEBUGMSG(1, "   replaced: '%s'\n", ccnl_prefix_to_path(lru->name));
@@ -984,12 +1419,82 @@ ccnl_content_add2cache(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c)
         }
     }
 
+    if (ccnl_content_index(ccnl, c) < 0) {
+        puts("can't get more memory from malloc, content not cached...");
+        return NULL;
+    }
+
     DEBUGMSG(1, "  add new content to store: '%s'\n", ccnl_prefix_to_path(c->name));
     DBL_LINKED_LIST_ADD(ccnl->contents, c);
+
+    if (!(c->flags & CCNL_CONTENT_FLAGS_STATIC)) {
+        ccnl_content_lru_push(ccnl, c);
+    }
+
     ccnl->contentcnt++;
     return c;
 }
 
+// decides by the policy in force whether c, received on face from, goes
+// into the content store
+static int
+ccnl_content_admit(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c,
+                   struct ccnl_face_s *from)
+{
+    struct ccnl_cache_stat_s *st = ccnl->cache_stat + ccnl->cache_policy;
+    int admit;
+
+    switch (ccnl->cache_policy) {
+        case CCNL_CACHE_PROB:
+            admit = (int)(genrand_uint32() & 0xff) < ccnl->cache_prob;
+            break;
+
+        case CCNL_CACHE_LCD:
+            // content of a local producer, or marked by the relay above
+            // which answered from its store
+            admit = from->ifndx == RIOT_MSG_IDX
+                    || (from->flags & CCNL_FACE_FLAGS_COPYDOWN);
+            break;
+
+        case CCNL_CACHE_SIZE:
+            admit = c->pkt->datalen <= CCNL_CACHE_SIZE_REF
+                    || genrand_uint32() % c->pkt->datalen < CCNL_CACHE_SIZE_REF;
+            break;
+
+        default:
+            admit = 1;
+    }
+
+    if (admit) {
+        st->admitted++;
+    }
+    else {
+        st->rejected++;
+    }
+
+    return admit;
+}
+
+// a copy of the packet of c, preceded by a mark telling the receiver to
+// cache it (CCNL_CACHE_LCD)
+static struct ccnl_buf_s *
+ccnl_content_copydown(struct ccnl_content_s *c)
+{
+    unsigned char mark[8];
+    int len = mkHeader(mark, CCNL_DTAG_COPYDOWN, CCN_TT_DTAG);
+    struct ccnl_buf_s *buf;
+
+    mark[len++] = 0; // end-of-copydown
+    buf = ccnl_buf_new(NULL, len + c->pkt->datalen);
+
+    if (buf) {
+        memcpy(buf->data, mark, len);
+        memcpy(buf->data + len, c->pkt->data, c->pkt->datalen);
+    }
+
+    return buf;
+}
+
 // deliver new content c to all clients with (loosely) matching interest,
 // but only one copy per face
 // returns: number of forwards
@@ -997,21 +1502,50 @@ int ccnl_content_serve_pending(struct ccnl_relay_s *ccnl,
                                struct ccnl_content_s *c,
                                struct ccnl_face_s *from)
 {
-    struct ccnl_interest_s *i;
     struct ccnl_face_s *f;
-    int cnt = 0;
+    int cnt = 0, k, compcnt = c->name->compcnt;
+    uint32_t h = CCNL_HASH_INIT;
     DEBUGMSG(99, "ccnl_content_serve_pending\n");
 
     for (f = ccnl->faces; f; f = f->next) {
         f->flags &= ~CCNL_FACE_FLAGS_SERVED;    // reply on a face only once
     }
 
-    for (i = ccnl->pit; i;) {
+    // only interests named by a prefix of c (or c plus its digest) can match
+    for (k = 0; k <= compcnt + 1 && k <= CCNL_MAX_NAME_COMP; k++) {
+        if (k > 0 && k <= compcnt) {
+            h = ccnl_hash_comp(h, c->name->comp[k - 1], c->name->complen[k - 1]);
+        }
+
+        if (ccnl->pit_compcnt[k] == 0) {
+            continue;
+        }
+
+        if (k == compcnt + 1) {
+            h = ccnl_hash_comp(h, compute_ccnx_digest(c->pkt), 32); // SHA256_DIGEST_LEN
+        }
+
+        cnt += ccnl_content_serve_bucket(ccnl, c, from, k, h);
+    }
+
+    return cnt;
+}
+
+static int ccnl_content_serve_bucket(struct ccnl_relay_s *ccnl,
+                                     struct ccnl_content_s *c,
+                                     struct ccnl_face_s *from,
+                                     int compcnt, uint32_t h)
+{
+    struct ccnl_interest_s *i, *inext;
+    int cnt = 0;
+
+    for (i = ccnl->pit_index[CCNL_INDEX_BUCKET(h)]; i; i = inext) {
         struct ccnl_pendint_s *pi;
+        inext = i->hnext;
 
-        if (!ccnl_i_prefixof_c(i->prefix, i->ppkd, i->minsuffix, i->maxsuffix,
-                               c)) {
-            i = i->next;
+        if (i->hash != h || i->prefix->compcnt != compcnt
+            || !ccnl_i_prefixof_c(i->prefix, i->ppkd, i->minsuffix, i->maxsuffix,
+                                  c)) {
             continue;
         }
 
@@ -1037,11 +1571,11 @@ int ccnl_content_serve_pending(struct ccnl_relay_s *ccnl,
             ccnl_face_enqueue(ccnl, pi->face, buf_dup(c->pkt));
 
             c->served_cnt++;
-            ccnl_get_timeval(&c->last_used);
+            ccnl_content_touch(ccnl, c);
             cnt++;
         }
 
-        i = ccnl_interest_remove(ccnl, i);
+        ccnl_interest_remove(ccnl, i);
     }
 
     return cnt;
@@ -1053,23 +1587,28 @@ int ccnl_content_serve_pending(struct ccnl_relay_s *ccnl,
  */
 struct ccnl_forward_s *ccn_forward_find_common_prefix_to_aggregate(struct ccnl_relay_s *ccnl, struct ccnl_prefix_s *p, int *match_len)
 {
-    if (!ccnl->fib) {
-        DEBUGMSG(999, "ccn_forward_find_common_prefix: fib was empty\n");
+    int t = CCNL_FIB_AGGR_LEN(ccnl);
+    struct ccnl_forward_s *fwd2;
+
+    if (p->compcnt < t) {
         return NULL;
     }
 
-    /* fib as at least one enty */
-    struct ccnl_forward_s *fwd2 = ccnl->fib;
-    while (fwd2) {
+    /* only dynamic entries sharing the first t components can aggregate */
+    uint32_t h = ccnl_hash_prefix(p, t);
+
+    for (fwd2 = ccnl->fib_aggr_index[CCNL_INDEX_BUCKET(h)]; fwd2; fwd2 = fwd2->anext) {
+        if (fwd2->ahash != h) {
+            continue;
+        }
+
         DEBUGMSG(1, "ccn_forward_find_common_prefix: '%s' vs. '%s'\n", ccnl_prefix_to_path(p), ccnl_prefix_to_path(fwd2->prefix));
         *match_len = ccnl_prefix_cmp(fwd2->prefix, 0, p, CMP_LONGEST);
 
-        /* check for threshold and never date up a static enty */
-        if ((ccnl->fib_threshold_aggregate <= *match_len) && !(fwd2->flags & CCNL_FORWARD_FLAGS_STATIC)) {
+        /* check for threshold */
+        if (t <= *match_len) {
             return fwd2;
         }
-
-        fwd2 = fwd2->next;
     }
 
     return NULL;
@@ -1078,12 +1617,63 @@ struct ccnl_forward_s *ccn_forward_find_common_prefix_to_aggregate(struct ccnl_r
 static struct ccnl_forward_s *ccnl_forward_new(struct ccnl_prefix_s *p, struct ccnl_face_s *f, int threshold_prefix, int flags)
 {
     struct ccnl_forward_s *fwd = ccnl_calloc(1, sizeof(struct ccnl_forward_s));
+
+    if (!fwd) {
+        return NULL;
+    }
+
     fwd->prefix = ccnl_prefix_clone_strip(p, threshold_prefix);
+
+    if (!fwd->prefix) {
+        ccnl_free(fwd);
+        return NULL;
+    }
+
     fwd->face = f;
     fwd->flags = flags;
     return fwd;
 }
 
+// links fwd into the fib, its age list and the indices
+static void ccnl_forward_add(struct ccnl_relay_s *ccnl, struct ccnl_forward_s *fwd)
+{
+    int n = fwd->prefix->compcnt, t = CCNL_FIB_AGGR_LEN(ccnl);
+
+    DBL_LINKED_LIST_ADD(ccnl->fib, fwd);
+    ccnl_age_push(&ccnl->fib_age, &fwd->age);
+
+    fwd->hash = ccnl_hash_prefix(fwd->prefix, n);
+    fwd->hnext = ccnl->fib_index[CCNL_INDEX_BUCKET(fwd->hash)];
+    ccnl->fib_index[CCNL_INDEX_BUCKET(fwd->hash)] = fwd;
+    ccnl->fib_compcnt[n]++;
+
+    if (!(fwd->flags & CCNL_FORWARD_FLAGS_STATIC) && n >= t) {
+        fwd->ahash = ccnl_hash_prefix(fwd->prefix, t);
+        fwd->anext = ccnl->fib_aggr_index[CCNL_INDEX_BUCKET(fwd->ahash)];
+        ccnl->fib_aggr_index[CCNL_INDEX_BUCKET(fwd->ahash)] = fwd;
+    }
+}
+
+static void ccnl_forward_unindex(struct ccnl_relay_s *ccnl, struct ccnl_forward_s *fwd)
+{
+    struct ccnl_forward_s **pf;
+
+    for (pf = &ccnl->fib_index[CCNL_INDEX_BUCKET(fwd->hash)]; *pf; pf = &(*pf)->hnext) {
+        if (*pf == fwd) {
+            *pf = fwd->hnext;
+            ccnl->fib_compcnt[fwd->prefix->compcnt]--;
+            break;
+        }
+    }
+
+    for (pf = &ccnl->fib_aggr_index[CCNL_INDEX_BUCKET(fwd->ahash)]; *pf; pf = &(*pf)->anext) {
+        if (*pf == fwd) {
+            *pf = fwd->anext;
+            break;
+        }
+    }
+}
+
 void ccnl_content_learn_name_route(struct ccnl_relay_s *ccnl, struct ccnl_prefix_s *p, struct ccnl_face_s *f, int threshold_prefix, int flags)
 {
     /*
@@ -1097,7 +1687,12 @@ void ccnl_content_learn_name_route(struct ccnl_relay_s *ccnl, struct ccnl_prefix
 
         /* create a new fib entry */
         fwd = ccnl_forward_new(p, f, threshold_prefix, flags);
-        DBL_LINKED_LIST_ADD(ccnl->fib, fwd);
+
+        if (!fwd) {
+            return;
+        }
+
+        ccnl_forward_add(ccnl, fwd);
         DEBUGMSG(999, "ccnl_content_learn_name_route: new route '%s' on face %d learned\n", ccnl_prefix_to_path(fwd->prefix), f->faceid);
     }
     else {
@@ -1106,11 +1701,16 @@ void ccnl_content_learn_name_route(struct ccnl_relay_s *ccnl, struct ccnl_prefix
         /* if the new entry has shorter prefix */
         if (p->compcnt < fwd->prefix->compcnt) {
             /* we need to aggregate! */
-            DBL_LINKED_LIST_REMOVE(ccnl->fib, fwd);
+            ccnl_forward_remove(ccnl, fwd);
 
             /* create a new fib entry */
             fwd = ccnl_forward_new(p, f, (p->compcnt - match_len), flags);
-            DBL_LINKED_LIST_ADD(ccnl->fib, fwd);
+
+            if (!fwd) {
+                return;
+            }
+
+            ccnl_forward_add(ccnl, fwd);
             DEBUGMSG(999, "ccnl_content_learn_name_route: route '%s' on face %d replaced\n", ccnl_prefix_to_path(fwd->prefix), f->faceid);
         }
         else {
@@ -1120,7 +1720,7 @@ void ccnl_content_learn_name_route(struct ccnl_relay_s *ccnl, struct ccnl_prefix
 
     /* refresh fwd entry */
     DEBUGMSG(999, "ccnl_content_learn_name_route refresh route '%s' on face %d\n", ccnl_prefix_to_path(fwd->prefix), f->faceid);
-    ccnl_get_timeval(&fwd->last_used);
+    ccnl_age_touch(&ccnl->fib_age, &fwd->age, &fwd->last_used);
 }
 
 struct ccnl_forward_s *
@@ -1131,6 +1731,8 @@ ccnl_forward_remove(struct ccnl_relay_s *ccnl, struct ccnl_forward_s *fwd)
 
     fwd2 = fwd->next;
     DBL_LINKED_LIST_REMOVE(ccnl->fib, fwd);
+    ccnl_age_unlink(&ccnl->fib_age, &fwd->age);
+    ccnl_forward_unindex(ccnl, fwd);
 
     for (struct ccnl_interest_s *p = ccnl->pit; p; p = p->next) {
         if (p->forwarded_over == fwd) {
@@ -1181,79 +1783,83 @@ void ccnl_do_nonce_timeout(void *ptr, void *dummy)
 {
     (void) dummy; /* unused */
 
-    struct ccnl_relay_s *relay = (struct ccnl_relay_s *) ptr;
-
-    struct timeval now;
-    ccnl_get_timeval(&now);
-    //DEBUGMSG(99, "ccnl_do_nonce_timeout: %lu:%lu\n", now.tv_sec, now.tv_usec);
-
-    for (struct ccnl_nonce_s *n = relay->nonces; n;) {
-        if (ccnl_is_timeouted(&now, &n->created, CCNL_NONCE_TIMEOUT_SEC, CCNL_NONCE_TIMEOUT_USEC)) {
-            n = ccnl_nonce_remove(relay, n);
-        } else {
-            n = n->next;
-        }
-    }
+    ccnl_nonce_rotate((struct ccnl_relay_s *) ptr);
 }
 
+// all entries of a list have the same timeout, so ageing stops at the first
+// entry that is still alive and only looks at the ones expiring.  Static
+// entries never expire, they are moved out of the way to the newest end.
 void ccnl_do_ageing(void *ptr, void *dummy)
 {
 
     (void) dummy; /* unused */
 
     struct ccnl_relay_s *relay = (struct ccnl_relay_s *) ptr;
-    struct ccnl_interest_s *i = relay->pit;
-    struct ccnl_content_s *c = relay->contents;
-
-    struct ccnl_face_s *f = relay->faces;
+    struct ccnl_age_s *a, *first_static;
+    struct ccnl_content_s *c;
     struct timeval now;
     ccnl_get_timeval(&now);
     //DEBUGMSG(999, "ccnl_do_ageing %ld:%ld\n", now.tv_sec, now.tv_usec);
 
-    while (i) {
-        if (ccnl_is_timeouted(&now, &i->last_used, CCNL_INTEREST_TIMEOUT_SEC,
+    while ((a = relay->pit_age.oldest)) {
+        struct ccnl_interest_s *i = CCNL_AGE_ENTRY(a, struct ccnl_interest_s);
+
+        if (!ccnl_is_timeouted(&now, &i->last_used, CCNL_INTEREST_TIMEOUT_SEC,
                 CCNL_INTEREST_TIMEOUT_USEC)) {
-            if (i->from->ifndx == RIOT_MSG_IDX) {
-                /* this interest was requested by an app from this node */
-                /* inform this app about this problem */
-                riot_send_nack(i->from->faceid);
-            }
-            i = ccnl_interest_remove(relay, i);
+            break;
         }
-        else {
-            i = i->next;
+
+        if (i->from && i->from->ifndx == RIOT_MSG_IDX) {
+            /* this interest was requested by an app from this node */
+            /* inform this app about this problem */
+            riot_send_nack(i->from->faceid);
         }
+
+        ccnl_interest_remove(relay, i);
     }
 
-    while (c) {
-        if (ccnl_is_timeouted(&now, &c->last_used, CCNL_CONTENT_TIMEOUT_SEC, CCNL_CONTENT_TIMEOUT_USEC)
-            && !(c->flags & CCNL_CONTENT_FLAGS_STATIC)) {
-            c = ccnl_content_remove(relay, c);
-        }
-        else {
-            c = c->next;
-        }
+    /* static content is not in the LRU list */
+    while ((c = relay->lru_tail)
+           && ccnl_is_timeouted(&now, &c->last_used, CCNL_CONTENT_TIMEOUT_SEC, CCNL_CONTENT_TIMEOUT_USEC)) {
+        ccnl_content_remove(relay, c);
     }
 
-    while (f) {
-        if (!(f->flags & CCNL_FACE_FLAGS_STATIC)
-            && ccnl_is_timeouted(&now, &f->last_used, CCNL_FACE_TIMEOUT_SEC, CCNL_FACE_TIMEOUT_USEC)) {
-            f = ccnl_face_remove(relay, f);
+    first_static = NULL;
+
+    while ((a = relay->face_age.oldest) && a != first_static) {
+        struct ccnl_face_s *f = CCNL_AGE_ENTRY(a, struct ccnl_face_s);
+
+        if (f->flags & CCNL_FACE_FLAGS_STATIC) {
+            first_static = first_static ? first_static : a;
+            ccnl_age_unlink(&relay->face_age, a);
+            ccnl_age_push(&relay->face_age, a);
+            continue;
         }
-        else {
-            f = f->next;
+
+        if (!ccnl_is_timeouted(&now, &f->last_used, CCNL_FACE_TIMEOUT_SEC, CCNL_FACE_TIMEOUT_USEC)) {
+            break;
         }
+
+        ccnl_face_remove(relay, f);
     }
 
-    struct ccnl_forward_s *fwd = relay->fib;
-    while (fwd) {
-        if (!(fwd->flags & CCNL_FORWARD_FLAGS_STATIC)
-            && ccnl_is_timeouted(&now, &fwd->last_used, CCNL_FWD_TIMEOUT_SEC, CCNL_FWD_TIMEOUT_USEC)) {
-            fwd = ccnl_forward_remove(relay, fwd);
+    first_static = NULL;
+
+    while ((a = relay->fib_age.oldest) && a != first_static) {
+        struct ccnl_forward_s *fwd = CCNL_AGE_ENTRY(a, struct ccnl_forward_s);
+
+        if (fwd->flags & CCNL_FORWARD_FLAGS_STATIC) {
+            first_static = first_static ? first_static : a;
+            ccnl_age_unlink(&relay->fib_age, a);
+            ccnl_age_push(&relay->fib_age, a);
+            continue;
         }
-        else {
-            fwd = fwd->next;
+
+        if (!ccnl_is_timeouted(&now, &fwd->last_used, CCNL_FWD_TIMEOUT_SEC, CCNL_FWD_TIMEOUT_USEC)) {
+            break;
         }
+
+        ccnl_forward_remove(relay, fwd);
     }
 }
 
@@ -1274,10 +1880,6 @@ void ccnl_core_cleanup(struct ccnl_relay_s *ccnl)
         ccnl_content_remove(ccnl, ccnl->contents);
     }
 
-    while (ccnl->nonces) {
-        ccnl_nonce_remove(ccnl, ccnl->nonces);
-    }
-
     for (k = 0; k < ccnl->ifcount; k++) {
         ccnl_interface_cleanup(ccnl->ifs + k);
     }
@@ -1286,32 +1888,40 @@ void ccnl_core_cleanup(struct ccnl_relay_s *ccnl)
 // ----------------------------------------------------------------------
 // the core logic of CCN:
 
+// the packet is parsed in place, answering an interest from the content
+// store or adding a face to a known interest allocates nothing.  Only
+// packets that are kept are copied.
 int ccnl_core_RX_i_or_c(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
                         unsigned char **data, int *datalen)
 {
-    int rc = -1, scope = 3, aok = 3, minsfx = 0, maxsfx = CCNL_MAX_NAME_COMP,
-        contlen;
-    struct ccnl_buf_s *buf = 0, *nonce = 0, *ppkd = 0;
+    int rc = -1;
+    struct ccnl_parsed_s pkt;
+    struct ccnl_buf_s *buf = 0, *ppkd = 0;
     struct ccnl_interest_s *i = 0;
     struct ccnl_content_s *c = 0;
-    struct ccnl_prefix_s *p = 0;
+    struct ccnl_prefix_s *p = &pkt.prefix, *kept = 0;
     unsigned char *content = 0;
     DEBUGMSG(1, "ccnl_core_RX_i_or_c: (%d bytes left)\n", *datalen);
 
-    buf = ccnl_extract_prefix_nonce_ppkd(data, datalen, &scope, &aok, &minsfx,
-                                         &maxsfx, &p, &nonce, &ppkd, &content, &contlen);
-
-    if (!buf) {
+    if (ccnl_parse(data, datalen, &pkt) < 0) {
         DEBUGMSG(6, "  parsing error or no prefix\n");
         goto Done;
     }
 
-    if (nonce && ccnl_nonce_find_or_append(relay, nonce)) {
+    if (pkt.nonce && ccnl_nonce_find_or_append(relay, pkt.nonce, pkt.noncelen)) {
         DEBUGMSG(6, "  dropped because of duplicate nonce\n");
         goto Skip;
     }
 
-    if (buf->data[0] == 0x01 && buf->data[1] == 0xd2) { // interest
+    if (pkt.ppkd) {
+        ppkd = ccnl_buf_new(pkt.ppkd, pkt.ppkdlen);
+
+        if (!ppkd) {
+            goto Done;
+        }
+    }
+
+    if (pkt.pkt[0] == 0x01 && pkt.pkt[1] == 0xd2) { // interest
         DEBUGMSG(1, "ccnl_core_RX_i_or_c: interest=<%s>\n", ccnl_prefix_to_path(p));
         from->stat.received_interest++;
 
@@ -1321,53 +1931,79 @@ int ccnl_core_RX_i_or_c(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
 
         if (p->compcnt == 4 && !memcmp(p->comp[0], "ccnx", 4)) {
             DEBUGMSG(1, "it's a mgnt msg!\n");
-            rc = ccnl_mgmt(relay, buf, p, from);
+
+            if (!(buf = ccnl_parsed_copy(&pkt, &kept, NULL))) {
+                goto Done;
+            }
+
+            rc = ccnl_mgmt(relay, buf, kept, from);
             DEBUGMSG(1, "mgnt processing done!\n");
             goto Done;
         }
 
         // CONFORM: Step 1:
-        if (aok & 0x01) { // honor "answer-from-existing-content-store" flag
-            for (c = relay->contents; c; c = c->next) {
-                if (!ccnl_i_prefixof_c(p, ppkd, minsfx, maxsfx, c)) {
-                    continue;
-                }
+        if (pkt.aok & 0x01) { // honor "answer-from-existing-content-store" flag
+            c = ccnl_content_lookup(relay, p, ppkd, pkt.minsfx, pkt.maxsfx);
+
+            if (!c && ccnl_store_load(relay, p)) {
+                c = ccnl_content_lookup(relay, p, ppkd, pkt.minsfx, pkt.maxsfx);
+            }
 
+            if (c) {
                 // FIXME: should check stale bit in aok here
                 DEBUGMSG(7, "  matching content for interest, content %p\n",
                          (void *) c);
+                relay->cache_stat[relay->cache_policy].hits++;
                 from->stat.send_content[c->served_cnt % CCNL_MAX_CONTENT_SERVED_STAT]++;
                 c->served_cnt++;
+                ccnl_content_touch(relay, c);
 
                 if (from->ifndx >= 0) {
-                    ccnl_face_enqueue(relay, from, buf_dup(c->pkt));
+                    struct ccnl_buf_s *out = NULL;
+
+                    if (from->ifndx == RIOT_TRANS_IDX
+                        && relay->cache_policy == CCNL_CACHE_LCD) {
+                        out = ccnl_content_copydown(c);
+                    }
+
+                    ccnl_face_enqueue(relay, from, out ? out : buf_dup(c->pkt));
                 }
 
                 goto Skip;
             }
+
+            relay->cache_stat[relay->cache_policy].misses++;
         }
 
         // CONFORM: Step 2: check whether interest is already known
-        for (i = relay->pit; i; i = i->next) {
-            if (!ccnl_prefix_cmp(i->prefix, NULL, p, CMP_EXACT)
-                && i->minsuffix == minsfx && i->maxsuffix == maxsfx
+        uint32_t h = ccnl_hash_prefix(p, p->compcnt);
+
+        for (i = relay->pit_index[CCNL_INDEX_BUCKET(h)]; i; i = i->hnext) {
+            if (i->hash == h
+                && !ccnl_prefix_cmp(i->prefix, NULL, p, CMP_EXACT)
+                && i->minsuffix == pkt.minsfx && i->maxsuffix == pkt.maxsfx
                 && ((!ppkd && !i->ppkd) || buf_equal(ppkd, i->ppkd))) {
                 break;
             }
         }
 
         if (!i) { // this is a new/unknown I request: create and propagate
-            i = ccnl_interest_new(relay, from, &buf, &p, minsfx, maxsfx, &ppkd);
+            if (!(buf = ccnl_parsed_copy(&pkt, &kept, NULL))) {
+                goto Done;
+            }
+
+            i = ccnl_interest_new(relay, from, &buf, &kept, pkt.minsfx,
+                                  pkt.maxsfx, &ppkd);
 
             if (i) { // CONFORM: Step 3 (and 4)
                 DEBUGMSG(7, "  created new interest entry %p\n", (void *) i);
 
-                if (scope > 2) {
+                if (pkt.scope > 2) {
                     ccnl_interest_propagate(relay, i);
                 }
             }
         }
-        else if (scope > 2 && (from->flags & CCNL_FACE_FLAGS_FWDALLI)) {
+        else if (pkt.scope > 2 && (from->flags & CCNL_FACE_FLAGS_FWDALLI)) {
             DEBUGMSG(7, "  old interest, nevertheless propagated %p\n",
                      (void *) i);
             ccnl_interest_propagate(relay, i);
@@ -1383,14 +2019,16 @@ int ccnl_core_RX_i_or_c(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
         from->stat.received_content++;
 
         // CONFORM: Step 1:
-        for (c = relay->contents; c; c = c->next) {
-            if (buf_equal(c->pkt, buf)) {
-                DEBUGMSG(1, "content is dup: skip\n");
-                goto Skip;
-            }
+        if (ccnl_content_find_dup(relay, p, pkt.pkt, pkt.pktlen)) {
+            DEBUGMSG(1, "content is dup: skip\n");
+            goto Skip;
         }
 
-        c = ccnl_content_new(relay, &buf, &p, &ppkd, content, contlen);
+        if (!(buf = ccnl_parsed_copy(&pkt, &kept, &content))) {
+            goto Done;
+        }
+
+        c = ccnl_content_new(relay, &buf, &kept, &ppkd, content, pkt.contlen);
 
         if (c) { // CONFORM: Step 2 (and 3)
             if (!ccnl_content_serve_pending(relay, c, from)) { // unsolicited content
@@ -1406,9 +2044,13 @@ int ccnl_core_RX_i_or_c(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
             }
 #endif
 
-            if (relay->max_cache_entries != 0) { // it's set to -1 or a limit
+            if (relay->max_cache_entries != 0 // it's set to -1 or a limit
+                && ccnl_content_admit(relay, c, from)) {
                 DEBUGMSG(7, "  adding content to cache\n");
-                ccnl_content_add2cache(relay, c);
+
+                if (ccnl_content_add2cache(relay, c)) {
+                    ccnl_store_append(relay, c);
+                }
             }
             else {
                 DEBUGMSG(7, "  content not added to cache\n");
@@ -1420,8 +2062,8 @@ int ccnl_core_RX_i_or_c(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
 Skip:
     rc = 0;
 Done:
-    free_prefix(p);
-    free_3ptr_list(buf, nonce, ppkd);
+    free_prefix(kept);
+    free_2ptr_list(buf, ppkd);
     DEBUGMSG(1, "leaving\n");
     return rc;
 }
@@ -1444,6 +2086,16 @@ int ccnl_core_RX_datagram(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
 
             case CCN_DTAG_CONTENTOBJ:
                 rc = ccnl_core_RX_i_or_c(relay, from, data, datalen);
+                from->flags &= ~CCNL_FACE_FLAGS_COPYDOWN;
+                continue;
+
+            case CCNL_DTAG_COPYDOWN:
+                // applies to the next packet of this datagram
+                if (consume(typ, num, data, datalen, 0, 0) < 0) {
+                    return -1;
+                }
+
+                from->flags |= CCNL_FACE_FLAGS_COPYDOWN;
                 continue;
 #ifdef USE_FRAG
 
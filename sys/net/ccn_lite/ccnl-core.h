@@ -24,6 +24,8 @@
 #ifndef CCNL_CORE_H__
 #define CCNL_CORE_H__
 
+#include "bloom.h"
+
 #define EXACT_MATCH 1
 #define PREFIX_MATCH 0
 
@@ -36,6 +38,14 @@
 #define CCNL_FACE_FLAGS_SERVED	4
 #define CCNL_FACE_FLAGS_FWDALLI	8 // forward all interests, also known ones
 #define CCNL_FACE_FLAGS_BROADCAST  16
+#define CCNL_FACE_FLAGS_COPYDOWN   32 // the packet being received is to be cached
+
+// admission policies of the content store, all evict the least recently used
+#define CCNL_CACHE_ALL      0 // every content
+#define CCNL_CACHE_PROB     1 // with probability cache_prob/256
+#define CCNL_CACHE_LCD      2 // leave copy down: one hop below a hit or the producer
+#define CCNL_CACHE_SIZE     3 // small packets always, larger ones the less likely the larger
+#define CCNL_CACHE_POLICIES 4
 
 #define CCNL_FRAG_NONE		0
 #define CCNL_FRAG_SEQUENCED2012	1
@@ -47,13 +57,29 @@
 #define CCNL_FORWARD_FLAGS_STATIC  0x01
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <time.h>
 #include <sys/time.h>
 
+#include "mempool.h"
+
 #include "ccnl.h"
 
 // ----------------------------------------------------------------------
 
+// links an entry into a list ordered by last_used, all entries of a list
+// share the same timeout, so the oldest one expires first
+struct ccnl_age_s {
+    struct ccnl_age_s *newer, *older;
+};
+
+struct ccnl_age_list_s {
+    struct ccnl_age_s *newest, *oldest;
+};
+
+// the entry of type t holding the ccnl_age_s a in its member age
+#define CCNL_AGE_ENTRY(a, t) ((t *) ((char *) (a) - offsetof(t, age)))
+
 typedef union {
     uint16_t id;
 } sockunion;
@@ -78,6 +104,13 @@ struct ccnl_if_s { // interface for packet IO
     struct ccnl_txrequest_s queue[CCNL_MAX_IF_QLEN];
     struct ccnl_sched_s *sched;
     struct ccnl_face_s *broadcast_face;
+    unsigned char *frame; // packs queued packets to a peer, NULL: no batching
+    int framelen;
+};
+
+struct ccnl_cache_stat_s { // counted for the policy in force
+    int hits, misses;       // interests answered from the store, or not
+    int admitted, rejected; // content seen
 };
 
 struct ccnl_relay_s {
@@ -87,9 +120,25 @@ struct ccnl_relay_s {
     struct ccnl_forward_s *fib;
     struct ccnl_interest_s *pit;
     struct ccnl_content_s *contents; //, *contentsend;
-    struct ccnl_nonce_s *nonces;
+    struct ccnl_content_s *lru_head, *lru_tail; // dynamic contents, MRU first
+    struct ccnl_age_list_s pit_age, face_age, fib_age;
+    struct ccnl_content_ref_s *cs_index[CCNL_INDEX_BUCKETS];
+    struct ccnl_interest_s *pit_index[CCNL_INDEX_BUCKETS];
+    int pit_compcnt[CCNL_MAX_NAME_COMP + 1]; // interests per name length
+    struct ccnl_forward_s *fib_index[CCNL_INDEX_BUCKETS];
+    // dynamic routes, hashed by their first fib_threshold_aggregate components
+    struct ccnl_forward_s *fib_aggr_index[CCNL_INDEX_BUCKETS];
+    int fib_compcnt[CCNL_MAX_NAME_COMP + 1]; // routes per prefix length
+    // recent nonces, in two time slices, see ccnl_nonce_find_or_append()
+    struct bloom_t nonce_bloom[2];
+    uint8_t nonce_bits[2][BLOOM_BITFIELD_SIZE(CCNL_NONCE_BLOOM_BITS)];
+    int nonce_slice;            // slice taking new nonces
+    int nonce_cnt;              // nonces in it
     int contentcnt;		// number of cached items
     int max_cache_entries;	// -1: unlimited
+    int cache_policy;           // CCNL_CACHE_*
+    int cache_prob;             // of 256, for CCNL_CACHE_PROB
+    struct ccnl_cache_stat_s cache_stat[CCNL_CACHE_POLICIES];
     struct ccnl_if_s ifs[CCNL_MAX_INTERFACES];
     int ifcount;		// number of active interfaces
     char halt_flag;
@@ -111,17 +160,26 @@ struct ccnl_buf_s {
     unsigned char data[1];
 };
 
-struct ccnl_nonce_s {
-    struct ccnl_nonce_s *next, *prev;
-    struct timeval created;
-    struct ccnl_buf_s *buf;
-};
-
 struct ccnl_prefix_s {
     unsigned char **comp;
     int *complen;
     int compcnt;
     unsigned char *path; // memory for name component copies
+    uint32_t *hash; // hash[k]: of the first k+1 components, parsed names only
+};
+
+// an interest or content object parsed in place: the name components,
+// nonce, ppkd and content point into the received data, nothing is copied
+struct ccnl_parsed_s {
+    unsigned char *pkt; // the whole packet, including its dtag
+    int pktlen;
+    struct ccnl_prefix_s prefix; // uses the arrays below
+    unsigned char *comp[CCNL_MAX_NAME_COMP + 1];
+    int complen[CCNL_MAX_NAME_COMP];
+    uint32_t hash[CCNL_MAX_NAME_COMP];
+    unsigned char *nonce, *ppkd, *content; // NULL if not present
+    int noncelen, ppkdlen, contlen;
+    int scope, aok, minsfx, maxsfx;
 };
 
 struct ccnl_stat_s {
@@ -158,6 +216,7 @@ struct ccnl_face_s {
     sockunion peer;
     int flags;
     struct timeval last_used; // updated when we receive a packet
+    struct ccnl_age_s age;
     struct ccnl_buf_s *outq, *outqend; // queue of packets to send
     struct ccnl_frag_s *frag;  // which special datagram armoring
     struct ccnl_sched_s *sched;
@@ -171,10 +230,17 @@ struct ccnl_forward_s {
     struct ccnl_face_s *face;
     int flags;
     struct timeval last_used; // updated when we use this fib entry
+    struct ccnl_age_s age;
+    struct ccnl_forward_s *hnext; // next in fib_index bucket
+    uint32_t hash;                // name hash of prefix
+    struct ccnl_forward_s *anext; // next in fib_aggr_index bucket
+    uint32_t ahash;               // hash of the first fib_threshold_aggregate components
 };
 
 struct ccnl_interest_s {
     struct ccnl_interest_s *next, *prev;
+    struct ccnl_interest_s *hnext; // next in pit_index bucket
+    uint32_t hash;                 // name hash of prefix
     struct ccnl_face_s *from;
     struct ccnl_pendint_s *pending; // linked list of faces wanting that content
     struct ccnl_prefix_s *prefix;
@@ -182,6 +248,7 @@ struct ccnl_interest_s {
     struct ccnl_buf_s *ppkd;	   // publisher public key digest
     struct ccnl_buf_s *pkt;	   // full datagram
     struct timeval last_used;
+    struct ccnl_age_s age;
     int retries;
     struct ccnl_forward_s *forwarded_over;
 };
@@ -204,6 +271,16 @@ struct ccnl_content_s {
     // >> CCNL: currently no stale bit, old content is fully removed <<
     struct timeval last_used;
     int served_cnt;
+    struct ccnl_content_s *lru_next, *lru_prev;
+    struct ccnl_content_ref_s *refs; // one index entry per name prefix
+};
+
+// index entry for a content, hashed by one of the prefixes of its name
+struct ccnl_content_ref_s {
+    struct ccnl_content_ref_s *next;
+    struct ccnl_content_s *content;
+    uint32_t hash;
+    int compcnt; // number of name components covered by hash
 };
 
 // ----------------------------------------------------------------------
@@ -245,6 +322,12 @@ ccnl_content_new(struct ccnl_relay_s *ccnl, struct ccnl_buf_s **pkt,
 struct ccnl_content_s *
 ccnl_content_add2cache(struct ccnl_relay_s *ccnl, struct ccnl_content_s *c);
 
+struct ccnl_content_s *
+ccnl_content_find_dup(struct ccnl_relay_s *ccnl, struct ccnl_prefix_s *p,
+                      unsigned char *pkt, int len);
+
+uint32_t ccnl_hash_prefix(struct ccnl_prefix_s *p, int compcnt);
+
 void ccnl_content_learn_name_route(struct ccnl_relay_s *ccnl, struct ccnl_prefix_s *p,
                                    struct ccnl_face_s *f, int threshold_prefix, int flags);
 
@@ -260,6 +343,12 @@ ccnl_face_remove(struct ccnl_relay_s *ccnl, struct ccnl_face_s *f);
 struct ccnl_forward_s *
 ccnl_forward_remove(struct ccnl_relay_s *ccnl, struct ccnl_forward_s *fwd);
 
+int ccnl_parse(unsigned char **data, int *datalen, struct ccnl_parsed_s *pkt);
+
+struct ccnl_buf_s *
+ccnl_parsed_copy(struct ccnl_parsed_s *pkt, struct ccnl_prefix_s **prefix,
+                 unsigned char **content);
+
 struct ccnl_buf_s *
 ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
                                int *aok, int *min, int *max, struct ccnl_prefix_s **prefix,
@@ -269,15 +358,17 @@ ccnl_extract_prefix_nonce_ppkd(unsigned char **data, int *datalen, int *scope,
 void ccnl_do_retransmit(void *ptr, void *dummy);
 void ccnl_do_ageing(void *ptr, void *dummy);
 void ccnl_do_nonce_timeout(void *ptr, void *dummy);
+void ccnl_nonce_init(struct ccnl_relay_s *ccnl);
 
 void ccnl_interface_CTS(void *aux1, void *aux2);
+void ccnl_interface_flush(struct ccnl_relay_s *ccnl);
 
 void ccnl_face_print_stat(struct ccnl_face_s *f);
 
-#define ccnl_malloc(s)  malloc(s)
-#define ccnl_calloc(n,s)    calloc(n,s)
-#define ccnl_realloc(p,s)   realloc(p,s)
-#define ccnl_free(p)        free(p)
+#define ccnl_malloc(s)  mempool_alloc(s)
+#define ccnl_calloc(n,s)    mempool_calloc(n,s)
+#define ccnl_realloc(p,s)   mempool_realloc(p,s)
+#define ccnl_free(p)        mempool_free(p)
 
 void free_2ptr_list(void *a, void *b);
 void free_3ptr_list(void *a, void *b, void *c);
@@ -57,61 +57,118 @@ static int appserver_sent_content(uint8_t *buf, int len, uint16_t from)
     return ret;
 }
 
-static int appserver_create_content(char **prefix, uint8_t *out)
+/** Size of the object served, chunks but the last are CCNL_RIOT_CHUNK_SIZE */
+#ifndef APPSERVER_CONTENT_SIZE
+#define APPSERVER_CONTENT_SIZE (3 * CCNL_RIOT_CHUNK_SIZE - 1)
+#endif
+
+#define APPSERVER_CHUNKS (APPSERVER_CONTENT_SIZE / CCNL_RIOT_CHUNK_SIZE + 1)
+
+/** Name of the object served, the chunk number follows */
+static char *appserver_name[] = { "riot", "appserver", "test", NULL };
+#define APPSERVER_NAME_COMPS (3)
+
+/*
+ * Content objects of the chunks, encoded once when the appserver starts.
+ * An interest is answered by the chunk number of its name, the relay reads
+ * the packet straight from here.
+ */
+static struct {
+    unsigned char *pkt;
+    int len;
+} appserver_store[APPSERVER_CHUNKS];
+
+static int appserver_store_init(void)
 {
-    char buf[CCNL_RIOT_CHUNK_SIZE - 1];
+    char *prefix[CCNL_MAX_NAME_COMP];
+    char segment[16];
+    char data[CCNL_RIOT_CHUNK_SIZE];
+    unsigned char *out = malloc(PAYLOAD_SIZE);
+
+    if (!out) {
+        puts("appserver_store_init: malloc failed");
+        return -1;
+    }
 
-    for (int i = 0; i < CCNL_RIOT_CHUNK_SIZE - 1; i++) {
-        buf[i] = 'a' + i%26;
+    for (int k = 0; k < APPSERVER_NAME_COMPS; k++) {
+        prefix[k] = appserver_name[k];
     }
 
-    int len = mkContent(prefix, buf, CCNL_RIOT_CHUNK_SIZE - 1, out);
-    return len;
+    prefix[APPSERVER_NAME_COMPS] = segment;
+    prefix[APPSERVER_NAME_COMPS + 1] = NULL;
+
+    for (int c = 0; c < APPSERVER_CHUNKS; c++) {
+        int offs = c * CCNL_RIOT_CHUNK_SIZE;
+        int datalen = APPSERVER_CONTENT_SIZE - offs;
+
+        if (datalen > CCNL_RIOT_CHUNK_SIZE) {
+            datalen = CCNL_RIOT_CHUNK_SIZE;
+        }
+
+        for (int i = 0; i < datalen; i++) {
+            data[i] = 'a' + (offs + i) % 26;
+        }
+
+        snprintf(segment, sizeof(segment), "%d", c);
+        appserver_store[c].len = mkContent(prefix, data, datalen, out);
+        appserver_store[c].pkt = ccnl_malloc(appserver_store[c].len);
+
+        if (!appserver_store[c].pkt) {
+            puts("appserver_store_init: malloc failed");
+            free(out);
+            return -1;
+        }
+
+        memcpy(appserver_store[c].pkt, out, appserver_store[c].len);
+    }
+
+    free(out);
+    return 0;
 }
 
-static int appserver_create_prefix(char *name, char **prefix)
+// returns the chunk number the interest asks for, -1 if it is not ours
+static int appserver_parse_interest(unsigned char *data, int datalen)
 {
-    int i = 0;
-    char *cp = strtok(name, "/");
+    struct ccnl_parsed_s pkt;
+    int num, typ, chunk = 0;
 
-    while (i < (CCNL_MAX_NAME_COMP - 1) && cp) {
-        prefix[i++] = cp;
-        cp = strtok(NULL, "/");
+    if (dehead(&data, &datalen, &num, &typ) || typ != CCN_TT_DTAG
+        || num != CCN_DTAG_INTEREST || ccnl_parse(&data, &datalen, &pkt) < 0
+        || pkt.prefix.compcnt != APPSERVER_NAME_COMPS + 1) {
+        return -1;
+    }
+
+    for (int k = 0; k < APPSERVER_NAME_COMPS; k++) {
+        if (pkt.complen[k] != (int) strlen(appserver_name[k])
+            || memcmp(pkt.comp[k], appserver_name[k], pkt.complen[k])) {
+            return -1;
+        }
     }
 
-    prefix[i] = NULL;
+    for (int k = 0; k < pkt.complen[APPSERVER_NAME_COMPS]; k++) {
+        unsigned char d = pkt.comp[APPSERVER_NAME_COMPS][k];
+
+        if (d < '0' || d > '9' || chunk >= APPSERVER_CHUNKS) {
+            return -1;
+        }
+
+        chunk = 10 * chunk + d - '0';
+    }
 
-    return i;
+    return chunk;
 }
 
 static int appserver_handle_interest(char *data, uint16_t datalen, uint16_t from)
 {
-    (void) data;
-    (void) datalen;
+    int chunk = appserver_parse_interest((unsigned char *) data, datalen);
 
-    char *prefix[CCNL_MAX_NAME_COMP];
-    //struct ccnl_interest_s *i = appserver_parse_interest(data, datalen);
-
-    char name[] = "/riot/appserver/test/0";
-    appserver_create_prefix(name, prefix);
-
-    unsigned char *content_pkg = malloc(PAYLOAD_SIZE);
-    if (!content_pkg) {
-        puts("appserver_handle_interest: malloc failed");
+    if (chunk < 0 || chunk >= APPSERVER_CHUNKS || !appserver_store[chunk].pkt) {
+        DEBUGMSG(1, "appserver: no content for the interest\n");
         return 0;
     }
-    int len = appserver_create_content(prefix, content_pkg);
-    /*
-     struct ccnl_prefix *myprefix = ccnl_path_to_prefix(name);
 
-     if (ccnl_prefix_cmp(myprefix, 0, i->prefix, CMP_EXACT) != CMP_EXACT) {
-     DEBUGMSG(1, "APPSERVER: it's a match");
-     }
-     */
-    int ret = appserver_sent_content(content_pkg, len, from);
-    free(content_pkg);
-
-    return ret;
+    return appserver_sent_content(appserver_store[chunk].pkt,
+                                  appserver_store[chunk].len, from);
 }
 
 static void riot_ccnl_appserver_ioloop(void)
@@ -169,6 +226,11 @@ static void riot_ccnl_appserver_register(void)
 void ccnl_riot_appserver_start(int _relay_pid)
 {
     relay_pid = _relay_pid;
+
+    if (appserver_store_init() < 0) {
+        return;
+    }
+
     riot_ccnl_appserver_register();
     riot_ccnl_appserver_ioloop();
     DEBUGMSG(1, "appserver terminated\n");
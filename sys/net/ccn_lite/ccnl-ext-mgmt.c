@@ -537,6 +537,88 @@ Bail:
     return rc;
 }
 
+static const char *cache_policy_names[CCNL_CACHE_POLICIES] = {
+    "all", "prob", "lcd", "size"
+};
+
+// sets the admission policy of the content store to the name in the
+// last component, "prob" may be followed by "=" and the probability of
+// 256 to cache with
+int
+ccnl_mgmt_cachepolicy(struct ccnl_relay_s *ccnl, struct ccnl_buf_s *orig,
+                      struct ccnl_prefix_s *prefix, struct ccnl_face_s *from)
+{
+    char arg[16], *val;
+    char *cp = "cachepolicy cmd failed";
+    int policy, len = prefix->complen[3], rc = -1;
+
+    DEBUGMSG(1, "ccnl_mgmt_cachepolicy\n");
+
+    if (len >= (int) sizeof(arg)) {
+        goto Bail;
+    }
+
+    memcpy(arg, prefix->comp[3], len);
+    arg[len] = '\0';
+
+    if ((val = strchr(arg, '='))) {
+        *val++ = '\0';
+    }
+
+    for (policy = 0; policy < CCNL_CACHE_POLICIES; policy++) {
+        if (!strcmp(arg, cache_policy_names[policy])) {
+            break;
+        }
+    }
+
+    if (policy == CCNL_CACHE_POLICIES || (val && policy != CCNL_CACHE_PROB)) {
+        goto Bail;
+    }
+
+    if (val) {
+        int prob = strtol(val, NULL, 0);
+
+        if (prob < 0 || prob > 256) {
+            goto Bail;
+        }
+
+        ccnl->cache_prob = prob;
+    }
+
+    ccnl->cache_policy = policy;
+    cp = "cachepolicy cmd worked";
+    rc = 0;
+
+Bail:
+    ccnl_mgmt_return_msg(ccnl, orig, from, cp);
+    return rc;
+}
+
+// replies the hits, misses, admitted and rejected content per policy,
+// the one in force marked by a '*'
+int
+ccnl_mgmt_cachestat(struct ccnl_relay_s *ccnl, struct ccnl_buf_s *orig,
+                    struct ccnl_face_s *from)
+{
+    static char reply[CCNL_CACHE_POLICIES * 64];
+    int len = 0;
+
+    DEBUGMSG(1, "ccnl_mgmt_cachestat\n");
+
+    for (int k = 0; k < CCNL_CACHE_POLICIES; k++) {
+        struct ccnl_cache_stat_s *st = ccnl->cache_stat + k;
+
+        len += snprintf(reply + len, sizeof(reply) - len,
+                        "%s%s hits=%d misses=%d admitted=%d rejected=%d\n",
+                        k == ccnl->cache_policy ? "*" : "",
+                        cache_policy_names[k], st->hits, st->misses,
+                        st->admitted, st->rejected);
+    }
+
+    ccnl_mgmt_return_msg(ccnl, orig, from, reply);
+    return 0;
+}
+
 static int ccnl_mgmt_handle(struct ccnl_relay_s *ccnl, struct ccnl_buf_s *orig,
         struct ccnl_prefix_s *prefix, struct ccnl_face_s *from, char *cmd,
         int verified)
@@ -556,6 +638,14 @@ static int ccnl_mgmt_handle(struct ccnl_relay_s *ccnl, struct ccnl_buf_s *orig,
         DEBUGMSG(1, "ccnl_mgmt_prefixreg msg\n");
         ccnl_mgmt_prefixreg(ccnl, orig, prefix, from);
     }
+    else if (!strcmp(cmd, "cachepolicy")) {
+        DEBUGMSG(1, "ccnl_mgmt_cachepolicy msg\n");
+        ccnl_mgmt_cachepolicy(ccnl, orig, prefix, from);
+    }
+    else if (!strcmp(cmd, "cachestat")) {
+        DEBUGMSG(1, "ccnl_mgmt_cachestat msg\n");
+        ccnl_mgmt_cachestat(ccnl, orig, from);
+    }
     else {
         DEBUGMSG(99, "unknown mgmt command %s\n", cmd);
 
@@ -0,0 +1,249 @@
+/*
+ * @f ccnl-ext-store.c
+ * @b CCN lite extension: content store tier in flash, kept across reboots
+ *
+ * Copyright (C) 2014, Freie Universität Berlin
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Every content the relay admits to its store is also appended to a
+ * flashlog, see sys/include/flashlog.h, which is written as a ring.
+ * Content leaving the RAM store, because it is evicted or timed out,
+ * thus stays on flash until its sector is reused.  An interest not
+ * matched in RAM looks up its name in a RAM index of the log; a record
+ * found is loaded into the RAM store again and appended anew, so content
+ * in use stays among the newest records.  At startup the index is built
+ * from the log and the CCNL_STORE_WARM newest records are loaded.
+ *
+ * The index is direct mapped by the hash of the full name, so only
+ * interests naming a content exactly are answered from flash, and a
+ * newer record takes the slot of an older one.  Packets larger than
+ * FLASHLOG_RECORD_MAX are not stored.  Records are buffered in RAM until
+ * a page is full, ccnl_store_sync() writes them, e.g. before a reboot.
+ *
+ * The flash range is set by CCNL_STORE_START, CCNL_STORE_SECTORS and
+ * CCNL_STORE_SECTOR_SIZE, on the LPC2387 e.g. to 0x40000, 8 and 0x8000.
+ */
+
+#ifdef MODULE_CCN_LITE_STORE
+
+#include <string.h>
+
+#include "flashlog.h"
+
+#include "ccnl-includes.h"
+#include "ccnx.h"
+#include "ccnl.h"
+#include "ccnl-core.h"
+#include "ccnl-ext.h"
+#include "ccnl-pdu.h"
+
+#if !defined(CCNL_STORE_START) || !defined(CCNL_STORE_SECTORS) || \
+    !defined(CCNL_STORE_SECTOR_SIZE)
+#error "ccn_lite_store needs CCNL_STORE_START, CCNL_STORE_SECTORS and CCNL_STORE_SECTOR_SIZE"
+#endif
+
+struct ccnl_store_ent_s {
+    uint32_t hash;              // of the full name
+    uint32_t stamp;             // time stamp of the record, 0: slot unused
+};
+
+static flashlog_t store_log;
+static struct ccnl_store_ent_s store_index[CCNL_STORE_INDEX];
+static uint32_t store_stamp;    // of the next record, counts up
+static int store_ok;
+static unsigned char store_buf[FLASHLOG_RECORD_MAX];
+
+// the hash of the name of a stored packet, -1 if it is no content object
+static int
+ccnl_store_hash(unsigned char *data, int datalen, struct ccnl_parsed_s *pkt,
+                uint32_t *hash)
+{
+    int num, typ;
+
+    if (dehead(&data, &datalen, &num, &typ) || typ != CCN_TT_DTAG
+        || num != CCN_DTAG_CONTENTOBJ) {
+        return -1;
+    }
+
+    if (ccnl_parse(&data, &datalen, pkt) < 0 || !pkt->content) {
+        return -1;
+    }
+
+    *hash = ccnl_hash_prefix(&pkt->prefix, pkt->prefix.compcnt);
+    return 0;
+}
+
+static void
+ccnl_store_index_add(uint32_t hash, uint32_t stamp)
+{
+    struct ccnl_store_ent_s *e = store_index + hash % CCNL_STORE_INDEX;
+
+    e->hash = hash;
+    e->stamp = stamp;
+}
+
+// adds the stored packet to the RAM store, returns the content or NULL
+// if it is broken, cached already or the store refused it
+static struct ccnl_content_s *
+ccnl_store_cache(struct ccnl_relay_s *relay, unsigned char *data, int datalen)
+{
+    struct ccnl_parsed_s pkt;
+    struct ccnl_prefix_s *prefix = NULL;
+    struct ccnl_buf_s *buf, *ppkd = NULL;
+    struct ccnl_content_s *c;
+    unsigned char *content;
+    uint32_t hash;
+
+    if (ccnl_store_hash(data, datalen, &pkt, &hash) < 0) {
+        return NULL;
+    }
+
+    if (ccnl_content_find_dup(relay, &pkt.prefix, pkt.pkt, pkt.pktlen)) {
+        return NULL;
+    }
+
+    if (!(buf = ccnl_parsed_copy(&pkt, &prefix, &content))) {
+        return NULL;
+    }
+
+    if (pkt.ppkd) {
+        ppkd = ccnl_buf_new(pkt.ppkd, pkt.ppkdlen);
+    }
+
+    c = ccnl_content_new(relay, &buf, &prefix, &ppkd, content, pkt.contlen);
+
+    if (c && !ccnl_content_add2cache(relay, c)) {
+        free_content(c);
+        c = NULL;
+    }
+
+    free_prefix(prefix);
+    free_2ptr_list(buf, ppkd);
+    return c;
+}
+
+void
+ccnl_store_init(struct ccnl_relay_s *relay)
+{
+    flashlog_cursor_t cur;
+    struct ccnl_parsed_s pkt;
+    uint32_t stamp, hash, warm = CCNL_STORE_WARM;
+    int len, cnt = 0;
+
+    if (flashlog_init(&store_log, (uint8_t *) CCNL_STORE_START,
+                      CCNL_STORE_SECTORS, CCNL_STORE_SECTOR_SIZE) < 0) {
+        DEBUGMSG(1, "ccnl_store_init: no flash log\n");
+        return;
+    }
+
+    store_ok = 1;
+
+    // newer records replace older ones in the index
+    flashlog_seek(&store_log, &cur, 0);
+
+    while ((len = flashlog_read(&store_log, &cur, &stamp, store_buf,
+                                sizeof(store_buf))) >= 0) {
+        if (ccnl_store_hash(store_buf, len, &pkt, &hash) == 0) {
+            ccnl_store_index_add(hash, stamp);
+            cnt++;
+        }
+    }
+
+    store_stamp = store_log.last + 1;
+
+    if (relay->max_cache_entries >= 0
+        && warm > (uint32_t) relay->max_cache_entries) {
+        warm = relay->max_cache_entries;
+    }
+
+    DEBUGMSG(1, "ccnl_store_init: %d records, loading the newest %d\n", cnt,
+             (int) warm);
+
+    // the newest records are the hot set
+    flashlog_seek(&store_log, &cur, store_stamp > warm ? store_stamp - warm : 0);
+
+    while (warm && (len = flashlog_read(&store_log, &cur, NULL, store_buf,
+                                        sizeof(store_buf))) >= 0) {
+        ccnl_store_cache(relay, store_buf, len);
+    }
+}
+
+void
+ccnl_store_append(struct ccnl_relay_s *relay, struct ccnl_content_s *c)
+{
+    (void) relay;
+
+    if (!store_ok || (c->flags & CCNL_CONTENT_FLAGS_STATIC)
+        || c->pkt->datalen > FLASHLOG_RECORD_MAX) {
+        return;
+    }
+
+    if (flashlog_append(&store_log, store_stamp, c->pkt->data,
+                        c->pkt->datalen) < 0) {
+        DEBUGMSG(1, "ccnl_store_append: flash log error\n");
+        return;
+    }
+
+    ccnl_store_index_add(ccnl_hash_prefix(c->name, c->name->compcnt),
+                         store_stamp++);
+}
+
+// loads the stored content named p into the RAM store, returns 1 if one
+// was loaded, the caller looks the interest up again
+int
+ccnl_store_load(struct ccnl_relay_s *relay, struct ccnl_prefix_s *p)
+{
+    uint32_t hash = ccnl_hash_prefix(p, p->compcnt), stamp;
+    struct ccnl_store_ent_s *e = store_index + hash % CCNL_STORE_INDEX;
+    struct ccnl_content_s *c;
+    flashlog_cursor_t cur;
+    int len;
+
+    if (!store_ok || !e->stamp || e->hash != hash) {
+        return 0;
+    }
+
+    flashlog_seek(&store_log, &cur, e->stamp);
+    len = flashlog_read(&store_log, &cur, &stamp, store_buf,
+                        sizeof(store_buf));
+
+    if (len < 0 || stamp != e->stamp) {
+        // the sector was erased meanwhile
+        e->stamp = 0;
+        return 0;
+    }
+
+    if (!(c = ccnl_store_cache(relay, store_buf, len))) {
+        return 0;
+    }
+
+    DEBUGMSG(7, "  loaded from flash: '%s'\n", ccnl_prefix_to_path(c->name));
+    ccnl_store_append(relay, c);
+    return 1;
+}
+
+void
+ccnl_store_sync(struct ccnl_relay_s *relay)
+{
+    (void) relay;
+
+    if (store_ok) {
+        flashlog_sync(&store_log);
+    }
+}
+
+#endif // MODULE_CCN_LITE_STORE
+
+// eof
@@ -0,0 +1,242 @@
+/*
+ * @f ccnl-ext-udp.c
+ * @b CCN lite extension: UDP interface of the RIOT relay
+ *
+ * Copyright (C) 2014, Freie Universität Berlin
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * The relay's third interface bridges CCN traffic to an IP backhaul,
+ * e.g. from a border router or over the TAP device of native.  A thread
+ * of its own waits on a destiny UDP socket and hands every datagram to
+ * the relay as a CCNL_RIOT_UDP message.  The sender id of a UDP face is
+ * one more than the index of the peer in a table, ids must be > 0: peers added by
+ * ccnl_riot_udp_peer_add() are the backhaul, interests without a route
+ * are sent to all of them; peers sending to the relay are added when
+ * they are first heard.
+ */
+
+#ifdef MODULE_CCN_LITE_UDP
+
+#include <string.h>
+
+#include "msg.h"
+#include "thread.h"
+#include "irq.h"
+#include "destiny/socket.h"
+
+#include "ccnl-includes.h"
+#include "ccnx.h"
+#include "ccnl.h"
+#include "ccnl-core.h"
+#include "ccnl-ext.h"
+#include "ccnl-riot-compat.h"
+
+#ifndef CCNL_UDP_PEERS
+#define CCNL_UDP_PEERS      (8)
+#endif
+
+#ifndef CCNL_UDP_STACKSIZE
+#define CCNL_UDP_STACKSIZE  (KERNEL_CONF_STACKSIZE_MAIN)
+#endif
+
+#ifndef CCNL_UDP_PRIORITY
+#define CCNL_UDP_PRIORITY   (PRIORITY_MAIN - 2)
+#endif
+
+// a datagram on its way to the relay, the payload follows
+struct ccnl_udp_rx_s {
+    riot_ccnl_msg_t msg;
+    uint16_t peer;
+};
+
+// peers are only appended, the receiving thread and the applications add
+// them while the relay reads them
+static sockaddr6_t udp_peers[CCNL_UDP_PEERS];
+static uint8_t udp_static[CCNL_UDP_PEERS]; // added for the backhaul
+static volatile int udp_peercnt;
+
+static int udp_sock = -1;
+static int udp_relay_pid;
+static char udp_stack[CCNL_UDP_STACKSIZE];
+static unsigned char udp_rx_buf[CCNL_UDP_MTU];
+
+static int
+ccnl_udp_peer_find(const sockaddr6_t *sa)
+{
+    for (int k = 0; k < udp_peercnt; k++) {
+        if (udp_peers[k].sin6_port == sa->sin6_port
+            && !memcmp(&udp_peers[k].sin6_addr, &sa->sin6_addr,
+                       sizeof(ipv6_addr_t))) {
+            return k;
+        }
+    }
+
+    return -1;
+}
+
+// the port of *sa* is in network byte order
+static int
+ccnl_udp_peer_add(const sockaddr6_t *sa, int backhaul)
+{
+    unsigned state = disableIRQ();
+    int k = ccnl_udp_peer_find(sa);
+
+    if (k < 0 && udp_peercnt < CCNL_UDP_PEERS) {
+        k = udp_peercnt;
+        memcpy(&udp_peers[k], sa, sizeof(sockaddr6_t));
+        udp_static[k] = backhaul;
+        udp_peercnt = k + 1;
+    }
+    else if (k >= 0 && backhaul) {
+        udp_static[k] = 1;
+    }
+
+    restoreIRQ(state);
+    return k;
+}
+
+int
+ccnl_riot_udp_peer_add(const ipv6_addr_t *addr, uint16_t port)
+{
+    sockaddr6_t sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET6;
+    sa.sin6_port = HTONS(port);
+    memcpy(&sa.sin6_addr, addr, sizeof(ipv6_addr_t));
+
+    int k = ccnl_udp_peer_add(&sa, 1);
+
+    return (k < 0) ? -1 : k + 1;
+}
+
+static void
+ccnl_udp_thread(void)
+{
+    sockaddr6_t sa;
+    socklen_t sa_len;
+    int32_t len;
+    msg_t m;
+
+    while (1) {
+        sa_len = sizeof(sa);
+        len = destiny_socket_recvfrom(udp_sock, udp_rx_buf, sizeof(udp_rx_buf),
+                                      0, &sa, &sa_len);
+
+        if (len <= 0) {
+            continue;
+        }
+
+        // recvfrom() returns the port in host byte order
+        sa.sin6_port = HTONS(sa.sin6_port);
+
+        int peer = ccnl_udp_peer_add(&sa, 0);
+
+        if (peer < 0) {
+            DEBUGMSG(1, "ccnl udp: peer table full, datagram dropped\n");
+            continue;
+        }
+
+        struct ccnl_udp_rx_s *rx = ccnl_malloc(sizeof(*rx) + len);
+
+        if (!rx) {
+            DEBUGMSG(1, "ccnl udp: out of memory, datagram dropped\n");
+            continue;
+        }
+
+        rx->msg.payload = (unsigned char *) (rx + 1);
+        rx->msg.size = (uint16_t) len;
+        rx->peer = (uint16_t) (peer + 1);
+        memcpy(rx->msg.payload, udp_rx_buf, len);
+
+        // never blocks, a relay with a full queue loses the datagram
+        m.type = CCNL_RIOT_UDP;
+        m.content.ptr = (char *) rx;
+
+        if (msg_send(&m, udp_relay_pid, 0) != 1) {
+            ccnl_free(rx);
+        }
+    }
+}
+
+int
+ccnl_open_riotudpdev(void)
+{
+    sockaddr6_t sa;
+
+    udp_relay_pid = thread_getpid();
+    udp_sock = destiny_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin6_family = AF_INET6;
+    sa.sin6_port = HTONS(CCNL_UDP_PORT);
+
+    if (udp_sock < 0 || destiny_socket_bind(udp_sock, &sa, sizeof(sa)) < 0) {
+        DEBUGMSG(1, "ccnl udp: cannot bind port %u\n", CCNL_UDP_PORT);
+        return -1;
+    }
+
+    if (thread_create(udp_stack, sizeof(udp_stack), CCNL_UDP_PRIORITY,
+                      CREATE_STACKTEST, ccnl_udp_thread, "ccnl udp") < 0) {
+        destiny_socket_close(udp_sock);
+        udp_sock = -1;
+        return -1;
+    }
+
+    return RIOT_UDP_DEV;
+}
+
+int
+riot_send_udp(uint8_t *buf, uint16_t size, uint16_t to)
+{
+    DEBUGMSG(1, "this is a RIOT UDP based connection\n");
+    DEBUGMSG(1, "size=%" PRIu16 " to=%" PRIu16 "\n", size, to);
+
+    if (to != RIOT_BROADCAST) {
+        if (!to || to > udp_peercnt) {
+            return 0;
+        }
+
+        destiny_socket_sendto(udp_sock, buf, size, 0, &udp_peers[to - 1],
+                              sizeof(sockaddr6_t));
+        return size;
+    }
+
+    // there is no broadcast on the backhaul, the static peers stand in
+    for (int k = 0; k < udp_peercnt; k++) {
+        if (udp_static[k]) {
+            destiny_socket_sendto(udp_sock, buf, size, 0, &udp_peers[k],
+                                  sizeof(sockaddr6_t));
+        }
+    }
+
+    return size;
+}
+
+void
+ccnl_udp_RX(struct ccnl_relay_s *relay, void *ptr)
+{
+    struct ccnl_udp_rx_s *rx = ptr;
+
+    DEBUGMSG(1, "\tLength:\t%u\n", rx->msg.size);
+    DEBUGMSG(1, "\tPeer:\t%u\n", rx->peer);
+
+    ccnl_core_RX(relay, RIOT_UDP_IDX, (unsigned char *) rx->msg.payload,
+                 rx->msg.size, rx->peer);
+    ccnl_free(rx);
+}
+
+#endif // MODULE_CCN_LITE_UDP
+
+// eof
@@ -75,6 +75,31 @@ int ccnl_is_fragment(unsigned char *data, int datalen);
 
 // ----------------------------------------------------------------------
 
+#ifdef MODULE_CCN_LITE_STORE
+
+void ccnl_store_init(struct ccnl_relay_s *relay);
+
+void ccnl_store_append(struct ccnl_relay_s *relay, struct ccnl_content_s *c);
+
+int ccnl_store_load(struct ccnl_relay_s *relay, struct ccnl_prefix_s *p);
+
+void ccnl_store_sync(struct ccnl_relay_s *relay);
+#else
+# define ccnl_store_init(r)         do{}while(0)
+# define ccnl_store_append(r,c)     do{}while(0)
+# define ccnl_store_load(r,p)       0
+# define ccnl_store_sync(r)         do{}while(0)
+#endif // MODULE_CCN_LITE_STORE
+
+// ----------------------------------------------------------------------
+
+#ifdef MODULE_CCN_LITE_UDP
+
+int ccnl_open_riotudpdev(void);
+
+void ccnl_udp_RX(struct ccnl_relay_s *relay, void *ptr);
+#endif // MODULE_CCN_LITE_UDP
+
 // ----------------------------------------------------------------------
 
 int ccnl_mgmt(struct ccnl_relay_s *ccnl, struct ccnl_buf_s *buf,
@@ -30,8 +30,10 @@
 
 #define RIOT_MSG_DEV    (1)
 #define RIOT_TRANS_DEV  (2)
+#define RIOT_UDP_DEV    (3)
 
 #define RIOT_MSG_IDX (0)
 #define RIOT_TRANS_IDX (1)
+#define RIOT_UDP_IDX (2)
 
 // eof
@@ -21,7 +21,11 @@
  * 2011-03-30 created
  */
 
+#ifdef MODULE_CCN_LITE_UDP
+#define CCNL_MAX_INTERFACES             3 /* msg, transceiver and UDP interfaces */
+#else
 #define CCNL_MAX_INTERFACES             2 /* transceiver and msg interfaces */
+#endif
 
 #define CCNL_INTEREST_TIMEOUT_SEC       0
 #define CCNL_INTEREST_TIMEOUT_USEC      ((CCNL_CHECK_RETRANSMIT_USEC) * ((CCNL_MAX_INTEREST_RETRANSMIT) + 1))
@@ -53,6 +57,16 @@
 #define CCNL_MAX_IF_QLEN                64
 
 #define CCNL_MAX_NONCES                 256 // for detected dups
+#define CCNL_NONCE_BLOOM_BITS           4096 // per time slice of the nonce filter
+#define CCNL_NONCE_BLOOM_HASHES         4
+
+#define CCNL_INDEX_BUCKETS              64 // name hash buckets (power of two)
+
+#define CCNL_CACHE_PROBABILITY          64 // of 256, for CCNL_CACHE_PROB
+#define CCNL_CACHE_SIZE_REF             64 // bytes, CCNL_CACHE_SIZE always admits smaller packets
+
+#define CCNL_STORE_INDEX                128 // flash store: names indexed (direct mapped)
+#define CCNL_STORE_WARM                 32 // flash store: newest content loaded at startup
 
 #define TIMEOUT_TO_US(SEC, USEC) ((SEC)*1000*1000 + (USEC))
 
@@ -69,6 +83,7 @@
 #define CCNL_DTAG_DEVNAME	99007 // name of interface (eth0, wlan0)
 #define CCNL_DTAG_DEVFLAGS	99008 //
 #define CCNL_DTAG_MTU		99009 //
+#define CCNL_DTAG_COPYDOWN	99010 // precedes content to be cached, see CCNL_CACHE_LCD
 
 #define CCNL_DTAG_DEBUGREQUEST  99100 //
 #define CCNL_DTAG_DEBUGACTION   99101 // dump, halt, dump+halt
@@ -176,4 +176,25 @@ mkPrefixregRequest(unsigned char *out, char reg, char *path, char *faceid)
     return len;
 }
 
+// cmd is "cachepolicy" with the policy as arg, or "cachestat"
+int
+mkCacheRequest(unsigned char *out, char *cmd, char *arg)
+{
+    int len;
+
+    len = mkHeader(out, CCN_DTAG_INTEREST, CCN_TT_DTAG);   // interest
+    len += mkHeader(out + len, CCN_DTAG_NAME, CCN_TT_DTAG); // name
+
+    len += mkStrBlob(out + len, CCN_DTAG_COMPONENT, CCN_TT_DTAG, "ccnx");
+    len += mkStrBlob(out + len, CCN_DTAG_COMPONENT, CCN_TT_DTAG, "");
+    len += mkStrBlob(out + len, CCN_DTAG_COMPONENT, CCN_TT_DTAG, cmd);
+    len += mkStrBlob(out + len, CCN_DTAG_COMPONENT, CCN_TT_DTAG,
+                     arg ? arg : "");
+
+    out[len++] = 0; // end-of-name
+    out[len++] = 0; // end-of-interest
+
+    return len;
+}
+
 // ----------------------------------------------------------------------
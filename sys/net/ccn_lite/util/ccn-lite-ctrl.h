@@ -20,3 +20,5 @@ int mkNewFaceRequest(unsigned char *out, char *macsrc, char *ip4src,
                      char *host, char *port, char *flags);
 
 int mkPrefixregRequest(unsigned char *out, char reg, char *path, char *faceid);
+
+int mkCacheRequest(unsigned char *out, char *cmd, char *arg);
@@ -20,102 +20,322 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <ctype.h>
 
 #include "msg.h"
 #include "random.h"
+#include "vtimer.h"
 
 #include "ccnl.h"
 #include "ccnl-core.h"
 #include "ccnl-riot-compat.h"
 #include "ccn-lite-ctrl.h"
 #include "ccnl-pdu.h"
+#include "ccnx.h"
+#include "ccn_lite/util/ccnl-riot-client.h"
 
 msg_t mesg, rep;
 
-int ccnl_riot_client_get(unsigned int relay_pid, char *name, char *reply_buf)
+struct fetch_slot {
+    int chunk;                  // -1: slot free
+    int tries;                  // retransmissions so far
+    timex_t sent, deadline;
+    unsigned char *interest;
+    riot_ccnl_msg_t rmsg;       // read by the relay after msg_send returns
+};
+
+struct fetch_rtt {
+    int measured;
+    uint32_t srtt, rttvar, rto; // usec
+};
+
+// RFC 6298, the timeout is doubled on every retransmission
+static void fetch_rtt_sample(struct fetch_rtt *r, uint32_t sample)
+{
+    if (!r->measured) {
+        r->srtt = sample;
+        r->rttvar = sample / 2;
+        r->measured = 1;
+    }
+    else {
+        uint32_t delta = sample > r->srtt ? sample - r->srtt : r->srtt - sample;
+        r->rttvar = (3 * r->rttvar + delta) / 4;
+        r->srtt = (7 * r->srtt + sample) / 8;
+    }
+
+    r->rto = r->srtt + 4 * r->rttvar;
+
+    if (r->rto < CCNL_RIOT_FETCH_RTO_MIN) {
+        r->rto = CCNL_RIOT_FETCH_RTO_MIN;
+    }
+
+    if (r->rto > CCNL_RIOT_FETCH_RTO_MAX) {
+        r->rto = CCNL_RIOT_FETCH_RTO_MAX;
+    }
+}
+
+static void fetch_send(unsigned int relay_pid, char **prefix, int segpos,
+                       struct fetch_slot *s, uint32_t rto)
+{
+    char segment_string[16];
+    unsigned int interest_nonce = genrand_uint32();
+    msg_t m;
+
+    snprintf(segment_string, sizeof(segment_string), "%d", s->chunk);
+    prefix[segpos] = segment_string;
+    s->rmsg.payload = s->interest;
+    s->rmsg.size = mkInterest(prefix, &interest_nonce, s->interest);
+    DEBUGMSG(1, "fetch: chunk=%d try=%d rto=%" PRIu32 "\n", s->chunk, s->tries,
+             rto);
+
+    vtimer_now(&s->sent);
+    s->deadline = timex_add(s->sent, timex_set(rto / (1000 * 1000),
+                                               rto % (1000 * 1000)));
+
+    m.content.ptr = (char *) &s->rmsg;
+    m.type = CCNL_RIOT_MSG;
+    msg_send(&m, relay_pid, 1);
+}
+
+// the outstanding slot sent first, the relay times out its interests in
+// this order
+static struct fetch_slot *fetch_oldest(struct fetch_slot *slots, int window)
+{
+    struct fetch_slot *oldest = NULL;
+
+    for (int k = 0; k < window; k++) {
+        if (slots[k].chunk >= 0
+            && (!oldest || timex_cmp(slots[k].sent, oldest->sent) < 0)) {
+            oldest = &slots[k];
+        }
+    }
+
+    return oldest;
+}
+
+// returns the chunk number of a content object for the name, -1 otherwise
+static int fetch_parse(riot_ccnl_msg_t *rmsg, int segpos,
+                       struct ccnl_parsed_s *pkt)
+{
+    unsigned char *data = rmsg->payload;
+    int datalen = (int) rmsg->size, num, typ, chunk = 0;
+
+    if (dehead(&data, &datalen, &num, &typ) || typ != CCN_TT_DTAG
+        || num != CCN_DTAG_CONTENTOBJ) {
+        return -1;
+    }
+
+    if (ccnl_parse(&data, &datalen, pkt) < 0 || !pkt->content
+        || pkt->prefix.compcnt <= segpos) {
+        return -1;
+    }
+
+    for (int k = 0; k < pkt->complen[segpos]; k++) {
+        if (!isdigit(pkt->comp[segpos][k]) || chunk > INT_MAX / 10 - 1) {
+            return -1;
+        }
+
+        chunk = 10 * chunk + pkt->comp[segpos][k] - '0';
+    }
+
+    return chunk;
+}
+
+int ccnl_riot_client_fetch(unsigned int relay_pid, char *name, char *buf,
+                           int buflen, int window)
 {
     char *prefix[CCNL_MAX_NAME_COMP];
+    struct fetch_slot slots[CCNL_RIOT_FETCH_WINDOW_MAX];
+    struct fetch_rtt rtt = { 0, 0, 0, CCNL_RIOT_FETCH_RTO_INIT };
+    struct fetch_slot *s;
     char *cp = strtok(name, "/");
-    int i = 0;
+    int i = 0, k, next = 0, last = -1, content_len = -1, failed = 0;
+    timex_t now;
+    msg_t rep;
 
     while (i < (CCNL_MAX_NAME_COMP - 1) && cp) {
         prefix[i++] = cp;
         cp = strtok(NULL, "/");
     }
 
-    //prefix[i] = 0; //segment to request
     prefix[i + 1] = 0;
 
-    int content_len = 0;
-
-    for (int segment = 0; ; segment++) {
-        char segment_string[16]; //max=999\0
-        memset(segment_string, 0, 16);
-        snprintf(segment_string, 16, "%d", segment);
-        prefix[i] = segment_string;
-        unsigned char *interest_pkg = malloc(PAYLOAD_SIZE);
-        if (!interest_pkg) {
-            puts("ccnl_riot_client_get: malloc failed");
-            return 0;
-        }
-        unsigned int interest_nonce = genrand_uint32();
-        int interest_len = mkInterest(prefix, &interest_nonce, interest_pkg);
-        DEBUGMSG(1, "relay_pid=%u interest_len=%d\n", relay_pid, interest_len);
-
-        riot_ccnl_msg_t rmsg;
-        rmsg.payload = interest_pkg;
-        rmsg.size = interest_len;
-
-        msg_t m, rep;
-        m.content.ptr = (char *) &rmsg;
-        m.type = CCNL_RIOT_MSG;
-        msg_send(&m, relay_pid, 1);
-
-        /* ######################################################################### */
-
-        msg_receive(&rep);
-        free(interest_pkg);
-        if (rep.type == CCNL_RIOT_NACK) {
-            /* network stack was not able to fetch this chunk */
-            return 0;
+    if (window < 1) {
+        window = 1;
+    }
+
+    if (window > CCNL_RIOT_FETCH_WINDOW_MAX) {
+        window = CCNL_RIOT_FETCH_WINDOW_MAX;
+    }
+
+    for (k = 0; k < window; k++) {
+        slots[k].chunk = -1;
+        slots[k].interest = malloc(PAYLOAD_SIZE);
+
+        if (!slots[k].interest) {
+            puts("ccnl_riot_client_fetch: malloc failed");
+            window = k;
+            goto Done;
         }
+    }
 
-        /* we got a chunk of data from the network stack */
-        riot_ccnl_msg_t *rmsg_reply = (riot_ccnl_msg_t *) rep.content.ptr;
+    while (!failed) {
+        timex_t then = timex_set(0, 0);
+        int pending = 0;
+        unsigned long ticks;
 
-        unsigned char *data = rmsg_reply->payload;
-        int datalen = (int) rmsg_reply->size;
-        DEBUGMSG(1, "%d bytes left; msg from=%u\n", datalen, rep.sender_pid);
+        for (k = 0; k < window; k++) {
+            s = &slots[k];
 
-        int scope = 3, aok = 3, minsfx = 0, maxsfx = CCNL_MAX_NAME_COMP,
-            contlen = 0;
-        struct ccnl_buf_s *buf = 0, *nonce = 0, *ppkd = 0;
-        struct ccnl_prefix_s *p = 0;
-        unsigned char *content = 0;
+            if (s->chunk < 0 && last < 0) {
+                s->chunk = next++;
+                s->tries = 0;
+                fetch_send(relay_pid, prefix, i, s, rtt.rto);
+            }
 
-        buf = ccnl_extract_prefix_nonce_ppkd(&data, &datalen, &scope, &aok, &minsfx,
-                                             &maxsfx, &p, &nonce, &ppkd, &content, &contlen);
+            if (s->chunk >= 0 && (last < 0 || s->chunk <= last)) {
+                if (!pending || timex_cmp(s->deadline, then) < 0) {
+                    then = s->deadline;
+                }
 
-        if (!buf) {
-            DEBUGMSG(6, "  parsing error or no prefix\n");
-            return 0;
+                pending++;
+            }
         }
 
-        DEBUGMSG(1, "content_len=%d contlen=%d\n", content_len, contlen);
-        memcpy(reply_buf + content_len, content, contlen);
-        content_len += contlen;
+        if (!pending) {
+            break;
+        }
 
-        free_prefix(p);
-        free_3ptr_list(buf, nonce, ppkd);
-        ccnl_free(rmsg_reply);
+        ticks = vtimer_timeout_ticks(then);
+
+        if (ticks && msg_receive_timeout(&rep, ticks) >= 0) {
+            if (rep.type == CCNL_RIOT_NACK) {
+                // a NACK carries no name, see fetch_oldest()
+                s = fetch_oldest(slots, window);
+
+                if (!s) {
+                    continue;
+                }
+
+                if (last >= 0 && s->chunk > last) {
+                    s->chunk = -1;
+                }
+                else if (s->tries++ < CCNL_RIOT_FETCH_RETRIES) {
+                    fetch_send(relay_pid, prefix, i, s, rtt.rto);
+                }
+                else {
+                    failed = 1;
+                }
+
+                continue;
+            }
+
+            if (rep.type != CCNL_RIOT_MSG) {
+                continue;
+            }
+
+            riot_ccnl_msg_t *rmsg_reply = (riot_ccnl_msg_t *) rep.content.ptr;
+            struct ccnl_parsed_s pkt;
+            int chunk = fetch_parse(rmsg_reply, i, &pkt);
+
+            for (k = 0; k < window && slots[k].chunk != chunk; k++) {
+            }
+
+            if (chunk < 0 || k == window) {
+                // no content of this name, or a duplicate
+                DEBUGMSG(6, "  fetch: dropping reply of chunk %d\n", chunk);
+                ccnl_free(rmsg_reply);
+                continue;
+            }
+
+            s = &slots[k];
+            vtimer_now(&now);
+
+            if (s->tries == 0) {
+                // Karn: retransmitted chunks give no sample
+                fetch_rtt_sample(&rtt, (uint32_t) timex_uint64(
+                                     timex_sub(now, s->sent)));
+            }
+
+            // chunks are placed by number, so the buffer is in order
+            // whatever order they arrive in
+            if (buflen < pkt.contlen
+                || chunk > (buflen - pkt.contlen) / CCNL_RIOT_CHUNK_SIZE) {
+                puts("ccnl_riot_client_fetch: buffer too small");
+                failed = 1;
+            }
+            else {
+                memcpy(buf + chunk * CCNL_RIOT_CHUNK_SIZE, pkt.content,
+                       pkt.contlen);
+
+                if (pkt.contlen != CCNL_RIOT_CHUNK_SIZE
+                    && (last < 0 || chunk < last)) {
+                    last = chunk;
+                    content_len = chunk * CCNL_RIOT_CHUNK_SIZE + pkt.contlen;
+                }
+            }
+
+            s->chunk = -1;
+            ccnl_free(rmsg_reply);
+            continue;
+        }
 
-        if (contlen < CCNL_RIOT_CHUNK_SIZE || CCNL_RIOT_CHUNK_SIZE < contlen) {
-            /* last chunk */
-            break;
+        // timeouts
+        vtimer_now(&now);
+
+        for (k = 0; k < window; k++) {
+            s = &slots[k];
+
+            if (s->chunk < 0 || (last >= 0 && s->chunk > last)
+                || timex_cmp(s->deadline, now) > 0) {
+                continue;
+            }
+
+            if (s->tries++ == CCNL_RIOT_FETCH_RETRIES) {
+                failed = 1;
+                break;
+            }
+
+            rtt.rto = rtt.rto > CCNL_RIOT_FETCH_RTO_MAX / 2 ?
+                      CCNL_RIOT_FETCH_RTO_MAX : 2 * rtt.rto;
+            fetch_send(relay_pid, prefix, i, s, rtt.rto);
         }
     }
 
-    return content_len;
+    // wait for the NACKs of the interests sent beyond the last chunk or
+    // after a failure, they would be taken for replies by the next request
+    while ((s = fetch_oldest(slots, window))) {
+        timex_t then = timex_add(s->sent, timex_set(CCNL_INTEREST_TIMEOUT_SEC,
+                                 CCNL_INTEREST_TIMEOUT_USEC
+                                 + 2 * CCNL_CHECK_RETRANSMIT_USEC));
+        unsigned long ticks = vtimer_timeout_ticks(then);
+
+        if (!ticks || msg_receive_timeout(&rep, ticks) < 0) {
+            s->chunk = -1;
+        }
+        else if (rep.type == CCNL_RIOT_NACK) {
+            s->chunk = -1;
+        }
+        else if (rep.type == CCNL_RIOT_MSG) {
+            ccnl_free(rep.content.ptr);
+        }
+    }
+
+Done:
+    for (k = 0; k < window; k++) {
+        free(slots[k].interest);
+    }
+
+    return failed ? -1 : content_len;
+}
+
+int ccnl_riot_client_get(unsigned int relay_pid, char *name, char *reply_buf)
+{
+    int content_len = ccnl_riot_client_fetch(relay_pid, name, reply_buf,
+                                             INT_MAX, 1);
+
+    return content_len < 0 ? 0 : content_len;
 }
 
 int ccnl_riot_client_new_face(unsigned int relay_pid, char *type, char *faceid,
@@ -177,6 +397,36 @@ int ccnl_riot_client_register_prefix(unsigned int relay_pid, char *prefix, char
     return size;
 }
 
+int ccnl_riot_client_cache(unsigned int relay_pid, char *cmd, char *arg,
+                           unsigned char *reply_buf)
+{
+    DEBUGMSG(1, "riot_cache: mkCacheRequest\n");
+    int len = mkCacheRequest(reply_buf, cmd, arg);
+
+    riot_ccnl_msg_t rmsg;
+    rmsg.payload = reply_buf;
+    rmsg.size = len;
+
+    msg_t m, rep;
+    m.content.ptr = (char *) &rmsg;
+    m.type = CCNL_RIOT_MSG;
+    DEBUGMSG(1, "  sending cache req to relay\n");
+    msg_send(&m, relay_pid, 1);
+
+    /* ######################################################################### */
+
+    msg_receive(&rep);
+    DEBUGMSG(1, "  received reply from relay\n");
+    riot_ccnl_msg_t *rmsg_reply = (riot_ccnl_msg_t *) rep.content.ptr;
+    memcpy(reply_buf, rmsg_reply->payload, rmsg_reply->size);
+    reply_buf[rmsg_reply->size] = '\0';
+    int size = rmsg_reply->size;
+
+    ccnl_free(rmsg_reply);
+
+    return size;
+}
+
 int ccnl_riot_client_publish(unsigned int relay_pid, char *prefix, char *faceid, char *type, unsigned char *reply_buf)
 {
     ccnl_riot_client_new_face(relay_pid, type, faceid, reply_buf);
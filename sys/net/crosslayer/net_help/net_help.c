@@ -31,41 +31,115 @@ void printArrayRange(uint8_t *array, uint16_t len, char *str)
     printf("\n-----------%u-------------\n", len);
 }
 
+/* word types that may alias the byte buffers handed to csum() */
+typedef uint16_t __attribute__((__may_alias__)) csum_u16_t;
+typedef uint32_t __attribute__((__may_alias__)) csum_u32_t;
+
+/* folds a 32 bit one's complement accumulator into 16 bit */
+static inline uint16_t csum_fold(uint32_t acc)
+{
+    acc = (acc & 0xffff) + (acc >> 16);
+    acc = (acc & 0xffff) + (acc >> 16);
+    return (uint16_t) acc;
+}
+
+/*
+ * Sums an aligned buffer in the CPU's native byte order. RFC 1071 lets us
+ * do that and swap the folded result once, instead of assembling each
+ * big endian word from two bytes.
+ */
+static uint16_t csum_native(const uint8_t *buf, uint16_t len)
+{
+#if defined(__MSP430__)
+    /* 16 bit CPU: 32 bit arithmetic is expensive, stay with 16 bit words */
+    uint32_t acc = 0;
+    const csum_u16_t *w = (const csum_u16_t *) buf;
+
+    for (; len >= 8; len -= 8, w += 4) {
+        acc += w[0];
+        acc += w[1];
+        acc += w[2];
+        acc += w[3];
+    }
+
+    for (; len >= 2; len -= 2) {
+        acc += *w++;
+    }
+
+    return csum_fold(acc);
+#else
+    uint64_t acc = 0;
+
+    if (((uintptr_t) buf & 2) && (len >= 2)) {
+        acc += *(const csum_u16_t *) buf;
+        buf += 2;
+        len -= 2;
+    }
+
+    const csum_u32_t *w = (const csum_u32_t *) buf;
+
+    for (; len >= 16; len -= 16, w += 4) {
+        acc += w[0];
+        acc += w[1];
+        acc += w[2];
+        acc += w[3];
+    }
+
+    for (; len >= 4; len -= 4) {
+        acc += *w++;
+    }
+
+    if (len >= 2) {
+        acc += *(const csum_u16_t *) w;
+    }
+
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    return csum_fold((uint32_t) acc);
+#endif
+}
+
 uint16_t csum(uint16_t sum, uint8_t *buf, uint16_t len)
 {
-    int count;
-    uint16_t carry;
-
-    count = len >> 1;
-
-    if (count) {
-        if (count) {
-            carry = 0;
-
-            do {
-                uint16_t t = (*buf << 8) + *(buf + 1);
-                count--;
-                buf += 2;
-                sum += carry;
-                sum += t;
-                carry = (t > sum);
-            }
-            while (count);
-
-            sum += carry;
+    uint32_t acc = sum;
+
+    if (((uintptr_t) buf & 1) == 0) {
+        uint16_t part = csum_native(buf, len);
+#if __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+        part = (uint16_t)((part << 8) | (part >> 8));
+#endif
+        acc += part;
+    }
+    else {
+        /* unaligned buffers can not be read word-wise on every platform */
+        for (uint16_t i = 0; i + 1 < len; i += 2) {
+            acc += (uint16_t)((buf[i] << 8) | buf[i + 1]);
         }
     }
 
     if (len & 1) {
-        uint16_t u = (*buf << 8);
-        sum += (*buf << 8);
-
-        if (sum < u) {
-            sum++;
-        }
+        acc += (uint16_t)(buf[len - 1] << 8);
     }
 
-    return sum;
+    return csum_fold(acc);
+}
+
+uint16_t csum_update16(uint16_t checksum, uint16_t old_val, uint16_t new_val)
+{
+    /* RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m') */
+    uint32_t acc = (uint16_t) ~checksum;
+
+    acc += (uint16_t) ~old_val;
+    acc += new_val;
+
+    return (uint16_t) ~csum_fold(acc);
+}
+
+uint16_t csum_update32(uint16_t checksum, uint32_t old_val, uint32_t new_val)
+{
+    checksum = csum_update16(checksum, (uint16_t)(old_val >> 16),
+                             (uint16_t)(new_val >> 16));
+    return csum_update16(checksum, (uint16_t) old_val, (uint16_t) new_val);
 }
 
 /**
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup netstat
+ * @{
+ * @file    netstat.c
+ * @brief   Storage of the network statistics.
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "netstat.h"
+
+netstat_counters_t netstat_layers[NETSTAT_LAYER_NUMOF];
+uint32_t netstat_drops[NETSTAT_DROP_NUMOF];
+
+static const char *layer_names[NETSTAT_LAYER_NUMOF] = {
+    "mac", "lowpan", "ipv6", "udp", "tcp"
+};
+
+static const char *drop_names[NETSTAT_DROP_NUMOF] = {
+    "no_buffer", "malformed", "duplicate", "reas_timeout", "reas_evicted",
+    "checksum", "no_route", "hop_limit", "no_handler", "socket_full",
+    "tx_failed"
+};
+
+void netstat_reset(void)
+{
+    memset(netstat_layers, 0, sizeof(netstat_layers));
+    memset(netstat_drops, 0, sizeof(netstat_drops));
+}
+
+const char *netstat_layer_name(netstat_layer_t layer)
+{
+    return (layer < NETSTAT_LAYER_NUMOF) ? layer_names[layer] : "?";
+}
+
+const char *netstat_drop_name(netstat_drop_t reason)
+{
+    return (reason < NETSTAT_DROP_NUMOF) ? drop_names[reason] : "?";
+}
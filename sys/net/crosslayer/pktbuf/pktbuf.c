@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2013  Freie Universität Berlin.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup pktbuf
+ * @{
+ * @file    pktbuf.c
+ * @brief   Implementation of the packet buffer pools.
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "irq.h"
+
+#include "pktbuf.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+static pktbuf_t pktbuf_small[PKTBUF_SMALL_NUM];
+static pktbuf_t pktbuf_large[PKTBUF_LARGE_NUM];
+static uint8_t pktbuf_small_mem[PKTBUF_SMALL_NUM][PKTBUF_SMALL_SIZE];
+static uint8_t pktbuf_large_mem[PKTBUF_LARGE_NUM][PKTBUF_LARGE_SIZE];
+
+static pktbuf_t *pktbuf_take(pktbuf_t *pool, uint8_t *mem, int num,
+                             uint16_t size)
+{
+    for (int i = 0; i < num; i++) {
+        if (pool[i].refs == 0) {
+            pool[i].refs = 1;
+            pool[i].head = &mem[i * size];
+            pool[i].size = size;
+            return &pool[i];
+        }
+    }
+
+    return NULL;
+}
+
+pktbuf_t *pktbuf_alloc(uint16_t len, uint16_t headroom)
+{
+    pktbuf_t *pkt = NULL;
+    uint32_t needed = (uint32_t) len + headroom;
+    unsigned state;
+
+    if (needed > PKTBUF_LARGE_SIZE) {
+        DEBUG("pktbuf: request for %lu bytes too large\n",
+              (unsigned long) needed);
+        return NULL;
+    }
+
+    state = disableIRQ();
+
+    if (needed <= PKTBUF_SMALL_SIZE) {
+        pkt = pktbuf_take(pktbuf_small, &pktbuf_small_mem[0][0],
+                          PKTBUF_SMALL_NUM, PKTBUF_SMALL_SIZE);
+    }
+
+    /* small class exhausted or too small: fall back to a large buffer */
+    if (pkt == NULL) {
+        pkt = pktbuf_take(pktbuf_large, &pktbuf_large_mem[0][0],
+                          PKTBUF_LARGE_NUM, PKTBUF_LARGE_SIZE);
+    }
+
+    restoreIRQ(state);
+
+    if (pkt == NULL) {
+        DEBUG("pktbuf: no buffer left for %lu bytes\n",
+              (unsigned long) needed);
+        return NULL;
+    }
+
+    pkt->data = pkt->head + headroom;
+    pkt->len = len;
+
+    return pkt;
+}
+
+void pktbuf_hold(pktbuf_t *pkt)
+{
+    unsigned state = disableIRQ();
+    pkt->refs++;
+    restoreIRQ(state);
+}
+
+void pktbuf_release(pktbuf_t *pkt)
+{
+    unsigned state;
+
+    if (pkt == NULL) {
+        return;
+    }
+
+    state = disableIRQ();
+
+    if (pkt->refs > 0) {
+        pkt->refs--;
+    }
+
+    restoreIRQ(state);
+}
+
+uint8_t *pktbuf_push(pktbuf_t *pkt, uint16_t len)
+{
+    if (pktbuf_headroom(pkt) < len) {
+        return NULL;
+    }
+
+    pkt->data -= len;
+    pkt->len += len;
+
+    return pkt->data;
+}
+
+uint8_t *pktbuf_pull(pktbuf_t *pkt, uint16_t len)
+{
+    if (pkt->len < len) {
+        return NULL;
+    }
+
+    pkt->data += len;
+    pkt->len -= len;
+
+    return pkt->data;
+}
+
+uint8_t *pktbuf_trim(pktbuf_t *pkt, uint16_t len)
+{
+    if (pkt->len < len) {
+        return NULL;
+    }
+
+    pkt->len = len;
+
+    return pkt->data;
+}
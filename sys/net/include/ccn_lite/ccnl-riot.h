@@ -48,6 +48,7 @@ typedef enum ccnl_riot_event {
     CCNL_RIOT_PRINT_STAT,
     CCNL_RIOT_TIMEOUT,
     CCNL_RIOT_NACK,
+    CCNL_RIOT_UDP,
 
     CCNL_RIOT_RESERVED
 } ccnl_riot_event_t;
@@ -78,6 +79,37 @@ typedef enum ccnl_riot_event {
  */
 void ccnl_riot_relay_start(int max_cache_entries, int fib_threshold_prefix, int fib_threshold_aggregate);
 
+#ifdef MODULE_CCN_LITE_UDP
+#include "ipv6.h"
+
+/**
+ * @brief UDP port of the relay's UDP interface, the CCNx port
+ */
+#ifndef CCNL_UDP_PORT
+#define CCNL_UDP_PORT       (9695)
+#endif
+
+/**
+ * @brief largest datagram sent or received by the UDP interface
+ */
+#ifndef CCNL_UDP_MTU
+#define CCNL_UDP_MTU        (512)
+#endif
+
+/**
+ * @brief adds a peer of the UDP interface, e.g. a relay of the backhaul
+ *
+ * Interests without a route go to all peers added this way.  Peers
+ * sending to the relay are added by the relay itself.
+ *
+ * @param addr  address of the peer
+ * @param port  UDP port of the peer in host byte order
+ *
+ * @return the id of the peer's face, -1 if the peer table is full
+ */
+int ccnl_riot_udp_peer_add(const ipv6_addr_t *addr, uint16_t port);
+#endif
+
 /**
  * @brief  starts an appication server, which can repy to ccn interests
  *
@@ -27,6 +27,29 @@
 #ifndef CCNL_RIOT_CLIENT_H
 #define CCNL_RIOT_CLIENT_H
 
+/**
+ * @brief interests ccnl_riot_client_fetch() keeps outstanding at most
+ */
+#ifndef CCNL_RIOT_FETCH_WINDOW_MAX
+#define CCNL_RIOT_FETCH_WINDOW_MAX  (8)
+#endif
+
+/**
+ * @brief timeout of an interest before a round trip was measured, in usec
+ */
+#define CCNL_RIOT_FETCH_RTO_INIT    (1000 * 1000)
+
+/**
+ * @brief bounds of the timeout of an interest, in usec
+ */
+#define CCNL_RIOT_FETCH_RTO_MIN     (100 * 1000)
+#define CCNL_RIOT_FETCH_RTO_MAX     (4 * 1000 * 1000)
+
+/**
+ * @brief retransmissions of an interest before a fetch gives up
+ */
+#define CCNL_RIOT_FETCH_RETRIES     (5)
+
 /**
  * @brief  high level function to fetch a file (all chunks of a file)
  *
@@ -40,6 +63,38 @@
  */
 int ccnl_riot_client_get(unsigned int relay_pid, char *name, char *reply_buf);
 
+/**
+ * @brief  fetches all chunks of a file with up to *window* interests
+ *         outstanding
+ *
+ * The chunks are written to their place in *buf* as they arrive, in any
+ * order.  Interests are retransmitted after a timeout derived from the
+ * measured round trip times, or when the relay reports one to have timed
+ * out.  The last chunk is the first one not of CCNL_RIOT_CHUNK_SIZE bytes;
+ * interests sent beyond it are waited for to time out in the relay, so
+ * no stale reply reaches the caller later.
+ *
+ * @note   the calling thread needs a message queue of more than *window*
+ *         messages
+ *
+ * @param relay_pid pid of the relay thread
+ *
+ * @param name c string represenation of the name to fetch e.g. "/riot/test",
+ *             it is modified
+ *
+ * @param buf buffer for the content
+ *
+ * @param buflen size of buf
+ *
+ * @param window interests outstanding at most, 1 to
+ *               CCNL_RIOT_FETCH_WINDOW_MAX
+ *
+ * @return the length of the content stored in buf, -1 if a chunk could
+ *         not be fetched or buf is too small
+ */
+int ccnl_riot_client_fetch(unsigned int relay_pid, char *name, char *buf,
+        int buflen, int window);
+
 /**
  * @brief   high level function to publish a name, e.g. "/riot/test"
  *          all interest with "prefix" as prefix  received by the rely
@@ -103,6 +158,24 @@ int ccnl_riot_client_new_face(unsigned int relay_pid, char *type, char *faceid,
 int ccnl_riot_client_register_prefix(unsigned int relay_pid, char *prefix,
         char *faceid, unsigned char *reply_buf);
 
+/**
+ * @brief lower layer function to set the admission policy of the
+ *        content store or to get its hit counters
+ *
+ * @param relay_pid pid of the relay
+ *
+ * @param cmd "cachepolicy" or "cachestat"
+ *
+ * @param arg for "cachepolicy" one of "all", "prob", "lcd" and "size",
+ *            "prob=<n>" caches with a probability of n/256
+ *
+ * @param reply_buf buffer for the aswer message from the relay
+ *
+ * @return the length of the reply message stored in reply_buf
+ */
+int ccnl_riot_client_cache(unsigned int relay_pid, char *cmd, char *arg,
+        unsigned char *reply_buf);
+
 /**
  * @}
  */
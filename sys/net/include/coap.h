@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_coap CoAP
+ * @ingroup     net
+ * @brief       CoAP server on destiny UDP sockets
+ *
+ * A thread receives requests on COAP_PORT and hands them to the handler
+ * of the matching resource.  Requests are not copied once received: the
+ * options are read where they are, with coap_opt_next() or coap_opt_find(),
+ * and the response is written by the handler straight into the transmit
+ * buffer, options first, in increasing order, then the payload.
+ *
+ * Confirmable requests are answered with a piggybacked response.
+ * Representations larger than a block are sent block-wise with
+ * coap_resp_block2(), uploads in blocks are read with coap_req_block().
+ * A GET with an Observe option registers the client on an observable
+ * resource; coap_notify() runs the handler once and sends the result to
+ * every observer, as non-confirmable notifications.
+ *
+ *     static int temp_get(const coap_request_t *req, coap_response_t *resp,
+ *                         void *arg)
+ *     {
+ *         uint16_t max;
+ *         char *p = (char *) coap_resp_payload(resp, &max);
+ *
+ *         coap_resp_opt_uint(resp, COAP_OPT_CONTENT_FORMAT, COAP_FORMAT_TEXT);
+ *         return coap_resp_payload_len(resp, snprintf(p, max, "%d", temp));
+ *     }
+ *
+ *     static const coap_resource_t resources[] = {
+ *         { "/temp", COAP_METHOD_GET, 1, temp_get, NULL },
+ *     };
+ *
+ *     coap_init(resources, 1);
+ *
+ * @see     <a href="http://tools.ietf.org/html/rfc7252">RFC 7252</a>,
+ *          <a href="http://tools.ietf.org/html/draft-ietf-core-observe">
+ *              Observing Resources in CoAP
+ *          </a>,
+ *          <a href="http://tools.ietf.org/html/draft-ietf-core-block">
+ *              Blockwise transfers in CoAP
+ *          </a>
+ * @{
+ *
+ * @file        coap.h
+ */
+
+#ifndef COAP_H
+#define COAP_H
+
+#include <stdint.h>
+
+#include "kernel.h"
+#include "destiny/socket.h"
+
+/**
+ * @brief   UDP port of the server.
+ */
+#ifndef COAP_PORT
+#define COAP_PORT                   (5683)
+#endif
+
+/**
+ * @brief   Size of the receive and of the transmit buffer.
+ */
+#ifndef COAP_BUF_SIZE
+#define COAP_BUF_SIZE               (128)
+#endif
+
+/**
+ * @brief   Largest block size sent, as exponent: 2^(COAP_BLOCK_SZX + 4).
+ */
+#ifndef COAP_BLOCK_SZX
+#define COAP_BLOCK_SZX              (2)
+#endif
+
+/**
+ * @brief   Observers of all resources together.
+ */
+#ifndef COAP_OBSERVERS_NUMOF
+#define COAP_OBSERVERS_NUMOF        (8)
+#endif
+
+/**
+ * @brief   Stack size of the server thread, the handlers run on it.
+ */
+#ifndef COAP_STACKSIZE
+#define COAP_STACKSIZE              (KERNEL_CONF_STACKSIZE_MAIN)
+#endif
+
+/**
+ * @brief   Thread priority of the server.
+ */
+#ifndef COAP_PRIORITY
+#define COAP_PRIORITY               (PRIORITY_MAIN - 1)
+#endif
+
+/**
+ * @name Message types
+ * @{
+ */
+#define COAP_TYPE_CON               (0)
+#define COAP_TYPE_NON               (1)
+#define COAP_TYPE_ACK               (2)
+#define COAP_TYPE_RST               (3)
+/** @} */
+
+/**
+ * @brief   A code from its class and detail, e.g. COAP_CODE(2, 5) for 2.05.
+ */
+#define COAP_CODE(c, d)             (((c) << 5) | (d))
+
+/**
+ * @name Method and response codes
+ * @{
+ */
+#define COAP_GET                    COAP_CODE(0, 1)
+#define COAP_POST                   COAP_CODE(0, 2)
+#define COAP_PUT                    COAP_CODE(0, 3)
+#define COAP_DELETE                 COAP_CODE(0, 4)
+#define COAP_CODE_CREATED           COAP_CODE(2, 1)
+#define COAP_CODE_DELETED           COAP_CODE(2, 2)
+#define COAP_CODE_VALID             COAP_CODE(2, 3)
+#define COAP_CODE_CHANGED           COAP_CODE(2, 4)
+#define COAP_CODE_CONTENT           COAP_CODE(2, 5)
+#define COAP_CODE_CONTINUE          COAP_CODE(2, 31)
+#define COAP_CODE_BAD_REQUEST       COAP_CODE(4, 0)
+#define COAP_CODE_BAD_OPTION        COAP_CODE(4, 2)
+#define COAP_CODE_NOT_FOUND         COAP_CODE(4, 4)
+#define COAP_CODE_NOT_ALLOWED       COAP_CODE(4, 5)
+#define COAP_CODE_INCOMPLETE        COAP_CODE(4, 8)
+#define COAP_CODE_TOO_LARGE         COAP_CODE(4, 13)
+#define COAP_CODE_INTERNAL_ERROR    COAP_CODE(5, 0)
+/** @} */
+
+/**
+ * @name Methods a resource accepts, see coap_resource_t
+ * @{
+ */
+#define COAP_METHOD_GET             (1 << (COAP_GET - 1))
+#define COAP_METHOD_POST            (1 << (COAP_POST - 1))
+#define COAP_METHOD_PUT             (1 << (COAP_PUT - 1))
+#define COAP_METHOD_DELETE          (1 << (COAP_DELETE - 1))
+/** @} */
+
+/**
+ * @name Option numbers
+ * @{
+ */
+#define COAP_OPT_IF_MATCH           (1)
+#define COAP_OPT_URI_HOST           (3)
+#define COAP_OPT_ETAG               (4)
+#define COAP_OPT_IF_NONE_MATCH      (5)
+#define COAP_OPT_OBSERVE            (6)
+#define COAP_OPT_URI_PORT           (7)
+#define COAP_OPT_LOCATION_PATH      (8)
+#define COAP_OPT_URI_PATH           (11)
+#define COAP_OPT_CONTENT_FORMAT     (12)
+#define COAP_OPT_MAX_AGE            (14)
+#define COAP_OPT_URI_QUERY          (15)
+#define COAP_OPT_ACCEPT             (17)
+#define COAP_OPT_LOCATION_QUERY     (20)
+#define COAP_OPT_BLOCK2             (23)
+#define COAP_OPT_SIZE2              (28)
+#define COAP_OPT_BLOCK1             (27)
+#define COAP_OPT_PROXY_URI          (35)
+#define COAP_OPT_PROXY_SCHEME       (39)
+#define COAP_OPT_SIZE1              (60)
+/** @} */
+
+/**
+ * @name Content formats
+ * @{
+ */
+#define COAP_FORMAT_TEXT            (0)
+#define COAP_FORMAT_LINK            (40)
+#define COAP_FORMAT_OCTET           (42)
+#define COAP_FORMAT_JSON            (50)
+/** @} */
+
+/**
+ * @brief   A received request, pointing into the receive buffer.
+ */
+typedef struct {
+    const uint8_t *buf;             /**< the whole message */
+    uint16_t len;                   /**< length of *buf* */
+    uint8_t type;                   /**< COAP_TYPE_* */
+    uint8_t code;                   /**< the method */
+    uint16_t id;                    /**< message ID */
+    uint8_t token_len;              /**< length of *token* */
+    const uint8_t *token;           /**< token */
+    const uint8_t *options;         /**< the first option */
+    uint16_t options_len;           /**< length of all options */
+    const uint8_t *payload;         /**< payload, NULL if there is none */
+    uint16_t payload_len;           /**< length of *payload* */
+    const sockaddr6_t *remote;      /**< the client, NULL for notifications */
+} coap_request_t;
+
+/**
+ * @brief   An option of a request, see coap_opt_next().
+ */
+typedef struct {
+    uint16_t num;                   /**< option number */
+    uint16_t len;                   /**< length of *val* */
+    const uint8_t *val;             /**< value, in the receive buffer */
+    const uint8_t *next;            /**< internal */
+} coap_opt_t;
+
+/**
+ * @brief   A response being written, see coap_resp_opt().
+ */
+typedef struct {
+    uint8_t *buf;                   /**< internal */
+    uint16_t size;                  /**< internal */
+    uint16_t len;                   /**< internal */
+    uint16_t last_opt;              /**< internal */
+    uint8_t code;                   /**< response code, see coap_resp_code() */
+} coap_response_t;
+
+/**
+ * @brief   Value of a Block1 or Block2 option.
+ */
+typedef struct {
+    uint32_t num;                   /**< block number */
+    uint8_t more;                   /**< 1 if more blocks follow */
+    uint8_t szx;                    /**< block size 2^(szx + 4) */
+} coap_block_t;
+
+/**
+ * @brief   Handles a request to a resource.
+ *
+ * The response is preset to 2.05 for GET and 2.04 for the other methods.
+ * Must not call coap_notify().
+ *
+ * @return  0 on success, -1 to answer 5.00 instead, or the error code
+ *          set with coap_resp_code().
+ */
+typedef int (*coap_handler_t)(const coap_request_t *req,
+                              coap_response_t *resp, void *arg);
+
+/**
+ * @brief   A resource of the server.
+ */
+typedef struct {
+    const char *path;               /**< e.g. "/sensors/temp" */
+    uint8_t methods;                /**< COAP_METHOD_* flags */
+    uint8_t observable;             /**< 1 if GETs may observe it */
+    coap_handler_t handler;         /**< handles all its methods */
+    void *arg;                      /**< passed to *handler* */
+} coap_resource_t;
+
+/**
+ * @brief   Starts the server thread, further calls do nothing.
+ *
+ * destiny has to be initialized before.
+ *
+ * @param[in] resources     The resources, kept by the server.
+ * @param[in] numof         Number of entries in *resources*.
+ *
+ * @return  PID of the thread, -1 on error.
+ */
+int coap_init(const coap_resource_t *resources, unsigned int numof);
+
+/**
+ * @brief   Gets the options of a request one after the other.
+ *
+ * @param[in] req       The request.
+ * @param[in,out] opt   Zeroed for the first option, the option before
+ *                      otherwise.
+ *
+ * @return  1 if *opt* holds the next option, 0 if there is none.
+ */
+int coap_opt_next(const coap_request_t *req, coap_opt_t *opt);
+
+/**
+ * @brief   Gets the first option of a request with number *num*.
+ *
+ * @return  1 if it was found, 0 otherwise.
+ */
+int coap_opt_find(const coap_request_t *req, uint16_t num, coap_opt_t *opt);
+
+/**
+ * @brief   Value of an option holding an unsigned integer.
+ */
+uint32_t coap_opt_uint(const coap_opt_t *opt);
+
+/**
+ * @brief   Gets the Block1 or Block2 option of a request.
+ *
+ * @param[in] req       The request.
+ * @param[in] num       COAP_OPT_BLOCK1 or COAP_OPT_BLOCK2.
+ * @param[out] block    The value.
+ *
+ * @return  1 if the request has a valid option, 0 otherwise.
+ */
+int coap_req_block(const coap_request_t *req, uint16_t num,
+                   coap_block_t *block);
+
+/**
+ * @brief   Offset of a block in the representation.
+ */
+static inline uint32_t coap_block_offset(const coap_block_t *block)
+{
+    return block->num << (block->szx + 4);
+}
+
+/**
+ * @brief   Sets the code of a response.
+ */
+static inline void coap_resp_code(coap_response_t *resp, uint8_t code)
+{
+    resp->code = code;
+}
+
+/**
+ * @brief   Adds an option to a response. Options have to be added in
+ *          increasing order of their numbers, and before the payload.
+ *
+ * @return  0 on success, -1 if it is out of order or does not fit.
+ */
+int coap_resp_opt(coap_response_t *resp, uint16_t num, const void *val,
+                  uint16_t len);
+
+/**
+ * @brief   Adds an option holding an unsigned integer to a response.
+ *
+ * @return  0 on success, -1 if it is out of order or does not fit.
+ */
+int coap_resp_opt_uint(coap_response_t *resp, uint16_t num, uint32_t val);
+
+/**
+ * @brief   Adds a Block1 or Block2 option to a response, e.g. to
+ *          acknowledge a block of an upload with 2.31.
+ *
+ * @return  0 on success, -1 if it is out of order or does not fit.
+ */
+int coap_resp_opt_block(coap_response_t *resp, uint16_t num,
+                        const coap_block_t *block);
+
+/**
+ * @brief   Where the payload of a response is to be written.
+ *
+ * @param[in] resp      The response, all options have to be added.
+ * @param[out] max      Space for the payload.
+ *
+ * @return  The place of the payload, NULL if there is no space.
+ */
+uint8_t *coap_resp_payload(coap_response_t *resp, uint16_t *max);
+
+/**
+ * @brief   Ends the response after *len* bytes of payload written to
+ *          coap_resp_payload().
+ *
+ * @return  0 on success, -1 if *len* does not fit.
+ */
+int coap_resp_payload_len(coap_response_t *resp, uint16_t len);
+
+/**
+ * @brief   Answers a GET with the block of *repr* the client asked for, or
+ *          the first one, plus a Block2 option. A representation that fits
+ *          a single block is sent as is.
+ *
+ * Options with a number above COAP_OPT_BLOCK2 must not be added before.
+ *
+ * @param[in] req       The request.
+ * @param[in] resp      Its response.
+ * @param[in] repr      The whole representation.
+ * @param[in] len       Length of *repr*.
+ *
+ * @return  0 on success, -1 if the block does not fit or is past the
+ *          end, the response is 4.02 in the latter case.
+ */
+int coap_resp_block2(const coap_request_t *req, coap_response_t *resp,
+                     const void *repr, uint32_t len);
+
+/**
+ * @brief   Sends a notification to every observer of *resource*.
+ *
+ * The handler of the resource runs once, on the calling thread, for a GET
+ * without options. Observers are dropped if the response is not 2.xx.
+ *
+ * @return  Number of notifications sent.
+ */
+int coap_notify(const coap_resource_t *resource);
+
+/** @} */
+#endif /* COAP_H */
@@ -162,14 +162,77 @@ typedef uint32_t  socklen_t;    ///< POSIX compatible type for address length.
 #define DESTINY_SOCKET_STATIC_MSS       48  ///< Static TCP maxmimum segment size.
 
 /**
- * Static TCP flow control window for window size 1.
+ * Number of full-sized segments a TCP connection may have in flight.
  */
-#define DESTINY_SOCKET_STATIC_WINDOW    1 * DESTINY_SOCKET_STATIC_MSS
+#ifndef DESTINY_SOCKET_WINDOW_SEGMENTS
+#define DESTINY_SOCKET_WINDOW_SEGMENTS  4
+#endif
+
+/**
+ * Static TCP flow control window.
+ */
+#define DESTINY_SOCKET_STATIC_WINDOW    (DESTINY_SOCKET_WINDOW_SEGMENTS * DESTINY_SOCKET_STATIC_MSS)
+
+/**
+ * Size of the TCP receive queue of each socket. Its free space is the
+ * advertised receive window, so it must not exceed 65535.
+ */
+#ifndef DESTINY_SOCKET_MAX_TCP_BUFFER
+#define DESTINY_SOCKET_MAX_TCP_BUFFER   (1 * DESTINY_SOCKET_STATIC_WINDOW)
+#endif
 
 /**
- * Maximum size of TCP buffer.
+ * Bytes a corked TCP socket collects before it sends them, at most one
+ * segment is sent from it.
+ * @see destiny_socket_set_tcp_cork()
  */
-#define DESTINY_SOCKET_MAX_TCP_BUFFER   1 * DESTINY_SOCKET_STATIC_WINDOW
+#ifndef DESTINY_SOCKET_CORK_BUFFER
+#define DESTINY_SOCKET_CORK_BUFFER      DESTINY_SOCKET_STATIC_MSS
+#endif
+
+/**
+ * @name TCP congestion control algorithms
+ * @see destiny_socket_set_tcp_cc()
+ * @{
+ */
+#define DESTINY_TCP_CC_NEWRENO          0   ///< loss based (RFC 5681, RFC 6582), default
+#define DESTINY_TCP_CC_LEDBAT           1   ///< delay based, yields to other traffic (RFC 6817)
+/** @} */
+
+/**
+ * Per connection TCP statistics.
+ */
+typedef struct {
+    uint32_t    bytes_sent;         ///< payload bytes sent, retransmissions included
+    uint32_t    bytes_acked;        ///< payload bytes acknowledged by the peer
+    uint16_t    segments_sent;      ///< data segments sent, retransmissions included
+    uint16_t    retransmits;        ///< data segments sent again
+    uint16_t    fast_retransmits;   ///< losses detected by duplicate ACKs
+    uint16_t    timeouts;           ///< expirations of the retransmission timer
+    uint16_t    cwnd;               ///< current congestion window in bytes
+    uint16_t    ssthresh;           ///< current slow start threshold in bytes
+    uint32_t    srtt;               ///< smoothed round trip time in microseconds
+} destiny_socket_tcp_stats_t;
+
+/**
+ * @name Events for destiny_socket_poll()
+ * @{
+ */
+#define DESTINY_POLLIN                  0x01    ///< data, a datagram or a connection to accept
+#define DESTINY_POLLOUT                 0x04    ///< connection established, sending is possible
+#define DESTINY_POLLERR                 0x08    ///< error, always reported
+#define DESTINY_POLLHUP                 0x10    ///< peer closed the connection, always reported
+#define DESTINY_POLLNVAL                0x20    ///< no such socket, always reported
+/** @} */
+
+/**
+ * Entry of the socket set given to destiny_socket_poll().
+ */
+typedef struct {
+    int         fd;         ///< socket ID, negative IDs are ignored
+    uint8_t     events;     ///< requested DESTINY_POLL* events
+    uint8_t     revents;    ///< returned DESTINY_POLL* events
+} destiny_socket_pollfd_t;
 
 /**
  * Socket address type for IPv6 communication.
@@ -181,6 +244,16 @@ typedef struct __attribute__((packed)) {
     ipv6_addr_t sin6_addr;      ///< IPv6 address
 } sockaddr6_t;
 
+/**
+ * One datagram of destiny_socket_sendmmsg() or destiny_socket_recvmmsg().
+ */
+typedef struct {
+    void        *buf;       ///< payload
+    uint32_t    len;        ///< length of *buf* in byte
+    sockaddr6_t *addr;      ///< destination or sender, may be NULL on receive
+    int32_t     res;        ///< returned number of bytes sent or received
+} destiny_socket_mmsg_t;
+
 /**
  * Creates new socket for communication in family *domain*, of type *type*,
  * and with protocol *protocol*. Roughly identical to POSIX's
@@ -202,6 +275,10 @@ int destiny_socket(int domain, int type, int protocol);
  * SOCK_STREAM). Roughly identical to POSIX's
  * <a href="http://man.he.net/man2/connect">connect(2)</a>.
  *
+ * A UDP socket only remembers the peer, destiny_socket_send() then sends
+ * datagrams to it. The source address and the constant part of the
+ * checksum are worked out once here instead of for every datagram.
+ *
  * @param[in] socket    The ID of the socket.
  * @param[in] addr      The IPv6 address to connect to
  * @param[in] addrlen   Length of the IPv6 address in byte (always 16)
@@ -245,7 +322,8 @@ int32_t destiny_socket_recvfrom(int s, void *buf, uint32_t len, int flags,
 
 /**
  * Sends data *buf* through socket *s*. Roughly identical to POSIX's
- * <a href="http://man.he.net/man2/send">send(2)</a>.
+ * <a href="http://man.he.net/man2/send">send(2)</a>. UDP sockets have to be
+ * connected with destiny_socket_connect() before.
  *
  * @param[in] s         The ID of the socket to send through.
  * @param[in] buf       Buffer to send the data from.
@@ -274,6 +352,42 @@ int32_t destiny_socket_send(int s, const void *buf, uint32_t len, int flags);
 int32_t destiny_socket_sendto(int s, const void *buf, uint32_t len, int flags,
                               sockaddr6_t *to, socklen_t tolen);
 
+/**
+ * Sends the datagrams in *msgvec* through UDP socket *s*, each to its own
+ * *addr*. Roughly identical to Linux'
+ * <a href="http://man7.org/linux/man-pages/man2/sendmmsg.2.html">sendmmsg(2)</a>.
+ *
+ * @param[in] s         The ID of the socket to send through.
+ * @param[in,out] msgvec The datagrams, *res* is set for every datagram sent.
+ * @param[in] vlen      Number of entries in *msgvec*.
+ * @param[in] flags     Flags for possible later implementations (currently
+ *                      unused).
+ *
+ * @return Number of datagrams sent, sending stops at the first error. -1 if
+ *         the first one failed.
+ */
+int destiny_socket_sendmmsg(int s, destiny_socket_mmsg_t *msgvec,
+                            unsigned int vlen, int flags);
+
+/**
+ * Receives up to *vlen* datagrams through UDP socket *s*. Roughly identical
+ * to Linux' <a href="http://man7.org/linux/man-pages/man2/recvmmsg.2.html">recvmmsg(2)</a>.
+ *
+ * Blocks for the first datagram only, the ones that follow it right away
+ * are taken in the same call. Payloads longer than *len* are truncated.
+ *
+ * @param[in] s         The ID of the socket to receive from.
+ * @param[in,out] msgvec The buffers, *res* and *addr* are set for every
+ *                      datagram received.
+ * @param[in] vlen      Number of entries in *msgvec*.
+ * @param[in] flags     Flags for possible later implementations (currently
+ *                      unused).
+ *
+ * @return Number of datagrams received, -1 if *s* is no UDP socket.
+ */
+int destiny_socket_recvmmsg(int s, destiny_socket_mmsg_t *msgvec,
+                            unsigned int vlen, int flags);
+
 /**
  * Closes the socket *s* and removes it.
  *
@@ -320,6 +434,72 @@ int destiny_socket_listen(int s, int backlog);
  */
 int destiny_socket_accept(int s, sockaddr6_t *addr, socklen_t *addrlen);
 
+/**
+ * Selects the congestion control algorithm of a TCP socket. Switching on an
+ * established connection restarts it from the initial window.
+ *
+ * @param[in] s         The ID of the socket.
+ * @param[in] algorithm One of the DESTINY_TCP_CC_* values.
+ *
+ * @return 0 on success, -1 if *s* is no TCP socket or *algorithm* unknown.
+ */
+int destiny_socket_set_tcp_cc(int s, uint8_t algorithm);
+
+/**
+ * Corks or uncorks a TCP socket. While it is corked, destiny_socket_send()
+ * collects small writes and only sends full segments, instead of one
+ * segment per call. Uncorking or closing the socket sends what is left.
+ *
+ * @param[in] s         The ID of the socket.
+ * @param[in] cork      1 to cork, 0 to uncork.
+ *
+ * @return 0 on success, -1 if *s* is no TCP socket or sending the collected
+ *         data failed.
+ */
+int destiny_socket_set_tcp_cork(int s, int cork);
+
+/**
+ * Gets the statistics of a TCP socket.
+ *
+ * @param[in] s         The ID of the socket.
+ * @param[out] stats    The statistics.
+ *
+ * @return 0 on success, -1 if *s* is no TCP socket.
+ */
+int destiny_socket_get_tcp_stats(int s, destiny_socket_tcp_stats_t *stats);
+
+/**
+ * Waits until one of the sockets in *fds* is ready, so a single thread can
+ * serve several sockets. Roughly identical to POSIX's
+ * <a href="http://man.he.net/man2/poll">poll(2)</a>.
+ *
+ * The calling thread becomes the receiving thread of all sockets in *fds*.
+ * A datagram that makes a UDP socket readable is held back until the next
+ * destiny_socket_recvfrom() on that socket.  Other messages the thread
+ * receives meanwhile are dropped, their senders get a reply if they wait
+ * for one.
+ *
+ * @param[in,out] fds   The sockets and the events to wait for.
+ * @param[in] nfds      Number of entries in *fds*.
+ * @param[in] timeout   Time to wait in milliseconds, -1 to wait forever.
+ *
+ * @return Number of entries with events, 0 on timeout, -1 on error.
+ */
+int destiny_socket_poll(destiny_socket_pollfd_t *fds, unsigned int nfds,
+                        int32_t timeout);
+
+/**
+ * Takes a notification of the transport layer a thread that polls its
+ * sockets itself received, see destiny_socket_poll() with a timeout of 0.
+ * The notification only changes what the next poll reports; a sender
+ * waiting for a reply gets it.
+ *
+ * @param[in] m     The message received.
+ *
+ * @return 1 if *m* was for the sockets, 0 if it is the thread's own.
+ */
+int destiny_socket_handle_msg(msg_t *m);
+
 /**
  * Outputs a list of all open sockets to stdout. Information includes its
  * creation parameters, local and foreign address and ports, it's ID and the
@@ -9,50 +9,107 @@
 
 #define ETX_RCV_QUEUE_SIZE     (128)
 
+/*
+ * ETX values are fixed-point with ETX_SCALE as 1, the representation of
+ * RFC 6551. 0 means no estimate yet.
+ */
+#define ETX_SCALE           (128)
+
+/*
+ * Every sample moves the estimate by a 1/2^ETX_EWMA_SHIFT of its distance.
+ */
+#ifndef ETX_EWMA_SHIFT
+#define ETX_EWMA_SHIFT      (3)
+#endif
+
+#define ETX_MAX_SAMPLE      (8 * ETX_SCALE)     //Sample for a failed transmission
+
+/*
+ * A link we only heard from is guessed at ETX 1 if the transceiver reports at
+ * least this LQI, at ETX_GUESS_POOR otherwise. Samples of transmissions
+ * refine it.
+ */
+#ifndef ETX_LQI_GOOD
+#define ETX_LQI_GOOD        (100)
+#endif
+#define ETX_GUESS_POOR      (2 * ETX_SCALE)
+
+/*
+ * Dedicated ETX beacons, sent at an adaptive rate (see ETX_INTERVAL), add a
+ * sample per neighbor and beacon. Without them the estimates come from the
+ * unicast traffic and the frames heard by the 6LoWPAN MAC only.
+ */
+#ifndef ETX_USE_BEACONS
+#define ETX_USE_BEACONS     (0)
+#endif
+
 /*
  * Default 40, should be enough to get all messages for neighbors.
- * In my tests, the maximum count of neighbors was around 30-something
+ * In my tests, the maximum count of neighbors was around 30-something.
+ * A full table makes room for a new neighbor by evicting the worst link if
+ * it is worse than ETX_GUESS_POOR or has no estimate, the new one is
+ * ignored otherwise.
  */
+#ifndef ETX_MAX_CANDIDATE_NEIGHBORS
 #if ENABLE_DEBUG
 #define ETX_MAX_CANDIDATE_NEIGHBORS (15) //Stacksizes are huge in debug mode, so memory is rare
 #else
 #define ETX_MAX_CANDIDATE_NEIGHBORS (40)
 #endif
+#endif
 //ETX Interval parameters
 #define MS  (1000)
 
 /*
  * ETX_INTERVAL
  *
- * Given in ms, the default is 1 second.
- * Should be divisible through 2 (For ETX_DEF_JIT_CORRECT)
- * and 5 (For ETX_MAX_JITTER) unless those values are adjusted too.
+ * Given in ms, the shortest time between beacons, the default is 1 second.
+ * After every beacon with stable estimates the interval doubles, up to
+ * ETX_INTERVAL << ETX_INTERVAL_DOUBLINGS, and it goes right to the maximum
+ * while every neighbor has an estimate from recent traffic. A new or
+ * evicted neighbor or an estimate that moves by more than
+ * ETX_CHANGE_THRESHOLD brings it back to ETX_INTERVAL.
+ *
+ * Each beacon is sent within +/- ETX_JITTER_PERCENT of the interval at
+ * random, so that neighbors do not send in step.
  */
+#ifndef ETX_INTERVAL
 #define ETX_INTERVAL        (1000)
-#define ETX_WINDOW          (10)                    //10 is the default value
-#define ETX_BEST_CANDIDATES (15)                    //Sent only 15 candidates in a beaconing packet
+#endif
+#ifndef ETX_INTERVAL_DOUBLINGS
+#define ETX_INTERVAL_DOUBLINGS  (5)
+#endif
+#define ETX_JITTER_PERCENT  (20)
+#define ETX_CHANGE_THRESHOLD    (ETX_SCALE / 2)
+#define ETX_TRAFFIC_TIMEOUT (60 * MS)               //Age in ms up to which an estimate from traffic counts as recent
+#define ETX_WINDOW          (10)                    //Beacons of a neighbor looked at, at most 16
+#define ETX_BEST_CANDIDATES (14)                    //Sent only 14 candidates in a beaconing packet
 #define ETX_TUPLE_SIZE      (2)                     //1 Byte for Addr, 1 Byte for packets rec.
 #define ETX_PKT_REC_OFFSET  (ETX_TUPLE_SIZE - 1)    //Offset in a tuple of (addr,pkt_rec), will always be the last byte
 #define ETX_IPV6_LAST_BYTE  (15)                    //The last byte for an ipv6 address
-#define ETX_MAX_JITTER      (ETX_INTERVAL / 5)      //The default value is 20% of ETX_INTERVAL
-#define ETX_JITTER_MOD      (ETX_MAX_JITTER + 1)    //The modulo value for jitter computation
-#define ETX_DEF_JIT_CORRECT (ETX_MAX_JITTER / 2)    //Default Jitter correction value (normally ETX_MAX_JITTER / 2)
-#define ETX_CLOCK_ADJUST    (52500)                 //Adjustment for clockthread computations to stay close/near ETX_INTERVAL
 
 /*
  * The ETX beaconing packet consists of:
  *
- *      0                   1                   2
- *      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3
- *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- - - - - - - -
- *     |  Option Type  | Option Length | Data
- *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- - - - - - - -
+ *      0                   1                   2                   3
+ *      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |  Option Type  | Option Length |   Sequence    |   Interval    |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     | Data ...
+ *     +-+-+-+-+-+-+-+- - - - - - - -
  * Option type:     Set to 0x20
  *
  * Option Length:   The length of the Data sent with this packet
  *
+ * Sequence:        Incremented with every beacon, so that receivers count
+ *                  the beacons they missed whatever the sender's rate is
+ *
+ * Interval:        Doublings of ETX_INTERVAL until the sender's next beacon
+ *
  * Option Data:     2-Octet Pairs of 8 bit for addresses and a positive integer
- *                  denoting the amount of packets received from that IP address
+ *                  denoting the amount of the last ETX_WINDOW beacons
+ *                  received from that IP address
  *
  * We only need 1 octet for the ip address since RPL for now only allows for
  * 255 different addresses.
@@ -67,31 +124,38 @@
 typedef struct __attribute__((packed)) etx_probe_t {
     uint8_t code;
     uint8_t length;
-    uint8_t data[30];
+    uint8_t seq;
+    uint8_t interval;
+    uint8_t data[28];
 } etx_probe_t;
 
 typedef struct etx_neighbor_t {
     ipv6_addr_t addr;           //The address of this node
-    uint8_t     tx_cur_round;   //The indicator for receiving a packet from this candidate this round
-    uint8_t     packets_tx[ETX_WINDOW]; //The packets this node has transmitted TO ME
+    uint16_t    rx_bits;        //Bit i is set if its beacon last_seq - i reached me
+    uint8_t     last_seq;       //The sequence number of its last beacon
+    uint8_t     span;           //Its beacons rx_bits covers, up to ETX_WINDOW
+    uint8_t     interval;       //The doublings of its beacon interval
     uint8_t     packets_rx;     //The packets this node has received FROM ME
-    double      cur_etx;        //The currently calculated ETX-value
+    uint16_t    cur_etx;        //The current ETX estimate, ETX_SCALE is 1
+    uint32_t    last_beacon;    //Time in ms its last beacon came in
+    uint32_t    last_traffic;   //Time in ms of its last sample from traffic
     uint8_t     used;           //The indicator if this node is active or not
 } etx_neighbor_t;
 
 //prototypes
 void etx_init_beaconing(ipv6_addr_t *address);
-void etx_beacon(void);
-void etx_clock(void);
-double etx_get_metric(ipv6_addr_t *address);
+uint16_t etx_get_metric(ipv6_addr_t *address);
 void etx_update(etx_neighbor_t *neighbor);
+void etx_tx_result(ipv6_addr_t *address, uint8_t transmissions);
+void etx_rx_quality(ipv6_addr_t *address, uint8_t lqi);
+void etx_set_change_handler(void (*handler)(ipv6_addr_t *address));
 void etx_radio(void);
 
 #define ETX_PKT_OPT         (0)     //Position of Option-Type-Byte
 #define ETX_PKT_OPTVAL      (0x20)  //Non-standard way of saying this is an ETX-Packet.
 #define ETX_PKT_LEN         (1)     //Position of Length-Byte
-#define ETX_DATA_MAXLEN     (30)    //max length of the data
-#define ETX_PKT_HDR_LEN     (2)     //Option type + Length (1 Byte each)
-#define ETX_PKT_DATA        (2)     //Begin of Data Bytes
+#define ETX_DATA_MAXLEN     (28)    //max length of the data
+#define ETX_PKT_HDR_LEN     (4)     //Option type, Length, Sequence, Interval (1 Byte each)
+#define ETX_PKT_DATA        (4)     //Begin of Data Bytes
 
 #endif /* ETX_BEACONING_H_ */
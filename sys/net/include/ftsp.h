@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_ftsp Time synchronization
+ * @ingroup     net
+ * @brief       Network-wide time base after the flooding time
+ *              synchronization protocol (FTSP)
+ *
+ * The node with the lowest EUI-64 becomes the root, its clock is the
+ * global time.  Every FTSP_BEACON_PERIOD the root broadcasts a beacon with
+ * its time and a sequence number, a node that has heard enough beacons
+ * broadcasts its estimate of the global time in turn, so the time floods
+ * across the hops.  Beacons are taken at the time of arrival the driver
+ * stamped (radio_packet_t.toa), a node keeps the last FTSP_TABLE_SIZE of
+ * them and fits a line through them by linear regression: the offset of
+ * its clock to the global time and the skew, so the estimate stays good
+ * between the beacons.
+ *
+ * A node that hears no beacon of its root for FTSP_ROOT_TIMEOUT periods
+ * takes over as root, keeping the time it had; a beacon of a root with a
+ * lower EUI-64 takes over from it.
+ *
+ * Timers are set at a global time with ftsp_set_msg(), e.g. to wake up in
+ * the same slot as the neighbors:
+ *
+ *     uint64_t now;
+ *
+ *     if (ftsp_now64(&now) == 0) {
+ *         ftsp_set_msg(&timer, now - now % SLOT + SLOT, thread_getpid(), NULL);
+ *     }
+ *
+ * The cc2420 and native stamp frames in their interrupt, the other drivers
+ * when the transceiver thread gets to them.  The sender's stamp is taken
+ * before the beacon goes to the MAC, FTSP_DELAY makes up for the typical
+ * time until the receiver stamps it.
+ *
+ * @{
+ *
+ * @file        ftsp.h
+ */
+
+#ifndef FTSP_H
+#define FTSP_H
+
+#include <stdint.h>
+
+#include "net_if.h"
+#include "timex.h"
+#include "vtimer.h"
+
+/**
+ * @brief   Time between two beacons of a node in us.
+ */
+#ifndef FTSP_BEACON_PERIOD
+#define FTSP_BEACON_PERIOD          (10000000)
+#endif
+
+/**
+ * @brief   Beacons the regression is done over.
+ */
+#ifndef FTSP_TABLE_SIZE
+#define FTSP_TABLE_SIZE             (8)
+#endif
+
+/**
+ * @brief   Age in us after which a beacon is left out of the regression,
+ *          FTSP_TABLE_SIZE * FTSP_MAX_AGE^2 must stay below 2^63.
+ */
+#ifndef FTSP_MAX_AGE
+#define FTSP_MAX_AGE                (2 * FTSP_TABLE_SIZE * FTSP_BEACON_PERIOD)
+#endif
+
+/**
+ * @brief   Beacons a node needs before its time is valid.
+ */
+#ifndef FTSP_ENTRY_VALID
+#define FTSP_ENTRY_VALID            (4)
+#endif
+
+/**
+ * @brief   Beacons a node needs before it sends beacons of its own.
+ */
+#ifndef FTSP_ENTRY_SEND
+#define FTSP_ENTRY_SEND             (3)
+#endif
+
+/**
+ * @brief   Beacon periods without a beacon of the root before a node
+ *          takes over as root.
+ */
+#ifndef FTSP_ROOT_TIMEOUT
+#define FTSP_ROOT_TIMEOUT           (3)
+#endif
+
+/**
+ * @brief   Distance in us of a beacon from the estimate beyond which it
+ *          counts as an error, once the time is valid.
+ */
+#ifndef FTSP_ERROR_LIMIT
+#define FTSP_ERROR_LIMIT            (10000)
+#endif
+
+/**
+ * @brief   Errors in a row after which the estimate is dropped, the global
+ *          time has jumped.
+ */
+#ifndef FTSP_ERRORS_MAX
+#define FTSP_ERRORS_MAX             (3)
+#endif
+
+/**
+ * @brief   Typical time in us from the sender's stamp of a beacon to the
+ *          receiver's.
+ */
+#ifndef FTSP_DELAY
+#define FTSP_DELAY                  (0)
+#endif
+
+/**
+ * @brief   First octet of a beacon, a 6LoWPAN NALP dispatch.
+ */
+#define FTSP_DISPATCH               (0x3d)
+
+/**
+ * @brief   State of the synchronization.
+ */
+typedef struct {
+    net_if_eui64_t root;    /**< the root followed, all ones if none yet */
+    uint8_t is_root;        /**< 1 if the node is the root */
+    uint8_t synced;         /**< 1 if the global time is valid */
+    uint8_t entries;        /**< beacons in the regression */
+    uint8_t seq;            /**< last sequence number of the root */
+    int32_t skew_ppb;       /**< rate of the global time to the local clock
+                                 less 1, in parts per billion */
+    int64_t offset;         /**< global less local time now in us */
+} ftsp_status_t;
+
+/**
+ * @brief   Starts the synchronization on an interface.
+ *
+ * @param[in] if_id     The interface, beacons are sent over its 6LoWPAN
+ *                      MAC.
+ *
+ * @return  0 on success, -1 on error.
+ */
+int ftsp_init(int if_id);
+
+/**
+ * @brief   Converts a vtimer_now64() time to the global time.
+ *
+ * @param[in] local     The local time in us.
+ * @param[out] global   The global time in us.
+ *
+ * @return  0 on success, -1 if the global time is not valid.
+ */
+int ftsp_local_to_global(uint64_t local, uint64_t *global);
+
+/**
+ * @brief   Converts a global time to vtimer_now64() time.
+ *
+ * @param[in] global    The global time in us.
+ * @param[out] local    The local time in us.
+ *
+ * @return  0 on success, -1 if the global time is not valid.
+ */
+int ftsp_global_to_local(uint64_t global, uint64_t *local);
+
+/**
+ * @brief   Reads the global time.
+ *
+ * @param[out] global   The global time in us.
+ *
+ * @return  0 on success, -1 if the global time is not valid.
+ */
+int ftsp_now64(uint64_t *global);
+
+/**
+ * @brief   Sets a vtimer to send a message at a global time, see
+ *          vtimer_set_msg().  The skew is taken into account when it is
+ *          set only, timers far ahead are better set again later.
+ *
+ * @param[in] t         The timer.
+ * @param[in] global    The global time in us, a passed one fires at once.
+ * @param[in] pid       The thread to send the message to.
+ * @param[in] ptr       The content of the message.
+ *
+ * @return  0 on success, -1 if the global time is not valid or the timer
+ *          could not be set.
+ */
+int ftsp_set_msg(vtimer_t *t, uint64_t global, unsigned int pid, void *ptr);
+
+/**
+ * @brief   Reads the state of the synchronization.
+ *
+ * @param[out] status   The state.
+ */
+void ftsp_status(ftsp_status_t *status);
+
+/**
+ * @brief   Takes a beacon, called by the 6LoWPAN MAC for frames starting
+ *          with FTSP_DISPATCH.
+ *
+ * @param[in] src       The sender.
+ * @param[in] payload   The frame's payload.
+ * @param[in] length    Length of *payload*.
+ * @param[in] toa       Time of arrival as stamped by the driver, in us.
+ */
+void ftsp_receive(const net_if_eui64_t *src, const uint8_t *payload,
+                  uint8_t length, uint64_t toa);
+
+/** @} */
+#endif /* FTSP_H */
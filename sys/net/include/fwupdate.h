@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_fwupdate Firmware dissemination
+ * @ingroup     net
+ * @brief       Sends a firmware image to every node of the MPL domain
+ *
+ * The source cuts the new image into flash pages of FWUPDATE_PAGE_SIZE
+ * bytes, and every page into chunks of FWUPDATE_CHUNK_SIZE bytes that fit
+ * into a single datagram.  A chunk is sent as a delta against the image
+ * the nodes run: runs found in the old image are copied from there, only
+ * the rest is carried literally.  Chunks are multicast over MPL (see
+ * mpl.h) on FWUPDATE_PORT, so the trickle timers of the forwarders repeat
+ * them across the hops instead of the source unicasting the image to
+ * every node.
+ *
+ * A node whose running version is the base of the delta erases its
+ * staging slot when it hears the first chunk of a new version, and writes
+ * every page with flashrom_write() once its chunks are complete, so no
+ * more than FWUPDATE_PAGE_BUFS pages are held in RAM.  Pages still missing
+ * when the source has gone quiet are asked for with a NACK sent to the
+ * source, a bitmap of up to FWUPDATE_NACK_PAGES pages; the source multicasts
+ * them again, which repairs every node that missed the same pages.  After
+ * the last page the checksum of the whole image is verified and the done
+ * callback is told, switching to the new image is left to it.
+ *
+ *     static const fwupdate_config_t config = {
+ *         .image = (const uint8_t *) 0, .image_len = 0x20000, .version = 7,
+ *         .slot = (uint8_t *) 0x40000, .slot_size = 0x20000,
+ *         .done = install_image,
+ *     };
+ *
+ *     fwupdate_init(&config);
+ *
+ * The source calls fwupdate_send() with the new image and the one the
+ * nodes run; a node may be both.
+ *
+ * @{
+ *
+ * @file        fwupdate.h
+ */
+
+#ifndef FWUPDATE_H
+#define FWUPDATE_H
+
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * @brief   UDP port of the service, chunks and NACKs.
+ */
+#ifndef FWUPDATE_PORT
+#define FWUPDATE_PORT               (5690)
+#endif
+
+/**
+ * @brief   Flash page, the unit written with flashrom_write() and
+ *          repaired by NACKs.
+ */
+#ifndef FWUPDATE_PAGE_SIZE
+#define FWUPDATE_PAGE_SIZE          (256)
+#endif
+
+/**
+ * @brief   Bytes of the image a chunk carries, must divide
+ *          FWUPDATE_PAGE_SIZE.  The delta of a chunk, the headers of IPv6,
+ *          MPL and UDP must fit into IPV6_MTU.
+ */
+#ifndef FWUPDATE_CHUNK_SIZE
+#define FWUPDATE_CHUNK_SIZE         (128)
+#endif
+
+/**
+ * @brief   Largest image in pages.
+ */
+#ifndef FWUPDATE_PAGES_MAX
+#define FWUPDATE_PAGES_MAX          (512)
+#endif
+
+/**
+ * @brief   Pages assembled in RAM at the same time.
+ */
+#ifndef FWUPDATE_PAGE_BUFS
+#define FWUPDATE_PAGE_BUFS          (2)
+#endif
+
+/**
+ * @brief   Pages a NACK asks for, a multiple of 8.
+ */
+#ifndef FWUPDATE_NACK_PAGES
+#define FWUPDATE_NACK_PAGES         (64)
+#endif
+
+/**
+ * @brief   Silence in ms before missing pages are NACKed, a random
+ *          share of it is added so that nodes do not NACK at once.
+ */
+#ifndef FWUPDATE_NACK_DELAY
+#define FWUPDATE_NACK_DELAY         (2000)
+#endif
+
+/**
+ * @brief   NACKs without a page heard in between before a transfer is
+ *          given up.
+ */
+#ifndef FWUPDATE_NACK_RETRIES
+#define FWUPDATE_NACK_RETRIES       (8)
+#endif
+
+/**
+ * @brief   Time in ms between two chunks of the source, MPL buffers
+ *          every chunk for a few trickle intervals.
+ */
+#ifndef FWUPDATE_PACE
+#define FWUPDATE_PACE               (100)
+#endif
+
+/**
+ * @brief   Bytes of the old image searched around a chunk for runs that
+ *          moved.
+ */
+#ifndef FWUPDATE_DELTA_WINDOW
+#define FWUPDATE_DELTA_WINDOW       (256)
+#endif
+
+/**
+ * @brief   Stack size of the service thread.
+ */
+#ifndef FWUPDATE_STACKSIZE
+#define FWUPDATE_STACKSIZE          (KERNEL_CONF_STACKSIZE_MAIN)
+#endif
+
+/**
+ * @brief   Thread priority of the service.
+ */
+#ifndef FWUPDATE_PRIORITY
+#define FWUPDATE_PRIORITY           (PRIORITY_MAIN - 1)
+#endif
+
+/**
+ * @brief   Base version of a delta that copies nothing, accepted by every
+ *          node.
+ */
+#define FWUPDATE_NO_BASE            (0xffff)
+
+/**
+ * @brief   Images of a node.
+ */
+typedef struct {
+    const uint8_t *image;   /**< running image, deltas are applied to it */
+    uint32_t image_len;     /**< length of the running image */
+    uint16_t version;       /**< version of the running image */
+    uint8_t *slot;          /**< staging slot in flash, page aligned */
+    uint32_t slot_size;     /**< size of the staging slot */
+    /**
+     * @brief   Called by the service thread once a new image is complete
+     *          and verified in the slot, NULL if not needed.
+     */
+    void (*done)(uint16_t version, uint32_t len);
+} fwupdate_config_t;
+
+/**
+ * @brief   Progress of the transfer a node receives.
+ */
+typedef struct {
+    uint16_t version;       /**< version received, 0 if none */
+    uint16_t pages;         /**< pages of the image */
+    uint16_t pages_done;    /**< pages written to the slot */
+    uint8_t complete;       /**< 1 once the image is verified */
+} fwupdate_status_t;
+
+/**
+ * @brief   Starts the service thread and MPL.
+ *
+ * @param[in] config    Images of the node, must stay valid.
+ *
+ * @return  PID of the service thread, -1 on error.
+ */
+int fwupdate_init(const fwupdate_config_t *config);
+
+/**
+ * @brief   Disseminates an image, replacing one being sent.  NACKs are
+ *          answered until fwupdate_stop().
+ *
+ * @param[in] image         The new image, must stay valid while sent.
+ * @param[in] len           Length of *image*.
+ * @param[in] version       Version of *image*.
+ * @param[in] base          Image the nodes run, NULL to send *image*
+ *                          without a delta.
+ * @param[in] base_len      Length of *base*.
+ * @param[in] base_version  Version of *base*, only nodes running it
+ *                          accept the delta.
+ *
+ * @return  0 on success, -1 if the service is not running or the image
+ *          has more than FWUPDATE_PAGES_MAX pages.
+ */
+int fwupdate_send(const uint8_t *image, uint32_t len, uint16_t version,
+                  const uint8_t *base, uint32_t base_len,
+                  uint16_t base_version);
+
+/**
+ * @brief   Stops sending the image and answering NACKs.
+ */
+void fwupdate_stop(void);
+
+/**
+ * @brief   Reads the progress of the transfer the node receives.
+ *
+ * @param[out] status   The progress.
+ */
+void fwupdate_status(fwupdate_status_t *status);
+
+/** @} */
+#endif /* FWUPDATE_H */
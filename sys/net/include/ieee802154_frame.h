@@ -25,11 +25,19 @@
 #include <stdio.h>
 #include <stdint.h>
 
+#include "timex.h"
+
 /* maximum 802.15.4 header length */
 #define IEEE_802154_MAX_HDR_LEN         (23)
 /* ...and FCS*/
 #define IEEE_802154_FCS_LEN             (2)
 
+/* FCS computation: 0 bit by bit, 1 with a 32 byte nibble table, 2 with a
+ * 512 byte octet table */
+#ifndef IEEE_802154_FCS_TABLE
+#define IEEE_802154_FCS_TABLE           (1)
+#endif
+
 #define IEEE_802154_BEACON_FRAME        (0)
 #define IEEE_802154_DATA_FRAME          (1)
 #define IEEE_802154_ACK_FRAME           (2)
@@ -98,9 +106,90 @@ typedef struct __attribute__(( packed )) {
     int8_t rssi;                /** < the rssi value */
     uint8_t crc;                /** < 1 if crc was successfull, 0 otherwise */
     uint8_t lqi;                /** < the link quality indicator */
+    timex_t toa;                /** < the time of arrival, as vtimer_now() */
     /* @} */
 } ieee802154_packet_t;
 
+/**
+ * @brief   A frame parsed in the buffer it was received into, nothing is
+ *          copied.  The addresses keep their little endian wire order.
+ */
+typedef struct {
+    uint8_t *buf;               ///< the frame, starting with the FCF
+    uint8_t len;                ///< length of the frame including the FCS
+    uint8_t hdr_len;            ///< offset of the payload
+    uint8_t dest_pos;           ///< offset of the destination address
+    uint8_t src_pos;            ///< offset of the source address
+} ieee802154_frame_view_t;
+
+/**
+ * @brief   Header lengths by (destination mode << 3 | source mode << 1 |
+ *          PAN ID compression), 0 for the reserved address mode 1.
+ */
+extern const uint8_t ieee802154_frame_hdr_lens[32];
+
+/**
+ * @brief   Length of a header with the given address modes.
+ */
+static inline uint8_t ieee802154_frame_hdr_len(uint8_t dest_addr_m,
+                                               uint8_t src_addr_m,
+                                               uint8_t panid_comp)
+{
+    return ieee802154_frame_hdr_lens[((dest_addr_m & 0x03) << 3) |
+                                     ((src_addr_m & 0x03) << 1) |
+                                     (panid_comp & 0x01)];
+}
+
+/**
+ * @brief   Parses the header of the frame in *buf* in place.
+ *
+ * @return  The header length, -1 if *len* is too short for header and FCS
+ *          or an address mode is reserved.
+ */
+int ieee802154_frame_view(ieee802154_frame_view_t *view, uint8_t *buf,
+                          uint8_t len);
+
+static inline uint8_t ieee802154_view_frame_type(const ieee802154_frame_view_t *view)
+{
+    return view->buf[0] & 0x07;
+}
+
+static inline uint8_t ieee802154_view_dest_addr_m(const ieee802154_frame_view_t *view)
+{
+    return (view->buf[1] >> 2) & 0x03;
+}
+
+static inline uint8_t ieee802154_view_src_addr_m(const ieee802154_frame_view_t *view)
+{
+    return (view->buf[1] >> 6) & 0x03;
+}
+
+static inline uint8_t ieee802154_view_seq_nr(const ieee802154_frame_view_t *view)
+{
+    return view->buf[2];
+}
+
+static inline uint8_t *ieee802154_view_payload(const ieee802154_frame_view_t *view)
+{
+    return view->buf + view->hdr_len;
+}
+
+static inline uint8_t ieee802154_view_payload_len(const ieee802154_frame_view_t *view)
+{
+    return view->len - view->hdr_len - IEEE_802154_FCS_LEN;
+}
+
+/**
+ * @brief   Copies the destination or source address in the byte order of
+ *          ieee802154_frame_t's fields.
+ *
+ * @return  The length of the address, 0 if there is none.
+ */
+uint8_t ieee802154_view_get_dest_addr(const ieee802154_frame_view_t *view,
+                                      uint8_t *addr);
+uint8_t ieee802154_view_get_src_addr(const ieee802154_frame_view_t *view,
+                                     uint8_t *addr);
+
 uint8_t ieee802154_frame_init(ieee802154_frame_t *frame, uint8_t *buf);
 uint8_t ieee802154_frame_get_hdr_len(ieee802154_frame_t *frame);
 uint8_t ieee802154_frame_read(uint8_t *buf, ieee802154_frame_t *frame, uint8_t len);
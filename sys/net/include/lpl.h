@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_lpl Low power listening
+ * @ingroup     net
+ * @brief       Duty cycling MAC engine for the 6LoWPAN MAC layer
+ *
+ * Keeps the radio powered down except for a short listen window every
+ * LPL_INTERVAL.  A sender repeats a frame back to back until the receiver
+ * woke up and acknowledged it, broadcasts are repeated for a whole
+ * interval.  The time of an acknowledgement tells when the neighbor wakes
+ * up, later frames to it are only sent shortly before that (phase lock).
+ *
+ * All nodes of a network have to use the same LPL_INTERVAL.  The
+ * acknowledgements are frames of their own since the transceivers do not
+ * report link layer acknowledgements, so they are only heard by senders
+ * that are not the MAC receiver thread itself.
+ *
+ * Transceivers with wake-on-radio (SWITCH_WOR, e.g. cc110x_ng) listen
+ * every LPL_INTERVAL by themselves, the MCU then sleeps until a frame
+ * arrives instead of waking up for every listen window.
+ *
+ * @see     <a href="http://dunkels.com/adam/dunkels11contikimac.pdf">
+ *              The ContikiMAC Radio Duty Cycling Protocol
+ *          </a>
+ * @{
+ *
+ * @file        lpl.h
+ */
+
+#ifndef LPL_H
+#define LPL_H
+
+#include <stdint.h>
+
+/**
+ * @brief   Time between two wake ups in us.
+ */
+#ifndef LPL_INTERVAL
+#define LPL_INTERVAL            (125000)
+#endif
+
+/**
+ * @brief   Time the radio listens after waking up in us, has to exceed
+ *          the time between two copies of a frame.
+ */
+#ifndef LPL_LISTEN
+#define LPL_LISTEN              (8000)
+#endif
+
+/**
+ * @brief   Time the radio stays on after a frame was received in us, so
+ *          following fragments are heard at once.
+ */
+#ifndef LPL_AFTER_RX
+#define LPL_AFTER_RX            (30000)
+#endif
+
+/**
+ * @brief   Time a sender waits for an acknowledgement after every copy in
+ *          us.
+ */
+#ifndef LPL_ACK_WAIT
+#define LPL_ACK_WAIT            (3000)
+#endif
+
+/**
+ * @brief   Time a sender starts early and stops late around a known wake
+ *          up in us, covers clock drift.
+ */
+#ifndef LPL_GUARD
+#define LPL_GUARD               (8000)
+#endif
+
+/**
+ * @brief   Neighbors whose wake up is remembered.
+ */
+#ifndef LPL_NEIGHBORS_NUMOF
+#define LPL_NEIGHBORS_NUMOF     (8)
+#endif
+
+/**
+ * @brief   Age in us after which a learned wake up is no longer trusted.
+ */
+#ifndef LPL_PHASE_MAX_AGE
+#define LPL_PHASE_MAX_AGE       (60ULL * 1000 * 1000)
+#endif
+
+/**
+ * @brief   First octet of an acknowledgement, a 6LoWPAN NALP dispatch.
+ */
+#define LPL_ACK_DISPATCH        (0x3f)
+
+/**
+ * @brief   Starts duty cycling the radio of an interface.
+ *
+ * @param[in] if_id     The interface, its neighbors have to duty cycle as
+ *                      well.
+ *
+ * @return  PID of the LPL thread, -1 on error.
+ */
+int lpl_init(int if_id);
+
+/**
+ * @brief   Time the radio was switched on since lpl_init() in us, the
+ *          listening of a transceiver with wake-on-radio is estimated.
+ */
+uint64_t lpl_get_radio_on_time(void);
+
+/** @} */
+#endif /* LPL_H */
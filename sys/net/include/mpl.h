@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_mpl MPL
+ * @ingroup     net
+ * @brief       Multicast Protocol for Low-Power and Lossy Networks
+ *
+ * Floods multicast packets beyond the link to every node of the MPL
+ * domain.  Every forwarder keeps a copy of a new data message and sends
+ * it again on a trickle timer (see trickle.h), suppressed if enough
+ * neighbors were heard sending it already.  A message is identified by
+ * its seed, the IPv6 source address, and a sequence number carried in a
+ * hop-by-hop option.
+ *
+ * Only proactive forwarding is implemented, there are no control
+ * messages, so a message missed for longer than its trickle runs is lost.
+ *
+ * @see     <a href="http://tools.ietf.org/html/draft-ietf-roll-trickle-mcast">
+ *              Multicast Protocol for Low power and Lossy Networks (MPL)
+ *          </a>
+ * @{
+ *
+ * @file        mpl.h
+ */
+
+#ifndef MPL_H
+#define MPL_H
+
+#include <stdint.h>
+
+#include "sixlowpan/types.h"
+
+/**
+ * @brief   Option type of the MPL option in the hop-by-hop header.
+ */
+#define MPL_OPT_TYPE                (0x6d)
+
+/**
+ * @brief   Data messages a forwarder keeps at the same time.
+ */
+#ifndef MPL_BUFFER_NUMOF
+#define MPL_BUFFER_NUMOF            (4)
+#endif
+
+/**
+ * @brief   Seeds whose oldest sequence number is remembered.
+ */
+#ifndef MPL_SEED_NUMOF
+#define MPL_SEED_NUMOF              (4)
+#endif
+
+/**
+ * @brief   Trickle parameters for data messages, Imin in ms.
+ */
+#ifndef MPL_DATA_IMIN
+#define MPL_DATA_IMIN               (64)
+#endif
+#ifndef MPL_DATA_IMAX
+#define MPL_DATA_IMAX               (1)
+#endif
+#ifndef MPL_DATA_K
+#define MPL_DATA_K                  (1)
+#endif
+
+/**
+ * @brief   Trickle intervals a data message is sent in.
+ */
+#ifndef MPL_DATA_EXPIRATIONS
+#define MPL_DATA_EXPIRATIONS        (3)
+#endif
+
+/**
+ * @brief   Starts the MPL thread and joins the all MPL forwarders group.
+ *
+ * @return  PID of the MPL thread, -1 on error.
+ */
+int mpl_init(void);
+
+/**
+ * @brief   Sends a packet to every member of a multicast group in the
+ *          MPL domain.
+ *
+ * @param[in] group         A multicast address of at least realm-local
+ *                          scope.
+ * @param[in] next_header   Next header number of the payload.
+ * @param[in] payload       The payload.
+ * @param[in] len           Length of the payload.
+ *
+ * @return  *len* on success, -1 if the packet does not fit or no buffer
+ *          is free.
+ */
+int mpl_send(const ipv6_addr_t *group, uint8_t next_header,
+             const uint8_t *payload, uint16_t len);
+
+/** @} */
+#endif /* MPL_H */
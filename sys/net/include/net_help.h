@@ -35,7 +35,49 @@
 
 #define CMP_IPV6_ADDR(a, b) (memcmp(a, b, 16))
 
+/**
+ * @brief   Adds a buffer to a 16 bit one's complement sum (RFC 1071).
+ *
+ * The buffer is read as a sequence of big endian 16 bit words, a trailing
+ * odd byte is padded with zero. Word aligned buffers are summed 32 (or on
+ * 16 bit platforms 16) bits at a time.
+ *
+ * @param[in] sum   Sum of the data covered so far, in host byte order.
+ * @param[in] buf   The data to add.
+ * @param[in] len   Length of *buf* in bytes, must be even unless this is
+ *                  the last part of the data.
+ *
+ * @return  The new sum in host byte order, not complemented.
+ */
 uint16_t csum(uint16_t sum, uint8_t *buf, uint16_t len);
+
+/**
+ * @brief   Updates a checksum after a 16 bit word of the covered data has
+ *          changed, without summing the data again (RFC 1624).
+ *
+ * All values must be in the same byte order, usually the one of the
+ * packet. An 8 bit field has to be passed together with the byte that
+ * shares its 16 bit word.
+ *
+ * @param[in] checksum  The checksum field as stored, i.e. complemented.
+ * @param[in] old_val   The word before the change.
+ * @param[in] new_val   The word after the change.
+ *
+ * @return  The new value of the checksum field.
+ */
+uint16_t csum_update16(uint16_t checksum, uint16_t old_val, uint16_t new_val);
+
+/**
+ * @brief   Like csum_update16() for a 32 bit field, e.g. a sequence number.
+ *
+ * @param[in] checksum  The checksum field as stored, i.e. complemented.
+ * @param[in] old_val   The field before the change.
+ * @param[in] new_val   The field after the change.
+ *
+ * @return  The new value of the checksum field.
+ */
+uint16_t csum_update32(uint16_t checksum, uint32_t old_val, uint32_t new_val);
+
 void printArrayRange(uint8_t *array, uint16_t len, char *str);
 
 /** @} */
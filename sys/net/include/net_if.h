@@ -137,6 +137,7 @@ typedef struct {
     uint8_t initialized;                ///< Detemines if interface is initialized
     uint8_t protocols;                  ///< Interface L3 protocols
     transceiver_type_t transceivers;    ///< Transceivers to use with this interface
+    int transceiver_pid;                ///< Transceiver worker serving the interface, -1 if unknown yet
     net_if_trans_addr_m_t trans_src_addr_m; ///< Transceiver address mode
     mutex_t address_buffer_mutex;       ///< Mutex for address buffer operations
     net_if_addr_t *addresses;           ///< Adresses
@@ -273,6 +274,16 @@ int net_if_del_address(int if_id, net_if_addr_t *addr);
  */
 net_if_addr_t *net_if_iter_addresses(int if_id, net_if_addr_t **addr);
 
+/**
+ * @brief   Get a number that changes whenever an address is added to or
+ *          removed from any interface.
+ *
+ * Lets upper layers cache results derived from the address lists.
+ *
+ * @return  The current generation of the address lists, never 0.
+ */
+uint16_t net_if_get_address_generation(void);
+
 /**
  * @brief   Get the upper layer protocol types assigned to the interface *if_id*
  *
@@ -339,6 +350,80 @@ int net_if_send_packet(int if_id, uint16_t target, const void *packet_data,
 int net_if_send_packet_long(int if_id, net_if_eui64_t *target,
                             const void *packet_data, size_t packet_len);
 
+/**
+ * @brief   Like net_if_send_packet(), tells how often the frame was
+ *          transmitted.  Unicast frames over transceivers in
+ *          TRANSCEIVER_HW_ACK are sent again until acknowledged.
+ *
+ * @param[out] attempts     Number of transmissions, may be NULL.
+ *
+ * @return The number of bytes send on success, TRANSCEIVER_TX_NOACK or
+ *         TRANSCEIVER_TX_CHANNEL_BUSY if the transceiver tells so, another
+ *         negative value on other failures
+ */
+int net_if_send_packet_attempts(int if_id, uint16_t target,
+                                const void *packet_data, size_t packet_len,
+                                uint8_t *attempts);
+
+/**
+ * @brief   Like net_if_send_packet_long(), tells how often the frame was
+ *          transmitted.
+ *
+ * @param[out] attempts     Number of transmissions, may be NULL.
+ *
+ * @return The number of bytes send on success, negative value on failure
+ */
+int net_if_send_packet_long_attempts(int if_id, net_if_eui64_t *target,
+                                     const void *packet_data,
+                                     size_t packet_len, uint8_t *attempts);
+
+/**
+ * @brief   Like net_if_send_packet_attempts(), the packet waits for the
+ *          radio in a priority class: it goes before packets of lower
+ *          classes that are waiting, whenever they were sent.
+ *
+ * @param[in] priority      TRANSCEIVER_TX_PRIO_*
+ * @param[out] attempts     Number of transmissions, may be NULL.
+ *
+ * @return The number of bytes send on success, negative value on failure
+ */
+int net_if_send_packet_prio(int if_id, uint16_t target,
+                            const void *packet_data, size_t packet_len,
+                            uint8_t priority, uint8_t *attempts);
+
+/**
+ * @brief   Like net_if_send_packet_long_attempts(), in a priority class
+ *          as net_if_send_packet_prio().
+ *
+ * @return The number of bytes send on success, negative value on failure
+ */
+int net_if_send_packet_long_prio(int if_id, net_if_eui64_t *target,
+                                 const void *packet_data, size_t packet_len,
+                                 uint8_t priority, uint8_t *attempts);
+
+/**
+ * @brief   Queues a packet to a short address for sending over the
+ *          interface without waiting for the radio. The packet is copied,
+ *          the calling thread gets a TX_DONE message with *tag* and the
+ *          result when it was sent or given up.
+ *
+ * @pre     Transceivers has to be initialized and transceiver thread has
+ *          to be started.
+ *
+ * @param[in] if_id         The interface's ID.
+ * @param[in] target        The target's short transceiver address.
+ * @param[in] packet_data   The packet to send
+ * @param[in] packet_len    The length of the packet's data in byte.
+ * @param[in] priority      TRANSCEIVER_TX_PRIO_*
+ * @param[in] tag           Identifies the packet in the TX_DONE message
+ *
+ * @return 1 if the packet was queued, 0 if the queue is full, negative value
+ *         on failure
+ */
+int net_if_send_packet_queued(int if_id, uint16_t target,
+                              const void *packet_data, size_t packet_len,
+                              uint8_t priority, uint16_t tag);
+
 /**
  * @brief   Sends a packet over all initialized interfaces.
  *
@@ -358,6 +443,14 @@ int net_if_send_packet_long(int if_id, net_if_eui64_t *target,
 int net_if_send_packet_broadcast(net_if_trans_addr_m_t preferred_dest_mode,
                                  const void *payload, size_t payload_len);
 
+/**
+ * @brief   Like net_if_send_packet_broadcast(), in a priority class as
+ *          net_if_send_packet_prio().
+ */
+int net_if_send_packet_broadcast_prio(net_if_trans_addr_m_t preferred_dest_mode,
+                                      const void *payload, size_t payload_len,
+                                      uint8_t priority);
+
 /**
  * @brief register a thread for events an interface's transceiver
  * @details This function just wraps transceiver_register().
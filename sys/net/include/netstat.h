@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    netstat Network statistics
+ * @brief       Per-layer packet counters of the network stack, every drop
+ *              is counted with its reason.
+ * @ingroup     net
+ *
+ * The layers count with NETSTAT_RX(), NETSTAT_TX() and NETSTAT_DROP().
+ * Without the netstat module these expand to nothing, so the counters
+ * cost neither memory nor time unless an application selects them with
+ * USEMODULE += netstat.
+ *
+ * The counters are not locked. They are incremented by the threads of
+ * the stack only, a count lost to preemption does not matter here.
+ *
+ * @{
+ *
+ * @file        netstat.h
+ * @brief       Counters and drop reasons of the network stack
+ * @author      Freie Universität Berlin
+ */
+#ifndef _NETSTAT_H
+#define _NETSTAT_H
+
+#include <stdint.h>
+
+/**
+ * @brief   The counting layers.
+ */
+typedef enum {
+    NETSTAT_LAYER_MAC = 0,      ///< IEEE 802.15.4 frames
+    NETSTAT_LAYER_LOWPAN,       ///< 6LoWPAN datagrams, drops of fragments
+                                ///< count once per fragment
+    NETSTAT_LAYER_IPV6,         ///< IPv6 packets, forwarded ones count as
+                                ///< received and sent
+    NETSTAT_LAYER_UDP,          ///< UDP datagrams
+    NETSTAT_LAYER_TCP,          ///< TCP segments
+    NETSTAT_LAYER_NUMOF
+} netstat_layer_t;
+
+/**
+ * @brief   Why a packet was dropped.
+ */
+typedef enum {
+    NETSTAT_DROP_NO_BUFFER = 0, ///< no buffer to receive into
+    NETSTAT_DROP_MALFORMED,     ///< invalid header, dispatch or address
+    NETSTAT_DROP_DUPLICATE,     ///< frame or fragment received before
+    NETSTAT_DROP_REAS_TIMEOUT,  ///< reassembly not complete in time
+    NETSTAT_DROP_REAS_EVICTED,  ///< reassembly given up for a newer one
+    NETSTAT_DROP_CHECKSUM,      ///< wrong checksum
+    NETSTAT_DROP_NO_ROUTE,      ///< no next hop known
+    NETSTAT_DROP_HOP_LIMIT,     ///< hop limit exceeded while forwarding
+    NETSTAT_DROP_NO_HANDLER,    ///< no upper layer or socket for it
+    NETSTAT_DROP_SOCKET_FULL,   ///< receive window or queue of a socket full
+    NETSTAT_DROP_TX_FAILED,     ///< sending failed below
+    NETSTAT_DROP_NUMOF
+} netstat_drop_t;
+
+/**
+ * @brief   Counters of one layer.
+ */
+typedef struct {
+    uint32_t rx;                ///< packets passed up
+    uint32_t tx;                ///< packets passed down
+    uint32_t drop;              ///< packets dropped, in either direction
+} netstat_counters_t;
+
+#ifdef MODULE_NETSTAT
+extern netstat_counters_t netstat_layers[NETSTAT_LAYER_NUMOF];
+extern uint32_t netstat_drops[NETSTAT_DROP_NUMOF];
+
+/**
+ * @brief   Counts a packet *layer* passed up.
+ */
+#define NETSTAT_RX(layer)           ((void) netstat_layers[layer].rx++)
+
+/**
+ * @brief   Counts a packet *layer* passed down.
+ */
+#define NETSTAT_TX(layer)           ((void) netstat_layers[layer].tx++)
+
+/**
+ * @brief   Counts a packet *layer* dropped for *reason*.
+ */
+#define NETSTAT_DROP(layer, reason) ((void) (netstat_layers[layer].drop++, \
+                                             netstat_drops[reason]++))
+#else
+#define NETSTAT_RX(layer)           ((void) 0)
+#define NETSTAT_TX(layer)           ((void) 0)
+#define NETSTAT_DROP(layer, reason) ((void) 0)
+#endif
+
+/**
+ * @brief   Sets all counters to zero.
+ */
+void netstat_reset(void);
+
+/**
+ * @brief   Returns the name of *layer*.
+ */
+const char *netstat_layer_name(netstat_layer_t layer);
+
+/**
+ * @brief   Returns the name of *reason*.
+ */
+const char *netstat_drop_name(netstat_drop_t reason);
+
+/**
+ * @}
+ */
+#endif /* _NETSTAT_H */
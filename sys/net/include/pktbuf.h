@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2013  Freie Universität Berlin.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    pktbuf Packet buffer
+ * @brief       Statically allocated, reference counted packet buffers
+ * @ingroup     net
+ *
+ * Buffers are taken from two fixed pools (a small and a large size class)
+ * so that allocating a packet never touches the heap. Every buffer keeps
+ * headroom in front of its data, which lets a layer prepend or strip
+ * headers in place with pktbuf_push() and pktbuf_pull().
+ *
+ * Received datagrams travel as a pktbuf_t in msg_t::content.ptr from
+ * 6LoWPAN through IPv6 to destiny: the 6LoWPAN reassembly takes them from
+ * the pools, uncompressed ones are handed on in place and compressed ones
+ * are decompressed into a buffer of their own.  A thread handing a buffer
+ * on keeps its reference until the receiver replied; a receiver keeping
+ * the buffer longer takes a reference of its own with pktbuf_hold().
+ * ICMPv6, NDP and RPL still work on a copy in the IPv6 buffer, sending
+ * still copies as well.
+ *
+ * @{
+ *
+ * @file        pktbuf.h
+ * @brief       Types and functions for packet buffers
+ * @author      Freie Universität Berlin
+ */
+#ifndef _PKTBUF_H
+#define _PKTBUF_H
+
+#include <stdint.h>
+
+/**
+ * @brief   Number of buffers in the small size class.
+ */
+#ifndef PKTBUF_SMALL_NUM
+#define PKTBUF_SMALL_NUM    (6)
+#endif
+
+/**
+ * @brief   Capacity (headroom + data) of a buffer in the small size class.
+ */
+#ifndef PKTBUF_SMALL_SIZE
+#define PKTBUF_SMALL_SIZE   (160)
+#endif
+
+/**
+ * @brief   Number of buffers in the large size class, at least one per
+ *          6LoWPAN reassembly buffer (LOWPAN_REAS_BUF_NUMOF) and one for
+ *          the datagram IPv6 processes.
+ */
+#ifndef PKTBUF_LARGE_NUM
+#define PKTBUF_LARGE_NUM    (5)
+#endif
+
+/**
+ * @brief   Capacity (headroom + data) of a buffer in the large size class.
+ *          Big enough for a full IPv6 datagram plus link layer header.
+ */
+#ifndef PKTBUF_LARGE_SIZE
+#define PKTBUF_LARGE_SIZE   (1328)
+#endif
+
+/**
+ * @brief   A packet buffer.
+ *
+ * @note    Only pktbuf_t::data and pktbuf_t::len may be read directly, use
+ *          pktbuf_push() and pktbuf_pull() to change them.
+ */
+typedef struct {
+    uint8_t *head;      ///< start of the underlying memory
+    uint8_t *data;      ///< start of the packet data
+    uint16_t len;       ///< length of the packet data
+    uint16_t size;      ///< capacity of the underlying memory
+    uint8_t refs;       ///< reference counter, 0 if the buffer is unused
+} pktbuf_t;
+
+/**
+ * @brief   Allocates a packet buffer.
+ *
+ * @param[in] len       Length of the packet data.
+ * @param[in] headroom  Bytes to reserve in front of the data for headers
+ *                      that are prepended later.
+ *
+ * @return  The buffer with a reference count of 1, NULL if no buffer of
+ *          sufficient size is available.
+ */
+pktbuf_t *pktbuf_alloc(uint16_t len, uint16_t headroom);
+
+/**
+ * @brief   Adds a reference to a packet buffer, e.g. before handing it to
+ *          another thread.
+ *
+ * @param[in] pkt   A packet buffer.
+ */
+void pktbuf_hold(pktbuf_t *pkt);
+
+/**
+ * @brief   Drops a reference to a packet buffer. The buffer is returned to
+ *          its pool when the last reference is dropped.
+ *
+ * @param[in] pkt   A packet buffer.
+ */
+void pktbuf_release(pktbuf_t *pkt);
+
+/**
+ * @brief   Prepends *len* bytes to the packet data.
+ *
+ * @param[in] pkt   A packet buffer.
+ * @param[in] len   Number of bytes to prepend.
+ *
+ * @return  The new start of the packet data, NULL if the headroom is too
+ *          small.
+ */
+uint8_t *pktbuf_push(pktbuf_t *pkt, uint16_t len);
+
+/**
+ * @brief   Strips *len* bytes from the start of the packet data.
+ *
+ * @param[in] pkt   A packet buffer.
+ * @param[in] len   Number of bytes to strip.
+ *
+ * @return  The new start of the packet data, NULL if the packet is shorter
+ *          than *len*.
+ */
+uint8_t *pktbuf_pull(pktbuf_t *pkt, uint16_t len);
+
+/**
+ * @brief   Cuts the packet data down to its first *len* bytes.
+ *
+ * @param[in] pkt   A packet buffer.
+ * @param[in] len   New length of the packet data.
+ *
+ * @return  The start of the packet data, NULL if the packet is shorter
+ *          than *len*.
+ */
+uint8_t *pktbuf_trim(pktbuf_t *pkt, uint16_t len);
+
+/**
+ * @brief   Returns the number of bytes available in front of the data.
+ */
+static inline uint16_t pktbuf_headroom(const pktbuf_t *pkt)
+{
+    return (uint16_t)(pkt->data - pkt->head);
+}
+
+/**
+ * @brief   Returns the number of bytes available behind the data.
+ */
+static inline uint16_t pktbuf_tailroom(const pktbuf_t *pkt)
+{
+    return (uint16_t)(pkt->size - pktbuf_headroom(pkt) - pkt->len);
+}
+
+/**
+ * @}
+ */
+#endif /* _PKTBUF_H */
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_rfc5444 RFC 5444
+ * @ingroup     net
+ * @brief       Reader and writer of the generalized MANET packet format
+ *
+ * Neither side allocates memory.  The reader walks a received packet in
+ * place: the packet, its messages, their address blocks and every TLV
+ * block are iterated with *_next() functions, and values point into the
+ * packet.  Addresses are stored compressed, rfc5444_addr_get() puts one
+ * together in a buffer of the caller.
+ *
+ * The writer fills a buffer of the caller, in the order of the format:
+ *
+ *     rfc5444_writer_t w;
+ *
+ *     rfc5444_writer_init(&w, buf, sizeof(buf));
+ *     rfc5444_write_pkt(&w, &seqnum, 0);
+ *     rfc5444_write_msg(&w, HELLO, 16, NULL, 1, -1, -1);
+ *     rfc5444_write_tlv(&w, VALIDITY_TIME, 0, &vtime, 1);
+ *     rfc5444_write_addrs(&w, (uint8_t *) neighbors, n, NULL);
+ *     rfc5444_write_tlv_index(&w, LINK_STATUS, 0, 0, n - 1, status, n, 1);
+ *     rfc5444_write_msg_end(&w);
+ *     len = rfc5444_write_end(&w);
+ *
+ * Errors stick: once something does not fit, the following calls do
+ * nothing and rfc5444_write_end() returns -1.
+ *
+ * @see     <a href="http://tools.ietf.org/html/rfc5444">RFC 5444</a>
+ * @{
+ *
+ * @file        rfc5444.h
+ */
+
+#ifndef RFC5444_H
+#define RFC5444_H
+
+#include <stdint.h>
+
+/**
+ * @brief   Longest address, an IPv6 address.
+ */
+#define RFC5444_ADDR_MAX            (16)
+
+/**
+ * @brief   A TLV block.
+ */
+typedef struct {
+    const uint8_t *pos;             /**< internal */
+    const uint8_t *end;             /**< internal */
+    uint8_t num_addr;               /**< addresses it belongs to, 0 for a
+                                         packet or message TLV block */
+} rfc5444_tlvs_t;
+
+/**
+ * @brief   A TLV, see rfc5444_tlv_next().
+ */
+typedef struct {
+    uint8_t type;                   /**< type */
+    uint8_t type_ext;               /**< type extension, 0 if there is none */
+    uint8_t index_start;            /**< first address it applies to */
+    uint8_t index_stop;             /**< last address it applies to */
+    uint8_t multivalue;             /**< 1 if every address has a value */
+    uint16_t len;                   /**< length of *value* */
+    const uint8_t *value;           /**< value, NULL if there is none */
+} rfc5444_tlv_t;
+
+/**
+ * @brief   A received packet, see rfc5444_packet_parse().
+ */
+typedef struct {
+    uint8_t has_seqnum;             /**< 1 if *seqnum* is valid */
+    uint16_t seqnum;                /**< packet sequence number */
+    rfc5444_tlvs_t tlvs;            /**< packet TLVs, empty if there are none */
+    const uint8_t *pos;             /**< internal */
+    const uint8_t *end;             /**< internal */
+} rfc5444_packet_t;
+
+/**
+ * @brief   A message of a packet, see rfc5444_msg_next().
+ */
+typedef struct {
+    uint8_t type;                   /**< message type */
+    uint8_t addr_len;               /**< length of its addresses */
+    const uint8_t *orig;            /**< originator, NULL if there is none */
+    int16_t hop_limit;              /**< hop limit, -1 if there is none */
+    int16_t hop_count;              /**< hop count, -1 if there is none */
+    int32_t seqnum;                 /**< sequence number, -1 if there is none */
+    const uint8_t *buf;             /**< the whole message, e.g. to forward */
+    uint16_t len;                   /**< length of *buf* */
+    rfc5444_tlvs_t tlvs;            /**< message TLVs */
+    const uint8_t *pos;             /**< internal */
+} rfc5444_msg_t;
+
+/**
+ * @brief   An address block of a message, see rfc5444_addrblock_next().
+ */
+typedef struct {
+    uint8_t num;                    /**< number of addresses */
+    uint8_t addr_len;               /**< length of an address */
+    uint8_t head_len;               /**< internal */
+    uint8_t tail_len;               /**< internal */
+    uint8_t mid_len;                /**< internal */
+    const uint8_t *head;            /**< internal */
+    const uint8_t *tail;            /**< internal, NULL for a zero tail */
+    const uint8_t *mid;             /**< internal */
+    const uint8_t *prefix_lens;     /**< internal */
+    uint8_t multi_prefix;           /**< internal */
+    rfc5444_tlvs_t tlvs;            /**< its TLVs */
+} rfc5444_addrblock_t;
+
+/**
+ * @brief   Writes a packet, see rfc5444_writer_init().
+ */
+typedef struct {
+    uint8_t *buf;                   /**< internal */
+    uint16_t size;                  /**< internal */
+    uint16_t len;                   /**< internal */
+    uint16_t msg_start;             /**< internal, 0 outside of a message */
+    uint16_t tlvs_start;            /**< internal, 0 outside of a TLV block */
+    uint8_t addr_len;               /**< internal */
+    uint8_t num_addr;               /**< internal */
+    uint8_t err;                    /**< internal */
+} rfc5444_writer_t;
+
+/**
+ * @brief   Reads the header of a packet.
+ *
+ * @param[out] pkt  The packet, its messages follow with rfc5444_msg_next().
+ * @param[in] buf   The packet, has to stay as it is while it is read.
+ * @param[in] len   Length of *buf*.
+ *
+ * @return  0 on success, -1 if it is malformed.
+ */
+int rfc5444_packet_parse(rfc5444_packet_t *pkt, const uint8_t *buf,
+                         uint16_t len);
+
+/**
+ * @brief   Gets the next message of a packet.
+ *
+ * @return  1 if *msg* holds the next message, 0 if there is none, -1 if
+ *          it is malformed.
+ */
+int rfc5444_msg_next(rfc5444_packet_t *pkt, rfc5444_msg_t *msg);
+
+/**
+ * @brief   Gets the next address block of a message.
+ *
+ * @return  1 if *ab* holds the next address block, 0 if there is none,
+ *          -1 if it is malformed.
+ */
+int rfc5444_addrblock_next(rfc5444_msg_t *msg, rfc5444_addrblock_t *ab);
+
+/**
+ * @brief   Gets the next TLV of a TLV block.
+ *
+ * @return  1 if *tlv* holds the next TLV, 0 if there is none, -1 if it is
+ *          malformed.
+ */
+int rfc5444_tlv_next(rfc5444_tlvs_t *tlvs, rfc5444_tlv_t *tlv);
+
+/**
+ * @brief   Value of a TLV for the address *index*.
+ *
+ * @param[in] tlv       The TLV.
+ * @param[in] index     Index of the address in its address block.
+ * @param[out] len      Length of the value.
+ *
+ * @return  The value, NULL if the TLV does not apply to the address or
+ *          has no value.
+ */
+const uint8_t *rfc5444_tlv_value(const rfc5444_tlv_t *tlv, uint8_t index,
+                                 uint16_t *len);
+
+/**
+ * @brief   Puts an address of an address block together.
+ *
+ * @param[in] ab            The address block.
+ * @param[in] index         Index of the address, less than ab->num.
+ * @param[out] addr         The address, ab->addr_len bytes.
+ * @param[out] prefix_len   Its prefix length, may be NULL.
+ *
+ * @return  0 on success, -1 if *index* is out of range.
+ */
+int rfc5444_addr_get(const rfc5444_addrblock_t *ab, uint8_t index,
+                     uint8_t *addr, uint8_t *prefix_len);
+
+/**
+ * @brief   Starts writing into *buf*.
+ */
+void rfc5444_writer_init(rfc5444_writer_t *w, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief   Writes the packet header.
+ *
+ * @param[in] w         The writer.
+ * @param[in] seqnum    Packet sequence number, NULL for none.
+ * @param[in] tlvs      1 if packet TLVs follow with rfc5444_write_tlv().
+ */
+void rfc5444_write_pkt(rfc5444_writer_t *w, const uint16_t *seqnum, int tlvs);
+
+/**
+ * @brief   Starts a message, its TLVs follow with rfc5444_write_tlv().
+ *
+ * @param[in] w         The writer.
+ * @param[in] type      Message type.
+ * @param[in] addr_len  Length of its addresses, 1 to RFC5444_ADDR_MAX.
+ * @param[in] orig      Originator address, NULL for none.
+ * @param[in] hop_limit Hop limit, -1 for none.
+ * @param[in] hop_count Hop count, -1 for none.
+ * @param[in] seqnum    Message sequence number, -1 for none.
+ */
+void rfc5444_write_msg(rfc5444_writer_t *w, uint8_t type, uint8_t addr_len,
+                       const uint8_t *orig, int hop_limit, int hop_count,
+                       int32_t seqnum);
+
+/**
+ * @brief   Writes a TLV without index into the current TLV block.
+ *
+ * @param[in] w         The writer.
+ * @param[in] type      Type.
+ * @param[in] type_ext  Type extension, 0 for none.
+ * @param[in] value     Value, may be NULL if *len* is 0.
+ * @param[in] len       Length of *value*.
+ */
+void rfc5444_write_tlv(rfc5444_writer_t *w, uint8_t type, uint8_t type_ext,
+                       const void *value, uint16_t len);
+
+/**
+ * @brief   Writes a TLV for the addresses *start* to *stop* of the
+ *          address block written last.
+ *
+ * @param[in] w             The writer.
+ * @param[in] type          Type.
+ * @param[in] type_ext      Type extension, 0 for none.
+ * @param[in] start         First address.
+ * @param[in] stop          Last address.
+ * @param[in] value         Value, may be NULL if *len* is 0.
+ * @param[in] len           Length of *value*.
+ * @param[in] multivalue    1 if *value* holds a value of *len* / (*stop* -
+ *                          *start* + 1) bytes for each address.
+ */
+void rfc5444_write_tlv_index(rfc5444_writer_t *w, uint8_t type,
+                             uint8_t type_ext, uint8_t start, uint8_t stop,
+                             const void *value, uint16_t len, int multivalue);
+
+/**
+ * @brief   Writes an address block, compressed, its TLVs follow with
+ *          rfc5444_write_tlv_index().
+ *
+ * @param[in] w             The writer.
+ * @param[in] addrs         *num* addresses of the message's address length,
+ *                          one after the other.
+ * @param[in] num           Number of addresses, at least 1.
+ * @param[in] prefix_lens   A prefix length for each address, NULL for none.
+ */
+void rfc5444_write_addrs(rfc5444_writer_t *w, const uint8_t *addrs,
+                         uint8_t num, const uint8_t *prefix_lens);
+
+/**
+ * @brief   Ends the current message.
+ */
+void rfc5444_write_msg_end(rfc5444_writer_t *w);
+
+/**
+ * @brief   Ends the packet.
+ *
+ * @return  Length of the packet, -1 if it did not fit or the writer was
+ *          used in the wrong order.
+ */
+int rfc5444_write_end(rfc5444_writer_t *w);
+
+/** @} */
+#endif /* RFC5444_H */
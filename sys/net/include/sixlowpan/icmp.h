@@ -243,5 +243,28 @@ void icmpv6_send_neighbor_adv(ipv6_addr_t *src, ipv6_addr_t *dst,
  * @return The internet checksum of the given ICMPv6 packet.
  */
 uint16_t icmpv6_csum(ipv6_hdr_t *ipv6_buf, icmpv6_hdr_t *icmpv6_buf);
+
+/**
+ * @brief Sums an ICMPv6 message and the parts of the pseudo header that
+ *        do not depend on the addresses, so the sum of a message sent
+ *        unchanged can be kept.
+ *
+ * @param[in] icmpv6_buf    The ICMPv6 message, its checksum is zeroed.
+ * @param[in] len           Length of the message.
+ *
+ * @return The sum to pass to icmpv6_csum_finish().
+ */
+uint16_t icmpv6_csum_partial(icmpv6_hdr_t *icmpv6_buf, uint16_t len);
+
+/**
+ * @brief Completes a sum of icmpv6_csum_partial() with the addresses of
+ *        the IPv6 header.
+ *
+ * @param[in] ipv6_buf      The IPv6 header of the packet.
+ * @param[in] sum           The sum of icmpv6_csum_partial().
+ *
+ * @return The internet checksum of the packet.
+ */
+uint16_t icmpv6_csum_finish(ipv6_hdr_t *ipv6_buf, uint16_t sum);
 /** @} */
 #endif /* SIXLOWPAN_ICMP_H */
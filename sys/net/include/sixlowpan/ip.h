@@ -27,6 +27,7 @@
 #include "inet_ntop.h"
 #include "net_help.h"
 #include "net_if.h"
+#include "pktbuf.h"
 #include "sixlowpan/types.h"
 
 /**
@@ -49,6 +50,11 @@
  */
 #define IPV6_MAX_ADDR_STR_LEN   (40)
 
+/**
+ * @brief   Next header number of the IPv6 hop-by-hop options header.
+ */
+#define IPV6_PROTO_NUM_HOP_BY_HOP   (0)
+
 /**
  * @brief   L4 protocol number for TCP.
  */
@@ -59,6 +65,11 @@
  */
 #define IPV6_PROTO_NUM_UDP          (17)
 
+/**
+ * @brief   Next header number of the IPv6 routing header.
+ */
+#define IPV6_PROTO_NUM_ROUTING      (43)
+
 /**
  * @brief   L4 protocol number for ICMPv6.
  */
@@ -81,6 +92,35 @@
  */
 #define IPV6_PACKET_RECEIVED        (UPPER_LAYER_2)
 
+/**
+ * @brief   Copies of received packets for the threads registered with
+ *          ipv6_register_packet_handler(), of IPV6_MTU bytes each.
+ */
+#ifndef IPV6_TAP_BUFFERS
+#define IPV6_TAP_BUFFERS            (2)
+#endif
+
+/**
+ * @brief   Processes received packets in the thread of the MAC layer.
+ *
+ * If set to 1, 6LoWPAN, IPv6 and the L4 handlers registered with
+ * ipv6_register_next_header_callback() are called directly by the radio
+ * thread, which runs every packet to completion.  The lowpan_transfer and
+ * ip_process threads and their stacks are left out, only handing datagrams
+ * to the socket of an application still uses a message.
+ */
+#ifndef SIXLOWPAN_RUN_TO_COMPLETION
+#define SIXLOWPAN_RUN_TO_COMPLETION (0)
+#endif
+
+/**
+ * @brief   Handler called for a received packet of an L4 protocol.
+ *
+ * @param[in] pkt   The packet, starting with its IPv6 header. The handler
+ *                  takes a reference with pktbuf_hold() to keep it.
+ */
+typedef void (*ipv6_next_header_cb_t)(pktbuf_t *pkt);
+
 /**
  * @brief   Get IPv6 send/receive buffer.
  *
@@ -107,6 +147,40 @@ ipv6_hdr_t *ipv6_get_buf(void);
 int ipv6_sendto(const ipv6_addr_t *dest, uint8_t next_header,
                 const uint8_t *payload, uint16_t payload_length);
 
+/**
+ * @brief   Send IPv6 packet to dest with a traffic class, which may select
+ *          the route, e.g. the RPL instance (see rpl_set_class_instance()).
+ *
+ * @param[in] dest              Destination of this packet.
+ * @param[in] next_header       Next header ID of payload.
+ * @param[in] traffic_class     Traffic class of this packet.
+ * @param[in] payload           Payload of the packet.
+ * @param[in] payload_length    Length of payload.
+ *
+ * @return  Same as ipv6_sendto().
+ */
+int ipv6_sendto_class(const ipv6_addr_t *dest, uint8_t next_header,
+                      uint8_t traffic_class, const uint8_t *payload,
+                      uint16_t payload_length);
+
+/**
+ * @brief   Send IPv6 packet to dest from a source address chosen before,
+ *          e.g. by a connected socket. Saves the source address selection
+ *          of ipv6_sendto().
+ *
+ * @param[in] src               Source address of this packet, one of the
+ *                              node's addresses.
+ * @param[in] dest              Destination of this packet.
+ * @param[in] next_header       Next header ID of payload.
+ * @param[in] payload           Payload of the packet.
+ * @param[in] payload_length    Length of payload.
+ *
+ * @return  Same as ipv6_sendto().
+ */
+int ipv6_sendto_from(const ipv6_addr_t *src, const ipv6_addr_t *dest,
+                     uint8_t next_header, const uint8_t *payload,
+                     uint16_t payload_length);
+
 /**
  * @brief   Send an IPv6 packet defined by its header.
  *
@@ -146,6 +220,13 @@ uint8_t ipv6_get_default_hop_limit(void);
 /**
  * @brief   Registers a handler thread for incoming IP packets.
  *
+ * Every received packet is copied once for all handler threads, before it
+ * is processed.  A thread gets an IPV6_PACKET_RECEIVED message when there
+ * are packets for it and takes them with ipv6_packet_get() until it
+ * returns NULL; it is not told again before.  Every copy has to be given
+ * back with ipv6_packet_release().  Packets are counted as dropped for a
+ * thread if no copy is free or it fell behind by IPV6_TAP_BUFFERS packets.
+ *
  * @param[in] pid   PID of handler thread.
  *
  * @return  0 on success, ENOMEN if maximum number of registrable
@@ -153,14 +234,67 @@ uint8_t ipv6_get_default_hop_limit(void);
  */
 uint8_t ipv6_register_packet_handler(int pid);
 
+/**
+ * @brief   Takes the next packet for the calling handler thread.
+ *
+ * @return  The packet, NULL if there is none left or the thread is not
+ *          registered.
+ */
+ipv6_hdr_t *ipv6_packet_get(void);
+
+/**
+ * @brief   Gives back a packet taken with ipv6_packet_get().
+ *
+ * @param[in] packet    The packet.
+ */
+void ipv6_packet_release(ipv6_hdr_t *packet);
+
+/**
+ * @brief   Number of packets a handler thread missed.
+ *
+ * @param[in] pid   PID of the handler thread.
+ *
+ * @return  packets not handed to the thread since it registered
+ */
+uint32_t ipv6_get_packet_handler_drops(int pid);
+
 /**
  * @brief   Registers a handler thread for L4 protocol.
  *
+ * The thread receives each packet as a pktbuf_t in msg_t::content.ptr
+ * and replies once it is done with it.
+ *
  * @param[in] next_header   Next header ID of the L4 protocol.
  * @param[in] pid           PID of the handler thread
  */
 void ipv6_register_next_header_handler(uint8_t next_header, int pid);
 
+/**
+ * @brief   Registers a function called for every packet of an L4 protocol.
+ *
+ * The function is called in the thread processing IPv6 and takes
+ * precedence over a thread registered with
+ * ipv6_register_next_header_handler().
+ *
+ * @param[in] next_header   Next header ID of the L4 protocol.
+ * @param[in] cb            The handler, NULL to remove it.
+ */
+void ipv6_register_next_header_callback(uint8_t next_header,
+                                        ipv6_next_header_cb_t cb);
+
+/**
+ * @brief   Processes a received packet.
+ *
+ * Called by the ip_process thread, or by 6LoWPAN directly with
+ * SIXLOWPAN_RUN_TO_COMPLETION. ICMPv6 packets are copied into the
+ * IPv6 receive buffer (see ipv6_get_buf()), UDP and TCP are handed on
+ * in *pkt*.
+ *
+ * @param[in] pkt   The packet, starting with its IPv6 header. The caller
+ *                  keeps its reference.
+ */
+void ipv6_process_packet(pktbuf_t *pkt);
+
 /**
  * @brief   Registers a handler thread for RPL options
  *
@@ -168,6 +302,86 @@ void ipv6_register_next_header_handler(uint8_t next_header, int pid);
  */
 void ipv6_register_rpl_handler(int pid);
 
+/**
+ * @brief   Bits of the traffic class used for explicit congestion
+ *          notification, the others are the DSCP.
+ */
+#define IPV6_TC_ECN_MASK            (0x03)
+
+/**
+ * @brief   Gets the traffic class of an IPv6 header.
+ *
+ * @param[in] hdr   The header.
+ *
+ * @return  The traffic class.
+ */
+static inline uint8_t ipv6_get_traffic_class(const ipv6_hdr_t *hdr)
+{
+    return (uint8_t)((hdr->version_trafficclass << 4) |
+                     (hdr->trafficclass_flowlabel >> 4));
+}
+
+/**
+ * @brief   Sets the traffic class of an IPv6 header, keeps the version
+ *          and the flow label.
+ *
+ * @param[out] hdr              The header.
+ * @param[in]  traffic_class    The traffic class.
+ */
+static inline void ipv6_set_traffic_class(ipv6_hdr_t *hdr,
+                                          uint8_t traffic_class)
+{
+    hdr->version_trafficclass = (hdr->version_trafficclass & 0xf0) |
+                                (traffic_class >> 4);
+    hdr->trafficclass_flowlabel = (hdr->trafficclass_flowlabel & 0x0f) |
+                                  (uint8_t)(traffic_class << 4);
+}
+
+/**
+ * @brief   Class a traffic class is queued in by the stack, a lower one
+ *          goes first: the DSCP class selectors 6 and 7 (network control)
+ *          are TRANSCEIVER_TX_PRIO_CONTROL, 4 and 5 (EF among them)
+ *          TRANSCEIVER_TX_PRIO_EXPEDITED, 1 and lower effort (DSCP 1)
+ *          TRANSCEIVER_TX_PRIO_BULK, the others TRANSCEIVER_TX_PRIO_DATA.
+ *
+ * @param[in] traffic_class The traffic class.
+ *
+ * @return  The priority class, TRANSCEIVER_TX_PRIO_*.
+ */
+static inline uint8_t ipv6_traffic_class_priority(uint8_t traffic_class)
+{
+    uint8_t dscp = traffic_class >> 2;
+
+    switch (dscp >> 3) {
+        case 6:
+        case 7:
+            return TRANSCEIVER_TX_PRIO_CONTROL;
+
+        case 4:
+        case 5:
+            return TRANSCEIVER_TX_PRIO_EXPEDITED;
+
+        case 1:
+            return TRANSCEIVER_TX_PRIO_BULK;
+
+        default:
+            return (dscp == 1) ? TRANSCEIVER_TX_PRIO_BULK :
+                   TRANSCEIVER_TX_PRIO_DATA;
+    }
+}
+
+/**
+ * @brief   Class a packet is queued in by the stack: ICMPv6 messages but
+ *          echoes, i.e. neighbor discovery and RPL, are
+ *          TRANSCEIVER_TX_PRIO_CONTROL, others go by their traffic class,
+ *          see ipv6_traffic_class_priority().
+ *
+ * @param[in] hdr   The packet.
+ *
+ * @return  The priority class, TRANSCEIVER_TX_PRIO_*.
+ */
+uint8_t ipv6_get_priority(const ipv6_hdr_t *hdr);
+
 /**
  * @brief   Sets the first 64 bit of *ipv6_addr* to link local prefix.
  *
@@ -525,6 +739,91 @@ void ipv6_net_if_get_best_src_addr(ipv6_addr_t *src, const ipv6_addr_t *dest);
  */
 void ipv6_iface_set_routing_provider(ipv6_addr_t *(*next_hop)(ipv6_addr_t *dest));
 
+/**
+ * @brief   Registers a routing function like
+ *          ipv6_iface_set_routing_provider(), which is also given the
+ *          traffic class of the packet, e.g. to route it in the RPL
+ *          instance the class is mapped to. Replaces a function
+ *          registered with ipv6_iface_set_routing_provider() and vice
+ *          versa.
+ *
+ * @param   next_hop    function that returns the next hop to reach dest
+ *                      for packets of traffic_class
+ */
+void ipv6_iface_set_class_routing_provider(ipv6_addr_t *(*next_hop)(ipv6_addr_t *dest,
+                                           uint8_t traffic_class));
+
+/**
+ * @brief   Maximum number of hops of a source route, each costs 16 bytes
+ *          of stack while a packet is sent.
+ */
+#ifndef IPV6_SRH_MAX_HOPS
+#define IPV6_SRH_MAX_HOPS           (8)
+#endif
+
+/**
+ * @brief   Registers a function that provides source routes, e.g. on the
+ *          root of a non-storing RPL DODAG. Packets sent or forwarded to a
+ *          destination with a known source route get a compressed source
+ *          routing header (RFC 6554) and are sent to the first hop directly.
+ *
+ * @param   source_route    function that writes the intermediate hops to
+ *                          dest into hops, starting with the neighbor, and
+ *                          returns their number (0 if dest is a neighbor)
+ *                          or -1 if no route of at most max hops is known.
+ */
+void ipv6_iface_set_srh_provider(int (*source_route)(ipv6_addr_t *dest,
+                                 ipv6_addr_t *hops, uint8_t max));
+
+/**
+ * @brief   Registers a function that forwards received multicast packets
+ *          with a hop-by-hop options header, e.g. MPL.
+ *
+ * The function is called before the packet is delivered.  It has to
+ * remove the hop-by-hop header if the packet is to be delivered.
+ *
+ * @param   forward     returns 0 to deliver the packet to this node if it
+ *                      is a member of the destination group, -1 to drop
+ *                      it, NULL to remove the forwarder
+ */
+void ipv6_iface_set_mcast_forwarder(int (*forward)(ipv6_hdr_t *packet));
+
+/**
+ * @brief   Number of multicast groups this node can be a member of, a
+ *          power of two.
+ */
+#ifndef IPV6_MCAST_GROUPS_NUMOF
+#define IPV6_MCAST_GROUPS_NUMOF     (16)
+#endif
+
+/**
+ * @brief   Joins a multicast group, packets to it are delivered.
+ *
+ * Multicast addresses added with ipv6_net_if_add_addr() join their group.
+ *
+ * @param[in] group     The multicast address.
+ *
+ * @return  1 on success, 0 if the table is full or *group* is no
+ *          multicast address.
+ */
+int ipv6_mcast_join(const ipv6_addr_t *group);
+
+/**
+ * @brief   Leaves a multicast group.
+ *
+ * @param[in] group     The multicast address.
+ */
+void ipv6_mcast_leave(const ipv6_addr_t *group);
+
+/**
+ * @brief   Checks the membership in a multicast group in constant time.
+ *
+ * @param[in] group     The multicast address.
+ *
+ * @return  1 if this node is a member of *group*, 0 otherwise.
+ */
+int ipv6_mcast_is_member(const ipv6_addr_t *group);
+
 /**
  * @brief Calculates the IPv6 upper-layer checksum.
  *
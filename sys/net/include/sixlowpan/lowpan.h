@@ -145,6 +145,32 @@
 #define SIXLOWPAN_FRAGN_DISPATCH    (0xe0)
 
 
+/**
+ * @brief   Dispatch switching to page 1, in which 6LoRH headers may follow.
+ * @see <a href="http://tools.ietf.org/html/rfc8025">RFC 8025</a>
+ */
+#define SIXLOWPAN_PAGE1_DISPATCH    (0xf1)
+
+/**
+ * @brief   First octet of a critical 6LoRH, the lower 5 bits are its size
+ *          field, followed by its type.
+ * @see <a href="http://tools.ietf.org/html/rfc8138#section-4">
+ *          RFC 8138, section 4
+ *      </a>
+ */
+#define SIXLOWPAN_LORH_CRITICAL     (0x80)
+
+/**
+ * @brief   Mask to recognize SIXLOWPAN_LORH_CRITICAL.
+ */
+#define SIXLOWPAN_LORH_MASK         (0xe0)
+
+/**
+ * @brief   Highest type of an SRH-6LoRH, one of type t carries the last
+ *          2^t octets of every hop.
+ */
+#define SIXLOWPAN_LORH_SRH_TYPE_MAX (4)
+
 /**
  * 6LoWPAN fragmentation header length (first fragment)
  */
@@ -155,6 +181,53 @@
  */
 #define SIXLOWPAN_FRAGN_HDR_LEN    	(5)
 
+/**
+ * @brief   Dispatch of the UDP header compression, the lower 3 bits are
+ *          flags.
+ * @see <a href="http://tools.ietf.org/html/rfc6282#section-4.3.3">
+ *          RFC 6282, section 4.3.3
+ *      </a>
+ */
+#define SIXLOWPAN_NHC_UDP_DISPATCH  (0xf0)
+
+/**
+ * @brief   Mask to recognize SIXLOWPAN_NHC_UDP_DISPATCH.
+ */
+#define SIXLOWPAN_NHC_UDP_MASK      (0xf8)
+
+/**
+ * @brief   Flag for an elided UDP checksum.
+ */
+#define SIXLOWPAN_NHC_UDP_C         (0x04)
+
+/**
+ * @brief   Bits telling which ports are compressed.
+ */
+#define SIXLOWPAN_NHC_UDP_P         (0x03)
+
+/**
+ * @brief   Ports 0xf000 to 0xf0ff are carried in 8 bits.
+ */
+#define SIXLOWPAN_NHC_UDP_8BIT_PORT (0xf000)
+
+/**
+ * @brief   Ports 0xf0b0 to 0xf0bf are carried in 4 bits, if both ports
+ *          are.
+ */
+#define SIXLOWPAN_NHC_UDP_4BIT_PORT (0xf0b0)
+
+/**
+ * @brief   Elide the UDP checksum of outgoing datagrams.
+ *
+ * Allowed by RFC 6282 only if something else protects the datagrams, e.g.
+ * the link layer.  The receiver computes the checksum again when it
+ * decompresses such a datagram, so UDP and a border router see a complete
+ * header.
+ */
+#ifndef LOWPAN_NHC_UDP_CSUM_ELIDE
+#define LOWPAN_NHC_UDP_CSUM_ELIDE   (0)
+#endif
+
 /**
  * @brief message type for notification
  *
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 
+#include "net_if.h"
 #include "transceiver.h"
 
 #include "sixlowpan/types.h"
@@ -33,6 +34,45 @@
  */
 #define IEEE_802154_MAX_ADDR_STR_LEN   (12)
 
+/**
+ * @brief   A frame on its way to the transceiver.
+ */
+typedef struct {
+    int if_id;                  ///< interface, ignored for multicast
+    const void *dest;           ///< short or long address, network byte order
+    uint8_t dest_len;           ///< length of *dest*, 2 or 8
+    uint8_t mcast;              ///< 1 for a broadcast frame
+    net_if_eui64_t neighbor;    ///< *dest* as EUI-64, all ones if *mcast*
+    const void *data;           ///< the frame as the transceiver takes it
+    uint8_t len;                ///< length of *data*
+    uint8_t priority;           ///< class in the transmit queue,
+                                ///< TRANSCEIVER_TX_PRIO_*
+} sixlowpan_mac_frame_t;
+
+/**
+ * @brief   A MAC engine between the 6LoWPAN MAC layer and the transceiver,
+ *          e.g. one that duty cycles the radio. Either function may be
+ *          NULL.
+ */
+typedef struct {
+    /**
+     * @brief   Gets the frame to the neighbor, usually by calling
+     *          sixlowpan_mac_transmit() once or more.
+     *
+     * @return  Length of transmitted data, a value < 1 on failure.
+     */
+    int (*send)(const sixlowpan_mac_frame_t *frame);
+
+    /**
+     * @brief   Sees every received frame before 6LoWPAN does.
+     *
+     * @return  1 if the frame was the engine's own and is not passed on.
+     */
+    int (*receive)(int if_id, const net_if_eui64_t *src,
+                   const net_if_eui64_t *dst, const uint8_t *payload,
+                   uint8_t length);
+} sixlowpan_mac_engine_t;
+
 /**
  * @brief   Send an IEEE 802.15.4 frame to a long address.
  *
@@ -45,11 +85,40 @@
  * @param[in]   length      The length of the payload.
  * @param[in]   mcast       send frame as multicast frame (*addr* and *if_id*
  *                          will be ignored).
+ * @param[in]   priority    Class of the frame in the transmit queue,
+ *                          TRANSCEIVER_TX_PRIO_*
  *
  * @return Length of transmitted data in byte
  */
 int sixlowpan_mac_send_ieee802154_frame(int if_id, const void *dest,
-                                        uint8_t dest_len, const void *payload, uint8_t length, uint8_t mcast);
+                                        uint8_t dest_len, const void *payload, uint8_t length, uint8_t mcast,
+                                        uint8_t priority);
+
+/**
+ * @brief   Like sixlowpan_mac_send_ieee802154_frame(), the payload of the
+ *          frame is *hdr* followed by *payload*.  Both are copied straight
+ *          into the frame, so e.g. a fragment is sent from a slice of its
+ *          datagram without being copied to a buffer of its own first.
+ *
+ * @param[in]   if_id       The interface to send over.
+ * @param[in]   dest        The destination address of the frame.
+ * @param[in]   dest_len    The lengts of the destination address in byte.
+ * @param[in]   hdr         Start of the payload, e.g. a fragment header.
+ * @param[in]   hdr_len     The length of *hdr*, may be 0.
+ * @param[in]   payload     Rest of the payload.
+ * @param[in]   length      The length of *payload*.
+ * @param[in]   mcast       send frame as multicast frame.
+ * @param[in]   priority    Class of the frame in the transmit queue.
+ *
+ * @return Length of transmitted data in byte
+ */
+int sixlowpan_mac_send_ieee802154_frame_gather(int if_id, const void *dest,
+                                               uint8_t dest_len,
+                                               const void *hdr,
+                                               uint8_t hdr_len,
+                                               const void *payload,
+                                               uint8_t length, uint8_t mcast,
+                                               uint8_t priority);
 
 /**
  * @brief   Initialise 6LoWPAN MAC layer and register it to interface layer
@@ -58,5 +127,48 @@ int sixlowpan_mac_send_ieee802154_frame(int if_id, const void *dest,
  */
 int sixlowpan_mac_init(void);
 
+/**
+ * @brief   Registers functions that learn about the quality of the links to
+ *          neighbors, e.g. for link estimation. Either may be NULL.
+ *
+ * @param[in] tx    Called after every unicast frame with its destination and
+ *                  the number of transmissions it took, 0 if it failed.
+ * @param[in] rx    Called for every received frame with its source and the
+ *                  LQI the transceiver reported.
+ */
+void sixlowpan_mac_set_link_handlers(void (*tx)(const net_if_eui64_t *dest,
+                                                uint8_t transmissions),
+                                     void (*rx)(const net_if_eui64_t *src,
+                                                uint8_t lqi));
+
+/**
+ * @brief   Sets the MAC engine all frames go through, NULL hands them to
+ *          the transceiver directly.
+ */
+void sixlowpan_mac_set_engine(const sixlowpan_mac_engine_t *engine);
+
+/**
+ * @brief   Hands a frame to the transceiver once, bypassing the engine.
+ *
+ * @return  Length of transmitted data in byte
+ */
+int sixlowpan_mac_transmit(const sixlowpan_mac_frame_t *frame);
+
+/**
+ * @brief   Sends a frame of a MAC engine to a neighbor once, bypassing the
+ *          engine and the statistics, in TRANSCEIVER_TX_PRIO_CONTROL. Safe
+ *          to call from the engine's receive function.
+ *
+ * @param[in] if_id     The interface to send over.
+ * @param[in] dest      The neighbor, answered with a short address if it
+ *                      is derived from one, NULL to broadcast.
+ * @param[in] payload   The payload of the frame.
+ * @param[in] length    The length of the payload.
+ *
+ * @return  Length of transmitted data in byte
+ */
+int sixlowpan_mac_send_control(int if_id, const net_if_eui64_t *dest,
+                               const void *payload, uint8_t length);
+
 /** @} */
 #endif /* SIXLOWPAN_MAC_H */
@@ -38,6 +38,19 @@
 #define NDP_OPT_ARO_STATE_DUP_ADDR         	(1)
 #define NDP_OPT_ARO_STATE_NBR_CACHE_FULL   	(2)
 
+/**
+ * @name Neighbor unreachability detection constants
+ * @see <a href="http://tools.ietf.org/html/rfc4861#section-10">
+ *          RFC 4861, section 10
+ *      </a>
+ * @{
+ */
+#define NDP_REACHABLE_TIME_MS               (30000)
+#define NDP_RETRANS_TIMER_MS                (1000)
+#define NDP_DELAY_FIRST_PROBE_TIME_MS       (5000)
+#define NDP_MAX_UNICAST_SOLICIT             (3)
+/** @} */
+
 /**
  * @brief   Neighbor cache entry state according to
  *          <a href="http://tools.ietf.org/html/rfc4861#section-7.3.2">
@@ -125,7 +138,13 @@ typedef struct __attribute__((packed)) {
     uint8_t lladdr[8];          ///< Link-layer address of the neighbor
     uint8_t lladdr_len;         ///< Length of link-layer address of the
     ///< neighbor
-    timex_t ltime;              ///< lifetime of entry.
+    timex_t ltime;              ///< time the entry expires, 0 if it does
+    ///< not expire
+    timex_t state_time;         ///< time of the last state change
+    uint8_t probes;             ///< unicast solicitations sent in
+    ///< NDP_NCE_STATUS_PROBE
+    uint8_t probe_pending;      ///< a solicitation is due, see
+    ///< ndp_neighbor_cache_probe()
 } ndp_neighbor_cache_t;
 
 /**
@@ -141,6 +160,39 @@ typedef struct __attribute__((packed)) {
 } ndp_a6br_cache_t;
 
 ndp_default_router_list_t *ndp_default_router_list_search(ipv6_addr_t *ipaddr);
+
+/**
+ * @brief   Gets the default router to send to.
+ *
+ * A router stays preferred until it leaves the list, then the one valid
+ * for the longest time takes over.  Routers whose lifetime ran out are
+ * removed here.
+ *
+ * @return  The preferred default router, NULL if there is none.
+ */
+ndp_default_router_list_t *ndp_default_router_get_preferred(void);
+
+/**
+ * @brief   Adds a neighbor to the neighbor cache or updates its entry if
+ *          it is already known.
+ *
+ * If the cache is full, a garbage-collectible entry is evicted to make
+ * room, preferring one that is not known to be reachable.
+ *
+ * @param[in] if_id         Interface the neighbor is reachable over.
+ * @param[in] ipaddr        IPv6 address of the neighbor.
+ * @param[in] lladdr        Link-layer address of the neighbor.
+ * @param[in] lladdr_len    Length of *lladdr*.
+ * @param[in] isrouter      Neighbor is a router.
+ * @param[in] state         Initial state of the entry.
+ * @param[in] type          Type of the entry.
+ * @param[in] ltime         Lifetime of the entry in seconds, 0 for
+ *                          infinite. Ignored for
+ *                          NDP_NCE_TYPE_GC entries.
+ *
+ * @return  NDP_OPT_ARO_STATE_SUCCESS on success,
+ *          NDP_OPT_ARO_STATE_NBR_CACHE_FULL if no entry could be freed.
+ */
 uint8_t ndp_neighbor_cache_add(int if_id, const ipv6_addr_t *ipaddr,
                                const void *lladdr, uint8_t lladdr_len,
                                uint8_t isrouter, ndp_nce_state_t state,
@@ -156,8 +208,87 @@ uint8_t ndp_neighbor_cache_add(int if_id, const ipv6_addr_t *ipaddr,
  */
 uint8_t ndp_neighbor_cache_remove(const ipv6_addr_t *ipaddr);
 
+/**
+ * @brief   Looks up a neighbor cache entry. Expired entries are removed
+ *          on the fly.
+ *
+ * @param[in] ipaddr        IPv6 address of the neighbor.
+ *
+ * @return  The entry, NULL if *ipaddr* is not in the cache.
+ */
 ndp_neighbor_cache_t *ndp_neighbor_cache_search(ipv6_addr_t *ipaddr);
+
+/**
+ * @brief   Marks a neighbor as reachable, e.g. after a solicited neighbor
+ *          advertisement was received.
+ *
+ * @param[in] nce           A neighbor cache entry.
+ */
+void ndp_neighbor_cache_reachable(ndp_neighbor_cache_t *nce);
+
+/**
+ * @brief   Looks up the link-layer address of a neighbor for sending and
+ *          advances its neighbor unreachability detection state.
+ *
+ * REACHABLE entries whose reachable time elapsed become STALE, sending to
+ * a STALE entry moves it to DELAY, and DELAY entries move to PROBE after
+ * NDP_DELAY_FIRST_PROBE_TIME_MS. An entry that stays unanswered for
+ * NDP_MAX_UNICAST_SOLICIT probes is removed.
+ *
+ * @param[in] ipaddr        IPv6 address of the neighbor.
+ *
+ * @return  The entry, NULL if no usable link-layer address is known.
+ */
 ndp_neighbor_cache_t *ndp_get_ll_address(ipv6_addr_t *ipaddr);
+
+/**
+ * @brief   Sends the unicast neighbor solicitation requested by
+ *          ndp_get_ll_address(), if any.
+ *
+ * Must be called after the packet the entry was looked up for has been
+ * handed to the lower layer, since the solicitation is built in the
+ * shared IPv6 buffer.
+ *
+ * @param[in] nce           The entry returned by ndp_get_ll_address(), may
+ *                          be NULL.
+ */
+void ndp_neighbor_cache_probe(ndp_neighbor_cache_t *nce);
+
+/**
+ * @brief   Registers an address of a host, updates or removes its
+ *          registration, as requested by an address registration option.
+ *
+ * Routers keep registrations in a hashed table of NDP_REG_TABLE_SIZE
+ * entries apart from the neighbor cache, ordered by expiry so that
+ * expired registrations are dropped without scanning the table.
+ *
+ * @param[in] addr          Address to register.
+ * @param[in] eui64         EUI-64 of the registering host.
+ * @param[in] ltime         Registration lifetime in units of 60 seconds,
+ *                          0 removes the registration.
+ *
+ * @return  NDP_OPT_ARO_STATE_SUCCESS on success,
+ *          NDP_OPT_ARO_STATE_DUP_ADDR if another host registered *addr*,
+ *          NDP_OPT_ARO_STATE_NBR_CACHE_FULL if the table is full.
+ */
+uint8_t ndp_registration_update(const ipv6_addr_t *addr,
+                                const ieee_802154_long_t *eui64,
+                                uint16_t ltime);
+
+/**
+ * @brief   Looks up the registration of an address.
+ *
+ * @param[in] addr          A registered address.
+ *
+ * @return  EUI-64 of the host that registered *addr*, NULL if it is not
+ *          registered.
+ */
+const ieee_802154_long_t *ndp_registration_lookup(const ipv6_addr_t *addr);
+
+/**
+ * @brief   Gets the number of registered addresses.
+ */
+uint16_t ndp_registration_count(void);
 int ndp_addr_is_on_link(ipv6_addr_t *dest_addr);
 
 /**
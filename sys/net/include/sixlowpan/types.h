@@ -68,6 +68,24 @@ typedef struct __attribute__((packed)) {
     ipv6_addr_t destaddr;           ///< destination address of this packet.
 } ipv6_hdr_t;
 
+/**
+ * @brief   Data type to represent the fixed part of an IPv6 source routing
+ *          header, followed by the compressed addresses.
+ *
+ * @see <a href="http://tools.ietf.org/html/rfc6554#section-3">
+ *          RFC 6554, section 3
+ *      </a>
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t nextheader;     ///< type of the header behind this one.
+    uint8_t length;         ///< length in 8 octets, without the first 8.
+    uint8_t routing_type;   ///< routing type, 3 for source routing.
+    uint8_t segments_left;  ///< number of addresses still to visit.
+    uint8_t cmpr;           ///< CmprI (4 bit) and CmprE (4 bit).
+    uint8_t pad_reserved;   ///< Pad (4 bit) and 4 bit reserved.
+    uint16_t reserved;      ///< reserved field.
+} ipv6_srh_t;
+
 /**
  * @brief   Data type to represent an ICMPv6 packet header.
  *
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @defgroup    net_tsch Time slotted channel hopping
+ * @ingroup     net
+ * @brief       Scheduled channel hopping MAC engine for the 6LoWPAN MAC
+ *              layer
+ *
+ * Time is divided into slots of TSCH_SLOT_DURATION, counted by the
+ * absolute slot number (ASN) every node of a network agrees on.  Slots
+ * repeat in slotframes, a cell of a slotframe tells what to do in a slot
+ * and on which channel offset: send to a neighbor (dedicated), send with
+ * a backoff to whoever it may be (shared), or listen.  The channel of a
+ * slot is
+ *
+ *     TSCH_HOPPING_SEQUENCE[(ASN + channel offset) % length of it]
+ *
+ * so every cell hops over all channels.  A frame waits for the first cell
+ * to its neighbor, or for a shared cell if it has none; the radio is
+ * powered down in slots without a cell.  Several slotframes may be
+ * installed, in a slot the one with the lowest handle that has something
+ * to do wins.
+ *
+ * The coordinator starts the ASN and sends beacons in its shared cells,
+ * every node synchronizes to the first beacon it hears and then sends
+ * beacons of its own.  Until then the radio listens on
+ * TSCH_SCAN_CHANNEL and nothing can be sent.  Without slotframes
+ * tsch_init() installs the minimal schedule: one shared cell, used by
+ * all nodes to listen, to broadcast and to send beacons, in a slotframe
+ * of TSCH_MINIMAL_LENGTH slots.
+ *
+ * Slots are timed by the hwtimer.  A frame is handed to the transceiver
+ * once per cell, set TRANSCEIVER_TX_MAX_RETRIES to 0 so that it is sent
+ * again in a later cell, on another channel, rather than within the
+ * slot.
+ *
+ * @see     <a href="http://tools.ietf.org/html/rfc7554">RFC 7554</a>
+ * @{
+ *
+ * @file        tsch.h
+ */
+
+#ifndef TSCH_H
+#define TSCH_H
+
+#include <stdint.h>
+
+#include "net_if.h"
+
+/**
+ * @brief   Length of a slot in us, has to be the same on all nodes.
+ */
+#ifndef TSCH_SLOT_DURATION
+#define TSCH_SLOT_DURATION          (15000)
+#endif
+
+/**
+ * @brief   Time from the start of a slot until a frame is sent in us.
+ */
+#ifndef TSCH_TX_OFFSET
+#define TSCH_TX_OFFSET              (4000)
+#endif
+
+/**
+ * @brief   Time a receiver listens after TSCH_TX_OFFSET in us, covers
+ *          clock drift, the longest frame and its acknowledgement.
+ */
+#ifndef TSCH_RX_WAIT
+#define TSCH_RX_WAIT                (8000)
+#endif
+
+/**
+ * @brief   Time from the start of a beacon until it is seen by the engine
+ *          in us, the receiver synchronizes to the sender with it.
+ */
+#ifndef TSCH_BEACON_DELAY
+#define TSCH_BEACON_DELAY           (1000)
+#endif
+
+/**
+ * @brief   Channels to hop over.
+ */
+#ifndef TSCH_HOPPING_SEQUENCE
+#define TSCH_HOPPING_SEQUENCE       { 16, 17, 23, 18, 26, 15, 25, 22, \
+                                      19, 11, 12, 13, 24, 14, 20, 21 }
+#endif
+
+/**
+ * @brief   Channel a node listens on for beacons until it is
+ *          synchronized.
+ */
+#ifndef TSCH_SCAN_CHANNEL
+#define TSCH_SCAN_CHANNEL           (16)
+#endif
+
+/**
+ * @brief   Length of the slotframe of the minimal schedule.
+ */
+#ifndef TSCH_MINIMAL_LENGTH
+#define TSCH_MINIMAL_LENGTH         (7)
+#endif
+
+/**
+ * @brief   Number of slotframes, handles are 0 to TSCH_SLOTFRAMES_NUMOF - 1.
+ */
+#ifndef TSCH_SLOTFRAMES_NUMOF
+#define TSCH_SLOTFRAMES_NUMOF       (2)
+#endif
+
+/**
+ * @brief   Number of cells of all slotframes together.
+ */
+#ifndef TSCH_CELLS_NUMOF
+#define TSCH_CELLS_NUMOF            (16)
+#endif
+
+/**
+ * @brief   Frames waiting for a cell, one per sending thread.
+ */
+#ifndef TSCH_QUEUE_SIZE
+#define TSCH_QUEUE_SIZE             (4)
+#endif
+
+/**
+ * @brief   Cells a unicast frame is sent again in before it is given up.
+ */
+#ifndef TSCH_MAX_RETRIES
+#define TSCH_MAX_RETRIES            (3)
+#endif
+
+/**
+ * @brief   Backoff exponents in shared cells, the backoff counts shared
+ *          cells.
+ */
+#define TSCH_MIN_BE                 (1)
+#define TSCH_MAX_BE                 (5)
+
+/**
+ * @brief   Time between two beacons of a node in us.
+ */
+#ifndef TSCH_BEACON_PERIOD
+#define TSCH_BEACON_PERIOD          (4000000)
+#endif
+
+/**
+ * @brief   Time without a beacon of the time source after which a node
+ *          is no longer synchronized in us.
+ */
+#ifndef TSCH_DESYNC_TIMEOUT
+#define TSCH_DESYNC_TIMEOUT         (60000000)
+#endif
+
+/**
+ * @brief   First octet of a beacon, a 6LoWPAN NALP dispatch.
+ */
+#define TSCH_BEACON_DISPATCH        (0x3e)
+
+/**
+ * @name    Options of a cell
+ * @{
+ */
+#define TSCH_CELL_TX                (0x01)  /**< frames are sent in it */
+#define TSCH_CELL_RX                (0x02)  /**< the radio listens in it */
+#define TSCH_CELL_SHARED            (0x04)  /**< senders back off in it */
+/** @} */
+
+/**
+ * @brief   A cell of a slotframe.
+ */
+typedef struct {
+    uint16_t slot_offset;       /**< slot in the slotframe */
+    uint8_t channel_offset;     /**< added to the ASN to pick the channel */
+    uint8_t options;            /**< TSCH_CELL_* */
+    net_if_eui64_t neighbor;    /**< neighbor to send to, all ones for any
+                                     neighbor and broadcasts */
+} tsch_cell_t;
+
+/**
+ * @brief   Starts channel hopping on an interface.
+ *
+ * @param[in] if_id         The interface, its neighbors have to use TSCH
+ *                          with the same slot duration and hopping
+ *                          sequence.
+ * @param[in] coordinator   1 to start the ASN, 0 to wait for a beacon.
+ *
+ * @return  PID of the TSCH thread, -1 on error.
+ */
+int tsch_init(int if_id, int coordinator);
+
+/**
+ * @brief   Adds a slotframe or changes its length.
+ *
+ * @param[in] handle    0 to TSCH_SLOTFRAMES_NUMOF - 1, lower handles take
+ *                      precedence.
+ * @param[in] length    Number of slots, at least 1.
+ *
+ * @return  0 on success, -1 on error.
+ */
+int tsch_slotframe_add(uint8_t handle, uint16_t length);
+
+/**
+ * @brief   Removes a slotframe and its cells.
+ *
+ * @return  0 on success, -1 if there is no such slotframe.
+ */
+int tsch_slotframe_remove(uint8_t handle);
+
+/**
+ * @brief   Adds a cell to a slotframe.
+ *
+ * @param[in] handle    The slotframe.
+ * @param[in] cell      The cell, copied.
+ *
+ * @return  0 on success, -1 if there is no such slotframe, the slot
+ *          offset is out of it or TSCH_CELLS_NUMOF cells are in use.
+ */
+int tsch_cell_add(uint8_t handle, const tsch_cell_t *cell);
+
+/**
+ * @brief   Removes a cell of a slotframe.
+ *
+ * @return  0 on success, -1 if there is no such cell.
+ */
+int tsch_cell_remove(uint8_t handle, uint16_t slot_offset,
+                     uint8_t channel_offset);
+
+/**
+ * @brief   1 if the node is synchronized and can send.
+ */
+int tsch_is_synced(void);
+
+/**
+ * @brief   The current absolute slot number.
+ */
+uint64_t tsch_get_asn(void);
+
+/** @} */
+#endif /* TSCH_H */
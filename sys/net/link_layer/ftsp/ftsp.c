@@ -0,0 +1,363 @@
+/*
+ * Flooding time synchronization
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_ftsp
+ * @{
+ * @file    ftsp.c
+ * @brief   Network-wide time base after FTSP
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "mutex.h"
+#include "net_if.h"
+#include "vtimer.h"
+#include "workqueue.h"
+#include "sixlowpan/mac.h"
+
+#include "ftsp.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+/* dispatch, root, sequence number, global time */
+#define FTSP_BEACON_LEN     (18)
+
+/* skews are fractions of 2^32, beyond 1000 ppm a beacon is bogus */
+#define FTSP_SKEW_MAX       (INT32_C(4294967))
+
+typedef struct {
+    uint64_t local;
+    int64_t offset;             /* global less local time */
+} ftsp_entry_t;
+
+static mutex_t ftsp_mutex;
+static int ftsp_if_id;
+static work_t ftsp_beacon_work;
+
+static net_if_eui64_t ftsp_id;
+static net_if_eui64_t ftsp_root;
+static uint8_t ftsp_seq;
+/* beacon periods since the last new beacon of the root */
+static uint8_t ftsp_heartbeats;
+static uint8_t ftsp_errors;
+
+/* oldest first */
+static ftsp_entry_t ftsp_table[FTSP_TABLE_SIZE];
+static uint8_t ftsp_entries;
+
+/* global = local + offset_avg + (local - local_avg) * skew / 2^32 */
+static uint64_t ftsp_local_avg;
+static int64_t ftsp_offset_avg;
+static int32_t ftsp_skew;
+
+static inline int ftsp_is_root(void)
+{
+    return memcmp(&ftsp_root, &ftsp_id, sizeof(ftsp_id)) == 0;
+}
+
+static inline int ftsp_valid(void)
+{
+    return ftsp_is_root() || (ftsp_entries >= FTSP_ENTRY_VALID);
+}
+
+/* d * skew / 2^32, for any d as long as the skew is within FTSP_SKEW_MAX */
+static int64_t ftsp_scale(int64_t d, int32_t skew)
+{
+    uint64_t m = (d < 0) ? -(uint64_t) d : (uint64_t) d;
+    int64_t r = (int64_t)(m >> 32) * skew +
+                ((int64_t)(m & UINT32_MAX) * skew) / (INT64_C(1) << 32);
+
+    return (d < 0) ? -r : r;
+}
+
+/* num / den as a fraction of 2^32, den is shifted down where num cannot
+ * be shifted up */
+static int32_t ftsp_ratio(int64_t num, int64_t den)
+{
+    int s = 32;
+    int64_t q;
+
+    while ((s > 0) && ((num > (INT64_MAX >> s)) || (num < -(INT64_MAX >> s)))) {
+        s--;
+    }
+
+    den >>= 32 - s;
+
+    if (den == 0) {
+        return 0;
+    }
+
+    q = num * (INT64_C(1) << s) / den;
+
+    if (q > FTSP_SKEW_MAX) {
+        return FTSP_SKEW_MAX;
+    }
+
+    if (q < -FTSP_SKEW_MAX) {
+        return -FTSP_SKEW_MAX;
+    }
+
+    return (int32_t) q;
+}
+
+/* with ftsp_mutex */
+static uint64_t ftsp_global(uint64_t local)
+{
+    return local + ftsp_offset_avg +
+           ftsp_scale((int64_t)(local - ftsp_local_avg), ftsp_skew);
+}
+
+static uint64_t ftsp_local(uint64_t global)
+{
+    int64_t d = (int64_t)(global - ftsp_offset_avg - ftsp_local_avg);
+    uint64_t local = ftsp_local_avg + d - ftsp_scale(d, ftsp_skew);
+
+    /* the first step is off by d * skew^2 */
+    return local + (global - ftsp_global(local));
+}
+
+static void ftsp_regress(void)
+{
+    uint64_t l0 = ftsp_table[0].local;
+    int64_t o0 = ftsp_table[0].offset;
+    int64_t dl = 0, doff = 0, num = 0, den = 0;
+
+    /* the averages relative to the oldest entry, so the sums stay small */
+    for (uint8_t i = 0; i < ftsp_entries; i++) {
+        dl += (int64_t)(ftsp_table[i].local - l0);
+        doff += ftsp_table[i].offset - o0;
+    }
+
+    ftsp_local_avg = l0 + dl / ftsp_entries;
+    ftsp_offset_avg = o0 + doff / ftsp_entries;
+
+    for (uint8_t i = 0; i < ftsp_entries; i++) {
+        dl = (int64_t)(ftsp_table[i].local - ftsp_local_avg);
+        doff = ftsp_table[i].offset - ftsp_offset_avg;
+        num += dl * doff;
+        den += dl * dl;
+    }
+
+    ftsp_skew = ftsp_ratio(num, den);
+}
+
+static void ftsp_add(uint64_t local, uint64_t global)
+{
+    uint8_t keep = 0;
+
+    if (ftsp_entries >= FTSP_ENTRY_VALID) {
+        int64_t err = (int64_t)(global - ftsp_global(local));
+
+        if ((err > FTSP_ERROR_LIMIT) || (err < -FTSP_ERROR_LIMIT)) {
+            DEBUG("ftsp: beacon %ld us off\n", (long) err);
+
+            if (++ftsp_errors < FTSP_ERRORS_MAX) {
+                return;
+            }
+
+            /* the global time has jumped, start over */
+            ftsp_entries = 0;
+        }
+    }
+
+    ftsp_errors = 0;
+
+    /* drop entries too old to regress over, and the oldest if full */
+    for (uint8_t i = 0; i < ftsp_entries; i++) {
+        if ((ftsp_table[i].local + FTSP_MAX_AGE >= local) &&
+            (ftsp_entries - i < FTSP_TABLE_SIZE)) {
+            ftsp_table[keep++] = ftsp_table[i];
+        }
+    }
+
+    ftsp_table[keep].local = local;
+    ftsp_table[keep].offset = (int64_t)(global - local);
+    ftsp_entries = keep + 1;
+
+    ftsp_regress();
+}
+
+/* in the MAC receiver thread */
+void ftsp_receive(const net_if_eui64_t *src, const uint8_t *payload,
+                  uint8_t length, uint64_t toa)
+{
+    net_if_eui64_t root;
+    uint64_t global = 0;
+    int cmp;
+
+    (void) src;
+
+    if ((length != FTSP_BEACON_LEN) || (payload[0] != FTSP_DISPATCH)) {
+        return;
+    }
+
+    memcpy(&root, &payload[1], sizeof(root));
+
+    for (int i = 10; i < FTSP_BEACON_LEN; i++) {
+        global = (global << 8) | payload[i];
+    }
+
+    mutex_lock(&ftsp_mutex);
+
+    cmp = memcmp(&root, &ftsp_root, sizeof(root));
+
+    /* a higher root, or one we heard this beacon of already */
+    if ((cmp > 0) || ((cmp == 0) && ((int8_t)(payload[9] - ftsp_seq) <= 0))) {
+        mutex_unlock(&ftsp_mutex);
+        return;
+    }
+
+    if (cmp < 0) {
+        DEBUG("ftsp: following a lower root\n");
+        ftsp_root = root;
+    }
+
+    ftsp_seq = payload[9];
+    ftsp_heartbeats = 0;
+    ftsp_add(toa, global + FTSP_DELAY);
+
+    mutex_unlock(&ftsp_mutex);
+}
+
+static void ftsp_beacon(work_t *work)
+{
+    uint8_t beacon[FTSP_BEACON_LEN];
+    uint32_t jitter = FTSP_BEACON_PERIOD / 8;
+    uint64_t global;
+    int send;
+
+    mutex_lock(&ftsp_mutex);
+
+    if (!ftsp_is_root() && (++ftsp_heartbeats >= FTSP_ROOT_TIMEOUT)) {
+        /* the time goes on from the estimate we have */
+        DEBUG("ftsp: taking over as root\n");
+        ftsp_root = ftsp_id;
+        ftsp_heartbeats = 0;
+    }
+
+    if (ftsp_is_root()) {
+        ftsp_seq++;
+    }
+
+    send = ftsp_is_root() || (ftsp_entries >= FTSP_ENTRY_SEND);
+
+    beacon[0] = FTSP_DISPATCH;
+    memcpy(&beacon[1], &ftsp_root, sizeof(ftsp_root));
+    beacon[9] = ftsp_seq;
+    global = ftsp_global(vtimer_now64());
+
+    for (int i = FTSP_BEACON_LEN - 1; i >= 10; i--) {
+        beacon[i] = (uint8_t) global;
+        global >>= 8;
+    }
+
+    mutex_unlock(&ftsp_mutex);
+
+    if (send) {
+        sixlowpan_mac_send_control(ftsp_if_id, NULL, beacon, sizeof(beacon));
+    }
+
+    /* neighbors must not send in step */
+    workqueue_post_in(work, FTSP_BEACON_PERIOD - jitter +
+                      (uint32_t) rand() % (2 * jitter + 1));
+}
+
+int ftsp_init(int if_id)
+{
+    if (!net_if_get_eui64(&ftsp_id, if_id, 0)) {
+        return -1;
+    }
+
+    if (workqueue_init() < 0) {
+        return -1;
+    }
+
+    mutex_init(&ftsp_mutex);
+    ftsp_if_id = if_id;
+    memset(&ftsp_root, 0xff, sizeof(ftsp_root));
+    ftsp_entries = 0;
+
+    workqueue_work_init(&ftsp_beacon_work, ftsp_beacon, NULL,
+                        PRIORITY_MAIN - 1);
+    workqueue_post_in(&ftsp_beacon_work,
+                      (uint32_t) rand() % FTSP_BEACON_PERIOD);
+
+    return 0;
+}
+
+int ftsp_local_to_global(uint64_t local, uint64_t *global)
+{
+    int res = -1;
+
+    mutex_lock(&ftsp_mutex);
+
+    if (ftsp_valid()) {
+        *global = ftsp_global(local);
+        res = 0;
+    }
+
+    mutex_unlock(&ftsp_mutex);
+    return res;
+}
+
+int ftsp_global_to_local(uint64_t global, uint64_t *local)
+{
+    int res = -1;
+
+    mutex_lock(&ftsp_mutex);
+
+    if (ftsp_valid()) {
+        *local = ftsp_local(global);
+        res = 0;
+    }
+
+    mutex_unlock(&ftsp_mutex);
+    return res;
+}
+
+int ftsp_now64(uint64_t *global)
+{
+    return ftsp_local_to_global(vtimer_now64(), global);
+}
+
+int ftsp_set_msg(vtimer_t *t, uint64_t global, unsigned int pid, void *ptr)
+{
+    uint64_t local, now;
+
+    if (ftsp_global_to_local(global, &local) < 0) {
+        return -1;
+    }
+
+    now = vtimer_now64();
+
+    return vtimer_set_msg(t, timex_from_uint64((local > now) ? local - now : 0),
+                          pid, ptr);
+}
+
+void ftsp_status(ftsp_status_t *status)
+{
+    uint64_t now = vtimer_now64();
+
+    mutex_lock(&ftsp_mutex);
+
+    status->root = ftsp_root;
+    status->is_root = ftsp_is_root();
+    status->synced = ftsp_valid();
+    status->entries = ftsp_entries;
+    status->seq = ftsp_seq;
+    status->skew_ppb = (int32_t) ftsp_scale(1000000000, ftsp_skew);
+    status->offset = (int64_t)(ftsp_global(now) - now);
+
+    mutex_unlock(&ftsp_mutex);
+}
@@ -0,0 +1,447 @@
+/*
+ * Low power listening
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_lpl
+ * @{
+ * @file    lpl.c
+ * @brief   Duty cycling MAC engine with phase lock
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "timex.h"
+#include "vtimer.h"
+#include "net_help.h"
+#include "net_if.h"
+#include "transceiver.h"
+#include "sixlowpan/mac.h"
+
+#include "lpl.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define LPL_STACKSIZE       (KERNEL_CONF_STACKSIZE_DEFAULT)
+#define LPL_MSG_QUEUE_SIZE  (4)
+/* frames recently received, to drop the copies heard again */
+#define LPL_SEEN_NUMOF      (4)
+
+typedef struct {
+    uint8_t used;
+    net_if_eui64_t addr;
+    uint64_t wake;              /* a time the neighbor woke up at */
+    uint64_t awake_until;       /* still listening after our last frame */
+} lpl_neighbor_t;
+
+typedef struct {
+    net_if_eui64_t src;
+    uint16_t hash;
+    uint64_t expires;
+} lpl_seen_t;
+
+static char lpl_stack[LPL_STACKSIZE];
+static msg_t lpl_msg_queue[LPL_MSG_QUEUE_SIZE];
+static int lpl_pid = -1;
+static int lpl_if_id;
+/* the MAC receiver thread cannot hear acknowledgements while it sends */
+static int lpl_rx_pid = -1;
+
+/* guards everything below, senders are serialized by lpl_tx_mutex */
+static mutex_t lpl_mutex;
+static mutex_t lpl_tx_mutex;
+
+static transceiver_command_t lpl_tcmd;
+static uint8_t radio_on;
+static uint64_t radio_on_since;
+static uint64_t radio_on_time;
+static uint64_t awake_until;
+
+/* the transceiver wakes up by itself, see lpl_radio_wor() */
+static uint8_t lpl_wor;
+static uint64_t lpl_start;
+
+static uint8_t strobing;
+static volatile uint8_t strobe_acked;
+static net_if_eui64_t strobe_dest;
+
+static lpl_neighbor_t lpl_neighbors[LPL_NEIGHBORS_NUMOF];
+static lpl_seen_t lpl_seen[LPL_SEEN_NUMOF];
+static uint8_t lpl_seen_next;
+
+/* radio commands, with lpl_mutex held */
+static void lpl_radio(uint16_t type)
+{
+    msg_t m;
+    int pid = transceiver_get_pid(lpl_tcmd.transceivers);
+
+    if (pid < 0) {
+        return;
+    }
+
+    m.type = type;
+    m.content.ptr = (char *) &lpl_tcmd;
+    msg_send(&m, pid, 1);
+}
+
+/* 1 if the transceiver listens every LPL_INTERVAL by itself now */
+static int lpl_radio_wor(void)
+{
+    transceiver_wor_t wor = { LPL_INTERVAL, LPL_LISTEN };
+    transceiver_command_t tcmd;
+    msg_t m;
+    int pid = transceiver_get_pid(lpl_tcmd.transceivers);
+
+    if (pid < 0) {
+        return 0;
+    }
+
+    tcmd.transceivers = lpl_tcmd.transceivers;
+    tcmd.data = &wor;
+    m.type = SWITCH_WOR;
+    m.content.ptr = (char *) &tcmd;
+    msg_send_receive(&m, &m, pid);
+
+    return m.content.value;
+}
+
+static void lpl_radio_on(uint64_t now)
+{
+    if (!radio_on) {
+        lpl_radio(SWITCH_RX);
+        radio_on = 1;
+        radio_on_since = now;
+    }
+}
+
+static void lpl_radio_off(uint64_t now)
+{
+    if (radio_on) {
+        if (!lpl_wor || !lpl_radio_wor()) {
+            lpl_radio(POWERDOWN);
+        }
+
+        radio_on = 0;
+        radio_on_time += now - radio_on_since;
+    }
+}
+
+static lpl_neighbor_t *lpl_neighbor_get(const net_if_eui64_t *addr, int add)
+{
+    lpl_neighbor_t *oldest = &lpl_neighbors[0];
+
+    for (int i = 0; i < LPL_NEIGHBORS_NUMOF; i++) {
+        lpl_neighbor_t *n = &lpl_neighbors[i];
+
+        if (n->used && (n->addr.uint64 == addr->uint64)) {
+            return n;
+        }
+
+        if (!n->used || (oldest->used && (n->wake < oldest->wake))) {
+            oldest = n;
+        }
+    }
+
+    if (!add) {
+        return NULL;
+    }
+
+    oldest->used = 1;
+    oldest->addr = *addr;
+    return oldest;
+}
+
+static uint16_t lpl_hash(const uint8_t *data, uint8_t len)
+{
+    uint16_t hash = 5381;
+
+    for (uint8_t i = 0; i < len; i++) {
+        hash = ((hash << 5) + hash) + data[i];
+    }
+
+    return hash;
+}
+
+/* 1 if the frame was received before, remembers it otherwise */
+static int lpl_seen_before(const net_if_eui64_t *src, uint16_t hash,
+                           uint64_t now)
+{
+    for (int i = 0; i < LPL_SEEN_NUMOF; i++) {
+        lpl_seen_t *s = &lpl_seen[i];
+
+        if ((s->expires > now) && (s->hash == hash) &&
+            (s->src.uint64 == src->uint64)) {
+            return 1;
+        }
+    }
+
+    /* every copy is sent within an interval and the listen window */
+    lpl_seen[lpl_seen_next].src = *src;
+    lpl_seen[lpl_seen_next].hash = hash;
+    lpl_seen[lpl_seen_next].expires = now + LPL_INTERVAL + LPL_LISTEN;
+    lpl_seen_next = (lpl_seen_next + 1) % LPL_SEEN_NUMOF;
+    return 0;
+}
+
+static int lpl_send(const sixlowpan_mac_frame_t *frame)
+{
+    lpl_neighbor_t *n = NULL;
+    uint64_t now = vtimer_now64();
+    uint64_t deadline;
+    uint8_t acked;
+    int res;
+
+    mutex_lock(&lpl_tx_mutex);
+    mutex_lock(&lpl_mutex);
+
+    if (!frame->mcast) {
+        n = lpl_neighbor_get(&frame->neighbor, 0);
+    }
+
+    if ((n != NULL) && (now < n->awake_until)) {
+        /* still listening after the last frame */
+        deadline = n->awake_until;
+    }
+    else if ((n != NULL) && (now - n->wake < LPL_PHASE_MAX_AGE)) {
+        uint64_t next = n->wake + ((now + LPL_GUARD - n->wake) / LPL_INTERVAL + 1) *
+                        LPL_INTERVAL;
+
+        mutex_unlock(&lpl_mutex);
+        vtimer_usleep(next - LPL_GUARD - now);
+        mutex_lock(&lpl_mutex);
+
+        deadline = next + LPL_GUARD + LPL_LISTEN;
+    }
+    else {
+        deadline = now + LPL_INTERVAL + LPL_LISTEN;
+    }
+
+    strobing = 1;
+    strobe_acked = 0;
+    strobe_dest = frame->neighbor;
+    lpl_radio_on(vtimer_now64());
+    mutex_unlock(&lpl_mutex);
+
+    do {
+        res = sixlowpan_mac_transmit(frame);
+        vtimer_usleep(LPL_ACK_WAIT);
+    } while ((res > 0) && !strobe_acked && (vtimer_now64() < deadline));
+
+    mutex_lock(&lpl_mutex);
+    strobing = 0;
+    acked = strobe_acked;
+    mutex_unlock(&lpl_mutex);
+    mutex_unlock(&lpl_tx_mutex);
+
+    /* let the thread power the radio down */
+    msg_t m;
+    m.type = 0;
+    msg_send(&m, lpl_pid, 0);
+
+    if (!frame->mcast && !acked && (thread_getpid() != lpl_rx_pid)) {
+        DEBUG("lpl: no acknowledgement\n");
+        return -1;
+    }
+
+    return res;
+}
+
+/* in the MAC receiver thread */
+static int lpl_receive(int if_id, const net_if_eui64_t *src,
+                       const net_if_eui64_t *dst, const uint8_t *payload,
+                       uint8_t length)
+{
+    uint64_t now = vtimer_now64();
+    uint8_t ack = LPL_ACK_DISPATCH;
+    int bcast = (dst->uint16[3] == 0xffff);
+    int seen;
+
+    (void) if_id;
+
+    lpl_rx_pid = thread_getpid();
+
+    if (!bcast && (net_if_get_interface(lpl_if_id) != NULL)) {
+        net_if_eui64_t own;
+
+        net_if_get_eui64(&own, lpl_if_id, 0);
+
+        if ((own.uint64 != dst->uint64) &&
+            (net_if_get_hardware_address(lpl_if_id) != NTOHS(dst->uint16[3]))) {
+            /* overheard */
+            return 0;
+        }
+    }
+
+    mutex_lock(&lpl_mutex);
+
+    if ((length == 1) && (payload[0] == LPL_ACK_DISPATCH)) {
+        if (strobing && (strobe_dest.uint64 == src->uint64)) {
+            lpl_neighbor_t *n = lpl_neighbor_get(src, 1);
+
+            /* it woke up a little earlier, the guard covers that */
+            n->wake = now;
+            n->awake_until = now + LPL_AFTER_RX - LPL_GUARD;
+            strobe_acked = 1;
+        }
+
+        mutex_unlock(&lpl_mutex);
+        return 1;
+    }
+
+    if (awake_until < now + LPL_AFTER_RX) {
+        awake_until = now + LPL_AFTER_RX;
+    }
+
+    seen = lpl_seen_before(src, lpl_hash(payload, length), now);
+
+    if (lpl_wor && !radio_on) {
+        msg_t m;
+
+        /* woken by the transceiver, which stays in RX now; the thread
+         * ends it at *awake_until* */
+        radio_on = 1;
+        radio_on_since = now;
+        m.type = 0;
+        msg_send(&m, lpl_pid, 0);
+    }
+
+    mutex_unlock(&lpl_mutex);
+
+    if (!bcast) {
+        /* again for copies, the first acknowledgement may be lost */
+        sixlowpan_mac_send_control(lpl_if_id, src, &ack, sizeof(ack));
+    }
+
+    return seen;
+}
+
+static const sixlowpan_mac_engine_t lpl_engine = {
+    lpl_send,
+    lpl_receive,
+};
+
+static void lpl_process(void)
+{
+    uint64_t next_wake = vtimer_now64();
+    msg_t m;
+
+    msg_init_queue(lpl_msg_queue, LPL_MSG_QUEUE_SIZE);
+
+    while (1) {
+        uint64_t now, until;
+
+        mutex_lock(&lpl_mutex);
+        now = vtimer_now64();
+
+        if (lpl_wor) {
+            /* no wake ups to time, the MCU sleeps until a frame comes */
+            if (!strobing && radio_on && (now >= awake_until)) {
+                lpl_radio_off(now);
+            }
+
+            if (!strobing && radio_on) {
+                until = awake_until;
+                mutex_unlock(&lpl_mutex);
+                vtimer_msg_receive_timeout(&m, timex_from_uint64(until - now));
+            }
+            else {
+                mutex_unlock(&lpl_mutex);
+                msg_receive(&m);
+            }
+
+            continue;
+        }
+
+        if (now >= next_wake) {
+            lpl_radio_on(now);
+
+            if (awake_until < now + LPL_LISTEN) {
+                awake_until = now + LPL_LISTEN;
+            }
+
+            while (next_wake <= now) {
+                next_wake += LPL_INTERVAL;
+            }
+        }
+
+        if (!strobing && (now >= awake_until)) {
+            lpl_radio_off(now);
+        }
+
+        until = next_wake;
+
+        if (radio_on && !strobing && (awake_until < until)) {
+            until = awake_until;
+        }
+
+        mutex_unlock(&lpl_mutex);
+
+        vtimer_msg_receive_timeout(&m, timex_from_uint64(until - now));
+    }
+}
+
+int lpl_init(int if_id)
+{
+    net_if_t *iface = net_if_get_interface(if_id);
+
+    if (lpl_pid >= 0) {
+        return lpl_pid;
+    }
+
+    if (iface == NULL) {
+        return -1;
+    }
+
+    mutex_init(&lpl_mutex);
+    mutex_init(&lpl_tx_mutex);
+    lpl_if_id = if_id;
+    lpl_tcmd.transceivers = iface->transceivers;
+    lpl_tcmd.data = NULL;
+    lpl_start = vtimer_now64();
+    /* the radio is on until the first wake up is over, unless it wakes
+     * up by itself */
+    lpl_wor = lpl_radio_wor();
+    radio_on = !lpl_wor;
+    radio_on_since = lpl_start;
+
+    lpl_pid = thread_create(lpl_stack, LPL_STACKSIZE, PRIORITY_MAIN - 3,
+                            CREATE_STACKTEST, lpl_process, "lpl");
+
+    if (lpl_pid < 0) {
+        return -1;
+    }
+
+    sixlowpan_mac_set_engine(&lpl_engine);
+    return lpl_pid;
+}
+
+uint64_t lpl_get_radio_on_time(void)
+{
+    uint64_t res;
+
+    mutex_lock(&lpl_mutex);
+    res = radio_on_time;
+
+    if (radio_on) {
+        res += vtimer_now64() - radio_on_since;
+    }
+
+    if (lpl_wor) {
+        /* the transceiver's own listening, estimated */
+        res += (vtimer_now64() - lpl_start - res) * LPL_LISTEN / LPL_INTERVAL;
+    }
+
+    mutex_unlock(&lpl_mutex);
+    return res;
+}
@@ -30,6 +30,15 @@
 #include "debug.h"
 
 net_if_t interfaces[NET_IF_MAX];
+/* bumped on every change of an address list, never 0 */
+static volatile uint16_t address_generation = 1;
+
+static void address_changed(void)
+{
+    if (++address_generation == 0) {
+        address_generation = 1;
+    }
+}
 
 #ifdef DEBUG_ENABLED
 void print_addr_hex(net_if_addr_t *addr)
@@ -110,6 +119,7 @@ int net_if_init_interface(uint8_t protocols, transceiver_type_t transceivers)
             interfaces[i].protocols = protocols;
             mutex_init(&interfaces[i].address_buffer_mutex);
             interfaces[i].transceivers = transceivers;
+            interfaces[i].transceiver_pid = -1;
             DEBUG("Initialized interface %d for protocols %d on transceivers 0x%x\n",
                   i, protocols, transceivers);
             return i;
@@ -153,6 +163,7 @@ int net_if_add_address(int if_id, net_if_addr_t *addr)
 
     clist_add((clist_node_t **)&interfaces[if_id].addresses,
               (clist_node_t *)addr);
+    address_changed();
 
     mutex_unlock(&interfaces[if_id].address_buffer_mutex);
 
@@ -175,6 +186,7 @@ int net_if_del_address(int if_id, net_if_addr_t *addr)
 
     clist_remove((clist_node_t **)&interfaces[if_id].addresses,
                  (clist_node_t *)addr);
+    address_changed();
 
     mutex_unlock(&interfaces[if_id].address_buffer_mutex);
 
@@ -202,6 +214,11 @@ net_if_addr_t *net_if_iter_addresses(int if_id, net_if_addr_t **addr)
     return *addr;
 }
 
+uint16_t net_if_get_address_generation(void)
+{
+    return address_generation;
+}
+
 net_if_l3p_t net_if_get_l3p_types(int if_id)
 {
     net_if_l3p_t protocols;
@@ -261,34 +278,62 @@ uint32_t net_if_transceiver_get_set_handler(int if_id, uint16_t op_type,
     msg_t msg;
     transceiver_command_t tcmd;
 
+    if (interfaces[if_id].transceiver_pid < 0) {
+        /* the workers may start after the interface was initialized */
+        interfaces[if_id].transceiver_pid =
+            transceiver_get_pid(interfaces[if_id].transceivers);
+
+        if (interfaces[if_id].transceiver_pid < 0) {
+            DEBUG("No transceiver running for interface %d.\n", if_id);
+            return (uint32_t) -1;
+        }
+    }
+
     tcmd.transceivers = interfaces[if_id].transceivers;
     tcmd.data = (char *)data;
+
+    if ((op_type != SND_PKT) && (op_type != SND_PKT_PRIO) &&
+        (op_type != SND_PKT_QUEUED)) {
+        /* configuration goes to the driver without a round trip */
+        return transceiver_config(op_type, &tcmd);
+    }
+
     msg.content.ptr = (char *)&tcmd;
     msg.type = op_type;
-    msg_send_receive(&msg, &msg, transceiver_pid);
+    msg_send_receive(&msg, &msg, interfaces[if_id].transceiver_pid);
 
     return msg.content.value;
 }
 
 int net_if_send_packet_broadcast(net_if_trans_addr_m_t preferred_dest_mode,
                                  const void *payload, size_t payload_len)
+{
+    return net_if_send_packet_broadcast_prio(preferred_dest_mode, payload,
+                                             payload_len,
+                                             TRANSCEIVER_TX_PRIO_DATA);
+}
+
+int net_if_send_packet_broadcast_prio(net_if_trans_addr_m_t preferred_dest_mode,
+                                      const void *payload, size_t payload_len,
+                                      uint8_t priority)
 {
     int if_id = -1;
     int res = 0, res_prev = 0;
 
     while ((if_id = net_if_iter_interfaces(if_id)) >= 0) {
         if (interfaces[if_id].transceivers & (TRANSCEIVER_CC1100 | TRANSCEIVER_NATIVE)) {
-            res = net_if_send_packet(if_id, 0,
-                                     payload, payload_len);
+            res = net_if_send_packet_prio(if_id, 0, payload, payload_len,
+                                          priority, NULL);
         }
         else if (preferred_dest_mode == NET_IF_TRANS_ADDR_M_SHORT) {
-            res = net_if_send_packet(if_id, IEEE_802154_SHORT_MCAST_ADDR,
-                                     payload, payload_len);
+            res = net_if_send_packet_prio(if_id, IEEE_802154_SHORT_MCAST_ADDR,
+                                          payload, payload_len, priority,
+                                          NULL);
         }
         else {
             net_if_eui64_t mcast_addr = IEEE_802154_LONG_MCAST_ADDR;
-            res = net_if_send_packet_long(if_id, &mcast_addr, payload,
-                                          payload_len);
+            res = net_if_send_packet_long_prio(if_id, &mcast_addr, payload,
+                                               payload_len, priority, NULL);
         }
 
         if (res_prev != 0) {
@@ -308,11 +353,46 @@ int net_if_send_packet_broadcast(net_if_trans_addr_m_t preferred_dest_mode,
     return res;
 }
 
+/* the reply to SND_PKT, *attempts* gets the number of transmissions */
+static int net_if_send_result(uint32_t response, size_t payload_len,
+                              uint8_t *attempts)
+{
+    int16_t res = TRANSCEIVER_TX_RESULT(response);
+
+    if (attempts != NULL) {
+        *attempts = TRANSCEIVER_TX_ATTEMPTS(response);
+    }
+
+    if (res <= 0) {
+        return res;
+    }
+
+    return ((size_t)res > payload_len) ? (int)payload_len : (int)res;
+}
+
 int net_if_send_packet(int if_id, uint16_t target, const void *payload,
                        size_t payload_len)
+{
+    return net_if_send_packet_attempts(if_id, target, payload, payload_len,
+                                       NULL);
+}
+
+int net_if_send_packet_attempts(int if_id, uint16_t target,
+                                const void *payload, size_t payload_len,
+                                uint8_t *attempts)
+{
+    return net_if_send_packet_prio(if_id, target, payload, payload_len,
+                                   TRANSCEIVER_TX_PRIO_DATA, attempts);
+}
+
+int net_if_send_packet_prio(int if_id, uint16_t target, const void *payload,
+                            size_t payload_len, uint8_t priority,
+                            uint8_t *attempts)
 {
     DEBUG("net_if_send_packet: if_id = %d, target = %d, payload = %p, "
-          "payload_len = %d\n", if_id, target, payload, payload_len);
+          "payload_len = %d, priority = %d\n", if_id, target, payload,
+          payload_len, priority);
+    transceiver_tx_request_t req;
     uint32_t response;
 
     if (if_id < 0 || if_id > NET_IF_MAX || !interfaces[if_id].initialized) {
@@ -320,6 +400,9 @@ int net_if_send_packet(int if_id, uint16_t target, const void *payload,
         return -1;
     }
 
+    req.priority = priority;
+    req.tag = 0;
+
     if (interfaces[if_id].transceivers & (TRANSCEIVER_CC2420 | TRANSCEIVER_AT86RF231 | TRANSCEIVER_MC1322X)) {
         ieee802154_packet_t p;
 
@@ -329,14 +412,17 @@ int net_if_send_packet(int if_id, uint16_t target, const void *payload,
         p.frame.payload_len = (uint8_t)payload_len;
         p.frame.fcf.src_addr_m = (uint8_t)interfaces[if_id].trans_src_addr_m;
         p.frame.fcf.dest_addr_m = IEEE_802154_SHORT_ADDR_M;
-        p.frame.fcf.ack_req = 0;
+        p.frame.fcf.ack_req = (target != IEEE_802154_SHORT_MCAST_ADDR) &&
+                              (interfaces[if_id].transceivers & TRANSCEIVER_HW_ACK);
         p.frame.fcf.sec_enb = 0;
         p.frame.fcf.frame_type = 1;
         p.frame.fcf.frame_pend = 0;
 
         p.frame.dest_pan_id = net_if_get_pan_id(if_id);
         memcpy(p.frame.dest_addr, &target, 2);
-        response = net_if_transceiver_get_set_handler(if_id, SND_PKT, (void *)&p);
+        req.packet = &p;
+        response = net_if_transceiver_get_set_handler(if_id, SND_PKT_PRIO,
+                                                      (void *)&req);
     }
     else {
         radio_packet_t p;
@@ -344,19 +430,37 @@ int net_if_send_packet(int if_id, uint16_t target, const void *payload,
         p.data = (uint8_t *) payload;
         p.length = payload_len;
         p.dst = target;
-        response = net_if_transceiver_get_set_handler(if_id, SND_PKT, (void *)&p);
+        req.packet = &p;
+        response = net_if_transceiver_get_set_handler(if_id, SND_PKT_PRIO,
+                                                      (void *)&req);
     }
 
-
-    return (response > payload_len) ? (int)payload_len : (int)response;
+    return net_if_send_result(response, payload_len, attempts);
 }
 
 int net_if_send_packet_long(int if_id, net_if_eui64_t *target,
                             const void *payload, size_t payload_len)
+{
+    return net_if_send_packet_long_attempts(if_id, target, payload,
+                                            payload_len, NULL);
+}
+
+int net_if_send_packet_long_attempts(int if_id, net_if_eui64_t *target,
+                                     const void *payload, size_t payload_len,
+                                     uint8_t *attempts)
+{
+    return net_if_send_packet_long_prio(if_id, target, payload, payload_len,
+                                        TRANSCEIVER_TX_PRIO_DATA, attempts);
+}
+
+int net_if_send_packet_long_prio(int if_id, net_if_eui64_t *target,
+                                 const void *payload, size_t payload_len,
+                                 uint8_t priority, uint8_t *attempts)
 {
     DEBUG("net_if_send_packet: if_id = %d, target = %016" PRIx64 ", "
-          "payload = %p, payload_len = %d\n", if_id, NTOHLL(target->uint64), payload,
-          payload_len);
+          "payload = %p, payload_len = %d, priority = %d\n", if_id,
+          NTOHLL(target->uint64), payload, payload_len, priority);
+    transceiver_tx_request_t req;
     uint32_t response;
 
     if (if_id < 0 || if_id > NET_IF_MAX || !interfaces[if_id].initialized) {
@@ -364,6 +468,9 @@ int net_if_send_packet_long(int if_id, net_if_eui64_t *target,
         return -1;
     }
 
+    req.priority = priority;
+    req.tag = 0;
+
     if (interfaces[if_id].transceivers & (TRANSCEIVER_CC2420 |
                                           TRANSCEIVER_AT86RF231 |
                                           TRANSCEIVER_MC1322X)) {
@@ -373,13 +480,16 @@ int net_if_send_packet_long(int if_id, net_if_eui64_t *target,
         p.frame.payload_len = (uint8_t)payload_len;
         p.frame.fcf.src_addr_m = (uint8_t)interfaces[if_id].trans_src_addr_m;
         p.frame.fcf.dest_addr_m = IEEE_802154_LONG_ADDR_M;
-        p.frame.fcf.ack_req = 0;
+        p.frame.fcf.ack_req = (target->uint64 != UINT64_MAX) &&
+                              (interfaces[if_id].transceivers & TRANSCEIVER_HW_ACK);
         p.frame.fcf.sec_enb = 0;
         p.frame.fcf.frame_type = 1;
         p.frame.fcf.frame_pend = 0;
         p.frame.dest_pan_id = net_if_get_pan_id(if_id);
         memcpy(p.frame.dest_addr, target, 8);
-        response = net_if_transceiver_get_set_handler(if_id, SND_PKT, (void *)&p);
+        req.packet = &p;
+        response = net_if_transceiver_get_set_handler(if_id, SND_PKT_PRIO,
+                                                      (void *)&req);
     }
     else {
         radio_packet_t p;
@@ -387,11 +497,62 @@ int net_if_send_packet_long(int if_id, net_if_eui64_t *target,
         p.data = (uint8_t *) payload;
         p.length = payload_len;
         p.dst = NTOHS(target->uint16[3]);
-        response = net_if_transceiver_get_set_handler(if_id, SND_PKT, (void *)&p);
+        req.packet = &p;
+        response = net_if_transceiver_get_set_handler(if_id, SND_PKT_PRIO,
+                                                      (void *)&req);
+    }
+
+    return net_if_send_result(response, payload_len, attempts);
+}
+
+int net_if_send_packet_queued(int if_id, uint16_t target,
+                              const void *payload, size_t payload_len,
+                              uint8_t priority, uint16_t tag)
+{
+    DEBUG("net_if_send_packet_queued: if_id = %d, target = %d, payload = %p, "
+          "payload_len = %d, priority = %d\n", if_id, target, payload,
+          payload_len, priority);
+    transceiver_tx_request_t req;
+
+    if (if_id < 0 || if_id > NET_IF_MAX || !interfaces[if_id].initialized) {
+        DEBUG("Send packet: No interface initialized with ID %d.\n", if_id);
+        return -1;
     }
 
+    req.priority = priority;
+    req.tag = tag;
+
+    if (interfaces[if_id].transceivers & (TRANSCEIVER_CC2420 | TRANSCEIVER_AT86RF231 | TRANSCEIVER_MC1322X)) {
+        ieee802154_packet_t p;
+
+        memset(&p, 0, sizeof(ieee802154_packet_t));
+
+        p.frame.payload = (uint8_t *)payload;
+        p.frame.payload_len = (uint8_t)payload_len;
+        p.frame.fcf.src_addr_m = (uint8_t)interfaces[if_id].trans_src_addr_m;
+        p.frame.fcf.dest_addr_m = IEEE_802154_SHORT_ADDR_M;
+        p.frame.fcf.ack_req = (target != IEEE_802154_SHORT_MCAST_ADDR) &&
+                              (interfaces[if_id].transceivers & TRANSCEIVER_HW_ACK);
+        p.frame.fcf.sec_enb = 0;
+        p.frame.fcf.frame_type = 1;
+        p.frame.fcf.frame_pend = 0;
 
-    return (response > payload_len) ? (int)payload_len : (int)response;
+        p.frame.dest_pan_id = net_if_get_pan_id(if_id);
+        memcpy(p.frame.dest_addr, &target, 2);
+        req.packet = &p;
+        return (int)net_if_transceiver_get_set_handler(if_id, SND_PKT_QUEUED,
+                (void *)&req);
+    }
+    else {
+        radio_packet_t p;
+        memset(&p, 0, sizeof(radio_packet_t));
+        p.data = (uint8_t *) payload;
+        p.length = payload_len;
+        p.dst = target;
+        req.packet = &p;
+        return (int)net_if_transceiver_get_set_handler(if_id, SND_PKT_QUEUED,
+                (void *)&req);
+    }
 }
 
 int net_if_register(int if_id, int pid)
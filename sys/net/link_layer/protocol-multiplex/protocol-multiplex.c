@@ -66,66 +66,132 @@ int pm_find_handler_index(const pm_table_t *table, protocol_t protocol,
     return -1;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * The handler array is an open addressing hash table: small protocol
+ * numbers index it directly, larger ones are spread over it. Collisions
+ * move on to the next entry, so a lookup costs the same however many
+ * handlers are registered.
+ */
+static unsigned int pm_home(const pm_table_t *table, protocol_t protocol)
+{
+    if (protocol < table->size) {
+        return protocol;
+    }
+
+    return (unsigned int)(protocol * 167u) % table->size;
+}
+/*---------------------------------------------------------------------------*/
+static int pm_lookup(const pm_table_t *table, protocol_t protocol)
+{
+    unsigned int i = pm_home(table, protocol);
+
+    for (unsigned int n = 0; n < table->size; n++) {
+        if (table->handler[i].protocol == protocol) {
+            return i;
+        }
+
+        if (table->handler[i].protocol == 0) {
+            /* entries are shifted back on removal, the probe ends here */
+            return -1;
+        }
+
+        if (++i == table->size) {
+            i = 0;
+        }
+    }
+
+    return -1;
+}
+/*---------------------------------------------------------------------------*/
 int pm_set_handler(const pm_table_t *table, protocol_t protocol,
                    packet_handler_t handler)
 {
+    unsigned int i;
+
     /* Reject illegal values */
     if (protocol == 0 || handler == NULL) {
         PRINTF("proto %u rejected", protocol);
         return -1;
     }
 
-    /* Check if there is already a handler for given protocol */
-    int index = pm_find_handler_index(table, protocol, 0);
+    /* Two handlers for same protocol not allowed because only one gets
+     * called, the last one registered wins */
+    int index = pm_lookup(table, protocol);
 
     if (index >= 0) {
-        /* Two handlers for same protocol not allowed because only
-         * one gets called. This hasn't to be the last one who
-         * registered!*/
         PRINTF("proto %u handler found, reset", protocol);
-        table->handler[index].protocol = 0;
-        table->handler[index].handler = NULL;
+        table->handler[index].handler = handler;
+        return index;
     }
 
-    /* Find free position for handler (protocol value is 0) */
-    index = pm_find_handler_index(table, 0, 0);
+    /* Store handler at the first free entry of its probe sequence */
+    i = pm_home(table, protocol);
 
-    /* Store handler if free index found */
-    if (index >= 0) {
-        PRINTF("proto %u, set", protocol);
-        table->handler[index].protocol = protocol;
-        table->handler[index].handler = handler;
+    for (unsigned int n = 0; n < table->size; n++) {
+        if (table->handler[i].protocol == 0) {
+            PRINTF("proto %u, set", protocol);
+            table->handler[i].protocol = protocol;
+            table->handler[i].handler = handler;
+            return i;
+        }
+
+        if (++i == table->size) {
+            i = 0;
+        }
     }
 
-    /* Return result (-1 on error or no free index) */
-    return index;
+    /* no free index */
+    return -1;
 }
 /*---------------------------------------------------------------------------*/
 void pm_remove_handler(const pm_table_t *table, protocol_t protocol,
                        packet_handler_t handler)
 {
-    int i;
+    int index = pm_lookup(table, protocol);
+    unsigned int i, j;
 
-    for (i = 0; i < table->size; i++) {
-        if (table->handler[i].protocol == protocol && table->handler[i].handler == handler) {
-            PRINTF("proto %u handler found, reset", protocol);
-            table->handler[i].protocol = 0;
-            table->handler[i].handler = NULL;
+    if ((index < 0) || (table->handler[index].handler != handler)) {
+        return;
+    }
+
+    PRINTF("proto %u handler found, reset", protocol);
+
+    /* shift later entries of the probe sequence back into the gap */
+    i = j = index;
+
+    while (1) {
+        if (++j == table->size) {
+            j = 0;
+        }
+
+        if ((j == (unsigned int) index) || (table->handler[j].protocol == 0)) {
+            break;
+        }
+
+        unsigned int k = pm_home(table, table->handler[j].protocol);
+
+        /* entry j may move to i if its home is not in (i, j] */
+        if ((i <= j) ? ((k <= i) || (k > j)) : ((k <= i) && (k > j))) {
+            table->handler[i] = table->handler[j];
+            i = j;
         }
     }
+
+    table->handler[i].protocol = 0;
+    table->handler[i].handler = NULL;
 }
 /*---------------------------------------------------------------------------*/
 int pm_invoke(const pm_table_t *table, protocol_t protocol, void *payload,
               int payload_size, packet_info_t *packet_info)
 {
-    int index = 0;
+    int index;
 
     /* Reject illegal values */
     if (protocol == 0) {
         return -1;
     }
 
-    if ((index = pm_find_handler_index(table, protocol, index)) != -1) {
+    if ((index = pm_lookup(table, protocol)) != -1) {
         PRINTF("proto %u, invoke", protocol);
         table->handler[index].handler(payload, payload_size, packet_info);
     }
@@ -0,0 +1,748 @@
+/*
+ * Time slotted channel hopping
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_tsch
+ * @{
+ * @file    tsch.c
+ * @brief   Scheduled channel hopping MAC engine
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "kernel.h"
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "net_if.h"
+#include "transceiver.h"
+#include "sixlowpan/mac.h"
+
+#include "tsch.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define TSCH_STACKSIZE      (KERNEL_CONF_STACKSIZE_DEFAULT)
+#define TSCH_MSG_QUEUE_SIZE (4)
+
+#define TSCH_MSG_TIMER      (1)
+#define TSCH_MSG_RESYNC     (2)
+
+/* what the timer is set for */
+#define TSCH_PHASE_SLOT     (0)
+#define TSCH_PHASE_TX       (1)
+#define TSCH_PHASE_RX_END   (2)
+
+/* dispatch, ASN in 5 octets, join priority */
+#define TSCH_BEACON_LEN     (7)
+/* a deadline closer than this counts as missed */
+#define TSCH_MIN_AHEAD      (HWTIMER_TICKS(500))
+
+#define TSCH_SLOT_TICKS     (HWTIMER_TICKS(TSCH_SLOT_DURATION))
+#define TSCH_BEACON_SLOTS   (TSCH_BEACON_PERIOD / TSCH_SLOT_DURATION)
+#define TSCH_DESYNC_SLOTS   (TSCH_DESYNC_TIMEOUT / TSCH_SLOT_DURATION)
+
+typedef struct {
+    tsch_cell_t cell;
+    uint8_t handle;
+    uint8_t used;
+} tsch_cell_entry_t;
+
+typedef struct {
+    const sixlowpan_mac_frame_t *frame;
+    mutex_t done;               /* unlocked when sent or given up */
+    int res;
+    uint16_t order;
+    uint8_t attempts;
+    uint8_t be;
+    uint8_t backoff;            /* shared cells left out */
+    uint8_t used;
+    uint8_t queued;
+} tsch_tx_t;
+
+static char tsch_stack[TSCH_STACKSIZE];
+static msg_t tsch_msg_queue[TSCH_MSG_QUEUE_SIZE];
+static int tsch_pid = -1;
+static int tsch_if_id;
+static const uint8_t tsch_hopping[] = TSCH_HOPPING_SEQUENCE;
+
+/* guards everything below, zero initialized so that slotframes may be
+ * added before tsch_init() */
+static mutex_t tsch_mutex;
+
+static transceiver_command_t tsch_tcmd;
+static uint8_t radio_on;
+static uint8_t radio_channel;
+
+static uint8_t tsch_coordinator;
+static uint8_t tsch_synced;
+static uint8_t tsch_join_prio;
+static net_if_eui64_t tsch_time_source;
+static uint64_t tsch_last_sync_asn;
+static uint64_t tsch_beacon_asn;
+
+/* the slot *tsch_asn* starts at *tsch_slot_start* */
+static uint64_t tsch_asn;
+static unsigned long tsch_slot_start;
+
+static hwtimer_entry_t tsch_timer;
+static unsigned int tsch_timer_gen;
+static uint8_t tsch_phase;
+
+/* what the current slot is used for */
+static tsch_tx_t *tsch_cur_tx;
+static uint8_t tsch_cur_beacon;
+static uint8_t tsch_cur_shared;
+
+static uint16_t tsch_slotframes[TSCH_SLOTFRAMES_NUMOF];
+static tsch_cell_entry_t tsch_cells[TSCH_CELLS_NUMOF];
+static tsch_tx_t tsch_queue[TSCH_QUEUE_SIZE];
+static uint16_t tsch_order;
+
+/* the hwtimer counts from 0 to HWTIMER_MAXTICKS */
+static unsigned long ticks_add(unsigned long t, unsigned long d)
+{
+    return (HWTIMER_MAXTICKS - t >= d) ? t + d : d - (HWTIMER_MAXTICKS - t) - 1;
+}
+
+static unsigned long ticks_sub(unsigned long t, unsigned long d)
+{
+    return (t >= d) ? t - d : HWTIMER_MAXTICKS - (d - t) + 1;
+}
+
+static int ticks_ahead(unsigned long t, unsigned long now)
+{
+    unsigned long d = ticks_sub(t, now);
+
+    return (d >= TSCH_MIN_AHEAD) && (d <= HWTIMER_MAXTICKS / 2);
+}
+
+static inline int tsch_is_bcast(const net_if_eui64_t *addr)
+{
+    return addr->uint64 == UINT64_MAX;
+}
+
+/* radio commands, with tsch_mutex held */
+static void tsch_radio(uint16_t type)
+{
+    msg_t m;
+    int pid = transceiver_get_pid(tsch_tcmd.transceivers);
+
+    if (pid < 0) {
+        return;
+    }
+
+    m.type = type;
+    m.content.ptr = (char *) &tsch_tcmd;
+    msg_send(&m, pid, 1);
+}
+
+static void tsch_set_channel(uint8_t channel)
+{
+    transceiver_command_t tcmd;
+    int32_t c = channel;
+
+    if (channel == radio_channel) {
+        return;
+    }
+
+    tcmd.transceivers = tsch_tcmd.transceivers;
+    tcmd.data = &c;
+
+    /* once per slot, called directly rather than through the worker */
+    if (transceiver_config(SET_CHANNEL, &tcmd) == (uint32_t) -1) {
+        return;
+    }
+
+    radio_channel = channel;
+}
+
+static void tsch_radio_rx(uint8_t channel)
+{
+    tsch_set_channel(channel);
+
+    if (!radio_on) {
+        tsch_radio(SWITCH_RX);
+        radio_on = 1;
+    }
+}
+
+static void tsch_radio_off(void)
+{
+    if (radio_on) {
+        tsch_radio(POWERDOWN);
+        radio_on = 0;
+    }
+}
+
+static void tsch_timer_cb(void *arg)
+{
+    msg_t m;
+
+    m.type = TSCH_MSG_TIMER;
+    m.content.value = (uint32_t)(uintptr_t) arg;
+    msg_send_int(&m, tsch_pid);
+}
+
+static int tsch_timer_set(uint8_t phase, unsigned long at)
+{
+    if (!ticks_ahead(at, hwtimer_now())) {
+        return -1;
+    }
+
+    /* a timer message still queued is stale from now on */
+    tsch_phase = phase;
+    tsch_timer_gen++;
+    hwtimer_entry_set_absolute(&tsch_timer, at, tsch_timer_cb,
+                               (void *)(uintptr_t) tsch_timer_gen);
+    return 0;
+}
+
+/* sets the timer for the next slot that can still be made */
+static void tsch_next_slot(void)
+{
+    do {
+        tsch_slot_start = ticks_add(tsch_slot_start, TSCH_SLOT_TICKS);
+        tsch_asn++;
+    } while (tsch_timer_set(TSCH_PHASE_SLOT, tsch_slot_start) < 0);
+}
+
+static void tsch_tx_done(tsch_tx_t *tx, int res)
+{
+    tx->res = res;
+    tx->queued = 0;
+    mutex_unlock(&tx->done);
+}
+
+static void tsch_desync(void)
+{
+    DEBUG("tsch: lost synchronization\n");
+
+    tsch_synced = 0;
+    tsch_join_prio = 0xff;
+    tsch_timer_gen++;
+    hwtimer_entry_remove(&tsch_timer);
+
+    for (int i = 0; i < TSCH_QUEUE_SIZE; i++) {
+        if (tsch_queue[i].queued) {
+            tsch_tx_done(&tsch_queue[i], -1);
+        }
+    }
+
+    tsch_radio_rx(TSCH_SCAN_CHANNEL);
+}
+
+static int tsch_has_dedicated(const net_if_eui64_t *neighbor)
+{
+    for (int i = 0; i < TSCH_CELLS_NUMOF; i++) {
+        tsch_cell_entry_t *c = &tsch_cells[i];
+
+        if (c->used && (c->cell.options & TSCH_CELL_TX) &&
+            (c->cell.neighbor.uint64 == neighbor->uint64)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* the oldest frame that may be sent in *cell* */
+static tsch_tx_t *tsch_queue_pick(const tsch_cell_t *cell)
+{
+    tsch_tx_t *res = NULL;
+
+    for (int i = 0; i < TSCH_QUEUE_SIZE; i++) {
+        tsch_tx_t *tx = &tsch_queue[i];
+        const sixlowpan_mac_frame_t *f = tx->frame;
+
+        if (!tx->queued) {
+            continue;
+        }
+
+        if (tsch_is_bcast(&cell->neighbor)) {
+            /* frames with a cell of their own wait for it */
+            if (!f->mcast && tsch_has_dedicated(&f->neighbor)) {
+                continue;
+            }
+        }
+        else if (f->mcast || (f->neighbor.uint64 != cell->neighbor.uint64)) {
+            continue;
+        }
+
+        if ((cell->options & TSCH_CELL_SHARED) && (tx->backoff > 0)) {
+            tx->backoff--;
+            continue;
+        }
+
+        if ((res == NULL) || ((int16_t)(tx->order - res->order) < 0)) {
+            res = tx;
+        }
+    }
+
+    return res;
+}
+
+static void tsch_slot(void)
+{
+    const tsch_cell_t *cell = NULL;
+    uint8_t tx = 0;
+
+    if (!tsch_coordinator && (tsch_asn - tsch_last_sync_asn > TSCH_DESYNC_SLOTS)) {
+        tsch_desync();
+        return;
+    }
+
+    tsch_cur_tx = NULL;
+    tsch_cur_beacon = 0;
+
+    /* the lowest handle with something to do in this slot wins */
+    for (uint8_t h = 0; (h < TSCH_SLOTFRAMES_NUMOF) && (cell == NULL); h++) {
+        const tsch_cell_t *rx = NULL;
+        uint16_t offset;
+
+        if (tsch_slotframes[h] == 0) {
+            continue;
+        }
+
+        offset = tsch_asn % tsch_slotframes[h];
+
+        for (int i = 0; i < TSCH_CELLS_NUMOF; i++) {
+            const tsch_cell_t *c = &tsch_cells[i].cell;
+
+            if (!tsch_cells[i].used || (tsch_cells[i].handle != h) ||
+                (c->slot_offset != offset)) {
+                continue;
+            }
+
+            if (c->options & TSCH_CELL_TX) {
+                if (tsch_is_bcast(&c->neighbor) && (tsch_asn >= tsch_beacon_asn)) {
+                    tsch_cur_beacon = 1;
+                }
+                else {
+                    tsch_cur_tx = tsch_queue_pick(c);
+                }
+
+                if (tsch_cur_beacon || (tsch_cur_tx != NULL)) {
+                    cell = c;
+                    tx = 1;
+                    break;
+                }
+            }
+
+            if ((c->options & TSCH_CELL_RX) && (rx == NULL)) {
+                rx = c;
+            }
+        }
+
+        if (cell == NULL) {
+            cell = rx;
+        }
+    }
+
+    if (cell == NULL) {
+        tsch_radio_off();
+        tsch_next_slot();
+        return;
+    }
+
+    uint8_t channel = tsch_hopping[(tsch_asn + cell->channel_offset) %
+                                   sizeof(tsch_hopping)];
+
+    if (tx) {
+        tsch_cur_shared = cell->options & TSCH_CELL_SHARED;
+        tsch_set_channel(channel);
+
+        if (tsch_timer_set(TSCH_PHASE_TX, ticks_add(tsch_slot_start,
+                           HWTIMER_TICKS(TSCH_TX_OFFSET))) == 0) {
+            return;
+        }
+    }
+    else {
+        tsch_radio_rx(channel);
+
+        if (tsch_timer_set(TSCH_PHASE_RX_END, ticks_add(tsch_slot_start,
+                           HWTIMER_TICKS(TSCH_TX_OFFSET + TSCH_RX_WAIT))) == 0) {
+            return;
+        }
+    }
+
+    /* too late for this slot */
+    tsch_radio_off();
+    tsch_next_slot();
+}
+
+/* sends in the current slot, releases tsch_mutex meanwhile */
+static void tsch_transmit(void)
+{
+    tsch_tx_t *tx = tsch_cur_tx;
+    int res;
+
+    radio_on = 1;
+
+    if (tsch_cur_beacon) {
+        uint8_t beacon[TSCH_BEACON_LEN];
+
+        beacon[0] = TSCH_BEACON_DISPATCH;
+
+        for (int i = 0; i < 5; i++) {
+            beacon[5 - i] = (uint8_t)(tsch_asn >> (8 * i));
+        }
+
+        beacon[6] = tsch_join_prio;
+        /* jitter keeps neighbors from beaconing in the same cell forever */
+        tsch_beacon_asn = tsch_asn + TSCH_BEACON_SLOTS / 2 +
+                          rand() % (TSCH_BEACON_SLOTS / 2 + 1);
+
+        mutex_unlock(&tsch_mutex);
+        sixlowpan_mac_send_control(tsch_if_id, NULL, beacon, sizeof(beacon));
+        mutex_lock(&tsch_mutex);
+        return;
+    }
+
+    mutex_unlock(&tsch_mutex);
+    res = sixlowpan_mac_transmit(tx->frame);
+    mutex_lock(&tsch_mutex);
+
+    tx->attempts++;
+
+    if ((res > 0) || tx->frame->mcast || (tx->attempts > TSCH_MAX_RETRIES)) {
+        tsch_tx_done(tx, res);
+        return;
+    }
+
+    DEBUG("tsch: no acknowledgement in slot %lu\n", (unsigned long) tsch_asn);
+
+    if (tsch_cur_shared) {
+        if (tx->be < TSCH_MAX_BE) {
+            tx->be++;
+        }
+
+        tx->backoff = rand() % (1 << tx->be);
+    }
+}
+
+static void tsch_timer_fired(void)
+{
+    switch (tsch_phase) {
+        case TSCH_PHASE_SLOT:
+            tsch_slot();
+            break;
+
+        case TSCH_PHASE_TX:
+            tsch_transmit();
+            tsch_radio_off();
+            tsch_next_slot();
+            break;
+
+        case TSCH_PHASE_RX_END:
+            tsch_radio_off();
+            tsch_next_slot();
+            break;
+    }
+}
+
+static int tsch_send(const sixlowpan_mac_frame_t *frame)
+{
+    tsch_tx_t *tx = NULL;
+    int res;
+
+    mutex_lock(&tsch_mutex);
+
+    for (int i = 0; (i < TSCH_QUEUE_SIZE) && tsch_synced; i++) {
+        if (!tsch_queue[i].used) {
+            tx = &tsch_queue[i];
+            break;
+        }
+    }
+
+    if (tx == NULL) {
+        mutex_unlock(&tsch_mutex);
+        DEBUG("tsch: not synchronized or queue full\n");
+        return -1;
+    }
+
+    tx->frame = frame;
+    tx->order = tsch_order++;
+    tx->attempts = 0;
+    tx->be = TSCH_MIN_BE;
+    tx->backoff = 0;
+    tx->used = 1;
+    tx->queued = 1;
+    mutex_init(&tx->done);
+    mutex_lock(&tx->done);
+    mutex_unlock(&tsch_mutex);
+
+    /* until the TSCH thread is done with it */
+    mutex_lock(&tx->done);
+
+    mutex_lock(&tsch_mutex);
+    res = tx->res;
+    tx->used = 0;
+    mutex_unlock(&tsch_mutex);
+
+    return res;
+}
+
+/* in the MAC receiver thread */
+static int tsch_receive(int if_id, const net_if_eui64_t *src,
+                        const net_if_eui64_t *dst, const uint8_t *payload,
+                        uint8_t length)
+{
+    unsigned long now = hwtimer_now();
+    uint64_t asn = 0;
+    uint8_t prio;
+
+    (void) if_id;
+    (void) dst;
+
+    if ((length != TSCH_BEACON_LEN) || (payload[0] != TSCH_BEACON_DISPATCH)) {
+        return 0;
+    }
+
+    for (int i = 1; i < 6; i++) {
+        asn = (asn << 8) | payload[i];
+    }
+
+    prio = (payload[6] < 0xff) ? payload[6] + 1 : 0xff;
+
+    mutex_lock(&tsch_mutex);
+
+    /* follow the time source, or a neighbor closer to the coordinator */
+    if (!tsch_coordinator &&
+        (!tsch_synced || (src->uint64 == tsch_time_source.uint64) ||
+         (prio < tsch_join_prio))) {
+        msg_t m;
+
+        DEBUG("tsch: synchronized to slot %lu\n", (unsigned long) asn);
+
+        if (!tsch_synced) {
+            tsch_beacon_asn = asn + TSCH_BEACON_SLOTS;
+        }
+
+        tsch_asn = asn;
+        tsch_slot_start = ticks_sub(now, HWTIMER_TICKS(TSCH_TX_OFFSET +
+                                                       TSCH_BEACON_DELAY));
+        tsch_last_sync_asn = asn;
+        tsch_time_source = *src;
+        tsch_join_prio = prio;
+        tsch_synced = 1;
+
+        m.type = TSCH_MSG_RESYNC;
+        msg_send(&m, tsch_pid, 0);
+    }
+
+    mutex_unlock(&tsch_mutex);
+    return 1;
+}
+
+static const sixlowpan_mac_engine_t tsch_engine = {
+    tsch_send,
+    tsch_receive,
+};
+
+static void tsch_process(void)
+{
+    msg_t m;
+
+    msg_init_queue(tsch_msg_queue, TSCH_MSG_QUEUE_SIZE);
+
+    mutex_lock(&tsch_mutex);
+
+    if (tsch_synced) {
+        tsch_next_slot();
+    }
+    else {
+        tsch_radio_rx(TSCH_SCAN_CHANNEL);
+    }
+
+    mutex_unlock(&tsch_mutex);
+
+    while (1) {
+        msg_receive(&m);
+        mutex_lock(&tsch_mutex);
+
+        if (m.type == TSCH_MSG_RESYNC) {
+            if (tsch_synced) {
+                tsch_radio_off();
+                tsch_next_slot();
+            }
+        }
+        else if ((m.type == TSCH_MSG_TIMER) && tsch_synced &&
+                 (m.content.value == tsch_timer_gen)) {
+            tsch_timer_fired();
+        }
+
+        mutex_unlock(&tsch_mutex);
+    }
+}
+
+int tsch_init(int if_id, int coordinator)
+{
+    net_if_t *iface = net_if_get_interface(if_id);
+    int i;
+
+    if (tsch_pid >= 0) {
+        return tsch_pid;
+    }
+
+    if (iface == NULL) {
+        return -1;
+    }
+
+    mutex_lock(&tsch_mutex);
+
+    for (i = 0; (i < TSCH_SLOTFRAMES_NUMOF) && (tsch_slotframes[i] == 0); i++);
+
+    if (i == TSCH_SLOTFRAMES_NUMOF) {
+        tsch_cell_entry_t *c = &tsch_cells[0];
+
+        /* the minimal schedule */
+        tsch_slotframes[0] = TSCH_MINIMAL_LENGTH;
+        c->handle = 0;
+        c->used = 1;
+        c->cell.slot_offset = 0;
+        c->cell.channel_offset = 0;
+        c->cell.options = TSCH_CELL_TX | TSCH_CELL_RX | TSCH_CELL_SHARED;
+        memset(&c->cell.neighbor, 0xff, sizeof(c->cell.neighbor));
+    }
+
+    tsch_if_id = if_id;
+    tsch_tcmd.transceivers = iface->transceivers;
+    tsch_tcmd.data = NULL;
+    /* unknown until set */
+    radio_channel = 0;
+    radio_on = 1;
+
+    tsch_coordinator = coordinator;
+    tsch_synced = coordinator;
+    tsch_join_prio = coordinator ? 0 : 0xff;
+    tsch_asn = 0;
+    tsch_beacon_asn = 0;
+    tsch_slot_start = hwtimer_now();
+
+    mutex_unlock(&tsch_mutex);
+
+    tsch_pid = thread_create(tsch_stack, TSCH_STACKSIZE, PRIORITY_MAIN - 3,
+                             CREATE_STACKTEST, tsch_process, "tsch");
+
+    if (tsch_pid < 0) {
+        return -1;
+    }
+
+    sixlowpan_mac_set_engine(&tsch_engine);
+    return tsch_pid;
+}
+
+int tsch_slotframe_add(uint8_t handle, uint16_t length)
+{
+    if ((handle >= TSCH_SLOTFRAMES_NUMOF) || (length == 0)) {
+        return -1;
+    }
+
+    mutex_lock(&tsch_mutex);
+    tsch_slotframes[handle] = length;
+
+    /* cells out of a shorter slotframe */
+    for (int i = 0; i < TSCH_CELLS_NUMOF; i++) {
+        if (tsch_cells[i].used && (tsch_cells[i].handle == handle) &&
+            (tsch_cells[i].cell.slot_offset >= length)) {
+            tsch_cells[i].used = 0;
+        }
+    }
+
+    mutex_unlock(&tsch_mutex);
+    return 0;
+}
+
+int tsch_slotframe_remove(uint8_t handle)
+{
+    if ((handle >= TSCH_SLOTFRAMES_NUMOF) || (tsch_slotframes[handle] == 0)) {
+        return -1;
+    }
+
+    mutex_lock(&tsch_mutex);
+    tsch_slotframes[handle] = 0;
+
+    for (int i = 0; i < TSCH_CELLS_NUMOF; i++) {
+        if (tsch_cells[i].handle == handle) {
+            tsch_cells[i].used = 0;
+        }
+    }
+
+    mutex_unlock(&tsch_mutex);
+    return 0;
+}
+
+int tsch_cell_add(uint8_t handle, const tsch_cell_t *cell)
+{
+    int res = -1;
+
+    if (handle >= TSCH_SLOTFRAMES_NUMOF) {
+        return -1;
+    }
+
+    mutex_lock(&tsch_mutex);
+
+    if (cell->slot_offset < tsch_slotframes[handle]) {
+        for (int i = 0; i < TSCH_CELLS_NUMOF; i++) {
+            if (!tsch_cells[i].used) {
+                tsch_cells[i].cell = *cell;
+                tsch_cells[i].handle = handle;
+                tsch_cells[i].used = 1;
+                res = 0;
+                break;
+            }
+        }
+    }
+
+    mutex_unlock(&tsch_mutex);
+    return res;
+}
+
+int tsch_cell_remove(uint8_t handle, uint16_t slot_offset,
+                     uint8_t channel_offset)
+{
+    int res = -1;
+
+    mutex_lock(&tsch_mutex);
+
+    for (int i = 0; i < TSCH_CELLS_NUMOF; i++) {
+        tsch_cell_entry_t *c = &tsch_cells[i];
+
+        if (c->used && (c->handle == handle) &&
+            (c->cell.slot_offset == slot_offset) &&
+            (c->cell.channel_offset == channel_offset)) {
+            c->used = 0;
+            res = 0;
+        }
+    }
+
+    mutex_unlock(&tsch_mutex);
+    return res;
+}
+
+int tsch_is_synced(void)
+{
+    return tsch_synced;
+}
+
+uint64_t tsch_get_asn(void)
+{
+    uint64_t res;
+
+    mutex_lock(&tsch_mutex);
+    res = tsch_asn;
+    mutex_unlock(&tsch_mutex);
+
+    return res;
+}
@@ -0,0 +1,347 @@
+/*
+ * MPL forwarder
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_mpl
+ * @{
+ * @file    mpl.c
+ * @brief   Proactive forwarding of MPL data messages
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "trickle.h"
+#include "vtimer.h"
+#include "net_help.h"
+#include "sixlowpan/ip.h"
+#include "sixlowpan/lowpan.h"
+
+#include "mpl.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define MPL_STACKSIZE       (KERNEL_CONF_STACKSIZE_MAIN)
+#define MPL_MSG_QUEUE_SIZE  (8)
+
+/* hop-by-hop header holding nothing but the MPL option and a PadN */
+#define MPL_HBH_LEN         (8)
+#define MPL_OPT_LEN         (2)
+/* seed ID length in the first option octet, 0: the source address */
+#define MPL_OPT_S_MASK      (0xc0)
+#define IPV6_OPT_PAD1       (0)
+#define IPV6_OPT_PADN       (1)
+
+typedef struct {
+    uint8_t used;
+    uint8_t expirations;        /* trickle intervals left, 0 once done */
+    uint8_t seq;
+    uint16_t len;
+    trickle_t trickle;
+    uint8_t packet[IPV6_MTU];   /* starts with the IPv6 header */
+} mpl_msg_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t min_seq;            /* older messages are not accepted */
+    ipv6_addr_t addr;
+} mpl_seed_t;
+
+static char mpl_stack[MPL_STACKSIZE];
+static msg_t mpl_msg_queue[MPL_MSG_QUEUE_SIZE];
+static int mpl_pid = -1;
+static mutex_t mpl_mutex;
+
+static mpl_msg_t mpl_buffer[MPL_BUFFER_NUMOF];
+static mpl_seed_t mpl_seeds[MPL_SEED_NUMOF];
+static uint8_t mpl_seed_next = 0;
+static uint8_t mpl_seq = 0;
+/* sixlowpan_lowpan_sendto() may prepend a dispatch octet */
+static uint8_t mpl_tx[IPV6_MTU + 1];
+
+/* sequence numbers are compared in serial number arithmetic */
+static int seq_older(uint8_t a, uint8_t b)
+{
+    return (int8_t)(a - b) < 0;
+}
+
+static mpl_seed_t *seed_get(const ipv6_addr_t *addr)
+{
+    mpl_seed_t *seed;
+
+    for (uint8_t i = 0; i < MPL_SEED_NUMOF; i++) {
+        if (mpl_seeds[i].used && ipv6_addr_is_equal(&mpl_seeds[i].addr, addr)) {
+            return &mpl_seeds[i];
+        }
+    }
+
+    seed = &mpl_seeds[mpl_seed_next];
+    mpl_seed_next = (mpl_seed_next + 1) % MPL_SEED_NUMOF;
+
+    seed->used = 1;
+    memcpy(&seed->addr, addr, sizeof(ipv6_addr_t));
+    /* accept anything until a message of this seed is dropped */
+    seed->min_seq = 0;
+    return seed;
+}
+
+static mpl_msg_t *msg_find(const ipv6_addr_t *seed, uint8_t seq)
+{
+    for (uint8_t i = 0; i < MPL_BUFFER_NUMOF; i++) {
+        ipv6_hdr_t *hdr = (ipv6_hdr_t *) mpl_buffer[i].packet;
+
+        if (mpl_buffer[i].used && (mpl_buffer[i].seq == seq) &&
+            ipv6_addr_is_equal(&hdr->srcaddr, seed)) {
+            return &mpl_buffer[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* a free buffer, reuses one whose trickle is done */
+static mpl_msg_t *msg_alloc(void)
+{
+    mpl_msg_t *done = NULL;
+
+    for (uint8_t i = 0; i < MPL_BUFFER_NUMOF; i++) {
+        if (!mpl_buffer[i].used) {
+            return &mpl_buffer[i];
+        }
+
+        if ((mpl_buffer[i].expirations == 0) && (done == NULL)) {
+            done = &mpl_buffer[i];
+        }
+    }
+
+    if (done != NULL) {
+        /* forgetting the message means refusing it and all before it */
+        mpl_seed_t *seed = seed_get(&((ipv6_hdr_t *) done->packet)->srcaddr);
+
+        if (!seq_older(done->seq, seed->min_seq)) {
+            seed->min_seq = done->seq + 1;
+        }
+
+        done->used = 0;
+    }
+
+    return done;
+}
+
+static void mpl_transmit_cb(void *arg);
+
+static void msg_start(mpl_msg_t *m, uint8_t seq, uint16_t len)
+{
+    m->used = 1;
+    m->seq = seq;
+    m->len = len;
+    m->expirations = MPL_DATA_EXPIRATIONS;
+    trickle_start(&m->trickle, mpl_pid, mpl_transmit_cb, m,
+                  MPL_DATA_IMIN, MPL_DATA_IMAX, MPL_DATA_K);
+}
+
+/* trickle callback, in the MPL thread with mpl_mutex held */
+static void mpl_transmit_cb(void *arg)
+{
+    mpl_msg_t *m = arg;
+    uint16_t bcast = 0xffff;
+
+    DEBUG("mpl: sending message %u\n", m->seq);
+
+    memcpy(mpl_tx, m->packet, m->len);
+    sixlowpan_lowpan_sendto(0, &bcast, 2, mpl_tx, m->len);
+}
+
+/* the MPL option of a hop-by-hop header, NULL if there is none */
+static uint8_t *mpl_opt_find(uint8_t *hbh, uint16_t len)
+{
+    uint16_t i = 2;
+
+    while (i < len) {
+        if (hbh[i] == IPV6_OPT_PAD1) {
+            i++;
+            continue;
+        }
+
+        if ((i + 2 > len) || (i + 2 + hbh[i + 1] > len)) {
+            return NULL;
+        }
+
+        if ((hbh[i] == MPL_OPT_TYPE) && (hbh[i + 1] >= MPL_OPT_LEN)) {
+            return &hbh[i];
+        }
+
+        i += 2 + hbh[i + 1];
+    }
+
+    return NULL;
+}
+
+/* called by the IP layer for multicast packets with a hop-by-hop header */
+static int mpl_receive(ipv6_hdr_t *packet)
+{
+    uint8_t *hbh = (uint8_t *)(packet + 1);
+    uint16_t payload_len = NTOHS(packet->length);
+    uint16_t hbh_len = (hbh[1] + 1) * 8;
+    uint16_t len = sizeof(ipv6_hdr_t) + payload_len;
+    uint8_t *opt;
+    mpl_seed_t *seed;
+    mpl_msg_t *m;
+    uint8_t seq;
+
+    if ((hbh_len > payload_len) || (len > IPV6_MTU) ||
+        ((opt = mpl_opt_find(hbh, hbh_len)) == NULL) ||
+        (opt[2] & MPL_OPT_S_MASK)) {
+        /* no MPL message or a seed ID we do not know */
+        return 0;
+    }
+
+    seq = opt[3];
+
+    mutex_lock(&mpl_mutex);
+
+    seed = seed_get(&packet->srcaddr);
+    m = msg_find(&packet->srcaddr, seq);
+
+    if ((m != NULL) || seq_older(seq, seed->min_seq)) {
+        /* heard again, a consistent transmission */
+        if (m != NULL) {
+            trickle_increment_counter(&m->trickle);
+        }
+
+        mutex_unlock(&mpl_mutex);
+        return -1;
+    }
+
+    if ((packet->hoplimit > 1) && ((m = msg_alloc()) != NULL)) {
+        memcpy(m->packet, packet, len);
+        ((ipv6_hdr_t *) m->packet)->hoplimit--;
+        msg_start(m, seq, len);
+    }
+
+    mutex_unlock(&mpl_mutex);
+
+    /* deliver the payload as if the header had never been there */
+    packet->nextheader = hbh[0];
+    packet->length = HTONS(payload_len - hbh_len);
+    memmove(hbh, hbh + hbh_len, payload_len - hbh_len);
+    return 0;
+}
+
+static void mpl_process(void)
+{
+    msg_t m;
+
+    msg_init_queue(mpl_msg_queue, MPL_MSG_QUEUE_SIZE);
+
+    while (1) {
+        msg_receive(&m);
+
+        if (m.type != MSG_TIMER) {
+            continue;
+        }
+
+        mutex_lock(&mpl_mutex);
+
+        for (uint8_t i = 0; i < MPL_BUFFER_NUMOF; i++) {
+            mpl_msg_t *msg = &mpl_buffer[i];
+
+            if ((char *) &msg->trickle == m.content.ptr) {
+                /* the timer ends the interval if t is over */
+                int ending = msg->trickle.t_over;
+
+                trickle_fire(&msg->trickle);
+
+                if (ending && msg->expirations && (--msg->expirations == 0)) {
+                    trickle_stop(&msg->trickle);
+                }
+
+                break;
+            }
+        }
+
+        mutex_unlock(&mpl_mutex);
+    }
+}
+
+int mpl_init(void)
+{
+    ipv6_addr_t all_forwarders;
+
+    if (mpl_pid >= 0) {
+        return mpl_pid;
+    }
+
+    mutex_init(&mpl_mutex);
+    mpl_pid = thread_create(mpl_stack, MPL_STACKSIZE, PRIORITY_MAIN - 1,
+                            CREATE_STACKTEST, mpl_process, "mpl");
+
+    if (mpl_pid < 0) {
+        return -1;
+    }
+
+    /* ff03::fc */
+    ipv6_addr_init(&all_forwarders, 0xff03, 0, 0, 0, 0, 0, 0, 0x00fc);
+    ipv6_mcast_join(&all_forwarders);
+    ipv6_iface_set_mcast_forwarder(mpl_receive);
+
+    return mpl_pid;
+}
+
+int mpl_send(const ipv6_addr_t *group, uint8_t next_header,
+             const uint8_t *payload, uint16_t len)
+{
+    ipv6_hdr_t *hdr;
+    uint8_t *hbh;
+    mpl_msg_t *m;
+
+    if ((mpl_pid < 0) || (sizeof(ipv6_hdr_t) + MPL_HBH_LEN + len > IPV6_MTU)) {
+        return -1;
+    }
+
+    mutex_lock(&mpl_mutex);
+
+    if ((m = msg_alloc()) == NULL) {
+        mutex_unlock(&mpl_mutex);
+        return -1;
+    }
+
+    hdr = (ipv6_hdr_t *) m->packet;
+    hdr->version_trafficclass = 0x60; /* version 6 */
+    hdr->trafficclass_flowlabel = 0;
+    hdr->flowlabel = 0;
+    hdr->length = HTONS(MPL_HBH_LEN + len);
+    hdr->nextheader = IPV6_PROTO_NUM_HOP_BY_HOP;
+    hdr->hoplimit = ipv6_get_default_hop_limit();
+    memcpy(&hdr->destaddr, group, sizeof(ipv6_addr_t));
+    ipv6_net_if_get_best_src_addr(&hdr->srcaddr, group);
+
+    hbh = (uint8_t *)(hdr + 1);
+    hbh[0] = next_header;
+    hbh[1] = 0;
+    hbh[2] = MPL_OPT_TYPE;
+    hbh[3] = MPL_OPT_LEN;
+    hbh[4] = 0;
+    hbh[5] = mpl_seq;
+    hbh[6] = IPV6_OPT_PADN;
+    hbh[7] = 0;
+    memcpy(hbh + MPL_HBH_LEN, payload, len);
+
+    /* our own messages are never refused */
+    seed_get(&hdr->srcaddr);
+    msg_start(m, mpl_seq++, sizeof(ipv6_hdr_t) + MPL_HBH_LEN + len);
+
+    mutex_unlock(&mpl_mutex);
+    return len;
+}
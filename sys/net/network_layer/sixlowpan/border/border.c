@@ -29,8 +29,10 @@
 
 #include "ieee802154_frame.h"
 #include "sixlowpan/error.h"
+#include "destiny/types.h"
 #include "bordermultiplex.h"
 #include "flowcontrol.h"
+#include "pktbuf.h"
 #include "border.h"
 #include "ip.h"
 #include "icmp.h"
@@ -43,8 +45,8 @@
 
 #define READER_STACK_SIZE   (KERNEL_CONF_STACKSIZE_DEFAULT)
 
-char serial_reader_stack[READER_STACK_SIZE];
-uint16_t serial_reader_pid;
+char serial_reader_stack[BORDER_UPLINKS][READER_STACK_SIZE];
+int serial_reader_pid[BORDER_UPLINKS];
 
 uint8_t serial_out_buf[BORDER_BUFFER_SIZE];
 uint8_t serial_in_buf[BORDER_BUFFER_SIZE];
@@ -69,26 +71,32 @@ uint8_t *get_serial_in_buffer(int offset)
     return &(serial_in_buf[offset]);
 }
 
-uint16_t border_get_serial_reader()
+uint16_t border_get_serial_reader(uint8_t uplink)
 {
-    return serial_reader_pid;
+    return serial_reader_pid[uplink];
 }
 
 void serial_reader_f(void)
 {
-    int main_pid = 0;
     int bytes;
     msg_t m;
     border_packet_t *uart_buf;
+    uint8_t *in_buf;
+    uint8_t uplink;
 
-    posix_open(uart0_handler_pid, 0);
-
+    /* told by sixlowpan_lowpan_border_init() */
     msg_receive(&m);
-    main_pid = m.sender_pid;
+    uplink = m.content.value;
 
     while (1) {
-        posix_open(uart0_handler_pid, 0);
-        bytes = readpacket(get_serial_in_buffer(0), BORDER_BUFFER_SIZE);
+        if (uplink == 0) {
+            /* UART0 is the default transport of the first uplink */
+            posix_open(uart0_handler_pid, 0);
+        }
+
+        /* read into the receive window directly, no copy on delivery */
+        in_buf = flowcontrol_get_recv_buffer(uplink);
+        bytes = readpacket(uplink, in_buf, BORDER_BUFFER_SIZE);
 
         if (bytes < 0) {
             switch (bytes) {
@@ -106,20 +114,20 @@ void serial_reader_f(void)
             continue;
         }
 
-        uart_buf = (border_packet_t *)get_serial_in_buffer(0);
+        uart_buf = (border_packet_t *)in_buf;
 
         if (uart_buf->empty == 0) {
             if (uart_buf->type == BORDER_PACKET_CONF_TYPE) {
                 border_conf_header_t *conf_packet = (border_conf_header_t *)uart_buf;
 
                 if (conf_packet->conftype == BORDER_CONF_SYN) {
-                    m.content.ptr = (char *)conf_packet;
-                    msg_send(&m, main_pid, 1);
+                    flowcontrol_handshake(uplink,
+                                          (border_syn_packet_t *)conf_packet);
                     continue;
                 }
             }
 
-            flowcontrol_deliver_from_uart(uart_buf, bytes);
+            flowcontrol_deliver_from_uart(uplink, uart_buf, bytes);
         }
     }
 }
@@ -129,10 +137,30 @@ int sixlowpan_lowpan_border_init(int if_id)
     ipv6_net_if_addr_t *addr = NULL;
     uint8_t abr_addr_initialized = 0;
 
-    serial_reader_pid = thread_create(
-                            serial_reader_stack, READER_STACK_SIZE,
-                            PRIORITY_MAIN - 1, CREATE_STACKTEST,
-                            serial_reader_f, "serial_reader");
+    flowcontrol_init();
+
+    for (uint8_t uplink = 0; uplink < BORDER_UPLINKS; uplink++) {
+        msg_t m;
+
+        if (!border_uplink_configured(uplink)) {
+            serial_reader_pid[uplink] = -1;
+            continue;
+        }
+
+        serial_reader_pid[uplink] = thread_create(
+                                        serial_reader_stack[uplink],
+                                        READER_STACK_SIZE,
+                                        PRIORITY_MAIN - 1, CREATE_STACKTEST,
+                                        serial_reader_f, "serial_reader");
+
+        if (serial_reader_pid[uplink] < 0) {
+            return 0;
+        }
+
+        m.content.value = uplink;
+        msg_send(&m, serial_reader_pid[uplink], 1);
+    }
+
     ip_process_pid = thread_create(ip_process_buf, IP_PROCESS_STACKSIZE,
                                    PRIORITY_MAIN - 1, CREATE_STACKTEST,
                                    border_process_lowpan,
@@ -171,27 +199,47 @@ int sixlowpan_lowpan_border_init(int if_id)
 void border_process_lowpan(void)
 {
     msg_t m;
+    pktbuf_t *pkt;
     ipv6_hdr_t *ipv6_buf;
 
     while (1) {
         msg_receive(&m);
-        ipv6_buf = (ipv6_hdr_t *)m.content.ptr;
+        pkt = (pktbuf_t *) m.content.ptr;
+        ipv6_buf = (ipv6_hdr_t *) pkt->data;
 
         if (ipv6_buf->nextheader == IPV6_PROTO_NUM_ICMPV6) {
-            icmpv6_hdr_t *icmp_buf = (icmpv6_hdr_t *)(((uint8_t *)ipv6_buf) + IPV6_HDR_LEN);
+            icmpv6_hdr_t *icmp_buf;
 
-            if (icmp_buf->type == ICMPV6_TYPE_REDIRECT) {
-                continue;
-            }
+            /* ICMPv6 and NDP work on the IPv6 buffer */
+            memcpy(ipv6_get_buf(), pkt->data, pkt->len);
+            icmp_buf = get_icmpv6_buf(0);
 
-            if (icmpv6_demultiplex(icmp_buf) == 0) {
+            if ((icmp_buf->type == ICMPV6_TYPE_REDIRECT) ||
+                (icmpv6_demultiplex(icmp_buf) == 0)) {
+                /* the lowpan thread waits until its buffer is free again */
+                msg_reply(&m, &m);
                 continue;
             }
 
             /* Here, other ICMPv6 message types for ND may follow. */
         }
 
+        if (ipv6_buf->nextheader == IPV6_PROTO_NUM_UDP) {
+            udp_hdr_t *udp_buf = (udp_hdr_t *)(((uint8_t *)ipv6_buf) + IPV6_HDR_LEN);
+
+            /* elided within the 6LoWPAN, hosts behind us need it */
+            if (udp_buf->checksum == 0) {
+                uint16_t sum = ~ipv6_csum(ipv6_buf, (uint8_t *) udp_buf,
+                                          NTOHS(udp_buf->length),
+                                          IPV6_PROTO_NUM_UDP);
+
+                udp_buf->checksum = (sum == 0) ? 0xffff : sum;
+            }
+        }
+
         /* TODO: Bei ICMPv6-Paketen entsprechende LoWPAN-Optionen verarbeiten und entfernen */
         multiplex_send_ipv6_over_uart(ipv6_buf);
+        /* copied into the sending window, release the buffer */
+        msg_reply(&m, &m);
     }
 }
@@ -31,7 +31,7 @@
 
 extern ipv6_addr_t *abr_addr;
 
-uint16_t border_get_serial_reader(void);
+uint16_t border_get_serial_reader(uint8_t uplink);
 
 uint8_t *get_serial_out_buffer(int offset);
 uint8_t *get_serial_in_buffer(int offset);
@@ -102,46 +102,191 @@ void demultiplex(border_packet_t *packet)
     }
 }
 
+/* established uplinks if there are any, the first one before the daemons
+ * shook hands */
+static uint8_t multiplex_get_uplinks(uint8_t *uplinks)
+{
+    uint8_t num = 0;
+
+    for (uint8_t i = 0; i < BORDER_UPLINKS; i++) {
+        if (flowcontrol_established(i)) {
+            uplinks[num++] = i;
+        }
+    }
+
+    if (num == 0) {
+        uplinks[num++] = 0;
+    }
+
+    return num;
+}
+
+static uint8_t multiplex_select_uplink(ipv6_hdr_t *packet)
+{
+    uint8_t uplinks[BORDER_UPLINKS];
+    uint8_t num = multiplex_get_uplinks(uplinks);
+    uint32_t h;
+
+    if (num == 1) {
+        return uplinks[0];
+    }
+
+    h = ((uint32_t)(packet->trafficclass_flowlabel & 0x0f) << 16) ^
+        packet->flowlabel ^ packet->nextheader;
+
+    for (int i = 0; i < 16; i++) {
+        h = (h * 31) + (packet->srcaddr.uint8[i] ^ packet->destaddr.uint8[i]);
+    }
+
+    if ((packet->nextheader == IPV6_PROTO_NUM_UDP) ||
+        (packet->nextheader == IPV6_PROTO_NUM_TCP)) {
+        /* both carry the ports in the first four bytes */
+        uint8_t *ports = ((uint8_t *)packet) + IPV6_HDR_LEN;
+
+        for (int i = 0; i < 4; i++) {
+            h = (h * 31) + ports[i];
+        }
+    }
+
+    h ^= h >> 16;
+    return uplinks[h % num];
+}
+
 void multiplex_send_ipv6_over_uart(ipv6_hdr_t *packet)
 {
     border_l3_header_t *serial_buf;
+    uint16_t len = IPV6_HDR_LEN + NTOHS(packet->length);
+    uint8_t uplink;
+
+    if (sizeof(border_l3_header_t) + len > BORDER_BUFFER_SIZE) {
+        printf("ERROR: IPv6 packet too big for UART\n");
+        return;
+    }
+
+    uplink = multiplex_select_uplink(packet);
 
-    serial_buf = (border_l3_header_t *)get_serial_out_buffer(0);
+    /* build the frame right in its slot of the sending window */
+    serial_buf = (border_l3_header_t *)flowcontrol_get_send_buffer(uplink);
     serial_buf->empty = 0;
     serial_buf->type = BORDER_PACKET_L3_TYPE;
     serial_buf->ethertype = BORDER_ETHERTYPE_IPV6;
-    memcpy(get_serial_in_buffer(0) + sizeof(border_l3_header_t), packet, IPV6_HDR_LEN + packet->length);
+    memcpy(((uint8_t *)serial_buf) + sizeof(border_l3_header_t), packet, len);
 
-    flowcontrol_send_over_uart((border_packet_t *) serial_buf, sizeof(border_l3_header_t));
+    flowcontrol_send_buffer(uplink, (border_packet_t *) serial_buf,
+                            sizeof(border_l3_header_t) + len);
 }
 
 void multiplex_send_addr_over_uart(ipv6_addr_t *addr)
 {
-    border_addr_packet_t *serial_buf;
+    uint8_t uplinks[BORDER_UPLINKS];
+    uint8_t num = multiplex_get_uplinks(uplinks);
 
-    serial_buf = (border_addr_packet_t *)get_serial_in_buffer(0);
-    serial_buf->empty = 0;
-    serial_buf->type = BORDER_PACKET_CONF_TYPE;
-    serial_buf->conftype = BORDER_CONF_IPADDR;
-    memcpy(&serial_buf->addr, addr, sizeof(ipv6_addr_t));
+    for (uint8_t i = 0; i < num; i++) {
+        border_addr_packet_t *serial_buf;
+
+        serial_buf = (border_addr_packet_t *)flowcontrol_get_send_buffer(uplinks[i]);
+        serial_buf->empty = 0;
+        serial_buf->type = BORDER_PACKET_CONF_TYPE;
+        serial_buf->conftype = BORDER_CONF_IPADDR;
+        memcpy(&serial_buf->addr, addr, sizeof(ipv6_addr_t));
+
+        flowcontrol_send_buffer(uplinks[i], (border_packet_t *) serial_buf,
+                                sizeof(border_addr_packet_t));
+    }
+}
+
+static int uart0_transport_read(uint8_t *buf, size_t size)
+{
+    (void) size;
+
+    *buf = uart0_readc();
+    return 1;
+}
+
+static int uart0_transport_write(const uint8_t *buf, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        uart0_putc(buf[i]);
+    }
+
+    return size;
+}
+
+static const border_transport_t uart0_transport = {
+    uart0_transport_read,
+    uart0_transport_write,
+    BORDER_DEFAULT_FRAMING
+};
+
+typedef struct {
+    const border_transport_t *transport;
+    /* only the serial reader of the uplink reads */
+    uint8_t rx_chunk[BORDER_RX_CHUNK_SIZE];
+    size_t rx_pos, rx_len;
+    /* writes are serialized by the flowcontrol */
+    uint8_t tx_batch[BORDER_TX_BATCH_SIZE];
+    size_t tx_len;
+} border_link_t;
+
+static border_link_t links[BORDER_UPLINKS] = {
+    { .transport = &uart0_transport }
+};
+
+void border_set_uplink_transport(uint8_t uplink,
+                                 const border_transport_t *transport)
+{
+    border_link_t *link = &links[uplink];
+
+    if ((transport == NULL) && (uplink == 0)) {
+        transport = &uart0_transport;
+    }
+
+    link->transport = transport;
+    link->rx_pos = link->rx_len = 0;
+    link->tx_len = 0;
+}
+
+void border_set_transport(const border_transport_t *transport)
+{
+    border_set_uplink_transport(0, transport);
+}
+
+int border_uplink_configured(uint8_t uplink)
+{
+    return (uplink < BORDER_UPLINKS) && (links[uplink].transport != NULL);
+}
+
+static uint8_t transport_readc(border_link_t *link)
+{
+    while (link->rx_pos == link->rx_len) {
+        int bytes = link->transport->read(link->rx_chunk,
+                                          sizeof(link->rx_chunk));
+
+        if (bytes > 0) {
+            link->rx_pos = 0;
+            link->rx_len = bytes;
+        }
+    }
 
-    flowcontrol_send_over_uart((border_packet_t *) serial_buf, sizeof(border_addr_packet_t));
+    return link->rx_chunk[link->rx_pos++];
 }
 
-int readpacket(uint8_t *packet_buf, size_t size)
+/* SLIP decoding happens in place in packet_buf */
+static int readpacket_slip(border_link_t *link, uint8_t *packet_buf,
+                           size_t size)
 {
     uint8_t *line_buf_ptr = packet_buf;
-    uint8_t byte = END + 1;
+    uint8_t byte;
     uint8_t esc = 0;
 
     while (1) {
-        byte = uart0_readc();
+        byte = transport_readc(link);
 
         if (byte == END) {
             break;
         }
 
-        if ((size_t)(line_buf_ptr - packet_buf) >= size - 1) {
+        if ((size_t)(line_buf_ptr - packet_buf) >= size) {
             return -SIXLOWERROR_ARRAYFULL;
         }
 
@@ -172,41 +317,120 @@ int readpacket(uint8_t *packet_buf, size_t size)
         *line_buf_ptr++ = byte;
     }
 
-    return (line_buf_ptr - packet_buf - 1);
+    return (line_buf_ptr - packet_buf);
+}
+
+static int readpacket_binary(border_link_t *link, uint8_t *packet_buf,
+                             size_t size)
+{
+    size_t len;
+
+    /* resynchronize on anything that is not a frame start */
+    while (transport_readc(link) != BORDER_BINARY_MAGIC);
+
+    len = transport_readc(link) << 8;
+    len |= transport_readc(link);
+
+    if (len > size) {
+        while (len--) {
+            transport_readc(link);
+        }
+
+        return -SIXLOWERROR_ARRAYFULL;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        packet_buf[i] = transport_readc(link);
+    }
+
+    return len;
+}
+
+int readpacket_pending(uint8_t uplink)
+{
+    return (links[uplink].rx_pos < links[uplink].rx_len);
+}
+
+int readpacket(uint8_t uplink, uint8_t *packet_buf, size_t size)
+{
+    border_link_t *link = &links[uplink];
+
+    if (link->transport->framing == BORDER_FRAMING_BINARY) {
+        return readpacket_binary(link, packet_buf, size);
+    }
+
+    return readpacket_slip(link, packet_buf, size);
 }
 
-int writepacket(uint8_t *packet_buf, size_t size)
+void flushpackets(uint8_t uplink)
 {
-    uint8_t *byte_ptr = packet_buf;
+    border_link_t *link = &links[uplink];
+
+    if (link->tx_len > 0) {
+        link->transport->write(link->tx_batch, link->tx_len);
+        link->tx_len = 0;
+    }
+}
 
-    while ((size_t)(byte_ptr - packet_buf) < size) {
-        if ((size_t)(byte_ptr - packet_buf) > BORDER_BUFFER_SIZE) {
-            return -1;
+/*
+ * The frame is encoded behind the frames queued before, packet_buf stays
+ * untouched so that it can be retransmitted. The flowcontrol serializes the
+ * callers.
+ */
+int writepacket(uint8_t uplink, uint8_t *packet_buf, size_t size)
+{
+    border_link_t *link = &links[uplink];
+    uint8_t *out;
+
+    if (size > BORDER_BUFFER_SIZE) {
+        return -1;
+    }
+
+    if (link->transport->framing == BORDER_FRAMING_BINARY) {
+        if (link->tx_len + BORDER_BINARY_HDR_LEN + size > sizeof(link->tx_batch)) {
+            flushpackets(uplink);
         }
 
-        switch (*byte_ptr) {
+        out = &link->tx_batch[link->tx_len];
+        *out++ = BORDER_BINARY_MAGIC;
+        *out++ = (uint8_t)(size >> 8);
+        *out++ = (uint8_t) size;
+        memcpy(out, packet_buf, size);
+        link->tx_len += BORDER_BINARY_HDR_LEN + size;
+
+        return size;
+    }
+
+    /* worst case every byte is escaped */
+    if (link->tx_len + 2 * size + 1 > sizeof(link->tx_batch)) {
+        flushpackets(uplink);
+    }
+
+    out = &link->tx_batch[link->tx_len];
+
+    for (size_t i = 0; i < size; i++) {
+        switch (packet_buf[i]) {
             case (END): {
-                *byte_ptr = END_ESC;
-                uart0_putc(ESC);
+                *out++ = ESC;
+                *out++ = END_ESC;
                 break;
             }
 
             case (ESC): {
-                *byte_ptr = ESC_ESC;
-                uart0_putc(ESC);
+                *out++ = ESC;
+                *out++ = ESC_ESC;
                 break;
             }
 
             default: {
+                *out++ = packet_buf[i];
                 break;
             }
         }
-
-        uart0_putc(*byte_ptr);
-        byte_ptr++;
     }
 
-    uart0_putc(END);
+    *out++ = END;
+    link->tx_len = out - link->tx_batch;
 
-    return (byte_ptr - packet_buf);
+    return size;
 }
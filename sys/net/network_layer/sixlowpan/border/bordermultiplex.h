@@ -82,11 +82,128 @@ typedef struct __attribute__((packed)) {
 
 #define BORDER_BUFFER_SIZE (sizeof(border_l3_header_t) + IPV6_MTU)
 
+/**
+ * @brief   Framing of the packets on the tunnel to the border router daemon.
+ */
+typedef enum {
+    BORDER_FRAMING_SLIP = 0,    ///< SLIP (RFC 1055), for plain serial lines
+    BORDER_FRAMING_BINARY,      ///< magic byte and 16 bit length in network
+                                ///< byte order, for reliable byte streams
+} border_framing_t;
+
+#ifndef BORDER_DEFAULT_FRAMING
+#ifdef BORDER_BINARY_FRAMING
+#define BORDER_DEFAULT_FRAMING  (BORDER_FRAMING_BINARY)
+#else
+#define BORDER_DEFAULT_FRAMING  (BORDER_FRAMING_SLIP)
+#endif
+#endif
+
+/* first byte of every binary frame */
+#define BORDER_BINARY_MAGIC     (0xA5)
+#define BORDER_BINARY_HDR_LEN   (3)
+
+/**
+ * @brief   Size of the buffer frames are collected in before they are handed
+ *          to the transport in one transfer. Holds at least one SLIP encoded
+ *          frame of maximum size.
+ */
+#ifndef BORDER_TX_BATCH_SIZE
+#define BORDER_TX_BATCH_SIZE    (2 * BORDER_BUFFER_SIZE + 1)
+#endif
+
+/**
+ * @brief   Size of the chunks read from the transport.
+ */
+#ifndef BORDER_RX_CHUNK_SIZE
+#define BORDER_RX_CHUNK_SIZE    (64)
+#endif
+
+/**
+ * @brief   Number of tunnels to border router daemons. Each uplink has its
+ *          own transport and sliding window, packets leaving the 6LoWPAN
+ *          are spread over the established ones by flow.
+ */
+#ifndef BORDER_UPLINKS
+#define BORDER_UPLINKS          (1)
+#endif
+
+/**
+ * @brief   Byte stream the border router tunnel runs on.
+ */
+typedef struct {
+    /**
+     * @brief   Reads at most *size* bytes into *buf*, blocks until at least
+     *          one byte is available.
+     * @return  Number of bytes read, <= 0 on error.
+     */
+    int (*read)(uint8_t *buf, size_t size);
+    /**
+     * @brief   Writes *size* bytes from *buf* in one transfer.
+     * @return  Number of bytes written, < 0 on error.
+     */
+    int (*write)(const uint8_t *buf, size_t size);
+    border_framing_t framing;   ///< framing of the packets on this stream
+} border_transport_t;
+
+/**
+ * @brief   Replaces the transport of the first uplink, UART0 with
+ *          BORDER_DEFAULT_FRAMING is used if this is never called. Must be
+ *          called before sixlowpan_lowpan_border_init().
+ *
+ * @param[in] transport The transport, NULL for UART0. Must stay valid.
+ */
+void border_set_transport(const border_transport_t *transport);
+
+/**
+ * @brief   Sets the transport of an uplink. Uplinks other than the first
+ *          have none by default and are not used. Must be called before
+ *          sixlowpan_lowpan_border_init().
+ *
+ * @param[in] uplink    The uplink, less than BORDER_UPLINKS.
+ * @param[in] transport The transport, NULL for UART0 on the first uplink
+ *                      and for none on the others. Must stay valid.
+ */
+void border_set_uplink_transport(uint8_t uplink,
+                                 const border_transport_t *transport);
+
+/**
+ * @brief   Returns 1 if *uplink* has a transport, 0 otherwise.
+ */
+int border_uplink_configured(uint8_t uplink);
+
 void demultiplex(border_packet_t *packet);
+
+/**
+ * @brief   Sends a packet to the border router daemons. All packets of a
+ *          flow, i.e. of the same addresses, flow label, protocol and
+ *          ports, take the same established uplink.
+ */
 void multiplex_send_ipv6_over_uart(ipv6_hdr_t *packet);
+
+/**
+ * @brief   Sends an address to the daemons of all established uplinks.
+ */
 void multiplex_send_addr_over_uart(ipv6_addr_t *addr);
 
-int readpacket(uint8_t *packet_buf, size_t size);
-int writepacket(uint8_t *packet_buf, size_t size);
+int readpacket(uint8_t uplink, uint8_t *packet_buf, size_t size);
+
+/**
+ * @brief   Returns 1 if the transport of *uplink* already delivered bytes
+ *          that readpacket() has not consumed yet, 0 otherwise.
+ */
+int readpacket_pending(uint8_t uplink);
+
+/**
+ * @brief   Queues a frame for the transport of *uplink*, it is sent on the
+ *          next flushpackets() or when the queue runs full.
+ */
+int writepacket(uint8_t uplink, uint8_t *packet_buf, size_t size);
+
+/**
+ * @brief   Hands all frames queued for *uplink* to its transport in one
+ *          transfer.
+ */
+void flushpackets(uint8_t uplink);
 
 #endif /* _SIXLOWPAN_BORDERMULTIPLEX_H*/
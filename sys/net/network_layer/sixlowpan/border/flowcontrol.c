@@ -23,180 +23,324 @@
 
 #include "vtimer.h"
 #include "thread.h"
+#include "mutex.h"
 #include "semaphore.h"
 #include "bordermultiplex.h"
 #include "flowcontrol.h"
 
 
-static int set_timeout(vtimer_t *timeout, timex_t val, void *args);
+static void set_timeout(flowcontrol_stat_t *stat);
 static void sending_slot(void);
 
 char sending_slot_stack[SENDING_SLOT_STACK_SIZE];
 unsigned int sending_slot_pid;
 
-flowcontrol_stat_t slwin_stat;
-sem_t connection_established;
-int16_t synack_seqnum = -1;
+flowcontrol_stat_t slwin_stat[BORDER_UPLINKS];
 
-ipv6_addr_t init_threeway_handshake(void)
-{
-    border_syn_packet_t *syn;
-    msg_t m;
-    m.content.ptr = NULL;
-    msg_send(&m, border_get_serial_reader(), 1);
-    msg_receive(&m);
+static uint8_t recv_buffers[BORDER_UPLINKS][BORDER_RWS + 1][BORDER_BUFFER_SIZE];
 
-    syn = (border_syn_packet_t *)m.content.ptr;
-    border_conf_header_t *synack = (border_conf_header_t *)get_serial_out_buffer(0);
-    ipv6_addr_t addr;
-    memcpy(&addr, &(syn->addr), sizeof(ipv6_addr_t));
+void flowcontrol_init(void)
+{
+    for (uint8_t uplink = 0; uplink < BORDER_UPLINKS; uplink++) {
+        flowcontrol_stat_t *stat = &slwin_stat[uplink];
 
-    slwin_stat.next_exp = syn->next_seq_num;
-    slwin_stat.last_frame = syn->next_exp - 1;
-    slwin_stat.last_ack = slwin_stat.last_frame;
+        memset(stat, 0, sizeof(flowcontrol_stat_t));
+        stat->uplink = uplink;
+        stat->synack_seqnum = -1;
+        mutex_init(&stat->mutex);
+        sem_init(&stat->send_win_not_full, 0, BORDER_SWS);
 
-    synack->empty = 0;
-    synack->type = BORDER_PACKET_CONF_TYPE;
-    synack->conftype = BORDER_CONF_SYNACK;
+        for (int i = 0; i < BORDER_RWS; i++) {
+            stat->recv_win[i].frame = recv_buffers[uplink][i];
+        }
 
-    sending_slot_pid = thread_create(sending_slot_stack, SENDING_SLOT_STACK_SIZE, PRIORITY_MAIN - 1, CREATE_SLEEPING, sending_slot, "sending slot");
-    flowcontrol_send_over_uart((border_packet_t *)synack, sizeof(border_conf_header_t));
+        stat->recv_spare = recv_buffers[uplink][BORDER_RWS];
+    }
 
-    synack_seqnum = synack->seq_num;
+    /* one thread retransmits for all uplinks, the timers tell which */
+    sending_slot_pid = thread_create(sending_slot_stack, SENDING_SLOT_STACK_SIZE,
+                                     PRIORITY_MAIN - 1, CREATE_STACKTEST,
+                                     sending_slot, "sending slot");
+}
 
-    return addr;
+static int in_window(uint8_t seq_num, uint8_t min, uint8_t max)
+{
+    uint8_t pos = seq_num - min;
+    uint8_t maxpos = max - min + 1;
+    return (pos < maxpos);
 }
 
-ipv6_addr_t flowcontrol_init(void)
+/* gives back the slots of all unacknowledged frames, call with the mutex
+ * locked */
+static void release_send_window(flowcontrol_stat_t *stat)
 {
-    int i;
+    while (stat->last_ack != stat->last_frame) {
+        struct send_slot *slot;
+        slot = &(stat->send_win[++stat->last_ack % BORDER_SWS]);
+        slot->frame_len = 0;
+        slot->acked = 0;
+        sem_post(&stat->send_win_not_full);
+    }
 
-    sem_init(&slwin_stat.send_win_not_full, 0, BORDER_SWS);
+    vtimer_remove(&stat->timeout);
+    stat->timeout_set = 0;
+}
 
-    for (i = 0; i < BORDER_SWS; i++) {
-        slwin_stat.send_win[i].frame_len = 0;
+void flowcontrol_handshake(uint8_t uplink, border_syn_packet_t *syn)
+{
+    flowcontrol_stat_t *stat = &slwin_stat[uplink];
+    border_conf_header_t synack;
+
+    /* the daemon (re)starts the connection, frames still in flight are
+     * not delivered anymore */
+    mutex_lock(&stat->mutex);
+    release_send_window(stat);
+    stat->established = 0;
+    stat->next_exp = syn->next_seq_num;
+    stat->last_frame = syn->next_exp - 1;
+    stat->last_ack = stat->last_frame;
+
+    for (int i = 0; i < BORDER_RWS; i++) {
+        stat->recv_win[i].received = 0;
     }
 
-    memset(&slwin_stat.send_win, 0, sizeof(struct send_slot) * BORDER_SWS);
+    mutex_unlock(&stat->mutex);
 
-    for (i = 0; i < BORDER_RWS; i++) {
-        slwin_stat.recv_win[i].received = 0;
-        slwin_stat.recv_win[i].frame_len = 0;
-    }
+    synack.empty = 0;
+    synack.type = BORDER_PACKET_CONF_TYPE;
+    synack.conftype = BORDER_CONF_SYNACK;
 
-    memset(&slwin_stat.recv_win, 0, sizeof(struct recv_slot) * BORDER_RWS);
+    flowcontrol_send_over_uart(uplink, (border_packet_t *)&synack,
+                               sizeof(border_conf_header_t));
 
-    return init_threeway_handshake();
+    stat->synack_seqnum = synack.seq_num;
 }
 
+int flowcontrol_established(uint8_t uplink)
+{
+    return slwin_stat[uplink].established;
+}
+
+/* retransmits every frame of the window not acknowledged yet */
 static void sending_slot(void)
 {
     msg_t m;
     uint8_t seq_num;
     struct send_slot *slot;
-    border_packet_t *tmp;
+    flowcontrol_stat_t *stat;
 
     while (1) {
         msg_receive(&m);
-        seq_num = *((uint8_t *)m.content.ptr);
-        slot = &(slwin_stat.send_win[seq_num % BORDER_SWS]);
-        tmp = (border_packet_t *)slot->frame;
 
-        if (seq_num == tmp->seq_num) {
-            writepacket(slot->frame, slot->frame_len);
+        if (m.type != MSG_TIMER) {
+            continue;
+        }
 
-            if (set_timeout(&slot->timeout, timex_set(0, BORDER_SL_TIMEOUT), (void *)m.content.ptr) != 0) {
-                printf("ERROR: Error invoking timeout timer\n");
+        stat = (flowcontrol_stat_t *)m.content.ptr;
+        mutex_lock(&stat->mutex);
+        stat->timeout_set = 0;
+
+        for (seq_num = stat->last_ack + 1;
+             in_window(seq_num, stat->last_ack + 1, stat->last_frame);
+             seq_num++) {
+            slot = &(stat->send_win[seq_num % BORDER_SWS]);
+
+            if ((slot->frame_len != 0) && !slot->acked) {
+                writepacket(stat->uplink, slot->frame, slot->frame_len);
             }
         }
+
+        /* the whole window goes out in one transfer */
+        flushpackets(stat->uplink);
+
+        if (stat->last_ack != stat->last_frame) {
+            set_timeout(stat);
+        }
+
+        mutex_unlock(&stat->mutex);
     }
 }
 
-static int set_timeout(vtimer_t *timeout, timex_t val, void *args)
+/* (re)starts the retransmission timer, call with the mutex locked */
+static void set_timeout(flowcontrol_stat_t *stat)
 {
-    vtimer_remove(timeout);
+    timex_t val = timex_set(0, BORDER_SL_TIMEOUT);
 
+    vtimer_remove(&stat->timeout);
     timex_normalize(&val);
-    return vtimer_set_msg(timeout, val, sending_slot_pid, args);
+
+    if (vtimer_set_msg(&stat->timeout, val, sending_slot_pid, stat) != 0) {
+        printf("ERROR: Error invoking timeout timer\n");
+        return;
+    }
+
+    stat->timeout_set = 1;
 }
 
-static int in_window(uint8_t seq_num, uint8_t min, uint8_t max)
+border_packet_t *flowcontrol_get_send_buffer(uint8_t uplink)
 {
-    uint8_t pos = seq_num - min;
-    uint8_t maxpos = max - min + 1;
-    return (pos < maxpos);
+    flowcontrol_stat_t *stat = &slwin_stat[uplink];
+    struct send_slot *slot;
+    border_packet_t *packet;
+
+    sem_wait(&(stat->send_win_not_full));
+    mutex_lock(&stat->mutex);
+    slot = &(stat->send_win[(uint8_t)(stat->last_frame + 1) % BORDER_SWS]);
+    slot->frame_len = 0;
+    slot->acked = 0;
+    packet = (border_packet_t *)slot->frame;
+    packet->seq_num = ++stat->last_frame;
+    mutex_unlock(&stat->mutex);
+
+    return packet;
 }
 
-void flowcontrol_send_over_uart(border_packet_t *packet, int len)
+void flowcontrol_send_buffer(uint8_t uplink, border_packet_t *packet, int len)
 {
+    flowcontrol_stat_t *stat = &slwin_stat[uplink];
     struct send_slot *slot;
-    uint8_t args[] = {packet->seq_num};
 
-    sem_wait(&(slwin_stat.send_win_not_full));
-    packet->seq_num = ++slwin_stat.last_frame;
-    slot = &(slwin_stat.send_win[packet->seq_num % BORDER_SWS]);
-    memcpy(slot->frame, (uint8_t *)packet, len);
+    mutex_lock(&stat->mutex);
+    slot = &(stat->send_win[packet->seq_num % BORDER_SWS]);
     slot->frame_len = len;
 
-    if (set_timeout(&slot->timeout, timex_set(0, BORDER_SL_TIMEOUT * 1000), (void *)args) != 0) {
-        printf("ERROR: Error invoking timeout timer\n");
-        return;
+    if (!stat->timeout_set) {
+        set_timeout(stat);
     }
 
-    writepacket((uint8_t *)packet, len);
+    writepacket(uplink, slot->frame, slot->frame_len);
+    flushpackets(uplink);
+    mutex_unlock(&stat->mutex);
 }
 
-void send_ack(uint8_t seq_num)
+void flowcontrol_send_over_uart(uint8_t uplink, border_packet_t *packet, int len)
 {
-    border_packet_t *packet = (border_packet_t *)get_serial_out_buffer(0);
-    packet->empty = 0;
-    packet->type = BORDER_PACKET_ACK_TYPE;
+    border_packet_t *slot_packet = flowcontrol_get_send_buffer(uplink);
+    uint8_t seq_num = slot_packet->seq_num;
+
+    memcpy(slot_packet, packet, len);
+    slot_packet->seq_num = seq_num;
     packet->seq_num = seq_num;
-    writepacket((uint8_t *)packet, sizeof(border_packet_t));
+    flowcontrol_send_buffer(uplink, slot_packet, len);
 }
 
-void flowcontrol_deliver_from_uart(border_packet_t *packet, int len)
+uint8_t *flowcontrol_get_recv_buffer(uint8_t uplink)
 {
-    if (packet->type == BORDER_PACKET_ACK_TYPE) {
-        if (in_window(packet->seq_num, slwin_stat.last_ack + 1, slwin_stat.last_frame)) {
-            if (synack_seqnum == packet->seq_num) {
-                synack_seqnum = -1;
-                sem_post(&connection_established);
-            }
+    return slwin_stat[uplink].recv_spare;
+}
+
+static void send_ack(flowcontrol_stat_t *stat, uint8_t seq_num)
+{
+    border_ack_packet_t packet;
+
+    packet.empty = 0;
+    packet.type = BORDER_PACKET_ACK_TYPE;
+    packet.seq_num = seq_num;
+    packet.sack = 0;
+
+    for (uint8_t i = 0; i < BORDER_RWS - 1 && i < 8; i++) {
+        if (stat->recv_win[(uint8_t)(seq_num + 2 + i) % BORDER_RWS].received) {
+            packet.sack |= (1 << i);
+        }
+    }
+
+    mutex_lock(&stat->mutex);
+    writepacket(stat->uplink, (uint8_t *)&packet, sizeof(packet));
+    flushpackets(stat->uplink);
+    mutex_unlock(&stat->mutex);
+}
+
+static void recv_ack(flowcontrol_stat_t *stat, border_packet_t *packet, int len)
+{
+    uint8_t seq_num = packet->seq_num;
+
+    mutex_lock(&stat->mutex);
+
+    if (in_window(seq_num, stat->last_ack + 1, stat->last_frame)) {
+        if (stat->synack_seqnum == seq_num) {
+            stat->synack_seqnum = -1;
+            stat->established = 1;
+        }
+
+        do {
+            struct send_slot *slot;
+            slot = &(stat->send_win[++stat->last_ack % BORDER_SWS]);
+            slot->frame_len = 0;
+            slot->acked = 0;
+            sem_post(&stat->send_win_not_full);
+        }
+        while (stat->last_ack != seq_num);
 
-            do {
-                struct send_slot *slot;
-                slot = &(slwin_stat.send_win[++slwin_stat.last_ack % BORDER_SWS]);
-                vtimer_remove(&slot->timeout);
-                memset(&slot->frame, 0, BORDER_BUFFER_SIZE);
-                sem_post(&slwin_stat.send_win_not_full);
+        if (stat->last_ack == stat->last_frame) {
+            vtimer_remove(&stat->timeout);
+            stat->timeout_set = 0;
+        }
+        else {
+            /* progress, give the rest of the window a full timeout */
+            set_timeout(stat);
+        }
+    }
+
+    if ((size_t) len >= sizeof(border_ack_packet_t)) {
+        uint8_t sack = ((border_ack_packet_t *)packet)->sack;
+
+        for (uint8_t i = 0; sack != 0; i++, sack >>= 1) {
+            uint8_t s = seq_num + 2 + i;
+
+            if ((sack & 1) &&
+                in_window(s, stat->last_ack + 1, stat->last_frame)) {
+                stat->send_win[s % BORDER_SWS].acked = 1;
             }
-            while (slwin_stat.last_ack != packet->seq_num);
         }
     }
+
+    mutex_unlock(&stat->mutex);
+}
+
+void flowcontrol_deliver_from_uart(uint8_t uplink, border_packet_t *packet,
+                                   int len)
+{
+    flowcontrol_stat_t *stat = &slwin_stat[uplink];
+
+    if (packet->type == BORDER_PACKET_ACK_TYPE) {
+        recv_ack(stat, packet, len);
+    }
     else {
         struct recv_slot *slot;
 
-        slot = &(slwin_stat.recv_win[packet->seq_num % BORDER_RWS]);
+        slot = &(stat->recv_win[packet->seq_num % BORDER_RWS]);
 
-        if (!in_window(packet->seq_num,
-                       slwin_stat.next_exp,
-                       slwin_stat.next_exp + BORDER_RWS - 1)) {
-            return;
-        }
+        if (in_window(packet->seq_num,
+                      stat->next_exp,
+                      stat->next_exp + BORDER_RWS - 1) &&
+            !slot->received) {
+            if ((uint8_t *)packet == stat->recv_spare) {
+                /* hand the buffer the frame was read into to the slot */
+                stat->recv_spare = slot->frame;
+                slot->frame = (uint8_t *)packet;
+            }
+            else {
+                memcpy(slot->frame, (uint8_t *)packet, len);
+            }
 
-        memcpy(slot->frame, (uint8_t *)packet, len);
-        slot->received = 1;
+            slot->frame_len = len;
+            slot->received = 1;
+            slot = &stat->recv_win[stat->next_exp % BORDER_RWS];
 
-        if (packet->seq_num == slwin_stat.next_exp) {
             while (slot->received) {
                 demultiplex((border_packet_t *)slot->frame);
-                memset(&slot->frame, 0, BORDER_BUFFER_SIZE);
                 slot->received = 0;
-                slot = &slwin_stat.recv_win[++(slwin_stat.next_exp) % BORDER_RWS];
+                slot = &stat->recv_win[++(stat->next_exp) % BORDER_RWS];
             }
         }
 
-        send_ack(slwin_stat.next_exp - 1);
+        /* duplicates are acknowledged again, the ACK may have been lost */
+        stat->ack_pending = 1;
+    }
+
+    /* one cumulative ACK for all frames that came in the same transfer */
+    if (stat->ack_pending && !readpacket_pending(uplink)) {
+        stat->ack_pending = 0;
+        send_ack(stat, stat->next_exp - 1);
     }
 }
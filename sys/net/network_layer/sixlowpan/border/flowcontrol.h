@@ -23,6 +23,7 @@
 
 #include "vtimer.h"
 
+#include "mutex.h"
 #include "semaphore.h"
 #include "ip.h"
 #include "border.h"
@@ -35,32 +36,60 @@
 #define BORDER_CONF_SYN           (0)
 #define BORDER_CONF_SYNACK        (1)
 
-#define BORDER_SWS                (1)
-#define BORDER_RWS                (1)
-#define BORDER_SL_TIMEOUT         (500) // microseconds, maybe smaller
+/* window sizes, at most 9 frames for the receiver, see border_ack_packet_t */
+#ifndef BORDER_SWS
+#define BORDER_SWS                (4)
+#endif
+#ifndef BORDER_RWS
+#define BORDER_RWS                (4)
+#endif
+#define BORDER_SL_TIMEOUT         (500000) // microseconds
 
 #define SENDING_SLOT_STACK_SIZE     (MINIMUM_STACK_SIZE + 256)
 
 typedef struct {
+    uint8_t uplink;
+    uint8_t established;        /* the SYNACK was acknowledged */
+    int16_t synack_seqnum;
+    mutex_t mutex;              /* between senders, serial reader and
+                                 * sending slot */
+
     /* Sender state */
     uint8_t last_ack;
     uint8_t last_frame;
     sem_t send_win_not_full;
+    vtimer_t timeout;           /* retransmission timer of the window */
+    uint8_t timeout_set;
     struct send_slot {
-        vtimer_t timeout;
+        uint8_t acked;          /* selectively acknowledged */
         uint8_t frame[BORDER_BUFFER_SIZE];
-        size_t frame_len;
+        size_t frame_len;       /* 0 until the frame is complete */
     } send_win[BORDER_SWS];
 
-    /* Receiver state */
+    /* Receiver state, frames are read into recv_spare and swapped into
+     * their slot */
     uint8_t next_exp;
     struct recv_slot {
         int8_t received;
-        uint8_t frame[BORDER_BUFFER_SIZE];
+        uint8_t *frame;
         size_t frame_len;
     } recv_win[BORDER_RWS];
+    uint8_t *recv_spare;
+    uint8_t ack_pending;        /* only touched by the serial reader */
 } flowcontrol_stat_t;
 
+/*
+ * Acknowledges every frame up to seq_num. Bit i of sack is set if frame
+ * seq_num + 2 + i was received too, these are not retransmitted. Peers
+ * that send the plain border_packet_t are understood as well.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t empty;
+    uint8_t type;
+    uint8_t seq_num;
+    uint8_t sack;
+} border_ack_packet_t;
+
 typedef struct __attribute__((packed)) {
     uint8_t empty;
     uint8_t type;
@@ -70,8 +99,15 @@ typedef struct __attribute__((packed)) {
     ipv6_addr_t addr;
 } border_syn_packet_t;
 
-ipv6_addr_t flowcontrol_init(void);
-void flowcontrol_send_over_uart(border_packet_t *packet, int len);
-void flowcontrol_deliver_from_uart(border_packet_t *packet, int len);
+/* windows of all uplinks, every uplink shakes hands on its own */
+void flowcontrol_init(void);
+void flowcontrol_handshake(uint8_t uplink, border_syn_packet_t *syn);
+int flowcontrol_established(uint8_t uplink);
+border_packet_t *flowcontrol_get_send_buffer(uint8_t uplink);
+void flowcontrol_send_buffer(uint8_t uplink, border_packet_t *packet, int len);
+void flowcontrol_send_over_uart(uint8_t uplink, border_packet_t *packet, int len);
+uint8_t *flowcontrol_get_recv_buffer(uint8_t uplink);
+void flowcontrol_deliver_from_uart(uint8_t uplink, border_packet_t *packet,
+                                   int len);
 
 #endif /* _SIXLOWPAN_FLOWCONTROL_H*/
@@ -30,6 +30,7 @@
 #include "ip.h"
 #include "icmp.h"
 #include "serialnumber.h"
+#include "ipv6_lpm.h"
 #include "net_help.h"
 
 #define ENABLE_DEBUG    (0)
@@ -87,12 +88,39 @@
 #define OPT_ABRO_LEN                   	(3)
 #define OPT_ABRO_HDR_LEN               	(24)
 /* authoritive border router cache size */
+#ifndef ABR_CACHE_SIZE
 #define ABR_CACHE_SIZE                 	(2)
+#endif
 /* neighbor cache size */
+#ifndef NBR_CACHE_SIZE
 #define NBR_CACHE_SIZE                 	(8)
+#endif
+/* number of hash buckets of the neighbor cache, must be a power of two */
+#ifndef NBR_CACHE_HASH_BUCKETS
+#define NBR_CACHE_HASH_BUCKETS          (16)
+#endif
 #define NBR_CACHE_LTIME_TEN            	(20)
+/* address registrations of hosts, a border router registers the whole
+ * network; NDP_REG_HASH_BUCKETS must be a power of two and the table can
+ * hold up to 65535 entries */
+#ifndef NDP_REG_TABLE_SIZE
+#ifdef MODULE_SIXLOWBORDER
+#define NDP_REG_TABLE_SIZE              (256)
+#else
+#define NDP_REG_TABLE_SIZE              (16)
+#endif
+#endif
+#ifndef NDP_REG_HASH_BUCKETS
+#ifdef MODULE_SIXLOWBORDER
+#define NDP_REG_HASH_BUCKETS            (64)
+#else
+#define NDP_REG_HASH_BUCKETS            (16)
+#endif
+#endif
 /* default router list size */
+#ifndef DEF_RTR_LST_SIZE
 #define DEF_RTR_LST_SIZE                   	(3) /* geeigneten wert finden */
+#endif
 
 #define PREFIX_BUF_LEN                  (NET_IF_MAX * OPT_PI_LIST_LEN)
 
@@ -101,7 +129,7 @@ uint8_t ipv6_ext_hdr_len = 0;
 
 /* counter */
 uint8_t abr_count = 0;
-uint8_t nbr_count = 0;
+uint16_t nbr_count = 0;
 uint8_t def_rtr_count = 0;
 uint8_t rtr_sol_count = 0;
 uint8_t prefix_info_count = 0;
@@ -109,10 +137,39 @@ uint8_t prefix_buf_count = 0;
 
 /* datastructures */
 ndp_a6br_cache_t abr_cache[ABR_CACHE_SIZE];
+/* indices of abr_cache by descending version, abr_count are valid */
+static uint8_t abr_order[ABR_CACHE_SIZE];
 ndp_neighbor_cache_t nbr_cache[NBR_CACHE_SIZE];
+/* hash chains over nbr_cache, links are indices + 1, 0 terminates */
+static uint16_t nbr_cache_buckets[NBR_CACHE_HASH_BUCKETS];
+static uint16_t nbr_cache_links[NBR_CACHE_SIZE];
+static uint16_t nbr_cache_free;
+static uint8_t nbr_cache_initialized = 0;
+typedef struct {
+    ipv6_addr_t addr;
+    ieee_802154_long_t eui64;
+    uint32_t expires;           /* vtimer seconds */
+} ndp_registration_t;
+static ndp_registration_t reg_table[NDP_REG_TABLE_SIZE];
+/* hash chains over reg_table as for nbr_cache; reg_heap holds the indices
+ * of the reg_count registrations as a min-heap by expiry, followed by the
+ * free ones, reg_heap_pos is the inverse */
+static uint16_t reg_buckets[NDP_REG_HASH_BUCKETS];
+static uint16_t reg_links[NDP_REG_TABLE_SIZE];
+static uint16_t reg_heap[NDP_REG_TABLE_SIZE];
+static uint16_t reg_heap_pos[NDP_REG_TABLE_SIZE];
+static uint16_t reg_count;
+static uint8_t reg_initialized = 0;
+/* ARO status and lifetime the next neighbor advertisement carries */
+static uint8_t nbr_adv_aro_status = NDP_OPT_ARO_STATE_SUCCESS;
+static uint16_t nbr_adv_aro_ltime = OPT_ARO_LTIME;
 ndp_default_router_list_t def_rtr_lst[DEF_RTR_LST_SIZE];
+/* router used until it leaves the list, NULL if the list is empty */
+static ndp_default_router_list_t *def_rtr_pref;
 ndp_prefix_info_t prefix_info_buf[PREFIX_BUF_LEN];
 uint8_t prefix_buf[sizeof(ipv6_addr_t) * PREFIX_BUF_LEN];
+/* longest prefix match over prefix_info_buf per interface */
+static ipv6_lpm_t prefix_info_tries[NET_IF_MAX];
 
 /* pointer */
 static uint8_t *llao;
@@ -134,6 +191,27 @@ static icmpv6_ndp_opt_aro_t *opt_aro_buf;
 ndp_neighbor_cache_t *nbr_entry;
 ndp_default_router_list_t *def_rtr_entry;
 
+/* options of a cached router advertisement */
+#define RTR_ADV_CACHED      (0x80)
+#define RTR_ADV_CACHE_MTU   (0x01)
+#define RTR_ADV_CACHE_PI    (0x02)
+#define RTR_ADV_CACHE_6CO   (0x04)
+#define RTR_ADV_CACHE_ABRO  (0x08)
+
+/* the last router advertisement sent, reused until anything it
+ * advertises changes */
+static struct {
+    uint8_t opts;           /* RTR_ADV_CACHE_* it was built with, 0 if none */
+    uint16_t addr_gen;      /* net_if_get_address_generation() */
+    uint16_t ctx_version;   /* lowpan_context_get_version() */
+    uint16_t adv_gen;       /* rtr_adv_gen */
+    uint16_t len;           /* length of the ICMPv6 message */
+    uint16_t sum;           /* icmpv6_csum_partial() of the message */
+    uint8_t msg[IPV6_MTU - IPV6_HDR_LEN];
+} rtr_adv_cache;
+/* bumped on changes of the prefix information and the ABR cache */
+static uint16_t rtr_adv_gen;
+
 /* elements */
 //ipv6_addr_t tmpaddr;
 
@@ -511,32 +589,13 @@ void get_opt_6co_flags(uint8_t *compression_flag, uint8_t *cid, uint8_t flags)
 
 lowpan_context_t *abr_get_context(ndp_a6br_cache_t *abr, uint8_t cid);
 
-void icmpv6_send_router_adv(ipv6_addr_t *addr, uint8_t sllao, uint8_t mtu, uint8_t pi,
-                            uint8_t sixco, uint8_t abro)
+/* builds a router advertisement behind the IPv6 header in the buffer,
+ * returns the length of the ICMPv6 message */
+static uint16_t rtr_adv_build(int if_id, uint8_t sllao, uint8_t mtu, uint8_t pi,
+                              uint8_t sixco, uint8_t abro)
 {
-    int if_id = 0;      // TODO: get this somehow
     uint16_t packet_length;
-    lowpan_context_t *contexts = NULL;
-
     ndp_a6br_cache_t *msg_abr = NULL;
-    ipv6_buf = ipv6_get_buf();
-    icmp_buf = get_icmpv6_buf(ipv6_ext_hdr_len);
-
-    ipv6_buf->version_trafficclass = IPV6_VER;
-    ipv6_buf->trafficclass_flowlabel = 0;
-    ipv6_buf->flowlabel = 0;
-    ipv6_buf->nextheader = IPV6_PROTO_NUM_ICMPV6;
-    ipv6_buf->hoplimit = ND_HOPLIMIT;
-
-    if (addr == NULL) {
-        /* not solicited */
-        ipv6_addr_set_all_nodes_addr(&ipv6_buf->destaddr);
-    }
-    else {
-        memcpy(&ipv6_buf->destaddr, addr, 16);
-    }
-
-    ipv6_net_if_get_best_src_addr(&(ipv6_buf->srcaddr), &(ipv6_buf->destaddr));
 
     icmp_buf->type = ICMPV6_TYPE_ROUTER_ADV;
     icmp_buf->code = 0;
@@ -552,7 +611,7 @@ void icmpv6_send_router_adv(ipv6_addr_t *addr, uint8_t sllao, uint8_t mtu, uint8
     rtr_adv_buf->retrans_timer = 0;
     icmpv6_opt_hdr_len = RTR_ADV_LEN;
 
-    packet_length = IPV6_HDR_LEN + ICMPV6_HDR_LEN + RTR_ADV_LEN;
+    packet_length = ICMPV6_HDR_LEN + RTR_ADV_LEN;
 
     if (sllao == OPT_SLLAO) {
         /* set link layer address option */
@@ -584,59 +643,56 @@ void icmpv6_send_router_adv(ipv6_addr_t *addr, uint8_t sllao, uint8_t mtu, uint8
     /* set payload length field */
 
     if (abro == OPT_ABRO) {
-        /* set authoritive border router option */
-        if (abr_count > 0) {
-            msg_abr = ndp_a6br_cache_get_most_current();
+        /* set authoritive border router options, one per border router
+         * known, the most current first since the contexts are its */
+        msg_abr = ndp_a6br_cache_get_most_current();
+
+        for (int i = 0; i < abr_count; i++) {
+            ndp_a6br_cache_t *abr = &abr_cache[abr_order[i]];
+
             opt_abro_buf = get_opt_abro_buf(ipv6_ext_hdr_len, icmpv6_opt_hdr_len);
             opt_abro_buf->type = OPT_ABRO_TYPE;
             opt_abro_buf->length = OPT_ABRO_LEN;
-            opt_abro_buf->version = HTONS(msg_abr->version);
+            opt_abro_buf->version = HTONS(abr->version);
             opt_abro_buf->reserved = 0;
-            memcpy(&(opt_abro_buf->addr), &(msg_abr->abr_addr), sizeof(ipv6_addr_t));
+            memcpy(&(opt_abro_buf->addr), &(abr->abr_addr), sizeof(ipv6_addr_t));
+            icmpv6_opt_hdr_len += OPT_ABRO_HDR_LEN;
+            packet_length += OPT_ABRO_HDR_LEN;
         }
     }
 
     if (sixco == OPT_6CO) {
         /* set 6lowpan context option */
-        int contexts_len = 0;
         mutex_lock(&lowpan_context_mutex);
 
-        if (msg_abr == NULL) {
-            contexts = lowpan_context_get();
-            contexts_len = lowpan_context_len();
-        }
-        else {
-            lowpan_context_t c_tmp[NDP_6LOWPAN_CONTEXT_MAX];
-
-            contexts_len = 0;
-
-            for (int i = 0; i < NDP_6LOWPAN_CONTEXT_MAX; i++) {
-                lowpan_context_t *ctx = abr_get_context(msg_abr, i);
+        for (int i = 0; i < NDP_6LOWPAN_CONTEXT_MAX; i++) {
+            lowpan_context_t *context;
 
-                if (ctx != NULL) {
-                    memcpy(&(c_tmp[contexts_len++]), ctx, sizeof(lowpan_context_t));
-                }
+            if (msg_abr == NULL) {
+                context = (i < lowpan_context_len()) ? &lowpan_context_get()[i] : NULL;
+            }
+            else {
+                context = abr_get_context(msg_abr, i);
             }
 
-            contexts = (lowpan_context_t *)malloc(contexts_len * sizeof(lowpan_context_t));
-            memcpy(contexts, c_tmp, contexts_len);
-        }
+            if (context == NULL) {
+                continue;
+            }
 
-        for (int i = 0; i < contexts_len; i++) {
             opt_6co_hdr_buf = get_opt_6co_hdr_buf(ipv6_ext_hdr_len, icmpv6_opt_hdr_len);
             opt_6co_hdr_buf->type = OPT_6CO_TYPE;
 
-            if (contexts[i].length > 64) {
+            if (context->length > 64) {
                 opt_6co_hdr_buf->length = OPT_6CO_MAX_LEN;
             }
             else {
                 opt_6co_hdr_buf->length = OPT_6CO_MIN_LEN;
             }
 
-            opt_6co_hdr_buf->c_length = contexts[i].length;
-            opt_6co_hdr_buf->c_flags = set_opt_6co_flags(contexts[i].comp, contexts[i].num);
+            opt_6co_hdr_buf->c_length = context->length;
+            opt_6co_hdr_buf->c_flags = set_opt_6co_flags(context->comp, context->num);
             opt_6co_hdr_buf->reserved = 0;
-            opt_6co_hdr_buf->val_ltime = HTONS(contexts[i].lifetime);
+            opt_6co_hdr_buf->val_ltime = HTONS(context->lifetime);
 
             icmpv6_opt_hdr_len += OPT_6CO_HDR_LEN;
             packet_length += OPT_6CO_HDR_LEN;
@@ -645,21 +701,16 @@ void icmpv6_send_router_adv(ipv6_addr_t *addr, uint8_t sllao, uint8_t mtu, uint8
 
             if (opt_6co_hdr_buf->c_length > 64) {
                 memset((void *)opt_6co_prefix_buf, 0, 16);
-                memcpy((void *)opt_6co_prefix_buf, (void *) &contexts[i].prefix.uint8[0], opt_6co_hdr_buf->c_length / 8);
+                memcpy((void *)opt_6co_prefix_buf, (void *) &context->prefix.uint8[0], opt_6co_hdr_buf->c_length / 8);
                 icmpv6_opt_hdr_len += 16;
                 packet_length += 16;
             }
             else {
                 memset((void *)opt_6co_prefix_buf, 0, 8);
-                memcpy((void *)opt_6co_prefix_buf, (void *) &contexts[i].prefix.uint8[0], opt_6co_hdr_buf->c_length / 8);
+                memcpy((void *)opt_6co_prefix_buf, (void *) &context->prefix.uint8[0], opt_6co_hdr_buf->c_length / 8);
                 icmpv6_opt_hdr_len += 8;
                 packet_length += 8;
             }
-
-        }
-
-        if (msg_abr != NULL && contexts != NULL) {
-            free(contexts);
         }
 
         mutex_unlock(&lowpan_context_mutex);
@@ -688,10 +739,79 @@ void icmpv6_send_router_adv(ipv6_addr_t *addr, uint8_t sllao, uint8_t mtu, uint8
         }
     }
 
-    ipv6_buf->length = HTONS(packet_length - IPV6_HDR_LEN);
+    return packet_length;
+}
 
-    /* calculate checksum */
-    icmp_buf->checksum = icmpv6_csum(ipv6_buf, icmp_buf);
+void icmpv6_send_router_adv(ipv6_addr_t *addr, uint8_t sllao, uint8_t mtu, uint8_t pi,
+                            uint8_t sixco, uint8_t abro)
+{
+    int if_id = 0;      // TODO: get this somehow
+    uint16_t len;
+    uint16_t sum;
+    uint8_t opts = 0;
+    uint16_t addr_gen = net_if_get_address_generation();
+    uint16_t ctx_version = lowpan_context_get_version();
+    uint16_t adv_gen = rtr_adv_gen;
+
+    ipv6_buf = ipv6_get_buf();
+    icmp_buf = get_icmpv6_buf(ipv6_ext_hdr_len);
+
+    ipv6_buf->version_trafficclass = IPV6_VER;
+    ipv6_buf->trafficclass_flowlabel = 0;
+    ipv6_buf->flowlabel = 0;
+    ipv6_buf->nextheader = IPV6_PROTO_NUM_ICMPV6;
+    ipv6_buf->hoplimit = ND_HOPLIMIT;
+
+    if (addr == NULL) {
+        /* not solicited */
+        ipv6_addr_set_all_nodes_addr(&ipv6_buf->destaddr);
+    }
+    else {
+        memcpy(&ipv6_buf->destaddr, addr, 16);
+    }
+
+    ipv6_net_if_get_best_src_addr(&(ipv6_buf->srcaddr), &(ipv6_buf->destaddr));
+
+    /* the SLLAO follows the interface's address mode, such RAs are not
+     * cached */
+    if (sllao != OPT_SLLAO) {
+        opts = RTR_ADV_CACHED |
+               ((mtu == OPT_MTU) ? RTR_ADV_CACHE_MTU : 0) |
+               ((pi == OPT_PI) ? RTR_ADV_CACHE_PI : 0) |
+               ((sixco == OPT_6CO) ? RTR_ADV_CACHE_6CO : 0) |
+               ((abro == OPT_ABRO) ? RTR_ADV_CACHE_ABRO : 0);
+    }
+
+    if (opts && (rtr_adv_cache.opts == opts) &&
+        (rtr_adv_cache.addr_gen == addr_gen) &&
+        (rtr_adv_cache.ctx_version == ctx_version) &&
+        (rtr_adv_cache.adv_gen == adv_gen) &&
+        (rtr_adv_cache.len <= IPV6_MTU - IPV6_HDR_LEN - ipv6_ext_hdr_len)) {
+        len = rtr_adv_cache.len;
+        sum = rtr_adv_cache.sum;
+        memcpy(icmp_buf, rtr_adv_cache.msg, len);
+    }
+    else {
+        len = rtr_adv_build(if_id, sllao, mtu, pi, sixco, abro);
+        sum = icmpv6_csum_partial(icmp_buf, len);
+
+        if (opts) {
+            /* the generations were taken before building, a change in
+             * between invalidates the entry again */
+            rtr_adv_cache.opts = opts;
+            rtr_adv_cache.addr_gen = addr_gen;
+            rtr_adv_cache.ctx_version = ctx_version;
+            rtr_adv_cache.adv_gen = adv_gen;
+            rtr_adv_cache.len = len;
+            rtr_adv_cache.sum = sum;
+            memcpy(rtr_adv_cache.msg, icmp_buf, len);
+        }
+    }
+
+    ipv6_buf->length = HTONS(len);
+
+    /* only the pseudo header's addresses are summed per send */
+    icmp_buf->checksum = icmpv6_csum_finish(ipv6_buf, sum);
 
 #ifdef DEBUG_ENABLED
     char addr_str[IPV6_MAX_ADDR_STR_LEN];
@@ -864,6 +984,15 @@ void recv_rtr_adv(void)
 
             case (OPT_ABRO_TYPE): {
                 opt_abro_buf = get_opt_abro_buf(ipv6_ext_hdr_len, icmpv6_opt_hdr_len);
+
+                if (abro_found) {
+                    /* further border routers of the network, the contexts
+                     * belong to the first one */
+                    abr_add_contexts(HTONS(opt_abro_buf->version),
+                                     &opt_abro_buf->addr, NULL, 0);
+                    break;
+                }
+
                 abro_found = 1;
                 abro_version = HTONS(opt_abro_buf->version);
                 memcpy(&(abro_addr), &(opt_abro_buf->addr), sizeof(ipv6_addr_t));
@@ -878,12 +1007,9 @@ void recv_rtr_adv(void)
         icmpv6_opt_hdr_len += (opt_buf->length * 8);
     }
 
-    if (abro_found) {
-        int i;
-
-        for (i = 0; i < recvd_cids_len; i++) {
-            abr_add_context(abro_version, &abro_addr, recvd_cids[i]);
-        }
+    if (abro_found && recvd_cids_len) {
+        /* the ABR is looked up once for all its contexts */
+        abr_add_contexts(abro_version, &abro_addr, recvd_cids, recvd_cids_len);
     }
 
     mutex_unlock(&lowpan_context_mutex);
@@ -967,6 +1093,7 @@ void icmpv6_send_neighbor_sol(ipv6_addr_t *src, ipv6_addr_t *dest, ipv6_addr_t *
         opt_aro_buf->status = 0;
         opt_aro_buf->reserved1 = 0;
         opt_aro_buf->reserved2 = 0;
+        opt_aro_buf->reg_ltime = HTONS(OPT_ARO_LTIME);
 
         if (net_if_get_src_address_mode(if_id) == NET_IF_TRANS_ADDR_M_SHORT) {
             net_if_get_eui64((net_if_eui64_t *) &opt_aro_buf->eui64, if_id, 1);
@@ -1109,40 +1236,33 @@ void recv_nbr_sol(void)
                                                   icmpv6_opt_hdr_len);
 
                     if ((opt_aro_buf->length == 2) &&
-                        (opt_aro_buf->status == 0)) {
-                        /* check neighbor cache for duplicates */
-                        nbr_entry = ndp_neighbor_cache_search(&(ipv6_buf->srcaddr));
-
-                        if (nbr_entry == NULL) {
-                            /* create neighbor cache */
-                            aro_state = ndp_neighbor_cache_add(if_id, &ipv6_buf->srcaddr,
-                                                               &(opt_aro_buf->eui64), 8, 0,
-                                                               NDP_NCE_STATUS_STALE, NDP_NCE_TYPE_TENTATIVE,
-                                                               opt_aro_buf->reg_ltime);
-                        }
-                        else {
-                            if (memcmp(&(nbr_entry->addr.uint16[4]),
-                                       &(opt_aro_buf->eui64.uint16[0]), 8) == 0) {
-                                /* update neighbor cache entry */
-                                if (opt_aro_buf->reg_ltime == 0) {
-                                    /* delete neighbor cache entry */
-                                    ndp_neighbor_cache_remove(&nbr_entry->addr);
-                                }
-                                else {
-                                    set_remaining_time(&(nbr_entry->ltime), (uint32_t)opt_aro_buf->reg_ltime);
-                                    nbr_entry->state = NDP_NCE_STATUS_STALE;
-                                    nbr_entry->isrouter = 0;
-                                    memcpy(&(nbr_entry->addr.uint8[0]),
-                                           &(ipv6_buf->srcaddr.uint8[0]), 16);
-                                }
+                        (opt_aro_buf->status == 0) && ipv6_is_router()) {
+                        /* registration lifetime is in units of 60 s */
+                        uint16_t reg_ltime = NTOHS(opt_aro_buf->reg_ltime);
+
+                        aro_state = ndp_registration_update(&ipv6_buf->srcaddr,
+                                                            &opt_aro_buf->eui64,
+                                                            reg_ltime);
 
-                                aro_state = NDP_OPT_ARO_STATE_SUCCESS;
+                        if (aro_state == NDP_OPT_ARO_STATE_SUCCESS) {
+                            nbr_entry = ndp_neighbor_cache_search(&(ipv6_buf->srcaddr));
+
+                            if (reg_ltime == 0) {
+                                ndp_neighbor_cache_remove(&ipv6_buf->srcaddr);
                             }
-                            else {
-                                /* duplicate found */
-                                aro_state = NDP_OPT_ARO_STATE_DUP_ADDR;
+                            else if (nbr_entry != NULL) {
+                                /* the registration is kept in its own
+                                 * table, the neighbor cache only caches
+                                 * the link-layer address of the host */
+                                nbr_entry->type = NDP_NCE_TYPE_GC;
+                                nbr_entry->ltime = timex_set(0, 0);
+                                nbr_entry->state = NDP_NCE_STATUS_STALE;
+                                nbr_entry->isrouter = 0;
                             }
                         }
+
+                        nbr_adv_aro_status = aro_state;
+                        nbr_adv_aro_ltime = reg_ltime;
                     }
                 }
 
@@ -1179,6 +1299,9 @@ void recv_nbr_sol(void)
         icmpv6_send_neighbor_adv(&(ipv6_buf->srcaddr), &(ipv6_buf->destaddr),
                                  alist_targ.addr->addr_data, flags, 0, OPT_ARO);
     }
+
+    nbr_adv_aro_status = NDP_OPT_ARO_STATE_SUCCESS;
+    nbr_adv_aro_ltime = OPT_ARO_LTIME;
 }
 
 void icmpv6_send_neighbor_adv(ipv6_addr_t *src, ipv6_addr_t *dst, ipv6_addr_t *tgt,
@@ -1236,9 +1359,10 @@ void icmpv6_send_neighbor_adv(ipv6_addr_t *src, ipv6_addr_t *dst, ipv6_addr_t *t
         opt_aro_buf = get_opt_aro_buf(ipv6_ext_hdr_len, icmpv6_opt_hdr_len);
         opt_aro_buf->type = OPT_ARO_TYPE;
         opt_aro_buf->length = OPT_ARO_LEN;
-        opt_aro_buf->status = 0;    /* TODO */
+        opt_aro_buf->status = nbr_adv_aro_status;
         opt_aro_buf->reserved1 = 0;
         opt_aro_buf->reserved2 = 0;
+        opt_aro_buf->reg_ltime = HTONS(nbr_adv_aro_ltime);
 
         if (net_if_get_src_address_mode(if_id) == NET_IF_TRANS_ADDR_M_SHORT) {
             net_if_get_eui64((net_if_eui64_t *) &opt_aro_buf->eui64, if_id, 1);
@@ -1327,8 +1451,7 @@ void recv_nbr_adv(void)
                 }
 
                 if (nbr_adv_buf->rso & ICMPV6_NEIGHBOR_ADV_FLAG_SOLICITED) {
-                    nbr_entry->state = NDP_NCE_STATUS_REACHABLE;
-                    /* TODO: set rechability */
+                    ndp_neighbor_cache_reachable(nbr_entry);
                 }
                 else {
                     nbr_entry->state = NDP_NCE_STATUS_STALE;
@@ -1365,8 +1488,7 @@ void recv_nbr_adv(void)
                         }
 
                         if (nbr_adv_buf->rso & ICMPV6_NEIGHBOR_ADV_FLAG_SOLICITED) {
-                            nbr_entry->state = NDP_NCE_STATUS_REACHABLE;
-                            /* TODO: set rechablility */
+                            ndp_neighbor_cache_reachable(nbr_entry);
                         }
                         else {
                             if (llao != 0 && new_ll) {
@@ -1429,14 +1551,22 @@ void icmpv6_ndp_set_sllao(icmpv6_ndp_opt_stllao_t *sllao, int if_id,
 
 uint16_t icmpv6_csum(ipv6_hdr_t *ipv6_buf, icmpv6_hdr_t *icmpv6_buf)
 {
-    uint16_t sum;
     uint16_t len = NTOHS(ipv6_buf->length);
 
+    return icmpv6_csum_finish(ipv6_buf, icmpv6_csum_partial(icmpv6_buf, len));
+}
+
+uint16_t icmpv6_csum_partial(icmpv6_hdr_t *icmpv6_buf, uint16_t len)
+{
+    uint16_t sum = len + IPV6_PROTO_NUM_ICMPV6;
+
     icmpv6_buf->checksum = 0;
-    sum = len + IPV6_PROTO_NUM_ICMPV6;
+    return csum(sum, (uint8_t *)icmpv6_buf, len);
+}
 
+uint16_t icmpv6_csum_finish(ipv6_hdr_t *ipv6_buf, uint16_t sum)
+{
     sum = csum(sum, (uint8_t *)&ipv6_buf->srcaddr, 2 * sizeof(ipv6_addr_t));
-    sum = csum(sum, (uint8_t *)icmpv6_buf, len);
 
     return (sum == 0) ? 0 : ~HTONS(sum);
 }
@@ -1488,22 +1618,152 @@ void icmpv6_send_parameter_prob(ipv6_addr_t *src, ipv6_addr_t *dest,
 //------------------------------------------------------------------------------
 /* neighbor cache functions */
 
+#define NBR_CACHE_ENTRY(link)   (&nbr_cache[(link) - 1])
+#define NBR_CACHE_LINK(entry)   ((uint16_t)((entry) - nbr_cache) + 1)
+
+static void nbr_cache_init(void)
+{
+    for (uint16_t i = 0; i < NBR_CACHE_SIZE; i++) {
+        nbr_cache_links[i] = (i + 1 < NBR_CACHE_SIZE) ? i + 2 : 0;
+    }
+
+    nbr_cache_free = (NBR_CACHE_SIZE > 0) ? 1 : 0;
+    nbr_cache_initialized = 1;
+}
+
+static uint16_t ndp_addr_hash(const ipv6_addr_t *addr)
+{
+    /* neighbors share the prefix, so only the IID is hashed; byte-wise,
+     * since entries of the packed cache are not word aligned */
+    uint16_t h = 0;
+
+    for (int i = 8; i < 16; i++) {
+        h = (h << 3) ^ (h >> 13) ^ addr->uint8[i];
+    }
+
+    return h ^ (h >> 8);
+}
+
+static inline uint16_t *nbr_cache_bucket(const ipv6_addr_t *addr)
+{
+    return &nbr_cache_buckets[ndp_addr_hash(addr) & (NBR_CACHE_HASH_BUCKETS - 1)];
+}
+
+static int nbr_cache_elapsed(const timex_t *since, const timex_t *now,
+                             uint32_t ms)
+{
+    timex_t t = timex_add(*since, timex_set(ms / 1000, (ms % 1000) * 1000));
+    return timex_cmp(*now, t) >= 0;
+}
+
+static int nbr_cache_expired(ndp_neighbor_cache_t *nce, const timex_t *now)
+{
+    if ((nce->type == NDP_NCE_TYPE_GC) ||
+        ((nce->ltime.seconds == 0) && (nce->ltime.microseconds == 0))) {
+        return 0;
+    }
+
+    return timex_cmp(*now, nce->ltime) >= 0;
+}
+
+static void nbr_cache_set_state(ndp_neighbor_cache_t *nce,
+                                ndp_nce_state_t state, const timex_t *now)
+{
+    nce->state = state;
+    nce->state_time = *now;
+    nce->probes = 0;
+    nce->probe_pending = 0;
+}
+
+static void nbr_cache_unlink(ndp_neighbor_cache_t *nce)
+{
+    uint16_t target = NBR_CACHE_LINK(nce);
+    uint16_t *link = nbr_cache_bucket(&nce->addr);
+
+    while (*link != 0) {
+        if (*link == target) {
+            *link = nbr_cache_links[target - 1];
+            break;
+        }
+
+        link = &nbr_cache_links[*link - 1];
+    }
+
+    memset(nce, 0, sizeof(ndp_neighbor_cache_t));
+    nbr_cache_links[target - 1] = nbr_cache_free;
+    nbr_cache_free = target;
+    nbr_count--;
+}
+
+/* picks an entry to make room for a new neighbor, only called on a full
+ * cache */
+static ndp_neighbor_cache_t *nbr_cache_victim(const timex_t *now)
+{
+    ndp_neighbor_cache_t *victim = NULL;
+
+    for (uint16_t i = 0; i < NBR_CACHE_SIZE; i++) {
+        ndp_neighbor_cache_t *nce = &nbr_cache[i];
+
+        if (nbr_cache_expired(nce, now)) {
+            return nce;
+        }
+
+        if (nce->type != NDP_NCE_TYPE_GC) {
+            continue;
+        }
+
+        if (nce->state != NDP_NCE_STATUS_REACHABLE) {
+            /* least recently confirmed one of the unconfirmed entries */
+            if ((victim == NULL) || (victim->state == NDP_NCE_STATUS_REACHABLE) ||
+                (timex_cmp(nce->state_time, victim->state_time) < 0)) {
+                victim = nce;
+            }
+        }
+        else if (victim == NULL) {
+            victim = nce;
+        }
+    }
+
+    return victim;
+}
+
 ndp_neighbor_cache_t *ndp_neighbor_cache_search(ipv6_addr_t *ipaddr)
 {
-    int i;
+    if (!nbr_cache_initialized) {
+        return NULL;
+    }
+
+    for (uint16_t link = *nbr_cache_bucket(ipaddr); link != 0;
+         link = nbr_cache_links[link - 1]) {
+        ndp_neighbor_cache_t *nce = NBR_CACHE_ENTRY(link);
+
+        if (memcmp(&(nce->addr.uint8[0]), &(ipaddr->uint8[0]), 16) == 0) {
+            timex_t now;
+            vtimer_now(&now);
 
-    for (i = 0; i < NBR_CACHE_SIZE; i++) {
-        if (memcmp(&(nbr_cache[i].addr.uint8[0]), &(ipaddr->uint8[0]), 16) == 0) {
-            return &nbr_cache[i];
+            if (nbr_cache_expired(nce, &now)) {
+                nbr_cache_unlink(nce);
+                return NULL;
+            }
+
+            return nce;
         }
     }
 
     return NULL;
 }
 
+void ndp_neighbor_cache_reachable(ndp_neighbor_cache_t *nce)
+{
+    timex_t now;
+    vtimer_now(&now);
+    nbr_cache_set_state(nce, NDP_NCE_STATUS_REACHABLE, &now);
+}
+
 ndp_neighbor_cache_t *ndp_get_ll_address(ipv6_addr_t *ipaddr)
 {
     ndp_neighbor_cache_t *nce = ndp_neighbor_cache_search(ipaddr);
+    timex_t now;
 
     if (nce == NULL || nce->type == NDP_NCE_TYPE_GC ||
         nce->state == NDP_NCE_STATUS_INCOMPLETE) {
@@ -1511,9 +1771,66 @@ ndp_neighbor_cache_t *ndp_get_ll_address(ipv6_addr_t *ipaddr)
         return NULL;
     }
 
+    vtimer_now(&now);
+
+    switch (nce->state) {
+        case NDP_NCE_STATUS_REACHABLE:
+            if (nbr_cache_elapsed(&nce->state_time, &now,
+                                  NDP_REACHABLE_TIME_MS)) {
+                /* RFC 4861, 7.3.3: reachable time elapsed, sending to a
+                 * stale entry starts the delay right away */
+                nbr_cache_set_state(nce, NDP_NCE_STATUS_DELAY, &now);
+            }
+
+            break;
+
+        case NDP_NCE_STATUS_STALE:
+            nbr_cache_set_state(nce, NDP_NCE_STATUS_DELAY, &now);
+            break;
+
+        case NDP_NCE_STATUS_DELAY:
+            if (nbr_cache_elapsed(&nce->state_time, &now,
+                                  NDP_DELAY_FIRST_PROBE_TIME_MS)) {
+                nbr_cache_set_state(nce, NDP_NCE_STATUS_PROBE, &now);
+                nce->probe_pending = 1;
+            }
+
+            break;
+
+        case NDP_NCE_STATUS_PROBE:
+            if (nbr_cache_elapsed(&nce->state_time, &now,
+                                  NDP_RETRANS_TIMER_MS)) {
+                if (nce->probes >= NDP_MAX_UNICAST_SOLICIT) {
+                    DEBUG("ndp_get_ll_address: neighbor unreachable\n");
+                    nbr_cache_unlink(nce);
+                    return NULL;
+                }
+
+                nce->state_time = now;
+                nce->probe_pending = 1;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
     return nce;
 }
 
+void ndp_neighbor_cache_probe(ndp_neighbor_cache_t *nce)
+{
+    if ((nce == NULL) || !nce->probe_pending) {
+        return;
+    }
+
+    /* clear first, sending the solicitation looks the entry up again */
+    nce->probe_pending = 0;
+    nce->probes++;
+    icmpv6_send_neighbor_sol(NULL, &nce->addr, &nce->addr, OPT_SLLAO, 0);
+}
+
 int ndp_addr_is_on_link(ipv6_addr_t *dest_addr)
 {
     ndp_prefix_info_t *pi;
@@ -1544,60 +1861,295 @@ uint8_t ndp_neighbor_cache_add(int if_id, const ipv6_addr_t *ipaddr,
                                uint8_t isrouter, ndp_nce_state_t state,
                                ndp_nce_type_t type, uint16_t ltime)
 {
-    (void) ltime;
+    ndp_neighbor_cache_t *nce;
+    timex_t now;
 
-    if (nbr_count == NBR_CACHE_SIZE) {
-        printf("ERROR: neighbor cache full\n");
-        return NDP_OPT_ARO_STATE_NBR_CACHE_FULL;
+    if (!nbr_cache_initialized) {
+        nbr_cache_init();
+    }
+
+    nce = ndp_neighbor_cache_search((ipv6_addr_t *) ipaddr);
+    vtimer_now(&now);
+
+    if (nce == NULL) {
+        if (nbr_cache_free == 0) {
+            nce = nbr_cache_victim(&now);
+
+            if (nce == NULL) {
+                printf("ERROR: neighbor cache full\n");
+                return NDP_OPT_ARO_STATE_NBR_CACHE_FULL;
+            }
+
+            DEBUG("ndp_neighbor_cache_add: evicting entry\n");
+            nbr_cache_unlink(nce);
+        }
+
+        uint16_t *bucket = nbr_cache_bucket(ipaddr);
+        uint16_t link = nbr_cache_free;
+
+        nce = NBR_CACHE_ENTRY(link);
+        nbr_cache_free = nbr_cache_links[link - 1];
+        nbr_cache_links[link - 1] = *bucket;
+        *bucket = link;
+        nbr_count++;
+
+        memcpy(&(nce->addr), ipaddr, 16);
+    }
+
+    nce->if_id = if_id;
+    memcpy(&(nce->lladdr), lladdr, lladdr_len);
+    nce->lladdr_len = lladdr_len;
+    nce->isrouter = isrouter;
+    nce->type = type;
+    nbr_cache_set_state(nce, state, &now);
+
+    if ((type == NDP_NCE_TYPE_GC) || (ltime == 0)) {
+        nce->ltime = timex_set(0, 0);
+    }
+    else {
+        set_remaining_time(&(nce->ltime), ltime);
+    }
+
+    return NDP_OPT_ARO_STATE_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+/* address registration functions */
+
+static void reg_init(void)
+{
+    for (uint16_t i = 0; i < NDP_REG_TABLE_SIZE; i++) {
+        reg_heap[i] = i;
+        reg_heap_pos[i] = i;
+    }
+
+    reg_count = 0;
+    reg_initialized = 1;
+}
+
+static inline uint16_t *reg_bucket(const ipv6_addr_t *addr)
+{
+    return &reg_buckets[ndp_addr_hash(addr) & (NDP_REG_HASH_BUCKETS - 1)];
+}
+
+static void reg_heap_set(uint16_t pos, uint16_t idx)
+{
+    reg_heap[pos] = idx;
+    reg_heap_pos[idx] = pos;
+}
+
+static void reg_heap_up(uint16_t pos)
+{
+    uint16_t idx = reg_heap[pos];
+
+    while (pos > 0) {
+        uint16_t parent = (pos - 1) / 2;
+
+        if (reg_table[reg_heap[parent]].expires <= reg_table[idx].expires) {
+            break;
+        }
+
+        reg_heap_set(pos, reg_heap[parent]);
+        pos = parent;
     }
 
-    nbr_cache[nbr_count].if_id = if_id;
-    memcpy(&(nbr_cache[nbr_count].addr), ipaddr, 16);
-    memcpy(&(nbr_cache[nbr_count].lladdr), lladdr, lladdr_len);
-    nbr_cache[nbr_count].lladdr_len = lladdr_len;
-    nbr_cache[nbr_count].isrouter = isrouter;
-    nbr_cache[nbr_count].state = state;
-    nbr_cache[nbr_count].type = type;
+    reg_heap_set(pos, idx);
+}
+
+static void reg_heap_down(uint16_t pos)
+{
+    uint16_t idx = reg_heap[pos];
 
-    //vtimer_set_wakeup(&(nbr_cache[nbr_count].ltime), t,
-    /*                  nd_nbr_cache_rem_pid); */
+    for (;;) {
+        uint16_t child = 2 * pos + 1;
 
-    nbr_count++;
+        if (child >= reg_count) {
+            break;
+        }
+
+        if ((child + 1 < reg_count) &&
+            (reg_table[reg_heap[child + 1]].expires <
+             reg_table[reg_heap[child]].expires)) {
+            child++;
+        }
+
+        if (reg_table[idx].expires <= reg_table[reg_heap[child]].expires) {
+            break;
+        }
+
+        reg_heap_set(pos, reg_heap[child]);
+        pos = child;
+    }
+
+    reg_heap_set(pos, idx);
+}
+
+/* restores the heap after the expiry of the entry at *pos* changed */
+static void reg_heap_fix(uint16_t pos)
+{
+    uint16_t idx = reg_heap[pos];
+
+    reg_heap_up(pos);
+
+    if (reg_heap_pos[idx] == pos) {
+        reg_heap_down(pos);
+    }
+}
+
+static void reg_remove(uint16_t idx)
+{
+    uint16_t *link = reg_bucket(&reg_table[idx].addr);
+    uint16_t pos = reg_heap_pos[idx];
+
+    while (*link != 0) {
+        if (*link == idx + 1) {
+            *link = reg_links[idx];
+            break;
+        }
+
+        link = &reg_links[*link - 1];
+    }
+
+    /* the last registration takes its place, it goes to the free ones */
+    reg_count--;
+
+    if (pos != reg_count) {
+        reg_heap_set(pos, reg_heap[reg_count]);
+        reg_heap_set(reg_count, idx);
+        reg_heap_fix(pos);
+    }
+}
+
+static void reg_expire(uint32_t now)
+{
+    if (!reg_initialized) {
+        return;
+    }
+
+    while ((reg_count > 0) && (reg_table[reg_heap[0]].expires <= now)) {
+        DEBUG("reg_expire: registration %u expired\n", reg_heap[0]);
+        reg_remove(reg_heap[0]);
+    }
+}
+
+static int32_t reg_find(const ipv6_addr_t *addr)
+{
+    for (uint16_t link = *reg_bucket(addr); link != 0;
+         link = reg_links[link - 1]) {
+        if (ipv6_addr_is_equal(&reg_table[link - 1].addr, addr)) {
+            return link - 1;
+        }
+    }
+
+    return -1;
+}
+
+uint8_t ndp_registration_update(const ipv6_addr_t *addr,
+                                const ieee_802154_long_t *eui64,
+                                uint16_t ltime)
+{
+    timex_t now;
+    int32_t idx;
+
+    if (!reg_initialized) {
+        reg_init();
+    }
+
+    vtimer_now(&now);
+    reg_expire(now.seconds);
+
+    if ((idx = reg_find(addr)) >= 0) {
+        if (memcmp(&reg_table[idx].eui64, eui64, sizeof(*eui64)) != 0) {
+            return NDP_OPT_ARO_STATE_DUP_ADDR;
+        }
+
+        if (ltime == 0) {
+            reg_remove(idx);
+        }
+        else {
+            reg_table[idx].expires = now.seconds + (uint32_t) ltime * 60;
+            reg_heap_fix(reg_heap_pos[idx]);
+        }
+
+        return NDP_OPT_ARO_STATE_SUCCESS;
+    }
+
+    if (ltime == 0) {
+        return NDP_OPT_ARO_STATE_SUCCESS;
+    }
+
+    if (reg_count >= NDP_REG_TABLE_SIZE) {
+        DEBUG("ndp_registration_update: registration table full\n");
+        return NDP_OPT_ARO_STATE_NBR_CACHE_FULL;
+    }
+
+    uint16_t *bucket = reg_bucket(addr);
+
+    idx = reg_heap[reg_count];
+    memcpy(&reg_table[idx].addr, addr, sizeof(ipv6_addr_t));
+    memcpy(&reg_table[idx].eui64, eui64, sizeof(*eui64));
+    reg_table[idx].expires = now.seconds + (uint32_t) ltime * 60;
+    reg_links[idx] = *bucket;
+    *bucket = idx + 1;
+    reg_heap_up(reg_count++);
 
     return NDP_OPT_ARO_STATE_SUCCESS;
 }
 
+const ieee_802154_long_t *ndp_registration_lookup(const ipv6_addr_t *addr)
+{
+    timex_t now;
+    int32_t idx;
+
+    if (!reg_initialized) {
+        return NULL;
+    }
+
+    vtimer_now(&now);
+    reg_expire(now.seconds);
+
+    if ((idx = reg_find(addr)) < 0) {
+        return NULL;
+    }
+
+    return &reg_table[idx].eui64;
+}
+
+uint16_t ndp_registration_count(void)
+{
+    return reg_count;
+}
+
 void nbr_cache_auto_rem(void)
 {
-    int i;
+    timex_t now;
+
+    if (!nbr_cache_initialized) {
+        return;
+    }
 
-    for (i = 0; i < NBR_CACHE_SIZE; i++) {
-        if (get_remaining_time(&(nbr_cache[i].ltime)) == 0 &&
-            nbr_cache[i].type == NDP_NCE_TYPE_TENTATIVE) {
-            memmove(&(nbr_cache[i]), &(nbr_cache[nbr_count]),
-                    sizeof(ndp_neighbor_cache_t));
-            memset(&(nbr_cache[nbr_count]), 0, sizeof(ndp_neighbor_cache_t));
-            nbr_count--;
+    vtimer_now(&now);
+
+    /* entries also expire lazily on lookup, this just reclaims their room */
+    for (uint16_t i = 0; i < NBR_CACHE_SIZE; i++) {
+        if ((nbr_cache[i].type != 0) && nbr_cache_expired(&nbr_cache[i], &now)) {
+            nbr_cache_unlink(&nbr_cache[i]);
         }
     }
+
+    reg_expire(now.seconds);
 }
 
 uint8_t ndp_neighbor_cache_remove(const ipv6_addr_t *ipaddr)
 {
-    int i;
-    uint8_t removed = 0;
+    ndp_neighbor_cache_t *nce = ndp_neighbor_cache_search((ipv6_addr_t *) ipaddr);
 
-    for (i = 0; i < NBR_CACHE_SIZE; i++) {
-        if (memcmp(&(nbr_cache[i].addr.uint8[0]), &(ipaddr->uint8[0]), 16) == 0) {
-            memmove(&(nbr_cache[i]), &(nbr_cache[nbr_count]),
-                    sizeof(ndp_neighbor_cache_t));
-            memset(&(nbr_cache[nbr_count]), 0, sizeof(ndp_neighbor_cache_t));
-            nbr_count--;
-            removed = 1;
-        }
+    if (nce == NULL) {
+        return 0;
     }
 
-    return removed;
+    nbr_cache_unlink(nce);
+    return 1;
 }
 
 //------------------------------------------------------------------------------
@@ -1611,50 +2163,54 @@ uint8_t ndp_neighbor_cache_remove(const ipv6_addr_t *ipaddr)
  */
 ndp_a6br_cache_t *ndp_a6br_cache_get_most_current(void)
 {
-    ndp_a6br_cache_t *abr = NULL;
-    int i;
-    int version = abr_cache[0].version;
-
-    for (i = 0; i < abr_count; i++) {
-        if (serial_comp16(version, abr_cache[i].version) == GREATER) {
-            abr = &(abr_cache[i]);
-            version = abr_cache[i].version;
-        }
-    }
-
-    return abr;
+    return (abr_count > 0) ? &abr_cache[abr_order[0]] : NULL;
 }
 
 ndp_a6br_cache_t *ndp_a6br_cache_get_oldest(void)
 {
-    ndp_a6br_cache_t *abr = NULL;
-    int i;
-    int version = abr_cache[0].version;
+    return (abr_count > 0) ? &abr_cache[abr_order[abr_count - 1]] : NULL;
+}
 
-    for (i = 0; i < abr_count; i++) {
-        if (serial_comp16(version, abr_cache[i].version) == LESS) {
-            abr = &(abr_cache[i]);
-            version = abr_cache[i].version;
+ndp_a6br_cache_t *abr_get_version(uint16_t version, ipv6_addr_t *abr_addr)
+{
+    /* older versions follow, so the search stops at the first of them */
+    for (int i = 0; i < abr_count; i++) {
+        ndp_a6br_cache_t *abr = &abr_cache[abr_order[i]];
+
+        if (abr->version == version) {
+            if (ipv6_addr_is_equal(&abr->abr_addr, abr_addr)) {
+                return abr;
+            }
+        }
+        else if (serial_comp16(abr->version, version) == LESS) {
+            break;
         }
     }
 
-    return abr;
+    return NULL;
 }
 
-ndp_a6br_cache_t *abr_get_version(uint16_t version, ipv6_addr_t *abr_addr)
+/* sorts abr_cache[idx] into abr_order, which holds it at position pos */
+static void abr_order_insert(uint8_t pos)
 {
-    int i = 0;
+    uint8_t idx = abr_order[pos];
+    uint16_t version = abr_cache[idx].version;
+
+    /* take it out */
+    for (; pos + 1 < abr_count; pos++) {
+        abr_order[pos] = abr_order[pos + 1];
+    }
 
-    for (i = 0; i < ABR_CACHE_SIZE; i++) {
-        if (abr_cache[i].version == version &&
-            memcmp(&(abr_cache[i].abr_addr.uint8[0]),
-                   &(abr_addr->uint8[0]), 16
-                  ) == 0) {
-            return &(abr_cache[i]);
+    /* and put it in front of the first older one */
+    for (pos = abr_count - 1; pos > 0; pos--) {
+        if (serial_comp16(abr_cache[abr_order[pos - 1]].version, version) != LESS) {
+            break;
         }
+
+        abr_order[pos] = abr_order[pos - 1];
     }
 
-    return NULL;
+    abr_order[pos] = idx;
 }
 
 lowpan_context_t *abr_get_context(ndp_a6br_cache_t *abr, uint8_t cid)
@@ -1666,29 +2222,45 @@ lowpan_context_t *abr_get_context(ndp_a6br_cache_t *abr, uint8_t cid)
     return lowpan_context_num_lookup(abr->cids[cid]);
 }
 
-ndp_a6br_cache_t *abr_add_context(uint16_t version, ipv6_addr_t *abr_addr,
-                                  uint8_t cid)
+ndp_a6br_cache_t *abr_add_contexts(uint16_t version, ipv6_addr_t *abr_addr,
+                                   const uint8_t *cids, uint8_t num)
 {
     ndp_a6br_cache_t *abr = abr_get_version(version, abr_addr);
 
     if (abr == NULL) {
+        uint8_t pos;
+
         if (abr_count == ABR_CACHE_SIZE) {
-            abr = ndp_a6br_cache_get_oldest();
+            /* replaces the oldest */
+            pos = abr_count - 1;
         }
         else {
-            abr = &(abr_cache[abr_count++]);
+            pos = abr_count;
+            abr_order[pos] = abr_count++;
         }
 
+        abr = &abr_cache[abr_order[pos]];
         abr->version = version;
         memcpy(&(abr->abr_addr), abr_addr, sizeof(ipv6_addr_t));
         memset(abr->cids, 0xFF, NDP_6LOWPAN_CONTEXT_MAX);
+        abr_order_insert(pos);
     }
 
-    abr->cids[cid] = cid;
+    for (uint8_t i = 0; i < num; i++) {
+        abr->cids[cids[i]] = cids[i];
+    }
+
+    rtr_adv_gen++;
 
     return abr;
 }
 
+ndp_a6br_cache_t *abr_add_context(uint16_t version, ipv6_addr_t *abr_addr,
+                                  uint8_t cid)
+{
+    return abr_add_contexts(version, abr_addr, &cid, 1);
+}
+
 void abr_remove_context(uint8_t cid)
 {
     int i;
@@ -1696,6 +2268,8 @@ void abr_remove_context(uint8_t cid)
     for (i = 0; i < abr_count; i++) {
         abr_cache[i].cids[cid] = 0xFF;
     }
+
+    rtr_adv_gen++;
 }
 
 //------------------------------------------------------------------------------
@@ -1703,11 +2277,8 @@ void abr_remove_context(uint8_t cid)
 
 ndp_default_router_list_t *ndp_default_router_list_search(ipv6_addr_t *ipaddr)
 {
-    int i;
-
-    for (i = 0; i < DEF_RTR_LST_SIZE; i++) {
-        if (memcmp(&def_rtr_lst[i].addr.uint8[0],
-                   &(ipaddr->uint8[0]), 16) == 0) {
+    for (int i = 0; i < def_rtr_count; i++) {
+        if (ipv6_addr_is_equal(&def_rtr_lst[i].addr, ipaddr)) {
             return &def_rtr_lst[i];
         }
     }
@@ -1728,25 +2299,61 @@ void def_rtr_lst_add(ipv6_addr_t *ipaddr, uint32_t rtr_ltime)
 
         def_rtr_lst[def_rtr_count].inval_time = timex_add(now, rltime);
 
+        if (def_rtr_pref == NULL) {
+            def_rtr_pref = &def_rtr_lst[def_rtr_count];
+        }
+
         def_rtr_count++;
     }
 }
 
 void def_rtr_lst_rem(ndp_default_router_list_t *entry)
 {
-    int i;
+    ndp_default_router_list_t *last = &def_rtr_lst[def_rtr_count - 1];
+
+    if ((entry < def_rtr_lst) || (entry > last)) {
+        return;
+    }
+
+    /* the last entry takes the place of the removed one */
+    if (def_rtr_pref == last) {
+        def_rtr_pref = entry;
+    }
+    else if (def_rtr_pref == entry) {
+        def_rtr_pref = NULL;
+    }
+
+    memmove(entry, last, sizeof(ndp_default_router_list_t));
+    memset(last, 0, sizeof(ndp_default_router_list_t));
+    def_rtr_count--;
 
-    for (i = 0; i < DEF_RTR_LST_SIZE; i++) {
-        if (&def_rtr_lst[i] == entry) {
-            /* search the to deleted item, then memmove the last item to its
-             * position, and decrement array count */
-            memmove(entry, &def_rtr_lst[def_rtr_count], sizeof(ndp_default_router_list_t));
-            memset(&def_rtr_lst[def_rtr_count], 0, sizeof(ndp_default_router_list_t));
-            def_rtr_count--;
+    if ((def_rtr_pref == NULL) && def_rtr_count) {
+        /* the one valid for the longest time follows */
+        def_rtr_pref = &def_rtr_lst[0];
+
+        for (int i = 1; i < def_rtr_count; i++) {
+            if (timex_cmp(def_rtr_lst[i].inval_time, def_rtr_pref->inval_time) > 0) {
+                def_rtr_pref = &def_rtr_lst[i];
+            }
         }
     }
 }
 
+ndp_default_router_list_t *ndp_default_router_get_preferred(void)
+{
+    timex_t now;
+
+    vtimer_now(&now);
+
+    /* routers are dropped when they are asked for after their lifetime */
+    while ((def_rtr_pref != NULL) &&
+           (timex_cmp(def_rtr_pref->inval_time, now) <= 0)) {
+        def_rtr_lst_rem(def_rtr_pref);
+    }
+
+    return def_rtr_pref;
+}
+
 //------------------------------------------------------------------------------
 /* prefix information functions */
 
@@ -1764,6 +2371,7 @@ int ndp_add_prefix_info(int if_id, const ipv6_addr_t *prefix,
         prefix_info->flags = 0xc0 & flags;
         prefix_info->valid_lifetime = HTONL(valid_lifetime);
         prefix_info->preferred_lifetime = HTONL(preferred_lifetime);
+        rtr_adv_gen++;
 
         return SIXLOWERROR_SUCCESS;
     }
@@ -1798,6 +2406,11 @@ int ndp_add_prefix_info(int if_id, const ipv6_addr_t *prefix,
         return SIXLOWERROR_VALUE;
     }
 
+    if (ipv6_lpm_add(&prefix_info_tries[if_id], prefix, prefix_len,
+                     prefix_info) < 0) {
+        DEBUG("ndp_add_prefix_info: no trie node left for prefix\n");
+    }
+
     prefix_info_count++;
 
     return SIXLOWERROR_SUCCESS;
@@ -1806,57 +2419,27 @@ int ndp_add_prefix_info(int if_id, const ipv6_addr_t *prefix,
 ndp_prefix_info_t *ndp_prefix_info_search(int if_id, const ipv6_addr_t *addr,
         uint8_t up_to)
 {
-    uint8_t best_match = 0;
-    ndp_prefix_info_t *prefix = NULL, *tmp = NULL;
+    if ((if_id < 0) || (if_id >= NET_IF_MAX)) {
+        return NULL;
+    }
 
     if (up_to > 128) {
         up_to = 128;
     }
 
-    while (net_if_iter_addresses(if_id, (net_if_addr_t **) &prefix)) {
-        if (prefix->prefix_protocol & NET_IF_L3P_IPV6_PREFIX) {
-            uint8_t match = 0, len = min(up_to, prefix->prefix_len);
-            uint8_t byte_len = (len / 8);
-
-            for (int i = 0; i < byte_len; i++) {
-                if (addr->uint8[i] != prefix->prefix_data->uint8[i]) {
-                    break;
-                }
-
-                match += 8;
-            }
-
-            if (byte_len < 16) {
-                for (int i = len % 8; i > 0; i--) {
-                    if (addr->uint8[byte_len] >> i !=
-                        prefix->prefix_data->uint8[byte_len] >> i) {
-                        break;
-                    }
-
-                    match += 1;
-                }
-            }
-
-            if (prefix->prefix_len == 0 && match > best_match) {
-                tmp = prefix;
-                best_match = match;
-            }
-        }
-    }
-
-    return tmp;
+    return ipv6_lpm_lookup(&prefix_info_tries[if_id], addr, up_to, NULL);
 }
 
 ndp_prefix_info_t *ndp_prefix_info_match(int if_id, const ipv6_addr_t *prefix,
         uint8_t prefix_len)
 {
-    ndp_prefix_info_t *res = ndp_prefix_info_search(if_id, prefix,
-                             prefix_len);
-
-    if (res != NULL && res->prefix_len == prefix_len) {
-        return res;
-    }
-    else {
+    if ((if_id < 0) || (if_id >= NET_IF_MAX)) {
         return NULL;
     }
+
+    if (prefix_len > 128) {
+        prefix_len = 128;
+    }
+
+    return ipv6_lpm_exact(&prefix_info_tries[if_id], prefix, prefix_len);
 }
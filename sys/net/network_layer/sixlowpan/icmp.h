@@ -55,5 +55,7 @@ void recv_nbr_sol(void);
 void nbr_cache_auto_rem(void);
 ndp_a6br_cache_t *abr_add_context(uint16_t version, ipv6_addr_t *abr_addr,
                                   uint8_t cid);
+ndp_a6br_cache_t *abr_add_contexts(uint16_t version, ipv6_addr_t *abr_addr,
+                                   const uint8_t *cids, uint8_t num);
 void abr_remove_context(uint8_t cid);
 #endif /* _SIXLOWPAN_ICMP_H*/
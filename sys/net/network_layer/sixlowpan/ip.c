@@ -22,16 +22,23 @@
 #include <string.h>
 #include <errno.h>
 
+#include "irq.h"
 #include "vtimer.h"
 #include "mutex.h"
 #include "msg.h"
+#include "thread.h"
 #include "net_help.h"
 #include "net_if.h"
+#include "pubsub.h"
+#include "netstat.h"
+#include "pktbuf.h"
 #include "sixlowpan/mac.h"
 
 #include "ip.h"
 #include "icmp.h"
 #include "lowpan.h"
+#include "ipv6_lpm.h"
+#include "srh.h"
 
 #include "net_help.h"
 
@@ -48,35 +55,320 @@ char addr_str[IPV6_MAX_ADDR_STR_LEN];
 
 uint8_t ip_send_buffer[BUFFER_SIZE];
 uint8_t buffer[BUFFER_SIZE];
+#if !SIXLOWPAN_RUN_TO_COMPLETION
 msg_t ip_msg_queue[IP_PKT_RECV_BUF_SIZE];
+#endif
 ipv6_hdr_t *ipv6_buf;
 icmpv6_hdr_t *icmp_buf;
 uint8_t *nextheader;
 
 int udp_packet_handler_pid = 0;
 int tcp_packet_handler_pid = 0;
+static ipv6_next_header_cb_t udp_packet_handler_cb;
+static ipv6_next_header_cb_t tcp_packet_handler_cb;
 int rpl_process_pid = 0;
 ipv6_addr_t *(*ip_get_next_hop)(ipv6_addr_t *) = 0;
+static ipv6_addr_t *(*ip_get_next_hop_class)(ipv6_addr_t *, uint8_t) = NULL;
+int (*ip_get_source_route)(ipv6_addr_t *, ipv6_addr_t *, uint8_t) = 0;
+static int (*ip_mcast_forwarder)(ipv6_hdr_t *) = NULL;
 
 static ipv6_net_if_ext_t ipv6_net_if_ext[NET_IF_MAX];
 static ipv6_net_if_addr_t ipv6_net_if_addr_buffer[IPV6_NET_IF_ADDR_BUFFER_LEN];
 static ipv6_addr_t ipv6_addr_buffer[IPV6_NET_IF_ADDR_BUFFER_LEN];
 static uint8_t ipv6_net_if_addr_buffer_count = 0;
+/* global unicast and anycast addresses per interface for source selection,
+ * rebuilt from the address list when its generation changed */
+static ipv6_lpm_t ipv6_net_if_src_tries[NET_IF_MAX];
+static uint16_t ipv6_net_if_src_tries_gen[NET_IF_MAX];
 
 static uint8_t default_hop_limit = MULTIHOP_HOPLIMIT;
 
 /* registered upper layer threads */
-int sixlowip_reg[SIXLOWIP_MAX_REGISTERED];
+ipv6_listener_t sixlowip_reg[SIXLOWIP_MAX_REGISTERED];
 
-int ipv6_send_packet(ipv6_hdr_t *packet)
+/*
+ * Copies of received packets, published once to all registered threads.
+ * A packet is not copied and the drops of every listener are counted if
+ * a copy is still held, so a slow listener never stalls the receive path.
+ */
+static uint8_t ipv6_tap_buf[IPV6_TAP_BUFFERS][IPV6_MTU];
+static pubsub_event_t ipv6_tap_events[IPV6_TAP_BUFFERS];
+static pubsub_topic_t ipv6_tap = PUBSUB_TOPIC_INIT(ipv6_tap_events,
+                                                   IPV6_TAP_BUFFERS);
+
+/* hands *packet* to the registered threads without blocking */
+static void ipv6_tap_packet(const ipv6_hdr_t *packet)
+{
+    uint16_t len = IPV6_HDR_LEN + NTOHS(packet->length);
+    pubsub_event_t *event;
+
+    if ((ipv6_tap.subs_numof == 0) || (len > IPV6_MTU)) {
+        return;
+    }
+
+    event = pubsub_reserve(&ipv6_tap);
+
+    if (event == NULL) {
+        return;
+    }
+
+    event->data = ipv6_tap_buf[event - ipv6_tap_events];
+    memcpy(event->data, packet, len);
+    pubsub_publish(&ipv6_tap, event);
+}
+
+/*
+ * Results of is_our_address() and ipv6_net_if_get_best_src_addr() for
+ * recently seen addresses. An entry holds as long as the address lists
+ * of the interfaces keep the generation it was computed with.
+ */
+static struct {
+    ipv6_addr_t addr;
+    uint16_t gen;
+    uint8_t local;
+} ipv6_local_cache[IPV6_ADDR_CACHE_SIZE];
+
+static struct {
+    ipv6_addr_t dest;
+    ipv6_addr_t src;
+    uint16_t gen;
+} ipv6_src_cache[IPV6_ADDR_CACHE_SIZE];
+
+static uint8_t ipv6_local_cache_next = 0;
+static uint8_t ipv6_src_cache_next = 0;
+
+static void ipv6_addr_cache_flush(void)
+{
+    unsigned state = disableIRQ();
+
+    for (uint8_t i = 0; i < IPV6_ADDR_CACHE_SIZE; i++) {
+        ipv6_local_cache[i].gen = 0;
+        ipv6_src_cache[i].gen = 0;
+    }
+
+    restoreIRQ(state);
+}
+
+#if IPV6_MCAST_GROUPS_NUMOF & (IPV6_MCAST_GROUPS_NUMOF - 1)
+#error "IPV6_MCAST_GROUPS_NUMOF must be a power of two"
+#endif
+
+/*
+ * Multicast groups joined, open addressing on the group ID in the last
+ * 32 bit. A left group stays as a tombstone, so probing continues past it;
+ * flags and scope fill the first octets of a used slot.
+ */
+#define MCAST_FREE      (0)
+#define MCAST_LEFT      (1)
+
+static ipv6_addr_t ipv6_mcast_groups[IPV6_MCAST_GROUPS_NUMOF];
+
+static unsigned ipv6_mcast_slot(const ipv6_addr_t *group)
+{
+    uint32_t h = group->uint32[3] ^ group->uint32[0];
+
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h & (IPV6_MCAST_GROUPS_NUMOF - 1);
+}
+
+/* the slot of *group*, or with *free* set the first one it may go to */
+static ipv6_addr_t *ipv6_mcast_find(const ipv6_addr_t *group, int free)
+{
+    unsigned i = ipv6_mcast_slot(group);
+    ipv6_addr_t *tomb = NULL;
+
+    for (unsigned n = 0; n < IPV6_MCAST_GROUPS_NUMOF; n++) {
+        ipv6_addr_t *slot = &ipv6_mcast_groups[(i + n) & (IPV6_MCAST_GROUPS_NUMOF - 1)];
+
+        if (slot->uint8[0] == MCAST_FREE) {
+            return free ? (tomb ? tomb : slot) : NULL;
+        }
+
+        if (slot->uint8[0] == MCAST_LEFT) {
+            if (tomb == NULL) {
+                tomb = slot;
+            }
+        }
+        else if (ipv6_addr_is_equal(slot, group)) {
+            return slot;
+        }
+    }
+
+    return free ? tomb : NULL;
+}
+
+int ipv6_mcast_join(const ipv6_addr_t *group)
+{
+    ipv6_addr_t *slot;
+
+    if (!ipv6_addr_is_multicast(group)) {
+        return 0;
+    }
+
+    unsigned state = disableIRQ();
+
+    if ((slot = ipv6_mcast_find(group, 0)) == NULL) {
+        if ((slot = ipv6_mcast_find(group, 1)) != NULL) {
+            memcpy(slot, group, sizeof(ipv6_addr_t));
+        }
+    }
+
+    restoreIRQ(state);
+    return slot != NULL;
+}
+
+void ipv6_mcast_leave(const ipv6_addr_t *group)
+{
+    unsigned state = disableIRQ();
+    ipv6_addr_t *slot = ipv6_mcast_find(group, 0);
+
+    if (slot != NULL) {
+        memset(slot, 0, sizeof(ipv6_addr_t));
+        slot->uint8[0] = MCAST_LEFT;
+    }
+
+    restoreIRQ(state);
+}
+
+int ipv6_mcast_is_member(const ipv6_addr_t *group)
+{
+    unsigned state = disableIRQ();
+    int res = ipv6_addr_is_multicast(group) &&
+              (ipv6_mcast_find(group, 0) != NULL);
+
+    restoreIRQ(state);
+    return res;
+}
+
+/* next hops of recently forwarded and sent packets, see
+ * ipv6_fwd_cache_lookup() */
+static ipv6_fwd_entry_t ipv6_fwd_cache[IPV6_FWD_CACHE_SIZE];
+static uint8_t ipv6_fwd_cache_next = 0;
+
+static void ipv6_fwd_cache_store(const ipv6_addr_t *dest, uint8_t tclass,
+                                 const ndp_neighbor_cache_t *nce)
+{
+    ipv6_fwd_entry_t *e = NULL;
+    timex_t now;
+
+    for (uint8_t i = 0; i < IPV6_FWD_CACHE_SIZE; i++) {
+        if ((ipv6_fwd_cache[i].tclass == tclass) &&
+            ipv6_addr_is_equal(&ipv6_fwd_cache[i].dest, dest)) {
+            e = &ipv6_fwd_cache[i];
+            break;
+        }
+    }
+
+    if (e == NULL) {
+        e = &ipv6_fwd_cache[ipv6_fwd_cache_next];
+        ipv6_fwd_cache_next = (ipv6_fwd_cache_next + 1) % IPV6_FWD_CACHE_SIZE;
+    }
+
+    vtimer_now(&now);
+
+    memcpy(&e->dest, dest, sizeof(e->dest));
+    e->tclass = tclass;
+    memcpy(e->lladdr, nce->lladdr, sizeof(e->lladdr));
+    e->lladdr_len = nce->lladdr_len;
+    e->if_id = nce->if_id;
+    e->expires = now.seconds + IPV6_FWD_CACHE_LIFETIME;
+}
+
+static void ipv6_fwd_cache_flush(void)
+{
+    memset(ipv6_fwd_cache, 0, sizeof(ipv6_fwd_cache));
+}
+
+static ipv6_fwd_entry_t *ipv6_fwd_cache_find(const ipv6_addr_t *dest,
+                                             uint8_t tclass)
+{
+    timex_t now;
+
+    for (uint8_t i = 0; i < IPV6_FWD_CACHE_SIZE; i++) {
+        ipv6_fwd_entry_t *e = &ipv6_fwd_cache[i];
+
+        if (e->lladdr_len && (e->tclass == tclass) &&
+            ipv6_addr_is_equal(&e->dest, dest)) {
+            vtimer_now(&now);
+
+            if ((int32_t)(e->expires - now.seconds) <= 0) {
+                e->lladdr_len = 0;
+                return NULL;
+            }
+
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+const ipv6_fwd_entry_t *ipv6_fwd_cache_lookup(const ipv6_addr_t *dest,
+                                              uint8_t tclass)
+{
+    if (ipv6_tap.subs_numof > 0) {
+        /* the handlers see every packet */
+        return NULL;
+    }
+
+    return ipv6_fwd_cache_find(dest, tclass);
+}
+
+/* next hop of packet from the routing provider, NULL if it knows none */
+static ipv6_addr_t *ipv6_next_hop(ipv6_hdr_t *packet)
+{
+    if (ip_get_next_hop_class != NULL) {
+        return ip_get_next_hop_class(&packet->destaddr,
+                                     ipv6_get_traffic_class(packet));
+    }
+
+    return ip_get_next_hop(&packet->destaddr);
+}
+
+/* Source routes the packet if the provider knows a route to its destination.
+ * Returns 1 if the packet now goes to a neighbor, 0 if it is to be routed
+ * hop by hop and -1 if it does not fit. */
+static int ipv6_source_route(ipv6_hdr_t *packet)
 {
-    uint16_t length = IPV6_HDR_LEN + NTOHS(packet->length);
+    ipv6_addr_t hops[IPV6_SRH_MAX_HOPS];
+    int numof;
+
+    if ((ip_get_source_route == NULL) ||
+        ipv6_addr_is_multicast(&packet->destaddr) ||
+        (packet->nextheader == IPV6_PROTO_NUM_ROUTING)) {
+        return 0;
+    }
+
+    numof = ip_get_source_route(&packet->destaddr, hops, IPV6_SRH_MAX_HOPS);
+
+    if (numof < 0) {
+        return 0;
+    }
+
+    if ((numof > 0) && (ipv6_srh_insert(packet, hops, numof) < 0)) {
+        return -1;
+    }
+
+    return 1;
+}
+
+/* sends a packet whose source address is set already */
+static int ipv6_send_packet_from(ipv6_hdr_t *packet)
+{
+    uint16_t length;
     ndp_neighbor_cache_t *nce;
+    int direct;
 
-    ipv6_net_if_get_best_src_addr(&packet->srcaddr, &packet->destaddr);
+    if ((direct = ipv6_source_route(packet)) < 0) {
+        NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_ROUTE);
+        return -1;
+    }
+
+    length = IPV6_HDR_LEN + NTOHS(packet->length);
 
-    if (!ipv6_addr_is_multicast(&packet->destaddr) &&
-        ndp_addr_is_on_link(&packet->destaddr)) {
+    if (direct || (!ipv6_addr_is_multicast(&packet->destaddr) &&
+                   ndp_addr_is_on_link(&packet->destaddr))) {
         /* not multicast, on-link */
         nce = ndp_get_ll_address(&packet->destaddr);
 
@@ -91,6 +383,9 @@ int ipv6_send_packet(ipv6_hdr_t *packet)
             /* return -1; */
         }
 
+        ndp_neighbor_cache_probe(nce);
+
+        NETSTAT_TX(NETSTAT_LAYER_IPV6);
         return length;
     }
     else {
@@ -98,17 +393,33 @@ int ipv6_send_packet(ipv6_hdr_t *packet)
         if (ipv6_addr_is_multicast(&packet->destaddr)) {
             /* if_id will be ignored */
             uint16_t addr = 0xffff;
+            NETSTAT_TX(NETSTAT_LAYER_IPV6);
             return sixlowpan_lowpan_sendto(0, &addr, 2, (uint8_t *)packet,
                                            length);
         }
 
-        if (ip_get_next_hop == NULL) {
+        if (packet->nextheader != IPV6_PROTO_NUM_ROUTING) {
+            const ipv6_fwd_entry_t *e =
+                ipv6_fwd_cache_find(&packet->destaddr,
+                                    ipv6_get_traffic_class(packet));
+
+            if ((e != NULL) &&
+                (sixlowpan_lowpan_sendto(e->if_id, e->lladdr, e->lladdr_len,
+                                         (uint8_t *)packet, length) >= 0)) {
+                NETSTAT_TX(NETSTAT_LAYER_IPV6);
+                return length;
+            }
+        }
+
+        if ((ip_get_next_hop == NULL) && (ip_get_next_hop_class == NULL)) {
+            NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_ROUTE);
             return -1;
         }
 
-        ipv6_addr_t *dest = ip_get_next_hop(&packet->destaddr);
+        ipv6_addr_t *dest = ipv6_next_hop(packet);
 
         if (dest == NULL) {
+            NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_ROUTE);
             return -1;
         }
 
@@ -123,11 +434,39 @@ int ipv6_send_packet(ipv6_hdr_t *packet)
             sixlowpan_lowpan_sendto(0, &raddr, 2, (uint8_t *)packet, length);
             /* return -1; */
         }
+        else if (packet->nextheader != IPV6_PROTO_NUM_ROUTING) {
+            ipv6_fwd_cache_store(&packet->destaddr,
+                                 ipv6_get_traffic_class(packet), nce);
+        }
+
+        ndp_neighbor_cache_probe(nce);
 
+        NETSTAT_TX(NETSTAT_LAYER_IPV6);
         return length;
     }
 }
 
+int ipv6_send_packet(ipv6_hdr_t *packet)
+{
+    ipv6_net_if_get_best_src_addr(&packet->srcaddr, &packet->destaddr);
+    return ipv6_send_packet_from(packet);
+}
+
+uint8_t ipv6_get_priority(const ipv6_hdr_t *hdr)
+{
+    if (hdr->nextheader == IPV6_PROTO_NUM_ICMPV6) {
+        const icmpv6_hdr_t *icmp = (const icmpv6_hdr_t *)((const uint8_t *) hdr +
+                                                          IPV6_HDR_LEN);
+
+        if ((icmp->type != ICMPV6_TYPE_ECHO_REQUEST) &&
+            (icmp->type != ICMPV6_TYPE_ECHO_REPLY)) {
+            return TRANSCEIVER_TX_PRIO_CONTROL;
+        }
+    }
+
+    return ipv6_traffic_class_priority(ipv6_get_traffic_class(hdr));
+}
+
 ipv6_hdr_t *ipv6_get_buf_send(void)
 {
     return ((ipv6_hdr_t *) &ip_send_buffer[LL_HDR_LEN]);
@@ -153,8 +492,8 @@ uint8_t *get_payload_buf(uint8_t ext_len)
     return &(buffer[LLHDR_IPV6HDR_LEN + ext_len]);
 }
 
-int ipv6_sendto(const ipv6_addr_t *dest, uint8_t next_header,
-                const uint8_t *payload, uint16_t payload_length)
+static ipv6_hdr_t *ipv6_prepare(const ipv6_addr_t *dest, uint8_t next_header,
+                                const uint8_t *payload, uint16_t payload_length)
 {
     uint8_t *p_ptr;
 
@@ -178,7 +517,36 @@ int ipv6_sendto(const ipv6_addr_t *dest, uint8_t next_header,
 
     memcpy(p_ptr, payload, payload_length);
 
-    return ipv6_send_packet(ipv6_buf);
+    return ipv6_buf;
+}
+
+int ipv6_sendto(const ipv6_addr_t *dest, uint8_t next_header,
+                const uint8_t *payload, uint16_t payload_length)
+{
+    return ipv6_send_packet(ipv6_prepare(dest, next_header, payload,
+                                         payload_length));
+}
+
+int ipv6_sendto_class(const ipv6_addr_t *dest, uint8_t next_header,
+                      uint8_t traffic_class, const uint8_t *payload,
+                      uint16_t payload_length)
+{
+    ipv6_hdr_t *packet = ipv6_prepare(dest, next_header, payload,
+                                      payload_length);
+
+    ipv6_set_traffic_class(packet, traffic_class);
+    return ipv6_send_packet(packet);
+}
+
+int ipv6_sendto_from(const ipv6_addr_t *src, const ipv6_addr_t *dest,
+                     uint8_t next_header, const uint8_t *payload,
+                     uint16_t payload_length)
+{
+    ipv6_hdr_t *packet = ipv6_prepare(dest, next_header, payload,
+                                      payload_length);
+
+    memcpy(&packet->srcaddr, src, 16);
+    return ipv6_send_packet_from(packet);
 }
 
 void ipv6_set_default_hop_limit(uint8_t hop_limit)
@@ -196,8 +564,8 @@ uint8_t ipv6_register_packet_handler(int pid)
 {
     uint8_t i;
 
-    for (i = 0; ((i < SIXLOWIP_MAX_REGISTERED) && (sixlowip_reg[i] != pid) &&
-                 (sixlowip_reg[i] != 0)); i++) {
+    for (i = 0; ((i < SIXLOWIP_MAX_REGISTERED) && (sixlowip_reg[i].pid != pid) &&
+                 (sixlowip_reg[i].pid != 0)); i++) {
         ;
     }
 
@@ -205,11 +573,59 @@ uint8_t ipv6_register_packet_handler(int pid)
         return ENOMEM;
     }
     else {
-        sixlowip_reg[i] = pid;
+        if (sixlowip_reg[i].pid != pid) {
+            pubsub_subscribe(&ipv6_tap, &sixlowip_reg[i], pid,
+                             IPV6_PACKET_RECEIVED, 0);
+        }
+
         return 1;
     }
 }
 
+static pubsub_sub_t *ipv6_listener(int pid)
+{
+    for (uint8_t i = 0; i < SIXLOWIP_MAX_REGISTERED; i++) {
+        if (sixlowip_reg[i].pid == pid) {
+            return &sixlowip_reg[i];
+        }
+    }
+
+    return NULL;
+}
+
+ipv6_hdr_t *ipv6_packet_get(void)
+{
+    pubsub_sub_t *sub = ipv6_listener(thread_getpid());
+    pubsub_event_t *event;
+
+    if (sub == NULL) {
+        return NULL;
+    }
+
+    event = pubsub_get(&ipv6_tap, sub);
+
+    return (event != NULL) ? (ipv6_hdr_t *) event->data : NULL;
+}
+
+void ipv6_packet_release(ipv6_hdr_t *packet)
+{
+    unsigned int t = ((uint8_t *) packet - ipv6_tap_buf[0]) / IPV6_MTU;
+
+    if ((t >= IPV6_TAP_BUFFERS) || ((uint8_t *) packet != ipv6_tap_buf[t])) {
+        DEBUG("ipv6: release of unknown packet %p\n", (void *) packet);
+        return;
+    }
+
+    pubsub_release(&ipv6_tap, &ipv6_tap_events[t]);
+}
+
+uint32_t ipv6_get_packet_handler_drops(int pid)
+{
+    pubsub_sub_t *sub = ipv6_listener(pid);
+
+    return (sub != NULL) ? sub->drops : 0;
+}
+
 int icmpv6_demultiplex(const icmpv6_hdr_t *hdr)
 {
     switch (hdr->type) {
@@ -260,6 +676,8 @@ int icmpv6_demultiplex(const icmpv6_hdr_t *hdr)
 
             if (rpl_process_pid != 0) {
                 msg_t m_send;
+                /* RPL timers send to the same thread */
+                m_send.type = IPV6_PACKET_RECEIVED;
                 m_send.content.ptr = (char *) &hdr->code;
                 msg_send(&m_send, rpl_process_pid, 1);
             }
@@ -306,7 +724,7 @@ uint8_t ipv6_get_addr_match(const ipv6_addr_t *src,
     return val;
 }
 
-int is_our_address(ipv6_addr_t *addr)
+static int is_our_address_uncached(const ipv6_addr_t *addr)
 {
     ipv6_net_if_ext_t *net_if_ext;
     ipv6_net_if_addr_t *myaddr;
@@ -331,119 +749,219 @@ int is_our_address(ipv6_addr_t *addr)
     return 0;
 }
 
-void ipv6_process(void)
+int is_our_address(ipv6_addr_t *addr)
 {
-    msg_t m_recv_lowpan, m_send_lowpan;
-    msg_t m_recv, m_send;
-    uint8_t i;
-    uint16_t packet_length;
+    uint16_t gen = net_if_get_address_generation();
+    unsigned state;
+    int local;
 
-    msg_init_queue(ip_msg_queue, IP_PKT_RECV_BUF_SIZE);
+    if (ipv6_addr_is_multicast(addr)) {
+        return ipv6_mcast_is_member(addr);
+    }
 
-    while (1) {
-        msg_receive(&m_recv_lowpan);
+    state = disableIRQ();
 
-        ipv6_buf = (ipv6_hdr_t *)m_recv_lowpan.content.ptr;
+    for (uint8_t i = 0; i < IPV6_ADDR_CACHE_SIZE; i++) {
+        if ((ipv6_local_cache[i].gen == gen) &&
+            ipv6_addr_is_equal(&ipv6_local_cache[i].addr, addr)) {
+            local = ipv6_local_cache[i].local;
+            restoreIRQ(state);
+            return local;
+        }
+    }
 
-        /* identifiy packet */
-        nextheader = &ipv6_buf->nextheader;
+    restoreIRQ(state);
 
-        for (i = 0; i < SIXLOWIP_MAX_REGISTERED; i++) {
-            if (sixlowip_reg[i]) {
-                msg_t m_send;
-                m_send.type = IPV6_PACKET_RECEIVED;
-                m_send.content.ptr = (char *) ipv6_buf;
-                msg_send(&m_send, sixlowip_reg[i], 1);
-            }
+    local = is_our_address_uncached(addr);
+
+    state = disableIRQ();
+    memcpy(&ipv6_local_cache[ipv6_local_cache_next].addr, addr,
+           sizeof(ipv6_addr_t));
+    ipv6_local_cache[ipv6_local_cache_next].local = local;
+    ipv6_local_cache[ipv6_local_cache_next].gen = gen;
+    ipv6_local_cache_next = (ipv6_local_cache_next + 1) % IPV6_ADDR_CACHE_SIZE;
+    restoreIRQ(state);
+
+    return local;
+}
+
+void ipv6_process_packet(pktbuf_t *pkt)
+{
+    uint16_t packet_length;
+    int routed;
+
+    ipv6_buf = (ipv6_hdr_t *) pkt->data;
+
+    /* identifiy packet */
+    nextheader = &ipv6_buf->nextheader;
+
+    ipv6_tap_packet(ipv6_buf);
+
+    if ((ip_mcast_forwarder != NULL) &&
+        ipv6_addr_is_multicast(&ipv6_buf->destaddr) &&
+        (*nextheader == IPV6_PROTO_NUM_HOP_BY_HOP)) {
+        if ((ip_mcast_forwarder(ipv6_buf) < 0) ||
+            !ipv6_mcast_is_member(&ipv6_buf->destaddr)) {
+            return;
         }
+    }
 
-        /* destination is our address */
-        if (is_our_address(&ipv6_buf->destaddr)) {
-            switch (*nextheader) {
-                case (IPV6_PROTO_NUM_ICMPV6): {
-                    icmp_buf = get_icmpv6_buf(ipv6_ext_hdr_len);
+    routed = 0;
 
-                    /* checksum test*/
-                    if (ipv6_csum(ipv6_buf, (uint8_t *) icmp_buf, NTOHS(ipv6_buf->length),
-                                  IPV6_PROTO_NUM_ICMPV6) != 0xffff) {
-                        DEBUG("ERROR: wrong checksum\n");
-                    }
+    if (is_our_address(&ipv6_buf->destaddr) &&
+        (*nextheader == IPV6_PROTO_NUM_ROUTING)) {
+        /* 1: source routed through us, 0: arrived */
+        if ((routed = ipv6_srh_process(ipv6_buf)) < 0) {
+            DEBUG("INFO: Dropped packet with invalid routing header.\n");
+            NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_MALFORMED);
+            return;
+        }
 
-                    icmpv6_demultiplex(icmp_buf);
-                    break;
+        /* the routing header may have been stripped */
+        pktbuf_trim(pkt, IPV6_HDR_LEN + NTOHS(ipv6_buf->length));
+    }
+
+    /* destination is our address */
+    if (!routed && is_our_address(&ipv6_buf->destaddr)) {
+        NETSTAT_RX(NETSTAT_LAYER_IPV6);
+
+        switch (*nextheader) {
+            case (IPV6_PROTO_NUM_ICMPV6): {
+                /* ICMPv6, NDP and RPL work on the IPv6 buffer */
+                memcpy(ipv6_get_buf(), pkt->data, pkt->len);
+                ipv6_buf = ipv6_get_buf();
+                nextheader = &ipv6_buf->nextheader;
+                icmp_buf = get_icmpv6_buf(ipv6_ext_hdr_len);
+
+                /* checksum test*/
+                if (ipv6_csum(ipv6_buf, (uint8_t *) icmp_buf, NTOHS(ipv6_buf->length),
+                              IPV6_PROTO_NUM_ICMPV6) != 0xffff) {
+                    DEBUG("ERROR: wrong checksum\n");
                 }
 
-                case (IPV6_PROTO_NUM_TCP): {
-                    if (tcp_packet_handler_pid != 0) {
-                        m_send.content.ptr = (char *) ipv6_buf;
-                        msg_send_receive(&m_send, &m_recv, tcp_packet_handler_pid);
-                    }
-                    else {
-                        DEBUG("INFO: No TCP handler registered.\n");
-                    }
+                icmpv6_demultiplex(icmp_buf);
+                break;
+            }
 
-                    break;
+            case (IPV6_PROTO_NUM_TCP): {
+                if (tcp_packet_handler_cb != NULL) {
+                    tcp_packet_handler_cb(pkt);
+                }
+                else if (tcp_packet_handler_pid != 0) {
+                    msg_t m_recv, m_send;
+                    m_send.content.ptr = (char *) pkt;
+                    msg_send_receive(&m_send, &m_recv, tcp_packet_handler_pid);
+                }
+                else {
+                    DEBUG("INFO: No TCP handler registered.\n");
+                    NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_HANDLER);
                 }
 
-                case (IPV6_PROTO_NUM_UDP): {
-                    if (udp_packet_handler_pid != 0) {
-                        m_send.content.ptr = (char *) ipv6_buf;
-                        msg_send_receive(&m_send, &m_recv, udp_packet_handler_pid);
-                    }
-                    else {
-                        DEBUG("INFO: No UDP handler registered.\n");
-                    }
+                break;
+            }
 
-                    break;
+            case (IPV6_PROTO_NUM_UDP): {
+                if (udp_packet_handler_cb != NULL) {
+                    udp_packet_handler_cb(pkt);
                 }
-
-                case (IPV6_PROTO_NUM_NONE): {
-                    DEBUG("INFO: Packet with no Header following the IPv6 Header received.\n");
-                    break;
+                else if (udp_packet_handler_pid != 0) {
+                    msg_t m_recv, m_send;
+                    m_send.content.ptr = (char *) pkt;
+                    msg_send_receive(&m_send, &m_recv, udp_packet_handler_pid);
+                }
+                else {
+                    DEBUG("INFO: No UDP handler registered.\n");
+                    NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_HANDLER);
                 }
 
-                default:
-                    break;
+                break;
+            }
+
+            case (IPV6_PROTO_NUM_NONE): {
+                DEBUG("INFO: Packet with no Header following the IPv6 Header received.\n");
+                break;
             }
+
+            default:
+                break;
         }
-        /* destination is foreign address */
-        else {
-            packet_length = IPV6_HDR_LEN + NTOHS(ipv6_buf->length);
-            ndp_neighbor_cache_t *nce;
+    }
+    /* destination is foreign address */
+    else {
+        ndp_neighbor_cache_t *nce;
 
-            ipv6_addr_t *dest;
+        ipv6_addr_t *dest;
 
-            if (ip_get_next_hop == NULL) {
-                dest = &ipv6_buf->destaddr;
-            }
-            else {
-                dest = ip_get_next_hop(&ipv6_buf->destaddr);
-            }
+        /* forwarded from the send buffer, which leaves room for a source
+         * routing header */
+        memcpy(ipv6_get_buf_send(), pkt->data, pkt->len);
+        ipv6_buf = ipv6_get_buf_send();
+        nextheader = &ipv6_buf->nextheader;
 
-            if ((dest == NULL) || ((--ipv6_buf->hoplimit) == 0)) {
-                DEBUG("!!! Packet not for me, routing handler is set, but I "\
-                      " have no idea where to send or the hop limit is exceeded.\n");
-                msg_reply(&m_recv_lowpan, &m_send_lowpan);
-                continue;
-            }
+        if (!routed && ((routed = ipv6_source_route(ipv6_buf)) < 0)) {
+            NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_ROUTE);
+            return;
+        }
+
+        packet_length = IPV6_HDR_LEN + NTOHS(ipv6_buf->length);
+
+        if (routed) {
+            /* the source route names the neighbor to send to */
+            dest = &ipv6_buf->destaddr;
+        }
+        else if ((ip_get_next_hop == NULL) && (ip_get_next_hop_class == NULL)) {
+            dest = &ipv6_buf->destaddr;
+        }
+        else {
+            dest = ipv6_next_hop(ipv6_buf);
+        }
 
-            nce = ndp_get_ll_address(dest);
+        if ((dest == NULL) || ((--ipv6_buf->hoplimit) == 0)) {
+            DEBUG("!!! Packet not for me, routing handler is set, but I "\
+                  " have no idea where to send or the hop limit is exceeded.\n");
+            NETSTAT_DROP(NETSTAT_LAYER_IPV6, (dest == NULL) ?
+                         NETSTAT_DROP_NO_ROUTE : NETSTAT_DROP_HOP_LIMIT);
+            return;
+        }
 
-            /* copy received packet to send buffer */
-            memcpy(ipv6_get_buf_send(), ipv6_get_buf(), packet_length);
+        nce = ndp_get_ll_address(dest);
 
-            /* send packet to node ID derived from dest IP */
-            if (nce != NULL) {
-                sixlowpan_lowpan_sendto(nce->if_id, &nce->lladdr,
-                                        nce->lladdr_len,
-                                        (uint8_t *)ipv6_get_buf_send(),
-                                        packet_length);
+        /* send packet to node ID derived from dest IP */
+        if (nce != NULL) {
+            if (!routed && (ipv6_buf->nextheader != IPV6_PROTO_NUM_ROUTING)) {
+                /* the next packet to dest may skip all of this */
+                ipv6_fwd_cache_store(&ipv6_buf->destaddr,
+                                     ipv6_get_traffic_class(ipv6_buf), nce);
             }
+
+            NETSTAT_RX(NETSTAT_LAYER_IPV6);
+            NETSTAT_TX(NETSTAT_LAYER_IPV6);
+            sixlowpan_lowpan_sendto(nce->if_id, &nce->lladdr,
+                                    nce->lladdr_len,
+                                    (uint8_t *)ipv6_get_buf_send(),
+                                    packet_length);
+            ndp_neighbor_cache_probe(nce);
+        }
+        else {
+            NETSTAT_DROP(NETSTAT_LAYER_IPV6, NETSTAT_DROP_NO_ROUTE);
         }
+    }
+}
+
+#if !SIXLOWPAN_RUN_TO_COMPLETION
+void ipv6_process(void)
+{
+    msg_t m_recv_lowpan, m_send_lowpan;
 
+    msg_init_queue(ip_msg_queue, IP_PKT_RECV_BUF_SIZE);
+
+    while (1) {
+        msg_receive(&m_recv_lowpan);
+        ipv6_process_packet((pktbuf_t *) m_recv_lowpan.content.ptr);
         msg_reply(&m_recv_lowpan, &m_send_lowpan);
     }
 }
+#endif
 
 ipv6_net_if_ext_t *ipv6_net_if_get_ext(int if_id)
 {
@@ -477,6 +995,9 @@ int ipv6_net_if_add_addr(int if_id, const ipv6_addr_t *addr,
         return 1;
     }
 
+    /* a cached destination may be ours now */
+    ipv6_fwd_cache_flush();
+
     if (ipv6_net_if_addr_buffer_count < IPV6_NET_IF_ADDR_BUFFER_LEN) {
         timex_t valtime = {val_ltime, 0};
         timex_t preftime = {pref_ltime, 0};
@@ -510,6 +1031,13 @@ int ipv6_net_if_add_addr(int if_id, const ipv6_addr_t *addr,
 
         net_if_add_address(if_id, (net_if_addr_t *)addr_entry);
 
+        /* the source trie changes with the address list */
+        ipv6_addr_cache_flush();
+
+        if (ipv6_addr_is_multicast(addr_data)) {
+            ipv6_mcast_join(addr_data);
+        }
+
         /* Register to Solicited-Node multicast address according to RFC 4291 */
         if (is_anycast || !ipv6_addr_is_multicast(addr)) {
             ipv6_addr_t sol_node_mcast_addr;
@@ -632,32 +1160,65 @@ void ipv6_addr_init_prefix(ipv6_addr_t *out, const ipv6_addr_t *prefix,
     out->uint8[bytes] = prefix->uint8[bytes] & mask;
 }
 
+static int ipv6_net_if_src_preferred(void *value, void *arg)
+{
+    (void) arg;
+
+    return ((ipv6_net_if_addr_t *) value)->ndp_state == NDP_ADDR_STATE_PREFERRED;
+}
+
+/* brings the source trie of *if_id* in line with its address list, which
+ * also drops the addresses deleted with net_if_del_address() */
+static void ipv6_net_if_src_trie_update(int if_id, uint16_t gen)
+{
+    ipv6_net_if_addr_t *addr = NULL;
+
+    if (ipv6_net_if_src_tries_gen[if_id] == gen) {
+        return;
+    }
+
+    ipv6_lpm_clear(&ipv6_net_if_src_tries[if_id]);
+
+    while ((addr = (ipv6_net_if_addr_t *)net_if_iter_addresses(if_id,
+                   (net_if_addr_t **)&addr))) {
+        if (!ipv6_addr_is_link_local(addr->addr_data) &&
+            !ipv6_addr_is_multicast(addr->addr_data) &&
+            !ipv6_addr_is_unique_local_unicast(addr->addr_data)) {
+            ipv6_lpm_add(&ipv6_net_if_src_tries[if_id], addr->addr_data, 128,
+                         addr);
+        }
+    }
+
+    ipv6_net_if_src_tries_gen[if_id] = gen;
+}
+
 void ipv6_net_if_get_best_src_addr(ipv6_addr_t *src, const ipv6_addr_t *dest)
 {
     /* try to find best match if dest is not mcast or link local */
     int if_id = 0; // TODO: get this somehow
-    uint8_t tmp = 0;
-    uint8_t bmatch = 0;
     ipv6_net_if_addr_t *addr = NULL;
     ipv6_net_if_addr_t *tmp_addr = NULL;
+    uint16_t gen = net_if_get_address_generation();
+    unsigned state;
 
-    if (!(ipv6_addr_is_link_local(dest)) && !(ipv6_addr_is_multicast(dest))) {
-        while ((addr = (ipv6_net_if_addr_t *)net_if_iter_addresses(if_id,
-                       (net_if_addr_t **)&addr))) {
-            if (addr->ndp_state == NDP_ADDR_STATE_PREFERRED) {
-                if (!ipv6_addr_is_link_local(addr->addr_data) &&
-                    !ipv6_addr_is_multicast(addr->addr_data) &&
-                    !ipv6_addr_is_unique_local_unicast(addr->addr_data)) {
-                    tmp = ipv6_get_addr_match(dest, addr->addr_data);
-
-                    if (tmp >= bmatch) {
-                        bmatch = tmp;
-                        tmp_addr = addr;
-                    }
-                }
-            }
+    state = disableIRQ();
+
+    for (uint8_t i = 0; i < IPV6_ADDR_CACHE_SIZE; i++) {
+        if ((ipv6_src_cache[i].gen == gen) &&
+            ipv6_addr_is_equal(&ipv6_src_cache[i].dest, dest)) {
+            memcpy(src, &ipv6_src_cache[i].src, sizeof(ipv6_addr_t));
+            restoreIRQ(state);
+            return;
         }
     }
+
+    restoreIRQ(state);
+
+    if (!(ipv6_addr_is_link_local(dest)) && !(ipv6_addr_is_multicast(dest))) {
+        ipv6_net_if_src_trie_update(if_id, gen);
+        tmp_addr = ipv6_lpm_closest(&ipv6_net_if_src_tries[if_id], dest,
+                                    ipv6_net_if_src_preferred, NULL);
+    }
     else {
         while ((addr = (ipv6_net_if_addr_t *)net_if_iter_addresses(if_id,
                        (net_if_addr_t **)&addr))) {
@@ -675,6 +1236,14 @@ void ipv6_net_if_get_best_src_addr(ipv6_addr_t *src, const ipv6_addr_t *dest)
     else {
         memcpy(src, tmp_addr->addr_data, 16);
     }
+
+    state = disableIRQ();
+    memcpy(&ipv6_src_cache[ipv6_src_cache_next].dest, dest,
+           sizeof(ipv6_addr_t));
+    memcpy(&ipv6_src_cache[ipv6_src_cache_next].src, src, sizeof(ipv6_addr_t));
+    ipv6_src_cache[ipv6_src_cache_next].gen = gen;
+    ipv6_src_cache_next = (ipv6_src_cache_next + 1) % IPV6_ADDR_CACHE_SIZE;
+    restoreIRQ(state);
 }
 
 void ipv6_addr_init(ipv6_addr_t *out, uint16_t addr0, uint16_t addr1,
@@ -767,10 +1336,49 @@ void ipv6_register_next_header_handler(uint8_t next_header, int pid)
     }
 }
 
+void ipv6_register_next_header_callback(uint8_t next_header,
+                                        ipv6_next_header_cb_t cb)
+{
+    switch (next_header) {
+        case (IPV6_PROTO_NUM_TCP):
+            tcp_packet_handler_cb = cb;
+            break;
+
+        case (IPV6_PROTO_NUM_UDP):
+            udp_packet_handler_cb = cb;
+            break;
+
+        default:
+            break;
+    }
+}
+
 /* register routing function */
 void ipv6_iface_set_routing_provider(ipv6_addr_t *(*next_hop)(ipv6_addr_t *dest))
 {
     ip_get_next_hop = next_hop;
+    ip_get_next_hop_class = NULL;
+    ipv6_fwd_cache_flush();
+}
+
+void ipv6_iface_set_class_routing_provider(ipv6_addr_t *(*next_hop)(ipv6_addr_t *dest,
+                                           uint8_t traffic_class))
+{
+    ip_get_next_hop_class = next_hop;
+    ip_get_next_hop = NULL;
+    ipv6_fwd_cache_flush();
+}
+
+void ipv6_iface_set_srh_provider(int (*source_route)(ipv6_addr_t *dest,
+                                 ipv6_addr_t *hops, uint8_t max))
+{
+    ip_get_source_route = source_route;
+    ipv6_fwd_cache_flush();
+}
+
+void ipv6_iface_set_mcast_forwarder(int (*forward)(ipv6_hdr_t *packet))
+{
+    ip_mcast_forwarder = forward;
 }
 
 void ipv6_register_rpl_handler(int pid)
@@ -29,6 +29,7 @@
 #include "timex.h"
 #include "mutex.h"
 #include "net_if.h"
+#include "pubsub.h"
 
 #include "sixlowpan/ip.h"
 #include "sixlowpan/types.h"
@@ -58,7 +59,43 @@ extern int ip_process_pid;
 extern uint8_t buffer[BUFFER_SIZE];
 extern char ip_process_buf[IP_PROCESS_STACKSIZE];
 
-extern int sixlowip_reg[SIXLOWIP_MAX_REGISTERED];
+/* a thread registered for the received packets, pid 0 if unused */
+typedef pubsub_sub_t ipv6_listener_t;
+
+extern ipv6_listener_t sixlowip_reg[SIXLOWIP_MAX_REGISTERED];
+
+/* number of addresses whose is_our_address() result and best source
+ * address are cached */
+#ifndef IPV6_ADDR_CACHE_SIZE
+#define IPV6_ADDR_CACHE_SIZE        (4)
+#endif
+
+/* number of destinations whose next hop is cached for forwarding and
+ * sending */
+#ifndef IPV6_FWD_CACHE_SIZE
+#define IPV6_FWD_CACHE_SIZE         (4)
+#endif
+
+/* seconds a cached next hop is used without asking routing and NDP */
+#ifndef IPV6_FWD_CACHE_LIFETIME
+#define IPV6_FWD_CACHE_LIFETIME     (5)
+#endif
+
+typedef struct {
+    ipv6_addr_t dest;
+    uint8_t tclass;             /* traffic class, it may select the route */
+    uint8_t lladdr[8];          /* link-layer address of the next hop */
+    uint8_t lladdr_len;         /* 0 if the entry is unused */
+    int if_id;
+    uint32_t expires;           /* vtimer seconds */
+} ipv6_fwd_entry_t;
+
+/* Next hop of a recently forwarded or sent, not source routed packet to dest
+ * with traffic class tclass. NULL if there is none or packet handlers are
+ * registered, in which case every packet has to go through
+ * ipv6_process_packet(). */
+const ipv6_fwd_entry_t *ipv6_fwd_cache_lookup(const ipv6_addr_t *dest,
+                                              uint8_t tclass);
 
 typedef struct __attribute__((packed)) {
     struct net_if_addr_t *addr_next;
@@ -0,0 +1,365 @@
+/*
+ * Longest prefix match on IPv6 addresses
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sixlowpan
+ * @{
+ * @file    ipv6_lpm.c
+ * @brief   Path-compressed binary trie mapping IPv6 prefixes to values.
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "irq.h"
+
+#include "ipv6_lpm.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define LPM_NODE(idx)   (&lpm_nodes[(idx) - 1])
+#define LPM_IDX(node)   ((uint8_t)((node) - lpm_nodes) + 1)
+
+typedef struct {
+    ipv6_addr_t key;    /* prefix, all bits beyond len are zero */
+    void *value;        /* NULL for a branching node without own prefix */
+    uint8_t len;
+    uint8_t child[2];   /* indexed by bit len of the key */
+} lpm_node_t;
+
+static lpm_node_t lpm_nodes[IPV6_LPM_NODES_NUMOF];
+static uint8_t lpm_free;
+static uint8_t lpm_free_numof;
+static uint8_t lpm_initialized;
+
+static void lpm_init(void)
+{
+    /* chain all nodes into the free list through child[0] */
+    for (int i = IPV6_LPM_NODES_NUMOF; i > 0; i--) {
+        LPM_NODE(i)->child[0] = lpm_free;
+        lpm_free = i;
+    }
+
+    lpm_free_numof = IPV6_LPM_NODES_NUMOF;
+    lpm_initialized = 1;
+}
+
+static inline uint8_t lpm_bit(const ipv6_addr_t *addr, uint8_t pos)
+{
+    return (addr->uint8[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+
+/* number of leading bits *a* and *b* have in common, at most *max* */
+static uint8_t lpm_common(const ipv6_addr_t *a, const ipv6_addr_t *b,
+                          uint8_t max)
+{
+    uint8_t len = 0;
+    int i;
+
+    for (i = 0; (i < 16) && (len < max); i++) {
+        uint8_t diff = a->uint8[i] ^ b->uint8[i];
+
+        if (diff != 0) {
+            while (!(diff & 0x80)) {
+                diff <<= 1;
+                len++;
+            }
+
+            break;
+        }
+
+        len += 8;
+    }
+
+    return (len < max) ? len : max;
+}
+
+static uint8_t lpm_node_new(const ipv6_addr_t *prefix, uint8_t len,
+                            void *value)
+{
+    uint8_t idx = lpm_free;
+    lpm_node_t *node = LPM_NODE(idx);
+    int bytes = len / 8;
+
+    lpm_free = node->child[0];
+    lpm_free_numof--;
+
+    memset(&node->key, 0, sizeof(node->key));
+    memcpy(&node->key, prefix, bytes);
+
+    if (len % 8) {
+        node->key.uint8[bytes] = prefix->uint8[bytes] & (0xff << (8 - (len % 8)));
+    }
+
+    node->len = len;
+    node->value = value;
+    node->child[0] = 0;
+    node->child[1] = 0;
+
+    return idx;
+}
+
+static void lpm_node_free(uint8_t idx)
+{
+    LPM_NODE(idx)->child[0] = lpm_free;
+    lpm_free = idx;
+    lpm_free_numof++;
+}
+
+/* replaces a branching node left with at most one child by that child */
+static void lpm_node_collapse(uint8_t *link)
+{
+    lpm_node_t *node = LPM_NODE(*link);
+    uint8_t idx = *link;
+
+    if ((node->value != NULL) || (node->child[0] && node->child[1])) {
+        return;
+    }
+
+    *link = node->child[0] ? node->child[0] : node->child[1];
+    lpm_node_free(idx);
+}
+
+int ipv6_lpm_add(ipv6_lpm_t *t, const ipv6_addr_t *prefix, uint8_t len,
+                 void *value)
+{
+    uint8_t *link = &t->root;
+    lpm_node_t *node;
+    uint8_t common = 0;
+    unsigned state = disableIRQ();
+
+    if (!lpm_initialized) {
+        lpm_init();
+    }
+
+    while (*link) {
+        node = LPM_NODE(*link);
+        common = lpm_common(&node->key, prefix,
+                            (node->len < len) ? node->len : len);
+
+        if (common < node->len) {
+            break;
+        }
+
+        if (node->len == len) {
+            node->value = value;
+            restoreIRQ(state);
+            return 0;
+        }
+
+        link = &node->child[lpm_bit(prefix, node->len)];
+    }
+
+    /* a split needs a branching node besides the new one */
+    if (lpm_free_numof < ((*link && (common < len)) ? 2 : 1)) {
+        restoreIRQ(state);
+        DEBUG("ipv6_lpm_add: node pool exhausted\n");
+        return -1;
+    }
+
+    if (*link == 0) {
+        *link = lpm_node_new(prefix, len, value);
+    }
+    else if (common == len) {
+        /* the new prefix sits between *link and its parent */
+        uint8_t idx = lpm_node_new(prefix, len, value);
+
+        LPM_NODE(idx)->child[lpm_bit(&node->key, len)] = *link;
+        *link = idx;
+    }
+    else {
+        uint8_t branch = lpm_node_new(prefix, common, NULL);
+        uint8_t leaf = lpm_node_new(prefix, len, value);
+
+        LPM_NODE(branch)->child[lpm_bit(prefix, common)] = leaf;
+        LPM_NODE(branch)->child[lpm_bit(&node->key, common)] = *link;
+        *link = branch;
+    }
+
+    restoreIRQ(state);
+    return 0;
+}
+
+void *ipv6_lpm_remove(ipv6_lpm_t *t, const ipv6_addr_t *prefix, uint8_t len)
+{
+    uint8_t *parent = NULL;
+    uint8_t *link = &t->root;
+    lpm_node_t *node;
+    void *value = NULL;
+    unsigned state = disableIRQ();
+
+    while (*link) {
+        node = LPM_NODE(*link);
+
+        if ((node->len > len) ||
+            (lpm_common(&node->key, prefix, node->len) < node->len)) {
+            break;
+        }
+
+        if (node->len == len) {
+            value = node->value;
+            node->value = NULL;
+            lpm_node_collapse(link);
+
+            if (parent != NULL) {
+                lpm_node_collapse(parent);
+            }
+
+            break;
+        }
+
+        parent = link;
+        link = &node->child[lpm_bit(prefix, node->len)];
+    }
+
+    restoreIRQ(state);
+    return value;
+}
+
+void *ipv6_lpm_lookup(const ipv6_lpm_t *t, const ipv6_addr_t *addr,
+                      uint8_t up_to, uint8_t *match_len)
+{
+    uint8_t idx = t->root;
+    void *value = NULL;
+    unsigned state = disableIRQ();
+
+    while (idx) {
+        lpm_node_t *node = LPM_NODE(idx);
+
+        if ((node->len > up_to) ||
+            (lpm_common(&node->key, addr, node->len) < node->len)) {
+            break;
+        }
+
+        if (node->value != NULL) {
+            value = node->value;
+
+            if (match_len != NULL) {
+                *match_len = node->len;
+            }
+        }
+
+        if (node->len == 128) {
+            break;
+        }
+
+        idx = node->child[lpm_bit(addr, node->len)];
+    }
+
+    restoreIRQ(state);
+    return value;
+}
+
+void *ipv6_lpm_exact(const ipv6_lpm_t *t, const ipv6_addr_t *prefix,
+                     uint8_t len)
+{
+    uint8_t match_len = 0;
+    void *value = ipv6_lpm_lookup(t, prefix, len, &match_len);
+
+    return (match_len == len) ? value : NULL;
+}
+
+/* depth-first search for an accepted value below *idx*, skipping the
+ * subtree rooted at *skip* */
+static void lpm_node_free_all(uint8_t idx)
+{
+    uint8_t child0 = LPM_NODE(idx)->child[0];
+    uint8_t child1 = LPM_NODE(idx)->child[1];
+
+    lpm_node_free(idx);
+
+    if (child0) {
+        lpm_node_free_all(child0);
+    }
+
+    if (child1) {
+        lpm_node_free_all(child1);
+    }
+}
+
+void ipv6_lpm_clear(ipv6_lpm_t *t)
+{
+    unsigned state = disableIRQ();
+
+    if (t->root) {
+        lpm_node_free_all(t->root);
+        t->root = 0;
+    }
+
+    restoreIRQ(state);
+}
+
+static void *lpm_search(uint8_t idx, uint8_t skip,
+                        int (*accept)(void *value, void *arg), void *arg)
+{
+    uint8_t stack[IPV6_LPM_NODES_NUMOF];
+    int top = 0;
+
+    stack[top++] = idx;
+
+    while (top > 0) {
+        lpm_node_t *node = LPM_NODE(stack[--top]);
+
+        if (stack[top] == skip) {
+            continue;
+        }
+
+        if ((node->value != NULL) &&
+            ((accept == NULL) || accept(node->value, arg))) {
+            return node->value;
+        }
+
+        if (node->child[0]) {
+            stack[top++] = node->child[0];
+        }
+
+        if (node->child[1]) {
+            stack[top++] = node->child[1];
+        }
+    }
+
+    return NULL;
+}
+
+void *ipv6_lpm_closest(const ipv6_lpm_t *t, const ipv6_addr_t *addr,
+                       int (*accept)(void *value, void *arg), void *arg)
+{
+    uint8_t path[IPV6_LPM_NODES_NUMOF];
+    int depth = 0;
+    uint8_t idx = t->root;
+    uint8_t skip = 0;
+    void *value = NULL;
+    unsigned state = disableIRQ();
+
+    /* descend as far as *addr* agrees with the keys */
+    while (idx) {
+        lpm_node_t *node = LPM_NODE(idx);
+
+        path[depth++] = idx;
+
+        if ((node->len == 128) ||
+            (lpm_common(&node->key, addr, node->len) < node->len)) {
+            break;
+        }
+
+        idx = node->child[lpm_bit(addr, node->len)];
+    }
+
+    /* everything below a path node shares exactly that node's prefix
+     * with addr, so the deepest subtree with an accepted value wins */
+    while ((value == NULL) && (depth > 0)) {
+        idx = path[--depth];
+        value = lpm_search(idx, skip, accept, arg);
+        skip = idx;
+    }
+
+    restoreIRQ(state);
+    return value;
+}
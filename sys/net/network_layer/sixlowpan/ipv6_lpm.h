@@ -0,0 +1,112 @@
+/*
+ * Longest prefix match on IPv6 addresses
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sixlowpan
+ * @{
+ * @file    ipv6_lpm.h
+ * @brief   Path-compressed binary trie mapping IPv6 prefixes to values.
+ *
+ * All tries share one statically allocated node pool, a trie itself is only
+ * the index of its root node. Every operation walks at most one node per
+ * distinct prefix length on the path, independent of the number of stored
+ * prefixes.
+ * @}
+ */
+
+#ifndef _SIXLOWPAN_IPV6_LPM_H
+#define _SIXLOWPAN_IPV6_LPM_H
+
+#include <stdint.h>
+
+#include "sixlowpan/types.h"
+
+/**
+ * @brief   Number of trie nodes shared by all tries. A trie holding n
+ *          prefixes needs at most 2n - 1 nodes. Must not exceed 255.
+ */
+#ifndef IPV6_LPM_NODES_NUMOF
+#define IPV6_LPM_NODES_NUMOF    (32)
+#endif
+
+/**
+ * @brief   A trie, initialize with IPV6_LPM_INIT or zero it.
+ */
+typedef struct {
+    uint8_t root;       ///< 1-based index of the root node, 0 if empty
+} ipv6_lpm_t;
+
+#define IPV6_LPM_INIT   { 0 }
+
+/**
+ * @brief   Adds a prefix to a trie or replaces the value of an existing one.
+ *
+ * @param[in] t         The trie.
+ * @param[in] prefix    The prefix, bits beyond *len* are ignored.
+ * @param[in] len       Length of the prefix in bits (0 - 128).
+ * @param[in] value     Value to store, must not be NULL.
+ *
+ * @return  0 on success, -1 if the node pool is exhausted.
+ */
+int ipv6_lpm_add(ipv6_lpm_t *t, const ipv6_addr_t *prefix, uint8_t len,
+                 void *value);
+
+/**
+ * @brief   Removes a prefix from a trie.
+ *
+ * @return  The value that was stored for the prefix, NULL if not found.
+ */
+void *ipv6_lpm_remove(ipv6_lpm_t *t, const ipv6_addr_t *prefix, uint8_t len);
+
+/**
+ * @brief   Removes all prefixes from a trie.
+ */
+void ipv6_lpm_clear(ipv6_lpm_t *t);
+
+/**
+ * @brief   Finds the longest stored prefix of *addr* that is at most
+ *          *up_to* bits long.
+ *
+ * @param[in] t         The trie.
+ * @param[in] addr      The address to match.
+ * @param[in] up_to     Maximum prefix length to consider in bits.
+ * @param[out] match_len    Length of the matched prefix, may be NULL.
+ *
+ * @return  The value of the matched prefix, NULL if none matched.
+ */
+void *ipv6_lpm_lookup(const ipv6_lpm_t *t, const ipv6_addr_t *addr,
+                      uint8_t up_to, uint8_t *match_len);
+
+/**
+ * @brief   Finds the value stored for exactly *prefix* with *len* bits.
+ *
+ * @return  The value, NULL if the prefix is not stored.
+ */
+void *ipv6_lpm_exact(const ipv6_lpm_t *t, const ipv6_addr_t *prefix,
+                     uint8_t len);
+
+/**
+ * @brief   Finds the stored value whose prefix shares the most leading bits
+ *          with *addr* and that is accepted by *accept*.
+ *
+ * Unlike ipv6_lpm_lookup() the stored prefix does not have to be a prefix
+ * of *addr*. This is the comparison rule 8 of RFC 6724 source address
+ * selection makes.
+ *
+ * @param[in] t         The trie.
+ * @param[in] addr      The address to compare with.
+ * @param[in] accept    Predicate on the stored values, NULL to accept all.
+ *                      Called with interrupts disabled.
+ * @param[in] arg       Argument passed to *accept*.
+ *
+ * @return  The value, NULL if no stored value was accepted.
+ */
+void *ipv6_lpm_closest(const ipv6_lpm_t *t, const ipv6_addr_t *addr,
+                       int (*accept)(void *value, void *arg), void *arg);
+
+#endif /* _SIXLOWPAN_IPV6_LPM_H */
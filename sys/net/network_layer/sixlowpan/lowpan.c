@@ -19,6 +19,7 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -41,10 +42,16 @@
 #endif
 #include "ip.h"
 #include "icmp.h"
+#include "ipv6_lpm.h"
+#include "srh.h"
 
 #include "ieee802154_frame.h"
 #include "destiny/in.h"
+#include "destiny/types.h"
 #include "net_help.h"
+#include "netstat.h"
+#include "trace.h"
+#include "pktbuf.h"
 
 #define ENABLE_DEBUG    (0)
 #if ENABLE_DEBUG
@@ -65,11 +72,59 @@ char addr_str[IPV6_MAX_ADDR_STR_LEN];
 
 #define SIXLOWPAN_FRAG_HDR_MASK         (0xf8)
 
-typedef struct lowpan_interval_list_t {
-    uint8_t                         start;
-    uint8_t                         end;
-    struct lowpan_interval_list_t   *next;
-} lowpan_interval_list_t;
+/* number of datagrams that can be reassembled at the same time */
+#ifndef LOWPAN_REAS_BUF_NUMOF
+#define LOWPAN_REAS_BUF_NUMOF           (4)
+#endif
+
+/* every reassembly may need a datagram of the large size class */
+#if PKTBUF_LARGE_NUM < LOWPAN_REAS_BUF_NUMOF + 1
+#error "PKTBUF_LARGE_NUM must be larger than LOWPAN_REAS_BUF_NUMOF"
+#endif
+
+/* datagram_size is an 11 bit field, fragments are 8 octet aligned */
+#define LOWPAN_REAS_MAX_SIZE            (2048)
+#define LOWPAN_REAS_UNIT                (8)
+#define LOWPAN_REAS_MAP_LEN             (LOWPAN_REAS_MAX_SIZE / LOWPAN_REAS_UNIT / 8)
+
+/* number of flows whose compressed IPHC header is cached per direction */
+#ifndef LOWPAN_IPHC_CACHE_SIZE
+#define LOWPAN_IPHC_CACHE_SIZE          (2)
+#endif
+
+/* datagrams forwarded fragment by fragment at the same time */
+#ifndef LOWPAN_VRB_NUMOF
+#define LOWPAN_VRB_NUMOF                (4)
+#endif
+
+/* a datagram whose next fragment takes longer is forgotten */
+#define LOWPAN_VRB_TIMEOUT              (2 * 1000 * 1000)
+
+/* next hops whose fragment pacing is remembered */
+#ifndef LOWPAN_PACE_NUMOF
+#define LOWPAN_PACE_NUMOF               (4)
+#endif
+
+/* bounds of the gap between two fragments to the same next hop in us */
+#ifndef LOWPAN_PACE_GAP_MIN
+#define LOWPAN_PACE_GAP_MIN             (2000)
+#endif
+#ifndef LOWPAN_PACE_GAP_MAX
+#define LOWPAN_PACE_GAP_MAX             (200000)
+#endif
+
+/* source routing headers are sent as SRH-6LoRH, received ones are always
+ * understood */
+#ifndef LOWPAN_LORH_SRH
+#define LOWPAN_LORH_SRH                 (1)
+#endif
+
+/* page dispatch, size and type of an SRH-6LoRH */
+#define LOWPAN_LORH_HDR_LEN             (3)
+
+/* dispatch + CID + TF + NH + HLIM + two inline addresses */
+#define LOWPAN_IPHC_MAX_HDR_LEN         (2 + 1 + 4 + 1 + 1 + 16 + 16)
+#define LOWPAN_IPHC_HLIM_ELIDED         (0xff)
 
 /**
  * @brief   6LoWPAN reassembly buffer.
@@ -92,28 +147,110 @@ typedef struct lowpan_reas_buf_t {
      */
     uint16_t current_packet_size;
     /**
-     * @brief   Pointer to allocated memory for reassembled packet + 6LoWPAN
-     *          Dispatch Byte
+     * @brief   Packet buffer holding the reassembled packet
+     */
+    pktbuf_t *pkt;
+    /**
+     * @brief   Pointer to the data of lowpan_reas_buf_t::pkt (reassembled
+     *          packet + 6LoWPAN Dispatch Byte)
      */
     uint8_t *packet;
     /**
-     * @brief   Pointer to list of intervals of received packet fragments
-     *          (if any)
+     * @brief   Bitmap of received 8 octet units of the datagram
+     */
+    uint8_t received[LOWPAN_REAS_MAP_LEN];
+    /**
+     * @brief   Class of the complete packet, TRANSCEIVER_TX_PRIO_*
      */
-    lowpan_interval_list_t *interval_list_head;
+    uint8_t priority;
     struct lowpan_reas_buf_t *next;
 } lowpan_reas_buf_t;
 
+/**
+ * @brief   Compressed header of a recently sent or received flow.
+ *
+ * Everything in the IPv6 header except payload length and, if it is
+ * carried inline, hop limit determines the IPHC header. A flow that hits
+ * the cache therefore only needs a copy and a patch of the hop limit.
+ */
+typedef struct {
+    uint8_t valid;
+    uint8_t context_gen;            ///< lowpan_context_gen at creation
+    uint8_t hlim_pos;               ///< offset of inline hop limit in hdr
+    uint8_t hdr_len;                ///< length of hdr
+    uint8_t hdr[LOWPAN_IPHC_MAX_HDR_LEN];   ///< compressed header
+    ipv6_hdr_t ip;                  ///< uncompressed header, no length
+    /**
+     * @brief   Outbound: own IID and link-layer destination.
+     *          Inbound: link-layer source and destination.
+     */
+    uint8_t ll_addr[2][8];
+    int if_id;                      ///< outbound only
+    uint8_t dest_len;               ///< outbound only
+} lowpan_iphc_flow_t;
+
+/**
+ * @brief   Virtual reassembly buffer of a datagram forwarded fragment by
+ *          fragment.
+ */
+typedef struct {
+    uint8_t used;
+    net_if_eui64_t s_addr;          ///< previous hop
+    uint16_t tag;                   ///< datagram tag from the previous hop
+    uint16_t size;                  ///< datagram size
+    uint16_t tag_out;               ///< datagram tag to the next hop
+    timex_t timestamp;              ///< time of the last fragment
+    int if_id;                      ///< next hop
+    uint8_t lladdr[8];
+    uint8_t lladdr_len;
+    uint8_t priority;               ///< class of the datagram
+} lowpan_vrb_t;
+
+/**
+ * @brief   Pacing of the fragments sent to a next hop.
+ *
+ * The next hop needs about as long to pass a fragment on as it took to
+ * get it, and has a single transceiver buffer meanwhile.  The gap after
+ * a fragment is at least the time its transmission took, ACK included;
+ * a transmission much slower than the fastest seen needed retries, the
+ * next hop or the channel is busy, and doubles the gap, every quick one
+ * shrinks it again by an eighth.
+ */
+typedef struct {
+    uint8_t lladdr[8];
+    uint8_t lladdr_len;             ///< 0 if unused
+    uint32_t gap;                   ///< us after a fragment
+    uint32_t tx_min;                ///< fastest transmission in us
+} lowpan_pace_t;
+
 extern mutex_t lowpan_context_mutex;
 uint16_t tag = 0;
 uint8_t max_frag_initial = 0;
 uint8_t max_frag;
 
-static uint16_t packet_length;
 static sixlowpan_lowpan_iphc_status_t iphc_status = LOWPAN_IPHC_ENABLE;
 static ipv6_hdr_t *ipv6_buf;
+/* datagrams under reassembly, least recently refreshed first */
 static lowpan_reas_buf_t *head = NULL;
+static lowpan_reas_buf_t *tail = NULL;
 static lowpan_reas_buf_t *packet_fifo = NULL;
+static lowpan_reas_buf_t reas_pool[LOWPAN_REAS_BUF_NUMOF];
+static lowpan_reas_buf_t *reas_pool_free = NULL;
+static uint8_t reas_pool_initialized = 0;
+
+static lowpan_vrb_t lowpan_vrb[LOWPAN_VRB_NUMOF];
+
+static lowpan_pace_t lowpan_pace[LOWPAN_PACE_NUMOF];
+static uint8_t lowpan_pace_next = 0;
+
+static lowpan_iphc_flow_t iphc_tx_cache[LOWPAN_IPHC_CACHE_SIZE];
+static lowpan_iphc_flow_t iphc_rx_cache[LOWPAN_IPHC_CACHE_SIZE];
+static uint8_t iphc_tx_cache_next = 0;
+static uint8_t iphc_rx_cache_next = 0;
+/* bumped whenever the context table changes, invalidates cached flows */
+static uint8_t lowpan_context_gen = 0;
+/* bumped on every change of a context, lifetimes included */
+static uint16_t lowpan_context_version = 0;
 
 /* length of compressed packet */
 uint16_t comp_len;
@@ -134,19 +271,27 @@ mutex_t lowpan_context_mutex;
 int sixlowpan_reg[SIXLOWPAN_MAX_REGISTERED];
 static sixlowpan_lowpan_frame_t current_frame;
 
+#if !SIXLOWPAN_RUN_TO_COMPLETION || defined(MODULE_SIXLOWBORDER)
 char ip_process_buf[IP_PROCESS_STACKSIZE];
+#endif
 char con_buf[CON_STACKSIZE];
+#if !SIXLOWPAN_RUN_TO_COMPLETION
 char lowpan_transfer_buf[LOWPAN_TRANSFER_BUF_STACKSIZE];
+#endif
 lowpan_context_t contexts[NDP_6LOWPAN_CONTEXT_MAX];
 uint8_t context_len = 0;
+/* prefixes of contexts for compression, index + 1 of each CID for
+ * decompression */
+static ipv6_lpm_t context_trie = IPV6_LPM_INIT;
+static uint8_t context_by_cid[NDP_6LOWPAN_CONTEXT_MAX];
 uint16_t local_address = 0;
 
 int lowpan_init(int as_border);
 void lowpan_context_auto_remove(void);
 uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
                              ipv6_hdr_t *ipv6_buf_extra, uint8_t *ptr);
-void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
-                          net_if_eui64_t *d_addr);
+int lowpan_iphc_decoding(pktbuf_t *pkt, uint8_t *data, uint8_t length,
+                         net_if_eui64_t *s_addr, net_if_eui64_t *d_addr);
 void add_fifo_packet(lowpan_reas_buf_t *current_packet);
 lowpan_reas_buf_t *collect_garbage_fifo(lowpan_reas_buf_t *current_buf);
 lowpan_reas_buf_t *collect_garbage(lowpan_reas_buf_t *current_buf);
@@ -157,6 +302,131 @@ void print_long_local_addr(net_if_eui64_t *saddr);
 lowpan_context_t *lowpan_context_lookup(ipv6_addr_t *addr);
 
 /* deliver packet to mac*/
+static lowpan_pace_t *lowpan_pace_get(const void *lladdr, uint8_t len)
+{
+    lowpan_pace_t *p;
+
+    if (len > sizeof(p->lladdr)) {
+        len = sizeof(p->lladdr);
+    }
+
+    for (int i = 0; i < LOWPAN_PACE_NUMOF; i++) {
+        p = &lowpan_pace[i];
+
+        if ((p->lladdr_len == len) && (memcmp(p->lladdr, lladdr, len) == 0)) {
+            return p;
+        }
+    }
+
+    p = &lowpan_pace[lowpan_pace_next];
+    lowpan_pace_next = (lowpan_pace_next + 1) % LOWPAN_PACE_NUMOF;
+
+    memcpy(p->lladdr, lladdr, len);
+    p->lladdr_len = len;
+    p->gap = LOWPAN_PACE_GAP_MIN;
+    p->tx_min = UINT32_MAX;
+    return p;
+}
+
+static void lowpan_pace_update(lowpan_pace_t *p, uint32_t tx, int res)
+{
+    if ((res < 0) || ((p->tx_min != UINT32_MAX) && (tx > 2 * p->tx_min))) {
+        p->gap = (p->gap > LOWPAN_PACE_GAP_MAX / 2) ?
+                 LOWPAN_PACE_GAP_MAX : 2 * p->gap;
+    }
+    else {
+        p->gap -= p->gap / 8;
+    }
+
+    if ((res >= 0) && (tx < p->tx_min)) {
+        p->tx_min = tx;
+    }
+
+    if (p->gap < tx) {
+        p->gap = (tx < LOWPAN_PACE_GAP_MAX) ? tx : LOWPAN_PACE_GAP_MAX;
+    }
+
+    if (p->gap < LOWPAN_PACE_GAP_MIN) {
+        p->gap = LOWPAN_PACE_GAP_MIN;
+    }
+}
+
+/* sends a fragment, waits for the gap of the next hop unless it is the
+ * last one */
+static int lowpan_send_frag(int if_id, const void *dest, uint8_t dest_len,
+                            const uint8_t *hdr, uint8_t hdr_len,
+                            const uint8_t *data, uint8_t len, uint8_t mcast,
+                            uint8_t priority, lowpan_pace_t *pace, int last)
+{
+    uint64_t start = vtimer_now64();
+    int res = sixlowpan_mac_send_ieee802154_frame_gather(if_id, dest, dest_len,
+                                                         hdr, hdr_len, data,
+                                                         len, mcast, priority);
+
+    lowpan_pace_update(pace, (uint32_t)(vtimer_now64() - start), res);
+
+    if (!last) {
+        DEBUG("lowpan: fragment gap %" PRIu32 " us\n", pace->gap);
+        vtimer_usleep(pace->gap);
+    }
+
+    return res;
+}
+
+#if LOWPAN_LORH_SRH
+/*
+ * RFC 8138: removes the source routing header of the packet to send and
+ * writes the page dispatch and an SRH-6LoRH with the hops still to visit
+ * to lorh, returns its length, 0 if there is none.  Every hop is carried
+ * as the octets it does not share with the final destination.
+ */
+static uint8_t lowpan_lorh_srh_encode(ipv6_hdr_t *packet, uint8_t *lorh)
+{
+    ipv6_addr_t hops[IPV6_SRH_MAX_HOPS];
+    uint8_t common = IPV6_ADDR_LEN;
+    uint8_t type = 0;
+    uint8_t size;
+    int numof;
+
+    if (packet->nextheader != IPV6_PROTO_NUM_ROUTING) {
+        return 0;
+    }
+
+    /* a malformed header is sent as it is */
+    numof = ipv6_srh_remove(packet, hops, IPV6_SRH_MAX_HOPS);
+
+    if (numof <= 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < numof; i++) {
+        uint8_t c = 0;
+
+        while ((c < common) && (hops[i].uint8[c] == packet->destaddr.uint8[c])) {
+            c++;
+        }
+
+        common = c;
+    }
+
+    while ((1 << type) < IPV6_ADDR_LEN - common) {
+        type++;
+    }
+
+    size = 1 << type;
+    lorh[0] = SIXLOWPAN_PAGE1_DISPATCH;
+    lorh[1] = SIXLOWPAN_LORH_CRITICAL | (numof - 1);
+    lorh[2] = type;
+
+    for (int i = 0; i < numof; i++) {
+        memcpy(&lorh[LOWPAN_LORH_HDR_LEN + i * size],
+               &hops[i].uint8[IPV6_ADDR_LEN - size], size);
+    }
+
+    return LOWPAN_LORH_HDR_LEN + numof * size;
+}
+#endif
+
 int sixlowpan_lowpan_sendto(int if_id, const void *dest, int dest_len,
                             uint8_t *data, uint16_t data_len)
 {
@@ -164,6 +434,10 @@ int sixlowpan_lowpan_sendto(int if_id, const void *dest, int dest_len,
 
     ipv6_buf = (ipv6_hdr_t *) data;
     uint16_t send_packet_length = data_len;
+    /* taken before the header is compressed */
+    uint8_t priority = ipv6_get_priority(ipv6_buf);
+
+    TRACE(TRACE_LOWPAN_TX, data_len);
 
     if (ipv6_addr_is_multicast(&ipv6_buf->destaddr)) {
         /* send broadcast */
@@ -197,10 +471,25 @@ int sixlowpan_lowpan_sendto(int if_id, const void *dest, int dest_len,
 
 
     if (iphc_status == LOWPAN_IPHC_ENABLE) {
+#if LOWPAN_LORH_SRH
+        uint8_t lorh[LOWPAN_LORH_HDR_LEN + IPV6_SRH_MAX_HOPS * IPV6_ADDR_LEN];
+        uint8_t lorh_len = lowpan_lorh_srh_encode(ipv6_buf, lorh);
+#endif
+
         if (!lowpan_iphc_encoding(if_id, dest, dest_len, ipv6_buf, data)) {
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_TX_FAILED);
             return -1;
         }
 
+#if LOWPAN_LORH_SRH
+        /* the 6LoRH goes in front of the IPHC header */
+        if (lorh_len) {
+            memmove(&comp_buf[lorh_len], comp_buf, comp_len);
+            memcpy(comp_buf, lorh, lorh_len);
+            comp_len += lorh_len;
+        }
+#endif
+
         data = &comp_buf[0];
         send_packet_length = comp_len;
     }
@@ -222,7 +511,8 @@ int sixlowpan_lowpan_sendto(int if_id, const void *dest, int dest_len,
             max_frame = PAYLOAD_SIZE - IEEE_802154_MAX_HDR_LEN;
         }
 
-        uint8_t fragbuf[max_frame + 5];
+        uint8_t fraghdr[5];
+        lowpan_pace_t *pace = lowpan_pace_get(dest, dest_len);
 
         /* first fragment */
         max_frag_initial = ((max_frame - 4) / 8) * 8;
@@ -233,64 +523,59 @@ int sixlowpan_lowpan_sendto(int if_id, const void *dest, int dest_len,
             datagram_size--;
         }
 
-        memcpy(&fragbuf[4], data, max_frag_initial);
+        fraghdr[0] = ((SIXLOWPAN_FRAG1_DISPATCH << 8) | datagram_size) >> 8;
+        fraghdr[1] = (SIXLOWPAN_FRAG1_DISPATCH << 8) | datagram_size;
+        fraghdr[2] = tag >> 8;
+        fraghdr[3] = tag;
 
-        fragbuf[0] = ((SIXLOWPAN_FRAG1_DISPATCH << 8) | datagram_size) >> 8;
-        fragbuf[1] = (SIXLOWPAN_FRAG1_DISPATCH << 8) | datagram_size;
-        fragbuf[2] = tag >> 8;
-        fragbuf[3] = tag;
-
-        sixlowpan_mac_send_ieee802154_frame(if_id, dest, dest_len,
-                                            &fragbuf,
-                                            max_frag_initial + 4,
-                                            mcast);
+        /* the fragments are gathered from the datagram into the frame */
+        lowpan_send_frag(if_id, dest, dest_len, fraghdr, 4, data,
+                         max_frag_initial, mcast, priority, pace, 0);
 
         /* subsequent fragments */
         position = max_frag_initial;
         max_frag = ((max_frame - 5) / 8) * 8;
 
-        data += position;
+        fraghdr[0] = ((SIXLOWPAN_FRAGN_DISPATCH << 8) | datagram_size) >> 8;
+        fraghdr[1] = (SIXLOWPAN_FRAGN_DISPATCH << 8) | datagram_size;
 
         while (send_packet_length - position > max_frame - 5) {
-            memset(&fragbuf[0], 0, sizeof(fragbuf));
-            memcpy(&fragbuf[5], data, max_frag);
-
-            fragbuf[0] = ((SIXLOWPAN_FRAGN_DISPATCH << 8) | datagram_size) >> 8;
-            fragbuf[1] = (SIXLOWPAN_FRAGN_DISPATCH << 8) | datagram_size;
-            fragbuf[2] = tag >> 8;
-            fragbuf[3] = tag;
-            fragbuf[4] = position / 8;
-
-            sixlowpan_mac_send_ieee802154_frame(if_id, dest, dest_len,
-                                                &fragbuf,
-                                                max_frag + 5, mcast);
-            data += max_frag;
+            fraghdr[4] = position / 8;
+
+            lowpan_send_frag(if_id, dest, dest_len, fraghdr, 5,
+                             data + position, max_frag, mcast, priority,
+                             pace, 0);
             position += max_frag;
         }
 
         remaining = send_packet_length - position;
-
-        memset(&fragbuf[0], 0, sizeof(fragbuf));
-        memcpy(&fragbuf[5], data, remaining);
-
-        fragbuf[0] = ((SIXLOWPAN_FRAGN_DISPATCH << 8) | datagram_size) >> 8;
-        fragbuf[1] = (SIXLOWPAN_FRAGN_DISPATCH << 8) | datagram_size;
-        fragbuf[2] = tag >> 8;
-        fragbuf[3] = tag;
-        fragbuf[4] = position / 8;
+        fraghdr[4] = position / 8;
 
         tag++;
 
-        if (sixlowpan_mac_send_ieee802154_frame(if_id, dest, dest_len,
-                                                &fragbuf, remaining + 5, mcast) < 0) {
+        if (lowpan_send_frag(if_id, dest, dest_len, fraghdr, 5,
+                             data + position, remaining, mcast, priority,
+                             pace, 1) < 0) {
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_TX_FAILED);
             return -1;
         }
     }
     else {
-        return sixlowpan_mac_send_ieee802154_frame(if_id, dest, dest_len, data,
-                                                   send_packet_length, mcast);
+        int res = sixlowpan_mac_send_ieee802154_frame(if_id, dest, dest_len,
+                                                      data, send_packet_length,
+                                                      mcast, priority);
+
+        if (res < 0) {
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_TX_FAILED);
+        }
+        else {
+            NETSTAT_TX(NETSTAT_LAYER_LOWPAN);
+        }
+
+        return res;
     }
 
+    NETSTAT_TX(NETSTAT_LAYER_LOWPAN);
     return data_len;
 }
 
@@ -309,10 +594,28 @@ void print_long_local_addr(net_if_eui64_t *saddr)
            ((uint8_t *)saddr)[6], ((uint8_t *)saddr)[7]);
 }
 
+static void print_reas_intervals(lowpan_reas_buf_t *buf)
+{
+    uint16_t units = (buf->packet_size + LOWPAN_REAS_UNIT - 1) / LOWPAN_REAS_UNIT;
+    int start = -1;
+
+    for (uint16_t i = 0; i <= units; i++) {
+        int set = (i < units) && (buf->received[i / 8] & (1 << (i % 8)));
+
+        if (set && (start < 0)) {
+            start = i;
+        }
+        else if (!set && (start >= 0)) {
+            printf("\t%i - %i\n", start * LOWPAN_REAS_UNIT,
+                   i * LOWPAN_REAS_UNIT - 1);
+            start = -1;
+        }
+    }
+}
+
 void sixlowpan_lowpan_print_reassembly_buffers(void)
 {
     lowpan_reas_buf_t *temp_buffer;
-    lowpan_interval_list_t *temp_interval;
     temp_buffer = head;
 
     printf("\n\n--- Reassembly Buffers ---\n");
@@ -322,12 +625,7 @@ void sixlowpan_lowpan_print_reassembly_buffers(void)
         printf("Ident.: %i, Packet Size: %i/%i, Timestamp: %"PRIu64"\n",
                temp_buffer->tag, temp_buffer->current_packet_size,
                temp_buffer->packet_size, timex_uint64(temp_buffer->timestamp));
-        temp_interval = temp_buffer->interval_list_head;
-
-        while (temp_interval != NULL) {
-            printf("\t%i - %i\n", temp_interval->start, temp_interval->end);
-            temp_interval = temp_interval->next;
-        }
+        print_reas_intervals(temp_buffer);
 
         temp_buffer = temp_buffer->next;
     }
@@ -336,7 +634,6 @@ void sixlowpan_lowpan_print_reassembly_buffers(void)
 void sixlowpan_lowpan_print_fifo_buffers(void)
 {
     lowpan_reas_buf_t *temp_buffer;
-    lowpan_interval_list_t *temp_interval;
     temp_buffer = packet_fifo;
 
     printf("\n\n--- Reassembly Buffers ---\n");
@@ -346,80 +643,223 @@ void sixlowpan_lowpan_print_fifo_buffers(void)
         printf("Ident.: %i, Packet Size: %i/%i, Timestamp: %"PRIu64"\n",
                temp_buffer->tag, temp_buffer->current_packet_size,
                temp_buffer->packet_size, timex_uint64(temp_buffer->timestamp));
-        temp_interval = temp_buffer->interval_list_head;
-
-        while (temp_interval != NULL) {
-            printf("\t%i - %i\n", temp_interval->start, temp_interval->end);
-            temp_interval = temp_interval->next;
-        }
+        print_reas_intervals(temp_buffer);
 
         temp_buffer = temp_buffer->next;
     }
 }
 #endif
 
-void lowpan_transfer(void)
+/* hands a received IPv6 packet to the IP layer, the caller keeps its
+ * reference */
+static void lowpan_ip_deliver(pktbuf_t *pkt)
 {
+    NETSTAT_RX(NETSTAT_LAYER_LOWPAN);
+    TRACE(TRACE_LOWPAN_DELIVER, pkt->len);
+
+#if SIXLOWPAN_RUN_TO_COMPLETION
+    /* the border router still processes packets in its own thread */
+    if (!ip_process_pid) {
+        ipv6_process_packet(pkt);
+        return;
+    }
+#endif
+
     msg_t m_recv, m_send;
-    ipv6_hdr_t *ipv6_buf;
+    m_send.content.ptr = (char *) pkt;
+    msg_send_receive(&m_send, &m_recv, ip_process_pid);
+}
+
+/* length of the page dispatch and SRH-6LoRH at data, the number of hops
+ * and the octets carried of each, -1 if there is no SRH-6LoRH */
+static int lowpan_lorh_srh_parse(const uint8_t *data, uint16_t length,
+                                 uint8_t *numof, uint8_t *size)
+{
+    if ((length < LOWPAN_LORH_HDR_LEN) ||
+        (data[0] != SIXLOWPAN_PAGE1_DISPATCH) ||
+        ((data[1] & SIXLOWPAN_LORH_MASK) != SIXLOWPAN_LORH_CRITICAL) ||
+        (data[2] > SIXLOWPAN_LORH_SRH_TYPE_MAX)) {
+        return -1;
+    }
+
+    *numof = (data[1] & ~SIXLOWPAN_LORH_MASK) + 1;
+    *size = 1 << data[2];
+
+    if ((*numof > IPV6_SRH_MAX_HOPS) ||
+        (LOWPAN_LORH_HDR_LEN + *numof * *size >= length)) {
+        return -1;
+    }
+
+    return LOWPAN_LORH_HDR_LEN + *numof * *size;
+}
+
+/* hop i of an SRH-6LoRH, the rest of its octets from the destination */
+static void lowpan_lorh_srh_hop(const uint8_t *data, uint8_t size, uint8_t i,
+                                const ipv6_addr_t *dest, ipv6_addr_t *hop)
+{
+    memcpy(hop, dest, sizeof(ipv6_addr_t));
+    memcpy(&hop->uint8[IPV6_ADDR_LEN - size],
+           &data[LOWPAN_LORH_HDR_LEN + i * size], size);
+}
+
+/* decompresses an SRH-6LoRH and the IPHC header behind it, the packet
+ * gets its source routing header back with this node as destination */
+static int lowpan_lorh_decoding(pktbuf_t *pkt, uint8_t *data, uint16_t length,
+                                net_if_eui64_t *s_addr, net_if_eui64_t *d_addr)
+{
+    ipv6_addr_t hops[IPV6_SRH_MAX_HOPS];
+    uint8_t numof, size;
+    int pos = lowpan_lorh_srh_parse(data, length, &numof, &size);
+
+    if ((pos < 0) ||
+        ((data[pos] & 0xe0) != SIXLOWPAN_IPHC1_DISPATCH) ||
+        (lowpan_iphc_decoding(pkt, &data[pos], length - pos, s_addr,
+                              d_addr) < 0)) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < numof; i++) {
+        lowpan_lorh_srh_hop(data, size, i, &ipv6_buf->destaddr, &hops[i]);
+    }
+
+    return (ipv6_srh_insert(ipv6_buf, hops, numof) < 0) ? -1 : 0;
+}
+
+/* a reference to the uncompressed packet in a reassembly buffer, behind
+ * *skip* dispatch octets, NULL if it does not fit the IPv6 MTU */
+static pktbuf_t *lowpan_uncompressed_hold(lowpan_reas_buf_t *buf, uint8_t skip)
+{
+    if (buf->packet_size - skip > IPV6_MTU) {
+        DEBUG("ERROR: uncompressed packet exceeds IPV6_MTU\n");
+        NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_MALFORMED);
+        return NULL;
+    }
+
+    pktbuf_hold(buf->pkt);
+    pktbuf_pull(buf->pkt, skip);
+
+    return buf->pkt;
+}
+
+/* a buffer to decompress a packet of at most *size* octets into */
+static pktbuf_t *lowpan_decoding_alloc(uint16_t size)
+{
+    pktbuf_t *pkt = pktbuf_alloc((size < IPV6_MTU) ? size : IPV6_MTU, 0);
+
+    if (pkt == NULL) {
+        DEBUG("ERROR: no buffer to decompress into\n");
+        NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_NO_BUFFER);
+    }
+
+    return pkt;
+}
+
+/* cuts a decompressed packet down to the length its IPv6 header gives */
+static uint8_t *lowpan_decoding_trim(pktbuf_t *pkt)
+{
+    ipv6_hdr_t *hdr = (ipv6_hdr_t *) pkt->data;
+
+    return pktbuf_trim(pkt, IPV6_HDR_LEN + NTOHS(hdr->length));
+}
+
+/* processes the first complete packet of the highest class, 0 if there is
+ * none */
+static int lowpan_transfer_packet(void)
+{
+    pktbuf_t *pkt = NULL;
     lowpan_reas_buf_t *current_buf;
-    uint8_t gotosleep;
 
-    while (1) {
+    mutex_lock(&fifo_mutex);
+    current_buf = packet_fifo;
+    mutex_unlock(&fifo_mutex);
 
-        gotosleep = 1;
-        mutex_lock(&fifo_mutex);
-        current_buf = packet_fifo;
-
-        if (current_buf != NULL) {
-            mutex_unlock(&fifo_mutex);
-
-            if (current_buf->packet[0] == SIXLOWPAN_IPV6_DISPATCH) {
-                DEBUG("INFO: Uncompressed IPv6 dispatch (0x%02x) received\n",
-                      current_buf->packet[0]);
-                ipv6_buf = ipv6_get_buf();
-                memcpy(ipv6_buf, (current_buf->packet) + 1, current_buf->packet_size - 1);
-                m_send.content.ptr = (char *)ipv6_buf;
-                packet_length = current_buf->packet_size - 1;
-                msg_send_receive(&m_send, &m_recv, ip_process_pid);
-            }
-            else if (((current_buf->packet[0] & 0xf0) == IPV6_VER) &&
-                     (iphc_status == LOWPAN_IPHC_DISABLE)) {
-                ipv6_buf = ipv6_get_buf();
-                memcpy(ipv6_buf, (current_buf->packet), current_buf->packet_size);
-                m_send.content.ptr = (char *)ipv6_buf;
-                packet_length = current_buf->packet_size;
-                msg_send_receive(&m_send, &m_recv, ip_process_pid);
-            }
-            else if (((current_buf->packet[0] & 0xe0) == SIXLOWPAN_IPHC1_DISPATCH) &&
-                     (iphc_status == LOWPAN_IPHC_ENABLE)) {
-                DEBUG("INFO: IPHC1 dispatch 0x%02x received, decompress\n",
-                      current_buf->packet[0]);
-                lowpan_iphc_decoding(current_buf->packet,
-                                     current_buf->packet_size,
-                                     &(current_buf->s_addr),
-                                     &(current_buf->d_addr));
-
-                ipv6_buf = ipv6_get_buf();
-                m_send.content.ptr = (char *) ipv6_buf;
-                msg_send_receive(&m_send, &m_recv, ip_process_pid);
-            }
-            else {
-                DEBUG("ERROR: packet with unknown dispatch 0x%02x received\n",
-                      current_buf->packet[0]);
-            }
+    if (current_buf == NULL) {
+        return 0;
+    }
 
-            collect_garbage_fifo(current_buf);
-            gotosleep = 0;
+    if (current_buf->packet[0] == SIXLOWPAN_IPV6_DISPATCH) {
+        DEBUG("INFO: Uncompressed IPv6 dispatch (0x%02x) received\n",
+              current_buf->packet[0]);
+        /* handed on in place, without the dispatch octet */
+        pkt = lowpan_uncompressed_hold(current_buf, 1);
+    }
+    else if (((current_buf->packet[0] & 0xf0) == IPV6_VER) &&
+             (iphc_status == LOWPAN_IPHC_DISABLE)) {
+        pkt = lowpan_uncompressed_hold(current_buf, 0);
+    }
+    else if (((current_buf->packet[0] & 0xe0) == SIXLOWPAN_IPHC1_DISPATCH) &&
+             (iphc_status == LOWPAN_IPHC_ENABLE)) {
+        DEBUG("INFO: IPHC1 dispatch 0x%02x received, decompress\n",
+              current_buf->packet[0]);
+        pkt = lowpan_decoding_alloc(current_buf->packet_size +
+                                    IPV6_HDR_LEN + UDP_HDR_LEN);
+
+        if ((pkt != NULL) &&
+            ((lowpan_iphc_decoding(pkt, current_buf->packet,
+                                   current_buf->packet_size,
+                                   &(current_buf->s_addr),
+                                   &(current_buf->d_addr)) < 0) ||
+             (lowpan_decoding_trim(pkt) == NULL))) {
+            DEBUG("ERROR: malformed IPHC header\n");
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_MALFORMED);
+            pktbuf_release(pkt);
+            pkt = NULL;
+        }
+    }
+    else if ((current_buf->packet[0] == SIXLOWPAN_PAGE1_DISPATCH) &&
+             (iphc_status == LOWPAN_IPHC_ENABLE)) {
+        /* room for the source routing header to grow back */
+        pkt = lowpan_decoding_alloc(IPV6_MTU);
+
+        if ((pkt != NULL) &&
+            ((lowpan_lorh_decoding(pkt, current_buf->packet,
+                                   current_buf->packet_size,
+                                   &(current_buf->s_addr),
+                                   &(current_buf->d_addr)) < 0) ||
+             (lowpan_decoding_trim(pkt) == NULL))) {
+            DEBUG("ERROR: malformed 6LoRH or IPHC header\n");
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_MALFORMED);
+            pktbuf_release(pkt);
+            pkt = NULL;
         }
+    }
+    else {
+        DEBUG("ERROR: packet with unknown dispatch 0x%02x received\n",
+              current_buf->packet[0]);
+        NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_MALFORMED);
+    }
 
+    if (pkt != NULL) {
+        lowpan_ip_deliver(pkt);
+        pktbuf_release(pkt);
+    }
+
+    collect_garbage_fifo(current_buf);
+    return 1;
+}
 
-        if (gotosleep == 1) {
-            mutex_unlock(&fifo_mutex);
+#if !SIXLOWPAN_RUN_TO_COMPLETION
+void lowpan_transfer(void)
+{
+    while (1) {
+        if (!lowpan_transfer_packet()) {
             thread_sleep();
         }
     }
 }
+#endif
+
+/* called when a packet was added to the fifo */
+static void lowpan_transfer_notify(void)
+{
+#if SIXLOWPAN_RUN_TO_COMPLETION
+    while (lowpan_transfer_packet());
+#else
+    if (thread_getstatus(transfer_pid) == STATUS_SLEEPING) {
+        thread_wakeup(transfer_pid);
+    }
+#endif
+}
 
 uint8_t ll_get_addr_match(net_if_eui64_t *src, net_if_eui64_t *dst)
 {
@@ -449,48 +889,121 @@ uint8_t ll_get_addr_match(net_if_eui64_t *src, net_if_eui64_t *dst)
     return val;
 }
 
-lowpan_reas_buf_t *new_packet_buffer(uint16_t datagram_size,
-                                     uint16_t datagram_tag,
-                                     net_if_eui64_t *s_addr,
-                                     net_if_eui64_t *d_addr,
-                                     lowpan_reas_buf_t *current_buf,
-                                     lowpan_reas_buf_t *temp_buf)
+/* the pool is shared with the transfer thread, guarded by fifo_mutex */
+static lowpan_reas_buf_t *reas_pool_take(void)
 {
-    lowpan_reas_buf_t *new_buf = NULL;
+    lowpan_reas_buf_t *buf;
 
-    /* Allocate new memory for a new packet to be reassembled */
-    new_buf = malloc(sizeof(lowpan_reas_buf_t));
+    mutex_lock(&fifo_mutex);
 
-    if (new_buf != NULL) {
-        init_reas_bufs(new_buf);
+    if (!reas_pool_initialized) {
+        for (int i = 0; i < LOWPAN_REAS_BUF_NUMOF; i++) {
+            reas_pool[i].next = reas_pool_free;
+            reas_pool_free = &reas_pool[i];
+        }
 
-        new_buf->packet = malloc(datagram_size);
+        reas_pool_initialized = 1;
+    }
 
-        if (new_buf->packet != NULL) {
-            memcpy(&new_buf->s_addr, s_addr, 8);
-            memcpy(&new_buf->d_addr, d_addr, 8);
+    buf = reas_pool_free;
 
-            new_buf->tag = datagram_tag;
-            new_buf->packet_size = datagram_size;
+    if (buf != NULL) {
+        reas_pool_free = buf->next;
+    }
 
-            vtimer_now(&new_buf->timestamp);
+    mutex_unlock(&fifo_mutex);
 
-            if ((current_buf == NULL) && (temp_buf == NULL)) {
-                head = new_buf;
-            }
-            else {
-                temp_buf->next = new_buf;
-            }
+    return buf;
+}
 
-            return new_buf;
-        }
-        else {
-            return NULL;
-        }
+static void reas_pool_put(lowpan_reas_buf_t *buf)
+{
+    pktbuf_release(buf->pkt);
+    init_reas_bufs(buf);
+
+    mutex_lock(&fifo_mutex);
+    buf->next = reas_pool_free;
+    reas_pool_free = buf;
+    mutex_unlock(&fifo_mutex);
+}
+
+/* unlinks *buf* from the reassembly list, *prev* is its predecessor */
+static void reas_list_unlink(lowpan_reas_buf_t *buf, lowpan_reas_buf_t *prev)
+{
+    if (prev == NULL) {
+        head = buf->next;
     }
     else {
+        prev->next = buf->next;
+    }
+
+    if (tail == buf) {
+        tail = prev;
+    }
+
+    buf->next = NULL;
+}
+
+static void reas_list_append(lowpan_reas_buf_t *buf)
+{
+    buf->next = NULL;
+
+    if (tail == NULL) {
+        head = buf;
+    }
+    else {
+        tail->next = buf;
+    }
+
+    tail = buf;
+}
+
+lowpan_reas_buf_t *new_packet_buffer(uint16_t datagram_size,
+                                     uint16_t datagram_tag,
+                                     net_if_eui64_t *s_addr,
+                                     net_if_eui64_t *d_addr)
+{
+    lowpan_reas_buf_t *new_buf;
+
+    if (datagram_size > LOWPAN_REAS_MAX_SIZE) {
+        return NULL;
+    }
+
+    new_buf = reas_pool_take();
+
+    if ((new_buf == NULL) && (head != NULL)) {
+        /* all sessions busy: give up on the one idle for longest */
+        DEBUG("new_packet_buffer: dropping oldest reassembly\n");
+        NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_REAS_EVICTED);
+        new_buf = head;
+        reas_list_unlink(new_buf, NULL);
+        pktbuf_release(new_buf->pkt);
+    }
+
+    if (new_buf == NULL) {
+        return NULL;
+    }
+
+    init_reas_bufs(new_buf);
+
+    new_buf->pkt = pktbuf_alloc(datagram_size, 0);
+
+    if (new_buf->pkt == NULL) {
+        reas_pool_put(new_buf);
         return NULL;
     }
+
+    new_buf->packet = new_buf->pkt->data;
+    memcpy(&new_buf->s_addr, s_addr, 8);
+    memcpy(&new_buf->d_addr, d_addr, 8);
+
+    new_buf->tag = datagram_tag;
+    new_buf->packet_size = datagram_size;
+
+    vtimer_now(&new_buf->timestamp);
+    reas_list_append(new_buf);
+
+    return new_buf;
 }
 
 lowpan_reas_buf_t *get_packet_frag_buf(uint16_t datagram_size,
@@ -506,9 +1019,12 @@ lowpan_reas_buf_t *get_packet_frag_buf(uint16_t datagram_size,
             ((ll_get_addr_match(&current_buf->d_addr, d_addr)) == 64) &&
             (current_buf->packet_size == datagram_size) &&
             (current_buf->tag == datagram_tag) &&
-            current_buf->interval_list_head != NULL) {
-            /* Found buffer for current packet fragment */
+            current_buf->current_packet_size != 0) {
+            /* Found buffer for current packet fragment, moving it to the
+             * end keeps the list sorted by timestamp */
             vtimer_now(&current_buf->timestamp);
+            reas_list_unlink(current_buf, temp_buf);
+            reas_list_append(current_buf);
             return current_buf;
         }
 
@@ -516,66 +1032,38 @@ lowpan_reas_buf_t *get_packet_frag_buf(uint16_t datagram_size,
         current_buf = current_buf->next;
     }
 
-    return new_packet_buffer(datagram_size, datagram_tag, s_addr, d_addr,
-                             current_buf, temp_buf);
-}
-
-uint8_t is_in_interval(uint8_t start1, uint8_t end1, uint8_t start2, uint8_t end2)
-{
-    /* 1: Interval 1 and 2 are the same or overlapping */
-    /* 0: Interval 1 and 2 are not overlapping or the same */
-
-    if (((start1 < start2) && (start2 <= end1)) ||
-        ((start2 < start1) && (start1 <= end2)) ||
-        ((start1 == start2) && (end1 == end2))) {
-        return 1;
-    }
-    else {
-        return 0;
-    }
+    return new_packet_buffer(datagram_size, datagram_tag, s_addr, d_addr);
 }
 
 uint8_t handle_packet_frag_interval(lowpan_reas_buf_t *current_buf,
-                                    uint8_t datagram_offset,  uint8_t frag_size)
+                                    uint16_t datagram_offset, uint8_t frag_size)
 {
     /* 0: Error, discard fragment */
     /* 1: Finished correctly */
-    lowpan_interval_list_t *temp_interval = NULL, *current_interval = NULL, *new_interval = NULL;
-    current_interval = current_buf->interval_list_head;
+    uint16_t first = datagram_offset / LOWPAN_REAS_UNIT;
+    uint16_t last = (datagram_offset + frag_size - 1) / LOWPAN_REAS_UNIT;
 
-    while (current_interval != NULL) {
-        if (is_in_interval(current_interval->start, current_interval->end, datagram_offset, datagram_offset + frag_size) == 1) {
-            /* Interval is overlapping or the same as one of a previous fragment, discard fragment */
-            return 0;
-        }
-
-        temp_interval = current_interval;
-        current_interval = current_interval->next;
+    if ((frag_size == 0) ||
+        ((uint32_t) datagram_offset + frag_size > current_buf->packet_size)) {
+        return 0;
     }
 
-    new_interval = malloc(sizeof(lowpan_interval_list_t));
-
-    if (new_interval != NULL) {
-        new_interval->start = datagram_offset;
-        new_interval->end = datagram_offset + frag_size - 1;
-        new_interval->next = NULL;
-
-        if ((current_interval == NULL) && (temp_interval == NULL)) {
-            current_buf->interval_list_head = new_interval;
-        }
-        else {
-            temp_interval->next = new_interval;
+    for (uint16_t i = first; i <= last; i++) {
+        if (current_buf->received[i / 8] & (1 << (i % 8))) {
+            /* overlapping or the same as a previous fragment, discard */
+            return 0;
         }
+    }
 
-        return 1;
+    for (uint16_t i = first; i <= last; i++) {
+        current_buf->received[i / 8] |= (1 << (i % 8));
     }
 
-    return 0;
+    return 1;
 }
 
 lowpan_reas_buf_t *collect_garbage_fifo(lowpan_reas_buf_t *current_buf)
 {
-    lowpan_interval_list_t *temp_list, *current_list;
     lowpan_reas_buf_t *temp_buf, *my_buf, *return_buf;
 
     mutex_lock(&fifo_mutex);
@@ -600,60 +1088,30 @@ lowpan_reas_buf_t *collect_garbage_fifo(lowpan_reas_buf_t *current_buf)
 
     mutex_unlock(&fifo_mutex);
 
-    current_list = current_buf->interval_list_head;
-    temp_list = current_list;
-
-    while (current_list != NULL) {
-        temp_list = current_list->next;
-        free(current_list);
-        current_list = temp_list;
-    }
-
-    free(current_buf->packet);
-    free(current_buf);
+    reas_pool_put(current_buf);
 
     return return_buf;
 }
 
 lowpan_reas_buf_t *collect_garbage(lowpan_reas_buf_t *current_buf)
 {
-    lowpan_interval_list_t *temp_list, *current_list;
-    lowpan_reas_buf_t *temp_buf, *my_buf, *return_buf;
+    lowpan_reas_buf_t *temp_buf, *my_buf = NULL, *return_buf;
 
     temp_buf = head;
-    my_buf = temp_buf;
 
-    if (head == current_buf) {
-        head = current_buf->next;
-        return_buf = head;
-    }
-    else {
-        while (temp_buf != current_buf) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
-
-        my_buf->next = current_buf->next;
-
-        return_buf = my_buf->next;
+    while (temp_buf != current_buf) {
+        my_buf = temp_buf;
+        temp_buf = temp_buf->next;
     }
 
-    current_list = current_buf->interval_list_head;
-    temp_list = current_list;
-
-    while (current_list != NULL) {
-        temp_list = current_list->next;
-        free(current_list);
-        current_list = temp_list;
-    }
-
-    free(current_buf->packet);
-    free(current_buf);
+    return_buf = current_buf->next;
+    reas_list_unlink(current_buf, my_buf);
+    reas_pool_put(current_buf);
 
     return return_buf;
 }
 
-void handle_packet_fragment(uint8_t *data, uint8_t datagram_offset,
+void handle_packet_fragment(uint8_t *data, uint16_t datagram_offset,
                             uint16_t datagram_size, uint16_t datagram_tag,
                             net_if_eui64_t *s_addr, net_if_eui64_t *d_addr,
                             uint8_t hdr_length, uint8_t frag_size)
@@ -672,111 +1130,455 @@ void handle_packet_fragment(uint8_t *data, uint8_t datagram_offset,
 
         if (current_buf->current_packet_size == current_buf->packet_size) {
             add_fifo_packet(current_buf);
-
-            if (thread_getstatus(transfer_pid) == STATUS_SLEEPING) {
-                thread_wakeup(transfer_pid);
-            }
+            lowpan_transfer_notify();
         }
     }
     else {
         /* No memory left or duplicate */
         if (current_buf == NULL) {
             printf("ERROR: no memory left!\n");
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_NO_BUFFER);
         }
         else {
             printf("ERROR: duplicate fragment!\n");
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_DUPLICATE);
+
+            if (current_buf->current_packet_size == 0) {
+                /* a buffer was set up for this fragment alone */
+                collect_garbage(current_buf);
+            }
+        }
+    }
+}
+
+void check_timeout(void)
+{
+    timex_t now;
+    vtimer_now(&now);
+
+    /* the list is ordered by timestamp, so only its front can be due */
+    while ((head != NULL) &&
+           ((timex_uint64(now) - timex_uint64(head->timestamp)) >= LOWPAN_REAS_BUF_TIMEOUT)) {
+        printf("TIMEOUT!cur_time: %" PRIu64 ", temp_buf: %" PRIu64 "\n", timex_uint64(now),
+               timex_uint64(head->timestamp));
+        NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_REAS_TIMEOUT);
+        TRACE(TRACE_LOWPAN_TIMEOUT, head->tag);
+        collect_garbage(head);
+    }
+}
+
+/* ipv6_get_priority() of a packet whose ICMPv6 type is not at hand, all
+ * of ICMPv6 is control then */
+static uint8_t lowpan_header_priority(uint8_t next_header, uint8_t tclass)
+{
+    if (next_header == IPV6_PROTO_NUM_ICMPV6) {
+        return TRANSCEIVER_TX_PRIO_CONTROL;
+    }
+
+    return ipv6_traffic_class_priority(tclass);
+}
+
+/* class of a complete datagram, read from its header before it is
+ * decompressed */
+static uint8_t lowpan_rx_priority(const uint8_t *data, uint16_t length)
+{
+    uint8_t numof, size, tc = 0, pos;
+    int start = 0;
+
+    if (data[0] == SIXLOWPAN_IPV6_DISPATCH) {
+        return (length > 1 + IPV6_HDR_LEN) ?
+               ipv6_get_priority((const ipv6_hdr_t *) &data[1]) :
+               TRANSCEIVER_TX_PRIO_DATA;
+    }
+
+    if ((data[0] & 0xf0) == IPV6_VER) {
+        return (length > IPV6_HDR_LEN) ?
+               ipv6_get_priority((const ipv6_hdr_t *) data) :
+               TRANSCEIVER_TX_PRIO_DATA;
+    }
+
+    if (data[0] == SIXLOWPAN_PAGE1_DISPATCH) {
+        start = lowpan_lorh_srh_parse(data, length, &numof, &size);
+    }
+
+    if ((start < 0) || (start + 8 > length) ||
+        ((data[start] & 0xe0) != SIXLOWPAN_IPHC1_DISPATCH)) {
+        return TRANSCEIVER_TX_PRIO_DATA;
+    }
+
+    data += start;
+    pos = (data[1] & SIXLOWPAN_IPHC2_CID) ? 3 : 2;
+
+    /* the inline traffic class is ECN and DSCP, in this order */
+    switch (data[0] & (SIXLOWPAN_IPHC1_FL_C | SIXLOWPAN_IPHC1_TC_C)) {
+        case 0:
+            tc = (uint8_t)(data[pos] << 2) | (data[pos] >> 6);
+            pos += 4;
+            break;
+
+        case SIXLOWPAN_IPHC1_FL_C:
+            tc = (uint8_t)(data[pos] << 2) | (data[pos] >> 6);
+            pos++;
+            break;
+
+        case SIXLOWPAN_IPHC1_TC_C:
+            pos += 3;
+            break;
+
+        default:
+            break;
+    }
+
+    return lowpan_header_priority((data[0] & SIXLOWPAN_IPHC1_NH) ?
+                                  IPV6_PROTO_NUM_UDP : data[pos], tc);
+}
+
+/* moves a complete packet to the fifo, behind the packets of its class
+ * and before those of lower classes */
+void add_fifo_packet(lowpan_reas_buf_t *current_packet)
+{
+    lowpan_reas_buf_t *temp_buf, *my_buf = NULL;
+
+    temp_buf = head;
+
+    while (temp_buf != current_packet) {
+        my_buf = temp_buf;
+        temp_buf = temp_buf->next;
+    }
+
+    reas_list_unlink(current_packet, my_buf);
+
+    current_packet->priority = lowpan_rx_priority(current_packet->packet,
+                                                  current_packet->packet_size);
+    my_buf = NULL;
+
+    mutex_lock(&fifo_mutex);
+
+    temp_buf = packet_fifo;
+
+    while ((temp_buf != NULL) &&
+           (temp_buf->priority <= current_packet->priority)) {
+        my_buf = temp_buf;
+        temp_buf = temp_buf->next;
+    }
+
+    current_packet->next = temp_buf;
+
+    if (my_buf == NULL) {
+        packet_fifo = current_packet;
+    }
+    else {
+        my_buf->next = current_packet;
+    }
+
+    mutex_unlock(&fifo_mutex);
+}
+
+/* Register an upper layer thread */
+uint8_t sixlowpan_lowpan_register(int pid)
+{
+    uint8_t i;
+
+    for (i = 0; ((sixlowpan_reg[i] != pid) && (i < SIXLOWPAN_MAX_REGISTERED) &&
+                 (sixlowpan_reg[i] != 0)); i++) {
+        ;
+    }
+
+    if (i >= SIXLOWPAN_MAX_REGISTERED) {
+        return ENOMEM;
+    }
+    else {
+        sixlowpan_reg[i] = pid;
+        return 1;
+    }
+}
+
+static lowpan_iphc_flow_t *iphc_rx_cache_lookup(const uint8_t *data,
+                                                uint8_t length,
+                                                const net_if_eui64_t *s_addr,
+                                                const net_if_eui64_t *d_addr);
+
+/*
+ * Next hop of the packet whose IPHC or uncompressed IPv6 header starts at
+ * hdr if it can be forwarded without decompressing it: its header is in
+ * the receive cache or uncompressed and the IP layer cached a next hop
+ * for its destination. Only the inline hop limit at *hlim_pos changes, so
+ * the addresses must not be derived from the link-layer addresses.
+ * *priority* gets the class it is forwarded in.
+ */
+static const ipv6_fwd_entry_t *lowpan_forward_lookup(const uint8_t *hdr,
+        uint8_t length, const net_if_eui64_t *s_addr,
+        const net_if_eui64_t *d_addr, uint8_t *hlim_pos, uint8_t *priority)
+{
+    const ipv6_hdr_t *ip;
+
+    if (hdr[0] == SIXLOWPAN_IPV6_DISPATCH) {
+        if (length < 1 + IPV6_HDR_LEN) {
+            return NULL;
         }
+
+        ip = (const ipv6_hdr_t *) &hdr[1];
+        *hlim_pos = 1 + offsetof(ipv6_hdr_t, hoplimit);
+    }
+    else if ((iphc_status == LOWPAN_IPHC_ENABLE) &&
+             ((hdr[0] & 0xe0) == SIXLOWPAN_IPHC1_DISPATCH) &&
+             ((hdr[1] & SIXLOWPAN_IPHC2_SAM) != SIXLOWPAN_IPHC2_SAM) &&
+             ((hdr[1] & SIXLOWPAN_IPHC2_M) ||
+              ((hdr[1] & SIXLOWPAN_IPHC2_DAM) != SIXLOWPAN_IPHC2_DAM))) {
+        lowpan_iphc_flow_t *flow = iphc_rx_cache_lookup(hdr, length, s_addr,
+                                                        d_addr);
+
+        if ((flow == NULL) || (flow->hlim_pos == LOWPAN_IPHC_HLIM_ELIDED)) {
+            return NULL;
+        }
+
+        ip = &flow->ip;
+        *hlim_pos = flow->hlim_pos;
+    }
+    else {
+        return NULL;
+    }
+
+    if ((hdr[*hlim_pos] <= 1) || ipv6_addr_is_multicast(&ip->destaddr) ||
+        (ip->nextheader == IPV6_PROTO_NUM_ROUTING)) {
+        return NULL;
+    }
+
+    *priority = lowpan_header_priority(ip->nextheader,
+                                       ipv6_get_traffic_class(ip));
+    return ipv6_fwd_cache_lookup(&ip->destaddr, ipv6_get_traffic_class(ip));
+}
+
+/* sends a copy of a received frame, the frame may still be read by
+ * sixlowpan_reg threads */
+static void lowpan_forward_frame(int if_id, const uint8_t *lladdr,
+                                 uint8_t lladdr_len, const uint8_t *data,
+                                 uint8_t length, int hlim_pos, int tag_out,
+                                 uint8_t priority)
+{
+    uint8_t frame[length];
+
+    memcpy(frame, data, length);
+
+    if (hlim_pos >= 0) {
+        frame[hlim_pos]--;
+    }
+
+    if (tag_out >= 0) {
+        frame[2] = tag_out >> 8;
+        frame[3] = tag_out;
+    }
+
+    if (sixlowpan_mac_send_ieee802154_frame(if_id, lladdr, lladdr_len, frame,
+                                            length, 0, priority) < 0) {
+        NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_TX_FAILED);
+    }
+    else {
+        NETSTAT_TX(NETSTAT_LAYER_LOWPAN);
+    }
+}
+
+/*
+ * Forwards an unfragmented frame with an SRH-6LoRH to the next hop in it
+ * without decompressing it, 1 if it was handled: the first hop, this node,
+ * is taken off, with the last one the 6LoRH goes.  As for
+ * lowpan_forward_lookup(), the IPHC header must be in the receive cache,
+ * its hop limit inline and its addresses not derived from the link layer.
+ */
+static int lowpan_forward_lorh(const uint8_t *data, uint8_t length,
+                               const net_if_eui64_t *s_addr,
+                               const net_if_eui64_t *d_addr)
+{
+    const ipv6_fwd_entry_t *fwd;
+    lowpan_iphc_flow_t *flow;
+    ipv6_addr_t next;
+    uint8_t numof, size, start, new_len;
+    int pos = lowpan_lorh_srh_parse(data, length, &numof, &size);
+    const uint8_t *hdr;
+
+    if (pos < 0) {
+        return 0;
+    }
+
+    hdr = &data[pos];
+
+    if (((hdr[0] & 0xe0) != SIXLOWPAN_IPHC1_DISPATCH) ||
+        ((hdr[1] & SIXLOWPAN_IPHC2_SAM) == SIXLOWPAN_IPHC2_SAM) ||
+        ((hdr[1] & SIXLOWPAN_IPHC2_M) ||
+         ((hdr[1] & SIXLOWPAN_IPHC2_DAM) == SIXLOWPAN_IPHC2_DAM))) {
+        return 0;
+    }
+
+    flow = iphc_rx_cache_lookup(hdr, length - pos, s_addr, d_addr);
+
+    if ((flow == NULL) || (flow->hlim_pos == LOWPAN_IPHC_HLIM_ELIDED) ||
+        (hdr[flow->hlim_pos] <= 1)) {
+        return 0;
+    }
+
+    if (numof > 1) {
+        lowpan_lorh_srh_hop(data, size, 1, &flow->ip.destaddr, &next);
+    }
+    else {
+        memcpy(&next, &flow->ip.destaddr, sizeof(next));
+    }
+
+    fwd = ipv6_fwd_cache_lookup(&next, ipv6_get_traffic_class(&flow->ip));
+
+    if (fwd == NULL) {
+        return 0;
+    }
+
+    /* without the first hop, or without the 6LoRH */
+    start = (numof > 1) ? LOWPAN_LORH_HDR_LEN + size : pos;
+    new_len = length - start + ((numof > 1) ? LOWPAN_LORH_HDR_LEN : 0);
+
+    uint8_t frame[new_len];
+
+    if (numof > 1) {
+        frame[0] = SIXLOWPAN_PAGE1_DISPATCH;
+        frame[1] = SIXLOWPAN_LORH_CRITICAL | (numof - 2);
+        frame[2] = data[2];
+    }
+
+    memcpy(&frame[new_len - (length - start)], &data[start], length - start);
+
+    NETSTAT_RX(NETSTAT_LAYER_LOWPAN);
+    NETSTAT_RX(NETSTAT_LAYER_IPV6);
+    NETSTAT_TX(NETSTAT_LAYER_IPV6);
+
+    /* the hop limit is decremented in the copy */
+    lowpan_forward_frame(fwd->if_id, fwd->lladdr, fwd->lladdr_len, frame,
+                         new_len, new_len - (length - pos) + flow->hlim_pos,
+                         -1, lowpan_header_priority(flow->ip.nextheader,
+                                                    fwd->tclass));
+    return 1;
+}
+
+/* forwards an unfragmented frame as it is, 1 if it was handled */
+static int lowpan_forward_fast(const uint8_t *data, uint8_t length,
+                               const net_if_eui64_t *s_addr,
+                               const net_if_eui64_t *d_addr)
+{
+    const ipv6_fwd_entry_t *fwd;
+    uint8_t hlim_pos, priority;
+
+    if (length > PAYLOAD_SIZE - IEEE_802154_MAX_HDR_LEN) {
+        return 0;
+    }
+
+    if (data[0] == SIXLOWPAN_PAGE1_DISPATCH) {
+        return lowpan_forward_lorh(data, length, s_addr, d_addr);
+    }
+
+    fwd = lowpan_forward_lookup(data, length, s_addr, d_addr, &hlim_pos,
+                                &priority);
+
+    if (fwd == NULL) {
+        return 0;
     }
+
+    NETSTAT_RX(NETSTAT_LAYER_LOWPAN);
+    NETSTAT_RX(NETSTAT_LAYER_IPV6);
+    NETSTAT_TX(NETSTAT_LAYER_IPV6);
+
+    lowpan_forward_frame(fwd->if_id, fwd->lladdr, fwd->lladdr_len, data,
+                         length, hlim_pos, -1, priority);
+    return 1;
 }
 
-void check_timeout(void)
+/*
+ * Virtual reassembly buffers: the first fragment of a datagram that can be
+ * forwarded as it is opens one with the next hop and a new datagram tag,
+ * the following fragments are switched by their tag without reassembly.
+ */
+static lowpan_vrb_t *lowpan_vrb_find(const net_if_eui64_t *s_addr,
+                                     uint16_t datagram_tag,
+                                     uint16_t datagram_size)
 {
-    lowpan_reas_buf_t *temp_buf, *smallest_time = NULL;
-    int count = 0;
-
     timex_t now;
+
     vtimer_now(&now);
-    temp_buf = head;
 
-    while (temp_buf != NULL) {
-        if ((timex_uint64(now) - timex_uint64(temp_buf->timestamp)) >= LOWPAN_REAS_BUF_TIMEOUT) {
-            printf("TIMEOUT!cur_time: %" PRIu64 ", temp_buf: %" PRIu64 "\n", timex_uint64(now),
-                   timex_uint64(temp_buf->timestamp));
-            temp_buf = collect_garbage(temp_buf);
+    for (int i = 0; i < LOWPAN_VRB_NUMOF; i++) {
+        lowpan_vrb_t *vrb = &lowpan_vrb[i];
+
+        if (vrb->used &&
+            ((timex_uint64(now) - timex_uint64(vrb->timestamp)) >= LOWPAN_VRB_TIMEOUT)) {
+            vrb->used = 0;
         }
-        else {
-            if (smallest_time == NULL) {
-                smallest_time = temp_buf;
-            }
-            else if (timex_cmp(temp_buf->timestamp, smallest_time->timestamp) < 0) {
-                smallest_time = temp_buf;
-            }
 
-            temp_buf = temp_buf->next;
-            count++;
+        if (vrb->used && (vrb->tag == datagram_tag) &&
+            (vrb->size == datagram_size) &&
+            (memcmp(&vrb->s_addr, s_addr, sizeof(*s_addr)) == 0)) {
+            vrb->timestamp = now;
+            return vrb;
         }
     }
 
-    if ((count > 10) && (smallest_time != NULL)) {
-        collect_garbage(smallest_time);
-    }
+    return NULL;
 }
 
-void add_fifo_packet(lowpan_reas_buf_t *current_packet)
+/* forwards a fragment of a datagram as it is, 1 if it was handled */
+static int lowpan_forward_fragment(const uint8_t *data, uint8_t length,
+                                   uint16_t byte_offset, uint8_t frag_size,
+                                   uint16_t datagram_size,
+                                   uint16_t datagram_tag,
+                                   const net_if_eui64_t *s_addr,
+                                   const net_if_eui64_t *d_addr)
 {
-    lowpan_reas_buf_t *temp_buf, *my_buf;
+    lowpan_vrb_t *vrb = lowpan_vrb_find(s_addr, datagram_tag, datagram_size);
+    int hlim_pos = -1;
 
-    if (head == current_packet) {
-        head = current_packet->next;
-    }
-    else {
-        temp_buf = head;
+    if ((vrb == NULL) && (byte_offset == 0)) {
+        /* the first fragment starts with the IPv6 header */
+        const ipv6_fwd_entry_t *fwd;
+        uint8_t pos, priority;
 
-        while (temp_buf != current_packet) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
+        fwd = lowpan_forward_lookup(&data[4], length - 4, s_addr, d_addr, &pos,
+                                    &priority);
 
-        my_buf->next = current_packet->next;
-    }
+        for (int i = 0; (fwd != NULL) && (i < LOWPAN_VRB_NUMOF); i++) {
+            if (!lowpan_vrb[i].used) {
+                vrb = &lowpan_vrb[i];
+                break;
+            }
+        }
 
-    mutex_lock(&fifo_mutex);
+        if (vrb == NULL) {
+            return 0;
+        }
 
-    if (packet_fifo == NULL) {
-        packet_fifo = current_packet;
-    }
-    else {
-        temp_buf = packet_fifo;
+        vrb->used = 1;
+        memcpy(&vrb->s_addr, s_addr, sizeof(*s_addr));
+        vrb->tag = datagram_tag;
+        vrb->size = datagram_size;
+        vrb->tag_out = tag++;
+        vrb->if_id = fwd->if_id;
+        memcpy(vrb->lladdr, fwd->lladdr, sizeof(vrb->lladdr));
+        vrb->lladdr_len = fwd->lladdr_len;
+        vrb->priority = priority;
+        vtimer_now(&vrb->timestamp);
 
-        while (temp_buf != NULL) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
+        hlim_pos = 4 + pos;
 
-        my_buf->next = current_packet;
+        NETSTAT_RX(NETSTAT_LAYER_IPV6);
+        NETSTAT_TX(NETSTAT_LAYER_IPV6);
     }
 
-    mutex_unlock(&fifo_mutex);
-    current_packet->next = NULL;
-}
+    if (vrb == NULL) {
+        return 0;
+    }
 
-/* Register an upper layer thread */
-uint8_t sixlowpan_lowpan_register(int pid)
-{
-    uint8_t i;
+    lowpan_forward_frame(vrb->if_id, vrb->lladdr, vrb->lladdr_len, data,
+                         length, hlim_pos, vrb->tag_out, vrb->priority);
 
-    for (i = 0; ((sixlowpan_reg[i] != pid) && (i < SIXLOWPAN_MAX_REGISTERED) &&
-                 (sixlowpan_reg[i] != 0)); i++) {
-        ;
+    /* the first fragment may be compressed, only later ones end it */
+    if ((byte_offset != 0) && (byte_offset + frag_size >= datagram_size)) {
+        vrb->used = 0;
     }
 
-    if (i >= SIXLOWPAN_MAX_REGISTERED) {
-        return ENOMEM;
-    }
-    else {
-        sixlowpan_reg[i] = pid;
-        return 1;
-    }
+    return 1;
 }
 
 void lowpan_read(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
@@ -789,6 +1591,7 @@ void lowpan_read(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
     uint16_t datagram_tag = 0;
     short i;
 
+    TRACE(TRACE_LOWPAN_RX, length);
     check_timeout();
 
     for (i = 0; i < SIXLOWPAN_MAX_REGISTERED; i++) {
@@ -843,15 +1646,22 @@ void lowpan_read(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
         if ((frag_size % 8) != 0) {
             if ((byte_offset + frag_size) != datagram_size) {
                 printf("ERROR: received invalid fragment\n");
+                NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_MALFORMED);
                 return;
             }
         }
 
+        if (lowpan_forward_fragment(data, length, byte_offset, frag_size,
+                                    datagram_size, datagram_tag, s_addr,
+                                    d_addr)) {
+            return;
+        }
+
         handle_packet_fragment(data, byte_offset, datagram_size, datagram_tag,
                                s_addr, d_addr, hdr_length, frag_size);
     }
-    /* Regular Packet */
-    else {
+    /* Regular Packet, forwarded as it is if possible */
+    else if (!lowpan_forward_fast(data, length, s_addr, d_addr)) {
         DEBUG("INFO: unfragmentated packet with first byte 0x%02x received\n",
               data[0]);
         lowpan_reas_buf_t *current_buf = get_packet_frag_buf(length, 0, s_addr, d_addr);
@@ -864,13 +1674,148 @@ void lowpan_read(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
         }
         else {
             DEBUG("ERROR: no memory left in packet buffer!\n");
+            NETSTAT_DROP(NETSTAT_LAYER_LOWPAN, NETSTAT_DROP_NO_BUFFER);
         }
 
-        if (thread_getstatus(transfer_pid) == STATUS_SLEEPING) {
-            thread_wakeup(transfer_pid);
+        lowpan_transfer_notify();
+    }
+
+}
+
+/* compares the parts of two IPv6 headers the IPHC header depends on */
+static int iphc_ip_hdr_equal(const ipv6_hdr_t *a, const ipv6_hdr_t *b,
+                             uint8_t cmp_hlim)
+{
+    const uint8_t *x = (const uint8_t *) a;
+    const uint8_t *y = (const uint8_t *) b;
+
+    return (memcmp(x, y, 4) == 0) && (a->nextheader == b->nextheader) &&
+           (!cmp_hlim || (a->hoplimit == b->hoplimit)) &&
+           (memcmp(&x[8], &y[8], 2 * sizeof(ipv6_addr_t)) == 0);
+}
+
+static lowpan_iphc_flow_t *iphc_tx_cache_lookup(int if_id, const uint8_t *dest,
+                                                int dest_len,
+                                                const net_if_eui64_t *own_iid)
+{
+    for (int i = 0; i < LOWPAN_IPHC_CACHE_SIZE; i++) {
+        lowpan_iphc_flow_t *flow = &iphc_tx_cache[i];
+
+        if (flow->valid && (flow->context_gen == lowpan_context_gen) &&
+            (flow->if_id == if_id) && (flow->dest_len == dest_len) &&
+            iphc_ip_hdr_equal(&flow->ip, ipv6_buf,
+                              flow->hlim_pos == LOWPAN_IPHC_HLIM_ELIDED) &&
+            (memcmp(flow->ll_addr[0], own_iid, 8) == 0) &&
+            (memcmp(flow->ll_addr[1], dest, dest_len) == 0)) {
+            return flow;
         }
     }
 
+    return NULL;
+}
+
+static void iphc_tx_cache_store(int if_id, const uint8_t *dest, int dest_len,
+                                const net_if_eui64_t *own_iid,
+                                uint8_t hdr_len, uint8_t hlim_pos)
+{
+    lowpan_iphc_flow_t *flow = &iphc_tx_cache[iphc_tx_cache_next];
+
+    if ((hdr_len > LOWPAN_IPHC_MAX_HDR_LEN) || (dest_len > 8)) {
+        return;
+    }
+
+    iphc_tx_cache_next = (iphc_tx_cache_next + 1) % LOWPAN_IPHC_CACHE_SIZE;
+
+    flow->valid = 1;
+    flow->context_gen = lowpan_context_gen;
+    flow->hlim_pos = hlim_pos;
+    flow->hdr_len = hdr_len;
+    memcpy(flow->hdr, comp_buf, hdr_len);
+    memcpy(&flow->ip, ipv6_buf, IPV6_HDR_LEN);
+    memcpy(flow->ll_addr[0], own_iid, 8);
+    memcpy(flow->ll_addr[1], dest, dest_len);
+    flow->if_id = if_id;
+    flow->dest_len = dest_len;
+}
+
+/* whether the UDP header behind the IPv6 header at ptr can be compressed,
+ * its length is elided */
+static int lowpan_nhc_udp_possible(const uint8_t *ptr, uint16_t payload_length)
+{
+    const udp_hdr_t *udp = (const udp_hdr_t *) &ptr[IPV6_HDR_LEN];
+
+    return (ipv6_buf->nextheader == IPV6_PROTO_NUM_UDP) &&
+           (payload_length >= UDP_HDR_LEN) &&
+           (NTOHS(udp->length) == payload_length);
+}
+
+/* RFC 6282, section 4.3.3: writes the compressed form of udp to buf,
+ * returns its length */
+static uint8_t lowpan_nhc_udp_encoding(uint8_t *buf, udp_hdr_t *udp)
+{
+    uint16_t src = NTOHS(udp->src_port);
+    uint16_t dst = NTOHS(udp->dst_port);
+    uint8_t pos = 1;
+
+    buf[0] = SIXLOWPAN_NHC_UDP_DISPATCH;
+
+    if (((src & 0xfff0) == SIXLOWPAN_NHC_UDP_4BIT_PORT) &&
+        ((dst & 0xfff0) == SIXLOWPAN_NHC_UDP_4BIT_PORT)) {
+        buf[0] |= 0x03;
+        buf[pos++] = (src << 4) | (dst & 0x0f);
+    }
+    else if ((dst & 0xff00) == SIXLOWPAN_NHC_UDP_8BIT_PORT) {
+        buf[0] |= 0x01;
+        memcpy(&buf[pos], &udp->src_port, 2);
+        pos += 2;
+        buf[pos++] = dst & 0xff;
+    }
+    else if ((src & 0xff00) == SIXLOWPAN_NHC_UDP_8BIT_PORT) {
+        buf[0] |= 0x02;
+        buf[pos++] = src & 0xff;
+        memcpy(&buf[pos], &udp->dst_port, 2);
+        pos += 2;
+    }
+    else {
+        memcpy(&buf[pos], &udp->src_port, 4);
+        pos += 4;
+    }
+
+#if LOWPAN_NHC_UDP_CSUM_ELIDE
+    buf[0] |= SIXLOWPAN_NHC_UDP_C;
+#else
+
+    if (udp->checksum == 0) {
+        /* elided by the previous hop */
+        uint16_t sum = ~ipv6_csum(ipv6_buf, (uint8_t *) udp,
+                                  NTOHS(udp->length), IPV6_PROTO_NUM_UDP);
+
+        udp->checksum = (sum == 0) ? 0xffff : sum;
+    }
+
+    memcpy(&buf[pos], &udp->checksum, 2);
+    pos += 2;
+#endif
+
+    return pos;
+}
+
+/* puts the payload at ptr behind the hdr_len bytes of IPHC header in
+ * comp_buf */
+static void lowpan_iphc_encoding_payload(uint16_t hdr_len, uint8_t *ptr,
+                                         uint16_t payload_length)
+{
+    uint8_t *payload = &ptr[IPV6_HDR_LEN];
+
+    if (comp_buf[0] & SIXLOWPAN_IPHC1_NH) {
+        hdr_len += lowpan_nhc_udp_encoding(&comp_buf[hdr_len],
+                                           (udp_hdr_t *) payload);
+        payload += UDP_HDR_LEN;
+        payload_length -= UDP_HDR_LEN;
+    }
+
+    memcpy(&comp_buf[hdr_len], payload, payload_length);
+    comp_len = hdr_len + payload_length;
 }
 
 /* draft-ietf-6lowpan-hc-13#section-3.1 */
@@ -882,8 +1827,11 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
     uint8_t *ipv6_hdr_fields = &comp_buf[2];
     lowpan_context_t *con = NULL;
     uint16_t hdr_pos = 0;
+    uint8_t hlim_pos = LOWPAN_IPHC_HLIM_ELIDED;
     uint8_t tc;
     net_if_eui64_t own_iid;
+    lowpan_iphc_flow_t *flow;
+    int nhc;
 
     if (net_if_get_src_address_mode(if_id) == NET_IF_TRANS_ADDR_M_SHORT) {
         if (!net_if_get_eui64(&own_iid, if_id, 1)) {
@@ -899,6 +1847,21 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
     }
 
     ipv6_buf = ipv6_buf_extra;
+    nhc = lowpan_nhc_udp_possible(ptr, payload_length);
+
+    /* repeated flow: reuse its header, only the hop limit may differ */
+    flow = iphc_tx_cache_lookup(if_id, dest, dest_len, &own_iid);
+
+    if ((flow != NULL) && (!(flow->hdr[0] & SIXLOWPAN_IPHC1_NH) == !nhc)) {
+        memcpy(comp_buf, flow->hdr, flow->hdr_len);
+
+        if (flow->hlim_pos != LOWPAN_IPHC_HLIM_ELIDED) {
+            comp_buf[flow->hlim_pos] = ipv6_buf->hoplimit;
+        }
+
+        lowpan_iphc_encoding_payload(flow->hdr_len, ptr, payload_length);
+        return 1;
+    }
 
     memset(&lowpan_iphc, 0, 2);
 
@@ -948,10 +1911,14 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
         }
     }
 
-    /* NH: Next Header:
-     * TODO: NHC */
-    ipv6_hdr_fields[hdr_pos] = ipv6_buf->nextheader;
-    hdr_pos++;
+    /* NH: Next Header: UDP is compressed behind the IPHC header */
+    if (nhc) {
+        lowpan_iphc[0] |= SIXLOWPAN_IPHC1_NH;
+    }
+    else {
+        ipv6_hdr_fields[hdr_pos] = ipv6_buf->nextheader;
+        hdr_pos++;
+    }
 
     /* HLIM: Hop Limit: */
     switch (ipv6_buf->hoplimit) {
@@ -974,6 +1941,7 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
         }
 
         default: {
+            hlim_pos = 2 + hdr_pos;
             ipv6_hdr_fields[hdr_pos] = ipv6_buf->hoplimit;
             hdr_pos++;
             break;
@@ -988,6 +1956,10 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
         lowpan_iphc[1] |= SIXLOWPAN_IPHC2_CID;
         memmove(&ipv6_hdr_fields[1], &ipv6_hdr_fields[0], hdr_pos);
         hdr_pos++;
+
+        if (hlim_pos != LOWPAN_IPHC_HLIM_ELIDED) {
+            hlim_pos++;
+        }
     }
 
     /* SAC: Source Address Compression */
@@ -1155,15 +2127,195 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
     	ptr = get_payload_buf(ipv6_ext_hdr_len);
     	}
     */
-    memcpy(&ipv6_hdr_fields[hdr_pos], &ptr[IPV6_HDR_LEN], NTOHS(ipv6_buf->length));
+    iphc_tx_cache_store(if_id, dest, dest_len, &own_iid, 2 + hdr_pos, hlim_pos);
 
-    comp_len = 2 + hdr_pos + payload_length;
+    lowpan_iphc_encoding_payload(2 + hdr_pos, ptr, payload_length);
 
     return 1;
 }
 
-void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
-                          net_if_eui64_t *d_addr)
+static lowpan_iphc_flow_t *iphc_rx_cache_lookup(const uint8_t *data,
+                                                uint8_t length,
+                                                const net_if_eui64_t *s_addr,
+                                                const net_if_eui64_t *d_addr)
+{
+    for (int i = 0; i < LOWPAN_IPHC_CACHE_SIZE; i++) {
+        lowpan_iphc_flow_t *flow = &iphc_rx_cache[i];
+        uint8_t split = flow->hlim_pos;
+
+        if (!flow->valid || (flow->context_gen != lowpan_context_gen) ||
+            (flow->hdr_len > length)) {
+            continue;
+        }
+
+        if (split == LOWPAN_IPHC_HLIM_ELIDED) {
+            split = flow->hdr_len;
+        }
+
+        /* the dispatch bytes fix the layout, so equal bytes around the
+         * hop limit mean an equal header */
+        if ((memcmp(data, flow->hdr, split) == 0) &&
+            ((split == flow->hdr_len) ||
+             (memcmp(&data[split + 1], &flow->hdr[split + 1],
+                     flow->hdr_len - split - 1) == 0)) &&
+            (memcmp(flow->ll_addr[0], s_addr, 8) == 0) &&
+            (memcmp(flow->ll_addr[1], d_addr, 8) == 0)) {
+            return flow;
+        }
+    }
+
+    return NULL;
+}
+
+static void iphc_rx_cache_store(const uint8_t *data, uint8_t hdr_len,
+                                uint8_t hlim_pos, const net_if_eui64_t *s_addr,
+                                const net_if_eui64_t *d_addr)
+{
+    lowpan_iphc_flow_t *flow = &iphc_rx_cache[iphc_rx_cache_next];
+
+    if (hdr_len > LOWPAN_IPHC_MAX_HDR_LEN) {
+        return;
+    }
+
+    iphc_rx_cache_next = (iphc_rx_cache_next + 1) % LOWPAN_IPHC_CACHE_SIZE;
+
+    flow->valid = 1;
+    flow->context_gen = lowpan_context_gen;
+    flow->hlim_pos = hlim_pos;
+    flow->hdr_len = hdr_len;
+    memcpy(flow->hdr, data, hdr_len);
+    memcpy(&flow->ip, ipv6_buf, IPV6_HDR_LEN);
+    memcpy(flow->ll_addr[0], s_addr, 8);
+    memcpy(flow->ll_addr[1], d_addr, 8);
+}
+
+/* RFC 6282, section 4.3.3: rebuilds the UDP header from its compressed
+ * form at data[hdr_pos], returns the position of the UDP payload or -1 */
+static int lowpan_nhc_udp_decoding(const uint8_t *data, uint8_t length,
+                                   uint8_t hdr_pos, udp_hdr_t *udp)
+{
+    uint8_t *ports = (uint8_t *) &udp->src_port;
+    uint8_t nhc;
+    uint8_t inline_len;
+
+    if ((hdr_pos >= length) ||
+        ((data[hdr_pos] & SIXLOWPAN_NHC_UDP_MASK) != SIXLOWPAN_NHC_UDP_DISPATCH)) {
+        return -1;
+    }
+
+    nhc = data[hdr_pos++];
+
+    switch (nhc & SIXLOWPAN_NHC_UDP_P) {
+        case (0x03):
+            inline_len = 1;
+            break;
+
+        case (0x01):
+        case (0x02):
+            inline_len = 3;
+            break;
+
+        default:
+            inline_len = 4;
+            break;
+    }
+
+    if (!(nhc & SIXLOWPAN_NHC_UDP_C)) {
+        inline_len += 2;
+    }
+
+    if (length - hdr_pos < inline_len) {
+        return -1;
+    }
+
+    /* the ports in network byte order */
+    switch (nhc & SIXLOWPAN_NHC_UDP_P) {
+        case (0x03):
+            ports[0] = SIXLOWPAN_NHC_UDP_4BIT_PORT >> 8;
+            ports[1] = (SIXLOWPAN_NHC_UDP_4BIT_PORT & 0xff) | (data[hdr_pos] >> 4);
+            ports[2] = SIXLOWPAN_NHC_UDP_4BIT_PORT >> 8;
+            ports[3] = (SIXLOWPAN_NHC_UDP_4BIT_PORT & 0xff) | (data[hdr_pos] & 0x0f);
+            hdr_pos++;
+            break;
+
+        case (0x01):
+            memcpy(ports, &data[hdr_pos], 2);
+            ports[2] = SIXLOWPAN_NHC_UDP_8BIT_PORT >> 8;
+            ports[3] = data[hdr_pos + 2];
+            hdr_pos += 3;
+            break;
+
+        case (0x02):
+            ports[0] = SIXLOWPAN_NHC_UDP_8BIT_PORT >> 8;
+            ports[1] = data[hdr_pos];
+            memcpy(&ports[2], &data[hdr_pos + 1], 2);
+            hdr_pos += 3;
+            break;
+
+        default:
+            memcpy(ports, &data[hdr_pos], 4);
+            hdr_pos += 4;
+            break;
+    }
+
+    if (nhc & SIXLOWPAN_NHC_UDP_C) {
+        /* computed once the payload is in place */
+        udp->checksum = 0;
+    }
+    else {
+        memcpy(&udp->checksum, &data[hdr_pos], 2);
+        hdr_pos += 2;
+    }
+
+    udp->length = HTONS(UDP_HDR_LEN + length - hdr_pos);
+    return hdr_pos;
+}
+
+static int lowpan_iphc_decoding_payload(pktbuf_t *pkt, uint8_t *data,
+                                        uint8_t length, uint8_t hdr_pos)
+{
+    uint8_t *ptr = pkt->data + IPV6_HDR_LEN + ipv6_ext_hdr_len;
+    udp_hdr_t *udp = NULL;
+    uint16_t udp_len = 0;
+
+    if (data[0] & SIXLOWPAN_IPHC1_NH) {
+        int pos = lowpan_nhc_udp_decoding(data, length, hdr_pos,
+                                          (udp_hdr_t *) ptr);
+
+        if (pos < 0) {
+            return -1;
+        }
+
+        if (data[hdr_pos] & SIXLOWPAN_NHC_UDP_C) {
+            udp = (udp_hdr_t *) ptr;
+        }
+
+        hdr_pos = pos;
+        ptr += UDP_HDR_LEN;
+        udp_len = UDP_HDR_LEN;
+    }
+
+    if ((ptr - pkt->data) + (length - hdr_pos) > pkt->len) {
+        return -1;
+    }
+
+    memcpy(ptr, &data[hdr_pos], length - hdr_pos);
+
+    if (udp != NULL) {
+        /* elided by the previous hop, UDP verifies every datagram */
+        uint16_t sum = ~ipv6_csum(ipv6_buf, (uint8_t *) udp,
+                                  NTOHS(udp->length), IPV6_PROTO_NUM_UDP);
+
+        udp->checksum = (sum == 0) ? 0xffff : sum;
+    }
+
+    /* ipv6 length */
+    ipv6_buf->length = HTONS(udp_len + length - hdr_pos);
+    return 0;
+}
+
+int lowpan_iphc_decoding(pktbuf_t *pkt, uint8_t *data, uint8_t length,
+                         net_if_eui64_t *s_addr, net_if_eui64_t *d_addr)
 {
     uint8_t hdr_pos = 0;
     uint8_t *ipv6_hdr_fields = data;
@@ -1172,11 +2324,26 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
     uint8_t sci = 0;
     uint8_t dci = 0;
 
+    uint8_t hlim_pos = LOWPAN_IPHC_HLIM_ELIDED;
+
     uint8_t ll_prefix[2] = {0xfe, 0x80};
     uint8_t m_prefix[2] = {0xff, 0x02};
     lowpan_context_t *con = NULL;
+    lowpan_iphc_flow_t *flow;
 
-    ipv6_buf = ipv6_get_buf();
+    ipv6_buf = (ipv6_hdr_t *) pkt->data;
+
+    flow = iphc_rx_cache_lookup(data, length, s_addr, d_addr);
+
+    if (flow != NULL) {
+        memcpy(ipv6_buf, &flow->ip, IPV6_HDR_LEN);
+
+        if (flow->hlim_pos != LOWPAN_IPHC_HLIM_ELIDED) {
+            ipv6_buf->hoplimit = data[flow->hlim_pos];
+        }
+
+        return lowpan_iphc_decoding_payload(pkt, data, length, flow->hdr_len);
+    }
 
     lowpan_iphc[0] = ipv6_hdr_fields[0];
     lowpan_iphc[1] = ipv6_hdr_fields[1];
@@ -1204,7 +2371,7 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
             ipv6_buf->trafficclass_flowlabel = ((ipv6_hdr_fields[hdr_pos] >> 2) & 0x30) |
                                                ((ipv6_hdr_fields[hdr_pos] << 6) & 0xc0);
             ipv6_buf->flowlabel = 0;
-            hdr_pos += 3;
+            hdr_pos++;
         }
     }
     else {
@@ -1235,7 +2402,8 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
 
     /* NH: Next Header: */
     if (lowpan_iphc[0] & SIXLOWPAN_IPHC1_NH) {
-        // TODO: next header decompression
+        /* only UDP is compressed, its header follows the addresses */
+        ipv6_buf->nextheader = IPV6_PROTO_NUM_UDP;
     }
     else {
         ipv6_buf->nextheader = ipv6_hdr_fields[hdr_pos];
@@ -1265,6 +2433,7 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
         }
     }
     else {
+        hlim_pos = hdr_pos;
         ipv6_buf->hoplimit = ipv6_hdr_fields[hdr_pos];
         hdr_pos++;
     }
@@ -1286,7 +2455,8 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
 
         if (con == NULL) {
             printf("ERROR: context not found\n");
-            return;
+            mutex_unlock(&lowpan_context_mutex);
+            return -1;
         }
 
         switch (((lowpan_iphc[1] & SIXLOWPAN_IPHC2_SAM) >> 4) & 0x03) {
@@ -1386,7 +2556,8 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
 
             if (con == NULL) {
                 printf("ERROR: context not found\n");
-                return;
+                mutex_unlock(&lowpan_context_mutex);
+                return -1;
             }
 
             // TODO:
@@ -1461,7 +2632,8 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
 
             if (con == NULL) {
                 printf("ERROR: context not found\n");
-                return;
+                mutex_unlock(&lowpan_context_mutex);
+                return -1;
             }
 
             switch ((lowpan_iphc[1] & SIXLOWPAN_IPHC2_DAM) & 0x03) {
@@ -1533,13 +2705,9 @@ void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
         }
     }
 
-    uint8_t *ptr = get_payload_buf(ipv6_ext_hdr_len);
-
-    memcpy(ptr, &ipv6_hdr_fields[hdr_pos], length - hdr_pos);
+    iphc_rx_cache_store(data, hdr_pos, hlim_pos, s_addr, d_addr);
 
-    /* ipv6 length */
-    ipv6_buf->length = HTONS(length - hdr_pos);
-    packet_length = IPV6_HDR_LEN + ipv6_buf->length;
+    return lowpan_iphc_decoding_payload(pkt, data, length, hdr_pos);
 }
 
 uint8_t lowpan_context_len()
@@ -1549,19 +2717,34 @@ uint8_t lowpan_context_len()
 
 void lowpan_context_remove(uint8_t num)
 {
-    int i, j;
+    lowpan_context_t *context = lowpan_context_num_lookup(num);
+    lowpan_context_t *last;
 
-    for (i = 0; i < NDP_6LOWPAN_CONTEXT_MAX; i++) {
-        if (contexts[i].num == num) {
-            context_len--;
-            break;
-        }
+    if (context == NULL) {
+        return;
     }
 
     abr_remove_context(num);
+    lowpan_context_gen++;
+    lowpan_context_version++;
+
+    if (context->length > 0) {
+        ipv6_lpm_remove(&context_trie, &context->prefix, context->length);
+    }
 
-    for (j = i; j < NDP_6LOWPAN_CONTEXT_MAX; j++) {
-        contexts[j] = contexts[j + 1];
+    context_by_cid[num] = 0;
+    last = &contexts[--context_len];
+
+    /* fill the gap with the last entry, the trie and the CID index have to
+     * follow it to its new slot */
+    if (context != last) {
+        *context = *last;
+        context_by_cid[context->num] = (context - contexts) + 1;
+
+        if (context->length > 0) {
+            ipv6_lpm_add(&context_trie, &context->prefix, context->length,
+                         context);
+        }
     }
 }
 
@@ -1576,16 +2759,32 @@ lowpan_context_t *lowpan_context_update(uint8_t num, const ipv6_addr_t *prefix,
         return NULL;
     }
 
-    if (context_len == NDP_6LOWPAN_CONTEXT_MAX) {
+    if ((num >= NDP_6LOWPAN_CONTEXT_MAX) || (length > 128)) {
         return NULL;
     }
 
     context = lowpan_context_num_lookup(num);
 
     if (context == NULL) {
+        if (context_len == NDP_6LOWPAN_CONTEXT_MAX) {
+            return NULL;
+        }
+
         context = &(contexts[context_len++]);
+        context_by_cid[num] = context_len;
+        lowpan_context_gen++;
+    }
+    else if ((context->length != length) || (context->comp != comp) ||
+             (memcmp(&context->prefix, prefix, length / 8) != 0)) {
+        /* a mere lifetime refresh keeps cached IPHC headers valid */
+        lowpan_context_gen++;
+
+        if (context->length > 0) {
+            ipv6_lpm_remove(&context_trie, &context->prefix, context->length);
+        }
     }
 
+    lowpan_context_version++;
     context->num = num;
     memset((void *)(&context->prefix), 0, 16);
     // length in bits
@@ -1593,6 +2792,12 @@ lowpan_context_t *lowpan_context_update(uint8_t num, const ipv6_addr_t *prefix,
     context->length = length;
     context->comp = comp;
     context->lifetime = lifetime;
+
+    if ((length > 0) &&
+        (ipv6_lpm_add(&context_trie, &context->prefix, length, context) < 0)) {
+        DEBUG("lowpan_context_update: no trie node for context %u\n", num);
+    }
+
     return context;
 }
 
@@ -1601,38 +2806,29 @@ lowpan_context_t *lowpan_context_get()
     return contexts;
 }
 
-lowpan_context_t *lowpan_context_lookup(ipv6_addr_t *addr)
+uint16_t lowpan_context_get_version(void)
 {
-    int i;
-
-    lowpan_context_t *context = NULL;
-
-    for (i = 0; i < lowpan_context_len(); i++) {
-        if (contexts[i].length > 0 && memcmp((void *)addr, &(contexts[i].prefix),
-                                             contexts[i].length) == 0) {
-            /* longer prefixes are always prefered */
-            if (context == NULL || context->length < contexts[i].length) {
-                context = &contexts[i];
-            }
-        }
-    }
+    return lowpan_context_version;
+}
 
-    return context;
+lowpan_context_t *lowpan_context_lookup(ipv6_addr_t *addr)
+{
+    /* longer prefixes are always prefered */
+    return ipv6_lpm_lookup(&context_trie, addr, 128, NULL);
 }
 
 lowpan_context_t *lowpan_context_num_lookup(uint8_t num)
 {
-    int i;
-
-    for (i = 0; i < lowpan_context_len(); i++) {
-        if (contexts[i].num == num) {
-            return &contexts[i];
-        }
+    if ((num >= NDP_6LOWPAN_CONTEXT_MAX) || (context_by_cid[num] == 0)) {
+        return NULL;
     }
 
-    return NULL;
+    return &contexts[context_by_cid[num] - 1];
 }
 
+/* context lifetimes are in minutes, a second late does not matter */
+#define CONTEXT_AUTO_REMOVE_SLACK   (1000000)
+
 void lowpan_context_auto_remove(void)
 {
     timex_t minute = timex_set(60, 0);
@@ -1641,7 +2837,7 @@ void lowpan_context_auto_remove(void)
     int8_t to_remove_size;
 
     while (1) {
-        vtimer_sleep(minute);
+        vtimer_sleep_slack(minute, CONTEXT_AUTO_REMOVE_SLACK);
         to_remove_size = 0;
         mutex_lock(&lowpan_context_mutex);
 
@@ -1651,6 +2847,8 @@ void lowpan_context_auto_remove(void)
             }
         }
 
+        lowpan_context_version++;
+
         for (i = 0; i < to_remove_size; i++) {
             lowpan_context_remove(to_remove[i]);
         }
@@ -1667,8 +2865,9 @@ void init_reas_bufs(lowpan_reas_buf_t *buf)
     memset(&buf->timestamp, 0, sizeof(timex_t));
     buf->packet_size = 0;
     buf->current_packet_size = 0;
+    buf->pkt = NULL;
     buf->packet = NULL;
-    buf->interval_list_head = NULL;
+    memset(buf->received, 0, sizeof(buf->received));
     buf->next = NULL;
 }
 
@@ -1777,8 +2976,6 @@ int sixlowpan_lowpan_init_interface(int if_id)
 
 int sixlowpan_lowpan_init(void)
 {
-    short i;
-
     /* init mac-layer and radio transceiver */
     sixlowpan_mac_init();
 
@@ -1788,11 +2985,13 @@ int sixlowpan_lowpan_init(void)
     /* init packet_fifo mutex */
     mutex_init(&fifo_mutex);
 
+#if !SIXLOWPAN_RUN_TO_COMPLETION
     if (!ip_process_pid) {
         ip_process_pid = thread_create(ip_process_buf, IP_PROCESS_STACKSIZE,
                                        PRIORITY_MAIN - 1, CREATE_STACKTEST,
                                        ipv6_process, "ip_process");
     }
+#endif
 
     if (ip_process_pid < 0) {
         return 0;
@@ -1808,6 +3007,7 @@ int sixlowpan_lowpan_init(void)
         return 0;
     }
 
+#if !SIXLOWPAN_RUN_TO_COMPLETION
     transfer_pid = thread_create(lowpan_transfer_buf, LOWPAN_TRANSFER_BUF_STACKSIZE,
                                  PRIORITY_MAIN - 1, CREATE_STACKTEST,
                                  lowpan_transfer, "lowpan_transfer");
@@ -1815,10 +3015,7 @@ int sixlowpan_lowpan_init(void)
     if (transfer_pid < 0) {
         return 0;
     }
-
-    for (i = 0; i < SIXLOWIP_MAX_REGISTERED; i++) {
-        sixlowip_reg[i] = 0;
-    }
+#endif
 
     return 0;
 }
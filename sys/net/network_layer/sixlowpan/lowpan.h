@@ -51,6 +51,8 @@ lowpan_context_t *lowpan_context_update(uint8_t num,
                                         uint8_t length, uint8_t comp,
                                         uint16_t lifetime);
 lowpan_context_t *lowpan_context_get(void);
+/* changes whenever a context or its lifetime changes */
+uint16_t lowpan_context_get_version(void);
 lowpan_context_t *lowpan_context_num_lookup(uint8_t num);
 
 /** @} */
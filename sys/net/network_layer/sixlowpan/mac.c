@@ -35,6 +35,11 @@
 #include "lowpan.h"
 #include "ieee802154_frame.h"
 #include "net_help.h"
+#include "netstat.h"
+
+#ifdef MODULE_FTSP
+#include "ftsp.h"
+#endif
 
 #define ENABLE_DEBUG    (0)
 #if ENABLE_DEBUG
@@ -42,11 +47,24 @@
 #endif
 #include "debug.h"
 
+#if SIXLOWPAN_RUN_TO_COMPLETION
+/* the radio thread runs 6LoWPAN, IPv6 and the L4 handlers as well */
+#define RADIO_STACK_SIZE            (KERNEL_CONF_STACKSIZE_MAIN + IP_PROCESS_STACKSIZE)
+#else
 #define RADIO_STACK_SIZE            (KERNEL_CONF_STACKSIZE_MAIN)
+#endif
 #define RADIO_RCV_BUF_SIZE          (64)
 #define RADIO_SENDING_DELAY         (1000)
 
 #define DEFAULT_IEEE_802154_PAN_ID  (0x1234)
+/* neighbors whose last sequence number is remembered */
+#define MAC_DUP_NUMOF               (8)
+
+typedef struct {
+    net_if_eui64_t src;
+    uint8_t seq;
+    uint8_t used;
+} mac_dup_t;
 
 char radio_stack_buffer[RADIO_STACK_SIZE];
 msg_t msg_q[RADIO_RCV_BUF_SIZE];
@@ -54,6 +72,12 @@ msg_t msg_q[RADIO_RCV_BUF_SIZE];
 uint8_t lowpan_mac_buf[PAYLOAD_SIZE];
 static uint8_t macdsn;
 
+static void (*mac_tx_handler)(const net_if_eui64_t *dest, uint8_t transmissions);
+static void (*mac_rx_handler)(const net_if_eui64_t *src, uint8_t lqi);
+static const sixlowpan_mac_engine_t *mac_engine;
+static mac_dup_t mac_dup[MAC_DUP_NUMOF];
+static uint8_t mac_dup_next;
+
 static inline void mac_frame_short_to_eui64(net_if_eui64_t *eui64,
                                             uint8_t *frame_short)
 {
@@ -63,6 +87,33 @@ static inline void mac_frame_short_to_eui64(net_if_eui64_t *eui64,
     eui64->uint8[7] = frame_short[0];
 }
 
+/* 1 if *seq* is the last one heard from *src*, a retransmission whose
+ * acknowledgement got lost, remembers it otherwise */
+static int mac_is_duplicate(const net_if_eui64_t *src, uint8_t seq)
+{
+    mac_dup_t *d = NULL;
+
+    for (int i = 0; i < MAC_DUP_NUMOF; i++) {
+        if (mac_dup[i].used && (mac_dup[i].src.uint64 == src->uint64)) {
+            d = &mac_dup[i];
+            break;
+        }
+    }
+
+    if (d == NULL) {
+        d = &mac_dup[mac_dup_next];
+        mac_dup_next = (mac_dup_next + 1) % MAC_DUP_NUMOF;
+        d->src = *src;
+        d->used = 1;
+    }
+    else if (d->seq == seq) {
+        return 1;
+    }
+
+    d->seq = seq;
+    return 0;
+}
+
 void recv_ieee802154_frame(void)
 {
     msg_t m;
@@ -72,10 +123,11 @@ void recv_ieee802154_frame(void)
     ieee802154_packet_t *p;
 #else
     radio_packet_t *p;
-    uint8_t hdrlen;
+    ieee802154_frame_view_t view;
+    uint8_t src_addr[8], dest_addr[8];
 #endif
-    uint8_t length;
-    ieee802154_frame_t frame;
+    uint8_t length, src_m, dest_m, seq;
+    uint8_t *payload, *src_ptr, *dest_ptr;
     net_if_eui64_t src, dst;
 
     msg_init_queue(msg_q, RADIO_RCV_BUF_SIZE);
@@ -84,27 +136,48 @@ void recv_ieee802154_frame(void)
         msg_receive(&m);
 
         if (m.type == PKT_PENDING) {
+            /* the frame is only looked at where the transceiver put it */
 #if (defined(MODULE_AT86RF231) | \
      defined(MODULE_CC2420) | \
      defined(MODULE_MC1322X))
             p = (ieee802154_packet_t *) m.content.ptr;
-            memcpy(&frame, &p->frame, sizeof(ieee802154_frame_t));
+            payload = p->frame.payload;
             length = p->frame.payload_len;
+            src_m = p->frame.fcf.src_addr_m;
+            dest_m = p->frame.fcf.dest_addr_m;
+            src_ptr = p->frame.src_addr;
+            dest_ptr = p->frame.dest_addr;
+            seq = p->frame.seq_nr;
 #else
             p = (radio_packet_t *) m.content.ptr;
-            hdrlen = ieee802154_frame_read(p->data, &frame, p->length);
-            length = p->length - hdrlen - IEEE_802154_FCS_LEN;
+
+            if (ieee802154_frame_view(&view, p->data, p->length) < 0) {
+                DEBUG("Malformed IEEE 802.15.4 header.\n");
+                NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_MALFORMED);
+                transceiver_release(p);
+                continue;
+            }
+
+            payload = ieee802154_view_payload(&view);
+            length = ieee802154_view_payload_len(&view);
+            src_m = ieee802154_view_src_addr_m(&view);
+            dest_m = ieee802154_view_dest_addr_m(&view);
+            ieee802154_view_get_src_addr(&view, src_addr);
+            ieee802154_view_get_dest_addr(&view, dest_addr);
+            src_ptr = src_addr;
+            dest_ptr = dest_addr;
+            seq = ieee802154_view_seq_nr(&view);
 #endif
 
 #ifdef DEBUG_ENABLED
             DEBUG("INFO: Received IEEE 802.15.4. packet (length = %d):\n", length);
-            DEBUG("INFO: FCF:\n");
-            ieee802154_frame_print_fcf_frame(&frame);
+            DEBUG("INFO: address modes: %d (source), %d (destination)\n",
+                  src_m, dest_m);
 
             DEBUG("Sender:");
 
             for (uint8_t i = 0; i < 8; i++) {
-                printf("%02x ", frame.src_addr[i]);
+                printf("%02x ", src_ptr[i]);
             }
 
             DEBUG("\n");
@@ -112,53 +185,86 @@ void recv_ieee802154_frame(void)
             DEBUG("Receiver:");
 
             for (size_t i = 0; i < 8; i++) {
-                printf("%02x ", frame.dest_addr[i]);
+                printf("%02x ", dest_ptr[i]);
             }
 
             DEBUG("\n");
 
             DEBUG("Payload:\n");
 
-            for (uint8_t i = 0; i < frame.payload_len; i++) {
-                printf("%02x ", frame.payload[i]);
+            for (uint8_t i = 0; i < length; i++) {
+                printf("%02x ", payload[i]);
 
-                if (!((i + 1) % 16) || i == frame.payload_len - 1) {
+                if (!((i + 1) % 16) || i == length - 1) {
                     printf("\n");
                 }
             }
 
 #endif
 
-            if (frame.fcf.src_addr_m == IEEE_802154_SHORT_ADDR_M) {
-                mac_frame_short_to_eui64(&src, frame.src_addr);
+            if (src_m == IEEE_802154_SHORT_ADDR_M) {
+                mac_frame_short_to_eui64(&src, src_ptr);
             }
-            else if (frame.fcf.src_addr_m == IEEE_802154_LONG_ADDR_M) {
-                memcpy(&src, frame.src_addr, 8);
+            else if (src_m == IEEE_802154_LONG_ADDR_M) {
+                memcpy(&src, src_ptr, 8);
             }
             else {
                 DEBUG("Unknown IEEE 802.15.4 source address mode.\n");
+                NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_MALFORMED);
+                transceiver_release(p);
                 continue;
             }
 
-            if (frame.fcf.dest_addr_m == IEEE_802154_SHORT_ADDR_M) {
-                mac_frame_short_to_eui64(&dst, frame.dest_addr);
+            if (dest_m == IEEE_802154_SHORT_ADDR_M) {
+                mac_frame_short_to_eui64(&dst, dest_ptr);
             }
-            else if (frame.fcf.dest_addr_m == IEEE_802154_LONG_ADDR_M) {
-                memcpy(&dst, frame.dest_addr, 8);
+            else if (dest_m == IEEE_802154_LONG_ADDR_M) {
+                memcpy(&dst, dest_ptr, 8);
             }
             else {
                 DEBUG("Unknown IEEE 802.15.4 destination address mode.\n");
+                NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_MALFORMED);
+                transceiver_release(p);
+                continue;
+            }
+
+            if (mac_rx_handler != NULL) {
+                mac_rx_handler(&src, p->lqi);
+            }
+
+#ifdef MODULE_FTSP
+            /* time beacons carry no IPv6, whatever the engine */
+            if ((length > 0) && (payload[0] == FTSP_DISPATCH)) {
+                ftsp_receive(&src, payload, length, timex_uint64(p->toa));
+                transceiver_release(p);
+                continue;
+            }
+#endif
+
+            /* the engine may consume its own frames */
+            if ((mac_engine != NULL) && (mac_engine->receive != NULL) &&
+                mac_engine->receive(0, &src, &dst, payload, length)) {
+                transceiver_release(p);
+                continue;
+            }
+
+            if ((dst.uint16[3] != 0xffff) && mac_is_duplicate(&src, seq)) {
+                DEBUG("Duplicate IEEE 802.15.4 frame.\n");
+                NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_DUPLICATE);
+                transceiver_release(p);
                 continue;
             }
 
             /* deliver packet to network(6lowpan)-layer */
-            lowpan_read(frame.payload, length, &src, &dst);
+            NETSTAT_RX(NETSTAT_LAYER_MAC);
+            lowpan_read(payload, length, &src, &dst);
             /* TODO: get interface ID somehow */
 
-            p->processing--;
+            transceiver_release(p);
         }
         else if (m.type == ENOBUFFER) {
             DEBUG("Transceiver buffer full");
+            NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_NO_BUFFER);
         }
         else {
             DEBUG("Unknown packet received");
@@ -201,9 +307,13 @@ void set_ieee802154_frame_values(int if_id, uint16_t dest_pan,
     macdsn++;
 }
 
-int sixlowpan_mac_prepare_ieee802144_frame(
-    ieee802154_frame_t *frame, int if_id, uint16_t dest_pan, const void *dest,
-    uint8_t dest_len, const void *payload, uint8_t length, uint8_t mcast)
+/* writes the frame to *buf*, its payload gathered from *hdr* and
+ * *payload*, returns the header length */
+static int mac_prepare_frame(uint8_t *buf, ieee802154_frame_t *frame,
+                             int if_id, uint16_t dest_pan, const void *dest,
+                             uint8_t dest_len, const void *hdr,
+                             uint8_t hdr_len, const void *payload,
+                             uint8_t length, uint8_t mcast)
 {
     uint8_t src_mode = net_if_get_src_address_mode(if_id);
     uint8_t dest_mode;
@@ -243,75 +353,256 @@ int sixlowpan_mac_prepare_ieee802144_frame(
         memcpy(&frame->dest_addr[0], dest, dest_len);
     }
 
-    frame->payload = (uint8_t *)payload; // payload won't be changed so cast is legal.
-    frame->payload_len = length;
-    uint8_t hdrlen = ieee802154_frame_get_hdr_len(frame);
+    frame->payload_len = hdr_len + length;
 
-    memset(&lowpan_mac_buf, 0, PAYLOAD_SIZE);
-    ieee802154_frame_init(frame, (uint8_t *)&lowpan_mac_buf);
-    memcpy(&lowpan_mac_buf[hdrlen], frame->payload, frame->payload_len);
-    /* set FCS */
-    fcs = (uint16_t *)&lowpan_mac_buf[frame->payload_len + hdrlen];
-    *fcs = ieee802154_frame_get_fcs(lowpan_mac_buf, frame->payload_len + hdrlen);
+    /* the header is written in place, only the payload is copied */
+    uint8_t hdrlen = ieee802154_frame_init(frame, buf);
+    frame->payload = &buf[hdrlen];
+
+    if (hdr_len) {
+        memcpy(frame->payload, hdr, hdr_len);
+    }
+
+    memcpy(&frame->payload[hdr_len], payload, length);
+    /* set FCS, unless the radio protects the frame itself */
+    fcs = (uint16_t *)&buf[frame->payload_len + hdrlen];
+
+    if (net_if_get_interface(if_id) &&
+        !(net_if_get_interface(if_id)->transceivers & ~TRANSCEIVER_HW_FCS)) {
+        *fcs = 0;
+    }
+    else {
+        *fcs = ieee802154_frame_get_fcs(buf, frame->payload_len + hdrlen);
+    }
     DEBUG("IEEE802.15.4 frame - FCF: %02X %02X DPID: %02X SPID: %02X DSN: %02X\n",
-          lowpan_mac_buf[0], lowpan_mac_buf[1], frame->dest_pan_id,
-          frame->src_pan_id, frame->seq_nr);
+          buf[0], buf[1], frame->dest_pan_id, frame->src_pan_id, frame->seq_nr);
 
     return hdrlen;
 }
 
+int sixlowpan_mac_prepare_ieee802144_frame(
+    ieee802154_frame_t *frame, int if_id, uint16_t dest_pan, const void *dest,
+    uint8_t dest_len, const void *payload, uint8_t length, uint8_t mcast)
+{
+    return mac_prepare_frame(lowpan_mac_buf, frame, if_id, dest_pan, dest,
+                             dest_len, NULL, 0, payload, length, mcast);
+}
+
+static inline int mac_needs_header(int if_id)
+{
+    return !(net_if_get_interface(if_id) &&
+             net_if_get_interface(if_id)->transceivers & IEEE802154_TRANSCEIVER);
+}
+
+static inline void mac_count_tx(int res)
+{
+    if (res > 0) {
+        NETSTAT_TX(NETSTAT_LAYER_MAC);
+    }
+    else {
+        NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_TX_FAILED);
+    }
+}
+
+/* *attempts* gets the number of transmissions of a unicast frame */
+static int mac_transmit(const sixlowpan_mac_frame_t *frame, uint8_t *attempts)
+{
+    if (frame->mcast) {
+        return net_if_send_packet_broadcast_prio(IEEE_802154_SHORT_ADDR_M,
+                                                 frame->data, frame->len,
+                                                 frame->priority);
+    }
+
+    if (frame->dest_len == 8) {
+        net_if_eui64_t eui64;
+
+        memcpy(&eui64, frame->dest, sizeof(eui64));
+        return net_if_send_packet_long_prio(frame->if_id, &eui64,
+                                            frame->data, (size_t)frame->len,
+                                            frame->priority, attempts);
+    }
+
+    return net_if_send_packet_prio(frame->if_id,
+                                   NTOHS(*((uint16_t *)frame->dest)),
+                                   frame->data, (size_t)frame->len,
+                                   frame->priority, attempts);
+}
+
+int sixlowpan_mac_transmit(const sixlowpan_mac_frame_t *frame)
+{
+    return mac_transmit(frame, NULL);
+}
+
 int sixlowpan_mac_send_data(int if_id,
                             const void *dest, uint8_t dest_len,
                             const void *payload,
-                            uint8_t payload_len, uint8_t mcast)
+                            uint8_t payload_len, uint8_t mcast,
+                            uint8_t priority)
 {
+    sixlowpan_mac_frame_t frame;
+    uint8_t attempts = 1;
+    int res;
+
+    frame.if_id = if_id;
+    frame.dest = dest;
+    frame.dest_len = dest_len;
+    frame.mcast = mcast;
+    frame.data = payload;
+    frame.len = payload_len;
+    frame.priority = priority;
+
     if (mcast) {
-        return net_if_send_packet_broadcast(IEEE_802154_SHORT_ADDR_M,
-                                            payload,
-                                            payload_len);
+        memset(&frame.neighbor, 0xff, sizeof(frame.neighbor));
+    }
+    else if (dest_len == 8) {
+        memcpy(&frame.neighbor, dest, sizeof(frame.neighbor));
+    }
+    else if (dest_len == 2) {
+        /* mac_frame_short_to_eui64() takes little endian */
+        uint8_t frame_short[2] = { ((uint8_t *) dest)[1], ((uint8_t *) dest)[0] };
+
+        mac_frame_short_to_eui64(&frame.neighbor, frame_short);
     }
     else {
-        if (dest_len == 8) {
-            return net_if_send_packet_long(if_id, (net_if_eui64_t *) dest,
-                                           payload, (size_t)payload_len);
-        }
-        else if (dest_len == 2) {
-            return net_if_send_packet(if_id, NTOHS(*((uint16_t *)dest)),
-                                      payload, (size_t)payload_len);
-        }
+        NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_MALFORMED);
+        return -1;
+    }
+
+    if ((mac_engine != NULL) && (mac_engine->send != NULL)) {
+        res = mac_engine->send(&frame);
+    }
+    else {
+        res = mac_transmit(&frame, &attempts);
+    }
+
+    mac_count_tx(res);
+
+    /* an engine does not report retries, a sent frame took one there */
+    if (!mcast && (mac_tx_handler != NULL)) {
+        mac_tx_handler(&frame.neighbor, (res > 0) ? attempts : 0);
     }
 
-    return -1;
+    return res;
 }
 
 int sixlowpan_mac_send_ieee802154_frame(int if_id,
                                         const void *dest, uint8_t dest_len,
                                         const void *payload,
-                                        uint8_t payload_len, uint8_t mcast)
+                                        uint8_t payload_len, uint8_t mcast,
+                                        uint8_t priority)
 {
-    if (net_if_get_interface(if_id) &&
-        net_if_get_interface(if_id)->transceivers & IEEE802154_TRANSCEIVER) {
-        return sixlowpan_mac_send_data(if_id, dest, dest_len, payload,
-                                       payload_len, mcast);
+    return sixlowpan_mac_send_ieee802154_frame_gather(if_id, dest, dest_len,
+                                                      NULL, 0, payload,
+                                                      payload_len, mcast,
+                                                      priority);
+}
+
+int sixlowpan_mac_send_ieee802154_frame_gather(int if_id, const void *dest,
+                                               uint8_t dest_len,
+                                               const void *hdr,
+                                               uint8_t hdr_len,
+                                               const void *payload,
+                                               uint8_t payload_len,
+                                               uint8_t mcast,
+                                               uint8_t priority)
+{
+    if (!mac_needs_header(if_id)) {
+        if (hdr_len == 0) {
+            return sixlowpan_mac_send_data(if_id, dest, dest_len, payload,
+                                           payload_len, mcast, priority);
+        }
+
+        /* the transceiver takes the payload in one piece */
+        memcpy(lowpan_mac_buf, hdr, hdr_len);
+        memcpy(&lowpan_mac_buf[hdr_len], payload, payload_len);
+        return sixlowpan_mac_send_data(if_id, dest, dest_len, lowpan_mac_buf,
+                                       hdr_len + payload_len, mcast,
+                                       priority);
     }
     else {
         ieee802154_frame_t frame;
         uint16_t dest_pan = HTONS(0xabcd);
         uint8_t length;
-        int hdrlen = sixlowpan_mac_prepare_ieee802144_frame(&frame, if_id,
-                                                            dest_pan, dest,
-                                                            dest_len, payload,
-                                                            payload_len, mcast);
+        int hdrlen = mac_prepare_frame(lowpan_mac_buf, &frame, if_id,
+                                       dest_pan, dest, dest_len, hdr, hdr_len,
+                                       payload, payload_len, mcast);
 
         if (hdrlen < 0) {
+            NETSTAT_DROP(NETSTAT_LAYER_MAC, NETSTAT_DROP_MALFORMED);
             return -1;
         }
 
         length = hdrlen + frame.payload_len + IEEE_802154_FCS_LEN;
 
         return sixlowpan_mac_send_data(if_id, dest, dest_len, lowpan_mac_buf,
-                                       length, mcast);
+                                       length, mcast, priority);
+    }
+}
+
+int sixlowpan_mac_send_control(int if_id, const net_if_eui64_t *dest,
+                               const void *payload, uint8_t length)
+{
+    static const uint8_t short_prefix[6] = { 0, 0, 0, 0xff, 0xfe, 0 };
+    sixlowpan_mac_frame_t f;
+    uint8_t buf[PAYLOAD_SIZE];
+    uint16_t dest_short;
+
+    f.if_id = if_id;
+    f.mcast = (dest == NULL);
+    f.priority = TRANSCEIVER_TX_PRIO_CONTROL;
+
+    if (f.mcast) {
+        memset(&f.neighbor, 0xff, sizeof(f.neighbor));
+        dest_short = 0xffff;
+        f.dest = &dest_short;
+        f.dest_len = 2;
+    }
+    /* answer short addresses with short addresses */
+    else if (memcmp(dest, short_prefix, sizeof(short_prefix)) == 0) {
+        f.neighbor = *dest;
+        dest_short = dest->uint16[3];
+        f.dest = &dest_short;
+        f.dest_len = 2;
+    }
+    else {
+        f.neighbor = *dest;
+        f.dest = dest;
+        f.dest_len = 8;
+    }
+
+    if (mac_needs_header(if_id)) {
+        ieee802154_frame_t frame;
+        int hdrlen = mac_prepare_frame(buf, &frame, if_id, HTONS(0xabcd),
+                                       f.dest, f.dest_len, NULL, 0, payload,
+                                       length, f.mcast);
+
+        if (hdrlen < 0) {
+            return -1;
+        }
+
+        f.data = buf;
+        f.len = hdrlen + length + IEEE_802154_FCS_LEN;
+    }
+    else {
+        f.data = payload;
+        f.len = length;
     }
+
+    return sixlowpan_mac_transmit(&f);
+}
+
+void sixlowpan_mac_set_engine(const sixlowpan_mac_engine_t *engine)
+{
+    mac_engine = engine;
+}
+
+void sixlowpan_mac_set_link_handlers(void (*tx)(const net_if_eui64_t *dest,
+                                                uint8_t transmissions),
+                                     void (*rx)(const net_if_eui64_t *src,
+                                                uint8_t lqi))
+{
+    mac_tx_handler = tx;
+    mac_rx_handler = rx;
 }
 
 int sixlowpan_mac_init(void)
@@ -0,0 +1,209 @@
+/*
+ * IPv6 source routing header
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sixlowpan
+ * @{
+ * @file    srh.c
+ * @brief   Compressed source routing header for RPL (RFC 6554).
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "net_help.h"
+
+#include "ip.h"
+#include "srh.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define SRH_LEN         (sizeof(ipv6_srh_t))
+#define SRH_CMPR_MAX    (15)
+
+/* number of leading octets a and b share, at most SRH_CMPR_MAX */
+static uint8_t srh_common(const ipv6_addr_t *a, const ipv6_addr_t *b)
+{
+    uint8_t i = 0;
+
+    while ((i < SRH_CMPR_MAX) && (a->uint8[i] == b->uint8[i])) {
+        i++;
+    }
+
+    return i;
+}
+
+int ipv6_srh_insert(ipv6_hdr_t *packet, const ipv6_addr_t *hops,
+                    uint8_t numof)
+{
+    ipv6_srh_t *srh = (ipv6_srh_t *)((uint8_t *) packet + IPV6_HDR_LEN);
+    uint16_t payload_len = NTOHS(packet->length);
+    uint8_t cmpr_i = SRH_CMPR_MAX, cmpr_e, pad;
+    uint16_t len;
+    uint8_t *addr;
+    uint8_t i;
+
+    /* Addresses[i] is expanded by hop i - 1, which is then the destination
+     * of the packet; the destination as Addresses[n] by the last hop */
+    for (i = 1; i < numof; i++) {
+        uint8_t common = srh_common(&hops[i - 1], &hops[i]);
+
+        if (common < cmpr_i) {
+            cmpr_i = common;
+        }
+    }
+
+    cmpr_e = srh_common(&hops[numof - 1], &packet->destaddr);
+
+    len = SRH_LEN + (numof - 1) * (IPV6_ADDR_LEN - cmpr_i) +
+          (IPV6_ADDR_LEN - cmpr_e);
+    pad = (8 - (len % 8)) % 8;
+    len += pad;
+
+    if (IPV6_HDR_LEN + payload_len + len > IPV6_MTU) {
+        DEBUG("ipv6_srh_insert: packet too big for %u hops\n", numof);
+        return -1;
+    }
+
+    memmove((uint8_t *) srh + len, srh, payload_len);
+
+    srh->nextheader = packet->nextheader;
+    srh->length = (len / 8) - 1;
+    srh->routing_type = IPV6_SRH_ROUTING_TYPE;
+    srh->segments_left = numof;
+    srh->cmpr = (cmpr_i << 4) | cmpr_e;
+    srh->pad_reserved = pad << 4;
+    srh->reserved = 0;
+
+    addr = (uint8_t *) srh + SRH_LEN;
+
+    for (i = 1; i < numof; i++) {
+        memcpy(addr, &hops[i].uint8[cmpr_i], IPV6_ADDR_LEN - cmpr_i);
+        addr += IPV6_ADDR_LEN - cmpr_i;
+    }
+
+    memcpy(addr, &packet->destaddr.uint8[cmpr_e], IPV6_ADDR_LEN - cmpr_e);
+    memset(addr + IPV6_ADDR_LEN - cmpr_e, 0, pad);
+
+    packet->nextheader = IPV6_PROTO_NUM_ROUTING;
+    packet->length = HTONS(payload_len + len);
+    memcpy(&packet->destaddr, &hops[0], sizeof(ipv6_addr_t));
+
+    return len;
+}
+
+/* number of addresses in the header, 0 if it is malformed */
+static uint8_t srh_numof(const ipv6_srh_t *srh, uint16_t payload_len)
+{
+    uint16_t len = (srh->length + 1) * 8;
+    uint8_t cmpr_i = srh->cmpr >> 4;
+    uint8_t cmpr_e = srh->cmpr & 0x0f;
+    uint8_t pad = srh->pad_reserved >> 4;
+
+    if ((payload_len < len) ||
+        (len < SRH_LEN + (IPV6_ADDR_LEN - cmpr_e) + pad)) {
+        return 0;
+    }
+
+    return ((len - SRH_LEN - pad - (IPV6_ADDR_LEN - cmpr_e)) /
+            (IPV6_ADDR_LEN - cmpr_i)) + 1;
+}
+
+int ipv6_srh_remove(ipv6_hdr_t *packet, ipv6_addr_t *hops, uint8_t max)
+{
+    ipv6_srh_t *srh = (ipv6_srh_t *)((uint8_t *) packet + IPV6_HDR_LEN);
+    uint16_t payload_len = NTOHS(packet->length);
+    uint16_t len = (srh->length + 1) * 8;
+    uint8_t cmpr_i = srh->cmpr >> 4;
+    uint8_t n = srh_numof(srh, payload_len);
+    uint8_t i, numof = 0;
+    uint8_t *addr;
+
+    if ((n == 0) || (srh->routing_type != IPV6_SRH_ROUTING_TYPE) ||
+        (srh->segments_left > n) || (srh->segments_left > max)) {
+        return -1;
+    }
+
+    if (srh->segments_left > 0) {
+        /* elided octets come from the current destination */
+        hops[numof++] = packet->destaddr;
+
+        for (i = n - srh->segments_left; i < n - 1; i++) {
+            addr = (uint8_t *) srh + SRH_LEN + i * (IPV6_ADDR_LEN - cmpr_i);
+            hops[numof] = packet->destaddr;
+            memcpy(&hops[numof].uint8[cmpr_i], addr, IPV6_ADDR_LEN - cmpr_i);
+            numof++;
+        }
+
+        addr = (uint8_t *) srh + SRH_LEN + (n - 1) * (IPV6_ADDR_LEN - cmpr_i);
+        memcpy(&packet->destaddr.uint8[srh->cmpr & 0x0f], addr,
+               IPV6_ADDR_LEN - (srh->cmpr & 0x0f));
+    }
+
+    packet->nextheader = srh->nextheader;
+    packet->length = HTONS(payload_len - len);
+    memmove(srh, (uint8_t *) srh + len, payload_len - len);
+
+    return numof;
+}
+
+int ipv6_srh_process(ipv6_hdr_t *packet)
+{
+    ipv6_srh_t *srh = (ipv6_srh_t *)((uint8_t *) packet + IPV6_HDR_LEN);
+    uint16_t payload_len = NTOHS(packet->length);
+    uint16_t len = (srh->length + 1) * 8;
+    uint8_t cmpr_i = srh->cmpr >> 4;
+    uint8_t cmpr_e = srh->cmpr & 0x0f;
+    uint8_t n = srh_numof(srh, payload_len);
+    uint8_t i, elided;
+    ipv6_addr_t next;
+    uint8_t *addr;
+
+    if (n == 0) {
+        return -1;
+    }
+
+    if (srh->segments_left == 0) {
+        /* arrived, hand the payload to the upper layer as if the header
+         * had never been there */
+        packet->nextheader = srh->nextheader;
+        packet->length = HTONS(payload_len - len);
+        memmove(srh, (uint8_t *) srh + len, payload_len - len);
+        return 0;
+    }
+
+    if (srh->routing_type != IPV6_SRH_ROUTING_TYPE) {
+        DEBUG("ipv6_srh_process: unknown routing type %u\n",
+              srh->routing_type);
+        return -1;
+    }
+
+    if (srh->segments_left > n) {
+        return -1;
+    }
+
+    i = n - srh->segments_left;
+    srh->segments_left--;
+    elided = (i < n - 1) ? cmpr_i : cmpr_e;
+    addr = (uint8_t *) srh + SRH_LEN + i * (IPV6_ADDR_LEN - cmpr_i);
+
+    memcpy(&next, &packet->destaddr, sizeof(ipv6_addr_t));
+    memcpy(&next.uint8[elided], addr, IPV6_ADDR_LEN - elided);
+
+    if (ipv6_addr_is_multicast(&next)) {
+        return -1;
+    }
+
+    /* the visited address takes the place of the next one (RFC 6554, 4.2) */
+    memcpy(addr, &packet->destaddr.uint8[elided], IPV6_ADDR_LEN - elided);
+    memcpy(&packet->destaddr, &next, sizeof(ipv6_addr_t));
+
+    return 1;
+}
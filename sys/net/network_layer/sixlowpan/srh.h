@@ -0,0 +1,72 @@
+/*
+ * IPv6 source routing header
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sixlowpan
+ * @{
+ * @file    srh.h
+ * @brief   Compressed source routing header for RPL (RFC 6554).
+ * @}
+ */
+
+#ifndef _SIXLOWPAN_SRH_H
+#define _SIXLOWPAN_SRH_H
+
+#include <stdint.h>
+
+#include "sixlowpan/types.h"
+
+/**
+ * @brief   Routing type of the RPL source routing header.
+ */
+#define IPV6_SRH_ROUTING_TYPE   (3)
+
+/**
+ * @brief   Inserts a source routing header behind the IPv6 header of
+ *          *packet*. The packet's destination moves into the header and
+ *          *hops[0]* becomes the new destination.
+ *
+ * @param[in,out] packet    The packet, the buffer behind its payload must
+ *                          have room for the header.
+ * @param[in] hops          The hops to the destination, *hops[0]* is a
+ *                          neighbor.
+ * @param[in] numof         Number of hops, at least 1.
+ *
+ * @return  Length of the inserted header, -1 if the packet gets too big.
+ */
+int ipv6_srh_insert(ipv6_hdr_t *packet, const ipv6_addr_t *hops,
+                    uint8_t numof);
+
+/**
+ * @brief   Processes the routing header directly behind the IPv6 header of
+ *          a packet for this node.
+ *
+ * @return  1 if the packet has to be forwarded to its new destination,
+ *          0 if it has arrived (the routing header is removed),
+ *          -1 if it has to be dropped.
+ */
+int ipv6_srh_process(ipv6_hdr_t *packet);
+
+/**
+ * @brief   Removes the routing header directly behind the IPv6 header of
+ *          *packet*, the reverse of ipv6_srh_insert(): the last address of
+ *          the header becomes the destination again.
+ *
+ * @param[in,out] packet    The packet.
+ * @param[out] hops         The hops the packet has still to visit before
+ *                          the destination, *hops[0]* is the current
+ *                          destination.
+ * @param[in] max           Size of *hops*.
+ *
+ * @return  Number of hops, 0 if the packet has arrived already, -1 if the
+ *          header is malformed or has more than *max* hops; the packet is
+ *          not changed then.
+ */
+int ipv6_srh_remove(ipv6_hdr_t *packet, ipv6_addr_t *hops, uint8_t max);
+
+#endif /* _SIXLOWPAN_SRH_H */
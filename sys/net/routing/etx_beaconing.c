@@ -24,8 +24,10 @@
 #include "vtimer.h"
 #include "thread.h"
 #include "transceiver.h"
+#include "workqueue.h"
 
 #include "sixlowpan/ip.h"
+#include "sixlowpan/mac.h"
 #include "ieee802154_frame.h"
 #include "etx_beaconing.h"
 
@@ -33,47 +35,54 @@
 #include "debug.h"
 
 #if ENABLE_DEBUG
-#define ETX_BEACON_STACKSIZE    (KERNEL_CONF_STACKSIZE_DEFAULT + KERNEL_CONF_STACKSIZE_PRINTF_FLOAT)
 #define ETX_RADIO_STACKSIZE     (KERNEL_CONF_STACKSIZE_DEFAULT + KERNEL_CONF_STACKSIZE_PRINTF_FLOAT)
-#define ETX_CLOCK_STACKSIZE     (KERNEL_CONF_STACKSIZE_DEFAULT)
 #else
-#define ETX_BEACON_STACKSIZE    (KERNEL_CONF_STACKSIZE_MAIN)
 #define ETX_RADIO_STACKSIZE     (KERNEL_CONF_STACKSIZE_MAIN)
-#define ETX_CLOCK_STACKSIZE     (KERNEL_CONF_STACKSIZE_DEFAULT)
 #endif
 
 /* prototytpes */
 static uint8_t etx_count_packet_tx(etx_neighbor_t *candidate);
-static void etx_set_packets_received(void);
 static bool etx_equal_id(ipv6_addr_t *id1, ipv6_addr_t *id2);
+etx_neighbor_t *etx_add_candidate(ipv6_addr_t *address);
 
+#if ETX_USE_BEACONS
 //Buffer
-static char etx_beacon_buf[ETX_BEACON_STACKSIZE];
 static char etx_radio_buf[ETX_RADIO_STACKSIZE];
-static char etx_clock_buf[ETX_CLOCK_STACKSIZE];
 
+//Beacons are sent on the shared work queue
+static work_t etx_beacon_work;
+static void etx_beacon(work_t *work);
+#endif
+
+//Called with the address of a neighbor whose ETX value changed
+static void (*etx_change_handler)(ipv6_addr_t *address);
+
+#if ETX_USE_BEACONS
 static uint8_t etx_send_buf[ETX_BUF_SIZE];
+#endif
 static uint8_t etx_rec_buf[ETX_BUF_SIZE];
 
 //PIDs
-int etx_beacon_pid = 0;
 int etx_radio_pid = 0;
-int etx_clock_pid = 0;
 
 //Message queue for radio
 static msg_t msg_que[ETX_RCV_QUEUE_SIZE];
 
 /*
- * The counter for the current 'round'. An ETX beacon is sent every ETX_INTERVAL
- * u-seconds and a node computes the ETX value by comparing the the received
- * probes vs the expected probes from a neighbor every ETX_ROUND intervals.
+ * The sequence number of our last beacon and the doublings of ETX_INTERVAL
+ * until the next one. A neighbor compares the beacons it received from us
+ * to the sequence numbers it saw, so the rates of the nodes need not match.
  */
-static uint8_t cur_round;
+#if ETX_USE_BEACONS
+static uint8_t beacon_seq;
+#endif
+static uint8_t beacon_interval;
 
 /*
- * If we have not yet reached WINDOW intervals, won't calculate the ETX just yet
+ * Set when a neighbor comes or goes or an estimate changes a lot, the next
+ * beacon is then sent after ETX_INTERVAL again
  */
-static char reached_window;
+static uint8_t etx_unstable;
 
 /*
  * This could (and should) be done differently, once the RPL implementation
@@ -88,11 +97,8 @@ static char reached_window;
 static etx_neighbor_t candidates[ETX_MAX_CANDIDATE_NEIGHBORS];
 
 /*
- * Each time we send a beacon packet we need to reset some values for the
- * current 'round' (a round being the time between each sent beacon packet).
- *
- * In this time, no packet may be handled, otherwise it could assume values
- * from the last round to count for this round.
+ * Guards the candidates between the beacons, the receiving thread and the
+ * samples taken by the MAC.
  */
 mutex_t etx_mutex;
 //Transceiver command for sending ETX probes
@@ -103,15 +109,45 @@ msg_t mesg;
 
 static ipv6_addr_t *own_address;
 
+#if ETX_USE_BEACONS
 static etx_probe_t *etx_get_send_buf(void)
 {
     return ((etx_probe_t *) &(etx_send_buf[0]));
 }
+#endif
 static etx_probe_t *etx_get_rec_buf(void)
 {
     return ((etx_probe_t *) &(etx_rec_buf[0]));
 }
 
+static uint32_t etx_now_ms(void)
+{
+    timex_t now;
+
+    vtimer_now(&now);
+    return now.seconds * MS + now.microseconds / MS;
+}
+
+static uint32_t etx_interval_ms(uint8_t doublings)
+{
+    return (uint32_t) ETX_INTERVAL << doublings;
+}
+
+/* beacons of the candidate stopped for a whole window */
+static bool etx_beacons_stale(etx_neighbor_t *candidate, uint32_t now)
+{
+    uint32_t window = ETX_WINDOW * etx_interval_ms(candidate->interval);
+
+    return (candidate->span == 0) ||
+           (now - candidate->last_beacon > window + window / 4);
+}
+
+static bool etx_traffic_recent(etx_neighbor_t *candidate, uint32_t now)
+{
+    return (candidate->last_traffic != 0) &&
+           (now - candidate->last_traffic <= ETX_TRAFFIC_TIMEOUT);
+}
+
 void etx_show_candidates(void)
 {
     etx_neighbor_t *candidate;
@@ -125,89 +161,147 @@ void etx_show_candidates(void)
         }
 
         printf("Candidates Addr:%d\n"
-               "\t cur_etx:%f\n"
+               "\t cur_etx:%u.%02u\n"
                "\t packets_rx:%d\n"
-               "\t packets_tx:%d\n"
+               "\t packets_tx:%d/%d\n"
                "\t used:%d\n", candidate->addr.uint8[ETX_IPV6_LAST_BYTE],
-               candidate->cur_etx, candidate->packets_rx,
-               etx_count_packet_tx(candidate),
+               candidate->cur_etx / ETX_SCALE,
+               ((candidate->cur_etx % ETX_SCALE) * 100) / ETX_SCALE,
+               candidate->packets_rx,
+               etx_count_packet_tx(candidate), candidate->span,
                candidate->used);
     }
+
+    printf("Beacon interval: %lu ms\n",
+           (unsigned long) etx_interval_ms(beacon_interval));
+}
+
+static void etx_eui64_to_addr(ipv6_addr_t *addr, const net_if_eui64_t *eui64)
+{
+    /* the link-local address the neighbor derives (see ipv6_addr_set_by_eui64) */
+    ipv6_addr_set_link_local_prefix(addr);
+    memcpy(&addr->uint8[8], eui64, sizeof(*eui64));
+
+    if (!sixlowpan_lowpan_eui64_to_short_addr(eui64)) {
+        addr->uint8[8] ^= 0x02;
+    }
+}
+
+static void etx_mac_tx(const net_if_eui64_t *dest, uint8_t transmissions)
+{
+    ipv6_addr_t addr;
+
+    etx_eui64_to_addr(&addr, dest);
+    etx_tx_result(&addr, transmissions);
+}
+
+static void etx_mac_rx(const net_if_eui64_t *src, uint8_t lqi)
+{
+    ipv6_addr_t addr;
+
+    etx_eui64_to_addr(&addr, src);
+    etx_rx_quality(&addr, lqi);
 }
 
 void etx_init_beaconing(ipv6_addr_t *address)
 {
     mutex_init(&etx_mutex);
     own_address = address;
+    sixlowpan_mac_set_link_handlers(etx_mac_tx, etx_mac_rx);
+#if ETX_USE_BEACONS
     //set code
     puts("ETX BEACON INIT");
     etx_send_buf[0] = ETX_PKT_OPTVAL;
 
-    etx_beacon_pid = thread_create(etx_beacon_buf, ETX_BEACON_STACKSIZE,
-                                   PRIORITY_MAIN - 1, CREATE_STACKTEST,
-                                   etx_beacon, "etx_beacon");
-
     etx_radio_pid = thread_create(etx_radio_buf, ETX_RADIO_STACKSIZE,
                                   PRIORITY_MAIN - 1, CREATE_STACKTEST,
                                   etx_radio, "etx_radio");
 
-    etx_clock_pid = thread_create(etx_clock_buf, ETX_CLOCK_STACKSIZE,
-                                  PRIORITY_MAIN - 1, CREATE_STACKTEST,
-                                  etx_clock, "etx_clock");
+    workqueue_init();
+    workqueue_work_init(&etx_beacon_work, etx_beacon, NULL, PRIORITY_MAIN - 1);
+    workqueue_post(&etx_beacon_work);
     //register at transceiver
     transceiver_register(TRANSCEIVER_CC1100, etx_radio_pid);
     puts("...[DONE]");
+#endif
 }
 
-void etx_beacon(void)
+#if ETX_USE_BEACONS
+/* next beacon interval in doublings of ETX_INTERVAL, call with etx_mutex */
+static uint8_t etx_next_interval(void)
 {
-    /*
-     * Sends a message every ETX_INTERVAL +/- a jitter-value (default is 10%) .
-     * A correcting variable is needed to stay at a base interval of
-     * ETX_INTERVAL between the wakeups. It takes the old jittervalue in account
-     * and modifies the time to wait accordingly.
-     */
-    etx_probe_t *packet = etx_get_send_buf();
-    uint8_t p_length = 0;
+    uint32_t now = etx_now_ms();
+    bool traffic = false;
+
+    if (etx_unstable) {
+        etx_unstable = 0;
+        return 0;
+    }
 
-    while (true) {
-        thread_sleep();
-        mutex_lock(&etx_mutex);
-        //Build etx packet
-        p_length = 0;
-
-        for (uint8_t i = 0; i < ETX_BEST_CANDIDATES; i++) {
-            if (candidates[i].used != 0) {
-                packet->data[i * ETX_TUPLE_SIZE] =
-                    candidates[i].addr.uint8[ETX_IPV6_LAST_BYTE];
-                packet->data[i * ETX_TUPLE_SIZE + ETX_PKT_REC_OFFSET] =
-                    etx_count_packet_tx(&candidates[i]);
-                p_length = p_length + ETX_PKT_HDR_LEN;
+    /* neighbors whose estimates all come from recent traffic need no
+     * beacons to speak of */
+    for (uint8_t i = 0; i < ETX_MAX_CANDIDATE_NEIGHBORS; i++) {
+        if (candidates[i].used) {
+            traffic = etx_traffic_recent(&candidates[i], now);
+
+            if (!traffic) {
+                break;
             }
         }
+    }
 
-        packet->length = p_length;
-        /* will be send broadcast, so if_id and destination address will be
-         * ignored (see documentation)
-         */
-        sixlowpan_mac_send_ieee802154_frame(0, NULL, 8, &etx_send_buf[0],
-                                            ETX_DATA_MAXLEN + ETX_PKT_HDR_LEN, 1);
-        DEBUG("sent beacon!\n");
-        etx_set_packets_received();
-        cur_round++;
-
-        if (cur_round == ETX_WINDOW) {
-            if (reached_window != 1) {
-                //first round is through
-                reached_window = 1;
-            }
+    if (traffic) {
+        return ETX_INTERVAL_DOUBLINGS;
+    }
 
-            cur_round = 0;
-        }
+    return (beacon_interval < ETX_INTERVAL_DOUBLINGS) ?
+           beacon_interval + 1 : ETX_INTERVAL_DOUBLINGS;
+}
 
-        mutex_unlock(&etx_mutex);
+static void etx_beacon(work_t *work)
+{
+    etx_probe_t *packet = etx_get_send_buf();
+    uint8_t p_length = 0;
+    uint32_t interval;
+    uint32_t jitter;
+    uint32_t now;
+
+    mutex_lock(&etx_mutex);
+    now = etx_now_ms();
+    beacon_interval = etx_next_interval();
+
+    //Build etx packet, with the neighbors still sending beacons
+    for (uint8_t i = 0; (i < ETX_MAX_CANDIDATE_NEIGHBORS) &&
+         (p_length < ETX_BEST_CANDIDATES * ETX_TUPLE_SIZE); i++) {
+        if (candidates[i].used && !etx_beacons_stale(&candidates[i], now)) {
+            packet->data[p_length] =
+                candidates[i].addr.uint8[ETX_IPV6_LAST_BYTE];
+            packet->data[p_length + ETX_PKT_REC_OFFSET] =
+                etx_count_packet_tx(&candidates[i]);
+            p_length += ETX_TUPLE_SIZE;
+        }
     }
+
+    packet->length = p_length;
+    packet->seq = ++beacon_seq;
+    packet->interval = beacon_interval;
+    /* will be send broadcast, so if_id and destination address will be
+     * ignored (see documentation)
+     */
+    sixlowpan_mac_send_ieee802154_frame(0, NULL, 8, &etx_send_buf[0],
+                                        ETX_DATA_MAXLEN + ETX_PKT_HDR_LEN, 1,
+                                        TRANSCEIVER_TX_PRIO_CONTROL);
+    DEBUG("sent beacon %u, next in %lu ms\n", beacon_seq,
+          (unsigned long) etx_interval_ms(beacon_interval));
+    mutex_unlock(&etx_mutex);
+
+    /* anywhere within ETX_JITTER_PERCENT of the interval */
+    interval = etx_interval_ms(beacon_interval);
+    jitter = (interval * ETX_JITTER_PERCENT) / 100;
+    interval = interval - jitter + (uint32_t) rand() % (2 * jitter + 1);
+    workqueue_post_in(work, interval * MS);
 }
+#endif
 
 etx_neighbor_t *etx_find_candidate(ipv6_addr_t *address)
 {
@@ -225,56 +319,120 @@ etx_neighbor_t *etx_find_candidate(ipv6_addr_t *address)
     return NULL ;
 }
 
-void etx_clock(void)
+uint16_t etx_get_metric(ipv6_addr_t *address)
 {
-    /*
-     * Manages the etx_beacon thread to wake up every full second +- jitter
-     */
+    etx_neighbor_t *candidate = etx_find_candidate(address);
 
-    /*
-     * The jittercorrection and jitter variables keep usecond values divided
-     * through 1000 to fit into uint8 variables.
-     *
-     * That is why they are multiplied by 1000 when used for hwtimer_wait.
-     */
-    uint8_t jittercorrection = ETX_DEF_JIT_CORRECT;
-    uint8_t jitter = (uint8_t)(rand() % ETX_JITTER_MOD);
+    if (candidate != NULL) {
+        uint32_t now = etx_now_ms();
 
-    while (true) {
-        thread_wakeup(etx_beacon_pid);
+        if (!ETX_USE_BEACONS || etx_traffic_recent(candidate, now) ||
+            (!etx_beacons_stale(candidate, now) &&
+             (etx_count_packet_tx(candidate) > 0))) {
+            //this means the current etx_value is not outdated
+            return candidate->cur_etx;
+        }
+        else {
+            //The last time I received a packet is too long ago to give a
+            //good estimate of the etx value
+            return 0;
+        }
+    }
+
+    return 0;
+}
 
-        /*
-         * Vtimer is buggy, but I seem to have no hwtimers left, so using this
-         * for now.
-         */
-        vtimer_usleep(
-            ((ETX_INTERVAL - ETX_MAX_JITTER)*MS) + jittercorrection * MS + jitter * MS - ETX_CLOCK_ADJUST);
+/*
+ * Exponentially weighted moving average of the samples, the first sample
+ * is taken as it is.
+ */
+static void etx_add_sample(etx_neighbor_t *candidate, uint16_t sample)
+{
+    uint16_t old_etx = candidate->cur_etx;
 
-        //hwtimer_wait(
-        //        HWTIMER_TICKS(((ETX_INTERVAL - ETX_MAX_JITTER)*MS) + jittercorrection*MS + jitter*MS - ETX_CLOCK_ADJUST));
+    if (old_etx == 0) {
+        candidate->cur_etx = sample;
+    }
+    else {
+        candidate->cur_etx = old_etx + ((int32_t) sample - old_etx) /
+                             (1 << ETX_EWMA_SHIFT);
 
-        jittercorrection = (ETX_MAX_JITTER) - jitter;
-        jitter = (uint8_t)(rand() % ETX_JITTER_MOD);
+        if (abs((int32_t) candidate->cur_etx - old_etx) > ETX_CHANGE_THRESHOLD) {
+            etx_unstable = 1;
+        }
+    }
+
+    if ((candidate->cur_etx != old_etx) && (etx_change_handler != NULL)) {
+        etx_change_handler(&candidate->addr);
     }
 }
 
-double etx_get_metric(ipv6_addr_t *address)
+static etx_neighbor_t *etx_get_candidate(ipv6_addr_t *address)
 {
     etx_neighbor_t *candidate = etx_find_candidate(address);
 
+    if (candidate == NULL) {
+        candidate = etx_add_candidate(address);
+    }
+
+    return candidate;
+}
+
+void etx_tx_result(ipv6_addr_t *address, uint8_t transmissions)
+{
+    etx_neighbor_t *candidate;
+
+    mutex_lock(&etx_mutex);
+    candidate = etx_get_candidate(address);
+
     if (candidate != NULL) {
-        if (etx_count_packet_tx(candidate) > 0) {
-            //this means the current etx_value is not outdated
-            return candidate->cur_etx;
+        candidate->last_traffic = etx_now_ms();
+        etx_add_sample(candidate, (transmissions > 0) ?
+                       transmissions * ETX_SCALE : ETX_MAX_SAMPLE);
+    }
+
+    mutex_unlock(&etx_mutex);
+}
+
+void etx_rx_quality(ipv6_addr_t *address, uint8_t lqi)
+{
+    etx_neighbor_t *candidate;
+
+    mutex_lock(&etx_mutex);
+    candidate = etx_get_candidate(address);
+
+    /* only a first guess, the transmissions know better */
+    if ((candidate != NULL) && (candidate->cur_etx == 0)) {
+        etx_add_sample(candidate, (lqi >= ETX_LQI_GOOD) ?
+                       ETX_SCALE : ETX_GUESS_POOR);
+    }
+
+    mutex_unlock(&etx_mutex);
+}
+
+/* the worst link of a full table, NULL if all are good enough to keep */
+static etx_neighbor_t *etx_candidate_victim(void)
+{
+    etx_neighbor_t *victim = NULL;
+
+    for (uint8_t i = 0; i < ETX_MAX_CANDIDATE_NEIGHBORS; i++) {
+        etx_neighbor_t *candidate = &candidates[i];
+
+        if (candidate->cur_etx == 0) {
+            //No estimate at all, nothing to lose
+            return candidate;
         }
-        else {
-            //The last time I received a packet is too long ago to give a
-            //good estimate of the etx value
-            return 0;
+
+        if ((victim == NULL) || (candidate->cur_etx > victim->cur_etx)) {
+            victim = candidate;
         }
     }
 
-    return 0;
+    if ((victim != NULL) && (victim->cur_etx <= ETX_GUESS_POOR)) {
+        return NULL;
+    }
+
+    return victim;
 }
 
 etx_neighbor_t *etx_add_candidate(ipv6_addr_t *address)
@@ -286,43 +444,45 @@ etx_neighbor_t *etx_add_candidate(ipv6_addr_t *address)
      *                  Otherwise the candidate will be added a second time,
      *                  leading to unknown behavior.
      *
-     *      Check if there is still enough space to add this candidate
-     *
-     *      a)
-     *          Space is available:
-     *              Add candidate
-     *
-     *      b)
-     *          Space is not available:
-     *              ignore new candidate
-     *              This shouldn't really happen though, since we have enough
-     *              place in the array.
+     * A full table gives up its worst link for the new candidate, see
+     * ETX_MAX_CANDIDATE_NEIGHBORS.
      *
      * Returns the pointer to the candidate if it was added, or a NULL-pointer
      * otherwise.
      */
-    etx_neighbor_t *candidate;
-    etx_neighbor_t *end;
+    etx_neighbor_t *candidate = NULL;
 
-    for (candidate = &candidates[0], end = candidates
-                                           + ETX_MAX_CANDIDATE_NEIGHBORS; candidate < end;
-         candidate++) {
-        if (candidate->used) {
-            //skip
-            continue;
+    for (uint8_t i = 0; i < ETX_MAX_CANDIDATE_NEIGHBORS; i++) {
+        if (!candidates[i].used) {
+            candidate = &candidates[i];
+            break;
         }
-        else {
-            //We still have a free place add the new candidate
-            memset(candidate, 0, sizeof(*candidate));
-            candidate->addr = *address;
-            candidate->cur_etx = 0;
-            candidate->packets_rx = 0;
-            candidate->used = 1;
-            return candidate;
+    }
+
+    if (candidate == NULL) {
+        ipv6_addr_t evicted;
+
+        candidate = etx_candidate_victim();
+
+        if (candidate == NULL) {
+            return NULL;
+        }
+
+        DEBUG("evict candidate %d\n", candidate->addr.uint8[ETX_IPV6_LAST_BYTE]);
+        evicted = candidate->addr;
+        candidate->used = 0;
+
+        if (etx_change_handler != NULL) {
+            //Its metric is unknown from now on
+            etx_change_handler(&evicted);
         }
     }
 
-    return NULL ;
+    memset(candidate, 0, sizeof(*candidate));
+    candidate->addr = *address;
+    candidate->used = 1;
+    etx_unstable = 1;
+    return candidate;
 }
 
 void etx_handle_beacon(ipv6_addr_t *candidate_address)
@@ -340,25 +500,47 @@ void etx_handle_beacon(ipv6_addr_t *candidate_address)
         candidate_address->uint8[ETX_IPV6_LAST_BYTE]);
 
     etx_neighbor_t *candidate = etx_find_candidate(candidate_address);
+    etx_probe_t *rec_pkt = etx_get_rec_buf();
 
     if (candidate == NULL) {
         //Candidate was not found in my list, I should add it
         candidate = etx_add_candidate(candidate_address);
 
         if (candidate == NULL) {
-            puts("[ERROR] Candidate could not get added");
-            puts("Increase the constant ETX_MAX_CANDIDATE_NEIHGBORS");
+            DEBUG("Candidate could not get added, table full of good links\n");
             return;
         }
     }
 
-    //I have received 1 packet from this candidate in this round
-    //This value will be reset by etx_update to 0
-    candidate->tx_cur_round = 1;
+    //Shift the beacons it sent since the last one I got into the window
+    if (candidate->span == 0) {
+        candidate->rx_bits = 1;
+        candidate->span = 1;
+    }
+    else {
+        uint8_t gap = rec_pkt->seq - candidate->last_seq;
+
+        if (gap == 0) {
+            //A duplicate
+            return;
+        }
+
+        candidate->rx_bits = (gap < 16) ? (candidate->rx_bits << gap) | 1 : 1;
+        candidate->span = (candidate->span + gap < ETX_WINDOW) ?
+                          candidate->span + gap : ETX_WINDOW;
+    }
+
+    candidate->rx_bits &= (1 << ETX_WINDOW) - 1;
+    candidate->last_seq = rec_pkt->seq;
+    candidate->interval = (rec_pkt->interval <= ETX_INTERVAL_DOUBLINGS) ?
+                          rec_pkt->interval : ETX_INTERVAL_DOUBLINGS;
+    candidate->last_beacon = etx_now_ms();
 
     // If i find my address in this probe, update the packet_rx value for
     // this candidate.
-    etx_probe_t *rec_pkt = etx_get_rec_buf();
+    if (rec_pkt->length > ETX_DATA_MAXLEN) {
+        rec_pkt->length = ETX_DATA_MAXLEN;
+    }
 
     for (uint8_t i = 0; i < rec_pkt->length / ETX_TUPLE_SIZE; i++) {
         DEBUG("\tIPv6 short Addr:%u\n"
@@ -400,9 +582,13 @@ void etx_radio(void)
 
             ieee802154_frame_read(p->data, &frame, p->length);
 
-            if (frame.payload[0] == ETX_PKT_OPTVAL) {
+            if ((frame.payload[0] == ETX_PKT_OPTVAL) &&
+                (frame.payload_len >= ETX_PKT_HDR_LEN)) {
                 //copy to receive buffer
-                memcpy(etx_rec_buf, &frame.payload[0], frame.payload_len);
+                memset(etx_rec_buf, 0, sizeof(etx_rec_buf));
+                memcpy(etx_rec_buf, &frame.payload[0],
+                       (frame.payload_len < ETX_BUF_SIZE) ?
+                       frame.payload_len : ETX_BUF_SIZE);
 
                 //create IPv6 address from radio packet
                 //we can do the cast here since rpl nodes can only have addr
@@ -414,7 +600,7 @@ void etx_radio(void)
                 mutex_unlock(&etx_mutex);
             }
 
-            p->processing--;
+            transceiver_release(p);
         }
         else if (m.type == ENOBUFFER) {
             puts("Transceiver buffer full");
@@ -431,108 +617,69 @@ void etx_update(etx_neighbor_t *candidate)
     /*
      * Update the current ETX value of a candidate
      */
-    double d_f;
-    double d_r;
+    uint8_t d_f;
+    uint8_t d_r;
 
-    if (reached_window != 1 || candidate == NULL) {
+    if (candidate == NULL || candidate->span < ETX_WINDOW) {
         //We will wait at least ETX_WINDOW beacons until we decide to
         //calculate an ETX value, so that we have a good estimate
         return;
     }
 
     /*
-     * Calculate d_f (the forward PDR) from ME to this candidate.
+     * d_f (the forward PDR) from ME to this candidate and d_r (the backwards
+     * PDR) from this candidate to ME, both in packets per ETX_WINDOW.
      */
-    d_f = candidate->packets_rx / (double) ETX_WINDOW;
+    d_f = candidate->packets_rx;
+    d_r = etx_count_packet_tx(candidate);
 
     /*
-     * Calculate d_r (the backwards PDR) from this candidate to ME
+     * Sample the ETX value for my link to this candidate, 1 / (d_f * d_r).
      */
-    d_r = etx_count_packet_tx(candidate) / (double) ETX_WINDOW;
+    if ((d_f != 0) && (d_r != 0)) {
+        uint32_t sample = ((uint32_t) ETX_SCALE * ETX_WINDOW * ETX_WINDOW) /
+                          ((uint32_t) d_f * d_r);
 
-    /*
-     * Calculate the current ETX value for my link to this candidate.
-     */
-    if (d_f * d_r != 0) {
-        candidate->cur_etx = 1 / (d_f * d_r);
+        etx_add_sample(candidate, (sample < ETX_MAX_SAMPLE) ?
+                       sample : ETX_MAX_SAMPLE);
     }
     else {
-        candidate->cur_etx = 0;
+        etx_add_sample(candidate, ETX_MAX_SAMPLE);
     }
 
     DEBUG(
-        "Estimated ETX Metric  is %f for candidate w/ addr %d\n"
-        "Estimated PDR_forward is %f\n"
-        "Estimated PDR_backwrd is %f\n"
+        "Estimated ETX Metric  is %u/%u for candidate w/ addr %d\n"
+        "Estimated PDR_forward is %u/%u\n"
+        "Estimated PDR_backwrd is %u/%u\n"
         "\n"
         "Received Packets: %d\n"
         "Sent Packets    : %d\n\n",
-        candidate->cur_etx, candidate->addr.uint8[ETX_IPV6_LAST_BYTE],
-        d_f, d_r, candidate->packets_rx, etx_count_packet_tx(candidate));
+        candidate->cur_etx, ETX_SCALE, candidate->addr.uint8[ETX_IPV6_LAST_BYTE],
+        d_f, ETX_WINDOW, d_r, ETX_WINDOW, candidate->packets_rx,
+        etx_count_packet_tx(candidate));
+}
+
+void etx_set_change_handler(void (*handler)(ipv6_addr_t *address))
+{
+    etx_change_handler = handler;
 }
 
 static uint8_t etx_count_packet_tx(etx_neighbor_t *candidate)
 {
     /*
-     *  Counts the number of packets that were received for this candidate
-     *  in the last ETX_WINDOW intervals.
+     *  Counts the beacons that were received from this candidate out of
+     *  its last ETX_WINDOW ones.
      */
-    DEBUG("counting packets");
     uint8_t pkt_count = 0;
-    DEBUG("[");
-
-    for (uint8_t i = 0; i < ETX_WINDOW; i++) {
-        if (i != cur_round) {
-            pkt_count = pkt_count + candidate->packets_tx[i];
-            DEBUG("%d", candidate->packets_tx[i]);
 
-            if (i < ETX_WINDOW - 1) {
-                DEBUG(",");
-            }
-        }
-        else {
-            //Check if I received something for the current round
-            if (candidate->tx_cur_round == 0) {
-                //Didn't receive a packet, zero the field and don't add
-                candidate->packets_tx[i] = 0;
-                DEBUG("%d!", candidate->packets_tx[i]);
-
-                if (i < ETX_WINDOW - 1) {
-                    DEBUG(",");
-                }
-            }
-            else {
-                //Add 1 and set field
-                pkt_count = pkt_count + 1;
-                candidate->packets_tx[i] = 1;
-                DEBUG("%d!", candidate->packets_tx[i]);
-
-                if (i < ETX_WINDOW - 1) {
-                    DEBUG(",");
-                }
-            }
-        }
+    for (uint16_t bits = candidate->rx_bits; bits != 0; bits &= bits - 1) {
+        pkt_count++;
     }
 
-    DEBUG("]\n");
+    DEBUG("counted %u of %u packets\n", pkt_count, candidate->span);
     return pkt_count;
 }
 
-static void etx_set_packets_received(void)
-{
-    /*
-     * Set for all candidates if they received a packet this round or not
-     */
-    for (uint8_t i = 0; i < ETX_MAX_CANDIDATE_NEIGHBORS; i++) {
-        if (candidates[i].used) {
-            if (candidates[i].tx_cur_round != 0) {
-                candidates[i].packets_tx[cur_round] = 1;
-                candidates[i].tx_cur_round = 0;
-            }
-        }
-    }
-}
-
 bool etx_equal_id(ipv6_addr_t *id1, ipv6_addr_t *id2)
 {
     for (uint8_t i = 0; i < 4; i++) {
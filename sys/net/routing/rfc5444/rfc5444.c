@@ -0,0 +1,729 @@
+/*
+ * RFC 5444 reader and writer
+ *
+ * Copyright (C) 2014  Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup net_rfc5444
+ * @{
+ * @file    rfc5444.c
+ * @brief   Packets read in place and written into buffers of the caller
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rfc5444.h"
+
+#define PKT_VERSION             (0)
+#define PKT_HAS_SEQNUM          (0x08)
+#define PKT_HAS_TLV             (0x04)
+
+#define MSG_HDR_LEN             (4)
+#define MSG_HAS_ORIG            (0x08)
+#define MSG_HAS_HOP_LIMIT       (0x04)
+#define MSG_HAS_HOP_COUNT       (0x02)
+#define MSG_HAS_SEQNUM          (0x01)
+
+#define ADDR_HAS_HEAD           (0x80)
+#define ADDR_HAS_FULL_TAIL      (0x40)
+#define ADDR_HAS_ZERO_TAIL      (0x20)
+#define ADDR_HAS_SINGLE_PRELEN  (0x10)
+#define ADDR_HAS_MULTI_PRELEN   (0x08)
+
+#define TLV_HAS_TYPE_EXT        (0x80)
+#define TLV_HAS_SINGLE_INDEX    (0x40)
+#define TLV_HAS_MULTI_INDEX     (0x20)
+#define TLV_HAS_VALUE           (0x10)
+#define TLV_HAS_EXT_LEN         (0x08)
+#define TLV_IS_MULTIVALUE       (0x04)
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* reads the TLV block at *p* and moves *p* behind it */
+static int tlvs_read(rfc5444_tlvs_t *tlvs, const uint8_t **p,
+                     const uint8_t *end, uint8_t num_addr)
+{
+    uint16_t len;
+
+    if (end - *p < 2) {
+        return -1;
+    }
+
+    len = get16(*p);
+
+    if (len > end - *p - 2) {
+        return -1;
+    }
+
+    tlvs->pos = *p + 2;
+    tlvs->end = tlvs->pos + len;
+    tlvs->num_addr = num_addr;
+    *p = tlvs->end;
+    return 0;
+}
+
+int rfc5444_packet_parse(rfc5444_packet_t *pkt, const uint8_t *buf,
+                         uint16_t len)
+{
+    const uint8_t *end = buf + len;
+    const uint8_t *p = buf + 1;
+
+    memset(pkt, 0, sizeof(*pkt));
+
+    if ((len < 1) || ((buf[0] >> 4) != PKT_VERSION)) {
+        return -1;
+    }
+
+    if (buf[0] & PKT_HAS_SEQNUM) {
+        if (end - p < 2) {
+            return -1;
+        }
+
+        pkt->has_seqnum = 1;
+        pkt->seqnum = get16(p);
+        p += 2;
+    }
+
+    if (buf[0] & PKT_HAS_TLV) {
+        if (tlvs_read(&pkt->tlvs, &p, end, 0) < 0) {
+            return -1;
+        }
+    }
+    else {
+        pkt->tlvs.pos = p;
+        pkt->tlvs.end = p;
+    }
+
+    pkt->pos = p;
+    pkt->end = end;
+    return 0;
+}
+
+int rfc5444_msg_next(rfc5444_packet_t *pkt, rfc5444_msg_t *msg)
+{
+    const uint8_t *p = pkt->pos;
+    const uint8_t *end;
+    uint8_t flags;
+    uint16_t size;
+
+    if (p >= pkt->end) {
+        return 0;
+    }
+
+    if (pkt->end - p < MSG_HDR_LEN) {
+        return -1;
+    }
+
+    size = get16(&p[2]);
+
+    if ((size < MSG_HDR_LEN) || (size > pkt->end - p)) {
+        return -1;
+    }
+
+    end = p + size;
+    /* the next one can be read even if this one is broken */
+    pkt->pos = end;
+
+    msg->type = p[0];
+    flags = p[1] >> 4;
+    msg->addr_len = (p[1] & 0x0f) + 1;
+    msg->buf = p;
+    msg->len = size;
+    msg->orig = NULL;
+    msg->hop_limit = -1;
+    msg->hop_count = -1;
+    msg->seqnum = -1;
+    p += MSG_HDR_LEN;
+
+    if (flags & MSG_HAS_ORIG) {
+        if (end - p < msg->addr_len) {
+            return -1;
+        }
+
+        msg->orig = p;
+        p += msg->addr_len;
+    }
+
+    if (flags & MSG_HAS_HOP_LIMIT) {
+        if (end - p < 1) {
+            return -1;
+        }
+
+        msg->hop_limit = *p++;
+    }
+
+    if (flags & MSG_HAS_HOP_COUNT) {
+        if (end - p < 1) {
+            return -1;
+        }
+
+        msg->hop_count = *p++;
+    }
+
+    if (flags & MSG_HAS_SEQNUM) {
+        if (end - p < 2) {
+            return -1;
+        }
+
+        msg->seqnum = get16(p);
+        p += 2;
+    }
+
+    if (tlvs_read(&msg->tlvs, &p, end, 0) < 0) {
+        return -1;
+    }
+
+    msg->pos = p;
+    return 1;
+}
+
+int rfc5444_addrblock_next(rfc5444_msg_t *msg, rfc5444_addrblock_t *ab)
+{
+    const uint8_t *end = msg->buf + msg->len;
+    const uint8_t *p = msg->pos;
+    uint8_t flags;
+
+    if (p >= end) {
+        return 0;
+    }
+
+    if (end - p < 2) {
+        return -1;
+    }
+
+    memset(ab, 0, sizeof(*ab));
+    ab->num = p[0];
+    ab->addr_len = msg->addr_len;
+    flags = p[1];
+    p += 2;
+
+    if ((ab->num == 0) ||
+        ((flags & ADDR_HAS_FULL_TAIL) && (flags & ADDR_HAS_ZERO_TAIL)) ||
+        ((flags & ADDR_HAS_SINGLE_PRELEN) && (flags & ADDR_HAS_MULTI_PRELEN))) {
+        return -1;
+    }
+
+    if (flags & ADDR_HAS_HEAD) {
+        if ((end - p < 1) || (end - p - 1 < p[0])) {
+            return -1;
+        }
+
+        ab->head_len = p[0];
+        ab->head = p + 1;
+        p += 1 + ab->head_len;
+    }
+
+    if (flags & (ADDR_HAS_FULL_TAIL | ADDR_HAS_ZERO_TAIL)) {
+        if (end - p < 1) {
+            return -1;
+        }
+
+        ab->tail_len = *p++;
+
+        if (flags & ADDR_HAS_FULL_TAIL) {
+            if (end - p < ab->tail_len) {
+                return -1;
+            }
+
+            ab->tail = p;
+            p += ab->tail_len;
+        }
+    }
+
+    if (ab->head_len + ab->tail_len > ab->addr_len) {
+        return -1;
+    }
+
+    ab->mid_len = ab->addr_len - ab->head_len - ab->tail_len;
+
+    if (end - p < ab->mid_len * ab->num) {
+        return -1;
+    }
+
+    ab->mid = p;
+    p += ab->mid_len * ab->num;
+
+    if (flags & (ADDR_HAS_SINGLE_PRELEN | ADDR_HAS_MULTI_PRELEN)) {
+        uint8_t n = (flags & ADDR_HAS_MULTI_PRELEN) ? ab->num : 1;
+
+        if (end - p < n) {
+            return -1;
+        }
+
+        ab->prefix_lens = p;
+        ab->multi_prefix = (n > 1) || (flags & ADDR_HAS_MULTI_PRELEN);
+        p += n;
+    }
+
+    if (tlvs_read(&ab->tlvs, &p, end, ab->num) < 0) {
+        return -1;
+    }
+
+    msg->pos = p;
+    return 1;
+}
+
+int rfc5444_tlv_next(rfc5444_tlvs_t *tlvs, rfc5444_tlv_t *tlv)
+{
+    const uint8_t *p = tlvs->pos;
+    const uint8_t *end = tlvs->end;
+    uint8_t flags;
+
+    if (p >= end) {
+        return 0;
+    }
+
+    if (end - p < 2) {
+        return -1;
+    }
+
+    tlv->type = p[0];
+    flags = p[1];
+    p += 2;
+
+    tlv->type_ext = 0;
+    tlv->index_start = 0;
+    tlv->index_stop = (tlvs->num_addr > 0) ? tlvs->num_addr - 1 : 0;
+    tlv->multivalue = 0;
+    tlv->len = 0;
+    tlv->value = NULL;
+
+    if (flags & TLV_HAS_TYPE_EXT) {
+        if (end - p < 1) {
+            return -1;
+        }
+
+        tlv->type_ext = *p++;
+    }
+
+    if ((flags & TLV_HAS_SINGLE_INDEX) && (flags & TLV_HAS_MULTI_INDEX)) {
+        return -1;
+    }
+
+    if (flags & TLV_HAS_SINGLE_INDEX) {
+        if (end - p < 1) {
+            return -1;
+        }
+
+        tlv->index_start = tlv->index_stop = *p++;
+    }
+    else if (flags & TLV_HAS_MULTI_INDEX) {
+        if (end - p < 2) {
+            return -1;
+        }
+
+        tlv->index_start = p[0];
+        tlv->index_stop = p[1];
+        p += 2;
+    }
+
+    if ((flags & (TLV_HAS_SINGLE_INDEX | TLV_HAS_MULTI_INDEX)) &&
+        ((tlv->index_start > tlv->index_stop) ||
+         (tlv->index_stop >= tlvs->num_addr))) {
+        return -1;
+    }
+
+    if (flags & TLV_HAS_VALUE) {
+        uint8_t ext = (flags & TLV_HAS_EXT_LEN) ? 2 : 1;
+
+        if (end - p < ext) {
+            return -1;
+        }
+
+        tlv->len = (ext == 2) ? get16(p) : p[0];
+        p += ext;
+
+        if (end - p < tlv->len) {
+            return -1;
+        }
+
+        tlv->value = p;
+        p += tlv->len;
+
+        if ((flags & TLV_IS_MULTIVALUE) && (flags & TLV_HAS_MULTI_INDEX)) {
+            /* each address gets an equal share */
+            if (tlv->len % (tlv->index_stop - tlv->index_start + 1)) {
+                return -1;
+            }
+
+            tlv->multivalue = 1;
+        }
+    }
+
+    tlvs->pos = p;
+    return 1;
+}
+
+const uint8_t *rfc5444_tlv_value(const rfc5444_tlv_t *tlv, uint8_t index,
+                                 uint16_t *len)
+{
+    *len = 0;
+
+    if ((index < tlv->index_start) || (index > tlv->index_stop) ||
+        (tlv->value == NULL)) {
+        return NULL;
+    }
+
+    if (!tlv->multivalue) {
+        *len = tlv->len;
+        return tlv->value;
+    }
+
+    *len = tlv->len / (tlv->index_stop - tlv->index_start + 1);
+    return tlv->value + (index - tlv->index_start) * (*len);
+}
+
+int rfc5444_addr_get(const rfc5444_addrblock_t *ab, uint8_t index,
+                     uint8_t *addr, uint8_t *prefix_len)
+{
+    if (index >= ab->num) {
+        return -1;
+    }
+
+    memcpy(addr, ab->head, ab->head_len);
+    memcpy(addr + ab->head_len, ab->mid + index * ab->mid_len, ab->mid_len);
+
+    if (ab->tail != NULL) {
+        memcpy(addr + ab->head_len + ab->mid_len, ab->tail, ab->tail_len);
+    }
+    else {
+        memset(addr + ab->head_len + ab->mid_len, 0, ab->tail_len);
+    }
+
+    if (prefix_len != NULL) {
+        if (ab->prefix_lens == NULL) {
+            *prefix_len = ab->addr_len * 8;
+        }
+        else {
+            *prefix_len = ab->prefix_lens[ab->multi_prefix ? index : 0];
+        }
+    }
+
+    return 0;
+}
+
+static void put(rfc5444_writer_t *w, const void *data, uint16_t len)
+{
+    if (w->err || (len > w->size - w->len)) {
+        w->err = 1;
+        return;
+    }
+
+    if (data != NULL) {
+        memcpy(&w->buf[w->len], data, len);
+    }
+    else {
+        memset(&w->buf[w->len], 0, len);
+    }
+
+    w->len += len;
+}
+
+static void put8(rfc5444_writer_t *w, uint8_t v)
+{
+    put(w, &v, 1);
+}
+
+static void put16(rfc5444_writer_t *w, uint16_t v)
+{
+    uint8_t b[2] = { v >> 8, v & 0xff };
+
+    put(w, b, 2);
+}
+
+static void set16(rfc5444_writer_t *w, uint16_t pos, uint16_t v)
+{
+    if (!w->err) {
+        w->buf[pos] = v >> 8;
+        w->buf[pos + 1] = v & 0xff;
+    }
+}
+
+static void tlvs_begin(rfc5444_writer_t *w)
+{
+    w->tlvs_start = w->len;
+    put16(w, 0);
+}
+
+static void tlvs_end(rfc5444_writer_t *w)
+{
+    if (w->tlvs_start != 0) {
+        set16(w, w->tlvs_start, w->len - w->tlvs_start - 2);
+        w->tlvs_start = 0;
+    }
+}
+
+void rfc5444_writer_init(rfc5444_writer_t *w, uint8_t *buf, uint16_t size)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->size = size;
+}
+
+void rfc5444_write_pkt(rfc5444_writer_t *w, const uint16_t *seqnum, int tlvs)
+{
+    if (w->len != 0) {
+        w->err = 1;
+        return;
+    }
+
+    put8(w, (PKT_VERSION << 4) | (seqnum ? PKT_HAS_SEQNUM : 0) |
+         (tlvs ? PKT_HAS_TLV : 0));
+
+    if (seqnum != NULL) {
+        put16(w, *seqnum);
+    }
+
+    if (tlvs) {
+        tlvs_begin(w);
+    }
+}
+
+void rfc5444_write_msg(rfc5444_writer_t *w, uint8_t type, uint8_t addr_len,
+                       const uint8_t *orig, int hop_limit, int hop_count,
+                       int32_t seqnum)
+{
+    uint8_t flags = (orig ? MSG_HAS_ORIG : 0) |
+                    ((hop_limit >= 0) ? MSG_HAS_HOP_LIMIT : 0) |
+                    ((hop_count >= 0) ? MSG_HAS_HOP_COUNT : 0) |
+                    ((seqnum >= 0) ? MSG_HAS_SEQNUM : 0);
+
+    if ((w->len == 0) || (w->msg_start != 0) || (addr_len == 0) ||
+        (addr_len > RFC5444_ADDR_MAX)) {
+        w->err = 1;
+        return;
+    }
+
+    /* the packet TLVs end here */
+    tlvs_end(w);
+
+    w->msg_start = w->len;
+    w->addr_len = addr_len;
+    put8(w, type);
+    put8(w, (flags << 4) | (addr_len - 1));
+    put16(w, 0);
+
+    if (orig != NULL) {
+        put(w, orig, addr_len);
+    }
+
+    if (hop_limit >= 0) {
+        put8(w, hop_limit);
+    }
+
+    if (hop_count >= 0) {
+        put8(w, hop_count);
+    }
+
+    if (seqnum >= 0) {
+        put16(w, seqnum);
+    }
+
+    w->num_addr = 0;
+    tlvs_begin(w);
+}
+
+static void write_tlv(rfc5444_writer_t *w, uint8_t type, uint8_t type_ext,
+                      uint8_t flags, uint8_t start, uint8_t stop,
+                      const void *value, uint16_t len)
+{
+    if (w->tlvs_start == 0) {
+        w->err = 1;
+        return;
+    }
+
+    flags |= (type_ext ? TLV_HAS_TYPE_EXT : 0);
+
+    if (len > 0) {
+        flags |= TLV_HAS_VALUE | ((len > 0xff) ? TLV_HAS_EXT_LEN : 0);
+    }
+    else {
+        flags &= ~TLV_IS_MULTIVALUE;
+    }
+
+    put8(w, type);
+    put8(w, flags);
+
+    if (type_ext) {
+        put8(w, type_ext);
+    }
+
+    if (flags & TLV_HAS_SINGLE_INDEX) {
+        put8(w, start);
+    }
+    else if (flags & TLV_HAS_MULTI_INDEX) {
+        put8(w, start);
+        put8(w, stop);
+    }
+
+    if (len > 0xff) {
+        put16(w, len);
+    }
+    else if (len > 0) {
+        put8(w, len);
+    }
+
+    put(w, value, len);
+}
+
+void rfc5444_write_tlv(rfc5444_writer_t *w, uint8_t type, uint8_t type_ext,
+                       const void *value, uint16_t len)
+{
+    write_tlv(w, type, type_ext, 0, 0, 0, value, len);
+}
+
+void rfc5444_write_tlv_index(rfc5444_writer_t *w, uint8_t type,
+                             uint8_t type_ext, uint8_t start, uint8_t stop,
+                             const void *value, uint16_t len, int multivalue)
+{
+    uint8_t flags;
+
+    if ((start > stop) || (stop >= w->num_addr) ||
+        (multivalue && (len % (stop - start + 1)))) {
+        w->err = 1;
+        return;
+    }
+
+    if ((start == 0) && (stop == w->num_addr - 1) && !multivalue) {
+        /* no index is needed for all addresses */
+        flags = 0;
+    }
+    else if (start == stop) {
+        flags = TLV_HAS_SINGLE_INDEX;
+    }
+    else {
+        flags = TLV_HAS_MULTI_INDEX | (multivalue ? TLV_IS_MULTIVALUE : 0);
+    }
+
+    write_tlv(w, type, type_ext, flags, start, stop, value, len);
+}
+
+void rfc5444_write_addrs(rfc5444_writer_t *w, const uint8_t *addrs,
+                         uint8_t num, const uint8_t *prefix_lens)
+{
+    uint8_t len = w->addr_len;
+    uint8_t head = 0, tail = 0, mid, flags = 0;
+    int zero_tail = 1, single_prefix = 1;
+
+    if ((w->msg_start == 0) || (num == 0)) {
+        w->err = 1;
+        return;
+    }
+
+    /* the TLVs of the message or of the address block before end here */
+    tlvs_end(w);
+
+    if (num > 1) {
+        /* the bytes all addresses share, at least one is left in the mid */
+        while ((head < len - 1) && (head < 255)) {
+            uint8_t i;
+
+            for (i = 1; (i < num) && (addrs[i * len + head] == addrs[head]); i++);
+
+            if (i < num) {
+                break;
+            }
+
+            head++;
+        }
+
+        while (tail < len - head - 1) {
+            uint8_t pos = len - 1 - tail;
+            uint8_t i;
+
+            for (i = 1; (i < num) && (addrs[i * len + pos] == addrs[pos]); i++);
+
+            if (i < num) {
+                break;
+            }
+
+            tail++;
+        }
+    }
+
+    for (uint8_t i = 0; i < tail; i++) {
+        if (addrs[len - 1 - i] != 0) {
+            zero_tail = 0;
+        }
+    }
+
+    for (uint8_t i = 1; (prefix_lens != NULL) && (i < num); i++) {
+        if (prefix_lens[i] != prefix_lens[0]) {
+            single_prefix = 0;
+        }
+    }
+
+    mid = len - head - tail;
+
+    if (head > 0) {
+        flags |= ADDR_HAS_HEAD;
+    }
+
+    if (tail > 0) {
+        flags |= zero_tail ? ADDR_HAS_ZERO_TAIL : ADDR_HAS_FULL_TAIL;
+    }
+
+    if (prefix_lens != NULL) {
+        flags |= single_prefix ? ADDR_HAS_SINGLE_PRELEN : ADDR_HAS_MULTI_PRELEN;
+    }
+
+    put8(w, num);
+    put8(w, flags);
+
+    if (head > 0) {
+        put8(w, head);
+        put(w, addrs, head);
+    }
+
+    if (tail > 0) {
+        put8(w, tail);
+
+        if (!zero_tail) {
+            put(w, &addrs[len - tail], tail);
+        }
+    }
+
+    for (uint8_t i = 0; i < num; i++) {
+        put(w, &addrs[i * len + head], mid);
+    }
+
+    if (prefix_lens != NULL) {
+        put(w, prefix_lens, single_prefix ? 1 : num);
+    }
+
+    w->num_addr = num;
+    tlvs_begin(w);
+}
+
+void rfc5444_write_msg_end(rfc5444_writer_t *w)
+{
+    if (w->msg_start == 0) {
+        w->err = 1;
+        return;
+    }
+
+    tlvs_end(w);
+    set16(w, w->msg_start + 2, w->len - w->msg_start);
+    w->msg_start = 0;
+    w->num_addr = 0;
+}
+
+int rfc5444_write_end(rfc5444_writer_t *w)
+{
+    if ((w->len == 0) || (w->msg_start != 0)) {
+        w->err = 1;
+    }
+
+    /* packet TLVs without a message */
+    tlvs_end(w);
+
+    return w->err ? -1 : w->len;
+}
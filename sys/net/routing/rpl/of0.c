@@ -72,14 +72,17 @@ uint16_t calc_rank(rpl_parent_t *parent, uint16_t base_rank)
     return base_rank + add;
 }
 
-/* We simply return the Parent with lower rank */
+/* We simply return the Parent with lower rank, on a tie the preferred one */
 rpl_parent_t *which_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
     if (p1->rank < p2->rank) {
         return p1;
     }
+    else if (p2->rank < p1->rank) {
+        return p2;
+    }
 
-    return p2;
+    return (p1 == p1->dodag->my_preferred_parent) ? p1 : p2;
 }
 
 /* Not used yet, as the implementation only makes use of one dodag for now. */
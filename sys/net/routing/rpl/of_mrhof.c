@@ -20,15 +20,16 @@
 
 #include "etx_beaconing.h"
 
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
 // Function Prototypes
 static uint16_t calc_rank(rpl_parent_t *, uint16_t);
 static rpl_parent_t *which_parent(rpl_parent_t *, rpl_parent_t *);
 static rpl_dodag_t *which_dodag(rpl_dodag_t *, rpl_dodag_t *);
 static void reset(rpl_dodag_t *);
 static uint16_t calc_path_cost(rpl_parent_t *parent);
-
-uint16_t cur_min_path_cost = MAX_PATH_COST;
-rpl_parent_t *cur_preferred_parent = NULL;
+static uint16_t get_path_cost(rpl_parent_t *parent);
 
 rpl_of_t rpl_of_mrhof = {
     0x1,
@@ -51,9 +52,28 @@ void reset(rpl_dodag_t *dodag)
     (void) dodag;
 }
 
+/*
+ * Path costs are cached in the parent until its rank or the ETX to it
+ * changes, so choosing a parent on every DIO does not search the ETX
+ * candidates again.
+ */
+static uint16_t get_path_cost(rpl_parent_t *parent)
+{
+    if (parent == NULL) {
+        return calc_path_cost(parent);
+    }
+
+    if (!parent->path_cost_valid) {
+        parent->path_cost = calc_path_cost(parent);
+        parent->path_cost_valid = 1;
+    }
+
+    return parent->path_cost;
+}
+
 static uint16_t calc_path_cost(rpl_parent_t *parent)
 {
-    puts("calc_pathcost");
+    DEBUG("calc_pathcost\n");
 
     /*
      * Calculates the path cost through the parent, for now, only for ETX
@@ -65,10 +85,13 @@ static uint16_t calc_path_cost(rpl_parent_t *parent)
         return DEFAULT_MIN_HOP_RANK_INCREASE;
     }
 
-    double etx_value = etx_get_metric(&(parent->addr));
-    printf("Metric for parent returned: %f", etx_value);
+    uint16_t etx_value = etx_get_metric(&(parent->addr));
+    DEBUG("Metric for parent returned: %u\n", etx_value);
 
     if (etx_value != 0) {
+        uint32_t link_metric = ((uint32_t) etx_value * ETX_RANK_MULTIPLIER) /
+                               ETX_SCALE;
+
         /*
          * (ETX_for_link_to_neighbor * 128) + Rank_of_that_neighbor
          *
@@ -78,20 +101,17 @@ static uint16_t calc_path_cost(rpl_parent_t *parent)
          * from me to that neighbor
          *
          */
-        if (etx_value * ETX_RANK_MULTIPLIER > MAX_LINK_METRIC) {
+        if (link_metric > MAX_LINK_METRIC) {
             // Disallow links with an estimated ETX of 4 or higher
             return MAX_PATH_COST;
         }
 
-        if (etx_value * ETX_RANK_MULTIPLIER + parent->rank
-            < parent->rank) {
+        if (link_metric + parent->rank > MAX_PATH_COST) {
             //Overflow
             return MAX_PATH_COST;
         }
 
-        //TODO runden
-        return etx_value * ETX_RANK_MULTIPLIER
-               + parent->rank;
+        return link_metric + parent->rank;
     }
     else {
         // IMPLEMENT HANDLING OF OTHER METRICS HERE
@@ -103,7 +123,7 @@ static uint16_t calc_path_cost(rpl_parent_t *parent)
 
 static uint16_t calc_rank(rpl_parent_t *parent, uint16_t base_rank)
 {
-    puts("calc_rank");
+    DEBUG("calc_rank\n");
 
     /*
      * Return the rank for this node.
@@ -132,7 +152,7 @@ static uint16_t calc_rank(rpl_parent_t *parent, uint16_t base_rank)
          * the parent and choose the maximum of that value and the advertised
          * rank of the parent + minhoprankincrease for our rank.
          */
-        uint16_t calculated_pcost = calc_path_cost(parent);
+        uint16_t calculated_pcost = get_path_cost(parent);
 
         if (calculated_pcost < MAX_PATH_COST) {
             if ((parent->rank + parent->dodag->minhoprankincrease)
@@ -152,38 +172,30 @@ static uint16_t calc_rank(rpl_parent_t *parent, uint16_t base_rank)
 
 static rpl_parent_t *which_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
-    puts("which_parent");
+    DEBUG("which_parent\n");
     /*
      * Return the parent with the lowest path cost.
-     * Before returning any of the two given parents, make sure that a switch is
-     * desirable.
+     * The preferred parent is only given up for a path that is better by at
+     * least PARENT_SWITCH_THRESHOLD (RFC 6719, 3.2.2), so that parents with
+     * similar costs do not flap.
      *
      */
-    uint16_t path_p1    = calc_path_cost(p1);
-    uint16_t path_p2    = calc_path_cost(p2);
-
-    if (cur_preferred_parent != NULL) {
-        //test if the parent from which we got this path is still active
-        if (cur_preferred_parent->used != 0) {
-            // Test, if the current best path is better than both parents given
-            if (cur_min_path_cost < path_p1 + PARENT_SWITCH_THRESHOLD
-                && cur_min_path_cost < path_p2 + PARENT_SWITCH_THRESHOLD) {
-                return cur_preferred_parent;
-            }
-        }
+    uint16_t path_p1    = get_path_cost(p1);
+    uint16_t path_p2    = get_path_cost(p2);
+    rpl_parent_t *preferred = p1->dodag->my_preferred_parent;
+
+    if (p1 == preferred) {
+        return (path_p2 + PARENT_SWITCH_THRESHOLD < path_p1) ? p2 : p1;
+    }
+
+    if (p2 == preferred) {
+        return (path_p1 + PARENT_SWITCH_THRESHOLD < path_p2) ? p1 : p2;
     }
 
     if (path_p1 < path_p2) {
-        /*
-         * Return the current best parent, and set it as current best parent
-         */
-        cur_min_path_cost = path_p1;
-        cur_preferred_parent = p1;
         return p1;
     }
 
-    cur_min_path_cost = path_p2;
-    cur_preferred_parent = p2;
     return p2;
 }
 
@@ -33,8 +33,8 @@
 
 #define ENABLE_DEBUG (0)
 #if ENABLE_DEBUG
-#undef TRICKLE_TIMER_STACKSIZE
-#define TRICKLE_TIMER_STACKSIZE (KERNEL_CONF_STACKSIZE_MAIN)
+#undef RPL_PROCESS_STACKSIZE
+#define RPL_PROCESS_STACKSIZE (KERNEL_CONF_STACKSIZE_MAIN + RPL_MSG_BUFSIZE)
 #define DEBUG_ENABLED
 char addr_str[IPV6_MAX_ADDR_STR_LEN];
 #endif
@@ -42,31 +42,48 @@ char addr_str[IPV6_MAX_ADDR_STR_LEN];
 
 char rpl_process_buf[RPL_PROCESS_STACKSIZE];
 /* global variables */
-char i_am_root = 0;
 rpl_of_t *objective_functions[NUMBER_IMPLEMENTED_OFS];
-rpl_routing_entry_t routing_table[RPL_MAX_ROUTING_ENTRIES];
 unsigned int rpl_process_pid;
 ipv6_addr_t my_address;
-mutex_t rpl_send_mutex;
 mutex_t rpl_recv_mutex;
 /* receive buffer without LL_HDR */
 uint8_t rpl_buffer[BUFFER_SIZE - LL_HDR_LEN];
-/* in send buffer we need space fpr LL_HDR */
-uint8_t rpl_send_buffer[BUFFER_SIZE];
 
 msg_t msg_queue[RPL_PKT_RECV_BUF_SIZE];
-/* SEND BUFFERS */
-static ipv6_hdr_t *ipv6_send_buf;
-static icmpv6_hdr_t *icmp_send_buf;
-static struct rpl_dio_t *rpl_send_dio_buf;
-static struct rpl_dis_t *rpl_send_dis_buf;
-static struct rpl_dao_t *rpl_send_dao_buf;
-static struct rpl_dao_ack_t *rpl_send_dao_ack_buf;
-static rpl_opt_dodag_conf_t *rpl_send_opt_dodag_conf_buf;
-/* static struct rpl_opt_solicited_t * rpl_send_opt_solicited_buf; */
-static rpl_opt_target_t *rpl_send_opt_target_buf;
-static rpl_opt_transit_t *rpl_send_opt_transit_buf;
 
+/* routing table timer, its messages go to rpl_process like those of the
+ * DAO timer of each instance */
+static vtimer_t rt_timer;
+/* the route lifetimes are counted down once a second, a little late is fine */
+#define RT_TIMER_SLACK (50000)
+
+/*
+ * DAOs carry only the targets that changed since the parent acknowledged
+ * them: an entry is pending until it is sent and sent until the DAO-ACK
+ * with the sequence of its DAO arrives.  Removed targets wait in
+ * dao_nopaths to be withdrawn with a zero lifetime.  All targets are
+ * marked pending for a new parent and every RPL_DAO_REFRESH_INTERVAL
+ * seconds, before their routes at the parent expire.  All of this state
+ * is kept per instance.
+ */
+#define DAO_PENDING     (1)
+#define DAO_SENT        (2)
+
+enum {
+    DAO_IDLE,
+    DAO_DELAY,          /* changes are collected before sending */
+    DAO_WAIT_ACK
+};
+
+/* host targets below this prefix are announced as the prefix */
+static ipv6_addr_t dao_aggregate;
+static uint8_t dao_aggregate_len;
+/* traffic classes routed in another instance than the first joined */
+static struct {
+    uint8_t used;
+    uint8_t traffic_class;
+    uint8_t instanceid;
+} class_map[RPL_CLASS_MAP_SIZE];
 /* RECEIVE BUFFERS */
 static ipv6_hdr_t *ipv6_buf;
 static struct rpl_dio_t *rpl_dio_buf;
@@ -79,55 +96,17 @@ static rpl_opt_solicited_t *rpl_opt_solicited_buf;
 static rpl_opt_target_t *rpl_opt_target_buf;
 static rpl_opt_transit_t *rpl_opt_transit_buf;
 
-/*  SEND BUFFERS */
-static ipv6_hdr_t *get_rpl_send_ipv6_buf(void)
-{
-    return ((ipv6_hdr_t *) &(rpl_send_buffer[0]));
-}
-
-static uint8_t *get_rpl_send_payload_buf(uint8_t ext_len)
-{
-    return &(rpl_send_buffer[IPV6_HDR_LEN + ext_len]);
-}
-
-static icmpv6_hdr_t *get_rpl_send_icmpv6_buf(uint8_t ext_len)
-{
-    return ((icmpv6_hdr_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ext_len]));
-}
-
-static struct rpl_dio_t *get_rpl_send_dio_buf(void)
-{
-    return ((struct rpl_dio_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN]));
-}
-
-static struct rpl_dao_t *get_rpl_send_dao_buf(void)
-{
-    return ((struct rpl_dao_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN]));
-}
-
-static struct rpl_dao_ack_t *get_rpl_send_dao_ack_buf(void)
-{
-    return ((struct rpl_dao_ack_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN]));
-}
-
-static struct rpl_dis_t *get_rpl_send_dis_buf(void)
-{
-    return ((struct rpl_dis_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN]));
-}
+static bool rpl_prefix_matches(ipv6_addr_t *prefix, ipv6_addr_t *addr, uint8_t prefix_len);
+static ipv6_addr_t *rpl_instance_next_hop(rpl_instance_t *inst, ipv6_addr_t *addr);
+static uint8_t rpl_instance_class(rpl_instance_t *inst);
+static rpl_routing_entry_t *rpl_find_routing_prefix(rpl_instance_t *inst,
+        ipv6_addr_t *prefix, uint8_t prefix_len);
 
-static rpl_opt_dodag_conf_t *get_rpl_send_opt_dodag_conf_buf(uint8_t rpl_msg_len)
+static bool rpl_is_non_storing(rpl_instance_t *inst)
 {
-    return ((rpl_opt_dodag_conf_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN + rpl_msg_len]));
-}
+    rpl_dodag_t *my_dodag = rpl_get_joined_dodag(inst);
 
-static rpl_opt_target_t *get_rpl_send_opt_target_buf(uint8_t rpl_msg_len)
-{
-    return ((rpl_opt_target_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN + rpl_msg_len]));
-}
-
-static rpl_opt_transit_t *get_rpl_send_opt_transit_buf(uint8_t rpl_msg_len)
-{
-    return ((rpl_opt_transit_t *) &(rpl_send_buffer[IPV6_HDR_LEN + ICMPV6_HDR_LEN + rpl_msg_len]));
+    return (my_dodag != NULL) && (my_dodag->mop == NON_STORING_MODE);
 }
 
 /* RECEIVE BUFFERS */
@@ -193,19 +172,33 @@ rpl_of_t *rpl_get_of_for_ocp(uint16_t ocp)
     return NULL;
 }
 
+/* OF for ocp, starts the ETX beaconing of MRHOF when it is first used */
+static rpl_of_t *rpl_use_of(uint16_t ocp)
+{
+    static bool etx_started;
+    rpl_of_t *of = rpl_get_of_for_ocp(ocp);
+
+    if ((of == rpl_get_of_mrhof()) && !etx_started) {
+        DEBUG("%s, %d: INIT ETX BEACONING\n", __FILE__, __LINE__);
+        etx_init_beaconing(&my_address);
+        etx_set_change_handler(rpl_parent_metric_changed);
+        etx_started = true;
+    }
+
+    return of;
+}
+
 uint8_t rpl_init(int if_id)
 {
-    mutex_init(&rpl_send_mutex);
     mutex_init(&rpl_recv_mutex);
 
     rpl_instances_init();
 
-    /* initialize routing table */
-    rpl_clear_routing_table();
-    init_trickle();
     rpl_process_pid = thread_create(rpl_process_buf, RPL_PROCESS_STACKSIZE,
                                     PRIORITY_MAIN - 1, CREATE_STACKTEST,
                                     rpl_process, "rpl_process");
+    vtimer_set_msg_slack(&rt_timer, timex_set(1, 0), RT_TIMER_SLACK,
+                         rpl_process_pid, &rt_timer);
 
     /* INSERT NEW OBJECTIVE FUNCTIONS HERE */
     objective_functions[0] = rpl_get_of0();
@@ -219,33 +212,45 @@ uint8_t rpl_init(int if_id)
     ipv6_register_rpl_handler(rpl_process_pid);
 
     /* initialize ETX-calculation if needed */
-    if (RPL_DEFAULT_OCP == 1) {
-        DEBUG("%s, %d: INIT ETX BEACONING\n", __FILE__, __LINE__);
-        etx_init_beaconing(&my_address);
-    }
+    rpl_use_of(RPL_DEFAULT_OCP);
 
     return SIXLOWERROR_SUCCESS;
 }
 
 void rpl_init_root(void)
+{
+    rpl_init_root_instance(RPL_DEFAULT_INSTANCE, RPL_DEFAULT_OCP);
+}
+
+int rpl_init_root_instance(uint8_t instanceid, uint16_t ocp)
 {
     rpl_instance_t *inst;
     rpl_dodag_t *dodag;
+    rpl_of_t *of = rpl_use_of(ocp);
 
-    inst = rpl_new_instance(RPL_DEFAULT_INSTANCE);
+    if (of == NULL) {
+        DEBUG("%s, %d: Error - objective function %u not implemented\n", __FILE__, __LINE__, ocp);
+        return -1;
+    }
+
+    if ((inst = rpl_get_instance(instanceid)) != NULL) {
+        DEBUG("%s, %d: Error - instance %u exists\n", __FILE__, __LINE__, instanceid);
+        return -1;
+    }
+
+    inst = rpl_new_instance(instanceid);
 
     if (inst == NULL) {
         DEBUG("%s, %d: Error - No memory for another RPL instance\n", __FILE__, __LINE__);
-        return;
+        return -1;
     }
 
-    inst->id = RPL_DEFAULT_INSTANCE;
     inst->joined = 1;
 
-    dodag = rpl_new_dodag(RPL_DEFAULT_INSTANCE, &my_address);
+    dodag = rpl_new_dodag(instanceid, &my_address);
 
     if (dodag != NULL) {
-        dodag->of = (struct rpl_of_t *) rpl_get_of_for_ocp(RPL_DEFAULT_OCP);
+        dodag->of = (struct rpl_of_t *) of;
         dodag->instance = inst;
         dodag->mop = RPL_DEFAULT_MOP;
         dodag->dtsn = 1;
@@ -266,219 +271,669 @@ void rpl_init_root(void)
     }
     else {
         DEBUG("%s, %d: Error - could not generate DODAG\n", __FILE__, __LINE__);
-        return;
+        return -1;
+    }
+
+    inst->root = 1;
+    rpl_dio_changed(inst);
+
+    if (dodag->mop == NON_STORING_MODE) {
+        /* only we know the way down */
+        ipv6_iface_set_srh_provider(rpl_get_source_route);
     }
 
-    i_am_root = 1;
-    start_trickle(dodag->dio_min, dodag->dio_interval_doubling, dodag->dio_redundancy);
+    rpl_start_dio_trickle(dodag);
     DEBUG("%s, %d: ROOT INIT FINISHED\n", __FILE__, __LINE__);
+    return 0;
+}
+
+
+static void rpl_trickle_send_dio(void *arg)
+{
+    ipv6_addr_t mcast;
+
+    ipv6_addr_set_all_nodes_addr(&mcast);
+    send_DIO((rpl_instance_t *) arg, &mcast);
+}
+
+void rpl_start_dio_trickle(rpl_dodag_t *dodag)
+{
+    trickle_start(&dodag->instance->trickle, rpl_process_pid,
+                  rpl_trickle_send_dio, dodag->instance,
+                  1 << dodag->dio_min, dodag->dio_interval_doubling,
+                  dodag->dio_redundancy);
+}
+
+static void dao_timer_set(rpl_instance_t *inst, uint8_t state, uint32_t seconds)
+{
+    inst->dao_timer_state = state;
+    vtimer_remove(&inst->dao_timer);
+    vtimer_set_msg(&inst->dao_timer, timex_set(seconds, 0), rpl_process_pid,
+                   &inst->dao_timer);
+}
+
+static bool rpl_dao_covered(ipv6_addr_t *target, uint8_t prefix_len)
+{
+    return dao_aggregate_len && (prefix_len >= dao_aggregate_len) &&
+           rpl_prefix_matches(&dao_aggregate, target, dao_aggregate_len);
+}
+
+static void rpl_dao_mark(rpl_instance_t *inst, rpl_routing_entry_t *entry)
+{
+    if (!inst->root) {
+        entry->dao = DAO_PENDING;
+        inst->dao_changes++;
+    }
+}
+
+static void rpl_dao_mark_all(rpl_instance_t *inst)
+{
+    for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+        if (inst->routing_table[i].used) {
+            inst->routing_table[i].dao = DAO_PENDING;
+        }
+    }
+
+    /* the parent forgets withdrawn targets on its own */
+    memset(inst->dao_nopaths, 0, sizeof(inst->dao_nopaths));
+    inst->own_dao = DAO_PENDING;
+    inst->dao_refresh_in = RPL_DAO_REFRESH_INTERVAL;
+    inst->dao_changes++;
+}
+
+static void rpl_dao_withdraw(rpl_instance_t *inst, rpl_routing_entry_t *entry)
+{
+    if (inst->root || rpl_dao_covered(&entry->address, entry->prefix_len)) {
+        return;
+    }
+
+    for (int i = 0; i < RPL_DAO_NOPATH_MAX; i++) {
+        rpl_dao_nopath_t *np = &inst->dao_nopaths[i];
+
+        if (!np->dao) {
+            np->target = entry->address;
+            np->prefix_len = entry->prefix_len;
+            np->dao = DAO_PENDING;
+            inst->dao_changes++;
+            return;
+        }
+    }
+
+    /* the route at the parent runs out of lifetime instead */
+    DEBUG("%s, %d: no room to withdraw a target\n", __FILE__, __LINE__);
+}
+
+static bool rpl_dao_outstanding(rpl_instance_t *inst)
+{
+    if (inst->own_dao) {
+        return true;
+    }
+
+    for (int i = 0; i < RPL_DAO_NOPATH_MAX; i++) {
+        if (inst->dao_nopaths[i].dao) {
+            return true;
+        }
+    }
+
+    for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+        if (inst->routing_table[i].used && inst->routing_table[i].dao) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void delay_dao(rpl_instance_t *inst)
+{
+    /* changes within the delay share one DAO */
+    if (inst->dao_timer_state != DAO_DELAY) {
+        inst->dao_counter = 0;
+        dao_timer_set(inst, DAO_DELAY, DEFAULT_DAO_DELAY);
+    }
+}
+
+void rpl_dao_set_aggregate(ipv6_addr_t *prefix, uint8_t prefix_len)
+{
+    if (prefix != NULL) {
+        dao_aggregate = *prefix;
+    }
+
+    dao_aggregate_len = (prefix != NULL) ? prefix_len : 0;
+
+    /* our addresses are the same in all instances */
+    for (int i = 0; i < RPL_MAX_INSTANCES; i++) {
+        if (instances[i].joined && !instances[i].root) {
+            rpl_dao_mark_all(&instances[i]);
+            delay_dao(&instances[i]);
+        }
+    }
+}
+
+static void dao_delay_over(rpl_instance_t *inst)
+{
+    if ((rpl_get_joined_dodag(inst) == NULL) || !rpl_dao_outstanding(inst)) {
+        inst->dao_timer_state = DAO_IDLE;
+        return;
+    }
+
+    if (inst->dao_counter < DAO_SEND_RETRIES) {
+        inst->dao_counter++;
+        send_DAO_pending(inst);
+        dao_timer_set(inst, DAO_WAIT_ACK, DEFAULT_WAIT_FOR_DAO_ACK);
+    }
+    else {
+        /* the next change or refresh tries again */
+        DEBUG("%s, %d: no DAO-ACK\n", __FILE__, __LINE__);
+        inst->dao_timer_state = DAO_IDLE;
+    }
+}
+
+void dao_ack_received(rpl_instance_t *inst, uint8_t sequence)
+{
+    bool pending = false;
+
+    if ((inst->own_dao == DAO_SENT) && (inst->own_dao_seq == sequence)) {
+        inst->own_dao = 0;
+    }
+
+    pending |= (inst->own_dao == DAO_PENDING);
+
+    for (int i = 0; i < RPL_DAO_NOPATH_MAX; i++) {
+        rpl_dao_nopath_t *np = &inst->dao_nopaths[i];
+
+        if ((np->dao == DAO_SENT) && (np->dao_seq == sequence)) {
+            np->dao = 0;
+        }
+
+        pending |= (np->dao == DAO_PENDING);
+    }
+
+    for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+        rpl_routing_entry_t *entry = &inst->routing_table[i];
+
+        if ((entry->dao == DAO_SENT) && (entry->dao_seq == sequence)) {
+            entry->dao = 0;
+        }
+
+        pending |= (entry->dao == DAO_PENDING);
+    }
+
+    if (!rpl_dao_outstanding(inst)) {
+        vtimer_remove(&inst->dao_timer);
+        inst->dao_timer_state = DAO_IDLE;
+    }
+    else if (pending && (inst->dao_timer_state == DAO_WAIT_ACK)) {
+        /* changed while the DAO was on its way */
+        delay_dao(inst);
+    }
+}
+
+static void rt_timer_over(void)
+{
+    for (int n = 0; n < RPL_MAX_INSTANCES; n++) {
+        rpl_instance_t *inst = &instances[n];
+        rpl_dodag_t *my_dodag = rpl_get_joined_dodag(inst);
+
+        if (my_dodag == NULL) {
+            continue;
+        }
+
+        rpl_routing_entry_t *rt = inst->routing_table;
+
+        for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+            if (rt[i].used) {
+                if (rt[i].lifetime <= 1) {
+                    rpl_remove_routing_entry(inst, &rt[i]);
+                }
+                else {
+                    rt[i].lifetime--;
+                }
+            }
+        }
+
+        if (!inst->root && (my_dodag->mop != NO_DOWNWARD_ROUTES) &&
+            (inst->dao_refresh_in-- <= 1)) {
+            rpl_dao_mark_all(inst);
+            delay_dao(inst);
+        }
+
+        /* Parent is NULL for root too */
+        if (my_dodag->my_preferred_parent != NULL) {
+            if (my_dodag->my_preferred_parent->lifetime <= 1) {
+                puts("parent lifetime timeout");
+                rpl_parent_update(my_dodag, NULL);
+            }
+            else {
+                my_dodag->my_preferred_parent->lifetime--;
+            }
+        }
+    }
+
+    /* Wake up every second */
+    vtimer_set_msg_slack(&rt_timer, timex_set(1, 0), RT_TIMER_SLACK,
+                         rpl_process_pid, &rt_timer);
+}
+
+void rpl_msg_init(rpl_msg_t *msg, uint8_t *buf, uint16_t size, uint8_t code)
+{
+    msg->ipv6 = (ipv6_hdr_t *) buf;
+    msg->size = size;
+    msg->len = 0;
+
+    icmpv6_hdr_t *icmp = rpl_msg_put(msg, ICMPV6_HDR_LEN);
+    icmp->type = ICMPV6_TYPE_RPL_CONTROL;
+    icmp->code = code;
+}
+
+void *rpl_msg_put(rpl_msg_t *msg, uint16_t len)
+{
+    uint8_t *p = (uint8_t *) msg->ipv6 + IPV6_HDR_LEN + msg->len;
+
+    if (IPV6_HDR_LEN + msg->len + len > msg->size) {
+        return NULL;
+    }
+
+    memset(p, 0, len);
+    msg->len += len;
+    return p;
+}
+
+uint16_t rpl_msg_room(const rpl_msg_t *msg)
+{
+    return msg->size - IPV6_HDR_LEN - msg->len;
+}
+
+/* sends a message of inst whose sum of icmpv6_csum_partial() is *sum*, if
+ * given */
+static void rpl_msg_send_sum(rpl_msg_t *msg, rpl_instance_t *inst,
+                             ipv6_addr_t *destination, const uint16_t *sum)
+{
+    ipv6_hdr_t *ipv6 = msg->ipv6;
+    icmpv6_hdr_t *icmp = (icmpv6_hdr_t *)((uint8_t *) ipv6 + IPV6_HDR_LEN);
+
+    ipv6->version_trafficclass = IPV6_VER;
+    ipv6->trafficclass_flowlabel = 0;
+    ipv6->flowlabel = 0;
+    ipv6->nextheader = IPV6_PROTO_NUM_ICMPV6;
+    ipv6->hoplimit = MULTIHOP_HOPLIMIT;
+    ipv6->length = HTONS(msg->len);
+
+    if (inst != NULL) {
+        /* routed in inst if a class is mapped to it */
+        ipv6_set_traffic_class(ipv6, rpl_instance_class(inst));
+    }
+
+    memcpy(&ipv6->destaddr, destination, sizeof(ipv6_addr_t));
+    ipv6_net_if_get_best_src_addr(&ipv6->srcaddr, &ipv6->destaddr);
+
+    icmp->checksum = icmpv6_csum_finish(ipv6, (sum != NULL) ? *sum :
+                                        icmpv6_csum_partial(icmp, msg->len));
+
+    /* a DIS goes to a neighbor, before any instance is joined */
+    if ((inst != NULL) && !ipv6_addr_is_multicast(&ipv6->destaddr) &&
+        (rpl_instance_next_hop(inst, &ipv6->destaddr) == NULL)) {
+        rpl_dodag_t *my_dodag = rpl_get_joined_dodag(inst);
+
+        /* find appropriate next hop before sending */
+        if (inst->root) {
+            /* in non-storing mode the IP layer source routes */
+            if (!rpl_is_non_storing(inst) ||
+                (rpl_find_routing_entry(inst, &ipv6->destaddr) == NULL)) {
+                DEBUG("%s, %d: [Error] destination unknown\n", __FILE__, __LINE__);
+                return;
+            }
+        }
+        else if ((my_dodag == NULL) || (my_dodag->my_preferred_parent == NULL)) {
+            DEBUG("%s, %d: [Error] no preferred parent, dropping package\n", __FILE__, __LINE__);
+            return;
+        }
+    }
 
+    /* sent from the caller's buffer, the source routing header is
+     * inserted in place */
+    ipv6_send_packet(ipv6);
 }
 
+void rpl_msg_send(rpl_msg_t *msg, rpl_instance_t *inst, ipv6_addr_t *destination)
+{
+    rpl_msg_send_sum(msg, inst, destination, NULL);
+}
+
+void rpl_dio_changed(rpl_instance_t *inst)
+{
+    inst->dio_cache.dodag = NULL;
+}
 
-void send_DIO(ipv6_addr_t *destination)
+void send_DIO(rpl_instance_t *inst, ipv6_addr_t *destination)
 {
     DEBUG("%s, %d: Send DIO\n", __FILE__, __LINE__);
-    mutex_lock(&rpl_send_mutex);
+    uint8_t buf[RPL_MSG_BUFSIZE];
+    rpl_msg_t msg;
     rpl_dodag_t *mydodag;
-    icmp_send_buf = get_rpl_send_icmpv6_buf(ipv6_ext_hdr_len);
+    struct rpl_dio_t *dio;
+    rpl_opt_dodag_conf_t *conf;
+    rpl_dio_cache_t *dio_cache = &inst->dio_cache;
 
-    mydodag = rpl_get_my_dodag();
+    mydodag = rpl_get_joined_dodag(inst);
 
     if (mydodag == NULL) {
         DEBUG("%s, %d: Error - trying to send DIO without being part of a dodag.\n", __FILE__, __LINE__);
-        mutex_unlock(&rpl_send_mutex);
         return;
     }
 
-    icmp_send_buf->type = ICMPV6_TYPE_RPL_CONTROL;
-    icmp_send_buf->code = ICMP_CODE_DIO;
+    if ((dio_cache->dodag == mydodag) && (dio_cache->version == mydodag->version) &&
+        (dio_cache->rank == mydodag->my_rank) && (dio_cache->dtsn == mydodag->dtsn)) {
+        /* nothing changed since the last DIO */
+        msg.ipv6 = (ipv6_hdr_t *) buf;
+        msg.size = sizeof(buf);
+        msg.len = 0;
+        memcpy(rpl_msg_put(&msg, sizeof(dio_cache->msg)), dio_cache->msg,
+               sizeof(dio_cache->msg));
+        rpl_msg_send_sum(&msg, inst, destination, &dio_cache->sum);
+        return;
+    }
 
-    rpl_send_dio_buf = get_rpl_send_dio_buf();
-    memset(rpl_send_dio_buf, 0, sizeof(*rpl_send_dio_buf));
+    rpl_msg_init(&msg, buf, sizeof(buf), ICMP_CODE_DIO);
+    dio = rpl_msg_put(&msg, DIO_BASE_LEN);
 
     DEBUG("%s, %d: Sending DIO with ", __FILE__, __LINE__);
-    rpl_send_dio_buf->rpl_instanceid = mydodag->instance->id;
-    DEBUG("instance %02X ", rpl_send_dio_buf->rpl_instanceid);
-    rpl_send_dio_buf->version_number = mydodag->version;
-    rpl_send_dio_buf->rank = mydodag->my_rank;
-    DEBUG("rank %04X\n", rpl_send_dio_buf->rank);
-    rpl_send_dio_buf->g_mop_prf = (mydodag->grounded << RPL_GROUNDED_SHIFT) | (mydodag->mop << RPL_MOP_SHIFT) | mydodag->prf;
-    rpl_send_dio_buf->dtsn = mydodag->dtsn;
-    rpl_send_dio_buf->flags = 0;
-    rpl_send_dio_buf->reserved = 0;
-    rpl_send_dio_buf->dodagid = mydodag->dodag_id;
-
-    int opt_hdr_len = 0;
+    dio->rpl_instanceid = mydodag->instance->id;
+    DEBUG("instance %02X ", dio->rpl_instanceid);
+    dio->version_number = mydodag->version;
+    dio->rank = mydodag->my_rank;
+    DEBUG("rank %04X\n", dio->rank);
+    dio->g_mop_prf = (mydodag->grounded << RPL_GROUNDED_SHIFT) | (mydodag->mop << RPL_MOP_SHIFT) | mydodag->prf;
+    dio->dtsn = mydodag->dtsn;
+    dio->dodagid = mydodag->dodag_id;
+
     /* DODAG configuration option */
-    rpl_send_opt_dodag_conf_buf = get_rpl_send_opt_dodag_conf_buf(DIO_BASE_LEN);
-    rpl_send_opt_dodag_conf_buf->type = RPL_OPT_DODAG_CONF;
-    rpl_send_opt_dodag_conf_buf->length = RPL_OPT_DODAG_CONF_LEN;
-    rpl_send_opt_dodag_conf_buf->flags_a_pcs = 0;
-    rpl_send_opt_dodag_conf_buf->DIOIntDoubl = mydodag->dio_interval_doubling;
-    rpl_send_opt_dodag_conf_buf->DIOIntMin = mydodag->dio_min;
-    rpl_send_opt_dodag_conf_buf->DIORedun = mydodag->dio_redundancy;
-    rpl_send_opt_dodag_conf_buf->MaxRankIncrease = mydodag->maxrankincrease;
-    rpl_send_opt_dodag_conf_buf->MinHopRankIncrease = mydodag->minhoprankincrease;
-    rpl_send_opt_dodag_conf_buf->ocp = mydodag->of->ocp;
-    rpl_send_opt_dodag_conf_buf->reserved = 0;
-    rpl_send_opt_dodag_conf_buf->default_lifetime = mydodag->default_lifetime;
-    rpl_send_opt_dodag_conf_buf->lifetime_unit = mydodag->lifetime_unit;
-
-    opt_hdr_len += RPL_OPT_LEN + RPL_OPT_DODAG_CONF_LEN;
-
-    uint16_t plen = ICMPV6_HDR_LEN + DIO_BASE_LEN + opt_hdr_len;
-    rpl_send(destination, (uint8_t *)icmp_send_buf, plen, IPV6_PROTO_NUM_ICMPV6);
-    mutex_unlock(&rpl_send_mutex);
+    conf = rpl_msg_put(&msg, RPL_OPT_LEN + RPL_OPT_DODAG_CONF_LEN);
+    conf->type = RPL_OPT_DODAG_CONF;
+    conf->length = RPL_OPT_DODAG_CONF_LEN;
+    conf->DIOIntDoubl = mydodag->dio_interval_doubling;
+    conf->DIOIntMin = mydodag->dio_min;
+    conf->DIORedun = mydodag->dio_redundancy;
+    conf->MaxRankIncrease = mydodag->maxrankincrease;
+    conf->MinHopRankIncrease = mydodag->minhoprankincrease;
+    conf->ocp = mydodag->of->ocp;
+    conf->default_lifetime = mydodag->default_lifetime;
+    conf->lifetime_unit = mydodag->lifetime_unit;
+
+    dio_cache->dodag = mydodag;
+    dio_cache->version = mydodag->version;
+    dio_cache->rank = mydodag->my_rank;
+    dio_cache->dtsn = mydodag->dtsn;
+    dio_cache->sum = icmpv6_csum_partial((icmpv6_hdr_t *)(buf + IPV6_HDR_LEN), msg.len);
+    memcpy(dio_cache->msg, buf + IPV6_HDR_LEN, sizeof(dio_cache->msg));
+    rpl_msg_send_sum(&msg, inst, destination, &dio_cache->sum);
 }
 
 void send_DIS(ipv6_addr_t *destination)
 {
     DEBUG("%s, %d: Send DIS\n", __FILE__, __LINE__);
-    mutex_lock(&rpl_send_mutex);
-    icmp_send_buf = get_rpl_send_icmpv6_buf(ipv6_ext_hdr_len);
+    uint8_t buf[RPL_MSG_BUFSIZE];
+    rpl_msg_t msg;
 
-    icmp_send_buf->type = ICMPV6_TYPE_RPL_CONTROL;
-    icmp_send_buf->code = ICMP_CODE_DIS;
+    rpl_msg_init(&msg, buf, sizeof(buf), ICMP_CODE_DIS);
+    rpl_msg_put(&msg, DIS_BASE_LEN);
+    rpl_msg_send(&msg, NULL, destination);
+}
+
+/* starts a DAO, returns its sequence number */
+static uint8_t dao_begin(rpl_msg_t *msg, uint8_t *buf, rpl_dodag_t *my_dodag)
+{
+    struct rpl_dao_t *dao;
+
+    rpl_msg_init(msg, buf, RPL_MSG_BUFSIZE, ICMP_CODE_DAO);
+    dao = rpl_msg_put(msg, DAO_BASE_LEN);
+    dao->rpl_instanceid = my_dodag->instance->id;
+    dao->k_d_flags = 0x00;
+    dao->dao_sequence = my_dodag->dao_seq;
+    return dao->dao_sequence;
+}
 
-    rpl_send_dis_buf = get_rpl_send_dis_buf();
+/* room a target with its transit option takes */
+#define DAO_TARGET_ROOM     (RPL_OPT_TARGET_LEN + 2 + RPL_OPT_TRANSIT_PARENT_LEN + 2)
 
-    uint16_t plen = ICMPV6_HDR_LEN + DIS_BASE_LEN;
-    rpl_send(destination, (uint8_t *)icmp_send_buf, plen, IPV6_PROTO_NUM_ICMPV6);
-    mutex_unlock(&rpl_send_mutex);
+/* a DAO with *targets* has no room for *n* more */
+#define DAO_FULL(msg, targets, n) \
+    (((targets) + (n) > RPL_DAO_TARGETS_MAX) || \
+     (rpl_msg_room(msg) < (n) * DAO_TARGET_ROOM))
+
+/* appends a target with its transit option, *parent* is only given in
+ * non-storing mode */
+static void dao_put_target(rpl_msg_t *msg, ipv6_addr_t *target,
+                           uint8_t prefix_len, uint8_t lifetime,
+                           ipv6_addr_t *parent)
+{
+    rpl_opt_target_t *opt_target = rpl_msg_put(msg, RPL_OPT_TARGET_LEN + 2);
+    opt_target->type = RPL_OPT_TARGET;
+    opt_target->length = RPL_OPT_TARGET_LEN;
+    opt_target->flags = 0x00;
+    opt_target->prefix_length =
+        (prefix_len < RPL_HOST_ROUTE_PREFIX_LEN) ? prefix_len : RPL_DODAG_ID_LEN;
+    memcpy(&opt_target->target, target, sizeof(ipv6_addr_t));
+
+    uint8_t transit_len = (parent != NULL) ? RPL_OPT_TRANSIT_PARENT_LEN : RPL_OPT_TRANSIT_LEN;
+    rpl_opt_transit_t *opt_transit = rpl_msg_put(msg, transit_len + 2);
+    opt_transit->type = RPL_OPT_TRANSIT;
+    opt_transit->length = transit_len;
+    opt_transit->e_flags = 0x00;
+    opt_transit->path_control = 0x00; /* not used */
+    opt_transit->path_sequence = 0x00; /* not used */
+    opt_transit->path_lifetime = lifetime;
+
+    if (parent != NULL) {
+        /* the root links us to our parent */
+        memcpy((uint8_t *) opt_transit + sizeof(rpl_opt_transit_t),
+               parent, sizeof(ipv6_addr_t));
+    }
 }
 
+/* where DAOs go, NULL if there is no parent */
+static ipv6_addr_t *dao_destination(rpl_dodag_t *my_dodag)
+{
+    if (my_dodag->my_preferred_parent == NULL) {
+        DEBUG("%s, %d: send_DAO: my_dodag has no my_preferred_parent\n", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    if (my_dodag->mop == NON_STORING_MODE) {
+        /* DAOs go to the root, which keeps the whole topology */
+        return &my_dodag->dodag_id;
+    }
 
-void send_DAO(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint8_t start_index)
+    return &my_dodag->my_preferred_parent->addr;
+}
+
+void send_DAO(rpl_instance_t *inst, ipv6_addr_t *destination, uint8_t lifetime,
+              bool default_lifetime, uint8_t start_index)
 {
     DEBUG("Send DAO\n");
 
-    if (i_am_root) {
+    if (inst->root) {
         return;
     }
 
-    mutex_lock(&rpl_send_mutex);
     rpl_dodag_t *my_dodag;
 
-    if ((my_dodag = rpl_get_my_dodag()) == NULL) {
+    if ((my_dodag = rpl_get_joined_dodag(inst)) == NULL) {
         DEBUG("%s, %d: send_DAO: I have no my_dodag\n", __FILE__, __LINE__);
-        mutex_unlock(&rpl_send_mutex);
         return;
     }
 
-    if (destination == NULL) {
-        if (my_dodag->my_preferred_parent == NULL) {
-            DEBUG("%s, %d: send_DAO: my_dodag has no my_preferred_parent\n", __FILE__, __LINE__);
-            mutex_unlock(&rpl_send_mutex);
+    if ((my_dodag->mop == NON_STORING_MODE) || (destination == NULL)) {
+        destination = dao_destination(my_dodag);
+
+        if (destination == NULL) {
             return;
         }
+    }
 
-        destination = &my_dodag->my_preferred_parent->addr;
+    if (my_dodag->mop == NON_STORING_MODE) {
+        start_index = RPL_MAX_ROUTING_ENTRIES;
     }
 
     if (default_lifetime) {
         lifetime = my_dodag->default_lifetime;
     }
 
-    icmp_send_buf  = get_rpl_send_icmpv6_buf(ipv6_ext_hdr_len);
-
-    icmp_send_buf->type = ICMPV6_TYPE_RPL_CONTROL;
-    icmp_send_buf->code = ICMP_CODE_DAO;
-
-    rpl_send_dao_buf = get_rpl_send_dao_buf();
-    memset(rpl_send_dao_buf, 0, sizeof(*rpl_send_dao_buf));
-    rpl_send_dao_buf->rpl_instanceid = my_dodag->instance->id;
-    rpl_send_dao_buf->k_d_flags = 0x00;
-    rpl_send_dao_buf->dao_sequence = my_dodag->dao_seq;
-    DEBUG("%s, %d: Send DAO with instance %04X and sequence %04X to %s\n",
-            __FILE__, __LINE__,
-            rpl_send_dao_buf->rpl_instanceid, rpl_send_dao_buf->dao_sequence,
-            ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, destination));
-    uint16_t opt_len = 0;
-    rpl_send_opt_target_buf = get_rpl_send_opt_target_buf(DAO_BASE_LEN);
-    /* add all targets from routing table as targets */
-    uint8_t entries = 0;
-    uint8_t continue_index = 0;
-
-    for (uint8_t i = start_index; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (routing_table[i].used) {
-            rpl_send_opt_target_buf->type = RPL_OPT_TARGET;
-            rpl_send_opt_target_buf->length = RPL_OPT_TARGET_LEN;
-            rpl_send_opt_target_buf->flags = 0x00;
-            rpl_send_opt_target_buf->prefix_length = RPL_DODAG_ID_LEN;
-            memcpy(&rpl_send_opt_target_buf->target, &routing_table[i].address, sizeof(ipv6_addr_t));
-            opt_len += RPL_OPT_TARGET_LEN + 2;
-            rpl_send_opt_transit_buf = get_rpl_send_opt_transit_buf(DAO_BASE_LEN + opt_len);
-            rpl_send_opt_transit_buf->type = RPL_OPT_TRANSIT;
-            rpl_send_opt_transit_buf->length = RPL_OPT_TRANSIT_LEN;
-            rpl_send_opt_transit_buf->e_flags = 0x00;
-            rpl_send_opt_transit_buf->path_control = 0x00; /* not used */
-            rpl_send_opt_transit_buf->path_sequence = 0x00; /* not used */
-            rpl_send_opt_transit_buf->path_lifetime = lifetime;
-            opt_len += RPL_OPT_TRANSIT_LEN + 2;
-            rpl_send_opt_target_buf = get_rpl_send_opt_target_buf(DAO_BASE_LEN + opt_len);
-            entries++;
-        }
+    /* split into DAOs of at most RPL_DAO_TARGETS_MAX routing entries,
+     * each with our own address */
+    do {
+        uint8_t buf[RPL_MSG_BUFSIZE];
+        rpl_msg_t msg;
+        dao_begin(&msg, buf, my_dodag);
+        DEBUG("%s, %d: Send DAO with instance %04X and sequence %04X to %s\n",
+                __FILE__, __LINE__, my_dodag->instance->id, my_dodag->dao_seq,
+                ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, destination));
+        /* add all targets from routing table as targets */
+        uint8_t entries = 0;
+        uint16_t continue_index = 0;
+
+        for (uint16_t i = start_index; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+            rpl_routing_entry_t *rt = &inst->routing_table[i];
+
+            if (rt->used) {
+                dao_put_target(&msg, &rt->address, rt->prefix_len, lifetime, NULL);
+                entries++;
+            }
 
-        /* Split DAO, so packages don't get too big.
-         * The value 5 is based on experience. */
-        if (entries >= 5) {
-            continue_index = i + 1;
-            break;
+            /* Split DAO, so packages don't get too big. */
+            if ((entries >= RPL_DAO_TARGETS_MAX) || DAO_FULL(&msg, 0, 2)) {
+                continue_index = i + 1;
+                break;
+            }
         }
+
+        /* add own address */
+        dao_put_target(&msg, &my_address, RPL_HOST_ROUTE_PREFIX_LEN, lifetime,
+                       (my_dodag->mop == NON_STORING_MODE) ?
+                       &my_dodag->my_preferred_parent->addr : NULL);
+
+        rpl_msg_send(&msg, inst, destination);
+        my_dodag->dao_seq = RPL_COUNTER_INCREMENT(my_dodag->dao_seq);
+        start_index = continue_index;
+    } while (start_index > 1);
+}
+
+void send_DAO_pending(rpl_instance_t *inst)
+{
+    rpl_dodag_t *my_dodag = rpl_get_joined_dodag(inst);
+    ipv6_addr_t *destination;
+
+    if (inst->root || (my_dodag == NULL) ||
+        ((destination = dao_destination(my_dodag)) == NULL)) {
+        return;
     }
 
-    /* add own address */
-    rpl_send_opt_target_buf->type = RPL_OPT_TARGET;
-    rpl_send_opt_target_buf->length = RPL_OPT_TARGET_LEN;
-    rpl_send_opt_target_buf->flags = 0x00;
-    rpl_send_opt_target_buf->prefix_length = RPL_DODAG_ID_LEN;
-    memcpy(&rpl_send_opt_target_buf->target, &my_address, sizeof(ipv6_addr_t));
-    opt_len += RPL_OPT_TARGET_LEN + 2;
+    if (!rpl_equal_id(&inst->dao_parent, &my_dodag->my_preferred_parent->addr)) {
+        /* a new parent knows none of our targets */
+        inst->dao_parent = my_dodag->my_preferred_parent->addr;
+        rpl_dao_mark_all(inst);
+    }
 
-    rpl_send_opt_transit_buf = get_rpl_send_opt_transit_buf(DAO_BASE_LEN + opt_len);
-    rpl_send_opt_transit_buf->type = RPL_OPT_TRANSIT;
-    rpl_send_opt_transit_buf->length = RPL_OPT_TRANSIT_LEN;
-    rpl_send_opt_transit_buf->e_flags = 0x00;
-    rpl_send_opt_transit_buf->path_control = 0x00;
-    rpl_send_opt_transit_buf->path_sequence = 0x00;
-    rpl_send_opt_transit_buf->path_lifetime = lifetime;
-    opt_len += RPL_OPT_TRANSIT_LEN + 2;
+    /* what went unacknowledged goes again */
+    inst->own_dao = inst->own_dao ? DAO_PENDING : 0;
 
-    uint16_t plen = ICMPV6_HDR_LEN + DAO_BASE_LEN + opt_len;
-    rpl_send(destination, (uint8_t *)icmp_send_buf, plen, IPV6_PROTO_NUM_ICMPV6);
-    mutex_unlock(&rpl_send_mutex);
+    for (int i = 0; i < RPL_DAO_NOPATH_MAX; i++) {
+        inst->dao_nopaths[i].dao = inst->dao_nopaths[i].dao ? DAO_PENDING : 0;
+    }
 
-    if (continue_index > 1) {
-        send_DAO(destination, lifetime, default_lifetime, continue_index);
+    for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+        inst->routing_table[i].dao = inst->routing_table[i].dao ? DAO_PENDING : 0;
     }
+
+    uint8_t lifetime = my_dodag->default_lifetime;
+    ipv6_addr_t *parent = (my_dodag->mop == NON_STORING_MODE) ?
+                          &my_dodag->my_preferred_parent->addr : NULL;
+    int nopath = 0;
+    uint16_t entry = 0;
+    uint8_t targets;
+
+    do {
+        uint8_t buf[RPL_MSG_BUFSIZE];
+        rpl_msg_t msg;
+        uint8_t sequence = dao_begin(&msg, buf, my_dodag);
+        targets = 0;
+
+        for (; (nopath < RPL_DAO_NOPATH_MAX) && !DAO_FULL(&msg, targets, 1); nopath++) {
+            rpl_dao_nopath_t *np = &inst->dao_nopaths[nopath];
+
+            if (np->dao == DAO_PENDING) {
+                dao_put_target(&msg, &np->target, np->prefix_len, 0, parent);
+                np->dao = DAO_SENT;
+                np->dao_seq = sequence;
+                targets++;
+            }
+        }
+
+        for (; (entry < RPL_MAX_ROUTING_ENTRIES) && !DAO_FULL(&msg, targets, 1); entry++) {
+            rpl_routing_entry_t *rt = &inst->routing_table[entry];
+
+            if (!rt->used || (rt->dao != DAO_PENDING)) {
+                continue;
+            }
+
+            if (rpl_dao_covered(&rt->address, rt->prefix_len)) {
+                /* announced by the aggregate with our own address */
+                rt->dao = 0;
+                continue;
+            }
+
+            dao_put_target(&msg, &rt->address, rt->prefix_len, lifetime, NULL);
+            rt->dao = DAO_SENT;
+            rt->dao_seq = sequence;
+            targets++;
+        }
+
+        if ((inst->own_dao == DAO_PENDING) && !DAO_FULL(&msg, targets, 2)) {
+            dao_put_target(&msg, &my_address, RPL_HOST_ROUTE_PREFIX_LEN,
+                           lifetime, parent);
+
+            if (dao_aggregate_len) {
+                dao_put_target(&msg, &dao_aggregate, dao_aggregate_len,
+                               lifetime, parent);
+            }
+
+            inst->own_dao = DAO_SENT;
+            inst->own_dao_seq = sequence;
+            targets += 2;
+        }
+
+        if (targets) {
+            DEBUG("%s, %d: Send DAO with %u targets and sequence %04X to %s\n",
+                  __FILE__, __LINE__, targets, sequence,
+                  ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, destination));
+            rpl_msg_send(&msg, inst, destination);
+            my_dodag->dao_seq = RPL_COUNTER_INCREMENT(my_dodag->dao_seq);
+        }
+
+        /* the loops stop early only if the DAO is full */
+    } while (targets && ((nopath < RPL_DAO_NOPATH_MAX) ||
+                         (entry < RPL_MAX_ROUTING_ENTRIES) ||
+                         (inst->own_dao == DAO_PENDING)));
 }
 
-void send_DAO_ACK(ipv6_addr_t *destination)
+void send_DAO_ACK(rpl_instance_t *inst, ipv6_addr_t *destination, uint8_t sequence)
 {
     DEBUG("%s, %d: Send DAO ACK\n", __FILE__, __LINE__);
-    rpl_dodag_t *my_dodag;
-    my_dodag = rpl_get_my_dodag();
+    uint8_t buf[RPL_MSG_BUFSIZE];
+    rpl_msg_t msg;
+    struct rpl_dao_ack_t *ack;
 
-    if (my_dodag == NULL) {
+    if (rpl_get_joined_dodag(inst) == NULL) {
         return;
     }
 
-    mutex_lock(&rpl_send_mutex);
-    icmp_send_buf = get_rpl_send_icmpv6_buf(ipv6_ext_hdr_len);
-
-    icmp_send_buf->type = ICMPV6_TYPE_RPL_CONTROL;
-    icmp_send_buf->code = ICMP_CODE_DAO_ACK;
-
-    rpl_send_dao_ack_buf = get_rpl_send_dao_ack_buf();
-    rpl_send_dao_ack_buf->rpl_instanceid = my_dodag->instance->id;
-    rpl_send_dao_ack_buf->d_reserved = 0;
-    rpl_send_dao_ack_buf->dao_sequence = my_dodag->dao_seq;
-    rpl_send_dao_ack_buf->status = 0;
-
-    uint16_t plen = ICMPV6_HDR_LEN + DAO_ACK_LEN;
-    rpl_send(destination, (uint8_t *)icmp_send_buf, plen, IPV6_PROTO_NUM_ICMPV6);
-    mutex_unlock(&rpl_send_mutex);
+    rpl_msg_init(&msg, buf, sizeof(buf), ICMP_CODE_DAO_ACK);
+    ack = rpl_msg_put(&msg, DAO_ACK_LEN);
+    ack->rpl_instanceid = inst->id;
+    ack->d_reserved = 0;
+    ack->dao_sequence = sequence;
+    ack->status = 0;
+    rpl_msg_send(&msg, inst, destination);
 }
 
 void rpl_process(void)
@@ -488,6 +943,29 @@ void rpl_process(void)
 
     while (1) {
         msg_receive(&m_recv);
+
+        if (m_recv.type == MSG_TIMER) {
+            rpl_instance_t *inst = NULL;
+
+            for (int i = 0; i < RPL_MAX_INSTANCES; i++) {
+                if (m_recv.content.ptr == (char *) &instances[i].dao_timer) {
+                    inst = &instances[i];
+                }
+            }
+
+            if (inst != NULL) {
+                dao_delay_over(inst);
+            }
+            else if (m_recv.content.ptr == (char *) &rt_timer) {
+                rt_timer_over();
+            }
+            else {
+                trickle_fire((trickle_t *) m_recv.content.ptr);
+            }
+
+            continue;
+        }
+
         uint8_t *code;
         code = ((uint8_t *)m_recv.content.ptr);
         /* differentiate packet types */
@@ -539,15 +1017,9 @@ void recv_rpl_dio(void)
     int len = DIO_BASE_LEN;
 
     rpl_instance_t *dio_inst = rpl_get_instance(rpl_dio_buf->rpl_instanceid);
-    rpl_instance_t *my_inst = rpl_get_my_instance();
 
     if (dio_inst == NULL) {
-        if (my_inst != NULL) {
-            /* already part of a DODAG -> impossible to join other instance */
-            DEBUG("%s, %d: Not joining another DODAG!\n", __FILE__, __LINE__);
-            return;
-        }
-
+        /* instances are joined side by side, each with a DODAG of its own */
         dio_inst = rpl_new_instance(rpl_dio_buf->rpl_instanceid);
 
         if (dio_inst == NULL) {
@@ -555,19 +1027,6 @@ void recv_rpl_dio(void)
             return;
         }
     }
-    else if (my_inst == NULL) {
-        DEBUG("%s, %d: Not joined an instance yet\n", __FILE__, __LINE__);
-    }
-    else if (my_inst->id != dio_inst->id) {
-        /* TODO: Add support support for several instances.  */
-
-        /* At the moment, nodes can only join one instance, this is
-        * the instance they join first.
-        * Instances cannot be switched later on.  */
-
-        DEBUG("%s, %d: Ignoring instance - we are %d and got %d\n", __FILE__, __LINE__, my_inst->id, dio_inst->id);
-        return;
-    }
 
     rpl_dodag_t dio_dodag;
     memset(&dio_dodag, 0, sizeof(dio_dodag));
@@ -629,7 +1088,7 @@ void recv_rpl_dio(void)
                 dio_dodag.minhoprankincrease = rpl_opt_dodag_conf_buf->MinHopRankIncrease;
                 dio_dodag.default_lifetime = rpl_opt_dodag_conf_buf->default_lifetime;
                 dio_dodag.lifetime_unit = rpl_opt_dodag_conf_buf->lifetime_unit;
-                dio_dodag.of = (struct rpl_of_t *) rpl_get_of_for_ocp(rpl_opt_dodag_conf_buf->ocp);
+                dio_dodag.of = (struct rpl_of_t *) rpl_use_of(rpl_opt_dodag_conf_buf->ocp);
                 len += RPL_OPT_DODAG_CONF_LEN + 2;
                 break;
             }
@@ -651,7 +1110,7 @@ void recv_rpl_dio(void)
     }
 
     /* handle packet content... */
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
+    rpl_dodag_t *my_dodag = rpl_get_joined_dodag(dio_inst);
 
     if (my_dodag == NULL) {
         if (!has_dodag_conf_opt) {
@@ -669,6 +1128,7 @@ void recv_rpl_dio(void)
 
         if (dio_dodag.of == NULL) {
             DEBUG("%s, %d: Required objective function not supported\n", __FILE__, __LINE__);
+            return;
         }
 
         if (rpl_dio_buf->rank != INFINITE_RANK) {
@@ -688,7 +1148,7 @@ void recv_rpl_dio(void)
             if (my_dodag->my_rank == ROOT_RANK) {
                 DEBUG("%s, %d: [Warning] Inconsistent Dodag Version\n", __FILE__, __LINE__);
                 my_dodag->version = RPL_COUNTER_INCREMENT(dio_dodag.version);
-                reset_trickletimer();
+                trickle_reset_timer(&my_dodag->instance->trickle);
             }
             else {
                 DEBUG("%s, %d: [Info] New Version of dodag %d\n", __FILE__, __LINE__, dio_dodag.version);
@@ -699,20 +1159,20 @@ void recv_rpl_dio(void)
         }
         else if (RPL_COUNTER_GREATER_THAN(my_dodag->version, dio_dodag.version)) {
             /* ein Knoten hat noch eine kleinere Versionsnummer -> mehr DIOs senden */
-            reset_trickletimer();
+            trickle_reset_timer(&my_dodag->instance->trickle);
             return;
         }
     }
 
     /* version matches, DODAG matches */
     if (rpl_dio_buf->rank == INFINITE_RANK) {
-        reset_trickletimer();
+        trickle_reset_timer(&my_dodag->instance->trickle);
     }
 
     /* We are root, all done!*/
     if (my_dodag->my_rank == ROOT_RANK) {
         if (rpl_dio_buf->rank != INFINITE_RANK) {
-            trickle_increment_counter();
+            trickle_increment_counter(&my_dodag->instance->trickle);
         }
 
         return;
@@ -721,7 +1181,7 @@ void recv_rpl_dio(void)
     /*********************  Parent Handling *********************/
 
     rpl_parent_t *parent;
-    parent = rpl_find_parent(&ipv6_buf->srcaddr);
+    parent = rpl_find_parent(my_dodag, &ipv6_buf->srcaddr);
 
     if (parent == NULL) {
         /* add new parent candidate */
@@ -733,18 +1193,18 @@ void recv_rpl_dio(void)
     }
     else {
         /* DIO OK */
-        trickle_increment_counter();
+        trickle_increment_counter(&my_dodag->instance->trickle);
     }
 
     /* update parent rank */
-    parent->rank = rpl_dio_buf->rank;
-    rpl_parent_update(parent);
+    rpl_parent_set_rank(parent, rpl_dio_buf->rank);
+    rpl_parent_update(my_dodag, parent);
 
     if (my_dodag->my_preferred_parent == NULL) {
         DEBUG("%s, %d: my dodag has no preferred_parent yet - seems to be odd since I have a parent...\n", __FILE__, __LINE__);
     }
     else if (rpl_equal_id(&parent->addr, &my_dodag->my_preferred_parent->addr) && (parent->dtsn != rpl_dio_buf->dtsn)) {
-        delay_dao();
+        delay_dao(dio_inst);
     }
 
     parent->dtsn = rpl_dio_buf->dtsn;
@@ -753,11 +1213,7 @@ void recv_rpl_dio(void)
 
 void recv_rpl_dis(void)
 {
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
-
-    if (my_dodag == NULL) {
-        return;
-    }
+    rpl_opt_solicited_t *solicited = NULL;
 
     ipv6_buf = get_rpl_ipv6_buf();
     rpl_dis_buf = get_rpl_dis_buf();
@@ -778,63 +1234,92 @@ void recv_rpl_dis(void)
             }
 
             case (RPL_OPT_SOLICITED_INFO): {
-                len += RPL_OPT_SOLICITED_INFO_LEN + 2;
-
                 /* extract and check */
                 if (rpl_opt_buf->length != RPL_OPT_SOLICITED_INFO_LEN) {
                     /* error malformed */
                     return;
                 }
 
-                rpl_opt_solicited_buf = get_rpl_opt_solicited_buf(len);
+                solicited = rpl_opt_solicited_buf = get_rpl_opt_solicited_buf(len);
+                len += RPL_OPT_SOLICITED_INFO_LEN + 2;
+                break;
+            }
 
-                if (rpl_opt_solicited_buf->VID_Flags & RPL_DIS_I_MASK) {
-                    if (my_dodag->instance->id != rpl_opt_solicited_buf->rplinstanceid) {
-                        return;
-                    }
-                }
+            default:
+                return;
+        }
+    }
 
-                if (rpl_opt_solicited_buf->VID_Flags & RPL_DIS_D_MASK) {
-                    if (!rpl_equal_id(&my_dodag->dodag_id, &rpl_opt_solicited_buf->dodagid)) {
-                        return;
-                    }
-                }
+    /* answered for every joined instance the DIS asks for */
+    for (int i = 0; i < RPL_MAX_INSTANCES; i++) {
+        rpl_dodag_t *my_dodag = rpl_get_joined_dodag(&instances[i]);
 
-                if (rpl_opt_solicited_buf->VID_Flags & RPL_DIS_V_MASK) {
-                    if (my_dodag->version != rpl_opt_solicited_buf->version) {
-                        return;
-                    }
-                }
+        if (my_dodag == NULL) {
+            continue;
+        }
 
-                break;
+        if (solicited != NULL) {
+            if ((solicited->VID_Flags & RPL_DIS_I_MASK) &&
+                (instances[i].id != solicited->rplinstanceid)) {
+                continue;
             }
 
-            default:
-                return;
+            if ((solicited->VID_Flags & RPL_DIS_D_MASK) &&
+                !rpl_equal_id(&my_dodag->dodag_id, &solicited->dodagid)) {
+                continue;
+            }
+
+            if ((solicited->VID_Flags & RPL_DIS_V_MASK) &&
+                (my_dodag->version != solicited->version)) {
+                continue;
+            }
         }
+
+        send_DIO(&instances[i], &ipv6_buf->srcaddr);
     }
+}
 
-    send_DIO(&ipv6_buf->srcaddr);
+/* removes a withdrawn route, unless it has moved to another next hop */
+static void rpl_dao_nopath(rpl_instance_t *inst, ipv6_addr_t *target,
+                           uint8_t prefix_len, ipv6_addr_t *next_hop)
+{
+    rpl_routing_entry_t *entry;
+
+    if (prefix_len >= RPL_HOST_ROUTE_PREFIX_LEN) {
+        entry = rpl_find_routing_entry(inst, target);
+    }
+    else {
+        entry = rpl_find_routing_prefix(inst, target, prefix_len);
+    }
 
+    if ((entry != NULL) && rpl_equal_id(&entry->next_hop, next_hop)) {
+        rpl_remove_routing_entry(inst, entry);
+    }
 }
 
 void recv_rpl_dao(void)
 {
     DEBUG("%s, %d: Received DAO with ", __FILE__, __LINE__);
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
+    ipv6_buf = get_rpl_ipv6_buf();
+    rpl_dao_buf = get_rpl_dao_buf();
+    DEBUG("instance %04X ", rpl_dao_buf->rpl_instanceid);
+    DEBUG("sequence %04X\n", rpl_dao_buf->dao_sequence);
+
+    rpl_instance_t *inst = rpl_get_instance(rpl_dao_buf->rpl_instanceid);
+    rpl_dodag_t *my_dodag = (inst != NULL) ? rpl_get_joined_dodag(inst) : NULL;
 
     if (my_dodag == NULL) {
         DEBUG("%s, %d: [Error] got DAO although not a DODAG\n", __FILE__, __LINE__);
         return;
     }
 
-    ipv6_buf = get_rpl_ipv6_buf();
-    rpl_dao_buf = get_rpl_dao_buf();
-    DEBUG("instance %04X ", rpl_dao_buf->rpl_instanceid);
-    DEBUG("sequence %04X\n", rpl_dao_buf->dao_sequence);
+    if ((my_dodag->mop == NON_STORING_MODE) && !inst->root) {
+        DEBUG("%s, %d: [Error] got DAO although not root of a non-storing DODAG\n", __FILE__, __LINE__);
+        return;
+    }
 
     int len = DAO_BASE_LEN;
-    uint8_t increment_seq = 0;
+    uint16_t changes = inst->dao_changes;
 
     while (len < (NTOHS(ipv6_buf->length) - ICMPV6_HDR_LEN)) {
         rpl_opt_buf = get_rpl_opt_buf(len);
@@ -859,11 +1344,6 @@ void recv_rpl_dao(void)
             case (RPL_OPT_TARGET): {
                 rpl_opt_target_buf = get_rpl_opt_target_buf(len);
 
-                if (rpl_opt_target_buf->prefix_length != RPL_DODAG_ID_LEN) {
-                    DEBUG("%s, %d: prefixes are not supported yet", __FILE__, __LINE__);
-                    break;
-                }
-
                 len += rpl_opt_target_buf->length + 2;
                 rpl_opt_transit_buf = get_rpl_opt_transit_buf(len);
 
@@ -873,14 +1353,38 @@ void recv_rpl_dao(void)
                 }
 
                 len += rpl_opt_transit_buf->length + 2;
+
+                /* non-storing mode: the next hop is the target's parent,
+                 * the root follows them to build source routes */
+                ipv6_addr_t *next_hop = &ipv6_buf->srcaddr;
+
+                if ((my_dodag->mop == NON_STORING_MODE) &&
+                    (rpl_opt_transit_buf->length >= RPL_OPT_TRANSIT_PARENT_LEN)) {
+                    next_hop = (ipv6_addr_t *)((uint8_t *) rpl_opt_transit_buf +
+                                               sizeof(rpl_opt_transit_t));
+                }
+
                 /* route lifetime seconds = (DAO lifetime) * (Unit Lifetime) */
                 DEBUG("%s, %d: Adding routing information: Target: %s, Source: %s, Lifetime: %u\n", 
                         __FILE__, __LINE__,
                         ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, &ipv6_buf->srcaddr),
                         ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, &ipv6_buf->srcaddr),
                         (rpl_opt_transit_buf->path_lifetime * my_dodag->lifetime_unit));
-                rpl_add_routing_entry(&rpl_opt_target_buf->target, &ipv6_buf->srcaddr, rpl_opt_transit_buf->path_lifetime * my_dodag->lifetime_unit);
-                increment_seq = 1;
+                /* RPL_DODAG_ID_LEN is what older nodes put in for a full address */
+                uint8_t prefix_len = rpl_opt_target_buf->prefix_length;
+
+                if (prefix_len == RPL_DODAG_ID_LEN) {
+                    prefix_len = RPL_HOST_ROUTE_PREFIX_LEN;
+                }
+
+                if (rpl_opt_transit_buf->path_lifetime == 0) {
+                    rpl_dao_nopath(inst, &rpl_opt_target_buf->target, prefix_len, next_hop);
+                }
+                else {
+                    rpl_add_routing_prefix(inst, &rpl_opt_target_buf->target, prefix_len,
+                                           next_hop, rpl_opt_transit_buf->path_lifetime * my_dodag->lifetime_unit);
+                }
+
                 break;
             }
 
@@ -899,25 +1403,21 @@ void recv_rpl_dao(void)
         }
     }
 
-    send_DAO_ACK(&ipv6_buf->srcaddr);
+    send_DAO_ACK(inst, &ipv6_buf->srcaddr, rpl_dao_buf->dao_sequence);
 
-    if (increment_seq) {
-        RPL_COUNTER_INCREMENT(my_dodag->dao_seq);
-        delay_dao();
+    /* only what changed our routes goes further up */
+    if (changes != inst->dao_changes) {
+        delay_dao(inst);
     }
 }
 
 void recv_rpl_dao_ack(void)
 {
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
-
-    if (my_dodag == NULL) {
-        return;
-    }
-
     rpl_dao_ack_buf = get_rpl_dao_ack_buf();
 
-    if (rpl_dao_ack_buf->rpl_instanceid != my_dodag->instance->id) {
+    rpl_instance_t *inst = rpl_get_instance(rpl_dao_ack_buf->rpl_instanceid);
+
+    if ((inst == NULL) || (rpl_get_joined_dodag(inst) == NULL)) {
         return;
     }
 
@@ -925,128 +1425,396 @@ void recv_rpl_dao_ack(void)
         return;
     }
 
-    dao_ack_received();
+    dao_ack_received(inst, rpl_dao_ack_buf->dao_sequence);
 
 }
 
 void rpl_send(ipv6_addr_t *destination, uint8_t *payload, uint16_t p_len, uint8_t next_header)
 {
-    uint8_t *p_ptr;
-    ipv6_send_buf = get_rpl_send_ipv6_buf();
-    p_ptr = get_rpl_send_payload_buf(ipv6_ext_hdr_len);
-    uint16_t packet_length = 0;
+    uint8_t buf[RPL_MSG_BUFSIZE];
+    rpl_msg_t msg = { (ipv6_hdr_t *) buf, sizeof(buf), 0 };
+    uint8_t *p_ptr = rpl_msg_put(&msg, p_len);
 
-    ipv6_send_buf->version_trafficclass = IPV6_VER;
-    ipv6_send_buf->trafficclass_flowlabel = 0;
-    ipv6_send_buf->flowlabel = 0;
-    ipv6_send_buf->nextheader = next_header;
-    ipv6_send_buf->hoplimit = MULTIHOP_HOPLIMIT;
-    ipv6_send_buf->length = HTONS(p_len);
+    /* RPL messages are ICMPv6 messages */
+    (void) next_header;
+
+    if (p_ptr == NULL) {
+        DEBUG("%s, %d: [Error] payload of %u bytes too big\n", __FILE__, __LINE__, p_len);
+        return;
+    }
 
-    memcpy(&(ipv6_send_buf->destaddr), destination, 16);
-    ipv6_net_if_get_best_src_addr(&(ipv6_send_buf->srcaddr), &(ipv6_send_buf->destaddr));
+    memcpy(p_ptr, payload, p_len);
+    rpl_msg_send(&msg, rpl_get_my_instance(), destination);
+}
 
-    icmp_send_buf = get_rpl_send_icmpv6_buf(ipv6_ext_hdr_len);
-    icmp_send_buf->checksum = icmpv6_csum(ipv6_send_buf, icmp_send_buf);
+/* Host routes are chained into hash buckets by interface identifier, prefix
+ * routes are kept in a single list sorted by descending prefix length, so the
+ * first match is the longest one. Unused entries form a free list. Each
+ * instance has a table of its own. */
+#define ROUTING_ENTRY(inst, link)   (&(inst)->routing_table[(link) - 1])
+#define ROUTING_LINK(inst, entry)   ((uint16_t)((entry) - (inst)->routing_table) + 1)
 
-    /* The packet was "assembled" in rpl.c. Therefore rpl_send_buf was used.
-     * Therefore memcpy is not needed because the payload is at the
-     * right memory location already. */
+static inline uint16_t *rpl_routing_bucket(rpl_instance_t *inst, ipv6_addr_t *addr)
+{
+    /* nodes of a DODAG share the prefix, so only the IID is hashed */
+    uint32_t h = addr->uint32[2] ^ addr->uint32[3];
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return &inst->routing_buckets[h & (RPL_ROUTING_HASH_BUCKETS - 1)];
+}
 
-    if (p_ptr != payload) {
-        memcpy(p_ptr, payload, p_len);
+static bool rpl_prefix_matches(ipv6_addr_t *prefix, ipv6_addr_t *addr, uint8_t prefix_len)
+{
+    uint8_t bytes = prefix_len / 8;
+    uint8_t bits = prefix_len % 8;
+
+    if (memcmp(prefix, addr, bytes) != 0) {
+        return false;
     }
 
-    packet_length = IPV6_HDR_LEN + p_len;
+    if (bits == 0) {
+        return true;
+    }
 
-    if (ipv6_addr_is_multicast(&ipv6_send_buf->destaddr)) {
-        ipv6_send_packet(ipv6_send_buf);
+    uint8_t mask = (uint8_t)(0xFF << (8 - bits));
+    return ((prefix->uint8[bytes] ^ addr->uint8[bytes]) & mask) == 0;
+}
+
+static rpl_routing_entry_t *rpl_alloc_routing_entry(rpl_instance_t *inst)
+{
+    if (inst->routing_free == RPL_ROUTING_ENTRY_NONE) {
+        DEBUG("%s, %d: [Error] routing table full\n", __FILE__, __LINE__);
+        return NULL;
     }
-    else {
-        /* find appropriate next hop before sending */
-        ipv6_addr_t *next_hop = rpl_get_next_hop(&ipv6_send_buf->destaddr);
 
-        if (next_hop == NULL) {
-            if (i_am_root) {
-                DEBUG("%s, %d: [Error] destination unknown\n", __FILE__, __LINE__);
-                return;
-            }
-            else {
-                next_hop = rpl_get_my_preferred_parent();
+    rpl_routing_entry_t *entry = ROUTING_ENTRY(inst, inst->routing_free);
+    inst->routing_free = entry->next;
+    return entry;
+}
 
-                if (next_hop == NULL) {
-                    DEBUG("%s, %d: [Error] no preferred parent, dropping package\n", __FILE__, __LINE__);
-                    return;
-                }
+static uint16_t *rpl_routing_list(rpl_instance_t *inst, rpl_routing_entry_t *entry)
+{
+    if (entry->prefix_len < RPL_HOST_ROUTE_PREFIX_LEN) {
+        return &inst->routing_prefixes;
+    }
+
+    return rpl_routing_bucket(inst, &entry->address);
+}
+
+static rpl_routing_entry_t *rpl_find_routing_prefix(rpl_instance_t *inst,
+        ipv6_addr_t *prefix, uint8_t prefix_len)
+{
+    for (uint16_t link = inst->routing_prefixes; link != RPL_ROUTING_ENTRY_NONE;
+         link = ROUTING_ENTRY(inst, link)->next) {
+        rpl_routing_entry_t *entry = ROUTING_ENTRY(inst, link);
+
+        if ((entry->prefix_len == prefix_len) &&
+            rpl_prefix_matches(&entry->address, prefix, prefix_len)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static ipv6_addr_t *rpl_instance_next_hop(rpl_instance_t *inst, ipv6_addr_t *addr)
+{
+    rpl_routing_entry_t *entry;
+    rpl_dodag_t *my_dodag = rpl_get_joined_dodag(inst);
+
+    if ((my_dodag == NULL) || (inst->root && (my_dodag->mop == NON_STORING_MODE))) {
+        /* the routing table holds parents, not next hops */
+        return NULL;
+    }
+
+    entry = rpl_find_routing_entry(inst, addr);
+
+    if (entry != NULL) {
+        return &entry->next_hop;
+    }
+
+    /* longest prefix match over aggregated routes */
+    for (uint16_t link = inst->routing_prefixes; link != RPL_ROUTING_ENTRY_NONE;
+         link = ROUTING_ENTRY(inst, link)->next) {
+        entry = ROUTING_ENTRY(inst, link);
+
+        if (rpl_prefix_matches(&entry->address, addr, entry->prefix_len)) {
+            return &entry->next_hop;
+        }
+    }
+
+    if (my_dodag->my_preferred_parent == NULL) {
+        return NULL;
+    }
+
+    return &my_dodag->my_preferred_parent->addr;
+}
+
+/* traffic class mapped to inst, 0 if there is none */
+static uint8_t rpl_instance_class(rpl_instance_t *inst)
+{
+    for (int i = 0; i < RPL_CLASS_MAP_SIZE; i++) {
+        if (class_map[i].used && (class_map[i].instanceid == inst->id)) {
+            return class_map[i].traffic_class;
+        }
+    }
+
+    return 0;
+}
+
+int rpl_set_class_instance(uint8_t traffic_class, uint8_t instanceid)
+{
+    int slot = -1;
+
+    /* ECN is set on the way, only the DSCP selects the instance */
+    traffic_class &= ~IPV6_TC_ECN_MASK;
+
+    for (int i = RPL_CLASS_MAP_SIZE - 1; i >= 0; i--) {
+        if (!class_map[i].used) {
+            slot = i;
+        }
+        else if (class_map[i].traffic_class == traffic_class) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0) {
+        return -1;
+    }
+
+    class_map[slot].used = 1;
+    class_map[slot].traffic_class = traffic_class;
+    class_map[slot].instanceid = instanceid;
+    return 0;
+}
+
+rpl_instance_t *rpl_get_class_instance(uint8_t traffic_class)
+{
+    traffic_class &= ~IPV6_TC_ECN_MASK;
+
+    for (int i = 0; i < RPL_CLASS_MAP_SIZE; i++) {
+        if (class_map[i].used && (class_map[i].traffic_class == traffic_class)) {
+            rpl_instance_t *inst = rpl_get_instance(class_map[i].instanceid);
+
+            if ((inst != NULL) && inst->joined) {
+                return inst;
             }
+
+            break;
         }
+    }
+
+    return rpl_get_my_instance();
+}
+
+ipv6_addr_t *rpl_get_next_hop_class(ipv6_addr_t *addr, uint8_t traffic_class)
+{
+    rpl_instance_t *inst = rpl_get_class_instance(traffic_class);
 
-        ipv6_send_packet(ipv6_send_buf);
+    if (inst == NULL) {
+        return NULL;
     }
 
+    return rpl_instance_next_hop(inst, addr);
 }
 
 ipv6_addr_t *rpl_get_next_hop(ipv6_addr_t *addr)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (routing_table[i].used && rpl_equal_id(&routing_table[i].address, addr)) {
-            return &routing_table[i].next_hop;
+    return rpl_get_next_hop_class(addr, 0);
+}
+
+int rpl_get_source_route(ipv6_addr_t *addr, ipv6_addr_t *hops, uint8_t max)
+{
+    rpl_instance_t *inst = NULL;
+    rpl_routing_entry_t *entry = NULL;
+    int numof = 0;
+
+    /* the first non-storing DODAG we are root of with a route to addr */
+    for (int i = 0; (i < RPL_MAX_INSTANCES) && (entry == NULL); i++) {
+        inst = &instances[i];
+
+        if (inst->root && rpl_is_non_storing(inst)) {
+            entry = rpl_find_routing_entry(inst, addr);
+        }
+    }
+
+    /* follow the parents up to us, a loop ends when max is exceeded */
+    while (entry != NULL) {
+        if (rpl_equal_id(&entry->next_hop, &my_address)) {
+            /* collected from the destination upwards, reverse */
+            for (int i = 0; i < numof / 2; i++) {
+                ipv6_addr_t tmp = hops[i];
+                hops[i] = hops[numof - 1 - i];
+                hops[numof - 1 - i] = tmp;
+            }
+
+            return numof;
         }
+
+        if (numof == max) {
+            break;
+        }
+
+        hops[numof++] = entry->next_hop;
+        entry = rpl_find_routing_entry(inst, &entry->next_hop);
+    }
+
+    return -1;
+}
+
+void rpl_add_routing_entry(rpl_instance_t *inst, ipv6_addr_t *addr,
+                           ipv6_addr_t *next_hop, uint16_t lifetime)
+{
+    rpl_routing_entry_t *entry = rpl_find_routing_entry(inst, addr);
+
+    if (entry != NULL) {
+        /* the route may have moved to another child or parent */
+        entry->next_hop = *next_hop;
+        entry->lifetime = lifetime;
+        return;
+    }
+
+    entry = rpl_alloc_routing_entry(inst);
+
+    if (entry == NULL) {
+        return;
     }
 
-    return (rpl_get_my_preferred_parent());
+    uint16_t *bucket = rpl_routing_bucket(inst, addr);
+
+    entry->address = *addr;
+    entry->next_hop = *next_hop;
+    entry->lifetime = lifetime;
+    entry->prefix_len = RPL_HOST_ROUTE_PREFIX_LEN;
+    entry->used = 1;
+    entry->next = *bucket;
+    *bucket = ROUTING_LINK(inst, entry);
+    rpl_dao_mark(inst, entry);
 }
 
-void rpl_add_routing_entry(ipv6_addr_t *addr, ipv6_addr_t *next_hop, uint16_t lifetime)
+void rpl_add_routing_prefix(rpl_instance_t *inst, ipv6_addr_t *prefix,
+                            uint8_t prefix_len, ipv6_addr_t *next_hop,
+                            uint16_t lifetime)
 {
-    rpl_routing_entry_t *entry = rpl_find_routing_entry(addr);
+    if (prefix_len >= RPL_HOST_ROUTE_PREFIX_LEN) {
+        rpl_add_routing_entry(inst, prefix, next_hop, lifetime);
+        return;
+    }
+
+    rpl_routing_entry_t *entry = rpl_find_routing_prefix(inst, prefix, prefix_len);
 
     if (entry != NULL) {
         entry->lifetime = lifetime;
         return;
     }
 
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (!routing_table[i].used) {
-            routing_table[i].address = *addr;
-            routing_table[i].next_hop = *next_hop;
-            routing_table[i].lifetime = lifetime;
-            routing_table[i].used = 1;
+    entry = rpl_alloc_routing_entry(inst);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    uint8_t bytes = prefix_len / 8;
+
+    memset(&entry->address, 0, sizeof(entry->address));
+    memcpy(&entry->address, prefix, bytes);
+
+    if (prefix_len % 8) {
+        entry->address.uint8[bytes] = prefix->uint8[bytes] & (uint8_t)(0xFF << (8 - (prefix_len % 8)));
+    }
+
+    entry->next_hop = *next_hop;
+    entry->lifetime = lifetime;
+    entry->prefix_len = prefix_len;
+    entry->used = 1;
+
+    /* keep list sorted by descending prefix length */
+    uint16_t *link = &inst->routing_prefixes;
+
+    while ((*link != RPL_ROUTING_ENTRY_NONE) &&
+           (ROUTING_ENTRY(inst, *link)->prefix_len >= prefix_len)) {
+        link = &ROUTING_ENTRY(inst, *link)->next;
+    }
+
+    entry->next = *link;
+    *link = ROUTING_LINK(inst, entry);
+    rpl_dao_mark(inst, entry);
+}
+
+void rpl_remove_routing_entry(rpl_instance_t *inst, rpl_routing_entry_t *entry)
+{
+    uint16_t target = ROUTING_LINK(inst, entry);
+    uint16_t *link = rpl_routing_list(inst, entry);
+
+    rpl_dao_withdraw(inst, entry);
+
+    while (*link != RPL_ROUTING_ENTRY_NONE) {
+        if (*link == target) {
+            *link = entry->next;
             break;
         }
+
+        link = &ROUTING_ENTRY(inst, *link)->next;
     }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->next = inst->routing_free;
+    inst->routing_free = target;
 }
 
-void rpl_del_routing_entry(ipv6_addr_t *addr)
+void rpl_del_routing_entry(rpl_instance_t *inst, ipv6_addr_t *addr)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (routing_table[i].used && rpl_equal_id(&routing_table[i].address, addr)) {
-            memset(&routing_table[i], 0, sizeof(routing_table[i]));
-            return;
-        }
+    rpl_routing_entry_t *entry = rpl_find_routing_entry(inst, addr);
+
+    if (entry != NULL) {
+        rpl_remove_routing_entry(inst, entry);
+    }
+}
+
+void rpl_del_routing_prefix(rpl_instance_t *inst, ipv6_addr_t *prefix,
+                            uint8_t prefix_len)
+{
+    if (prefix_len >= RPL_HOST_ROUTE_PREFIX_LEN) {
+        rpl_del_routing_entry(inst, prefix);
+        return;
+    }
+
+    rpl_routing_entry_t *entry = rpl_find_routing_prefix(inst, prefix, prefix_len);
+
+    if (entry != NULL) {
+        rpl_remove_routing_entry(inst, entry);
     }
 }
 
-rpl_routing_entry_t *rpl_find_routing_entry(ipv6_addr_t *addr)
+rpl_routing_entry_t *rpl_find_routing_entry(rpl_instance_t *inst, ipv6_addr_t *addr)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (routing_table[i].used && rpl_equal_id(&routing_table[i].address, addr)) {
-            return &routing_table[i];
+    for (uint16_t link = *rpl_routing_bucket(inst, addr); link != RPL_ROUTING_ENTRY_NONE;
+         link = ROUTING_ENTRY(inst, link)->next) {
+        if (rpl_equal_id(&ROUTING_ENTRY(inst, link)->address, addr)) {
+            return ROUTING_ENTRY(inst, link);
         }
     }
 
     return NULL;
 }
 
-void rpl_clear_routing_table(void)
+void rpl_clear_routing_table(rpl_instance_t *inst)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        memset(&routing_table[i], 0, sizeof(routing_table[i]));
+    memset(inst->routing_table, 0, sizeof(inst->routing_table));
+    memset(inst->routing_buckets, 0, sizeof(inst->routing_buckets));
+    inst->routing_prefixes = RPL_ROUTING_ENTRY_NONE;
+    inst->routing_free = RPL_ROUTING_ENTRY_NONE;
+
+    for (uint16_t i = RPL_MAX_ROUTING_ENTRIES; i > 0; i--) {
+        inst->routing_table[i - 1].next = inst->routing_free;
+        inst->routing_free = i;
     }
-
 }
 
 rpl_routing_entry_t *rpl_get_routing_table(void)
 {
-    return routing_table;
+    rpl_instance_t *inst = rpl_get_my_instance();
+
+    return (inst != NULL) ? inst->routing_table : NULL;
 }
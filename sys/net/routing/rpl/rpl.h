@@ -33,16 +33,51 @@
 #define CC1100_RADIO_MODE CC1100_MODE_WOR
 
 #define RPL_PKT_RECV_BUF_SIZE 16
-#define RPL_PROCESS_STACKSIZE KERNEL_CONF_STACKSIZE_DEFAULT
+
+/**
+ * @brief Buffer of an outgoing control message, room for the IPv6 header,
+ *        the message and a source routing header inserted when it is sent
+ */
+#define RPL_MSG_BUFSIZE (IPV6_MTU)
+
+/* the senders keep their message on the stack */
+#define RPL_PROCESS_STACKSIZE (KERNEL_CONF_STACKSIZE_DEFAULT + RPL_MSG_BUFSIZE)
+
+/**
+ * @brief An outgoing control message, built in a buffer of the caller
+ *
+ * Every sender has a buffer of its own, so messages are built and sent
+ * without a lock and without copying.
+ */
+typedef struct {
+    ipv6_hdr_t *ipv6;   /**< the buffer, starting with the IPv6 header */
+    uint16_t size;      /**< size of the buffer */
+    uint16_t len;       /**< length of the ICMPv6 message so far */
+} rpl_msg_t;
+
+/**
+ * @brief Entries of the map of traffic classes to instances
+ */
+#ifndef RPL_CLASS_MAP_SIZE
+#define RPL_CLASS_MAP_SIZE (4)
+#endif
 
 uint8_t rpl_init(int if_id);
 void rpl_init_root(void);
+int rpl_init_root_instance(uint8_t instanceid, uint16_t ocp);
 rpl_of_t *rpl_get_of_for_ocp(uint16_t ocp);
 
-void send_DIO(ipv6_addr_t *destination);
+void rpl_msg_init(rpl_msg_t *msg, uint8_t *buf, uint16_t size, uint8_t code);
+void *rpl_msg_put(rpl_msg_t *msg, uint16_t len);
+uint16_t rpl_msg_room(const rpl_msg_t *msg);
+void rpl_msg_send(rpl_msg_t *msg, rpl_instance_t *inst, ipv6_addr_t *destination);
+void rpl_dio_changed(rpl_instance_t *inst);
+void send_DIO(rpl_instance_t *inst, ipv6_addr_t *destination);
 void send_DIS(ipv6_addr_t *destination);
-void send_DAO(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint8_t start_index);
-void send_DAO_ACK(ipv6_addr_t *destination);
+void send_DAO(rpl_instance_t *inst, ipv6_addr_t *destination, uint8_t lifetime,
+              bool default_lifetime, uint8_t start_index);
+void send_DAO_pending(rpl_instance_t *inst);
+void send_DAO_ACK(rpl_instance_t *inst, ipv6_addr_t *destination, uint8_t sequence);
 void rpl_process(void);
 void recv_rpl_dio(void);
 void recv_rpl_dis(void);
@@ -50,10 +85,39 @@ void recv_rpl_dao(void);
 void recv_rpl_dao_ack(void);
 void rpl_send(ipv6_addr_t *destination, uint8_t *payload, uint16_t p_len, uint8_t next_header);
 ipv6_addr_t *rpl_get_next_hop(ipv6_addr_t *addr);
-void rpl_add_routing_entry(ipv6_addr_t *addr, ipv6_addr_t *next_hop, uint16_t lifetime);
-void rpl_del_routing_entry(ipv6_addr_t *addr);
-rpl_routing_entry_t *rpl_find_routing_entry(ipv6_addr_t *addr);
-void rpl_clear_routing_table(void);
+ipv6_addr_t *rpl_get_next_hop_class(ipv6_addr_t *addr, uint8_t traffic_class);
+
+/**
+ * @brief   Routes packets of a traffic class in an instance, for
+ *          ipv6_iface_set_class_routing_provider(rpl_get_next_hop_class)
+ *
+ * The ECN bits of the class are ignored.  Classes without an entry are
+ * routed in the first instance joined.
+ *
+ * @param[in] traffic_class     the class, e.g. a DSCP shifted left by 2
+ * @param[in] instanceid        the instance, need not be joined yet
+ *
+ * @return  0 on success, -1 if the map is full
+ */
+int rpl_set_class_instance(uint8_t traffic_class, uint8_t instanceid);
+rpl_instance_t *rpl_get_class_instance(uint8_t traffic_class);
+void rpl_start_dio_trickle(rpl_dodag_t *dodag);
+void delay_dao(rpl_instance_t *inst);
+void dao_ack_received(rpl_instance_t *inst, uint8_t sequence);
+void rpl_dao_set_aggregate(ipv6_addr_t *prefix, uint8_t prefix_len);
+int rpl_get_source_route(ipv6_addr_t *addr, ipv6_addr_t *hops, uint8_t max);
+void rpl_add_routing_entry(rpl_instance_t *inst, ipv6_addr_t *addr,
+                           ipv6_addr_t *next_hop, uint16_t lifetime);
+void rpl_add_routing_prefix(rpl_instance_t *inst, ipv6_addr_t *prefix,
+                            uint8_t prefix_len, ipv6_addr_t *next_hop,
+                            uint16_t lifetime);
+void rpl_del_routing_entry(rpl_instance_t *inst, ipv6_addr_t *addr);
+void rpl_del_routing_prefix(rpl_instance_t *inst, ipv6_addr_t *prefix,
+                            uint8_t prefix_len);
+void rpl_remove_routing_entry(rpl_instance_t *inst, rpl_routing_entry_t *entry);
+rpl_routing_entry_t *rpl_find_routing_entry(rpl_instance_t *inst, ipv6_addr_t *addr);
+void rpl_clear_routing_table(rpl_instance_t *inst);
+/* routing table of the first instance joined, NULL if there is none */
 rpl_routing_entry_t *rpl_get_routing_table(void);
 
 /** @} */
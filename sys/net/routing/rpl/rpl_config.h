@@ -43,6 +43,8 @@
 #define RPL_OPT_SOLICITED_INFO_LEN  19
 #define RPL_OPT_TARGET_LEN          18
 #define RPL_OPT_TRANSIT_LEN         4
+/* transit option carrying the parent address (non-storing mode) */
+#define RPL_OPT_TRANSIT_PARENT_LEN  20
 
 /* message options */
 #define RPL_OPT_PAD1                 0
@@ -92,7 +94,9 @@ static inline bool RPL_COUNTER_GREATER_THAN(uint8_t A,uint8_t B)
 
 /*  RPL Constants and Variables */
 
+#ifndef RPL_DEFAULT_MOP
 #define RPL_DEFAULT_MOP STORING_MODE_NO_MC
+#endif
 #define BASE_RANK 0
 #define INFINITE_RANK 0xFFFF
 #define RPL_DEFAULT_INSTANCE 0
@@ -111,15 +115,36 @@ static inline bool RPL_COUNTER_GREATER_THAN(uint8_t A,uint8_t B)
 #define REGULAR_DAO_INTERVAL 300
 #define DAO_SEND_RETRIES 4
 #define DEFAULT_WAIT_FOR_DAO_ACK 15
+/* targets in one DAO, so packets don't get too big */
+#define RPL_DAO_TARGETS_MAX 5
+/* removed targets waiting to be withdrawn */
+#define RPL_DAO_NOPATH_MAX 8
+/* seconds between DAOs with all targets, below the route lifetime */
+#ifndef RPL_DAO_REFRESH_INTERVAL
+#define RPL_DAO_REFRESH_INTERVAL REGULAR_DAO_INTERVAL
+#endif
 #define RPL_DODAG_ID_LEN 16
 
 /* others */
 
 #define NUMBER_IMPLEMENTED_OFS 2
 #define RPL_MAX_DODAGS 3
+/* each instance has a routing table of its own */
+#ifndef RPL_MAX_INSTANCES
 #define RPL_MAX_INSTANCES 1
+#endif
 #define RPL_MAX_PARENTS 5
+/* in non-storing mode only the root fills the routing table, with the
+ * parent of each node as next_hop, so other nodes can make it small */
+#ifndef RPL_MAX_ROUTING_ENTRIES
 #define RPL_MAX_ROUTING_ENTRIES 128
+#endif
+/* number of hash buckets for host routes, must be a power of two */
+#define RPL_ROUTING_HASH_BUCKETS 32
+/* prefix length (in bit) of a host route */
+#define RPL_HOST_ROUTE_PREFIX_LEN 128
+/* routing table links are stored as (index + 1), this terminates a list */
+#define RPL_ROUTING_ENTRY_NONE 0
 #define RPL_ROOT_RANK 256
 #define RPL_DEFAULT_LIFETIME 0xff
 #define RPL_LIFETIME_UNIT 2
@@ -20,7 +20,6 @@
 #include <stdio.h>
 
 #include "rpl_dodag.h"
-#include "trickle.h"
 #include "rpl.h"
 
 #define ENABLE_DEBUG (0)
@@ -48,6 +47,7 @@ rpl_instance_t *rpl_new_instance(uint8_t instanceid)
             memset(inst, 0, sizeof(*inst));
             inst->used = 1;
             inst->id = instanceid;
+            rpl_clear_routing_table(inst);
             return inst;
         }
     }
@@ -76,6 +76,17 @@ rpl_instance_t *rpl_get_my_instance()
     return NULL;
 }
 
+rpl_dodag_t *rpl_get_joined_dodag(rpl_instance_t *inst)
+{
+    for (int i = 0; i < RPL_MAX_DODAGS; i++) {
+        if (dodags[i].joined && (dodags[i].instance == inst)) {
+            return &dodags[i];
+        }
+    }
+
+    return NULL;
+}
+
 rpl_dodag_t *rpl_new_dodag(uint8_t instanceid, ipv6_addr_t *dodagid)
 {
     rpl_instance_t *inst;
@@ -127,6 +138,10 @@ rpl_dodag_t *rpl_get_my_dodag()
 }
 void rpl_del_dodag(rpl_dodag_t *dodag)
 {
+    if (dodag->instance != NULL) {
+        rpl_dio_changed(dodag->instance);
+    }
+
     memset(dodag, 0, sizeof(*dodag));
 }
 
@@ -134,7 +149,7 @@ void rpl_leave_dodag(rpl_dodag_t *dodag)
 {
     dodag->joined = 0;
     dodag->my_preferred_parent = NULL;
-    rpl_delete_all_parents();
+    rpl_delete_all_parents(dodag);
 }
 
 bool rpl_equal_id(ipv6_addr_t *id1, ipv6_addr_t *id2)
@@ -172,13 +187,33 @@ rpl_parent_t *rpl_new_parent(rpl_dodag_t *dodag, ipv6_addr_t *address, uint16_t
     return rpl_new_parent(dodag, address, rank);
 }
 
-rpl_parent_t *rpl_find_parent(ipv6_addr_t *address)
+void rpl_parent_set_rank(rpl_parent_t *parent, uint16_t rank)
+{
+    if (parent->rank != rank) {
+        parent->rank = rank;
+        parent->path_cost_valid = 0;
+    }
+}
+
+/* link metric of a neighbor changed, the OF has to recalculate its path cost */
+void rpl_parent_metric_changed(ipv6_addr_t *address)
+{
+    /* the neighbor may be a parent in several instances */
+    for (int i = 0; i < RPL_MAX_PARENTS; i++) {
+        if (parents[i].used && rpl_equal_id(address, &parents[i].addr)) {
+            parents[i].path_cost_valid = 0;
+        }
+    }
+}
+
+rpl_parent_t *rpl_find_parent(rpl_dodag_t *dodag, ipv6_addr_t *address)
 {
     rpl_parent_t *parent;
     rpl_parent_t *end;
 
     for (parent = &parents[0], end = parents + RPL_MAX_PARENTS; parent < end; parent++) {
-        if ((parent->used) && (rpl_equal_id(address, &parent->addr))) {
+        if ((parent->used) && (parent->dodag == dodag) &&
+            (rpl_equal_id(address, &parent->addr))) {
             return parent;
         }
     }
@@ -188,11 +223,10 @@ rpl_parent_t *rpl_find_parent(ipv6_addr_t *address)
 
 void rpl_delete_parent(rpl_parent_t *parent)
 {
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
+    rpl_dodag_t *dodag = parent->dodag;
 
-    if ((my_dodag != NULL) && rpl_equal_id(&my_dodag->my_preferred_parent->addr,
-                                           &parent->addr)) {
-        my_dodag->my_preferred_parent = NULL;
+    if ((dodag != NULL) && (dodag->my_preferred_parent == parent)) {
+        dodag->my_preferred_parent = NULL;
     }
 
     memset(parent, 0, sizeof(*parent));
@@ -219,31 +253,23 @@ void rpl_delete_worst_parent(void)
 
 }
 
-void rpl_delete_all_parents(void)
+void rpl_delete_all_parents(rpl_dodag_t *dodag)
 {
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
-
-    if (my_dodag != NULL) {
-        my_dodag->my_preferred_parent = NULL;
-    }
+    dodag->my_preferred_parent = NULL;
 
     for (int i = 0; i < RPL_MAX_PARENTS; i++) {
-        memset(&parents[i], 0, sizeof(parents[i]));
+        if (parents[i].dodag == dodag) {
+            memset(&parents[i], 0, sizeof(parents[i]));
+        }
     }
 }
 
-rpl_parent_t *rpl_find_preferred_parent(void)
+rpl_parent_t *rpl_find_preferred_parent(rpl_dodag_t *my_dodag)
 {
     rpl_parent_t *best = NULL;
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
-
-    if (my_dodag == NULL) {
-        DEBUG("Not part of a dodag\n");
-        return NULL;
-    }
 
     for (uint8_t i = 0; i < RPL_MAX_PARENTS; i++) {
-        if (parents[i].used) {
+        if (parents[i].used && (parents[i].dodag == my_dodag)) {
             if ((parents[i].rank == INFINITE_RANK) || (parents[i].lifetime <= 1)) {
                 DEBUG("Infinite rank, bad parent\n");
                 continue;
@@ -267,33 +293,30 @@ rpl_parent_t *rpl_find_preferred_parent(void)
     }
 
     if (!rpl_equal_id(&my_dodag->my_preferred_parent->addr, &best->addr)) {
-        if (my_dodag->mop != NO_DOWNWARD_ROUTES) {
-            /* send DAO with ZERO_LIFETIME to old parent */
-            send_DAO(&my_dodag->my_preferred_parent->addr, 0, false, 0);
+        if ((my_dodag->mop != NO_DOWNWARD_ROUTES) &&
+            (my_dodag->mop != NON_STORING_MODE)) {
+            /* send DAO with ZERO_LIFETIME to old parent, in non-storing
+             * mode the next DAO just updates the root */
+            send_DAO(my_dodag->instance, &my_dodag->my_preferred_parent->addr,
+                     0, false, 0);
         }
 
         my_dodag->my_preferred_parent = best;
 
         if (my_dodag->mop != NO_DOWNWARD_ROUTES) {
-            delay_dao();
+            delay_dao(my_dodag->instance);
         }
 
-        reset_trickletimer();
+        trickle_reset_timer(&my_dodag->instance->trickle);
     }
 
     return best;
 }
 
-void rpl_parent_update(rpl_parent_t *parent)
+void rpl_parent_update(rpl_dodag_t *my_dodag, rpl_parent_t *parent)
 {
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
     uint16_t old_rank;
 
-    if (my_dodag == NULL) {
-        DEBUG("Not part of a dodag - this should not happen");
-        return;
-    }
-
     old_rank = my_dodag->my_rank;
 
     /* update Parent lifetime */
@@ -301,8 +324,8 @@ void rpl_parent_update(rpl_parent_t *parent)
         parent->lifetime = my_dodag->default_lifetime * my_dodag->lifetime_unit;
     }
 
-    if (rpl_find_preferred_parent() == NULL) {
-        rpl_local_repair();
+    if (rpl_find_preferred_parent(my_dodag) == NULL) {
+        rpl_local_repair(my_dodag);
     }
 
     if (rpl_calc_rank(old_rank, my_dodag->minhoprankincrease) !=
@@ -311,7 +334,7 @@ void rpl_parent_update(rpl_parent_t *parent)
             my_dodag->min_rank = my_dodag->my_rank;
         }
 
-        reset_trickletimer();
+        trickle_reset_timer(&my_dodag->instance->trickle);
     }
 }
 
@@ -325,7 +348,7 @@ void rpl_join_dodag(rpl_dodag_t *dodag, ipv6_addr_t *parent, uint16_t parent_ran
         return;
     }
 
-    preferred_parent = rpl_new_parent(dodag, parent, parent_rank);
+    preferred_parent = rpl_new_parent(my_dodag, parent, parent_rank);
 
     if (preferred_parent == NULL) {
         rpl_del_dodag(my_dodag);
@@ -352,6 +375,7 @@ void rpl_join_dodag(rpl_dodag_t *dodag, ipv6_addr_t *parent, uint16_t parent_ran
     my_dodag->my_rank = dodag->of->calc_rank(preferred_parent, dodag->my_rank);
     my_dodag->dao_seq = RPL_COUNTER_INIT;
     my_dodag->min_rank = my_dodag->my_rank;
+    rpl_dio_changed(my_dodag->instance);
     DEBUG("Joint DODAG:\n");
     DEBUG("\tMOP:\t%02X\n", my_dodag->mop);
     DEBUG("\tminhoprankincrease :\t%04X\n", my_dodag->minhoprankincrease);
@@ -363,21 +387,21 @@ void rpl_join_dodag(rpl_dodag_t *dodag, ipv6_addr_t *parent, uint16_t parent_ran
     DEBUG("\tmy_preferred_parent rank\t%02X\n", my_dodag->my_preferred_parent->rank);
     DEBUG("\tmy_preferred_parent lifetime\t%04X\n", my_dodag->my_preferred_parent->lifetime);
 
-    start_trickle(my_dodag->dio_min, my_dodag->dio_interval_doubling, my_dodag->dio_redundancy);
-    delay_dao();
+    rpl_start_dio_trickle(my_dodag);
+    delay_dao(my_dodag->instance);
 }
 
 void rpl_global_repair(rpl_dodag_t *dodag, ipv6_addr_t *p_addr, uint16_t rank)
 {
     puts("[INFO] Global repair started");
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
+    rpl_dodag_t *my_dodag = rpl_get_joined_dodag(dodag->instance);
 
     if (my_dodag == NULL) {
         printf("[Error] - no global repair possible, if not part of a DODAG\n");
         return;
     }
 
-    rpl_delete_all_parents();
+    rpl_delete_all_parents(my_dodag);
     my_dodag->version = dodag->version;
     my_dodag->dtsn++;
     my_dodag->my_preferred_parent = rpl_new_parent(my_dodag, p_addr, rank);
@@ -391,28 +415,22 @@ void rpl_global_repair(rpl_dodag_t *dodag, ipv6_addr_t *p_addr, uint16_t rank)
         my_dodag->my_rank = my_dodag->of->calc_rank(my_dodag->my_preferred_parent,
                             my_dodag->my_rank);
         my_dodag->min_rank = my_dodag->my_rank;
-        reset_trickletimer();
-        delay_dao();
+        trickle_reset_timer(&my_dodag->instance->trickle);
+        delay_dao(my_dodag->instance);
     }
 
     printf("Migrated to DODAG Version %d. My new Rank: %d\n", my_dodag->version,
            my_dodag->my_rank);
 }
 
-void rpl_local_repair(void)
+void rpl_local_repair(rpl_dodag_t *my_dodag)
 {
     puts("[INFO] Local Repair started");
-    rpl_dodag_t *my_dodag = rpl_get_my_dodag();
-
-    if (my_dodag == NULL) {
-        printf("[Error] - no local repair possible, if not part of a DODAG\n");
-        return;
-    }
 
     my_dodag->my_rank = INFINITE_RANK;
     my_dodag->dtsn++;
-    rpl_delete_all_parents();
-    reset_trickletimer();
+    rpl_delete_all_parents(my_dodag);
+    trickle_reset_timer(&my_dodag->instance->trickle);
 
 }
 
@@ -17,6 +17,9 @@
 
 #include <string.h>
 #include "ipv6.h"
+#include "trickle.h"
+#include "vtimer.h"
+#include "rpl_config.h"
 
 #ifndef RPL_STRUCTS_H_INCLUDED
 #define RPL_STRUCTS_H_INCLUDED
@@ -124,15 +127,67 @@ typedef struct {
     double              link_metric;
     uint8_t             link_metric_type;
     uint8_t             used;
+    uint16_t            path_cost;          /* cached by the OF */
+    uint8_t             path_cost_valid;    /* cleared on rank or metric change */
 } rpl_parent_t;
 
 struct rpl_of_t;
 
+typedef struct {
+    uint8_t used;
+    ipv6_addr_t address;
+    ipv6_addr_t next_hop;
+    uint16_t lifetime;
+    uint8_t prefix_len;     /* RPL_HOST_ROUTE_PREFIX_LEN for host routes */
+    uint16_t next;          /* next entry in hash bucket or prefix list */
+    uint8_t dao;            /* not yet acknowledged by the parent */
+    uint8_t dao_seq;        /* sequence of the DAO that carried it */
+} rpl_routing_entry_t;
+
+/* removed target waiting to be withdrawn */
+typedef struct {
+    ipv6_addr_t target;
+    uint8_t prefix_len;
+    uint8_t dao;            /* 0 if the entry is free */
+    uint8_t dao_seq;
+} rpl_dao_nopath_t;
+
+/* the last DIO sent, reused while the DODAG's version, rank and DTSN stay
+ * the same; rpl_dio_changed() drops it when the configuration changes */
+typedef struct {
+    struct rpl_dodag_t *dodag;
+    uint8_t version;
+    uint16_t rank;
+    uint8_t dtsn;
+    uint16_t sum;           /* icmpv6_csum_partial() of the message */
+    uint8_t msg[sizeof(icmpv6_hdr_t) + DIO_BASE_LEN + RPL_OPT_LEN +
+                RPL_OPT_DODAG_CONF_LEN];
+} rpl_dio_cache_t;
+
+/* An RPL instance: every instance has its own DODAG, routes and DAO state,
+ * so the same node may be root of one and router in another. */
 typedef struct {
     uint8_t id;
     uint8_t used;
     uint8_t joined;
-
+    uint8_t root;           /* we are the root of its DODAG */
+    trickle_t trickle;      /* DIO timer of the joined DODAG */
+    rpl_dio_cache_t dio_cache;
+    /* routes, see rpl.c */
+    rpl_routing_entry_t routing_table[RPL_MAX_ROUTING_ENTRIES];
+    uint16_t routing_buckets[RPL_ROUTING_HASH_BUCKETS];
+    uint16_t routing_prefixes;
+    uint16_t routing_free;
+    /* DAOs to the parent, see rpl.c */
+    vtimer_t dao_timer;
+    uint8_t dao_timer_state;
+    uint8_t dao_counter;
+    uint8_t own_dao;
+    uint8_t own_dao_seq;
+    uint16_t dao_refresh_in;
+    uint16_t dao_changes;
+    ipv6_addr_t dao_parent;
+    rpl_dao_nopath_t dao_nopaths[RPL_DAO_NOPATH_MAX];
 } rpl_instance_t;
 
 //Node-internal representation of a DODAG, with nodespecific information
@@ -172,12 +227,4 @@ typedef struct rpl_of_t {
     void (*process_dio)(void);  //DIO processing callback (acc. to OF0 spec, chpt 5)
 } rpl_of_t;
 
-typedef struct {
-    uint8_t used;
-    ipv6_addr_t address;
-    ipv6_addr_t next_hop;
-    uint16_t lifetime;
-
-} rpl_routing_entry_t;
-
 #endif
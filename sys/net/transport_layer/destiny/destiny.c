@@ -30,9 +30,9 @@
 #include "udp.h"
 
 char tcp_stack_buffer[TCP_STACK_SIZE];
+#if !SIXLOWPAN_RUN_TO_COMPLETION
 char udp_stack_buffer[UDP_STACK_SIZE];
-
-char tcp_timer_stack[TCP_TIMER_STACKSIZE];
+#endif
 
 int destiny_init_transport_layer(void)
 {
@@ -42,6 +42,9 @@ int destiny_init_transport_layer(void)
     memset(sockets, 0, MAX_SOCKETS * sizeof(socket_internal_t));
 
     /* UDP */
+#if SIXLOWPAN_RUN_TO_COMPLETION
+    ipv6_register_next_header_callback(IPV6_PROTO_NUM_UDP, udp_packet_process);
+#else
     int udp_thread_pid = thread_create(udp_stack_buffer, UDP_STACK_SIZE,
                                        PRIORITY_MAIN, CREATE_STACKTEST,
                                        udp_packet_handler, "udp_packet_handler");
@@ -51,6 +54,7 @@ int destiny_init_transport_layer(void)
     }
 
     ipv6_register_next_header_handler(IPV6_PROTO_NUM_UDP, udp_thread_pid);
+#endif
 
     /* TCP */
     timex_t now;
@@ -72,10 +76,11 @@ int destiny_init_transport_layer(void)
 
     ipv6_register_next_header_handler(IPV6_PROTO_NUM_TCP, tcp_thread_pid);
 
-    if (thread_create(tcp_timer_stack, TCP_TIMER_STACKSIZE, PRIORITY_MAIN + 1,
-                      CREATE_STACKTEST, tcp_general_timer, "tcp_general_timer") < 0) {
+    if (workqueue_init() < 0) {
         return -1;
     }
 
+    tcp_timer_init();
+
     return 0;
 }
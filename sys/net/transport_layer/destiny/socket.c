@@ -22,13 +22,17 @@
 
 #include "hwtimer.h"
 #include "ipv6.h"
+#include "irq.h"
 #include "thread.h"
 #include "vtimer.h"
 
 #include "net_help.h"
+#include "netstat.h"
+#include "sixlowpan/lowpan.h"
 
 #include "msg_help.h"
 #include "tcp.h"
+#include "tcp_cc.h"
 #include "tcp_hc.h"
 #include "tcp_timer.h"
 #include "udp.h"
@@ -110,6 +114,8 @@ void print_tcp_cb(tcp_cb_t *cb)
            cb->send_iss, cb->send_una, cb->send_nxt, cb->send_wnd);
     printf("Rcv_IRS: %" PRIu32 "\nRcv_NXT: %" PRIu32 "\nRcv_WND: %u\n",
            cb->rcv_irs, cb->rcv_nxt, cb->rcv_wnd);
+    printf("Cwnd: %u, Ssthresh: %u, Recovery: %u\n",
+           cb->cwnd, cb->ssthresh, cb->in_recovery);
     printf("Time difference: %" PRIu64 ", No_of_retries: %u, State: %u\n\n",
            timex_uint64(timex_sub(now, cb->last_packet_time)), cb->no_of_retries, cb->state);
 }
@@ -171,6 +177,89 @@ void print_internal_socket(socket_internal_t *current_socket_internal)
     printf("\n--------------------------\n");
 }
 
+/* Demultiplexing tables. Every socket with a local port is linked into the
+ * port table, every socket with a foreign port also into the connection
+ * table keyed on (local port, foreign address, foreign port). Links are
+ * socket IDs, 0 terminates a chain. */
+typedef struct {
+    uint8_t next;
+    uint8_t bucket;
+    uint8_t linked;
+} socket_link_t;
+
+static uint8_t socket_port_buckets[DESTINY_SOCKET_HASH_BUCKETS];
+static uint8_t socket_conn_buckets[DESTINY_SOCKET_HASH_BUCKETS];
+static socket_link_t socket_port_links[MAX_SOCKETS];
+static socket_link_t socket_conn_links[MAX_SOCKETS];
+
+static uint8_t socket_port_hash(uint16_t local_port)
+{
+    return (local_port ^ (local_port >> 8)) & (DESTINY_SOCKET_HASH_BUCKETS - 1);
+}
+
+static uint8_t socket_conn_hash(uint16_t local_port, const ipv6_addr_t *foreign_addr,
+                                uint16_t foreign_port)
+{
+    uint16_t hash = local_port ^ (foreign_port * 31);
+
+    /* the interface identifier differs most between peers */
+    for (int i = 8; i < 16; i++) {
+        hash = (hash * 31) + foreign_addr->uint8[i];
+    }
+
+    return (hash ^ (hash >> 8)) & (DESTINY_SOCKET_HASH_BUCKETS - 1);
+}
+
+static void socket_hash_link(uint8_t *buckets, socket_link_t *links, uint8_t id,
+                             uint8_t bucket)
+{
+    links[id - 1].next = buckets[bucket];
+    links[id - 1].bucket = bucket;
+    links[id - 1].linked = 1;
+    buckets[bucket] = id;
+}
+
+static void socket_hash_unlink(uint8_t *buckets, socket_link_t *links, uint8_t id)
+{
+    uint8_t *link;
+
+    if (!links[id - 1].linked) {
+        return;
+    }
+
+    for (link = &buckets[links[id - 1].bucket]; *link != 0;
+         link = &links[*link - 1].next) {
+        if (*link == id) {
+            *link = links[id - 1].next;
+            break;
+        }
+    }
+
+    links[id - 1].linked = 0;
+}
+
+/* Relinks a socket after its local or foreign address changed */
+static void socket_hash_update(socket_internal_t *current_socket)
+{
+    socket_t *values = &current_socket->socket_values;
+    uint8_t id = current_socket->socket_id;
+
+    socket_hash_unlink(socket_port_buckets, socket_port_links, id);
+    socket_hash_unlink(socket_conn_buckets, socket_conn_links, id);
+
+    if (values->local_address.sin6_port != 0) {
+        socket_hash_link(socket_port_buckets, socket_port_links, id,
+                         socket_port_hash(values->local_address.sin6_port));
+    }
+
+    if (values->foreign_address.sin6_port != 0) {
+        socket_hash_link(socket_conn_buckets, socket_conn_links, id,
+                         socket_conn_hash(values->local_address.sin6_port,
+                                          &values->foreign_address.sin6_addr,
+                                          values->foreign_address.sin6_port));
+    }
+}
+
 socket_internal_t *get_socket(int s)
 {
     if (exists_socket(s)) {
@@ -195,7 +284,8 @@ void destiny_socket_print_sockets(void)
 
 int exists_socket(int socket)
 {
-    if (sockets[socket - 1].socket_id == 0) {
+    if ((socket < 1) || (socket > MAX_SOCKETS) ||
+        (sockets[socket - 1].socket_id == 0)) {
         return false;
     }
     else {
@@ -203,8 +293,23 @@ int exists_socket(int socket)
     }
 }
 
+static void tcp_syn_cache_flush(socket_internal_t *listening_socket);
+
 void close_socket(socket_internal_t *current_socket)
 {
+    tcp_timer_stop(current_socket);
+
+    if (current_socket->socket_values.tcp_control.state == TCP_LISTEN) {
+        tcp_syn_cache_flush(current_socket);
+    }
+
+    if (current_socket->socket_id != 0) {
+        socket_hash_unlink(socket_port_buckets, socket_port_links,
+                           current_socket->socket_id);
+        socket_hash_unlink(socket_conn_buckets, socket_conn_links,
+                           current_socket->socket_id);
+    }
+
     memset(current_socket, 0, sizeof(socket_internal_t));
 }
 
@@ -236,42 +341,51 @@ bool is_tcp_socket(int s)
     }
 }
 
-int bind_udp_socket(int s, sockaddr6_t *name, int namelen, uint8_t pid)
+/* Returns whether a socket of *protocol* uses *port* (in network byte order) */
+static bool socket_port_in_use(uint8_t protocol, uint16_t port)
 {
-    int i;
+    uint8_t id = socket_port_buckets[socket_port_hash(port)];
+
+    for (; id != 0; id = socket_port_links[id - 1].next) {
+        socket_t *values = &sockets[id - 1].socket_values;
+
+        if ((values->local_address.sin6_port == port) &&
+            ((protocol == IPPROTO_TCP) ? is_tcp_socket(id) : isUDPSocket(id))) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
+int bind_udp_socket(int s, sockaddr6_t *name, int namelen, uint8_t pid)
+{
     if (!exists_socket(s)) {
         return -1;
     }
 
-    for (i = 1; i < MAX_SOCKETS + 1; i++) {
-        if (isUDPSocket(i) &&
-            (get_socket(i)->socket_values.local_address.sin6_port == name->sin6_port)) {
-            return -1;
-        }
+    if (socket_port_in_use(IPPROTO_UDP, name->sin6_port)) {
+        return -1;
     }
 
     memcpy(&get_socket(s)->socket_values.local_address, name, namelen);
+    socket_hash_update(get_socket(s));
     get_socket(s)->recv_pid = pid;
     return 0;
 }
 
 int bind_tcp_socket(int s, sockaddr6_t *name, int namelen, uint8_t pid)
 {
-    int i;
-
     if (!exists_socket(s)) {
         return -1;
     }
 
-    for (i = 1; i < MAX_SOCKETS + 1; i++) {
-        if (is_tcp_socket(i) &&
-            (get_socket(i)->socket_values.local_address.sin6_port == name->sin6_port)) {
-            return -1;
-        }
+    if (socket_port_in_use(IPPROTO_TCP, name->sin6_port)) {
+        return -1;
     }
 
     memcpy(&get_socket(s)->socket_values.local_address, name, namelen);
+    socket_hash_update(get_socket(s));
     get_socket(s)->recv_pid = pid;
     get_socket(s)->socket_values.tcp_control.rto = TCP_INITIAL_ACK_TIMEOUT;
     return 0;
@@ -281,16 +395,19 @@ int destiny_socket(int domain, int type, int protocol)
 {
     int i = 1;
 
-    while (get_socket(i) != NULL) {
+    while ((i <= MAX_SOCKETS) && (get_socket(i) != NULL)) {
         i++;
     }
 
-    if (i > MAX_SOCKETS + 1) {
+    if (i > MAX_SOCKETS) {
         return -1;
     }
     else {
         socket_t *current_socket = &sockets[i - 1].socket_values;
         sockets[i - 1].socket_id = i;
+        ringbuffer_init(&sockets[i - 1].tcp_input_rb,
+                        (char *) sockets[i - 1].tcp_input_buffer,
+                        DESTINY_SOCKET_MAX_TCP_BUFFER);
         current_socket->domain = domain;
         current_socket->type = type;
         current_socket->protocol = protocol;
@@ -301,16 +418,14 @@ int destiny_socket(int domain, int type, int protocol)
 
 socket_internal_t *get_udp_socket(udp_hdr_t *udp_header)
 {
-    uint8_t i = 1;
+    uint8_t id = socket_port_buckets[socket_port_hash(udp_header->dst_port)];
 
-    while (i < MAX_SOCKETS + 1) {
-        if (isUDPSocket(i) &&
-            (get_socket(i)->socket_values.local_address.sin6_port ==
+    for (; id != 0; id = socket_port_links[id - 1].next) {
+        if (isUDPSocket(id) &&
+            (get_socket(id)->socket_values.local_address.sin6_port ==
              udp_header->dst_port)) {
-            return get_socket(i);
+            return get_socket(id);
         }
-
-        i++;
     }
 
     return NULL;
@@ -329,55 +444,347 @@ bool is_four_touple(socket_internal_t *current_socket, ipv6_hdr_t *ipv6_header,
 
 socket_internal_t *get_tcp_socket(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header)
 {
-    uint8_t i = 1;
     socket_internal_t *current_socket = NULL;
     socket_internal_t *listening_socket = NULL;
-    uint8_t compare[16];
-    memset(compare, 0, 16);
+    uint8_t id;
 
-    while (i < MAX_SOCKETS + 1) {
-        current_socket = get_socket(i);
+    /* Check for matching 4 touple, TCP_ESTABLISHED connection */
+    id = socket_conn_buckets[socket_conn_hash(tcp_header->dst_port,
+                                              &ipv6_header->srcaddr,
+                                              tcp_header->src_port)];
 
-        /* Check for matching 4 touple, TCP_ESTABLISHED connection */
-        if (is_tcp_socket(i) && is_four_touple(current_socket, ipv6_header,
-                                               tcp_header)) {
+    for (; id != 0; id = socket_conn_links[id - 1].next) {
+        current_socket = get_socket(id);
+
+        if (is_tcp_socket(id) && is_four_touple(current_socket, ipv6_header,
+                                                tcp_header)) {
             return current_socket;
         }
-        /* Sockets in TCP_LISTEN and TCP_SYN_RCVD state should only be tested on local TCP values */
-        else if (is_tcp_socket(i) &&
-                 ((current_socket->socket_values.tcp_control.state == TCP_LISTEN) ||
-                  (current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD)) &&
-                 (current_socket->socket_values.local_address.sin6_addr.uint8[15] ==
-                  ipv6_header->destaddr.uint8[15]) &&
-                 (current_socket->socket_values.local_address.sin6_port ==
-                  tcp_header->dst_port) &&
-                 (current_socket->socket_values.foreign_address.sin6_addr.uint8[15] ==
-                  0x00) &&
-                 (current_socket->socket_values.foreign_address.sin6_port == 0)) {
+    }
+
+    /* Sockets in TCP_LISTEN state should only be tested on local TCP values,
+     * connections in the handshake are in the SYN cache of theirs */
+    id = socket_port_buckets[socket_port_hash(tcp_header->dst_port)];
+
+    for (; id != 0; id = socket_port_links[id - 1].next) {
+        current_socket = get_socket(id);
+
+        if (is_tcp_socket(id) &&
+            (current_socket->socket_values.tcp_control.state == TCP_LISTEN) &&
+            (current_socket->socket_values.local_address.sin6_addr.uint8[15] ==
+             ipv6_header->destaddr.uint8[15]) &&
+            (current_socket->socket_values.local_address.sin6_port ==
+             tcp_header->dst_port) &&
+            (current_socket->socket_values.foreign_address.sin6_addr.uint8[15] ==
+             0x00) &&
+            (current_socket->socket_values.foreign_address.sin6_port == 0)) {
             listening_socket = current_socket;
         }
-
-        i++;
     }
 
     /* Return either NULL if nothing was matched or the listening 2 touple socket */
     return listening_socket;
 }
 
+/* Connections in the handshake are kept apart from the sockets, chained
+ * into buckets by the same key as the connection table */
+static tcp_syn_entry_t tcp_syn_cache[DESTINY_SOCKET_SYN_CACHE_SIZE];
+static uint8_t tcp_syn_buckets[DESTINY_SOCKET_HASH_BUCKETS];
+
+static void tcp_syn_cache_remove(tcp_syn_entry_t *entry)
+{
+    uint8_t index = entry - tcp_syn_cache + 1;
+    uint8_t *link;
+
+    for (link = &tcp_syn_buckets[entry->bucket]; *link != 0;
+         link = &tcp_syn_cache[*link - 1].next) {
+        if (*link == index) {
+            *link = entry->next;
+            break;
+        }
+    }
+
+    get_socket(entry->listener)->tcp_syn_numof--;
+    entry->listener = 0;
+}
+
+static tcp_syn_entry_t *tcp_syn_cache_find(socket_internal_t *listening_socket,
+        ipv6_hdr_t *ipv6_header,
+        tcp_hdr_t *tcp_header)
+{
+    uint8_t index = tcp_syn_buckets[socket_conn_hash(tcp_header->dst_port,
+                                    &ipv6_header->srcaddr,
+                                    tcp_header->src_port)];
+
+    for (; index != 0; index = tcp_syn_cache[index - 1].next) {
+        tcp_syn_entry_t *entry = &tcp_syn_cache[index - 1];
+
+        if ((entry->listener == listening_socket->socket_id) &&
+            (entry->foreign_port == tcp_header->src_port) &&
+            ipv6_addr_is_equal(&entry->foreign_addr, &ipv6_header->srcaddr) &&
+            ipv6_addr_is_equal(&entry->local_addr, &ipv6_header->destaddr)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/* Drops the connections whose peers gave up on the handshake */
+static void tcp_syn_cache_expire(void)
+{
+    timex_t now;
+
+    vtimer_now(&now);
+
+    for (int i = 0; i < DESTINY_SOCKET_SYN_CACHE_SIZE; i++) {
+        if ((tcp_syn_cache[i].listener != 0) &&
+            (timex_uint64(timex_sub(now, tcp_syn_cache[i].syn_time)) >
+             TCP_SYN_INITIAL_TIMEOUT + TCP_MAX_SYN_RETRIES * TCP_SYN_TIMEOUT)) {
+            tcp_syn_cache_remove(&tcp_syn_cache[i]);
+        }
+    }
+}
+
+static void tcp_syn_cache_flush(socket_internal_t *listening_socket)
+{
+    for (int i = 0; i < DESTINY_SOCKET_SYN_CACHE_SIZE; i++) {
+        if (tcp_syn_cache[i].listener == listening_socket->socket_id) {
+            tcp_syn_cache_remove(&tcp_syn_cache[i]);
+        }
+    }
+
+    /* established connections nobody accepted */
+    while (listening_socket->tcp_accept_numof > 0) {
+        socket_internal_t *queued_socket = get_socket(
+            listening_socket->tcp_accept_queue[listening_socket->tcp_accept_head]);
+
+        listening_socket->tcp_accept_head = (listening_socket->tcp_accept_head + 1) %
+                                            DESTINY_SOCKET_BACKLOG_MAX;
+        listening_socket->tcp_accept_numof--;
+
+        if (queued_socket != NULL) {
+            close_socket(queued_socket);
+        }
+    }
+}
+
+/* Sends the SYN-ACK of a connection in the handshake, the same segment as
+ * send_tcp() would for a socket in TCP_SYN_RCVD */
+static int tcp_syn_cache_send(socket_internal_t *listening_socket,
+                              tcp_syn_entry_t *entry)
+{
+    /* room for the full header TCP_HC prefix */
+    uint8_t send_buffer[IPV6_HDR_LEN + 3 + TCP_HDR_LEN + sizeof(tcp_mss_option_t)];
+    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(&send_buffer));
+    tcp_hdr_t *syn_ack_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
+    uint8_t header_length = (TCP_HDR_LEN + sizeof(tcp_mss_option_t)) / 4;
+    uint16_t packet_size = header_length * 4;
+    tcp_mss_option_t current_mss_option;
+
+    current_mss_option.kind = TCP_MSS_OPTION;
+    current_mss_option.len = sizeof(tcp_mss_option_t);
+    current_mss_option.mss = DESTINY_SOCKET_STATIC_MSS;
+    memcpy(((uint8_t *)syn_ack_packet) + TCP_HDR_LEN, &current_mss_option,
+           sizeof(tcp_mss_option_t));
+
+    set_tcp_packet(syn_ack_packet,
+                   listening_socket->socket_values.local_address.sin6_port,
+                   entry->foreign_port, entry->iss, entry->irs + 1,
+                   header_length, TCP_SYN_ACK, DESTINY_SOCKET_MAX_TCP_BUFFER,
+                   0, 0);
+
+    memcpy(&temp_ipv6_header->destaddr, &entry->foreign_addr, 16);
+    memcpy(&temp_ipv6_header->srcaddr, &entry->local_addr, 16);
+    temp_ipv6_header->length = packet_size;
+
+    syn_ack_packet->checksum = ~tcp_csum(temp_ipv6_header, syn_ack_packet);
+    switch_tcp_packet_byte_order(syn_ack_packet);
+
+#ifdef TCP_HC
+    /* draft-aayadi-6lowpan-tcphc-01: 5.1 Full header TCP segment */
+    uint16_t current_context = HTONS(entry->context_id);
+
+    memmove(((uint8_t *)syn_ack_packet) + 3, syn_ack_packet, packet_size);
+    memset(syn_ack_packet, 0x01, 1);
+    memcpy(((uint8_t *)syn_ack_packet) + 1, &current_context, 2);
+    packet_size += 3;
+#endif
+
+    NETSTAT_TX(NETSTAT_LAYER_TCP);
+    return ipv6_sendto(&entry->foreign_addr, IPPROTO_TCP,
+                       (uint8_t *)syn_ack_packet, packet_size);
+}
+
+/* Answers a SYN to a listening socket, in the TCP thread */
+int tcp_syn_cache_add(socket_internal_t *listening_socket,
+                      ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header)
+{
+    tcp_syn_entry_t *entry = tcp_syn_cache_find(listening_socket, ipv6_header,
+                             tcp_header);
+
+    if (entry != NULL) {
+        /* the SYN-ACK got lost, the peer sent its SYN again */
+        tcp_syn_cache_send(listening_socket, entry);
+        return 0;
+    }
+
+    tcp_syn_cache_expire();
+
+    if (listening_socket->tcp_syn_numof + listening_socket->tcp_accept_numof >=
+        listening_socket->tcp_backlog) {
+        return -1;
+    }
+
+    for (int i = 0; i < DESTINY_SOCKET_SYN_CACHE_SIZE; i++) {
+        if (tcp_syn_cache[i].listener == 0) {
+            entry = &tcp_syn_cache[i];
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        return -1;
+    }
+
+    memset(entry, 0, sizeof(tcp_syn_entry_t));
+    entry->listener = listening_socket->socket_id;
+    entry->foreign_port = tcp_header->src_port;
+    memcpy(&entry->foreign_addr, &ipv6_header->srcaddr, 16);
+    memcpy(&entry->local_addr, &ipv6_header->destaddr, 16);
+    entry->flowinfo = ipv6_header->flowlabel;
+    entry->irs = tcp_header->seq_nr;
+    entry->wnd = tcp_header->window;
+    vtimer_now(&entry->syn_time);
+
+    /* Foreign TCP information */
+    if ((tcp_header->dataOffset_reserved * 4 > TCP_HDR_LEN) &&
+        (*(((uint8_t *)tcp_header) + TCP_HDR_LEN) == TCP_MSS_OPTION)) {
+        entry->mss = *((uint16_t *)(((uint8_t *)tcp_header) + TCP_HDR_LEN + 2));
+    }
+    else {
+        entry->mss = DESTINY_SOCKET_STATIC_MSS;
+    }
+
+    inc_global_variables();
+    mutex_lock(&global_sequence_counter_mutex);
+    entry->iss = global_sequence_counter;
+    mutex_unlock(&global_sequence_counter_mutex);
+
+#ifdef TCP_HC
+    /* decompress_tcp_packet() left the context of the SYN there */
+    entry->context_id =
+        listening_socket->socket_values.tcp_control.tcp_context.context_id;
+    memset(&listening_socket->socket_values.tcp_control.tcp_context, 0,
+           sizeof(tcp_hc_context_t));
+#endif
+
+    entry->bucket = socket_conn_hash(tcp_header->dst_port, &entry->foreign_addr,
+                                     entry->foreign_port);
+    entry->next = tcp_syn_buckets[entry->bucket];
+    tcp_syn_buckets[entry->bucket] = entry - tcp_syn_cache + 1;
+    listening_socket->tcp_syn_numof++;
+
+    tcp_syn_cache_send(listening_socket, entry);
+    return 0;
+}
+
+/* Takes a socket for a connection whose handshake the ACK completes and
+ * queues it for accept(), in the TCP thread. NULL if the ACK is not for a
+ * connection in the SYN cache of the listening socket. */
+socket_internal_t *tcp_syn_cache_complete(socket_internal_t *listening_socket,
+        ipv6_hdr_t *ipv6_header,
+        tcp_hdr_t *tcp_header)
+{
+    tcp_syn_entry_t *entry = tcp_syn_cache_find(listening_socket, ipv6_header,
+                             tcp_header);
+    socket_internal_t *new_socket;
+    tcp_cb_t *tcp_control;
+    unsigned int state;
+    msg_t m_send;
+    int s;
+
+    if ((entry == NULL) || (tcp_header->ack_nr != entry->iss + 1)) {
+        return NULL;
+    }
+
+    s = destiny_socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP);
+
+    if (s < 0) {
+        /* the entry stays, the peer sends again */
+        return NULL;
+    }
+
+    new_socket = get_socket(s);
+    tcp_control = &new_socket->socket_values.tcp_control;
+
+    set_socket_address(&new_socket->socket_values.foreign_address, AF_INET6,
+                       entry->foreign_port, entry->flowinfo,
+                       &entry->foreign_addr);
+    set_socket_address(&new_socket->socket_values.local_address, AF_INET6,
+                       listening_socket->socket_values.local_address.sin6_port,
+                       0, &entry->local_addr);
+    socket_hash_update(new_socket);
+
+    tcp_control->mss = entry->mss;
+    tcp_control->rcv_irs = entry->irs;
+    tcp_control->send_iss = entry->iss;
+    tcp_control->rto = TCP_INITIAL_ACK_TIMEOUT;
+    set_tcp_cb(tcp_control, tcp_header->seq_nr + 1, DESTINY_SOCKET_MAX_TCP_BUFFER,
+               tcp_header->ack_nr, tcp_header->ack_nr, tcp_header->window);
+    vtimer_now(&tcp_control->last_packet_time);
+
+#ifdef TCP_HC
+    /* the context as the SYN-ACK left it */
+    tcp_control->tcp_context.context_id = entry->context_id;
+    tcp_control->tcp_context.hc_type = FULL_HEADER;
+    tcp_control->tcp_context.seq_snd = entry->iss;
+    tcp_control->tcp_context.ack_snd = entry->irs + 1;
+    tcp_control->tcp_context.wnd_snd = DESTINY_SOCKET_MAX_TCP_BUFFER;
+    update_tcp_hc_context(true, new_socket, tcp_header);
+#endif
+
+    tcp_control->state = TCP_ESTABLISHED;
+    tcp_cc_init(tcp_control);
+    tcp_timer_arm(new_socket);
+
+    /* Reset PID to an unlikely value */
+    new_socket->recv_pid = 255;
+
+    tcp_syn_cache_remove(entry);
+
+    /* the backlog kept room for it */
+    state = disableIRQ();
+    listening_socket->tcp_accept_queue[(listening_socket->tcp_accept_head +
+                                        listening_socket->tcp_accept_numof) %
+                                       DESTINY_SOCKET_BACKLOG_MAX] = s;
+    listening_socket->tcp_accept_numof++;
+    restoreIRQ(state);
+
+    /* wake up accept() or poll() */
+    net_msg_send(&m_send, listening_socket->recv_pid, 0, TCP_SYN);
+
+    return new_socket;
+}
+
 uint16_t get_free_source_port(uint8_t protocol)
 {
-    int i;
-    uint16_t biggest_port = EPHEMERAL_PORTS - 1;
+    static uint16_t next_port[2] = { EPHEMERAL_PORTS, EPHEMERAL_PORTS };
+    uint16_t *next = &next_port[(protocol == IPPROTO_TCP) ? 0 : 1];
+    uint16_t port = *next;
 
-    /* Remember biggest ephemeral port number used so far and add 1 */
-    for (i = 0; i < MAX_SOCKETS; i++) {
-        if ((sockets[i].socket_values.protocol == protocol) &&
-            (sockets[i].socket_values.local_address.sin6_port > biggest_port)) {
-            biggest_port = sockets[i].socket_values.local_address.sin6_port;
+    /* hand out ephemeral ports round robin, skipping those in use. At most
+     * MAX_SOCKETS of them can be taken. */
+    for (int i = 0; i <= MAX_SOCKETS; i++) {
+        port = *next;
+        *next = (port == 0xffff) ? EPHEMERAL_PORTS : port + 1;
+
+        if (!socket_port_in_use(protocol, HTONS(port))) {
+            break;
         }
     }
 
-    return biggest_port + 1;
+    return port;
 }
 
 void set_socket_address(sockaddr6_t *sockaddr, uint8_t sin6_family,
@@ -449,8 +856,9 @@ void switch_tcp_packet_byte_order(tcp_hdr_t *current_tcp_packet)
     current_tcp_packet->urg_pointer = HTONS(current_tcp_packet->urg_pointer);
 }
 
-int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
-             ipv6_hdr_t *temp_ipv6_header, uint8_t flags, uint8_t payload_length)
+int send_tcp_seq(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
+                 ipv6_hdr_t *temp_ipv6_header, uint8_t flags,
+                 uint8_t payload_length, uint32_t seq)
 {
     socket_t *current_tcp_socket = &current_socket->socket_values;
     uint8_t header_length = TCP_HDR_LEN / 4;
@@ -466,10 +874,11 @@ int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
                &current_mss_option, sizeof(tcp_mss_option_t));
     }
 
+    /* every segment acknowledges what was received */
+    tcp_timer_ack_sent(current_socket);
+
     set_tcp_packet(current_tcp_packet, current_tcp_socket->local_address.sin6_port,
-                   current_tcp_socket->foreign_address.sin6_port,
-                   (flags == TCP_ACK ? current_tcp_socket->tcp_control.send_una - 1 :
-                    current_tcp_socket->tcp_control.send_una),
+                   current_tcp_socket->foreign_address.sin6_port, seq,
                    current_tcp_socket->tcp_control.rcv_nxt, header_length, flags,
                    current_tcp_socket->tcp_control.rcv_wnd, 0, 0);
 
@@ -492,20 +901,34 @@ int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
 
     if (compressed_size == 0) {
         /* Error in compressing tcp packet header */
+        NETSTAT_DROP(NETSTAT_LAYER_TCP, NETSTAT_DROP_TX_FAILED);
         return -1;
     }
 
+    NETSTAT_TX(NETSTAT_LAYER_TCP);
     return ipv6_sendto(&current_tcp_socket->foreign_address.sin6_addr,
                        IPPROTO_TCP, (uint8_t *)(current_tcp_packet),
                        compressed_size);
 #else
     switch_tcp_packet_byte_order(current_tcp_packet);
+    NETSTAT_TX(NETSTAT_LAYER_TCP);
     return ipv6_sendto(&current_tcp_socket->foreign_address.sin6_addr,
                        IPPROTO_TCP, (uint8_t *)(current_tcp_packet),
                        header_length * 4 + payload_length);
 #endif
 }
 
+int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
+             ipv6_hdr_t *temp_ipv6_header, uint8_t flags, uint8_t payload_length)
+{
+    tcp_cb_t *tcp_control = &current_socket->socket_values.tcp_control;
+
+    return send_tcp_seq(current_socket, current_tcp_packet, temp_ipv6_header,
+                        flags, payload_length,
+                        (flags == TCP_ACK ? tcp_control->send_una - 1 :
+                         tcp_control->send_una));
+}
+
 void set_tcp_cb(tcp_cb_t *tcp_control, uint32_t rcv_nxt, uint16_t rcv_wnd,
                 uint32_t send_nxt, uint32_t send_una, uint16_t send_wnd)
 {
@@ -516,6 +939,42 @@ void set_tcp_cb(tcp_cb_t *tcp_control, uint32_t rcv_nxt, uint16_t rcv_wnd,
     tcp_control->send_wnd = send_wnd;
 }
 
+/* fixes the addresses of a UDP socket and sums everything of the checksum
+ * that does not change from datagram to datagram */
+static int udp_connect(socket_internal_t *current_socket, sockaddr6_t *addr)
+{
+    socket_t *current_udp_socket = &current_socket->socket_values;
+    ipv6_addr_t src_addr;
+    uint16_t sum;
+
+    ipv6_net_if_get_best_src_addr(&src_addr, &addr->sin6_addr);
+
+    if (current_udp_socket->local_address.sin6_port == 0) {
+        current_udp_socket->local_address.sin6_port =
+            HTONS(get_free_source_port(IPPROTO_UDP));
+    }
+
+    set_socket_address(&current_udp_socket->local_address, PF_INET6,
+                       current_udp_socket->local_address.sin6_port, 0,
+                       &src_addr);
+    set_socket_address(&current_udp_socket->foreign_address, addr->sin6_family,
+                       addr->sin6_port, addr->sin6_flowinfo, &addr->sin6_addr);
+    socket_hash_update(current_socket);
+
+    sum = IPPROTO_UDP;
+    sum = csum(sum, (uint8_t *)&current_udp_socket->local_address.sin6_addr,
+               sizeof(ipv6_addr_t));
+    sum = csum(sum, (uint8_t *)&current_udp_socket->foreign_address.sin6_addr,
+               sizeof(ipv6_addr_t));
+    sum = csum(sum, (uint8_t *)&current_udp_socket->local_address.sin6_port,
+               sizeof(uint16_t));
+    sum = csum(sum, (uint8_t *)&current_udp_socket->foreign_address.sin6_port,
+               sizeof(uint16_t));
+    current_socket->udp_csum_partial = sum;
+
+    return 0;
+}
+
 int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
 {
     (void) addrlen;
@@ -536,6 +995,10 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
         return -1;
     }
 
+    if (isUDPSocket(socket)) {
+        return udp_connect(current_int_tcp_socket, addr);
+    }
+
     current_tcp_socket = &current_int_tcp_socket->socket_values;
 
     current_int_tcp_socket->recv_pid = thread_getpid();
@@ -548,11 +1011,13 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
     /* Foreign address information */
     set_socket_address(&current_tcp_socket->foreign_address, addr->sin6_family,
                        addr->sin6_port, addr->sin6_flowinfo, &addr->sin6_addr);
+    socket_hash_update(current_int_tcp_socket);
 
     /* Fill lcoal TCP socket information */
     srand(addr->sin6_port);
 
     current_tcp_socket->tcp_control.rcv_irs	= 0;
+    inc_global_variables();
     mutex_lock(&global_sequence_counter_mutex);
     current_tcp_socket->tcp_control.send_iss = global_sequence_counter;
     mutex_unlock(&global_sequence_counter_mutex);
@@ -572,7 +1037,7 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
            sizeof(tcp_hc_context_t));
 #endif
 
-    set_tcp_cb(&current_tcp_socket->tcp_control, 0, DESTINY_SOCKET_STATIC_WINDOW,
+    set_tcp_cb(&current_tcp_socket->tcp_control, 0, DESTINY_SOCKET_MAX_TCP_BUFFER,
                current_tcp_socket->tcp_control.send_iss,
                current_tcp_socket->tcp_control.send_iss, 0);
 
@@ -588,6 +1053,7 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
         /* Send packet */
         send_tcp(current_int_tcp_socket, current_tcp_packet, temp_ipv6_header,
                  TCP_SYN, 0);
+        tcp_timer_arm(current_int_tcp_socket);
 
         /* wait for SYN ACK or RETRY */
         msg_receive(&msg_from_server);
@@ -657,6 +1123,7 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
         /* Send packet */
         send_tcp(current_int_tcp_socket, current_tcp_packet, temp_ipv6_header,
                  TCP_ACK, 0);
+        tcp_timer_arm(current_int_tcp_socket);
 
         msg_receive(&msg_from_server);
 #ifdef TCP_HC
@@ -676,6 +1143,8 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
     }
 
     current_tcp_socket->tcp_control.state = TCP_ESTABLISHED;
+    tcp_cc_init(&current_tcp_socket->tcp_control);
+    tcp_timer_arm(current_int_tcp_socket);
 
     current_int_tcp_socket->recv_pid = 255;
 
@@ -683,9 +1152,12 @@ int destiny_socket_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
     return 0;
 }
 
-void calculate_rto(tcp_cb_t *tcp_control, timex_t current_time)
+void calculate_rto(tcp_cb_t *tcp_control, timex_t sent_time)
 {
-    double rtt = (double) timex_uint64(timex_sub(current_time, tcp_control->last_packet_time));
+    timex_t now;
+    vtimer_now(&now);
+
+    double rtt = (double) timex_uint64(timex_sub(now, sent_time));
     double srtt = tcp_control->srtt;
     double rttvar = tcp_control->rttvar;
     double rto = tcp_control->rto;
@@ -700,7 +1172,8 @@ void calculate_rto(tcp_cb_t *tcp_control, timex_t current_time)
     else {
         /* every other calculation */
         srtt = (1 - TCP_ALPHA) * srtt + TCP_ALPHA * rtt;
-        rttvar = (1 - TCP_BETA) * rttvar + TCP_BETA * abs(srtt - rtt);
+        rttvar = (1 - TCP_BETA) * rttvar + TCP_BETA *
+                 ((srtt > rtt) ? (srtt - rtt) : (rtt - srtt));
         rto = srtt + (((4 * rttvar) < TCP_TIMER_RESOLUTION) ?
                       (TCP_TIMER_RESOLUTION) : (4 * rttvar));
     }
@@ -714,20 +1187,62 @@ void calculate_rto(tcp_cb_t *tcp_control, timex_t current_time)
     tcp_control->rto = rto;
 }
 
-int32_t destiny_socket_send(int s, const void *buf, uint32_t len, int flags)
+/* One entry of the retransmission queue of destiny_socket_send(). The data
+ * itself stays in the caller's buffer until it is acknowledged. */
+typedef struct {
+    tcp_seg_t   seg;
+    timex_t     sent;
+    uint8_t     retransmitted;
+} tcp_send_seg_t;
+
+static int send_tcp_segment(socket_internal_t *current_socket, uint8_t *send_buffer,
+                            const uint8_t *data, uint32_t seq, uint16_t len)
 {
-    (void) flags;
+    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)send_buffer);
+    tcp_hdr_t *current_tcp_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
+    tcp_cb_t *tcp_control = &current_socket->socket_values.tcp_control;
+
+    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN], data, len);
+    tcp_control->stats.segments_sent++;
+    tcp_control->stats.bytes_sent += len;
+
+    return send_tcp_seq(current_socket, current_tcp_packet, temp_ipv6_header,
+                        0, len, seq);
+}
+
+/* Sends the unacknowledged part of a queued segment again */
+static int retransmit_tcp_segment(socket_internal_t *current_socket,
+                                  uint8_t *send_buffer, const uint8_t *buf,
+                                  uint32_t start_seq, tcp_send_seg_t *seg)
+{
+    tcp_cb_t *tcp_control = &current_socket->socket_values.tcp_control;
+    uint32_t from = (seg->seg.seq < tcp_control->send_una) ?
+                    tcp_control->send_una : seg->seg.seq;
+
+#ifdef TCP_HC
+    tcp_control->tcp_context.hc_type = FULL_HEADER;
+#endif
+    seg->retransmitted = 1;
+    tcp_control->stats.retransmits++;
 
+    return send_tcp_segment(current_socket, send_buffer, buf + (from - start_seq),
+                            from, seg->seg.seq + seg->seg.len - from);
+}
+
+static int32_t send_tcp_data(int s, const void *buf, uint32_t len)
+{
     /* Variables */
     msg_t recv_msg;
-    int32_t sent_bytes = 0;
-    uint32_t total_sent_bytes = 0;
     socket_internal_t *current_int_tcp_socket;
     socket_t *current_tcp_socket;
+    tcp_cb_t *tcp_control;
+    tcp_send_seg_t queue[TCP_SEND_QUEUE_LEN];
+    uint8_t queue_head = 0, queue_numof = 0;
+    uint8_t dupacks_handled = 0;
+    uint32_t start_seq, last_una, rexmit_end;
+    timex_t now;
     uint8_t send_buffer[BUFFER_SIZE];
     memset(send_buffer, 0, BUFFER_SIZE);
-    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(&send_buffer));
-    tcp_hdr_t *current_tcp_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
 
     /* Check if socket exists and is TCP socket */
     if (!is_tcp_socket(s)) {
@@ -736,184 +1251,403 @@ int32_t destiny_socket_send(int s, const void *buf, uint32_t len, int flags)
 
     current_int_tcp_socket = get_socket(s);
     current_tcp_socket = &current_int_tcp_socket->socket_values;
+    tcp_control = &current_tcp_socket->tcp_control;
 
     /* Check for TCP_ESTABLISHED STATE */
-    if (current_tcp_socket->tcp_control.state != TCP_ESTABLISHED) {
+    if (tcp_control->state != TCP_ESTABLISHED) {
         return -1;
     }
 
     /* Add thread PID */
     current_int_tcp_socket->send_pid = thread_getpid();
 
-    recv_msg.type = UNDEFINED;
+    tcp_control->no_of_retries = 0;
+    start_seq = tcp_control->send_una;
+    last_una = tcp_control->send_una;
+    rexmit_end = tcp_control->send_una;
+    tcp_control->send_nxt = start_seq;
+    tcp_control->dupacks = 0;
+
+    while ((tcp_control->send_una - start_seq) < len) {
+        /* the TCP thread advances send_una on every cumulative ACK, retire
+         * what it covers and take an RTT sample from the newest segment that
+         * was not retransmitted (Karn's algorithm) */
+        tcp_send_seg_t *sample = NULL;
+        uint32_t rtt = 0;
+        uint8_t dupacks;
+
+        while (queue_numof > 0) {
+            tcp_send_seg_t *oldest = &queue[queue_head];
+
+            if (oldest->seg.seq + oldest->seg.len > tcp_control->send_una) {
+                break;
+            }
 
-    while (1) {
-        current_tcp_socket->tcp_control.no_of_retries = 0;
+            if (!oldest->retransmitted) {
+                sample = oldest;
+            }
 
-#ifdef TCP_HC
-        current_tcp_socket->tcp_control.tcp_context.hc_type = COMPRESSED_HEADER;
-        /* Remember TCP Context for possible TCP_RETRY */
-        tcp_hc_context_t saved_tcp_context;
-        memcpy(&saved_tcp_context, &current_tcp_socket->tcp_control.tcp_context,
-               sizeof(tcp_hc_context_t) - 1);
-#endif
+            queue_head = (queue_head + 1) % TCP_SEND_QUEUE_LEN;
+            queue_numof--;
+        }
 
-        while (recv_msg.type != TCP_ACK) {
-            /* Add packet data */
-            if (current_tcp_socket->tcp_control.send_wnd >
-                current_tcp_socket->tcp_control.mss) {
-                /* Window size > Maximum Segment Size */
-                if ((len - total_sent_bytes) > current_tcp_socket->tcp_control.mss) {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN], buf,
-                           current_tcp_socket->tcp_control.mss);
-                    sent_bytes = current_tcp_socket->tcp_control.mss;
-                    total_sent_bytes += sent_bytes;
-                }
-                else {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN],
-                           (uint8_t *) buf + total_sent_bytes, len - total_sent_bytes);
-                    sent_bytes = len - total_sent_bytes;
-                    total_sent_bytes = len;
-                }
+        vtimer_now(&now);
+
+        if (sample != NULL) {
+            rtt = timex_uint64(timex_sub(now, sample->sent));
+            calculate_rto(tcp_control, sample->sent);
+        }
+
+        if (tcp_control->send_una != last_una) {
+            uint32_t acked = tcp_control->send_una - last_una;
+
+            /* new data got acknowledged, restart the retransmission timer */
+            last_una = tcp_control->send_una;
+            tcp_control->no_of_retries = 0;
+            tcp_control->last_packet_time = now;
+            tcp_control->stats.bytes_acked += acked;
+            dupacks_handled = 0;
+
+            if (!tcp_control->in_recovery) {
+                tcp_cc_ack(tcp_control, acked, rtt);
+            }
+            else if (SEQ_GEQ(tcp_control->send_una, tcp_control->recover)) {
+                /* full ACK, leave fast recovery (RFC 6582, 3.2 step 3) */
+                uint32_t flight = tcp_control->send_nxt - tcp_control->send_una;
+
+                tcp_control->in_recovery = 0;
+                tcp_control->cwnd = (tcp_control->ssthresh < flight + tcp_control->mss) ?
+                                    tcp_control->ssthresh : flight + tcp_control->mss;
             }
             else {
-                /* Window size <= Maximum Segment Size */
-                if ((len - total_sent_bytes) > current_tcp_socket->tcp_control.send_wnd) {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN], buf,
-                           current_tcp_socket->tcp_control.send_wnd);
-                    sent_bytes = current_tcp_socket->tcp_control.send_wnd;
-                    total_sent_bytes += sent_bytes;
+                /* partial ACK, the segment after the acknowledged bytes got
+                 * lost as well: resend it and deflate the window */
+                if ((queue_numof > 0) &&
+                    (retransmit_tcp_segment(current_int_tcp_socket,
+                                            send_buffer, buf, start_seq,
+                                            &queue[queue_head]) != 1)) {
+                    printf("Error while sending, returning to application thread!\n");
+                    tcp_control->send_nxt = tcp_control->send_una;
+                    return -1;
                 }
-                else {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN],
-                           (uint8_t *) buf + total_sent_bytes, len - total_sent_bytes);
-                    sent_bytes = len - total_sent_bytes;
-                    total_sent_bytes = len;
+
+                tcp_control->cwnd = (tcp_control->cwnd > acked + tcp_control->mss) ?
+                                    (tcp_control->cwnd - acked) : tcp_control->mss;
+
+                if (acked >= tcp_control->mss) {
+                    tcp_control->cwnd += tcp_control->mss;
                 }
             }
+        }
 
-            current_tcp_socket->tcp_control.send_nxt += sent_bytes;
-            current_tcp_socket->tcp_control.send_wnd -= sent_bytes;
+        dupacks = tcp_control->dupacks;
 
-            if (send_tcp(current_int_tcp_socket, current_tcp_packet,
-                         temp_ipv6_header, 0, sent_bytes) != 1) {
-                /* Error while sending tcp data */
-                current_tcp_socket->tcp_control.send_nxt -= sent_bytes;
-                current_tcp_socket->tcp_control.send_wnd += sent_bytes;
-#ifdef TCP_HC
-                memcpy(&current_tcp_socket->tcp_control.tcp_context,
-                       &saved_tcp_context, sizeof(tcp_hc_context_t));
-                current_tcp_socket->tcp_control.tcp_context.hc_type =
-                    COMPRESSED_HEADER;
-#endif
-                printf("Error while sending, returning to application thread!\n");
-                return -1;
+        if (dupacks > dupacks_handled) {
+            if (tcp_control->in_recovery) {
+                /* every further duplicate ACK means a segment left the
+                 * network */
+                uint32_t cwnd = tcp_control->cwnd +
+                                (uint32_t)(dupacks - dupacks_handled) * tcp_control->mss;
+
+                tcp_control->cwnd = (cwnd > 0xffff) ? 0xffff : cwnd;
             }
+            else if ((dupacks >= TCP_CC_DUPACK_THRESHOLD) && (queue_numof > 0) &&
+                     SEQ_GT(tcp_control->send_una, tcp_control->recover)) {
+                /* fast retransmit and enter fast recovery (RFC 6582, 3.2
+                 * step 2), unless the ACK belongs to an earlier recovery */
+                tcp_cc_loss(tcp_control, TCP_CC_LOSS_DUPACK,
+                            tcp_control->send_nxt - tcp_control->send_una);
+                tcp_control->in_recovery = 1;
+                tcp_control->recover = tcp_control->send_nxt;
+                tcp_control->stats.fast_retransmits++;
+
+                if (retransmit_tcp_segment(current_int_tcp_socket, send_buffer,
+                                           buf, start_seq,
+                                           &queue[queue_head]) != 1) {
+                    printf("Error while sending, returning to application thread!\n");
+                    tcp_control->send_nxt = tcp_control->send_una;
+                    return -1;
+                }
 
-            /* Remember current time */
-            vtimer_now(&current_tcp_socket->tcp_control.last_packet_time);
-            net_msg_receive(&recv_msg);
+                tcp_control->last_packet_time = now;
+            }
 
-            switch (recv_msg.type) {
-                case TCP_ACK: {
-                    if (current_tcp_socket->tcp_control.no_of_retries == 0) {
-                        calculate_rto(&current_tcp_socket->tcp_control,
-                                      current_tcp_socket->tcp_control.last_packet_time);
-                    }
+            dupacks_handled = dupacks;
+        }
 
-                    tcp_hdr_t *tcp_header = ((tcp_hdr_t *)(recv_msg.content.ptr));
+        /* fill what the send and congestion windows allow */
+        while ((queue_numof < TCP_SEND_QUEUE_LEN) &&
+               ((tcp_control->send_nxt - start_seq) < len)) {
+            uint32_t in_flight = tcp_control->send_nxt - tcp_control->send_una;
+            uint32_t wnd = (tcp_control->cwnd < tcp_control->send_wnd) ?
+                           tcp_control->cwnd : tcp_control->send_wnd;
+            uint32_t usable = (wnd > in_flight) ? (wnd - in_flight) : 0;
+            uint32_t seg_len = len - (tcp_control->send_nxt - start_seq);
+            tcp_send_seg_t *seg;
+
+            if (usable == 0) {
+                if ((in_flight > 0) || (tcp_control->send_wnd > 0)) {
+                    break;
+                }
 
-                    if ((current_tcp_socket->tcp_control.send_nxt ==
-                         tcp_header->ack_nr) && (total_sent_bytes == len)) {
-                        current_tcp_socket->tcp_control.send_una = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_nxt = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_wnd = tcp_header->window;
-                        /* Got ACK for every sent byte */
-#ifdef TCP_HC
-                        current_tcp_socket->tcp_control.tcp_context.hc_type =
-                            COMPRESSED_HEADER;
-#endif
-                        return sent_bytes;
-                    }
-                    else if ((current_tcp_socket->tcp_control.send_nxt ==
-                              tcp_header->ack_nr) && (total_sent_bytes != len)) {
-                        current_tcp_socket->tcp_control.send_una = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_nxt = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_wnd = tcp_header->window;
-                        /* Got ACK for every sent byte */
-#ifdef TCP_HC
-                        current_tcp_socket->tcp_control.tcp_context.hc_type =
-                            COMPRESSED_HEADER;
-#endif
-                        break;
-                    }
+                /* zero window: probe with a single byte, the retransmission
+                 * timer keeps probing until the window opens */
+                usable = 1;
+            }
 
-                    /* else {
-                     *     TODO: If window size > MSS, ACK was valid only for
-                     *     a few segments, handle retransmit of missing
-                     *     segments
-                     *	break;
-                     * } */
-                    break;
-                }
+            if (seg_len > tcp_control->mss) {
+                seg_len = tcp_control->mss;
+            }
+
+            if (seg_len > usable) {
+                seg_len = usable;
+            }
+
+            seg = &queue[(queue_head + queue_numof) % TCP_SEND_QUEUE_LEN];
+            seg->seg.seq = tcp_control->send_nxt;
+            seg->seg.len = seg_len;
+            /* after a timeout everything up to rexmit_end goes out again */
+            seg->retransmitted = (seg->seg.seq < rexmit_end);
+
+            if (seg->retransmitted) {
+                tcp_control->stats.retransmits++;
+            }
 
-                case TCP_RETRY: {
-                    current_tcp_socket->tcp_control.send_nxt -= sent_bytes;
-                    current_tcp_socket->tcp_control.send_wnd += sent_bytes;
-                    total_sent_bytes -= sent_bytes;
 #ifdef TCP_HC
-                    memcpy(&current_tcp_socket->tcp_control.tcp_context,
-                           $&saved_tcp_context, sizeof(tcp_hc_context_t));
-                    current_tcp_socket->tcp_control.tcp_context.hc_type =
-                        MOSTLY_COMPRESSED_HEADER;
+            tcp_control->tcp_context.hc_type = COMPRESSED_HEADER;
 #endif
+
+            if (send_tcp_segment(current_int_tcp_socket, send_buffer,
+                                 (const uint8_t *) buf +
+                                 (tcp_control->send_nxt - start_seq),
+                                 tcp_control->send_nxt, seg_len) != 1) {
+                /* Error while sending tcp data */
+                printf("Error while sending, returning to application thread!\n");
+                tcp_control->send_nxt = tcp_control->send_una;
+                return -1;
+            }
+
+            vtimer_now(&seg->sent);
+
+            if (in_flight == 0) {
+                /* start the retransmission timer */
+                tcp_control->last_packet_time = seg->sent;
+            }
+
+            queue_numof++;
+            tcp_control->send_nxt += seg_len;
+        }
+
+        tcp_timer_arm(current_int_tcp_socket);
+        net_msg_receive(&recv_msg);
+
+        switch (recv_msg.type) {
+            case TCP_ACK: {
+                /* handled on top of the loop */
+                break;
+            }
+
+            case TCP_RETRY: {
+                if ((tcp_control->send_una != last_una) || (queue_numof == 0)) {
+                    /* an ACK arrived while we were not listening */
                     break;
                 }
 
-                case TCP_TIMEOUT: {
-                    current_tcp_socket->tcp_control.send_nxt -= sent_bytes;
-                    current_tcp_socket->tcp_control.send_wnd += sent_bytes;
+                if (tcp_control->send_wnd > 0) {
+                    tcp_control->stats.timeouts++;
+                    tcp_cc_loss(tcp_control, TCP_CC_LOSS_TIMEOUT,
+                                tcp_control->send_nxt - tcp_control->send_una);
+                }
+
+                /* go back to send_una and slow start from there, whatever
+                 * was in flight is resent as the window opens again */
+                tcp_control->in_recovery = 0;
+                tcp_control->recover = tcp_control->send_nxt;
+                dupacks_handled = tcp_control->dupacks;
+
+                if (tcp_control->send_nxt > rexmit_end) {
+                    rexmit_end = tcp_control->send_nxt;
+                }
+
+                tcp_control->send_nxt = tcp_control->send_una;
+                queue_numof = 0;
+                vtimer_now(&now);
+                tcp_control->last_packet_time = now;
+                break;
+            }
+
+            case TCP_TIMEOUT: {
+                tcp_control->send_nxt = tcp_control->send_una;
+                tcp_timer_arm(current_int_tcp_socket);
 #ifdef TCP_HC
-                    memcpy(&current_tcp_socket->tcp_control.tcp_context,
-                           &saved_tcp_context, sizeof(tcp_hc_context_t));
-                    current_tcp_socket->tcp_control.tcp_context.hc_type =
-                        COMPRESSED_HEADER;
+                tcp_control->tcp_context.hc_type = COMPRESSED_HEADER;
 #endif
-                    return -1;
-                    break;
-                }
+                return -1;
             }
         }
     }
 
-    return sent_bytes;
+    /* everything is acknowledged */
+    tcp_timer_arm(current_int_tcp_socket);
+#ifdef TCP_HC
+    tcp_control->tcp_context.hc_type = COMPRESSED_HEADER;
+#endif
+    return len;
 }
 
-uint8_t read_from_socket(socket_internal_t *current_int_tcp_socket,
-                         void *buf, int len)
+/* a full cork buffer is sent as one segment */
+static uint16_t tcp_cork_limit(socket_internal_t *current_socket)
 {
-    if (len >= current_int_tcp_socket->tcp_input_buffer_end) {
-        mutex_lock(&current_int_tcp_socket->tcp_buffer_mutex);
-        uint8_t read_bytes = current_int_tcp_socket->tcp_input_buffer_end;
-        memcpy(buf, current_int_tcp_socket->tcp_input_buffer,
-               current_int_tcp_socket->tcp_input_buffer_end);
-        current_int_tcp_socket->tcp_input_buffer_end = 0;
-        current_int_tcp_socket->socket_values.tcp_control.rcv_wnd += read_bytes;
-        mutex_unlock(&current_int_tcp_socket->tcp_buffer_mutex);
-        return read_bytes;
+    uint16_t mss = current_socket->socket_values.tcp_control.mss;
+
+    return (mss < DESTINY_SOCKET_CORK_BUFFER) ? mss : DESTINY_SOCKET_CORK_BUFFER;
+}
+
+static int tcp_cork_flush(int s)
+{
+    socket_internal_t *current_socket = get_socket(s);
+    uint8_t len = current_socket->tcp_cork_len;
+
+    if (len == 0) {
+        return 0;
     }
-    else {
-        mutex_lock(&current_int_tcp_socket->tcp_buffer_mutex);
-        memcpy(buf, current_int_tcp_socket->tcp_input_buffer, len);
-        memmove(current_int_tcp_socket->tcp_input_buffer,
-                (current_int_tcp_socket->tcp_input_buffer + len),
-                current_int_tcp_socket->tcp_input_buffer_end - len);
-        current_int_tcp_socket->tcp_input_buffer_end =
-            current_int_tcp_socket->tcp_input_buffer_end - len;
-        current_int_tcp_socket->socket_values.tcp_control.rcv_wnd += len;
-        mutex_unlock(&current_int_tcp_socket->tcp_buffer_mutex);
-        return len;
+
+    current_socket->tcp_cork_len = 0;
+    return (send_tcp_data(s, current_socket->tcp_cork_buffer, len) < 0) ? -1 : 0;
+}
+
+/* sends a datagram on a UDP socket set up by udp_connect(), only the
+ * payload and the length are new to the checksum */
+static int32_t udp_send_connected(socket_internal_t *current_socket,
+                                  const void *buf, uint32_t len)
+{
+    socket_t *current_udp_socket = &current_socket->socket_values;
+    uint8_t send_buffer[BUFFER_SIZE];
+    udp_hdr_t *current_udp_packet = ((udp_hdr_t *)(&send_buffer));
+    uint8_t *payload = &send_buffer[UDP_HDR_LEN];
+    uint16_t udp_len = UDP_HDR_LEN + len;
+
+    if ((current_udp_socket->foreign_address.sin6_port == 0) ||
+        (len > sizeof(send_buffer) - UDP_HDR_LEN)) {
+        return -1;
+    }
+
+    current_udp_packet->src_port = current_udp_socket->local_address.sin6_port;
+    current_udp_packet->dst_port = current_udp_socket->foreign_address.sin6_port;
+    current_udp_packet->length = HTONS(udp_len);
+    current_udp_packet->checksum = 0;
+    memcpy(payload, buf, len);
+
+#if !LOWPAN_NHC_UDP_CSUM_ELIDE
+    /* the length is in the pseudo header and in the UDP header */
+    uint32_t acc = current_socket->udp_csum_partial + 2 * (uint32_t) udp_len;
+    uint16_t sum;
+
+    acc = (acc & 0xffff) + (acc >> 16);
+    acc = (acc & 0xffff) + (acc >> 16);
+    sum = csum((uint16_t) acc, payload, len);
+    current_udp_packet->checksum = ~HTONS(sum);
+
+    if (current_udp_packet->checksum == 0) {
+        /* 0 means no checksum */
+        current_udp_packet->checksum = 0xffff;
+    }
+#endif
+
+    NETSTAT_TX(NETSTAT_LAYER_UDP);
+    return ipv6_sendto_from(&current_udp_socket->local_address.sin6_addr,
+                            &current_udp_socket->foreign_address.sin6_addr,
+                            IPPROTO_UDP, (uint8_t *) current_udp_packet,
+                            udp_len);
+}
+
+int32_t destiny_socket_send(int s, const void *buf, uint32_t len, int flags)
+{
+    (void) flags;
+
+    socket_internal_t *current_socket;
+    const uint8_t *data = buf;
+    uint32_t left = len;
+
+    if (isUDPSocket(s)) {
+        return udp_send_connected(get_socket(s), buf, len);
+    }
+
+    if (!is_tcp_socket(s)) {
+        return -1;
+    }
+
+    current_socket = get_socket(s);
+
+    if (!current_socket->tcp_cork ||
+        (current_socket->socket_values.tcp_control.state != TCP_ESTABLISHED)) {
+        return send_tcp_data(s, buf, len);
     }
+
+    while (left > 0) {
+        uint16_t limit = tcp_cork_limit(current_socket);
+        uint16_t n;
+
+        if ((current_socket->tcp_cork_len == 0) && (left >= limit)) {
+            /* full segments need no copy, only the rest is held back */
+            n = left - (left % limit);
+
+            if (send_tcp_data(s, data, n) < 0) {
+                return -1;
+            }
+
+            data += n;
+            left -= n;
+            continue;
+        }
+
+        n = limit - current_socket->tcp_cork_len;
+
+        if (n > left) {
+            n = left;
+        }
+
+        memcpy(&current_socket->tcp_cork_buffer[current_socket->tcp_cork_len],
+               data, n);
+        current_socket->tcp_cork_len += n;
+        data += n;
+        left -= n;
+
+        if ((current_socket->tcp_cork_len == limit) && (tcp_cork_flush(s) < 0)) {
+            return -1;
+        }
+    }
+
+    return len;
+}
+
+int destiny_socket_set_tcp_cork(int s, int cork)
+{
+    if (!is_tcp_socket(s)) {
+        return -1;
+    }
+
+    get_socket(s)->tcp_cork = (cork != 0);
+
+    if (!cork) {
+        return tcp_cork_flush(s);
+    }
+
+    return 0;
+}
+
+uint16_t read_from_socket(socket_internal_t *current_int_tcp_socket,
+                          void *buf, int len)
+{
+    uint16_t read_bytes;
+
+    mutex_lock(&current_int_tcp_socket->tcp_buffer_mutex);
+    /* out-of-order data behind the in-order data stays where it is */
+    read_bytes = rb_get_elements(&current_int_tcp_socket->tcp_input_rb, buf,
+                                 len);
+    current_int_tcp_socket->socket_values.tcp_control.rcv_wnd += read_bytes;
+    mutex_unlock(&current_int_tcp_socket->tcp_buffer_mutex);
+    return read_bytes;
 }
 
 int32_t destiny_socket_recv(int s, void *buf, uint32_t len, int flags)
@@ -921,7 +1655,7 @@ int32_t destiny_socket_recv(int s, void *buf, uint32_t len, int flags)
     (void) flags;
 
     /* Variables */
-    uint8_t read_bytes;
+    uint16_t read_bytes;
     msg_t m_recv, m_send;
     socket_internal_t *current_int_tcp_socket;
 
@@ -936,13 +1670,13 @@ int32_t destiny_socket_recv(int s, void *buf, uint32_t len, int flags)
     /* Setting Thread PID */
     current_int_tcp_socket->recv_pid = thread_getpid();
 
-    if (current_int_tcp_socket->tcp_input_buffer_end > 0) {
+    if (current_int_tcp_socket->tcp_input_rb.avail > 0) {
         return read_from_socket(current_int_tcp_socket, buf, len);
     }
 
     msg_receive(&m_recv);
 
-    if ((exists_socket(s)) && (current_int_tcp_socket->tcp_input_buffer_end > 0)) {
+    if ((exists_socket(s)) && (current_int_tcp_socket->tcp_input_rb.avail > 0)) {
         read_bytes = read_from_socket(current_int_tcp_socket, buf, len);
         net_msg_reply(&m_recv, &m_send, UNDEFINED);
         return read_bytes;
@@ -960,34 +1694,90 @@ int32_t destiny_socket_recv(int s, void *buf, uint32_t len, int flags)
     return -1;
 }
 
-int32_t destiny_socket_recvfrom(int s, void *buf, uint32_t len, int flags,
-                                sockaddr6_t *from, uint32_t *fromlen)
+/* copies the datagram in *m* out and lets the UDP thread go on */
+static int32_t udp_datagram_copy(msg_t *m, void *buf, uint32_t len,
+                                 sockaddr6_t *from, socklen_t *fromlen)
 {
-    (void) flags;
-
-    if (isUDPSocket(s)) {
-        msg_t m_recv, m_send;
-        ipv6_hdr_t *ipv6_header;
-        udp_hdr_t *udp_header;
-        uint8_t *payload;
-        get_socket(s)->recv_pid = thread_getpid();
-
-        msg_receive(&m_recv);
+    msg_t m_send;
+    uint8_t *datagram = ((pktbuf_t *) m->content.ptr)->data;
+    ipv6_hdr_t *ipv6_header = ((ipv6_hdr_t *) datagram);
+    udp_hdr_t *udp_header = ((udp_hdr_t *)(datagram + IPV6_HDR_LEN));
+    uint8_t *payload = datagram + IPV6_HDR_LEN + UDP_HDR_LEN;
+    uint32_t payload_len = NTOHS(udp_header->length) - UDP_HDR_LEN;
+
+    if (payload_len > len) {
+        payload_len = len;
+    }
 
-        ipv6_header = ((ipv6_hdr_t *)m_recv.content.ptr);
-        udp_header = ((udp_hdr_t *)(m_recv.content.ptr + IPV6_HDR_LEN));
-        payload = (uint8_t *)(m_recv.content.ptr + IPV6_HDR_LEN + UDP_HDR_LEN);
+    memset(buf, 0, len);
+    memcpy(buf, payload, payload_len);
 
-        memset(buf, 0, len);
-        memcpy(buf, payload, NTOHS(udp_header->length) - UDP_HDR_LEN);
+    if (from != NULL) {
         memcpy(&from->sin6_addr, &ipv6_header->srcaddr, 16);
         from->sin6_family = AF_INET6;
         from->sin6_flowinfo = 0;
         from->sin6_port = NTOHS(udp_header->src_port);
+    }
+
+    if (fromlen != NULL) {
         *fromlen = sizeof(sockaddr6_t);
+    }
+
+    msg_reply(m, &m_send);
+    return payload_len;
+}
+
+/* hands a message not meant for UDP socket *s* on, like
+ * destiny_socket_poll() does, 1 if it is a datagram for *s* */
+static int udp_datagram_for(int s, msg_t *m)
+{
+    msg_t m_send;
+
+    if (m->type == UDP_DATAGRAM) {
+        pktbuf_t *pkt = (pktbuf_t *) m->content.ptr;
+        udp_hdr_t *udp_header = ((udp_hdr_t *)(pkt->data + IPV6_HDR_LEN));
+        socket_internal_t *udp_socket = get_udp_socket(udp_header);
+
+        if (udp_socket == get_socket(s)) {
+            return 1;
+        }
+
+        if ((udp_socket != NULL) && !udp_socket->udp_pending) {
+            udp_socket->udp_pending_msg = *m;
+            udp_socket->udp_pending = 1;
+        }
+        else {
+            msg_reply(m, &m_send);
+        }
+    }
+    else if ((m->type == UNDEFINED) &&
+             (thread_getstatus(m->sender_pid) == STATUS_REPLY_BLOCKED)) {
+        net_msg_reply(m, &m_send, UNDEFINED);
+    }
+
+    return 0;
+}
+
+int32_t destiny_socket_recvfrom(int s, void *buf, uint32_t len, int flags,
+                                sockaddr6_t *from, uint32_t *fromlen)
+{
+    (void) flags;
+
+    if (isUDPSocket(s)) {
+        msg_t m_recv;
+        socket_internal_t *current_socket = get_socket(s);
+        current_socket->recv_pid = thread_getpid();
+
+        if (current_socket->udp_pending) {
+            /* already taken by destiny_socket_poll() */
+            m_recv = current_socket->udp_pending_msg;
+            current_socket->udp_pending = 0;
+        }
+        else {
+            msg_receive(&m_recv);
+        }
 
-        msg_reply(&m_recv, &m_send);
-        return NTOHS(udp_header->length) - UDP_HDR_LEN;
+        return udp_datagram_copy(&m_recv, buf, len, from, fromlen);
     }
     else if (is_tcp_socket(s)) {
         return destiny_socket_recv(s, buf, len, flags);
@@ -998,6 +1788,203 @@ int32_t destiny_socket_recvfrom(int s, void *buf, uint32_t len, int flags,
     }
 }
 
+int destiny_socket_recvmmsg(int s, destiny_socket_mmsg_t *msgvec,
+                            unsigned int vlen, int flags)
+{
+    socket_internal_t *current_socket;
+    unsigned int i = 0;
+    msg_t m_recv;
+
+    (void) flags;
+
+    if (!isUDPSocket(s)) {
+        return -1;
+    }
+
+    current_socket = get_socket(s);
+    current_socket->recv_pid = thread_getpid();
+
+    while (i < vlen) {
+        if (current_socket->udp_pending) {
+            m_recv = current_socket->udp_pending_msg;
+            current_socket->udp_pending = 0;
+        }
+        else if (i == 0) {
+            msg_receive(&m_recv);
+
+            if (!udp_datagram_for(s, &m_recv)) {
+                continue;
+            }
+        }
+        else {
+            /* the UDP thread sends the next datagram once it got the reply */
+            thread_yield();
+
+            if (msg_try_receive(&m_recv) < 0) {
+                break;
+            }
+
+            if (!udp_datagram_for(s, &m_recv)) {
+                break;
+            }
+        }
+
+        msgvec[i].res = udp_datagram_copy(&m_recv, msgvec[i].buf,
+                                          msgvec[i].len, msgvec[i].addr, NULL);
+        i++;
+    }
+
+    return i;
+}
+
+static uint8_t socket_poll_events(int s)
+{
+    socket_internal_t *current_socket = get_socket(s);
+
+    if (current_socket == NULL) {
+        return DESTINY_POLLNVAL;
+    }
+
+    if (isUDPSocket(s)) {
+        return DESTINY_POLLOUT |
+               (current_socket->udp_pending ? DESTINY_POLLIN : 0);
+    }
+
+    if (!is_tcp_socket(s)) {
+        return DESTINY_POLLNVAL;
+    }
+
+    switch (current_socket->socket_values.tcp_control.state) {
+        case TCP_LISTEN:
+            return (current_socket->tcp_accept_numof > 0) ? DESTINY_POLLIN : 0;
+
+        case TCP_ESTABLISHED:
+            return DESTINY_POLLOUT |
+                   ((current_socket->tcp_input_rb.avail > 0) ?
+                    DESTINY_POLLIN : 0);
+
+        case TCP_CLOSED:
+        case TCP_SYN_SENT:
+        case TCP_SYN_RCVD:
+            return 0;
+
+        default:
+            /* closing, the peer will not send any more data */
+            return DESTINY_POLLHUP |
+                   ((current_socket->tcp_input_rb.avail > 0) ?
+                    DESTINY_POLLIN : 0);
+    }
+}
+
+static int socket_poll_check(destiny_socket_pollfd_t *fds, unsigned int nfds)
+{
+    int ready = 0;
+
+    for (unsigned int i = 0; i < nfds; i++) {
+        fds[i].revents = 0;
+
+        if (fds[i].fd < 0) {
+            continue;
+        }
+
+        fds[i].revents = socket_poll_events(fds[i].fd) &
+                         (fds[i].events | DESTINY_POLLERR | DESTINY_POLLHUP |
+                          DESTINY_POLLNVAL);
+
+        if (fds[i].revents != 0) {
+            ready++;
+        }
+    }
+
+    return ready;
+}
+
+int destiny_socket_handle_msg(msg_t *m)
+{
+    msg_t m_send;
+
+    if (m->type == UDP_DATAGRAM) {
+        pktbuf_t *pkt = (pktbuf_t *) m->content.ptr;
+        udp_hdr_t *udp_header = ((udp_hdr_t *)(pkt->data + IPV6_HDR_LEN));
+        socket_internal_t *udp_socket = get_udp_socket(udp_header);
+
+        if ((udp_socket != NULL) && !udp_socket->udp_pending) {
+            /* keep the UDP thread waiting until recvfrom() copied it */
+            udp_socket->udp_pending_msg = *m;
+            udp_socket->udp_pending = 1;
+        }
+        else {
+            msg_reply(m, &m_send);
+        }
+
+        return 1;
+    }
+
+    if (((m->type == UNDEFINED) || (m->type == TCP_ACK) ||
+         (m->type == TCP_SYN_ACK) || (m->type == CLOSE_CONN)) &&
+        (thread_getstatus(m->sender_pid) == STATUS_REPLY_BLOCKED)) {
+        /* the TCP thread waits for the reply, e.g. after new data in an
+         * input buffer, see handle_payload() */
+        net_msg_reply(m, &m_send, UNDEFINED);
+        return 1;
+    }
+
+    return 0;
+}
+
+int destiny_socket_poll(destiny_socket_pollfd_t *fds, unsigned int nfds,
+                        int32_t timeout)
+{
+    msg_t m_recv;
+    timex_t now, deadline;
+    int ready;
+
+    if (timeout > 0) {
+        vtimer_now(&now);
+        deadline = timex_add(now, timex_set(timeout / 1000,
+                                            (timeout % 1000) * 1000));
+    }
+
+    /* all notifications of the transport layer go to the receiving thread */
+    for (unsigned int i = 0; i < nfds; i++) {
+        if (exists_socket(fds[i].fd)) {
+            get_socket(fds[i].fd)->recv_pid = thread_getpid();
+        }
+    }
+
+    while ((ready = socket_poll_check(fds, nfds)) == 0) {
+        if (timeout == 0) {
+            break;
+        }
+
+        if (timeout < 0) {
+            msg_receive(&m_recv);
+        }
+        else {
+            vtimer_now(&now);
+
+            if (timex_cmp(now, deadline) >= 0) {
+                break;
+            }
+
+            if (vtimer_msg_receive_timeout(&m_recv,
+                                           timex_sub(deadline, now)) < 0) {
+                continue;
+            }
+        }
+
+        if (!destiny_socket_handle_msg(&m_recv) &&
+            (thread_getstatus(m_recv.sender_pid) == STATUS_REPLY_BLOCKED)) {
+            /* dropped here, its sender must not wait forever */
+            msg_t m_send;
+
+            net_msg_reply(&m_recv, &m_send, UNDEFINED);
+        }
+    }
+
+    return ready;
+}
+
 int32_t destiny_socket_sendto(int s, const void *buf, uint32_t len, int flags,
                               sockaddr6_t *to, uint32_t tolen)
 {
@@ -1015,7 +2002,14 @@ int32_t destiny_socket_sendto(int s, const void *buf, uint32_t len, int flags,
         memcpy(&(temp_ipv6_header->destaddr), &to->sin6_addr, 16);
         ipv6_net_if_get_best_src_addr(&(temp_ipv6_header->srcaddr), &(temp_ipv6_header->destaddr));
 
-        current_udp_packet->src_port = get_free_source_port(IPPROTO_UDP);
+        /* replies have to come from the port requests went to */
+        current_udp_packet->src_port =
+            get_socket(s)->socket_values.local_address.sin6_port;
+
+        if (current_udp_packet->src_port == 0) {
+            current_udp_packet->src_port = HTONS(get_free_source_port(IPPROTO_UDP));
+        }
+
         current_udp_packet->dst_port = to->sin6_port;
         current_udp_packet->checksum = 0;
 
@@ -1023,11 +2017,14 @@ int32_t destiny_socket_sendto(int s, const void *buf, uint32_t len, int flags,
         current_udp_packet->length = HTONS(UDP_HDR_LEN + len);
         temp_ipv6_header->length = UDP_HDR_LEN + len;
 
+#if !LOWPAN_NHC_UDP_CSUM_ELIDE
         current_udp_packet->checksum = ~ipv6_csum(temp_ipv6_header,
                                        (uint8_t *) current_udp_packet,
                                        UDP_HDR_LEN + len,
                                        IPPROTO_UDP);
+#endif
 
+        NETSTAT_TX(NETSTAT_LAYER_UDP);
         return ipv6_sendto(&to->sin6_addr, IPPROTO_UDP,
                            (uint8_t *)(current_udp_packet),
                            NTOHS(current_udp_packet->length));
@@ -1037,6 +2034,59 @@ int32_t destiny_socket_sendto(int s, const void *buf, uint32_t len, int flags,
     }
 }
 
+int destiny_socket_sendmmsg(int s, destiny_socket_mmsg_t *msgvec,
+                            unsigned int vlen, int flags)
+{
+    unsigned int i;
+
+    for (i = 0; i < vlen; i++) {
+        msgvec[i].res = destiny_socket_sendto(s, msgvec[i].buf, msgvec[i].len,
+                                              flags, msgvec[i].addr,
+                                              sizeof(sockaddr6_t));
+
+        if (msgvec[i].res < 0) {
+            break;
+        }
+    }
+
+    return ((i == 0) && (vlen > 0)) ? -1 : (int) i;
+}
+
+int destiny_socket_set_tcp_cc(int s, uint8_t algorithm)
+{
+    tcp_cb_t *tcp_control;
+
+    if (!is_tcp_socket(s) || (tcp_cc_get(algorithm) == NULL)) {
+        return -1;
+    }
+
+    tcp_control = &get_socket(s)->socket_values.tcp_control;
+    tcp_control->cc_algorithm = algorithm;
+
+    if (tcp_control->state == TCP_ESTABLISHED) {
+        tcp_cc_init(tcp_control);
+    }
+
+    return 0;
+}
+
+int destiny_socket_get_tcp_stats(int s, destiny_socket_tcp_stats_t *stats)
+{
+    tcp_cb_t *tcp_control;
+
+    if (!is_tcp_socket(s)) {
+        return -1;
+    }
+
+    tcp_control = &get_socket(s)->socket_values.tcp_control;
+    *stats = tcp_control->stats;
+    stats->cwnd = tcp_control->cwnd;
+    stats->ssthresh = tcp_control->ssthresh;
+    stats->srtt = tcp_control->srtt;
+
+    return 0;
+}
+
 int destiny_socket_close(int s)
 {
     socket_internal_t *current_socket = get_socket(s);
@@ -1060,6 +2110,9 @@ int destiny_socket_close(int s)
                 return 0;
             }
 
+            /* what the cork held back goes out before the FIN */
+            tcp_cork_flush(s);
+
             current_socket->send_pid = thread_getpid();
 
             /* Refresh local TCP socket information */
@@ -1077,6 +2130,12 @@ int destiny_socket_close(int s)
             return 1;
         }
         else if (isUDPSocket(s)) {
+            if (current_socket->udp_pending) {
+                /* release the UDP thread */
+                msg_t m_send;
+                msg_reply(&current_socket->udp_pending_msg, &m_send);
+            }
+
             close_socket(current_socket);
             return 0;
         }
@@ -1172,10 +2231,20 @@ int destiny_socket_bind(int s, sockaddr6_t *addr, int addrlen)
 
 int destiny_socket_listen(int s, int backlog)
 {
-    (void) backlog;
-
     if (is_tcp_socket(s) && get_socket(s)->socket_values.tcp_control.state == TCP_CLOSED) {
         socket_internal_t *current_socket = get_socket(s);
+
+        if (backlog < 1) {
+            backlog = 1;
+        }
+        else if (backlog > DESTINY_SOCKET_BACKLOG_MAX) {
+            backlog = DESTINY_SOCKET_BACKLOG_MAX;
+        }
+
+        current_socket->tcp_backlog = backlog;
+        current_socket->tcp_syn_numof = 0;
+        current_socket->tcp_accept_head = 0;
+        current_socket->tcp_accept_numof = 0;
         current_socket->socket_values.tcp_control.state = TCP_LISTEN;
         return 0;
     }
@@ -1184,199 +2253,50 @@ int destiny_socket_listen(int s, int backlog)
     }
 }
 
-socket_internal_t *get_waiting_connection_socket(int socket,
-        ipv6_hdr_t *ipv6_header,
-        tcp_hdr_t *tcp_header)
-{
-    int i;
-    socket_internal_t *current_socket, *listening_socket = get_socket(socket);
-
-    for (i = 1; i < MAX_SOCKETS + 1; i++) {
-        current_socket = get_socket(i);
-
-        /* Connection establishment ACK, Check for 4 touple and state */
-        if ((ipv6_header != NULL) && (tcp_header != NULL)) {
-            if (is_four_touple(current_socket, ipv6_header, tcp_header) &&
-                (current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD)) {
-                return current_socket;
-            }
-        }
-        /* Connection establishment SYN ACK, check only for port and state */
-        else {
-            if ((current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD) &&
-                (current_socket->socket_values.local_address.sin6_port ==
-                 listening_socket->socket_values.local_address.sin6_port)) {
-                return current_socket;
-            }
-        }
-    }
-
-    return NULL;
-}
-
-int handle_new_tcp_connection(socket_internal_t *current_queued_int_socket,
-                              socket_internal_t *server_socket, uint8_t pid)
+int destiny_socket_accept(int s, sockaddr6_t *addr, uint32_t *addrlen)
 {
-    (void) pid;
-
-    msg_t msg_recv_client_ack, msg_send_client_ack;
-    socket_t *current_queued_socket = &current_queued_int_socket->socket_values;
-    uint8_t send_buffer[BUFFER_SIZE];
-    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(&send_buffer));
-    tcp_hdr_t *syn_ack_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
-
-    current_queued_int_socket->recv_pid = thread_getpid();
-#ifdef TCP_HC
-    current_queued_int_socket->socket_values.tcp_control.tcp_context.hc_type =
-        FULL_HEADER;
-    memcpy(&current_queued_int_socket->socket_values.tcp_control.tcp_context.context_id,
-           &server_socket->socket_values.tcp_control.tcp_context.context_id,
-           sizeof(server_socket->socket_values.tcp_control.tcp_context.context_id));
-#endif
-    /* Remember current time */
-    timex_t now;
-    vtimer_now(&now);
-    current_queued_int_socket->socket_values.tcp_control.last_packet_time = now;
-
-    current_queued_int_socket->socket_values.tcp_control.no_of_retries = 0;
-
-    /* Set message type to Retry for while loop */
-    msg_recv_client_ack.type = TCP_RETRY;
-
-    while (msg_recv_client_ack.type == TCP_RETRY) {
-        /* Send packet */
-        send_tcp(current_queued_int_socket, syn_ack_packet, temp_ipv6_header,
-                 TCP_SYN_ACK, 0);
-
-        /* wait for ACK from Client */
-        msg_receive(&msg_recv_client_ack);
-
-        if (msg_recv_client_ack.type == TCP_TIMEOUT) {
-            /* Set status of internal socket back to TCP_LISTEN */
-            server_socket->socket_values.tcp_control.state = TCP_LISTEN;
+    socket_internal_t *server_socket = get_socket(s);
+    socket_internal_t *new_socket;
+    unsigned int state;
+    msg_t m_recv;
+    uint8_t id;
 
-            close_socket(current_queued_int_socket);
-            return -1;
-        }
+    if (!is_tcp_socket(s) ||
+        (server_socket->socket_values.tcp_control.state != TCP_LISTEN)) {
+        return -1;
     }
 
-    tcp_hdr_t *tcp_header;
+    server_socket->recv_pid = thread_getpid();
 
-    tcp_header = ((tcp_hdr_t *)(msg_recv_client_ack.content.ptr));
+    /* the TCP thread completes the handshakes and queues the connections,
+     * it must not queue one between the test and msg_receive() */
+    state = disableIRQ();
 
-    /* Check for consistency */
-    if (tcp_header->ack_nr != current_queued_socket->tcp_control.send_nxt + 1) {
-        printf("TCP packets not consistent!\n");
+    while (server_socket->tcp_accept_numof == 0) {
+        msg_receive(&m_recv);
+        disableIRQ();
     }
 
-    /* Got ack, connection established, refresh local and foreign tcp socket
-     * status */
-    set_tcp_cb(&current_queued_socket->tcp_control, tcp_header->seq_nr + 1,
-               current_queued_socket->tcp_control.rcv_wnd, tcp_header->ack_nr,
-               tcp_header->ack_nr, tcp_header->window);
+    id = server_socket->tcp_accept_queue[server_socket->tcp_accept_head];
+    server_socket->tcp_accept_head = (server_socket->tcp_accept_head + 1) %
+                                     DESTINY_SOCKET_BACKLOG_MAX;
+    server_socket->tcp_accept_numof--;
+    restoreIRQ(state);
 
-#ifdef TCP_HC
-    /* Copy TCP context information into new socket */
-    memset(&server_socket->socket_values.tcp_control.tcp_context, 0,
-           sizeof(tcp_hc_context_t));
-#endif
-
-    /* Update connection status information */
-    current_queued_socket->tcp_control.state = TCP_ESTABLISHED;
-
-    /* Set status of internal socket back to TCP_LISTEN */
-    server_socket->socket_values.tcp_control.state = TCP_LISTEN;
-
-    /* send a reply to the TCP handler after processing every information from
-     * the TCP ACK packet */
-    msg_reply(&msg_recv_client_ack, &msg_send_client_ack);
-
-    /* Reset PID to an unlikely value */
-    current_queued_int_socket->recv_pid = 255;
-
-    /* Waiting for Clients ACK waiting period to time out */
-    vtimer_usleep(TCP_SYN_INITIAL_TIMEOUT / 2);
-
-    destiny_socket_print_sockets();
-
-    return current_queued_int_socket->socket_id;
-}
-
-int destiny_socket_accept(int s, sockaddr6_t *addr, uint32_t *addrlen)
-{
-    (void) addr;
-    (void) addrlen;
-
-    socket_internal_t *server_socket = get_socket(s);
-
-    if (is_tcp_socket(s) && (server_socket->socket_values.tcp_control.state == TCP_LISTEN)) {
-        socket_internal_t *current_queued_socket =
-            get_waiting_connection_socket(s, NULL, NULL);
-
-        if (current_queued_socket != NULL) {
-            return handle_new_tcp_connection(current_queued_socket,
-                                             server_socket, thread_getpid());
-        }
-        else {
-            /* No waiting connections, waiting for message from TCP Layer */
-            msg_t msg_recv_client_syn;
-            msg_recv_client_syn.type = UNDEFINED;
+    new_socket = get_socket(id);
 
-            while (msg_recv_client_syn.type != TCP_SYN) {
-                msg_receive(&msg_recv_client_syn);
-            }
-
-            current_queued_socket = get_waiting_connection_socket(s, NULL, NULL);
-
-            return handle_new_tcp_connection(current_queued_socket,
-                                             server_socket, thread_getpid());
-        }
-    }
-    else {
+    if (new_socket == NULL) {
         return -1;
     }
-}
-
-socket_internal_t *new_tcp_queued_socket(ipv6_hdr_t *ipv6_header,
-        tcp_hdr_t *tcp_header)
-{
-    int queued_socket_id;
-
-    queued_socket_id = destiny_socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP);
-    socket_internal_t *current_queued_socket = get_socket(queued_socket_id);
-
-    /* Foreign address */
-    set_socket_address(&current_queued_socket->socket_values.foreign_address,
-                       AF_INET6, tcp_header->src_port, ipv6_header->flowlabel,
-                       &ipv6_header->srcaddr);
 
-    /* Local address */
-    set_socket_address(&current_queued_socket->socket_values.local_address,
-                       AF_INET6, tcp_header->dst_port, 0,
-                       &ipv6_header->destaddr);
+    if (addr != NULL) {
+        memcpy(addr, &new_socket->socket_values.foreign_address,
+               sizeof(sockaddr6_t));
 
-    /* Foreign TCP information */
-    if ((tcp_header->dataOffset_reserved * 4 > TCP_HDR_LEN) &&
-        (*(((uint8_t *)tcp_header) + TCP_HDR_LEN) == TCP_MSS_OPTION)) {
-        current_queued_socket->socket_values.tcp_control.mss =
-            *((uint16_t *)(((uint8_t *)tcp_header) + TCP_HDR_LEN + 2));
-    }
-    else {
-        current_queued_socket->socket_values.tcp_control.mss = DESTINY_SOCKET_STATIC_MSS;
+        if (addrlen != NULL) {
+            *addrlen = sizeof(sockaddr6_t);
+        }
     }
 
-    current_queued_socket->socket_values.tcp_control.rcv_irs =
-        tcp_header->seq_nr;
-    mutex_lock(&global_sequence_counter_mutex);
-    current_queued_socket->socket_values.tcp_control.send_iss =
-        global_sequence_counter;
-    mutex_unlock(&global_sequence_counter_mutex);
-    current_queued_socket->socket_values.tcp_control.state = TCP_SYN_RCVD;
-    set_tcp_cb(&current_queued_socket->socket_values.tcp_control,
-               tcp_header->seq_nr + 1, DESTINY_SOCKET_STATIC_WINDOW,
-               current_queued_socket->socket_values.tcp_control.send_iss,
-               current_queued_socket->socket_values.tcp_control.send_iss,
-               tcp_header->window);
-
-    return current_queued_socket;
+    return id;
 }
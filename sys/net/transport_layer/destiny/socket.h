@@ -2,14 +2,29 @@
 #define _DESTINY_SOCKET
 
 #include "cpu.h"
+#include "ringbuffer.h"
 
 #include "destiny/socket.h"
 
 #include "tcp.h"
 #include "udp.h"
 
-#define MAX_SOCKETS			5
-// #define MAX_QUEUED_SOCKETS	2
+#ifndef MAX_SOCKETS
+#define MAX_SOCKETS			5	// at most 255, IDs are 8 bit
+#endif
+// buckets of the demultiplexing tables, must be a power of two
+#ifndef DESTINY_SOCKET_HASH_BUCKETS
+#define DESTINY_SOCKET_HASH_BUCKETS	8
+#endif
+// connections in the handshake, for all listening sockets together
+#ifndef DESTINY_SOCKET_SYN_CACHE_SIZE
+#define DESTINY_SOCKET_SYN_CACHE_SIZE	8
+#endif
+// connections a listening socket holds until accept(), the backlog is
+// capped to this
+#ifndef DESTINY_SOCKET_BACKLOG_MAX
+#define DESTINY_SOCKET_BACKLOG_MAX	4
+#endif
 
 #define INC_PACKET			0
 #define OUT_PACKET			1
@@ -45,6 +60,18 @@ typedef struct __attribute__((packed)) {
     double				rttvar;
     double				rto;
 
+    // congestion control, see tcp_cc.h
+    uint8_t				cc_algorithm;
+    uint16_t			cwnd;
+    uint16_t			ssthresh;
+    uint8_t				dupacks; // counted by the TCP thread
+    uint8_t				ack_pending; // in-order segments received but not acknowledged
+    uint8_t				in_recovery;
+    uint32_t			recover; // send_nxt when recovery started
+    uint32_t			base_delay; // lowest RTT seen, for LEDBAT
+    int16_t			cwnd_frac; // growth below one byte in 1/256 byte, for LEDBAT
+    destiny_socket_tcp_stats_t stats;
+
 #ifdef TCP_HC
     tcp_hc_context_t	tcp_context;
 #endif
@@ -59,27 +86,77 @@ typedef struct __attribute__((packed)) {
     sockaddr6_t			foreign_address;
 } socket_t;
 
+// Out-of-order segments held back per socket until the gap before them is filled
+#define TCP_REAS_QUEUE_LEN	DESTINY_SOCKET_WINDOW_SEGMENTS
+// Unacknowledged segments tracked per destiny_socket_send() call
+#define TCP_SEND_QUEUE_LEN	DESTINY_SOCKET_WINDOW_SEGMENTS
+
+typedef struct __attribute__((packed)) {
+    uint32_t			seq;
+    uint16_t			len;
+} tcp_seg_t;
+
+// A connection after its SYN until the ACK of the SYN-ACK, a full socket is
+// taken only then. The local port is that of the listening socket.
+typedef struct __attribute__((packed)) {
+    uint8_t				listener;	// socket ID, 0 if the entry is free
+    uint8_t				next;		// entry in the hash chain, index + 1
+    uint8_t				bucket;
+    uint16_t			foreign_port;
+    ipv6_addr_t			local_addr;
+    ipv6_addr_t			foreign_addr;
+    uint32_t			flowinfo;
+    uint32_t			irs;
+    uint32_t			iss;
+    uint16_t			mss;
+    uint16_t			wnd;
+    timex_t				syn_time;	// of the first SYN
+#ifdef TCP_HC
+    uint16_t			context_id;
+#endif
+} tcp_syn_entry_t;
+
 typedef struct __attribute__((packed)) {
     uint8_t				socket_id;
     uint8_t				recv_pid;
     uint8_t				send_pid;
-    uint8_t				tcp_input_buffer_end;
+    ringbuffer_t		tcp_input_rb;		// in-order data of tcp_input_buffer
     mutex_t				tcp_buffer_mutex;
     socket_t			socket_values;
     uint8_t				tcp_input_buffer[DESTINY_SOCKET_MAX_TCP_BUFFER];
+    // received segments behind a gap, their data is already stored behind
+    // the in-order data of tcp_input_rb
+    uint8_t				tcp_reas_numof;
+    tcp_seg_t			tcp_reas_queue[TCP_REAS_QUEUE_LEN];
+    // small writes held back by destiny_socket_set_tcp_cork()
+    uint8_t				tcp_cork;
+    uint8_t				tcp_cork_len;
+    uint8_t				tcp_cork_buffer[DESTINY_SOCKET_CORK_BUFFER];
+    // datagram taken by destiny_socket_poll(), the UDP thread waits for its reply
+    uint8_t				udp_pending;
+    msg_t				udp_pending_msg;
+    // pseudo header and ports of a connected UDP socket, summed by connect()
+    uint16_t			udp_csum_partial;
+    // listening TCP socket: connections in the SYN cache and established
+    // ones waiting for accept(), together at most tcp_backlog
+    uint8_t				tcp_backlog;
+    uint8_t				tcp_syn_numof;
+    uint8_t				tcp_accept_head;
+    uint8_t				tcp_accept_numof;
+    uint8_t				tcp_accept_queue[DESTINY_SOCKET_BACKLOG_MAX];
 } socket_internal_t;
 
 extern socket_internal_t sockets[MAX_SOCKETS];
 
-socket_internal_t *get_waiting_connection_socket(int socket,
-        ipv6_hdr_t *ipv6_header,
-        tcp_hdr_t *tcp_header);
 void close_socket(socket_internal_t *current_socket);
 socket_internal_t *get_socket(int s);
 socket_internal_t *get_udp_socket(udp_hdr_t *udp_header);
 socket_internal_t *get_tcp_socket(ipv6_hdr_t *ipv6_header,
                                   tcp_hdr_t *tcp_header);
-socket_internal_t *new_tcp_queued_socket(ipv6_hdr_t *ipv6_header,
+int tcp_syn_cache_add(socket_internal_t *listening_socket,
+                      ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header);
+socket_internal_t *tcp_syn_cache_complete(socket_internal_t *listening_socket,
+        ipv6_hdr_t *ipv6_header,
         tcp_hdr_t *tcp_header);
 void print_tcp_status(int in_or_out, ipv6_hdr_t *ipv6_header,
                       tcp_hdr_t *tcp_header, socket_t *tcp_socket);
@@ -90,6 +167,9 @@ void switch_tcp_packet_byte_order(tcp_hdr_t *current_tcp_packet);
 int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
              ipv6_hdr_t *temp_ipv6_header, uint8_t flags,
              uint8_t payload_length);
+int send_tcp_seq(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
+                 ipv6_hdr_t *temp_ipv6_header, uint8_t flags,
+                 uint8_t payload_length, uint32_t seq);
 bool is_tcp_socket(int s);
 
 #endif /* _DESTINY_SOCKET */
@@ -27,6 +27,7 @@
 #include "destiny/in.h"
 
 #include "net_help.h"
+#include "netstat.h"
 
 #include "msg_help.h"
 #include "socket.h"
@@ -43,6 +44,18 @@ uint8_t             global_context_counter;
 mutex_t             global_sequence_counter_mutex;
 uint32_t            global_sequence_counter;
 
+void inc_global_variables(void)
+{
+    mutex_lock(&global_sequence_counter_mutex);
+    global_sequence_counter += rand();
+    mutex_unlock(&global_sequence_counter_mutex);
+#ifdef TCP_HC
+    mutex_lock(&global_context_counter_mutex);
+    global_context_counter += rand();
+    mutex_unlock(&global_context_counter_mutex);
+#endif
+}
+
 void printTCPHeader(tcp_hdr_t *tcp_header)
 {
     printf("\nBEGIN: TCP HEADER\n");
@@ -81,37 +94,117 @@ uint16_t tcp_csum(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header)
     return (sum == 0) ? 0xffff : HTONS(sum);
 }
 
-uint8_t handle_payload(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
-                       socket_internal_t *tcp_socket, uint8_t *payload)
+/* Records an out-of-order segment, keeping the queue sorted by sequence
+ * number and merging segments that touch */
+static void tcp_reas_insert(socket_internal_t *tcp_socket, uint32_t seq,
+                            uint16_t len)
 {
-    (void) tcp_header;
+    tcp_seg_t *queue = tcp_socket->tcp_reas_queue;
+    uint8_t i = 0, j;
+
+    while ((i < tcp_socket->tcp_reas_numof) && SEQ_LT(queue[i].seq + queue[i].len, seq)) {
+        i++;
+    }
+
+    if ((i < tcp_socket->tcp_reas_numof) && SEQ_LEQ(queue[i].seq, seq + len)) {
+        /* overlaps or touches queue[i], grow it and swallow its successors */
+        uint32_t end = seq + len;
+
+        if (SEQ_LT(queue[i].seq, seq)) {
+            seq = queue[i].seq;
+        }
+
+        for (j = i; (j < tcp_socket->tcp_reas_numof) && SEQ_LEQ(queue[j].seq, end); j++) {
+            if (SEQ_GT(queue[j].seq + queue[j].len, end)) {
+                end = queue[j].seq + queue[j].len;
+            }
+        }
+
+        queue[i].seq = seq;
 
+        queue[i].len = end - queue[i].seq;
+        memmove(&queue[i + 1], &queue[j],
+                (tcp_socket->tcp_reas_numof - j) * sizeof(tcp_seg_t));
+        tcp_socket->tcp_reas_numof -= j - (i + 1);
+        return;
+    }
+
+    if (tcp_socket->tcp_reas_numof == TCP_REAS_QUEUE_LEN) {
+        /* forget it, the sender will retransmit */
+        NETSTAT_DROP(NETSTAT_LAYER_TCP, NETSTAT_DROP_SOCKET_FULL);
+        return;
+    }
+
+    memmove(&queue[i + 1], &queue[i],
+            (tcp_socket->tcp_reas_numof - i) * sizeof(tcp_seg_t));
+    queue[i].seq = seq;
+    queue[i].len = len;
+    tcp_socket->tcp_reas_numof++;
+}
+
+/* Returns the first sequence number not covered by an in-order byte stream
+ * that currently ends at *next*, consuming the queued segments it passes */
+static uint32_t tcp_reas_collect(socket_internal_t *tcp_socket, uint32_t next)
+{
+    tcp_seg_t *queue = tcp_socket->tcp_reas_queue;
+    uint8_t i = 0;
+
+    while ((i < tcp_socket->tcp_reas_numof) && SEQ_LEQ(queue[i].seq, next)) {
+        if (SEQ_GT(queue[i].seq + queue[i].len, next)) {
+            next = queue[i].seq + queue[i].len;
+        }
+        i++;
+    }
+
+    memmove(&queue[0], &queue[i],
+            (tcp_socket->tcp_reas_numof - i) * sizeof(tcp_seg_t));
+    tcp_socket->tcp_reas_numof -= i;
+
+    return next;
+}
+
+uint16_t handle_payload(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
+                        socket_internal_t *tcp_socket, uint8_t *payload)
+{
     msg_t m_send_tcp, m_recv_tcp;
-    uint8_t tcp_payload_len = ipv6_header->length - TCP_HDR_LEN;
-    uint8_t acknowledged_bytes = 0;
-
-    if (tcp_payload_len > tcp_socket->socket_values.tcp_control.rcv_wnd) {
-        mutex_lock(&tcp_socket->tcp_buffer_mutex);
-        memcpy(tcp_socket->tcp_input_buffer, payload,
-               tcp_socket->socket_values.tcp_control.rcv_wnd);
-        acknowledged_bytes = tcp_socket->socket_values.tcp_control.rcv_wnd;
-        tcp_socket->socket_values.tcp_control.rcv_wnd = 0;
-        tcp_socket->tcp_input_buffer_end = tcp_socket->tcp_input_buffer_end +
-                                           tcp_socket->socket_values.tcp_control.rcv_wnd;
-        mutex_unlock(&tcp_socket->tcp_buffer_mutex);
+    tcp_cb_t *tcp_control = &tcp_socket->socket_values.tcp_control;
+    uint16_t tcp_payload_len = ipv6_header->length -
+                               tcp_header->dataOffset_reserved * 4;
+    uint32_t offset = tcp_header->seq_nr - tcp_control->rcv_nxt;
+    uint16_t acknowledged_bytes = 0;
+
+    if (offset >= tcp_control->rcv_wnd) {
+        /* nothing of it fits into the receive window */
+        NETSTAT_DROP(NETSTAT_LAYER_TCP, NETSTAT_DROP_SOCKET_FULL);
+        return 0;
+    }
+
+    if (tcp_payload_len > tcp_control->rcv_wnd - offset) {
+        tcp_payload_len = tcp_control->rcv_wnd - offset;
+    }
+
+    mutex_lock(&tcp_socket->tcp_buffer_mutex);
+    /* segments ahead of rcv_nxt are placed where they belong in the stream,
+     * behind the gap that is still missing */
+    rb_write_elements(&tcp_socket->tcp_input_rb, offset, (char *) payload,
+                      tcp_payload_len);
+
+    if (offset == 0) {
+        acknowledged_bytes = tcp_reas_collect(tcp_socket, tcp_header->seq_nr +
+                                              tcp_payload_len) -
+                             tcp_control->rcv_nxt;
+        tcp_control->rcv_nxt += acknowledged_bytes;
+        tcp_control->rcv_wnd -= acknowledged_bytes;
+        rb_commit_elements(&tcp_socket->tcp_input_rb, acknowledged_bytes);
     }
     else {
-        mutex_lock(&tcp_socket->tcp_buffer_mutex);
-        memcpy(tcp_socket->tcp_input_buffer, payload, tcp_payload_len);
-        tcp_socket->socket_values.tcp_control.rcv_wnd =
-            tcp_socket->socket_values.tcp_control.rcv_wnd - tcp_payload_len;
-        acknowledged_bytes = tcp_payload_len;
-        tcp_socket->tcp_input_buffer_end = tcp_socket->tcp_input_buffer_end +
-                                           tcp_payload_len;
-        mutex_unlock(&tcp_socket->tcp_buffer_mutex);
+        tcp_reas_insert(tcp_socket, tcp_header->seq_nr, tcp_payload_len);
     }
 
-    if (thread_getstatus(tcp_socket->recv_pid) == STATUS_RECEIVE_BLOCKED) {
+    mutex_unlock(&tcp_socket->tcp_buffer_mutex);
+
+    if ((acknowledged_bytes > 0) &&
+        (thread_getstatus(tcp_socket->recv_pid) == STATUS_RECEIVE_BLOCKED)) {
         net_msg_send_recv(&m_send_tcp, &m_recv_tcp, tcp_socket->recv_pid, UNDEFINED);
     }
 
@@ -121,7 +214,7 @@ uint8_t handle_payload(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
 void handle_tcp_ack_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
                            socket_internal_t *tcp_socket)
 {
-    msg_t m_recv_tcp, m_send_tcp;
+    msg_t m_send_tcp;
     uint8_t target_pid;
 
     if (tcp_socket->socket_values.tcp_control.state == TCP_LAST_ACK) {
@@ -135,14 +228,37 @@ void handle_tcp_ack_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
         msg_send(&m_send_tcp, tcp_socket->send_pid, 0);
         return;
     }
-    else if (get_waiting_connection_socket(tcp_socket->socket_id, ipv6_header,
-                                           tcp_header) != NULL) {
-        m_send_tcp.content.ptr = (char *)tcp_header;
-        net_msg_send_recv(&m_send_tcp, &m_recv_tcp, tcp_socket->recv_pid, TCP_ACK);
+    else if (tcp_socket->socket_values.tcp_control.state == TCP_LISTEN) {
+        /* the last ACK of a handshake in the SYN cache */
+        if (tcp_syn_cache_complete(tcp_socket, ipv6_header, tcp_header) == NULL) {
+            NETSTAT_DROP(NETSTAT_LAYER_TCP, NETSTAT_DROP_NO_HANDLER);
+        }
+
         return;
     }
     else if (tcp_socket->socket_values.tcp_control.state == TCP_ESTABLISHED) {
-        if (check_tcp_consistency(&tcp_socket->socket_values, tcp_header) == PACKET_OK) {
+        tcp_cb_t *tcp_control = &tcp_socket->socket_values.tcp_control;
+        int consistency = check_tcp_consistency(&tcp_socket->socket_values,
+                                                tcp_header);
+
+        if ((consistency == PACKET_OK) ||
+            ((consistency == ACK_NO_TOO_SMALL) &&
+             (tcp_header->ack_nr == tcp_control->send_una) &&
+             (tcp_control->send_nxt != tcp_control->send_una))) {
+            /* ACKs are cumulative, everything before ack_nr has arrived.
+             * A repeated ACK may still open the window, if it does not it
+             * hints at a lost segment. The sending thread picks the new
+             * values up from the control block. */
+            if (consistency == PACKET_OK) {
+                tcp_control->dupacks = 0;
+            }
+            else if ((tcp_header->window == tcp_control->send_wnd) &&
+                     (tcp_control->dupacks < UINT8_MAX)) {
+                tcp_control->dupacks++;
+            }
+
+            tcp_control->send_una = tcp_header->ack_nr;
+            tcp_control->send_wnd = tcp_header->window;
             m_send_tcp.content.ptr = (char *)tcp_header;
             net_msg_send(&m_send_tcp, tcp_socket->send_pid, 0, TCP_ACK);
             return;
@@ -165,25 +281,12 @@ void handle_tcp_rst_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
 void handle_tcp_syn_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
                            socket_internal_t *tcp_socket)
 {
-    msg_t m_send_tcp;
-
     if (tcp_socket->socket_values.tcp_control.state == TCP_LISTEN) {
-        socket_internal_t *new_socket = new_tcp_queued_socket(ipv6_header,
-                                        tcp_header);
-
-        if (new_socket != NULL) {
-#ifdef TCP_HC
-            update_tcp_hc_context(true, new_socket, tcp_header);
-#endif
-            /* notify socket function destiny_socket_accept(..) that a new
-             * connection request has arrived. No need to wait for an answer
-             * because the server destiny_socket_accept() function isnt reading
-             * from anything other than the queued sockets */
-            net_msg_send(&m_send_tcp, tcp_socket->recv_pid, 0, TCP_SYN);
-        }
-        else {
-            printf("Dropped TCP SYN Message because an error occured while "\
-                   "requesting a new queued socket!\n");
+        /* answered right here, destiny_socket_accept() only hears of the
+         * connection once the handshake is complete */
+        if (tcp_syn_cache_add(tcp_socket, ipv6_header, tcp_header) < 0) {
+            /* the backlog is full, the peer sends its SYN again */
+            NETSTAT_DROP(NETSTAT_LAYER_TCP, NETSTAT_DROP_SOCKET_FULL);
         }
     }
     else {
@@ -270,7 +373,8 @@ void handle_tcp_fin_ack_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
 void handle_tcp_no_flags_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
                                 socket_internal_t *tcp_socket, uint8_t *payload)
 {
-    uint8_t tcp_payload_len = ipv6_header->length - TCP_HDR_LEN, read_bytes = 0;
+    uint16_t tcp_payload_len = ipv6_header->length -
+                               tcp_header->dataOffset_reserved * 4;
     socket_t *current_tcp_socket = &tcp_socket->socket_values;
     uint8_t send_buffer[BUFFER_SIZE];
     ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(&send_buffer));
@@ -279,17 +383,23 @@ void handle_tcp_no_flags_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
     if (tcp_payload_len > 0) {
 
         if (check_tcp_consistency(current_tcp_socket, tcp_header) == PACKET_OK) {
-            read_bytes = handle_payload(ipv6_header, tcp_header, tcp_socket, payload);
+            /* advances rcv_nxt over everything that is now in order, an
+             * out-of-order segment gets a duplicate ACK for the gap */
+            uint16_t acknowledged = handle_payload(ipv6_header, tcp_header,
+                                                   tcp_socket, payload);
 
             /* Refresh TCP status values */
             current_tcp_socket->tcp_control.state = TCP_ESTABLISHED;
 
-            set_tcp_cb(&current_tcp_socket->tcp_control,
-                       tcp_header->seq_nr + read_bytes,
-                       current_tcp_socket->tcp_control.rcv_wnd,
-                       current_tcp_socket->tcp_control.send_nxt,
-                       current_tcp_socket->tcp_control.send_una,
-                       current_tcp_socket->tcp_control.send_wnd);
+            /* an in-order segment with nothing missing behind it may wait
+             * for the next one, gaps and their fills are reported at once */
+            if ((acknowledged == tcp_payload_len) &&
+                (tcp_socket->tcp_reas_numof == 0) &&
+                (++current_tcp_socket->tcp_control.ack_pending <
+                 TCP_DELAYED_ACK_SEGMENTS)) {
+                tcp_timer_delay_ack(tcp_socket);
+                return;
+            }
 
             /* Send packet */
             //			block_continue_thread();
@@ -312,6 +422,7 @@ void handle_tcp_no_flags_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
 void tcp_packet_handler(void)
 {
     msg_t m_recv_ip, m_send_ip;
+    pktbuf_t *pkt;
     ipv6_hdr_t *ipv6_header;
     tcp_hdr_t *tcp_header;
     uint8_t *payload;
@@ -321,8 +432,9 @@ void tcp_packet_handler(void)
     while (1) {
         msg_receive(&m_recv_ip);
 
-        ipv6_header = ((ipv6_hdr_t *)m_recv_ip.content.ptr);
-        tcp_header = ((tcp_hdr_t *)(m_recv_ip.content.ptr + IPV6_HDR_LEN));
+        pkt = (pktbuf_t *) m_recv_ip.content.ptr;
+        ipv6_header = ((ipv6_hdr_t *) pkt->data);
+        tcp_header = ((tcp_hdr_t *)(pkt->data + IPV6_HDR_LEN));
 #ifdef TCP_HC
         tcp_socket = decompress_tcp_packet(ipv6_header);
 #else
@@ -331,10 +443,11 @@ void tcp_packet_handler(void)
 #endif
         chksum = tcp_csum(ipv6_header, tcp_header);
 
-        payload = (uint8_t *)(m_recv_ip.content.ptr + IPV6_HDR_LEN +
+        payload = (uint8_t *)(pkt->data + IPV6_HDR_LEN +
                               tcp_header->dataOffset_reserved * 4);
 
         if ((chksum == 0xffff) && (tcp_socket != NULL)) {
+            NETSTAT_RX(NETSTAT_LAYER_TCP);
 #ifdef TCP_HC
             update_tcp_hc_context(true, tcp_socket, tcp_header);
 #endif
@@ -393,6 +506,8 @@ void tcp_packet_handler(void)
         else {
             printf("Wrong checksum (%x) or no corresponding socket found!\n",
                    chksum);
+            NETSTAT_DROP(NETSTAT_LAYER_TCP, (chksum != 0xffff) ?
+                         NETSTAT_DROP_CHECKSUM : NETSTAT_DROP_NO_HANDLER);
             printArrayRange(((uint8_t *)ipv6_header), IPV6_HDR_LEN +
                             ipv6_header->length, "Incoming");
             print_tcp_status(INC_PACKET, ipv6_header, tcp_header,
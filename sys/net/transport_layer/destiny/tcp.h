@@ -62,6 +62,13 @@ enum tcp_codes {
 
 #define REMOVE_RESERVED         (0xFC)
 
+/* sequence number comparisons, correct across the 2^32 wrap as long as the
+ * numbers compared are less than 2^31 apart */
+#define SEQ_LT(a, b)            ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+#define SEQ_LEQ(a, b)           ((int32_t)((uint32_t)(a) - (uint32_t)(b)) <= 0)
+#define SEQ_GT(a, b)            ((int32_t)((uint32_t)(a) - (uint32_t)(b)) > 0)
+#define SEQ_GEQ(a, b)           ((int32_t)((uint32_t)(a) - (uint32_t)(b)) >= 0)
+
 #define IS_TCP_ACK(a)           (((a) & TCP_ACK)      == TCP_ACK) /* Test for ACK flag only, ignore URG und PSH flag */
 #define IS_TCP_RST(a)           (((a) & TCP_RST)      == TCP_RST)
 #define IS_TCP_SYN(a)           (((a) & TCP_SYN)      == TCP_SYN)
@@ -93,6 +100,8 @@ extern mutex_t             global_sequence_counter_mutex;
 extern uint32_t            global_sequence_counter;
 
 void tcp_packet_handler(void);
+// moves the counters on before they are used for a new connection
+void inc_global_variables(void);
 uint16_t tcp_csum(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header);
 void printTCPHeader(tcp_hdr_t *tcp_header);
 void printArrayRange_tcp(uint8_t *udp_header, uint16_t len);
@@ -0,0 +1,137 @@
+/**
+ * Destiny TCP congestion control
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup destiny
+ * @{
+ * @file    tcp_cc.c
+ * @brief   NewReno and LEDBAT window control
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "destiny/socket.h"
+
+#include "socket.h"
+
+#include "tcp_cc.h"
+
+#define TCP_CC_CWND_MAX     (0xffff)
+
+static void tcp_cc_cwnd_add(tcp_cb_t *tcp_control, int32_t inc)
+{
+    int32_t cwnd = (int32_t) tcp_control->cwnd + inc;
+
+    if (cwnd < tcp_control->mss) {
+        cwnd = tcp_control->mss;
+    }
+    else if (cwnd > TCP_CC_CWND_MAX) {
+        cwnd = TCP_CC_CWND_MAX;
+    }
+
+    tcp_control->cwnd = cwnd;
+}
+
+static void newreno_init(tcp_cb_t *tcp_control)
+{
+    tcp_control->cwnd = TCP_CC_INITIAL_WINDOW * tcp_control->mss;
+    tcp_control->ssthresh = TCP_CC_CWND_MAX;
+}
+
+static void newreno_ack(tcp_cb_t *tcp_control, uint16_t acked, uint32_t rtt)
+{
+    (void) rtt;
+
+    if (tcp_control->cwnd < tcp_control->ssthresh) {
+        /* slow start, at most one MSS per ACK (RFC 5681, 3.1) */
+        tcp_cc_cwnd_add(tcp_control, (acked < tcp_control->mss) ?
+                        acked : tcp_control->mss);
+    }
+    else {
+        /* congestion avoidance, about one MSS per RTT */
+        uint32_t inc = ((uint32_t) tcp_control->mss * tcp_control->mss) /
+                       tcp_control->cwnd;
+
+        tcp_cc_cwnd_add(tcp_control, (inc > 0) ? inc : 1);
+    }
+}
+
+static void newreno_loss(tcp_cb_t *tcp_control, tcp_cc_loss_t type,
+                         uint32_t flight)
+{
+    uint32_t half = flight / 2;
+
+    tcp_control->ssthresh = (half > 2 * tcp_control->mss) ?
+                            half : 2 * tcp_control->mss;
+
+    if (type == TCP_CC_LOSS_TIMEOUT) {
+        /* loss window */
+        tcp_control->cwnd = tcp_control->mss;
+    }
+    else {
+        /* fast recovery inflates by the segments that have left the network */
+        tcp_control->cwnd = tcp_control->ssthresh +
+                            TCP_CC_DUPACK_THRESHOLD * tcp_control->mss;
+    }
+}
+
+/*
+ * LEDBAT (RFC 6817) with the RTT standing in for the one-way delay: the
+ * queuing delay is the smoothed RTT above the lowest RTT ever seen. The
+ * window grows while it is below TCP_LEDBAT_TARGET and shrinks above it,
+ * so bulk uploads back off before loss based flows suffer.
+ */
+static void ledbat_ack(tcp_cb_t *tcp_control, uint16_t acked, uint32_t rtt)
+{
+    int32_t queuing, off_target, change;
+
+    if ((rtt != 0) &&
+        ((tcp_control->base_delay == 0) || (rtt < tcp_control->base_delay))) {
+        tcp_control->base_delay = rtt;
+    }
+
+    if (tcp_control->base_delay == 0) {
+        /* no delay sample yet */
+        newreno_ack(tcp_control, acked, rtt);
+        return;
+    }
+
+    queuing = (int32_t) tcp_control->srtt - (int32_t) tcp_control->base_delay;
+
+    if (queuing < 0) {
+        queuing = 0;
+    }
+    else if (queuing > 2 * TCP_LEDBAT_TARGET) {
+        queuing = 2 * TCP_LEDBAT_TARGET;
+    }
+
+    /* -256 .. 256 for (TARGET - queuing) / TARGET */
+    off_target = ((TCP_LEDBAT_TARGET - queuing) * 256) / TCP_LEDBAT_TARGET;
+
+    /* in 1/256 byte: GAIN * off_target * acked * MSS / cwnd */
+    change = (TCP_LEDBAT_GAIN * off_target * acked * tcp_control->mss) /
+             tcp_control->cwnd + tcp_control->cwnd_frac;
+
+    tcp_control->cwnd_frac = change % 256;
+    tcp_cc_cwnd_add(tcp_control, change / 256);
+}
+
+static const tcp_cc_ops_t tcp_cc_algorithms[] = {
+    [DESTINY_TCP_CC_NEWRENO] = { newreno_init, newreno_ack, newreno_loss },
+    [DESTINY_TCP_CC_LEDBAT] = { newreno_init, ledbat_ack, newreno_loss },
+};
+
+const tcp_cc_ops_t *tcp_cc_get(uint8_t algorithm)
+{
+    if (algorithm >= sizeof(tcp_cc_algorithms) / sizeof(tcp_cc_algorithms[0])) {
+        return NULL;
+    }
+
+    return &tcp_cc_algorithms[algorithm];
+}
@@ -0,0 +1,96 @@
+/**
+ * Destiny TCP congestion control
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup destiny
+ * @{
+ * @file    tcp_cc.h
+ * @brief   Interface between the TCP sender and congestion control algorithms
+ *
+ * The sender in destiny_socket_send() detects losses and runs fast
+ * retransmit and NewReno fast recovery itself. An algorithm only decides
+ * how tcp_cb_t::cwnd and tcp_cb_t::ssthresh react to new ACKs and losses.
+ */
+
+#ifndef TCP_CC_H_
+#define TCP_CC_H_
+
+#include <stdint.h>
+
+#include "socket.h"
+
+/**
+ * Initial congestion window in segments (RFC 3390 allows up to 4, lossy
+ * links prefer fewer).
+ */
+#ifndef TCP_CC_INITIAL_WINDOW
+#define TCP_CC_INITIAL_WINDOW       2
+#endif
+
+/** Duplicate ACKs that trigger a fast retransmit */
+#define TCP_CC_DUPACK_THRESHOLD     3
+
+/** Queuing delay LEDBAT aims for, in microseconds */
+#ifndef TCP_LEDBAT_TARGET
+#define TCP_LEDBAT_TARGET           (100 * 1000)
+#endif
+
+/** Growth of the window per RTT at zero queuing delay, in segments */
+#ifndef TCP_LEDBAT_GAIN
+#define TCP_LEDBAT_GAIN             1
+#endif
+
+typedef enum {
+    TCP_CC_LOSS_DUPACK,     ///< fast retransmit after duplicate ACKs
+    TCP_CC_LOSS_TIMEOUT     ///< retransmission timer expired
+} tcp_cc_loss_t;
+
+typedef struct {
+    /** set up the windows of a fresh connection */
+    void (*init)(tcp_cb_t *tcp_control);
+    /** *acked* new bytes got acknowledged outside of fast recovery, *rtt*
+     * is a round trip sample in microseconds or 0 if none was taken */
+    void (*ack)(tcp_cb_t *tcp_control, uint16_t acked, uint32_t rtt);
+    /** a loss was detected while *flight* bytes were outstanding */
+    void (*loss)(tcp_cb_t *tcp_control, tcp_cc_loss_t type, uint32_t flight);
+} tcp_cc_ops_t;
+
+/**
+ * @brief   Returns the operations of a DESTINY_TCP_CC_* algorithm, NULL if
+ *          it is unknown.
+ */
+const tcp_cc_ops_t *tcp_cc_get(uint8_t algorithm);
+
+static inline void tcp_cc_init(tcp_cb_t *tcp_control)
+{
+    tcp_control->dupacks = 0;
+    tcp_control->in_recovery = 0;
+    /* no recovery yet, the first loss may be repaired by one; compared
+     * with SEQ_GT(), so this holds across the wrap as well */
+    tcp_control->recover = tcp_control->send_una - 1;
+    tcp_control->cwnd_frac = 0;
+    tcp_cc_get(tcp_control->cc_algorithm)->init(tcp_control);
+}
+
+static inline void tcp_cc_ack(tcp_cb_t *tcp_control, uint16_t acked,
+                              uint32_t rtt)
+{
+    tcp_cc_get(tcp_control->cc_algorithm)->ack(tcp_control, acked, rtt);
+}
+
+static inline void tcp_cc_loss(tcp_cb_t *tcp_control, tcp_cc_loss_t type,
+                               uint32_t flight)
+{
+    tcp_cc_get(tcp_control->cc_algorithm)->loss(tcp_control, type, flight);
+}
+
+/**
+ * @}
+ */
+
+#endif /* TCP_CC_H_ */
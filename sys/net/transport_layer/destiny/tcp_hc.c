@@ -31,21 +31,42 @@
 
 #ifdef TCP_HC
 
+/* sockets by the low bits of their context ID, verified on every use */
+#define TCP_HC_INDEX_SIZE   (8)
+
+static uint8_t tcp_hc_index[TCP_HC_INDEX_SIZE];
+
+static bool tcp_hc_context_matches(socket_internal_t *temp_socket,
+                                   ipv6_hdr_t *current_ipv6_header,
+                                   uint16_t current_context)
+{
+    return (temp_socket != NULL) &&
+           (temp_socket->socket_values.tcp_control.tcp_context.context_id ==
+            current_context) &&
+           ipv6_addr_is_equal(&temp_socket->socket_values.foreign_address.sin6_addr,
+                              &current_ipv6_header->srcaddr) &&
+           ipv6_addr_is_equal(&temp_socket->socket_values.local_address.sin6_addr,
+                              &current_ipv6_header->destaddr);
+}
+
 socket_internal_t *get_tcp_socket_by_context(ipv6_hdr_t *current_ipv6_header,
         uint16_t current_context)
 {
-    socket_internal_t *temp_socket;
+    uint8_t *index = &tcp_hc_index[current_context & (TCP_HC_INDEX_SIZE - 1)];
+    socket_internal_t *temp_socket = get_socket(*index);
 
+    if (tcp_hc_context_matches(temp_socket, current_ipv6_header,
+                               current_context)) {
+        return temp_socket;
+    }
+
+    /* first segment of the context or a collision in the index */
     for (int i = 1; i < MAX_SOCKETS + 1; i++) {
         temp_socket = get_socket(i);
 
-        if ((temp_socket != NULL) &&
-            ipv6_addr_is_equal(&temp_socket->socket_values.foreign_address.sin6_addr,
-                               &current_ipv6_header->srcaddr) &&
-            ipv6_addr_is_equal(&temp_socket->socket_values.local_address.sin6_addr,
-                               &current_ipv6_header->destaddr) &&
-            (temp_socket->socket_values.tcp_control.tcp_context.context_id ==
-             current_context)) {
+        if (tcp_hc_context_matches(temp_socket, current_ipv6_header,
+                                   current_context)) {
+            *index = i;
             return temp_socket;
         }
     }
@@ -71,6 +92,134 @@ void update_tcp_hc_context(bool incoming, socket_internal_t *current_socket,
     }
 }
 
+/* draft-aayadi-6lowpan-tcphc-01, 5.2: every field is sent as the bytes
+ * that differ from the context, the returned 2 bit code tells which.  For
+ * 32 bit fields 1 and 2 are the lowest 8 and 16 bits, for the 16 bit window
+ * they are its lower and its upper byte. */
+static uint8_t tcp_hc_put_field(uint8_t **out, uint32_t value, uint32_t last,
+                                uint8_t size, bool full)
+{
+    uint32_t diff = value ^ last;
+    uint8_t code;
+    uint8_t len;
+
+    if (full) {
+        code = 3;
+    }
+    else if (diff == 0) {
+        return 0;
+    }
+    else if ((diff >> 8) == 0) {
+        code = 1;
+    }
+    else if ((size == 2) && ((diff & 0xff) == 0)) {
+        code = 2;
+        value >>= 8;
+    }
+    else if ((size == 4) && ((diff >> 16) == 0)) {
+        code = 2;
+    }
+    else {
+        code = 3;
+    }
+
+    len = (code == 3) ? size : ((size == 2) ? 1 : code);
+
+    /* big endian */
+    for (int i = len - 1; i >= 0; i--) {
+        (*out)[i] = value;
+        value >>= 8;
+    }
+
+    *out += len;
+    return code;
+}
+
+/* the inverse of tcp_hc_put_field() */
+static uint32_t tcp_hc_get_field(const uint8_t **in, uint8_t code,
+                                 uint32_t last, uint8_t size)
+{
+    uint32_t value = 0;
+    uint8_t len;
+
+    if (code == 0) {
+        return last;
+    }
+
+    len = (code == 3) ? size : ((size == 2) ? 1 : code);
+
+    for (int i = 0; i < len; i++) {
+        value = (value << 8) | (*in)[i];
+    }
+
+    *in += len;
+
+    if (code == 3) {
+        return value;
+    }
+    else if (size == 2) {
+        return (code == 1) ? ((last & 0xff00) | value) :
+               ((value << 8) | (last & 0x00ff));
+    }
+    else {
+        uint32_t mask = (code == 1) ? 0xff : 0xffff;
+
+        return (last & ~mask) | value;
+    }
+}
+
+/* Compressed and mostly compressed header, the latter sends every field */
+static uint16_t tcp_hc_compress(socket_internal_t *current_socket,
+                                uint8_t *current_tcp_packet,
+                                uint8_t payload_length, bool mostly)
+{
+    tcp_hc_context_t *tcp_context =
+        &current_socket->socket_values.tcp_control.tcp_context;
+    tcp_hdr_t full_tcp_header;
+    /* behind TCP_HC header and context ID */
+    uint8_t *out = current_tcp_packet + 4;
+    /* (1|1|0) for compressed and (1|0|0) for mostly compressed headers, the
+     * CID is always 16 bits (1) */
+    uint16_t tcp_hc_header = mostly ? 0x9000 : 0xD000;
+    uint16_t value;
+
+    /* the header is overwritten while it is compressed */
+    memcpy(&full_tcp_header, current_tcp_packet, TCP_HDR_LEN);
+
+    if (!mostly && IS_TCP_ACK(full_tcp_header.reserved_flags) &&
+        (tcp_context->ack_snd == full_tcp_header.ack_nr)) {
+        tcp_context->ack_snd = tcp_context->seq_rcv;
+    }
+
+    tcp_hc_header |= tcp_hc_put_field(&out, full_tcp_header.seq_nr,
+                                      tcp_context->seq_snd, 4, mostly) << 10;
+    tcp_hc_header |= tcp_hc_put_field(&out, full_tcp_header.ack_nr,
+                                      tcp_context->ack_snd, 4, mostly) << 8;
+    tcp_hc_header |= tcp_hc_put_field(&out, full_tcp_header.window,
+                                      tcp_context->wnd_snd, 2, mostly) << 6;
+
+    if (IS_TCP_FIN(full_tcp_header.reserved_flags)) {
+        /* F = (1) */
+        tcp_hc_header |= 0x0008;
+    }
+
+    value = HTONS(full_tcp_header.checksum);
+    memcpy(out, &value, 2);
+    out += 2;
+
+    value = HTONS(tcp_hc_header);
+    memcpy(current_tcp_packet, &value, 2);
+    value = HTONS(tcp_context->context_id);
+    memcpy(current_tcp_packet + 2, &value, 2);
+
+    /* the compressed header never outgrows the full one */
+    memmove(out, current_tcp_packet + TCP_HDR_LEN, payload_length);
+
+    update_tcp_hc_context(false, current_socket, &full_tcp_header);
+
+    return (out - current_tcp_packet) + payload_length;
+}
+
 uint16_t compress_tcp_packet(socket_internal_t *current_socket,
                              uint8_t *current_tcp_packet,
                              ipv6_hdr_t *temp_ipv6_header,
@@ -79,8 +228,6 @@ uint16_t compress_tcp_packet(socket_internal_t *current_socket,
 {
     socket_t *current_tcp_socket = &current_socket->socket_values;
     tcp_hc_context_t *tcp_context = &current_tcp_socket->tcp_control.tcp_context;
-    tcp_cb_t *tcp_cb = &current_tcp_socket->tcp_control;
-    tcp_hdr_t full_tcp_header;
     uint16_t packet_size = 0;
 
     /* Connection establisment phase, use FULL_HEADER TCP */
@@ -113,293 +260,12 @@ uint16_t compress_tcp_packet(socket_internal_t *current_socket,
 
         return packet_size;
     }
-    /* Check for header compression type: COMPRESSED_HEADER */
-    else if (tcp_context->hc_type == COMPRESSED_HEADER) {
-        /* draft-aayadi-6lowpan-tcphc-01: 5.1 Compressed header TCP segment. */
-
-        /* Temporary variable for TCP_HC_Header Bytes */
-        uint16_t tcp_hc_header = 0x0000;
-
-        /* Save TCP_Header to refresh TCP Context values after compressing the
-         * packet */
-        memcpy(&full_tcp_header, current_tcp_packet, TCP_HDR_LEN);
-
-        /* Temporary variable for storing TCP header beginning */
-        uint8_t *tcp_packet_begin = current_tcp_packet;
-
-        /* Position for first TCP header value, TCP_HC_Header and Context ID */
-        current_tcp_packet += 4;
-
-        /* Packet size value */
-        packet_size += 4;
-
-        /* 5.2.  LOWPAN_TCPHC Format */
-
-        /* First 3 bits of TCP_HC_Header are not exactly specified. In this
-         * implementation they are (1|1|0) * for compressed headers and the
-         * CID is always 16 bits (1) */
-        /* (1|1|0|1) = D */
-        tcp_hc_header |= 0xD000;
-
-        /*----------------------------------*/
-        /*|		Sequence number handling   |*/
-        /*----------------------------------*/
-        if (full_tcp_header.seq_nr == tcp_context->seq_snd) {
-            /* Nothing to do, Seq = (0|0) */
-        }
-        /* If the 24 most significant bits haven't changed from previous
-         * packet, don't transmit them */
-        else if ((full_tcp_header.seq_nr & 0xFFFFFF00) == (tcp_context->seq_snd &
-                 0xFFFFFF00)) {
-            /* Seq = (0|1) */
-            tcp_hc_header |= 0x0400;
-
-            /* Copy first 8 less significant bits of sequence number into
-             * buffer */
-            *current_tcp_packet = (uint8_t)(full_tcp_header.seq_nr & 0x000000FF);
-            current_tcp_packet += 1;
-            packet_size += 1;
-        }
-        /* If the 16 most significant bits haven't changed from previous packet,
-         * don't transmit them */
-        else if ((full_tcp_header.seq_nr & 0xFFFF0000) == (tcp_context->seq_snd & 0xFFFF0000)) {
-            /* Seq = (1|0) */
-            tcp_hc_header |= 0x0800;
-
-            /* Copy first 16 less significant bits of sequence number into buffer */
-            *((uint16_t *)current_tcp_packet) =
-                HTONS((uint16_t)(full_tcp_header.seq_nr & 0x0000FFFF));
-            current_tcp_packet += 2;
-            packet_size += 2;
-        }
-        /* Sending uncompressed sequence number */
-        else {
-            /* Seq = (1|1) */
-            tcp_hc_header |= 0x0C00;
-
-            /* Copy all bits of sequence number into buffer */
-            uint32_t cur_seq_no = HTONL(full_tcp_header.seq_nr);
-            memcpy(current_tcp_packet, &cur_seq_no, 4);
-            current_tcp_packet += 4;
-            packet_size += 4;
-        }
-
-        /*----------------------------------*/
-        /*|	Acknowledgment number handling |*/
-        /*----------------------------------*/
-        if ((IS_TCP_ACK(full_tcp_header.reserved_flags) &&
-             (tcp_cb->tcp_context.ack_snd == full_tcp_header.ack_nr))) {
-            tcp_context->ack_snd = tcp_context->seq_rcv;
-        }
-
-        if (full_tcp_header.ack_nr == tcp_context->ack_snd) {
-            /* Nothing to do, Ack = (0|0) */
-        }
-        /* If the 24 most significant bits haven't changed from previous packet,
-         * don't transmit them */
-        else if ((full_tcp_header.ack_nr & 0xFFFFFF00) == (tcp_context->ack_snd &
-                 0xFFFFFF00)) {
-            /* Ack = (0|1) */
-            tcp_hc_header |= 0x0100;
-
-            /* Copy first 8 less significant bits of acknowledgment number into
-             * buffer */
-            *current_tcp_packet = (uint8_t)(full_tcp_header.ack_nr & 0x000000FF);
-            current_tcp_packet += 1;
-            packet_size += 1;
-        }
-        /* If the 16 most significant bits haven't changed from previous packet,
-         * don't transmit them */
-        else if ((full_tcp_header.ack_nr & 0xFFFF0000) == (tcp_context->ack_snd &
-                 0xFFFF0000)) {
-            /* Ack = (1|0) */
-            tcp_hc_header |= 0x0200;
-
-            /* Copy first 16 less significant bits of acknowledgment number
-             * into buffer */
-            *((uint16_t *)current_tcp_packet) =
-                HTONS((uint16_t)(full_tcp_header.ack_nr & 0x0000FFFF));
-            current_tcp_packet += 2;
-            packet_size += 2;
-        }
-        /* Sending uncompressed acknowledgment number */
-        else {
-            /* Ack = (1|1) */
-            tcp_hc_header |= 0x0300;
-
-            /* Copy all bits of acknowledgment number into buffer */
-            uint32_t cur_ack_nr = HTONL(full_tcp_header.ack_nr);
-            memcpy(current_tcp_packet, &cur_ack_nr, 4);
-            current_tcp_packet += 4;
-            packet_size += 4;
-        }
-
-        /*----------------------------------*/
-        /*|			Window handling 	   |*/
-        /*----------------------------------*/
-        if (full_tcp_header.window == tcp_context->wnd_snd) {
-            /* Nothing to do, Wnd = (0|0) */
-        }
-        /* If the 8 most significant bits haven't changed from previous packet,
-         * don't transmit them */
-        else if ((full_tcp_header.window & 0xFF00) == (tcp_context->wnd_snd & 0xFF00)) {
-            /* Wnd = (0|1) */
-            tcp_hc_header |= 0x0040;
-
-            /* Copy first 8 less significant bits of window size into buffer */
-            *current_tcp_packet = (uint8_t)(full_tcp_header.window & 0x00FF);
-            current_tcp_packet += 1;
-            packet_size += 1;
-        }
-        /* If the 8 less significant bits haven't changed from previous packet,
-         * don't transmit them */
-        else if ((full_tcp_header.window & 0x00FF) == (tcp_context->wnd_snd &
-                 0x00FF)) {
-            /* Wnd = (1|0) */
-            tcp_hc_header |= 0x0080;
-
-            /* Copy first 8 most significant bits of window size into buffer */
-            *current_tcp_packet = (uint8_t)(full_tcp_header.window & 0xFF00);
-            current_tcp_packet += 1;
-            packet_size += 1;
-        }
-        /* Sending uncompressed window */
-        else {
-            /* Wnd = (1|1) */
-            tcp_hc_header |= 0x00C0;
-
-            /* Copy all bits of window size into buffer */
-            uint16_t cur_window = HTONS(full_tcp_header.window);
-            memcpy(current_tcp_packet, &cur_window, 2);
-            current_tcp_packet += 2;
-            packet_size += 2;
-        }
-
-        /* FIN flag */
-        if (IS_TCP_FIN(full_tcp_header.reserved_flags)) {
-            /* F = (1) */
-            tcp_hc_header |= 0x0008;
-        }
-
-        /* Copy checksum into buffer */
-        uint16_t cur_chk_sum = HTONS(full_tcp_header.checksum);
-        memcpy(current_tcp_packet, &cur_chk_sum, 2);
-        current_tcp_packet += 2;
-        packet_size += 2;
-
-        /* Copy TCP_HC Bytes into buffer */
-        uint16_t cur_tcp_hc_header = HTONS(tcp_hc_header);
-        memcpy(tcp_packet_begin, &cur_tcp_hc_header, 2);
-
-        /* Copy TCP_HC Context ID into buffer */
-        uint16_t cur_context_id = HTONS(tcp_context->context_id);
-        memcpy(tcp_packet_begin + 2, &cur_context_id, 2);
-
-        /* Move payload to end of tcp header */
-        memmove(current_tcp_packet, tcp_packet_begin + TCP_HDR_LEN,
-                payload_length);
-
-        /* Adding TCP payload length to TCP_HC header length */
-        packet_size += payload_length;
-
-        update_tcp_hc_context(false, current_socket, &full_tcp_header);
-
-        return packet_size;
-    }
-    /* Check for header compression type: MOSTLY_COMPRESSED_HEADER */
-    else if (tcp_context->hc_type == MOSTLY_COMPRESSED_HEADER) {
+    else if ((tcp_context->hc_type == COMPRESSED_HEADER) ||
+             (tcp_context->hc_type == MOSTLY_COMPRESSED_HEADER)) {
         /* draft-aayadi-6lowpan-tcphc-01: 5.1 Compressed header TCP segment. */
-
-        /* Temporary variable for TCP_HC_Header Bytes */
-        uint16_t tcp_hc_header = 0x0000;
-
-        /* Save TCP_Header to refresh TCP Context values after compressing the
-         * packet */
-        memcpy(&full_tcp_header, current_tcp_packet, TCP_HDR_LEN);
-
-        /* Temporary variable for storing TCP header beginning */
-        uint8_t *tcp_packet_begin = current_tcp_packet;
-
-        /* Position for first TCP header value, TCP_HC_Header and Context ID */
-        current_tcp_packet += 4;
-
-        /* Packet size value */
-        packet_size += 4;
-
-        /* 5.2.  LOWPAN_TCPHC Format */
-
-        /* First 3 bits of TCP_HC_Header are not exactly specified. In this
-         * implementation they are (1|0|0) for mostly compressed headers and
-         * the CID is always 16 bits (1) */
-        /* (1|0|0|1) = 9 */
-        tcp_hc_header |= 0x9000;
-
-        /*----------------------------------*/
-        /*|		Sequence number handling   |*/
-        /*----------------------------------*/
-        /* Sending uncompressed sequence number */
-        /* Seq = (1|1) */
-        tcp_hc_header |= 0x0C00;
-
-        /* Copy all bits of sequence number into buffer */
-        uint32_t cur_seq_no = HTONL(full_tcp_header.seq_nr);
-        memcpy(current_tcp_packet, &cur_seq_no, 4);
-        current_tcp_packet += 4;
-        packet_size += 4;
-
-        /*----------------------------------*/
-        /*|	Acknowledgment number handling |*/
-        /*----------------------------------*/
-        /* Ack = (1|1) */
-        tcp_hc_header |= 0x0300;
-
-        /* Copy all bits of acknowledgment number into buffer */
-        uint32_t cur_ack_nr = HTONL(full_tcp_header.ack_nr);
-        memcpy(current_tcp_packet, &cur_ack_nr, 4);
-        current_tcp_packet += 4;
-        packet_size += 4;
-
-        /*----------------------------------*/
-        /*|			Window handling 	   |*/
-        /*----------------------------------*/
-        /* Wnd = (1|1) */
-        tcp_hc_header |= 0x00C0;
-
-        /* Copy all bits of window size into buffer */
-        uint16_t cur_window = HTONS(full_tcp_header.window);
-        memcpy(current_tcp_packet, &cur_window, 2);
-        current_tcp_packet += 2;
-        packet_size += 2;
-
-        /* FIN flag */
-        if (IS_TCP_FIN(full_tcp_header.reserved_flags)) {
-            /* F = (1) */
-            tcp_hc_header |= 0x0008;
-        }
-
-        /* Copy checksum into buffer */
-        uint16_t cur_chk_sum = HTONS(full_tcp_header.checksum);
-        memcpy(current_tcp_packet, &cur_chk_sum, 2);
-        current_tcp_packet += 2;
-        packet_size += 2;
-
-        /* Copy TCP_HC Bytes into buffer */
-        uint16_t cur_tcp_hc_header = HTONS(tcp_hc_header);
-        memcpy(tcp_packet_begin, &cur_tcp_hc_header, 2);
-
-        /* Copy TCP_HC Context ID into buffer */
-        uint16_t cur_context_id = HTONS(tcp_context->context_id);
-        memcpy(tcp_packet_begin + 2, &cur_context_id, 2);
-
-        /* Move payload to end of tcp header */
-        memmove(current_tcp_packet, tcp_packet_begin + TCP_HDR_LEN,
-                payload_length);
-
-        /* Adding TCP payload length to TCP_HC header length */
-        packet_size += payload_length;
-
-        update_tcp_hc_context(false, current_socket, &full_tcp_header);
-        return packet_size;
+        return tcp_hc_compress(current_socket, current_tcp_packet,
+                               payload_length,
+                               tcp_context->hc_type == MOSTLY_COMPRESSED_HEADER);
     }
 
     return 0;
@@ -421,7 +287,7 @@ socket_internal_t *decompress_tcp_packet(ipv6_hdr_t *temp_ipv6_header)
                                                 IPV6_HDR_LEN + 3)));
 
         if (current_socket != NULL) {
-            if (current_socket->socket_values.tcp_control.state == LISTEN) {
+            if (current_socket->socket_values.tcp_control.state == TCP_LISTEN) {
                 memcpy(&current_socket->socket_values.tcp_control.tcp_context.context_id,
                        ((uint8_t *)temp_ipv6_header) + IPV6_HDR_LEN + 1, 2);
                 current_socket->socket_values.tcp_control.tcp_context.context_id =
@@ -484,113 +350,25 @@ socket_internal_t *decompress_tcp_packet(ipv6_hdr_t *temp_ipv6_header)
         tcp_hc_context_t *current_tcp_context =
             &current_socket->socket_values.tcp_control.tcp_context;
 
-        /*----------------------------------*/
-        /*|		Sequence number handling   |*/
-        /*----------------------------------*/
-        if (!BITSET(tcp_hc_header, 11) && !BITSET(tcp_hc_header, 10)) {
-            /* Seq = (0|0), sequence number didn't change, copy old value */
-            memcpy(&full_tcp_header.seq_nr, &current_tcp_context->seq_rcv, 4);
-        }
-        /* The 24 most significant bits haven't changed from previous packet */
-        else if (!BITSET(tcp_hc_header, 11) && BITSET(tcp_hc_header, 10)) {
-            /* Seq = (0|1), copy 1 byte of tcp_hc packet and 3 bytes from
-             * previous packet */
-            full_tcp_header.seq_nr |= *packet_buffer;
-            full_tcp_header.seq_nr |= ((current_tcp_context->seq_rcv) &
-                                       0xFFFFFF00);
-            packet_buffer += 1;
-            packet_size += 1;
-        }
-        /* If the 16 most significant bits haven't changed from previous packet */
-        else if (BITSET(tcp_hc_header, 11) && !BITSET(tcp_hc_header, 10)) {
-            /* Seq = (1|0), copy 2 bytes of tcp_hc packet and 2 bytes from
-             * previous packet */
-            full_tcp_header.seq_nr |= NTOHS(*((uint16_t *)packet_buffer));
-            full_tcp_header.seq_nr |= ((current_tcp_context->seq_rcv) & 0xFFFF0000);
-            packet_buffer += 2;
-            packet_size += 2;
-        }
-        /* Sending uncompressed sequence number */
-        else {
-            /* Seq = (1|1), copy 4 bytes of tcp_hc packet */
-            memcpy(&full_tcp_header.seq_nr, packet_buffer, 4);
-            full_tcp_header.seq_nr = NTOHL(full_tcp_header.seq_nr);
-            packet_buffer += 4;
-            packet_size += 4;
-        }
+        const uint8_t *in = packet_buffer;
 
-        /*----------------------------------*/
-        /*|	Acknowledgment number handling |*/
-        /*----------------------------------*/
-        if (!BITSET(tcp_hc_header, 9) && !BITSET(tcp_hc_header, 8)) {
-            /* Ack = (0|0), acknowledgment number didn't change, copy old value */
-            memcpy(&full_tcp_header.ack_nr, &current_tcp_context->ack_rcv, 4);
-        }
-        /* The 24 most significant bits haven't changed from previous packet */
-        else if (!BITSET(tcp_hc_header, 9) && BITSET(tcp_hc_header, 8)) {
-            /* Ack = (0|1), copy 1 byte of tcp_hc packet and 3 bytes from
-             * previous packet */
-            full_tcp_header.ack_nr |= *packet_buffer;
-            full_tcp_header.ack_nr |= ((current_tcp_context->ack_rcv) & 0xFFFFFF00);
-            packet_buffer += 1;
-            packet_size += 1;
-            SET_TCP_ACK(full_tcp_header.reserved_flags);
-        }
-        /* If the 16 most significant bits haven't changed from previous packet */
-        else if (BITSET(tcp_hc_header, 9) && !BITSET(tcp_hc_header, 8)) {
-            /* Ack = (1|0), copy 2 bytes of tcp_hc packet and 2 bytes from
-             * previous packet */
-            full_tcp_header.ack_nr |= NTOHS(*((uint16_t *)packet_buffer));
-            full_tcp_header.ack_nr |= ((current_tcp_context->ack_rcv) & 0xFFFF0000);
-            packet_buffer += 2;
-            packet_size += 2;
+        full_tcp_header.seq_nr = tcp_hc_get_field(&in, (tcp_hc_header >> 10) & 3,
+                                                  current_tcp_context->seq_rcv, 4);
+        full_tcp_header.ack_nr = tcp_hc_get_field(&in, (tcp_hc_header >> 8) & 3,
+                                                  current_tcp_context->ack_rcv, 4);
+        full_tcp_header.window = tcp_hc_get_field(&in, (tcp_hc_header >> 6) & 3,
+                                                  current_tcp_context->wnd_rcv, 2);
+
+        /* a changed acknowledgment number implies the ACK flag, in a mostly
+         * compressed header it is always sent */
+        if ((((tcp_hc_header >> 8) & 3) != 0) &&
+            ((header_type == COMPRESSED_HEADER) ||
+             (((tcp_hc_header >> 8) & 3) != 3))) {
             SET_TCP_ACK(full_tcp_header.reserved_flags);
         }
-        /* Sending uncompressed acknowledgment number */
-        else {
-            /* Ack = (1|1), copy 4 bytes of tcp_hc packet */
-            memcpy(&full_tcp_header.ack_nr, packet_buffer, 4);
-            full_tcp_header.ack_nr = NTOHL(full_tcp_header.ack_nr);
-            packet_buffer += 4;
-            packet_size += 4;
-
-            if (header_type == COMPRESSED_HEADER) {
-                SET_TCP_ACK(full_tcp_header.reserved_flags);
-            }
-        }
 
-        /*----------------------------------*/
-        /*|			Window handling 	   |*/
-        /*----------------------------------*/
-        if (!BITSET(tcp_hc_header, 7) && !BITSET(tcp_hc_header, 6)) {
-            /* Wnd = (0|0), copy old value */
-            memcpy(&full_tcp_header.window, &current_tcp_context->wnd_rcv, 2);
-        }
-        /* The 8 most significant bits haven't changed from previous packet */
-        else if (!BITSET(tcp_hc_header, 7) && BITSET(tcp_hc_header, 6)) {
-            /* Wnd = (0|1), copy 1 byte of tcp_hc packet and 1 byte from
-             * previous packet */
-            full_tcp_header.window |= *packet_buffer;
-            full_tcp_header.window |= ((current_tcp_context->wnd_rcv) & 0xFF00);
-            packet_buffer += 1;
-            packet_size += 1;
-        }
-        /* If the 8 less significant bits haven't changed from previous packet */
-        else if (BITSET(tcp_hc_header, 7) && !BITSET(tcp_hc_header, 6)) {
-            /* Wnd = (1|0), copy 1 byte of tcp_hc packet and 1 byte from previous packet */
-            full_tcp_header.window |= ((*((uint16_t *)packet_buffer)) & 0xFF00);
-            full_tcp_header.window |= ((current_tcp_context->wnd_rcv) & 0x00FF);
-            packet_buffer += 1;
-            packet_size += 1;
-        }
-        /* Sending uncompressed window size */
-        else {
-            /* Wnd = (1|1), copy 2 bytes of tcp_hc packet */
-            memcpy(&full_tcp_header.window, packet_buffer, 2);
-            full_tcp_header.window = NTOHS(full_tcp_header.window);
-            packet_buffer += 2;
-            packet_size += 2;
-        }
+        packet_size += in - packet_buffer;
+        packet_buffer += in - packet_buffer;
 
         /* FIN flag */
         if (BITSET(tcp_hc_header, 3)) {
@@ -15,8 +15,8 @@
  * @}
  */
 
+#include <stdint.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include "sixlowpan.h"
@@ -27,9 +27,13 @@
 
 #include "msg_help.h"
 #include "socket.h"
+#include "tcp_hc.h"
 
 #include "tcp_timer.h"
 
+static work_t tcp_timers[MAX_SOCKETS];
+static work_t tcp_ack_timers[MAX_SOCKETS];
+
 void handle_synchro_timeout(socket_internal_t *current_socket)
 {
     msg_t send;
@@ -93,65 +97,166 @@ void handle_established(socket_internal_t *current_socket)
     }
 }
 
-void check_sockets(void)
+/* us until the timer of current_socket expires, 0 if it did, -1 if it does
+ * not run: nothing is outstanding in its state */
+static int64_t tcp_timer_remaining(socket_internal_t *current_socket)
 {
-    socket_internal_t *current_socket;
-    uint8_t i = 1;
-
-    while (i < MAX_SOCKETS + 1) {
-        current_socket = get_socket(i);
-
-        if (is_tcp_socket(i)) {
-            switch (current_socket->socket_values.tcp_control.state) {
-                case TCP_ESTABLISHED: {
-                    handle_established(current_socket);
-                    break;
-                }
-
-                case TCP_SYN_SENT: {
-                    handle_synchro_timeout(current_socket);
-                    break;
-                }
-
-                case TCP_SYN_RCVD: {
-                    handle_synchro_timeout(current_socket);
-                    break;
-                }
-
-                default: {
-                    break;
-                }
+    tcp_cb_t *tcp_control = &current_socket->socket_values.tcp_control;
+    double timeout;
+    uint64_t elapsed;
+    timex_t now;
+
+    switch (tcp_control->state) {
+        case TCP_SYN_SENT:
+        case TCP_SYN_RCVD: {
+            timeout = TCP_SYN_INITIAL_TIMEOUT +
+                      tcp_control->no_of_retries * TCP_SYN_TIMEOUT;
+            break;
+        }
+
+        case TCP_ESTABLISHED: {
+            if (tcp_control->send_nxt <= tcp_control->send_una) {
+                return -1;
+            }
+
+            timeout = tcp_control->rto;
+
+            if (timeout < SECOND) {
+                timeout = SECOND;
             }
+
+            for (uint8_t i = 0; i < tcp_control->no_of_retries; i++) {
+                timeout *= 2;
+            }
+
+            if (timeout > TCP_ACK_MAX_TIMEOUT) {
+                return 0;
+            }
+
+            break;
+        }
+
+        default: {
+            return -1;
+        }
+    }
+
+    vtimer_now(&now);
+    elapsed = timex_uint64(timex_sub(now, tcp_control->last_packet_time));
+
+    /* the handlers need the timeout to be exceeded */
+    return (elapsed > timeout) ? 0 : (int64_t)(timeout - elapsed) + 1;
+}
+
+static void tcp_timer_post(work_t *timer, int64_t remaining)
+{
+    if (remaining > TCP_TIMER_MAX_DELAY) {
+        remaining = TCP_TIMER_MAX_DELAY;
+    }
+
+    workqueue_post_in(timer, remaining);
+}
+
+static void tcp_socket_timer(work_t *timer)
+{
+    socket_internal_t *current_socket = timer->arg;
+    int64_t remaining;
+
+    switch (current_socket->socket_values.tcp_control.state) {
+        case TCP_ESTABLISHED: {
+            handle_established(current_socket);
+            break;
         }
 
-        i++;
+        case TCP_SYN_SENT:
+        case TCP_SYN_RCVD: {
+            handle_synchro_timeout(current_socket);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    remaining = tcp_timer_remaining(current_socket);
+
+    if (remaining == 0) {
+        /* its thread was not waiting, look again later */
+        remaining = TCP_TIMER_RESOLUTION;
+    }
+
+    if (remaining > 0) {
+        tcp_timer_post(timer, remaining);
     }
 }
 
-void inc_global_variables(void)
+static void tcp_delayed_ack(work_t *timer)
 {
-    mutex_lock(&global_sequence_counter_mutex);
-    global_sequence_counter += rand();
-    mutex_unlock(&global_sequence_counter_mutex);
+    socket_internal_t *current_socket = timer->arg;
+    /* a pure ACK, the header is all there is */
+    uint8_t send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN];
+    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(&send_buffer));
+    tcp_hdr_t *current_tcp_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
+
+    if (!current_socket->socket_values.tcp_control.ack_pending ||
+        (current_socket->socket_values.tcp_control.state != TCP_ESTABLISHED)) {
+        return;
+    }
+
 #ifdef TCP_HC
-    mutex_lock(&global_context_counter_mutex);
-    global_context_counter += rand();
-    mutex_unlock(&global_context_counter_mutex);
+    current_socket->socket_values.tcp_control.tcp_context.hc_type =
+        COMPRESSED_HEADER;
 #endif
+    send_tcp(current_socket, current_tcp_packet, temp_ipv6_header, TCP_ACK, 0);
 }
 
-void tcp_general_timer(void)
+void tcp_timer_init(void)
 {
-    vtimer_t tcp_vtimer;
-    timex_t interval = timex_set(0, TCP_TIMER_RESOLUTION);
+    for (int i = 0; i < MAX_SOCKETS; i++) {
+        workqueue_work_init(&tcp_timers[i], tcp_socket_timer, &sockets[i],
+                            PRIORITY_MAIN + 1);
+        workqueue_work_init(&tcp_ack_timers[i], tcp_delayed_ack, &sockets[i],
+                            PRIORITY_MAIN + 1);
+    }
+}
 
-    while (1) {
-        inc_global_variables();
-        check_sockets();
+void tcp_timer_arm(socket_internal_t *current_socket)
+{
+    work_t *timer = &tcp_timers[current_socket - sockets];
+    int64_t remaining = tcp_timer_remaining(current_socket);
 
-        vtimer_set_wakeup(&tcp_vtimer, interval, thread_getpid());
-        thread_sleep();
+    if (remaining < 0) {
+        workqueue_cancel(timer);
+    }
+    else if (remaining == 0) {
+        workqueue_post(timer);
+    }
+    else {
+        tcp_timer_post(timer, remaining);
+    }
+}
+
+void tcp_timer_stop(socket_internal_t *current_socket)
+{
+    workqueue_cancel(&tcp_timers[current_socket - sockets]);
+    workqueue_cancel(&tcp_ack_timers[current_socket - sockets]);
+}
 
-        vtimer_remove(&tcp_vtimer);
+void tcp_timer_delay_ack(socket_internal_t *current_socket)
+{
+    work_t *timer = &tcp_ack_timers[current_socket - sockets];
+
+    /* the timeout counts from the first unacknowledged segment */
+    if (current_socket->socket_values.tcp_control.ack_pending == 1) {
+        workqueue_post_in(timer, TCP_DELAYED_ACK_TIMEOUT);
+    }
+}
+
+void tcp_timer_ack_sent(socket_internal_t *current_socket)
+{
+    if (current_socket->socket_values.tcp_control.ack_pending) {
+        current_socket->socket_values.tcp_control.ack_pending = 0;
+        workqueue_cancel(&tcp_ack_timers[current_socket - sockets]);
     }
 }
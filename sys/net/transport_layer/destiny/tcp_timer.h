@@ -15,10 +15,24 @@
 #ifndef TCP_TIMER_H_
 #define TCP_TIMER_H_
 
+#include "workqueue.h"
+
+#include "socket.h"
+
 #define TCP_TIMER_RESOLUTION		500*1000
+// longer delays are waited for in steps, they are kept by the hwtimer
+#define TCP_TIMER_MAX_DELAY			TCP_TIMER_RESOLUTION
+
+// an ACK is delayed until this many segments arrived or the timeout passed
+// (RFC 1122, 4.2.3.2), 1 acknowledges every segment at once
+#ifndef TCP_DELAYED_ACK_SEGMENTS
+#define TCP_DELAYED_ACK_SEGMENTS	2
+#endif
+#ifndef TCP_DELAYED_ACK_TIMEOUT
+#define TCP_DELAYED_ACK_TIMEOUT		200*1000
+#endif
 
 #define SECOND						1000.0f*1000.0f
-#define TCP_TIMER_STACKSIZE			KERNEL_CONF_STACKSIZE_DEFAULT
 #define TCP_SYN_INITIAL_TIMEOUT		6*SECOND
 #define TCP_SYN_TIMEOUT				24*SECOND
 #define TCP_MAX_SYN_RETRIES			3
@@ -33,7 +47,15 @@
 #define TCP_TIMEOUT					2
 #define TCP_CONTINUE				3
 
-void tcp_general_timer(void);
+// every TCP socket has a timer, it only runs while something is outstanding
+void tcp_timer_init(void);
+// (re)starts the timer after the state or last_packet_time of a socket changed
+void tcp_timer_arm(socket_internal_t *current_socket);
+void tcp_timer_stop(socket_internal_t *current_socket);
+// acknowledges received data later, unless something else is sent before
+void tcp_timer_delay_ack(socket_internal_t *current_socket);
+// an ACK went out, nothing is pending anymore
+void tcp_timer_ack_sent(socket_internal_t *current_socket);
 
 #endif /* TCP_TIMER_H_ */
 /**
@@ -26,13 +26,16 @@
 #include "destiny/in.h"
 
 #include "net_help.h"
+#include "netstat.h"
 
 #include "msg_help.h"
 #include "socket.h"
 
 #include "udp.h"
 
+#if !SIXLOWPAN_RUN_TO_COMPLETION
 msg_t udp_msg_queue[UDP_PKT_RECV_BUF_SIZE];
+#endif
 
 uint16_t udp_csum(ipv6_hdr_t *ipv6_header, udp_hdr_t *udp_header)
 {
@@ -45,38 +48,49 @@ uint16_t udp_csum(ipv6_hdr_t *ipv6_header, udp_hdr_t *udp_header)
     return (sum == 0) ? 0xffff : HTONS(sum);
 }
 
-void udp_packet_handler(void)
+void udp_packet_process(pktbuf_t *pkt)
 {
-    msg_t m_recv_ip, m_send_ip, m_recv_udp, m_send_udp;
-    ipv6_hdr_t *ipv6_header;
+    msg_t m_recv_udp, m_send_udp;
+    ipv6_hdr_t *ipv6_header = (ipv6_hdr_t *) pkt->data;
     udp_hdr_t *udp_header;
     socket_internal_t *udp_socket = NULL;
     uint16_t chksum;
 
-    msg_init_queue(udp_msg_queue, UDP_PKT_RECV_BUF_SIZE);
-
-    while (1) {
-        msg_receive(&m_recv_ip);
-        ipv6_header = ((ipv6_hdr_t *)m_recv_ip.content.ptr);
-        udp_header = ((udp_hdr_t *)(m_recv_ip.content.ptr + IPV6_HDR_LEN));
+    udp_header = ((udp_hdr_t *)((uint8_t *) ipv6_header + IPV6_HDR_LEN));
 
-        chksum = ipv6_csum(ipv6_header, (uint8_t*) udp_header, NTOHS(udp_header->length), IPPROTO_UDP);
+    chksum = ipv6_csum(ipv6_header, (uint8_t*) udp_header, NTOHS(udp_header->length), IPPROTO_UDP);
 
-        if (chksum == 0xffff) {
-            udp_socket = get_udp_socket(udp_header);
+    if (chksum == 0xffff) {
+        udp_socket = get_udp_socket(udp_header);
 
-            if (udp_socket != NULL) {
-                m_send_udp.content.ptr = (char *)ipv6_header;
-                msg_send_receive(&m_send_udp, &m_recv_udp, udp_socket->recv_pid);
-            }
-            else {
-                printf("Dropped UDP Message because no thread ID was found for delivery!\n");
-            }
+        if (udp_socket != NULL) {
+            NETSTAT_RX(NETSTAT_LAYER_UDP);
+            m_send_udp.type = UDP_DATAGRAM;
+            m_send_udp.content.ptr = (char *) pkt;
+            msg_send_receive(&m_send_udp, &m_recv_udp, udp_socket->recv_pid);
         }
         else {
-            printf("Wrong checksum (%x)!\n", chksum);
+            printf("Dropped UDP Message because no thread ID was found for delivery!\n");
+            NETSTAT_DROP(NETSTAT_LAYER_UDP, NETSTAT_DROP_NO_HANDLER);
         }
+    }
+    else {
+        printf("Wrong checksum (%x)!\n", chksum);
+        NETSTAT_DROP(NETSTAT_LAYER_UDP, NETSTAT_DROP_CHECKSUM);
+    }
+}
 
+#if !SIXLOWPAN_RUN_TO_COMPLETION
+void udp_packet_handler(void)
+{
+    msg_t m_recv_ip, m_send_ip;
+
+    msg_init_queue(udp_msg_queue, UDP_PKT_RECV_BUF_SIZE);
+
+    while (1) {
+        msg_receive(&m_recv_ip);
+        udp_packet_process((pktbuf_t *) m_recv_ip.content.ptr);
         msg_reply(&m_recv_ip, &m_send_ip);
     }
 }
+#endif
@@ -23,9 +23,14 @@
 
 #define UDP_STACK_SIZE 				KERNEL_CONF_STACKSIZE_MAIN
 #define UDP_PKT_RECV_BUF_SIZE			(64)
+// message type of datagrams handed to the receiving thread
+#define UDP_DATAGRAM					(0x0100)
 
 uint16_t udp_csum(ipv6_hdr_t *ipv6_header, udp_hdr_t *udp_header);
 void udp_packet_handler(void);
+/* delivers a received datagram to its socket, as a pktbuf_t in a
+ * UDP_DATAGRAM message */
+void udp_packet_process(pktbuf_t *pkt);
 
 /**
  * @}
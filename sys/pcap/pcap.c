@@ -0,0 +1,379 @@
+/**
+ * Packet capture in pcap format
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_pcap
+ * @{
+ * @file    pcap.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef CPU_NATIVE
+#include <fcntl.h>
+#include <unistd.h>
+#include "native_internal.h"
+#endif
+
+#include "kernel.h"
+#include "irq.h"
+#include "thread.h"
+#include "thread_flags.h"
+#include "vtimer.h"
+#include "pcap.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#if PCAP_BUFSIZE & (PCAP_BUFSIZE - 1)
+#error PCAP_BUFSIZE must be a power of two
+#endif
+
+#define FLAG_PENDING    (1 << 0)
+
+/* TLV types of the 802.15.4 TAP header */
+#define TAP_FCS_TYPE    (0)
+#define TAP_RSS         (1)
+#define TAP_CHANNEL     (3)
+#define TAP_LQI         (10)
+
+/* version, reserved, length, then FCS type, RSS, channel and LQI */
+#define TAP_HDR_LEN     (4 + 8 + 8 + 8 + 8)
+#define USER0_HDR_LEN   (4)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+} pcap_hdr_t;
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} pcap_rec_t;
+
+/* indices run freely, the ring holds head - tail bytes */
+static uint8_t ring[PCAP_BUFSIZE];
+static unsigned int head;
+static unsigned int tail;
+
+static uint32_t linktype;
+static uint32_t started;                ///< link type of the file header
+static uint16_t snaplen;
+static pcap_filter_t filter;
+static pcap_stats_t stats;
+
+static int pcap_pid = -1;
+static char pcap_stack[PCAP_STACKSIZE];
+
+#ifdef CPU_NATIVE
+static int fd = -1;
+#endif
+
+/* interrupts must be disabled and the bytes must fit */
+static void ring_put(const void *buf, size_t len)
+{
+    unsigned int pos = head & (PCAP_BUFSIZE - 1);
+    size_t first = PCAP_BUFSIZE - pos;
+
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(&ring[pos], buf, first);
+    memcpy(ring, (const uint8_t *) buf + first, len - first);
+    head += len;
+}
+
+static void put_le16(uint8_t *buf, uint16_t value)
+{
+    buf[0] = value & 0xff;
+    buf[1] = value >> 8;
+}
+
+static void put_tlv(uint8_t *buf, uint16_t type, uint16_t len)
+{
+    put_le16(buf, type);
+    put_le16(buf + 2, len);
+    memset(buf + 4, 0, 4);
+}
+
+/* writes the link header to *buf*, returns its length */
+static size_t link_header(uint8_t *buf, const pcap_info_t *info)
+{
+    if (linktype == PCAP_LINKTYPE_IEEE802_15_4_TAP) {
+        float rss = info->rssi;
+
+        buf[0] = 0;
+        buf[1] = 0;
+        put_le16(buf + 2, TAP_HDR_LEN);
+
+        /* the frames are passed without FCS */
+        put_tlv(buf + 4, TAP_FCS_TYPE, 1);
+
+        /* both the TLVs and the float are little endian, like the CPUs */
+        put_tlv(buf + 12, TAP_RSS, 4);
+        memcpy(buf + 16, &rss, 4);
+
+        put_tlv(buf + 20, TAP_CHANNEL, 3);
+        put_le16(buf + 24, info->channel);
+
+        put_tlv(buf + 28, TAP_LQI, 1);
+        buf[32] = info->lqi;
+        return TAP_HDR_LEN;
+    }
+
+    if (linktype == PCAP_LINKTYPE_USER0) {
+        buf[0] = info->dst >> 8;
+        buf[1] = info->dst & 0xff;
+        buf[2] = info->src >> 8;
+        buf[3] = info->src & 0xff;
+        return USER0_HDR_LEN;
+    }
+
+    return 0;
+}
+
+static int matches(const pcap_info_t *info)
+{
+    if ((filter.match & PCAP_MATCH_SRC) && (info->src != filter.src)) {
+        return 0;
+    }
+
+    if ((filter.match & PCAP_MATCH_DST) && (info->dst != filter.dst)) {
+        return 0;
+    }
+
+    if ((filter.match & PCAP_MATCH_TYPE) &&
+        ((info->type >= 8) || !(filter.types & (1 << info->type)))) {
+        return 0;
+    }
+
+    if ((filter.match & PCAP_MATCH_RSSI) && (info->rssi < filter.rssi)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+void pcap_capture(const pcap_info_t *info, const uint8_t *hdr, size_t hdr_len,
+                  const uint8_t *data, size_t len)
+{
+    uint8_t link[TAP_HDR_LEN];
+    pcap_rec_t rec;
+
+    if (!linktype) {
+        return;
+    }
+
+    uint64_t now = vtimer_now64();
+    size_t link_len = link_header(link, info);
+
+    rec.ts_sec = now / 1000000;
+    rec.ts_usec = now % 1000000;
+    rec.orig_len = link_len + hdr_len + len;
+    rec.incl_len = rec.orig_len;
+
+    if (snaplen && (rec.incl_len > snaplen)) {
+        rec.incl_len = snaplen;
+    }
+
+    /* the snap length cuts off the end of the frame */
+    size_t keep = rec.incl_len - link_len;
+
+    if (hdr_len > keep) {
+        hdr_len = keep;
+    }
+
+    keep -= hdr_len;
+
+    if (len > keep) {
+        len = keep;
+    }
+
+    unsigned int state = disableIRQ();
+
+    if (!matches(info)) {
+        stats.filtered++;
+        restoreIRQ(state);
+        return;
+    }
+
+    if (PCAP_BUFSIZE - (head - tail) < sizeof(rec) + rec.incl_len) {
+        stats.dropped++;
+        restoreIRQ(state);
+        return;
+    }
+
+    int wake = (head == tail);
+
+    ring_put(&rec, sizeof(rec));
+    ring_put(link, link_len);
+
+    if (hdr_len) {
+        ring_put(hdr, hdr_len);
+    }
+
+    ring_put(data, len);
+    stats.captured++;
+    restoreIRQ(state);
+
+    if (wake) {
+        thread_flags_set(pcap_pid, FLAG_PENDING);
+    }
+}
+
+static void output(const uint8_t *buf, size_t len)
+{
+#ifdef CPU_NATIVE
+
+    while (len) {
+        ssize_t n = _native_write(fd, buf, len);
+
+        if (n <= 0) {
+            DEBUG("pcap: write failed\n");
+            return;
+        }
+
+        buf += n;
+        len -= n;
+    }
+
+#else
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
+#endif
+}
+
+static void pcap_thread(void)
+{
+    while (1) {
+        thread_flags_wait_any(FLAG_PENDING);
+
+        while (1) {
+            unsigned int state = disableIRQ();
+            unsigned int pos = tail & (PCAP_BUFSIZE - 1);
+            size_t len = head - tail;
+            restoreIRQ(state);
+
+            if (len == 0) {
+                break;
+            }
+
+            /* the bytes stay in place until they are written */
+            if (len > PCAP_BUFSIZE - pos) {
+                len = PCAP_BUFSIZE - pos;
+            }
+
+            output(&ring[pos], len);
+
+            state = disableIRQ();
+            tail += len;
+            restoreIRQ(state);
+        }
+    }
+}
+
+int pcap_start(uint32_t type, uint16_t snap)
+{
+    pcap_hdr_t hdr;
+
+    if (linktype || (started && (type != started))) {
+        return -1;
+    }
+
+    if (pcap_pid < 0) {
+        pcap_pid = thread_create(pcap_stack, sizeof(pcap_stack), PCAP_PRIORITY,
+                                 CREATE_STACKTEST, pcap_thread, "pcap");
+
+        if (pcap_pid < 0) {
+            return -1;
+        }
+    }
+
+#ifdef CPU_NATIVE
+
+    if (fd < 0) {
+        char name[64];
+
+        snprintf(name, sizeof(name), PCAP_NATIVE_FILE, (int) getpid());
+        _native_syscall_enter();
+        fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        _native_syscall_leave();
+
+        if (fd < 0) {
+            return -1;
+        }
+    }
+
+#endif
+
+    unsigned int state = disableIRQ();
+
+    /* a stream has one file header, a capture started again continues it */
+    if (!started) {
+        /* in host byte order, the readers tell it by the magic */
+        hdr.magic = 0xa1b2c3d4;
+        hdr.version_major = 2;
+        hdr.version_minor = 4;
+        hdr.thiszone = 0;
+        hdr.sigfigs = 0;
+        hdr.snaplen = 0xffff;
+        hdr.network = type;
+        ring_put(&hdr, sizeof(hdr));
+        started = type;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    snaplen = (snap && (snap < TAP_HDR_LEN)) ? TAP_HDR_LEN : snap;
+    linktype = type;
+    restoreIRQ(state);
+
+    thread_flags_set(pcap_pid, FLAG_PENDING);
+    return 0;
+}
+
+void pcap_stop(void)
+{
+    linktype = 0;
+}
+
+uint32_t pcap_linktype(void)
+{
+    return linktype;
+}
+
+void pcap_set_filter(const pcap_filter_t *f)
+{
+    unsigned int state = disableIRQ();
+
+    if (f == NULL) {
+        memset(&filter, 0, sizeof(filter));
+    }
+    else {
+        filter = *f;
+    }
+
+    restoreIRQ(state);
+}
+
+void pcap_get_stats(pcap_stats_t *out)
+{
+    unsigned int state = disableIRQ();
+    *out = stats;
+    restoreIRQ(state);
+}
@@ -6,11 +6,11 @@
 /** Value returned if `sem_open' failed.  */
 #define SEM_FAILED      ((sem_t *) 0)
 
-#include "queue.h"
+#include "pheap.h"
 
 typedef struct sem {
     volatile unsigned int value;
-    queue_node_t queue;
+    pheap_node_t queue;
 } sem_t;
 
 /**
@@ -67,11 +67,10 @@ int sem_wait(sem_t *sem);
 /**
  * @brief Similar to `sem_wait' but wait only until ABSTIME.
  *
- * @brief WARNING: currently not supported
- *
  * @param sem Semaphore to wait on
- * @param abstime Max time to wait for a post
+ * @param abstime Max time to wait for a post, in the time of vtimer_now()
  *
+ * @return 0 if the semaphore was taken, -1 on timeout
  */
 int sem_timedwait(sem_t *sem, const struct timespec *abstime);
 
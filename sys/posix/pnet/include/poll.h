@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @addtogroup  pnet
+ * @{
+ */
+
+/**
+ * @file    poll.h
+ * @brief   Definitions for the poll() function
+ * @see     <a href="http://pubs.opengroup.org/onlinepubs/9699919799/basedefs/poll.h.html">
+ *              The Open Group Base Specifications Issue 7, <poll.h>
+ *          </a>
+ */
+#ifndef _POLL_H
+#define _POLL_H
+
+#include "destiny/socket.h"
+
+/**
+ * @brief   Maximum number of entries poll() accepts in one call.
+ */
+#ifndef POLL_NFDS_MAX
+#define POLL_NFDS_MAX   (8)
+#endif
+
+/**
+ * @name    *events* and *revents* values of struct pollfd
+ * @{
+ */
+#define POLLIN      DESTINY_POLLIN      ///< Data other than high-priority data may be read without blocking.
+#define POLLRDNORM  DESTINY_POLLIN      ///< Normal data may be read without blocking.
+#define POLLOUT     DESTINY_POLLOUT     ///< Normal data may be written without blocking.
+#define POLLWRNORM  DESTINY_POLLOUT     ///< Equivalent to POLLOUT.
+#define POLLERR     DESTINY_POLLERR     ///< An error has occurred (*revents* only).
+#define POLLHUP     DESTINY_POLLHUP     ///< Device has been disconnected (*revents* only).
+#define POLLNVAL    DESTINY_POLLNVAL    ///< Invalid *fd* member (*revents* only).
+/** @} */
+
+/**
+ * @brief   Number of entries in the poll() file descriptor set.
+ */
+typedef unsigned int nfds_t;
+
+/**
+ * @brief   Entry of the poll() file descriptor set.
+ */
+struct pollfd {
+    int     fd;         ///< The following descriptor being polled.
+    short   events;     ///< The input event flags.
+    short   revents;    ///< The output event flags.
+};
+
+/**
+ * @brief   Waits until one of the sockets in *fds* is ready.
+ * @details A single thread can serve several sockets this way, instead of
+ *          blocking one thread per socket in recv(), recvfrom() or accept().
+ *
+ * @see <a href="http://pubs.opengroup.org/onlinepubs/9699919799/functions/poll.html">
+ *          The Open Group Base Specification Issue 7, poll
+ *      </a>
+ *
+ * @param[in,out] fds   The file descriptors and the events to wait for.
+ *                      Entries with negative *fd* are ignored.
+ * @param[in] nfds      Number of entries in *fds*, at most POLL_NFDS_MAX.
+ * @param[in] timeout   Time to wait in milliseconds, -1 to wait forever and
+ *                      0 to return immediately.
+ *
+ * @return  The number of entries with non-zero *revents*, 0 on timeout or -1
+ *          on error with *errno* set.
+ */
+int poll(struct pollfd fds[], nfds_t nfds, int timeout);
+
+/**
+ * @}
+ */
+#endif /* _POLL_H */
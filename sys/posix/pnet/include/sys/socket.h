@@ -420,6 +420,64 @@ ssize_t send(int socket, const void *buffer, size_t length, int flags);
 ssize_t sendto(int socket, const void *message, size_t length, int flags,
                const struct sockaddr *dest_addr, socklen_t dest_len);
 
+/**
+ * @brief   Datagrams a call of sendmmsg() or recvmmsg() handles at most,
+ *          larger *vlen* are cut to it.
+ */
+#ifndef MMSG_VLEN_MAX
+#define MMSG_VLEN_MAX   (8)
+#endif
+
+/**
+ * @brief   One datagram of sendmmsg() or recvmmsg().
+ * @note    Simplified, there is no struct msghdr: one buffer and one
+ *          address per datagram.
+ */
+struct mmsghdr {
+    struct sockaddr *msg_name;  ///< destination or sender address, may be NULL
+                                ///< on receive
+    socklen_t msg_namelen;      ///< length of *msg_name*
+    void *msg_buf;              ///< payload
+    size_t msg_buflen;          ///< length of *msg_buf*
+    unsigned int msg_len;       ///< returned number of bytes sent or received
+};
+
+/**
+ * @brief   Send several datagrams on a socket.
+ * @detail  Sends *vlen* datagrams with a single call, like the Linux
+ *          function of the same name.
+ *
+ * @param[in] socket    Specifies the socket file descriptor.
+ * @param[in,out] msgvec The datagrams, *msg_len* is set for each one sent.
+ * @param[in] vlen      Number of entries in *msgvec*, at most MMSG_VLEN_MAX
+ *                      are used.
+ * @param[in] flags     Support for values other than 0 is not implemented
+ *                      yet.
+ *
+ * @return  Number of datagrams sent, or -1 with errno set if none was.
+ */
+int sendmmsg(int socket, struct mmsghdr *msgvec, unsigned int vlen,
+             int flags);
+
+/**
+ * @brief   Receive several datagrams from a socket.
+ * @detail  Blocks until a datagram arrives and also takes the ones that
+ *          follow it right away, up to *vlen*, like the Linux function of
+ *          the same name without a timeout.
+ *
+ * @param[in] socket    Specifies the socket file descriptor.
+ * @param[in,out] msgvec The buffers, *msg_len* and *msg_name* are set for
+ *                      each datagram received.
+ * @param[in] vlen      Number of entries in *msgvec*, at most MMSG_VLEN_MAX
+ *                      are used.
+ * @param[in] flags     Support for values other than 0 is not implemented
+ *                      yet.
+ *
+ * @return  Number of datagrams received, or -1 with errno set on error.
+ */
+int recvmmsg(int socket, struct mmsghdr *msgvec, unsigned int vlen,
+             int flags);
+
 /**
  * @brief   Set the socket options.
  *
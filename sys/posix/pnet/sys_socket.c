@@ -18,6 +18,7 @@
 #include "fd.h"
 
 #include "sys/socket.h"
+#include "poll.h"
 
 int flagless_send(int fd, const void *buf, size_t len)
 {
@@ -175,6 +176,107 @@ ssize_t sendto(int socket, const void *message, size_t length, int flags,
     return (ssize_t)res;
 }
 
+int sendmmsg(int socket, struct mmsghdr *msgvec, unsigned int vlen,
+             int flags)
+{
+    destiny_socket_mmsg_t internal_msgvec[MMSG_VLEN_MAX];
+    int res;
+
+    if (vlen > MMSG_VLEN_MAX) {
+        vlen = MMSG_VLEN_MAX;
+    }
+
+    for (unsigned int i = 0; i < vlen; i++) {
+        internal_msgvec[i].buf = msgvec[i].msg_buf;
+        internal_msgvec[i].len = (uint32_t) msgvec[i].msg_buflen;
+        internal_msgvec[i].addr = (sockaddr6_t *) msgvec[i].msg_name;
+    }
+
+    res = sock_func_wrapper(destiny_socket_sendmmsg, socket, internal_msgvec,
+                            vlen, flags);
+
+    if (res < 0) {
+        // destiny needs more granular error handling
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    for (int i = 0; i < res; i++) {
+        msgvec[i].msg_len = (unsigned int) internal_msgvec[i].res;
+    }
+
+    return res;
+}
+
+int recvmmsg(int socket, struct mmsghdr *msgvec, unsigned int vlen,
+             int flags)
+{
+    destiny_socket_mmsg_t internal_msgvec[MMSG_VLEN_MAX];
+    int res;
+
+    if (vlen > MMSG_VLEN_MAX) {
+        vlen = MMSG_VLEN_MAX;
+    }
+
+    for (unsigned int i = 0; i < vlen; i++) {
+        internal_msgvec[i].buf = msgvec[i].msg_buf;
+        internal_msgvec[i].len = (uint32_t) msgvec[i].msg_buflen;
+        internal_msgvec[i].addr = (sockaddr6_t *) msgvec[i].msg_name;
+    }
+
+    res = sock_func_wrapper(destiny_socket_recvmmsg, socket, internal_msgvec,
+                            vlen, flags);
+
+    if (res < 0) {
+        // destiny needs more granular error handling
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    for (int i = 0; i < res; i++) {
+        msgvec[i].msg_len = (unsigned int) internal_msgvec[i].res;
+
+        if (msgvec[i].msg_name != NULL) {
+            msgvec[i].msg_namelen = sizeof(sockaddr6_t);
+        }
+    }
+
+    return res;
+}
+
+int poll(struct pollfd fds[], nfds_t nfds, int timeout)
+{
+    destiny_socket_pollfd_t internal_fds[POLL_NFDS_MAX];
+    int res;
+
+    if (nfds > POLL_NFDS_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (nfds_t i = 0; i < nfds; i++) {
+        fd_t *fd = (fds[i].fd >= 0) ? fd_get(fds[i].fd) : NULL;
+
+        /* an unknown descriptor is reported as POLLNVAL */
+        internal_fds[i].fd = (fd != NULL) ? fd->fd :
+                             ((fds[i].fd >= 0) ? 0 : -1);
+        internal_fds[i].events = (uint8_t) fds[i].events;
+    }
+
+    res = destiny_socket_poll(internal_fds, nfds, timeout);
+
+    if (res < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (nfds_t i = 0; i < nfds; i++) {
+        fds[i].revents = internal_fds[i].revents;
+    }
+
+    return res;
+}
+
 int setsockopt(int socket, int level, int option_name, const void *option_value,
                socklen_t option_len)
 {
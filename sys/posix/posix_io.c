@@ -64,3 +64,30 @@ int posix_write(int pid, char *buffer, int bufsize)
 {
     return _posix_fileop_data(pid, WRITE, buffer, bufsize);
 }
+
+static int _posix_fileop_vec(int pid, int op, struct posix_iovec_t *iov,
+                             int iovcnt)
+{
+    struct posix_iopv_t r;
+    r.nbytes = 0;
+    r.iov = iov;
+    r.iovcnt = iovcnt;
+
+    msg_t m;
+    m.type = op;
+    m.content.ptr = (char *) &r;
+
+    msg_send_receive(&m, &m, pid);
+
+    return r.nbytes;
+}
+
+int posix_readv(int pid, struct posix_iovec_t *iov, int iovcnt)
+{
+    return _posix_fileop_vec(pid, READV, iov, iovcnt);
+}
+
+int posix_writev(int pid, struct posix_iovec_t *iov, int iovcnt)
+{
+    return _posix_fileop_vec(pid, WRITEV, iov, iovcnt);
+}
@@ -19,9 +19,11 @@
 #include "pthread_rwlock.h"
 #include "pthread_spin.h"
 #include "pthread_barrier.h"
+#include "pthread_cond.h"
 #include "pthread_cleanup.h"
 #include "pthread_once.h"
 #include "pthread_scheduling.h"
 #include "pthread_cancellation.h"
+#include "pthread_pool.h"
 
 #endif	/* pthread.h */
@@ -2,8 +2,6 @@
  * @ingroup pthread
  */
 
-#include "mutex.h"
-
 /**
  * @def     PTHREAD_PROCESS_SHARED
  * @brief   Share the structure with child processes (default).
@@ -38,7 +36,6 @@ typedef struct pthread_barrier_waiting_node
 typedef struct pthread_barrier
 {
     struct pthread_barrier_waiting_node *next; /**< The first waiting thread. */
-    mutex_t mutex; /**< Mutex to unlock to wake the thread up. */
     volatile int count; /**< Wait for N more threads before waking everyone up. */
 } pthread_barrier_t;
 
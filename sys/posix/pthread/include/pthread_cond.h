@@ -1,54 +1,133 @@
-/* Functions for handling conditional variables.  */
-
-typedef unsigned long int pthread_cond_t;
-typedef unsigned long int pthread_condattr_t;
-
-/* Initialize condition variable COND using attributes ATTR, or use
- the default values if later is NULL.  */
-int pthread_cond_init(pthread_cond_t *cond,
-        const pthread_condattr_t *cond_attr);
-
-/* Destroy condition variable COND.  */
+/**
+ * @ingroup pthread
+ */
+
+#include <time.h>
+
+#include "mutex.h"
+#include "pheap.h"
+
+/**
+ * @brief     A condition variable.
+ * @details   Initialize with pthread_cond_init() or #PTHREAD_COND_INITIALIZER.
+ *            A zeroed out datum is initialized.
+ */
+typedef struct pthread_cond
+{
+    pheap_node_t queue; /**< The waiting threads, ordered by priority. */
+} pthread_cond_t;
+
+/**
+ * @brief     Static initializer for a pthread_cond_t.
+ */
+#define PTHREAD_COND_INITIALIZER { { NULL, NULL, NULL, 0, 0, 0 } }
+
+/**
+ * @brief     Details for a pthread_cond_t.
+ */
+typedef struct pthread_condattr
+{
+    int pshared; /**< See pthread_condattr_setpshared(), has no effect. */
+    clockid_t clock; /**< See pthread_condattr_setclock(), has no effect. */
+} pthread_condattr_t;
+
+/**
+ * @brief     Initializes a condition variable.
+ * @param     cond   Datum to initialize
+ * @param     attr   (unused)
+ * @returns   0, the invocation cannot fail
+ */
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
+
+/**
+ * @brief     Destroys a condition variable.
+ * @param     cond   Condition variable to destroy
+ * @returns   0 on success, EBUSY if threads are waiting for it
+ */
 int pthread_cond_destroy(pthread_cond_t *cond);
 
-/* Wake up one thread waiting for condition variable COND.  */
+/**
+ * @brief     Wakes up the waiting thread with the highest priority.
+ * @param     cond   Condition variable to signal
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_cond_signal(pthread_cond_t *cond);
 
-/* Wake up all threads waiting for condition variables COND.  */
+/**
+ * @brief     Wakes up every waiting thread.
+ * @details   All waiters are put on the run queue with interrupts disabled
+ *            once, and the caller yields at most once afterwards.
+ * @param     cond   Condition variable to broadcast
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_cond_broadcast(pthread_cond_t *cond);
 
-/* Wait for condition variable COND to be signaled or broadcast.
- MUTEX is assumed to be locked before.
-
- This function is a cancellation point and therefore not marked with.  */
+/**
+ * @brief     Releases *mutex* and waits for *cond* to be signaled.
+ * @details   The calling thread holds *mutex* again when the function returns.
+ *            Spurious wake ups are possible, check your predicate in a loop.
+ * @param     cond    Condition variable to wait for
+ * @param     mutex   Mutex held by the calling thread
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
 
-/* Wait for condition variable COND to be signaled or broadcast until
- ABSTIME.  MUTEX is assumed to be locked before.  ABSTIME is an
- absolute time specification; zero is the beginning of the epoch
- (00:00:00 GMT, January 1, 1970).
-
- This function is a cancellation point and therefore not marked with.  */
+/**
+ * @brief     Like pthread_cond_wait(), but waits at most until *abstime*.
+ * @param     cond      Condition variable to wait for
+ * @param     mutex     Mutex held by the calling thread
+ * @param     abstime   Absolute time in the time of vtimer_now().
+ * @returns   0 if signaled, ETIMEDOUT if *abstime* passed
+ */
 int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
-        const struct timespec *abstime);
-
-/* Functions for handling condition variable attributes.  */
-
-/* Initialize condition variable attribute ATTR.  */
+                           const struct timespec *abstime);
+
+/**
+ * @brief     Initialize a pthread_condattr_t
+ * @details   A zeroed out datum is initialized.
+ * @param     attr   Datum to initialize.
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_condattr_init(pthread_condattr_t *attr);
 
-/* Destroy condition variable attribute ATTR.  */
+/**
+ * @brief     Destroy a pthread_condattr_t
+ * @details   This function does nothing.
+ * @param     attr   Datum to destroy
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_condattr_destroy(pthread_condattr_t *attr);
 
-/* Get the process-shared flag of the condition variable attribute ATTR.  */
+/**
+ * @brief     Returns the value stored with pthread_condattr_setpshared().
+ * @param     attr      Attribute to read
+ * @param     pshared   Output value
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_condattr_getpshared(const pthread_condattr_t *attr, int *pshared);
 
-/* Set the process-shared flag of the condition variable attribute ATTR.  */
+/**
+ * @brief     Set if the condition variable should be shared with child processes
+ * @details   Since RIOT is a single process OS, pthread_cond_init() will ignore the value.
+ * @param     attr      Attribute set for pthread_cond_init()
+ * @param     pshared   Either #PTHREAD_PROCESS_PRIVATE or #PTHREAD_PROCESS_SHARED
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_condattr_setpshared(pthread_condattr_t *attr, int pshared);
 
-/* Get the clock selected for the conditon variable attribute ATTR.  */
-int pthread_condattr_getclock(const pthread_condattr_t *attr,
-        clockid_t *clock_id);
-
-/* Set the clock selected for the conditon variable attribute ATTR.  */
+/**
+ * @brief     Returns the value stored with pthread_condattr_setclock().
+ * @param     attr       Attribute to read
+ * @param     clock_id   Output value
+ * @returns   0, the invocation cannot fail
+ */
+int pthread_condattr_getclock(const pthread_condattr_t *attr, clockid_t *clock_id);
+
+/**
+ * @brief     Sets the clock for pthread_cond_timedwait().
+ * @details   The timeouts always use the time of vtimer_now(), the value is only stored.
+ * @param     attr       Attribute set for pthread_cond_init()
+ * @param     clock_id   Clock to use
+ * @returns   0, the invocation cannot fail
+ */
 int pthread_condattr_setclock(pthread_condattr_t *attr, clockid_t clock_id);
@@ -52,11 +52,11 @@ int pthread_mutex_trylock(pthread_mutex_t *mutex);
 int pthread_mutex_lock(pthread_mutex_t *mutex);
 
 /**
- * @brief           Not implemented, yet.
- * @details         Will cause a linktime error ...
- * @param[in]       mutex     The unused mutex.
- * @param[in]       abstime   The used absolute time.
- * @return          Well ... you'll get a link time error, so nothing will be returned.
+ * @brief           Locks the mutex, blocking at most until *abstime*.
+ * @param[in]       mutex     The mutex to lock.
+ * @param[in]       abstime   Absolute time in the time of vtimer_now().
+ * @return          0 on success, ETIMEDOUT if the mutex was not unlocked in time,
+ *                  -1 if *mutex* is NULL.
  */
 int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *abstime);
 
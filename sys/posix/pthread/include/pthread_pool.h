@@ -0,0 +1,74 @@
+/**
+ * @ingroup pthread
+ */
+
+#include <stdbool.h>
+
+/**
+ * @def      PTHREAD_POOL_WORKERS
+ * @brief    Number of threads running the routines passed to pthread_pool_submit().
+ */
+#ifndef PTHREAD_POOL_WORKERS
+#define PTHREAD_POOL_WORKERS (1)
+#endif
+
+/**
+ * @def      PTHREAD_POOL_STACKSIZE
+ * @brief    Stack size of every worker.
+ */
+#ifndef PTHREAD_POOL_STACKSIZE
+#define PTHREAD_POOL_STACKSIZE (KERNEL_CONF_STACKSIZE_DEFAULT)
+#endif
+
+/**
+ * @def      PTHREAD_POOL_PRIORITY
+ * @brief    Priority of the workers.
+ */
+#ifndef PTHREAD_POOL_PRIORITY
+#define PTHREAD_POOL_PRIORITY (PRIORITY_MAIN)
+#endif
+
+/**
+ * @brief     A routine submitted to the pool and its result.
+ * @details   The datum is supplied by the caller and must stay valid until the
+ *            routine finished, see pthread_future_get().
+ */
+typedef struct pthread_future
+{
+    struct pthread_future *next; /**< The next routine in the queue. */
+    void *(*routine)(void *); /**< The routine to run. */
+    void *arg; /**< Argument supplied to `routine`. */
+    void *result; /**< Value returned by `routine`. */
+    volatile bool done; /**< `routine` has returned. */
+    int waiting_pid; /**< Thread waiting in pthread_future_get(), or -1. */
+} pthread_future_t;
+
+/**
+ * @brief     Runs `routine(arg)` on a worker of the pool.
+ * @details   The workers are started with the first call, so short-lived tasks
+ *            run without creating a thread or allocating a stack.
+ *            Routines run one after the other in the order of submission on
+ *            each worker.
+ *            They are not pthreads and must not call pthread_exit().
+ * @param[out]  future    Datum to hold the result.
+ * @param[in]   routine   The routine to run.
+ * @param[in]   arg       Argument supplied to `routine`.
+ * @returns   `0` on success.
+ *            `-1` if the workers could not be started.
+ */
+int pthread_pool_submit(pthread_future_t *future, void *(*routine)(void *), void *arg);
+
+/**
+ * @brief     Waits for the routine of `future` to finish.
+ * @details   Only one thread may wait for a future at a time.
+ * @param[in,out]   future   A submitted future.
+ * @returns   The value returned by the routine.
+ */
+void *pthread_future_get(pthread_future_t *future);
+
+/**
+ * @brief     Tells whether the routine of `future` finished, without blocking.
+ * @param[in]   future   A submitted future.
+ * @returns   `true` if pthread_future_get() would not block.
+ */
+bool pthread_future_done(const pthread_future_t *future);
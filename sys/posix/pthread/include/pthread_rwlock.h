@@ -18,13 +18,17 @@
 typedef struct pthread_rwlock
 {
     /**
-     * @brief     The current amount of reader inside the critical section.
+     * @brief     Who is inside the critical section.
      * @details
-     *            * `== 0`: no thread is in the critical section.
-     *            * `> 0`: the number of readers currently in the critical section.
-     *            * `< 0`: a writer is currently in the critical section.
+     *            * `__PTHREAD_RWLOCK_READERS` bits: the number of readers in the critical section.
+     *            * `__PTHREAD_RWLOCK_WRITER`: a writer is in the critical section.
+     *            * `__PTHREAD_RWLOCK_WAITERS`: threads may wait in `queue`,
+     *              the state is only changed while holding `mutex`.
+     *
+     *            Without waiters the lock is taken and released by atomic_cas() on the state,
+     *            without touching `mutex` and `queue`.
      */
-    int readers;
+    volatile unsigned int state;
 
     /**
      * @brief     Queue of waiting threads.
@@ -35,8 +39,28 @@ typedef struct pthread_rwlock
      * @brief     Provides mutual exclusion on reading and writing on the structure.
      */
     mutex_t mutex;
+
+    /**
+     * @brief     Whom the lock lets in first, see pthread_rwlockattr_setkind_np().
+     */
+    int kind;
 } pthread_rwlock_t;
 
+/**
+ * @brief     Bits of `pthread_rwlock_t::state` counting the readers.
+ */
+#define __PTHREAD_RWLOCK_READERS (0x3fffu)
+
+/**
+ * @brief     Bit of `pthread_rwlock_t::state` set while a writer holds the lock.
+ */
+#define __PTHREAD_RWLOCK_WRITER (0x4000u)
+
+/**
+ * @brief     Bit of `pthread_rwlock_t::state` set while threads may wait for the lock.
+ */
+#define __PTHREAD_RWLOCK_WAITERS (0x8000u)
+
 /**
  * @brief     Internal structure that stores one waiting thread.
  */
@@ -4,9 +4,26 @@
 
 #include <errno.h>
 
+/**
+ * @brief     Waiting readers and writers of the same priority don't starve each other.
+ */
+#define PTHREAD_RWLOCK_PREFER_PRIORITY_NP (0)
+
+/**
+ * @brief     Readers only wait for a writer in the critical section,
+ *            a release lets all waiting readers continue at once.
+ */
+#define PTHREAD_RWLOCK_PREFER_READER_NP (1)
+
+/**
+ * @brief     Readers wait while any writer waits,
+ *            a release lets a waiting writer continue before any reader.
+ */
+#define PTHREAD_RWLOCK_PREFER_WRITER_NP (2)
+
 /**
  * @brief     Attributes for a new reader/writer lock.
- * @details   The options set in this struct will be ignored by pthread_rwlock_init().
+ * @details   Only `kind` is used by pthread_rwlock_init().
  */
 typedef struct pthread_rwlockattr
 {
@@ -16,6 +33,12 @@ typedef struct pthread_rwlockattr
      *            Since RIOT is a single-process operating system, this value is ignored.
      */
     int pshared;
+
+    /**
+     * @brief     Whom a contended lock lets in first.
+     * @details   One of the `PTHREAD_RWLOCK_PREFER_*_NP` values.
+     */
+    int kind;
 } pthread_rwlockattr_t;
 
 /**
@@ -56,3 +79,23 @@ int pthread_rwlockattr_getpshared(const pthread_rwlockattr_t *attr, int *pshared
  *                  `EINVAL` if `attr == NULL` or a wrong value for `pshared` was supplied.
  */
 int pthread_rwlockattr_setpshared(pthread_rwlockattr_t *attr, int pshared);
+
+/**
+ * @brief           Read whom the lock lets in first.
+ * @param[in]       attr   Attribute set to query.
+ * @param[out]      kind   One of the `PTHREAD_RWLOCK_PREFER_*_NP` values.
+ * @returns         `0` on success.
+ *                  `EINVAL` if `attr == NULL`.
+ */
+int pthread_rwlockattr_getkind_np(const pthread_rwlockattr_t *attr, int *kind);
+
+/**
+ * @brief           Set whom the lock lets in first.
+ * @details         The default is `PTHREAD_RWLOCK_PREFER_PRIORITY_NP`.
+ *                  Use `PTHREAD_RWLOCK_PREFER_READER_NP` to wake bursts of readers together.
+ * @param[in,out]   attr   Attribute set to operate on.
+ * @param[in]       kind   One of the `PTHREAD_RWLOCK_PREFER_*_NP` values.
+ * @returns         `0` on success.
+ *                  `EINVAL` if `attr == NULL` or a wrong value for `kind` was supplied.
+ */
+int pthread_rwlockattr_setkind_np(pthread_rwlockattr_t *attr, int kind);
@@ -47,6 +47,11 @@
 
 #include "debug.h"
 
+/* stacks of PTHREAD_STACKSIZE handed out before falling back to malloc() */
+#ifndef PTHREAD_STACK_POOL
+#   define PTHREAD_STACK_POOL (2)
+#endif
+
 enum pthread_thread_status {
     PTS_RUNNING,
     PTS_DETACHED,
@@ -65,17 +70,62 @@ typedef struct pthread_thread {
     void *arg;
 
     char *stack;
+    int pool_slot;
 
     __pthread_cleanup_datum_t *cleanup_top;
 } pthread_thread_t;
 
 static pthread_thread_t *volatile pthread_sched_threads[MAXTHREADS];
+static pthread_thread_t pthread_threads[MAXTHREADS];
 static struct mutex_t pthread_mutex;
 
 static volatile int pthread_reaper_pid = -1;
 
 static char pthread_reaper_stack[PTHREAD_REAPER_STACKSIZE];
 
+#if PTHREAD_STACK_POOL > 0
+static char pthread_stacks[PTHREAD_STACK_POOL][PTHREAD_STACKSIZE];
+static volatile bool pthread_stack_used[PTHREAD_STACK_POOL];
+#endif
+
+/* an unused stack of the pool, -1 if all are taken */
+static int stack_pool_get(void)
+{
+    int result = -1;
+#if PTHREAD_STACK_POOL > 0
+    unsigned state = disableIRQ();
+    for (int i = 0; i < PTHREAD_STACK_POOL; i++) {
+        if (!pthread_stack_used[i]) {
+            pthread_stack_used[i] = true;
+            result = i;
+            break;
+        }
+    }
+    restoreIRQ(state);
+#endif
+    return result;
+}
+
+static void *stack_pool_stack(int slot)
+{
+#if PTHREAD_STACK_POOL > 0
+    return pthread_stacks[slot];
+#else
+    (void) slot;
+    return NULL;
+#endif
+}
+
+/* a thread may still run on the stack, if it does so with interrupts disabled */
+static void stack_pool_put(int slot)
+{
+#if PTHREAD_STACK_POOL > 0
+    pthread_stack_used[slot] = false;
+#else
+    (void) slot;
+#endif
+}
+
 static void pthread_start_routine(void)
 {
     pthread_t self = pthread_self();
@@ -84,13 +134,14 @@ static void pthread_start_routine(void)
     pthread_exit(retval);
 }
 
-static int insert(pthread_thread_t *pt)
+static int insert(void)
 {
     int result = -1;
     mutex_lock(&pthread_mutex);
     for (int i = 0; i < MAXTHREADS; i++){
         if (!pthread_sched_threads[i]) {
-            pthread_sched_threads[i] = pt;
+            memset(&pthread_threads[i], 0, sizeof(pthread_threads[i]));
+            pthread_sched_threads[i] = &pthread_threads[i];
             result = i+1;
             break;
         }
@@ -111,13 +162,11 @@ static void pthread_reaper(void)
 
 int pthread_create(pthread_t *newthread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg)
 {
-    pthread_thread_t *pt = calloc(1, sizeof(pthread_thread_t));
-
-    int pthread_pid = insert(pt);
+    int pthread_pid = insert();
     if (pthread_pid < 0) {
-        free(pt);
         return -1;
     }
+    pthread_thread_t *pt = pthread_sched_threads[pthread_pid-1];
     *newthread = pthread_pid;
 
     pt->status = attr && attr->detached ? PTS_DETACHED : PTS_RUNNING;
@@ -126,7 +175,22 @@ int pthread_create(pthread_t *newthread, const pthread_attr_t *attr, void *(*sta
 
     bool autofree = attr == NULL || attr->ss_sp == NULL || attr->ss_size == 0;
     size_t stack_size = attr && attr->ss_size > 0 ? attr->ss_size : PTHREAD_STACKSIZE;
-    void *stack = autofree ? malloc(stack_size) : attr->ss_sp;
+    void *stack = autofree ? NULL : attr->ss_sp;
+
+    /* the pool saves the heap, oneway_malloc never gets a stack back */
+    pt->pool_slot = autofree && stack_size <= PTHREAD_STACKSIZE ? stack_pool_get() : -1;
+    if (pt->pool_slot >= 0) {
+        stack = stack_pool_stack(pt->pool_slot);
+        stack_size = PTHREAD_STACKSIZE;
+        autofree = false;
+    }
+    else if (autofree) {
+        stack = malloc(stack_size);
+        if (stack == NULL) {
+            pthread_sched_threads[pthread_pid-1] = NULL;
+            return -1;
+        }
+    }
     pt->stack = autofree ? stack : NULL;
 
     if (autofree && pthread_reaper_pid < 0) {
@@ -151,8 +215,10 @@ int pthread_create(pthread_t *newthread, const pthread_attr_t *attr, void *(*sta
                                    pthread_start_routine,
                                    "pthread");
     if (pt->thread_pid < 0) {
+        if (pt->pool_slot >= 0) {
+            stack_pool_put(pt->pool_slot);
+        }
         free(pt->stack);
-        free(pt);
         pthread_sched_threads[pthread_pid-1] = NULL;
         return -1;
     }
@@ -164,7 +230,8 @@ int pthread_create(pthread_t *newthread, const pthread_attr_t *attr, void *(*sta
 
 void pthread_exit(void *retval)
 {
-    pthread_thread_t *self = pthread_sched_threads[pthread_self()-1];
+    pthread_t self_id = pthread_self();
+    pthread_thread_t *self = pthread_sched_threads[self_id-1];
 
     while (self->cleanup_top) {
         __pthread_cleanup_datum_t *ct = self->cleanup_top;
@@ -186,11 +253,19 @@ void pthread_exit(void *retval)
     }
 
     dINT();
-    if (self->stack) {
+    if (self->pool_slot >= 0) {
+        /* nobody else runs before we left the stack */
+        stack_pool_put(self->pool_slot);
+    }
+    else if (self->stack) {
         msg_t m;
         m.content.ptr = self->stack;
         msg_send_int(&m, pthread_reaper_pid);
     }
+    if (self->status == PTS_DETACHED) {
+        /* nobody joins, the slot can be reused right away */
+        pthread_sched_threads[self_id-1] = NULL;
+    }
     sched_task_exit();
 }
 
@@ -211,8 +286,7 @@ int pthread_join(pthread_t th, void **thread_return)
             if (thread_return) {
                 *thread_return = other->returnval;
             }
-            free(other);
-            /* we only need to free the pthread layer struct,
+            /* we only need to release the pthread layer struct,
             native thread stack is freed by other */
             pthread_sched_threads[th-1] = NULL;
             return 0;
@@ -231,8 +305,7 @@ int pthread_detach(pthread_t th)
     }
 
     if (other->status == PTS_ZOMBIE) {
-        free(other);
-        /* we only need to free the pthread layer struct,
+        /* we only need to release the pthread layer struct,
         native thread stack is freed by other */
         pthread_sched_threads[th-1] = NULL;
     } else {
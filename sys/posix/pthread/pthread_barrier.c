@@ -17,7 +17,9 @@
  * @}
  */
 
+#include "irq.h"
 #include "sched.h"
+#include "thread.h"
 #include "pthread.h"
 
 #define ENABLE_DEBUG (0)
@@ -29,7 +31,6 @@ int pthread_barrier_init(pthread_barrier_t *barrier,
 {
     (void) attr;
     barrier->next = NULL;
-    mutex_init(&barrier->mutex);
     barrier->count = count;
     return 0;
 }
@@ -46,7 +47,7 @@ int pthread_barrier_wait(pthread_barrier_t *barrier)
      * If the value is bigger than zero afterwards, then the thread has to wait
      * to be woken up. Once the value reaches zero, everyone gets woken up. */
 
-    mutex_lock(&barrier->mutex);
+    int old_state = disableIRQ();
     DEBUG("%s: hit a synchronization barrier. pid=%u\n",
           active_thread->name, active_thread->pid);
 
@@ -62,19 +63,17 @@ int pthread_barrier_wait(pthread_barrier_t *barrier)
         node.cont = 0;
 
         barrier->next = &node;
-        mutex_unlock(&barrier->mutex);
-
-        while (1) {
-            /* The mutex is reacquired before checking if we should continue,
-             * so that the waiting thread don't accidentially run before the
-             * wake up loop has ended. Otherwise the thread could run into the
-             * the barrier again before `barrier->count` was reset. */
-            mutex_lock(&barrier->mutex);
-            if (node.cont) {
-                break;
-            }
-            mutex_unlock_and_sleep(&barrier->mutex);
+
+        /* The last thread puts everybody on the run queue with interrupts
+         * disabled, so nobody runs before `barrier->count` was reset. */
+        while (!node.cont) {
+            sched_set_status((tcb_t *) active_thread, STATUS_SLEEPING);
+            restoreIRQ(old_state);
+            thread_yield();
+            old_state = disableIRQ();
         }
+
+        restoreIRQ(old_state);
     }
     else {
         /* all threads have arrived, wake everybody up */
@@ -84,17 +83,26 @@ int pthread_barrier_wait(pthread_barrier_t *barrier)
 
         int count = 1; /* Count number of woken up threads.
                         * The first thread is the current thread. */
+        uint16_t priority = active_thread->priority;
         pthread_barrier_waiting_node_t *next;
         for (next = barrier->next; next; next = next->next) {
             ++count;
 
+            tcb_t *process = (tcb_t *) sched_threads[next->pid];
+            if (process->priority < priority) {
+                priority = process->priority;
+            }
+
             next->cont = 1;
-            sched_set_status((tcb_t *) sched_threads[next->pid], STATUS_PENDING);
+            sched_set_status(process, STATUS_PENDING);
         }
         barrier->next = NULL;
         barrier->count = count;
+
+        /* one reschedule for all of them */
+        restoreIRQ(old_state);
+        sched_switch(active_thread->priority, priority);
     }
 
-    mutex_unlock(&barrier->mutex);
     return 0;
 }
@@ -0,0 +1,171 @@
+/*
+ * POSIX compatible implementation of condition variables.
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup pthread
+ * @{
+ * @file
+ * @brief   Condition variables.
+ * @}
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "irq.h"
+#include "pthread.h"
+#include "sched.h"
+#include "tcb.h"
+#include "thread.h"
+#include "timex.h"
+#include "vtimer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr)
+{
+    (void) attr;
+    memset(cond, 0, sizeof (*cond));
+    return 0;
+}
+
+int pthread_cond_destroy(pthread_cond_t *cond)
+{
+    return pheap_head(&cond->queue) ? EBUSY : 0;
+}
+
+/* releases *mutex* and sleeps at most *ticks* if not 0, returns 0 on timeout */
+static int pthread_cond_sleep(pthread_cond_t *cond, pthread_mutex_t *mutex, unsigned long ticks)
+{
+    int old_state = disableIRQ();
+
+    pheap_node_t n;
+    n.priority = active_thread->priority;
+    n.data = (unsigned int) active_thread;
+
+    /* queue up before the mutex is released, so no signal is missed */
+    pheap_add(&cond->queue, &n);
+    sched_set_status((tcb_t *) active_thread, STATUS_MUTEX_BLOCKED);
+
+    if (ticks) {
+        active_thread->wait_data = (void *) &n;
+        thread_timeout_arm(ticks);
+    }
+
+    mutex_unlock(mutex);
+    restoreIRQ(old_state);
+    thread_yield();
+
+    int woken = !(ticks && thread_timeout_disarm());
+
+    mutex_lock(mutex);
+    return woken;
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    DEBUG("%s: waiting for condition variable\n", active_thread->name);
+    pthread_cond_sleep(cond, mutex, 0);
+    return 0;
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime)
+{
+    uint64_t then;
+    unsigned long ticks;
+
+    then = (uint64_t) abstime->tv_sec * 1000000 + abstime->tv_nsec / 1000u;
+
+    ticks = vtimer_timeout_ticks64(then);
+    if ((ticks == 0) || !pthread_cond_sleep(cond, mutex, ticks)) {
+        DEBUG("%s: condition variable timed out\n", active_thread->name);
+        return ETIMEDOUT;
+    }
+
+    return 0;
+}
+
+int pthread_cond_signal(pthread_cond_t *cond)
+{
+    int old_state = disableIRQ();
+
+    pheap_node_t *head = pheap_remove_head(&cond->queue);
+    if (head == NULL) {
+        restoreIRQ(old_state);
+        return 0;
+    }
+
+    tcb_t *process = (tcb_t *) head->data;
+    sched_set_status(process, STATUS_PENDING);
+
+    restoreIRQ(old_state);
+    sched_switch(active_thread->priority, process->priority);
+    return 0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t *cond)
+{
+    int old_state = disableIRQ();
+
+    pheap_node_t *head = pheap_head(&cond->queue);
+    if (head == NULL) {
+        restoreIRQ(old_state);
+        return 0;
+    }
+
+    /* the head has the highest priority, it is the one to yield to */
+    uint16_t priority = head->priority;
+
+    while ((head = pheap_remove_head(&cond->queue)) != NULL) {
+        sched_set_status((tcb_t *) head->data, STATUS_PENDING);
+    }
+
+    restoreIRQ(old_state);
+    sched_switch(active_thread->priority, priority);
+    return 0;
+}
+
+int pthread_condattr_init(pthread_condattr_t *attr)
+{
+    memset(attr, 0, sizeof (*attr));
+    return 0;
+}
+
+int pthread_condattr_destroy(pthread_condattr_t *attr)
+{
+    (void) attr;
+    return 0;
+}
+
+int pthread_condattr_getpshared(const pthread_condattr_t *attr, int *pshared)
+{
+    *pshared = attr->pshared;
+    return 0;
+}
+
+int pthread_condattr_setpshared(pthread_condattr_t *attr, int pshared)
+{
+    attr->pshared = pshared;
+    return 0;
+}
+
+int pthread_condattr_getclock(const pthread_condattr_t *attr, clockid_t *clock_id)
+{
+    *clock_id = attr->clock;
+    return 0;
+}
+
+int pthread_condattr_setclock(pthread_condattr_t *attr, clockid_t clock_id)
+{
+    attr->clock = clock_id;
+    return 0;
+}
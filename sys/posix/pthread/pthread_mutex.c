@@ -20,6 +20,8 @@
 #include <stddef.h>
 
 #include "pthread.h"
+#include "timex.h"
+#include "vtimer.h"
 
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *mutexattr)
 {
@@ -62,9 +64,23 @@ int pthread_mutex_lock(pthread_mutex_t *mutex)
 
 int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *abstime)
 {
-    (void) mutex;
-    (void) abstime;
-    return -1; /* currently not supported */
+    uint64_t then;
+    unsigned long ticks;
+
+    if (!mutex) {
+        return -1;
+    }
+
+    then = (uint64_t) abstime->tv_sec * 1000000 + abstime->tv_nsec / 1000u;
+
+    while ((ticks = vtimer_timeout_ticks64(then)) > 0) {
+        if (mutex_lock_timeout(mutex, ticks)) {
+            return 0;
+        }
+    }
+
+    /* POSIX tries once even if abstime has passed */
+    return mutex_trylock(mutex) ? 0 : ETIMEDOUT;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex)
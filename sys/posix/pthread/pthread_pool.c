@@ -0,0 +1,151 @@
+/*
+ * Fixed size pool of worker threads.
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup pthread
+ * @{
+ * @file
+ * @brief Executor running submitted routines on preallocated threads.
+ * @author Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "irq.h"
+#include "sched.h"
+#include "thread.h"
+#include "pthread.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+static char pool_stacks[PTHREAD_POOL_WORKERS][PTHREAD_POOL_STACKSIZE];
+static struct mutex_t pool_mutex;
+static volatile bool pool_started;
+
+/* submitted routines, oldest first */
+static pthread_future_t *pool_head;
+static pthread_future_t *pool_tail;
+
+/* workers sleeping for want of work */
+static int pool_idle[PTHREAD_POOL_WORKERS];
+static int pool_idle_count;
+
+static void pool_worker(void)
+{
+    while (1) {
+        unsigned state = disableIRQ();
+        pthread_future_t *future = pool_head;
+
+        if (future == NULL) {
+            pool_idle[pool_idle_count++] = thread_pid;
+            sched_set_status((tcb_t *) active_thread, STATUS_SLEEPING);
+            restoreIRQ(state);
+            thread_yield();
+            continue;
+        }
+
+        pool_head = future->next;
+        if (pool_head == NULL) {
+            pool_tail = NULL;
+        }
+        restoreIRQ(state);
+
+        DEBUG("pthread_pool: %u runs %p\n", thread_pid, (void *) future);
+        future->result = future->routine(future->arg);
+
+        state = disableIRQ();
+        future->done = true;
+        int waiting_pid = future->waiting_pid;
+        restoreIRQ(state);
+
+        if (waiting_pid >= 0) {
+            thread_wakeup(waiting_pid);
+        }
+    }
+}
+
+static int pool_start(void)
+{
+    mutex_lock(&pool_mutex);
+    if (!pool_started) {
+        int started = 0;
+        for (int i = 0; i < PTHREAD_POOL_WORKERS; i++) {
+            if (thread_create(pool_stacks[i], PTHREAD_POOL_STACKSIZE,
+                              PTHREAD_POOL_PRIORITY, CREATE_STACKTEST,
+                              pool_worker, "pthread-pool") >= 0) {
+                started++;
+            }
+        }
+        DEBUG("pthread_pool: %d workers\n", started);
+        /* the workers that did start take all routines */
+        pool_started = started > 0;
+    }
+    mutex_unlock(&pool_mutex);
+    return pool_started ? 0 : -1;
+}
+
+int pthread_pool_submit(pthread_future_t *future, void *(*routine)(void *), void *arg)
+{
+    if (!pool_started && pool_start() != 0) {
+        return -1;
+    }
+
+    future->next = NULL;
+    future->routine = routine;
+    future->arg = arg;
+    future->result = NULL;
+    future->done = false;
+    future->waiting_pid = -1;
+
+    unsigned state = disableIRQ();
+    if (pool_tail) {
+        pool_tail->next = future;
+    }
+    else {
+        pool_head = future;
+    }
+    pool_tail = future;
+
+    int idle_pid = pool_idle_count > 0 ? pool_idle[--pool_idle_count] : -1;
+    restoreIRQ(state);
+
+    if (idle_pid >= 0) {
+        thread_wakeup(idle_pid);
+    }
+
+    return 0;
+}
+
+void *pthread_future_get(pthread_future_t *future)
+{
+    while (1) {
+        unsigned state = disableIRQ();
+        if (future->done) {
+            future->waiting_pid = -1;
+            restoreIRQ(state);
+            break;
+        }
+
+        /* the worker wakes us up once the routine returned */
+        future->waiting_pid = thread_pid;
+        sched_set_status((tcb_t *) active_thread, STATUS_SLEEPING);
+        restoreIRQ(state);
+        thread_yield();
+    }
+
+    return future->result;
+}
+
+bool pthread_future_done(const pthread_future_t *future)
+{
+    return future->done;
+}
@@ -28,6 +28,7 @@
  * @}
  */
 
+#include "atomic.h"
 #include "pthread.h"
 #include "sched.h"
 #include "vtimer.h"
@@ -38,16 +39,23 @@
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
+#define READERS (__PTHREAD_RWLOCK_READERS)
+#define WRITER  (__PTHREAD_RWLOCK_WRITER)
+#define WAITERS (__PTHREAD_RWLOCK_WAITERS)
+
 int pthread_rwlock_init(pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr)
 {
-    (void) attr;
-
     if (rwlock == NULL) {
         DEBUG("Thread %u: pthread_rwlock_%s(): rwlock=NULL supplied\n", thread_pid, "init");
         return EINVAL;
     }
 
     memset(rwlock, 0, sizeof (*rwlock));
+
+    if (attr != NULL) {
+        rwlock->kind = attr->kind;
+    }
+
     return 0;
 }
 
@@ -59,65 +67,133 @@ int pthread_rwlock_destroy(pthread_rwlock_t *rwlock)
     }
 
     /* do not unlock the mutex, no need */
-    if ((mutex_trylock(&rwlock->mutex) == 0) || (rwlock->readers != 0)) {
+    if ((mutex_trylock(&rwlock->mutex) == 0) || (rwlock->state != 0)) {
         return EBUSY;
     }
 
     return 0;
 }
 
+static inline bool __pthread_rwlock_is_writer(const queue_node_t *qnode)
+{
+    return ((const __pthread_rwlock_waiter_node_t *) qnode->data)->is_writer;
+}
+
 bool __pthread_rwlock_blocked_readingly(const pthread_rwlock_t *rwlock)
 {
-    if (rwlock->readers < 0) {
+    if (rwlock->state & WRITER) {
         /* a writer holds the lock */
         return true;
     }
 
+    queue_node_t *qnode = rwlock->queue.next;
+
+    switch (rwlock->kind) {
+        case PTHREAD_RWLOCK_PREFER_READER_NP:
+            return false;
+
+        case PTHREAD_RWLOCK_PREFER_WRITER_NP:
+            /* any waiting writer goes first */
+            for (; qnode; qnode = qnode->next) {
+                if (__pthread_rwlock_is_writer(qnode)) {
+                    return true;
+                }
+            }
+
+            return false;
+    }
+
     /* Determine if there is a writer waiting to get this lock who has a higher or the same priority: */
 
-    if (rwlock->queue.next == NULL) {
+    if (qnode == NULL) {
         /* no waiting thread */
         return false;
     }
 
-    queue_node_t *qnode = rwlock->queue.next;
     if (qnode->priority > active_thread->priority) {
         /* the waiting thread has a lower priority */
         return false;
     }
 
     /* if the waiting node is a writer, then we cannot enter the critical section (to prevent starving the writer) */
-    __pthread_rwlock_waiter_node_t *waiting_node = (__pthread_rwlock_waiter_node_t *) qnode->data;
-    return waiting_node->is_writer;
+    return __pthread_rwlock_is_writer(qnode);
 }
 
 bool __pthread_rwlock_blocked_writingly(const pthread_rwlock_t *rwlock)
 {
     /* if any thread holds the lock, then no writer may enter the critical section */
-    return rwlock->readers != 0;
+    return (rwlock->state & (READERS | WRITER)) != 0;
+}
+
+/* takes the lock by one atomic_cas() if no thread waits for it */
+static bool pthread_rwlock_fast_lock(pthread_rwlock_t *rwlock, bool is_writer)
+{
+    unsigned int state = rwlock->state;
+
+    if (is_writer) {
+        return (state == 0) && atomic_cas((unsigned int *) &rwlock->state, 0, WRITER);
+    }
+
+    while (!(state & (WRITER | WAITERS))) {
+        if (atomic_cas((unsigned int *) &rwlock->state, state, state + 1)) {
+            return true;
+        }
+
+        state = rwlock->state;
+    }
+
+    return false;
+}
+
+/* Sets WAITERS, the mutex must be held.  The fast paths then fail, so the
+ * state can be changed by plain stores until pthread_rwlock_slow_leave(). */
+static void pthread_rwlock_slow_enter(pthread_rwlock_t *rwlock)
+{
+    unsigned int state;
+
+    do {
+        state = rwlock->state;
+    } while (!(state & WAITERS)
+             && !atomic_cas((unsigned int *) &rwlock->state, state, state | WAITERS));
+}
+
+/* clears WAITERS if no one waits anymore and releases the mutex */
+static void pthread_rwlock_slow_leave(pthread_rwlock_t *rwlock)
+{
+    unsigned int state = rwlock->state;
+
+    if ((state & WAITERS) && (rwlock->queue.next == NULL)) {
+        rwlock->state = state & ~WAITERS;
+    }
+
+    mutex_unlock(&rwlock->mutex);
 }
 
 static int pthread_rwlock_lock(pthread_rwlock_t *rwlock,
                                bool (*is_blocked)(const pthread_rwlock_t *rwlock),
                                bool is_writer,
-                               int incr_when_held,
-                               bool allow_spurious)
+                               const uint64_t *then)
 {
     if (rwlock == NULL) {
-        DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, allow_spurious=%u %s\n",
-              thread_pid, "lock", is_writer, allow_spurious, "rwlock=NULL");
+        DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, timed=%u %s\n",
+              thread_pid, "lock", is_writer, then != NULL, "rwlock=NULL");
         return EINVAL;
     }
 
+    if (pthread_rwlock_fast_lock(rwlock, is_writer)) {
+        return 0;
+    }
+
     mutex_lock(&rwlock->mutex);
+    pthread_rwlock_slow_enter(rwlock);
     if (!is_blocked(rwlock)) {
-        DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, allow_spurious=%u %s\n",
-              thread_pid, "lock", is_writer, allow_spurious, "is open");
-        rwlock->readers += incr_when_held;
+        DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, timed=%u %s\n",
+              thread_pid, "lock", is_writer, then != NULL, "is open");
+        rwlock->state += is_writer ? WRITER : 1;
     }
     else {
-        DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, allow_spurious=%u %s\n",
-              thread_pid, "lock", is_writer, allow_spurious, "is locked");
+        DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, timed=%u %s\n",
+              thread_pid, "lock", is_writer, then != NULL, "is locked");
 
         /* queue for the lock */
         __pthread_rwlock_waiter_node_t waiting_node = {
@@ -134,110 +210,122 @@ static int pthread_rwlock_lock(pthread_rwlock_t *rwlock,
 
         while (1) {
             /* wait to be unlocked, so this thread can try to acquire the lock again */
-            mutex_unlock_and_sleep(&rwlock->mutex);
+            if (then == NULL) {
+                mutex_unlock_and_sleep(&rwlock->mutex);
+            }
+            else {
+                unsigned long ticks = vtimer_timeout_ticks64(*then);
+
+                if (ticks == 0) {
+                    DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, timed=%u %s\n",
+                          thread_pid, "lock", is_writer, then != NULL, "is timed out");
+                    queue_remove(&rwlock->queue, &waiting_node.qnode);
+                    pthread_rwlock_slow_leave(rwlock);
+                    return ETIMEDOUT;
+                }
+
+                mutex_unlock_and_sleep_timeout(&rwlock->mutex, ticks);
+            }
 
             mutex_lock(&rwlock->mutex);
             if (waiting_node.continue_) {
-                /* pthread_rwlock_unlock() already set rwlock->readers */
-                DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, allow_spurious=%u %s\n",
-                      thread_pid, "lock", is_writer, allow_spurious, "continued");
+                /* pthread_rwlock_unlock() already set rwlock->state */
+                DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, timed=%u %s\n",
+                      thread_pid, "lock", is_writer, then != NULL, "continued");
                 break;
             }
-            else if (allow_spurious) {
-                DEBUG("Thread %u: pthread_rwlock_%s(): is_writer=%u, allow_spurious=%u %s\n",
-                      thread_pid, "lock", is_writer, allow_spurious, "is timed out");
-                queue_remove(&rwlock->queue, &waiting_node.qnode);
-                mutex_unlock(&rwlock->mutex);
-                return ETIMEDOUT;
-            }
         }
     }
-    mutex_unlock(&rwlock->mutex);
+    pthread_rwlock_slow_leave(rwlock);
 
     return 0;
 }
 
 static int pthread_rwlock_trylock(pthread_rwlock_t *rwlock,
                                   bool (*is_blocked)(const pthread_rwlock_t *rwlock),
-                                  int incr_when_held)
+                                  bool is_writer)
 {
     if (rwlock == NULL) {
         DEBUG("Thread %u: pthread_rwlock_%s(): rwlock=NULL supplied\n", thread_pid, "trylock");
         return EINVAL;
     }
+    else if (pthread_rwlock_fast_lock(rwlock, is_writer)) {
+        return 0;
+    }
     else if (mutex_trylock(&rwlock->mutex) == 0) {
         return EBUSY;
     }
-    else if (is_blocked(rwlock)) {
-        mutex_unlock(&rwlock->mutex);
+
+    pthread_rwlock_slow_enter(rwlock);
+    if (is_blocked(rwlock)) {
+        pthread_rwlock_slow_leave(rwlock);
         return EBUSY;
     }
 
-    rwlock->readers += incr_when_held;
+    rwlock->state += is_writer ? WRITER : 1;
 
-    mutex_unlock(&rwlock->mutex);
+    pthread_rwlock_slow_leave(rwlock);
     return 0;
 }
 
 static int pthread_rwlock_timedlock(pthread_rwlock_t *rwlock,
                                     bool (*is_blocked)(const pthread_rwlock_t *rwlock),
                                     bool is_writer,
-                                    int incr_when_held,
                                     const struct timespec *abstime)
 {
-    timex_t now, then;
-
-    then.seconds = abstime->tv_sec;
-    then.microseconds = abstime->tv_nsec / 1000u;
-    timex_normalize(&then);
-
-    vtimer_now(&now);
-
-    if (timex_cmp(then, now) <= 0) {
-        return ETIMEDOUT;
-    }
-    else {
-        timex_t reltime = timex_sub(then, now);
+    uint64_t then;
 
-        vtimer_t timer;
-        vtimer_set_wakeup(&timer, reltime, active_thread->pid);
-        int result = pthread_rwlock_lock(rwlock, is_blocked, is_writer, incr_when_held, true);
-        if (result != ETIMEDOUT) {
-            vtimer_remove(&timer);
-        }
+    then = (uint64_t) abstime->tv_sec * 1000000 + abstime->tv_nsec / 1000u;
 
-        return result;
-    }
+    return pthread_rwlock_lock(rwlock, is_blocked, is_writer, &then);
 }
 
 int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
 {
-    return pthread_rwlock_lock(rwlock, __pthread_rwlock_blocked_readingly, false, +1, false);
+    return pthread_rwlock_lock(rwlock, __pthread_rwlock_blocked_readingly, false, NULL);
 }
 
 int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock)
 {
-    return pthread_rwlock_lock(rwlock, __pthread_rwlock_blocked_writingly, true, -1, false);
+    return pthread_rwlock_lock(rwlock, __pthread_rwlock_blocked_writingly, true, NULL);
 }
 
 int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock)
 {
-    return pthread_rwlock_trylock(rwlock, __pthread_rwlock_blocked_readingly, +1);
+    return pthread_rwlock_trylock(rwlock, __pthread_rwlock_blocked_readingly, false);
 }
 
 int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock)
 {
-    return pthread_rwlock_trylock(rwlock, __pthread_rwlock_blocked_writingly, -1);
+    return pthread_rwlock_trylock(rwlock, __pthread_rwlock_blocked_writingly, true);
 }
 
 int pthread_rwlock_timedrdlock(pthread_rwlock_t *rwlock, const struct timespec *abstime)
 {
-    return pthread_rwlock_timedlock(rwlock, __pthread_rwlock_blocked_readingly, false, +1, abstime);
+    return pthread_rwlock_timedlock(rwlock, __pthread_rwlock_blocked_readingly, false, abstime);
 }
 
 int pthread_rwlock_timedwrlock(pthread_rwlock_t *rwlock, const struct timespec *abstime)
 {
-    return pthread_rwlock_timedlock(rwlock, __pthread_rwlock_blocked_writingly, true, -1, abstime);
+    return pthread_rwlock_timedlock(rwlock, __pthread_rwlock_blocked_writingly, true, abstime);
+}
+
+/* lets the waiting thread of qnode continue, returns its priority */
+static uint16_t pthread_rwlock_continue(pthread_rwlock_t *rwlock, queue_node_t *qnode)
+{
+    __pthread_rwlock_waiter_node_t *waiting_node = (__pthread_rwlock_waiter_node_t *) qnode->data;
+    uint16_t prio = qnode->priority;
+
+    DEBUG("Thread %u: pthread_rwlock_%s(): continue %s %u\n",
+          thread_pid, "unlock", waiting_node->is_writer ? "writer" : "reader",
+          waiting_node->thread->pid);
+
+    queue_remove(&rwlock->queue, qnode);
+    rwlock->state += waiting_node->is_writer ? WRITER : 1;
+    waiting_node->continue_ = true;
+    sched_set_status(waiting_node->thread, STATUS_PENDING);
+
+    return prio;
 }
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock)
@@ -247,72 +335,105 @@ int pthread_rwlock_unlock(pthread_rwlock_t *rwlock)
         return EINVAL;
     }
 
+    /* without waiters one atomic_cas() releases the lock */
+    unsigned int state = rwlock->state;
+    while (!(state & WAITERS)) {
+        if (!(state & (READERS | WRITER))) {
+            break;
+        }
+
+        if (atomic_cas((unsigned int *) &rwlock->state, state,
+                       (state & WRITER) ? 0 : state - 1)) {
+            return 0;
+        }
+
+        state = rwlock->state;
+    }
+
     mutex_lock(&rwlock->mutex);
-    if (rwlock->readers == 0) {
+    pthread_rwlock_slow_enter(rwlock);
+
+    state = rwlock->state;
+    if (!(state & (READERS | WRITER))) {
         /* the lock is open */
         DEBUG("Thread %u: pthread_rwlock_%s(): lock is open\n", thread_pid, "unlock");
-        mutex_unlock(&rwlock->mutex);
+        pthread_rwlock_slow_leave(rwlock);
         return EPERM;
     }
 
-    if (rwlock->readers > 0) {
-        DEBUG("Thread %u: pthread_rwlock_%s(): release %s lock\n", thread_pid, "unlock", "read");
-        --rwlock->readers;
+    if (state & WRITER) {
+        DEBUG("Thread %u: pthread_rwlock_%s(): release %s lock\n", thread_pid, "unlock", "write");
+        state -= WRITER;
     }
     else {
-        DEBUG("Thread %u: pthread_rwlock_%s(): release %s lock\n", thread_pid, "unlock", "write");
-        rwlock->readers = 0;
+        DEBUG("Thread %u: pthread_rwlock_%s(): release %s lock\n", thread_pid, "unlock", "read");
+        --state;
     }
+    rwlock->state = state;
 
-    if (rwlock->readers != 0 || rwlock->queue.next == NULL) {
+    if ((state & READERS) != 0 || rwlock->queue.next == NULL) {
         /* this thread was not the last reader, or no one is waiting to aquire the lock */
         DEBUG("Thread %u: pthread_rwlock_%s(): no one is waiting\n", thread_pid, "unlock");
-        mutex_unlock(&rwlock->mutex);
+        pthread_rwlock_slow_leave(rwlock);
         return 0;
     }
 
-    /* wake up the next thread */
-    queue_node_t *qnode = queue_remove_head(&rwlock->queue);
-    __pthread_rwlock_waiter_node_t *waiting_node = (__pthread_rwlock_waiter_node_t *) qnode->data;
-    waiting_node->continue_ = true;
-    uint16_t prio = qnode->priority;
-    sched_set_status(waiting_node->thread, STATUS_PENDING);
+    /* find out whom to wake up */
+    queue_node_t *first_writer = NULL;
+    bool reader_waits = false;
+    for (queue_node_t *qnode = rwlock->queue.next; qnode; qnode = qnode->next) {
+        if (!__pthread_rwlock_is_writer(qnode)) {
+            reader_waits = true;
+        }
+        else if (first_writer == NULL) {
+            first_writer = qnode;
+        }
+    }
 
-    if (waiting_node->is_writer) {
-        DEBUG("Thread %u: pthread_rwlock_%s(): continue %s %u\n",
-              thread_pid, "unlock", "writer", waiting_node->thread->pid);
-        --rwlock->readers;
+    bool wake_readers;
+    switch (rwlock->kind) {
+        case PTHREAD_RWLOCK_PREFER_READER_NP:
+            wake_readers = reader_waits;
+            break;
+
+        case PTHREAD_RWLOCK_PREFER_WRITER_NP:
+            wake_readers = (first_writer == NULL);
+            break;
+
+        default:
+            wake_readers = !__pthread_rwlock_is_writer(rwlock->queue.next);
+            break;
+    }
+
+    uint16_t prio;
+    if (!wake_readers) {
+        prio = pthread_rwlock_continue(rwlock, first_writer);
     }
     else {
-        DEBUG("Thread %u: pthread_rwlock_%s(): continue %s %u\n",
-              thread_pid, "unlock", "reader", waiting_node->thread->pid);
-        ++rwlock->readers;
-
-        /* wake up further readers */
-        while (rwlock->queue.next) {
-            waiting_node = (__pthread_rwlock_waiter_node_t *) rwlock->queue.next->data;
-            if (waiting_node->is_writer) {
-                /* Not to be unfair to writers, we don't try to wake up readers that came after the first writer. */
-                DEBUG("Thread %u: pthread_rwlock_%s(): continuing readers blocked by writer %u\n",
-                      thread_pid, "unlock", waiting_node->thread->pid);
-                break;
-            }
-            waiting_node->continue_ = true;
-            DEBUG("Thread %u: pthread_rwlock_%s(): continue %s %u\n",
-                  thread_pid, "unlock", "reader", waiting_node->thread->pid);
-
-            /* wake up this reader */
-            qnode = queue_remove_head(&rwlock->queue);
-            if (qnode->priority < prio) {
-                prio = qnode->priority;
+        prio = rwlock->queue.next->priority;
+
+        /* wake up the readers, as a batch */
+        for (queue_node_t *qnode = rwlock->queue.next, *next; qnode; qnode = next) {
+            next = qnode->next;
+
+            if (__pthread_rwlock_is_writer(qnode)) {
+                if (rwlock->kind == PTHREAD_RWLOCK_PREFER_PRIORITY_NP) {
+                    /* Not to be unfair to writers, we don't try to wake up readers that came after the first writer. */
+                    DEBUG("Thread %u: pthread_rwlock_%s(): continuing readers blocked by writer %u\n",
+                          thread_pid, "unlock", ((__pthread_rwlock_waiter_node_t *) qnode->data)->thread->pid);
+                    break;
+                }
+                continue;
             }
-            sched_set_status(waiting_node->thread, STATUS_PENDING);
 
-            ++rwlock->readers;
+            uint16_t reader_prio = pthread_rwlock_continue(rwlock, qnode);
+            if (reader_prio < prio) {
+                prio = reader_prio;
+            }
         }
     }
 
-    mutex_unlock(&rwlock->mutex);
+    pthread_rwlock_slow_leave(rwlock);
 
     /* yield if a woken up thread had a higher priority */
     sched_switch(active_thread->priority, prio);
@@ -72,3 +72,23 @@ int pthread_rwlockattr_setpshared(pthread_rwlockattr_t *attr, int pshared)
     attr->pshared = pshared;
     return 0;
 }
+
+int pthread_rwlockattr_getkind_np(const pthread_rwlockattr_t *attr, int *kind)
+{
+    if (attr == NULL || kind == NULL) {
+        return EINVAL;
+    }
+
+    *kind = attr->kind;
+    return 0;
+}
+
+int pthread_rwlockattr_setkind_np(pthread_rwlockattr_t *attr, int kind)
+{
+    if (attr == NULL || kind < PTHREAD_RWLOCK_PREFER_PRIORITY_NP || kind > PTHREAD_RWLOCK_PREFER_WRITER_NP) {
+        return EINVAL;
+    }
+
+    attr->kind = kind;
+    return 0;
+}
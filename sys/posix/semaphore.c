@@ -22,16 +22,40 @@
 
 #include <inttypes.h>
 
+#include "atomic.h"
 #include "irq.h"
 #include "sched.h"
 #include "tcb.h"
 #include "thread.h"
+#include "timex.h"
+#include "vtimer.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
 #include "semaphore.h"
 
+/* Set in sem->value while threads may wait in sem->queue.  Without it
+ * the value is changed by atomic_cas() only, and sem_post() need not
+ * look at the queue.  It is set and cleared with interrupts disabled,
+ * so the count can then be changed by plain stores. */
+#define SEM_WAITERS     (~(~0u >> 1))
+#define SEM_COUNT(v)    ((v) & ~SEM_WAITERS)
+
+/* takes a unit if one is free, without disabling interrupts */
+static int sem_trydown(sem_t *sem)
+{
+    unsigned value;
+
+    while (SEM_COUNT(value = sem->value) > 0) {
+        if (atomic_cas((unsigned int *) &sem->value, value, value - 1)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int sem_init(sem_t *sem, int pshared, unsigned int value)
 {
     (void) pshared;  /* nothing to do */
@@ -39,16 +63,14 @@ int sem_init(sem_t *sem, int pshared, unsigned int value)
     sem->value = value;
 
     /* waiters for the mutex */
-    sem->queue.priority = 0;
-    sem->queue.data = 0;
-    sem->queue.next = NULL;
+    pheap_init(&sem->queue);
 
     return 0;
 }
 
 int sem_destroy(sem_t *sem)
 {
-    if (sem->queue.next) {
+    if (pheap_head(&sem->queue)) {
         DEBUG("%s: tried to destroy active semaphore.\n", active_thread->name);
         return -1;
     }
@@ -74,35 +96,48 @@ int sem_unlink(const char *name)
     return -1;
 }
 
-static void sem_thread_blocked(sem_t *sem)
+/* blocks at most *ticks* if not 0, returns 0 on timeout */
+static int sem_thread_blocked(sem_t *sem, unsigned long ticks)
 {
     /* I'm going blocked */
     sched_set_status((tcb_t*) active_thread, STATUS_MUTEX_BLOCKED);
 
-    queue_node_t n;
+    pheap_node_t n;
     n.priority = (uint32_t) active_thread->priority;
     n.data = (size_t) active_thread;
-    n.next = NULL;
 
     DEBUG("%s: Adding node to mutex queue: prio: %" PRIu32 "\n",
           active_thread->name, n.priority);
 
     /* add myself to the waiters queue */
-    queue_priority_add(&sem->queue, &n);
+    pheap_add(&sem->queue, &n);
+
+    if (ticks) {
+        active_thread->wait_data = (void *) &n;
+        thread_timeout_arm(ticks);
+    }
 
     /* scheduler should schedule an other thread, that unlocks the
      * mutex in the future, when this happens I get scheduled again
      */
     thread_yield();
+
+    /* the timeout removed the node from the queue */
+    return !(ticks && thread_timeout_disarm());
 }
 
 int sem_wait(sem_t *sem)
 {
+    if (sem_trydown(sem)) {
+        return 1;
+    }
+
     int old_state = disableIRQ();
     while (1) {
         unsigned value = sem->value;
-        if (value == 0) {
-            sem_thread_blocked(sem);
+        if (SEM_COUNT(value) == 0) {
+            sem->value = value | SEM_WAITERS;
+            sem_thread_blocked(sem, 0);
             continue;
         }
         else {
@@ -116,35 +151,68 @@ int sem_wait(sem_t *sem)
 
 int sem_timedwait(sem_t *sem, const struct timespec *abstime)
 {
-    (void) sem; /* timedwait currently not supported */
-    (void) abstime;
-    return -1; /* signal problem */
-}
+    uint64_t then;
+    unsigned long ticks;
+    int result = -1;
+
+    if (sem_trydown(sem)) {
+        return 0;
+    }
+
+    then = (uint64_t) abstime->tv_sec * 1000000 + abstime->tv_nsec / 1000u;
 
-int sem_trywait(sem_t *sem)
-{
     int old_state = disableIRQ();
-    int result;
+    while (1) {
+        unsigned value = sem->value;
+        if (SEM_COUNT(value) > 0) {
+            sem->value = value - 1;
+            result = 0;
+            break;
+        }
 
-    unsigned value = sem->value;
-    if (value == 0) {
-        result = -1;
-    }
-    else {
-        result = 0;
-        sem->value = value - 1;
-    }
+        restoreIRQ(old_state);
+        ticks = vtimer_timeout_ticks64(then);
+        old_state = disableIRQ();
 
+        if (ticks == 0) {
+            DEBUG("%s: sem_timedwait timed out\n", active_thread->name);
+            break;
+        }
+
+        if (SEM_COUNT(sem->value) == 0) {
+            sem->value |= SEM_WAITERS;
+            sem_thread_blocked(sem, ticks);
+        }
+    }
     restoreIRQ(old_state);
     return result;
 }
 
+int sem_trywait(sem_t *sem)
+{
+    return sem_trydown(sem) ? 0 : -1;
+}
+
 int sem_post(sem_t *sem)
 {
+    unsigned value;
+
+    while (!((value = sem->value) & SEM_WAITERS)) {
+        if (atomic_cas((unsigned int *) &sem->value, value, value + 1)) {
+            return 1;
+        }
+    }
+
     int old_state = disableIRQ();
-    ++sem->value;
+    value = sem->value + 1;
+
+    pheap_node_t *next = pheap_remove_head(&sem->queue);
+    if (!pheap_head(&sem->queue)) {
+        /* timeouts may have emptied the queue before */
+        value &= ~SEM_WAITERS;
+    }
+    sem->value = value;
 
-    queue_node_t *next = queue_remove_head(&sem->queue);
     if (next) {
         tcb_t *next_process = (tcb_t*) next->data;
         DEBUG("%s: waking up %s\n", active_thread->name, next_process->name);
@@ -158,6 +226,6 @@ int sem_post(sem_t *sem)
 
 int sem_getvalue(sem_t *sem, int *sval)
 {
-    *sval = sem->value;
+    *sval = SEM_COUNT(sem->value);
     return 0;
 }
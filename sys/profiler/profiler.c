@@ -0,0 +1,136 @@
+/**
+ * Statistical sampling profiler
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_profiler
+ * @{
+ * @file    profiler.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "irq.h"
+#include "sched.h"
+#include "tcb.h"
+#include "profiler.h"
+
+#if (PROFILER_GRANULARITY & (PROFILER_GRANULARITY - 1))
+#error "PROFILER_GRANULARITY must be a power of two"
+#endif
+
+/* pid of the samples taken before the first thread ran */
+#define PROFILER_NO_THREAD  (MAXTHREADS)
+
+/* slots looked at for a bucket before the sample counts as missed */
+#define PROBES          (16)
+
+static unsigned long buckets[PROFILER_SLOTS];
+static unsigned long counts[PROFILER_SLOTS];    /* 0: slot unused */
+static uint8_t pids[PROFILER_SLOTS];            /* thread of the bucket */
+static unsigned long thread_samples[MAXTHREADS];
+static unsigned long samples;
+static unsigned long missed;
+static unsigned long interval;
+static volatile int running;
+
+void profiler_sample(unsigned long pc)
+{
+    unsigned long bucket = pc & ~(unsigned long)(PROFILER_GRANULARITY - 1);
+    uint8_t pid = active_thread ? active_thread->pid : PROFILER_NO_THREAD;
+    unsigned int slot = (bucket / PROFILER_GRANULARITY + pid) % PROFILER_SLOTS;
+
+    if (!running) {
+        return;
+    }
+
+    samples++;
+
+    if (active_thread) {
+        thread_samples[pid]++;
+    }
+
+    for (int i = 0; i < PROBES; i++) {
+        if (counts[slot] == 0) {
+            buckets[slot] = bucket;
+            pids[slot] = pid;
+        }
+
+        if ((buckets[slot] == bucket) && (pids[slot] == pid)) {
+            counts[slot]++;
+            return;
+        }
+
+        if (++slot == PROFILER_SLOTS) {
+            slot = 0;
+        }
+    }
+
+    missed++;
+}
+
+int profiler_start(unsigned long interval_us)
+{
+    if (profiler_arch_start(interval_us) < 0) {
+        return -1;
+    }
+
+    interval = interval_us;
+    running = 1;
+    return 0;
+}
+
+void profiler_stop(void)
+{
+    running = 0;
+    profiler_arch_stop();
+}
+
+void profiler_clear(void)
+{
+    unsigned int state = disableIRQ();
+
+    memset(counts, 0, sizeof(counts));
+    memset(thread_samples, 0, sizeof(thread_samples));
+    samples = 0;
+    missed = 0;
+
+    restoreIRQ(state);
+}
+
+void profiler_dump(void)
+{
+    int was_running = running;
+
+    /* the timer keeps running, its samples are dropped meanwhile */
+    running = 0;
+
+    printf("PROF begin interval_us=%lu samples=%lu missed=%lu granularity=%u\n",
+           interval, samples, missed, PROFILER_GRANULARITY);
+
+    for (int pid = 0; pid < MAXTHREADS; pid++) {
+        if (thread_samples[pid]) {
+            printf("PROF thread %d %s %lu\n", pid,
+                   sched_threads[pid] ? sched_threads[pid]->name : "-",
+                   thread_samples[pid]);
+        }
+    }
+
+    for (int i = 0; i < PROFILER_SLOTS; i++) {
+        if (counts[i]) {
+            printf("PROF pc %08lx %lu %u\n", buckets[i], counts[i], pids[i]);
+        }
+    }
+
+    puts("PROF end");
+    running = was_running;
+}
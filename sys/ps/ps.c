@@ -31,7 +31,10 @@ const char *state_names[] = {
     [STATUS_MUTEX_BLOCKED] = "bl mutex",
     [STATUS_RECEIVE_BLOCKED] = "bl rx",
     [STATUS_SEND_BLOCKED] = "bl send",
-    [STATUS_REPLY_BLOCKED] = "bl reply"
+    [STATUS_REPLY_BLOCKED] = "bl reply",
+    [STATUS_TIMER_WAITING] = "bl timer",
+    [STATUS_FLAGS_BLOCKED_ANY] = "bl flags",
+    [STATUS_FLAGS_BLOCKED_ALL] = "bl flags"
 };
 
 /**
@@ -70,3 +73,43 @@ void thread_print_all(void)
 
     printf("\t%5s %-21s|%13s%6s %5i\n", "|", "SUM", "|", "|", overall_stacksz);
 }
+
+#if SCHEDSTATISTICS
+/**
+ * @brief Prints wakeup latencies per thread and run queue statistics per
+ *        priority level to stdout.
+ */
+void sched_print_stats(void)
+{
+    unsigned long now = hwtimer_now();
+
+    printf("\tpid | %-21s| wakeups | lat avg | lat max (ticks)\n", "name");
+
+    for (int i = 0; i < MAXTHREADS; i++) {
+        tcb_t *p = (tcb_t *)sched_threads[i];
+
+        if (p != NULL) {
+            unsigned long avg = 0;
+
+            if (pidlist[i].wakeups) {
+                avg = pidlist[i].latency_sum_ticks / pidlist[i].wakeups;
+            }
+
+            printf("\t%3u | %-21s| %7u | %7lu | %7lu\n", p->pid, p->name,
+                   pidlist[i].wakeups, avg, pidlist[i].latency_max_ticks);
+        }
+    }
+
+    printf("\n\tpri | runtime | max rq depth\n");
+
+    for (int i = 0; i < SCHED_PRIO_LEVELS; i++) {
+        if (sched_prio_runtime_ticks[i] || sched_runqueue_depth_max[i]) {
+            printf("\t%3i | %6.3f%% | %5u\n", i,
+                   sched_prio_runtime_ticks[i] / (double) now * 100,
+                   sched_runqueue_depth_max[i]);
+        }
+    }
+
+    printf("\n\tisr | %6.3f%%\n", sched_isr_ticks / (double) now * 100);
+}
+#endif
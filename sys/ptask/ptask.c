@@ -0,0 +1,286 @@
+/**
+ * Stackless tasks
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_ptask
+ * @{
+ * @file    ptask.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "irq.h"
+#include "msg.h"
+#include "thread.h"
+#include "vtimer.h"
+#include "ptask.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+/* started tasks, in the order they run */
+static ptask_t *tasks;
+static volatile int runner = -1;
+static msg_t queue[PTASK_MSG_QUEUE_SIZE];
+
+/* makes the runner look at the tasks again */
+static void ptask_notify(void)
+{
+    msg_t m;
+
+    if ((runner < 0) || (runner == thread_getpid())) {
+        return;
+    }
+
+    /* a full queue is fine, the runner looks at all tasks anyway */
+    m.type = PTASK_MSG_WAKE;
+    msg_send(&m, runner, false);
+}
+
+void ptask_init(ptask_t *t, ptask_fn_t fn, void *arg)
+{
+    memset(t, 0, sizeof(*t));
+    t->fn = fn;
+    t->arg = arg;
+}
+
+int ptask_start(ptask_t *t)
+{
+    unsigned state = disableIRQ();
+    ptask_t **p = &tasks;
+
+    if (t->started) {
+        restoreIRQ(state);
+        return -1;
+    }
+
+    while (*p) {
+        p = &(*p)->next;
+    }
+
+    t->next = NULL;
+    t->lc = 0;
+    t->wait = 0;
+    t->event = 0;
+    t->woken = 0;
+    t->started = 1;
+    *p = t;
+
+    restoreIRQ(state);
+
+    ptask_notify();
+    return 0;
+}
+
+int ptask_getpid(void)
+{
+    return runner;
+}
+
+void ptask_wake(ptask_t *t)
+{
+    t->woken = 1;
+    ptask_notify();
+}
+
+void ptask_wait_msg(ptask_t *t, uint16_t type)
+{
+    t->msg_type = type;
+    t->wait |= PTASK_EV_MSG;
+}
+
+void ptask_wait_timeout(ptask_t *t, uint32_t us)
+{
+    t->deadline = vtimer_now64() + us;
+    t->wait |= PTASK_EV_TIMEOUT;
+    vtimer_set_msg(&t->timer, timex_from_uint64(us), thread_getpid(), t);
+}
+
+void ptask_wait_cond(ptask_t *t)
+{
+    t->wait |= PTASK_EV_COND;
+}
+
+#ifdef MODULE_DESTINY
+void ptask_wait_socket(ptask_t *t, int s, uint8_t events)
+{
+    t->poll.fd = s;
+    t->poll.events = events;
+    t->poll.revents = 0;
+    t->wait |= PTASK_EV_SOCKET;
+}
+#endif
+
+/* hands a message to the task waiting for it */
+static void ptask_dispatch(msg_t *m)
+{
+    ptask_t *t;
+
+    if (m->type == PTASK_MSG_WAKE) {
+        return;
+    }
+
+    if (m->type == MSG_TIMER) {
+        for (t = tasks; t; t = t->next) {
+            if ((char *) t != m->content.ptr) {
+                continue;
+            }
+
+            /* the timer of an earlier wait may have fired already */
+            if ((t->wait & PTASK_EV_TIMEOUT) &&
+                (vtimer_now64() >= t->deadline)) {
+                t->event |= PTASK_EV_TIMEOUT;
+            }
+
+            return;
+        }
+    }
+
+#ifdef MODULE_DESTINY
+
+    if (destiny_socket_handle_msg(m)) {
+        return;
+    }
+
+#endif
+
+    for (t = tasks; t; t = t->next) {
+        if ((t->wait & PTASK_EV_MSG) && !(t->event & PTASK_EV_MSG) &&
+            ((t->msg_type == PTASK_MSG_ANY) || (t->msg_type == m->type))) {
+            t->msg = *m;
+            t->event |= PTASK_EV_MSG;
+            return;
+        }
+    }
+
+    DEBUG("ptask: no task for message type %u\n", m->type);
+}
+
+/* sets the events of the waiting tasks that came in without a message,
+ * returns the number of tasks to run */
+static int ptask_collect(int progress)
+{
+    int runnable = 0;
+
+    for (ptask_t *t = tasks; t; t = t->next) {
+        if (t->wait == 0) {
+            runnable++;
+            continue;
+        }
+
+        if (t->woken) {
+            t->woken = 0;
+            t->event |= PTASK_EV_WAKE;
+        }
+
+        if (progress && (t->wait & PTASK_EV_COND)) {
+            t->event |= PTASK_EV_COND;
+        }
+
+#ifdef MODULE_DESTINY
+
+        if ((t->wait & PTASK_EV_SOCKET) &&
+            (destiny_socket_poll(&t->poll, 1, 0) > 0)) {
+            t->event |= PTASK_EV_SOCKET;
+        }
+
+#endif
+
+        if (t->event) {
+            runnable++;
+        }
+    }
+
+    return runnable;
+}
+
+/* runs every task that can, returns whether one of them got on */
+static int ptask_round(void)
+{
+    int progress = 0;
+    ptask_t *t = tasks;
+
+    while (t) {
+        ptask_t *next = t->next;
+        uint16_t lc = t->lc;
+        uint8_t event = t->event;
+        int res;
+
+        if ((t->wait != 0) && (event == 0)) {
+            t = next;
+            continue;
+        }
+
+        /* the other waits are off, the task arms its next ones */
+        if ((t->wait & PTASK_EV_TIMEOUT) && !(event & PTASK_EV_TIMEOUT)) {
+            vtimer_remove(&t->timer);
+        }
+
+        t->wait = 0;
+        res = t->fn(t);
+        t->event = 0;
+
+        /* only a condition tested again in vain is no progress */
+        if ((res != PTASK_WAITING) || (lc != t->lc) ||
+            (event != PTASK_EV_COND) || (t->wait != PTASK_EV_COND)) {
+            progress = 1;
+        }
+
+        if (res == PTASK_EXITED) {
+            unsigned state = disableIRQ();
+            ptask_t **p = &tasks;
+
+            if (t->wait & PTASK_EV_TIMEOUT) {
+                vtimer_remove(&t->timer);
+            }
+
+            while (*p != t) {
+                p = &(*p)->next;
+            }
+
+            *p = t->next;
+            t->wait = 0;
+            t->started = 0;
+            restoreIRQ(state);
+            DEBUG("ptask: %p exited\n", (void *) t);
+        }
+
+        t = next;
+    }
+
+    return progress;
+}
+
+void ptask_run(void)
+{
+    msg_t m;
+    int progress = 1;
+
+    msg_init_queue(queue, PTASK_MSG_QUEUE_SIZE);
+    runner = thread_getpid();
+
+    while (1) {
+        /* messages first, yielding tasks must not starve them */
+        while (msg_try_receive(&m) >= 0) {
+            ptask_dispatch(&m);
+            progress = 1;
+        }
+
+        if (ptask_collect(progress) == 0) {
+            msg_receive(&m);
+            ptask_dispatch(&m);
+            progress = 1;
+            continue;
+        }
+
+        progress = ptask_round();
+    }
+}
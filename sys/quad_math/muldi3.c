@@ -190,6 +190,10 @@ quad_t __muldi3(quad_t a, quad_t b)
  */
 static quad_t __lmulq(u_int u, u_int v)
 {
+#if defined(__arm__)
+    /* ARM multiplies u_int * u_int => quad in hardware (UMULL) */
+    return (u_quad_t) u * v;
+#else
     u_int u1, u0, v1, v0, udiff, vdiff, high, mid, low;
     u_int prodh, prodl, was;
     union uu prod;
@@ -255,4 +259,5 @@ static quad_t __lmulq(u_int u, u_int v)
     prod.ul[H] = prodh;
     prod.ul[L] = prodl;
     return prod.q;
+#endif
 }
@@ -95,6 +95,23 @@ __qdivrem(u_quad_t uq, u_quad_t vq, u_quad_t *arq)
         return 0;
     }
 
+    tmp.uq = uq;
+
+    if (tmp.ul[H] == 0) {
+        /*
+         * Both fit into an u_int (v <= u), as the time stamps of the
+         * timers mostly do.  One native division does it.
+         */
+        union uu vv;
+        vv.uq = vq;
+
+        if (arq) {
+            *arq = tmp.ul[L] % vv.ul[L];
+        }
+
+        return tmp.ul[L] / vv.ul[L];
+    }
+
     u = &uspace[0];
     v = &vspace[0];
     q = &qspace[0];
@@ -112,7 +129,6 @@ __qdivrem(u_quad_t uq, u_quad_t vq, u_quad_t *arq)
      * and thus
      *  m = 4 - n <= 2
      */
-    tmp.uq = uq;
     u[0] = 0;
     u[1] = (digit) HHALF(tmp.ul[H]);
     u[2] = (digit) LHALF(tmp.ul[H]);
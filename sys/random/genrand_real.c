@@ -0,0 +1,40 @@
+/*
+ * Floating point random numbers on top of genrand_uint32(), for every
+ * backend of the random module.  Taken from the MT19937 reference code,
+ * see mersenne.c for its license.  The real versions are due to Isaku
+ * Wada, 2002/01/09.
+ */
+
+#include "random.h"
+
+#if PRNG_FLOAT
+
+#define TWO_POW_6 64.0
+#define TWO_POW_26 67108864.0
+#define TWO_POW_32_M1 4294967295.0
+#define TWO_POW_32 4294967296.0
+#define TWO_POW_53 9007199254740992.0
+
+double genrand_real(void)
+{
+    return genrand_uint32() * (1.0 / TWO_POW_32);
+}
+
+double genrand_real_inclusive(void)
+{
+    return genrand_uint32() * (1.0 / TWO_POW_32_M1);
+}
+
+double genrand_real_exclusive(void)
+{
+    return ((double) genrand_uint32() + 0.5) * (1.0 / TWO_POW_32);
+}
+
+double genrand_res53(void)
+{
+    double a = genrand_uint32() * TWO_POW_26;
+    double b = genrand_uint32() * (1.0 / TWO_POW_6);
+    return (a + b) * (1.0 / TWO_POW_53);
+}
+
+#endif /* PRNG_FLOAT */
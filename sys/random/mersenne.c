@@ -118,6 +118,16 @@ static void generate_numbers(void)
     mti = 0;
 }
 
+void genrand_add_entropy(uint32_t sample)
+{
+    if (mti >= N) {
+        generate_numbers();
+    }
+
+    /* the next word handed out depends on the sample */
+    mt[mti] ^= sample;
+}
+
 uint32_t genrand_uint32(void)
 {
     if (mti >= N) {
@@ -131,35 +141,3 @@ uint32_t genrand_uint32(void)
     y ^= y >> 18;
     return y;
 }
-
-#if PRNG_FLOAT
-
-#define TWO_POW_6 64.0
-#define TWO_POW_26 67108864.0
-#define TWO_POW_32_M1 4294967295.0
-#define TWO_POW_32 4294967296.0
-#define TWO_POW_53 9007199254740992.0
-
-double genrand_real(void)
-{
-    return genrand_uint32() * (1.0 / TWO_POW_32);
-}
-
-double genrand_real_inclusive(void)
-{
-    return genrand_uint32() * (1.0 / TWO_POW_32_M1);
-}
-
-double genrand_real_exclusive(void)
-{
-    return ((double) genrand_uint32() + 0.5) * (1.0 / TWO_POW_32);
-}
-
-double genrand_res53(void)
-{
-    double a = genrand_uint32() * TWO_POW_26;
-    double b = genrand_uint32() * (1.0 / TWO_POW_6);
-    return (a + b) * (1.0 / TWO_POW_53);
-}
-
-#endif /* PRNG_FLOAT */
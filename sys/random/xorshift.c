@@ -0,0 +1,91 @@
+/**
+ * xoshiro128** random number generator
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_random
+ * @{
+ * @file    xorshift.c
+ * @brief   Small state backend of the random module, select it with
+ *          `USEMODULE += random_xorshift`
+ *
+ * The generator by David Blackman and Sebastiano Vigna keeps 16 bytes of
+ * state and takes a constant handful of shifts and xors per number, while
+ * MT19937 needs 2.5 KB and regenerates all of it every 624 numbers.
+ * @}
+ */
+
+#include "random.h"
+
+static uint32_t s[4];
+
+static inline uint32_t rotl(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+/* splitmix32, spreads a seed over the state words */
+static uint32_t splitmix(uint32_t *x)
+{
+    uint32_t z = (*x += 0x9e3779b9UL);
+    z = (z ^ (z >> 16)) * 0x85ebca6bUL;
+    z = (z ^ (z >> 13)) * 0xc2b2ae35UL;
+    return z ^ (z >> 16);
+}
+
+static void next(void)
+{
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+}
+
+void genrand_init(uint32_t seed)
+{
+    for (int i = 0; i < 4; ++i) {
+        s[i] = splitmix(&seed);
+    }
+}
+
+void genrand_init_by_array(uint32_t init_key[], int key_length)
+{
+    genrand_init(19650218UL);
+
+    for (int i = 0; i < key_length; ++i) {
+        genrand_add_entropy(init_key[i]);
+    }
+}
+
+void genrand_add_entropy(uint32_t sample)
+{
+    s[0] ^= sample;
+
+    if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+        /* the all zero state would only yield zeros */
+        genrand_init(sample);
+    }
+
+    next();
+}
+
+uint32_t genrand_uint32(void)
+{
+    if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+        /* if genrand_init() has not been called, a default initial seed is used */
+        genrand_init(5489UL);
+    }
+
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+
+    next();
+    return result;
+}
@@ -0,0 +1,247 @@
+/**
+ * Scheduled sensor sampling with batching and decimation
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_sampler
+ * @{
+ * @file    sampler.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kernel.h"
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "timex.h"
+#include "vtimer.h"
+#include "sampler.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define SAMPLER_MSG_QUEUE_SIZE  (4)
+
+static char sampler_stack[SAMPLER_STACKSIZE];
+static msg_t sampler_msg_queue[SAMPLER_MSG_QUEUE_SIZE];
+static int sampler_pid = -1;
+
+/* guards the sources, held while they are read */
+static mutex_t sampler_mutex;
+static sampler_source_t *sources;
+/* all periods count from here */
+static uint64_t epoch;
+
+/* hands the record over and starts the next one, with sampler_mutex held */
+static void deliver(sampler_source_t *s)
+{
+    s->deliver(&s->record, s->deliver_arg);
+    s->record.count = 0;
+}
+
+static void store(sampler_source_t *s, int32_t value, uint64_t now)
+{
+    if (s->record.count == 0) {
+        s->record.time = (uint32_t)(now / 1000);
+    }
+
+    s->record.values[s->record.count++] = value;
+
+    if (s->record.count == SAMPLER_BATCH) {
+        deliver(s);
+    }
+}
+
+static void sample(sampler_source_t *s, uint64_t now)
+{
+    int32_t value;
+
+    if (s->read(s->read_arg, &value) < 0) {
+        DEBUG("sampler: no reading of %u\n", s->record.id);
+        return;
+    }
+
+    if (s->readings == 0) {
+        s->acc = value;
+    }
+    else {
+        switch (s->reduce) {
+            case SAMPLER_AVG:
+                s->acc += value;
+                break;
+
+            case SAMPLER_MIN:
+                if (value < s->acc) {
+                    s->acc = value;
+                }
+
+                break;
+
+            case SAMPLER_MAX:
+                if (value > s->acc) {
+                    s->acc = value;
+                }
+
+                break;
+
+            default:
+                s->acc = value;
+                break;
+        }
+    }
+
+    if (++s->readings < s->decimate) {
+        return;
+    }
+
+    if (s->reduce == SAMPLER_AVG) {
+        s->acc /= s->readings;
+    }
+
+    s->readings = 0;
+    store(s, (int32_t) s->acc, now);
+}
+
+static void sampler_thread(void)
+{
+    msg_t m;
+
+    msg_init_queue(sampler_msg_queue, SAMPLER_MSG_QUEUE_SIZE);
+
+    while (1) {
+        uint64_t now, next = 0;
+
+        mutex_lock(&sampler_mutex);
+        now = vtimer_now64();
+
+        for (sampler_source_t *s = sources; s; s = s->next) {
+            if (s->due <= now + SAMPLER_SLACK) {
+                sample(s, now);
+
+                /* readings that were missed are skipped */
+                do {
+                    s->due += s->period;
+                } while (s->due <= now);
+            }
+
+            if ((next == 0) || (s->due < next)) {
+                next = s->due;
+            }
+        }
+
+        mutex_unlock(&sampler_mutex);
+
+        if (next == 0) {
+            msg_receive(&m);
+        }
+        else {
+            /* the time taken by the reads is in there as well */
+            now = vtimer_now64();
+
+            if (next > now) {
+                vtimer_msg_receive_timeout(&m, timex_from_uint64(next - now));
+            }
+        }
+    }
+}
+
+int sampler_init(void)
+{
+    if (sampler_pid >= 0) {
+        return sampler_pid;
+    }
+
+    mutex_init(&sampler_mutex);
+    epoch = vtimer_now64();
+    sampler_pid = thread_create(sampler_stack, SAMPLER_STACKSIZE,
+                                SAMPLER_PRIORITY, CREATE_STACKTEST,
+                                sampler_thread, "sampler");
+
+    return sampler_pid;
+}
+
+void sampler_source_init(sampler_source_t *source, uint8_t id,
+                         sampler_read_t read, void *read_arg,
+                         uint32_t period, uint8_t decimate,
+                         sampler_reduce_t reduce, sampler_deliver_t deliver,
+                         void *deliver_arg)
+{
+    source->next = NULL;
+    source->read = read;
+    source->read_arg = read_arg;
+    source->deliver = deliver;
+    source->deliver_arg = deliver_arg;
+    source->period = period;
+    source->due = 0;
+    source->decimate = decimate ? decimate : 1;
+    source->reduce = reduce;
+    source->readings = 0;
+    source->acc = 0;
+    source->record.id = id;
+    source->record.count = 0;
+    source->record.time = 0;
+    source->record.period = period * source->decimate;
+}
+
+int sampler_add(sampler_source_t *source)
+{
+    msg_t m;
+    uint64_t now;
+
+    mutex_lock(&sampler_mutex);
+
+    for (sampler_source_t *s = sources; s; s = s->next) {
+        if (s == source) {
+            mutex_unlock(&sampler_mutex);
+            return -1;
+        }
+    }
+
+    now = vtimer_now64();
+    source->due = epoch + ((now - epoch) / source->period + 1) * source->period;
+    source->readings = 0;
+    source->record.count = 0;
+    source->next = sources;
+    sources = source;
+
+    mutex_unlock(&sampler_mutex);
+
+    /* the thread may sleep past the new source */
+    m.type = 0;
+    msg_send(&m, sampler_pid, 0);
+    return 0;
+}
+
+int sampler_remove(sampler_source_t *source)
+{
+    int res = -1;
+
+    mutex_lock(&sampler_mutex);
+
+    for (sampler_source_t **p = &sources; *p; p = &(*p)->next) {
+        if (*p == source) {
+            *p = source->next;
+            source->next = NULL;
+            res = 0;
+            break;
+        }
+    }
+
+    mutex_unlock(&sampler_mutex);
+    return res;
+}
+
+void sampler_flush(sampler_source_t *source)
+{
+    mutex_lock(&sampler_mutex);
+    deliver(source);
+    mutex_unlock(&sampler_mutex);
+}
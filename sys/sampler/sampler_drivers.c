@@ -0,0 +1,92 @@
+/**
+ * Sampler adapters for the sensor drivers
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_sampler
+ * @{
+ * @file    sampler_drivers.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "sampler.h"
+
+#ifdef MODULE_SHT11
+#include "sht11.h"
+
+int sampler_sht11_temperature(void *arg, int32_t *value)
+{
+    sht11_val_t val;
+
+    (void) arg;
+
+    if (!sht11_read_sensor(&val, TEMPERATURE)) {
+        return -1;
+    }
+
+    *value = (int32_t)(val.temperature * 100);
+    return 0;
+}
+
+int sampler_sht11_humidity(void *arg, int32_t *value)
+{
+    sht11_val_t val;
+
+    (void) arg;
+
+    /* the compensation needs the temperature */
+    if (!sht11_read_sensor(&val, TEMPERATURE | HUMIDITY)) {
+        return -1;
+    }
+
+    *value = (int32_t)(val.relhum_temp * 100);
+    return 0;
+}
+#endif
+
+#ifdef MODULE_LTC4150
+#include "vtimer.h"
+#include "ltc4150.h"
+#include "ltc4150_arch.h"
+
+int sampler_ltc4150_current(void *arg, int32_t *value)
+{
+    static long last_count = -1;
+    static uint64_t last_time;
+    long count = ltc4150_get_intcount();
+    uint64_t now = vtimer_now64();
+    int res = -1;
+
+    (void) arg;
+
+    if ((last_count >= 0) && (now > last_time)) {
+        /* C per interrupt over s, scaled to uA and us */
+        *value = (int32_t)(((double)(count - last_count) * 1e12) /
+                           (_GFH * _R_SENSE * (double)(now - last_time)));
+        res = 0;
+    }
+
+    last_count = count;
+    last_time = now;
+    return res;
+}
+#endif
+
+#ifdef MODULE_LM75A
+#include "lm75a-temp-sensor.h"
+
+int sampler_lm75a_temperature(void *arg, int32_t *value)
+{
+    (void) arg;
+
+    *value = (int32_t)(lm75A_get_ambient_temperature() * 100);
+    return 0;
+}
+#endif
@@ -0,0 +1,157 @@
+/**
+ * Shell commands for the block ciphers
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_cipher.c
+ * @brief   measures the block ciphers of the build and suggests their ranks
+ *          for cipher_select.h
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "crypto/cipher_select.h"
+
+#define CIPHER_BENCH_BLOCKS (100)
+
+static const struct {
+    block_cipher_interface_t *cipher;
+    const char *name;               /* as in CIPHER_RANK_<name> */
+    uint16_t key_bits;
+    uint8_t rank;
+} ciphers[] = {
+#ifdef MODULE_CRYPTO_AES
+    { &aes_interface, "AES", CIPHER_KEY_BITS_AES, CIPHER_RANK_AES },
+#endif
+#ifdef MODULE_CRYPTO_TWOFISH
+    { &twofish_interface, "TWOFISH", CIPHER_KEY_BITS_TWOFISH,
+      CIPHER_RANK_TWOFISH },
+#endif
+#ifdef MODULE_CRYPTO_RC5
+    { &rc5_interface, "RC5", CIPHER_KEY_BITS_RC5, CIPHER_RANK_RC5 },
+#endif
+#ifdef MODULE_CRYPTO_SKIPJACK
+    { &skipjack_interface, "SKIPJACK", CIPHER_KEY_BITS_SKIPJACK,
+      CIPHER_RANK_SKIPJACK },
+#endif
+#ifdef MODULE_CRYPTO_3DES
+    { &tripledes_interface, "THREEDES", CIPHER_KEY_BITS_THREEDES,
+      CIPHER_RANK_THREEDES },
+#endif
+};
+
+#define CIPHER_COUNT    (sizeof(ciphers) / sizeof(ciphers[0]))
+
+/* ns per block of *blocks* blocks taking *ticks* */
+static unsigned long ns_per_block(unsigned long ticks, int blocks)
+{
+    return (unsigned long) ((unsigned long long) ticks * 1000000000ull /
+                            HWTIMER_SPEED / blocks);
+}
+
+void _cipher_bench_handler(int argc, char **argv)
+{
+    static uint8_t key[2][32];
+    uint8_t block[16];
+    unsigned long enc_ns[CIPHER_COUNT];
+    int blocks = CIPHER_BENCH_BLOCKS;
+
+    if (argc > 1) {
+        blocks = atoi(argv[1]);
+    }
+
+    if (blocks <= 0) {
+        printf("usage: %s [blocks]\n", argv[0]);
+        return;
+    }
+
+    memset(key[0], 0x2b, sizeof(key[0]));
+    memset(key[1], 0x7e, sizeof(key[1]));
+    printf("context %u bytes, policy %u bit keys\n",
+           (unsigned int) sizeof(cipher_context_t), CIPHERS_MIN_KEY_BITS);
+    printf("%-9s %4s %4s %10s %10s %10s\n", "cipher", "bits", "rank",
+           "setup ns", "enc ns/blk", "dec ns/blk");
+
+    for (unsigned int c = 0; c < CIPHER_COUNT; c++) {
+        block_cipher_interface_t *bc = ciphers[c].cipher;
+        cipher_context_t ctx;
+        unsigned long start, enc, dec, setup;
+        int i;
+
+        memset(block, 0, sizeof(block));
+        enc_ns[c] = 0;
+
+        if (bc->BlockCipher_init(&ctx, bc->BlockCipherInfo_getPreferredBlockSize(),
+                                 16, key[0]) <= 0 ||
+            bc->BlockCipher_encrypt(&ctx, block, block) <= 0) {
+            printf("%-9s failed\n", ciphers[c].name);
+            continue;
+        }
+
+        /* the key schedule is cached by then */
+        start = hwtimer_now();
+
+        for (i = 0; i < blocks; i++) {
+            bc->BlockCipher_encrypt(&ctx, block, block);
+        }
+
+        enc = hwtimer_now() - start;
+        start = hwtimer_now();
+
+        for (i = 0; i < blocks; i++) {
+            bc->BlockCipher_decrypt(&ctx, block, block);
+        }
+
+        dec = hwtimer_now() - start;
+
+        /* a new key for every block, less the time of the blocks */
+        start = hwtimer_now();
+
+        for (i = 0; i < blocks; i++) {
+            bc->setupKey(&ctx, key[i & 1], 16);
+            bc->BlockCipher_encrypt(&ctx, block, block);
+        }
+
+        setup = hwtimer_now() - start;
+        setup = (setup > enc) ? setup - enc : 0;
+        enc_ns[c] = ns_per_block(enc, blocks);
+
+        printf("%-9s %4u %4u %10lu %10lu %10lu\n", ciphers[c].name,
+               ciphers[c].key_bits, ciphers[c].rank,
+               ns_per_block(setup, blocks), enc_ns[c],
+               ns_per_block(dec, blocks));
+    }
+
+    /* the fastest gets the highest rank */
+    for (unsigned int c = 0; c < CIPHER_COUNT; c++) {
+        unsigned int rank = CIPHER_COUNT;
+
+        if (!enc_ns[c]) {
+            continue;
+        }
+
+        for (unsigned int o = 0; o < CIPHER_COUNT; o++) {
+            if (enc_ns[o] && (enc_ns[o] < enc_ns[c])) {
+                rank--;
+            }
+        }
+
+        printf("CFLAGS += -DCIPHER_RANK_%s=%u\n", ciphers[c].name, rank);
+    }
+
+#ifdef CIPHER_SELECTED
+    printf("selected: %s\n", CIPHER_SELECTED.name);
+#else
+    puts("selected: none meets the policy");
+#endif
+}
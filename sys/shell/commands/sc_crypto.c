@@ -0,0 +1,63 @@
+/**
+ * Shell commands for the crypto providers
+ *
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_crypto.c
+ * @brief   compares the registered AES providers
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "crypto/aes.h"
+
+#define CRYPTO_BENCH_BLOCKS (100)
+
+void _crypto_bench_handler(int argc, char **argv)
+{
+    const crypto_provider_t *p;
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t block[AES_BLOCK_SIZE];
+    int blocks = CRYPTO_BENCH_BLOCKS;
+
+    if (argc > 1) {
+        blocks = atoi(argv[1]);
+    }
+
+    memset(key, 0x2b, sizeof(key));
+    printf("%-10s %4s %5s %10s\n", "provider", "hw", "rank", "us/block");
+
+    for (p = crypto_provider_list(); p; p = p->next) {
+        aes_ctx_t ctx;
+        unsigned long start, ticks;
+        int i;
+
+        if (!(p->flags & CRYPTO_PROVIDER_KEY_128) ||
+            (aes_ctx_init(&ctx, p->aes, key, AES_KEY_SIZE) < 0)) {
+            printf("%-10s   no AES-128\n", p->name);
+            continue;
+        }
+
+        memset(block, 0, sizeof(block));
+        start = hwtimer_now();
+
+        for (i = 0; i < blocks; i++) {
+            aes_ctx_encrypt(&ctx, block, block);
+        }
+
+        ticks = hwtimer_now() - start;
+        printf("%-10s %4s %5u %10lu\n", p->name,
+               (p->flags & CRYPTO_PROVIDER_HW) ? "yes" : "no", p->rank,
+               blocks > 0 ? HWTIMER_TICKS_TO_US(ticks) / blocks : 0);
+    }
+}
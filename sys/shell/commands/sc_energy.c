@@ -0,0 +1,67 @@
+/**
+ * Shell command for the energy accounting
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_energy.c
+ * @brief   dumps and clears the energy accounting, sets the currents
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "energy.h"
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [dump|clear|calibrate|current <state> <uA>]\n", name);
+    printf("states:");
+
+    for (int i = 0; i < ENERGY_STATES; i++) {
+        printf(" %s", energy_state_name(i));
+    }
+
+    puts("");
+}
+
+void _energy_handler(int argc, char **argv)
+{
+    if ((argc < 2) || (strcmp(argv[1], "dump") == 0)) {
+        energy_dump();
+    }
+    else if (strcmp(argv[1], "clear") == 0) {
+        energy_clear();
+    }
+    else if (strcmp(argv[1], "calibrate") == 0) {
+        int scale = energy_calibrate();
+
+        if (scale < 0) {
+            puts("measurement started");
+        }
+        else {
+            printf("estimates scaled by %d/1000\n", scale);
+        }
+    }
+    else if ((strcmp(argv[1], "current") == 0) && (argc > 3)) {
+        for (int i = 0; i < ENERGY_STATES; i++) {
+            if (strcmp(argv[2], energy_state_name(i)) == 0) {
+                energy_set_current(i, strtoul(argv[3], NULL, 0));
+                return;
+            }
+        }
+
+        usage(argv[0]);
+    }
+    else {
+        usage(argv[0]);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * Shell command for the allocation profiler
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_heapprof.c
+ * @brief   dumps and clears the allocation profiler, starts its trace
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heapprof.h"
+
+void _heapprof_handler(int argc, char **argv)
+{
+    if ((argc < 2) || (strcmp(argv[1], "dump") == 0)) {
+        unsigned int top = 0;
+
+        if (argc > 2) {
+            top = strtoul(argv[2], NULL, 0);
+        }
+
+        heapprof_dump(top);
+    }
+    else if (strcmp(argv[1], "clear") == 0) {
+        heapprof_clear();
+    }
+    else if ((strcmp(argv[1], "trace") == 0) && (argc > 2) &&
+             ((strcmp(argv[2], "on") == 0) || (strcmp(argv[2], "off") == 0))) {
+        if (heapprof_trace(strcmp(argv[2], "on") == 0) < 0) {
+            puts("trace not available");
+        }
+    }
+    else {
+        printf("Usage: %s [dump [top]|clear|trace on|off]\n", argv[0]);
+    }
+}
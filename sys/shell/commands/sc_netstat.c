@@ -0,0 +1,63 @@
+/**
+ * Shell command for the network statistics
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_netstat.c
+ * @brief   prints the counters of the network stack
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "netstat.h"
+
+#ifdef MODULE_TRANSCEIVER
+#include "transceiver.h"
+#endif
+
+void _netstat_handler(int argc, char **argv)
+{
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        netstat_reset();
+        return;
+    }
+
+    if (argc > 1) {
+        printf("Usage: %s [reset]\n", argv[0]);
+        return;
+    }
+
+#ifdef MODULE_TRANSCEIVER
+    transceiver_rx_stats_t rx;
+
+    transceiver_get_rx_stats(&rx);
+    printf("%-12s rx %10" PRIu32 " no_slot %" PRIu32 " not_queued %" PRIu32
+           " not_delivered %" PRIu32 "\n", "transceiver", rx.received,
+           rx.no_slot, rx.not_queued, rx.not_delivered);
+#endif
+
+    for (int i = 0; i < NETSTAT_LAYER_NUMOF; i++) {
+        printf("%-12s rx %10" PRIu32 " tx %10" PRIu32 " drop %10" PRIu32 "\n",
+               netstat_layer_name(i), netstat_layers[i].rx,
+               netstat_layers[i].tx, netstat_layers[i].drop);
+    }
+
+    puts("drops:");
+
+    for (int i = 0; i < NETSTAT_DROP_NUMOF; i++) {
+        if (netstat_drops[i]) {
+            printf("  %-12s %10" PRIu32 "\n", netstat_drop_name(i),
+                   netstat_drops[i]);
+        }
+    }
+}
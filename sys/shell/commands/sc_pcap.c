@@ -0,0 +1,90 @@
+/**
+ * Shell command for packet capture
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_pcap.c
+ * @brief   starts and stops capturing received frames, sets the filter
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcap.h"
+
+/* the transceiver passes 802.15.4 frames for these radios */
+#if MODULE_AT86RF231 || MODULE_CC2420
+#define LINKTYPE    PCAP_LINKTYPE_IEEE802_15_4_TAP
+#else
+#define LINKTYPE    PCAP_LINKTYPE_USER0
+#endif
+
+static void set_filter(int argc, char **argv)
+{
+    pcap_filter_t filter;
+
+    memset(&filter, 0, sizeof(filter));
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        long value = strtol(argv[i + 1], NULL, 0);
+
+        if (strcmp(argv[i], "src") == 0) {
+            filter.match |= PCAP_MATCH_SRC;
+            filter.src = value;
+        }
+        else if (strcmp(argv[i], "dst") == 0) {
+            filter.match |= PCAP_MATCH_DST;
+            filter.dst = value;
+        }
+        else if (strcmp(argv[i], "type") == 0) {
+            filter.match |= PCAP_MATCH_TYPE;
+            filter.types |= 1 << value;
+        }
+        else if (strcmp(argv[i], "rssi") == 0) {
+            filter.match |= PCAP_MATCH_RSSI;
+            filter.rssi = value;
+        }
+        else {
+            printf("unknown field %s\n", argv[i]);
+            return;
+        }
+    }
+
+    pcap_set_filter(&filter);
+}
+
+void _pcap_handler(int argc, char **argv)
+{
+    if ((argc >= 2) && (strcmp(argv[1], "start") == 0)) {
+        /* nothing is printed on success, it would end up in the stream */
+        if (pcap_start(LINKTYPE, (argc > 2) ? atoi(argv[2]) : 0) < 0) {
+            puts("pcap: cannot start");
+        }
+    }
+    else if ((argc >= 2) && (strcmp(argv[1], "stop") == 0)) {
+        pcap_stop();
+    }
+    else if ((argc >= 2) && (strcmp(argv[1], "filter") == 0)) {
+        set_filter(argc, argv);
+    }
+    else if ((argc >= 2) && (strcmp(argv[1], "stats") == 0)) {
+        pcap_stats_t stats;
+
+        pcap_get_stats(&stats);
+        printf("captured %u, filtered %u, dropped %u\n", stats.captured,
+               stats.filtered, stats.dropped);
+    }
+    else {
+        printf("Usage: %s start [snaplen]|stop|stats|"
+               "filter [src <a>] [dst <a>] [type <t>] [rssi <dBm>]\n", argv[0]);
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * Shell command for the sampling profiler
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_profiler.c
+ * @brief   starts, stops and dumps the sampling profiler
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+
+void _profiler_handler(int argc, char **argv)
+{
+    if ((argc < 2) || (strcmp(argv[1], "dump") == 0)) {
+        profiler_dump();
+    }
+    else if (strcmp(argv[1], "start") == 0) {
+        unsigned long interval = PROFILER_INTERVAL;
+
+        if (argc > 2) {
+            interval = strtoul(argv[2], NULL, 0);
+        }
+
+        if (profiler_start(interval) < 0) {
+            printf("interval of %lu us not supported\n", interval);
+        }
+    }
+    else if (strcmp(argv[1], "stop") == 0) {
+        profiler_stop();
+    }
+    else if (strcmp(argv[1], "clear") == 0) {
+        profiler_clear();
+    }
+    else {
+        printf("Usage: %s [start [interval_us]|stop|dump|clear]\n", argv[0]);
+    }
+}
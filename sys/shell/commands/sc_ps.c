@@ -15,12 +15,35 @@
  * @}
  */
 
+#include <string.h>
+
 #include "ps.h"
 
+#ifdef MODULE_STACKMON
+#include "stackmon.h"
+#endif
+
 void _ps_handler(int argc, char **argv)
 {
+#ifdef MODULE_STACKMON
+    if ((argc > 1) && (strcmp(argv[1], "stack") == 0)) {
+        stackmon_print_report();
+        return;
+    }
+#else
     (void) argc;
     (void) argv;
+#endif
 
     thread_print_all();
 }
+
+#if SCHEDSTATISTICS
+void _schedstat_handler(int argc, char **argv)
+{
+    (void) argc;
+    (void) argv;
+
+    sched_print_stats();
+}
+#endif
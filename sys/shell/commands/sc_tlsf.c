@@ -0,0 +1,26 @@
+/**
+ * Shell command for the TLSF allocator
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_tlsf.c
+ * @brief   shows allocations per thread and heap fragmentation
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include "tlsf.h"
+
+void _tlsf_handler(int argc, char **argv)
+{
+    (void) argc;
+    (void) argv;
+
+    tlsf_print_stats();
+}
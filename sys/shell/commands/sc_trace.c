@@ -0,0 +1,40 @@
+/**
+ * Shell command for the event tracer
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup shell_commands
+ * @{
+ * @file    sc_trace.c
+ * @brief   dumps and controls the event trace
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+void _trace_handler(int argc, char **argv)
+{
+    if ((argc < 2) || (strcmp(argv[1], "dump") == 0)) {
+        trace_dump();
+    }
+    else if (strcmp(argv[1], "clear") == 0) {
+        trace_clear();
+    }
+    else if (strcmp(argv[1], "on") == 0) {
+        trace_enable(1);
+    }
+    else if (strcmp(argv[1], "off") == 0) {
+        trace_enable(0);
+    }
+    else {
+        printf("Usage: %s [dump|clear|on|off]\n", argv[0]);
+    }
+}
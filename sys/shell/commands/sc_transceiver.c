@@ -240,8 +240,8 @@ void _transceiver_send_handler(int argc, char **argv)
 
     printf("[transceiver] Sending packet of length %" PRIu16 " to %" PRIu16 ": %s\n", p.length, p.dst, (char*) p.data);
     msg_send_receive(&mesg, &mesg, transceiver_pid);
-    int8_t response = mesg.content.value;
-    printf("[transceiver] Packet sent: %" PRIi8 "\n", response);
+    int16_t response = TRANSCEIVER_TX_RESULT(mesg.content.value);
+    printf("[transceiver] Packet sent: %" PRIi16 "\n", response);
 }
 
 /* checked for type safety */
@@ -33,8 +33,32 @@ extern void _id_handler(int argc, char **argv);
 extern void _heap_handler(int argc, char **argv);
 #endif
 
+#ifdef MODULE_TLSF
+extern void _tlsf_handler(int argc, char **argv);
+#endif
+
+#ifdef MODULE_PCAP
+extern void _pcap_handler(int argc, char **argv);
+#endif
+
 #ifdef MODULE_PS
 extern void _ps_handler(int argc, char **argv);
+#if SCHEDSTATISTICS
+extern void _schedstat_handler(int argc, char **argv);
+#endif
+#endif
+
+#ifdef MODULE_TRACE
+extern void _trace_handler(int argc, char **argv);
+#endif
+#ifdef MODULE_PROFILER
+extern void _profiler_handler(int argc, char **argv);
+#endif
+#ifdef MODULE_HEAPPROF
+extern void _heapprof_handler(int argc, char **argv);
+#endif
+#ifdef MODULE_ENERGY
+extern void _energy_handler(int argc, char **argv);
 #endif
 
 #ifdef MODULE_RTC
@@ -104,6 +128,10 @@ extern void _transceiver_set_ignore_handler(int argc, char **argv);
 extern void _net_if_ifconfig(int argc, char **argv);
 #endif
 
+#ifdef MODULE_NETSTAT
+extern void _netstat_handler(int argc, char **argv);
+#endif
+
 #ifdef MODULE_MCI
 extern void _get_sectorsize(int argc, char **argv);
 extern void _get_blocksize(int argc, char **argv);
@@ -112,6 +140,16 @@ extern void _read_sector(int argc, char **argv);
 extern void _read_bytes(int argc, char **argv);
 #endif
 
+#ifdef MODULE_CRYPTO_AES
+extern void _crypto_bench_handler(int argc, char **argv);
+#endif
+
+#if defined(MODULE_CRYPTO_AES) || defined(MODULE_CRYPTO_3DES) || \
+    defined(MODULE_CRYPTO_RC5) || defined(MODULE_CRYPTO_SKIPJACK) || \
+    defined(MODULE_CRYPTO_TWOFISH)
+extern void _cipher_bench_handler(int argc, char **argv);
+#endif
+
 #ifdef MODULE_RANDOM
 extern void _mersenne_init(int argc, char **argv);
 extern void _mersenne_get(int argc, char **argv);
@@ -125,8 +163,29 @@ const shell_command_t _shell_command_list[] = {
 #ifdef MODULE_LPC_COMMON
     {"heap", "Shows the heap state for the LPC2387 on the command shell.", _heap_handler},
 #endif
+#ifdef MODULE_TLSF
+    {"tlsf", "Shows allocations per thread and heap fragmentation.", _tlsf_handler},
+#endif
+#ifdef MODULE_PCAP
+    {"pcap", "Streams received frames in pcap format, sets the filter.", _pcap_handler},
+#endif
 #ifdef MODULE_PS
     {"ps", "Prints information about running threads.", _ps_handler},
+#if SCHEDSTATISTICS
+    {"schedstat", "Prints scheduler latency and run queue statistics.", _schedstat_handler},
+#endif
+#endif
+#ifdef MODULE_TRACE
+    {"trace", "Dumps, clears, starts or stops the event trace.", _trace_handler},
+#endif
+#ifdef MODULE_PROFILER
+    {"prof", "Starts, stops, dumps or clears the sampling profiler.", _profiler_handler},
+#endif
+#ifdef MODULE_HEAPPROF
+    {"heapprof", "Shows the heap held per call site of malloc().", _heapprof_handler},
+#endif
+#ifdef MODULE_ENERGY
+    {"energy", "Dumps or clears the energy accounting, sets currents.", _energy_handler},
 #endif
 #ifdef MODULE_RTC
     {"date", "Gets or sets current date and time.", _date_handler},
@@ -172,6 +231,9 @@ const shell_command_t _shell_command_list[] = {
 #ifdef MODULE_NET_IF
     {"ifconfig", "Configures a network interface", _net_if_ifconfig},
 #endif
+#ifdef MODULE_NETSTAT
+    {"netstat", "Prints or resets the network statistics", _netstat_handler},
+#endif
 #ifdef MODULE_MCI
     {DISK_READ_SECTOR_CMD, "Reads the specified sector of inserted memory card", _read_sector},
     {DISK_READ_BYTES_CMD, "Reads the specified bytes from inserted memory card", _read_bytes},
@@ -179,6 +241,14 @@ const shell_command_t _shell_command_list[] = {
     {DISK_GET_SECTOR_COUNT, "Get the sector count of inserted memory card", _get_sectorcount},
     {DISK_GET_BLOCK_SIZE, "Get the block size of inserted memory card", _get_blocksize},
 #endif
+#ifdef MODULE_CRYPTO_AES
+    {"cryptobench", "Compares the speed of the AES providers", _crypto_bench_handler},
+#endif
+#if defined(MODULE_CRYPTO_AES) || defined(MODULE_CRYPTO_3DES) || \
+    defined(MODULE_CRYPTO_RC5) || defined(MODULE_CRYPTO_SKIPJACK) || \
+    defined(MODULE_CRYPTO_TWOFISH)
+    {"cipherbench", "Measures the block ciphers, suggests their ranks", _cipher_bench_handler},
+#endif
 #ifdef MODULE_RANDOM
     { "mersenne_init", "initializes the PRNG", _mersenne_init },
     { "mersenne_get", "returns 32 bit of pseudo randomness", _mersenne_get },
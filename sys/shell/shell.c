@@ -34,10 +34,107 @@
 #include "shell.h"
 #include "shell_commands.h"
 
-static shell_command_handler_t find_handler(const shell_command_t *command_list, char *command)
+#define INDEX_EMPTY     (0xff)
+#define INDEX_LIST(v)   ((v) >> 7)
+#define INDEX_POS(v)    ((v) & 0x7f)
+
+static unsigned hash_name(const char *name)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+
+    while (*name) {
+        h = (h ^ (unsigned char) *name++) * 16777619u;
+    }
+
+    return h ^ (h >> 16);
+}
+
+static const shell_command_t *index_entry(const shell_command_t *command_list,
+                                          uint8_t value)
+{
+#ifdef MODULE_SHELL_COMMANDS
+    if (INDEX_LIST(value)) {
+        return _shell_command_list + INDEX_POS(value);
+    }
+#endif
+
+    return command_list + INDEX_POS(value);
+}
+
+/**
+ * @brief   Hashes the commands of both lists into shell->index, entries
+ *          of the application list first so they take precedence.
+ *          If the index cannot take all commands, find_handler() falls
+ *          back to searching the lists.
+ */
+static void build_index(shell_t *shell)
 {
     const shell_command_t *command_lists[] = {
-        command_list,
+        shell->command_list,
+#ifdef MODULE_SHELL_COMMANDS
+        _shell_command_list,
+#endif
+    };
+
+    unsigned count = 0;
+
+    memset(shell->index, INDEX_EMPTY, sizeof(shell->index));
+    shell->indexed = 0;
+
+    for (unsigned int i = 0; i < sizeof(command_lists) / sizeof(command_lists[0]); i++) {
+        const shell_command_t *entry = command_lists[i];
+
+        for (unsigned pos = 0; entry && entry[pos].name != NULL; pos++) {
+            if (pos >= INDEX_POS(INDEX_EMPTY) || ++count >= SHELL_INDEX_SIZE) {
+                return;
+            }
+
+            unsigned slot = hash_name(entry[pos].name);
+
+            while (1) {
+                slot &= SHELL_INDEX_SIZE - 1;
+                uint8_t value = shell->index[slot];
+
+                if (value == INDEX_EMPTY) {
+                    shell->index[slot] = (i << 7) | pos;
+                    break;
+                }
+                else if (strcmp(index_entry(shell->command_list, value)->name,
+                                entry[pos].name) == 0) {
+                    /* shadowed by the application */
+                    break;
+                }
+
+                slot++;
+            }
+        }
+    }
+
+    shell->indexed = 1;
+}
+
+static shell_command_handler_t find_handler(shell_t *shell, char *command)
+{
+    if (shell->indexed) {
+        for (unsigned slot = hash_name(command); ; slot++) {
+            slot &= SHELL_INDEX_SIZE - 1;
+            uint8_t value = shell->index[slot];
+
+            if (value == INDEX_EMPTY) {
+                return NULL;
+            }
+
+            const shell_command_t *entry = index_entry(shell->command_list, value);
+
+            if (strcmp(entry->name, command) == 0) {
+                return entry->handler;
+            }
+        }
+    }
+
+    const shell_command_t *command_lists[] = {
+        shell->command_list,
 #ifdef MODULE_SHELL_COMMANDS
         _shell_command_list,
 #endif
@@ -193,7 +290,7 @@ static void handle_input_line(shell_t *shell, char *line)
     }
 
     /* then we call the appropriate handler */
-    shell_command_handler_t handler = find_handler(shell->command_list, argv[0]);
+    shell_command_handler_t handler = find_handler(shell, argv[0]);
     if (handler != NULL) {
         handler(argc, argv);
     }
@@ -262,6 +359,25 @@ void shell_run(shell_t *shell)
     }
 }
 
+void shell_run_script(shell_t *shell, char *script)
+{
+    while (*script) {
+        char *line = script;
+
+        while (*script && *script != '\n' && *script != '\r') {
+            script++;
+        }
+
+        if (*script) {
+            *script++ = '\0';
+        }
+
+        if (*line != '#') {
+            handle_input_line(shell, line);
+        }
+    }
+}
+
 void shell_init(shell_t *shell, const shell_command_t *shell_commands,
                 uint16_t shell_buffer_size, int(*readchar)(void), void(*put_char)(int))
 {
@@ -269,6 +385,7 @@ void shell_init(shell_t *shell, const shell_command_t *shell_commands,
     shell->shell_buffer_size = shell_buffer_size;
     shell->readchar = readchar;
     shell->put_char = put_char;
+    build_index(shell);
 }
 
 /** @} */
@@ -0,0 +1,181 @@
+/**
+ * Stack high-water monitor
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_stackmon
+ * @{
+ * @file    stackmon.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+
+#include "kernel.h"
+#include "irq.h"
+#include "sched.h"
+#include "tcb.h"
+#include "thread.h"
+#include "workqueue.h"
+#include "stackmon.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+/* suggested sizes are multiples of this */
+#define ALIGN           (16)
+
+typedef struct {
+    char *stack;                /* identifies the buffer */
+    const char *name;           /* last thread using it */
+    int size;
+    int used;                   /* high-water mark */
+} record_t;
+
+static record_t records[STACKMON_RECORDS];
+static unsigned int count;
+static unsigned int dropped;
+
+static work_t sample_work;
+
+static record_t *record(char *stack)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        if (records[i].stack == stack) {
+            return &records[i];
+        }
+    }
+
+    if (count == STACKMON_RECORDS) {
+        return NULL;
+    }
+
+    records[count].used = 0;
+    return &records[count++];
+}
+
+void stackmon_sample(void)
+{
+    for (int i = 0; i < MAXTHREADS; i++) {
+        unsigned int state = disableIRQ();
+        tcb_t *p = (tcb_t *) sched_threads[i];
+        char *stack;
+        const char *name;
+        int size, used;
+
+        if (p == NULL) {
+            restoreIRQ(state);
+            continue;
+        }
+
+        stack = p->stack_start;
+        name = p->name;
+        size = p->stack_size;
+        restoreIRQ(state);
+
+        /* the stack is scanned with interrupts enabled */
+        used = size - thread_measure_stack_free(stack);
+
+        state = disableIRQ();
+
+        /* the thread may have exited meanwhile */
+        if ((sched_threads[i] == p) && (p->stack_start == stack)) {
+            record_t *r = record(stack);
+
+            if (r == NULL) {
+                dropped++;
+            }
+            else {
+                r->stack = stack;
+                r->name = name;
+                r->size = size;
+
+                if (used > r->used) {
+                    DEBUG("stackmon: %s uses %i of %i\n", name, used, size);
+                    r->used = used;
+                }
+            }
+        }
+
+        restoreIRQ(state);
+    }
+}
+
+static void sample_handler(work_t *work)
+{
+    stackmon_sample();
+    workqueue_post_in(work, STACKMON_INTERVAL);
+}
+
+int stackmon_init(void)
+{
+    if (workqueue_init() < 0) {
+        return -1;
+    }
+
+    workqueue_work_init(&sample_work, sample_handler, NULL, PRIORITY_MIN - 1);
+    workqueue_post(&sample_work);
+    return 0;
+}
+
+static const char *constant(int size)
+{
+    if (size == KERNEL_CONF_STACKSIZE_MAIN) {
+        return "_MAIN";
+    }
+
+    if (size == KERNEL_CONF_STACKSIZE_DEFAULT) {
+        return "_DEFAULT";
+    }
+
+    if (size == KERNEL_CONF_STACKSIZE_PRINTF) {
+        return "_PRINTF";
+    }
+
+    if (size == KERNEL_CONF_STACKSIZE_IDLE) {
+        return "_IDLE";
+    }
+
+    return "";
+}
+
+void stackmon_print_report(void)
+{
+    long total = 0, suggested_total = 0;
+
+    stackmon_sample();
+
+    printf("\t%-21s| stack ( used) | suggested | constant\n", "name");
+
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int state = disableIRQ();
+        record_t r = records[i];
+        restoreIRQ(state);
+
+        long suggested = r.used + ((long) r.used * STACKMON_MARGIN) / 100;
+
+        suggested = (suggested + ALIGN - 1) & ~(long)(ALIGN - 1);
+
+        if (suggested > r.size) {
+            suggested = r.size;
+        }
+
+        total += r.size;
+        suggested_total += suggested;
+
+        printf("\t%-21s| %5i (%5i) | %9li | KERNEL_CONF_STACKSIZE%s\n",
+               r.name, r.size, r.used, suggested, constant(r.size));
+    }
+
+    printf("\t%-21s| %5li         | %9li | %li bytes to reclaim\n", "SUM",
+           total, suggested_total, total - suggested_total);
+
+    if (dropped) {
+        printf("\t%u samples dropped, raise STACKMON_RECORDS\n", dropped);
+    }
+}
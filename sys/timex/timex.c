@@ -122,6 +122,15 @@ uint64_t timex_uint64(const timex_t a)
     return (uint64_t) a.seconds * SEC_IN_USEC + a.microseconds;
 }
 
+timex_t timex_from_uint64(const uint64_t timestamp)
+{
+    /* 10^6 = 2^6 * 15625 */
+    uint16_t rem;
+    uint32_t seconds = timex_udiv64(timestamp >> 6, 15625, &rem);
+
+    return timex_set(seconds, ((uint32_t) rem << 6) | ((uint32_t) timestamp & 0x3f));
+}
+
 void timex_print(const timex_t t)
 {
     printf("Seconds: %" PRIu32 " - Microseconds: %" PRIu32 "\n", t.seconds, t.microseconds);
@@ -0,0 +1,564 @@
+/**
+ * Two-level segregated fit allocator
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_tlsf
+ * @{
+ * @file    tlsf.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitarithm.h"
+#include "irq.h"
+#include "sched.h"
+#include "tcb.h"
+#include "tlsf.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#if TLSF_FL_MAX > 24
+#error "TLSF_FL_MAX must not exceed 24, the size word holds the owner above"
+#endif
+
+#if UINTPTR_MAX > 0xffffffff
+#define ALIGN_LOG2      (3)
+#else
+#define ALIGN_LOG2      (2)
+#endif
+#define ALIGN           (1 << ALIGN_LOG2)
+
+/* 16 second level lists per power of two */
+#define SL_LOG2         (4)
+#define SL_COUNT        (1 << SL_LOG2)
+
+/* blocks below SMALL_BLOCK all go to the first list of the first level,
+ * split linearly by ALIGN */
+#define FL_SHIFT        (SL_LOG2 + ALIGN_LOG2)
+#define FL_COUNT        (TLSF_FL_MAX - FL_SHIFT + 1)
+#define SMALL_BLOCK     (1 << FL_SHIFT)
+
+/* the size word: flags in the bits the alignment leaves free, the thread
+ * that allocated the block above the size */
+#define BLOCK_FREE      (0x1)
+#define BLOCK_PREV_FREE (0x2)
+#define SIZE_MASK       ((size_t) 0x00fffffc)
+#define OWNER_SHIFT     (24)
+#define OWNER_NONE      (MAXTHREADS)
+
+typedef struct tlsf_block {
+    struct tlsf_block *prev_phys;   /* valid if BLOCK_PREV_FREE is set */
+    size_t size;
+    /* the payload starts here, a free block keeps its list links in it */
+    struct tlsf_block *next_free;
+    struct tlsf_block *prev_free;
+} tlsf_block_t;
+
+#define HEADER          (offsetof(tlsf_block_t, next_free))
+#define MIN_PAYLOAD     (sizeof(tlsf_block_t) - HEADER)
+#define MAX_PAYLOAD     (((size_t) 1 << TLSF_FL_MAX) - ALIGN)
+
+static struct {
+    unsigned int fl_bitmap;
+    unsigned int sl_bitmap[FL_COUNT];
+    tlsf_block_t *blocks[FL_COUNT][SL_COUNT];
+} tlsf;
+
+static size_t tlsf_pool_bytes;
+static tlsf_stats_t tlsf_stats[MAXTHREADS + 1];
+
+static inline size_t block_size(const tlsf_block_t *b)
+{
+    return b->size & SIZE_MASK;
+}
+
+static inline void block_set_size(tlsf_block_t *b, size_t size)
+{
+    b->size = (b->size & ~SIZE_MASK) | size;
+}
+
+static inline unsigned int block_owner(const tlsf_block_t *b)
+{
+    return (b->size >> OWNER_SHIFT) & 0xff;
+}
+
+static inline void block_set_owner(tlsf_block_t *b, unsigned int owner)
+{
+    b->size = (b->size & (SIZE_MASK | BLOCK_FREE | BLOCK_PREV_FREE)) |
+              ((size_t) owner << OWNER_SHIFT);
+}
+
+static inline void *block_payload(tlsf_block_t *b)
+{
+    return (uint8_t *) b + HEADER;
+}
+
+static inline tlsf_block_t *block_of(void *ptr)
+{
+    return (tlsf_block_t *) ((uint8_t *) ptr - HEADER);
+}
+
+static inline tlsf_block_t *block_next(tlsf_block_t *b)
+{
+    return (tlsf_block_t *) ((uint8_t *) block_payload(b) + block_size(b));
+}
+
+/* returns the physical successor after pointing it back to *b* */
+static inline tlsf_block_t *block_link_next(tlsf_block_t *b)
+{
+    tlsf_block_t *next = block_next(b);
+    next->prev_phys = b;
+    return next;
+}
+
+static inline void block_mark_free(tlsf_block_t *b)
+{
+    block_link_next(b)->size |= BLOCK_PREV_FREE;
+    b->size |= BLOCK_FREE;
+}
+
+static inline void block_mark_used(tlsf_block_t *b)
+{
+    block_next(b)->size &= ~BLOCK_PREV_FREE;
+    b->size &= ~BLOCK_FREE;
+}
+
+static void mapping_insert(size_t size, unsigned int *fl, unsigned int *sl)
+{
+    if (size < SMALL_BLOCK) {
+        *fl = 0;
+        *sl = size >> ALIGN_LOG2;
+    }
+    else {
+        unsigned int f = number_of_highest_bit(size);
+        *sl = (size >> (f - SL_LOG2)) ^ SL_COUNT;
+        *fl = f - (FL_SHIFT - 1);
+    }
+}
+
+/* like mapping_insert() but rounded up to the next list, any block of it
+ * is large enough */
+static void mapping_search(size_t size, unsigned int *fl, unsigned int *sl)
+{
+    if (size >= SMALL_BLOCK) {
+        size += (1 << (number_of_highest_bit(size) - SL_LOG2)) - 1;
+    }
+
+    mapping_insert(size, fl, sl);
+}
+
+static tlsf_block_t *search_suitable(unsigned int *fl, unsigned int *sl)
+{
+    if (*fl >= FL_COUNT) {
+        return NULL;
+    }
+
+    unsigned int sl_map = tlsf.sl_bitmap[*fl] & (~0u << *sl);
+
+    if (!sl_map) {
+        unsigned int fl_map = tlsf.fl_bitmap & (~0u << (*fl + 1));
+
+        if (!fl_map) {
+            return NULL;
+        }
+
+        *fl = number_of_lowest_bit(fl_map);
+        sl_map = tlsf.sl_bitmap[*fl];
+    }
+
+    *sl = number_of_lowest_bit(sl_map);
+    return tlsf.blocks[*fl][*sl];
+}
+
+static void remove_free(tlsf_block_t *b, unsigned int fl, unsigned int sl)
+{
+    tlsf_block_t *prev = b->prev_free;
+    tlsf_block_t *next = b->next_free;
+
+    if (next) {
+        next->prev_free = prev;
+    }
+
+    if (prev) {
+        prev->next_free = next;
+    }
+    else {
+        tlsf.blocks[fl][sl] = next;
+
+        if (!next) {
+            tlsf.sl_bitmap[fl] &= ~(1u << sl);
+
+            if (!tlsf.sl_bitmap[fl]) {
+                tlsf.fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+}
+
+static void insert_free(tlsf_block_t *b, unsigned int fl, unsigned int sl)
+{
+    tlsf_block_t *head = tlsf.blocks[fl][sl];
+
+    b->next_free = head;
+    b->prev_free = NULL;
+
+    if (head) {
+        head->prev_free = b;
+    }
+
+    tlsf.blocks[fl][sl] = b;
+    tlsf.sl_bitmap[fl] |= 1u << sl;
+    tlsf.fl_bitmap |= 1u << fl;
+}
+
+static void block_remove(tlsf_block_t *b)
+{
+    unsigned int fl, sl;
+
+    mapping_insert(block_size(b), &fl, &sl);
+    remove_free(b, fl, sl);
+}
+
+static void block_insert(tlsf_block_t *b)
+{
+    unsigned int fl, sl;
+
+    mapping_insert(block_size(b), &fl, &sl);
+    insert_free(b, fl, sl);
+}
+
+static inline int block_can_split(tlsf_block_t *b, size_t size)
+{
+    return block_size(b) >= size + sizeof(tlsf_block_t);
+}
+
+/* cuts *b* to *size*, the rest becomes a free block that is returned */
+static tlsf_block_t *block_split(tlsf_block_t *b, size_t size)
+{
+    tlsf_block_t *rest = (tlsf_block_t *) ((uint8_t *) block_payload(b) +
+                                           size);
+
+    rest->size = block_size(b) - size - HEADER;
+    block_set_size(b, size);
+    block_mark_free(rest);
+
+    return rest;
+}
+
+static tlsf_block_t *block_absorb(tlsf_block_t *b, tlsf_block_t *next)
+{
+    block_set_size(b, block_size(b) + block_size(next) + HEADER);
+    block_link_next(b);
+    return b;
+}
+
+static tlsf_block_t *block_merge_prev(tlsf_block_t *b)
+{
+    if (b->size & BLOCK_PREV_FREE) {
+        tlsf_block_t *prev = b->prev_phys;
+        block_remove(prev);
+        b = block_absorb(prev, b);
+    }
+
+    return b;
+}
+
+static tlsf_block_t *block_merge_next(tlsf_block_t *b)
+{
+    tlsf_block_t *next = block_next(b);
+
+    if (next->size & BLOCK_FREE) {
+        block_remove(next);
+        b = block_absorb(b, next);
+    }
+
+    return b;
+}
+
+/* payload size for a request, 0 if it cannot be served */
+static size_t adjust_request(size_t size)
+{
+    if ((size == 0) || (size > MAX_PAYLOAD)) {
+        return 0;
+    }
+
+    size = (size + ALIGN - 1) & ~((size_t) ALIGN - 1);
+
+    return (size < MIN_PAYLOAD) ? MIN_PAYLOAD : size;
+}
+
+static unsigned int current_owner(void)
+{
+    if ((thread_pid < 0) || (thread_pid >= MAXTHREADS)) {
+        return OWNER_NONE;
+    }
+
+    return thread_pid;
+}
+
+static void stats_add(unsigned int owner, size_t bytes)
+{
+    tlsf_stats_t *s = &tlsf_stats[owner];
+
+    s->used += bytes;
+
+    if (s->used > s->peak) {
+        s->peak = s->used;
+    }
+}
+
+static void *_malloc(size_t size)
+{
+    size_t adjusted = adjust_request(size);
+    unsigned int owner = current_owner();
+    tlsf_block_t *b = NULL;
+
+    if (adjusted) {
+        unsigned int fl, sl;
+
+        mapping_search(adjusted, &fl, &sl);
+        b = search_suitable(&fl, &sl);
+
+        if (b) {
+            remove_free(b, fl, sl);
+        }
+    }
+
+    if (!b) {
+        DEBUG("tlsf_malloc(): no block for %u bytes\n", (unsigned int) size);
+        tlsf_stats[owner].fails++;
+        return NULL;
+    }
+
+    if (block_can_split(b, adjusted)) {
+        block_insert(block_split(b, adjusted));
+    }
+
+    block_mark_used(b);
+    block_set_owner(b, owner);
+
+    tlsf_stats[owner].allocs++;
+    stats_add(owner, block_size(b));
+
+    return block_payload(b);
+}
+
+static void _free(void *ptr)
+{
+    tlsf_block_t *b = block_of(ptr);
+
+    tlsf_stats[block_owner(b)].used -= block_size(b);
+
+    block_mark_free(b);
+    b = block_merge_prev(b);
+    b = block_merge_next(b);
+    block_insert(b);
+}
+
+int tlsf_add_pool(void *mem, size_t bytes)
+{
+    uintptr_t start = ((uintptr_t) mem + ALIGN - 1) & ~((uintptr_t) ALIGN - 1);
+
+    if (bytes < (start - (uintptr_t) mem) + 2 * HEADER + MIN_PAYLOAD) {
+        return -1;
+    }
+
+    size_t size = (bytes - (start - (uintptr_t) mem) - 2 * HEADER) &
+                  ~((size_t) ALIGN - 1);
+
+    if (size > MAX_PAYLOAD) {
+        size = MAX_PAYLOAD;
+    }
+
+    tlsf_block_t *b = (tlsf_block_t *) start;
+    unsigned state = disableIRQ();
+
+    /* one free block, followed by a used block of size 0 that keeps it
+     * from merging beyond the pool */
+    b->prev_phys = NULL;
+    b->size = size | BLOCK_FREE;
+    block_insert(b);
+
+    tlsf_block_t *sentinel = block_link_next(b);
+    sentinel->size = BLOCK_PREV_FREE;
+
+    tlsf_pool_bytes += size + 2 * HEADER;
+
+    restoreIRQ(state);
+    return 0;
+}
+
+void *tlsf_malloc(size_t size)
+{
+    unsigned state = disableIRQ();
+    void *ptr = _malloc(size);
+    restoreIRQ(state);
+
+    return ptr;
+}
+
+void *tlsf_calloc(size_t num, size_t size)
+{
+    if (size && (num > ((size_t) -1) / size)) {
+        return NULL;
+    }
+
+    void *ptr = tlsf_malloc(num * size);
+
+    if (ptr) {
+        memset(ptr, 0, num * size);
+    }
+
+    return ptr;
+}
+
+void *tlsf_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return tlsf_malloc(size);
+    }
+
+    if (size == 0) {
+        tlsf_free(ptr);
+        return NULL;
+    }
+
+    size_t adjusted = adjust_request(size);
+
+    if (!adjusted) {
+        return NULL;
+    }
+
+    unsigned state = disableIRQ();
+    tlsf_block_t *b = block_of(ptr);
+    tlsf_block_t *next = block_next(b);
+    size_t current = block_size(b);
+    unsigned int owner = block_owner(b);
+
+    if ((adjusted > current) &&
+        (!(next->size & BLOCK_FREE) ||
+         (adjusted > current + block_size(next) + HEADER))) {
+        /* no room in place, move it */
+        void *moved = _malloc(size);
+
+        if (moved) {
+            memcpy(moved, ptr, current);
+            _free(ptr);
+        }
+
+        restoreIRQ(state);
+        return moved;
+    }
+
+    if (adjusted > current) {
+        block_merge_next(b);
+        block_mark_used(b);
+    }
+
+    if (block_can_split(b, adjusted)) {
+        tlsf_block_t *rest = block_split(b, adjusted);
+
+        /* *b* stays in use */
+        rest->size &= ~BLOCK_PREV_FREE;
+        block_insert(block_merge_next(rest));
+    }
+
+    tlsf_stats[owner].used -= current;
+    stats_add(owner, block_size(b));
+
+    restoreIRQ(state);
+    return ptr;
+}
+
+void tlsf_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    unsigned state = disableIRQ();
+    _free(ptr);
+    restoreIRQ(state);
+}
+
+const tlsf_stats_t *tlsf_get_stats(unsigned int pid)
+{
+    if (pid > MAXTHREADS) {
+        return NULL;
+    }
+
+    return &tlsf_stats[pid];
+}
+
+void tlsf_get_frag(tlsf_frag_t *frag)
+{
+    memset(frag, 0, sizeof(*frag));
+
+    unsigned state = disableIRQ();
+
+    frag->pool = tlsf_pool_bytes;
+
+    for (unsigned int fl = 0; fl < FL_COUNT; fl++) {
+        for (unsigned int sl = 0; sl < SL_COUNT; sl++) {
+            for (tlsf_block_t *b = tlsf.blocks[fl][sl]; b; b = b->next_free) {
+                size_t size = block_size(b);
+
+                frag->free += size;
+                frag->blocks++;
+
+                if (size > frag->largest) {
+                    frag->largest = size;
+                }
+            }
+        }
+    }
+
+    restoreIRQ(state);
+}
+
+void tlsf_print_stats(void)
+{
+    tlsf_frag_t frag;
+
+    printf("pid | %-21s | %8s | %8s | %8s | %5s\n",
+           "name", "used", "peak", "allocs", "fails");
+
+    for (unsigned int pid = 0; pid <= MAXTHREADS; pid++) {
+        const tlsf_stats_t *s = &tlsf_stats[pid];
+        const char *name = "-";
+
+        if (!s->allocs && !s->fails) {
+            continue;
+        }
+
+        if ((pid < MAXTHREADS) && sched_threads[pid]) {
+            name = sched_threads[pid]->name;
+        }
+
+        printf("%3u | %-21s | %8u | %8u | %8u | %5u\n", pid, name,
+               (unsigned int) s->used, (unsigned int) s->peak, s->allocs,
+               s->fails);
+    }
+
+    tlsf_get_frag(&frag);
+
+    /* the share of free memory not in the largest block, what a request
+     * that should fit may fail on */
+    unsigned int percent = frag.free ?
+        (unsigned int) (100 - (uint64_t) frag.largest * 100 / frag.free) : 0;
+
+    printf("pool %u bytes, free %u bytes in %u blocks, largest %u, "
+           "fragmentation %u%%\n", (unsigned int) frag.pool,
+           (unsigned int) frag.free, frag.blocks,
+           (unsigned int) frag.largest, percent);
+}
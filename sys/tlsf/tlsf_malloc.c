@@ -0,0 +1,110 @@
+/**
+ * TLSF as the system allocator
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_tlsf
+ * @{
+ * @file    tlsf_malloc.c
+ * @brief   malloc() and friends served by TLSF, selected with
+ *          `USEMODULE += tlsf_malloc`
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdlib.h>
+
+#include "tlsf.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+extern void *sbrk(int incr);
+
+/* adds a pool from sbrk() large enough for a request of *size* bytes */
+static int tlsf_grow(size_t size)
+{
+    size_t bytes = size + TLSF_POOL_OVERHEAD + sizeof(void *);
+
+    if (bytes < TLSF_MALLOC_GROW) {
+        bytes = TLSF_MALLOC_GROW;
+    }
+
+    void *mem = sbrk(bytes);
+
+    if (mem == (void *) -1) {
+        DEBUG("tlsf_grow(): sbrk failed for %u bytes\n", (unsigned int) bytes);
+        return 0;
+    }
+
+    return tlsf_add_pool(mem, bytes) == 0;
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = tlsf_malloc(size);
+
+    if ((ptr == NULL) && size && tlsf_grow(size)) {
+        ptr = tlsf_malloc(size);
+    }
+
+    return ptr;
+}
+
+void *calloc(size_t num, size_t size)
+{
+    void *ptr = tlsf_calloc(num, size);
+
+    if ((ptr == NULL) && num && size && tlsf_grow(num * size)) {
+        ptr = tlsf_calloc(num, size);
+    }
+
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *moved = tlsf_realloc(ptr, size);
+
+    if ((moved == NULL) && size && tlsf_grow(size)) {
+        moved = tlsf_realloc(ptr, size);
+    }
+
+    return moved;
+}
+
+void free(void *ptr)
+{
+    tlsf_free(ptr);
+}
+
+#ifdef _NEWLIB_VERSION
+/* newlib calls these itself, e.g. for stdio buffers */
+void *_malloc_r(struct _reent *r, size_t size)
+{
+    (void) r;
+    return malloc(size);
+}
+
+void *_calloc_r(struct _reent *r, size_t num, size_t size)
+{
+    (void) r;
+    return calloc(num, size);
+}
+
+void *_realloc_r(struct _reent *r, void *ptr, size_t size)
+{
+    (void) r;
+    return realloc(ptr, size);
+}
+
+void _free_r(struct _reent *r, void *ptr)
+{
+    (void) r;
+    free(ptr);
+}
+#endif
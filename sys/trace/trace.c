@@ -0,0 +1,84 @@
+/**
+ * Binary event tracer
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_trace
+ * @{
+ * @file    trace.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stdio.h>
+
+#include "hwtimer.h"
+#include "irq.h"
+#include "sched.h"
+#include "trace.h"
+
+#if (TRACE_SIZE & (TRACE_SIZE - 1))
+#error "TRACE_SIZE must be a power of two"
+#endif
+
+static trace_record_t ring[TRACE_SIZE];
+static unsigned int next;           /* records written since the clear */
+static volatile int enabled = 1;
+
+void trace_record(uint8_t event, uint16_t arg)
+{
+    trace_record_t *r;
+    unsigned int state;
+
+    if (!enabled) {
+        return;
+    }
+
+    state = disableIRQ();
+    r = &ring[next++ & (TRACE_SIZE - 1)];
+    r->time = hwtimer_now();
+    r->event = event;
+    r->pid = (inISR() || (thread_pid < 0)) ? TRACE_PID_ISR : thread_pid;
+    r->arg = arg;
+    restoreIRQ(state);
+}
+
+void trace_enable(int on)
+{
+    enabled = on;
+}
+
+void trace_clear(void)
+{
+    unsigned int state = disableIRQ();
+    next = 0;
+    restoreIRQ(state);
+}
+
+void trace_dump(void)
+{
+    int was_enabled = enabled;
+    unsigned int first = 0;
+
+    enabled = 0;
+
+    if (next > TRACE_SIZE) {
+        first = next - TRACE_SIZE;
+    }
+
+    printf("TRACE begin hz=%lu records=%u lost=%u\n",
+           (unsigned long) HWTIMER_SPEED, next - first, first);
+
+    for (unsigned int i = first; i != next; i++) {
+        trace_record_t *r = &ring[i & (TRACE_SIZE - 1)];
+        printf("TRACE %08lx %02x %02x %04x\n", (unsigned long) r->time,
+               r->event, r->pid, r->arg);
+    }
+
+    puts("TRACE end");
+    enabled = was_enabled;
+}
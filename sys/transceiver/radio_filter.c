@@ -0,0 +1,192 @@
+/**
+ * Early frame filter for radio drivers
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup transceiver
+ * @{
+ * @file    radio_filter.c
+ * @brief   Frame acceptance filter shared by the radio drivers.
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "radio/filter.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+#define IGNORE_MASK     (RADIO_FILTER_IGNORE_SIZE - 1)
+
+/* field layout as read by ieee802154_frame_read() */
+#define FCF_TYPE(h)         ((h)[0] & 0x07)
+#define FCF_PANID_COMP(h)   (((h)[0] >> 6) & 0x01)
+#define FCF_DEST_M(h)       (((h)[1] >> 2) & 0x03)
+#define FCF_SRC_M(h)        (((h)[1] >> 6) & 0x03)
+
+#define ADDR_M_SHORT        (2)
+#define ADDR_M_LONG         (3)
+
+/* multiplicative hash, spreads consecutive node addresses over the set */
+static uint8_t ignore_hash(radio_address_t addr)
+{
+    return (uint16_t)(addr * 40503u) >> (16 - RADIO_FILTER_IGNORE_BITS);
+}
+
+void radio_filter_init(radio_filter_t *filter, uint8_t flags)
+{
+    memset(filter, 0, sizeof(radio_filter_t));
+    filter->pan = RADIO_FILTER_ANY;
+    filter->addr = RADIO_FILTER_ANY;
+    filter->frame_types = RADIO_FILTER_TYPE(0) | RADIO_FILTER_TYPE(1) |
+                          RADIO_FILTER_TYPE(3);
+    filter->flags = flags;
+}
+
+int16_t radio_filter_ignore_add(radio_filter_t *filter, radio_address_t addr)
+{
+    uint8_t i = ignore_hash(addr);
+    uint8_t n;
+
+    if (addr == 0) {
+        /* marks free entries */
+        return -1;
+    }
+
+    for (n = 0; n < RADIO_FILTER_IGNORE_SIZE; n++, i = (i + 1) & IGNORE_MASK) {
+        if (filter->ignored[i] == addr) {
+            return i;
+        }
+
+        if (filter->ignored[i] == 0) {
+            filter->ignored[i] = addr;
+            filter->ignored_numof++;
+            DEBUG("radio_filter: ignoring %u (%u)\n", addr, i);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void radio_filter_ignore_clear(radio_filter_t *filter)
+{
+    memset(filter->ignored, 0, sizeof(filter->ignored));
+    filter->ignored_numof = 0;
+}
+
+int radio_filter_is_ignored(const radio_filter_t *filter, radio_address_t addr)
+{
+    uint8_t i = ignore_hash(addr);
+    uint8_t n;
+
+    if (filter->ignored_numof == 0) {
+        return 0;
+    }
+
+    /* entries are never removed one by one, so a free entry ends the probe */
+    for (n = 0; n < RADIO_FILTER_IGNORE_SIZE; n++, i = (i + 1) & IGNORE_MASK) {
+        if (filter->ignored[i] == addr) {
+            return 1;
+        }
+
+        if (filter->ignored[i] == 0) {
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+uint8_t radio_filter_ieee802154_hdr_len(const uint8_t *fcf)
+{
+    static const uint8_t addr_len[] = { 0, 0, 2, 8 };
+    uint8_t len = 3 + addr_len[FCF_DEST_M(fcf)] + addr_len[FCF_SRC_M(fcf)];
+
+    if (FCF_DEST_M(fcf) != 0) {
+        len += 2;
+    }
+
+    if ((FCF_SRC_M(fcf) != 0) && !FCF_PANID_COMP(fcf)) {
+        len += 2;
+    }
+
+    return len;
+}
+
+int radio_filter_ieee802154(const radio_filter_t *filter, const uint8_t *hdr,
+                            uint8_t len)
+{
+    uint8_t index = 3;
+    uint8_t check_addr;
+    uint16_t pan;
+
+    if (len < index) {
+        return 0;
+    }
+
+    if (!(filter->frame_types & RADIO_FILTER_TYPE(FCF_TYPE(hdr)))) {
+        return 0;
+    }
+
+    check_addr = !filter->monitor && !(filter->flags & RADIO_FILTER_HW_ADDR);
+
+    if (FCF_DEST_M(hdr) != 0) {
+        if (len < index + 2) {
+            return 0;
+        }
+
+        pan = (((uint16_t) hdr[index]) << 8) | hdr[index + 1];
+
+        if (check_addr && (filter->pan != RADIO_FILTER_ANY) &&
+            (pan != filter->pan) && (pan != RADIO_FILTER_ANY)) {
+            DEBUG("radio_filter: frame for PAN %04x\n", pan);
+            return 0;
+        }
+
+        index += 2;
+    }
+
+    if (FCF_DEST_M(hdr) == ADDR_M_SHORT) {
+        radio_address_t dst;
+
+        if (len < index + 2) {
+            return 0;
+        }
+
+        dst = hdr[index] | (((uint16_t) hdr[index + 1]) << 8);
+
+        if (check_addr && (filter->addr != RADIO_FILTER_ANY) &&
+            (dst != filter->addr) && (dst != RADIO_FILTER_ANY)) {
+            DEBUG("radio_filter: frame for %u\n", dst);
+            return 0;
+        }
+
+        index += 2;
+    }
+    else if (FCF_DEST_M(hdr) == ADDR_M_LONG) {
+        index += 8;
+    }
+
+    if ((filter->ignored_numof == 0) || (FCF_SRC_M(hdr) != ADDR_M_SHORT)) {
+        return 1;
+    }
+
+    if (!FCF_PANID_COMP(hdr)) {
+        index += 2;
+    }
+
+    if (len < index + 2) {
+        /* source not in the given bytes, let the caller decide later */
+        return 1;
+    }
+
+    return !radio_filter_is_ignored(filter, hdr[index] |
+                                    (((uint16_t) hdr[index + 1]) << 8));
+}
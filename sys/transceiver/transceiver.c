@@ -17,15 +17,21 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <inttypes.h>
 
 #include "thread.h"
 #include "msg.h"
+#include "mutex.h"
 #include "irq.h"
+#include "vtimer.h"
+#include "hwtimer.h"
+#include "trace.h"
 
 #include "radio/types.h"
+#include "radio/filter.h"
 
 #include "transceiver.h"
 
@@ -50,6 +56,10 @@
 #include "ieee802154_frame.h"
 #endif
 
+#ifdef MODULE_RANDOM
+#include "random.h"
+#endif
+
 #ifdef MODULE_NATIVENET
 #include "nativenet.h"
 #include "nativenet_internal.h"
@@ -60,6 +70,10 @@
 #include "ieee802154_frame.h"
 #endif
 
+#ifdef MODULE_PCAP
+#include "pcap.h"
+#endif
+
 #define ENABLE_DEBUG (0)
 #if ENABLE_DEBUG
 #define DEBUG_ENABLED
@@ -68,6 +82,13 @@
 #endif
 #include "debug.h"
 
+/* a build with one driver calls it without looking at the type */
+#ifdef TRANSCEIVER_SINGLE
+#define DISPATCH(t)     ((void)(t), TRANSCEIVER_SINGLE)
+#else
+#define DISPATCH(t)     (t)
+#endif
+
 /*------------------------------------------------------------------------------------*/
 /* used transceiver types */
 transceiver_type_t transceivers = TRANSCEIVER_NONE;
@@ -83,16 +104,91 @@ radio_packet_t transceiver_buffer[TRANSCEIVER_BUFFER_SIZE];
 #endif
 uint8_t data_buffer[TRANSCEIVER_BUFFER_SIZE * PAYLOAD_SIZE];
 
-/* message buffer */
-msg_t msg_buffer[TRANSCEIVER_MSG_BUFFER_SIZE];
-
-uint32_t response; ///< response bytes for messages to upper layer threads
+#ifdef MODULE_MC1322X
+/* the maca DMA buffer a slot's frame lies in, returned to the maca with
+ * the last token of the slot */
+static volatile maca_packet_t *mc1322x_rx_pkt[TRANSCEIVER_BUFFER_SIZE];
+#endif
 
-int transceiver_pid = -1; ///< the transceiver thread's pid
+int transceiver_pid = -1; ///< the first worker thread's pid
 
 static volatile uint8_t rx_buffer_pos = 0;
 static volatile uint8_t transceiver_buffer_pos = 0;
 
+/* where transceiver_rx_reserve() starts looking for a free slot */
+static uint8_t rx_ring_head = 0;
+static transceiver_rx_stats_t rx_stats;
+
+/* transmit queue, served in priority order and FIFO within a priority */
+typedef struct {
+    uint8_t used;
+    uint8_t priority;
+    uint8_t attempts;
+    uint8_t queued;                 ///< 1 for SND_PKT_QUEUED, 0 otherwise
+    uint8_t channel;                ///< of the receiver, 0 for a broadcast
+    uint16_t channels_todo;         ///< of the set, a broadcast still needs
+    uint16_t tag;
+    uint16_t seq;
+    transceiver_type_t transceivers;
+    msg_t request;                  ///< to reply to or notify when done
+    void *packet;
+} tx_entry_t;
+
+/*
+ * Every compiled in driver gets a worker thread of its own with its own
+ * message queue and transmit queue, so a radio busy sending or backing off
+ * does not hold up the others.
+ */
+typedef struct {
+    transceiver_type_t type;        ///< the transceiver served
+    int pid;                        ///< -1 if not started
+    msg_t msg_buffer[TRANSCEIVER_MSG_BUFFER_SIZE];
+    tx_entry_t tx_queue[TRANSCEIVER_TX_QUEUE_SIZE];
+#if MODULE_AT86RF231 || MODULE_CC2420 || MODULE_MC1322X
+    ieee802154_packet_t tx_packets[TRANSCEIVER_TX_QUEUE_SIZE];
+#else
+    radio_packet_t tx_packets[TRANSCEIVER_TX_QUEUE_SIZE];
+#endif
+    uint8_t tx_data[TRANSCEIVER_TX_QUEUE_SIZE][PAYLOAD_SIZE];
+    uint16_t tx_seq;
+    uint8_t tx_dsn;                 ///< IEEE 802.15.4 sequence number
+    vtimer_t tx_backoff_timer;
+    uint8_t tx_backoff_pending;
+    mutex_t lock;                   ///< held while the driver is used
+    /* multi-channel operation, off while ch_num is 0 */
+    uint8_t ch_set[TRANSCEIVER_CHANNELS_MAX];
+    uint8_t ch_num;
+    uint8_t ch_home;
+    uint8_t ch_cur;
+    uint8_t ch_batch;               ///< frames sent since the last switch
+    transceiver_nbr_channel_t ch_nbrs[TRANSCEIVER_CHANNEL_NEIGHBORS];
+    transceiver_channel_stats_t ch_stats;
+} transceiver_worker_t;
+
+static const transceiver_type_t worker_types[] = {
+#if MODULE_CC110X_NG || MODULE_CC110X
+    TRANSCEIVER_CC1100,
+#endif
+#if MODULE_CC2420
+    TRANSCEIVER_CC2420,
+#endif
+#if MODULE_MC1322X
+    TRANSCEIVER_MC1322X,
+#endif
+#if MODULE_NATIVENET
+    TRANSCEIVER_NATIVE,
+#endif
+#if MODULE_AT86RF231
+    TRANSCEIVER_AT86RF231,
+#endif
+    TRANSCEIVER_NONE
+};
+
+#define WORKERS_NUMOF   (sizeof(worker_types) / sizeof(worker_types[0]) - 1)
+
+static transceiver_worker_t workers[WORKERS_NUMOF];
+static char worker_stacks[WORKERS_NUMOF][TRANSCEIVER_STACK_SIZE];
+
 #ifdef MODULE_CC110X
 void *cc1100_payload;
 int cc1100_payload_size;
@@ -101,9 +197,6 @@ uint8_t cc1100_pkt[CC1100_MAX_DATA_LENGTH];
 #endif
 
 
-/* transceiver stack */
-char transceiver_stack[TRANSCEIVER_STACK_SIZE];
-
 /*------------------------------------------------------------------------------------*/
 /* function prototypes */
 static void run(void);
@@ -118,13 +211,23 @@ void receive_cc1100_packet(radio_packet_t *trans_p);
 #ifdef MODULE_CC2420
 static void receive_cc2420_packet(ieee802154_packet_t *trans_p);
 #endif
-#ifdef MODULE_NATIVENET
-static void receive_nativenet_packet(radio_packet_t *trans_p);
+#ifdef MODULE_MC1322X
+static int receive_mc1322x_packet(ieee802154_packet_t *trans_p);
 #endif
 #ifdef MODULE_AT86RF231
 void receive_at86rf231_packet(ieee802154_packet_t *trans_p);
 #endif
 static int8_t send_packet(transceiver_type_t t, void *pkt);
+static uint8_t tx_enqueue(transceiver_worker_t *w, msg_t *m,
+                          transceiver_type_t t, void *pkt,
+                          uint8_t priority, uint16_t tag, uint8_t queued);
+static void tx_process(transceiver_worker_t *w);
+static uint32_t config(uint16_t type, transceiver_command_t *cmd);
+static transceiver_worker_t *find_worker(transceiver_type_t t);
+static void channels_set(transceiver_worker_t *w, transceiver_type_t t,
+                         transceiver_channels_t *chs);
+static void channel_switch(transceiver_worker_t *w, transceiver_type_t t,
+                           uint8_t channel);
 static int32_t get_channel(transceiver_type_t t);
 static int32_t set_channel(transceiver_type_t t, void *channel);
 static radio_address_t get_address(transceiver_type_t t);
@@ -138,13 +241,18 @@ static int32_t set_pan(transceiver_type_t t, void *pan);
 static void set_monitor(transceiver_type_t t, void *mode);
 static void powerdown(transceiver_type_t t);
 static void switch_to_rx(transceiver_type_t t);
+static int switch_to_wor(transceiver_type_t t, transceiver_wor_t *wor);
+static int set_ext_mode(transceiver_type_t t, transceiver_ext_mode_t *mode);
 
 #ifdef DBG_IGNORE
 static int16_t ignore_add(transceiver_type_t transceiver, void *address);
 
-#define MAX_IGNORED_ADDR     (10)
+/* ignore set for radios whose driver has no filter of its own */
+static radio_filter_t ignore_filter;
+#endif
 
-radio_address_t ignored_addr[MAX_IGNORED_ADDR];
+#ifdef MODULE_PCAP
+static void capture(transceiver_type_t t, int slot);
 #endif
 
 /*------------------------------------------------------------------------------------*/
@@ -160,9 +268,18 @@ void transceiver_init(transceiver_type_t t)
 
     /* Initializing transceiver buffer and data buffer */
     memset(transceiver_buffer, 0, sizeof(transceiver_buffer));
+    memset(&rx_stats, 0, sizeof(rx_stats));
+    rx_ring_head = 0;
+    memset(workers, 0, sizeof(workers));
+
+    for (i = 0; i < WORKERS_NUMOF; i++) {
+        workers[i].type = worker_types[i];
+        workers[i].pid = -1;
+        mutex_init(&workers[i].lock);
+    }
     memset(data_buffer, 0, TRANSCEIVER_BUFFER_SIZE * PAYLOAD_SIZE);
 #ifdef DBG_IGNORE
-    memset(ignored_addr, 0, MAX_IGNORED_ADDR * sizeof(radio_address_t));
+    radio_filter_init(&ignore_filter, 0);
 #endif
 
     for (i = 0; i < TRANSCEIVER_MAX_REGISTERED; i++) {
@@ -179,59 +296,176 @@ void transceiver_init(transceiver_type_t t)
     }
 }
 
-/* Start the transceiver thread */
+/* Start the transceiver threads */
 int transceiver_start(void)
 {
-    transceiver_pid = thread_create(transceiver_stack, TRANSCEIVER_STACK_SIZE, PRIORITY_MAIN - 3, CREATE_STACKTEST, run, "Transceiver");
+    for (uint8_t i = 0; i < WORKERS_NUMOF; i++) {
+        transceiver_worker_t *w = &workers[i];
 
-    if (transceiver_pid < 0) {
-        puts("Error creating transceiver thread");
-    }
+        if (!(transceivers & w->type)) {
+            continue;
+        }
+
+        /* the worker looks itself up by its pid, so it may run only
+         * after the pid is stored */
+        w->pid = thread_create(worker_stacks[i], TRANSCEIVER_STACK_SIZE,
+                               PRIORITY_MAIN - 3,
+                               CREATE_STACKTEST | CREATE_SLEEPING, run,
+                               "Transceiver");
+
+        if (w->pid < 0) {
+            puts("Error creating transceiver thread");
+            continue;
+        }
+
+        thread_wakeup(w->pid);
+
+        if (transceiver_pid < 0) {
+            transceiver_pid = w->pid;
+        }
 
+        switch (DISPATCH(w->type)) {
 #ifdef MODULE_CC110X_NG
-    else if (transceivers & TRANSCEIVER_CC1100) {
-        DEBUG("transceiver: Transceiver started for CC1100\n");
-        cc110x_init(transceiver_pid);
-    }
 
+            case TRANSCEIVER_CC1100:
+                DEBUG("transceiver: Transceiver started for CC1100\n");
+                cc110x_init(w->pid);
+                break;
 #endif
 #ifdef MODULE_CC110X
-    else if (transceivers & TRANSCEIVER_CC1100) {
-        DEBUG("transceiver: Transceiver started for CC1100\n");
-        cc1100_init();
-        cc1100_set_packet_monitor(cc1100_packet_monitor);
-    }
 
+            case TRANSCEIVER_CC1100:
+                DEBUG("transceiver: Transceiver started for CC1100\n");
+                cc1100_init();
+                cc1100_set_packet_monitor(cc1100_packet_monitor);
+                break;
 #endif
 #ifdef MODULE_CC2420
-    else if (transceivers & TRANSCEIVER_CC2420) {
-        DEBUG("transceiver: Transceiver started for CC2420\n");
-        cc2420_init(transceiver_pid);
-    }
 
+            case TRANSCEIVER_CC2420:
+                DEBUG("transceiver: Transceiver started for CC2420\n");
+                cc2420_init(w->pid);
+                break;
 #endif
 #ifdef MODULE_AT86RF231
-    else if (transceivers & TRANSCEIVER_AT86RF231) {
-        DEBUG("transceiver: Transceiver started for AT86RF231\n");
-        at86rf231_init(transceiver_pid);
-    }
 
+            case TRANSCEIVER_AT86RF231:
+                DEBUG("transceiver: Transceiver started for AT86RF231\n");
+                at86rf231_init(w->pid);
+                break;
 #endif
 #ifdef MODULE_MC1322X
-    else if (transceivers & TRANSCEIVER_MC1322X) {
-        maca_init();
-    }
 
+            case TRANSCEIVER_MC1322X:
+                maca_init();
+                break;
 #endif
 #ifdef MODULE_NATIVENET
-    else if (transceivers & TRANSCEIVER_NATIVE) {
-        nativenet_init(transceiver_pid);
-    }
 
+            case TRANSCEIVER_NATIVE:
+                nativenet_init(w->pid);
+                break;
 #endif
+
+            default:
+                break;
+        }
+    }
+
     return transceiver_pid;
 }
 
+/* the running worker of a transceiver, NULL if there is none */
+static transceiver_worker_t *find_worker(transceiver_type_t t)
+{
+    for (uint8_t i = 0; i < WORKERS_NUMOF; i++) {
+        if ((workers[i].type & t) && (workers[i].pid >= 0)) {
+            return &workers[i];
+        }
+    }
+
+    return NULL;
+}
+
+int transceiver_get_pid(transceiver_type_t t)
+{
+    transceiver_worker_t *w = find_worker(t);
+
+    return (w != NULL) ? w->pid : -1;
+}
+
+uint32_t transceiver_config(uint16_t type, transceiver_command_t *cmd)
+{
+    transceiver_worker_t *w = find_worker(cmd->transceivers);
+    uint32_t res;
+
+    if (w == NULL) {
+        return (uint32_t) -1;
+    }
+
+    mutex_lock(&w->lock);
+    res = config(type, cmd);
+    mutex_unlock(&w->lock);
+
+    return res;
+}
+
+void transceiver_get_channel_stats(transceiver_type_t t,
+                                   transceiver_channel_stats_t *stats)
+{
+    transceiver_worker_t *w = find_worker(t);
+
+    if (w == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    mutex_lock(&w->lock);
+    memcpy(stats, &w->ch_stats, sizeof(*stats));
+    mutex_unlock(&w->lock);
+}
+
+/* the worker of the calling thread, NULL if it is none */
+static transceiver_worker_t *worker_self(void)
+{
+    int pid = thread_getpid();
+
+    for (uint8_t i = 0; i < WORKERS_NUMOF; i++) {
+        if (workers[i].pid == pid) {
+            return &workers[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* the transceiver type a driver message is from */
+static transceiver_type_t rcv_type_to_transceiver(uint16_t type)
+{
+    switch (type) {
+        case RCV_PKT_CC1020:
+            return TRANSCEIVER_CC1020;
+
+        case RCV_PKT_CC1100:
+            return TRANSCEIVER_CC1100;
+
+        case RCV_PKT_CC2420:
+            return TRANSCEIVER_CC2420;
+
+        case RCV_PKT_MC1322X:
+            return TRANSCEIVER_MC1322X;
+
+        case RCV_PKT_NATIVE:
+            return TRANSCEIVER_NATIVE;
+
+        case RCV_PKT_AT86RF231:
+            return TRANSCEIVER_AT86RF231;
+
+        default:
+            return TRANSCEIVER_NONE;
+    }
+}
+
 /* Register an upper layer thread */
 uint8_t transceiver_register(transceiver_type_t t, int pid)
 {
@@ -253,6 +487,109 @@ uint8_t transceiver_register(transceiver_type_t t, int pid)
     }
 }
 
+/*------------------------------------------------------------------------------------*/
+/*                               Receive buffer                                       */
+/*------------------------------------------------------------------------------------*/
+/*
+ * The ISRs of the drivers are the only producers, the slots are handed out
+ * round-robin starting at rx_ring_head. The processing field of a slot
+ * counts the tokens of its owners: one for the producer from reserve to
+ * commit and one for every registered thread notified about it. A slot with
+ * owners is skipped instead of overwritten.
+ */
+int transceiver_rx_reserve(void)
+{
+    unsigned state = disableIRQ();
+
+    for (uint8_t i = 0; i < TRANSCEIVER_BUFFER_SIZE; i++) {
+        uint8_t slot = rx_ring_head;
+
+        if (++rx_ring_head == TRANSCEIVER_BUFFER_SIZE) {
+            rx_ring_head = 0;
+        }
+
+        if (!transceiver_buffer[slot].processing) {
+            transceiver_buffer[slot].processing = 1;
+            rx_stats.received++;
+            TRACE(TRACE_TRANSCEIVER_RX, slot);
+            restoreIRQ(state);
+            return slot;
+        }
+    }
+
+    rx_stats.no_slot++;
+    TRACE(TRACE_TRANSCEIVER_NO_SLOT, 0);
+    restoreIRQ(state);
+    return -1;
+}
+
+void *transceiver_rx_get_packet(int slot)
+{
+    return &transceiver_buffer[slot];
+}
+
+uint8_t *transceiver_rx_get_payload(int slot)
+{
+    return &data_buffer[slot * PAYLOAD_SIZE];
+}
+
+int transceiver_rx_commit(uint16_t type, int slot)
+{
+    msg_t m;
+
+    m.type = type;
+    m.content.value = slot;
+
+    if (msg_send_int(&m, transceiver_get_pid(rcv_type_to_transceiver(type))) < 1) {
+        rx_stats.not_queued++;
+        transceiver_rx_cancel(slot);
+        return 0;
+    }
+
+    return 1;
+}
+
+void transceiver_rx_cancel(int slot)
+{
+    transceiver_release(&transceiver_buffer[slot]);
+}
+
+void transceiver_release(void *packet)
+{
+    unsigned state;
+    unsigned int slot = ((char *) packet - (char *) transceiver_buffer) /
+                        sizeof(transceiver_buffer[0]);
+
+    if (slot >= TRANSCEIVER_BUFFER_SIZE) {
+        DEBUG("transceiver: release of unknown packet %p\n", packet);
+        return;
+    }
+
+    state = disableIRQ();
+
+    if ((transceiver_buffer[slot].processing > 0) &&
+        (--transceiver_buffer[slot].processing == 0)) {
+        TRACE(TRACE_TRANSCEIVER_RELEASE, slot);
+#ifdef MODULE_MC1322X
+
+        if (mc1322x_rx_pkt[slot] != NULL) {
+            maca_free_packet(mc1322x_rx_pkt[slot]);
+            mc1322x_rx_pkt[slot] = NULL;
+        }
+
+#endif
+    }
+
+    restoreIRQ(state);
+}
+
+void transceiver_get_rx_stats(transceiver_rx_stats_t *stats)
+{
+    unsigned state = disableIRQ();
+    memcpy(stats, &rx_stats, sizeof(rx_stats));
+    restoreIRQ(state);
+}
+
 /*------------------------------------------------------------------------------------*/
 /*                                Internal functions                                  */
 /*------------------------------------------------------------------------------------*/
@@ -265,8 +602,9 @@ void run(void)
 {
     msg_t m;
     transceiver_command_t *cmd;
+    transceiver_worker_t *w = worker_self();
 
-    msg_init_queue(msg_buffer, TRANSCEIVER_MSG_BUFFER_SIZE);
+    msg_init_queue(w->msg_buffer, TRANSCEIVER_MSG_BUFFER_SIZE);
 
     while (1) {
         DEBUG("transceiver: Waiting for next message\n");
@@ -275,6 +613,9 @@ void run(void)
         cmd = (transceiver_command_t *) m.content.ptr;
         DEBUG("transceiver: Transceiver: Message received, type: %02X\n", m.type);
 
+        /* transceiver_config() uses the driver in other threads meanwhile */
+        mutex_lock(&w->lock);
+
         switch (m.type) {
             case RCV_PKT_CC1020:
             case RCV_PKT_CC1100:
@@ -286,139 +627,251 @@ void run(void)
                 break;
 
             case SND_PKT:
-                response = send_packet(cmd->transceivers, cmd->data);
-                m.content.value = response;
-                msg_reply(&m, &m);
+                /* the reply is sent when the packet is done */
+                if (!tx_enqueue(w, &m, cmd->transceivers, cmd->data,
+                                TRANSCEIVER_TX_PRIO_DATA, 0, 0)) {
+                    m.content.value = (uint32_t) -1;
+                    msg_reply(&m, &m);
+                }
+
+                tx_process(w);
                 break;
 
-            case GET_CHANNEL:
-                *((int32_t *) cmd->data) = get_channel(cmd->transceivers);
-                msg_reply(&m, &m);
-                break;
+            case SND_PKT_PRIO: {
+                transceiver_tx_request_t *req = cmd->data;
 
-            case SET_CHANNEL:
-                *((int32_t *) cmd->data) = set_channel(cmd->transceivers, cmd->data);
-                msg_reply(&m, &m);
-                break;
+                if (!tx_enqueue(w, &m, cmd->transceivers, req->packet,
+                                req->priority, 0, 0)) {
+                    m.content.value = (uint32_t) -1;
+                    msg_reply(&m, &m);
+                }
 
-            case GET_ADDRESS:
-                *((radio_address_t *) cmd->data) = get_address(cmd->transceivers);
-                msg_reply(&m, &m);
+                tx_process(w);
                 break;
+            }
 
-            case SET_ADDRESS:
-                *((radio_address_t *) cmd->data) = set_address(cmd->transceivers, cmd->data);
-                msg_reply(&m, &m);
-                break;
+            case SND_PKT_QUEUED: {
+                transceiver_tx_request_t *req = cmd->data;
 
-            case GET_LONG_ADDR:
-                *((transceiver_eui64_t *) cmd->data) = get_long_addr(cmd->transceivers);
+                m.content.value = tx_enqueue(w, &m, cmd->transceivers,
+                                             req->packet, req->priority,
+                                             req->tag, 1);
                 msg_reply(&m, &m);
+                tx_process(w);
                 break;
+            }
 
-            case SET_LONG_ADDR:
-                *((transceiver_eui64_t *) cmd->data) = set_long_addr(cmd->transceivers, cmd->data);
-                msg_reply(&m, &m);
+            case MSG_TIMER:
+                w->tx_backoff_pending = 0;
+                tx_process(w);
                 break;
 
             case SET_MONITOR:
-                set_monitor(cmd->transceivers, cmd->data);
-                break;
-
             case POWERDOWN:
-                powerdown(cmd->transceivers);
-                break;
-
             case SWITCH_RX:
-                switch_to_rx(cmd->transceivers);
+                config(m.type, cmd);
                 break;
 
-            case GET_PAN:
-                *((int32_t *) cmd->data) = get_pan(cmd->transceivers);
+            case SWITCH_WOR:
+            case SET_EXT_MODE:
+            case SET_CHANNELS:
+            case SET_NBR_CHANNEL:
+                m.content.value = config(m.type, cmd);
                 msg_reply(&m, &m);
                 break;
 
+            case GET_CHANNEL:
+            case SET_CHANNEL:
+            case GET_ADDRESS:
+            case SET_ADDRESS:
+            case GET_LONG_ADDR:
+            case SET_LONG_ADDR:
+            case GET_PAN:
             case SET_PAN:
-                *((int32_t *) cmd->data) = set_pan(cmd->transceivers, cmd->data);
-                msg_reply(&m, &m);
-                break;
 #ifdef DBG_IGNORE
-
             case DBG_IGN:
-                *((int16_t *) cmd->data) = ignore_add(cmd->transceivers, cmd->data);
+#endif
+                config(m.type, cmd);
                 msg_reply(&m, &m);
                 break;
-#endif
 
             default:
                 DEBUG("transceiver: Unknown message received\n");
                 break;
         }
+
+        mutex_unlock(&w->lock);
     }
 }
 
 /*------------------------------------------------------------------------------------*/
 /*
- * @brief Processes a packet received by any transceiver device
+ * @brief Runs a command that configures a transceiver or asks for its
+ * configuration, with the worker's lock held
  *
- * @param type  The message type to determine which device has received the
- * packet
- * @param pos   The current device driver's buffer position
+ * @param type  The message type
+ * @param cmd   The command
+ *
+ * @return The value SWITCH_WOR and SET_EXT_MODE reply with, 0 for the other
+ * commands, (uint32_t) -1 for an unknown one
  */
-static void receive_packet(uint16_t type, uint8_t pos)
+static uint32_t config(uint16_t type, transceiver_command_t *cmd)
 {
-    uint8_t i = 0;
-    transceiver_type_t t;
-    rx_buffer_pos = pos;
-    msg_t m;
+    switch (type) {
+        case GET_CHANNEL:
+            *((int32_t *) cmd->data) = get_channel(cmd->transceivers);
+            break;
 
-    DEBUG("Packet received\n");
+        case SET_CHANNEL: {
+            transceiver_worker_t *w = find_worker(cmd->transceivers);
+
+            *((int32_t *) cmd->data) = set_channel(cmd->transceivers, cmd->data);
+
+            /* with several channels this moves the home channel */
+            if ((w != NULL) && w->ch_num && (*((int32_t *) cmd->data) > 0)) {
+                w->ch_home = w->ch_cur = *((int32_t *) cmd->data);
+            }
 
-    switch (type) {
-        case RCV_PKT_CC1020:
-            t = TRANSCEIVER_CC1020;
             break;
+        }
 
-        case RCV_PKT_CC1100:
-            t = TRANSCEIVER_CC1100;
+        case SET_CHANNELS: {
+            transceiver_worker_t *w = find_worker(cmd->transceivers);
+
+            if (w == NULL) {
+                return (uint32_t) -1;
+            }
+
+            channels_set(w, cmd->transceivers, cmd->data);
             break;
+        }
+
+        case SET_NBR_CHANNEL: {
+            transceiver_worker_t *w = find_worker(cmd->transceivers);
+            transceiver_nbr_channel_t *nbr = cmd->data;
+            transceiver_nbr_channel_t *free = NULL;
+
+            if (w == NULL) {
+                return (uint32_t) -1;
+            }
+
+            for (uint8_t i = 0; i < TRANSCEIVER_CHANNEL_NEIGHBORS; i++) {
+                transceiver_nbr_channel_t *e = &w->ch_nbrs[i];
+
+                if (e->channel && (e->addr == nbr->addr)) {
+                    e->channel = nbr->channel;
+                    return 0;
+                }
+
+                if (!e->channel && (free == NULL)) {
+                    free = e;
+                }
+            }
+
+            if (nbr->channel) {
+                if (free == NULL) {
+                    return (uint32_t) -1;
+                }
+
+                *free = *nbr;
+            }
 
-        case RCV_PKT_CC2420:
-            t = TRANSCEIVER_CC2420;
             break;
+        }
 
-        case RCV_PKT_MC1322X:
-            t = TRANSCEIVER_MC1322X;
+        case GET_ADDRESS:
+            *((radio_address_t *) cmd->data) = get_address(cmd->transceivers);
             break;
 
-        case RCV_PKT_NATIVE:
-            t = TRANSCEIVER_NATIVE;
+        case SET_ADDRESS:
+            *((radio_address_t *) cmd->data) = set_address(cmd->transceivers, cmd->data);
             break;
 
-        case RCV_PKT_AT86RF231:
-            t = TRANSCEIVER_AT86RF231;
+        case GET_LONG_ADDR:
+            *((transceiver_eui64_t *) cmd->data) = get_long_addr(cmd->transceivers);
             break;
 
-        default:
-            t = TRANSCEIVER_NONE;
+        case SET_LONG_ADDR:
+            *((transceiver_eui64_t *) cmd->data) = set_long_addr(cmd->transceivers, cmd->data);
+            break;
+
+        case SET_MONITOR:
+            set_monitor(cmd->transceivers, cmd->data);
+            break;
+
+        case POWERDOWN:
+            powerdown(cmd->transceivers);
+            break;
+
+        case SWITCH_RX:
+            switch_to_rx(cmd->transceivers);
+            break;
+
+        case SWITCH_WOR:
+            return switch_to_wor(cmd->transceivers, cmd->data);
+
+        case SET_EXT_MODE:
+            return set_ext_mode(cmd->transceivers, cmd->data);
+
+        case GET_PAN:
+            *((int32_t *) cmd->data) = get_pan(cmd->transceivers);
             break;
+
+        case SET_PAN:
+            *((int32_t *) cmd->data) = set_pan(cmd->transceivers, cmd->data);
+            break;
+#ifdef DBG_IGNORE
+
+        case DBG_IGN:
+            *((int16_t *) cmd->data) = ignore_add(cmd->transceivers, cmd->data);
+            break;
+#endif
+
+        default:
+            return (uint32_t) -1;
     }
 
-    /* search first free position in transceiver buffer */
-    for (i = 0; (i < TRANSCEIVER_BUFFER_SIZE) && (transceiver_buffer[transceiver_buffer_pos].processing); i++) {
-        if (++transceiver_buffer_pos == TRANSCEIVER_BUFFER_SIZE) {
-            transceiver_buffer_pos = 0;
-        }
+    return 0;
+}
+
+/*------------------------------------------------------------------------------------*/
+/*
+ * @brief Processes a packet received by any transceiver device
+ *
+ * @param type  The message type to determine which device has received the
+ * packet
+ * @param pos   The current device driver's buffer position
+ */
+static void receive_packet(uint16_t type, uint8_t pos)
+{
+    uint8_t i = 0;
+    int slot;
+    unsigned state;
+    transceiver_type_t t;
+    rx_buffer_pos = pos;
+    msg_t m;
+
+    DEBUG("Packet received\n");
+
+    t = rcv_type_to_transceiver(type);
+
+    if (type == RCV_PKT_NATIVE) {
+        /* nativenet receives into the slot itself */
+        slot = pos;
+    }
+    else {
+        slot = transceiver_rx_reserve();
     }
 
     /* no buffer left */
-    if (i >= TRANSCEIVER_BUFFER_SIZE) {
+    if (slot < 0) {
         /* inform upper layers of lost packet */
         m.type = ENOBUFFER;
         m.content.value = t;
     }
     /* copy packet and handle it */
     else {
+        transceiver_buffer_pos = slot;
         m.type = PKT_PENDING;
 
         /* pass a null pointer if a packet from a undefined transceiver is
@@ -435,7 +888,11 @@ static void receive_packet(uint16_t type, uint8_t pos)
         else if (type == RCV_PKT_MC1322X) {
 #ifdef MODULE_MC1322X
             ieee802154_packet_t *trans_p = &(transceiver_buffer[transceiver_buffer_pos]);
-            receive_mc1322x_packet(trans_p);
+
+            if (receive_mc1322x_packet(trans_p) < 0) {
+                transceiver_rx_cancel(slot);
+                return;
+            }
 #endif
         }
         else if (type == RCV_PKT_CC2420) {
@@ -452,46 +909,116 @@ static void receive_packet(uint16_t type, uint8_t pos)
         }
         else if (type == RCV_PKT_NATIVE) {
 #ifdef MODULE_NATIVENET
-            radio_packet_t *trans_p = &(transceiver_buffer[transceiver_buffer_pos]);
-            receive_nativenet_packet(trans_p);
+            DEBUG("Packet %p was from %" PRIu16 " to %" PRIu16 ", size: %" PRIu8 "\n",
+                  &transceiver_buffer[slot], transceiver_buffer[slot].src,
+                  transceiver_buffer[slot].dst, transceiver_buffer[slot].length);
 #endif
         }
         else {
             puts("Invalid transceiver type");
+            transceiver_rx_cancel(slot);
             return;
         }
 
-#ifdef DBG_IGNORE
+#if defined(DBG_IGNORE) && !(MODULE_AT86RF231 || MODULE_CC2420 || MODULE_MC1322X)
+
+        /* the drivers with a filter drop these before reading them */
+        if (radio_filter_is_ignored(&ignore_filter, transceiver_buffer[slot].src)) {
+            DEBUG("ignored packet from %" PRIu16 "\n", transceiver_buffer[slot].src);
+            transceiver_rx_cancel(slot);
+            return;
+        }
+
+#endif
+#ifdef MODULE_RANDOM
+        /* the low bits of signal strength and arrival time are noise */
+        genrand_add_entropy(((uint32_t) transceiver_buffer[slot].rssi << 24) ^
+                            ((uint32_t) transceiver_buffer[slot].lqi << 16) ^
+                            hwtimer_now());
+#endif
+#ifdef MODULE_PCAP
+        capture(t, slot);
+#endif
+        m.content.ptr = (char *) &(transceiver_buffer[slot]);
 
-        for (uint8_t i = 0; (i < MAX_IGNORED_ADDR) && (ignored_addr[i]); i++) {
-            DEBUG("check if source (%u) is ignored -> %u\n", transceiver_buffer[transceiver_buffer_pos].src, ignored_addr[i]);
+        /* hand out all tokens before the first send, a receiver with
+         * higher priority releases its token before msg_send() returns */
+        state = disableIRQ();
 
-            if (transceiver_buffer[transceiver_buffer_pos].src == ignored_addr[i]) {
-                DEBUG("ignored packet from %" PRIu16 "\n", transceiver_buffer[transceiver_buffer_pos].src);
-                return;
+        for (i = 0; (i < TRANSCEIVER_MAX_REGISTERED) &&
+             (reg[i].transceivers != TRANSCEIVER_NONE); i++) {
+            if (reg[i].transceivers & t) {
+                transceiver_buffer[slot].processing++;
             }
         }
 
-#endif
+        restoreIRQ(state);
     }
 
     /* finally notify waiting upper layers
      * this is done non-blocking, so packets can get lost */
-    i = 0;
-
-    while (reg[i].transceivers != TRANSCEIVER_NONE) {
+    for (i = 0; (i < TRANSCEIVER_MAX_REGISTERED) &&
+         (reg[i].transceivers != TRANSCEIVER_NONE); i++) {
         if (reg[i].transceivers & t) {
-            m.content.ptr = (char *) &(transceiver_buffer[transceiver_buffer_pos]);
             DEBUG("transceiver: Notify thread %i\n", reg[i].pid);
 
-            if (msg_send(&m, reg[i].pid, false) && (m.type != ENOBUFFER)) {
-                transceiver_buffer[transceiver_buffer_pos].processing++;
+            if (msg_send(&m, reg[i].pid, false) < 1) {
+                rx_stats.not_delivered++;
+
+                if (m.type == PKT_PENDING) {
+                    transceiver_release(&transceiver_buffer[slot]);
+                }
             }
         }
+    }
+
+    if (m.type == PKT_PENDING) {
+        /* the producer's token */
+        transceiver_release(&transceiver_buffer[slot]);
+    }
+}
+
+#ifdef MODULE_PCAP
+/*
+ * @brief Passes a received packet to a running capture
+ *
+ * @param t     The transceiver device
+ * @param slot  The packet's slot in transceiver_buffer
+ */
+static void capture(transceiver_type_t t, int slot)
+{
+    transceiver_worker_t *w = find_worker(t);
+    pcap_info_t info;
 
-        i++;
+    if (pcap_linktype() == 0) {
+        return;
     }
+
+    info.channel = (w != NULL) ? w->ch_cur : 0;
+    info.lqi = transceiver_buffer[slot].lqi;
+    info.rssi = transceiver_buffer[slot].rssi;
+
+#if MODULE_AT86RF231 || MODULE_CC2420 || MODULE_MC1322X
+    /* the drivers keep the parsed frame only, the header is built anew */
+    ieee802154_frame_t *frame = &transceiver_buffer[slot].frame;
+    uint8_t hdr[IEEE_802154_MAX_HDR_LEN];
+    uint8_t hdr_len = ieee802154_frame_init(frame, hdr);
+
+    info.type = frame->fcf.frame_type;
+    info.dst = (frame->fcf.dest_addr_m == IEEE_802154_SHORT_ADDR_M) ?
+               (frame->dest_addr[0] << 8) | frame->dest_addr[1] : PCAP_UNKNOWN;
+    info.src = (frame->fcf.src_addr_m == IEEE_802154_SHORT_ADDR_M) ?
+               (frame->src_addr[0] << 8) | frame->src_addr[1] : PCAP_UNKNOWN;
+    pcap_capture(&info, hdr, hdr_len, frame->payload, frame->payload_len);
+#else
+    info.type = PCAP_UNKNOWN;
+    info.dst = transceiver_buffer[slot].dst;
+    info.src = transceiver_buffer[slot].src;
+    pcap_capture(&info, NULL, 0, transceiver_buffer[slot].data,
+                 transceiver_buffer[slot].length);
+#endif
 }
+#endif
 
 #ifdef MODULE_CC110X_NG
 /*
@@ -502,6 +1029,8 @@ static void receive_packet(uint16_t type, uint8_t pos)
 static void receive_cc110x_packet(radio_packet_t *trans_p)
 {
     DEBUG("transceiver: Handling CC1100 packet\n");
+    /* not stamped by the driver */
+    vtimer_now(&trans_p->toa);
     /* disable interrupts while copying packet */
     dINT();
     cc110x_packet_t p = cc110x_rx_buffer[rx_buffer_pos].packet;
@@ -522,6 +1051,7 @@ static void receive_cc110x_packet(radio_packet_t *trans_p)
 #ifdef MODULE_CC110X
 void receive_cc1100_packet(radio_packet_t *trans_p)
 {
+    vtimer_now(&trans_p->toa);
     dINT();
     trans_p->src = cc1100_packet_info->source;
     trans_p->dst = cc1100_packet_info->destination;
@@ -547,6 +1077,7 @@ void receive_cc2420_packet(ieee802154_packet_t *trans_p)
     trans_p->rssi = p->rssi;
     trans_p->crc = p->crc;
     trans_p->lqi = p->lqi;
+    trans_p->toa = timex_from_uint64(vtimer_now64_at(p->toa));
     memcpy(&data_buffer[transceiver_buffer_pos * CC2420_MAX_DATA_LENGTH],
            p->frame.payload, p->frame.payload_len);
     trans_p->frame.payload = (uint8_t *) & (data_buffer[transceiver_buffer_pos * CC2420_MAX_DATA_LENGTH]);
@@ -592,48 +1123,61 @@ void receive_cc2420_packet(ieee802154_packet_t *trans_p)
 #endif
 
 #ifdef MODULE_MC1322X
-void receive_mc1322x_packet(radio_packet_t *trans_p)
+/*
+ * @brief Called by the maca ISR for every frame it queues, the frame is
+ *        taken from the queue by receive_mc1322x_packet()
+ */
+void maca_rx_callback(volatile maca_packet_t *packet)
 {
-    maca_packet_t *maca_pkt;
-    dINT();
-    maca_pkt = maca_get_rx_packet();
-    trans_p->lqi = maca_pkt->lqi;
-    trans_p->length = maca_pkt->length;
-    memcpy((void *) &(data_buffer[transceiver_buffer_pos * PAYLOAD_SIZE]), maca_pkt->data, MACA_MAX_PAYLOAD_SIZE);
-    maca_free_packet(maca_pkt);
-    eINT();
+    msg_t m;
 
-    trans_p->data = (uint8_t *) &(data_buffer[transceiver_buffer_pos * MACA_MAX_PAYLOAD_SIZE]);
+    (void) packet;
+    m.type = RCV_PKT_MC1322X;
+    m.content.value = 0;
+    msg_send_int(&m, transceiver_get_pid(TRANSCEIVER_MC1322X));
 }
-#endif
-
 
-#ifdef MODULE_NATIVENET
-void receive_nativenet_packet(radio_packet_t *trans_p)
+/*
+ * @brief process packets from the maca
+ *
+ * The frame is parsed in the DMA buffer it was received into, the slot
+ * takes that buffer over until its last owner releases it.
+ *
+ * @param trans_p   The current entry in the transceiver buffer
+ *
+ * @return 0 on success, -1 if the maca has no frame queued
+ */
+static int receive_mc1322x_packet(ieee802154_packet_t *trans_p)
 {
-    unsigned state;
-    radio_packet_t *p = &_nativenet_rx_buffer[rx_buffer_pos].packet;
+    volatile maca_packet_t *maca_pkt = maca_get_rx_packet();
 
-    /* disable interrupts while copying packet */
-    state = disableIRQ();
-
-    DEBUG("Handling nativenet packet\n");
-
-    memcpy(trans_p, p, sizeof(radio_packet_t));
-    memcpy(&(data_buffer[transceiver_buffer_pos * PAYLOAD_SIZE]), p->data, p->length);
-    trans_p->data = (uint8_t *) &(data_buffer[transceiver_buffer_pos * PAYLOAD_SIZE]);
+    if (maca_pkt == NULL) {
+        return -1;
+    }
 
-    DEBUG("Packet %p was from %" PRIu16 " to %" PRIu16 ", size: %" PRIu8 "\n", trans_p, trans_p->src, trans_p->dst, trans_p->length);
+    trans_p->length = maca_pkt->length + IEEE_802154_FCS_LEN;
+    trans_p->rssi = 0;
+    /* frames with a wrong FCS are not queued by the maca */
+    trans_p->crc = 1;
+    trans_p->lqi = maca_pkt->lqi;
+    /* the maca does not stamp its frames, the time we got to it */
+    vtimer_now(&trans_p->toa);
+    ieee802154_frame_read((uint8_t *) &maca_pkt->data[maca_pkt->offset],
+                          &trans_p->frame, trans_p->length);
+    mc1322x_rx_pkt[transceiver_buffer_pos] = maca_pkt;
 
-    /* reset interrupts */
-    restoreIRQ(state);
+    return 0;
 }
 #endif
 
+
+
 #ifdef MODULE_AT86RF231
 void receive_at86rf231_packet(ieee802154_packet_t *trans_p)
 {
     DEBUG("Handling AT86RF231 packet\n");
+    /* not stamped by the driver */
+    vtimer_now(&trans_p->toa);
     dINT();
     at86rf231_packet_t *p = &at86rf231_rx_buffer[rx_buffer_pos];
     trans_p->length = p->length;
@@ -715,7 +1259,7 @@ static int8_t send_packet(transceiver_type_t t, void *pkt)
     at86rf231_packet_t at86rf231_pkt;
 #endif
 
-    switch (t) {
+    switch (DISPATCH(t)) {
         case TRANSCEIVER_CC1100:
 #ifdef MODULE_CC110X_NG
             cc110x_pkt.length = p->length + CC1100_HEADER_LENGTH;
@@ -772,6 +1316,387 @@ static int8_t send_packet(transceiver_type_t t, void *pkt)
     return res;
 }
 
+/*------------------------------------------------------------------------------------*/
+/*
+ * the destination of a packet, short addresses as they are and long ones
+ * in host byte order; 1 for a broadcast
+ */
+static uint8_t tx_dest(void *pkt, uint64_t *dst)
+{
+#if MODULE_AT86RF231 || MODULE_CC2420 || MODULE_MC1322X
+    ieee802154_frame_t *f = &((ieee802154_packet_t *) pkt)->frame;
+
+    if (f->fcf.dest_addr_m == IEEE_802154_SHORT_ADDR_M) {
+        uint16_t a;
+
+        /* net_if puts it there in host byte order */
+        memcpy(&a, f->dest_addr, sizeof(a));
+        *dst = a;
+        return a == IEEE_802154_SHORT_MCAST_ADDR;
+    }
+
+    *dst = 0;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        *dst = (*dst << 8) | f->dest_addr[i];
+    }
+
+    return *dst == UINT64_MAX;
+#else
+    *dst = ((radio_packet_t *) pkt)->dst;
+    return *dst == 0;
+#endif
+}
+
+/* the channel a neighbor listens on */
+static uint8_t nbr_channel(transceiver_worker_t *w, uint64_t addr)
+{
+    for (uint8_t i = 0; i < TRANSCEIVER_CHANNEL_NEIGHBORS; i++) {
+        if (w->ch_nbrs[i].channel && (w->ch_nbrs[i].addr == addr)) {
+            return w->ch_nbrs[i].channel;
+        }
+    }
+
+    return w->ch_set[(uint16_t) addr % w->ch_num];
+}
+
+/*
+ * time a radio needs after a channel switch until it can send or receive:
+ * the cc110x calibrates its synthesizer again, the 2.4 GHz radios wait for
+ * their PLL to lock
+ */
+static uint32_t channel_settle_us(transceiver_type_t t)
+{
+    switch (DISPATCH(t)) {
+        case TRANSCEIVER_CC1100:
+            return 810;
+
+        case TRANSCEIVER_CC2420:
+        case TRANSCEIVER_MC1322X:
+            return 192;
+
+        case TRANSCEIVER_AT86RF231:
+            return 11;
+
+        default:
+            return 0;
+    }
+}
+
+static void channel_switch(transceiver_worker_t *w, transceiver_type_t t,
+                           uint8_t channel)
+{
+    unsigned long start = hwtimer_now();
+
+    set_channel(t, &channel);
+    w->ch_cur = channel;
+    w->ch_batch = 0;
+    w->ch_stats.switches++;
+    w->ch_stats.switch_us += HWTIMER_TICKS_TO_US(hwtimer_now() - start) +
+                             channel_settle_us(t);
+}
+
+static void channels_set(transceiver_worker_t *w, transceiver_type_t t,
+                         transceiver_channels_t *chs)
+{
+    uint8_t num = (chs->num > TRANSCEIVER_CHANNELS_MAX) ?
+                  TRANSCEIVER_CHANNELS_MAX : chs->num;
+
+    w->ch_num = 0;
+
+    if (!num) {
+        return;
+    }
+
+    memcpy(w->ch_set, chs->channels, num);
+    w->ch_num = num;
+    w->ch_home = (chs->home >= 0) ? (uint8_t) chs->home :
+                 w->ch_set[get_address(t) % num];
+    channel_switch(w, t, w->ch_home);
+}
+
+/*
+ * the channel to send an entry on next, 0 without multi-channel operation:
+ * the receiver's, or for a broadcast the current one if it still needs it
+ */
+static uint8_t tx_channel(transceiver_worker_t *w, tx_entry_t *e)
+{
+    int8_t first = -1;
+
+    if (e->channel || !e->channels_todo) {
+        return e->channel;
+    }
+
+    for (uint8_t i = 0; i < w->ch_num; i++) {
+        if (!(e->channels_todo & (1 << i))) {
+            continue;
+        }
+
+        if (w->ch_set[i] == w->ch_cur) {
+            return w->ch_cur;
+        }
+
+        if (first < 0) {
+            first = i;
+        }
+    }
+
+    if (first < 0) {
+        /* the channel set shrank meanwhile */
+        e->channels_todo = 0;
+        return 0;
+    }
+
+    return w->ch_set[first];
+}
+
+/*------------------------------------------------------------------------------------*/
+/*
+ * @brief Puts a packet into the transmit queue
+ *
+ * @param w         The worker
+ * @param m         The request, SND_PKT is replied to and SND_PKT_QUEUED is
+ *                  notified with TX_DONE when the packet is done
+ * @param t         The transceiver device
+ * @param pkt       The packet, copied if *queued* is set
+ * @param priority  The priority class
+ * @param tag       The tag for the TX_DONE message
+ * @param queued    1 to copy the packet for an asynchronous send
+ *
+ * @return 1 if the packet was queued, 0 if the queue was full
+ */
+static uint8_t tx_enqueue(transceiver_worker_t *w, msg_t *m,
+                          transceiver_type_t t, void *pkt,
+                          uint8_t priority, uint16_t tag, uint8_t queued)
+{
+    uint8_t i;
+    tx_entry_t *e;
+
+    for (i = 0; (i < TRANSCEIVER_TX_QUEUE_SIZE) && w->tx_queue[i].used; i++);
+
+    if (i >= TRANSCEIVER_TX_QUEUE_SIZE) {
+        DEBUG("transceiver: transmit queue full\n");
+        return 0;
+    }
+
+    e = &w->tx_queue[i];
+
+    if (queued) {
+#if MODULE_AT86RF231 || MODULE_CC2420 || MODULE_MC1322X
+        ieee802154_packet_t *p = &w->tx_packets[i];
+
+        memcpy(p, pkt, sizeof(*p));
+
+        if (p->frame.payload_len > PAYLOAD_SIZE) {
+            return 0;
+        }
+
+        memcpy(w->tx_data[i], p->frame.payload, p->frame.payload_len);
+        p->frame.payload = w->tx_data[i];
+#else
+        radio_packet_t *p = &w->tx_packets[i];
+
+        memcpy(p, pkt, sizeof(*p));
+
+        if (p->length > PAYLOAD_SIZE) {
+            return 0;
+        }
+
+        memcpy(w->tx_data[i], p->data, p->length);
+        p->data = w->tx_data[i];
+#endif
+        pkt = p;
+    }
+
+#if MODULE_AT86RF231 || MODULE_CC2420 || MODULE_MC1322X
+    /* every attempt sends the same sequence number, so receivers can
+     * drop the duplicates of a frame whose acknowledgement was lost */
+    ((ieee802154_packet_t *) pkt)->frame.seq_nr = w->tx_dsn++;
+#endif
+
+    e->used = 1;
+    e->priority = (priority < TRANSCEIVER_TX_PRIO_NUMOF) ?
+                  priority : TRANSCEIVER_TX_PRIO_DATA;
+    e->attempts = 0;
+    e->channel = 0;
+    e->channels_todo = 0;
+
+    if (w->ch_num) {
+        uint64_t dst;
+
+        if (tx_dest(pkt, &dst)) {
+            e->channels_todo = (uint16_t)((1UL << w->ch_num) - 1);
+        }
+        else {
+            e->channel = nbr_channel(w, dst);
+        }
+    }
+
+    e->queued = queued;
+    e->tag = tag;
+    e->seq = w->tx_seq++;
+    e->transceivers = t;
+    e->request = *m;
+    e->packet = pkt;
+
+    return 1;
+}
+
+/*
+ * the entry to send next: highest priority, oldest first; an entry of that
+ * priority for the current channel goes first if another one would cost a
+ * switch, for TRANSCEIVER_CHANNEL_BATCH frames in a row
+ */
+static tx_entry_t *tx_next(transceiver_worker_t *w)
+{
+    tx_entry_t *next = NULL;
+    tx_entry_t *here = NULL;
+
+    for (uint8_t i = 0; i < TRANSCEIVER_TX_QUEUE_SIZE; i++) {
+        tx_entry_t *e = &w->tx_queue[i];
+
+        if (!e->used) {
+            continue;
+        }
+
+        if ((next == NULL) || (e->priority < next->priority) ||
+            ((e->priority == next->priority) &&
+             ((uint16_t)(w->tx_seq - e->seq) > (uint16_t)(w->tx_seq - next->seq)))) {
+            next = e;
+        }
+    }
+
+    if ((next == NULL) || !w->ch_num || (tx_channel(w, next) == w->ch_cur) ||
+        (w->ch_batch >= TRANSCEIVER_CHANNEL_BATCH) ||
+        !channel_settle_us(next->transceivers)) {
+        return next;
+    }
+
+    for (uint8_t i = 0; i < TRANSCEIVER_TX_QUEUE_SIZE; i++) {
+        tx_entry_t *e = &w->tx_queue[i];
+
+        if (!e->used || (e->priority != next->priority) ||
+            (tx_channel(w, e) != w->ch_cur)) {
+            continue;
+        }
+
+        if ((here == NULL) ||
+            ((uint16_t)(w->tx_seq - e->seq) > (uint16_t)(w->tx_seq - here->seq))) {
+            here = e;
+        }
+    }
+
+    if (here != NULL) {
+        w->ch_stats.batched++;
+        return here;
+    }
+
+    return next;
+}
+
+static void tx_finish(tx_entry_t *e, int8_t res)
+{
+    msg_t m;
+    /* attempts counts the failed ones */
+    uint8_t transmissions = e->attempts + ((res > 0) ? 1 : 0);
+
+    e->used = 0;
+
+    if (e->queued) {
+        m.type = TX_DONE;
+        m.content.value = ((uint32_t) e->tag << 16) | (uint16_t)(int16_t) res;
+
+        if (msg_send(&m, e->request.sender_pid, false) < 1) {
+            DEBUG("transceiver: TX_DONE for %u lost\n", e->tag);
+        }
+    }
+    else {
+        m = e->request;
+        m.content.value = ((uint32_t) transmissions << 16) |
+                          (uint16_t)(int16_t) res;
+        msg_reply(&e->request, &m);
+    }
+}
+
+/*
+ * @brief Sends queued packets until the queue is empty or a failed attempt
+ * backs off. Retries wait a random number of backoff periods out of a window
+ * that doubles from 2^TRANSCEIVER_CSMA_MIN_BE up to 2^TRANSCEIVER_CSMA_MAX_BE,
+ * the same for every driver. The transceiver thread keeps serving other
+ * messages meanwhile.
+ */
+static void tx_process(transceiver_worker_t *w)
+{
+    tx_entry_t *e;
+
+    while (!w->tx_backoff_pending && ((e = tx_next(w)) != NULL)) {
+        uint8_t channel = tx_channel(w, e);
+        int8_t res;
+
+        if (w->ch_num && channel && (channel != w->ch_cur)) {
+            channel_switch(w, e->transceivers, channel);
+        }
+
+        res = send_packet(e->transceivers, e->packet);
+        w->ch_batch++;
+
+        if ((res > 0) && e->channels_todo) {
+            /* a broadcast goes out once on every channel */
+            for (uint8_t i = 0; i < w->ch_num; i++) {
+                if (w->ch_set[i] == channel) {
+                    e->channels_todo &= ~(1 << i);
+                }
+            }
+
+            if (e->channels_todo) {
+                continue;
+            }
+        }
+
+        if (res > 0) {
+            tx_finish(e, res);
+        }
+        else if (res == TRANSCEIVER_TX_CHANNEL_BUSY) {
+            /* the radio backed off by itself already, and sent nothing */
+            tx_finish(e, res);
+        }
+        else if (e->attempts++ >= TRANSCEIVER_TX_MAX_RETRIES) {
+            DEBUG("transceiver: giving up after %u attempts\n", e->attempts);
+            tx_finish(e, res);
+        }
+        else {
+            uint8_t be = TRANSCEIVER_CSMA_MIN_BE + e->attempts - 1;
+            uint32_t backoff;
+
+            if (be > TRANSCEIVER_CSMA_MAX_BE) {
+                be = TRANSCEIVER_CSMA_MAX_BE;
+            }
+
+#ifdef MODULE_RANDOM
+            backoff = (genrand_uint32() % (1 << be)) * TRANSCEIVER_CSMA_UNIT_US;
+#else
+            backoff = (rand() % (1 << be)) * TRANSCEIVER_CSMA_UNIT_US;
+#endif
+
+            if (backoff == 0) {
+                continue;
+            }
+
+            DEBUG("transceiver: backoff %" PRIu32 " us\n", backoff);
+
+            if (vtimer_set_msg(&w->tx_backoff_timer, timex_set(0, backoff),
+                               w->pid, NULL) == 0) {
+                w->tx_backoff_pending = 1;
+            }
+        }
+    }
+
+    if (w->ch_num && (w->ch_cur != w->ch_home)) {
+        /* listen where the neighbors send to while there is nothing to send */
+        channel_switch(w, w->type, w->ch_home);
+    }
+}
+
 /*------------------------------------------------------------------------------------*/
 /*
  * @brief Sets the radio channel for any transceiver device
@@ -785,7 +1710,7 @@ static int32_t set_channel(transceiver_type_t t, void *channel)
 {
     uint8_t c = *((uint8_t *)channel);
 
-    switch (t) {
+    switch (DISPATCH(t)) {
         case TRANSCEIVER_CC1100:
 #ifdef MODULE_CC110X_NG
             return cc110x_set_channel(c);
@@ -830,7 +1755,7 @@ static int32_t set_channel(transceiver_type_t t, void *channel)
  */
 static int32_t get_channel(transceiver_type_t t)
 {
-    switch (t) {
+    switch (DISPATCH(t)) {
         case TRANSCEIVER_CC1100:
 #ifdef MODULE_CC110X_NG
             return cc110x_get_channel();
@@ -879,7 +1804,7 @@ static int32_t set_pan(transceiver_type_t t, void *pan)
 {
     uint16_t c = *((uint16_t *) pan);
 
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC2420
 
         case TRANSCEIVER_CC2420:
@@ -917,7 +1842,7 @@ static int32_t set_pan(transceiver_type_t t, void *pan)
  */
 static int32_t get_pan(transceiver_type_t t)
 {
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC2420
 
         case TRANSCEIVER_CC2420:
@@ -955,7 +1880,7 @@ static int32_t get_pan(transceiver_type_t t)
  */
 static radio_address_t get_address(transceiver_type_t t)
 {
-    switch (t) {
+    switch (DISPATCH(t)) {
         case TRANSCEIVER_CC1100:
 #ifdef MODULE_CC110X_NG
             return cc110x_get_address();
@@ -1004,7 +1929,7 @@ static radio_address_t set_address(transceiver_type_t t, void *address)
 {
     radio_address_t addr = *((radio_address_t *)address);
 
-    switch (t) {
+    switch (DISPATCH(t)) {
         case TRANSCEIVER_CC1100:
 #ifdef MODULE_CC110X_NG
             return cc110x_set_address(addr);
@@ -1048,7 +1973,7 @@ static radio_address_t set_address(transceiver_type_t t, void *address)
  */
 static transceiver_eui64_t get_long_addr(transceiver_type_t t)
 {
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC2420
 
         case TRANSCEIVER_CC2420:
@@ -1077,7 +2002,7 @@ static transceiver_eui64_t set_long_addr(transceiver_type_t t, void *address)
 {
     uint64_t addr = *((uint64_t *)address);
 
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC2420
 
         case TRANSCEIVER_CC2420:
@@ -1105,7 +2030,7 @@ static void set_monitor(transceiver_type_t t, void *mode)
 {
     (void) mode;
 
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC110X_NG
 
         case TRANSCEIVER_CC1100:
@@ -1150,7 +2075,7 @@ void cc1100_packet_monitor(void *payload, int payload_size, protocol_t protocol,
 /*------------------------------------------------------------------------------------*/
 static void powerdown(transceiver_type_t t)
 {
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC110X_NG
 
         case TRANSCEIVER_CC1100:
@@ -1178,7 +2103,7 @@ static void powerdown(transceiver_type_t t)
 /*------------------------------------------------------------------------------------*/
 static void switch_to_rx(transceiver_type_t t)
 {
-    switch (t) {
+    switch (DISPATCH(t)) {
 #ifdef MODULE_CC110X_NG
 
         case TRANSCEIVER_CC1100:
@@ -1209,20 +2134,85 @@ static void switch_to_rx(transceiver_type_t t)
     }
 }
 
+/*------------------------------------------------------------------------------------*/
+static int switch_to_wor(transceiver_type_t t, transceiver_wor_t *wor)
+{
+    switch (DISPATCH(t)) {
+#ifdef MODULE_CC110X_NG
+
+        case TRANSCEIVER_CC1100:
+            if (!cc110x_set_wor(wor->interval, wor->listen)) {
+                return 0;
+            }
+
+            cc110x_switch_to_wor();
+            return 1;
+#endif
+
+        default:
+            (void) wor;
+            return 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------*/
+/*
+ * @brief Switches the extended operating mode of a transceiver, in which the
+ * radio backs off, retries and handles acknowledgements by itself
+ *
+ * @param t     The transceiver device
+ * @param mode  The mode and its retries
+ *
+ * @return 1 if the transceiver has such a mode, 0 otherwise
+ */
+static int set_ext_mode(transceiver_type_t t, transceiver_ext_mode_t *mode)
+{
+    switch (DISPATCH(t)) {
+#ifdef MODULE_AT86RF231
+
+        case TRANSCEIVER_AT86RF231:
+            at86rf231_set_extended_mode(mode->on, mode->csma_retries,
+                                        mode->frame_retries);
+            return 1;
+#endif
+
+        default:
+            (void) mode;
+            return 0;
+    }
+}
+
 #ifdef DBG_IGNORE
 static int16_t ignore_add(transceiver_type_t transceiver, void *address)
 {
-    (void) transceiver;
     radio_address_t addr = *((radio_address_t *)address);
+    radio_filter_t *filter;
 
-    for (uint8_t i = 0; i < MAX_IGNORED_ADDR; i++) {
-        if (ignored_addr[i] == 0) {
-            ignored_addr[i] = addr;
-            DEBUG("addr %u will be ignored (%u)\n", addr, i);
-            return i;
-        }
+    switch (DISPATCH(transceiver)) {
+#ifdef MODULE_CC110X_NG
+
+        case TRANSCEIVER_CC1100:
+            filter = &cc110x_rx_filter;
+            break;
+#endif
+#ifdef MODULE_CC2420
+
+        case TRANSCEIVER_CC2420:
+            filter = &cc2420_rx_filter;
+            break;
+#endif
+#ifdef MODULE_AT86RF231
+
+        case TRANSCEIVER_AT86RF231:
+            filter = &at86rf231_rx_filter;
+            break;
+#endif
+
+        default:
+            filter = &ignore_filter;
+            break;
     }
 
-    return -1;
+    return radio_filter_ignore_add(filter, addr);
 }
 #endif
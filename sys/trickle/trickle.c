@@ -0,0 +1,113 @@
+/**
+ * Trickle implementation
+ *
+ * Copyright (C) 2013  INRIA.
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_trickle
+ * @{
+ * @file    trickle.c
+ * @brief   Trickle implementation
+ * @author  Eric Engel <eric.engel@fu-berlin.de>
+ * @}
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "inttypes.h"
+#include "trickle.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+static void trickle_set_timer(trickle_t *trickle, uint32_t ms)
+{
+    timex_t time = timex_set(0, ms * 1000);
+
+    timex_normalize(&time);
+    vtimer_remove(&trickle->timer);
+    vtimer_set_msg(&trickle->timer, time, trickle->pid, trickle);
+}
+
+/* RFC 6206, 4.2 rule 1 and 2 */
+static void trickle_new_interval(trickle_t *trickle)
+{
+    trickle->c = 0;
+    trickle->t_over = 0;
+    trickle->t = (trickle->I / 2) + (rand() % (trickle->I - (trickle->I / 2) + 1));
+    trickle_set_timer(trickle, trickle->t);
+}
+
+void trickle_start(trickle_t *trickle, unsigned int pid,
+                   void (*callback)(void *), void *arg,
+                   uint32_t Imin, uint8_t Imax, uint8_t k)
+{
+    trickle->pid = pid;
+    trickle->callback = callback;
+    trickle->arg = arg;
+    trickle->k = k;
+    trickle->Imin = Imin;
+    trickle->Imax = Imax;
+    /* first interval somewhere in [Imin, Imax] (RFC 6206, 4.2 rule 1) */
+    trickle->I = Imin + (rand() % ((Imin << Imax) - Imin + 1));
+    trickle_new_interval(trickle);
+}
+
+void trickle_stop(trickle_t *trickle)
+{
+    trickle->I = 0;
+    vtimer_remove(&trickle->timer);
+}
+
+void trickle_reset_timer(trickle_t *trickle)
+{
+    /* only inconsistencies in longer intervals reset (RFC 6206, 4.2 rule 6) */
+    if ((trickle->I == 0) || (trickle->I == trickle->Imin)) {
+        return;
+    }
+
+    trickle->I = trickle->Imin;
+    trickle_new_interval(trickle);
+}
+
+void trickle_increment_counter(trickle_t *trickle)
+{
+    /* call this function, when a consistent transmission was heard */
+    trickle->c++;
+}
+
+void trickle_fire(trickle_t *trickle)
+{
+    if (trickle->I == 0) {
+        /* stopped while the message was queued */
+        return;
+    }
+
+    if (!trickle->t_over) {
+        trickle->t_over = 1;
+
+        /* suppressed after k consistent transmissions, k = 0 is infinity
+         * (RFC 6206, 4.2 rule 4 and 6.5) */
+        if ((trickle->k == 0) || (trickle->c < trickle->k)) {
+            trickle->callback(trickle->arg);
+        }
+
+        trickle_set_timer(trickle, trickle->I - trickle->t);
+        return;
+    }
+
+    /* interval over, double it up to Imax (RFC 6206, 4.2 rule 5) */
+    if (trickle->I >= (trickle->Imin << trickle->Imax) / 2) {
+        trickle->I = trickle->Imin << trickle->Imax;
+    }
+    else {
+        trickle->I *= 2;
+    }
+
+    DEBUG("TRICKLE new Interval %" PRIu32 "\n", trickle->I);
+    trickle_new_interval(trickle);
+}
@@ -23,7 +23,7 @@
 
 #include "cpu-conf.h"
 #include "chardev_thread.h"
-#include "ringbuffer.h"
+#include "spsc_ringbuffer.h"
 #include "thread.h"
 #include "msg.h"
 #include "posix_io.h"
@@ -35,10 +35,14 @@
 #define UART0_BUFSIZE       (128)
 #endif
 
+#if (UART0_BUFSIZE & (UART0_BUFSIZE - 1))
+#error "UART0_BUFSIZE must be a power of two"
+#endif
+
 /* increase when ENABLE_DEBUG in chardev_thread is set to 1! */
 #define UART0_STACKSIZE 	(KERNEL_CONF_STACKSIZE_DEFAULT)
 
-ringbuffer_t uart0_ringbuffer;
+spsc_ringbuffer_t uart0_ringbuffer;
 int uart0_handler_pid;
 
 static char buffer[UART0_BUFSIZE];
@@ -52,7 +56,7 @@ static void uart0_loop(void)
 
 void board_uart0_init(void)
 {
-    ringbuffer_init(&uart0_ringbuffer, buffer, UART0_BUFSIZE);
+    spsc_rb_init(&uart0_ringbuffer, buffer, UART0_BUFSIZE);
     int pid = thread_create(
                   uart0_thread_stack,
                   sizeof(uart0_thread_stack),
@@ -62,13 +66,21 @@ void board_uart0_init(void)
                   "uart0"
               );
     uart0_handler_pid = pid;
+    /* the uart does not receive in deep sleep modes */
+    lpm_prevent_sleep |= LPM_PREVENT_SLEEP_UART;
     thread_wakeup(pid);
     puts("uart0_init() [OK]");
 }
 
 void uart0_handle_incoming(int c)
 {
-    rb_add_element(&uart0_ringbuffer, c);
+    char ch = c;
+    spsc_rb_put(&uart0_ringbuffer, &ch, 1);
+}
+
+void uart0_handle_incoming_block(char *buf, int n)
+{
+    spsc_rb_put(&uart0_ringbuffer, buf, n);
 }
 
 void uart0_notify_thread(void)
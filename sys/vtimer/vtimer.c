@@ -22,12 +22,14 @@
 #include <inttypes.h>
 
 #include "irq.h"
+#include "bitarithm.h"
 #include "queue.h"
 #include "timex.h"
 #include "hwtimer.h"
 #include "msg.h"
 #include "mutex.h"
 #include "thread.h"
+#include "thread_flags.h"
 #include "queue.h"
 
 #include "vtimer.h"
@@ -41,6 +43,29 @@
 #define SECONDS_PER_TICK (4096U)
 #define MICROSECONDS_PER_TICK (4096UL * 1000000)
 
+/*
+ * Short term timers are kept in a hierarchical timing wheel keyed by their
+ * microsecond offset into the current long term tick. Level l of the wheel
+ * holds the timers that differ from the wheel's current position first in
+ * bits [SHIFT + l * BITS, SHIFT + (l + 1) * BITS), so arming and removing a
+ * timer never walks a list. Timers whose key shares its upper bits with the
+ * current position are due soon and are kept in a short sorted list that
+ * feeds the hwtimer.
+ */
+#define VTIMER_WHEEL_SHIFT  (10)
+#define VTIMER_WHEEL_BITS   (4)
+#define VTIMER_WHEEL_SLOTS  (1 << VTIMER_WHEEL_BITS)
+#define VTIMER_WHEEL_MASK   (VTIMER_WHEEL_SLOTS - 1)
+#define VTIMER_WHEEL_LEVELS (6)
+
+/* values of vtimer_t::list */
+#define VTIMER_LIST_NONE        (0)
+#define VTIMER_LIST_DUE         (1)
+#define VTIMER_LIST_LONGTERM    (2)
+#define VTIMER_LIST_WHEEL       (3)
+
+#define VTIMER_NEXT(t) ((vtimer_t *) (t)->queue_entry.next)
+
 void vtimer_callback(void *ptr);
 void vtimer_tick(void *ptr);
 static int vtimer_set(vtimer_t *timer);
@@ -51,8 +76,11 @@ static int set_shortterm(vtimer_t *timer);
 void vtimer_print(vtimer_t *t);
 #endif
 
-static queue_node_t longterm_queue_root;
-static queue_node_t shortterm_queue_root;
+static vtimer_t *longterm_list;
+static vtimer_t *due_list;
+static vtimer_t *wheel[VTIMER_WHEEL_LEVELS][VTIMER_WHEEL_SLOTS];
+static unsigned wheel_bitmap[VTIMER_WHEEL_LEVELS];
+static uint32_t wheel_now;
 
 static vtimer_t longterm_tick_timer;
 static uint32_t longterm_tick_start;
@@ -60,51 +88,262 @@ static volatile int in_callback = false;
 
 static int hwtimer_id = -1;
 static uint32_t hwtimer_next_absolute;
+/* timer the hwtimer is armed for, NULL if it is armed for a wheel slot */
+static vtimer_t *hwtimer_target;
 
 static uint32_t seconds = 0;
 
+/* hwtimer counter at the last vtimer_now64() and its overflows so far */
+static uint32_t now64_last;
+static uint32_t now64_wraps;
+
+static vtimer_t **vtimer_list_head(uint8_t list)
+{
+    if (list == VTIMER_LIST_DUE) {
+        return &due_list;
+    }
+    else if (list == VTIMER_LIST_LONGTERM) {
+        return &longterm_list;
+    }
+    else {
+        list -= VTIMER_LIST_WHEEL;
+        return &wheel[list / VTIMER_WHEEL_SLOTS][list & VTIMER_WHEEL_MASK];
+    }
+}
+
+static void vtimer_list_insert(vtimer_t **head, vtimer_t *prev,
+                               vtimer_t *timer, uint8_t list)
+{
+    vtimer_t *next = (prev == NULL) ? *head : VTIMER_NEXT(prev);
+
+    timer->queue_entry.next = (queue_node_t *) next;
+    timer->prev = prev;
+    timer->list = list;
+
+    if (next != NULL) {
+        next->prev = timer;
+    }
+
+    if (prev == NULL) {
+        *head = timer;
+    }
+    else {
+        prev->queue_entry.next = (queue_node_t *) timer;
+    }
+}
+
+static void vtimer_list_unlink(vtimer_t *timer)
+{
+    if ((timer->list == VTIMER_LIST_NONE) ||
+        (timer->list >= VTIMER_LIST_WHEEL +
+                        VTIMER_WHEEL_LEVELS * VTIMER_WHEEL_SLOTS)) {
+        return;
+    }
+
+    vtimer_t **head = vtimer_list_head(timer->list);
+    vtimer_t *next = VTIMER_NEXT(timer);
+
+    /* refuse to unlink a timer that is not where it claims to be */
+    if ((timer->prev == NULL) ? (*head != timer) :
+        (VTIMER_NEXT(timer->prev) != timer)) {
+        DEBUG("vtimer_list_unlink: %p is not queued\n", timer);
+        timer->list = VTIMER_LIST_NONE;
+        return;
+    }
+
+    if (timer->prev == NULL) {
+        *head = next;
+    }
+    else {
+        timer->prev->queue_entry.next = (queue_node_t *) next;
+    }
+
+    if (next != NULL) {
+        next->prev = timer->prev;
+    }
+
+    if ((timer->list >= VTIMER_LIST_WHEEL) && (*head == NULL)) {
+        uint8_t slot = timer->list - VTIMER_LIST_WHEEL;
+        wheel_bitmap[slot / VTIMER_WHEEL_SLOTS] &=
+            ~(1u << (slot & VTIMER_WHEEL_MASK));
+    }
+
+    timer->queue_entry.next = NULL;
+    timer->prev = NULL;
+    timer->list = VTIMER_LIST_NONE;
+}
+
+static void wheel_insert(vtimer_t *timer)
+{
+    uint32_t key = timer->queue_entry.priority;
+
+    if ((key >> VTIMER_WHEEL_SHIFT) <= (wheel_now >> VTIMER_WHEEL_SHIFT)) {
+        /* due within the current slot, keep it sorted for the hwtimer */
+        vtimer_t *prev = NULL;
+
+        for (vtimer_t *t = due_list; t != NULL; t = VTIMER_NEXT(t)) {
+            if (t->queue_entry.priority > key) {
+                break;
+            }
+
+            prev = t;
+        }
+
+        vtimer_list_insert(&due_list, prev, timer, VTIMER_LIST_DUE);
+        return;
+    }
+
+    uint32_t diff = (key ^ wheel_now) >> VTIMER_WHEEL_SHIFT;
+    unsigned level = 0;
+
+    while (diff >= VTIMER_WHEEL_SLOTS) {
+        diff >>= VTIMER_WHEEL_BITS;
+        level++;
+    }
+
+    unsigned slot = (key >> (VTIMER_WHEEL_SHIFT + level * VTIMER_WHEEL_BITS)) &
+                    VTIMER_WHEEL_MASK;
+
+    vtimer_list_insert(&wheel[level][slot], NULL, timer,
+                       VTIMER_LIST_WHEEL + level * VTIMER_WHEEL_SLOTS + slot);
+    wheel_bitmap[level] |= (1u << slot);
+}
+
+/**
+ * @brief   Finds the wheel slot that has to be cascaded next.
+ *
+ * @return  1 and the key at which the slot starts, 0 if the wheel is empty
+ */
+static int wheel_next_slot(unsigned *level, unsigned *slot, uint32_t *key)
+{
+    for (unsigned l = 0; l < VTIMER_WHEEL_LEVELS; l++) {
+        if (wheel_bitmap[l] == 0) {
+            continue;
+        }
+
+        unsigned shift = VTIMER_WHEEL_SHIFT + l * VTIMER_WHEEL_BITS;
+        unsigned idx = (wheel_now >> shift) & VTIMER_WHEEL_MASK;
+        unsigned pending = wheel_bitmap[l] & ~((2u << idx) - 1);
+
+        if (pending == 0) {
+            DEBUG("wheel_next_slot: level %u has no slot ahead\n", l);
+            continue;
+        }
+
+        *level = l;
+        *slot = number_of_lowest_bit(pending);
+        *key = ((uint32_t) *slot) << shift;
+
+        if ((shift + VTIMER_WHEEL_BITS) < 32) {
+            *key |= (wheel_now >> (shift + VTIMER_WHEEL_BITS))
+                    << (shift + VTIMER_WHEEL_BITS);
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/* move the wheel forward to *to*, cascading every slot it passes */
+static void wheel_advance(uint32_t to)
+{
+    unsigned level, slot;
+    uint32_t key;
+
+    while (wheel_next_slot(&level, &slot, &key) && (key <= to)) {
+        vtimer_t *timer = wheel[level][slot];
+
+        wheel[level][slot] = NULL;
+        wheel_bitmap[level] &= ~(1u << slot);
+        wheel_now = key;
+
+        while (timer != NULL) {
+            vtimer_t *next = VTIMER_NEXT(timer);
+            wheel_insert(timer);
+            timer = next;
+        }
+    }
+
+    if (to > wheel_now) {
+        wheel_now = to;
+    }
+}
+
+/*
+ * The latest time in [absolute, absolute + slack] with the most low bits
+ * clear.  Timers of a similar deadline and slack round to the same time
+ * and are shot by one hwtimer interrupt.
+ */
+static uint64_t vtimer_apply_slack(uint64_t absolute, uint32_t slack)
+{
+    uint64_t limit = absolute + slack;
+    uint64_t mask = absolute ^ limit;
+    unsigned bit = 0;
+
+    if (slack == 0) {
+        return absolute;
+    }
+
+    while (mask >>= 1) {
+        bit++;
+    }
+
+    return limit & ~(((uint64_t) 1 << bit) - 1);
+}
+
+static uint32_t wheel_position_now(void)
+{
+    return HWTIMER_TICKS_TO_US(hwtimer_now()) - longterm_tick_start;
+}
+
 static int set_longterm(vtimer_t *timer)
 {
     timer->queue_entry.priority = timer->absolute.seconds;
-    queue_priority_add(&longterm_queue_root, (queue_node_t *)timer);
+    vtimer_list_insert(&longterm_list, NULL, timer, VTIMER_LIST_LONGTERM);
     return 0;
 }
 
 static int update_shortterm(void)
 {
-    if (shortterm_queue_root.next == NULL) {
-        /* there is no vtimer to schedule, queue is empty */
-        DEBUG("update_shortterm: shortterm_queue_root.next == NULL - dont know what to do here\n");
-        return 0;
+    vtimer_t *target = due_list;
+    uint32_t key;
+
+    if (target != NULL) {
+        key = target->queue_entry.priority;
     }
+    else {
+        unsigned level, slot;
+
+        if (!wheel_next_slot(&level, &slot, &key)) {
+            /* there is no vtimer to schedule, wheel is empty */
+            DEBUG("update_shortterm: wheel is empty - dont know what to do here\n");
+            return 0;
+        }
+    }
+
     if (hwtimer_id != -1) {
         /* there is a running hwtimer for us */
-        if (hwtimer_next_absolute != shortterm_queue_root.next->priority) {
-            /* the next timer in the vtimer queue is not the next hwtimer */
+        if ((hwtimer_target != target) || (hwtimer_next_absolute != key)) {
+            /* the next event in the wheel is not the next hwtimer */
             /* we have to remove the running hwtimer (and schedule a new one) */
             hwtimer_remove(hwtimer_id);
         }
         else {
-            /* the next vtimer is the next hwtimer, nothing to do */
+            /* the next event is the next hwtimer, nothing to do */
             return 0;
         }
     }
 
-    /* short term part of the next vtimer */
-    hwtimer_next_absolute = shortterm_queue_root.next->priority;
+    hwtimer_target = target;
+    hwtimer_next_absolute = key;
 
-    uint32_t next = hwtimer_next_absolute;
+    /* wheel keys are offsets from the start of the current long term tick */
+    uint32_t next = key + longterm_tick_start;
 
     /* current short term time */
     uint32_t now = HWTIMER_TICKS_TO_US(hwtimer_now());
 
-    /* make sure the longterm_tick_timer does not get truncated */
-    if (((vtimer_t*)shortterm_queue_root.next)->action != vtimer_tick) {
-        /* the next vtimer to schedule is the long term tick */
-        /* it has a shortterm offset of longterm_tick_start */
-        next += longterm_tick_start;
-    }
-
     if((next -  HWTIMER_TICKS_TO_US(VTIMER_THRESHOLD) - now) > MICROSECONDS_PER_TICK ) {
         DEBUG("truncating next (next -  HWTIMER_TICKS_TO_US(VTIMER_THRESHOLD) - now): %lu\n", (next -  HWTIMER_TICKS_TO_US(VTIMER_THRESHOLD) - now));
         next = now +  HWTIMER_TICKS_TO_US(VTIMER_BACKOFF);
@@ -122,20 +361,38 @@ void vtimer_tick(void *ptr)
     DEBUG("vtimer_tick().\n");
     seconds += SECONDS_PER_TICK;
 
+    /* a tick is shorter than a hwtimer period, this catches every overflow */
+    vtimer_now64();
+
     longterm_tick_start = longterm_tick_timer.absolute.microseconds;
     longterm_tick_timer.absolute.microseconds += MICROSECONDS_PER_TICK;
-    set_shortterm(&longterm_tick_timer);
 
-    while (longterm_queue_root.next) {
-        vtimer_t *timer = (vtimer_t *) longterm_queue_root.next;
+    /* timers due together with the tick are now offsets into the new tick */
+    for (vtimer_t *t = due_list; t != NULL; t = VTIMER_NEXT(t)) {
+        if (t->queue_entry.priority > MICROSECONDS_PER_TICK) {
+            t->queue_entry.priority -= MICROSECONDS_PER_TICK;
+        }
+        else {
+            t->queue_entry.priority = 0;
+        }
+    }
+
+    wheel_now = 0;
+
+    longterm_tick_timer.queue_entry.priority = MICROSECONDS_PER_TICK;
+    wheel_insert(&longterm_tick_timer);
+
+    vtimer_t *timer = longterm_list;
+
+    while (timer != NULL) {
+        vtimer_t *next = VTIMER_NEXT(timer);
 
         if (timer->absolute.seconds == seconds) {
-            timer = (vtimer_t *) queue_remove_head(&longterm_queue_root);
+            vtimer_list_unlink(timer);
             set_shortterm(timer);
         }
-        else {
-            break;
-        }
+
+        timer = next;
     }
 }
 
@@ -143,28 +400,17 @@ static int set_shortterm(vtimer_t *timer)
 {
     DEBUG("set_shortterm(): Absolute: %" PRIu32 " %" PRIu32 "\n", timer->absolute.seconds, timer->absolute.microseconds);
     timer->queue_entry.priority = timer->absolute.microseconds;
-    queue_priority_add(&shortterm_queue_root, (queue_node_t *)timer);
+    wheel_insert(timer);
     return 1;
 }
 
-void vtimer_callback(void *ptr)
+static void vtimer_shoot(vtimer_t *timer)
 {
-    DEBUG("vtimer_callback ptr=%p\n", ptr);
-
-    (void) ptr;
-    vtimer_t *timer;
-    in_callback = true;
-    hwtimer_id = -1;
-
-    /* get the vtimer that fired */
-    timer = (vtimer_t *)queue_remove_head(&shortterm_queue_root);
-
 #if ENABLE_DEBUG
     vtimer_print(timer);
 #endif
     DEBUG("vtimer_callback(): Shooting %" PRIu32 ".\n", timer->absolute.microseconds);
 
-    /* shoot timer */
     if (timer->action == (void (*)(void *)) msg_send_int) {
         msg_t msg;
         msg.type = MSG_TIMER;
@@ -174,6 +420,9 @@ void vtimer_callback(void *ptr)
     else if (timer->action == (void (*)(void *)) thread_wakeup){
         timer->action(timer->arg);
     }
+    else if (timer->action == (void (*)(void *)) thread_flags_set) {
+        thread_flags_set(timer->pid, (thread_flags_t)(uintptr_t) timer->arg);
+    }
     else if (timer->action == vtimer_tick) {
         vtimer_tick(NULL);
     }
@@ -184,44 +433,71 @@ void vtimer_callback(void *ptr)
     else {
         DEBUG("Timer was poisoned.\n");
     }
-
-    in_callback = false;
-    update_shortterm();
 }
 
-void normalize_to_tick(timex_t *time)
+void vtimer_callback(void *ptr)
 {
-    DEBUG("Normalizing: %" PRIu32 " %" PRIu32 "\n", time->seconds, time->microseconds);
-    uint32_t seconds_tmp = time->seconds % SECONDS_PER_TICK;
-    time->seconds -= seconds_tmp;
-    uint32_t usecs_tmp = time->microseconds + (seconds_tmp * 1000000);
-    DEBUG("Normalizin2: %" PRIu32 " %" PRIu32 "\n", time->seconds, usecs_tmp);
+    DEBUG("vtimer_callback ptr=%p\n", ptr);
+
+    (void) ptr;
+    vtimer_t *timer;
+    in_callback = true;
+    hwtimer_id = -1;
+
+    if (hwtimer_target == NULL) {
+        /* we reached a wheel slot, move its timers closer to the front */
+        uint32_t now = wheel_position_now();
+        wheel_advance((now > hwtimer_next_absolute) &&
+                      (now <= MICROSECONDS_PER_TICK) ?
+                      now : hwtimer_next_absolute);
+        in_callback = false;
+        update_shortterm();
+        return;
+    }
+
+    /* get the vtimer that fired */
+    timer = due_list;
 
-    if (usecs_tmp < time->microseconds) {
-        usecs_tmp -= MICROSECONDS_PER_TICK;
-        time->seconds += SECONDS_PER_TICK;
+    if (timer != hwtimer_target) {
+        DEBUG("vtimer_callback(): armed timer was removed\n");
+        in_callback = false;
+        update_shortterm();
+        return;
     }
 
-    if (usecs_tmp > MICROSECONDS_PER_TICK) {
-        usecs_tmp -= MICROSECONDS_PER_TICK;
-        time->seconds += SECONDS_PER_TICK;
+    vtimer_list_unlink(timer);
+
+    vtimer_shoot(timer);
+
+    /* timers due by now ride along, the slack of their owners made them meet */
+    for (uint32_t now = wheel_position_now();
+         (due_list != NULL) && (now <= MICROSECONDS_PER_TICK) &&
+         (due_list->queue_entry.priority <= now);
+         now = wheel_position_now()) {
+        timer = due_list;
+        vtimer_list_unlink(timer);
+        vtimer_shoot(timer);
     }
 
-    time->microseconds = usecs_tmp;
-    DEBUG("     Result: %" PRIu32 " %" PRIu32 "\n", time->seconds, time->microseconds);
+    in_callback = false;
+    update_shortterm();
 }
 
 static int vtimer_set(vtimer_t *timer)
 {
     DEBUG("vtimer_set(): New timer. Offset: %" PRIu32 " %" PRIu32 "\n", timer->absolute.seconds, timer->absolute.microseconds);
 
-    timex_t now;
-    vtimer_now(&now);
-    timer->absolute = timex_add(now, timer->absolute);
-    normalize_to_tick(&(timer->absolute));
+    /* split the absolute time into its long term tick and the offset into it */
+    uint64_t absolute = vtimer_apply_slack(vtimer_now64() +
+                                           timex_uint64(timer->absolute),
+                                           timer->slack);
+    uint16_t rem;
+
+    /* MICROSECONDS_PER_TICK = 2^18 * 15625 */
+    timer->absolute.seconds = timex_udiv64(absolute >> 18, 15625, &rem) * SECONDS_PER_TICK;
+    timer->absolute.microseconds = ((uint32_t) rem << 18) | ((uint32_t) absolute & 0x3ffff);
 
     DEBUG("vtimer_set(): Absolute: %" PRIu32 " %" PRIu32 "\n", timer->absolute.seconds, timer->absolute.microseconds);
-    DEBUG("vtimer_set(): NOW: %" PRIu32 " %" PRIu32 "\n", now.seconds, now.microseconds);
 
     int result = 0;
 
@@ -233,6 +509,13 @@ static int vtimer_set(vtimer_t *timer)
 
     int state = disableIRQ();
 
+    /* catch the wheel up so the new timer is filed relative to now */
+    uint32_t position = wheel_position_now();
+
+    if (!in_callback && (position <= MICROSECONDS_PER_TICK)) {
+        wheel_advance(position);
+    }
+
     if (timer->absolute.seconds != seconds) {
         /* we're long-term */
         DEBUG("vtimer_set(): setting long_term\n");
@@ -258,13 +541,42 @@ static int vtimer_set(vtimer_t *timer)
     return result;
 }
 
-void vtimer_now(timex_t *out)
+uint64_t vtimer_now64(void)
 {
-    uint32_t us = HWTIMER_TICKS_TO_US(hwtimer_now() - longterm_tick_start);
-    uint32_t us_per_s = 1000ul * 1000ul;
+    int state = disableIRQ();
+    uint32_t now = hwtimer_now();
+
+    if (now < now64_last) {
+        now64_wraps++;
+    }
 
-    out->seconds = seconds + us / us_per_s;
-    out->microseconds = us % us_per_s;
+    now64_last = now;
+    uint64_t ticks = ((uint64_t) now64_wraps << 32) | now;
+
+    restoreIRQ(state);
+    return HWTIMER_TICKS_TO_US(ticks);
+}
+
+uint64_t vtimer_now64_at(unsigned long ticks)
+{
+    int state = disableIRQ();
+    uint32_t now = hwtimer_now();
+
+    if (now < now64_last) {
+        now64_wraps++;
+    }
+
+    now64_last = now;
+    uint64_t at = (((uint64_t) now64_wraps << 32) | now) -
+                  (uint32_t)(now - (uint32_t) ticks);
+
+    restoreIRQ(state);
+    return HWTIMER_TICKS_TO_US(at);
+}
+
+void vtimer_now(timex_t *out)
+{
+    *out = timex_from_uint64(vtimer_now64());
 }
 
 void vtimer_gettimeofday(struct timeval *tp) {
@@ -297,12 +609,14 @@ int vtimer_init()
 
     longterm_tick_timer.action = vtimer_tick;
     longterm_tick_timer.arg = NULL;
+    longterm_tick_timer.slack = 0;
 
     longterm_tick_timer.absolute.seconds = 0;
     longterm_tick_timer.absolute.microseconds = MICROSECONDS_PER_TICK;
 
     DEBUG("vtimer_init(): Setting longterm tick to %" PRIu32 "\n", longterm_tick_timer.absolute.microseconds);
 
+    wheel_now = 0;
     set_shortterm(&longterm_tick_timer);
     update_shortterm();
 
@@ -311,16 +625,34 @@ int vtimer_init()
 }
 
 int vtimer_set_wakeup(vtimer_t *t, timex_t interval, int pid)
+{
+    return vtimer_set_wakeup_slack(t, interval, 0, pid);
+}
+
+int vtimer_set_wakeup_slack(vtimer_t *t, timex_t interval, uint32_t slack,
+                            int pid)
 {
     int ret;
     t->action = (void(*)(void *)) thread_wakeup;
     t->arg = (void *) pid;
     t->absolute = interval;
+    t->slack = slack;
     t->pid = 0;
     ret = vtimer_set(t);
     return ret;
 }
 
+int vtimer_set_flags(vtimer_t *t, timex_t interval, int pid,
+                     thread_flags_t flags)
+{
+    t->action = (void(*)(void *)) thread_flags_set;
+    t->arg = (void *)(uintptr_t) flags;
+    t->absolute = interval;
+    t->slack = 0;
+    t->pid = pid;
+    return vtimer_set(t);
+}
+
 int vtimer_usleep(uint32_t usecs)
 {
     timex_t offset = timex_set(0, usecs);
@@ -328,6 +660,11 @@ int vtimer_usleep(uint32_t usecs)
 }
 
 int vtimer_sleep(timex_t time)
+{
+    return vtimer_sleep_slack(time, 0);
+}
+
+int vtimer_sleep_slack(timex_t time, uint32_t slack)
 {
     int ret;
     vtimer_t t;
@@ -338,6 +675,7 @@ int vtimer_sleep(timex_t time)
     t.action = (void(*)(void *)) mutex_unlock;
     t.arg = (void *) &mutex;
     t.absolute = time;
+    t.slack = slack;
 
     ret = vtimer_set(&t);
     mutex_lock(&mutex);
@@ -346,10 +684,15 @@ int vtimer_sleep(timex_t time)
 
 int vtimer_remove(vtimer_t *t)
 {
-    queue_remove(&shortterm_queue_root, (queue_node_t *)t);
-    queue_remove(&longterm_queue_root, (queue_node_t *)t);
+    int state = disableIRQ();
 
-    update_shortterm();
+    vtimer_list_unlink(t);
+
+    if (!in_callback) {
+        update_shortterm();
+    }
+
+    restoreIRQ(state);
 
     if (!inISR()) {
         eINT();
@@ -359,41 +702,84 @@ int vtimer_remove(vtimer_t *t)
 }
 
 int vtimer_set_msg(vtimer_t *t, timex_t interval, unsigned int pid, void *ptr)
+{
+    return vtimer_set_msg_slack(t, interval, 0, pid, ptr);
+}
+
+int vtimer_set_msg_slack(vtimer_t *t, timex_t interval, uint32_t slack,
+                         unsigned int pid, void *ptr)
 {
     t->action = (void(*)(void *)) msg_send_int;
     t->arg = ptr;
     t->absolute = interval;
+    t->slack = slack;
     t->pid = pid;
     vtimer_set(t);
     return 0;
 }
 
 int vtimer_msg_receive_timeout(msg_t *m, timex_t timeout) {
-    msg_t timeout_message;
-    timeout_message.type = MSG_TIMER;
-    timeout_message.content.ptr = (char *) &timeout_message;
+    unsigned long ticks;
+    uint64_t then = vtimer_now64() + timex_uint64(timeout);
 
-    vtimer_t t;
-    vtimer_set_msg(&t, timeout, thread_pid, &timeout_message);
-    msg_receive(m);
-    if (m->type == MSG_TIMER && m->content.ptr == (char *) &timeout_message) {
-        /* we hit the timeout */
-        return -1;
+    while ((ticks = vtimer_timeout_ticks64(then)) > 0) {
+        if (msg_receive_timeout(m, ticks) >= 0) {
+            return 1;
+        }
     }
-    else {
-        vtimer_remove(&t);
-        return 1;
+
+    /* we hit the timeout */
+    return msg_try_receive(m);
+}
+
+unsigned long vtimer_timeout_ticks(timex_t then)
+{
+    return vtimer_timeout_ticks64(timex_uint64(then));
+}
+
+unsigned long vtimer_timeout_ticks64(uint64_t then)
+{
+    uint64_t now = vtimer_now64();
+
+    if (then <= now) {
+        return 0;
+    }
+
+    if ((then - now) >= (uint64_t) VTIMER_TIMEOUT_MAX * 1000000) {
+        return (unsigned long) VTIMER_TIMEOUT_MAX * HWTIMER_SPEED;
     }
+
+    unsigned long ticks = HWTIMER_TICKS((uint32_t) (then - now));
+
+    /* less than a tick is still a timeout */
+    return ticks ? ticks : 1;
 }
 
 #if ENABLE_DEBUG
 
+static void vtimer_print_list(vtimer_t *t)
+{
+    for (; t != NULL; t = VTIMER_NEXT(t)) {
+        printf("Timer %p: priority %" PRIu32 "\n", t, t->queue_entry.priority);
+    }
+}
+
 void vtimer_print_short_queue(){
-    queue_print(&shortterm_queue_root);
+    printf("due:\n");
+    vtimer_print_list(due_list);
+
+    for (unsigned l = 0; l < VTIMER_WHEEL_LEVELS; l++) {
+        for (unsigned s = 0; s < VTIMER_WHEEL_SLOTS; s++) {
+            if (wheel[l][s] != NULL) {
+                printf("wheel level %u slot %u:\n", l, s);
+                vtimer_print_list(wheel[l][s]);
+            }
+        }
+    }
 }
 
 void vtimer_print_long_queue(){
-    queue_print(&longterm_queue_root);
+    vtimer_print_list(longterm_list);
 }
 
 void vtimer_print(vtimer_t *t)
@@ -0,0 +1,178 @@
+/**
+ * Shared executor for deferred work
+ *
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ *
+ * @ingroup sys_workqueue
+ * @{
+ * @file    workqueue.c
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "kernel.h"
+#include "irq.h"
+#include "sched.h"
+#include "thread.h"
+#include "hwtimer.h"
+#include "workqueue.h"
+
+#define ENABLE_DEBUG    (0)
+#include "debug.h"
+
+static char stacks[WORKQUEUE_WORKERS][WORKQUEUE_STACKSIZE];
+
+/* queued work, by priority and then in the order of posting */
+static work_t *queue;
+
+/* workers sleeping for want of work */
+static int idle[WORKQUEUE_WORKERS];
+static unsigned int idle_count;
+
+static volatile int workers;
+
+/* called with interrupts disabled, returns the worker to wake up or -1 */
+static int enqueue(work_t *work)
+{
+    work_t **p = &queue;
+
+    while (*p && ((*p)->priority <= work->priority)) {
+        p = &(*p)->next;
+    }
+
+    work->next = *p;
+    *p = work;
+    work->queued = 1;
+
+    return idle_count ? idle[--idle_count] : -1;
+}
+
+/* called with interrupts disabled */
+static int dequeue(work_t *work)
+{
+    work_t **p = &queue;
+
+    if (!work->queued) {
+        return 0;
+    }
+
+    while (*p != work) {
+        p = &(*p)->next;
+    }
+
+    *p = work->next;
+    work->queued = 0;
+    return 1;
+}
+
+static void worker(void)
+{
+    while (1) {
+        unsigned state = disableIRQ();
+        work_t *work = queue;
+
+        if (work == NULL) {
+            idle[idle_count++] = thread_pid;
+            sched_set_status((tcb_t *) active_thread, STATUS_SLEEPING);
+            restoreIRQ(state);
+            thread_yield();
+            continue;
+        }
+
+        queue = work->next;
+        work->queued = 0;
+        restoreIRQ(state);
+
+        DEBUG("workqueue: %d runs %p\n", thread_pid, (void *) work);
+        /* the handler may post the work again */
+        work->handler(work);
+    }
+}
+
+static void timeout(void *arg)
+{
+    workqueue_post((work_t *) arg);
+}
+
+void workqueue_work_init(work_t *work, void (*handler)(work_t *), void *arg,
+                         uint8_t priority)
+{
+    work->next = NULL;
+    work->timer.next = NULL;
+    work->timer.pprev = NULL;
+    work->handler = handler;
+    work->arg = arg;
+    work->priority = priority;
+    work->queued = 0;
+}
+
+int workqueue_init(void)
+{
+    unsigned state = disableIRQ();
+
+    /* taken before the workers run, a second caller sees it */
+    if (workers == 0) {
+        workers = -1;
+        restoreIRQ(state);
+
+        int started = 0;
+
+        for (int i = 0; i < WORKQUEUE_WORKERS; i++) {
+            if (thread_create(stacks[i], WORKQUEUE_STACKSIZE,
+                              WORKQUEUE_PRIORITY, CREATE_STACKTEST,
+                              worker, "workqueue") >= 0) {
+                started++;
+            }
+        }
+
+        DEBUG("workqueue: %d workers\n", started);
+        workers = started ? started : 0;
+        return started ? 0 : -1;
+    }
+
+    restoreIRQ(state);
+    return 0;
+}
+
+int workqueue_post(work_t *work)
+{
+    unsigned state = disableIRQ();
+    int pid = -1;
+    int res = 0;
+
+    if (!work->queued) {
+        pid = enqueue(work);
+        res = 1;
+    }
+
+    restoreIRQ(state);
+
+    if (pid >= 0) {
+        thread_wakeup(pid);
+    }
+
+    return res;
+}
+
+void workqueue_post_in(work_t *work, unsigned long us)
+{
+    hwtimer_entry_set(&work->timer, HWTIMER_TICKS(us), timeout, work);
+}
+
+int workqueue_cancel(work_t *work)
+{
+    unsigned state = disableIRQ();
+    int res = (work->timer.pprev != NULL);
+
+    hwtimer_entry_remove(&work->timer);
+    res |= dequeue(work);
+
+    restoreIRQ(state);
+    return res;
+}
@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   Costs of the containers in core and sys
+ *
+ * Every container is filled with *size* elements, searched for each of
+ * them and emptied again, BENCH_ROUNDS times for each size.  Every
+ * operation prints one line
+ *
+ *     BENCH <container>_<op> size=<n> ops=<count> per_op=<cost> unit=<unit>
+ *
+ * where unit is "cycles" on Cortex-M3 (DWT cycle counter) and "ns",
+ * derived from the hwtimer, elsewhere.  Containers without a lookup or a
+ * remove skip that line.  The hwtimer resolution is coarse on some
+ * platforms, raise BENCH_ROUNDS for stable numbers there.
+ *
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "hwtimer.h"
+#include "cib.h"
+#include "clist.h"
+#include "lifo.h"
+#include "queue.h"
+#include "ringbuffer.h"
+#include "spsc_ringbuffer.h"
+#include "hashtable.h"
+#include "rhtable.h"
+#include "bloom.h"
+
+#ifndef BENCH_ROUNDS
+#define BENCH_ROUNDS        (20)
+#endif
+
+/* power of two, cib needs it */
+#define BENCH_MAX_SIZE      (256)
+
+/* Fibonacci hashing spreads the keys 0..size - 1 */
+#define BENCH_KEY(i)        ((uint32_t) (i) * 2654435761u)
+
+#if defined(__ARM_ARCH_7M__) && defined(DWT)
+#define BENCH_UNIT          "cycles"
+
+static void bench_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline unsigned long bench_now(void)
+{
+    return DWT->CYCCNT;
+}
+
+static unsigned long bench_per_op(unsigned long total, unsigned long ops)
+{
+    return total / ops;
+}
+#else
+#define BENCH_UNIT          "ns"
+
+static void bench_init(void)
+{
+}
+
+static inline unsigned long bench_now(void)
+{
+    return hwtimer_now();
+}
+
+static unsigned long bench_per_op(unsigned long total, unsigned long ops)
+{
+    return (unsigned long) ((unsigned long long) total * 1000000000ull /
+                            HWTIMER_SPEED / ops);
+}
+#endif
+
+/* time spent in each operation, summed over the rounds */
+typedef struct {
+    unsigned long insert;
+    unsigned long lookup;
+    unsigned long remove;
+} bench_t;
+
+static const unsigned int sizes[] = { 8, 64, BENCH_MAX_SIZE };
+
+/* the node containers take turns */
+static union {
+    clist_node_t clist[BENCH_MAX_SIZE];
+    queue_node_t queue[BENCH_MAX_SIZE];
+} nodes;
+
+static int lifo[BENCH_MAX_SIZE + 1];
+static char buffer[BENCH_MAX_SIZE];
+
+struct rh_slot {
+    uint32_t key;
+    uint32_t value;
+};
+
+/* a load of one half, like a table dimensioned for its peak */
+static struct rh_slot rh_slots[2 * BENCH_MAX_SIZE];
+static uint8_t rh_psl[2 * BENCH_MAX_SIZE];
+
+/* ten bits per element, k = 7, about 1% false positives */
+#define BLOOM_BITS_PER_ELEMENT  (10)
+static uint8_t bloom_bits[BLOOM_BITFIELD_SIZE(BLOOM_BITS_PER_ELEMENT *
+                                              BENCH_MAX_SIZE)];
+
+/* keeps the compiler from dropping lookups whose result is not used */
+static volatile unsigned long sink;
+
+static void report(const char *name, const char *op, unsigned int size,
+                   unsigned long total)
+{
+    unsigned long ops = (unsigned long) size * BENCH_ROUNDS;
+
+    printf("BENCH %s_%s size=%u ops=%lu per_op=%lu unit=%s\n", name, op,
+           size, ops, bench_per_op(total, ops), BENCH_UNIT);
+}
+
+/* operations a container has besides insert */
+#define BENCH_LOOKUP        (0x01)
+#define BENCH_REMOVE        (0x02)
+
+static void report_all(const char *name, uint8_t ops, unsigned int size,
+                       const bench_t *b)
+{
+    report(name, "insert", size, b->insert);
+
+    if (ops & BENCH_LOOKUP) {
+        report(name, "lookup", size, b->lookup);
+    }
+
+    if (ops & BENCH_REMOVE) {
+        report(name, "remove", size, b->remove);
+    }
+}
+
+static void bench_cib(unsigned int size, bench_t *b)
+{
+    cib_t cib;
+    unsigned long start;
+
+    cib_init(&cib, size);
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += cib_put(&cib);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += cib_avail(&cib);
+        }
+        b->lookup += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += cib_get(&cib);
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static void bench_clist(unsigned int size, bench_t *b)
+{
+    clist_node_t *list = NULL;
+    unsigned long start;
+
+    for (unsigned int i = 0; i < size; i++) {
+        nodes.clist[i].data = i;
+    }
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            clist_add(&list, &nodes.clist[i]);
+        }
+        b->insert += bench_now() - start;
+
+        /* walks the list to each node */
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            clist_node_t *n = list;
+
+            while (n->data != i) {
+                n = n->next;
+            }
+
+            sink += n->data;
+        }
+        b->lookup += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            clist_remove(&list, &nodes.clist[i]);
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static void bench_lifo(unsigned int size, bench_t *b)
+{
+    unsigned long start;
+
+    lifo_init(lifo, size);
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            lifo_insert(lifo, i);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += lifo_get(lifo);
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static void bench_queue(unsigned int size, bench_t *b)
+{
+    queue_node_t root = { NULL, 0, 0 };
+    unsigned long start;
+
+    /* priorities in no particular order, so the insert walks the queue */
+    for (unsigned int i = 0; i < size; i++) {
+        nodes.queue[i].data = i;
+        nodes.queue[i].priority = BENCH_KEY(i) >> 24;
+    }
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            queue_priority_add(&root, &nodes.queue[i]);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += queue_remove_head(&root)->data;
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static void bench_ringbuffer(unsigned int size, bench_t *b)
+{
+    ringbuffer_t rb;
+    unsigned long start;
+
+    ringbuffer_init(&rb, buffer, size);
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            rb_add_element(&rb, (char) i);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += rb_peek_element(&rb);
+        }
+        b->lookup += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += rb_get_element(&rb);
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static void bench_spsc_ringbuffer(unsigned int size, bench_t *b)
+{
+    spsc_ringbuffer_t rb;
+    unsigned long start;
+    char c = 0;
+
+    spsc_rb_init(&rb, buffer, size);
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += spsc_rb_put(&rb, &c, 1);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            sink += spsc_rb_get(&rb, &c, 1);
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static unsigned int hashtable_hash(void *key)
+{
+    return *(uint32_t *) key;
+}
+
+static int hashtable_eq(void *a, void *b)
+{
+    return *(uint32_t *) a == *(uint32_t *) b;
+}
+
+/* the table owns its keys, so every insert includes a malloc() and every
+ * remove a free(), as for any user of it */
+static void bench_hashtable(unsigned int size, bench_t *b)
+{
+    struct hashtable *h = create_hashtable(size, hashtable_hash, hashtable_eq);
+    unsigned long start;
+
+    if (h == NULL) {
+        puts("BENCH hashtable: out of memory");
+        return;
+    }
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t *key = malloc(sizeof(*key));
+
+            if (key == NULL) {
+                break;
+            }
+
+            *key = BENCH_KEY(i);
+            hashtable_insert(h, key, &nodes);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            sink += (unsigned long) hashtable_search(h, &key);
+        }
+        b->lookup += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            sink += (unsigned long) hashtable_remove(h, &key);
+        }
+        b->remove += bench_now() - start;
+    }
+
+    hashtable_destroy(h, 0);
+}
+
+static void bench_rhtable(unsigned int size, bench_t *b)
+{
+    rhtable_t t;
+    unsigned long start;
+
+    rhtable_init(&t, rh_slots, rh_psl, 2 * size, sizeof(struct rh_slot),
+                 sizeof(uint32_t), offsetof(struct rh_slot, value),
+                 sizeof(uint32_t), NULL);
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            rhtable_insert(&t, &key, &i);
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            sink += (unsigned long) rhtable_search(&t, &key);
+        }
+        b->lookup += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            sink += rhtable_remove(&t, &key, NULL);
+        }
+        b->remove += bench_now() - start;
+    }
+}
+
+static void bench_bloom(unsigned int size, bench_t *b)
+{
+    struct bloom_t bloom;
+    unsigned long start;
+
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        /* a bloom filter is emptied by starting over */
+        bloom_init(&bloom, BLOOM_BITS_PER_ELEMENT * size, bloom_bits, 7, r,
+                   BLOOM_DOUBLE_HASH);
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            bloom_add(&bloom, (const uint8_t *) &key, sizeof(key));
+        }
+        b->insert += bench_now() - start;
+
+        start = bench_now();
+        for (unsigned int i = 0; i < size; i++) {
+            uint32_t key = BENCH_KEY(i);
+            sink += bloom_check(&bloom, (const uint8_t *) &key, sizeof(key));
+        }
+        b->lookup += bench_now() - start;
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*run)(unsigned int size, bench_t *b);
+    uint8_t ops;
+} containers[] = {
+    { "cib", bench_cib, BENCH_LOOKUP | BENCH_REMOVE },
+    { "clist", bench_clist, BENCH_LOOKUP | BENCH_REMOVE },
+    { "lifo", bench_lifo, BENCH_REMOVE },
+    { "queue", bench_queue, BENCH_REMOVE },
+    { "ringbuffer", bench_ringbuffer, BENCH_LOOKUP | BENCH_REMOVE },
+    { "spsc_ringbuffer", bench_spsc_ringbuffer, BENCH_REMOVE },
+    { "hashtable", bench_hashtable, BENCH_LOOKUP | BENCH_REMOVE },
+    { "rhtable", bench_rhtable, BENCH_LOOKUP | BENCH_REMOVE },
+    { "bloom", bench_bloom, BENCH_LOOKUP },
+};
+
+int main(void)
+{
+    bench_init();
+
+    printf("BENCH start hwtimer_speed=%lu rounds=%d\n",
+           (unsigned long) HWTIMER_SPEED, BENCH_ROUNDS);
+
+    for (unsigned int c = 0; c < sizeof(containers) / sizeof(containers[0]);
+         c++) {
+        for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            bench_t b = { 0, 0, 0 };
+
+            containers[c].run(sizes[s], &b);
+            report_all(containers[c].name, containers[c].ops, sizes[s], &b);
+        }
+    }
+
+    puts("BENCH done");
+    return 0;
+}
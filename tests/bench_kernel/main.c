@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   Costs of kernel primitives
+ *
+ * Every benchmark prints one line
+ *
+ *     BENCH <name> iterations=<n> total=<count> unit=<unit>
+ *
+ * where unit is "cycles" on Cortex-M3 (DWT cycle counter) and "ticks" of
+ * the hwtimer, at HWTIMER_SPEED per second, elsewhere.
+ *
+ * @author  Freie Universität Berlin, Computer Systems & Telematics
+ *
+ * @}
+ */
+
+#include <stdio.h>
+
+#include "cpu.h"
+#include "kernel.h"
+#include "thread.h"
+#include "msg.h"
+#include "mutex.h"
+#include "hwtimer.h"
+#include "vtimer.h"
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS    (1000)
+#endif
+
+#define STACK_SIZE          (KERNEL_CONF_STACKSIZE_MAIN)
+
+#if defined(__ARM_ARCH_7M__) && defined(DWT)
+#define BENCH_UNIT          "cycles"
+
+static void bench_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline unsigned long bench_now(void)
+{
+    return DWT->CYCCNT;
+}
+#else
+#define BENCH_UNIT          "ticks"
+
+static void bench_init(void)
+{
+}
+
+static inline unsigned long bench_now(void)
+{
+    return hwtimer_now();
+}
+#endif
+
+static char stack[STACK_SIZE];
+static int main_pid;
+static mutex_t mtx;
+
+static void report(const char *name, unsigned long total)
+{
+    printf("BENCH %s iterations=%d total=%lu unit=%s\n", name,
+           BENCH_ITERATIONS, total, BENCH_UNIT);
+}
+
+/* yields back to main, one context switch each way per round */
+static void yield_thread(void)
+{
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        thread_yield();
+    }
+}
+
+static void bench_switch(void)
+{
+    unsigned long start, total;
+
+    thread_create(stack, sizeof(stack), PRIORITY_MAIN,
+                  CREATE_STACKTEST | CREATE_WOUT_YIELD, yield_thread, "yield");
+    start = bench_now();
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        thread_yield();
+    }
+
+    total = bench_now() - start;
+
+    /* lets it return */
+    thread_yield();
+
+    report("context_switch_pair", total);
+}
+
+static void echo_thread(void)
+{
+    msg_t m;
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        msg_receive(&m);
+        msg_reply(&m, &m);
+    }
+}
+
+static void bench_msg(void)
+{
+    int pid = thread_create(stack, sizeof(stack), PRIORITY_MAIN - 1,
+                            CREATE_STACKTEST, echo_thread, "echo");
+    msg_t m, reply;
+    unsigned long start = bench_now();
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        m.content.value = i;
+        msg_send_receive(&m, &reply, pid);
+    }
+
+    report("msg_send_receive", bench_now() - start);
+}
+
+/* same as bench_msg() but without a priority difference to switch by */
+static void bench_msg_same_prio(void)
+{
+    int pid = thread_create(stack, sizeof(stack), PRIORITY_MAIN,
+                            CREATE_STACKTEST, echo_thread, "echo");
+    msg_t m, reply;
+    unsigned long start = bench_now();
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        m.content.value = i;
+        msg_send_receive(&m, &reply, pid);
+    }
+
+    unsigned long total = bench_now() - start;
+
+    /* lets it return */
+    thread_yield();
+
+    report("msg_send_receive_same_prio", total);
+}
+
+/* blocks on the mutex held by main and takes it over on unlock */
+static void mutex_thread(void)
+{
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        thread_sleep();
+        mutex_lock(&mtx);
+        mutex_unlock(&mtx);
+    }
+}
+
+static void bench_mutex(void)
+{
+    int pid = thread_create(stack, sizeof(stack), PRIORITY_MAIN - 1,
+                            CREATE_STACKTEST, mutex_thread, "mutex");
+    unsigned long total = 0;
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        unsigned long start;
+
+        mutex_lock(&mtx);
+        /* runs until it blocks on the mutex */
+        thread_wakeup(pid);
+
+        start = bench_now();
+        mutex_unlock(&mtx);
+        total += bench_now() - start;
+    }
+
+    report("mutex_handoff", total);
+}
+
+static void bench_vtimer(void)
+{
+    timex_t interval = timex_set(1, 0);
+    vtimer_t t;
+    unsigned long start = bench_now();
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        vtimer_set_msg(&t, interval, main_pid, NULL);
+        vtimer_remove(&t);
+    }
+
+    report("vtimer_set_remove", bench_now() - start);
+}
+
+static void exit_thread(void)
+{
+}
+
+static void bench_thread_create(void)
+{
+    unsigned long start = bench_now();
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        /* runs and exits right away, freeing its slot */
+        thread_create(stack, sizeof(stack), PRIORITY_MAIN - 1, 0,
+                      exit_thread, "exit");
+    }
+
+    report("thread_create_exit", bench_now() - start);
+}
+
+int main(void)
+{
+    main_pid = thread_getpid();
+    mutex_init(&mtx);
+    bench_init();
+
+    printf("BENCH start hwtimer_speed=%lu\n", (unsigned long) HWTIMER_SPEED);
+
+    /* the benchmark threads share one stack, each exits before the next
+     * one is created */
+    bench_switch();
+    bench_msg();
+    bench_msg_same_prio();
+    bench_mutex();
+    bench_vtimer();
+    bench_thread_create();
+
+    puts("BENCH done");
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief Round trips of sys/compress
+ *
+ * Encodes a slowly changing series, an LZ block and a sampler record,
+ * decodes them again in small pieces and prints the sizes reached.
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "compress.h"
+
+#define VALUES      (64)
+#define PIECE       (3)
+
+static int32_t values[VALUES];
+static int32_t decoded[VALUES];
+static uint8_t buf[VALUES * COMPRESS_VARINT_MAX];
+static uint8_t lz[COMPRESS_LZ_BOUND(sizeof(buf))];
+static uint8_t block[sizeof(buf)];
+
+static int test_delta(void)
+{
+    compress_delta_decoder_t dec;
+    int32_t prev = 0;
+    int count = 0, len;
+
+    for (int i = 0; i < VALUES; i++) {
+        /* a temperature in centidegrees with a jump */
+        values[i] = 2150 + (i % 5) - (i % 3) + ((i > VALUES / 2) ? -400 : 0);
+    }
+
+    len = compress_delta_encode(&prev, values, VALUES, buf, sizeof(buf));
+
+    if (len < 0) {
+        return -1;
+    }
+
+    compress_delta_decoder_init(&dec, 0);
+
+    for (int pos = 0; pos < len; pos += PIECE) {
+        const uint8_t *data = &buf[pos];
+        size_t n = (len - pos < PIECE) ? len - pos : PIECE;
+        int got;
+
+        while ((got = compress_delta_decode(&dec, &data, &n, &decoded[count],
+                                            VALUES - count)) > 0) {
+            count += got;
+        }
+
+        if (got < 0) {
+            return -1;
+        }
+    }
+
+    if ((count != VALUES) || memcmp(values, decoded, sizeof(values))) {
+        return -1;
+    }
+
+    printf("delta: %u bytes -> %d bytes\n", (unsigned) sizeof(values), len);
+    return len;
+}
+
+static int test_lz(int len)
+{
+    compress_lz_decoder_t dec;
+    int out;
+
+    out = compress_lz_encode(buf, len, lz, sizeof(lz));
+
+    if (out < 0) {
+        return -1;
+    }
+
+    compress_lz_decoder_init(&dec, block, sizeof(block));
+
+    for (int pos = 0; pos < out; pos += PIECE) {
+        if (compress_lz_decode(&dec, &lz[pos],
+                               (out - pos < PIECE) ? out - pos : PIECE) < 0) {
+            return -1;
+        }
+    }
+
+    if ((compress_lz_finish(&dec) != len) || memcmp(buf, block, len)) {
+        return -1;
+    }
+
+    printf("lz: %d bytes -> %d bytes\n", len, out);
+    return 0;
+}
+
+static int test_record(void)
+{
+    sampler_record_t record, copy;
+    int len;
+
+    record.id = 3;
+    record.count = SAMPLER_BATCH;
+    record.time = 123456;
+    record.period = 1000000;
+    memcpy(record.values, values, sizeof(record.values));
+
+    len = compress_record_encode(&record, buf, sizeof(buf));
+
+    if ((len < 0) || (compress_record_decode(buf, len, &copy) != len) ||
+        (copy.id != record.id) || (copy.count != record.count) ||
+        (copy.time != record.time) || (copy.period != record.period) ||
+        memcmp(copy.values, record.values, sizeof(record.values))) {
+        return -1;
+    }
+
+    printf("record: %u bytes -> %d bytes\n", (unsigned) sizeof(record), len);
+    return 0;
+}
+
+int main(void)
+{
+    int len = test_delta();
+
+    if ((len < 0) || (test_lz(len) < 0) || (test_record() < 0)) {
+        puts("FAILED");
+        return 1;
+    }
+
+    puts("SUCCESS");
+    return 0;
+}
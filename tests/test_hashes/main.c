@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief Hash function benchmark
+ *
+ * Times every hash of sys/hashes on keys of the sizes used by the lookup
+ * tables (IPv6 address, CCN name) and measures how many output bits
+ * change when a single input bit flips.
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "hashes.h"
+
+#define ROUNDS      (1000)
+
+static uint32_t xxh32_0(const uint8_t *buf, size_t len)
+{
+    return xxh32_hash(buf, len, 0);
+}
+
+static uint32_t xxh64_0(const uint8_t *buf, size_t len)
+{
+    return (uint32_t) xxh64_hash(buf, len, 0);
+}
+
+static const struct {
+    const char *name;
+    uint32_t (*hash)(const uint8_t *buf, size_t len);
+} hashes[] = {
+    { "djb2", djb2_hash },
+    { "sdbm", sdbm_hash },
+    { "kr", kr_hash },
+    { "sax", sax_hash },
+    { "dek", dek_hash },
+    { "fnv", fnv_hash },
+    { "rotating", rotating_hash },
+    { "oaat", one_at_a_time_hash },
+    { "xxh32", xxh32_0 },
+    { "xxh64", xxh64_0 },
+};
+
+static uint8_t buf[64];
+
+static unsigned popcount(uint32_t x)
+{
+    unsigned n = 0;
+
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+
+    return n;
+}
+
+/* average number of output bits that change when one bit of a 16 byte key
+ * flips, in tenths, 160 is ideal */
+static unsigned avalanche(uint32_t (*hash)(const uint8_t *, size_t))
+{
+    unsigned long changed = 0;
+    uint32_t h;
+
+    h = hash(buf, 16);
+
+    for (unsigned bit = 0; bit < 16 * 8; bit++) {
+        buf[bit / 8] ^= 1 << (bit % 8);
+        changed += popcount(h ^ hash(buf, 16));
+        buf[bit / 8] ^= 1 << (bit % 8);
+    }
+
+    return changed * 10 / (16 * 8);
+}
+
+static unsigned long time_hash(uint32_t (*hash)(const uint8_t *, size_t),
+                               size_t len)
+{
+    volatile uint32_t sink = 0;
+    unsigned long start = hwtimer_now();
+
+    for (int i = 0; i < ROUNDS; i++) {
+        buf[0] = i;
+        sink += hash(buf, len);
+    }
+
+    (void) sink;
+    return hwtimer_now() - start;
+}
+
+int main(void)
+{
+    for (unsigned i = 0; i < sizeof(buf); i++) {
+        buf[i] = i * 7;
+    }
+
+    printf("hwtimer ticks per %d calls, avalanche in tenths of bits (160 ideal)\n\n",
+           ROUNDS);
+    printf("%-10s %10s %10s %10s\n", "hash", "16 bytes", "64 bytes", "avalanche");
+
+    for (unsigned i = 0; i < sizeof(hashes) / sizeof(hashes[0]); i++) {
+        unsigned long t16 = time_hash(hashes[i].hash, 16);
+        unsigned long t64 = time_hash(hashes[i].hash, 64);
+
+        printf("%-10s %10lu %10lu %10u\n", hashes[i].name, t16, t64,
+               avalanche(hashes[i].hash));
+    }
+
+    puts("\nAll done!");
+    return 0;
+}
@@ -25,7 +25,7 @@
 #define BASE_DELAY (1000UL * 1000UL)
 #define DELTA_DELAY (1000UL * 1000UL)
 #define MSGLEN 12 // == strlen("callback %2i")
-char msg[MSGLEN * HWTIMER_MAXTIMERS]; // == [callback  1\0callback  2\0...]
+char msg[MSGLEN * HWTIMER_VIRTUAL_TIMERS]; // == [callback  1\0callback  2\0...]
 
 void callback(void *ptr)
 {
@@ -38,14 +38,14 @@ int main(void)
 
     puts("");
     puts("  Timers should print \"callback x\" once when they run out.");
-    printf("  The order for x is 1, n-1, n-2, ..., 2 where n is the number of available hardware timers (%u on this platform).\n", HWTIMER_MAXTIMERS);
+    printf("  The order for x is 1, n, n-1, ..., 2 where n is the number of available timers (%u on this platform).\n", HWTIMER_VIRTUAL_TIMERS);
     puts("  One timer should fire every second until all timers have run out.");
     puts("  Additionally the message \"hwtimer set.\" should be printed once 1 second from now.");
     puts("");
     puts("Setting timers:");
     puts("");
 
-    unsigned long delay = BASE_DELAY + ((HWTIMER_MAXTIMERS - 1) * DELTA_DELAY);
+    unsigned long delay = BASE_DELAY + (HWTIMER_VIRTUAL_TIMERS * DELTA_DELAY);
 
     /* make the first timer first to fire so timers do not run out linearly */
     char *msgn = msg;
@@ -53,9 +53,8 @@ int main(void)
     hwtimer_set(HWTIMER_TICKS(BASE_DELAY), callback, (void *) msgn);
     printf("set %s\n", msgn);
 
-    /* set up to HWTIMER_MAXTIMERS-1 because hwtimer_wait below also
-     * needs a timer */
-    for (int i = 1; i < (HWTIMER_MAXTIMERS - 1); i++) {
+    /* hwtimer_wait below does not need one of them */
+    for (int i = 1; i < HWTIMER_VIRTUAL_TIMERS; i++) {
         msgn = msg + (i * MSGLEN);
         delay -= DELTA_DELAY;
         snprintf(msgn, MSGLEN, "callback %2x", i + 1);
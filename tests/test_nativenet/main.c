@@ -85,7 +85,7 @@ void radio(void)
                 printf("sender was %i\n", p->src);
             }
 
-            p->processing--;
+            transceiver_release(p);
         }
         else if (m.type == ENOBUFFER) {
             puts("Transceiver buffer full");
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License. See the file LICENSE in the top level directory for more
+ * details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief Stackless tasks of sys/ptask
+ *
+ * Runs a few dozen sleeping tasks, a producer and a consumer waiting on
+ * each other and a task receiving the messages of a thread, all on the
+ * stack of the main thread.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "kernel.h"
+#include "msg.h"
+#include "thread.h"
+#include "vtimer.h"
+#include "ptask.h"
+
+#define SLEEPERS        (24)
+#define TICKS           (3)
+#define ITEMS           (10)
+#define MESSAGES        (5)
+#define MSG_TYPE_TEST   (0x1234)
+
+typedef struct {
+    ptask_t task;
+    unsigned int ticks;
+} sleeper_t;
+
+static sleeper_t sleepers[SLEEPERS];
+static ptask_t producer, consumer, receiver, reporter;
+
+static unsigned int sleepers_done;
+static unsigned int slot, produced, consumed;
+static unsigned int received;
+
+static char sender_stack[KERNEL_CONF_STACKSIZE_PRINTF];
+
+static int sleeper(ptask_t *t)
+{
+    sleeper_t *s = (sleeper_t *) t;
+
+    PTASK_BEGIN(t);
+
+    for (s->ticks = 0; s->ticks < TICKS; s->ticks++) {
+        PTASK_SLEEP(t, 10000 * ((uintptr_t) t->arg + 1));
+    }
+
+    sleepers_done++;
+
+    PTASK_END(t);
+}
+
+static int produce(ptask_t *t)
+{
+    PTASK_BEGIN(t);
+
+    while (produced < ITEMS) {
+        PTASK_WAIT_UNTIL(t, slot == 0);
+        slot = ++produced;
+        PTASK_YIELD(t);
+    }
+
+    PTASK_END(t);
+}
+
+static int consume(ptask_t *t)
+{
+    PTASK_BEGIN(t);
+
+    while (consumed < ITEMS) {
+        PTASK_WAIT_UNTIL(t, slot != 0);
+
+        if (slot != consumed + 1) {
+            printf("consumer: got %u, expected %u\n", slot, consumed + 1);
+        }
+
+        consumed = slot;
+        slot = 0;
+    }
+
+    PTASK_END(t);
+}
+
+static int receive(ptask_t *t)
+{
+    PTASK_BEGIN(t);
+
+    while (received < MESSAGES) {
+        ptask_wait_msg(t, MSG_TYPE_TEST);
+        ptask_wait_timeout(t, 2000000);
+        PTASK_WAIT(t);
+
+        if (!(t->event & PTASK_EV_MSG)) {
+            puts("receiver: timeout");
+            PTASK_EXIT(t);
+        }
+
+        if (t->msg.content.value != received) {
+            printf("receiver: got %u, expected %u\n",
+                   (unsigned int) t->msg.content.value,
+                   received);
+        }
+
+        received++;
+    }
+
+    PTASK_END(t);
+}
+
+static int report(ptask_t *t)
+{
+    PTASK_BEGIN(t);
+
+    PTASK_WAIT_UNTIL(t, (sleepers_done == SLEEPERS) &&
+                     (consumed == ITEMS) && (received == MESSAGES));
+
+    printf("%u sleepers, %u items, %u messages\n", sleepers_done, consumed,
+           received);
+    puts("SUCCESS");
+
+    PTASK_END(t);
+}
+
+static void sender(void)
+{
+    msg_t m;
+
+    while (ptask_getpid() < 0) {
+        vtimer_usleep(10000);
+    }
+
+    for (unsigned int i = 0; i < MESSAGES; i++) {
+        vtimer_usleep(50000);
+        m.type = MSG_TYPE_TEST;
+        m.content.value = i;
+        msg_send(&m, ptask_getpid(), true);
+    }
+}
+
+int main(void)
+{
+    puts("ptask test");
+
+    for (unsigned int i = 0; i < SLEEPERS; i++) {
+        ptask_init(&sleepers[i].task, sleeper, (void *)(uintptr_t) i);
+        ptask_start(&sleepers[i].task);
+    }
+
+    ptask_init(&producer, produce, NULL);
+    ptask_init(&consumer, consume, NULL);
+    ptask_init(&receiver, receive, NULL);
+    ptask_init(&reporter, report, NULL);
+    ptask_start(&producer);
+    ptask_start(&consumer);
+    ptask_start(&receiver);
+    ptask_start(&reporter);
+
+    thread_create(sender_stack, sizeof(sender_stack), PRIORITY_MAIN - 1,
+                  CREATE_STACKTEST, sender, "sender");
+
+    ptask_run();
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+* Copyright (C) 2014 Freie Universität Berlin
+*
+* This file is subject to the terms and conditions of the GNU Lesser General
+* Public License. See the file LICENSE in the top level directory for more
+* details.
+*/
+
+/**
+* @ingroup tests
+* @{
+*
+* @file
+* @brief pthread_cond test
+*
+* @}
+*/
+
+#include <stdio.h>
+
+#include "pthread.h"
+#include "thread.h"
+
+#define NUM_CONSUMERS 4
+#define NUM_ITEMS 100
+
+static pthread_mutex_t mutex;
+static pthread_cond_t not_empty;
+static pthread_cond_t go = PTHREAD_COND_INITIALIZER;
+
+static int items;
+static int started;
+static int done;
+
+static void *consume(void *id_)
+{
+    int id = (intptr_t) id_ + 1;
+    int count = 0;
+
+    pthread_mutex_lock(&mutex);
+
+    /* wait for the broadcast to start */
+    ++started;
+    while (started <= NUM_CONSUMERS) {
+        pthread_cond_wait(&go, &mutex);
+    }
+
+    while (1) {
+        while ((items == 0) && !done) {
+            pthread_cond_wait(&not_empty, &mutex);
+        }
+
+        if (items == 0) {
+            break;
+        }
+
+        --items;
+        ++count;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    printf("Consumer %i took %i items.\n", id, count);
+    return (void *) (intptr_t) count;
+}
+
+int main(void)
+{
+    puts("Start.");
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&not_empty, NULL);
+
+    pthread_t children[NUM_CONSUMERS];
+    for (int i = 0; i < NUM_CONSUMERS; ++i) {
+        pthread_create(&children[i], NULL, consume, (void *) (intptr_t) i);
+    }
+
+    pthread_mutex_lock(&mutex);
+    while (started < NUM_CONSUMERS) {
+        pthread_mutex_unlock(&mutex);
+        thread_yield();
+        pthread_mutex_lock(&mutex);
+    }
+    ++started;
+    pthread_cond_broadcast(&go);
+    pthread_mutex_unlock(&mutex);
+
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        pthread_mutex_lock(&mutex);
+        ++items;
+        pthread_cond_signal(&not_empty);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    pthread_mutex_lock(&mutex);
+    done = 1;
+    pthread_cond_broadcast(&not_empty);
+    pthread_mutex_unlock(&mutex);
+
+    int total = 0;
+    for (int i = 0; i < NUM_CONSUMERS; ++i) {
+        void *count;
+        pthread_join(children[i], &count);
+        total += (intptr_t) count;
+    }
+
+    pthread_cond_destroy(&not_empty);
+    pthread_cond_destroy(&go);
+
+    printf("%i of %i items consumed.\n", total, NUM_ITEMS);
+    puts(total == NUM_ITEMS ? "SUCCESS" : "FAILURE");
+    return 0;
+}
@@ -28,6 +28,8 @@
 
 #define SHELL_BUFSIZE   (UART0_BUFSIZE)
 
+static shell_t shell;
+
 static void print_teststart(int argc, char **argv)
 {
     (void) argc;
@@ -50,6 +52,18 @@ static void print_echo(int argc, char **argv)
     puts("");
 }
 
+static void run_script(int argc, char **argv)
+{
+    (void) argc;
+    (void) argv;
+    char script[] = "# runs a few commands\n"
+                    "start_test\n"
+                    "\n"
+                    "echo batch \"two words\"\r\n"
+                    "end_test";
+    shell_run_script(&shell, script);
+}
+
 static int shell_readc(void)
 {
     char c;
@@ -69,6 +83,7 @@ static const shell_command_t shell_commands[] = {
     { "start_test", "starts a test", print_teststart },
     { "end_test", "ends a test", print_testend },
     { "echo", "prints the input command", print_echo },
+    { "script", "runs a script of commands", run_script },
     { NULL, NULL, NULL }
 };
 
@@ -82,7 +97,6 @@ int main(void)
     posix_open(uart0_handler_pid, 0);
 
     /* define own shell commands */
-    shell_t shell;
     shell_init(&shell, shell_commands, SHELL_BUFSIZE, shell_readc,
                shell_putchar);
     shell_run(&shell);
@@ -24,6 +24,7 @@
 #include <flags.h>
 #include <kernel.h>
 #include <mutex.h>
+#include <hwtimer.h>
 
 #define STACK_SIZE (KERNEL_CONF_STACKSIZE_MAIN)
 #define PROBLEM 12
@@ -75,6 +76,8 @@ int main(void)
 
     printf("Problem: %" PRIu32 "\n", PROBLEM);
 
+    unsigned long start = hwtimer_now();
+
     msg_t args[PROBLEM];
 
     for (int i = 0; i < PROBLEM; ++i) {
@@ -100,6 +103,7 @@ int main(void)
         printf("Reveiced message %d from thread %d\n", i, msg.content.value);
     }
 
+    printf("Elapsed: %lu hwtimer ticks\n", hwtimer_now() - start);
     printf("Factorial: %" PRIu32 "\n", storage);
 
     if (storage != 479001600) {